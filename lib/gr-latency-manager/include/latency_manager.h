@@ -28,9 +28,14 @@ namespace gr {
   namespace latency_manager {
 
     /*!
-     * \brief <+description of block+>
+     * \brief Caps the items in flight after it at max_tags_in_flight *
+     * tag_interval
      * \ingroup latency_manager
      *
+     * Every tag_interval'th item it passes is tagged with a latency_strobe,
+     * which uses up one of its tokens. A message on its token port, which a
+     * tag_to_msg at the end of the chain sends as the strobes get there,
+     * hands one back. It has no more than max_tags_in_flight tokens.
      */
     class LATENCY_MANAGER_API latency_manager : virtual public gr::sync_block
     {
@@ -38,6 +43,15 @@ namespace gr {
       typedef std::shared_ptr<latency_manager> sptr;
 
       static sptr make(int max_tags_in_flight, int tag_interval, int itemsize);
+
+      /*!
+       * \brief Hand all the tokens back after it has had none for this
+       * long, 0 to wait for them forever (the default)
+       *
+       * A strobe lost on the way, to a block that doesn't pass tags on,
+       * doesn't then hold the stream up for good.
+       */
+      virtual void set_starved_timeout(double seconds) = 0;
     };
 
   } // namespace latency_manager
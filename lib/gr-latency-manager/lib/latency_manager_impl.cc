@@ -38,7 +38,9 @@ namespace gr {
 
     void latency_manager_impl::add_token(pmt::pmt_t msg)
     {
-        d_tokens++;
+        // A strobe that was given up on can still turn up
+        if (d_tokens < d_max_tokens)
+          d_tokens++;
         //std::cout << "Tokens: " << d_tokens << " : Added one\n";
     }
 
@@ -51,6 +53,9 @@ namespace gr {
         d_tag_phase(0)
     {
         d_tokens = max_tags_in_flight;
+        d_max_tokens = max_tags_in_flight;
+        d_starved_timeout = 0;
+        d_starved = false;
         message_port_register_in(pmt::mp("token"));
         set_msg_handler(pmt::mp("token"), [this](pmt::pmt_t msg) { this->add_token(msg); });
         d_tag.key = pmt::intern("latency_strobe");
@@ -62,6 +67,11 @@ namespace gr {
     {
     }
 
+    void latency_manager_impl::set_starved_timeout(double seconds)
+    {
+        d_starved_timeout = seconds;
+    }
+
     int
     latency_manager_impl::work(int noutput_items,
         gr_vector_const_void_star &input_items,
@@ -70,6 +80,19 @@ namespace gr {
       const char *in = (const char*) input_items[0];
       char *out = (char *) output_items[0];
 
+      if (d_tokens > 0) {
+        d_starved = false;
+      } else if (d_starved_timeout > 0) {
+        boost::posix_time::ptime now(boost::posix_time::microsec_clock::universal_time());
+        if (!d_starved) {
+          d_starved = true;
+          d_starved_since = now;
+        } else if ((now - d_starved_since).total_microseconds() > d_starved_timeout * 1e6) {
+          d_tokens = d_max_tokens;
+          d_starved = false;
+        }
+      }
+
       int copy_count = std::min(noutput_items, d_tag_phase + d_tokens * d_tag_interval);
       std::memcpy(out, in, copy_count * d_itemsize);
       //std::cout << "Copied: " << copy_count << "\n";
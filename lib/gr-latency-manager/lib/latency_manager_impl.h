@@ -22,6 +22,7 @@
 #define INCLUDED_LATENCY_MANAGER_LATENCY_MANAGER_IMPL_H
 
 #include "../include/latency_manager.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace gr {
   namespace latency_manager {
@@ -30,6 +31,10 @@ namespace gr {
     {
      private:
         int d_tokens;
+        int d_max_tokens;
+        double d_starved_timeout;
+        bool d_starved;
+        boost::posix_time::ptime d_starved_since;
         void add_token(pmt::pmt_t tag);
         int d_itemsize;
         int d_tag_interval;
@@ -40,6 +45,8 @@ namespace gr {
       latency_manager_impl(int max_tags_in_flight, int tag_interval, int itemsize);
       ~latency_manager_impl();
 
+      void set_starved_timeout(double seconds);
+
       // Where all the action really happens
       int work(
               int noutput_items,
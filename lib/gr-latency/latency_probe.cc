@@ -42,7 +42,8 @@ latency_probe::latency_probe (int item_size, std::vector<std::string> keys)
 	: gr::sync_block ("probe",
 		gr::io_signature::make(1,1, item_size),
 		gr::io_signature::make (0,1, item_size)),
-      d_itemsize(item_size)
+      d_itemsize(item_size),
+      d_last_origin(0)
 {
     for(size_t i=0; i<keys.size(); i++){
         pmt::pmt_t this_key( pmt::intern(keys[i]) );
@@ -62,44 +63,29 @@ latency_probe::work (int noutput_items,
 			gr_vector_const_void_star &input_items,
 			gr_vector_void_star &output_items)
 {
-  
+
     std::vector<tag_t> tags;
-    /*
-    get_tags_in_range(tags, 0, nitems_read(0), nitems_read(0) + noutput_items);
-    for(int i=0; i<tags.size(); i++){
-        for(int j=0; j<d_keys.size(); j++){
-            if(pmt::eq(d_keys[j], tags[i].key)){
-                // get current time
-                ptime now(boost::posix_time::microsec_clock::universal_time());
-                ptime epoch(boost::gregorian::date(1970,1,1));
-                time_duration diff = now - epoch;
-                double time = diff.total_seconds() + diff.fractional_seconds() * 1e-6;
- 
-                // compute time difference from tag
-                double ddiff = time - pmt::to_double(tags[i].value);
-                std::cout << " Delay: " << std::setprecision(5) << ddiff << std::endl;
-                // store it in our measurement structure
-                latmes_t tp = {tags[i].offset, ddiff, pmt::to_double(tags[i].value), time};
-                d_measurements[ tags[i].key ].push_back( tp );
-                }
-            }
-        }*/
-    get_tags_in_range(tags, 0, nitems_read(0), nitems_read(0) + (uint64_t)noutput_items,pmt::intern("recorder"));
-    for(int i=0; i<tags.size(); i++){
-
-                // get current time
-                ptime now(boost::posix_time::microsec_clock::universal_time());
-                ptime epoch(boost::gregorian::date(1970,1,1));
-                time_duration diff = now - epoch;
-                double time = diff.total_seconds() + diff.fractional_seconds() * 1e-6;
- 
-                // compute time difference from tag
-                double ddiff = time - pmt::to_double(tags[i].value);
-                std::cout << " Delay: " << std::setprecision(5) << ddiff << std::endl;
-
-                }
-            
-        
+    for(size_t j=0; j<d_keys.size(); j++){
+        get_tags_in_range(tags, 0, nitems_read(0), nitems_read(0) + (uint64_t)noutput_items, d_keys[j]);
+        if(tags.empty())
+            continue;
+
+        // get current time
+        ptime now(boost::posix_time::microsec_clock::universal_time());
+        ptime epoch(boost::gregorian::date(1970,1,1));
+        time_duration diff = now - epoch;
+        double time = diff.total_seconds() + diff.fractional_seconds() * 1e-6;
+
+        std::lock_guard<std::mutex> lock(d_mutex);
+        for(size_t i=0; i<tags.size(); i++){
+            // compute time difference from tag and store it in our measurement structure
+            double t_start = pmt::to_double(tags[i].value);
+            latmes_t tp = {tags[i].offset, time - t_start, t_start, time};
+            d_measurements[ d_keys[j] ].push_back( tp );
+            d_last_origin = t_start;
+        }
+    }
+
 	// copy outputs if connected and return
     if(output_items.size() > 0){
         memcpy(output_items[0], input_items[0], noutput_items*d_itemsize);
@@ -112,6 +98,7 @@ typedef std::vector<lm> lmv;
 typedef std::map< pmt::pmt_t, lmv > mt;
 
 std::vector<std::string> latency_probe::get_keys(){
+    std::lock_guard<std::mutex> lock(d_mutex);
     std::vector<std::string> keys;
     for(mt::iterator i = d_measurements.begin(); i!=d_measurements.end(); i++){
         keys.push_back( pmt::symbol_to_string( (*i).first ) );
@@ -121,10 +108,12 @@ std::vector<std::string> latency_probe::get_keys(){
 
 
 std::vector<unsigned long> latency_probe::get_offsets(std::string key){
+    std::lock_guard<std::mutex> lock(d_mutex);
     if(d_measurements.find(pmt::intern(key)) == d_measurements.end())
         throw std::runtime_error("latency_probe::get_offsets() called with invalid key");
     lmv pv = d_measurements[pmt::intern(key)];
-    std::vector<unsigned long> offsets(pv.size());
+    std::vector<unsigned long> offsets;
+    offsets.reserve(pv.size());
     for(lmv::iterator i = pv.begin(); i != pv.end(); i++){
         offsets.push_back( (*i).offset );
     }
@@ -132,10 +121,12 @@ std::vector<unsigned long> latency_probe::get_offsets(std::string key){
 }
 
 std::vector<double> latency_probe::get_delays(std::string key){
+    std::lock_guard<std::mutex> lock(d_mutex);
     if(d_measurements.find(pmt::intern(key)) == d_measurements.end())
         throw std::runtime_error("latency_probe::get_delays() called with invalid key");
     lmv pv = d_measurements[pmt::intern(key)];
-    std::vector<double> delays(pv.size());
+    std::vector<double> delays;
+    delays.reserve(pv.size());
     for(lmv::iterator i = pv.begin(); i != pv.end(); i++){
         delays.push_back( (*i).delay );
     }
@@ -143,10 +134,12 @@ std::vector<double> latency_probe::get_delays(std::string key){
 }
 
 std::vector<double> latency_probe::get_t_start(std::string key){
+    std::lock_guard<std::mutex> lock(d_mutex);
     if(d_measurements.find(pmt::intern(key)) == d_measurements.end())
         throw std::runtime_error("latency_probe::get_t_start() called with invalid key");
     lmv pv = d_measurements[pmt::intern(key)];
-    std::vector<double> times(pv.size());
+    std::vector<double> times;
+    times.reserve(pv.size());
     for(lmv::iterator i = pv.begin(); i != pv.end(); i++){
         times.push_back( (*i).t_start );
     }
@@ -154,18 +147,41 @@ std::vector<double> latency_probe::get_t_start(std::string key){
 }
 
 std::vector<double> latency_probe::get_t_end(std::string key){
+    std::lock_guard<std::mutex> lock(d_mutex);
     if(d_measurements.find(pmt::intern(key)) == d_measurements.end())
         throw std::runtime_error("latency_probe::get_t_end() called with invalid key");
     lmv pv = d_measurements[pmt::intern(key)];
-    std::vector<double> times(pv.size());
+    std::vector<double> times;
+    times.reserve(pv.size());
     for(lmv::iterator i = pv.begin(); i != pv.end(); i++){
         times.push_back( (*i).t_end );
     }
     return times;
 }
 
+std::vector<double> latency_probe::take_delays(std::string key){
+    std::vector<double> delays;
+    std::lock_guard<std::mutex> lock(d_mutex);
+    mt::iterator it = d_measurements.find(pmt::intern(key));
+    if(it == d_measurements.end())
+        throw std::runtime_error("latency_probe::take_delays() called with invalid key");
+    delays.reserve(it->second.size());
+    for(lmv::iterator i = it->second.begin(); i != it->second.end(); i++){
+        delays.push_back( (*i).delay );
+    }
+    it->second.clear();
+    return delays;
+}
+
+double latency_probe::last_origin(){
+    return d_last_origin;
+}
+
 void latency_probe::reset(){
-    d_measurements.clear();
+    std::lock_guard<std::mutex> lock(d_mutex);
+    for(mt::iterator i = d_measurements.begin(); i!=d_measurements.end(); i++){
+        (*i).second.clear();
+    }
 }
 
   } /* namespace latency_probe */
@@ -22,7 +22,9 @@
 #define INCLUDED_LATENCY_PROBE_H
 
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <gnuradio/sync_block.h>
 #include "boost/tuple/tuple.hpp" 
 
@@ -53,8 +55,12 @@ typedef struct  {
 } latmes_t;
 
 /*!
- * \brief <+description+>
+ * \brief Measures how long ago the time tags with one of its keys that
+ * pass it were stamped
  *
+ * The measurements are kept until they are read back, which can be done
+ * from another thread while the flowgraph runs. The output is optional, a
+ * probe is usually left hanging off the port it measures.
  */
 
 class LATENCY_PROBE_API latency_probe : public gr::sync_block
@@ -65,6 +71,8 @@ class LATENCY_PROBE_API latency_probe : public gr::sync_block
     std::vector<pmt::pmt_t> d_keys;
     int d_itemsize;
     std::map< pmt::pmt_t, std::vector< latmes_t  > > d_measurements;
+    std::mutex d_mutex;
+    std::atomic<double> d_last_origin;
  public:
      typedef std::shared_ptr<latency_probe> sptr;
     static sptr make(int item_size, std::vector<std::string> keys);
@@ -79,6 +87,11 @@ class LATENCY_PROBE_API latency_probe : public gr::sync_block
     std::vector<double> get_t_start(std::string key);
     std::vector<double> get_t_end(std::string key);
 
+    // The delays measured for key since the last call, which are cleared
+    std::vector<double> take_delays(std::string key);
+    // The time in the last tag seen, 0 before there has been one
+    double last_origin();
+
     void reset();
 };
   }
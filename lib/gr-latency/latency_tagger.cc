@@ -34,20 +34,22 @@ using boost::posix_time::time_duration;
 namespace gr {
   namespace gr_latency {
 
-latency_tagger::sptr latency_tagger::make  (int item_size, int tag_frequency, std::string tag)
+latency_tagger::sptr latency_tagger::make  (int item_size, int tag_frequency, std::string tag, latency_probe::sptr origin)
 {
-	return gnuradio::get_initial_sptr(new latency_tagger (item_size, tag_frequency, tag));
+	return gnuradio::get_initial_sptr(new latency_tagger (item_size, tag_frequency, tag, origin));
 }
 
 
-latency_tagger::latency_tagger (int item_size, int tag_frequency, std::string tag)
+latency_tagger::latency_tagger (int item_size, int tag_frequency, std::string tag, latency_probe::sptr origin)
 	: gr::sync_block ("latency_tagger",
 		gr::io_signature::make (1, 1, item_size),
 		gr::io_signature::make (1, 1, item_size)),
       d_tag_frequency(tag_frequency),
       d_key(pmt::intern(tag)),
       d_src(pmt::intern(name())),
-      d_itemsize(item_size)
+      d_itemsize(item_size),
+      d_origin(origin),
+      d_last_origin(0)
 {
 }
 
@@ -64,15 +66,22 @@ latency_tagger::work (int noutput_items,
 {
     // add time tags where appropriate
     uint64_t start(nitems_written(0));
-    for(uint64_t i=start; i<start+noutput_items; i++){
-        if(i%d_tag_frequency==0){
+    uint64_t end(start + noutput_items);
+    uint64_t i = ((start + d_tag_frequency - 1) / d_tag_frequency) * d_tag_frequency;
+    for(; i<end; i+=d_tag_frequency){
+        double time;
+        if(d_origin){
+            time = d_origin->last_origin();
+            if(time == d_last_origin)
+                continue;
+            d_last_origin = time;
+        } else {
             ptime now(boost::posix_time::microsec_clock::universal_time());
             ptime epoch(boost::gregorian::date(1970,1,1));
             time_duration diff = now - epoch;
-            double time = diff.total_seconds() + diff.fractional_seconds() * 1e-6;
-            add_item_tag(0, i, d_key, pmt::from_double(time), d_src);
-            std::cout << "tagged " << i << " with " << time << std::endl;
+            time = diff.total_seconds() + diff.fractional_seconds() * 1e-6;
         }
+        add_item_tag(0, i, d_key, pmt::from_double(time), d_src);
     }
 
     // move data and return
@@ -26,6 +26,8 @@
 
 #include <gnuradio/attributes.h>
 
+#include "latency_probe.h"
+
 #ifdef gnuradio_latency_tagger_EXPORTS
 #define LATENCY_TAGGER_API __GR_ATTR_EXPORT
 #else
@@ -34,8 +36,14 @@
 
 
 /*!
- * \brief <+description+>
+ * \brief Copies its input through and stamps every tag_frequency'th item
+ * with a tag holding the time, in seconds since the epoch
  *
+ * Made with an origin probe it is a relay: the tags hold the last time the
+ * probe was seen instead of now, and an item is only stamped when that has
+ * changed. Put after a block whose output doesn't follow its input item for
+ * item, like a frame assembler, with the probe in front of it, the time the
+ * tags started out with carries on past it.
  */
 
 namespace gr {
@@ -44,15 +52,17 @@ class LATENCY_TAGGER_API latency_tagger : public gr::sync_block
 {
 
 
-	latency_tagger (int item_size, int tag_frequency, std::string tag);
+	latency_tagger (int item_size, int tag_frequency, std::string tag, latency_probe::sptr origin);
     int d_tag_frequency;
     int d_itemsize;
     pmt::pmt_t d_key;
     pmt::pmt_t d_src;
+    latency_probe::sptr d_origin;
+    double d_last_origin;
 
  public:
  	typedef std::shared_ptr<latency_tagger> sptr;
-    static sptr make(int item_size, int tag_frequency, std::string tag);
+    static sptr make(int item_size, int tag_frequency, std::string tag, latency_probe::sptr origin = latency_probe::sptr());
 	~latency_tagger ();
 
 	int work (int noutput_items,
@@ -6,9 +6,9 @@
  *  Created on: Feb 19, 2017
  *      Author: S. Lukic
  */
-#include "bit_utils.h"
 #include "lfsr.h"
-#include <iostream>
+#include <map>
+#include <mutex>
 
 /*************************************************
  * Implementation of class p25p2_lfsr
@@ -16,113 +16,75 @@
 
 
 p25p2_lfsr::p25p2_lfsr(unsigned nac, unsigned sysid, unsigned wacn) :
-  xor_chars(new std::string)
+  xor_chars(mk_xor_chars(nac, sysid, wacn))
 {
+}
 
-  // Initialize M
-  for (unsigned i=0; i<msize; i++) {
-    for (unsigned j=0; j<msize; j++) {
-      M(i,j) = 0;
-    }
-    M(i, i) = 1;
-    if ( i<msize-4 ) M(i, i+4) = 1;
-    if ( i<msize-9 ) M(i, i+9) = 1;
-    if ( i<msize-15 ) M(i, i+15) = 1;
-    if ( i<msize-20 ) M(i, i+20) = 1;
-    if ( i<msize-34 ) M(i, i+34) = 1;
-  }
-
-  Eigen::VectorXi *xorbits = mk_xor_bits(nac,sysid,wacn);
-
-
-  xorsyms = new Eigen::VectorXi(xorbits->size( )/2);
-  for (unsigned i=0; i<xorsyms->size(); i++) {
-    (*xorsyms)(i) = ((*xorbits)(i*2) << 1) + (*xorbits)(i*2+1);
-    (*xor_chars) += (char)((*xorsyms)(i)%(1<<8));
-  }
 
+const char * p25p2_lfsr::getXorChars(unsigned &len) const {
 
+  len = xor_chars.size();
+  return xor_chars.c_str();
 }
 
 
-const char * p25p2_lfsr::getXorChars(unsigned &len) const {
+const char * p25p2_lfsr::getXorChars(unsigned nac, unsigned sysid, unsigned wacn, unsigned &len) {
 
-  len = xor_chars->size();
-  return xor_chars->c_str();
-}
+  // The entries are never removed, so what c_str() gives out stays good
+  static std::mutex cache_mutex;
+  static std::map<unsigned long long, std::string> cache;
 
+  unsigned long long key = ((unsigned long long)wacn << 32) ^ ((unsigned long long)sysid << 16) ^ nac;
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  std::map<unsigned long long, std::string>::iterator it = cache.find(key);
+  if (it == cache.end()) {
+    it = cache.emplace(key, mk_xor_chars(nac, sysid, wacn)).first;
+  }
+  len = it->second.size();
+  return it->second.c_str();
+}
 
-Eigen::VectorXi * p25p2_lfsr::mk_xor_bits(unsigned long nac, unsigned long sysid, unsigned long wacn) {
 
-  unsigned long long int n = 16777216ULL*wacn + 4096*sysid + nac;
-  Eigen::VectorXi *reg = mk_array(n, 44);
+/* The starting register is the 44 bit (WACN, System ID, NAC) times the
+ * matrix M of lfsr.py, which has ones on the diagonal and at 4, 9, 15, 20
+ * and 34 to the right of it. With the first element of the vector as the
+ * top bit of the register, each bit of the product is the XOR of the bits
+ * that many below it, which is a handful of shifts rather than a 44 x 44
+ * matrix multiply. Each pair of output bits is a symbol.
+ */
+std::string p25p2_lfsr::mk_xor_chars(unsigned long long nac, unsigned long long sysid, unsigned long long wacn) {
 
-  Eigen::VectorXi product = reg->transpose()*M;
+  const unsigned long long reg_mask = (1ULL << msize) - 1;
+  unsigned long long n = (16777216ULL*wacn + 4096ULL*sysid + nac) & reg_mask;
 
-  unsigned long long sreg = mk_int(product);
+  unsigned long long sreg = n ^ (n >> 4) ^ (n >> 9) ^ (n >> 15) ^ (n >> 20) ^ (n >> 34);
 
   const unsigned ssize = 4320;
-  Eigen::VectorXi *s = new Eigen::VectorXi(ssize);
-  for (unsigned i=0; i<ssize; i++) {
-    (*s)(i) = (sreg >> 43) & 1;
+  std::string chars(ssize/2, '\0');
+  for (unsigned i=0; i<ssize/2; i++) {
+    unsigned b1 = (sreg >> 43) & 1;
+    sreg = cyc_reg(sreg);
+    unsigned b2 = (sreg >> 43) & 1;
     sreg = cyc_reg(sreg);
+    chars[i] = (char)((b1 << 1) + b2);
   }
 
+  return chars;
 
-  return s;
-
-}
-
-
-unsigned long long p25p2_lfsr::asm_reg(unsigned long long s[6] ) {
-  s[0] = s[0] & 0xfULL;
-  s[1] = s[1] & 0x1fULL;
-  s[2] = s[2] & 0x3fULL;
-  s[3] = s[3] & 0x1fULL;
-  s[4] = s[4] & 0x3fffULL;
-  s[5] = s[5] & 0x3ffULL;
-  return (s[0]<<40)+(s[1]<<35)+(s[2]<<29)+(s[3]<<24)+(s[4]<<10)+s[5];
 }
 
-unsigned long long * p25p2_lfsr::disasm_reg(unsigned long long r) {
-
-  unsigned long long *s = new unsigned long long[6];
-  s[0] = (r>>40) & 0xfULL;
-  s[1] = (r>>35) & 0x1fULL;
-  s[2] = (r>>29) & 0x3fULL;
-  s[3] = (r>>24) & 0x1fULL;
-  s[4] = (r>>10) & 0x3fffULL;
-  s[5] =  r      & 0x3ffULL;
-
-  return s;
-}
 
+/* lfsr.py splits the register into fields of 4, 5, 6, 5, 14 and 10 bits,
+ * shifts each one up by a bit and feeds into the bottom of each the top bit
+ * of the register XOR the bit shifted out of the field below it, with the
+ * last field given the top bit alone. Shifting the whole register up
+ * already puts the bit out of each field into the bottom of the next
+ * one, so that is XORing the top bit into the bottom of every field.
+ */
 unsigned long long p25p2_lfsr::cyc_reg(unsigned long long reg) {
 
-  unsigned long long *s = disasm_reg(reg);
-  unsigned long long cy1 = (s[0] >> 3) & 1L;
-  unsigned long long cy2 = (s[1] >> 4) & 1L;
-  unsigned long long cy3 = (s[2] >> 5) & 1L;
-  unsigned long long cy4 = (s[3] >> 4) & 1L;
-  unsigned long long cy5 = (s[4] >> 13) & 1L;
-  unsigned long long cy6 = (s[5] >> 9) & 1L;
-  unsigned long long x1 = cy1 ^ cy2;
-  unsigned long long x2 = cy1 ^ cy3;
-  unsigned long long x3 = cy1 ^ cy4;
-  unsigned long long x4 = cy1 ^ cy5;
-  unsigned long long x5 = cy1 ^ cy6;
-  s[0] = (s[0] << 1) & 0xfULL;
-  s[1] = (s[1] << 1) & 0x1fULL;
-  s[2] = (s[2] << 1) & 0x3fULL;
-  s[3] = (s[3] << 1) & 0x1fULL;
-  s[4] = (s[4] << 1) & 0x3fffULL;
-  s[5] = (s[5] << 1) & 0x3ffULL;
-  s[0] = s[0] | (x1 & 1ULL);
-  s[1] = s[1] | (x2 & 1ULL);
-  s[2] = s[2] | (x3 & 1ULL);
-  s[3] = s[3] | (x4 & 1ULL);
-  s[4] = s[4] | (x5 & 1ULL);
-  s[5] = s[5] | (cy1 & 1ULL);
-
-  return asm_reg(s);
+  const unsigned long long field_lsbs = (1ULL<<40) | (1ULL<<35) | (1ULL<<29) | (1ULL<<24) | (1ULL<<10) | 1ULL;
+  unsigned long long cy1 = (reg >> 43) & 1ULL;
+
+  return ((reg << 1) & ((1ULL << msize) - 1)) ^ (cy1 ? field_lsbs : 0ULL);
 }
@@ -10,28 +10,29 @@
 #ifndef LFSR_H_
 #define LFSR_H_
 
-#include "Eigen/Dense"
+#include <string>
 
 class p25p2_lfsr {
 public:
   p25p2_lfsr(unsigned nac, unsigned sysid, unsigned wacn);
 
-  const Eigen::VectorXi * getXorsyms() const { return xorsyms; }
   const char * getXorChars(unsigned &len) const;
 
+  /* The XOR symbols for a system, worked out the first time they are asked
+   * for and kept for the life of the process. The pointer stays good, and
+   * the same, for every System with that WACN, System ID and NAC.
+   */
+  static const char * getXorChars(unsigned nac, unsigned sysid, unsigned wacn, unsigned &len);
+
 private:
 
-  Eigen::VectorXi * mk_xor_bits(unsigned long, unsigned long, unsigned long);
+  static std::string mk_xor_chars(unsigned long long nac, unsigned long long sysid, unsigned long long wacn);
 
-  static unsigned long long asm_reg(unsigned long long s[6] );
-  static unsigned long long * disasm_reg(unsigned long long r);
   static unsigned long long cyc_reg(unsigned long long reg);
 
-  Eigen::VectorXi *xorsyms;
-  std::string *xor_chars;
+  std::string xor_chars;
 
   static const int msize = 44;
-  Eigen::Matrix<int, msize, msize> M;
 
 };
 
@@ -0,0 +1,55 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_VOCODER_SERVICE_H
+#define INCLUDED_OP25_REPEATER_VOCODER_SERVICE_H
+
+#include <op25_repeater/api.h>
+
+namespace gr {
+  namespace op25_repeater {
+
+    /*
+     * vocoder_service
+     *   A small pool of threads that runs the IMBE / AMBE speech synthesis
+     *   of all the P25 frame assemblers, instead of each one decoding its
+     *   frames on its own flowgraph thread.
+     *
+     * Each frame assembler hands its frames to the same worker, so they are
+     * decoded in order against the right decoder state, and a worker takes
+     * everything that has queued up for it as one batch. The audio goes back
+     * through the frame assembler's output, in the order it was received,
+     * with the tone, silence and encrypted frames that are still made inline.
+     *
+     * gnuradio-op25_repeater is a shared library, so there is only the one
+     * pool; main() starts it. Before start() or after stop() the frames are
+     * decoded inline as they always were.
+     */
+    class OP25_REPEATER_API vocoder_service
+    {
+    public:
+      static void start(int threads);
+      static void stop();
+      static bool running();
+      static void print_stats();
+    };
+
+  } // namespace op25_repeater
+} // namespace gr
+
+#endif /* INCLUDED_OP25_REPEATER_VOCODER_SERVICE_H */
@@ -0,0 +1,85 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "audio_ring.h"
+
+#include <algorithm>
+#include <string.h>
+
+static size_t round_up_pow2(size_t n) {
+	size_t p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+audio_ring::audio_ring(size_t capacity) :
+	d_buf(round_up_pow2(capacity)),
+	d_mask(d_buf.size() - 1),
+	d_read(0),
+	d_write(0)
+{
+}
+
+// Makes room for count more samples, keeping the ones there in order
+void audio_ring::grow(size_t count) {
+	size_t used = size();
+	std::vector<int16_t> buf(round_up_pow2(used + count));
+	read(&buf[0], used);
+	d_buf.swap(buf);
+	d_mask = d_buf.size() - 1;
+	d_read = 0;
+	d_write = used;
+}
+
+void audio_ring::write(const int16_t *samples, size_t count) {
+	if (size() + count > d_buf.size())
+		grow(count);
+	size_t start = d_write & d_mask;
+	size_t first = std::min(count, d_buf.size() - start);
+	memcpy(&d_buf[start], samples, first * sizeof(int16_t));
+	memcpy(&d_buf[0], samples + first, (count - first) * sizeof(int16_t));
+	d_write += count;
+}
+
+void audio_ring::fill(size_t count, int16_t value) {
+	if (size() + count > d_buf.size())
+		grow(count);
+	size_t start = d_write & d_mask;
+	size_t first = std::min(count, d_buf.size() - start);
+	std::fill(d_buf.begin() + start, d_buf.begin() + start + first, value);
+	std::fill(d_buf.begin(), d_buf.begin() + (count - first), value);
+	d_write += count;
+}
+
+size_t audio_ring::read(int16_t *out, size_t count) {
+	count = std::min(count, size());
+	size_t start = d_read & d_mask;
+	size_t first = std::min(count, d_buf.size() - start);
+	memcpy(out, &d_buf[start], first * sizeof(int16_t));
+	memcpy(out + first, &d_buf[0], (count - first) * sizeof(int16_t));
+	d_read += count;
+	return count;
+}
+
+void audio_ring::overwrite(size_t offset, const int16_t *samples, size_t count) {
+	size_t start = (d_read + offset) & d_mask;
+	size_t first = std::min(count, d_buf.size() - start);
+	memcpy(&d_buf[start], samples, first * sizeof(int16_t));
+	memcpy(&d_buf[0], samples + first, (count - first) * sizeof(int16_t));
+}
@@ -0,0 +1,71 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_AUDIO_RING_H
+#define INCLUDED_OP25_REPEATER_AUDIO_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+ * audio_ring
+ *   The decoded audio of a frame assembler, on its way from the voice
+ *   decoders to the block's output.
+ *
+ * A ring of samples, allocated once, that frames are written to and the
+ * block's work function copies out of in blocks, a memcpy for each of the
+ * (at most two) contiguous spans. The decoders and the work function run
+ * on the same flowgraph thread, so there is one producer and one consumer
+ * and nothing is locked. If the output falls far enough behind to fill it
+ * the ring doubles, rather than drop audio, the way the deque it replaces
+ * would have grown.
+ */
+class audio_ring {
+public:
+	audio_ring(size_t capacity = 8192);
+
+	inline size_t size() const { return d_write - d_read; }
+	inline bool empty() const { return d_write == d_read; }
+	inline void clear() { d_read = d_write; }
+
+	inline void push_back(int16_t sample) {
+		if (size() == d_buf.size())
+			grow(1);
+		d_buf[d_write++ & d_mask] = sample;
+	}
+
+	void write(const int16_t *samples, size_t count);
+	void fill(size_t count, int16_t value);
+
+	// copies out and drops up to count samples, returns how many
+	size_t read(int16_t *out, size_t count);
+
+	// replaces count samples starting offset samples in from the oldest
+	void overwrite(size_t offset, const int16_t *samples, size_t count);
+
+private:
+	void grow(size_t count);
+
+	std::vector<int16_t> d_buf;
+	size_t d_mask;
+	uint64_t d_read;     // counted from the start, the index is & d_mask
+	uint64_t d_write;
+};
+
+#endif /* INCLUDED_OP25_REPEATER_AUDIO_RING_H */
@@ -1,18 +1,19 @@
 
 #include <stdio.h>
+#include <stdint.h>
 #include <vector>
 #include <bch.h>
 /*
  * Copyright 2010, KA1RBI 
  */
-static const int bchGFexp[64] = {
+static constexpr int bchGFexp[64] = {
 	1, 2, 4, 8, 16, 32, 3, 6, 12, 24, 48, 35, 5, 10, 20, 40,
 	19, 38, 15, 30, 60, 59, 53, 41, 17, 34, 7, 14, 28, 56, 51, 37,
 	9, 18, 36, 11, 22, 44, 27, 54, 47, 29, 58, 55, 45, 25, 50, 39,
 	13, 26, 52, 43, 21, 42, 23, 46, 31, 62, 63, 61, 57, 49, 33, 0
 };
 
-static const int bchGFlog[64] = {
+static constexpr int bchGFlog[64] = {
 	-1, 0, 1, 6, 2, 12, 7, 26, 3, 32, 13, 35, 8, 48, 27, 18,
 	4, 24, 33, 16, 14, 52, 36, 54, 9, 45, 49, 38, 28, 41, 19, 56,
 	5, 62, 25, 11, 34, 31, 17, 47, 15, 23, 53, 51, 37, 44, 55, 40,
@@ -25,6 +26,33 @@ static const int bchG[48] = {
 	1, 1, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1
 };
 
+/*
+ * The syndromes are S[i] = c(alpha^i), with codeword bit j the coefficient
+ * of x^j. This has the part of each odd syndrome that each byte of the
+ * codeword adds, so one is 8 lookups instead of 63 multiplies. The even
+ * ones are squares of the odd ones, as the codeword is binary.
+ */
+struct bch_syndrome_table {
+   uint8_t part[11][8][256];   // [(i - 1) / 2][byte][value]
+
+   constexpr bch_syndrome_table() : part() {
+      for (int k = 0; k < 11; k++) {
+         for (int b = 0; b < 8; b++) {
+            for (int v = 0; v < 256; v++) {
+               int s = 0;
+               for (int t = 0; t < 8; t++) {
+                  int j = 8 * b + t;
+                  if ((j <= 62) && ((v >> t) & 1)) { s ^= bchGFexp[((2 * k + 1) * j) % 63]; }
+               }
+               part[k][b][v] = s;
+            }
+         }
+      }
+   }
+};
+
+static constexpr bch_syndrome_table bchSyn;
+
 int bchDec(bit_vector& Codeword)
 {
 
@@ -36,14 +64,21 @@ int bchDec(bit_vector& Codeword)
 
    SynError = 0; CantDecode = 0;
 
-   for(i = 1; i <= 22; i++) {
+   uint64_t cw = 0;
+   for(j = 0; j <= 62; j++) {
+      cw |= (uint64_t)Codeword[j] << j;
+   }
+   for(i = 1; i <= 22; i += 2) {
       S[i] = 0;
-      // FOR j = 0 TO 62
-      for(j = 0; j <= 62; j++) {
-         if( Codeword[j]) { S[i] = S[i] ^ bchGFexp[(i * j) % 63]; }
+      for(j = 0; j < 8; j++) {
+         S[i] ^= bchSyn.part[i / 2][j][(cw >> (8 * j)) & 0xff];
       }
       if( S[i]) { SynError = 1; }
       S[i] = bchGFlog[S[i]];
+   }
+   if( !SynError) { return 0; } // the common case, a good codeword
+   for(i = 2; i <= 22; i += 2) {
+      S[i] = (S[i / 2] == -1) ? -1 : (2 * S[i / 2]) % 63;
       // printf("S[%d] %d\n", i, S[i]);
    }
 
@@ -136,7 +171,7 @@ int bchDec(bit_vector& Codeword)
             //FOR j = 1 TO L(U)
             for(j = 1; j <= L[U]; j++) {
                if( reg[j] != -1) {
-                  reg[j] =(reg[j] + j) % 63; q = q ^ bchGFexp[reg[j]];
+                  reg[j] = reg[j] + j; if( reg[j] >= 63) { reg[j] -= 63; } q = q ^ bchGFexp[reg[j]];
                }
             }
             if( q == 0) { //store error location number indices
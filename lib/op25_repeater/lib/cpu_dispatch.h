@@ -0,0 +1,56 @@
+/* -*- c++ -*- */
+/*
+ * cpu_dispatch.h - builds the hot DSP loops for more than one CPU
+ *
+ * A function marked DSP_CLONES is compiled once for plain x86-64 and again
+ * for x86-64-v3 (AVX2, FMA) and x86-64-v4 (AVX-512), or for armv8.2-a with
+ * the dot product instructions on aarch64. The loader picks the one the CPU
+ * it is running on can do, through an ifunc, the first time it is called.
+ * It is only worth it for a function that does its own arithmetic in a
+ * loop the compiler can vectorize, what it calls is not cloned with it.
+ * The blocks that do their math through VOLK already get this from VOLK.
+ *
+ * It is off unless trunk-recorder is configured with -DCPU_DISPATCH=ON,
+ * and without a compiler and a C library that can do target_clones it
+ * does nothing.
+ */
+
+#ifndef INCLUDED_OP25_CPU_DISPATCH_H
+#define INCLUDED_OP25_CPU_DISPATCH_H
+
+#include <stdlib.h> // for __GLIBC__
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#if defined(CPU_DISPATCH) && defined(__linux__) && defined(__GLIBC__) && defined(__x86_64__) && \
+    ((defined(__clang__) && __clang_major__ >= 14) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 12))
+#define DSP_CLONES __attribute__((target_clones("default", "arch=x86-64-v3", "arch=x86-64-v4")))
+#elif defined(CPU_DISPATCH) && defined(__linux__) && defined(__GLIBC__) && defined(__aarch64__) && \
+    ((defined(__clang__) && __clang_major__ >= 16) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 14))
+#define DSP_CLONES __attribute__((target_clones("default", "dotprod")))
+#else
+#define DSP_CLONES
+#endif
+
+// The version of the DSP_CLONES functions this CPU gets, for the log
+static inline const char *cpu_dispatch_level() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+    return "x86-64-v4";
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2")) {
+    return "x86-64-v3";
+  }
+  return "x86-64";
+#elif defined(__aarch64__) && defined(__linux__) && defined(HWCAP_ASIMDDP)
+  return (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) ? "armv8.2-a+dotprod" : "armv8-a";
+#else
+  return "generic";
+#endif
+}
+
+#endif /* INCLUDED_OP25_CPU_DISPATCH_H */
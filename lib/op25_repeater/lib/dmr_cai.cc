@@ -37,7 +37,8 @@
 #include "crc16.h"
 
 dmr_cai::dmr_cai(log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr queue) :
-	d_slot{dmr_slot(0, logger, debug, msgq_id, queue), dmr_slot(1, logger, debug, msgq_id, queue)},
+	d_slot{dmr_slot(0, logger, debug, msgq_id, queue, d_pool), dmr_slot(1, logger, debug, msgq_id, queue, d_pool)},
+	d_cach_len(0),
 	d_slot_mask(3),
 	d_chan(0),
 	d_shift_reg(0),
@@ -46,7 +47,7 @@ dmr_cai::dmr_cai(log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr que
 	d_msg_queue(queue),
 	logts(logger)
 {
-	d_cach_sig.clear();
+	memset(d_cach_sig, 0, sizeof(d_cach_sig));
 	memset(d_frame, 0, sizeof(d_frame));
 }
 
@@ -100,13 +101,11 @@ int dmr_cai::get_cc(int slot) {
 }
 
 void
-dmr_cai::send_msg(const std::string& m_buf, const int m_type) {
-	if ((d_msgq_id < 0) || (d_msg_queue->full_p()))
+dmr_cai::send_msg(const uint8_t* m_buf, const size_t m_len, const int m_type) {
+	if (d_msgq_id < 0)
 		return;
 
-	gr::message::sptr msg = gr::message::make_from_string(m_buf, get_msg_type(PROTOCOL_DMR, m_type), (d_msgq_id << 1), logts.get_ts());
-	if (!d_msg_queue->full_p())
-	    d_msg_queue->insert_tail(msg);
+	d_pool.send(d_msg_queue, m_buf, m_len, get_msg_type(PROTOCOL_DMR, m_type), (d_msgq_id << 1), logts.get_ts());
 }
 
 bool
@@ -175,28 +174,39 @@ dmr_cai::extract_cach_fragment() {
 			// TODO: do something useful
 			break;
 		case 1: // Begin Short_LC
-			d_cach_sig.clear();
-			for (size_t i=0; i<sizeof(cach_payload_bits); i++)
-				d_cach_sig.push_back(d_frame[CACH + cach_payload_bits[i]]);
+			d_cach_len = 0;
+			append_cach_payload();
 			break;
 		case 2: // End Short_LC or CSBK
-			for (size_t i=0; i<sizeof(cach_payload_bits); i++)
-				d_cach_sig.push_back(d_frame[CACH + cach_payload_bits[i]]);
+			append_cach_payload();
 			decode_shortLC();
 			break;
 		case 3: // Continue Short_LC or CSBK
-			for (size_t i=0; i<sizeof(cach_payload_bits); i++)
-				d_cach_sig.push_back(d_frame[CACH + cach_payload_bits[i]]);
+			append_cach_payload();
 			break;
 	}
 }
 
+// Fragments past the four that make up a Short LC are dropped, only the
+// first 68 bits are decoded
+void
+dmr_cai::append_cach_payload() {
+	if (d_cach_len + sizeof(cach_payload_bits) > SHORT_LC_BITS)
+		return;
+	for (size_t i=0; i<sizeof(cach_payload_bits); i++)
+		d_cach_sig[d_cach_len + i] = d_frame[CACH + cach_payload_bits[i]];
+	d_cach_len += sizeof(cach_payload_bits);
+}
+
 bool
 dmr_cai::decode_shortLC()
 {
 	bool slc[68];
 	bool hmg_result = true;
 
+	if (d_cach_len < SHORT_LC_BITS)
+		return false;
+
 	// deinterleave
 	int i, src;
 	for (i = 0; i < 67; i++) {
@@ -254,12 +264,12 @@ dmr_cai::decode_shortLC()
 	}
 
 	// send up the stack for further processing
-	std::string slc_msg(4,0);
-        slc_msg[0] = slco;
+	uint8_t slc_msg[4];
+	slc_msg[0] = slco;
 	slc_msg[1] = d0;
 	slc_msg[2] = d1;
 	slc_msg[3] = d2;
-	send_msg(slc_msg, M_DMR_CACH_SLC);
+	send_msg(slc_msg, sizeof(slc_msg), M_DMR_CACH_SLC);
 
 	// decode a little further for logging purposes
 	switch(slco) {
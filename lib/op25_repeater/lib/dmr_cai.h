@@ -27,6 +27,7 @@
 
 #include "dmr_slot.h"
 #include "log_ts.h"
+#include "msg_pool.h"
 
 typedef std::vector<bool> bit_vector;
 
@@ -48,10 +49,13 @@ public:
 private:
 	static const int FRAME_SIZE = 288; // frame length in bits
 	static const int CACH       =   0; // position of CACH in frame
+	static const size_t SHORT_LC_BITS = 68; // four CACH payloads
 
 	uint8_t d_frame[FRAME_SIZE];       // array of bits comprising the current frame
+	msg_pool d_pool;                   // messages for the CACH and both slots
 	dmr_slot d_slot[2];
-	bit_vector d_cach_sig;
+	uint8_t d_cach_sig[SHORT_LC_BITS]; // CACH payloads of the current Short LC, one bit per byte
+	size_t d_cach_len;
 	int d_slot_mask;
 	int d_chan;
 	int d_shift_reg;
@@ -61,8 +65,9 @@ private:
 	log_ts& logts;
 
 	void extract_cach_fragment();
+	void append_cach_payload();
 	bool decode_shortLC();
-	void send_msg(const std::string& m_buf, const int m_type);
+	void send_msg(const uint8_t* m_buf, const size_t m_len, const int m_type);
 };
 
 #endif /* INCLUDED_DMR_CAI_H */
@@ -42,7 +42,12 @@
 
 #define _CRC_CHECK_ 0
 
-dmr_slot::dmr_slot(const int chan, log_ts& logger, const int debug, int msgq_id, gr::msg_queue::sptr queue) :
+dmr_slot::dmr_slot(const int chan, log_ts& logger, const int debug, int msgq_id, gr::msg_queue::sptr queue, msg_pool& pool) :
+	d_slot_type_valid(false),
+	d_emb_len(0),
+	d_mbc_len(0),
+	d_dhdr_len(0),
+	d_pdp_len(0),
 	d_rc(0),
 	d_sb(0),
 	d_pdp_bf(0),
@@ -62,31 +67,26 @@ dmr_slot::dmr_slot(const int chan, log_ts& logger, const int debug, int msgq_id,
 	d_chan(chan),
 	d_slot_mask(3),
 	logts(logger),
-	d_msg_queue(queue)
+	d_msg_queue(queue),
+	d_pool(pool)
 {
 	memset(d_slot, 0, sizeof(d_slot));
 	d_cc = 0;
 	d_src_id = -1;
 	d_dst_id = -1;
-	d_slot_type.clear();
-	d_lc.clear();
-	d_emb.clear();
-	d_mbc.clear();
-	d_dhdr.clear();
-	d_pdp.clear();
+	d_lc.fill(0);
+	memset(d_pi, 0, sizeof(d_pi));
 }
 
 dmr_slot::~dmr_slot() {
 }
 
 void
-dmr_slot::send_msg(const std::string& m_buf, const int m_type) {
-	if ((d_msgq_id < 0) || (d_msg_queue->full_p()))
+dmr_slot::send_msg(const uint8_t* m_buf, const size_t m_len, const int m_type) {
+	if (d_msgq_id < 0)
 		return;
 
-	gr::message::sptr msg = gr::message::make_from_string(m_buf, get_msg_type(PROTOCOL_DMR, m_type), ((d_msgq_id << 1) + (d_chan & 0x1)), logts.get_ts());
-	if (!d_msg_queue->full_p())
-	    d_msg_queue->insert_tail(msg);
+	d_pool.send(d_msg_queue, m_buf, m_len, get_msg_type(PROTOCOL_DMR, m_type), ((d_msgq_id << 1) + (d_chan & 0x1)), logts.get_ts());
 }
 
 bool
@@ -105,7 +105,7 @@ dmr_slot::load_slot(const uint8_t slot[], uint64_t sl_type) {
 		decode_emb();
 
 	// Voice or Data decision is based on most recent SYNC
-	std::string v_type;
+	const char* v_type = "";
 	switch(d_type) {
 		case DMR_BS_VOICE_SYNC_MAGIC:
 			v_type = "BS";
@@ -132,7 +132,7 @@ dmr_slot::load_slot(const uint8_t slot[], uint64_t sl_type) {
 			break;
 	}
 	if (is_voice_frame && (d_debug >= 10)) {
-		fprintf(stderr, "%s Slot(%d), CC(%x), %s VOICE\n", logts.get(d_msgq_id), d_chan, d_cc, v_type.c_str());
+		fprintf(stderr, "%s Slot(%d), CC(%x), %s VOICE\n", logts.get(d_msgq_id), d_chan, d_cc, v_type);
 	}
 	return is_voice_frame;
 }
@@ -140,13 +140,11 @@ dmr_slot::load_slot(const uint8_t slot[], uint64_t sl_type) {
 bool
 dmr_slot::decode_slot_type() {
 	bool rc = true;
-	d_slot_type.clear();
 
 	// deinterleave
-	for (unsigned int i = SLOT_L; i < SYNC_EMB; i++)
-		d_slot_type.push_back(d_slot[i]);
-	for (unsigned int i = SLOT_R; i < (SLOT_R + 10); i++)
-		d_slot_type.push_back(d_slot[i]);
+	memcpy(d_slot_type, d_slot + SLOT_L, SYNC_EMB - SLOT_L);
+	memcpy(d_slot_type + (SYNC_EMB - SLOT_L), d_slot + SLOT_R, 10);
+	d_slot_type_valid = true;
 
 	// golay (20,8) hamming-weight of 6 reliably corrects at most 2 bit-errors
 	int gly_errs = CGolay2087::decode(d_slot_type);
@@ -264,11 +262,11 @@ dmr_slot::decode_csbk(uint8_t* csbk) {
 #endif
 
 	// pack and send up the stack
-	std::string csbk_msg(10,0);
+	uint8_t csbk_msg[10] = {0};
 	for (int i = 0; i < 80; i++) {
 		csbk_msg[i/8] = (csbk_msg[i/8] << 1) + csbk[i];
 	}
-	send_msg(csbk_msg, M_DMR_SLOT_CSBK);
+	send_msg(csbk_msg, sizeof(csbk_msg), M_DMR_SLOT_CSBK);
 
 	// Extract parameters for logging purposes
 	uint8_t  csbk_lb   = csbk[0] & 0x1;
@@ -333,9 +331,8 @@ dmr_slot::decode_mbc_header(uint8_t* mbc) {
 	uint8_t  mbc_fid  = extract(mbc, 8, 16);
 
 	// Save header and data, excluding last 16 bits of CRC
-	for (int i = 0; i < 80; i++) {
-		d_mbc.push_back(mbc[i]);
-	}
+	memcpy(d_mbc, mbc, 80);
+	d_mbc_len = 80;
 	d_mbc_state = DATA_INCOMPLETE;
 
 	if (d_debug >= 10) {
@@ -355,9 +352,12 @@ dmr_slot::decode_mbc_continue(uint8_t* mbc) {
 	uint8_t  mbc_lb   = mbc[0] & 0x1;
 
 	// Save data including last block indicator bit
-	for (int i = 0; i < 96; i++) {
-		d_mbc.push_back(mbc[i]);
+	if (d_mbc_len + 96 > MBC_MAX_BITS) {
+		d_mbc_state = DATA_INVALID;
+		return false;
 	}
+	memcpy(d_mbc + d_mbc_len, mbc, 96);
+	d_mbc_len += 96;
 
 	if (!mbc_lb) {
 		if (d_debug >= 10) {
@@ -366,31 +366,31 @@ dmr_slot::decode_mbc_continue(uint8_t* mbc) {
 	} else {
 		// Validate CRC, excluding first 80 bits of header
 #if _CRC_CHECK_
-		if ((d_mbc.size() < 175) || 
-		    (crc16((uint8_t*)(d_mbc.data() + 80), d_mbc.size() - 80) != 0)) {
+		if ((d_mbc_len < 175) || 
+		    (crc16(d_mbc + 80, d_mbc_len - 80) != 0)) {
 			d_mbc_state = DATA_INVALID;
 			return false;
 		}
 #else
-		if (d_mbc.size() < 175) {
+		if (d_mbc_len < 175) {
 			d_mbc_state = DATA_INVALID;
 			return false;
 		}
 #endif
 
-		d_mbc.resize(d_mbc.size()-16); // discard trailing CRC
+		d_mbc_len -= 16; // discard trailing CRC
 		d_mbc_state = DATA_VALID;
 
 		if (d_debug >= 10) {
-			fprintf(stderr, "%s Slot(%d), CC(%x), MBC CONT LB(%d), data size=%lu\n", logts.get(d_msgq_id), d_chan, get_slot_cc(), mbc_lb, d_mbc.size());
+			fprintf(stderr, "%s Slot(%d), CC(%x), MBC CONT LB(%d), data size=%zu\n", logts.get(d_msgq_id), d_chan, get_slot_cc(), mbc_lb, d_mbc_len);
 		}
 
 		// pack MBC and send up the stack
-		std::string mbc_msg(d_mbc.size()/8,0);
-		for (size_t i = 0; i < d_mbc.size(); i++) {
+		uint8_t mbc_msg[MBC_MAX_BITS/8] = {0};
+		for (size_t i = 0; i < d_mbc_len; i++) {
 			mbc_msg[i/8] = (mbc_msg[i/8] << 1) + d_mbc[i];
 		}
-		send_msg(mbc_msg, M_DMR_SLOT_MBC);
+		send_msg(mbc_msg, d_mbc_len/8, M_DMR_SLOT_MBC);
 	} 
 
 	return true;
@@ -401,9 +401,9 @@ dmr_slot::decode_pdp_header(uint8_t* dhdr) {
 	if (d_dhdr_state != DATA_INCOMPLETE) {
 		d_dhdr_state = DATA_INVALID;
 		d_dhdr_valid = false;
-		d_dhdr.clear();
+		d_dhdr_len = 0;
 		d_pdp_state = DATA_INVALID;
-		d_pdp.clear();
+		d_pdp_len = 0;
 		d_pdp_bf = 0;
 		d_pdp_poc = 0;
 	}
@@ -427,7 +427,8 @@ dmr_slot::decode_pdp_header(uint8_t* dhdr) {
 		uint8_t  pdp_bf   = extract(dhdr, 65, 72);
 
 		// Convert bits to bytes and save all except CRC for later
-		d_dhdr.assign(10, 0);
+		memset(d_dhdr, 0, 10);
+		d_dhdr_len = 10;
 		for (int i = 0; i < 80; i++) {
 			d_dhdr[i / 8] = (d_dhdr[i / 8] << 1) | dhdr[i];
 		}
@@ -454,8 +455,13 @@ dmr_slot::decode_pdp_header(uint8_t* dhdr) {
 		d_pdp_bf--;
 
 		// Convert bits to bytes and save all except CRC for later
-		int offset = d_dhdr.size();
-		d_dhdr.insert(d_dhdr.end(), 10, 0);
+		int offset = d_dhdr_len;
+		if (offset + 10 > (int)DHDR_MAX_BYTES) {
+			d_dhdr_state = DATA_INVALID;
+			return false;
+		}
+		memset(d_dhdr + offset, 0, 10);
+		d_dhdr_len += 10;
 		for (int i = 0; i < 80; i++) {
 			d_dhdr[offset + (i / 8)] = (d_dhdr[offset + (i / 8)] << 1) | dhdr[i];
 		}
@@ -480,7 +486,7 @@ dmr_slot::decode_pdp_12data(uint8_t* pdp) {
 		d_pdp_bf--;
 	else {                              // error if fragment not expected
 		d_pdp_state = DATA_INVALID;
-		d_pdp.clear();
+		d_pdp_len = 0;
 		return false;
 	}
 
@@ -495,8 +501,14 @@ dmr_slot::decode_pdp_12data(uint8_t* pdp) {
 	}
 
 	// Convert bits to bytes and save fragment
-	int offset = d_pdp.size();
-	d_pdp.insert(d_pdp.end(), (12 - startpos), 0);
+	int offset = d_pdp_len;
+	if (offset + (12 - startpos) > (int)PDP_MAX_BYTES) {
+		d_pdp_state = DATA_INVALID;
+		d_pdp_len = 0;
+		return false;
+	}
+	memset(d_pdp + offset, 0, 12 - startpos);
+	d_pdp_len += 12 - startpos;
 	for (int i = (startpos * 8); i < 96; i++)
 		d_pdp[offset + (i / 8) - startpos] = (d_pdp[offset + (i / 8) - startpos] << 1) | pdp[i];
 
@@ -506,7 +518,7 @@ dmr_slot::decode_pdp_12data(uint8_t* pdp) {
 		d_src_id = get_dhdr_src();
 
 		if (d_debug >= 10) {
-			int d_len = d_pdp.size() - (d_pdp_poc + 4);
+			int d_len = d_pdp_len - (d_pdp_poc + 4);
 			char szData[(d_len * 3) + 1];
 			for (int i = 0; i < d_len; i++)
 				sprintf((szData + (i *3)), "%02x ", d_pdp[i]);
@@ -523,7 +535,7 @@ dmr_slot::decode_pdp_34data(uint8_t* pdp) {
 		d_pdp_bf--;
 	else {                              // error if fragment not expected
 		d_pdp_state = DATA_INVALID;
-		d_pdp.clear();
+		d_pdp_len = 0;
 		return false;
 	}
 
@@ -537,8 +549,13 @@ dmr_slot::decode_pdp_34data(uint8_t* pdp) {
 
 	// Save received fragment
 	// TODO: handle repeat transmissions with duplicate DBSN
-	int offset = d_pdp.size();
-	d_pdp.insert(d_pdp.end(), (18 - startpos), 0);
+	int offset = d_pdp_len;
+	if (offset + (18 - startpos) > (int)PDP_MAX_BYTES) {
+		d_pdp_state = DATA_INVALID;
+		d_pdp_len = 0;
+		return false;
+	}
+	d_pdp_len += 18 - startpos;
 	for (int i = startpos; i < 18; i++) {
 		d_pdp[offset + i - startpos] = pdp[i];
 	}
@@ -550,7 +567,7 @@ dmr_slot::decode_pdp_34data(uint8_t* pdp) {
 		d_src_id = get_dhdr_src();
 		
 		if (d_debug >= 10) {
-			int d_len = d_pdp.size() - (d_pdp_poc + 4);
+			int d_len = d_pdp_len - (d_pdp_poc + 4);
 			char szData[(d_len * 3) + 1];
 			for (int i = 0; i < d_len; i++)
 				sprintf((szData + (i *3)), "%02x ", d_pdp[i]);
@@ -572,16 +589,10 @@ dmr_slot::decode_vlch(uint8_t* vlch) {
 	if (!rc)
 		return false;
 
-	// send up the stack
-	std::string lc_msg(12,0);
-	for (int i = 0; i < 12; i++) {
-		if (d_lc.size() <= i) {
-			//std::cerr << "ERROR: d_lc.size()=" << d_lc.size() << " i=" << i << std::endl;
-			break;
-		}
-		lc_msg[i] = d_lc[i];
-	}
-	send_msg(lc_msg, M_DMR_SLOT_VLC);
+	// send up the stack, the 9 bytes of LC and 3 of 0
+	uint8_t lc_msg[12] = {0};
+	memcpy(lc_msg, d_lc.data(), 9);
+	send_msg(lc_msg, sizeof(lc_msg), M_DMR_SLOT_VLC);
 
 	d_src_id = get_lc_srcaddr();
 	d_dst_id = get_lc_dstaddr();
@@ -605,16 +616,10 @@ dmr_slot::decode_tlc(uint8_t* tlc) {
 	if (!rc)
 		return false;
 
-	// send up the stack
-	std::string lc_msg(12,0);
-	for (int i = 0; i < 12; i++) {
-		if (d_lc.size() <= i) {
-			// std::cerr << "ERROR: d_lc.size()=" << d_lc.size() << " i=" << i << std::endl;
-			break;
-		}
-		lc_msg[i] = d_lc[i];
-	}
-	send_msg(lc_msg, M_DMR_SLOT_TLC);
+	// send up the stack, the 9 bytes of LC and 3 of 0
+	uint8_t lc_msg[12] = {0};
+	memcpy(lc_msg, d_lc.data(), 9);
+	send_msg(lc_msg, sizeof(lc_msg), M_DMR_SLOT_TLC);
 
 	d_src_id = get_lc_srcaddr();
 	d_dst_id = get_lc_dstaddr();
@@ -630,7 +635,7 @@ dmr_slot::decode_tlc(uint8_t* tlc) {
 bool
 dmr_slot::decode_lc(uint8_t* lc, int* errs) {
 	// Convert bits to bytes and apply Reed-Solomon(12,9) error correction
-	d_lc.assign(12,0);
+	d_lc.fill(0);
 	for (int i = 0; i < 96; i++) {
 		d_lc[i / 8] = (d_lc[i / 8] << 1) | lc[i];
 	}
@@ -647,8 +652,7 @@ dmr_slot::decode_lc(uint8_t* lc, int* errs) {
 	if (errs != NULL)
 		*errs = rs_errs;
 
-	// Discard parity information and check results
-	d_lc.resize(9);
+	// Parity information is left in d_lc[9..11] and ignored
 	d_lc_valid = (rs_errs >= 0) ? true : false; 
 
 	return d_lc_valid;
@@ -667,18 +671,14 @@ dmr_slot::decode_pinf(uint8_t* pinf) {
 #endif
 
 	// Convert bits to bytes and save PI information
-	d_pi.assign(10,0);
+	memset(d_pi, 0, sizeof(d_pi));
 	for (int i = 0; i < 80; i++) {
 		d_pi[i / 8] = (d_pi[i / 8] << 1) | pinf[i];
 	}
 	d_pi_valid = true;
 
 	// send up the stack
-	std::string pi_msg(10,0);
-	for (int i = 0; i < 10; i++) {
-		pi_msg[i] = d_pi[i];
-	}
-	send_msg(pi_msg, M_DMR_SLOT_PI);
+	send_msg(d_pi, sizeof(d_pi), M_DMR_SLOT_PI);
 
 	if (d_debug >= 10) {
 		fprintf(stderr, "%s Slot(%d), CC(%x), PI HEADER: ALGID(%02x), KEYID(%02x), MI(%08x), DSTADDR(%06x)\n",
@@ -690,13 +690,11 @@ dmr_slot::decode_pinf(uint8_t* pinf) {
 
 bool
 dmr_slot::decode_emb() {
-	bit_vector emb_sig;
+	uint8_t emb_sig[16];
 
 	// deinterleave
-	for (unsigned int i = SYNC_EMB; i < (SYNC_EMB + 8); i++)
-		emb_sig.push_back(d_slot[i]);
-	for (unsigned int i = (SLOT_R - 8); i < SLOT_R; i++)
-		emb_sig.push_back(d_slot[i]);
+	memcpy(emb_sig, d_slot + SYNC_EMB, 8);
+	memcpy(emb_sig + 8, d_slot + (SLOT_R - 8), 8);
 
 	// quadratic residue FEC
 	int qr_errs = CQR1676::decode(emb_sig);
@@ -718,9 +716,8 @@ dmr_slot::decode_emb() {
 
 	switch (emb_lcss) {
 		case 0:	// Single-fragment RC
-			d_emb.clear();
-			for (size_t i=0; i<32; i++)
-				d_emb.push_back(d_slot[SYNC_EMB + 8 + i]);
+			d_emb_len = 0;
+			append_emb();
 			if (decode_embedded_sbrc(emb_pi)) {
 				if (d_debug >= 10) {
 					if (emb_pi)
@@ -731,13 +728,11 @@ dmr_slot::decode_emb() {
 			}
 			break;
 		case 1: // First fragment LC
-			d_emb.clear();
-			for (size_t i=0; i<32; i++)
-				d_emb.push_back(d_slot[SYNC_EMB + 8 + i]);
+			d_emb_len = 0;
+			append_emb();
 			break;
 		case 2: // End LC
-			for (size_t i=0; i<32; i++)
-				d_emb.push_back(d_slot[SYNC_EMB + 8 + i]);
+			append_emb();
 			if (decode_embedded_lc()) {
 				d_terminated = std::pair<bool, int>(true, 0);
 				if (d_debug >= 10) {
@@ -746,8 +741,7 @@ dmr_slot::decode_emb() {
 			}
 			break;
 		case 3: // Continue LC
-			for (size_t i=0; i<32; i++)
-				d_emb.push_back(d_slot[SYNC_EMB + 8 + i]);
+			append_emb();
 			break;
  
 	}
@@ -755,6 +749,16 @@ dmr_slot::decode_emb() {
 	return true;
 }
 
+// Fragments past the four that make up an embedded LC are dropped, only the
+// first 128 bits are decoded
+void
+dmr_slot::append_emb() {
+	if (d_emb_len + 32 > EMB_LC_BITS)
+		return;
+	memcpy(d_emb + d_emb_len, d_slot + SYNC_EMB + 8, 32);
+	d_emb_len += 32;
+}
+
 std::pair<bool,long> dmr_slot::get_terminated() {
 	return d_terminated;
 }
@@ -773,15 +777,15 @@ int dmr_slot::get_cc() {
 
 bool
 dmr_slot::decode_embedded_lc() {
-	byte_vector emb_data;
+	uint8_t emb_data[72];
 	d_lc_valid = false;
-	d_lc.clear();
+	d_lc.fill(0);
 
 	// Check that we have all 4 fragments (128 bits total)
-	if (d_emb.size() < 128) {
+	if (d_emb_len < EMB_LC_BITS) {
 		if (d_debug >= 10) {
 			fprintf(stderr, "%s Slot(%d), Incomplete EMB LC: only %zu bits, need 128\n", 
-				logts.get(d_msgq_id), d_chan, d_emb.size());
+				logts.get(d_msgq_id), d_chan, d_emb_len);
 		}
 		return false;
 	}
@@ -813,24 +817,25 @@ dmr_slot::decode_embedded_lc() {
 	}
 
 	// Extract 72 bits of payload
+	unsigned int n = 0;
 	for (unsigned int a = 0; a < 11; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 16; a < 27; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 32; a < 42; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 48; a < 58; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 64; a < 74; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 80; a < 90; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 	for (unsigned int a = 96; a < 106; a++)
-		emb_data.push_back(data[a]);
+		emb_data[n++] = data[a];
 
 	// Convert 72 bits payload to 9 bytes LC
 	for (int i = 0; i < 72; i += 8)
-		d_lc.push_back((emb_data[i+0] << 7) + (emb_data[i+1] << 6) + (emb_data[i+2] << 5) + (emb_data[i+3] << 4) +
+		d_lc[i / 8] = ((emb_data[i+0] << 7) + (emb_data[i+1] << 6) + (emb_data[i+2] << 5) + (emb_data[i+3] << 4) +
 			       (emb_data[i+4] << 3) + (emb_data[i+5] << 2) + (emb_data[i+6] << 1) +  emb_data[i+7]);
 
 	// Extract 5 bit received CRC
@@ -846,11 +851,7 @@ dmr_slot::decode_embedded_lc() {
 		d_lc_valid = true;
 
 		// send up the stack
-		std::string lc_msg(9,0);
-		for (int i = 0; i < 9; i++) {
-			lc_msg[i] = d_lc[i];
-		}
-		send_msg(lc_msg, M_DMR_SLOT_ELC);
+		send_msg(d_lc.data(), 9, M_DMR_SLOT_ELC);
 
 		if (d_debug >=10) {
 			fprintf(stderr, "%s EMB LC: %02x %02x %02x %02x %02x %02x %02x %02x %02x\n",
@@ -904,9 +905,7 @@ dmr_slot::decode_embedded_sbrc(bool _pi) {
 		d_rc_valid = true;
 
 		// send up the stack
-		std::string rc_msg(1,0);
-		rc_msg[0] = d_rc;
-		send_msg(rc_msg, M_DMR_SLOT_ERC);
+		send_msg(&d_rc, 1, M_DMR_SLOT_ERC);
 
 		if (d_debug >=10) {
 			fprintf(stderr, "%s EMB RC: %x\n", logts.get(d_msgq_id), get_rc());
@@ -924,10 +923,10 @@ dmr_slot::decode_embedded_sbrc(bool _pi) {
 		d_sb_valid = true;
 
 		// send up the stack
-		std::string sb_msg(2,0);
+		uint8_t sb_msg[2];
 		sb_msg[0] = (d_sb >> 8) & 0xff;
 		sb_msg[1] = d_sb & 0xff;
-		send_msg(sb_msg, M_DMR_SLOT_ESB);
+		send_msg(sb_msg, sizeof(sb_msg), M_DMR_SLOT_ESB);
 
 		if (d_debug >=10) {
 			fprintf(stderr, "%s EMB SB: %03x\n", logts.get(d_msgq_id), get_sb());
@@ -22,6 +22,8 @@
 #define INCLUDED_DMR_SLOT_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <array>
 #include <vector>
 #include <gnuradio/msg_queue.h>
 
@@ -31,6 +33,7 @@
 #include "trellis.h"
 #include "ezpwd/rs"
 #include "log_ts.h"
+#include "msg_pool.h"
 
 typedef std::vector<bool> bit_vector;
 typedef std::vector<uint8_t> byte_vector;
@@ -63,9 +66,15 @@ static const unsigned int SYNC_EMB                 = 108;
 static const unsigned int SLOT_L                   =  98;
 static const unsigned int SLOT_R                   = 156;
 
+// Sizes of the buffers a slot accumulates bursts in
+static const unsigned int EMB_LC_BITS              = 128;          // four 32 bit fragments of embedded LC
+static const unsigned int MBC_MAX_BITS             = 80 + (7 * 96); // header and up to 7 continuation blocks
+static const unsigned int DHDR_MAX_BYTES           = 40;           // a data header and up to 3 chained proprietary ones
+static const unsigned int PDP_MAX_BYTES            = 127 * 18;     // blocks to follow is 7 bits, rate 3/4 blocks are 18 bytes
+
 class dmr_slot {
 public:
-	dmr_slot(const int chan, log_ts& logger, const int debug, int msgq_id, gr::msg_queue::sptr queue);
+	dmr_slot(const int chan, log_ts& logger, const int debug, int msgq_id, gr::msg_queue::sptr queue, msg_pool& pool);
 	~dmr_slot();
 	inline void set_debug(const int debug) { d_debug = debug; };
 	bool load_slot(const uint8_t slot[], uint64_t sl_type);
@@ -79,15 +88,20 @@ public:
 
 private:
 	uint8_t     d_slot[SLOT_SIZE];	// array of bits comprising the current slot
-	bit_vector  d_slot_type;
-	byte_vector d_emb;		// last received Embedded data
-	byte_vector d_mbc;		// last received MBC data
-	byte_vector d_dhdr;		// last received Data Header data
-	byte_vector d_pdp;		// last received PDP data
-	byte_vector d_lc;		// last received LC data
+	uint8_t     d_slot_type[20];	// last received Slot Type, one bit per byte
+	bool        d_slot_type_valid;
+	uint8_t     d_emb[EMB_LC_BITS];	// last received Embedded data, one bit per byte
+	size_t      d_emb_len;
+	uint8_t     d_mbc[MBC_MAX_BITS];	// last received MBC data, one bit per byte
+	size_t      d_mbc_len;
+	uint8_t     d_dhdr[DHDR_MAX_BYTES];	// last received Data Header data
+	size_t      d_dhdr_len;
+	uint8_t     d_pdp[PDP_MAX_BYTES];	// last received PDP data
+	size_t      d_pdp_len;
+	std::array<uint8_t,12> d_lc;	// last received LC data, 9 bytes once decoded
 	uint8_t     d_rc;		// last received RC data
 	uint16_t    d_sb;		// last received SB data
-	byte_vector d_pi;
+	uint8_t     d_pi[10];
 	uint8_t     d_pdp_bf;
 	uint8_t     d_pdp_poc;
 	data_state  d_mbc_state;
@@ -112,8 +126,9 @@ private:
 	CDMRTrellis trellis;
 	ezpwd::RS<255,252> rs12;	// Reed-Solomon(12,9) object for Link Control decode
 	gr::msg_queue::sptr d_msg_queue;
+	msg_pool&   d_pool;		// shared with the other slot and the CACH
 
-	void send_msg(const std::string& m_buf, const int m_type);
+	void send_msg(const uint8_t* m_buf, const size_t m_len, const int m_type);
 	bool decode_slot_type();
 	bool decode_csbk(uint8_t* csbk);
 	bool decode_mbc_header(uint8_t* mbc);
@@ -128,6 +143,7 @@ private:
 	bool decode_emb();
 	bool decode_embedded_lc();
 	bool decode_embedded_sbrc(bool _pi);
+	void append_emb();
 
 	inline uint8_t  get_lc_pf()      { return d_lc_valid ? ((d_lc[0] & 0x80) >> 7) : 0; };
 	inline uint8_t  get_lc_flco()    { return d_lc_valid ? (d_lc[0] & 0x3f) : 0; };
@@ -144,8 +160,8 @@ private:
 	inline uint8_t  get_rc()         { return d_rc_valid ? d_rc : 0; };
 	inline uint8_t  get_sb()         { return d_sb_valid ? d_sb : 0; };
 
-	inline uint8_t  get_slot_cc()    { return d_slot_type.size() ? ((d_slot_type[0] << 3) + (d_slot_type[1] << 2) + (d_slot_type[2] << 1) + d_slot_type[3]) : 0xf; };
-	inline uint8_t  get_data_type()  { return d_slot_type.size() ? ((d_slot_type[4] << 3) + (d_slot_type[5] << 2) + (d_slot_type[6] << 1) + d_slot_type[7]) : 0x9; };
+	inline uint8_t  get_slot_cc()    { return d_slot_type_valid ? ((d_slot_type[0] << 3) + (d_slot_type[1] << 2) + (d_slot_type[2] << 1) + d_slot_type[3]) : 0xf; };
+	inline uint8_t  get_data_type()  { return d_slot_type_valid ? ((d_slot_type[4] << 3) + (d_slot_type[5] << 2) + (d_slot_type[6] << 1) + d_slot_type[7]) : 0x9; };
 
 	inline uint8_t  get_dhdr_dpf()   { return d_dhdr_valid ? (d_dhdr[0] & 0xf) : 0; };
 	inline uint8_t  get_dhdr_sap()   { return d_dhdr_valid ? (d_dhdr[1] >> 4) & 0xf : 0; };
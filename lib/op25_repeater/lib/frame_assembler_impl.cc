@@ -178,12 +178,7 @@ namespace gr {
         if (terminated) {
             add_item_tag(0, nitems_written(0), pmt::intern("terminate"), pmt::from_long(1), pmt::intern(name()));
         }*/
-          for (int i = 0; i < output_queue[slot_id].size(); i++) {
-              //BOOST_LOG_TRIVIAL(info) << output_queue[slot_id][i];
-            out[i] = output_queue[slot_id][i];
-          }
-          output_queue[slot_id].clear();
-          //output_queue[slot_id].erase(output_queue[slot_id].begin(), output_queue[slot_id].begin() + output_queue[slot_id].size());
+          output_queue[slot_id].read(out, output_queue[slot_id].size());
         }
 
         //BOOST_LOG_TRIVIAL(info) << "DMR Frame Assembler - Amt Prod: " << amt_produce << " output_items 0: " << len(output_items[0]) << " output_items 1: " << len(output_items[1]) <<" noutput_items: " <<  noutput_items;
@@ -31,6 +31,7 @@
 #include <deque>
 #include <array>
 #include "rx_base.h"
+#include "audio_ring.h"
 #include "log_ts.h"
 
 typedef std::deque<uint8_t> dibit_queue;
@@ -45,7 +46,7 @@ namespace gr {
                 int d_msgq_id;
                 gr::msg_queue::sptr d_msg_queue;
                 //std::deque<int16_t> output_queue[2];
-                std::array<std::deque<int16_t>, 2> output_queue;
+                std::array<audio_ring, 2> output_queue;
                 rx_base* d_sync;
 
                 // internal functions
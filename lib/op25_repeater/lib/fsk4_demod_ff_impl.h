@@ -24,10 +24,8 @@
 #ifndef INCLUDED_OP25_REPEATER_FSK4_DEMOD_FF_IMPL_H
 #define INCLUDED_OP25_REPEATER_FSK4_DEMOD_FF_IMPL_H
 
-#if GNURADIO_VERSION >= 0x030a00
-#include <boost/smart_ptr/scoped_array.hpp>
-#endif
 #include <op25_repeater/fsk4_demod_ff.h>
+#include "fsk4_timing.h"
 
 namespace gr {
   namespace op25_repeater  {
@@ -36,26 +34,14 @@ namespace gr {
     {
      private:
       float d_block_rate;
-      boost::scoped_array<float> d_history;
-      size_t d_history_last;
       gr::msg_queue::sptr d_queue;
-      double d_symbol_clock;
-      double d_symbol_spread;
-      float d_symbol_time;
-      double fine_frequency_correction;
-      double coarse_frequency_correction;
-      bool d_bfsk;
+      fsk4_timing d_timing;
 
       /**
        * Called when we want the input frequency to be adjusted.
        */
       void send_frequency_correction();
 
-      /**
-       * Tracking loop.
-       */
-      bool tracking_loop_mmse(float input, float *output);
-
      public:
       fsk4_demod_ff_impl(gr::msg_queue::sptr queue, float sample_rate_Hz, float symbol_rate_Hz, bool bfsk = false);
       ~fsk4_demod_ff_impl();
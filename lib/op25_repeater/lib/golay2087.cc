@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "golay2087.h"
+#include "op25_golay.h"
 
 const unsigned int ENCODING_TABLE_2087[] =
 	{0x0000U, 0xB08EU, 0xE093U, 0x501DU, 0x70A9U, 0xC027U, 0x903AU, 0x20B4U, 0x60DCU, 0xD052U, 0x804FU, 0x30C1U,
@@ -267,18 +268,8 @@ unsigned int CGolay2087::getSyndrome1987(unsigned int pattern)
  * obtain its syndrome in decoding.
  */
 {
-	unsigned int aux = X18;
-
-	if (pattern >= X11) {
-		while (pattern & MASK8) {
-			while (!(aux & pattern))
-				aux = aux >> 1;
-
-			pattern ^= (aux  / X11) * GENPOL_GL;
-		}
-	}
- 
-	return pattern;
+	// The same generator as the Golay(23,12) code, so the same table
+	return golay_23_syndrome(pattern);
 }
 
 unsigned int CGolay2087::decode(bit_vector& data)
@@ -286,6 +277,17 @@ unsigned int CGolay2087::decode(bit_vector& data)
 	if (data.size() < 20)
 		return -1;
 
+	uint8_t bits[20];
+	for (int i = 0; i < 20; i++)
+		bits[i] = data[i];
+	unsigned int errs = decode(bits);
+	for (int i = 0; i < 20; i++)
+		data[i] = bits[i];
+	return errs;
+}
+
+unsigned int CGolay2087::decode(uint8_t* data)
+{
 	unsigned int code = 0;
 	unsigned int parity_bit = data[19];			// save parity bit
 	for (int i = 0; i < 19; i++) {				// parity bit ignored for table lookup
@@ -384,6 +386,17 @@ unsigned char CQR1676::decode(bit_vector& data)
 	if (data.size() < 16)
 		return -1;
 
+	uint8_t bits[16];
+	for (int i = 0; i < 16; i++)
+		bits[i] = data[i];
+	unsigned char errs = decode(bits);
+	for (int i = 0; i < 16; i++)
+		data[i] = bits[i];
+	return errs;
+}
+
+unsigned char CQR1676::decode(uint8_t* data)
+{
 	unsigned int code = 0;
 	unsigned int parity_bit = data[15];			// save parity bit
 	for (int i = 0; i < 15; i++) {				// parity bit ignored for table lookup
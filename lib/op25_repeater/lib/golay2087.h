@@ -22,6 +22,7 @@
 #ifndef Golay2087_H
 #define Golay2087_H
 
+#include <stdint.h>
 #include <vector>
 
 typedef std::vector<bool> bit_vector;
@@ -30,6 +31,7 @@ class CGolay2087 {
 public:
 	static void encode(bit_vector& data);
 	static unsigned int decode(bit_vector& data);
+	static unsigned int decode(uint8_t* data);	// 20 bits, one per byte
 
 private:
 	static unsigned int getSyndrome1987(unsigned int pattern);
@@ -39,6 +41,7 @@ class CQR1676 {
 public:
 	static void encode(bit_vector& data);
 	static unsigned char decode(bit_vector& data);
+	static unsigned char decode(uint8_t* data);	// 16 bits, one per byte
 
 private:
 	static unsigned int getSyndrome1576(unsigned int pattern);
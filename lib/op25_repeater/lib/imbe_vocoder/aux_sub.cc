@@ -23,6 +23,7 @@
 #include "imbe.h"
 #include "aux_sub.h"
 #include "tbls.h"
+#include "../op25_simd.h"
 
 //-----------------------------------------------------------------------------
 //	PURPOSE:
@@ -157,6 +158,68 @@ Word32 L_v_magsq(Word16 *vec, Word16 n)
 	return L_magsq;
 } 
 
+//-----------------------------------------------------------------------------
+//	PURPOSE:
+//			Compute the sum of L_shr(L_mult(vec1[i], vec2[i]), scale) of two
+//		    16 bit input vectors with saturation, as an L_add() of the
+//		    products one at a time would.  Output is a 32 bit number.
+//
+//	INPUT:
+//		vec1      - Pointer to the first vector
+//		vec2      - Pointer to the second vector
+//      scale     - right shift factor of the products
+//      n         - size of input vectors
+//
+//	OUTPUT:
+//		none
+//
+//	RETURN:
+//		32 bit long signed integer result  
+//
+//-----------------------------------------------------------------------------
+Word32 L_v_mult_sum(Word16 *vec1, Word16 *vec2, Word16 scale, Word16 n)
+{
+	Word32 L_sum = 0;
+	Word16 i;
+
+	for(i = 0; i < n; i++)
+		L_sum = L_add(L_sum, L_shr(L_mult(vec1[i], vec2[i]), scale));
+	return L_sum;
+}
+
+//-----------------------------------------------------------------------------
+//	PURPOSE:
+//		Multiply two 16 bit input vectors element by element with mult_r()
+//
+//  INPUT:
+//		vec1      - Pointer to the destination vector
+//		vec2      - Pointer to the first source vector
+//		vec3      - Pointer to the second source vector
+//      n         - size of input vectors
+//
+//	OUTPUT:
+//		Products of the source vectors
+//
+//	RETURN:
+//		None 
+//
+//	NOTE:
+//		Only mult_r(-32768, -32768) saturates, so it is a min() rather than
+//		a branch and the loop vectorizes.  Overflow isn't set.
+//
+//-----------------------------------------------------------------------------
+OP25_KERNEL
+void v_mult_r(Word16 *vec1, Word16 *vec2, const Word16 *vec3, Word16 n)
+{
+	Word16 i;
+
+	for(i = 0; i < n; i++)
+	{
+		Word32 L_product = ((Word32)vec2[i] * vec3[i] + 0x4000) >> 15;
+		vec1[i] = (Word16)((L_product > MAX_16) ? MAX_16 : L_product);
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	PURPOSE:
 //		Copy the contents of one 16 bit input vector to another with shift
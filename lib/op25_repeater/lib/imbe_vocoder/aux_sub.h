@@ -111,6 +111,46 @@ void v_equ(Word16 *vec1, Word16 *vec2, Word16 n);
 //-----------------------------------------------------------------------------
 Word32 L_v_magsq(Word16 *vec, Word16 n);
 
+//-----------------------------------------------------------------------------
+//	PURPOSE:
+//			Compute the sum of L_shr(L_mult(vec1[i], vec2[i]), scale) of two
+//		    16 bit input vectors with saturation, as an L_add() of the
+//		    products one at a time would.  Output is a 32 bit number.
+//
+//	INPUT:
+//		vec1      - Pointer to the first vector
+//		vec2      - Pointer to the second vector
+//      scale     - right shift factor of the products
+//      n         - size of input vectors
+//
+//	OUTPUT:
+//		none
+//
+//	RETURN:
+//		32 bit long signed integer result  
+//
+//-----------------------------------------------------------------------------
+Word32 L_v_mult_sum(Word16 *vec1, Word16 *vec2, Word16 scale, Word16 n);
+
+//-----------------------------------------------------------------------------
+//	PURPOSE:
+//		Multiply two 16 bit input vectors element by element with mult_r()
+//
+//  INPUT:
+//		vec1      - Pointer to the destination vector
+//		vec2      - Pointer to the first source vector
+//		vec3      - Pointer to the second source vector
+//      n         - size of input vectors
+//
+//	OUTPUT:
+//		Products of the source vectors
+//
+//	RETURN:
+//		None 
+//
+//-----------------------------------------------------------------------------
+void v_mult_r(Word16 *vec1, Word16 *vec2, const Word16 *vec3, Word16 n);
+
 //-----------------------------------------------------------------------------
 //	PURPOSE:
 //		Copy the contents of one 16 bit input vector to another with shift
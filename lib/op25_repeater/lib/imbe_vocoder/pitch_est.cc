@@ -73,14 +73,7 @@ void imbe_vocoder::pitch_est_init(void)
 
 Word32 imbe_vocoder::autocorr(Word16 *sigin, Word16 shift, Word16 scale_shift)
 {
-	Word32 L_sum;
-	Word16 i;
-
-	L_sum = 0;
-	for(i = 0; i < PITCH_EST_FRAME - shift; i++)
-		L_sum = L_add(L_sum, L_shr(L_mult(sigin[i], sigin[i + shift]), scale_shift) );
-
-	return L_sum;
+	return L_v_mult_sum(sigin, sigin + shift, scale_shift, PITCH_EST_FRAME - shift);
 }
 
 
@@ -96,8 +89,7 @@ void imbe_vocoder::e_p(Word16 *sigin, Word16 *res_buf)
 
 
 	// Windowing input signal s * wi^2
-	for(i = 0 ; i < PITCH_EST_FRAME; i++)
-		sig_wndwed[i] = mult_r(sigin[i], wi[i]);                                
+	v_mult_r(sig_wndwed, sigin, wi, PITCH_EST_FRAME);
 
 	L_sum = 0;
 	for(i = 0 ; i < PITCH_EST_FRAME; i++)
@@ -115,9 +107,7 @@ void imbe_vocoder::e_p(Word16 *sigin, Word16 *res_buf)
 	else
 		scale_shift = 0;
 	
-	L_e0 = 0;
-	for(i = 0 ; i < PITCH_EST_FRAME; i++)
-		L_e0 = L_add(L_e0, L_shr( L_mult(sig_wndwed[i], sig_wndwed[i]), scale_shift));              // sum(s^2 * wi^4) 
+	L_e0 = L_v_mult_sum(sig_wndwed, sig_wndwed, scale_shift, PITCH_EST_FRAME);              // sum(s^2 * wi^4) 
 
     // Calculate correlation for time shift in range 21...150 with step 0.5
 	// For integer shifts
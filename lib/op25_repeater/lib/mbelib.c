@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include "mbelib.h"
 #include "mbelib_const.h"
+#include "cpu_dispatch.h"
 
 void
 mbe_printVersion (char *str)
@@ -208,7 +209,7 @@ mbe_synthesizeSilence (short *aout_buf)
     }
 }
 
-void
+DSP_CLONES void
 mbe_synthesizeSpeechf (float *aout_buf, mbe_parms * cur_mp, mbe_parms * prev_mp, int uvquality)
 {
 
@@ -0,0 +1,88 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_MSG_POOL_H
+#define INCLUDED_OP25_REPEATER_MSG_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <gnuradio/message.h>
+#include <gnuradio/msg_queue.h>
+
+/*
+ * msg_pool
+ *   The gr::messages a decoder sends up its msg_queue, made once and used
+ *   again.
+ *
+ * A gr::message can't be resized, so each one the pool makes keeps the
+ * length it was made with and is only handed out again for a payload of
+ * that length. The decoders send a handful of fixed size messages, so a
+ * pool that has seen a few of each stops allocating. A message is free
+ * again once the pool holds the only reference to it: the queue lets go of
+ * it in delete_head() and the reader when it is done with it. No one else
+ * can get a reference back from there, so checking use_count() needs no
+ * lock. When no message of the right length is free, a new one is made and
+ * kept, in place of a free one of another length once the pool is full.
+ *
+ * Everything is called from the flowgraph thread of the block that owns
+ * the decoder.
+ */
+class msg_pool {
+public:
+	static const int POOL_SIZE = 32;
+
+	msg_pool() : d_count(0) { }
+
+	// Insert a message with m_len bytes of m_buf at the tail of queue,
+	// unless it is full
+	void send(gr::msg_queue::sptr queue, const uint8_t* m_buf, size_t m_len, long type, double arg1, double arg2) {
+		if (queue->full_p())
+			return;
+		gr::message::sptr msg = get(m_len);
+		msg->set_type(type);
+		msg->set_arg1(arg1);
+		msg->set_arg2(arg2);
+		if (m_len)
+			memcpy(msg->msg(), m_buf, m_len);
+		queue->insert_tail(msg);
+	}
+
+private:
+	gr::message::sptr d_msgs[POOL_SIZE];
+	int d_count;
+
+	gr::message::sptr get(size_t m_len) {
+		int spare = -1;
+		for (int i = 0; i < d_count; i++) {
+			if (d_msgs[i].use_count() != 1)
+				continue;
+			if (d_msgs[i]->length() == m_len)
+				return d_msgs[i];
+			spare = i;
+		}
+		gr::message::sptr msg = gr::message::make(0, 0, 0, m_len);
+		if (d_count < POOL_SIZE)
+			d_msgs[d_count++] = msg;
+		else if (spare >= 0)
+			d_msgs[spare] = msg;	// a free message of another length makes way
+		return msg;
+	}
+};
+
+#endif /* INCLUDED_OP25_REPEATER_MSG_POOL_H */
@@ -44,17 +44,39 @@ golay_23_encode(uint32_t code_word_in)
 	return golay_24_encode(code_word_in) >> 1;
 }
 
+/* Golay(23,12) syndromes of the top 12 bits of a codeword.
+ *
+ * The syndrome is the remainder after dividing by g(x) = 0xC75, which is
+ * linear, and the low 11 bits are already their own remainder. So the
+ * syndrome of any codeword is one lookup of its top 12 bits xor its low 11,
+ * instead of the long division a bit at a time. The table is built at
+ * compile time by that same division, and is shared by the P25 and DMR
+ * decoders that use this generator.
+ */
+struct golay_23_syndrome_table {
+   uint16_t syndrome[4096];
+
+   constexpr golay_23_syndrome_table() : syndrome() {
+      for(uint32_t high = 0; high < 4096; high++) {
+         uint32_t pattern = high << 11;
+         uint32_t aux = 0x400000;
+         while(pattern & 0xFFFFF800) {
+            while((aux & pattern) == 0) {
+               aux >>= 1;
+            }
+            pattern ^= (aux >> 11) * 0xC75;
+         }
+         syndrome[high] = pattern;
+      }
+   }
+};
+
+inline constexpr golay_23_syndrome_table golay_23_syndromes;
+
 static inline uint32_t
 golay_23_syndrome(uint32_t pattern)
 {
-   uint32_t aux = 0x400000;
-   while(pattern & 0xFFFFF800) {
-      while((aux & pattern) == 0) {
-         aux >>= 1;
-      }
-      pattern ^= (aux >> 11) * 0xC75;
-   }
-   return  pattern;
+   return golay_23_syndromes.syndrome[(pattern >> 11) & 0xFFF] ^ (pattern & 0x7FF);
 }
 /* APCO Golay(23,11,7) decoder.
  *
@@ -0,0 +1,52 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_OP25_SIMD_H
+#define INCLUDED_OP25_REPEATER_OP25_SIMD_H
+
+#include <stdint.h>
+
+/*
+ * OP25_KERNEL
+ *   Put in front of the definition of a loop heavy function to have it built
+ *   for AVX-512 and AVX2 as well as for the baseline, with the loader
+ *   picking the one for the CPU it is run on.
+ *
+ * The packages are built for plain x86-64, which leaves the vectorizer
+ * SSE2. GCC's target_clones makes a copy of the function for each target
+ * and an ifunc that chooses between them once, when the library is loaded,
+ * so a call costs what a call through the PLT always did. AVX-512 brings
+ * FMA with it, which would round a * b + c once instead of twice, so
+ * contraction is turned off and a float kernel gives the same answer
+ * whichever copy is run. Only the function itself is cloned: give it the
+ * loops, not a wrapper around them, and keep it out of line.
+ *
+ * ifuncs need GCC and glibc on x86-64. Everywhere else the macro is empty
+ * and the kernels are built once for the target, which on aarch64 already
+ * has NEON. Build with -DOP25_NO_DISPATCH to get the baseline copy only,
+ * to compare against it.
+ */
+#if defined(__x86_64__) && defined(__GLIBC__) && defined(__GNUC__) && !defined(__clang__) && !defined(OP25_NO_DISPATCH)
+#define OP25_KERNEL __attribute__((target_clones("avx512f", "avx2", "default"), optimize("fp-contract=off")))
+#define OP25_KERNEL_DISPATCH 1
+#else
+#define OP25_KERNEL
+#define OP25_KERNEL_DISPATCH 0
+#endif
+
+#endif /* INCLUDED_OP25_REPEATER_OP25_SIMD_H */
@@ -108,6 +108,8 @@ static const int MAX_IN = 1;	// maximum number of input streams
 	d_do_msgq(do_msgq),
 	d_msg_queue(queue),
 	output_queue(),
+	vocoder_out(output_queue),
+	d_terminate_pending(std::make_pair(false, 0)),
 	op25audio(udp_host, port, debug),
   d_input_rate(4800),
   d_tag_src(pmt::intern(name())), 
@@ -122,8 +124,11 @@ static const int MAX_IN = 1;	// maximum number of input streams
       if (d_do_phase2_tdma && !d_do_audio_output)
         fprintf(stderr, "p25_frame_assembler: error: do_audio_output must be enabled if do_phase2_tdma is enabled\n");
 
-      if (d_do_audio_output)
+      if (d_do_audio_output) {
         set_output_multiple(864);
+        p1fdma.set_vocoder_output(&vocoder_out);
+        p2tdma.set_vocoder_output(&vocoder_out);
+      }
 
       if (!d_do_audio_output && !d_do_imbe)
         set_output_multiple(160);
@@ -190,8 +195,11 @@ p25_frame_assembler_impl::general_work (int noutput_items,
 
   p1fdma.rx_sym(in, ninput_items[0]);
   if(d_do_phase2_tdma) {
-    for (int i = 0; i < ninput_items[0]; i++) {
-      if(p2tdma.rx_sym(in[i])) {
+    // The framer takes the dibits a burst at a time
+    for (int i = 0; i < ninput_items[0];) {
+      bool complete;
+      i += p2tdma.rx_syms(in + i, ninput_items[0] - i, complete);
+      if (complete) {
         int rc = p2tdma.handle_frame();
         terminate_call = p2tdma.get_call_terminated();
         if (terminate_call.first) {
@@ -215,29 +223,37 @@ p25_frame_assembler_impl::general_work (int noutput_items,
 
       // If this block is being used for Trunking, then you want to skip all of this.
       if (d_do_audio_output) {
-        amt_produce = output_queue.size();
+        // The audio goes out up to the first frame the vocoder_service hasn't
+        // decoded yet, and a terminate waits until it all has
+        amt_produce = vocoder_out.ready();
+        if (terminate_call.first) {
+          d_terminate_pending = terminate_call;
+        }
+        terminate_call = d_terminate_pending;
+        terminate_call.first = d_terminate_pending.first && !vocoder_out.pending();
+        if (terminate_call.first) {
+          d_terminate_pending.first = false;
+        }
         int16_t *out = (int16_t *)output_items[0];
 
         //BOOST_LOG_TRIVIAL(trace) << "P25 Frame Assembler -  output_queue: " << output_queue.size() << " noutput_items: " <<  noutput_items << " ninput_items: " << ninput_items[0];
 
         if (amt_produce > 0) {
             if (amt_produce >= 32768) {
-              BOOST_LOG_TRIVIAL(error) << "P25 Frame Assembler -  output_queue size: " << output_queue.size() << " max size: " << output_queue.max_size() << " limiting amt_produce to  32767 ";
+              BOOST_LOG_TRIVIAL(error) << "P25 Frame Assembler -  output_queue size: " << output_queue.size() << " limiting amt_produce to  32767 ";
               
               amt_produce = 32767; // buffer limit is 32768, see gnuradio/gnuradio-runtime/lib/../include/gnuradio/buffer.h:186
             }
 
-            for (int i = 0; i < amt_produce; i++) {
-              out[i] = output_queue[i];
-            }
-            output_queue.erase(output_queue.begin(), output_queue.begin() + amt_produce);
+            output_queue.read(out, amt_produce);
+            vocoder_out.consumed(amt_produce);
 
             send_grp_src_id();
 
             BOOST_LOG_TRIVIAL(trace) << "setting silence_frame_count " << silence_frame_count << " to d_silence_frames: " << d_silence_frames << std::endl;
             silence_frame_count = d_silence_frames;
         } else {
-          if (silence_frame_count > 0) {
+          if ((silence_frame_count > 0) && !vocoder_out.pending()) {
             std::fill(out, out + noutput_items, 0);
             amt_produce = noutput_items;
             silence_frame_count--;
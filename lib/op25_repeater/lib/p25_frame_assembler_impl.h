@@ -33,6 +33,7 @@
 
 #include "p25p1_fdma.h"
 #include "p25p2_tdma.h"
+#include "vocoder_output.h"
 #include "op25_audio.h"
 #include "log_ts.h"
 
@@ -70,7 +71,9 @@ namespace gr {
     void set_debug(int debug) ;
     void reset_timer() ;
 	typedef std::vector<bool> bit_vector;
-	std::deque<int16_t> output_queue;
+	audio_ring output_queue;
+	vocoder_output vocoder_out;	// after the decoders, so it is destroyed before them
+	std::pair<bool,long> d_terminate_pending;
 
   void p25p2_queue_msg(int duid);
   void set_phase2_tdma(bool p);
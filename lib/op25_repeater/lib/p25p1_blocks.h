@@ -0,0 +1,169 @@
+/* -*- c++ -*- */
+/*
+ * This file is part of OP25
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_P25P1_BLOCKS_H
+#define INCLUDED_P25P1_BLOCKS_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Decoding of the P25 Phase 1 TSBK and PDU blocks: the CRC-CCITT of a 12
+ * byte block, the CRC-32 of an MBT's data, and the deinterleave and 1/2
+ * rate trellis decode of a 196 bit block.
+ *
+ * The CRCs go a byte at a time through a 256 entry table and the trellis
+ * goes a dibit at a time through a table of the next state for each state
+ * and received codeword, so nothing is counted or compared per bit. They
+ * give the same results as the bit at a time versions they replaced,
+ * which utils/p25-block-bench checks.
+ */
+
+namespace gr {
+    namespace op25_repeater {
+
+        /* remainder of t * x^16 for the CCITT polynomial, for each byte t */
+        struct p25p1_crc16_table {
+            uint16_t t[256];
+            p25p1_crc16_table() {
+                const uint32_t poly = 0x11021;
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t r = i << 16;
+                    for (int bit = 23; bit >= 16; bit--) {
+                        if (r & (1 << bit))
+                            r ^= poly << (bit - 16);
+                    }
+                    t[i] = r & 0xffff;
+                }
+            }
+        };
+
+        /* crc of each byte shifted in at the top of the 32 bit register */
+        struct p25p1_crc32_table {
+            uint32_t t[256];
+            p25p1_crc32_table() {
+                const uint32_t g = 0x04c11db7;
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t crc = i << 24;
+                    for (int j = 0; j < 8; j++)
+                        crc = (crc & 0x80000000) ? ((crc << 1) ^ g) : (crc << 1);
+                    t[i] = crc;
+                }
+            }
+        };
+
+        /* next state after each dibit's codeword, -1 where two candidates are equally close */
+        struct p25p1_trellis_table {
+            int8_t next[4][16];
+            p25p1_trellis_table() {
+                static const uint8_t next_words[4][4] = {
+                    {0x2, 0xC, 0x1, 0xF},
+                    {0xE, 0x0, 0xD, 0x3},
+                    {0x9, 0x7, 0xA, 0x4},
+                    {0x5, 0xB, 0x6, 0x8}
+                };
+                for (int state = 0; state < 4; state++) {
+                    for (int codeword = 0; codeword < 16; codeword++) {
+                        int min = 5, index = -1;
+                        for (int j = 0; j < 4; j++) {
+                            int hd = __builtin_popcount(codeword ^ next_words[state][j]);
+                            if (hd < min) {
+                                min = hd;
+                                index = j;
+                            } else if (hd == min) {
+                                index = -1;
+                            }
+                        }
+                        next[state][codeword] = index;
+                    }
+                }
+            }
+        };
+
+        /* the message bits of buf are followed by the inverted crc, so a good block gives 0 */
+        static inline uint16_t p25p1_crc16(const uint8_t buf[], int len) {
+            static const p25p1_crc16_table table;
+            if (buf == 0)
+                return -1;
+            uint32_t crc = 0;
+            for (int i = 0; i < len; i++)
+                crc = (((crc & 0xff) << 8) | buf[i]) ^ table.t[crc >> 8];
+            return (crc ^ 0xffff) & 0xffff;
+        }
+
+        /* length is nr. of bits */
+        static inline uint32_t p25p1_crc32(const uint8_t buf[], int len) {
+            static const p25p1_crc32_table table;
+            uint32_t crc = 0;
+            int i;
+            for (i = 0; i + 8 <= len; i += 8)
+                crc = (crc << 8) ^ table.t[(crc >> 24) ^ buf[i / 8]];
+            for (; i < len; i++) {
+                int b = (buf[i / 8] >> (7 - (i % 8))) & 1;
+                crc = (((crc >> 31) ^ b) & 1) ? ((crc << 1) ^ 0x04c11db7) : (crc << 1);
+            }
+            return crc ^ 0xffffffff;
+        }
+
+        /* deinterleave and trellis1_2 decode the 196 bits of bv from start */
+        /* buf is assumed to be a buffer of 12 bytes, returns -1 on a decode error */
+        template <typename Bits>
+        static inline int p25p1_block_deinterleave(const Bits& bv, unsigned int start, uint8_t* buf) {
+            /* where the 4 bits of each dibit's codeword are, one row of 16 per 4 dibits */
+            static const uint8_t deinterleave_tb[] = {
+                0,  1,  2,  3,  52, 53, 54, 55, 100,101,102,103, 148,149,150,151,
+                4,  5,  6,  7,  56, 57, 58, 59, 104,105,106,107, 152,153,154,155,
+                8,  9, 10, 11,  60, 61, 62, 63, 108,109,110,111, 156,157,158,159,
+                12, 13, 14, 15,  64, 65, 66, 67, 112,113,114,115, 160,161,162,163,
+                16, 17, 18, 19,  68, 69, 70, 71, 116,117,118,119, 164,165,166,167,
+                20, 21, 22, 23,  72, 73, 74, 75, 120,121,122,123, 168,169,170,171,
+                24, 25, 26, 27,  76, 77, 78, 79, 124,125,126,127, 172,173,174,175,
+                28, 29, 30, 31,  80, 81, 82, 83, 128,129,130,131, 176,177,178,179,
+                32, 33, 34, 35,  84, 85, 86, 87, 132,133,134,135, 180,181,182,183,
+                36, 37, 38, 39,  88, 89, 90, 91, 136,137,138,139, 184,185,186,187,
+                40, 41, 42, 43,  92, 93, 94, 95, 140,141,142,143, 188,189,190,191,
+                44, 45, 46, 47,  96, 97, 98, 99, 144,145,146,147, 192,193,194,195,
+                48, 49, 50, 51 };
+            static const p25p1_trellis_table table;
+
+            memset(buf, 0, 12);
+
+            int state = 0;
+            for (int b = 0; b < 98*2; b += 4) {
+                uint8_t codeword = (bv[start+deinterleave_tb[b+0]] << 3) |
+                    (bv[start+deinterleave_tb[b+1]] << 2) |
+                    (bv[start+deinterleave_tb[b+2]] << 1) |
+                    bv[start+deinterleave_tb[b+3]];
+                state = table.next[state][codeword];
+                if (state < 0)
+                    return -1;	// decode error, return failure
+
+                /* append dibit onto output buffer, the last one is the flush dibit */
+                int d = b >> 2;
+                if (d < 48)
+                    buf[d >> 2] |= state << (6 - ((d%4) * 2));
+            }
+            return 0;
+        }
+
+    } // namespace op25_repeater
+} // namespace gr
+
+#endif /* INCLUDED_P25P1_BLOCKS_H */
@@ -24,6 +24,7 @@
 #endif
 
 #include "p25p1_fdma.h"
+#include "p25p1_blocks.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -59,139 +60,6 @@ namespace gr {
             delete framer;
         }
 
-        static uint16_t crc16(uint8_t buf[], int len) {
-            if (buf == 0)
-                return -1;
-            uint32_t poly = (1<<12) + (1<<5) + (1<<0);
-            uint32_t crc = 0;
-            for(int i=0; i<len; i++) {
-                uint8_t bits = buf[i];
-                for (int j=0; j<8; j++) {
-                    uint8_t bit = (bits >> (7-j)) & 1;
-                    crc = ((crc << 1) | bit) & 0x1ffff;
-                    if (crc & 0x10000)
-                        crc = (crc & 0xffff) ^ poly;
-                }
-            }
-            crc = crc ^ 0xffff;
-            return crc & 0xffff;
-        }
-
-        /* translated from p25craft.py Michael Ossmann <mike@ossmann.com>  */
-        static uint32_t crc32(uint8_t buf[], int len) {	/* length is nr. of bits */
-            uint32_t g = 0x04c11db7;
-            uint64_t crc = 0;
-            for (int i = 0; i < len; i++) {
-                crc <<= 1;
-                int b = ( buf [i / 8] >> (7 - (i % 8)) ) & 1;
-                if (((crc >> 32) ^ b) & 1)
-                    crc ^= g;
-            }
-            crc = (crc & 0xffffffff) ^ 0xffffffff;
-            return crc;
-        }
-
-        /* find_min is from wireshark/plugins/p25/packet-p25cai.c */
-        /* Copyright 2008, Michael Ossmann <mike@ossmann.com>  */
-        /* return the index of the lowest value in a list */
-        static int find_min(uint8_t list[], int len) {
-            int min = list[0];	
-            int index = 0;	
-            int unique = 1;	
-            int i;
-
-            for (i = 1; i < len; i++) {
-                if (list[i] < min) {
-                    min = list[i];
-                    index = i;
-                    unique = 1;
-                } else if (list[i] == min) {
-                    unique = 0;
-                }
-            }
-            /* return -1 if a minimum can't be found */
-            if (!unique)
-                return -1;
-
-            return index;
-        }
-
-        /* count_bits is from wireshark/plugins/p25/packet-p25cai.c */
-        /* Copyright 2008, Michael Ossmann <mike@ossmann.com>  */
-        /* count the number of 1 bits in an int */
-        static int count_bits(unsigned int n) {
-            int i = 0;
-            for (i = 0; n != 0; i++)
-                n &= n - 1;
-            return i;
-        }
-
-        /* adapted from wireshark/plugins/p25/packet-p25cai.c */
-        /* Copyright 2008, Michael Ossmann <mike@ossmann.com>  */
-        /* deinterleave and trellis1_2 decoding */
-        /* buf is assumed to be a buffer of 12 bytes */
-        static int block_deinterleave(bit_vector& bv, unsigned int start, uint8_t* buf) {
-            static const uint16_t deinterleave_tb[] = {
-                0,  1,  2,  3,  52, 53, 54, 55, 100,101,102,103, 148,149,150,151,
-                4,  5,  6,  7,  56, 57, 58, 59, 104,105,106,107, 152,153,154,155,
-                8,  9, 10, 11,  60, 61, 62, 63, 108,109,110,111, 156,157,158,159,
-                12, 13, 14, 15,  64, 65, 66, 67, 112,113,114,115, 160,161,162,163,
-                16, 17, 18, 19,  68, 69, 70, 71, 116,117,118,119, 164,165,166,167,
-                20, 21, 22, 23,  72, 73, 74, 75, 120,121,122,123, 168,169,170,171,
-                24, 25, 26, 27,  76, 77, 78, 79, 124,125,126,127, 172,173,174,175,
-                28, 29, 30, 31,  80, 81, 82, 83, 128,129,130,131, 176,177,178,179,
-                32, 33, 34, 35,  84, 85, 86, 87, 132,133,134,135, 180,181,182,183,
-                36, 37, 38, 39,  88, 89, 90, 91, 136,137,138,139, 184,185,186,187,
-                40, 41, 42, 43,  92, 93, 94, 95, 140,141,142,143, 188,189,190,191,
-                44, 45, 46, 47,  96, 97, 98, 99, 144,145,146,147, 192,193,194,195,
-                48, 49, 50, 51 };
-
-            uint8_t hd[4];
-            int b, d, j;
-            int state = 0;
-            uint8_t codeword;
-
-            static const uint8_t next_words[4][4] = {
-                {0x2, 0xC, 0x1, 0xF},
-                {0xE, 0x0, 0xD, 0x3},
-                {0x9, 0x7, 0xA, 0x4},
-                {0x5, 0xB, 0x6, 0x8}
-            };
-
-            memset(buf, 0, 12);
-
-            for (b=0; b < 98*2; b += 4) {
-                codeword = (bv[start+deinterleave_tb[b+0]] << 3) + 
-                    (bv[start+deinterleave_tb[b+1]] << 2) + 
-                    (bv[start+deinterleave_tb[b+2]] << 1) + 
-                    bv[start+deinterleave_tb[b+3]]     ;
-
-                /* try each codeword in a row of the state transition table */
-                for (j = 0; j < 4; j++) {
-                    /* find Hamming distance for candidate */
-                    hd[j] = count_bits(codeword ^ next_words[state][j]);
-                }
-                /* find the dibit that matches the most codeword bits (minimum Hamming distance) */
-                state = find_min(hd, 4);
-                /* error if minimum can't be found */
-                if(state == -1)
-                    return -1;	// decode error, return failure
-                /* It also might be nice to report a condition where the minimum is
-                 * non-zero, i.e. an error has been corrected.  It probably shouldn't
-                 * be a permanent failure, though.
-                 *
-                 * DISSECTOR_ASSERT(hd[state] == 0);
-                 */
-
-                /* append dibit onto output buffer */
-                d = b >> 2;	// dibit ctr
-                if (d < 48) {
-                    buf[d >> 2] |= state << (6 - ((d%4) * 2));
-                }
-            }
-            return 0;
-        }
-
         void p25p1_fdma::set_debug(int debug)
         {
             d_debug = debug;
@@ -206,7 +74,7 @@ namespace gr {
                 fprintf(stderr, "%s p25p1_fdma::set_nac: 0x%03x\n", logts.get(d_msgq_id), d_nac);
         }
 
-        p25p1_fdma::p25p1_fdma(const op25_audio& udp, log_ts& logger, int debug, bool do_imbe, bool do_output, bool do_msgq, gr::msg_queue::sptr queue, std::deque<int16_t> &output_queue, bool do_audio_output, bool soft_vocoder, int msgq_id) :
+        p25p1_fdma::p25p1_fdma(const op25_audio& udp, log_ts& logger, int debug, bool do_imbe, bool do_output, bool do_msgq, gr::msg_queue::sptr queue, audio_ring &output_queue, bool do_audio_output, bool soft_vocoder, int msgq_id) :
             write_bufp(0),
             d_debug(debug),
             d_do_imbe(do_imbe),
@@ -232,7 +100,8 @@ namespace gr {
             ess_algid(0x80),
             vf_tgid(0),
 			terminate_call(std::pair<bool,long>(false,0)),
-            p1voice_decode((debug > 0), udp, output_queue)
+            p1voice_decode((debug > 0), udp, output_queue),
+            d_vocoder_output(NULL)
         {
 			rx_status.error_count = 0;
 			rx_status.total_len = 0;
@@ -290,7 +159,7 @@ namespace gr {
                 memcpy(&wbuf[p], buf, len);	// copy data
                 p += len;
             }
-            send_msg(std::string(wbuf, p), duid);
+            send_msg((const uint8_t*)wbuf, p, duid);
             qtimer.reset();
         }
 
@@ -723,7 +592,7 @@ namespace gr {
             block_vector deinterleave_buf;
             if (process_blocks(fr, fr_len, deinterleave_buf) == 0) {
                 for (size_t j = 0; (j < deinterleave_buf.size()) && (lb == 0); j++) {
-                    if (crc16(deinterleave_buf[j].data(), 12) != 0) // validate CRC
+                    if (p25p1_crc16(deinterleave_buf[j].data(), 12) != 0) // validate CRC
                         return;
 
                     lb = deinterleave_buf[j][0] >> 7;	// last block flag
@@ -746,7 +615,7 @@ namespace gr {
             block_vector deinterleave_buf;
             if ((process_blocks(fr, fr_len, deinterleave_buf) == 0) &&
                     (deinterleave_buf.size() > 0)) {			// extract all blocks associated with this PDU
-                if (crc16(deinterleave_buf[0].data(), 12) != 0) // validate PDU header
+                if (p25p1_crc16(deinterleave_buf[0].data(), 12) != 0) // validate PDU header
                     return;
 
                 fmt =  deinterleave_buf[0][0] & 0x1f;
@@ -757,7 +626,7 @@ namespace gr {
                     if ((blks > deinterleave_buf.size()) || (deinterleave_buf.size() == 1))
                         return; // insufficient blocks available
 
-                    uint32_t crc1 = crc32(deinterleave_buf[1].data(), ((blks * 12) - 4) * 8);
+                    uint32_t crc1 = p25p1_crc32(deinterleave_buf[1].data(), ((blks * 12) - 4) * 8);
                     uint32_t crc2 = (deinterleave_buf[blks][8] << 24) + (deinterleave_buf[blks][9] << 16) +
                         (deinterleave_buf[blks][10] << 8) + deinterleave_buf[blks][11];
 
@@ -814,7 +683,7 @@ namespace gr {
             int bl_len = (bv.size() - (48+64)) / 196;
             for (bl_cnt = 0; bl_cnt < bl_len; bl_cnt++) { // deinterleave,  decode trellis1_2, save 12 byte block
                 dbuf.push_back({0,0,0,0,0,0,0,0,0,0,0,0});
-                if(block_deinterleave(bv, 48+64+bl_cnt*196, dbuf[bl_cnt].data()) != 0) {
+                if(p25p1_block_deinterleave(bv, 48+64+bl_cnt*196, dbuf[bl_cnt].data()) != 0) {
                     dbuf.pop_back();
                     return -1;
                 }
@@ -893,7 +762,10 @@ namespace gr {
 					sprintf(s, "%03x %03x %03x %03x %03x %03x %03x %03x\n", u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7]);
 
                     if (d_do_audio_output) {
-                        if ( !encrypted()) {
+                        if ( !encrypted() && d_vocoder_output && !op25audio.enabled() &&
+                             d_vocoder_output->queue_fullrate(d_soft_vocoder ? &software_decoder : NULL, &vocoder, u, E0, ET)) {
+                            // The vocoder_service decodes it, its place in output_queue is held until it has
+                        } else if ( !encrypted()) {
                             // This is the Vocoder that OP25 currently uses.
 
                             if (d_soft_vocoder) {
@@ -915,20 +787,22 @@ namespace gr {
                             if (op25audio.enabled()) {      // decoded audio goes out via UDP (normal code path)
                                 op25audio.send_audio(snd, SND_FRAME * sizeof(int16_t));
                             } else {                        // decoded audio back to gnuradio (still supported?)
-                                for (int i = 0; i < SND_FRAME; i++) {
-                                    output_queue.push_back(snd[i]);
-                                }
+                                output_queue.write(snd, SND_FRAME);
                             }
                         } else {
 		                    // For encrypted voice without a valid key, push silent audio frames
                             // If monitoring for metadata, this will allow tags to pass and preserve call flow
                             if (!op25audio.enabled()) {
-                                for (int i = 0; i < SND_FRAME; i++) {
-                                    output_queue.push_back(0);  // Silent frame
-                                }
+                                output_queue.fill(SND_FRAME, 0);  // Silent frame
                             }
                             std::string encr = "{\"encrypted\": " + std::to_string(1) + ", \"algid\": " + std::to_string(ess_algid) + ", \"keyid\": " + std::to_string(ess_keyid) + "}";
                             send_msg(encr, M_P25_JSON_DATA);
+                            // Once per transmission, so a recorder can give up on it right away
+                            if (!crypt_reported) {
+                                crypt_reported = true;
+                                std::string voice = "{\"type\": \"encrypted_voice\", \"algid\": " + std::to_string(ess_algid) + ", \"keyid\": " + std::to_string(ess_keyid) + "}";
+                                send_msg(voice, M_P25_JSON_DATA);
+                            }
                         }
                     }
 
@@ -964,13 +838,14 @@ namespace gr {
         }
 
         void p25p1_fdma::send_msg(const std::string msg_str, long msg_type) {
+            send_msg((const uint8_t*)msg_str.data(), msg_str.size(), msg_type);
+        }
+
+        void p25p1_fdma::send_msg(const uint8_t* m_buf, size_t m_len, long msg_type) {
             if (!d_do_msgq)
                 return;
 
-            gr::message::sptr msg = gr::message::make_from_string(msg_str, msg_type);     
-
-            if (!d_msg_queue->full_p())
-                d_msg_queue->insert_tail(msg);
+            d_msg_pool.send(d_msg_queue, m_buf, m_len, msg_type, 0, 0);
         }
 
         void p25p1_fdma::process_frame() {
@@ -28,8 +28,10 @@
 #include "ezpwd/rs"
 
 #include "log_ts.h"
+#include "msg_pool.h"
 #include "op25_timer.h"
 #include "op25_audio.h"
+#include "audio_ring.h"
 #include "p25_framer.h"
 #include "software_imbe_decoder.h"
 #include "p25_crypt_algs.h"
@@ -38,6 +40,7 @@
 #include <boost/log/trivial.hpp>
 #include "../include/op25_repeater/rx_status.h"
 #include "imbe_vocoder/imbe_vocoder.h" // for the original full rate vocoder
+#include "vocoder_output.h"
 
 namespace gr {
     namespace op25_repeater {
@@ -69,8 +72,9 @@ namespace gr {
                 void process_frame();
                 void check_timeout();
                 inline bool encrypted() { return (ess_algid != 0x80); }
-                inline void reset_ess() { ess_algid = 0x80; memset(ess_mi, 0, sizeof(ess_mi)); }
+                inline void reset_ess() { ess_algid = 0x80; memset(ess_mi, 0, sizeof(ess_mi)); crypt_reported = false; }
                 void send_msg(const std::string msg_str, long msg_type);
+                void send_msg(const uint8_t* m_buf, size_t m_len, long msg_type);
 
                 // internal instance variables and state
                 int write_bufp;
@@ -84,7 +88,8 @@ namespace gr {
                 bool d_soft_vocoder;
                 int d_nac;
                 gr::msg_queue::sptr d_msg_queue;
-                std::deque<int16_t> &output_queue;
+                msg_pool d_msg_pool;
+                audio_ring &output_queue;
                 p25_framer* framer;
                 op25_timer qtimer;
 				software_imbe_decoder software_decoder;
@@ -114,9 +119,11 @@ namespace gr {
                 uint16_t  ess_keyid;
                 uint8_t ess_algid;
                 uint8_t  ess_mi[9] = {0};
+                bool crypt_reported = false; // encrypted_voice sent for this transmission
                 uint16_t vf_tgid;
 
                 imbe_vocoder vocoder; // for original full rate vocoder
+                vocoder_output *d_vocoder_output; // voice frames go to the vocoder_service when set
 
             public:
                 void set_debug(int debug);
@@ -126,7 +133,7 @@ namespace gr {
                 void crypt_reset();
                 void crypt_key(uint16_t keyid, uint8_t algid, const std::vector<uint8_t> &key);
                 void rx_sym (const uint8_t *syms, int nsyms);
-                p25p1_fdma(const op25_audio& udp,  log_ts& logger, int debug, bool do_imbe, bool do_output, bool do_msgq, gr::msg_queue::sptr queue, std::deque<int16_t> &output_queue, bool do_audio_output, bool soft_vocoder, int msgq_id = 0);
+                p25p1_fdma(const op25_audio& udp,  log_ts& logger, int debug, bool do_imbe, bool do_output, bool do_msgq, gr::msg_queue::sptr queue, audio_ring &output_queue, bool do_audio_output, bool soft_vocoder, int msgq_id = 0);
                 ~p25p1_fdma();
                 uint32_t load_nid(const uint8_t *syms, int nsyms, const uint64_t fs);
                 bool load_body(const uint8_t * syms, int nsyms);
@@ -146,6 +153,7 @@ namespace gr {
                 void reset_call_terminated();
                 Rx_Status get_rx_status();
                 void clear();
+                inline void set_vocoder_output(vocoder_output *output) { d_vocoder_output = output; }
 
         };
     } // namespace
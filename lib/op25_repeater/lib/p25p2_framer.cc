@@ -14,13 +14,13 @@
 
 // constructor
 p25p2_framer::p25p2_framer() :
-	d_next_bit(0),
+	d_next_dibit(0),
 	d_in_sync(0),
 	d_fs(0),
 	nid_accum(0),
-	symbols_received(0),
-	d_frame_body(P25P2_BURST_SIZE)
+	symbols_received(0)
 {
+	memset(d_burst, 0, sizeof(d_burst));
 }
 
 // destructor
@@ -28,65 +28,65 @@ p25p2_framer::~p25p2_framer ()
 {
 }
 
+bool p25p2_framer::rx_sym(uint8_t dibit) {
+	bool complete;
+	rx_syms(&dibit, 1, complete);
+	return complete;
+}
+
 /*
- * rx_sym: called once per received symbol
+ * rx_syms: called with the received symbols
  * 1. looks for flags sequences
  * 2. after flags detected (nid_syms > 0), accumulate 64-bit NID word
  * 3. do BCH check on completed NID
- * 4. after valid BCH check (next_bit > 0), accumulate frame data bits
+ * 4. after valid BCH check (next_bit > 0), accumulate frame data dibits
  *
- * Returns true when complete frame received, else false
+ * Stops after the dibit that completes a frame, with complete set
  */
-bool p25p2_framer::rx_sym(uint8_t dibit) {
-        bool rc = false;
-
-	symbols_received++;
+int p25p2_framer::rx_syms(const uint8_t dibits[], int n, bool &complete) {
+	complete = false;
+	for (int i = 0; i < n; i++) {
+		const uint8_t dibit = dibits[i] & 0x3;
+		symbols_received++;
 
-	nid_accum <<= 2;
-	nid_accum |= (dibit & 0x3);
+		nid_accum <<= 2;
+		nid_accum |= dibit;
 
-	int found=0;
-	if(check_frame_sync((nid_accum & P25P2_FRAME_SYNC_MASK) ^ P25P2_FRAME_SYNC_MAGIC, 4, 40)) {
-        d_fs = P25P2_FRAME_SYNC_MAGIC;
-		found = 1;
-	}
-	else if(check_frame_sync((nid_accum & P25P2_FRAME_SYNC_MASK) ^ P25P2_FRAME_SYNC_REV_P, 0, 40)) {
-        d_fs = P25P2_FRAME_SYNC_REV_P;
-		found = 1;
-	}
-	else if(check_frame_sync((nid_accum & P25P2_FRAME_SYNC_MASK) ^ P25P2_FRAME_SYNC_X2400, 0, 40)) {
-        d_fs = P25P2_FRAME_SYNC_X2400;
-		found = 1;
-	}
-	else if(check_frame_sync((nid_accum & P25P2_FRAME_SYNC_MASK) ^ P25P2_FRAME_SYNC_N1200, 0, 40)) {
-        d_fs = P25P2_FRAME_SYNC_N1200;
-		found = 1;
-	}
-	else if(check_frame_sync((nid_accum & P25P2_FRAME_SYNC_MASK) ^ P25P2_FRAME_SYNC_P1200, 0, 40)) {
-        d_fs = P25P2_FRAME_SYNC_P1200;
-		found = 1;
-	}
-	if (found) {
-		uint64_t accum = d_fs;
-		for (int i=0; i < 40; i++) {
-			d_frame_body[39 - i] = accum & 1;
-			accum = accum >> 1;
+		// Only the usual sync is allowed errors, the others have to match
+		const uint64_t accum = nid_accum & P25P2_FRAME_SYNC_MASK;
+		uint64_t fs = 0;
+		if (check_frame_sync(accum ^ P25P2_FRAME_SYNC_MAGIC, 4, 40))
+			fs = P25P2_FRAME_SYNC_MAGIC;
+		else if (accum == P25P2_FRAME_SYNC_REV_P)
+			fs = P25P2_FRAME_SYNC_REV_P;
+		else if (accum == P25P2_FRAME_SYNC_X2400)
+			fs = P25P2_FRAME_SYNC_X2400;
+		else if (accum == P25P2_FRAME_SYNC_N1200)
+			fs = P25P2_FRAME_SYNC_N1200;
+		else if (accum == P25P2_FRAME_SYNC_P1200)
+			fs = P25P2_FRAME_SYNC_P1200;
+		if (fs) {
+			d_fs = fs;
+			for (int j = 0; j < 20; j++) {
+				d_burst[19 - j] = fs & 3;
+				fs >>= 2;
+			}
+			d_next_dibit = 20;
+			d_in_sync = 10;  // renew allowance
+			continue;
 		}
-		d_next_bit = 40;
-		d_in_sync = 10;  // renew allowance
-		return false;
-	}
-	if (d_in_sync) {
-		d_frame_body[d_next_bit++] = (dibit >> 1) & 1;
-		d_frame_body[d_next_bit++] =  dibit       & 1;
-		// dispose of received frame (if exists) and complete frame is received
-		if (d_next_bit >= P25P2_BURST_SIZE) {
-			rc = true;	// set rc indicating frame available
-			d_in_sync--;	// each frame reduces allowance
-			d_next_bit = 0;
+		if (d_in_sync) {
+			d_burst[d_next_dibit++] = dibit;
+			// dispose of received frame (if exists) and complete frame is received
+			if (d_next_dibit >= P25P2_BURST_DIBITS) {
+				complete = true;	// set complete indicating frame available
+				d_in_sync--;	// each frame reduces allowance
+				d_next_dibit = 0;
+				return i + 1;
+			}
+		} else {
+			d_fs = 0;
 		}
-	} else {
-        d_fs = 0;
-    }
-	return rc;
+	}
+	return n;
 }
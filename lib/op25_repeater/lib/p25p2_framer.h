@@ -4,25 +4,45 @@
  * construct P25 P2 TDMA frames out of raw dibits
  * Copyright 2014, Max H. Parke KA1RBI
  *
- * usage: after constructing, call rx_sym once per received dibit.
- * frame available when true is returned
+ * usage: after constructing, call rx_sym once per received dibit, or
+ * rx_syms with as many as there are.
+ * frame available in d_burst when true is returned
  */
 
 #ifndef INCLUDED_P25P2_FRAMER_H
 #define INCLUDED_P25P2_FRAMER_H
 
+#include <stdint.h>
+#include <string.h>
 #include "frame_sync_magics.h"
 
 static const unsigned int P25P2_BURST_SIZE=360; /* in bits */
+static const unsigned int P25P2_BURST_DIBITS=P25P2_BURST_SIZE/2;
+
+/*
+ * XOR len dibits of a burst with the scrambling mask, a word at a time
+ */
+static inline void p25p2_descramble(uint8_t out[], const uint8_t in[], const uint8_t mask[], size_t len)
+{
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		uint64_t a, b;
+		memcpy(&a, in + i, 8);
+		memcpy(&b, mask + i, 8);
+		a ^= b;
+		memcpy(out + i, &a, 8);
+	}
+	for (; i < len; i++)
+		out[i] = in[i] ^ mask[i];
+}
 
 class p25p2_framer;
 
 class p25p2_framer
 {
 private:
-	typedef std::vector<bool> bit_vector;
   // internal instance variables and state
-	uint32_t d_next_bit;
+	uint32_t d_next_dibit;
 	uint32_t d_in_sync;
 	uint64_t d_fs;
 	uint64_t nid_accum;
@@ -31,11 +51,13 @@ public:
 	p25p2_framer();  	// constructor
 	~p25p2_framer ();	// destructor
 	bool rx_sym(uint8_t dibit) ;
+	// Takes dibits up to the end of the next burst, returns how many it took
+	int rx_syms(const uint8_t dibits[], int n, bool &complete);
     uint64_t get_fs() { return d_fs; }
 
 	uint32_t symbols_received;
 
-	bit_vector d_frame_body;	// all bits in frame
+	uint8_t d_burst[P25P2_BURST_DIBITS];	// all dibits in frame
 };
 
 #endif /* INCLUDED_P25P2_FRAMER_H */
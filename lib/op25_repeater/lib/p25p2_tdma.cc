@@ -97,7 +97,7 @@ static const uint8_t mac_msg_len[256] = {
 	28,  0,  0, 14, 17, 14,  0,  0, 16,  8, 11,  0, 13, 19,  0,  0, 
 	 0,  0, 16, 14,  0,  0, 12,  0, 22,  0, 11, 13, 11,  0, 15,  0 };
 
-p25p2_tdma::p25p2_tdma(const op25_audio& udp, log_ts& logger, int slotid, int debug, bool do_msgq, gr::msg_queue::sptr queue, std::deque<int16_t> &qptr, bool do_audio_output, bool soft_vocoder, int msgq_id) :	// constructor
+p25p2_tdma::p25p2_tdma(const op25_audio& udp, log_ts& logger, int slotid, int debug, bool do_msgq, gr::msg_queue::sptr queue, audio_ring &qptr, bool do_audio_output, bool soft_vocoder, int msgq_id) :	// constructor
 	tdma_xormask(new uint8_t[SUPERFRAME_SIZE]),
 	symbols_received(0),
 	packets(0),
@@ -106,6 +106,7 @@ p25p2_tdma::p25p2_tdma(const op25_audio& udp, log_ts& logger, int slotid, int de
 	d_tdma_slot_first_4v(-1),
 	mbe_err_cnt(0),
 	tone_frame(false),
+	d_vocoder_output(NULL),
 	d_msg_queue(queue),
 	output_queue_decode(qptr),
 	d_do_msgq(do_msgq),
@@ -144,6 +145,13 @@ bool p25p2_tdma::rx_sym(uint8_t sym)
 	return p2framer.rx_sym(sym);
 }
 
+int p25p2_tdma::rx_syms(const uint8_t syms[], int n, bool &complete)
+{
+	int used = p2framer.rx_syms(syms, n, complete);
+	symbols_received += used;
+	return used;
+}
+
 void p25p2_tdma::set_slotid(int slotid)
 {
 	assert (slotid == 0 || slotid == 1);
@@ -704,6 +712,7 @@ void p25p2_tdma::handle_voice_frame(const uint8_t dibits[], int slot, int voice_
 	int16_t snd;
 	int K;
 	int rc = -1;
+	bool queued = false;
 	frame_type fr_type;
 
 	// Deinterleave and figure out frame type:
@@ -747,6 +756,12 @@ void p25p2_tdma::handle_voice_frame(const uint8_t dibits[], int slot, int voice_
 		// For encrypted voice without a valid key, push silent audio frames
         // If monitoring for metadata, this will allow tags to pass and preserve call flow
 		memset(samples_buf, 0, sizeof(samples_buf));
+		// Once per transmission, so a recorder can give up on it right away
+		if (!crypt_reported) {
+			crypt_reported = true;
+			std::string s = "{\"type\": \"encrypted_voice\", \"algid\": " + std::to_string(ess_algid) + ", \"keyid\": " + std::to_string(ess_keyid) + "}";
+			send_msg(s, M_P25_JSON_DATA);
+		}
 		}
 	}
 
@@ -781,27 +796,36 @@ void p25p2_tdma::handle_voice_frame(const uint8_t dibits[], int slot, int voice_
 		// Synthesize tones or speech as long as dequantization was successful and overall error rate is below threshold
 		if ((rc == 0) && (errs_mp.ER <= 0.096)) {
 			if (tone_frame) {
+				if (d_vocoder_output)
+					d_vocoder_output->wait();	// tones are made here, with the decoder a worker may be using
 				software_decoder.decode_tone(samples_buf, tone_mp.ID, tone_mp.AD, &tone_mp.n);
-			} else if(d_soft_vocoder) {
+			} else {
 				K = 12;
 				if (cur_mp.L <= 36)
 					K = int(float(cur_mp.L + 2.0) / 3.0);
-				software_decoder.decode_tap(samples_buf, cur_mp.L, K, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1]);
-			} else {
-				vocoder.decode_tap(samples_buf, cur_mp.L, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1]);
+				if (d_vocoder_output && !op25audio.enabled() &&
+				    d_vocoder_output->queue_tap(d_soft_vocoder ? &software_decoder : NULL, &vocoder, cur_mp.L, K, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1])) {
+					queued = true;  // its place in output_queue_decode is held until it is decoded
+				} else if(d_soft_vocoder) {
+					software_decoder.decode_tap(samples_buf, cur_mp.L, K, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1]);
+				} else {
+					vocoder.decode_tap(samples_buf, cur_mp.L, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1]);
+				}
 			}
 		}
 	}
 
 	// Populate output buffer with either audio samples or silence
 	write_bufp = 0;
-	for (int i=0; i < IMBE_SAMPLES_PER_FRAME; i++) {
-		snd = samples_buf[i];
-		output_queue_decode.push_back(snd); // outputs the sound
-		write_buf[write_bufp++] = snd & 0xFF ;
-		write_buf[write_bufp++] = snd >> 8;
+	if (!queued) {
+		output_queue_decode.write(samples_buf, IMBE_SAMPLES_PER_FRAME); // outputs the sound
+		for (int i=0; i < IMBE_SAMPLES_PER_FRAME; i++) {
+			snd = samples_buf[i];
+			write_buf[write_bufp++] = snd & 0xFF ;
+			write_buf[write_bufp++] = snd >> 8;
+		}
 	}
-	if (d_do_audio_output && (write_bufp >= 0)) { 
+	if (d_do_audio_output && (write_bufp > 0)) {
 		op25audio.send_audio(write_buf, write_bufp);
 		write_bufp = 0;
 	}
@@ -812,12 +836,7 @@ void p25p2_tdma::handle_voice_frame(const uint8_t dibits[], int slot, int voice_
 
 int p25p2_tdma::handle_frame(void)
 {
-	uint8_t dibits[180];
-	int rc;
-	for (size_t i=0; i<sizeof(dibits); i++)
-		dibits[i] = p2framer.d_frame_body[i*2+1] + (p2framer.d_frame_body[i*2] << 1);
-	rc = handle_packet(dibits, p2framer.get_fs());
-	return rc;
+	return handle_packet(p2framer.d_burst, p2framer.get_fs());
 }
 
 /* returns true if in sync and slot matches current active slot d_slotid */
@@ -835,9 +854,9 @@ int p25p2_tdma::handle_packet(uint8_t dibits[], const uint64_t fs)
 	burst_type = duid.duid_lookup(duid.extract_duid(burstp));
 	if ((burst_type != 13) && (which_slot[sync.tdma_slotid()] != d_slotid)) // only permit control channel or active slot
 		return -1;
-	for (int i=0; i<BURST_SIZE - 10; i++) {
-		xored_burst[i] = burstp[i] ^ tdma_xormask[sync.tdma_slotid() * BURST_SIZE + i];
-	}
+	// only the 4V, 2V, sacch and facch bursts that are scrambled are descrambled
+	if (burst_type == 0 || burst_type == 6 || burst_type == 3 || burst_type == 9)
+		p25p2_descramble(xored_burst, burstp, &tdma_xormask[sync.tdma_slotid() * BURST_SIZE], BURST_SIZE - 10);
 	if (burst_type == 0 || burst_type == 6)	{       // 4V or 2V burst
 		// normalize current TDMA slot from 0-9 to ch0/ch1 slot 0-4
 		int current_slot = sync.tdma_slotid() >> 1;
@@ -958,10 +977,8 @@ void p25p2_tdma::handle_4V2V_ess(const uint8_t dibits[])
 
 void p25p2_tdma::send_msg(const std::string msg_str, long msg_type)
 {
-	if (!d_do_msgq || d_msg_queue->full_p())
+	if (!d_do_msgq)
 		return;
 
-	gr::message::sptr msg = gr::message::make_from_string(msg_str, msg_type, 0, 0);           
-    if (!d_msg_queue->full_p())
-    	d_msg_queue->insert_tail(msg);
+	d_msg_pool.send(d_msg_queue, (const uint8_t*)msg_str.data(), msg_str.size(), msg_type, 0, 0);
 }
@@ -33,9 +33,12 @@
 #include "p25p2_vf.h"
 #include "p25p2_framer.h"
 #include "p25_crypt_algs.h"
+#include "msg_pool.h"
 #include "op25_audio.h"
+#include "audio_ring.h"
 #include "log_ts.h"
 #include "imbe_vocoder/imbe_vocoder.h"
+#include "vocoder_output.h"
 
 #include "ezpwd/rs"
 
@@ -43,7 +46,7 @@
 class p25p2_tdma
 {
 public:
-	p25p2_tdma(const op25_audio& udp, log_ts& logger, int slotid, int debug, bool do_msgq, gr::msg_queue::sptr queue, std::deque<int16_t> &qptr, bool do_audio_output, bool soft_vocoder, int msgq_id = 0) ;	// constructor
+	p25p2_tdma(const op25_audio& udp, log_ts& logger, int slotid, int debug, bool do_msgq, gr::msg_queue::sptr queue, audio_ring &qptr, bool do_audio_output, bool soft_vocoder, int msgq_id = 0) ;	// constructor
 	int handle_packet(uint8_t dibits[], const uint64_t fs) ;
 	void set_slotid(int slotid);
 	void call_end();
@@ -57,11 +60,15 @@ public:
 	inline void set_nac(int nac) { d_nac = nac; }
 	inline void set_debug(int debug) { d_debug = debug; }
 	bool rx_sym(uint8_t sym);
+	// Takes symbols up to the end of the next burst, returns how many it
+	// took, with complete set if there is a frame for handle_frame()
+	int rx_syms(const uint8_t syms[], int n, bool &complete);
 	int handle_frame(void) ;
   	std::pair<bool,long> get_call_terminated();
 	void reset_call_terminated();
 	long get_ptt_src_id();
 	long get_ptt_grp_id();
+	inline void set_vocoder_output(vocoder_output *output) { d_vocoder_output = output; }
 private:
 	p25p2_sync sync;
 	p25p2_duid duid;
@@ -79,8 +86,10 @@ private:
 	bool tone_frame;
 	software_imbe_decoder software_decoder;
 	imbe_vocoder vocoder;
+	vocoder_output *d_vocoder_output;	// voice frames go to the vocoder_service when set
 	gr::msg_queue::sptr d_msg_queue;
-	std::deque<int16_t> &output_queue_decode;
+	msg_pool d_msg_pool;
+	audio_ring &output_queue_decode;
 	bool d_do_msgq;
 	int d_msgq_id;
 	bool d_do_audio_output;
@@ -108,6 +117,7 @@ private:
 	uint16_t ess_keyid;
 	uint8_t ess_algid;
 	uint8_t ess_mi[9] = {0};
+	bool crypt_reported = false; // encrypted_voice sent for this transmission
 	uint16_t next_keyid;
 	uint8_t next_algid;
 	uint8_t next_mi[9] = {0};
@@ -128,7 +138,7 @@ private:
     void convert_abbrev_msg(const uint8_t byte_buf[], const uint16_t nac, const uint8_t mfid = 0x00);
 	void handle_4V2V_ess(const uint8_t dibits[]);
 	inline bool encrypted() { return (ess_algid != 0x80); }
-    inline void reset_ess() { ess_algid = 0x80; memset(ess_mi, 0, sizeof(ess_mi)); }
+    inline void reset_ess() { ess_algid = 0x80; memset(ess_mi, 0, sizeof(ess_mi)); crypt_reported = false; }
 
 	void send_msg(const std::string msg_str, long msg_type);
 };
@@ -574,18 +574,8 @@ static const uint32_t pr_n[4096] = {	\
 		u[0] = gly24128Dec(c0, &errs);
 		errs_mp->E0 = errs;
 		err_cnt += errs;
-		// TODO: use pr_n[] to lookup m1
-		int pr[24];
-		int _m1[24];
-		pr[0] = 16 * u[0];
-		for (int n=1; n < 24; n++) {
-			pr[n] = (173*pr[n-1] + 13849) - 65536 * int((173*pr[n-1]+13849)/65536);
-			_m1[n-1] = (pr[n] / 32768) & 1;
-		}
-		_m1[23] = 0;
-		int m1 = 0;
-		for (int i=0; i<23; i++)
-			m1 = (m1 << 1) + _m1[i];
+		// pr_n[] has the 23 bits of the PN sequence seeded by u0, as the encoder uses it
+		int m1 = pr_n[u[0]] >> 1;
 	
 		u[1] = gly23127Dec(c1 ^ m1, &errs);
 		errs_mp->E1 = errs;
@@ -732,94 +722,53 @@ static const uint32_t pr_n[4096] = {	\
 		}
 	}
 
-	void p25p2_vf::extract_vcw(const uint8_t _vf[], int& _c0, int& _c1, int& _c2, int& _c3){
-		uint8_t vf[72];
-		uint8_t c0[24];
-		uint8_t c1[23];
-		uint8_t c2[11];
-		uint8_t c3[14];
-
-		for (size_t i=0; i<sizeof(vf)/2; i++) {
-			vf[i*2]   = (_vf[i] >> 1) & 1;
-			vf[i*2+1] = _vf[i] & 1;
+	// Each dibit's bits go to the codewords as c0 | c1 << 24 and c2 | c3 << 11,
+	// one word of each for each of the 36 dibits and its 4 values. It is made
+	// once from interleave_vcw(), so the two can't disagree.
+	struct vcw_deinterleave {
+		uint64_t c01[36][4];
+		uint64_t c23[36][4];
+		vcw_deinterleave() {
+			static const int lengths[4] = {24, 23, 11, 14};
+			static const int shifts[4] = {0, 24, 0, 11};
+			memset(c01, 0, sizeof(c01));
+			memset(c23, 0, sizeof(c23));
+			p25p2_vf vf;
+			for (int w = 0; w < 4; w++) {
+				for (int k = 0; k < lengths[w]; k++) {
+					int c[4] = {0, 0, 0, 0};
+					c[w] = 1 << k;
+					uint8_t dibits[36];
+					vf.interleave_vcw(dibits, c[0], c[1], c[2], c[3]);
+					uint64_t bit = (uint64_t)1 << (k + shifts[w]);
+					for (int i = 0; i < 36; i++) {
+						// dibits[i] is the bit of the dibit it went to, or 0
+						for (int v = 0; v < 4; v++) {
+							if (dibits[i] & v) {
+								if (w < 2)
+									c01[i][v] |= bit;
+								else
+									c23[i][v] |= bit;
+							}
+						}
+					}
+				}
+			}
 		}
+	};
 
-		c0[23] = vf[0];
-		c0[5] = vf[1];
-		c1[10] = vf[2];
-		c2[3] = vf[3];
-		c0[22] = vf[4];
-		c0[4] = vf[5];
-		c1[9] = vf[6];
-		c2[2] = vf[7];
-		c0[21] = vf[8];
-		c0[3] = vf[9];
-		c1[8] = vf[10];
-		c2[1] = vf[11];
-		c0[20] = vf[12];
-		c0[2] = vf[13];
-		c1[7] = vf[14];
-		c2[0] = vf[15];
-		c0[19] = vf[16];
-		c0[1] = vf[17];
-		c1[6] = vf[18];
-		c3[13] = vf[19];
-		c0[18] = vf[20];
-		c0[0] = vf[21];
-		c1[5] = vf[22];
-		c3[12] = vf[23];
-		c0[17] = vf[24];
-		c1[22] = vf[25];
-		c1[4] = vf[26];
-		c3[11] = vf[27];
-		c0[16] = vf[28];
-		c1[21] = vf[29];
-		c1[3] = vf[30];
-		c3[10] = vf[31];
-		c0[15] = vf[32];
-		c1[20] = vf[33];
-		c1[2] = vf[34];
-		c3[9] = vf[35];
-		c0[14] = vf[36];
-		c1[19] = vf[37];
-		c1[1] = vf[38];
-		c3[8] = vf[39];
-		c0[13] = vf[40];
-		c1[18] = vf[41];
-		c1[0] = vf[42];
-		c3[7] = vf[43];
-		c0[12] = vf[44];
-		c1[17] = vf[45];
-		c2[10] = vf[46];
-		c3[6] = vf[47];
-		c0[11] = vf[48];
-		c1[16] = vf[49];
-		c2[9] = vf[50];
-		c3[5] = vf[51];
-		c0[10] = vf[52];
-		c1[15] = vf[53];
-		c2[8] = vf[54];
-		c3[4] = vf[55];
-		c0[9] = vf[56];
-		c1[14] = vf[57];
-		c2[7] = vf[58];
-		c3[3] = vf[59];
-		c0[8] = vf[60];
-		c1[13] = vf[61];
-		c2[6] = vf[62];
-		c3[2] = vf[63];
-		c0[7] = vf[64];
-		c1[12] = vf[65];
-		c2[5] = vf[66];
-		c3[1] = vf[67];
-		c0[6] = vf[68];
-		c1[11] = vf[69];
-		c2[4] = vf[70];
-		c3[0] = vf[71];
-		load_i(c0, _c0, 24);
-		load_i(c1, _c1, 23);
-		load_i(c2, _c2, 11);
-		load_i(c3, _c3, 14);
+	void p25p2_vf::extract_vcw(const uint8_t _vf[], int& _c0, int& _c1, int& _c2, int& _c3){
+		static const vcw_deinterleave table;
+		uint64_t c01 = 0;
+		uint64_t c23 = 0;
+		for (int i=0; i<36; i++) {
+			c01 |= table.c01[i][_vf[i] & 3];
+			c23 |= table.c23[i][_vf[i] & 3];
+		}
+		_c0 = c01 & 0xffffff;
+		_c1 = (c01 >> 24) & 0x7fffff;
+		_c2 = c23 & 0x7ff;
+		_c3 = (c23 >> 11) & 0x3fff;
 	}
 
 static const int m_list[] = {0, 1, 2, 3, 4, 5, 11, 12, 13, 14, 17, 18, 19, 20, 21, 22, 23, 26, 27, 28, 29, 30, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 7, 8, 9, 10, 15, 16, 24, 25, 31, 32, 6};
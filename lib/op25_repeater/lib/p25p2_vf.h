@@ -36,6 +36,7 @@ public:
 	void unpack_cw(const packed_codeword& cw, int* u);
 	void unpack_b(int* b, const int* u);
 private:
+	friend struct vcw_deinterleave;
 	void extract_vcw(const uint8_t _vf[], int& _c0, int& _c1, int& _c2, int& _c3);
 	void interleave_vcw(uint8_t _vf[], int _c0, int _c1, int _c2, int _c3);
 };
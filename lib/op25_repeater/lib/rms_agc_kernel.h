@@ -0,0 +1,189 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_RMS_AGC_KERNEL_H
+#define INCLUDED_OP25_REPEATER_RMS_AGC_KERNEL_H
+
+#include <algorithm>
+#include <complex>
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define RMS_AGC_SSE 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define RMS_AGC_NEON 1
+#endif
+
+/*
+ * The RMS AGC of op25's rmsagc_ff and trunk-recorder's rms_agc, on its own
+ * so utils/rms-agc-bench can run it.
+ *
+ * Each sample is scaled by gain / sqrt() of the running mean square, which
+ * went a sample at a time with a sqrt and a divide each. The mean square is
+ * an average that feeds back on itself and is still made in double, but a
+ * few samples at a time (see mean_squares()). The gains for a tile of
+ * samples are then made in one go from the reciprocal
+ * square root estimate of SSE or NEON and a Newton step, which is within a
+ * few parts in 10^7 of 1 / sqrt(), and the samples are scaled by them in a
+ * loop the compiler vectorizes.
+ *
+ * Where the mean square is 0, because every sample so far was, the sample
+ * is only multiplied by gain, as rmsagc_ff did.
+ */
+
+namespace gr {
+  namespace op25_repeater {
+
+class rms_agc_kernel {
+public:
+  static const int TILE = 256;
+  static const int GROUP = 4;
+
+  rms_agc_kernel(double alpha, double gain, double avg) : d_avg(avg) {
+    set_alpha(alpha);
+    set_gain(gain);
+  }
+
+  void set_alpha(double alpha) {
+    d_alpha = alpha;
+    d_beta = 1 - alpha;
+    d_beta_n[0] = d_beta;
+    for (int k = 1; k < GROUP; k++) {
+      d_beta_n[k] = d_beta_n[k - 1] * d_beta;
+    }
+  }
+  void set_gain(double gain) { d_gain = gain; }
+  void set_avg(double avg) { d_avg = avg; }
+  double avg() const { return d_avg; }
+
+  void agc(const float *in, float *out, int n) {
+    for (int done = 0; done < n; done += TILE) {
+      const int count = std::min(TILE, n - done);
+      for (int i = 0; i < count; i++) {
+        d_ms[i] = in[done + i] * in[done + i];
+      }
+      mean_squares(count);
+      gains(count);
+      for (int i = 0; i < count; i++) {
+        out[done + i] = in[done + i] * d_ms[i];
+      }
+    }
+  }
+
+  void agc(const std::complex<float> *in, std::complex<float> *out, int n) {
+    for (int done = 0; done < n; done += TILE) {
+      const int count = std::min(TILE, n - done);
+      const float *re_im = (const float *)&in[done];
+      for (int i = 0; i < count; i++) {
+        d_ms[i] = re_im[2 * i] * re_im[2 * i] + re_im[2 * i + 1] * re_im[2 * i + 1];
+      }
+      mean_squares(count);
+      gains(count);
+      float *scaled = (float *)&out[done];
+      for (int i = 0; i < count; i++) {
+        scaled[2 * i] = re_im[2 * i] * d_ms[i];
+        scaled[2 * i + 1] = re_im[2 * i + 1] * d_ms[i];
+      }
+    }
+  }
+
+private:
+  double d_alpha, d_beta, d_gain;
+  double d_avg;
+  // d_beta to the powers 1 to GROUP
+  double d_beta_n[GROUP];
+
+  // the squares of a tile's samples, then their mean squares, then their
+  // gains
+  float d_ms[TILE];
+
+  // The average of GROUP samples on is beta^GROUP times the one before them
+  // plus what they add, and what they add doesn't depend on the average, so
+  // it can be worked out while the average of the GROUP before is, and the
+  // average only waits on a multiply and an add every GROUP samples. The
+  // sums are rounded differently from a sample at a time, in the 16th digit.
+  void mean_squares(int count) {
+    const double alpha = d_alpha, beta = d_beta;
+    double avg = d_avg;
+    int i = 0;
+    for (; i + GROUP <= count; i += GROUP) {
+      double added[GROUP];
+      added[0] = alpha * d_ms[i];
+      for (int k = 1; k < GROUP; k++) {
+        added[k] = beta * added[k - 1] + alpha * d_ms[i + k];
+      }
+      for (int k = 0; k < GROUP; k++) {
+        d_ms[i + k] = (float)(d_beta_n[k] * avg + added[k]);
+      }
+      avg = d_beta_n[GROUP - 1] * avg + added[GROUP - 1];
+    }
+    for (; i < count; i++) {
+      avg = beta * avg + alpha * d_ms[i];
+      d_ms[i] = (float)avg;
+    }
+    d_avg = avg;
+  }
+
+  void gains(int count) {
+    const float gain = (float)d_gain;
+    int i = 0;
+#if defined(RMS_AGC_SSE)
+    const __m128 vgain = _mm_set1_ps(gain);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    const __m128 smallest = _mm_set1_ps(FLT_MIN);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+      const __m128 ms = _mm_loadu_ps(&d_ms[i]);
+      // FLT_MIN keeps a 0 or a denormal from making an inf the Newton step
+      // would turn into a NaN
+      const __m128 x = _mm_max_ps(ms, smallest);
+      __m128 y = _mm_rsqrt_ps(x);
+      y = _mm_mul_ps(_mm_mul_ps(half, y), _mm_sub_ps(three, _mm_mul_ps(x, _mm_mul_ps(y, y))));
+      const __m128 positive = _mm_cmpgt_ps(ms, zero);
+      y = _mm_or_ps(_mm_and_ps(positive, y), _mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+      _mm_storeu_ps(&d_ms[i], _mm_mul_ps(vgain, y));
+    }
+#elif defined(RMS_AGC_NEON)
+    const float32x4_t vgain = vdupq_n_f32(gain);
+    const float32x4_t smallest = vdupq_n_f32(FLT_MIN);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4) {
+      const float32x4_t ms = vld1q_f32(&d_ms[i]);
+      const float32x4_t x = vmaxq_f32(ms, smallest);
+      // NEON's estimate is good to 8 bits, it takes two steps
+      float32x4_t y = vrsqrteq_f32(x);
+      y = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(x, y), y));
+      y = vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(x, y), y));
+      y = vbslq_f32(vcgtq_f32(ms, vdupq_n_f32(0.0f)), y, one);
+      vst1q_f32(&d_ms[i], vmulq_f32(vgain, y));
+    }
+#endif
+    for (; i < count; i++) {
+      d_ms[i] = (d_ms[i] > 0) ? gain / sqrtf(std::max(d_ms[i], FLT_MIN)) : gain;
+    }
+  }
+};
+
+  } // namespace op25_repeater
+} // namespace gr
+
+#endif /* INCLUDED_OP25_REPEATER_RMS_AGC_KERNEL_H */
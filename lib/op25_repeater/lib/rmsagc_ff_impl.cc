@@ -27,7 +27,6 @@
 
 #include "rmsagc_ff_impl.h"
 #include <gnuradio/io_signature.h>
-#include <cmath>
 
 namespace gr {
     namespace op25_repeater {
@@ -42,10 +41,9 @@ namespace gr {
         rmsagc_ff_impl::rmsagc_ff_impl(double alpha, double k)
             : sync_block("rmsagc_ff",
                     io_signature::make(1, 1, sizeof(float)),
-                    io_signature::make(1, 1, sizeof(float)))
+                    io_signature::make(1, 1, sizeof(float))),
+              d_agc(alpha, k, 1.0)
         {
-            set_k(k);
-            set_alpha(alpha);
         }
 
         rmsagc_ff_impl::~rmsagc_ff_impl()
@@ -55,15 +53,14 @@ namespace gr {
         void
         rmsagc_ff_impl::set_alpha(double alpha)
         {
-            d_alpha = alpha;
-            d_beta = 1 - d_alpha;
-            d_avg = 1.0;
+            d_agc.set_alpha(alpha);
+            d_agc.set_avg(1.0);
         }
 
         void
         rmsagc_ff_impl::set_k(double k)
         {
-            d_gain = k;
+            d_agc.set_gain(k);
         }
 
         int
@@ -74,14 +71,7 @@ namespace gr {
             const float *in = (const float *)input_items[0];
             float *out = (float *)output_items[0];
 
-            for(int i = 0; i < noutput_items; i++) {
-                double mag_sqrd = in[i]*in[i];
-                d_avg = d_beta*d_avg + d_alpha*mag_sqrd;
-                if (d_avg > 0)
-                    out[i] = d_gain * in[i] / sqrt(d_avg);
-                else
-                    out[i] = d_gain * in[i];
-            }
+            d_agc.agc(in, out, noutput_items);
 
             return noutput_items;
         }
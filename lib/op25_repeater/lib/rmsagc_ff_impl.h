@@ -25,6 +25,7 @@
 #define INCLUDED_OP25_REPEATER_RMSAGC_FF_IMPL_H
 
 #include <op25_repeater/rmsagc_ff.h>
+#include "rms_agc_kernel.h"
 
 namespace gr {
     namespace op25_repeater {
@@ -36,7 +37,7 @@ namespace gr {
         class rmsagc_ff_impl : public rmsagc_ff
         {
             private:
-                double d_alpha, d_beta, d_avg, d_gain;
+                rms_agc_kernel d_agc;
 
             public:
                 rmsagc_ff_impl(double alpha  = 0.001, double k = 1.0);
@@ -158,15 +158,7 @@ static const uint32_t gly23127DecTbl[2048] = {
 	1048579, 69635, 141315, 16387, 1048578, 1048579, 1048579, 4456451, 69635, 69634, 524291, 69635, 1048579, 69635, 2113539, 163843 };
 
 uint32_t gly23127GetSyn (uint32_t pattern) {
-	uint32_t aux = 0x400000;
-
-	while(pattern & 0xFFFFF800) {
-		while ((aux & pattern) == 0) {
-			aux = aux >> 1;
-		}
-		pattern = pattern ^ (aux / 0x800 * 0xC75) ;//generator is C75
-	}
-	return pattern;
+	return golay_23_syndrome(pattern); //generator is C75, see op25_golay.h
 }
 
 uint32_t gly24128Dec (uint32_t n, size_t* errs) { //based on gly23127Dec
@@ -230,13 +230,8 @@ namespace gr{
         }
 
         void rx_smartnet::send_msg(const char* buf) {
-            std::string msg_str = std::string(buf,5);
-            if ((d_msgq_id >= 0) && (!d_msg_queue->full_p())) {
-
-                gr::message::sptr msg = gr::message::make_from_string(msg_str, get_msg_type(PROTOCOL_SMARTNET, M_SMARTNET_OSW), (d_msgq_id<<1), logts.get_ts());
-                if (!d_msg_queue->full_p())
-                    d_msg_queue->insert_tail(msg);
-            }
+            if (d_msgq_id >= 0)
+                d_msg_pool.send(d_msg_queue, (const uint8_t*)buf, 5, get_msg_type(PROTOCOL_SMARTNET, M_SMARTNET_OSW), (d_msgq_id<<1), logts.get_ts());
         }
 
     } // end namespace op25_repeater
@@ -35,6 +35,7 @@
 #include "frame_sync_magics.h"
 #include "op25_timer.h"
 #include "log_ts.h"
+#include "msg_pool.h"
 
 #include "rx_base.h"
 
@@ -85,6 +86,7 @@ namespace gr{
                 int d_debug;
                 int d_msgq_id;
                 gr::msg_queue::sptr d_msg_queue;
+                msg_pool d_msg_pool;
 
                 op25_timer sync_timer;
                 bool d_in_sync;
@@ -220,7 +220,7 @@ void rx_sync::ysf_sync(const uint8_t dibitbuf[], bool& ysf_fullrate, bool& unmut
 		fprintf(stderr, "%s ysf_sync: muting audio: dt: %d, rc: %d\n", logts.get(d_msgq_id), d_shift_reg, rc);
 }
 
-rx_sync::rx_sync(const char * options, log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr queue, std::array<std::deque<int16_t>, 2> &output_queue, bool d_soft_vocoder) :	// constructor
+rx_sync::rx_sync(const char * options, log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr queue, std::array<audio_ring, 2> &output_queue, bool d_soft_vocoder) :	// constructor
 	sync_timer(op25_timer(1000000)),
 	d_symbol_count(0),
 	d_sync_reg(0),
@@ -450,14 +450,10 @@ void rx_sync::codeword(const uint8_t* cw, const enum codeword_types codeword_typ
 			}
 		}
 	}
-	float snd;
-	for (int i=0; i < NSAMP_OUTPUT; i++) {
-		if (do_silence) {
-			snd = 0.0f;
-		} else {
-			snd = samp_buf[i];
-		}
-		output_queue[slot_id].push_back(snd);
+	if (do_silence) {
+		output_queue[slot_id].fill(NSAMP_OUTPUT, 0);
+	} else {
+		output_queue[slot_id].write(samp_buf, NSAMP_OUTPUT);
 	}
 	//output(samp_buf, slot_id);
 }
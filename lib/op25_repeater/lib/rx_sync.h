@@ -50,6 +50,7 @@
 #include "op25_imbe_frame.h"
 #include "software_imbe_decoder.h"
 #include "op25_audio.h"
+#include "audio_ring.h"
 #include "log_ts.h"
 
 #include "rx_base.h"
@@ -128,7 +129,7 @@ public:
 	int get_dst_id(int slot);
 	int get_cc(int slot);
 	std::pair<bool,long> get_terminated(int slot);
-	rx_sync(const char * options, log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr queue, std::array<std::deque<int16_t>, 2> &output_queue, bool d_soft_vocoder);
+	rx_sync(const char * options, log_ts& logger, int debug, int msgq_id, gr::msg_queue::sptr queue, std::array<audio_ring, 2> &output_queue, bool d_soft_vocoder);
 	~rx_sync();
 
 private:
@@ -168,7 +169,7 @@ private:
 	bool d_soft_vocoder;
 	software_imbe_decoder d_software_decoder[2];
 	imbe_vocoder d_imbe_vocoder[2];
-	std::deque<int16_t> d_output_queue[2];
+	audio_ring d_output_queue[2];
 	dmr_cai dmr;
 	int d_msgq_id;
 	gr::msg_queue::sptr d_msg_queue;
@@ -176,7 +177,7 @@ private:
 	int d_debug;
 	op25_audio d_audio;
 	log_ts& logts;
-	std::array<std::deque<int16_t>, 2> &output_queue;
+	std::array<audio_ring, 2> &output_queue;
 	int src_id[2];
 };
 
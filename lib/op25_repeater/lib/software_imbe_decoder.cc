@@ -26,6 +26,7 @@
 #include "op25_imbe_frame.h"
 #include "op25_golay.h"
 #include "op25_hamming.h"
+#include "op25_simd.h"
 
 #include <algorithm>
 #include <cstdio>
@@ -729,6 +730,72 @@ static const float PhzNz[57] = {
 	0.068775, 0.520336, 2.339119, -0.808328, 1.332154, 2.929768, -0.338316, 0.022767, -1.063795
 };
 
+// The twiddles exp(-j * pi * k / 128) of the 256 point real transform, the
+// 128 point FFT uses every other one, and its bit reversed order. They are
+// the same for every decoder, so they are built once.
+struct imbe_fft_plan {
+   float c[128];
+   float s[128];
+   uint8_t rev[128];
+
+   imbe_fft_plan() {
+      for(int k = 0; k < 128; k++) {
+         c[k] = cos(M_PI * k / 128);
+         s[k] = -sin(M_PI * k / 128);
+         int r = 0;
+         for(int b = 0; b < 7; b++) {
+            r |= ((k >> b) & 1) << (6 - b);
+         }
+         rev[k] = r;
+      }
+   }
+};
+
+static const imbe_fft_plan&
+fft_plan()
+{
+   static const imbe_fft_plan plan;
+   return plan;
+}
+
+// out[n] += amplitude * window[n] * cos(phase + step * n)
+//
+// The harmonic is a phasor turned by step each sample, kept in double so it
+// doesn't drift over a frame, instead of a cos() per sample.
+static void
+add_harmonic(float out[], const float window[], float amplitude, double phase, double step, int count)
+{
+   double Ci = cos(phase), Cq = sin(phase);
+   const double Di = cos(step), Dq = sin(step);
+   for(int n = 0; n < count; n++) {
+      out[n] += amplitude * window[n] * Ci;
+      double t = Ci;
+      Ci = t * Di - Cq * Dq;
+      Cq = t * Dq + Cq * Di;
+   }
+}
+
+// out[n] += (amplitude + slope * n) * cos(phase + (step + sweep * n) * n)
+//
+// The phase of a fine transition is quadratic, so the step the phasor is
+// turned by is itself turned by 2 * sweep each sample.
+static void
+add_chirp(float out[], float amplitude, float slope, double phase, double step, double sweep, int count)
+{
+   double Ci = cos(phase), Cq = sin(phase);
+   double Di = cos(step + sweep), Dq = sin(step + sweep);
+   const double DDi = cos(2 * sweep), DDq = sin(2 * sweep);
+   for(int n = 0; n < count; n++) {
+      out[n] += (amplitude + slope * n) * Ci;
+      double t = Ci;
+      Ci = t * Di - Cq * Dq;
+      Cq = t * Dq + Cq * Di;
+      t = Di;
+      Di = t * DDi - Dq * DDq;
+      Dq = t * DDq + Dq * DDi;
+   }
+}
+
 software_imbe_decoder::software_imbe_decoder()
 {
    int i,j;
@@ -744,9 +811,15 @@ software_imbe_decoder::software_imbe_decoder()
          log2Mu[i][j] = 0.0;
       }
    }
+   // decode_spectral_amplitudes() makes the frame before the first one 30
+   // harmonics long, so the first frame reads these before they are set
+   Oldw0 = 0.0;
    for(i=0; i < 57; i++) {
       for(j=0; j < 2; j++) {
          phi[i][j] = 0.0;
+         M[i][j] = 0.0;
+         Mu[i][j] = 0.0;
+         vee[i][j] = 0;
       }
    }
    for(i=0; i < 256; i++) {
@@ -756,6 +829,13 @@ software_imbe_decoder::software_imbe_decoder()
    for(i=1; i < 211; i++) {
       u[i] = next_u(u[i-1]);
    }
+   synth_mode = SYNTH_FAST;
+}
+
+void
+software_imbe_decoder::set_synth_mode(synth_mode_t mode)
+{
+   synth_mode = mode;
 }
 
 uint32_t
@@ -860,6 +940,41 @@ software_imbe_decoder::fft(float REX[], float IMX[])
 
 }
 
+// The same transform as fft(), with the twiddles and the bit reversal taken
+// from the plan instead of worked out as it goes.
+OP25_KERNEL
+void
+software_imbe_decoder::fft_table(float REX[], float IMX[])
+{
+   const imbe_fft_plan& plan = fft_plan();
+   int I, J, K, H, KpH;
+   float tmp_f;
+   float l_Ui, l_Uq, Ti, Xi, Tq, Xq;
+
+   for(I = 1; I < 127; I++) {
+      J = plan.rev[I];
+#define SWAP(x,y) tmp_f=x;x=y;y=tmp_f
+      if(I < J) { SWAP(REX[J], REX[I]); SWAP(IMX[J], IMX[I]); }
+#undef SWAP
+   }
+
+   for(H = 1; H < 128; H = H * 2) {
+      for(J = 0; J < H; J++) {
+         l_Ui = plan.c[J * (128 / H)];
+         l_Uq = plan.s[J * (128 / H)];
+         for(K = J; K < 128; K += H * 2) {
+            KpH = K + H;
+
+            Ti = REX[KpH] * l_Ui - IMX[KpH] * l_Uq; Xi = REX[K];
+            Tq = REX[KpH] * l_Uq + IMX[KpH] * l_Ui; Xq = IMX[K];
+
+            REX[KpH] = Xi - Ti; REX[K] = Xi + Ti;
+            IMX[KpH] = Xq - Tq; IMX[K] = Xq + Tq;
+         }
+      }
+   }
+}
+
 void
 software_imbe_decoder::decode_fullrate(int16_t samples[IMBE_SAMPLES_PER_FRAME], uint32_t u0, uint32_t u1, uint32_t u2, uint32_t u3, uint32_t u4, uint32_t u5, uint32_t u6, uint32_t u7, uint32_t E0, uint32_t ET)
 {
@@ -1301,6 +1416,7 @@ software_imbe_decoder::enhance_spectral_amplitudes(float& SE)
 
 }
 
+OP25_KERNEL
 void
 software_imbe_decoder::ifft(float FDi[], float FDq[], float TD[]) // ToDo: replace "real IFFT" with fftw3 IFFT proc!
 {
@@ -1326,7 +1442,11 @@ software_imbe_decoder::ifft(float FDi[], float FDq[], float TD[]) // ToDo: repla
       Aq[J] = FDi[H - 1] - FDq[H - 1];
    }
 
-   fft(Ai, Aq);
+   if(synth_mode == SYNTH_FAST) {
+      fft_table(Ai, Aq);
+   } else {
+      fft(Ai, Aq);
+   }
 
    for(I = 1; I <= 63; I++) {
       J = 128 - I;    //127 to 65
@@ -1354,10 +1474,12 @@ software_imbe_decoder::ifft(float FDi[], float FDq[], float TD[]) // ToDo: repla
    FDi[0] = Ai[0]   ; //c (new)
    FDq[0] = 0       ; //d
 
+   const imbe_fft_plan& plan = fft_plan();
    l_Ui = 1; l_Uq = 0;
    Si = cos(M_PI / 128); Sq = -sin(M_PI / 128);
    for(I = 0; I <= 127; I++) {
       J = I + 128  ;   //128 TO 255
+      if(synth_mode == SYNTH_FAST) { l_Ui = plan.c[I]; l_Uq = plan.s[I]; }
 
       Ti = FDi[J] * l_Ui - FDq[J] * l_Uq; Xi = FDi[I];
       Tq = FDi[J] * l_Uq + FDq[J] * l_Ui; Xq = FDq[I];
@@ -1481,12 +1603,16 @@ software_imbe_decoder::rearrange(uint32_t u0, uint32_t u1, uint32_t u2, uint32_t
    return K;
 }
 
+OP25_KERNEL
 void
 software_imbe_decoder::synth_unvoiced()
 {
    float Uwi[256];
    float Uwq[256];
    float uw[256];
+   float Si[256];
+   float Sq[256];
+   bool have_spectrum = false;
 
    float Tmp;
 
@@ -1515,14 +1641,17 @@ software_imbe_decoder::synth_unvoiced()
          }
       } else {
          Luv = Luv + 1;
-         for(em = al; em <= bl - 1; em++) {
-            Uwi[em] = 0;
-            Uwq[em] = 0;
-            for (en = 0; en < 211; en++) {
-               float exp = -0.0078125 * M_PI * em * (en - 105);
-               Uwi[em] = Uwi[em] + u[en] * ws[en] * cos(exp);
-               Uwq[em] = Uwq[em] + u[en] * ws[en] * sin(exp);
+         if(synth_mode == SYNTH_FAST) {
+            // one FFT gives the bins of all the unvoiced bands
+            if(!have_spectrum) {
+               unvoiced_spectrum_fft(Si, Sq);
+               have_spectrum = true;
             }
+            for(em = al; em <= bl - 1; em++) {
+               Uwi[em] = Si[em]; Uwq[em] = Sq[em];
+            }
+         } else {
+            unvoiced_spectrum_dft(al, bl, Uwi, Uwq);
          }
          //precompute Tmp = <most of big hairy equation>
          Tmp = 0;
@@ -1567,6 +1696,65 @@ software_imbe_decoder::synth_unvoiced()
    }
 }
 
+void
+software_imbe_decoder::unvoiced_spectrum_dft(int al, int bl, float Uwi[], float Uwq[])
+{
+   int em, en;
+   for(em = al; em <= bl - 1; em++) {
+      Uwi[em] = 0;
+      Uwq[em] = 0;
+      for (en = 0; en < 211; en++) {
+         float exp = -0.0078125 * M_PI * em * (en - 105);
+         Uwi[em] = Uwi[em] + u[en] * ws[en] * cos(exp);
+         Uwq[em] = Uwq[em] + u[en] * ws[en] * sin(exp);
+      }
+   }
+}
+
+// All 256 bins of the unvoiced_spectrum_dft() transform of the windowed noise.
+// The noise is centred on sample 0, so the (en - 105) shift is a rotation of
+// the input, and as it's real the 256 point transform is a 128 point complex
+// FFT of the even and odd samples and one pass to split them apart again.
+OP25_KERNEL
+void
+software_imbe_decoder::unvoiced_spectrum_fft(float Uwi[], float Uwq[])
+{
+   const imbe_fft_plan& plan = fft_plan();
+   float y[256];
+   float Zi[128];
+   float Zq[128];
+   int en, em;
+
+   for(en = 0; en < 256; en++) {
+      y[en] = 0;
+   }
+   for(en = 0; en < 211; en++) {
+      y[(en - 105) & 255] = u[en] * ws[en];
+   }
+   for(en = 0; en < 128; en++) {
+      Zi[en] = y[2 * en];
+      Zq[en] = y[2 * en + 1];
+   }
+
+   fft_table(Zi, Zq);
+
+   for(em = 0; em <= 128; em++) {
+      float ai = Zi[em & 127], aq = Zq[em & 127];
+      float bi = Zi[(128 - em) & 127], bq = Zq[(128 - em) & 127];
+      float Ei = (ai + bi) / 2, Eq = (aq - bq) / 2;
+      float Oi = (aq + bq) / 2, Oq = -(ai - bi) / 2;
+      float Wi = (em < 128) ? plan.c[em] : -1;
+      float Wq = (em < 128) ? plan.s[em] : 0;
+      Uwi[em] = Ei + Wi * Oi - Wq * Oq;
+      Uwq[em] = Eq + Wi * Oq + Wq * Oi;
+   }
+   for(em = 129; em < 256; em++) {
+      Uwi[em] = Uwi[256 - em];
+      Uwq[em] = -Uwq[256 - em];
+   }
+}
+
+OP25_KERNEL
 void
 software_imbe_decoder::synth_voiced()
 {
@@ -1624,10 +1812,19 @@ software_imbe_decoder::synth_voiced()
                THa = (Oldw0 * (float)ell + Dwl);
                THb = (w0 - Oldw0) * ell * .003125;
                Mb = .00625 *(MNew - MOld);
+               if(synth_mode == SYNTH_FAST) {
+                  add_chirp(sv, MOld, Mb, phi[ell][ Old], THa, THb, 160);
+                  continue;
+               }
                for(en = 0; en <= 159; en++) {
                   sv[en] = sv[en] +(MOld + en * Mb) * cos(phi[ell][ Old] +(THa + THb * en) * en);
                }
             } else { // (coarse transition)
+               if(synth_mode == SYNTH_FAST) {
+                  add_harmonic(sv, ws + 105, MOld, phi[ell][ Old], Oldw0 * ell, 106);
+                  add_harmonic(sv + 56, ws + 1, MNew, w0 * -104 * ell + phi[ell][ New], w0 * ell, 104);
+                  continue;
+               }
                for(en = 0; en <= 55; en++) {
                   sv[en] = sv[en] + ws[en+105] * MOld * cos(Oldw0 * en * ell + phi[ell] [ Old]);
                }
@@ -1639,13 +1836,17 @@ software_imbe_decoder::synth_voiced()
                   sv[en] = sv[en] + ws[en-55] * MNew * cos(w0 *(en - 160) * ell + phi[ell][ New]);
                }
             }
+         } else if(synth_mode == SYNTH_FAST) {
+            add_harmonic(sv + 56, ws + 1, MNew, w0 * -104 * ell + phi[ell][ New], w0 * ell, 104);
          } else {
             for(en = 56; en <= 159; en++) {
                sv[en] = sv[en] + ws[en-55] * MNew * cos(w0 *(en - 160) * ell + phi[ell][ New]);
             }
          }
       } else {
-         if( vee[ell][Old]) {
+         if( vee[ell][Old] && synth_mode == SYNTH_FAST) {
+            add_harmonic(sv, ws + 105, MOld, phi[ell][ Old], Oldw0 * ell, 106);
+         } else if( vee[ell][Old]) {
             for(en = 0; en <= 105; en++) {
                sv[en] = sv[en] + ws[en+105] * MOld * cos(Oldw0 * en * ell + phi[ell][ Old]);
             }
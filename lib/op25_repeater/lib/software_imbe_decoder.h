@@ -34,6 +34,18 @@
 class software_imbe_decoder : public imbe_decoder {
 public:
 
+	/**
+	 * How the voiced and unvoiced speech is synthesized. SYNTH_FAST, the
+	 * default, takes the unvoiced spectrum from one table driven FFT and
+	 * runs the voiced harmonics as an oscillator bank. SYNTH_REFERENCE is
+	 * the original per bin DFT and per sample cos(), kept to check the
+	 * fast one against.
+	 */
+	enum synth_mode_t {
+		SYNTH_REFERENCE,
+		SYNTH_FAST
+	};
+
 	/**
 	 * Default constructor for the software_imbe_decoder.
 	 */
@@ -54,8 +66,12 @@ public:
 	void decode_fullrate(int16_t samples[IMBE_SAMPLES_PER_FRAME], uint32_t u0, uint32_t u1, uint32_t u2, uint32_t u3, uint32_t u4, uint32_t u5, uint32_t u6, uint32_t u7, uint32_t E0, uint32_t ET);
 	void decode_tap(int16_t samples[IMBE_SAMPLES_PER_FRAME], int _L, int _K, float _w0, const int * _v, const float * _mu);
 	void decode_tone(int16_t samples[IMBE_SAMPLES_PER_FRAME], int _ID, int _AD, int * _n);
+
+	void set_synth_mode(synth_mode_t mode);
 private:
 
+	synth_mode_t synth_mode;
+
 	//NOTE: Single-letter variable names are upper case only; Lower
 	//				  case if needed is spelled. e.g. L, ell
 
@@ -94,11 +110,14 @@ private:
 	void decode_vuv(int );
 	void adaptive_smoothing(float, float );
 	void fft(float i[], float q[]);
+	static void fft_table(float i[], float q[]);
 	void enhance_spectral_amplitudes(float&);
 	void ifft(float i[], float q[], float[]);
 	uint16_t rearrange(uint32_t u0, uint32_t u1, uint32_t u2, uint32_t u3, uint32_t u4, uint32_t u5, uint32_t u6, uint32_t u7);
 	void synth_unvoiced();
 	void synth_voiced();
+	void unvoiced_spectrum_dft(int al, int bl, float Uwi[], float Uwq[]);
+	void unvoiced_spectrum_fft(float Uwi[], float Uwq[]);
 	void unpack(uint8_t *buf, uint32_t& u0, uint32_t& u1, uint32_t& u2, uint32_t& u3, uint32_t& u4, uint32_t& u5, uint32_t& u6, uint32_t& u7, uint32_t& E0, uint32_t& ET);
 	int repeat_last();
 };
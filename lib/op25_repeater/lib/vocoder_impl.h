@@ -30,6 +30,7 @@
 #include <deque>
 
 #include "op25_audio.h"
+#include "audio_ring.h"
 #include "p25p1_voice_encode.h"
 #include "p25p1_voice_decode.h"
 
@@ -65,7 +66,7 @@ namespace gr {
   private:
 
 	std::deque<uint8_t> output_queue;
-	std::deque<int16_t> output_queue_decode;
+	audio_ring output_queue_decode;
 	int opt_udp_port;
 	bool opt_encode_flag;
         op25_audio op25audio;
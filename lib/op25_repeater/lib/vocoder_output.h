@@ -0,0 +1,102 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_OP25_REPEATER_VOCODER_OUTPUT_H
+#define INCLUDED_OP25_REPEATER_VOCODER_OUTPUT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+
+#include "audio_ring.h"
+#include "imbe_decoder.h"
+#include "software_imbe_decoder.h"
+#include "imbe_vocoder/imbe_vocoder.h"
+
+// One frame for the vocoder_service to decode, with a copy of its
+// parameters and room for its audio
+struct vocoder_frame {
+	enum kind_t {
+		FULLRATE,     // the 8 IMBE codewords of a phase 1 voice frame
+		TAP           // the model parameters of a phase 2 AMBE frame
+	};
+
+	kind_t kind;
+	software_imbe_decoder *software_decoder;  // one of these is set
+	imbe_vocoder *vocoder;
+
+	uint32_t u[8];
+	uint32_t E0;
+	uint32_t ET;
+
+	int L;
+	int K;
+	float w0;
+	int Vl[56];
+	float Ml[56];
+
+	int16_t samples[IMBE_SAMPLES_PER_FRAME];
+	std::atomic<bool> done;
+
+	void decode();
+};
+
+/*
+ * vocoder_output
+ *   The frames a frame assembler has handed to the vocoder_service, and
+ *   where their audio goes in its output queue.
+ *
+ * queue_fullrate() / queue_tap() put IMBE_SAMPLES_PER_FRAME samples of
+ * silence at the end of the queue to hold the frame's place, and ready()
+ * copies the audio of the frames that are done over them. Only the samples
+ * up to the first frame that isn't done can go out. The owner keeps using
+ * the queue as before: anything pushed after a queued frame stays behind it.
+ *
+ * When the service isn't running nothing is queued, the queue functions wait
+ * for the frames that already were and return false, and the caller decodes
+ * the frame itself. The destructor waits for them too, so it has to run
+ * before the decoders it points at are destroyed.
+ */
+class vocoder_output {
+public:
+	vocoder_output(audio_ring &queue);
+	~vocoder_output();
+
+	bool queue_fullrate(software_imbe_decoder *software_decoder, imbe_vocoder *vocoder, const uint32_t u[8], uint32_t E0, uint32_t ET);
+	bool queue_tap(software_imbe_decoder *software_decoder, imbe_vocoder *vocoder, int L, int K, float w0, const int *Vl, const float *Ml);
+
+	size_t ready();
+	void consumed(size_t count);
+	inline bool pending() const { return !frames.empty(); }
+	void wait();
+
+private:
+	struct pending_frame {
+		vocoder_frame *frame;
+		uint64_t position;    // of its first sample, counted from the start of the queue
+	};
+
+	bool queue(vocoder_frame *frame);
+
+	audio_ring &output_queue;
+	std::deque<pending_frame> frames;
+	uint64_t consumed_samples;
+	unsigned int id;
+};
+
+#endif /* INCLUDED_OP25_REPEATER_VOCODER_OUTPUT_H */
@@ -0,0 +1,266 @@
+/* -*- c++ -*- */
+/*
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../include/op25_repeater/vocoder_service.h"
+#include "vocoder_output.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <boost/log/trivial.hpp>
+
+namespace {
+
+struct vocoder_worker {
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<vocoder_frame *> frames;
+	bool stopping;
+	std::thread thread;
+};
+
+std::mutex pool_mutex;
+std::vector<vocoder_worker *> workers;
+std::atomic<unsigned int> next_output_id(0);
+
+std::atomic<long> frames_decoded(0);
+std::atomic<long> batches(0);
+std::atomic<long> busy_ns(0);
+long last_busy_ns = 0;
+std::chrono::steady_clock::time_point last_stats;
+
+void run_worker(vocoder_worker *worker) {
+	std::vector<vocoder_frame *> batch;
+	std::unique_lock<std::mutex> lock(worker->mutex);
+
+	while (true) {
+		worker->wake.wait(lock, [worker] { return worker->stopping || !worker->frames.empty(); });
+		// The frames already queued are decoded before it stops
+		if (worker->frames.empty()) {
+			return;
+		}
+		batch.swap(worker->frames);
+		lock.unlock();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < batch.size(); i++) {
+			batch[i]->decode();
+			batch[i]->done.store(true, std::memory_order_release);
+		}
+		busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		frames_decoded += batch.size();
+		batches++;
+		batch.clear();
+
+		lock.lock();
+	}
+}
+
+// Hands the frame to the worker for its output, false if there are none
+bool submit(unsigned int output_id, vocoder_frame *frame) {
+	std::lock_guard<std::mutex> pool_lock(pool_mutex);
+	if (workers.empty()) {
+		return false;
+	}
+	vocoder_worker *worker = workers[output_id % workers.size()];
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->frames.push_back(frame);
+	}
+	worker->wake.notify_one();
+	return true;
+}
+
+} // namespace
+
+void vocoder_frame::decode() {
+	switch (kind) {
+	case FULLRATE:
+		if (software_decoder) {
+			software_decoder->decode_fullrate(samples, u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7], E0, ET);
+		} else {
+			int16_t frame_vector[8];
+			for (int i = 0; i < 8; i++) {
+				frame_vector[i] = u[i];
+			}
+			frame_vector[7] >>= 1;
+			vocoder->imbe_decode(frame_vector, samples);
+		}
+		break;
+	case TAP:
+		if (software_decoder) {
+			software_decoder->decode_tap(samples, L, K, w0, Vl, Ml);
+		} else {
+			vocoder->decode_tap(samples, L, w0, Vl, Ml);
+		}
+		break;
+	}
+}
+
+vocoder_output::vocoder_output(audio_ring &queue)
+	: output_queue(queue),
+	  consumed_samples(0),
+	  id(next_output_id++) {
+}
+
+vocoder_output::~vocoder_output() {
+	wait();
+	while (!frames.empty()) {
+		delete frames.front().frame;
+		frames.pop_front();
+	}
+}
+
+bool vocoder_output::queue(vocoder_frame *frame) {
+	frame->done.store(false, std::memory_order_relaxed);
+	if (!submit(id, frame)) {
+		delete frame;
+		// The caller decodes this one itself, with the decoder the workers may still be using
+		wait();
+		return false;
+	}
+	pending_frame pending;
+	pending.frame = frame;
+	pending.position = consumed_samples + output_queue.size();
+	frames.push_back(pending);
+	output_queue.fill(IMBE_SAMPLES_PER_FRAME, 0);
+	return true;
+}
+
+bool vocoder_output::queue_fullrate(software_imbe_decoder *software_decoder, imbe_vocoder *vocoder, const uint32_t u[8], uint32_t E0, uint32_t ET) {
+	vocoder_frame *frame = new vocoder_frame();
+	frame->kind = vocoder_frame::FULLRATE;
+	frame->software_decoder = software_decoder;
+	frame->vocoder = vocoder;
+	memcpy(frame->u, u, sizeof(frame->u));
+	frame->E0 = E0;
+	frame->ET = ET;
+	return queue(frame);
+}
+
+bool vocoder_output::queue_tap(software_imbe_decoder *software_decoder, imbe_vocoder *vocoder, int L, int K, float w0, const int *Vl, const float *Ml) {
+	vocoder_frame *frame = new vocoder_frame();
+	frame->kind = vocoder_frame::TAP;
+	frame->software_decoder = software_decoder;
+	frame->vocoder = vocoder;
+	frame->L = L;
+	frame->K = K;
+	frame->w0 = w0;
+	memcpy(frame->Vl, Vl, L * sizeof(int));
+	memcpy(frame->Ml, Ml, L * sizeof(float));
+	return queue(frame);
+}
+
+size_t vocoder_output::ready() {
+	while (!frames.empty() && frames.front().frame->done.load(std::memory_order_acquire)) {
+		pending_frame &pending = frames.front();
+		output_queue.overwrite(pending.position - consumed_samples, pending.frame->samples, IMBE_SAMPLES_PER_FRAME);
+		delete pending.frame;
+		frames.pop_front();
+	}
+	if (frames.empty()) {
+		return output_queue.size();
+	}
+	return frames.front().position - consumed_samples;
+}
+
+void vocoder_output::consumed(size_t count) {
+	consumed_samples += count;
+}
+
+void vocoder_output::wait() {
+	for (size_t i = 0; i < frames.size(); i++) {
+		while (!frames[i].frame->done.load(std::memory_order_acquire)) {
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+}
+
+namespace gr {
+  namespace op25_repeater {
+
+    void vocoder_service::start(int threads) {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      if (!workers.empty() || (threads < 1)) {
+        return;
+      }
+      for (int i = 0; i < threads; i++) {
+        vocoder_worker *worker = new vocoder_worker();
+        worker->stopping = false;
+        worker->thread = std::thread(run_worker, worker);
+        workers.push_back(worker);
+      }
+      last_busy_ns = busy_ns.load();
+      last_stats = std::chrono::steady_clock::now();
+      BOOST_LOG_TRIVIAL(info) << "Vocoder Service started - Threads: " << threads;
+    }
+
+    void vocoder_service::stop() {
+      std::vector<vocoder_worker *> stopping;
+      {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping.swap(workers);
+      }
+      // Nothing more is queued from here on, the workers finish what they have
+      for (size_t i = 0; i < stopping.size(); i++) {
+        {
+          std::lock_guard<std::mutex> lock(stopping[i]->mutex);
+          stopping[i]->stopping = true;
+        }
+        stopping[i]->wake.notify_one();
+      }
+      for (size_t i = 0; i < stopping.size(); i++) {
+        stopping[i]->thread.join();
+        delete stopping[i];
+      }
+    }
+
+    bool vocoder_service::running() {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      return !workers.empty();
+    }
+
+    void vocoder_service::print_stats() {
+      size_t threads;
+      double elapsed;
+      long busy;
+      {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        threads = workers.size();
+        if (threads == 0) {
+          return;
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        elapsed = std::chrono::duration<double, std::nano>(now - last_stats).count();
+        busy = busy_ns.load() - last_busy_ns;
+        last_busy_ns += busy;
+        last_stats = now;
+      }
+      long total = frames_decoded.load();
+      long total_batches = batches.load();
+      BOOST_LOG_TRIVIAL(info) << "Vocoder Service - Threads: " << threads << " Frames: " << total << " Batches: " << total_batches
+                              << " Frames per Batch: " << ((total_batches > 0) ? (double)total / total_batches : 0)
+                              << " Load: " << ((elapsed > 0) ? 100.0 * busy / (elapsed * threads) : 0) << "%";
+    }
+
+  } // namespace op25_repeater
+} // namespace gr
@@ -4,6 +4,7 @@
 
 #include "../../trunk-recorder/call_concluder/call_concluder.h"
 #include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/upload_engine.h"
 #include "../trunk-recorder/gr_blocks/decoder_wrapper.h"
 #include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
 #include <boost/foreach.hpp>
@@ -31,14 +32,11 @@ struct Broadcastify_Uploader_Data {
   bool ssl_verify_disable;
 };
 
-boost::mutex curl_share_mutex;
-
 class Broadcastify_Uploader : public Plugin_Api {
   // float aggr_;
   // my_plugin_aggregator() : aggr_(0) {}
   Broadcastify_Uploader_Data data;
-  CURLSH *curl_share;
-  long curl_dns_ttl;
+  Upload_Engine *upload_engine;
   std::string plugin_name;
 
 private:
@@ -159,7 +157,7 @@ private:
   }
 
 public:
-  Broadcastify_Uploader() : curl_share(NULL), curl_dns_ttl(300) {}
+  Broadcastify_Uploader() : upload_engine(NULL) {}
 
   Broadcastify_System_Key *get_system(std::string short_name) {
     for (std::vector<Broadcastify_System_Key>::iterator it = data.keys.begin(); it != data.keys.end(); ++it) {
@@ -195,18 +193,24 @@ public:
     return size * nmemb;
   }
 
-  CURLcode upload_audio_file(std::string converted, std::string url) {
+  CURLcode upload_audio_file(std::string converted, std::shared_ptr<const std::string> converted_audio, std::string url) {
     struct stat file_info;
+    FILE *audio = NULL;
+    Upload_Engine::Audio_Reader reader;
 
-    /* get the file size of the local file */
-    stat(converted.c_str(), &file_info);
+    if (converted_audio) {
+      reader.audio = converted_audio;
+    } else {
+      /* get the file size of the local file */
+      stat(converted.c_str(), &file_info);
 
-    FILE *audio = fopen(converted.c_str(), "rb");
+      audio = fopen(converted.c_str(), "rb");
 
-    // Make sure we have something to read.
-    if (!audio) {
-      BOOST_LOG_TRIVIAL(info) << "Error opening file " << converted;
-      return CURLE_READ_ERROR;
+      // Make sure we have something to read.
+      if (!audio) {
+        BOOST_LOG_TRIVIAL(info) << "Error opening file " << converted;
+        return CURLE_READ_ERROR;
+      }
     }
 
     CURL *curl;
@@ -228,13 +232,18 @@ public:
        name, not only a directory */
       curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
-      /* now specify which file to upload */
-      curl_easy_setopt(curl, CURLOPT_READDATA, audio);
+      if (audio) {
+        /* now specify which file to upload */
+        curl_easy_setopt(curl, CURLOPT_READDATA, audio);
 
-      /* provide the size of the upload, we specially typecast the value
-       to curl_off_t since we must be sure to use the correct data size */
-      curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
-                       (curl_off_t)file_info.st_size);
+        /* provide the size of the upload, we specially typecast the value
+         to curl_off_t since we must be sure to use the correct data size */
+        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE,
+                         (curl_off_t)file_info.st_size);
+      } else {
+        /* send the audio the Call Concluder already read */
+        Upload_Engine::set_upload_audio(curl, &reader);
+      }
 
       headers = curl_slist_append(headers, "Content-Type: audio/aac");
       /* Expect: 100-continue is not wanted */
@@ -244,27 +253,23 @@ public:
 
       curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
-      curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
-      curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, curl_dns_ttl);
-
       /* Perform the request, res will get the return code */
-      res = curl_easy_perform(curl);
+      res = upload_engine->perform(curl).code;
 
       /* always cleanup */
       curl_slist_free_all(headers);
       curl_easy_cleanup(curl);
     }
 
-    fclose(audio);
+    if (audio) {
+      fclose(audio);
+    }
 
     return res;
   }
 
-  int upload(Call_Data_t call_info) {
+  int upload(const Call_Data_t &call_info) {
 
-    CURLMcode res;
-    CURLM *multi_handle;
-    int still_running = 0;
     std::string response_buffer;
 
     Broadcastify_System_Key *sys = get_system(call_info.short_name);
@@ -301,7 +306,7 @@ public:
     mime = curl_mime_init(curl);
 
     part = curl_mime_addpart(mime);
-    curl_mime_data(part, call_info.call_json.dump().c_str(), CURL_ZERO_TERMINATED);
+    curl_mime_data(part, call_info.call_json ? call_info.call_json->c_str() : "{}", CURL_ZERO_TERMINATED);
     curl_mime_filename(part, "call_meta.json");
     curl_mime_type(part, "application/json");
     curl_mime_name(part, "metadata");
@@ -318,11 +323,9 @@ public:
     curl_mime_data(part, api_key.c_str(), CURL_ZERO_TERMINATED);
     curl_mime_name(part, "apiKey");
 
-    multi_handle = curl_multi_init();
-
     /* initialize custom header list (stating that Expect: 100-continue is not wanted */
     headerlist = curl_slist_append(headerlist, "Expect:");
-    if (curl && multi_handle) {
+    if (curl) {
       /* what URL that receives this POST */
       curl_easy_setopt(curl, CURLOPT_URL, data.bcfy_calls_server.c_str());
 
@@ -333,89 +336,14 @@ public:
       curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
       curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buffer);
 
-      curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
-      curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, curl_dns_ttl);
-
       // broadcastify seems to make a habit out of letting their ssl certs expire
       if (this->data.ssl_verify_disable) {
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
       }
 
-      curl_multi_add_handle(multi_handle, curl);
-
-      curl_multi_perform(multi_handle, &still_running);
-
-      while (still_running) {
-        struct timeval timeout;
-        int rc;       /* select() return code */
-        CURLMcode mc; /* curl_multi_fdset() return code */
-
-        fd_set fdread;
-        fd_set fdwrite;
-        fd_set fdexcep;
-        int maxfd = -1;
-
-        long curl_timeo = -1;
-
-        FD_ZERO(&fdread);
-        FD_ZERO(&fdwrite);
-        FD_ZERO(&fdexcep);
-
-        /* set a suitable timeout to play around with */
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-
-        curl_multi_timeout(multi_handle, &curl_timeo);
-        if (curl_timeo >= 0) {
-          timeout.tv_sec = curl_timeo / 1000;
-          if (timeout.tv_sec > 1)
-            timeout.tv_sec = 1;
-          else
-            timeout.tv_usec = (curl_timeo % 1000) * 1000;
-        }
-
-        /* get file descriptors from the transfers */
-        mc = curl_multi_fdset(multi_handle, &fdread, &fdwrite, &fdexcep, &maxfd);
-
-        if (mc != CURLM_OK) {
-          fprintf(stderr, "curl_multi_fdset() failed, code %d.\n", mc);
-          break;
-        }
-
-        /* On success the value of maxfd is guaranteed to be >= -1. We call
-         select(maxfd + 1, ...); specially in case of (maxfd == -1) there are
-         no fds ready yet so we call select(0, ...) --or Sleep() on Windows--
-         to sleep 100ms, which is the minimum suggested value in the
-         curl_multi_fdset() doc. */
-
-        if (maxfd == -1) {
-          /* Portable sleep for platforms other than Windows. */
-          struct timeval wait = {0, 100 * 1000}; /* 100ms */
-          rc = select(0, NULL, NULL, NULL, &wait);
-        } else {
-          /* Note that on some platforms 'timeout' may be modified by select().
-           If you need access to the original value save a copy beforehand. */
-          rc = select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-        }
-
-        switch (rc) {
-        case -1:
-          /* select error */
-          break;
-        case 0:
-        default:
-          /* timeout or readable/writable sockets */
-          curl_multi_perform(multi_handle, &still_running);
-          break;
-        }
-      }
-
-      // Grab HTTP status BEFORE cleaning up easy handle (important!)
-      long response_code = 0;
-      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-
-      res = curl_multi_cleanup(multi_handle);
+      Upload_Engine::Result res = upload_engine->perform(curl);
+      long response_code = res.response_code;
 
       /* always cleanup */
       curl_easy_cleanup(curl);
@@ -428,7 +356,7 @@ public:
 
       std::string loghdr = log_header(call_info.short_name,call_info.call_num,call_info.talkgroup_display,call_info.freq);
 
-      if (res != CURLM_OK || response_code != 200) {
+      if (res.code != CURLE_OK || response_code != 200) {
         BOOST_LOG_TRIVIAL(error) << loghdr << this->plugin_name << " Metadata Upload Error: " << response_buffer;
         return 1;
       }
@@ -457,7 +385,7 @@ public:
         return 1;
       }
 
-      CURLcode audio_error = this->upload_audio_file(call_info.converted, message);
+      CURLcode audio_error = this->upload_audio_file(call_info.converted, call_info.converted_audio, message);
 
       if (audio_error) {
         BOOST_LOG_TRIVIAL(error) << loghdr << this->plugin_name << " Audio Upload Error: " << curl_easy_strerror(audio_error);
@@ -474,10 +402,14 @@ public:
     }
   }
 
-  int call_end(Call_Data_t call_info) {
+  int call_end_view(const Call_Data_t &call_info) {
     return upload(call_info);
   }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_CALL_END;
+  }
+
   int parse_config(json config_data) {
     // Extract plugin name from config, with fallback for default internal plugin name
     std::string config_name = config_data.value("name", "broadcastify_uploader");
@@ -557,23 +489,12 @@ public:
       return 1;
     }
 
-    // Initialize shared curl cache to reduce DNS lookups (5 min TTL)
-    curl_share = curl_share_init();
-    curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_lock_cb);
-    curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_unlock_cb);
-    curl_dns_ttl = 300;
-
     return 0;
   }
 
-  // curl callbacks
-  static void curl_lock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.lock();
-  }
-
-  static void curl_unlock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.unlock();
+  int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) {
+    upload_engine = config->upload_engine;
+    return Plugin_Api::init(config, sources, systems);
   }
 
   /*
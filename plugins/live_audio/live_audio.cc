@@ -0,0 +1,655 @@
+#include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/recorders/recorder.h"
+#include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
+#include <boost/log/trivial.hpp>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <opus.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Live_Audio
+ *   Serves the audio of each talkgroup as it is recorded, as a live HLS
+ *   stream, from a thread of its own.
+ *
+ * The audio_stream() hook encodes a talkgroup's audio to Opus as it comes
+ * in, and every segmentSeconds of it is put together into a fragmented MP4
+ * segment kept in memory. The last few segments of each talkgroup are
+ * served with a playlist, so a player is only a couple of segments behind
+ * the radio instead of waiting for the call to end and be uploaded. A
+ * segment is also finished when the audio stops, so the end of a call
+ * doesn't wait on the next one.
+ *
+ * The media time of a talkgroup only goes forward while there is audio, so
+ * the quiet between calls is skipped instead of being played as silence.
+ * Each segment has the wall clock time it started at.
+ *
+ *   /live/                                 JSON list of the talkgroups
+ *   /live/<shortName>/<TGID>/index.m3u8    the playlist
+ *   /live/<shortName>/<TGID>/init.mp4      the Opus track
+ *   /live/<shortName>/<TGID>/<n>.m4s       a segment
+ *
+ * The encoders and segments are behind one lock, the recorders only hold
+ * it to encode their audio and the server to copy out what it sends.
+ */
+class Live_Audio : public Plugin_Api {
+  // Opus in MP4 is timed at 48 kHz, whatever it was encoded from
+  static const int TIMESCALE = 48000;
+  static const int FRAME_MS = 20;
+  static const int MAX_OPUS_PACKET = 1275;
+  // The recorders hand over audio in bursts, a P25 voice frame at a time,
+  // so it has to be quiet for longer than that before it has stopped
+  static constexpr double QUIET_SECONDS = 0.5;
+
+  struct Segment {
+    uint64_t sequence;
+    double duration;
+    time_t started; // wall clock, for EXT-X-PROGRAM-DATE-TIME
+    int started_ms;
+    std::string data; // moof and mdat
+  };
+
+  struct Channel {
+    std::string short_name;
+    long talkgroup;
+    OpusEncoder *encoder;
+    long rate;
+    int frame;    // samples in FRAME_MS at rate
+    int pre_skip; // at TIMESCALE, for the init segment
+    std::string init;
+    std::vector<int16_t> pcm; // waiting for a whole frame
+
+    // The segment being put together
+    std::string packets;
+    std::vector<uint32_t> sizes;
+    struct timespec segment_started;
+
+    uint64_t decode_time; // of the next segment, at TIMESCALE
+    uint64_t next_sequence;
+    std::deque<Segment> segments;
+    std::chrono::steady_clock::time_point last_audio;
+  };
+
+  std::string address;
+  int port;
+  double segment_seconds;
+  size_t segment_count;
+  int opus_bitrate;
+  int idle_seconds;
+  int listen_fd;
+  std::atomic<bool> running;
+  std::thread server;
+
+  std::mutex channels_mutex;
+  std::map<std::pair<std::string, long>, Channel> channels;
+
+public:
+  Live_Audio() : address("0.0.0.0"), port(8090), segment_seconds(1.0), segment_count(6), opus_bitrate(16000), idle_seconds(600), listen_fd(-1), running(false) {}
+
+  ~Live_Audio() {
+    for (std::map<std::pair<std::string, long>, Channel>::iterator it = channels.begin(); it != channels.end(); ++it) {
+      opus_encoder_destroy(it->second.encoder);
+    }
+  }
+
+  unsigned int hooks() {
+    return PLUGIN_HOOK_AUDIO_STREAM;
+  }
+
+  int parse_config(json config_data) {
+    address = config_data.value("address", "0.0.0.0");
+    port = config_data.value("port", 8090);
+    segment_seconds = config_data.value("segmentSeconds", 1.0);
+    segment_count = config_data.value("segments", 6);
+    opus_bitrate = config_data.value("opusBitrate", 16000);
+    idle_seconds = config_data.value("idleSeconds", 600);
+    if (segment_seconds < FRAME_MS / 1000.0) {
+      segment_seconds = FRAME_MS / 1000.0;
+    }
+    if (segment_count < 3) {
+      segment_count = 3;
+    }
+    BOOST_LOG_TRIVIAL(info) << " Live Audio Address: " << address << " Port: " << port << " Segment Seconds: " << segment_seconds << " Segments: " << segment_count << " Opus Bitrate: " << opus_bitrate;
+    return 0;
+  }
+
+  int start() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+      BOOST_LOG_TRIVIAL(error) << "Live Audio - socket failed: " << strerror(errno);
+      return 1;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+      BOOST_LOG_TRIVIAL(error) << "Live Audio - address is not an IPv4 address: " << address;
+      close(listen_fd);
+      listen_fd = -1;
+      return 1;
+    }
+    if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(listen_fd, 32) < 0)) {
+      BOOST_LOG_TRIVIAL(error) << "Live Audio - could not listen on " << address << ":" << port << " : " << strerror(errno);
+      close(listen_fd);
+      listen_fd = -1;
+      return 1;
+    }
+
+    running = true;
+    server = std::thread(&Live_Audio::run, this);
+    BOOST_LOG_TRIVIAL(info) << "Live Audio serving http://" << address << ":" << port << "/live/";
+    return 0;
+  }
+
+  int stop() {
+    if (!running.exchange(false)) {
+      return 0;
+    }
+    // The server checks running between polls
+    server.join();
+    close(listen_fd);
+    listen_fd = -1;
+    return 0;
+  }
+
+  /* -- MP4 boxes -- */
+
+  static void put_u8(std::string &out, uint8_t value) {
+    out += (char)value;
+  }
+
+  static void put_u16(std::string &out, uint16_t value) {
+    put_u8(out, value >> 8);
+    put_u8(out, value);
+  }
+
+  static void put_u32(std::string &out, uint32_t value) {
+    put_u16(out, value >> 16);
+    put_u16(out, value);
+  }
+
+  static void put_u64(std::string &out, uint64_t value) {
+    put_u32(out, value >> 32);
+    put_u32(out, value);
+  }
+
+  static void put_zeros(std::string &out, size_t count) {
+    out.append(count, '\0');
+  }
+
+  static void put_matrix(std::string &out) {
+    static const uint32_t unity[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (int i = 0; i < 9; i++) {
+      put_u32(out, unity[i]);
+    }
+  }
+
+  // A box around body
+  static std::string box(const char *type, const std::string &body) {
+    std::string out;
+    put_u32(out, 8 + body.size());
+    out.append(type, 4);
+    out += body;
+    return out;
+  }
+
+  static std::string full_box(const char *type, uint8_t version, uint32_t flags, const std::string &body) {
+    std::string header;
+    put_u32(header, ((uint32_t)version << 24) | flags);
+    return box(type, header + body);
+  }
+
+  // ftyp and moov, with the one Opus track and no samples of its own
+  static std::string make_init(long rate, int pre_skip) {
+    std::string ftyp;
+    ftyp.append("iso6", 4);
+    put_u32(ftyp, 0);
+    ftyp.append("iso6mp41", 8);
+
+    std::string mvhd;
+    put_u32(mvhd, 0); // creation
+    put_u32(mvhd, 0); // modification
+    put_u32(mvhd, TIMESCALE);
+    put_u32(mvhd, 0); // duration
+    put_u32(mvhd, 0x00010000);
+    put_u16(mvhd, 0x0100);
+    put_zeros(mvhd, 10);
+    put_matrix(mvhd);
+    put_zeros(mvhd, 24);
+    put_u32(mvhd, 2); // next track
+
+    std::string tkhd;
+    put_u32(tkhd, 0);
+    put_u32(tkhd, 0);
+    put_u32(tkhd, 1); // track
+    put_u32(tkhd, 0);
+    put_u32(tkhd, 0); // duration
+    put_zeros(tkhd, 8);
+    put_u16(tkhd, 0);      // layer
+    put_u16(tkhd, 0);      // alternate group
+    put_u16(tkhd, 0x0100); // volume
+    put_u16(tkhd, 0);
+    put_matrix(tkhd);
+    put_u32(tkhd, 0); // width
+    put_u32(tkhd, 0); // height
+
+    std::string mdhd;
+    put_u32(mdhd, 0);
+    put_u32(mdhd, 0);
+    put_u32(mdhd, TIMESCALE);
+    put_u32(mdhd, 0);
+    put_u16(mdhd, 0x55c4); // "und"
+    put_u16(mdhd, 0);
+
+    std::string hdlr;
+    put_u32(hdlr, 0);
+    hdlr.append("soun", 4);
+    put_zeros(hdlr, 12);
+    hdlr.append("SoundHandler", 13);
+
+    std::string smhd;
+    put_u32(smhd, 0);
+    std::string dref;
+    put_u32(dref, 1);
+    dref += full_box("url ", 0, 1, "");
+
+    std::string dops;
+    put_u8(dops, 0);  // version
+    put_u8(dops, 1);  // channels
+    put_u16(dops, pre_skip);
+    put_u32(dops, rate);
+    put_u16(dops, 0); // gain
+    put_u8(dops, 0);  // mapping family
+    std::string opus;
+    put_zeros(opus, 6);
+    put_u16(opus, 1); // data reference
+    put_zeros(opus, 8);
+    put_u16(opus, 1);  // channels
+    put_u16(opus, 16); // sample size
+    put_u32(opus, 0);
+    put_u32(opus, (uint32_t)TIMESCALE << 16);
+    opus += box("dOps", dops);
+
+    std::string stsd;
+    put_u32(stsd, 1);
+    stsd += box("Opus", opus);
+    std::string empty_table;
+    put_u32(empty_table, 0);
+    std::string stsz;
+    put_u32(stsz, 0);
+    put_u32(stsz, 0);
+    std::string stbl = full_box("stsd", 0, 0, stsd) + full_box("stts", 0, 0, empty_table) + full_box("stsc", 0, 0, empty_table) + full_box("stsz", 0, 0, stsz) + full_box("stco", 0, 0, empty_table);
+
+    std::string minf = full_box("smhd", 0, 0, smhd) + box("dinf", full_box("dref", 0, 0, dref)) + box("stbl", stbl);
+    std::string mdia = full_box("mdhd", 0, 0, mdhd) + full_box("hdlr", 0, 0, hdlr) + box("minf", minf);
+    std::string trak = full_box("tkhd", 0, 3, tkhd) + box("mdia", mdia);
+
+    std::string trex;
+    put_u32(trex, 1); // track
+    put_u32(trex, 1); // sample description
+    put_u32(trex, 0);
+    put_u32(trex, 0);
+    put_u32(trex, 0);
+
+    std::string moov = full_box("mvhd", 0, 0, mvhd) + box("trak", trak) + box("mvex", full_box("trex", 0, 0, trex));
+    return box("ftyp", ftyp) + box("moov", moov);
+  }
+
+  // moof and mdat for the packets put together so far, each FRAME_MS long
+  static std::string make_segment(uint64_t sequence, uint64_t decode_time, const std::vector<uint32_t> &sizes, const std::string &packets) {
+    std::string mfhd;
+    put_u32(mfhd, sequence);
+    std::string tfhd;
+    put_u32(tfhd, 1); // track
+    std::string tfdt;
+    put_u64(tfdt, decode_time);
+
+    // The data offset is from the start of the moof, which is worked out
+    // from the sizes of the boxes before the samples are put in
+    std::string trun;
+    put_u32(trun, sizes.size());
+    size_t offset_at = trun.size();
+    put_u32(trun, 0);
+    for (size_t i = 0; i < sizes.size(); i++) {
+      put_u32(trun, TIMESCALE * FRAME_MS / 1000);
+      put_u32(trun, sizes[i]);
+    }
+    size_t moof_size = 8 + (8 + 4 + mfhd.size()) + 8 + (8 + 4 + tfhd.size()) + (8 + 4 + tfdt.size()) + (8 + 4 + trun.size());
+    uint32_t offset = moof_size + 8;
+    trun[offset_at] = offset >> 24;
+    trun[offset_at + 1] = offset >> 16;
+    trun[offset_at + 2] = offset >> 8;
+    trun[offset_at + 3] = offset;
+
+    std::string traf = full_box("tfhd", 0, 0x020000, tfhd) + full_box("tfdt", 1, 0, tfdt) + full_box("trun", 0, 0x000301, trun);
+    std::string moof = box("moof", full_box("mfhd", 0, 0, mfhd) + box("traf", traf));
+    return moof + box("mdat", packets);
+  }
+
+  /* -- Encoding -- */
+
+  // A talkgroup's encoder is made with the first audio for it, and again
+  // if a recorder at another rate picks it up
+  bool setup_encoder(Channel &channel, long rate) {
+    if (channel.encoder && (channel.rate == rate)) {
+      return true;
+    }
+    int err = OPUS_OK;
+    OpusEncoder *encoder = opus_encoder_create(rate, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK) {
+      BOOST_LOG_TRIVIAL(error) << "Live Audio failed to create an Opus encoder at " << rate << " Hz: " << opus_strerror(err);
+      return false;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(opus_bitrate));
+    if (channel.encoder) {
+      opus_encoder_destroy(channel.encoder);
+    }
+    channel.encoder = encoder;
+    channel.rate = rate;
+    channel.frame = rate * FRAME_MS / 1000;
+    channel.pcm.clear();
+    if (channel.init.empty()) {
+      opus_int32 lookahead = 0;
+      opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+      channel.pre_skip = lookahead * TIMESCALE / rate;
+      channel.init = make_init(rate, channel.pre_skip);
+    }
+    return true;
+  }
+
+  void encode_frame(Channel &channel, const int16_t *pcm) {
+    unsigned char packet[MAX_OPUS_PACKET];
+    int length = opus_encode(channel.encoder, pcm, channel.frame, packet, MAX_OPUS_PACKET);
+    if (length < 0) {
+      BOOST_LOG_TRIVIAL(error) << "Live Audio failed to encode Opus: " << opus_strerror(length);
+      return;
+    }
+    if (channel.sizes.empty()) {
+      clock_gettime(CLOCK_REALTIME, &channel.segment_started);
+    }
+    channel.packets.append((const char *)packet, length);
+    channel.sizes.push_back(length);
+  }
+
+  void finish_segment(Channel &channel) {
+    if (channel.sizes.empty()) {
+      return;
+    }
+    Segment segment;
+    segment.sequence = channel.next_sequence++;
+    segment.duration = channel.sizes.size() * FRAME_MS / 1000.0;
+    segment.started = channel.segment_started.tv_sec;
+    segment.started_ms = channel.segment_started.tv_nsec / 1000000;
+    segment.data = make_segment(segment.sequence, channel.decode_time, channel.sizes, channel.packets);
+    channel.decode_time += (uint64_t)channel.sizes.size() * TIMESCALE * FRAME_MS / 1000;
+    channel.packets.clear();
+    channel.sizes.clear();
+    channel.segments.push_back(segment);
+    while (channel.segments.size() > segment_count) {
+      channel.segments.pop_front();
+    }
+  }
+
+  size_t segment_frames() const {
+    return std::max(1L, lround(segment_seconds * 1000 / FRAME_MS));
+  }
+
+  int audio_stream(Call *call, Recorder *recorder, int16_t *samples, int sampleCount) {
+    if ((call == NULL) || (sampleCount <= 0)) {
+      return 0;
+    }
+    std::pair<std::string, long> key(call->get_short_name(), call->get_talkgroup());
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    std::map<std::pair<std::string, long>, Channel>::iterator it = channels.find(key);
+    if (it == channels.end()) {
+      Channel channel;
+      channel.short_name = key.first;
+      channel.talkgroup = key.second;
+      channel.encoder = NULL;
+      channel.rate = 0;
+      channel.frame = 0;
+      channel.pre_skip = 0;
+      channel.decode_time = 0;
+      channel.next_sequence = 1;
+      channel.last_audio = std::chrono::steady_clock::now();
+      it = channels.insert(std::make_pair(key, channel)).first;
+    }
+    Channel &channel = it->second;
+    if (!setup_encoder(channel, recorder->get_wav_hz())) {
+      return 0;
+    }
+    channel.last_audio = std::chrono::steady_clock::now();
+
+    channel.pcm.insert(channel.pcm.end(), samples, samples + sampleCount);
+    size_t used = 0;
+    while (channel.pcm.size() - used >= (size_t)channel.frame) {
+      encode_frame(channel, &channel.pcm[used]);
+      used += channel.frame;
+      if (channel.sizes.size() >= segment_frames()) {
+        finish_segment(channel);
+      }
+    }
+    channel.pcm.erase(channel.pcm.begin(), channel.pcm.begin() + used);
+    return 0;
+  }
+
+  // Once the audio has stopped for QUIET_SECONDS, what is left of it is
+  // padded out to a frame and the segment finished. Talkgroups that have
+  // been quiet for idleSeconds are dropped.
+  void flush_quiet() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    std::map<std::pair<std::string, long>, Channel>::iterator it = channels.begin();
+    while (it != channels.end()) {
+      Channel &channel = it->second;
+      double quiet = std::chrono::duration<double>(now - channel.last_audio).count();
+      if (quiet > idle_seconds) {
+        opus_encoder_destroy(channel.encoder);
+        it = channels.erase(it);
+        continue;
+      }
+      if (quiet > QUIET_SECONDS) {
+        if (!channel.pcm.empty()) {
+          channel.pcm.resize(channel.frame, 0);
+          encode_frame(channel, &channel.pcm[0]);
+          channel.pcm.clear();
+        }
+        finish_segment(channel);
+      }
+      ++it;
+    }
+  }
+
+  /* -- Serving -- */
+
+  std::string format_playlist(const Channel &channel) {
+    std::ostringstream out;
+    double longest = segment_seconds;
+    for (std::deque<Segment>::const_iterator it = channel.segments.begin(); it != channel.segments.end(); ++it) {
+      longest = std::max(longest, it->duration);
+    }
+    out << "#EXTM3U\n"
+        << "#EXT-X-VERSION:7\n"
+        << "#EXT-X-TARGETDURATION:" << (int)ceil(longest) << "\n"
+        << "#EXT-X-MEDIA-SEQUENCE:" << (channel.segments.empty() ? channel.next_sequence : channel.segments.front().sequence) << "\n"
+        << "#EXT-X-MAP:URI=\"init.mp4\"\n";
+    for (std::deque<Segment>::const_iterator it = channel.segments.begin(); it != channel.segments.end(); ++it) {
+      char started[32];
+      struct tm tm;
+      gmtime_r(&it->started, &tm);
+      strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%S", &tm);
+      char duration[16];
+      snprintf(duration, sizeof(duration), "%.3f", it->duration);
+      char millis[8];
+      snprintf(millis, sizeof(millis), ".%03dZ", it->started_ms);
+      out << "#EXT-X-PROGRAM-DATE-TIME:" << started << millis << "\n"
+          << "#EXTINF:" << duration << ",\n"
+          << it->sequence << ".m4s\n";
+    }
+    return out.str();
+  }
+
+  std::string format_index() {
+    json list = json::array();
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (std::map<std::pair<std::string, long>, Channel>::iterator it = channels.begin(); it != channels.end(); ++it) {
+      list.push_back({{"short_name", it->second.short_name},
+                      {"talkgroup", it->second.talkgroup},
+                      {"playlist", "/live/" + it->second.short_name + "/" + std::to_string(it->second.talkgroup) + "/index.m3u8"},
+                      {"quiet_seconds", std::chrono::duration<double>(now - it->second.last_audio).count()}});
+    }
+    return list.dump() + "\n";
+  }
+
+  // Finds what path is asking for, under the lock
+  bool lookup(const std::string &path, std::string &type, std::string &body) {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    if ((path == "/live") || (path == "/live/")) {
+      type = "application/json";
+      body = format_index();
+      return true;
+    }
+    if (path.compare(0, 6, "/live/") != 0) {
+      return false;
+    }
+    size_t system_end = path.find('/', 6);
+    size_t talkgroup_end = (system_end == std::string::npos) ? std::string::npos : path.find('/', system_end + 1);
+    if (talkgroup_end == std::string::npos) {
+      return false;
+    }
+    std::string short_name = path.substr(6, system_end - 6);
+    std::string file = path.substr(talkgroup_end + 1);
+    long talkgroup = atol(path.substr(system_end + 1, talkgroup_end - system_end - 1).c_str());
+    std::map<std::pair<std::string, long>, Channel>::iterator it = channels.find(std::make_pair(short_name, talkgroup));
+    if (it == channels.end()) {
+      return false;
+    }
+    Channel &channel = it->second;
+    if (file == "index.m3u8") {
+      type = "application/vnd.apple.mpegurl";
+      body = format_playlist(channel);
+      return true;
+    }
+    if (file == "init.mp4") {
+      type = "audio/mp4";
+      body = channel.init;
+      return true;
+    }
+    if ((file.size() > 4) && (file.compare(file.size() - 4, 4, ".m4s") == 0)) {
+      uint64_t sequence = strtoull(file.c_str(), NULL, 10);
+      for (std::deque<Segment>::iterator seg = channel.segments.begin(); seg != channel.segments.end(); ++seg) {
+        if (seg->sequence == sequence) {
+          type = "audio/mp4";
+          body = seg->data;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  static bool send_all(int fd, const std::string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+      ssize_t sent = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      done += sent;
+    }
+    return true;
+  }
+
+  // One request per connection, like the Prometheus Exporter
+  void handle(int fd) {
+    struct timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+      ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+      if (got <= 0) {
+        break;
+      }
+      request.append(buffer, got);
+    }
+
+    std::string status = "404 Not Found";
+    std::string type = "text/plain";
+    std::string body = "The talkgroups are listed at /live/\n";
+    if (request.compare(0, 4, "GET ") == 0) {
+      size_t path_end = request.find_first_of(" ?", 4);
+      std::string path = request.substr(4, (path_end == std::string::npos) ? std::string::npos : path_end - 4);
+      std::string found_type;
+      std::string found_body;
+      if (lookup(path, found_type, found_body)) {
+        status = "200 OK";
+        type = found_type;
+        body.swap(found_body);
+      }
+    }
+
+    // The playlist changes with every segment, the segments never do
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: " << type << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Access-Control-Allow-Origin: *\r\n"
+             << "Cache-Control: " << ((type == "audio/mp4") ? "max-age=60" : "no-cache") << "\r\n"
+             << "Connection: close\r\n\r\n";
+    send_all(fd, response.str()) && send_all(fd, body);
+  }
+
+  void run() {
+    while (running.load()) {
+      struct pollfd pfd;
+      pfd.fd = listen_fd;
+      pfd.events = POLLIN;
+      int ready = poll(&pfd, 1, 100);
+      flush_quiet();
+      if (ready <= 0) {
+        continue;
+      }
+      int fd = accept(listen_fd, NULL, NULL);
+      if (fd < 0) {
+        continue;
+      }
+      handle(fd);
+      close(fd);
+    }
+  }
+
+  // Factory method
+  static boost::shared_ptr<Live_Audio> create() {
+    return boost::shared_ptr<Live_Audio>(
+        new Live_Audio());
+  }
+};
+
+BOOST_DLL_ALIAS(
+    Live_Audio::create, // <-- this function is exported with...
+    create_plugin       // <-- ...this alias name
+)
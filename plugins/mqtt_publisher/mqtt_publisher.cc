@@ -0,0 +1,760 @@
+#include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/recorders/recorder.h"
+#include "../../trunk-recorder/source.h"
+#include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
+#include <boost/log/trivial.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Mqtt_Publisher
+ *   Publishes what Trunk Recorder is doing to an MQTT broker, from a thread
+ *   of its own, with an MQTT 3.1.1 client built in.
+ *
+ * The hooks never touch the socket. The unit events, trunk messages and
+ * recorder states come in far too often to be a message each, so the hooks
+ * only add them to a batch, and a recorder's state replaces the one before
+ * it. Every flushInterval the thread turns each batch into one JSON payload
+ * and publishes it. A concluded call is published as soon as the thread
+ * gets to it, with the call's status JSON as the Call_Concluder wrote it:
+ * the payload is the Call_Data_t's own shared string, so putting it on
+ * more than one topic doesn't copy or serialize it again.
+ *
+ *   <topic>/call_end        a call's JSON, also <topic>/<shortName>/call_end with systemTopics
+ *   <topic>/units           the unit events since the last flush
+ *   <topic>/recorders       the recorders whose state changed
+ *   <topic>/trunk_messages  the decoded control channel messages, with trunkMessages
+ *
+ * At QoS 1 a message is kept until the broker acknowledges it, and sent
+ * again after a reconnect. While the broker can't be reached, the oldest
+ * messages past maxQueue are dropped.
+ */
+class Mqtt_Publisher : public Plugin_Api {
+  typedef std::shared_ptr<const std::string> Payload;
+
+  struct Message {
+    std::string topic;
+    Payload payload;
+    uint16_t packet_id; // 0 until it is sent at QoS 1
+  };
+
+  struct Unit_Event {
+    std::string short_name;
+    const char *event;
+    long unit;
+    long talkgroup;
+    std::int64_t time_ms;
+  };
+
+  struct Trunk_Event {
+    int sys_num;
+    int message_type;
+    double freq;
+    long talkgroup;
+    long source;
+    bool encrypted;
+    bool emergency;
+  };
+
+  struct Recorder_Event {
+    int source;
+    std::string type;
+    int state;
+    double freq;
+  };
+
+  std::string broker;
+  std::string host;
+  std::string port;
+  std::string topic;
+  std::string client_id;
+  std::string username;
+  std::string password;
+  int qos;
+  int flush_interval_ms;
+  int keepalive;
+  size_t max_queue;
+  bool system_topics;
+  bool publish_units;
+  bool publish_recorders;
+  bool publish_trunk_messages;
+
+  std::map<int, std::string> system_names; // sys_num to short name
+
+  // What the hooks hand to the thread
+  std::mutex events_mutex;
+  std::condition_variable events_ready; // wakes the thread for stop()
+  std::vector<Unit_Event> unit_events;
+  std::vector<Trunk_Event> trunk_events;
+  std::map<int, Recorder_Event> recorder_events; // by recorder num, the latest
+  std::deque<Message> queue;
+  uint64_t dropped;
+
+  // The thread's own
+  int sock;
+  std::string received;
+  std::map<uint16_t, Message> in_flight;
+  uint16_t next_packet_id;
+  std::chrono::steady_clock::time_point last_sent;
+  std::chrono::steady_clock::time_point next_connect;
+  uint64_t published;
+
+  std::atomic<bool> running;
+  std::thread worker;
+
+  static const size_t MAX_IN_FLIGHT = 64;
+  static const int POLL_MS = 50;
+
+public:
+  Mqtt_Publisher() : qos(0), flush_interval_ms(1000), keepalive(60), max_queue(1000), system_topics(false), publish_units(true), publish_recorders(true), publish_trunk_messages(false), dropped(0), sock(-1), next_packet_id(1), published(0), running(false) {}
+
+  unsigned int hooks() {
+    unsigned int hooks = PLUGIN_HOOK_CALL_END | PLUGIN_HOOK_SETUP_RECORDER | PLUGIN_HOOK_SOURCE_RATES | PLUGIN_HOOK_UNIT_EVENTS;
+    if (publish_trunk_messages) {
+      hooks |= PLUGIN_HOOK_TRUNK_MESSAGE;
+    }
+    return hooks;
+  }
+
+  int parse_config(json config_data) {
+    broker = config_data.value("broker", "tcp://localhost:1883");
+    topic = config_data.value("topic", "trunk-recorder");
+    client_id = config_data.value("clientId", "trunk-recorder");
+    username = config_data.value("username", "");
+    password = config_data.value("password", "");
+    qos = config_data.value("qos", 0);
+    flush_interval_ms = config_data.value("flushInterval", 1000);
+    keepalive = config_data.value("keepalive", 60);
+    max_queue = config_data.value("maxQueue", 1000);
+    system_topics = config_data.value("systemTopics", false);
+    publish_units = config_data.value("unitEvents", true);
+    publish_recorders = config_data.value("recorders", true);
+    publish_trunk_messages = config_data.value("trunkMessages", false);
+
+    if ((qos < 0) || (qos > 1)) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - qos has to be 0 or 1, using 1";
+      qos = 1;
+    }
+    if (flush_interval_ms < 10) {
+      flush_interval_ms = 10;
+    }
+    while (!topic.empty() && (topic[topic.size() - 1] == '/')) {
+      topic.erase(topic.size() - 1);
+    }
+
+    std::string address = broker;
+    if (address.compare(0, 6, "tcp://") == 0) {
+      address = address.substr(6);
+    } else if (address.compare(0, 7, "mqtt://") == 0) {
+      address = address.substr(7);
+    } else if (address.find("://") != std::string::npos) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - only tcp:// brokers are supported: " << broker;
+      return 1;
+    }
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+      host = address;
+      port = "1883";
+    } else {
+      host = address.substr(0, colon);
+      port = address.substr(colon + 1);
+    }
+    BOOST_LOG_TRIVIAL(info) << " MQTT Publisher Broker: " << host << ":" << port << " Topic: " << topic << " QoS: " << qos << " Flush Interval (ms): " << flush_interval_ms;
+    return 0;
+  }
+
+  int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) {
+    frequency_format = config->frequency_format;
+    for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
+      system_names[(*it)->get_sys_num()] = (*it)->get_short_name();
+    }
+    return 0;
+  }
+
+  int start() {
+    running = true;
+    worker = std::thread(&Mqtt_Publisher::run, this);
+    return 0;
+  }
+
+  int stop() {
+    if (!running.exchange(false)) {
+      return 0;
+    }
+    events_ready.notify_all();
+    worker.join();
+    return 0;
+  }
+
+  /* -- Hooks, these only add to the batches -- */
+
+  void add_unit_event(System *sys, const char *event, long unit, long talkgroup) {
+    if (!publish_units) {
+      return;
+    }
+    Unit_Event unit_event = {sys->get_short_name(), event, unit, talkgroup, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()};
+    std::lock_guard<std::mutex> lock(events_mutex);
+    unit_events.push_back(unit_event);
+  }
+
+  int unit_registration(System *sys, long source_id) {
+    add_unit_event(sys, "registration", source_id, 0);
+    return 0;
+  }
+
+  int unit_deregistration(System *sys, long source_id) {
+    add_unit_event(sys, "deregistration", source_id, 0);
+    return 0;
+  }
+
+  int unit_acknowledge_response(System *sys, long source_id) {
+    add_unit_event(sys, "acknowledge", source_id, 0);
+    return 0;
+  }
+
+  int unit_group_affiliation(System *sys, long source_id, long talkgroup_num) {
+    add_unit_event(sys, "affiliation", source_id, talkgroup_num);
+    return 0;
+  }
+
+  int unit_data_grant(System *sys, long source_id) {
+    add_unit_event(sys, "data_grant", source_id, 0);
+    return 0;
+  }
+
+  int unit_answer_request(System *sys, long source_id, long talkgroup) {
+    add_unit_event(sys, "answer_request", source_id, talkgroup);
+    return 0;
+  }
+
+  int unit_location(System *sys, long source_id, long talkgroup_num) {
+    add_unit_event(sys, "location", source_id, talkgroup_num);
+    return 0;
+  }
+
+  int trunk_message_view(const std::vector<TrunkMessage> &messages, System *system) {
+    if (!publish_trunk_messages) {
+      return 0;
+    }
+    std::lock_guard<std::mutex> lock(events_mutex);
+    for (std::vector<TrunkMessage>::const_iterator it = messages.begin(); it != messages.end(); ++it) {
+      Trunk_Event event = {system->get_sys_num(), it->message_type, it->freq, it->talkgroup, it->source, it->encrypted, it->emergency};
+      trunk_events.push_back(event);
+    }
+    return 0;
+  }
+
+  void add_recorder_event(Recorder *recorder) {
+    if (!publish_recorders) {
+      return;
+    }
+    Source *source = recorder->get_source();
+    Recorder_Event event = {source ? source->get_num() : -1, recorder->get_type_string(), recorder->get_state(), recorder->get_freq()};
+    std::lock_guard<std::mutex> lock(events_mutex);
+    std::map<int, Recorder_Event>::iterator it = recorder_events.find(recorder->get_num());
+    if (it == recorder_events.end()) {
+      recorder_events.insert(std::make_pair(recorder->get_num(), event));
+    } else {
+      it->second = event;
+    }
+  }
+
+  int setup_recorder(Recorder *recorder) {
+    add_recorder_event(recorder);
+    return 0;
+  }
+
+  // Picks up the state changes that don't come through setup_recorder(),
+  // only the ones that changed are added
+  int source_rates_view(const std::vector<Source *> &sources, float timeDiff) {
+    if (!publish_recorders) {
+      return 0;
+    }
+    for (std::vector<Source *>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+      std::vector<Recorder *> recorders = (*it)->get_recorders();
+      for (std::vector<Recorder *>::iterator rec = recorders.begin(); rec != recorders.end(); ++rec) {
+        if (recorder_changed(*rec)) {
+          add_recorder_event(*rec);
+        }
+      }
+    }
+    return 0;
+  }
+
+  // Called from the Call_Concluder's workers
+  int call_end_view(const Call_Data_t &call_info) {
+    Payload payload = call_info.call_json;
+    if (!payload) {
+      json call = {{"short_name", call_info.short_name},
+                   {"talkgroup", call_info.talkgroup},
+                   {"call_num", call_info.call_num},
+                   {"freq", call_info.freq},
+                   {"start_time", call_info.start_time},
+                   {"stop_time", call_info.stop_time},
+                   {"call_length", call_info.length},
+                   {"emergency", call_info.emergency},
+                   {"encrypted", call_info.encrypted}};
+      payload = std::make_shared<const std::string>(call.dump());
+    }
+    std::lock_guard<std::mutex> lock(events_mutex);
+    enqueue(topic + "/call_end", payload);
+    if (system_topics) {
+      enqueue(topic + "/" + call_info.short_name + "/call_end", payload);
+    }
+    return 0;
+  }
+
+  /* -- The thread -- */
+
+  // The state each recorder was last published with, only the thread and
+  // source_rates_view() on the main loop use it
+  std::mutex seen_mutex;
+  std::map<int, int> seen_states;
+
+  bool recorder_changed(Recorder *recorder) {
+    std::lock_guard<std::mutex> lock(seen_mutex);
+    std::map<int, int>::iterator it = seen_states.find(recorder->get_num());
+    if ((it != seen_states.end()) && (it->second == recorder->get_state())) {
+      return false;
+    }
+    seen_states[recorder->get_num()] = recorder->get_state();
+    return true;
+  }
+
+  // Under events_mutex
+  void enqueue(const std::string &to, Payload payload) {
+    Message message = {to, payload, 0};
+    queue.push_back(message);
+    while (queue.size() > max_queue) {
+      queue.pop_front();
+      dropped++;
+    }
+  }
+
+  static const char *message_type_name(int type) {
+    switch (type) {
+    case GRANT:
+      return "grant";
+    case STATUS:
+      return "status";
+    case UPDATE:
+      return "update";
+    case CONTROL_CHANNEL:
+      return "control_channel";
+    case REGISTRATION:
+      return "registration";
+    case DEREGISTRATION:
+      return "deregistration";
+    case AFFILIATION:
+      return "affiliation";
+    case SYSID:
+      return "sysid";
+    case ACKNOWLEDGE:
+      return "acknowledge";
+    case LOCATION:
+      return "location";
+    case PATCH_ADD:
+      return "patch_add";
+    case PATCH_DELETE:
+      return "patch_delete";
+    case DATA_GRANT:
+      return "data_grant";
+    case UU_ANS_REQ:
+      return "uu_ans_req";
+    case UU_V_GRANT:
+      return "uu_v_grant";
+    case UU_V_UPDATE:
+      return "uu_v_update";
+    case INVALID_CC_MESSAGE:
+      return "invalid_cc_message";
+    case TDULC:
+      return "tdulc";
+    default:
+      return "unknown";
+    }
+  }
+
+  static const char *state_name(int state) {
+    switch (state) {
+    case MONITORING:
+      return "monitoring";
+    case RECORDING:
+      return "recording";
+    case INACTIVE:
+      return "inactive";
+    case ACTIVE:
+      return "active";
+    case IDLE:
+      return "idle";
+    case STOPPED:
+      return "stopped";
+    case AVAILABLE:
+      return "available";
+    case IGNORE:
+      return "ignore";
+    default:
+      return "unknown";
+    }
+  }
+
+  // Turns the batches into one payload each, away from the hooks' lock
+  void flush_batches() {
+    std::vector<Unit_Event> units;
+    std::vector<Trunk_Event> trunks;
+    std::map<int, Recorder_Event> recorders;
+    {
+      std::lock_guard<std::mutex> lock(events_mutex);
+      units.swap(unit_events);
+      trunks.swap(trunk_events);
+      recorders.swap(recorder_events);
+    }
+
+    std::vector<std::pair<std::string, Payload>> batches;
+    if (!units.empty()) {
+      json events = json::array();
+      for (std::vector<Unit_Event>::iterator it = units.begin(); it != units.end(); ++it) {
+        json event = {{"short_name", it->short_name}, {"event", it->event}, {"unit", it->unit}, {"time_ms", it->time_ms}};
+        if (it->talkgroup) {
+          event["talkgroup"] = it->talkgroup;
+        }
+        events.push_back(event);
+      }
+      batches.push_back(std::make_pair(topic + "/units", std::make_shared<const std::string>(json({{"type", "units"}, {"units", events}}).dump())));
+    }
+    if (!trunks.empty()) {
+      json messages = json::array();
+      for (std::vector<Trunk_Event>::iterator it = trunks.begin(); it != trunks.end(); ++it) {
+        messages.push_back({{"short_name", system_names[it->sys_num]},
+                            {"type", message_type_name(it->message_type)},
+                            {"freq", it->freq},
+                            {"talkgroup", it->talkgroup},
+                            {"source", it->source},
+                            {"encrypted", it->encrypted},
+                            {"emergency", it->emergency}});
+      }
+      batches.push_back(std::make_pair(topic + "/trunk_messages", std::make_shared<const std::string>(json({{"type", "trunk_messages"}, {"messages", messages}}).dump())));
+    }
+    if (!recorders.empty()) {
+      json list = json::array();
+      for (std::map<int, Recorder_Event>::iterator it = recorders.begin(); it != recorders.end(); ++it) {
+        list.push_back({{"num", it->first},
+                        {"source", it->second.source},
+                        {"type", it->second.type},
+                        {"state", state_name(it->second.state)},
+                        {"freq", it->second.freq}});
+      }
+      batches.push_back(std::make_pair(topic + "/recorders", std::make_shared<const std::string>(json({{"type", "recorders"}, {"recorders", list}}).dump())));
+    }
+
+    if (!batches.empty()) {
+      std::lock_guard<std::mutex> lock(events_mutex);
+      for (std::vector<std::pair<std::string, Payload>>::iterator it = batches.begin(); it != batches.end(); ++it) {
+        enqueue(it->first, it->second);
+      }
+    }
+  }
+
+  /* -- MQTT 3.1.1 -- */
+
+  static void put_u16(std::string &out, uint16_t value) {
+    out += (char)(value >> 8);
+    out += (char)(value & 0xff);
+  }
+
+  static void put_string(std::string &out, const std::string &value) {
+    put_u16(out, value.size());
+    out += value;
+  }
+
+  // The fixed header, with the remaining length as a variable length int
+  static std::string fixed_header(uint8_t type, size_t remaining) {
+    std::string out;
+    out += (char)type;
+    do {
+      uint8_t byte = remaining % 128;
+      remaining /= 128;
+      if (remaining > 0) {
+        byte |= 0x80;
+      }
+      out += (char)byte;
+    } while (remaining > 0);
+    return out;
+  }
+
+  bool send_all(const char *data, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+      ssize_t sent = send(sock, data + done, length - done, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - send failed: " << strerror(errno);
+        return false;
+      }
+      done += sent;
+    }
+    last_sent = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  bool send_packet(const std::string &packet) {
+    return send_all(packet.data(), packet.size());
+  }
+
+  // The payload goes out straight from the shared string
+  bool send_publish(const Message &message, bool dup) {
+    std::string variable;
+    put_string(variable, message.topic);
+    if (qos > 0) {
+      put_u16(variable, message.packet_id);
+    }
+    uint8_t type = 0x30 | (dup ? 0x08 : 0) | (qos << 1);
+    std::string header = fixed_header(type, variable.size() + message.payload->size()) + variable;
+    return send_packet(header) && send_all(message.payload->data(), message.payload->size());
+  }
+
+  void disconnect() {
+    if (sock >= 0) {
+      close(sock);
+      sock = -1;
+    }
+    received.clear();
+    next_connect = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  }
+
+  bool connect_broker() {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *found = NULL;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &found);
+    if (err != 0) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - could not resolve " << host << ": " << gai_strerror(err);
+      disconnect();
+      return false;
+    }
+    for (struct addrinfo *addr = found; addr; addr = addr->ai_next) {
+      sock = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+      if (sock < 0) {
+        continue;
+      }
+      if (connect(sock, addr->ai_addr, addr->ai_addrlen) == 0) {
+        break;
+      }
+      close(sock);
+      sock = -1;
+    }
+    freeaddrinfo(found);
+    if (sock < 0) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - could not connect to " << host << ":" << port;
+      disconnect();
+      return false;
+    }
+    struct timeval timeout = {5, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string variable;
+    put_string(variable, "MQTT");
+    variable += (char)4; // 3.1.1
+    uint8_t flags = 0x02; // clean session
+    if (!username.empty()) {
+      flags |= 0x80;
+      if (!password.empty()) {
+        flags |= 0x40;
+      }
+    }
+    variable += (char)flags;
+    put_u16(variable, keepalive);
+    put_string(variable, client_id);
+    if (!username.empty()) {
+      put_string(variable, username);
+      if (!password.empty()) {
+        put_string(variable, password);
+      }
+    }
+    if (!send_packet(fixed_header(0x10, variable.size()) + variable)) {
+      disconnect();
+      return false;
+    }
+
+    unsigned char connack[4];
+    size_t got = 0;
+    while (got < sizeof(connack)) {
+      ssize_t n = recv(sock, connack + got, sizeof(connack) - got, 0);
+      if (n <= 0) {
+        BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - no CONNACK from " << host << ":" << port;
+        disconnect();
+        return false;
+      }
+      got += n;
+    }
+    if ((connack[0] != 0x20) || (connack[3] != 0)) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - broker refused the connection, return code " << (int)connack[3];
+      disconnect();
+      return false;
+    }
+    BOOST_LOG_TRIVIAL(info) << "MQTT Publisher connected to " << host << ":" << port;
+
+    // A clean session forgets what wasn't acknowledged, so it is sent again
+    for (std::map<uint16_t, Message>::iterator it = in_flight.begin(); it != in_flight.end(); ++it) {
+      if (!send_publish(it->second, true)) {
+        disconnect();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // PUBACKs and PINGRESPs, nothing else is subscribed to
+  bool read_packets() {
+    char buffer[512];
+    ssize_t got = recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (got == 0) {
+      BOOST_LOG_TRIVIAL(error) << "MQTT Publisher - the broker closed the connection";
+      return false;
+    }
+    if (got < 0) {
+      return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+    received.append(buffer, got);
+    while (received.size() >= 2) {
+      size_t remaining = 0;
+      size_t multiplier = 1;
+      size_t pos = 1;
+      bool complete = false;
+      while (pos < received.size() && pos < 5) {
+        uint8_t byte = received[pos++];
+        remaining += (byte & 0x7f) * multiplier;
+        multiplier *= 128;
+        if (!(byte & 0x80)) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete || (received.size() < pos + remaining)) {
+        break;
+      }
+      uint8_t type = received[0] & 0xf0;
+      if ((type == 0x40) && (remaining >= 2)) {
+        uint16_t id = ((uint8_t)received[pos] << 8) | (uint8_t)received[pos + 1];
+        if (in_flight.erase(id)) {
+          published++;
+        }
+      }
+      received.erase(0, pos + remaining);
+    }
+    return true;
+  }
+
+  // Sends what is queued, at QoS 1 no more than MAX_IN_FLIGHT at a time
+  bool send_queue() {
+    while (true) {
+      if ((qos > 0) && (in_flight.size() >= MAX_IN_FLIGHT)) {
+        return true;
+      }
+      Message message;
+      {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        if (queue.empty()) {
+          return true;
+        }
+        message = queue.front();
+        queue.pop_front();
+      }
+      if (qos > 0) {
+        do {
+          message.packet_id = next_packet_id++;
+        } while ((message.packet_id == 0) || in_flight.count(message.packet_id));
+        in_flight[message.packet_id] = message;
+      }
+      if (!send_publish(message, false)) {
+        if (qos == 0) {
+          std::lock_guard<std::mutex> lock(events_mutex);
+          queue.push_front(message);
+        }
+        return false;
+      }
+      if (qos == 0) {
+        published++;
+      }
+    }
+  }
+
+  void run() {
+    std::chrono::milliseconds flush_interval(flush_interval_ms);
+    std::chrono::steady_clock::time_point next_flush = std::chrono::steady_clock::now() + flush_interval;
+    next_connect = std::chrono::steady_clock::now();
+
+    while (running.load()) {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if (now >= next_flush) {
+        flush_batches();
+        next_flush = now + flush_interval;
+      }
+
+      if ((sock < 0) && (now >= next_connect)) {
+        connect_broker();
+      }
+      if (sock >= 0) {
+        if (!read_packets() || !send_queue()) {
+          disconnect();
+        } else if ((keepalive > 0) && (now - last_sent > std::chrono::seconds(keepalive) / 2)) {
+          if (!send_packet(fixed_header(0xc0, 0))) {
+            disconnect();
+          }
+        }
+      }
+
+      // Connected, a call that ends waits at most POLL_MS to go out
+      if (sock >= 0) {
+        long until_flush = std::chrono::duration_cast<std::chrono::milliseconds>(next_flush - std::chrono::steady_clock::now()).count();
+        struct pollfd pfd;
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+        poll(&pfd, 1, std::max(0L, std::min(until_flush, (long)POLL_MS)));
+      } else {
+        std::unique_lock<std::mutex> lock(events_mutex);
+        events_ready.wait_until(lock, std::min(next_flush, next_connect));
+      }
+    }
+
+    // What is left goes out before disconnecting, if it can
+    flush_batches();
+    if (sock >= 0) {
+      read_packets();
+      send_queue();
+      send_packet(fixed_header(0xe0, 0));
+      close(sock);
+      sock = -1;
+    }
+    BOOST_LOG_TRIVIAL(info) << "MQTT Publisher - published " << published << " messages, dropped " << dropped;
+  }
+
+  // Factory method
+  static boost::shared_ptr<Mqtt_Publisher> create() {
+    return boost::shared_ptr<Mqtt_Publisher>(
+        new Mqtt_Publisher());
+  }
+};
+
+BOOST_DLL_ALIAS(
+    Mqtt_Publisher::create, // <-- this function is exported with...
+    create_plugin           // <-- ...this alias name
+)
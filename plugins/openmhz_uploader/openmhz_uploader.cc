@@ -5,6 +5,7 @@
 
 #include "../../trunk-recorder/call_concluder/call_concluder.h"
 #include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/upload_engine.h"
 #include "../trunk-recorder/gr_blocks/decoder_wrapper.h"
 #include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
 #include <boost/foreach.hpp>
@@ -21,17 +22,16 @@ struct Openmhz_Uploader_Data {
   std::string openmhz_server;
 };
 
-boost::mutex curl_share_mutex;
-
 class Openmhz_Uploader : public Plugin_Api {
   // float aggr_;
   // my_plugin_aggregator() : aggr_(0) {}
   Openmhz_Uploader_Data data;
-  CURLSH *curl_share;
-  long curl_dns_ttl;
+  Upload_Engine *upload_engine;
   std::string plugin_name;
 
 public:
+  Openmhz_Uploader() : upload_engine(NULL) {}
+
   Openmhz_System *get_openmhz_system(std::string short_name) {
     for (std::vector<Openmhz_System>::iterator it = data.systems.begin(); it != data.systems.end(); ++it) {
       Openmhz_System sys = *it;
@@ -45,7 +45,7 @@ public:
     ((std::string *)userp)->append((char *)contents, size * nmemb);
     return size * nmemb;
   }
-  int upload(Call_Data_t call_info) {
+  int upload(const Call_Data_t &call_info) {
     std::string api_key;
     std::string openmhz_sysid;
     Openmhz_System *sys = get_openmhz_system(call_info.short_name);
@@ -120,10 +120,6 @@ public:
     snprintf(formattedTalkgroup, 61, "%c[%dm%10ld%c[0m", 0x1B, 35, call_info.talkgroup, 0x1B);
     std::string talkgroup_display = boost::lexical_cast<std::string>(formattedTalkgroup);
     /*CURL *curl;*/
-    CURLMcode res;
-    CURLM *multi_handle;
-
-    int still_running = 0;
     std::string response_buffer;
     freq_string = freq.str();
     error_count_string = error_count.str();
@@ -145,7 +141,12 @@ public:
     mime = curl_mime_init(curl);
     part = curl_mime_addpart(mime);
 
-    curl_mime_filedata(part, call_info.converted.c_str());
+    if (call_info.converted_audio) {
+      Upload_Engine::set_mime_audio(part, call_info.converted_audio);
+      curl_mime_filename(part, boost::filesystem::path(call_info.converted).filename().c_str());
+    } else {
+      curl_mime_filedata(part, call_info.converted.c_str());
+    }
     curl_mime_type(part, "application/octet-stream"); /* content-type for this part */
     curl_mime_name(part, "call");
 
@@ -193,11 +194,9 @@ public:
     curl_mime_data(part, source_list_string.c_str(), CURL_ZERO_TERMINATED);
     curl_mime_name(part, "source_list");
 
-    multi_handle = curl_multi_init();
-
     /* initialize custom header list (stating that Expect: 100-continue is not wanted */
     headerlist = curl_slist_append(headerlist, "Expect:");
-    if (curl && multi_handle) {
+    if (curl) {
       std::string url = data.openmhz_server + "/" + openmhz_sysid + "/upload";
 
       /* what URL that receives this POST */
@@ -210,82 +209,8 @@ public:
       curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
       curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buffer);
 
-      curl_easy_setopt(curl, CURLOPT_SHARE, curl_share); 
-      curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, curl_dns_ttl);
-
-      curl_multi_add_handle(multi_handle, curl);
-
-      curl_multi_perform(multi_handle, &still_running);
-
-      while (still_running) {
-        struct timeval timeout;
-        int rc;       /* select() return code */
-        CURLMcode mc; /* curl_multi_fdset() return code */
-
-        fd_set fdread;
-        fd_set fdwrite;
-        fd_set fdexcep;
-        int maxfd = -1;
-
-        long curl_timeo = -1;
-
-        FD_ZERO(&fdread);
-        FD_ZERO(&fdwrite);
-        FD_ZERO(&fdexcep);
-
-        /* set a suitable timeout to play around with */
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-
-        curl_multi_timeout(multi_handle, &curl_timeo);
-        if (curl_timeo >= 0) {
-          timeout.tv_sec = curl_timeo / 1000;
-          if (timeout.tv_sec > 1)
-            timeout.tv_sec = 1;
-          else
-            timeout.tv_usec = (curl_timeo % 1000) * 1000;
-        }
-
-        /* get file descriptors from the transfers */
-        mc = curl_multi_fdset(multi_handle, &fdread, &fdwrite, &fdexcep, &maxfd);
-
-        if (mc != CURLM_OK) {
-          fprintf(stderr, "curl_multi_fdset() failed, code %d.\n", mc);
-          break;
-        }
-
-        /* On success the value of maxfd is guaranteed to be >= -1. We call
-         select(maxfd + 1, ...); specially in case of (maxfd == -1) there are
-         no fds ready yet so we call select(0, ...) --or Sleep() on Windows--
-         to sleep 100ms, which is the minimum suggested value in the
-         curl_multi_fdset() doc. */
-
-        if (maxfd == -1) {
-          /* Portable sleep for platforms other than Windows. */
-          struct timeval wait = {0, 100 * 1000}; /* 100ms */
-          rc = select(0, NULL, NULL, NULL, &wait);
-        } else {
-          /* Note that on some platforms 'timeout' may be modified by select().
-           If you need access to the original value save a copy beforehand. */
-          rc = select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-        }
-
-        switch (rc) {
-        case -1:
-          /* select error */
-          break;
-        case 0:
-        default:
-          /* timeout or readable/writable sockets */
-          curl_multi_perform(multi_handle, &still_running);
-          break;
-        }
-      }
-
-      long response_code;
-      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-
-      res = curl_multi_cleanup(multi_handle);
+      Upload_Engine::Result res = upload_engine->perform(curl);
+      long response_code = res.response_code;
 
       /* always cleanup */
       curl_easy_cleanup(curl);
@@ -296,7 +221,7 @@ public:
       /* free slist */
       curl_slist_free_all(headerlist);
 
-      if (res == CURLM_OK && response_code == 200) {
+      if (res.code == CURLE_OK && response_code == 200) {
         struct stat file_info;
         stat(call_info.converted.c_str(), &file_info);
         std::string loghdr = log_header(call_info.short_name,call_info.call_num,call_info.talkgroup_display,call_info.freq);
@@ -331,10 +256,14 @@ public:
     return 1;
   }
 
-  int call_end(Call_Data_t call_info) {
+  int call_end_view(const Call_Data_t &call_info) {
     return upload(call_info);
   }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_CALL_END;
+  }
+
   int parse_config(json config_data) {
     // Extract plugin name from config, with fallback for default internal plugin name
     std::string config_name = config_data.value("name", "openmhz_uploader");
@@ -379,23 +308,12 @@ public:
       return 1;
     }
 
-    // Initialize shared curl cache to reduce DNS lookups (5 min TTL)
-    curl_share = curl_share_init();
-    curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_lock_cb);
-    curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_unlock_cb);
-    curl_dns_ttl = 300;
-
     return 0;
   }
 
-  // curl callbacks
-  static void curl_lock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.lock();
-  }
-
-  static void curl_unlock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.unlock();
+  int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) {
+    upload_engine = config->upload_engine;
+    return Plugin_Api::init(config, sources, systems);
   }
 
   /*
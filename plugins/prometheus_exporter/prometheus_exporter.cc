@@ -0,0 +1,559 @@
+#include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/source.h"
+#include "../../trunk-recorder/systems/system.h"
+#include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
+#include <boost/log/trivial.hpp>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Prometheus_Exporter
+ *   Serves the counters below at /metrics, in the Prometheus text format,
+ *   from a thread of its own.
+ *
+ * The hooks only store numbers into atomics. The slots they go in, and the
+ * labels for them, are made in init() from the Systems and Sources, which
+ * don't change after that, so the hooks never allocate or build a string.
+ * Everything is formatted when /metrics is scraped.
+ *
+ * Call_Latency only hands out percentiles, so the grant latencies are
+ * summaries rather than histograms. Like them, the Call_Concluder's load is
+ * as of the last time the status was printed.
+ */
+class Prometheus_Exporter : public Plugin_Api {
+  static const int MAX_RECORDERS = 1024;
+
+  struct System_Metrics {
+    std::string labels;
+    std::atomic<double> decode_rate;
+    std::atomic<uint64_t> messages;
+    std::atomic<uint64_t> calls_started;
+    std::atomic<uint64_t> calls_ended;
+    System_Metrics() : decode_rate(0), messages(0), calls_started(0), calls_ended(0) {}
+  };
+
+  struct Source_Metrics {
+    std::string labels;
+    std::atomic<double> rate;
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> overflows;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> preempted;
+    Source_Metrics() : rate(0), samples(0), overflows(0), dropped(0), preempted(0) {}
+  };
+
+  // -1 in source until the recorder has been seen
+  struct Recorder_Metrics {
+    std::atomic<int> source;
+    std::atomic<int> type;
+    std::atomic<int> state;
+    Recorder_Metrics() : source(-1), type(0), state(INACTIVE) {}
+  };
+
+  struct Stage_Metrics {
+    std::atomic<double> p50;
+    std::atomic<double> p90;
+    std::atomic<double> p99;
+    std::atomic<double> max;
+    std::atomic<long> count;
+    Stage_Metrics() : p50(0), p90(0), p99(0), max(0), count(0) {}
+  };
+
+  enum Stage { GRANT_TO_START,
+               START_TO_RETUNE,
+               RETUNE_TO_FRAME,
+               FRAME_TO_WRITE,
+               GRANT_TO_WRITE,
+               NUM_STAGES };
+
+  struct Latency_Metrics {
+    std::string type;
+    std::string name;
+    std::string labels;
+    std::atomic<long> calls;
+    std::atomic<long> no_audio;
+    std::atomic<long> pre_tuned;
+    Stage_Metrics stages[NUM_STAGES];
+    Latency_Metrics() : calls(0), no_audio(0), pre_tuned(0) {}
+  };
+
+  std::string address;
+  int port;
+  int listen_fd;
+  std::atomic<bool> running;
+  std::thread server;
+  std::atomic<uint64_t> scrapes;
+
+  std::map<int, size_t> system_index; // sys_num to slot
+  std::map<int, size_t> source_index; // source num to slot
+  std::unique_ptr<System_Metrics[]> system_metrics;
+  std::unique_ptr<Source_Metrics[]> source_metrics;
+  std::unique_ptr<Latency_Metrics[]> latency_metrics;
+  size_t system_count;
+  size_t source_count;
+  size_t latency_count;
+  Recorder_Metrics recorder_metrics[MAX_RECORDERS];
+
+  std::atomic<long> concluder_calls_pending;
+  std::atomic<int> concluder_workers_busy;
+  std::atomic<long long> concluder_bytes_pending;
+  std::atomic<double> concluder_oldest_seconds;
+
+public:
+  Prometheus_Exporter() : address("0.0.0.0"), port(9580), listen_fd(-1), running(false), scrapes(0), system_count(0), source_count(0), latency_count(0), concluder_calls_pending(0), concluder_workers_busy(0), concluder_bytes_pending(0), concluder_oldest_seconds(0) {}
+
+  static std::string escape_label(const std::string &value) {
+    std::string out;
+    for (std::string::const_iterator it = value.begin(); it != value.end(); ++it) {
+      if (*it == '\\' || *it == '"') {
+        out += '\\';
+        out += *it;
+      } else if (*it == '\n') {
+        out += "\\n";
+      } else {
+        out += *it;
+      }
+    }
+    return out;
+  }
+
+  unsigned int hooks() {
+    return PLUGIN_HOOK_CALL_START | PLUGIN_HOOK_CALL_END | PLUGIN_HOOK_SETUP_RECORDER | PLUGIN_HOOK_SYSTEM_RATES | PLUGIN_HOOK_SOURCE_RATES | PLUGIN_HOOK_CALL_LATENCY | PLUGIN_HOOK_CONCLUDER_LOAD;
+  }
+
+  int parse_config(json config_data) {
+    address = config_data.value("address", "0.0.0.0");
+    port = config_data.value("port", 9580);
+    BOOST_LOG_TRIVIAL(info) << " Prometheus Exporter Address: " << address << " Port: " << port;
+    return 0;
+  }
+
+  int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) {
+    frequency_format = config->frequency_format;
+
+    system_count = systems.size();
+    source_count = sources.size();
+    latency_count = system_count + source_count;
+    system_metrics.reset(new System_Metrics[system_count]);
+    source_metrics.reset(new Source_Metrics[source_count]);
+    latency_metrics.reset(new Latency_Metrics[latency_count]);
+
+    for (size_t i = 0; i < system_count; i++) {
+      System *sys = systems[i];
+      system_index[sys->get_sys_num()] = i;
+      system_metrics[i].labels = "system=\"" + escape_label(sys->get_short_name()) + "\"";
+      latency_metrics[i].type = "system";
+      latency_metrics[i].name = sys->get_short_name();
+      latency_metrics[i].labels = system_metrics[i].labels;
+    }
+    for (size_t i = 0; i < source_count; i++) {
+      Source *source = sources[i];
+      source_index[source->get_num()] = i;
+      source_metrics[i].labels = "source=\"" + std::to_string(source->get_num()) + "\"";
+      latency_metrics[system_count + i].type = "source";
+      latency_metrics[system_count + i].name = std::to_string(source->get_num());
+      latency_metrics[system_count + i].labels = source_metrics[i].labels;
+    }
+    return 0;
+  }
+
+  int start() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+      BOOST_LOG_TRIVIAL(error) << "Prometheus Exporter - socket failed: " << strerror(errno);
+      return 1;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+      BOOST_LOG_TRIVIAL(error) << "Prometheus Exporter - address is not an IPv4 address: " << address;
+      close(listen_fd);
+      listen_fd = -1;
+      return 1;
+    }
+    if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(listen_fd, 8) < 0)) {
+      BOOST_LOG_TRIVIAL(error) << "Prometheus Exporter - could not listen on " << address << ":" << port << " : " << strerror(errno);
+      close(listen_fd);
+      listen_fd = -1;
+      return 1;
+    }
+
+    running = true;
+    server = std::thread(&Prometheus_Exporter::run, this);
+    BOOST_LOG_TRIVIAL(info) << "Prometheus Exporter serving http://" << address << ":" << port << "/metrics";
+    return 0;
+  }
+
+  int stop() {
+    if (!running.exchange(false)) {
+      return 0;
+    }
+    // The server checks running between polls
+    server.join();
+    close(listen_fd);
+    listen_fd = -1;
+    return 0;
+  }
+
+  /* -- Hooks, these only store numbers -- */
+
+  int system_rates_view(const std::vector<System *> &systems, float timeDiff) {
+    for (std::vector<System *>::const_iterator it = systems.begin(); it != systems.end(); ++it) {
+      std::map<int, size_t>::const_iterator index = system_index.find((*it)->get_sys_num());
+      if (index == system_index.end()) {
+        continue;
+      }
+      System_Metrics &metrics = system_metrics[index->second];
+      int count = (*it)->get_message_count();
+      metrics.messages.fetch_add(count, std::memory_order_relaxed);
+      metrics.decode_rate.store(timeDiff > 0 ? count / timeDiff : 0, std::memory_order_relaxed);
+    }
+    return 0;
+  }
+
+  int source_rates_view(const std::vector<Source *> &sources, float timeDiff) {
+    for (std::vector<Source *>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+      Source *source = *it;
+      std::map<int, size_t>::const_iterator index = source_index.find(source->get_num());
+      if (index == source_index.end()) {
+        continue;
+      }
+      Source_Metrics &metrics = source_metrics[index->second];
+      metrics.rate.store(source->get_stats_rate(), std::memory_order_relaxed);
+      metrics.samples.store(source->get_stats_samples(), std::memory_order_relaxed);
+      metrics.overflows.store(source->get_stats_overflows(), std::memory_order_relaxed);
+      metrics.dropped.store(source->get_stats_dropped(), std::memory_order_relaxed);
+      metrics.preempted.store(source->get_preempted_calls(), std::memory_order_relaxed);
+
+      // Picks up the state changes that don't come through setup_recorder()
+      std::vector<Recorder *> recorders = source->get_recorders();
+      for (std::vector<Recorder *>::iterator rec = recorders.begin(); rec != recorders.end(); ++rec) {
+        update_recorder(*rec, index->second);
+      }
+    }
+    return 0;
+  }
+
+  void update_recorder(Recorder *recorder, int source) {
+    int num = recorder->get_num();
+    if ((num < 0) || (num >= MAX_RECORDERS)) {
+      return;
+    }
+    Recorder_Metrics &metrics = recorder_metrics[num];
+    metrics.type.store(recorder->get_type(), std::memory_order_relaxed);
+    metrics.state.store(recorder->get_state(), std::memory_order_relaxed);
+    metrics.source.store(source, std::memory_order_release);
+  }
+
+  int setup_recorder(Recorder *recorder) {
+    Source *source = recorder->get_source();
+    if (!source) {
+      return 0;
+    }
+    std::map<int, size_t>::const_iterator index = source_index.find(source->get_num());
+    if (index != source_index.end()) {
+      update_recorder(recorder, index->second);
+    }
+    return 0;
+  }
+
+  int call_start(Call *call) {
+    std::map<int, size_t>::const_iterator index = system_index.find(call->get_sys_num());
+    if (index != system_index.end()) {
+      system_metrics[index->second].calls_started.fetch_add(1, std::memory_order_relaxed);
+    }
+    return 0;
+  }
+
+  // Called from the Call_Concluder's workers
+  int call_end_view(const Call_Data_t &call_info) {
+    std::map<int, size_t>::const_iterator index = system_index.find(call_info.sys_num);
+    if (index != system_index.end()) {
+      system_metrics[index->second].calls_ended.fetch_add(1, std::memory_order_relaxed);
+    }
+    return 0;
+  }
+
+  static void store_stage(Stage_Metrics &metrics, const Latency_Summary &summary) {
+    metrics.p50.store(summary.p50_ms / 1000.0, std::memory_order_relaxed);
+    metrics.p90.store(summary.p90_ms / 1000.0, std::memory_order_relaxed);
+    metrics.p99.store(summary.p99_ms / 1000.0, std::memory_order_relaxed);
+    metrics.max.store(summary.max_ms / 1000.0, std::memory_order_relaxed);
+    metrics.count.store(summary.count, std::memory_order_relaxed);
+  }
+
+  int call_latency(const std::vector<Call_Latency_Stats> &stats) {
+    for (std::vector<Call_Latency_Stats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+      for (size_t i = 0; i < latency_count; i++) {
+        Latency_Metrics &metrics = latency_metrics[i];
+        if ((metrics.type != it->type) || (metrics.name != it->name)) {
+          continue;
+        }
+        metrics.calls.store(it->calls, std::memory_order_relaxed);
+        metrics.no_audio.store(it->no_audio, std::memory_order_relaxed);
+        metrics.pre_tuned.store(it->pre_tuned, std::memory_order_relaxed);
+        store_stage(metrics.stages[GRANT_TO_START], it->grant_to_start);
+        store_stage(metrics.stages[START_TO_RETUNE], it->start_to_retune);
+        store_stage(metrics.stages[RETUNE_TO_FRAME], it->retune_to_frame);
+        store_stage(metrics.stages[FRAME_TO_WRITE], it->frame_to_write);
+        store_stage(metrics.stages[GRANT_TO_WRITE], it->grant_to_write);
+        break;
+      }
+    }
+    return 0;
+  }
+
+  int concluder_load(const Concluder_Load &load) {
+    concluder_calls_pending.store(load.calls_pending, std::memory_order_relaxed);
+    concluder_workers_busy.store(load.workers_busy, std::memory_order_relaxed);
+    concluder_bytes_pending.store(load.bytes_pending, std::memory_order_relaxed);
+    concluder_oldest_seconds.store(load.oldest_seconds, std::memory_order_relaxed);
+    return 0;
+  }
+
+  /* -- Scraping -- */
+
+  static const char *state_name(int state) {
+    switch (state) {
+    case MONITORING:
+      return "monitoring";
+    case RECORDING:
+      return "recording";
+    case INACTIVE:
+      return "inactive";
+    case ACTIVE:
+      return "active";
+    case IDLE:
+      return "idle";
+    case STOPPED:
+      return "stopped";
+    case AVAILABLE:
+      return "available";
+    case IGNORE:
+      return "ignore";
+    default:
+      return "unknown";
+    }
+  }
+
+  static const char *type_name(int type) {
+    switch (type) {
+    case DEBUG:
+      return "debug";
+    case SIGMF:
+      return "sigmf";
+    case SIGMFC:
+      return "sigmfc";
+    case ANALOG:
+      return "analog";
+    case ANALOGC:
+      return "analogc";
+    case P25:
+      return "p25";
+    case P25C:
+      return "p25c";
+    case DMR:
+      return "dmr";
+    case SMARTNET:
+      return "smartnet";
+    default:
+      return "unknown";
+    }
+  }
+
+  static void header(std::ostringstream &out, const char *name, const char *type, const char *help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+  }
+
+  std::string format_metrics() {
+    std::ostringstream out;
+
+    header(out, "trunk_recorder_system_decode_rate", "gauge", "Control channel messages decoded per second");
+    for (size_t i = 0; i < system_count; i++) {
+      out << "trunk_recorder_system_decode_rate{" << system_metrics[i].labels << "} " << system_metrics[i].decode_rate.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_system_messages_total", "counter", "Control channel messages decoded");
+    for (size_t i = 0; i < system_count; i++) {
+      out << "trunk_recorder_system_messages_total{" << system_metrics[i].labels << "} " << system_metrics[i].messages.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_calls_started_total", "counter", "Calls started");
+    for (size_t i = 0; i < system_count; i++) {
+      out << "trunk_recorder_calls_started_total{" << system_metrics[i].labels << "} " << system_metrics[i].calls_started.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_calls_ended_total", "counter", "Calls concluded");
+    for (size_t i = 0; i < system_count; i++) {
+      out << "trunk_recorder_calls_ended_total{" << system_metrics[i].labels << "} " << system_metrics[i].calls_ended.load(std::memory_order_relaxed) << "\n";
+    }
+
+    header(out, "trunk_recorder_source_sample_rate", "gauge", "Samples per second the source delivered");
+    for (size_t i = 0; i < source_count; i++) {
+      out << "trunk_recorder_source_sample_rate{" << source_metrics[i].labels << "} " << source_metrics[i].rate.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_source_samples_total", "counter", "Samples the source delivered");
+    for (size_t i = 0; i < source_count; i++) {
+      out << "trunk_recorder_source_samples_total{" << source_metrics[i].labels << "} " << source_metrics[i].samples.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_source_overflows_total", "counter", "Overflows the SDR reported");
+    for (size_t i = 0; i < source_count; i++) {
+      out << "trunk_recorder_source_overflows_total{" << source_metrics[i].labels << "} " << source_metrics[i].overflows.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_source_dropped_samples_total", "counter", "Samples the source fell short of its rate by");
+    for (size_t i = 0; i < source_count; i++) {
+      out << "trunk_recorder_source_dropped_samples_total{" << source_metrics[i].labels << "} " << source_metrics[i].dropped.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_source_preempted_calls_total", "counter", "Calls stopped to give their recorder to a call that matters more");
+    for (size_t i = 0; i < source_count; i++) {
+      out << "trunk_recorder_source_preempted_calls_total{" << source_metrics[i].labels << "} " << source_metrics[i].preempted.load(std::memory_order_relaxed) << "\n";
+    }
+
+    // source, type, state
+    std::map<std::pair<int, std::pair<int, int>>, int> recorders;
+    for (int i = 0; i < MAX_RECORDERS; i++) {
+      int source = recorder_metrics[i].source.load(std::memory_order_acquire);
+      if (source < 0) {
+        continue;
+      }
+      recorders[std::make_pair(source, std::make_pair(recorder_metrics[i].type.load(std::memory_order_relaxed), recorder_metrics[i].state.load(std::memory_order_relaxed)))]++;
+    }
+    header(out, "trunk_recorder_recorders", "gauge", "Recorders in each state");
+    for (std::map<std::pair<int, std::pair<int, int>>, int>::iterator it = recorders.begin(); it != recorders.end(); ++it) {
+      out << "trunk_recorder_recorders{" << source_metrics[it->first.first].labels << ",type=\"" << type_name(it->first.second.first) << "\",state=\"" << state_name(it->first.second.second) << "\"} " << it->second << "\n";
+    }
+
+    header(out, "trunk_recorder_concluder_calls_pending", "gauge", "Calls queued or being concluded");
+    out << "trunk_recorder_concluder_calls_pending " << concluder_calls_pending.load(std::memory_order_relaxed) << "\n";
+    header(out, "trunk_recorder_concluder_workers_busy", "gauge", "Concluder workers concluding a call");
+    out << "trunk_recorder_concluder_workers_busy " << concluder_workers_busy.load(std::memory_order_relaxed) << "\n";
+    header(out, "trunk_recorder_concluder_bytes_pending", "gauge", "Bytes of audio in the calls waiting to be concluded");
+    out << "trunk_recorder_concluder_bytes_pending " << concluder_bytes_pending.load(std::memory_order_relaxed) << "\n";
+    header(out, "trunk_recorder_concluder_oldest_seconds", "gauge", "Seconds the longest waiting call has been queued");
+    out << "trunk_recorder_concluder_oldest_seconds " << concluder_oldest_seconds.load(std::memory_order_relaxed) << "\n";
+
+    header(out, "trunk_recorder_latency_calls_total", "counter", "Recorded calls concluded");
+    for (size_t i = 0; i < latency_count; i++) {
+      out << "trunk_recorder_latency_calls_total{" << latency_metrics[i].labels << "} " << latency_metrics[i].calls.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_latency_no_audio_calls_total", "counter", "Recorded calls that never wrote a sample");
+    for (size_t i = 0; i < latency_count; i++) {
+      out << "trunk_recorder_latency_no_audio_calls_total{" << latency_metrics[i].labels << "} " << latency_metrics[i].no_audio.load(std::memory_order_relaxed) << "\n";
+    }
+    header(out, "trunk_recorder_latency_pre_tuned_calls_total", "counter", "Recorded calls whose recorder was already tuned to the channel");
+    for (size_t i = 0; i < latency_count; i++) {
+      out << "trunk_recorder_latency_pre_tuned_calls_total{" << latency_metrics[i].labels << "} " << latency_metrics[i].pre_tuned.load(std::memory_order_relaxed) << "\n";
+    }
+
+    static const char *stage_names[NUM_STAGES] = {"grant_to_start", "start_to_retune", "retune_to_frame", "frame_to_write", "grant_to_write"};
+    for (int stage = 0; stage < NUM_STAGES; stage++) {
+      std::string name = std::string("trunk_recorder_") + stage_names[stage] + "_seconds";
+      header(out, name.c_str(), "summary", "Call latency from the grant, by stage");
+      for (size_t i = 0; i < latency_count; i++) {
+        Stage_Metrics &metrics = latency_metrics[i].stages[stage];
+        const std::string &labels = latency_metrics[i].labels;
+        out << name << "{" << labels << ",quantile=\"0.5\"} " << metrics.p50.load(std::memory_order_relaxed) << "\n";
+        out << name << "{" << labels << ",quantile=\"0.9\"} " << metrics.p90.load(std::memory_order_relaxed) << "\n";
+        out << name << "{" << labels << ",quantile=\"0.99\"} " << metrics.p99.load(std::memory_order_relaxed) << "\n";
+        out << name << "{" << labels << ",quantile=\"1\"} " << metrics.max.load(std::memory_order_relaxed) << "\n";
+        out << name << "_count{" << labels << "} " << metrics.count.load(std::memory_order_relaxed) << "\n";
+      }
+    }
+
+    header(out, "trunk_recorder_exporter_scrapes_total", "counter", "Times /metrics has been scraped");
+    out << "trunk_recorder_exporter_scrapes_total " << scrapes.load(std::memory_order_relaxed) << "\n";
+    return out.str();
+  }
+
+  static bool send_all(int fd, const std::string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+      ssize_t sent = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      done += sent;
+    }
+    return true;
+  }
+
+  // One request per connection, the scraper opens a new one each time
+  void handle(int fd) {
+    struct timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+      ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+      if (got <= 0) {
+        break;
+      }
+      request.append(buffer, got);
+    }
+
+    std::string status;
+    std::string body;
+    if ((request.compare(0, 13, "GET /metrics ") == 0) || (request.compare(0, 13, "GET /metrics?") == 0)) {
+      scrapes.fetch_add(1, std::memory_order_relaxed);
+      status = "200 OK";
+      body = format_metrics();
+    } else {
+      status = "404 Not Found";
+      body = "Metrics are at /metrics\n";
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    send_all(fd, response.str());
+  }
+
+  void run() {
+    while (running.load()) {
+      struct pollfd pfd;
+      pfd.fd = listen_fd;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, 500) <= 0) {
+        continue;
+      }
+      int fd = accept(listen_fd, NULL, NULL);
+      if (fd < 0) {
+        continue;
+      }
+      handle(fd);
+      close(fd);
+    }
+  }
+
+  // Factory method
+  static boost::shared_ptr<Prometheus_Exporter> create() {
+    return boost::shared_ptr<Prometheus_Exporter>(
+        new Prometheus_Exporter());
+  }
+};
+
+BOOST_DLL_ALIAS(
+    Prometheus_Exporter::create, // <-- this function is exported with...
+    create_plugin                // <-- ...this alias name
+)
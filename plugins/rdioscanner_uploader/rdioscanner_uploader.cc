@@ -5,6 +5,7 @@
 
 #include "../../trunk-recorder/call_concluder/call_concluder.h"
 #include "../../trunk-recorder/plugin_manager/plugin_api.h"
+#include "../../trunk-recorder/upload_engine.h"
 #include "../trunk-recorder/gr_blocks/decoder_wrapper.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
@@ -32,12 +33,9 @@ struct Rdio_Scanner_Uploader_Data {
   std::string server;
 };
 
-boost::mutex curl_share_mutex;
-
 class Rdio_Scanner_Uploader : public Plugin_Api {
   Rdio_Scanner_Uploader_Data data;
-  CURLSH *curl_share;
-  long curl_dns_ttl;
+  Upload_Engine *upload_engine;
   std::string plugin_name;
 
 private:
@@ -142,7 +140,7 @@ private:
     }
 
 public:
-  Rdio_Scanner_Uploader() : curl_share(NULL), curl_dns_ttl(300) {}
+  Rdio_Scanner_Uploader() : upload_engine(NULL) {}
 
   Rdio_Scanner_System *get_system(std::string short_name) {
     for (std::vector<Rdio_Scanner_System>::iterator it = data.systems.begin(); it != data.systems.end(); ++it) {
@@ -158,7 +156,7 @@ public:
     return size * nmemb;
   }
 
-  int upload(Call_Data_t call_info) {
+  int upload(const Call_Data_t &call_info) {
     std::string api_key;
     uint32_t system_id = 0;
     std::string talkgroup_group = call_info.talkgroup_group;
@@ -282,9 +280,6 @@ public:
 
     // BOOST_LOG_TRIVIAL(error) << "Got source list: " << source_list.str();
 
-    CURLMcode res = CURLM_OK;
-    CURLM *multi_handle = NULL;
-    int still_running = 0;
     std::string response_buffer;
     freq_string = freq.str();
 
@@ -331,7 +326,12 @@ public:
     mime = curl_mime_init(curl);
     part = curl_mime_addpart(mime);
 
-    curl_mime_filedata(part, (compress_wav ? call_info.converted : call_info.filename).c_str());
+    if (compress_wav && call_info.converted_audio) {
+      Upload_Engine::set_mime_audio(part, call_info.converted_audio);
+      curl_mime_filename(part, audioName.c_str());
+    } else {
+      curl_mime_filedata(part, (compress_wav ? call_info.converted : call_info.filename).c_str());
+    }
     curl_mime_type(part, "application/octet-stream"); /* content-type for this part */
     curl_mime_name(part, "audio");
 
@@ -400,8 +400,6 @@ public:
     curl_mime_data(part, call_info.short_name.c_str(), CURL_ZERO_TERMINATED);
     curl_mime_name(part, "systemLabel");
 
-    multi_handle = curl_multi_init();
-
     /* initialize custom header list (stating that Expect: 100-continue is not wanted */
     headerlist = curl_slist_append(headerlist, "Expect:");
 
@@ -414,7 +412,7 @@ public:
     long response_code = 0;
     CURLcode easy_result = CURLE_OK;
 
-    if (curl && multi_handle) {
+    if (curl) {
       /* what URL that receives this POST */
       curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
@@ -425,95 +423,9 @@ public:
       curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
       curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buffer);
 
-      if (curl_share) {
-        curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
-        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, curl_dns_ttl);
-      }
-
-      curl_multi_add_handle(multi_handle, curl);
-
-      curl_multi_perform(multi_handle, &still_running);
-
-      while (still_running) {
-        timeval timeout{};
-        int rc;       /* select() return code */
-        CURLMcode mc; /* curl_multi_fdset() return code */
-
-        fd_set fdread;
-        fd_set fdwrite;
-        fd_set fdexcep;
-        int maxfd = -1;
-
-        long curl_timeo = -1;
-
-        FD_ZERO(&fdread);
-        FD_ZERO(&fdwrite);
-        FD_ZERO(&fdexcep);
-
-        /* set a suitable timeout to play around with */
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-
-        curl_multi_timeout(multi_handle, &curl_timeo);
-        if (curl_timeo >= 0) {
-          timeout.tv_sec = curl_timeo / 1000;
-          if (timeout.tv_sec > 1)
-            timeout.tv_sec = 1;
-          else
-            timeout.tv_usec = (curl_timeo % 1000) * 1000;
-        }
-
-        /* get file descriptors from the transfers */
-        mc = curl_multi_fdset(multi_handle, &fdread, &fdwrite, &fdexcep, &maxfd);
-
-        if (mc != CURLM_OK) {
-          fprintf(stderr, "curl_multi_fdset() failed, code %d.\n", mc);
-          break;
-        }
-
-        /* On success the value of maxfd is guaranteed to be >= -1. We call
-         select(maxfd + 1, ...); specially in case of (maxfd == -1) there are
-         no fds ready yet so we call select(0, ...) --or Sleep() on Windows--
-         to sleep 100ms, which is the minimum suggested value in the
-         curl_multi_fdset() doc. */
-
-        if (maxfd == -1) {
-          /* Portable sleep for platforms other than Windows. */
-          struct timeval wait = {0, 100 * 1000}; /* 100ms */
-          rc = select(0, NULL, NULL, NULL, &wait);
-        } else {
-          /* Note that on some platforms 'timeout' may be modified by select().
-           If you need access to the original value save a copy beforehand. */
-          rc = select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
-        }
-
-        switch (rc) {
-        case -1:
-          /* select error */
-          break;
-        case 0:
-        default:
-          /* timeout or readable/writable sockets */
-          curl_multi_perform(multi_handle, &still_running);
-          break;
-        }
-      }
-
-      // Extract the transfer result (CURLcode) from the multi handle
-      {
-        int msgs_left = 0;
-        CURLMsg* msg = NULL;
-        while ((msg = curl_multi_info_read(multi_handle, &msgs_left))) {
-          if (msg->msg == CURLMSG_DONE) {
-            easy_result = msg->data.result;
-          }
-        }
-      }
-
-      // Grab HTTP status BEFORE cleaning up easy handle (important!)
-      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
-
-      res = curl_multi_cleanup(multi_handle);
+      Upload_Engine::Result res = upload_engine->perform(curl);
+      easy_result = res.code;
+      response_code = res.response_code;
 
       /* always cleanup */
       curl_easy_cleanup(curl);
@@ -525,7 +437,7 @@ public:
       curl_slist_free_all(headerlist);
 
       // NOTE: Your API may legitimately return 202 for stub-cache accepts.
-      if (res == CURLM_OK && easy_result == CURLE_OK && is_success_http_status(response_code)) {
+      if (easy_result == CURLE_OK && is_success_http_status(response_code)) {
         struct stat file_info{};
         stat((compress_wav ? call_info.converted : call_info.filename).c_str(), &file_info);
         std::string loghdr = log_header(call_info.short_name,call_info.call_num,call_info.talkgroup_display,call_info.freq);
@@ -552,10 +464,14 @@ public:
     return 1;
   }
 
-  int call_end(Call_Data_t call_info) {
+  int call_end_view(const Call_Data_t &call_info) {
     return upload(call_info);
   }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_CALL_END;
+  }
+
   int parse_config(json config_data) {
     // Extract plugin name from config, with fallback for default internal plugin name
     std::string config_name = config_data.value("name", "rdioscanner_uploader");
@@ -631,23 +547,12 @@ public:
       return 1;
     }
 
-    // Initialize shared curl cache to reduce DNS lookups (5 min TTL)
-    curl_share = curl_share_init();
-    curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, curl_lock_cb);
-    curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, curl_unlock_cb);
-    curl_dns_ttl = 300;
-
     return 0;
   }
 
-  // curl callbacks
-  static void curl_lock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.lock();
-  }
-
-  static void curl_unlock_cb(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
-    curl_share_mutex.unlock();
+  int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) {
+    upload_engine = config->upload_engine;
+    return Plugin_Api::init(config, sources, systems);
   }
 
   /*
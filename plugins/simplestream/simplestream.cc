@@ -4,6 +4,15 @@
 #include <boost/foreach.hpp>
 #include <boost/asio.hpp>
 #include <boost/array.hpp>
+#include <array>
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef HAVE_OPUS
+#include <opus.h>
+#endif
 
 using namespace boost::asio;
 
@@ -30,20 +39,188 @@ struct stream_t {
   bool sendCallStart = false;
   bool sendCallEnd = false;
   bool tcp = false;
+  bool opus = false;
 };
 
+// One packet that goes out for each piece of a call's audio
+struct route_t {
+  stream_t *stream;
+  int32_t TGID;
+  std::string json_string;
+  uint32_t json_length;
+};
+
+// What a recorder's audio is sent to, for the call it is on, and the
+// buffers its packets are put together in
+struct call_routes_t {
+  long call_num = -1;
+  long source_id = -2;
+  std::vector<route_t> routes;
+  bool has_opus = false;
+
+  // The UDP packets of one piece of audio, sent together
+  std::vector<struct iovec> iovs;  // MAX_IOVS for each packet
+#ifdef __linux__
+  std::vector<struct mmsghdr> msgs;
+#else
+  std::vector<struct msghdr> msgs;
+#endif
+  int packets = 0;
+
+#ifdef HAVE_OPUS
+  OpusEncoder *encoder = NULL;
+#endif
+  int opus_frame = 0;                  // samples in 20 ms
+  std::vector<int16_t> opus_pcm;       // samples waiting for a whole frame
+  std::vector<unsigned char> opus_data; // MAX_OPUS_PACKET for each frame
+  std::vector<int> opus_lengths;
+};
+
+static const int MAX_IOVS = 3;
+static const int MAX_OPUS_PACKET = 1275;
+
+// (shortName, TGID) to the streams configured for it, "" and 0 are the
+// streams that take every system or every talkgroup
+std::map<std::pair<std::string, long>, std::vector<stream_t *>> routing_table;
+std::mutex call_routes_mutex;
+std::map<Recorder *, call_routes_t> call_routes;
+
 class Simple_Stream : public Plugin_Api {
   typedef boost::asio::io_service io_service;
   io_service my_io_service;
   ip::udp::endpoint remote_endpoint;
   ip::udp::socket my_socket{my_io_service};
+  int opus_bitrate = 16000;
+  int multicast_ttl = 1;
+  std::string multicast_interface;
+  bool multicast_loopback = true;
   public:
   
   Simple_Stream(){
       
   }
 
+  // The streams a talkgroup on a system goes to, counting the ones that
+  // take every system or every talkgroup
+  void find_streams(const std::string &short_name, long TGID, std::vector<stream_t *> &found){
+    const std::pair<std::string, long> keys[4] = {{short_name, TGID}, {short_name, 0}, {"", TGID}, {"", 0}};
+    for (int i = 0; i < 4; i++){
+      if (((i == 1) && (TGID == 0)) || ((i >= 2) && short_name.empty()) || ((i == 3) && (TGID == 0))){
+        continue;  //the same key as one before it
+      }
+      std::map<std::pair<std::string, long>, std::vector<stream_t *>>::iterator it = routing_table.find(keys[i]);
+      if (it != routing_table.end()){
+        found.insert(found.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+
+  // Works out what is sent for each packet of audio from the recorder, once
+  // per call and again when the transmission changes
+  void update_routes(call_routes_t &entry, Call *call, Recorder *recorder){
+    entry.call_num = call->get_call_num();
+    entry.source_id = call->get_current_source_id();
+    entry.routes.clear();
+
+    System *call_system = call->get_system();
+    int32_t call_tgid = call->get_talkgroup();
+    int32_t call_src = entry.source_id;
+    uint32_t call_freq = call->get_freq();
+    std::string call_short_name = call->get_short_name();
+    std::vector<unsigned long> unsigned_patched_talkgroups = call_system->get_talkgroup_patch(call_tgid);
+    std::vector<long> patched_talkgroups;
+    // Convert unsigned long to signed long, preserving negative values
+    for (auto tgid : unsigned_patched_talkgroups) {
+      patched_talkgroups.push_back(static_cast<long>(tgid));
+    }
+    if (patched_talkgroups.size() == 0){
+      patched_talkgroups.push_back(call_tgid);  //call_info.talkgroup may be negative - we cast stream.TGID to signed for comparison
+    }
+
+    if(call_src == -1){
+      std::vector<Transmission> transmissions = call->get_transmissions();
+      if(transmissions.size() > 0){
+        // Get the source from the most recent transmission
+        call_src = transmissions.back().source;
+        BOOST_LOG_TRIVIAL(debug) << "using source " << call_src << " from most recent transmission";
+      }
+      else{
+        BOOST_LOG_TRIVIAL(debug) << "no source found for call - leaving src as -1";
+      }
+    }
+    std::string call_src_tag = call_system->find_unit_tag(call_src);
+    long wav_hz = recorder->get_wav_hz();
+    entry.has_opus = false;
+
+    std::vector<stream_t *> found;
+    for (long TGID : patched_talkgroups){
+      found.clear();
+      find_streams(call_short_name, TGID, found);
+      for (stream_t *stream : found){
+        BOOST_LOG_TRIVIAL(debug) << "streaming audio from recorder " << recorder->get_num() << " for TGID " << TGID << " to " << stream->address << " on port " << stream->port;
+        route_t route;
+        route.stream = stream;
+        route.TGID = TGID;
+        route.json_length = 0;
+        if (stream->sendJSON==true){
+          //create JSON metadata
+          json json_object = {
+             {"src", call_src},
+             {"src_tag",call_src_tag},
+             {"talkgroup", TGID},
+             {"patched_talkgroups",patched_talkgroups},
+             {"freq", call_freq},
+             {"short_name", call_short_name},
+             {"audio_sample_rate",wav_hz},
+             {"event","audio"},
+          };
+          if (stream->opus){
+            json_object["codec"] = "opus";
+          }
+          route.json_string = json_object.dump();
+          route.json_length = route.json_string.length();  //determine length in bytes
+        }
+        entry.routes.push_back(route);
+        entry.has_opus = entry.has_opus || stream->opus;
+      }
+    }
+    setup_opus(entry, wav_hz);
+  }
+
+  // One encoder for each recorder, the frames it makes go to every Opus
+  // stream the call is routed to
+  void setup_opus(call_routes_t &entry, long wav_hz){
+    entry.opus_pcm.clear();
+#ifdef HAVE_OPUS
+    if (!entry.has_opus){
+      return;
+    }
+    if (entry.encoder && (entry.opus_frame == wav_hz / 50)){
+      opus_encoder_ctl(entry.encoder, OPUS_RESET_STATE);
+      return;
+    }
+    if (entry.encoder){
+      opus_encoder_destroy(entry.encoder);
+      entry.encoder = NULL;
+    }
+    int err = OPUS_OK;
+    entry.encoder = opus_encoder_create(wav_hz, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK){
+      BOOST_LOG_TRIVIAL(error) << "simplestream failed to create an Opus encoder at " << wav_hz << " Hz: " << opus_strerror(err);
+      entry.encoder = NULL;
+      return;
+    }
+    opus_encoder_ctl(entry.encoder, OPUS_SET_BITRATE(opus_bitrate));
+    entry.opus_frame = wav_hz / 50;
+    entry.opus_pcm.reserve(entry.opus_frame * 2);
+#endif
+  }
+
  int parse_config(json config_data) {
+    opus_bitrate = config_data.value("opusBitrate", 16000);
+    multicast_ttl = config_data.value("multicastTTL", 1);
+    multicast_interface = config_data.value("multicastInterface", "");
+    multicast_loopback = config_data.value("multicastLoopback", true);
     for (json element : config_data["streams"]) {
       stream_t stream;
       stream.TGID = element["TGID"];
@@ -56,88 +233,158 @@ class Simple_Stream : public Plugin_Api {
       stream.sendCallEnd = element.value("sendCallEnd",false);
       stream.tcp = element.value("useTCP",false);
       stream.short_name = element.value("shortName", "");
+      std::string codec = element.value("codec", "pcm");
+      if (codec == "opus"){
+#ifdef HAVE_OPUS
+        stream.opus = true;
+#else
+        BOOST_LOG_TRIVIAL(error) << "simplestream was built without Opus, streaming PCM to " << stream.address << " on port " << stream.port;
+#endif
+      } else if (codec != "pcm"){
+        BOOST_LOG_TRIVIAL(error) << "simplestream unknown codec: " << codec << ", it should be pcm or opus. Using pcm";
+      }
       BOOST_LOG_TRIVIAL(info) << "simplestreamer will stream audio from TGID " <<stream.TGID << " on System " <<stream.short_name << " to " << stream.address <<" on port " << stream.port << " tcp is "<<stream.tcp;
       streams.push_back(stream);
     }
+    // The streams don't move once they are all in
+    for (stream_t &stream : streams){
+      routing_table[std::make_pair(stream.short_name, stream.TGID)].push_back(&stream);
+    }
     return 0;
   }
   
   int audio_stream(Call *call, Recorder *recorder, int16_t *samples, int sampleCount){
-    //Call local_call = *call;
-    System *call_system = call->get_system();
-    int32_t call_tgid = call->get_talkgroup();
-    int32_t call_src = call->get_current_source_id();
-    uint32_t call_freq = call->get_freq();
-    std::string call_short_name = call->get_short_name();
-    std::string call_src_tag = call_system->find_unit_tag(call_src);
-    std::vector<unsigned long> unsigned_patched_talkgroups = call_system->get_talkgroup_patch(call_tgid);
-    std::vector<long> patched_talkgroups;
-    // Convert unsigned long to signed long, preserving negative values
-    for (auto tgid : unsigned_patched_talkgroups) {
-      patched_talkgroups.push_back(static_cast<long>(tgid));
+    if (call == NULL){
+      return 0;
+    }
+    call_routes_t *entry;
+    {
+      std::lock_guard<std::mutex> lock(call_routes_mutex);
+      entry = &call_routes[recorder];
+    }
+    // Only the recorder's own thread uses its entry
+    if ((entry->call_num != call->get_call_num()) || (entry->source_id != call->get_current_source_id())){
+      update_routes(*entry, call, recorder);
     }
 
-    if(call_src == -1){
-      if(call->get_transmissions().size() > 0){
-        // Get the source from the most recent transmission
-        auto transmissions = call->get_transmissions();
-        call_src = transmissions.back().source;
-        BOOST_LOG_TRIVIAL(debug) << "using source " << call_src << " from most recent transmission";
+    int opus_frames = encode_opus(*entry, samples, sampleCount);
+    entry->packets = 0;
+    for (route_t &route : entry->routes){
+      if (!route.stream->opus){
+        add_packet(*entry, route, samples, sampleCount*2);
+        continue;
       }
-      else{
-        BOOST_LOG_TRIVIAL(debug) << "no source found for call - leaving src as -1";
+      for (int i = 0; i < opus_frames; i++){
+        add_packet(*entry, route, &entry->opus_data[i * MAX_OPUS_PACKET], entry->opus_lengths[i]);
       }
     }
+    send_packets(*entry);
+    return 0;
+  }
 
-    Recorder& local_recorder = *recorder;
-    int recorder_id = local_recorder.get_num();
-    long wav_hz = local_recorder.get_wav_hz();
-    boost::system::error_code error;
-    BOOST_FOREACH (auto stream, streams){
-      if (0==stream.short_name.compare(call_short_name) || (0==stream.short_name.compare(""))){ //Check if shortName matches or is not specified
-        if (patched_talkgroups.size() == 0){
-          patched_talkgroups.push_back(call_tgid);  //call_info.talkgroup may be negative - we cast stream.TGID to signed for comparison
-        }
-        BOOST_FOREACH (auto TGID, patched_talkgroups){
-          if ((TGID==static_cast<long>(stream.TGID)) || stream.TGID==0){  //setting TGID to 0 in the config file will stream everything
-            BOOST_LOG_TRIVIAL(debug) << "got " <<sampleCount <<" samples - " <<sampleCount*2<<" bytes from recorder "<<recorder_id<<" for TGID "<<TGID;
-            json json_object;
-            std::string json_string;
-            std::vector<boost::asio::const_buffer> send_buffer;
-            if (stream.sendJSON==true){
-              //create JSON metadata
-              json_object = {
-                 {"src", call_src},
-                 {"src_tag",call_src_tag},
-                 {"talkgroup", TGID},
-                 {"patched_talkgroups",patched_talkgroups},
-                 {"freq", call_freq},
-                 {"short_name", call_short_name},
-                 {"audio_sample_rate",wav_hz},
-                 {"event","audio"},
-              };
-              json_string = json_object.dump();
-              uint32_t json_length = json_string.length();  //determine length in bytes
-              //BOOST_LOG_TRIVIAL(debug) << "json_length is " <<json_length <<" bytes";
-              send_buffer.push_back(buffer(&json_length,4));  //prepend length of the json data
-              send_buffer.push_back(buffer(json_string));  //prepend json data
-              //BOOST_LOG_TRIVIAL(debug) << "json_string is " <<json_string;
-            }
-            else if (stream.sendTGID==true){
-              send_buffer.push_back(buffer(&TGID,4));  //prepend 4 byte long tgid to the audio data
-            }
-            send_buffer.push_back(buffer(samples, sampleCount*2));
-            if(stream.tcp == true){
-              stream.tcp_socket->send(send_buffer);
-            }
-            else{
-              my_socket.send_to(send_buffer, stream.remote_endpoint, 0, error);
-            }
-          }
-        }
+  // Encodes what makes up whole 20 ms frames and keeps the rest for the
+  // next piece of audio. Returns the number of frames in opus_data.
+  int encode_opus(call_routes_t &entry, int16_t *samples, int sampleCount){
+#ifdef HAVE_OPUS
+    if (!entry.encoder){
+      return 0;
+    }
+    entry.opus_pcm.insert(entry.opus_pcm.end(), samples, samples + sampleCount);
+    int frames = entry.opus_pcm.size() / entry.opus_frame;
+    if ((int)entry.opus_lengths.size() < frames){
+      entry.opus_lengths.resize(frames);
+      entry.opus_data.resize(frames * MAX_OPUS_PACKET);
+    }
+    int encoded = 0;
+    for (int i = 0; i < frames; i++){
+      int length = opus_encode(entry.encoder, &entry.opus_pcm[i * entry.opus_frame], entry.opus_frame, &entry.opus_data[encoded * MAX_OPUS_PACKET], MAX_OPUS_PACKET);
+      if (length < 0){
+        BOOST_LOG_TRIVIAL(error) << "simplestream failed to encode Opus: " << opus_strerror(length);
+        continue;
       }
+      entry.opus_lengths[encoded++] = length;
     }
+    entry.opus_pcm.erase(entry.opus_pcm.begin(), entry.opus_pcm.begin() + frames * entry.opus_frame);
+    return encoded;
+#else
     return 0;
+#endif
+  }
+
+  // TCP goes out right away, UDP waits for send_packets()
+  void add_packet(call_routes_t &entry, route_t &route, const void *audio, size_t audio_bytes){
+    stream_t *stream = route.stream;
+    std::array<boost::asio::const_buffer, MAX_IOVS> send_buffer;
+    int count = 0;
+    if (stream->sendJSON==true){
+      send_buffer[count++] = buffer(&route.json_length,4);  //prepend length of the json data
+      send_buffer[count++] = buffer(route.json_string);  //prepend json data
+    }
+    else if (stream->sendTGID==true){
+      send_buffer[count++] = buffer(&route.TGID,4);  //prepend 4 byte long tgid to the audio data
+    }
+    send_buffer[count++] = buffer(audio, audio_bytes);
+
+    if (stream->tcp == true){
+      stream->tcp_socket->send(send_buffer);
+      return;
+    }
+
+    if ((int)entry.msgs.size() <= entry.packets){
+      entry.msgs.resize(entry.packets + 1);
+      entry.iovs.resize((entry.packets + 1) * MAX_IOVS);
+    }
+    struct iovec *iov = &entry.iovs[entry.packets * MAX_IOVS];
+    for (int i = 0; i < count; i++){
+      iov[i].iov_base = const_cast<void *>(boost::asio::buffer_cast<const void *>(send_buffer[i]));
+      iov[i].iov_len = boost::asio::buffer_size(send_buffer[i]);
+    }
+#ifdef __linux__
+    struct msghdr &msg = entry.msgs[entry.packets].msg_hdr;
+    entry.msgs[entry.packets].msg_len = 0;
+#else
+    struct msghdr &msg = entry.msgs[entry.packets];
+#endif
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = stream->remote_endpoint.data();
+    msg.msg_namelen = stream->remote_endpoint.size();
+    msg.msg_iovlen = count;
+    entry.packets++;
+  }
+
+  // All of the UDP packets for a piece of audio in one system call
+  void send_packets(call_routes_t &entry){
+    if (entry.packets == 0){
+      return;
+    }
+    // The iovecs can move while packets are added
+    for (int i = 0; i < entry.packets; i++){
+#ifdef __linux__
+      entry.msgs[i].msg_hdr.msg_iov = &entry.iovs[i * MAX_IOVS];
+#else
+      entry.msgs[i].msg_iov = &entry.iovs[i * MAX_IOVS];
+#endif
+    }
+    int fd = my_socket.native_handle();
+#ifdef __linux__
+    int sent = 0;
+    while (sent < entry.packets){
+      int rc = sendmmsg(fd, &entry.msgs[sent], entry.packets - sent, 0);
+      if (rc < 0){
+        if (errno == EINTR){
+          continue;
+        }
+        BOOST_LOG_TRIVIAL(debug) << "simplestream failed to send " << entry.packets - sent << " packets: " << strerror(errno);
+        break;
+      }
+      sent += rc;
+    }
+#else
+    for (int i = 0; i < entry.packets; i++){
+      sendmsg(fd, &entry.msgs[i], 0);
+    }
+#endif
+    entry.packets = 0;
   }
 
   int call_start(Call *call){
@@ -164,7 +411,7 @@ class Simple_Stream : public Plugin_Api {
       }
     }
     
-    BOOST_FOREACH (auto stream, streams){
+    BOOST_FOREACH (auto& stream, streams){
       if (stream.sendJSON == true && stream.sendCallStart == true){
         if (0==stream.short_name.compare(call_short_name) || (0==stream.short_name.compare(""))){ //Check if shortName matches or is not specified
           if (patched_talkgroups.size() == 0){
@@ -212,9 +459,9 @@ class Simple_Stream : public Plugin_Api {
     return 0;
   }
 
-  int call_end(Call_Data_t call_info) {
+  int call_end_view(const Call_Data_t &call_info) {
     boost::system::error_code error;
-    BOOST_FOREACH (auto stream, streams){
+    BOOST_FOREACH (auto& stream, streams){
       if (stream.sendJSON == true && stream.sendCallEnd == true){
         if (0==stream.short_name.compare(call_info.short_name) || (0==stream.short_name.compare(""))){ //Check if shortName matches or is not specified
           std::vector<long> patched_talkgroups;
@@ -259,6 +506,10 @@ class Simple_Stream : public Plugin_Api {
     return 0;
   }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_AUDIO_STREAM | PLUGIN_HOOK_CALL_START | PLUGIN_HOOK_CALL_END;
+  }
+
   int start(){
     BOOST_FOREACH (auto& stream, streams){
       if (stream.tcp == true){
@@ -268,6 +519,24 @@ class Simple_Stream : public Plugin_Api {
       }
     }
     my_socket.open(ip::udp::v4());
+
+    // One packet to a multicast group reaches every receiver that has joined it
+    bool multicast = false;
+    BOOST_FOREACH (auto& stream, streams){
+      multicast = multicast || (!stream.tcp && stream.remote_endpoint.address().is_multicast());
+    }
+    if (multicast){
+      boost::system::error_code error;
+      my_socket.set_option(ip::multicast::hops(multicast_ttl), error);
+      my_socket.set_option(ip::multicast::enable_loopback(multicast_loopback), error);
+      if (!multicast_interface.empty()){
+        my_socket.set_option(ip::multicast::outbound_interface(ip::address_v4::from_string(multicast_interface)), error);
+      }
+      if (error){
+        BOOST_LOG_TRIVIAL(error) << "simplestream failed to set up multicast: " << error.message();
+      }
+      BOOST_LOG_TRIVIAL(info) << "simplestream multicast TTL: " << multicast_ttl << " Loopback: " << multicast_loopback << " Interface: " << (multicast_interface.empty() ? "default" : multicast_interface);
+    }
     return 0;
   }
   
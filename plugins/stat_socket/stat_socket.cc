@@ -1,3 +1,10 @@
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <time.h>
 #include <vector>
 #include <websocketpp/client.hpp>
@@ -11,6 +18,7 @@
 #include "../trunk-recorder/gr_blocks/decoder_wrapper.h"
 #include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS  
 
+#include <boost/log/trivial.hpp>
 #include <json.hpp>
 
 typedef struct stat_plugin_t stat_plugin_t;
@@ -38,6 +46,38 @@ class Stat_Socket : public Plugin_Api {
   bool m_open;
   bool m_done;
   bool m_config_sent;
+  uint64_t m_calls_version;
+  bool m_calls_resync;
+
+  // A message waiting to be encoded or sent. The ones with a key are a
+  // full picture of something, a newer one replaces one still waiting.
+  struct Message {
+    std::string key;
+    boost::property_tree::ptree root;
+    std::string payload;
+    bool calls_delta;
+  };
+
+  enum Format { JSON,
+                CBOR,
+                MSGPACK };
+
+  static const size_t MAX_QUEUED = 256;
+
+  Format format;
+  size_t send_buffer;
+  std::mutex queue_mutex;
+  std::condition_variable not_empty;
+  std::deque<Message> to_encode;
+  std::deque<Message> to_send; // encoded, sent from poll_one() on the websocket's thread
+  bool running;
+  std::thread encoder;
+  uint64_t dropped;
+  bool dropping;
+
+  // The last recorder and system stats sent, so ones that haven't changed aren't sent again
+  std::map<int, boost::property_tree::ptree> sent_recorders;
+  std::map<int, boost::property_tree::ptree> sent_systems;
   std::vector<Source *> sources;
   std::vector<System *> systems;
   std::vector<Call *> calls;
@@ -50,21 +90,34 @@ public:
  * programs where a client connects and pushes data for logging, stress/load
  * testing, etc.
  */
-  int system_rates(std::vector<System *> systems, float timeDiff) {
+  int system_rates_view(const std::vector<System *> &systems, float timeDiff) {
     this->systems = systems;
     if (m_open == false)
       return 0;
       
     boost::property_tree::ptree nodes;
 
-    for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); it++) {
+    for (std::vector<System *>::const_iterator it = systems.begin(); it != systems.end(); it++) {
       System *system = *it;
       nodes.push_back(std::make_pair("", system->get_stats_current(timeDiff)));
     }
     return send_object(nodes, "rates", "rates");
   }
 
-  Stat_Socket() : m_open(false), m_done(false), m_config_sent(false) {
+  int source_rates_view(const std::vector<Source *> &sources, float timeDiff) {
+    if (m_open == false)
+      return 0;
+
+    boost::property_tree::ptree nodes;
+
+    for (std::vector<Source *>::const_iterator it = sources.begin(); it != sources.end(); it++) {
+      Source *source = *it;
+      nodes.push_back(std::make_pair("", source->get_stats_current()));
+    }
+    return send_object(nodes, "sources", "source_rates");
+  }
+
+  Stat_Socket() : m_open(false), m_done(false), m_config_sent(false), m_calls_version(0), m_calls_resync(false), format(JSON), send_buffer(1048576), running(false), dropped(0), dropping(false) {
     // set up access channels to only log interesting things
     m_client.clear_access_channels(websocketpp::log::alevel::all);
     m_client.set_access_channels(websocketpp::log::alevel::connect);
@@ -191,11 +244,7 @@ public:
       root.put("broadcast_signals", this->config->broadcast_signals);
     }
 
-    std::stringstream stats_str;
-    boost::property_tree::write_json(stats_str, root);
-
-    // std::cout << stats_str;
-    send_stat(stats_str.str());
+    queue_message("config", root);
     m_config_sent = true;
   }
 
@@ -215,16 +264,27 @@ public:
     if (m_open == false)
       return 0;
 
-    return send_object(system->get_stats(), "system", "system");
+    boost::property_tree::ptree stats = system->get_stats();
+    std::map<int, boost::property_tree::ptree>::iterator sent = sent_systems.find(system->get_sys_num());
+    if ((sent != sent_systems.end()) && (sent->second == stats)) {
+      return 0;
+    }
+    sent_systems[system->get_sys_num()] = stats;
+    return send_object(stats, "system", "system");
 
   }
 
-  int calls_active(std::vector<Call *> calls) {
+  int calls_active_view(const std::vector<Call *> &calls) {
+    // With deltas the full list only goes out when the socket connects
+    if (this->config->status_calls_delta) {
+      this->calls = calls;
+      return 0;
+    }
     if (m_open == false)
       return 0;
     boost::property_tree::ptree node;
 
-    for (std::vector<Call *>::iterator it = calls.begin(); it != calls.end(); it++) {
+    for (std::vector<Call *>::const_iterator it = calls.begin(); it != calls.end(); it++) {
       Call *call = *it;
       //if (call->get_state() == RECORDING) {
         node.push_back(std::make_pair("", call->get_stats()));
@@ -234,6 +294,58 @@ public:
     return send_object(node, "calls", "calls_active");
   }
 
+  int send_calls_snapshot() {
+    if (m_open == false)
+      return 0;
+    boost::property_tree::ptree root;
+    boost::property_tree::ptree node;
+
+    for (std::vector<Call *>::iterator it = this->calls.begin(); it != this->calls.end(); it++) {
+      Call *call = *it;
+      node.push_back(std::make_pair("", call->get_stats()));
+    }
+
+    root.add_child("calls", node);
+    root.put("version", m_calls_version);
+    root.put("type", "calls_active");
+    root.put("instanceId", this->config->instance_id);
+    root.put("instanceKey", this->config->instance_key);
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      m_calls_resync = false;
+    }
+    return queue_message("calls_active", root);
+  }
+
+  int calls_changed(const Calls_Delta &delta) {
+    m_calls_version = delta.version;
+    if ((m_open == false) || !this->config->status_calls_delta)
+      return 0;
+
+    boost::property_tree::ptree node;
+    boost::property_tree::ptree added;
+    boost::property_tree::ptree changed;
+    boost::property_tree::ptree removed;
+
+    for (std::vector<Call *>::const_iterator it = delta.added.begin(); it != delta.added.end(); it++) {
+      added.push_back(std::make_pair("", (*it)->get_stats()));
+    }
+    for (std::vector<Call *>::const_iterator it = delta.changed.begin(); it != delta.changed.end(); it++) {
+      changed.push_back(std::make_pair("", (*it)->get_stats()));
+    }
+    for (std::vector<long>::const_iterator it = delta.removed.begin(); it != delta.removed.end(); it++) {
+      boost::property_tree::ptree call_num;
+      call_num.put("", *it);
+      removed.push_back(std::make_pair("", call_num));
+    }
+
+    node.put("version", delta.version);
+    node.add_child("added", added);
+    node.add_child("changed", changed);
+    node.add_child("removed", removed);
+    return send_object(node, "calls", "calls_delta");
+  }
+
   int send_recorders(std::vector<Recorder *> recorders) {
 
     if (m_open == false)
@@ -242,12 +354,47 @@ public:
 
     for (std::vector<Recorder *>::iterator it = recorders.begin(); it != recorders.end(); it++) {
       Recorder *recorder = *it;
-      node.push_back(std::make_pair("", recorder->get_stats()));
+      boost::property_tree::ptree stats = recorder->get_stats();
+      sent_recorders[recorder->get_num()] = stats;
+      node.push_back(std::make_pair("", stats));
     }
 
     return send_object(node, "recorders", "recorders");
   }
 
+  static boost::property_tree::ptree latency_node(const Latency_Summary &summary) {
+    boost::property_tree::ptree node;
+    node.put("count", summary.count);
+    node.put("p50_ms", summary.p50_ms);
+    node.put("p90_ms", summary.p90_ms);
+    node.put("p99_ms", summary.p99_ms);
+    node.put("max_ms", summary.max_ms);
+    return node;
+  }
+
+  int wav_writer_stats(const std::vector<Wav_Writer_Stats> &stats) {
+    if (m_open == false)
+      return 0;
+
+    boost::property_tree::ptree nodes;
+
+    for (std::vector<Wav_Writer_Stats>::const_iterator it = stats.begin(); it != stats.end(); it++) {
+      boost::property_tree::ptree node;
+      node.put("source_num", it->source_num);
+      node.put("files_opened", it->files_opened);
+      node.put("files_open", it->files_open);
+      node.put("open_failures", it->open_failures);
+      node.put("bytes_written", it->bytes_written);
+      node.put("dropped_samples", it->dropped_samples);
+      node.put("orphaned_samples", it->orphaned_samples);
+      node.add_child("open", latency_node(it->open));
+      node.add_child("write", latency_node(it->write));
+      node.add_child("close", latency_node(it->close));
+      nodes.push_back(std::make_pair("", node));
+    }
+    return send_object(nodes, "writers", "wav_writer_stats");
+  }
+
   int call_start(Call *call) {
     if (m_open == false)
       return 0;
@@ -256,7 +403,7 @@ public:
 
   }
 
-  int call_end(Call_Data_t call_info) {
+  int call_end_view(const Call_Data_t &call_info) {
     if (m_open == false)
       return 0;
     return 0;
@@ -267,7 +414,13 @@ public:
     if (m_open == false)
       return 0;
 
-    return send_object(recorder->get_stats(), "recorder", "recorder");
+    boost::property_tree::ptree stats = recorder->get_stats();
+    std::map<int, boost::property_tree::ptree>::iterator sent = sent_recorders.find(recorder->get_num());
+    if ((sent != sent_recorders.end()) && (sent->second == stats)) {
+      return 0;
+    }
+    sent_recorders[recorder->get_num()] = stats;
+    return send_object(stats, "recorder", "recorder");
   }
 
   int send_object(boost::property_tree::ptree data, std::string name, std::string type) {
@@ -279,11 +432,189 @@ public:
     root.put("type", type);
     root.put("instanceId", this->config->instance_id);
     root.put("instanceKey", this->config->instance_key);
-    std::stringstream stats_str;
-    boost::property_tree::write_json(stats_str, root);
 
-    // std::cout << stats_str;
-    return send_stat(stats_str.str());
+    // These are the whole picture, only the newest one needs to go out
+    std::string key;
+    if ((type == "rates") || (type == "source_rates") || (type == "systems") || (type == "recorders") || (type == "calls_active") || (type == "wav_writer_stats")) {
+      key = type;
+    }
+    return queue_message(key, root, type == "calls_delta");
+  }
+
+  // The values in a ptree are all strings. In the binary formats the ones
+  // that are numbers or booleans are sent as them.
+  static nlohmann::json typed_value(const std::string &value) {
+    if (value == "true") {
+      return true;
+    }
+    if (value == "false") {
+      return false;
+    }
+    if (value.empty() || (value.size() > 1 && value[0] == '0' && value[1] != '.') || value[0] == '+' || isspace((unsigned char)value[0])) {
+      return value;
+    }
+    const char *begin = value.c_str();
+    char *end;
+    errno = 0;
+    long long integer = strtoll(begin, &end, 10);
+    if (*end == '\0' && errno != ERANGE) {
+      return integer;
+    }
+    double number = strtod(begin, &end);
+    if (*end == '\0' && std::isfinite(number)) {
+      return number;
+    }
+    return value;
+  }
+
+  // Children without names are an array, the same as write_json() makes them
+  static nlohmann::json to_json(const boost::property_tree::ptree &node, bool typed) {
+    if (node.empty()) {
+      return typed ? typed_value(node.data()) : nlohmann::json(node.data());
+    }
+    bool array = true;
+    for (boost::property_tree::ptree::const_iterator it = node.begin(); it != node.end(); ++it) {
+      if (!it->first.empty()) {
+        array = false;
+        break;
+      }
+    }
+    nlohmann::json out = array ? nlohmann::json::array() : nlohmann::json::object();
+    for (boost::property_tree::ptree::const_iterator it = node.begin(); it != node.end(); ++it) {
+      if (array) {
+        out.push_back(to_json(it->second, typed));
+      } else {
+        out[it->first] = to_json(it->second, typed);
+      }
+    }
+    return out;
+  }
+
+  std::string encode(const boost::property_tree::ptree &root) {
+    switch (format) {
+    case CBOR: {
+      std::vector<uint8_t> bytes = nlohmann::json::to_cbor(to_json(root, true));
+      return std::string(bytes.begin(), bytes.end());
+    }
+    case MSGPACK: {
+      std::vector<uint8_t> bytes = nlohmann::json::to_msgpack(to_json(root, true));
+      return std::string(bytes.begin(), bytes.end());
+    }
+    default:
+      return to_json(root, false).dump();
+    }
+  }
+
+  // Replaces a waiting message with the same key, or else adds it. When the
+  // queue is full the oldest message goes, and if that was a calls_delta the
+  // server gets a fresh calls_active instead. Call with queue_mutex held.
+  static bool push_message(std::deque<Message> &queue, Message &message, bool &resync) {
+    if (!message.key.empty()) {
+      for (std::deque<Message>::iterator it = queue.begin(); it != queue.end(); ++it) {
+        if (it->key == message.key) {
+          *it = std::move(message);
+          return true;
+        }
+      }
+    }
+    bool full = queue.size() >= MAX_QUEUED;
+    if (full) {
+      resync = resync || queue.front().calls_delta;
+      queue.pop_front();
+    }
+    queue.push_back(std::move(message));
+    return !full;
+  }
+
+  int queue_message(std::string key, boost::property_tree::ptree &root, bool calls_delta = false) {
+    if (m_open == false)
+      return 0;
+
+    Message message;
+    message.key = key;
+    message.calls_delta = calls_delta;
+    message.root.swap(root);
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    if (!running) {
+      lock.unlock();
+      return send_stat(encode(message.root));
+    }
+    if (!push_message(to_encode, message, m_calls_resync)) {
+      message_dropped();
+    }
+    lock.unlock();
+    not_empty.notify_one();
+    return 0;
+  }
+
+  void message_dropped() {
+    dropped++;
+    if (!dropping) {
+      dropping = true;
+      BOOST_LOG_TRIVIAL(error) << "Status Server is not keeping up, dropping status messages";
+    }
+  }
+
+  // Encoding is the expensive part, it is done here instead of on the main thread
+  void run_encoder() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+      not_empty.wait(lock, [this] { return !to_encode.empty() || !running; });
+      if (!running) {
+        return;
+      }
+      Message message = std::move(to_encode.front());
+      to_encode.pop_front();
+      lock.unlock();
+
+      message.payload = encode(message.root);
+      message.root.clear();
+
+      lock.lock();
+      if (!push_message(to_send, message, m_calls_resync)) {
+        message_dropped();
+      }
+    }
+  }
+
+  // Only hands the websocket more once it has sent most of what it has
+  void flush_messages() {
+    if (!m_open) {
+      return;
+    }
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = m_client.get_con_from_hdl(m_hdl, ec);
+    if (ec) {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (!to_send.empty() && (con->get_buffered_amount() < send_buffer)) {
+      Message message = std::move(to_send.front());
+      to_send.pop_front();
+      lock.unlock();
+      send_stat(message.payload);
+      lock.lock();
+    }
+    if (to_send.empty() && dropping) {
+      BOOST_LOG_TRIVIAL(info) << "Status Server caught up, " << dropped << " status messages were dropped";
+      dropping = false;
+      dropped = 0;
+    }
+    bool resync = m_calls_resync && this->config->status_calls_delta;
+    lock.unlock();
+
+    if (resync) {
+      send_calls_snapshot();
+    }
+  }
+
+  void clear_messages() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    to_encode.clear();
+    to_send.clear();
+    m_calls_resync = false;
   }
 
 
@@ -332,6 +663,7 @@ public:
       reopen_stat();
     }
     m_client.poll_one();
+    flush_messages();
     return 0;
   }
 
@@ -357,6 +689,9 @@ public:
       m_open = true;
       retry_attempt = 0;
     }
+    sent_recorders.clear();
+    sent_systems.clear();
+    clear_messages();
     send_config(this->sources, this->systems);
     send_systems(this->systems);
     std::vector<Recorder *> recorders;
@@ -370,6 +705,10 @@ public:
     }
 
     send_recorders(recorders);
+
+    if (this->config->status_calls_delta) {
+      send_calls_snapshot();
+    }
   }
 
   // The close handler will signal that we should stop sending telemetry
@@ -378,6 +717,7 @@ public:
     std::string str_num;
     m_client.get_alog().write(websocketpp::log::alevel::app,
                               "on_close: WebSocket Connection closed, stopping telemetry!");
+    clear_messages();
 
     scoped_lock guard(m_lock);
     m_open = false;
@@ -417,10 +757,10 @@ public:
     //Need to receive the message so they don't build up. TrunkPlayer sends a message to acknowledge what TrunkRecorder sends.
   }
 
-  int send_stat(std::string val) {
+  int send_stat(const std::string &val) {
     websocketpp::lib::error_code ec;
     if (m_open) {
-      m_client.send(m_hdl, val, websocketpp::frame::opcode::text, ec);
+      m_client.send(m_hdl, val, (format == JSON) ? websocketpp::frame::opcode::text : websocketpp::frame::opcode::binary, ec);
 
       // The most likely error that we will get is that the connection is
       // not in the right state. Usually this means we tried to send a
@@ -467,10 +807,27 @@ public:
     this->systems = systems;
     this->config = config;
 
+    if (config->status_format == "cbor") {
+      format = CBOR;
+    } else if (config->status_format == "msgpack") {
+      format = MSGPACK;
+    } else {
+      format = JSON;
+    }
+    send_buffer = config->status_send_buffer;
+
     return 0;
   }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_POLL_ONE | PLUGIN_HOOK_SIGNAL | PLUGIN_HOOK_CALL_START | PLUGIN_HOOK_CALL_END | PLUGIN_HOOK_CALLS_ACTIVE | PLUGIN_HOOK_CALLS_CHANGED | PLUGIN_HOOK_SETUP_RECORDER | PLUGIN_HOOK_SETUP_SYSTEM | PLUGIN_HOOK_SETUP_SYSTEMS | PLUGIN_HOOK_SETUP_CONFIG | PLUGIN_HOOK_SYSTEM_RATES | PLUGIN_HOOK_SOURCE_RATES | PLUGIN_HOOK_WAV_WRITER_STATS;
+  }
+
   int start() {
+    if (!running && (this->config->status_server != "")) {
+      running = true;
+      encoder = std::thread(&Stat_Socket::run_encoder, this);
+    }
     open_stat();
     return 0;
   }
@@ -510,7 +867,18 @@ public:
     }
 
  int parse_config(json config_data ){ return 0; }
-   int stop() { return 0; }
+   int stop() {
+     {
+       std::lock_guard<std::mutex> lock(queue_mutex);
+       if (!running) {
+         return 0;
+       }
+       running = false;
+     }
+     not_empty.notify_all();
+     encoder.join();
+     return 0;
+   }
    int setup_sources(std::vector<Source *> sources) { return 0; }
 
 };
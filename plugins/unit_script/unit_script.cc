@@ -2,17 +2,230 @@
 #include "../../trunk-recorder/systems/system.h"
 #include <boost/dll/alias.hpp> // for BOOST_DLL_ALIAS
 #include <boost/foreach.hpp>
+#include <boost/log/trivial.hpp>
+#include <condition_variable>
+#include <csignal>
+#include <ctime>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
 
 
 struct Unit_Script_System_Script {
   std::string script;
   std::string short_name;
+  bool persistent;     // unitScriptMode "process"
+  FILE *pipe;          // the script's stdin, only used by the writer thread
+  time_t restart_time; // when the script can be started again after it exits
 };
 
+// One line for a persistent script, made into JSON by the writer thread
+struct Unit_Script_Event {
+  size_t script;
+  std::string short_name;
+  const char *event;
+  long source_id;
+  const char *extra_name; // NULL if the event has no fourth parameter
+  long extra;
+  std::vector<unsigned long> patches;
+};
+
+/*
+ * Unit_Script
+ *   Runs a System's unitScript for unit events and call starts.
+ *
+ * By default each event forks a shell with the event as its parameters.
+ * With unitScriptMode set to "process" the script is started once and
+ * gets each event as a line of JSON on its stdin. The events are queued
+ * and written by a thread of their own, as many as are waiting at once,
+ * so a slow script only backs up its queue. If the script exits it is
+ * started again, at most every RESTART_SECONDS.
+ */
 class Unit_Script : public Plugin_Api {
+  static const size_t MAX_QUEUED = 10000;
+  static const int RESTART_SECONDS = 5;
+
     std::vector<Unit_Script_System_Script> system_scripts;
 std::map<long, long> unit_affiliations;
+
+  std::mutex queue_mutex;
+  std::condition_variable not_empty;
+  std::deque<Unit_Script_Event> queue;
+  bool running;
+  std::thread writer;
+  uint64_t dropped;
+
 public:
+  Unit_Script() : running(false), dropped(0) {}
+
+  // True if the System's script is persistent, and the event was queued for it
+  bool queue_event(const std::string &short_name, long source_id, const char *event, const char *extra_name = NULL, long extra = 0, const std::vector<unsigned long> &patches = std::vector<unsigned long>()) {
+    size_t index;
+    for (index = 0; index < system_scripts.size(); index++) {
+      if (system_scripts[index].short_name == short_name) {
+        break;
+      }
+    }
+    if ((index == system_scripts.size()) || !system_scripts[index].persistent) {
+      return false;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    if (queue.size() >= MAX_QUEUED) {
+      if (dropped++ == 0) {
+        BOOST_LOG_TRIVIAL(error) << "unit_script: The unitScript for " << short_name << " is not keeping up, dropping events";
+      }
+      return true;
+    }
+    Unit_Script_Event entry;
+    entry.script = index;
+    entry.short_name = short_name;
+    entry.event = event;
+    entry.source_id = source_id;
+    entry.extra_name = extra_name;
+    entry.extra = extra;
+    entry.patches = patches;
+    queue.push_back(std::move(entry));
+    lock.unlock();
+    not_empty.notify_one();
+    return true;
+  }
+
+  static std::string format_event(const Unit_Script_Event &entry) {
+    json line;
+    line["shortName"] = entry.short_name;
+    line["radioId"] = entry.source_id;
+    line["event"] = entry.event;
+    if (entry.extra_name) {
+      line[entry.extra_name] = entry.extra;
+    }
+    if (!entry.patches.empty()) {
+      line["patchedTalkgroups"] = entry.patches;
+    }
+    return line.dump() + "\n";
+  }
+
+  // Only called from the writer thread
+  bool open_script(Unit_Script_System_Script &system_script) {
+    if (system_script.pipe) {
+      return true;
+    }
+    if (time(NULL) < system_script.restart_time) {
+      return false;
+    }
+    system_script.restart_time = time(NULL) + RESTART_SECONDS;
+    system_script.pipe = popen(system_script.script.c_str(), "w");
+    if (!system_script.pipe) {
+      BOOST_LOG_TRIVIAL(error) << "unit_script: Failed to start the unitScript for " << system_script.short_name << ": " << system_script.script;
+      return false;
+    }
+    BOOST_LOG_TRIVIAL(info) << "unit_script: Started the unitScript for " << system_script.short_name << ": " << system_script.script;
+    return true;
+  }
+
+  // Only called from the writer thread
+  void close_script(Unit_Script_System_Script &system_script) {
+    if (system_script.pipe) {
+      pclose(system_script.pipe);
+      system_script.pipe = NULL;
+    }
+    clear_sigpipe();
+  }
+
+  // A SIGPIPE from writing to a script that has exited goes to the thread
+  // that wrote. The writer thread keeps it blocked, so the write fails with
+  // EPIPE instead, and takes the pending signal back off itself here.
+  static void clear_sigpipe() {
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    struct timespec zero = {0, 0};
+    while (sigtimedwait(&pipe_set, NULL, &zero) == SIGPIPE) {
+    }
+  }
+
+  void run_writer() {
+    std::deque<Unit_Script_Event> batch;
+    std::vector<bool> written(system_scripts.size(), false);
+
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, NULL);
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        not_empty.wait(lock, [this] { return !queue.empty() || !running; });
+        if (queue.empty() && !running) {
+          break;
+        }
+        batch.swap(queue);
+        if (dropped) {
+          BOOST_LOG_TRIVIAL(error) << "unit_script: " << dropped << " events were dropped";
+          dropped = 0;
+        }
+      }
+
+      for (std::deque<Unit_Script_Event>::iterator it = batch.begin(); it != batch.end(); ++it) {
+        Unit_Script_System_Script &system_script = system_scripts[it->script];
+        if (!open_script(system_script)) {
+          continue;
+        }
+        std::string line = format_event(*it);
+        if (fwrite(line.data(), 1, line.size(), system_script.pipe) < line.size()) {
+          BOOST_LOG_TRIVIAL(error) << "unit_script: The unitScript for " << system_script.short_name << " has exited, it will be started again";
+          close_script(system_script);
+          continue;
+        }
+        written[it->script] = true;
+      }
+      batch.clear();
+
+      // One flush for each script per batch
+      for (size_t i = 0; i < system_scripts.size(); i++) {
+        if (written[i] && system_scripts[i].pipe && (fflush(system_scripts[i].pipe) != 0)) {
+          BOOST_LOG_TRIVIAL(error) << "unit_script: The unitScript for " << system_scripts[i].short_name << " has exited, it will be started again";
+          close_script(system_scripts[i]);
+        }
+        written[i] = false;
+      }
+    }
+
+    for (std::vector<Unit_Script_System_Script>::iterator it = system_scripts.begin(); it != system_scripts.end(); ++it) {
+      close_script(*it);
+    }
+  }
+
+  int start() {
+    bool persistent = false;
+    for (std::vector<Unit_Script_System_Script>::iterator it = system_scripts.begin(); it != system_scripts.end(); ++it) {
+      persistent = persistent || it->persistent;
+    }
+    if (persistent && !running) {
+      running = true;
+      writer = std::thread(&Unit_Script::run_writer, this);
+    }
+    return 0;
+  }
+
+  int stop() {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      if (!running) {
+        return 0;
+      }
+      running = false;
+    }
+    not_empty.notify_all();
+    // The writer writes whatever is still queued and closes the scripts
+    // before it returns
+    writer.join();
+    return 0;
+  }
+
   std::string get_system_script(std::string short_name) {
     for (std::vector<Unit_Script_System_Script>::iterator it = system_scripts.begin(); it != system_scripts.end(); ++it) {
       Unit_Script_System_Script system_script = *it;
@@ -27,6 +240,9 @@ int unit_registration(System *sys, long source_id) {
     unit_affiliations[source_id] = 0;
   std::string system_script = get_system_script(sys->get_short_name());
   if ((system_script != "") && (source_id != 0)) {
+    if (queue_event(sys->get_short_name(), source_id, "on")) {
+      return 0;
+    }
     char shell_command[200];
     snprintf(shell_command, 200, "%s %s %li on &", system_script.c_str(), sys->get_short_name().c_str(), source_id);
     int rc __attribute__((unused)) =  system(shell_command);
@@ -39,6 +255,9 @@ int unit_deregistration(System *sys, long source_id) {
     unit_affiliations[source_id] = -1;
   std::string system_script = get_system_script(sys->get_short_name());
   if ((system_script != "") && (source_id != 0)) {
+    if (queue_event(sys->get_short_name(), source_id, "off")) {
+      return 0;
+    }
     char shell_command[200];
     snprintf(shell_command, 200, "%s %s %li off &", system_script.c_str(), sys->get_short_name().c_str(), source_id);
     int rc __attribute__((unused)) =  system(shell_command);
@@ -49,6 +268,9 @@ int unit_deregistration(System *sys, long source_id) {
 int unit_acknowledge_response(System *sys, long source_id) { 
   std::string system_script = get_system_script(sys->get_short_name());
   if ((system_script != "") && (source_id != 0)) {
+    if (queue_event(sys->get_short_name(), source_id, "ackresp")) {
+      return 0;
+    }
     char shell_command[200];
     snprintf(shell_command,200, "%s %s %li ackresp &", system_script.c_str(), sys->get_short_name().c_str(), source_id);
     int rc __attribute__((unused)) =  system(shell_command);
@@ -63,6 +285,9 @@ int unit_group_affiliation(System *sys, long source_id, long talkgroup_num) {
   if ((system_script != "") && (source_id != 0)) {
     char shell_command[200];
     std::vector<unsigned long> talkgroup_patches = sys->get_talkgroup_patch(talkgroup_num);
+    if (queue_event(sys->get_short_name(), source_id, "join", "talkgroup", talkgroup_num, talkgroup_patches)) {
+      return 0;
+    }
     std::string patch_string;
     bool first = true;
     BOOST_FOREACH (auto& TGID, talkgroup_patches) {
@@ -80,6 +305,9 @@ int unit_group_affiliation(System *sys, long source_id, long talkgroup_num) {
 int unit_data_grant(System *sys, long source_id) {
     std::string system_script = get_system_script(sys->get_short_name());
   if ((system_script != "") && (source_id != 0)) {
+    if (queue_event(sys->get_short_name(), source_id, "data")) {
+      return 0;
+    }
     char shell_command[200];
     snprintf(shell_command, 200, "%s %s %li data &", system_script.c_str(), sys->get_short_name().c_str(), source_id);
     int rc __attribute__((unused)) =  system(shell_command);
@@ -91,6 +319,9 @@ int unit_data_grant(System *sys, long source_id) {
 int unit_answer_request(System *sys, long source_id, long talkgroup) {
     std::string system_script = get_system_script(sys->get_short_name());
   if ((system_script != "") && (source_id != 0)) {
+    if (queue_event(sys->get_short_name(), source_id, "ans_req", "source", talkgroup)) {
+      return 0;
+    }
     char shell_command[200];
     snprintf(shell_command, 200, "%s %s %li ans_req %li &", system_script.c_str(), sys->get_short_name().c_str(), source_id, talkgroup);
     int rc __attribute__((unused)) =  system(shell_command);
@@ -105,6 +336,9 @@ int unit_location(System *sys, long source_id, long talkgroup_num) {
   if ((system_script != "") && (source_id != 0)) {
     char shell_command[200];
     std::vector<unsigned long> talkgroup_patches = sys->get_talkgroup_patch(talkgroup_num);
+    if (queue_event(sys->get_short_name(), source_id, "location", "talkgroup", talkgroup_num, talkgroup_patches)) {
+      return 0;
+    }
     std::string patch_string;
     bool first = true;
     BOOST_FOREACH (auto& TGID, talkgroup_patches) {
@@ -127,6 +361,9 @@ int call_start(Call *call) {
   if ((system_script != "") && (source_id != 0)) {
     char shell_command[200];
     std::vector<unsigned long> talkgroup_patches = call->get_system()->get_talkgroup_patch(talkgroup_num);
+    if (queue_event(short_name, source_id, "call", "talkgroup", talkgroup_num, talkgroup_patches)) {
+      return 0;
+    }
     std::string patch_string;
     bool first = true;
     BOOST_FOREACH (auto& TGID, talkgroup_patches) {
@@ -141,14 +378,26 @@ int call_start(Call *call) {
     return 1;
 }
 
+  unsigned int hooks() {
+    return PLUGIN_HOOK_UNIT_EVENTS | PLUGIN_HOOK_CALL_START;
+  }
+
   int parse_config(json config_data) {
 
     for (json element : config_data["systems"]) {
       Unit_Script_System_Script system_script;
       system_script.script = element.value("unitScript", "");
       system_script.short_name = element.value("shortName", "");
+      std::string mode = element.value("unitScriptMode", "fork");
+      if ((mode != "fork") && (mode != "process")) {
+        BOOST_LOG_TRIVIAL(error) << "Unknown unitScriptMode: " << mode << ", it should be fork or process. Using fork";
+        mode = "fork";
+      }
+      system_script.persistent = (mode == "process");
+      system_script.pipe = NULL;
+      system_script.restart_time = 0;
       if (system_script.script != "") {
-        BOOST_LOG_TRIVIAL(info) << "\t- [" << system_script.short_name << "]: " << system_script.script ;
+        BOOST_LOG_TRIVIAL(info) << "\t- [" << system_script.short_name << "]: " << system_script.script << (system_script.persistent ? " (process)" : "");
         this->system_scripts.push_back(system_script);
       }
     }
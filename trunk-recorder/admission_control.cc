@@ -0,0 +1,151 @@
+#include "admission_control.h"
+#include "call.h"
+#include "flowgraph_profiler.h"
+#include "formatter.h"
+#include "recorders/recorder.h"
+#include "replay_clock.h"
+#include "source.h"
+#include "systems/system.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+#include <thread>
+
+// How much of each new measurement goes into the cost of a recording
+static const double COST_SMOOTHING = 0.5;
+
+double Admission_Control::budget = 0;
+double Admission_Control::defer_ms = 0;
+int Admission_Control::cores = 1;
+double Admission_Control::last_cpu_seconds = -1;
+double Admission_Control::load = 0;
+double Admission_Control::recording_cost = 0;
+std::map<Recorder *, double> Admission_Control::last_work;
+std::map<std::string, Admission_Control::Counts> Admission_Control::counts;
+
+void Admission_Control::set_budget(double cpu_percent, double defer_seconds) {
+  budget = std::max(0.0, cpu_percent / 100.0);
+  defer_ms = std::max(0.0, defer_seconds * 1000.0);
+  cores = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool Admission_Control::enabled() {
+  return budget > 0;
+}
+
+void Admission_Control::update(std::vector<Source *> &sources, float timeDiff) {
+  if (!enabled() || (timeDiff <= 0)) {
+    return;
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return;
+  }
+  double cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  bool first = (last_cpu_seconds < 0);
+  if (!first) {
+    load = (cpu_seconds - last_cpu_seconds) / (timeDiff * cores);
+  }
+  last_cpu_seconds = cpu_seconds;
+
+  // What the recorders that were recording used, from their counters
+  bool counted = Flowgraph_Profiler::counters_enabled();
+  if (counted) {
+    Flowgraph_Profiler::update_recorder_cpu();
+  }
+  int recordings = 0;
+  double work_seconds = 0;
+  std::map<Recorder *, double> work;
+  for (std::vector<Source *>::iterator it = sources.begin(); it != sources.end(); ++it) {
+    std::vector<Recorder *> recorders = (*it)->get_recorders();
+    for (std::vector<Recorder *>::iterator rx = recorders.begin(); rx != recorders.end(); ++rx) {
+      if ((*rx)->is_active()) {
+        recordings++;
+      }
+      if (counted) {
+        work[*rx] = (*rx)->get_work_seconds();
+        std::map<Recorder *, double>::iterator last = last_work.find(*rx);
+        if (last != last_work.end()) {
+          work_seconds += std::max(0.0, work[*rx] - last->second);
+        }
+      }
+    }
+  }
+  last_work.swap(work);
+  if (first) {
+    return;
+  }
+
+  double cost;
+  if (counted && recordings) {
+    cost = work_seconds / (timeDiff * cores) / recordings;
+  } else {
+    cost = load / (recordings + 1);
+  }
+  recording_cost = (recording_cost > 0) ? recording_cost + COST_SMOOTHING * (cost - recording_cost) : cost;
+}
+
+double Admission_Control::projected_load() {
+  return load + recording_cost;
+}
+
+bool Admission_Control::saturated(Source *source) {
+  if (!enabled()) {
+    return false;
+  }
+  return (load > budget) || (source && (source->get_stats_window_overflows() > 0));
+}
+
+bool Admission_Control::admit(Call *call, System *sys, Source *source, int priority) {
+  if (!enabled()) {
+    return true;
+  }
+  bool overflowed = source && (source->get_stats_window_overflows() > 0);
+  if (!overflowed && (projected_load() <= budget)) {
+    return true;
+  }
+
+  Counts &count = counts[sys->get_short_name()];
+  std::string loghdr = log_header(call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+  std::stringstream reason;
+  reason << std::fixed << std::setprecision(0);
+  if (overflowed) {
+    reason << "Source " << source->get_num() << " overflowed";
+  } else {
+    reason << "CPU " << load * 100 << "% + " << std::setprecision(1) << recording_cost * 100 << "% over budget of " << std::setprecision(0) << budget * 100 << "%";
+  }
+
+  if (call->get_emergency() || (priority <= sys->get_admission_priority())) {
+    count.admitted++;
+    std::string why = call->get_emergency() ? "emergency" : "priority " + std::to_string(priority);
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mRecording over budget\u001b[0m - " << reason.str() << ", " << why;
+    return true;
+  }
+  if (call->get_monitoring_state() != ADMISSION) {
+    count.deferred++;
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mNot Recording: " << reason.str() << "\u001b[0m";
+  }
+  return false;
+}
+
+bool Admission_Control::can_retry(Call *call) {
+  return enabled() && (call->get_state() == MONITORING) && (call->get_monitoring_state() == ADMISSION) && (Replay_Clock::now_ms() - call->get_start_time_ms() < defer_ms);
+}
+
+void Admission_Control::count_resumed(System *sys) {
+  counts[sys->get_short_name()].resumed++;
+}
+
+void Admission_Control::print_stats() {
+  if (!enabled()) {
+    return;
+  }
+  BOOST_LOG_TRIVIAL(info) << "Admission Control - CPU: " << std::fixed << std::setprecision(0) << load * 100 << "% of " << cores << " cores Budget: " << budget * 100 << "% Per Recording: " << std::setprecision(1) << recording_cost * 100 << "%";
+  for (std::map<std::string, Counts>::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+    BOOST_LOG_TRIVIAL(info) << "\t[" << it->first << "]\tDeferred: " << it->second.deferred << " Resumed: " << it->second.resumed << " Recorded Over Budget: " << it->second.admitted;
+  }
+}
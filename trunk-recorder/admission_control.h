@@ -0,0 +1,72 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Call;
+class Recorder;
+class Source;
+class System;
+
+/*
+ * Admission_Control
+ *   Keeps new recordings of low priority talkgroups from being started
+ *   once the host is out of CPU, so the control channels and the calls
+ *   that matter keep going instead of every recorder degrading at once.
+ *
+ * The budget is admissionCpuBudget, a percent of all the cores. update()
+ * runs with the decode rate check and measures what the process has used
+ * since the last one. When the recorders' CPU accounting is on, the cost of
+ * a recording is what the recorders that were recording used each, from
+ * their performance counters. Otherwise the process's share is split over
+ * the recordings and one more. A new recording is over budget when the
+ * load and its cost are over the budget, or when the Source it would be on
+ * overflowed in the last window.
+ *
+ * Over budget, emergency calls and talkgroups with a priority number up to
+ * the System's admissionPriority are still recorded. Others are deferred:
+ * the call is monitored as ADMISSION, and an update for it within
+ * admissionDeferSeconds of its start tries again. A System's decisions are
+ * counted and printed with the status.
+ *
+ * While the host is over budget, a control channel that decodes too few
+ * messages isn't retuned, since it is the load and not the channel.
+ *
+ * Everything is called from the main loop.
+ */
+class Admission_Control {
+public:
+  static void set_budget(double cpu_percent, double defer_seconds);
+  static bool enabled();
+  static void update(std::vector<Source *> &sources, float timeDiff);
+  // False if a call with priority should be deferred instead of recorded on source
+  static bool admit(Call *call, System *sys, Source *source, int priority);
+  // Whether a deferred call is still recent enough to try again
+  static bool can_retry(Call *call);
+  static void count_resumed(System *sys);
+  // Over budget, or source overflowed in the last window
+  static bool saturated(Source *source);
+  static void print_stats();
+
+private:
+  struct Counts {
+    long admitted;  // while over budget, because they matter
+    long deferred;
+    long resumed;   // started on a later try
+  };
+
+  static double projected_load();
+
+  static double budget;
+  static double defer_ms;
+  static int cores;
+  static double last_cpu_seconds;
+  static double load;           // share of all the cores, over the last window
+  static double recording_cost; // share of all the cores one recording takes
+  static std::map<Recorder *, double> last_work;
+  static std::map<std::string, Counts> counts;
+};
+
+#endif // ADMISSION_CONTROL_H
@@ -23,13 +23,17 @@
  * Each status display will show the current averages per source, as well as a suggested
  * "error" value for the config file to pre-correct future runs.
  *
- * Operation is currently limited to P25 voice channels (conventional/trunked) and P25
- * control channels, but may be expanded to other modes once it is verified that the
- * underlying FLL error readings are accurate.
+ * Operation is currently limited to P25 and DMR voice channels (conventional/trunked) and
+ * P25 control channels, but may be expanded to other modes once it is verified that the
+ * underlying FLL error readings are accurate.  The analog recorders' FLL is set up for a
+ * symbol rate FM voice doesn't have, so their readings aren't used.  All of a source's
+ * recorders and control channels add to the same history, so a busy source is corrected
+ * from many calls rather than one channel.
  *
  * General Operation:
  * 1) When enabled, AutotuneManager collects error measurements for each source.
- * 2) Average tuning error is calculated from the last 20 measurements.
+ * 2) Average tuning error is calculated from the last 20 measurements.  They are kept in a
+ *    circular buffer with a running sum, and the average is read without taking the lock.
  * 3) When a recorder starts, the average error is applied as a frequency offset.
  * 4) When a recorder stops, the running average is updated with observed error measurements.
  * 5) On each status display, source parameters and suggested error values are shown.
@@ -42,6 +46,12 @@
  *
  */
 
+// Whether a message at level would make it into the log, so the list of
+// errors is only put together when someone will see it
+static bool log_enabled(boost::log::trivial::severity_level level) {
+  return (bool)boost::log::trivial::logger::get().open_record(boost::log::keywords::severity = level);
+}
+
 /**
  * Constructor
  *
@@ -60,33 +70,35 @@ AutotuneManager::AutotuneManager(Source *source)
 void AutotuneManager::add_error_measurement(int observed_error, int current_offset) {
   std::lock_guard<std::mutex> lock(history_mutex);
 
-  // Add the total error (observed + current offset) to history, removing the oldest value
+  // Add the total error (observed + current offset) to history, replacing the oldest value
   int total_error = observed_error + current_offset;
-  error_history.push_front(total_error);
-
-  if (error_history.size() > MAX_HISTORY) {
-    error_history.pop_back();
+  if (history_count == MAX_HISTORY) {
+    history_sum -= error_history[history_next];
+  } else {
+    history_count++;
   }
+  error_history[history_next] = total_error;
+  history_sum += total_error;
+  history_next = (history_next + 1) % MAX_HISTORY;
 
-  // Recalculate the average
-  int total_errors = 0;
-  std::ostringstream debug_errors;
+  int average = static_cast<int>(history_sum / static_cast<long>(history_count));
+  average_error.store(average, std::memory_order_relaxed);
 
-  for (const auto &error : error_history) {
-    total_errors += error;
-    debug_errors << error << " ";
+  if (log_enabled(boost::log::trivial::debug)) {
+    std::ostringstream debug_errors;
+    for (size_t i = 0; i < history_count; i++) {
+      debug_errors << error_history[(history_next + MAX_HISTORY - 1 - i) % MAX_HISTORY] << " ";
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Source: " << parent_source->get_num() << " - Errors: " << debug_errors.str() << " Avg: " << average;
   }
 
-  average_error = total_errors / static_cast<int>(error_history.size());
-  BOOST_LOG_TRIVIAL(debug) << "Source: " << parent_source->get_num() << " - Errors: " << debug_errors.str() << " Avg: " << average_error;
-
   // Warn if calculated error offset > PPM_THRESHOLD
   double center_freq = parent_source->get_center();
   if (center_freq != 0.0) {
-    double ppm_correction = static_cast<double>(average_error) / (center_freq / 1000000.0);
+    double ppm_correction = static_cast<double>(average) / (center_freq / 1000000.0);
     if (std::abs(ppm_correction) > PPM_THRESHOLD) {
       BOOST_LOG_TRIVIAL(warning) << "Source " << parent_source->get_num()
-                                 << " - AutoTune offset: " << average_error
+                                 << " - AutoTune offset: " << average
                                  << " Hz exceeds " << PPM_THRESHOLD << " PPM (based on center freq "
                                  << center_freq / 1e6 << " MHz). "
                                  << "Verify initial offset used in config file.";
@@ -100,7 +112,7 @@ void AutotuneManager::add_error_measurement(int observed_error, int current_offs
  * @return Average error in Hz
  */
 int AutotuneManager::get_average_error() const {
-  return average_error;
+  return average_error.load(std::memory_order_relaxed);
 }
 
 /**
@@ -126,7 +138,9 @@ std::string AutotuneManager::get_status_string() const {
  */
 void AutotuneManager::reset() {
   std::lock_guard<std::mutex> lock(history_mutex);
-  error_history.clear();
+  history_next = 0;
+  history_count = 0;
+  history_sum = 0;
 }
 
 /**
@@ -1,9 +1,9 @@
 #ifndef AUTOTUNE_H
 #define AUTOTUNE_H
 
+#include <atomic>
 #include <boost/log/trivial.hpp>
 #include <cmath>
-#include <deque>
 #include <mutex>
 
 class Source;
@@ -11,16 +11,19 @@ class System;
 
 class AutotuneManager {
 private:
-  Source *parent_source;
-  std::mutex history_mutex;
-
-  std::deque<int> error_history; // Last 20 error measurements (in Hz)
-  int average_error = 0;         // Running average correction value (in Hz)
-
   static const size_t MAX_HISTORY = 20;               // Maximum number of error measurements to keep
   static constexpr double PPM_THRESHOLD = 3.5;        // Warning threshold in PPM
   static constexpr int SUGGESTED_ERROR_ROUNDING = 10; // Round suggested error to nearest X Hz
 
+  Source *parent_source;
+  std::mutex history_mutex; // only taken to add a measurement, or reset
+
+  int error_history[MAX_HISTORY]; // Last 20 error measurements (in Hz), oldest at history_next once full
+  size_t history_next = 0;
+  size_t history_count = 0;
+  long history_sum = 0;
+  std::atomic<int> average_error{0}; // Running average correction value (in Hz)
+
 public:
   explicit AutotuneManager(Source *source);
 
@@ -21,7 +21,7 @@ class System;
 class Call {
 public:
   // static Call * make(long t, double f, System *s, Config c);
-  static Call *make(TrunkMessage message, System *s, Config c);
+  static Call *make(TrunkMessage message, System *s, const Config &c);
   virtual ~Call(){};
   virtual long get_call_num() = 0;
   virtual void restart_call() = 0;
@@ -65,6 +65,14 @@ public:
   virtual int get_tdma_slot() = 0;
   virtual bool get_is_analog() = 0;
   virtual void set_is_analog(bool a) = 0;
+  virtual void set_source_allocation(Source_Allocation a) = 0;
+  virtual Source_Allocation get_source_allocation() = 0;
+  virtual void add_duplicate_grant(Duplicate_Grant grant) = 0;
+  virtual std::vector<Duplicate_Grant> get_duplicate_grants() = 0;
+  virtual void mark_latency(Call_Latency_Stage stage) = 0;
+  virtual std::int64_t get_latency_mark(Call_Latency_Stage stage) = 0;
+  virtual void set_pre_tuned(bool m) = 0;
+  virtual bool get_pre_tuned() = 0;
   virtual const char *get_xor_mask() = 0;
   virtual time_t get_start_time() = 0;
   virtual std::int64_t get_start_time_ms() = 0;
@@ -87,6 +95,8 @@ public:
   virtual boost::property_tree::ptree get_stats() = 0;
 
   virtual std::string get_talkgroup_tag() = 0;
+  virtual void set_encoded_filename(std::string filename) = 0;
+  virtual std::string get_encoded_filename() = 0;
   virtual std::string get_system_type() = 0;
   virtual double get_final_length() = 0;
   virtual long get_current_source_id() = 0;
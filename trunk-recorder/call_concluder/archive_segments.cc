@@ -0,0 +1,203 @@
+#include "archive_segments.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+bool Archive_Segments::on = false;
+double Archive_Segments::sync_seconds = 5;
+std::mutex Archive_Segments::segments_mutex;
+std::map<std::string, std::shared_ptr<Archive_Segments::Segment>> Archive_Segments::segments;
+
+static const std::chrono::minutes SEGMENT_IDLE(10);
+
+static bool write_at(int fd, const char *data, size_t length, off_t offset) {
+  while (length > 0) {
+    ssize_t written = pwrite(fd, data, length, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    length -= written;
+    offset += written;
+  }
+  return true;
+}
+
+void Archive_Segments::set_enabled(bool enabled, double seconds) {
+  on = enabled;
+  sync_seconds = seconds;
+}
+
+bool Archive_Segments::enabled() {
+  return on;
+}
+
+std::shared_ptr<Archive_Segments::Segment> Archive_Segments::open_segment(const std::string &base) {
+  std::lock_guard<std::mutex> lock(segments_mutex);
+  close_idle();
+
+  std::map<std::string, std::shared_ptr<Segment>>::iterator it = segments.find(base);
+  if (it != segments.end()) {
+    return it->second;
+  }
+
+  std::string data_filename = base + ".seg";
+  std::string index_filename = base + ".idx";
+  int data_fd = ::open(data_filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  int index_fd = ::open(index_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  struct stat statbuf;
+  if ((data_fd < 0) || (index_fd < 0) || (fstat(data_fd, &statbuf) != 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to open " << data_filename << ": " << strerror(errno);
+    if (data_fd >= 0) {
+      close(data_fd);
+    }
+    if (index_fd >= 0) {
+      close(index_fd);
+    }
+    return std::shared_ptr<Segment>();
+  }
+
+  std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+  segment->data_fd = data_fd;
+  segment->index_fd = index_fd;
+  segment->size = statbuf.st_size;
+  segment->dirty = false;
+  segment->closed = false;
+  segment->last_sync = std::chrono::steady_clock::now();
+  segment->last_write = segment->last_sync;
+  segments[base] = segment;
+  return segment;
+}
+
+// The data goes to disk before the index that points to it
+void Archive_Segments::sync(Segment &segment) {
+  if (segment.dirty) {
+    if ((fdatasync(segment.data_fd) != 0) || (fdatasync(segment.index_fd) != 0)) {
+      BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to sync a segment: " << strerror(errno);
+    }
+    segment.dirty = false;
+  }
+  segment.last_sync = std::chrono::steady_clock::now();
+}
+
+// Called with segments_mutex held. A segment being appended to is left for
+// next time.
+void Archive_Segments::close_idle() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  for (std::map<std::string, std::shared_ptr<Segment>>::iterator it = segments.begin(); it != segments.end();) {
+    Segment &segment = *it->second;
+    std::unique_lock<std::mutex> lock(segment.mutex, std::try_to_lock);
+    if (lock.owns_lock() && (now - segment.last_write > SEGMENT_IDLE)) {
+      sync(segment);
+      close(segment.data_fd);
+      close(segment.index_fd);
+      segment.closed = true;
+      lock.unlock();
+      it = segments.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool Archive_Segments::append(const Call_Data_t &call_info, Segment_Location *location) {
+  std::string audio_filename = call_info.filename;
+  std::string audio_format = "wav";
+  boost::system::error_code ec;
+  if (call_info.compress_wav && boost::filesystem::is_regular_file(call_info.converted, ec)) {
+    audio_filename = call_info.converted;
+    audio_format = "m4a";
+  }
+
+  std::ifstream audio_file(audio_filename, std::ios::binary);
+  if (!audio_file.is_open()) {
+    BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to read " << audio_filename;
+    return false;
+  }
+  std::vector<char> audio((std::istreambuf_iterator<char>(audio_file)), std::istreambuf_iterator<char>());
+  audio_file.close();
+  const std::string empty;
+  const std::string &json = call_info.call_json ? *call_info.call_json : empty;
+
+  time_t start_time = call_info.start_time;
+  struct tm ltm;
+  localtime_r(&start_time, &ltm);
+  char hour[4];
+  strftime(hour, sizeof(hour), "%H", &ltm);
+  std::string base = (boost::filesystem::path(call_info.filename).parent_path() / hour).string();
+
+  std::shared_ptr<Segment> segment;
+  std::unique_lock<std::mutex> lock;
+  do {
+    segment = open_segment(base);
+    if (!segment) {
+      return false;
+    }
+    lock = std::unique_lock<std::mutex>(segment->mutex);
+  } while (segment->closed);
+  off_t audio_offset = segment->size;
+  off_t json_offset = audio_offset + audio.size();
+  if (!write_at(segment->data_fd, audio.data(), audio.size(), audio_offset) || !write_at(segment->data_fd, json.data(), json.size(), json_offset)) {
+    BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to write to " << base << ".seg: " << strerror(errno);
+    if (ftruncate(segment->data_fd, audio_offset) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to cut " << base << ".seg back: " << strerror(errno);
+    }
+    return false;
+  }
+  segment->size = json_offset + json.size();
+
+  char line[256];
+  int length = snprintf(line, sizeof(line), "%lld\t%lld\t%ld\t%ld\t%.0f\t%lld\t%zu\t%s\t%lld\t%zu\n",
+                        (long long)call_info.start_time_ms, (long long)call_info.stop_time_ms, call_info.talkgroup, call_info.call_num, call_info.freq,
+                        (long long)audio_offset, audio.size(), audio_format.c_str(), (long long)json_offset, json.size());
+  if (write(segment->index_fd, line, length) != length) {
+    BOOST_LOG_TRIVIAL(error) << "Archive Segments: unable to write to " << base << ".idx: " << strerror(errno);
+    return false;
+  }
+
+  if (location) {
+    location->segment = base + ".seg";
+    location->audio_offset = audio_offset;
+    location->audio_length = audio.size();
+    location->audio_format = audio_format;
+    location->json_offset = json_offset;
+    location->json_length = json.size();
+  }
+
+  segment->dirty = true;
+  segment->last_write = std::chrono::steady_clock::now();
+  if (segment->last_write - segment->last_sync >= std::chrono::duration<double>(sync_seconds)) {
+    sync(*segment);
+  }
+  return true;
+}
+
+// A segment still being appended to by a worker that shutdown gave up on is
+// left to the OS
+void Archive_Segments::close_all() {
+  std::lock_guard<std::mutex> lock(segments_mutex);
+  for (std::map<std::string, std::shared_ptr<Segment>>::iterator it = segments.begin(); it != segments.end(); ++it) {
+    std::unique_lock<std::mutex> segment_lock(it->second->mutex, std::try_to_lock);
+    if (!segment_lock.owns_lock()) {
+      continue;
+    }
+    sync(*it->second);
+    close(it->second->data_fd);
+    close(it->second->index_fd);
+    it->second->closed = true;
+  }
+  segments.clear();
+}
@@ -0,0 +1,75 @@
+#ifndef ARCHIVE_SEGMENTS_H
+#define ARCHIVE_SEGMENTS_H
+
+#include "../global_structs.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+// Where append() put a call
+struct Segment_Location {
+  std::string segment; // the HH.seg file
+  long long audio_offset;
+  size_t audio_length;
+  std::string audio_format;
+  long long json_offset;
+  size_t json_length;
+};
+
+/*
+ * Archive_Segments
+ *   Archives concluded calls into one pair of files per system per hour
+ *   instead of a file or two per call, for archives big enough that the
+ *   number of files is the problem.
+ *
+ * Each call's audio, the m4a if it was compressed or else the wav, and
+ * its JSON are appended to HH.seg in the directory the call's own files
+ * would have gone in, and a line is appended to HH.idx:
+ *
+ *   start_time_ms stop_time_ms talkgroup call_num freq audio_offset
+ *   audio_length audio_format json_offset json_length
+ *
+ * tab separated, with the offsets and lengths in bytes into HH.seg. The
+ * index line is written after the data it points to. utils/archive-query
+ * lists and extracts calls.
+ *
+ * Writes are only flushed to disk every sync_seconds per segment, as the
+ * data first and then the index, and when a segment is closed. A segment
+ * is closed once it has had no writes for ten minutes and at shutdown.
+ * Workers append to different segments at the same time; appends to one
+ * segment take turns.
+ */
+class Archive_Segments {
+public:
+  static void set_enabled(bool enabled, double sync_seconds);
+  static bool enabled();
+  static bool append(const Call_Data_t &call_info, Segment_Location *location = NULL);
+  static void close_all();
+
+private:
+  struct Segment {
+    std::mutex mutex;
+    int data_fd;
+    int index_fd;
+    off_t size;
+    bool dirty;
+    bool closed; // by close_idle(), after it was handed out
+    std::chrono::steady_clock::time_point last_sync;
+    std::chrono::steady_clock::time_point last_write;
+  };
+
+  static std::shared_ptr<Segment> open_segment(const std::string &base);
+  static void sync(Segment &segment);
+  static void close_idle();
+
+  static bool on;
+  static double sync_seconds;
+  static std::mutex segments_mutex;
+  static std::map<std::string, std::shared_ptr<Segment>> segments;
+};
+
+#endif // ARCHIVE_SEGMENTS_H
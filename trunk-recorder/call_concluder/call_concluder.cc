@@ -1,11 +1,27 @@
 #include "call_concluder.h"
+#include "../gr_blocks/wav_writer.h"
+#include "../gr_blocks/wavfile_gr3.8.h"
+#include "../call_latency.h"
+#include "../json_writer.h"
+#include "../trace.h"
+#include "archive_segments.h"
+#include "recent_calls.h"
+#include "retry_journal.h"
 #include "../plugin_manager/plugin_manager.h"
 #include <boost/filesystem.hpp>
 #include <filesystem>
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <set>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 namespace fs = std::filesystem;
 
 // ---------------------------------------------------------------------------
@@ -224,7 +240,367 @@ static std::string expand_filename_format(const std::string &format,
 
 const int Call_Concluder::MAX_RETRY = 2;
 std::list<std::future<Call_Data_t>> Call_Concluder::call_data_workers = {};
-std::list<Call_Data_t> Call_Concluder::retry_call_list = {};
+std::vector<Call_Data_t> Call_Concluder::retry_calls = {};
+double Call_Concluder::retry_rate = 5;
+double Call_Concluder::retry_tokens = 5;
+std::chrono::steady_clock::time_point Call_Concluder::retry_refill = std::chrono::steady_clock::now();
+double Call_Concluder::backlog_max_seconds = 0;
+double Call_Concluder::backlog_max_bytes = 0;
+
+// For std::push_heap(), which makes a max heap, to put the next retry in front
+static bool retry_later(const Call_Data_t &a, const Call_Data_t &b) {
+  return a.process_call_time > b.process_call_time;
+}
+
+namespace {
+struct Concluder_Task {
+  Call_Data_t call_info;
+  std::promise<Call_Data_t> result;
+};
+
+// What the queue is sorted by, with the call itself behind a pointer so it
+// isn't copied as the queue is reordered
+struct Concluder_Job {
+  bool emergency;
+  int talkgroup_priority;
+  uint64_t seq;
+  std::chrono::steady_clock::time_point queued;
+  long long bytes;
+  std::multiset<std::chrono::steady_clock::time_point>::iterator pending;
+  std::shared_ptr<Concluder_Task> task;
+};
+
+// Which job std::priority_queue should put behind the other
+struct Concluder_Job_Order {
+  bool operator()(const Concluder_Job &a, const Concluder_Job &b) const {
+    if (a.emergency != b.emergency) {
+      return !a.emergency;
+    }
+    if (a.talkgroup_priority != b.talkgroup_priority) {
+      return a.talkgroup_priority > b.talkgroup_priority;
+    }
+    return a.seq > b.seq;
+  }
+};
+
+// The steps of concluding a call that are timed, in order
+enum Concluder_Stage {
+  STAGE_QUEUED,
+  STAGE_JOIN,
+  STAGE_JSON,
+  STAGE_ENCODE,
+  STAGE_UPLOAD_SCRIPT,
+  STAGE_PLUGINS,
+  STAGE_CLEANUP,
+  STAGE_TOTAL,
+  STAGE_COUNT
+};
+
+const char *const stage_names[STAGE_COUNT] = {"queued", "join", "json", "encode", "upload script", "plugins", "cleanup", "total"};
+
+// Allocated once and never freed: the workers are detached and may still be
+// waiting on it when the program exits
+struct Concluder_Pool {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::priority_queue<Concluder_Job, std::vector<Concluder_Job>, Concluder_Job_Order> jobs;
+  int worker_count = 0;
+  int started = 0;
+  int busy = 0;
+  uint64_t seq = 0;
+  long concluded = 0;
+  size_t max_depth = 0;
+  std::int64_t max_wait_ms = 0;
+  Latency_Histogram conclude_time; // main thread time in conclude_call()
+  std::multiset<std::chrono::steady_clock::time_point> pending; // when each queued or running job was queued
+  long long bytes_pending = 0;
+  Latency_Histogram stages[STAGE_COUNT];
+};
+
+Concluder_Pool &concluder_pool() {
+  static Concluder_Pool *pool = new Concluder_Pool();
+  return *pool;
+}
+
+int default_worker_count() {
+  return std::max(2, (int)std::thread::hardware_concurrency() / 2);
+}
+
+// Records the time from since to now for stage, and starts the next stage
+void record_stage(Concluder_Stage stage, std::chrono::steady_clock::time_point &since, long call_num) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (Trace::enabled()) {
+    Trace::complete(stage_names[stage], since, now, call_num, TRACE_FLOW_STEP);
+  }
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  pool.stages[stage].record(std::chrono::duration_cast<std::chrono::microseconds>(now - since).count());
+  since = now;
+}
+} // namespace
+
+// Calls already queued keep the workers they have, 0 picks half the cores
+void Call_Concluder::set_worker_count(int count) {
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  pool.worker_count = (count > 0) ? count : default_worker_count();
+}
+
+std::future<Call_Data_t> Call_Concluder::queue_call(Call_Data_t call_info) {
+  Concluder_Pool &pool = concluder_pool();
+  Concluder_Job job;
+  job.emergency = call_info.emergency;
+  job.talkgroup_priority = call_info.talkgroup_priority;
+  job.queued = std::chrono::steady_clock::now();
+  job.bytes = 0;
+  for (std::vector<Transmission>::const_iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
+    job.bytes += it->audio ? (long long)it->audio->bytes : (long long)it->sample_count * 2 + Wav_Writer::HEADER_SIZE;
+  }
+  job.task = std::make_shared<Concluder_Task>();
+  job.task->call_info = std::move(call_info);
+  std::future<Call_Data_t> future = job.task->result.get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.worker_count == 0) {
+      pool.worker_count = default_worker_count();
+    }
+    // Workers are started as they are needed, up to worker_count
+    if ((pool.started < pool.worker_count) && (pool.busy + pool.jobs.size() >= (size_t)pool.started)) {
+      std::thread(&Call_Concluder::run_worker).detach();
+      pool.started++;
+    }
+    job.seq = ++pool.seq;
+    job.pending = pool.pending.insert(job.queued);
+    pool.bytes_pending += job.bytes;
+    pool.jobs.push(std::move(job));
+    pool.max_depth = std::max(pool.max_depth, pool.jobs.size());
+  }
+  pool.ready.notify_one();
+  return future;
+}
+
+void Call_Concluder::run_worker() {
+  Concluder_Pool &pool = concluder_pool();
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  while (true) {
+    pool.ready.wait(lock, [&pool] { return !pool.jobs.empty(); });
+    Concluder_Job job = pool.jobs.top();
+    pool.jobs.pop();
+    pool.busy++;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::int64_t wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(begin - job.queued).count();
+    pool.max_wait_ms = std::max(pool.max_wait_ms, wait_ms);
+    pool.stages[STAGE_QUEUED].record(std::chrono::duration_cast<std::chrono::microseconds>(begin - job.queued).count());
+    lock.unlock();
+
+    long call_num = job.task->call_info.call_num;
+    if (Trace::enabled()) {
+      Trace::complete(stage_names[STAGE_QUEUED], job.queued, begin, call_num, TRACE_FLOW_STEP);
+    }
+    try {
+      job.task->result.set_value(upload_call_worker(std::move(job.task->call_info)));
+    } catch (...) {
+      job.task->result.set_exception(std::current_exception());
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    if (Trace::enabled()) {
+      Trace::complete("conclude", begin, end, call_num, TRACE_FLOW_END);
+    }
+
+    lock.lock();
+    pool.stages[STAGE_TOTAL].record(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+    pool.busy--;
+    pool.concluded++;
+    pool.pending.erase(job.pending);
+    pool.bytes_pending -= job.bytes;
+  }
+}
+
+// 0 turns a limit off
+void Call_Concluder::set_backlog_limits(double max_seconds, double max_mb) {
+  backlog_max_seconds = max_seconds;
+  backlog_max_bytes = max_mb * 1024 * 1024;
+}
+
+Concluder_Load Call_Concluder::get_load() {
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  Concluder_Load load;
+  load.calls_pending = pool.pending.size();
+  load.workers_busy = pool.busy;
+  load.bytes_pending = pool.bytes_pending;
+  load.oldest_seconds = pool.pending.empty() ? 0 : std::chrono::duration<double>(std::chrono::steady_clock::now() - *pool.pending.begin()).count();
+  load.level = 0;
+  if (backlog_max_seconds > 0) {
+    load.level = std::max(load.level, load.oldest_seconds / backlog_max_seconds);
+  }
+  if (backlog_max_bytes > 0) {
+    load.level = std::max(load.level, load.bytes_pending / backlog_max_bytes);
+  }
+  return load;
+}
+
+// Talkgroups with a higher priority number are let go sooner as the backlog
+// grows: priority 2 at the limit, 3 at half of it, 5 at a quarter and so
+// on. Priority 1 is always recorded, and unknown talkgroups go first.
+bool Call_Concluder::shed_call(int priority) {
+  if ((priority <= 1) || ((backlog_max_seconds <= 0) && (backlog_max_bytes <= 0))) {
+    return false;
+  }
+  return get_load().level >= 1.0 / (priority - 1);
+}
+
+// Totals since startup, for every stage that has been timed
+std::vector<Concluder_Stage_Stats> Call_Concluder::get_stage_stats() {
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  std::vector<Concluder_Stage_Stats> stats;
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    if (pool.stages[i].count()) {
+      Concluder_Stage_Stats stage;
+      stage.stage = stage_names[i];
+      stage.latency = Call_Latency::summarize(pool.stages[i]);
+      stats.push_back(stage);
+    }
+  }
+  return stats;
+}
+
+void Call_Concluder::print_stats() {
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  Latency_Summary conclude_time = Call_Latency::summarize(pool.conclude_time);
+  BOOST_LOG_TRIVIAL(info) << "Call Concluder - Workers: " << pool.busy << "/" << pool.worker_count << " busy Queued: " << pool.jobs.size() << " Max Queued: " << pool.max_depth << " Max Wait: " << pool.max_wait_ms << " ms Concluded: " << pool.concluded << " Retry Queue: " << retry_calls.size()
+                          << std::fixed << std::setprecision(2) << " Main Thread p50/p99/max ms: " << conclude_time.p50_ms << "/" << conclude_time.p99_ms << "/" << conclude_time.max_ms
+                          << " Pending: " << pool.bytes_pending / 1024 << " KB Oldest: " << (pool.pending.empty() ? 0 : std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - *pool.pending.begin()).count()) << " s";
+  pool.max_depth = pool.jobs.size();
+  pool.max_wait_ms = 0;
+
+  std::stringstream stages;
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    if (pool.stages[i].count()) {
+      Latency_Summary stage = Call_Latency::summarize(pool.stages[i]);
+      stages << " " << stage_names[i] << ": " << std::fixed << std::setprecision(2) << stage.p50_ms << "/" << stage.p99_ms;
+    }
+  }
+  if (!stages.str().empty()) {
+    BOOST_LOG_TRIVIAL(info) << "Call Concluder - Stage p50/p99 ms -" << stages.str();
+  }
+}
+
+// Copies length bytes from offset in in_fd to the end of out_fd, in the
+// kernel where it can
+static bool copy_wav_data(int in_fd, off_t offset, int out_fd, size_t length) {
+#ifdef __linux__
+  bool use_copy_range = true;
+#endif
+  while (length > 0) {
+    ssize_t copied = -1;
+#ifdef __linux__
+    if (use_copy_range) {
+      loff_t in_offset = offset;
+      copied = copy_file_range(in_fd, &in_offset, out_fd, NULL, length, 0);
+      if ((copied < 0) && ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) || (errno == EOPNOTSUPP))) {
+        use_copy_range = false;
+        continue;
+      }
+    } else {
+      off_t in_offset = offset;
+      copied = sendfile(out_fd, in_fd, &in_offset, length);
+    }
+#else
+    char buffer[65536];
+    copied = pread(in_fd, buffer, std::min(length, sizeof(buffer)), offset);
+    if (copied > 0) {
+      copied = write(out_fd, buffer, copied);
+    }
+#endif
+    if (copied < 0 && errno == EINTR) {
+      continue;
+    }
+    if (copied <= 0) {
+      return false;
+    }
+    offset += copied;
+    length -= copied;
+  }
+  return true;
+}
+
+// Joins wav files that all have the same format by copying their data
+// chunks after one header, returns false if they can't be joined that way
+bool concatenate_wav(const std::vector<std::string> &files, const std::string &target_filename) {
+  struct Part {
+    int fd;
+    off_t offset;
+    size_t length;
+  };
+  std::vector<Part> parts;
+  unsigned int sample_rate = 0;
+  int nchans = 0;
+  int bytes_per_sample = 0;
+  bool ok = !files.empty();
+
+  for (std::vector<std::string>::const_iterator it = files.begin(); ok && (it != files.end()); ++it) {
+    FILE *fp = fopen(it->c_str(), "rb");
+    if (!fp) {
+      ok = false;
+      break;
+    }
+
+    unsigned int rate;
+    int chans;
+    int bytes;
+    int first_sample_pos;
+    unsigned int samples_per_chan;
+    struct stat statbuf;
+    ok = gr::blocks::wavheader_parse(fp, rate, chans, bytes, first_sample_pos, samples_per_chan) && (fstat(fileno(fp), &statbuf) == 0);
+    if (ok && parts.empty()) {
+      sample_rate = rate;
+      nchans = chans;
+      bytes_per_sample = bytes;
+    }
+    ok = ok && (rate == sample_rate) && (chans == nchans) && (bytes == bytes_per_sample);
+
+    if (ok) {
+      // A header that was never completed says there is no data, trust the file size
+      size_t on_disk = (statbuf.st_size > first_sample_pos) ? statbuf.st_size - first_sample_pos : 0;
+      size_t length = (size_t)samples_per_chan * chans * bytes;
+      if ((length == 0) || (length > on_disk)) {
+        length = on_disk - (on_disk % (chans * bytes));
+      }
+      Part part = {dup(fileno(fp)), first_sample_pos, length};
+      ok = (part.fd >= 0);
+      if (ok) {
+        parts.push_back(part);
+      }
+    }
+    fclose(fp);
+  }
+
+  FILE *out = NULL;
+  size_t bytes_written = 0;
+  if (ok) {
+    out = fopen(target_filename.c_str(), "wb");
+    ok = out && gr::blocks::wavheader_write(out, sample_rate, nchans, bytes_per_sample) && (fflush(out) == 0);
+  }
+  for (std::vector<Part>::iterator it = parts.begin(); it != parts.end(); ++it) {
+    if (ok) {
+      ok = copy_wav_data(it->fd, it->offset, fileno(out), it->length);
+      bytes_written += it->length;
+    }
+    close(it->fd);
+  }
+  if (out) {
+    ok = ok && gr::blocks::wavheader_complete(out, bytes_written);
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+      std::remove(target_filename.c_str());
+    }
+  }
+  return ok;
+}
 
 int combine_wav(const std::string &files, const std::string &target_filename) {
   const std::string shell_command = "sox " + files + " '" + target_filename + "' ";
@@ -260,78 +636,204 @@ int convert_media(const std::string &filename, const std::string &converted, con
   return static_cast<int>(shell_command_string.size());
 }
 
+// Does what convert_media() does for a 16 bit wav file in one pass, without
+// sox: the samples are scaled to -0.01 dBFS from the peak found when they
+// were recorded and piped to fdkaac as raw audio
+int encode_media(const std::string &filename, const std::string &converted, const std::string &date, const std::string &short_name, const std::string &talkgroup, int peak) {
+  FILE *in = fopen(filename.c_str(), "rb");
+  if (!in) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to open call recording: " << filename;
+    return -1;
+  }
+
+  unsigned int sample_rate;
+  int nchans;
+  int bytes_per_sample;
+  int first_sample_pos;
+  unsigned int samples_per_chan;
+  if (!gr::blocks::wavheader_parse(in, sample_rate, nchans, bytes_per_sample, first_sample_pos, samples_per_chan) || (bytes_per_sample != 2)) {
+    fclose(in);
+    return -1;
+  }
+
+  std::stringstream shell_command;
+  shell_command << "fdkaac --silent -p 2 -R --raw-channels " << nchans << " --raw-rate " << sample_rate
+                << " --raw-format S16L --date '" << date << "' --artist '" << short_name << "' --title '" << talkgroup
+                << "' --moov-before-mdat -b 8000 -o '" << converted << "' -";
+  const std::string shell_command_string = shell_command.str();
+
+  BOOST_LOG_TRIVIAL(trace) << "Converting: " << converted;
+  BOOST_LOG_TRIVIAL(trace) << "Command: " << shell_command_string;
+
+  FILE *out = popen(shell_command_string.c_str(), "w");
+  if (!out) {
+    fclose(in);
+    BOOST_LOG_TRIVIAL(error) << "Failed to convert call recording. Make sure you have fdkaac installed.";
+    return -1;
+  }
+
+  // Silence is left as it is, like sox does
+  double gain = (peak > 0) ? 32768.0 * std::pow(10.0, -0.01 / 20.0) / peak : 1.0;
+  unsigned char buffer[8192];
+  size_t remaining = (size_t)samples_per_chan * nchans * 2;
+  bool ok = true;
+  while (ok && remaining > 0) {
+    size_t got = fread(buffer, 1, std::min(remaining, sizeof(buffer)), in);
+    got -= got % 2;
+    if (got == 0) {
+      break;
+    }
+    for (size_t i = 0; i < got; i += 2) {
+      double scaled = std::round((int16_t)(buffer[i] | (buffer[i + 1] << 8)) * gain);
+      int16_t sample = (int16_t)std::max(-32768.0, std::min(32767.0, scaled));
+      buffer[i] = sample & 0xff;
+      buffer[i + 1] = (sample >> 8) & 0xff;
+    }
+    ok = (fwrite(buffer, 1, got, out) == got);
+    remaining -= got;
+  }
+  fclose(in);
+
+  int rc = pclose(out);
+  if (!ok || (rc != 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to convert call recording. Make sure you have fdkaac installed.";
+    return -1;
+  }
+  BOOST_LOG_TRIVIAL(trace) << "Finished converting call";
+  return static_cast<int>(shell_command_string.size());
+}
+
 int create_call_json(Call_Data_t& call_info) {
-  // Create call JSON, write it to disk, and pass back a json object to call_info
+  // Write the call JSON in one pass, save it to disk, and pass the text back to call_info
 
-  // Using nlohmann::ordered_json to preserve the previous order
+  // Keys are written in the same order as previous versions
   // Bools are stored as 0 or 1 as in previous versions
   // Call length is rounded up to the nearest second as in previous versions
   // Time stored in fractional seconds will omit trailing zeroes per json spec (1.20 -> 1.2)
 
-  nlohmann::ordered_json json_data =
-      {
-          {"freq", int(call_info.freq)},
-          {"freq_error", int(call_info.freq_error)},
-          {"signal", int(call_info.signal)},
-          {"noise", int(call_info.noise)},
-          {"source_num", int(call_info.source_num)},
-          {"recorder_num", int(call_info.recorder_num)},
-          {"tdma_slot", int(call_info.tdma_slot)},
-          {"phase2_tdma", int(call_info.phase2_tdma)},
-          {"start_time", call_info.start_time},
-          {"stop_time", call_info.stop_time},
-          {"start_time_ms", call_info.start_time_ms},
-          {"stop_time_ms", call_info.stop_time_ms},
-          {"emergency", int(call_info.emergency)},
-          {"priority", call_info.priority},
-          {"mode", int(call_info.mode)},
-          {"duplex", int(call_info.duplex)},
-          {"encrypted",int(call_info.encrypted)},
-          {"call_length", int(std::round(call_info.length))},
-          {"call_length_ms", call_info.call_length_ms},
-          {"talkgroup", call_info.talkgroup},
-          {"talkgroup_tag", call_info.talkgroup_alpha_tag},
-          {"talkgroup_description", call_info.talkgroup_description},
-          {"talkgroup_group_tag", call_info.talkgroup_tag},
-          {"talkgroup_group", call_info.talkgroup_group},
-          {"color_code", call_info.color_code},
-          {"audio_type", call_info.audio_type},
-          {"short_name", call_info.short_name}
-        };
+  std::shared_ptr<std::string> text = std::make_shared<std::string>();
+  text->reserve(1024 + 160 * (call_info.transmission_error_list.size() + call_info.transmission_source_list.size()));
+  Json_Writer json(*text, 2);
+
+  json.begin_object();
+  json.field("freq", int(call_info.freq));
+  json.field("freq_error", int(call_info.freq_error));
+  json.field("signal", int(call_info.signal));
+  json.field("noise", int(call_info.noise));
+  json.field("source_num", int(call_info.source_num));
+  json.field("recorder_num", int(call_info.recorder_num));
+  json.field("tdma_slot", int(call_info.tdma_slot));
+  json.field("phase2_tdma", int(call_info.phase2_tdma));
+  json.field("start_time", call_info.start_time);
+  json.field("stop_time", call_info.stop_time);
+  json.field("start_time_ms", call_info.start_time_ms);
+  json.field("stop_time_ms", call_info.stop_time_ms);
+  json.field("emergency", int(call_info.emergency));
+  json.field("priority", call_info.priority);
+  json.field("mode", int(call_info.mode));
+  json.field("duplex", int(call_info.duplex));
+  json.field("encrypted", int(call_info.encrypted));
+  json.field("call_length", int(std::round(call_info.length)));
+  json.field("call_length_ms", call_info.call_length_ms);
+  json.field("talkgroup", call_info.talkgroup);
+  json.field("talkgroup_tag", call_info.talkgroup_alpha_tag);
+  json.field("talkgroup_description", call_info.talkgroup_description);
+  json.field("talkgroup_group_tag", call_info.talkgroup_tag);
+  json.field("talkgroup_group", call_info.talkgroup_group);
+  json.field("color_code", call_info.color_code);
+  json.field("audio_type", call_info.audio_type);
+  json.field("short_name", call_info.short_name);
+  if (call_info.source_allocation.candidates > 0) {
+    json.key("source_allocation");
+    json.begin_object();
+    json.field("candidates", call_info.source_allocation.candidates);
+    json.field("free_recorders", call_info.source_allocation.free_recorders);
+    json.field("load", round(call_info.source_allocation.load * 100.0) / 100.0);
+    json.field("edge", round(call_info.source_allocation.edge * 100.0) / 100.0);
+    json.field("score", round(call_info.source_allocation.score * 100.0) / 100.0);
+    json.end_object();
+  }
+  // Multi-Site grants for this call from the other sites
+  if (!call_info.duplicate_grants.empty()) {
+    json.key("duplicate_grants");
+    json.begin_array();
+    for (std::size_t i = 0; i < call_info.duplicate_grants.size(); i++) {
+      const Duplicate_Grant &grant = call_info.duplicate_grants[i];
+      json.begin_object();
+      json.field("short_name", grant.short_name);
+      json.field("sys_num", grant.sys_num);
+      json.field("nac", (long)grant.nac);
+      json.field("rfss_site", (long)grant.rfss_site);
+      json.field("src", grant.source);
+      json.field("time_ms", grant.time_ms);
+      json.field("decode_rate", grant.decode_rate);
+      json.field("superseded", int(grant.superseded));
+      json.end_object();
+    }
+    json.end_array();
+  }
   // Add any patched talkgroups
   if (call_info.patched_talkgroups.size() > 1) {
+    json.key("patched_talkgroups");
+    json.begin_array();
     BOOST_FOREACH (auto &TGID, call_info.patched_talkgroups) {
-      json_data["patched_talkgroups"] += int(TGID);
+      json.value(int(TGID));
     }
+    json.end_array();
   }
   // Add frequencies / IMBE errors
-  for (std::size_t i = 0; i < call_info.transmission_error_list.size(); i++) {
-    json_data["freqList"] += {
-        {"freq", int(call_info.freq)},
-        {"time", call_info.transmission_error_list[i].time},
-        {"pos", round(call_info.transmission_error_list[i].position * 100.0) / 100.0},  // round to 2 decimal places
-        {"len", call_info.transmission_error_list[i].total_len},
-        {"error_count", int(call_info.transmission_error_list[i].error_count)},
-        {"spike_count", int(call_info.transmission_error_list[i].spike_count)}};
+  if (!call_info.transmission_error_list.empty()) {
+    json.key("freqList");
+    json.begin_array();
+    for (std::size_t i = 0; i < call_info.transmission_error_list.size(); i++) {
+      json.begin_object();
+      json.field("freq", int(call_info.freq));
+      json.field("time", call_info.transmission_error_list[i].time);
+      json.field("pos", round(call_info.transmission_error_list[i].position * 100.0) / 100.0); // round to 2 decimal places
+      json.field("len", call_info.transmission_error_list[i].total_len);
+      json.field("error_count", int(call_info.transmission_error_list[i].error_count));
+      json.field("spike_count", int(call_info.transmission_error_list[i].spike_count));
+      json.end_object();
+    }
+    json.end_array();
   }
   // Add sources / tags
-  for (std::size_t i = 0; i < call_info.transmission_source_list.size(); i++) {
-    json_data["srcList"] += {
-        {"src", int(call_info.transmission_source_list[i].source)},
-        {"time", call_info.transmission_source_list[i].time},
-        {"pos", round(call_info.transmission_error_list[i].position * 100.0) / 100.0},  // round to 2 decimal places
-        {"emergency", int(call_info.transmission_source_list[i].emergency)},
-        {"signal_system", call_info.transmission_source_list[i].signal_system},
-        {"tag", call_info.transmission_source_list[i].tag}};
+  if (!call_info.transmission_source_list.empty()) {
+    json.key("srcList");
+    json.begin_array();
+    for (std::size_t i = 0; i < call_info.transmission_source_list.size(); i++) {
+      json.begin_object();
+      json.field("src", int(call_info.transmission_source_list[i].source));
+      json.field("time", call_info.transmission_source_list[i].time);
+      json.field("pos", round(call_info.transmission_error_list[i].position * 100.0) / 100.0); // round to 2 decimal places
+      json.field("emergency", int(call_info.transmission_source_list[i].emergency));
+      json.field("signal_system", call_info.transmission_source_list[i].signal_system);
+      json.field("tag", call_info.transmission_source_list[i].tag);
+      json.end_object();
+    }
+    json.end_array();
   }
+  // Silence cut out of the audio, at where it was in what was kept
+  if (!call_info.silence_list.empty()) {
+    json.key("silenceList");
+    json.begin_array();
+    for (std::size_t i = 0; i < call_info.silence_list.size(); i++) {
+      json.begin_object();
+      json.field("pos", round(call_info.silence_list[i].position * 100.0) / 100.0);
+      json.field("len", round(call_info.silence_list[i].length * 100.0) / 100.0);
+      json.end_object();
+    }
+    json.end_array();
+  }
+  json.end_object();
+
   // Add created JSON to call_info
-  call_info.call_json = json_data;
+  call_info.call_json = text;
 
   // Output the JSON status file
   std::ofstream json_file(call_info.status_filename);
   if (json_file.is_open()) {
-    // Write the JSON to disk, indented 2 spaces per level
-    json_file << json_data.dump(2);
+    json_file.write(text->data(), text->size());
     return 0;
   } else {
     std::string loghdr = log_header( call_info.short_name, call_info.call_num, call_info.talkgroup_display , call_info.freq);
@@ -353,7 +855,42 @@ bool checkIfFile(const std::string &filePath) {
   return false;
 }
 
-void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
+// Renames, or copies when the temp and capture directories are on different filesystems
+bool move_file(const std::string &from, const std::string &to) {
+  std::error_code ec;
+  fs::rename(from, to, ec);
+  if (ec) {
+    ec.clear();
+    fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to move " << from << " to " << to << " : " << ec.message();
+      return false;
+    }
+    fs::remove(from, ec);
+  }
+  return true;
+}
+
+// The encoded audio is read once here, and every uploader sends it from memory
+std::shared_ptr<const std::string> read_upload_audio(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return NULL;
+  }
+  std::streamoff size = file.tellg();
+  if (size <= 0) {
+    return NULL;
+  }
+  std::shared_ptr<std::string> audio = std::make_shared<std::string>(size, '\0');
+  file.seekg(0);
+  if (!file.read(&(*audio)[0], size)) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to read " << filename << " for upload, the uploaders will read the file";
+    return NULL;
+  }
+  return audio;
+}
+
+void remove_call_files(const Call_Data_t &call_info, bool plugin_failure=false) {
 
   if (plugin_failure) {
     std::string loghdr = log_header( call_info.short_name, call_info.call_num, call_info.talkgroup_display , call_info.freq);
@@ -367,8 +904,15 @@ void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
   if (call_info.audio_archive || (plugin_failure && call_info.archive_files_on_failure)) {
     if (call_info.transmission_archive) {
       // if the files are being archived, move them to the capture directory
-      for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
-        Transmission t = *it;
+      for (std::vector<Transmission>::const_iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
+        const Transmission &t = *it;
+
+        // Transmissions kept in memory are written straight to the capture directory
+        if (t.audio && !checkIfFile(t.filename)) {
+          std::vector<Transmission> single(1, t);
+          Wav_Writer::save(single, fs::path(call_info.filename).replace_filename(fs::path(t.filename).filename()).string());
+          continue;
+        }
 
         // Only move transmission wavs if they exist
         if (checkIfFile(t.filename)) {
@@ -391,8 +935,8 @@ void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
     }
 
     // remove the transmission files from the temp directory
-    for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
-      Transmission t = *it;
+    for (std::vector<Transmission>::const_iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
+      const Transmission &t = *it;
       if (checkIfFile(t.filename)) {
         std::remove(t.filename.c_str());
       }
@@ -408,8 +952,8 @@ void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
     if (checkIfFile(call_info.converted)) {
       std::remove(call_info.converted.c_str());
     }
-    for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
-      Transmission t = *it;
+    for (std::vector<Transmission>::const_iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
+      const Transmission &t = *it;
       if (checkIfFile(t.filename)) {
         std::remove(t.filename.c_str());
       }
@@ -417,6 +961,10 @@ void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
 
   }
 
+  if (!call_info.encoded_filename.empty() && checkIfFile(call_info.encoded_filename)) {
+    std::remove(call_info.encoded_filename.c_str());
+  }
+
   if (!call_info.call_log && !(plugin_failure && call_info.archive_files_on_failure)) {
     if (checkIfFile(call_info.status_filename)) {
       std::remove(call_info.status_filename.c_str());
@@ -426,33 +974,62 @@ void remove_call_files(Call_Data_t call_info, bool plugin_failure=false) {
 
 Call_Data_t upload_call_worker(Call_Data_t call_info) {
   int result;
+  std::chrono::steady_clock::time_point stage = std::chrono::steady_clock::now();
 
   if (call_info.status == INITIAL) {
     std::stringstream shell_command;
     std::string shell_command_string;
     std::string files;
+    std::vector<std::string> file_list;
 
-    struct stat statbuf;
-    // loop through the transmission list, pull in things to fill in totals for call_info
-    // Using a for loop with iterator
+    // The loudest sample of the call, if the Wav_Writer found it for every transmission
+    int peak = call_info.transmission_list.empty() ? -1 : 0;
+    for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); (peak >= 0) && (it != call_info.transmission_list.end()); ++it) {
+      peak = (it->peak < 0) ? -1 : std::max(peak, it->peak);
+    }
+
+    // If every transmission was kept in memory, the call file can be written without sox
+    bool in_memory = !call_info.transmission_list.empty();
     for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
-      Transmission t = *it;
+      in_memory = in_memory && it->audio;
+    }
+
+    if (!in_memory || !Wav_Writer::save(call_info.transmission_list, call_info.filename)) {
+      struct stat statbuf;
+      // loop through the transmission list, pull in things to fill in totals for call_info
+      // Using a for loop with iterator
+      for (std::vector<Transmission>::iterator it = call_info.transmission_list.begin(); it != call_info.transmission_list.end(); ++it) {
+        Transmission t = *it;
+
+        // sox needs the transmissions that were kept in memory on disk
+        if (t.audio && (stat(t.filename.c_str(), &statbuf) != 0)) {
+          std::vector<Transmission> single(1, t);
+          Wav_Writer::save(single, t.filename);
+        }
 
-      if (stat(t.filename.c_str(), &statbuf) == 0)
-      {
-          files.append("'");
-          files.append(t.filename);
-          files.append("' ");
+        if (stat(t.filename.c_str(), &statbuf) == 0)
+        {
+            file_list.push_back(t.filename);
+            files.append("'");
+            files.append(t.filename);
+            files.append("' ");
+        }
+        else
+        {
+            BOOST_LOG_TRIVIAL(error) << "Somehow, " << t.filename << " doesn't exist, not attempting to provide it to sox";
+        }
       }
-      else
-      {
-          BOOST_LOG_TRIVIAL(error) << "Somehow, " << t.filename << " doesn't exist, not attempting to provide it to sox";
+
+      // sox is only needed if the transmissions aren't all in the same format
+      if (!concatenate_wav(file_list, call_info.filename)) {
+        combine_wav(files, call_info.filename);
+        peak = -1;
       }
     }
-
-    combine_wav(files, call_info.filename);
+    record_stage(STAGE_JOIN, stage, call_info.call_num);
 
     result = create_call_json(call_info);
+    record_stage(STAGE_JSON, stage, call_info.call_num);
 
     if (result < 0) {
       call_info.status = FAILED;
@@ -467,12 +1044,21 @@ Call_Data_t upload_call_worker(Call_Data_t call_info) {
                                         : std::to_string(call_info.talkgroup);
 
       time_t start_time = static_cast<time_t>(call_info.start_time);
-      result = convert_media(call_info.filename, call_info.converted, std::ctime(&start_time), call_info.short_name, talkgroup_title);
+      if (!call_info.encoded_filename.empty() && checkIfFile(call_info.encoded_filename) && move_file(call_info.encoded_filename, call_info.converted)) {
+        BOOST_LOG_TRIVIAL(trace) << "Using streamed encoding: " << call_info.converted;
+        result = 0;
+      } else if (peak >= 0) {
+        result = encode_media(call_info.filename, call_info.converted, std::ctime(&start_time), call_info.short_name, talkgroup_title, peak);
+      } else {
+        result = convert_media(call_info.filename, call_info.converted, std::ctime(&start_time), call_info.short_name, talkgroup_title);
+      }
+      record_stage(STAGE_ENCODE, stage, call_info.call_num);
 
       if (result < 0) {
         call_info.status = FAILED;
         return call_info;
       }
+      call_info.converted_audio = read_upload_audio(call_info.converted);
     }
 
     // Handle the Upload Script, if set
@@ -483,16 +1069,30 @@ Call_Data_t upload_call_worker(Call_Data_t call_info) {
       BOOST_LOG_TRIVIAL(info) << loghdr << "\033[0m\tRunning upload script: " << shell_command_string;
 
       result = system(shell_command_string.c_str());
+      record_stage(STAGE_UPLOAD_SCRIPT, stage, call_info.call_num);
     }
   }
 
   int error = 0;
 
   error = plugman_call_end(call_info);
+  record_stage(STAGE_PLUGINS, stage, call_info.call_num);
 
   if (!error) {
+    // Once the call is in the segment files its own files aren't kept
+    Segment_Location location;
+    bool archived = false;
+    if (call_info.audio_archive && Archive_Segments::enabled() && Archive_Segments::append(call_info, &location)) {
+      call_info.audio_archive = false;
+      call_info.call_log = false;
+      archived = true;
+    }
     remove_call_files(call_info);
+    record_stage(STAGE_CLEANUP, stage, call_info.call_num);
     call_info.status = SUCCESS;
+    if (Recent_Calls::enabled()) {
+      Recent_Calls::add(call_info, archived ? &location : NULL);
+    }
   } else {
     call_info.status = RETRY;
   }
@@ -502,7 +1102,7 @@ Call_Data_t upload_call_worker(Call_Data_t call_info) {
 
 
 // static int rec_counter=0;
-Call_Data_t Call_Concluder::create_base_filename(Call *call, Call_Data_t call_info, System *sys, Config config) {
+void Call_Concluder::create_base_filename(Call *call, Call_Data_t &call_info, System *sys, const Config &config) {
   const std::int64_t start_ms = call->get_start_time_ms();
   time_t work_start_time = static_cast<time_t>(start_ms / 1000);
   std::string capture_dir = call->get_capture_dir();
@@ -560,12 +1160,10 @@ Call_Data_t Call_Concluder::create_base_filename(Call *call, Call_Data_t call_in
   call_info.filename = base_filename + "-call_" + std::to_string(call->get_call_num()) + ".wav";
   call_info.status_filename = base_filename + "-call_" + std::to_string(call->get_call_num()) + ".json";
   call_info.converted = base_filename + "-call_" + std::to_string(call->get_call_num()) + ".m4a";
-
-  return call_info;
 }
 
 
-Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config config) {
+Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, const Config &config) {
   Call_Data_t call_info;
 
   // ---------- Static metadata ----------
@@ -581,6 +1179,8 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
   call_info.noise               = call->get_noise();
   call_info.recorder_num        = call->get_recorder()->get_num();
   call_info.source_num          = call->get_recorder()->get_source()->get_num();
+  call_info.source_allocation   = call->get_source_allocation();
+  call_info.duplicate_grants    = call->get_duplicate_grants();
   call_info.encrypted           = call->get_encrypted();
   call_info.emergency           = call->get_emergency();
   call_info.priority            = call->get_priority();
@@ -597,6 +1197,7 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
   call_info.call_log            = sys->get_call_log();
   call_info.call_num            = call->get_call_num();
   call_info.compress_wav        = sys->get_compress_wav();
+  call_info.encoded_filename    = call->get_encoded_filename();
   call_info.talkgroup           = call->get_talkgroup();
   call_info.talkgroup_display   = call->get_talkgroup_display();
   call_info.patched_talkgroups  = sys->get_talkgroup_patch(call_info.talkgroup);
@@ -611,11 +1212,13 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
     call_info.talkgroup_alpha_tag    = tg->alpha_tag;
     call_info.talkgroup_description  = tg->description;
     call_info.talkgroup_group        = tg->group;
+    call_info.talkgroup_priority     = tg->priority;
   } else {
     call_info.talkgroup_tag.clear();
     call_info.talkgroup_alpha_tag.clear();
     call_info.talkgroup_description.clear();
     call_info.talkgroup_group.clear();
+    call_info.talkgroup_priority = 1; // what the talkgroups file assumes
   }
 
   if (call->get_is_analog()) {
@@ -644,22 +1247,29 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
 
     const Transmission &t = *it;
 
-    // Canonical length from millisecond stamps
-    const std::int64_t seg_ms   = std::max<std::int64_t>(0, t.stop_time_ms - t.start_time_ms);
+    // Canonical length from millisecond stamps, less any silence that was
+    // cut out of the audio
+    const std::int64_t air_ms   = std::max<std::int64_t>(0, t.stop_time_ms - t.start_time_ms);
+    const std::int64_t seg_ms   = std::max<std::int64_t>(0, air_ms - (std::int64_t)std::llround(t.silence_removed * 1000.0));
     const double       seg_len_s = seg_ms / 1000.0;
 
-    // Filter short segments using canonical length
-    if (seg_len_s < min_tx_s) {
+    // Filter short segments using how long they were on the air
+    if (air_ms / 1000.0 < min_tx_s) {
       if (!call_info.transmission_archive) {
 
         BOOST_LOG_TRIVIAL(info) << loghdr << "Removing transmission less than "
                                 << min_tx_s
-                                << " seconds. Actual length: " << seg_len_s << ".";
+                                << " seconds. Actual length: " << air_ms / 1000.0 << ".";
         call_info.min_transmissions_removed++;
         if (checkIfFile(t.filename)) {
           std::remove(t.filename.c_str());
         }
       }
+      // the streaming encoder was fed this transmission too, so convert the call as usual
+      if (!call_info.encoded_filename.empty() && checkIfFile(call_info.encoded_filename)) {
+        std::remove(call_info.encoded_filename.c_str());
+      }
+      call_info.encoded_filename.clear();
       it = call_info.transmission_list.erase(it);
       continue;
     }
@@ -712,6 +1322,10 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
                                 t.error_count, t.spike_count };
     call_info.transmission_source_list.push_back(call_source);
     call_info.transmission_error_list.push_back(call_error);
+    for (std::vector<Silence_Span>::const_iterator span = t.silence_list.begin(); span != t.silence_list.end(); ++span) {
+      Silence_Span call_span = {playable_pos_s + span->position, span->length};
+      call_info.silence_list.push_back(call_span);
+    }
 
     call_info.error_count += t.error_count;
     call_info.spike_count += t.spike_count;
@@ -742,14 +1356,25 @@ Call_Data_t Call_Concluder::create_call_data(Call *call, System *sys, Config con
 
   // Generate filenames after all call_info fields (including talkgroup tags)
   // are populated, so that custom format strings can reference any field.
-  call_info = create_base_filename(call, call_info, sys, config);
+  create_base_filename(call, call_info, sys, config);
 
   call_info.archive_files_on_failure = config.archive_files_on_failure;
   return call_info;
 }
 
 
-void Call_Concluder::conclude_call(Call *call, System *sys, Config config) {
+void Call_Concluder::conclude_call(Call *call, System *sys, const Config &config) {
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  dispatch_call(call, sys, config);
+  std::int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  Concluder_Pool &pool = concluder_pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  pool.conclude_time.record(us);
+}
+
+// Sorts out what to do with a call, on the main thread
+void Call_Concluder::dispatch_call(Call *call, System *sys, const Config &config) {
   Call_Data_t call_info = create_call_data(call, sys, config);
 
   std::string loghdr = log_header( call_info.short_name, call_info.call_num, call_info.talkgroup_display , call_info.freq);
@@ -788,7 +1413,32 @@ void Call_Concluder::conclude_call(Call *call, System *sys, Config config) {
   }
 
 
-  call_data_workers.push_back(std::async(std::launch::async, upload_call_worker, call_info));
+  queue_call_data(std::move(call_info));
+}
+
+// Hands a call that is ready to be concluded to the workers
+void Call_Concluder::queue_call_data(Call_Data_t call_info) {
+  call_data_workers.push_back(queue_call(std::move(call_info)));
+}
+
+void Call_Concluder::set_retry_journal(const std::string &filename) {
+  std::vector<Call_Data_t> calls = Retry_Journal::open(filename);
+  for (std::vector<Call_Data_t>::iterator it = calls.begin(); it != calls.end(); ++it) {
+    retry_calls.push_back(std::move(*it));
+    std::push_heap(retry_calls.begin(), retry_calls.end(), retry_later);
+  }
+}
+
+// 0 starts every retry as soon as it is due
+void Call_Concluder::set_retry_rate(double calls_per_second) {
+  retry_rate = calls_per_second;
+  retry_tokens = std::max(1.0, calls_per_second);
+}
+
+void Call_Concluder::schedule_retry(Call_Data_t call_info) {
+  Retry_Journal::add(call_info);
+  retry_calls.push_back(std::move(call_info));
+  std::push_heap(retry_calls.begin(), retry_calls.end(), retry_later);
 }
 
 void Call_Concluder::manage_call_data_workers() {
@@ -803,35 +1453,46 @@ void Call_Concluder::manage_call_data_workers() {
         std::string loghdr = log_header( call_info.short_name, call_info.call_num, call_info.talkgroup_display , call_info.freq);
 
         if (call_info.retry_attempt > Call_Concluder::MAX_RETRY) {
+          Retry_Journal::remove(call_info);
           remove_call_files(call_info, true);
           BOOST_LOG_TRIVIAL(error) << loghdr << "Failed to conclude call - " << std::put_time(std::localtime(&start_time), "%c %Z");
         } else {
           long jitter = rand() % 10;
           long backoff = ((1 << call_info.retry_attempt) * 60) + jitter;
           call_info.process_call_time = time(0) + backoff;
-          retry_call_list.push_back(call_info);
-          BOOST_LOG_TRIVIAL(error) << loghdr << std::put_time(std::localtime(&start_time), "%c %Z") << " retry attempt " << call_info.retry_attempt << " in " << backoff << "s\t retry queue: " << retry_call_list.size() << " calls";
+          int retry_attempt = call_info.retry_attempt;
+          schedule_retry(std::move(call_info));
+          BOOST_LOG_TRIVIAL(error) << loghdr << std::put_time(std::localtime(&start_time), "%c %Z") << " retry attempt " << retry_attempt << " in " << backoff << "s\t retry queue: " << retry_calls.size() << " calls";
         }
+      } else {
+        Retry_Journal::remove(call_info);
       }
       it = call_data_workers.erase(it);
     } else {
       it++;
     }
   }
-  for (std::list<Call_Data_t>::iterator it = retry_call_list.begin(); it != retry_call_list.end();) {
-    Call_Data_t call_info = *it;
 
-    if (call_info.process_call_time <= time(0)) {
-      call_data_workers.push_back(std::async(std::launch::async, upload_call_worker, call_info));
-      it = retry_call_list.erase(it);
-    } else {
-      it++;
-    }
+  // Due retries are started at no more than retry_rate a second, so a
+  // backlog doesn't all go at once when uploads start working again
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  retry_tokens = std::min(std::max(1.0, retry_rate), retry_tokens + retry_rate * std::chrono::duration<double>(now - retry_refill).count());
+  retry_refill = now;
+
+  time_t current_time = time(0);
+  while (!retry_calls.empty() && (retry_calls.front().process_call_time <= current_time) && ((retry_rate <= 0) || (retry_tokens >= 1))) {
+    std::pop_heap(retry_calls.begin(), retry_calls.end(), retry_later);
+    call_data_workers.push_back(queue_call(std::move(retry_calls.back())));
+    retry_calls.pop_back();
+    retry_tokens -= 1;
   }
 }
 
+// With the retry journal, calls still waiting for a retry are left in it
+// for the next run instead of being tried again right away
 bool Call_Concluder::shutdown_call_data_workers(std::chrono::seconds timeout) {
   const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const bool keep_retries = Retry_Journal::is_open();
 
   while (std::chrono::steady_clock::now() < deadline) {
     for (std::list<std::future<Call_Data_t>>::iterator it = call_data_workers.begin(); it != call_data_workers.end();) {
@@ -846,22 +1507,33 @@ bool Call_Concluder::shutdown_call_data_workers(std::chrono::seconds timeout) {
       if (call_info.status == RETRY) {
         call_info.retry_attempt++;
         if (call_info.retry_attempt > Call_Concluder::MAX_RETRY) {
+          Retry_Journal::remove(call_info);
           remove_call_files(call_info, true);
+        } else if (keep_retries) {
+          call_info.process_call_time = time(0);
+          schedule_retry(std::move(call_info));
         } else {
           // During shutdown, retry immediately instead of waiting for backoff.
-          call_data_workers.push_back(std::async(std::launch::async, upload_call_worker, call_info));
+          call_data_workers.push_back(queue_call(std::move(call_info)));
         }
+      } else {
+        Retry_Journal::remove(call_info);
       }
     }
 
     // Run any queued retries immediately while draining for shutdown.
-    for (std::list<Call_Data_t>::iterator it = retry_call_list.begin(); it != retry_call_list.end();) {
-      Call_Data_t call_info = *it;
-      call_data_workers.push_back(std::async(std::launch::async, upload_call_worker, call_info));
-      it = retry_call_list.erase(it);
+    if (!keep_retries) {
+      for (std::vector<Call_Data_t>::iterator it = retry_calls.begin(); it != retry_calls.end(); ++it) {
+        call_data_workers.push_back(queue_call(std::move(*it)));
+      }
+      retry_calls.clear();
     }
 
-    if (call_data_workers.empty() && retry_call_list.empty()) {
+    if (call_data_workers.empty() && (keep_retries || retry_calls.empty())) {
+      if (keep_retries && !retry_calls.empty()) {
+        BOOST_LOG_TRIVIAL(info) << "Leaving " << retry_calls.size() << " calls in the retry journal for next time";
+      }
+      Archive_Segments::close_all();
       return true;
     }
 
@@ -869,10 +1541,12 @@ bool Call_Concluder::shutdown_call_data_workers(std::chrono::seconds timeout) {
   }
 
   // Timeout hit: clean pending retries and force shutdown path to continue.
-  for (std::list<Call_Data_t>::iterator it = retry_call_list.begin(); it != retry_call_list.end(); ++it) {
-    remove_call_files(*it, true);
+  if (!keep_retries) {
+    for (std::vector<Call_Data_t>::iterator it = retry_calls.begin(); it != retry_calls.end(); ++it) {
+      remove_call_files(*it, true);
+    }
   }
-  retry_call_list.clear();
+  retry_calls.clear();
 
   if (!call_data_workers.empty()) {
     BOOST_LOG_TRIVIAL(error) << "Call concluder shutdown timed out after "
@@ -885,5 +1559,6 @@ bool Call_Concluder::shutdown_call_data_workers(std::chrono::seconds timeout) {
     abandoned_workers->splice(abandoned_workers->end(), call_data_workers);
   }
 
+  Archive_Segments::close_all();
   return false;
 }
@@ -2,6 +2,7 @@
 #define CALL_CONCLUDER_H
 #include <boost/regex.hpp>
 #include <sys/stat.h>
+#include <chrono>
 #include <ctime>
 #include <future>
 #include <list>
@@ -17,20 +18,71 @@
 
 Call_Data_t upload_call_worker(Call_Data_t call_info);
 
+/*
+ * Call_Concluder
+ *   Turns a finished Call into its files and hands them to the upload
+ *   script and plugins.
+ *
+ * upload_call_worker() runs sox, fdkaac and the uploads for a call, which
+ * can take seconds, so it is done by a fixed number of worker threads
+ * rather than a thread per call. When a lot of calls end at once they wait
+ * in a queue: emergency calls first, then by talkgroup priority, then in
+ * the order they ended. Each queued call has a future that
+ * manage_call_data_workers() checks, as before.
+ *
+ * A call's Call_Data_t is moved, not copied, from the main thread to its
+ * worker and back through the future and the retry list. How long the main
+ * thread spends in conclude_call() is shown with the status.
+ *
+ * Calls waiting for a retry are kept in a heap by when they are due, and
+ * in the Retry_Journal if there is one, so they are picked up again after a
+ * restart. Due retries are started at retry_rate a second at most.
+ *
+ * get_load() tells the recorder allocator how far behind the workers are:
+ * the calls queued or being concluded, how much audio they hold in the
+ * temp dir or memory and how long the oldest has been waiting. Against the
+ * backlog limits, shed_call() says if a new call of a talkgroup priority
+ * should go unrecorded so the backlog doesn't put higher priority audio at
+ * risk.
+ *
+ * Each worker times the steps of a call, from waiting in the queue through
+ * joining the transmissions, the JSON, encoding, the upload script, the
+ * plugins and removing the files, for get_stage_stats() and
+ * utils/concluder-bench.
+ */
 class Call_Concluder {
 
 public:
   static const int MAX_RETRY;
-  static std::list<Call_Data_t> retry_call_list;
+  static std::vector<Call_Data_t> retry_calls; // a heap, next retry first
   static std::list<std::future<Call_Data_t>> call_data_workers;
   
-  static Call_Data_t create_call_data(Call *call, System *sys, Config config);
-  static void conclude_call(Call *call, System *sys, Config config);
+  static void set_worker_count(int count);
+  static void set_retry_journal(const std::string &filename);
+  static void set_retry_rate(double calls_per_second);
+  static void set_backlog_limits(double max_seconds, double max_mb);
+  static Concluder_Load get_load();
+  static bool shed_call(int priority);
+  static std::vector<Concluder_Stage_Stats> get_stage_stats();
+  static Call_Data_t create_call_data(Call *call, System *sys, const Config &config);
+  static void conclude_call(Call *call, System *sys, const Config &config);
+  static void queue_call_data(Call_Data_t call_info);
   static void manage_call_data_workers();
   static bool shutdown_call_data_workers(std::chrono::seconds timeout);
+  static void print_stats();
 
 private:
-  static Call_Data_t create_base_filename(Call *call, Call_Data_t call_info, System *sys, Config config);
+  static void create_base_filename(Call *call, Call_Data_t &call_info, System *sys, const Config &config);
+  static void dispatch_call(Call *call, System *sys, const Config &config);
+  static std::future<Call_Data_t> queue_call(Call_Data_t call_info);
+  static void run_worker();
+  static void schedule_retry(Call_Data_t call_info);
+
+  static double retry_rate;
+  static double retry_tokens;
+  static std::chrono::steady_clock::time_point retry_refill;
+  static double backlog_max_seconds;
+  static double backlog_max_bytes;
 };
 
 #endif
@@ -0,0 +1,275 @@
+#include "recent_calls.h"
+#include "../replay_clock.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <json.hpp>
+#include <limits>
+#include <set>
+
+// How far past the window the oldest calls get before they are cut
+static const std::int64_t EXPIRE_SLACK_MS = 60 * 1000;
+static const size_t DEFAULT_LIMIT = 100;
+static const size_t MAX_LIMIT = 1000;
+
+std::mutex Recent_Calls::mutex;
+std::int64_t Recent_Calls::keep_ms = 0;
+std::vector<Recent_Calls::Entry> Recent_Calls::by_time;
+std::unordered_map<std::string, std::vector<Recent_Calls::Entry>> Recent_Calls::by_system;
+std::unordered_map<Recent_Calls::Key, std::vector<Recent_Calls::Entry>, Recent_Calls::Key_Hash> Recent_Calls::by_talkgroup;
+std::unordered_map<Recent_Calls::Key, std::vector<Recent_Calls::Entry>, Recent_Calls::Key_Hash> Recent_Calls::by_unit;
+
+static bool started_before(const Recent_Calls::Entry &entry, std::int64_t ms) {
+  return entry->start_time_ms < ms;
+}
+
+static bool started_after(std::int64_t ms, const Recent_Calls::Entry &entry) {
+  return ms < entry->start_time_ms;
+}
+
+void Recent_Calls::set_hours(double hours) {
+  std::lock_guard<std::mutex> lock(mutex);
+  keep_ms = (hours > 0) ? (std::int64_t)(hours * 3600 * 1000) : 0;
+}
+
+bool Recent_Calls::enabled() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return keep_ms > 0;
+}
+
+// After the last call that started at the same time or before it
+void Recent_Calls::insert(std::vector<Entry> &calls, const Entry &entry) {
+  if (calls.empty() || (calls.back()->start_time_ms <= entry->start_time_ms)) {
+    calls.push_back(entry);
+    return;
+  }
+  calls.insert(std::upper_bound(calls.begin(), calls.end(), entry->start_time_ms, started_after), entry);
+}
+
+void Recent_Calls::cut(std::vector<Entry> &calls, std::int64_t cutoff_ms) {
+  calls.erase(calls.begin(), std::lower_bound(calls.begin(), calls.end(), cutoff_ms, started_before));
+}
+
+void Recent_Calls::expire(std::int64_t now_ms) {
+  std::int64_t cutoff_ms = now_ms - keep_ms;
+  if (by_time.empty() || (by_time.front()->start_time_ms >= cutoff_ms - EXPIRE_SLACK_MS)) {
+    return;
+  }
+
+  // Only the vectors the dropped calls are in have anything to cut
+  std::set<std::string> systems;
+  std::set<Key> talkgroups;
+  std::set<Key> units;
+  std::vector<Entry>::iterator end = std::lower_bound(by_time.begin(), by_time.end(), cutoff_ms, started_before);
+  for (std::vector<Entry>::iterator it = by_time.begin(); it != end; ++it) {
+    const Recent_Call &call = **it;
+    systems.insert(call.short_name);
+    talkgroups.insert(Key(call.short_name, call.talkgroup));
+    for (std::vector<long>::const_iterator unit = call.units.begin(); unit != call.units.end(); ++unit) {
+      units.insert(Key(call.short_name, *unit));
+    }
+  }
+  by_time.erase(by_time.begin(), end);
+
+  for (std::set<std::string>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    std::vector<Entry> &calls = by_system[*it];
+    cut(calls, cutoff_ms);
+    if (calls.empty()) {
+      by_system.erase(*it);
+    }
+  }
+  for (std::set<Key>::iterator it = talkgroups.begin(); it != talkgroups.end(); ++it) {
+    std::vector<Entry> &calls = by_talkgroup[*it];
+    cut(calls, cutoff_ms);
+    if (calls.empty()) {
+      by_talkgroup.erase(*it);
+    }
+  }
+  for (std::set<Key>::iterator it = units.begin(); it != units.end(); ++it) {
+    std::vector<Entry> &calls = by_unit[*it];
+    cut(calls, cutoff_ms);
+    if (calls.empty()) {
+      by_unit.erase(*it);
+    }
+  }
+}
+
+void Recent_Calls::add(const Call_Data_t &call_info, const Segment_Location *location) {
+  std::shared_ptr<Recent_Call> call = std::make_shared<Recent_Call>();
+  call->call_num = call_info.call_num;
+  call->short_name = call_info.short_name;
+  call->talkgroup = call_info.talkgroup;
+  call->talkgroup_alpha_tag = call_info.talkgroup_alpha_tag;
+  call->start_time_ms = call_info.start_time_ms;
+  call->stop_time_ms = call_info.stop_time_ms;
+  call->length = call_info.length;
+  call->freq = call_info.freq;
+  call->emergency = call_info.emergency;
+  call->encrypted = call_info.encrypted;
+  for (std::vector<Call_Source>::const_iterator it = call_info.transmission_source_list.begin(); it != call_info.transmission_source_list.end(); ++it) {
+    if ((it->source > 0) && (std::find(call->units.begin(), call->units.end(), it->source) == call->units.end())) {
+      call->units.push_back(it->source);
+    }
+  }
+  if (call_info.audio_archive) {
+    call->audio = call_info.filename;
+    if (call_info.compress_wav) {
+      call->converted = call_info.converted;
+    }
+  }
+  if (call_info.call_log) {
+    call->json = call_info.status_filename;
+  }
+  call->archived = (location != NULL);
+  if (location) {
+    call->location = *location;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (keep_ms <= 0) {
+    return;
+  }
+  Entry entry = call;
+  insert(by_time, entry);
+  insert(by_system[call->short_name], entry);
+  insert(by_talkgroup[Key(call->short_name, call->talkgroup)], entry);
+  for (std::vector<long>::const_iterator unit = call->units.begin(); unit != call->units.end(); ++unit) {
+    insert(by_unit[Key(call->short_name, *unit)], entry);
+  }
+  expire(Replay_Clock::now_ms());
+}
+
+std::vector<Recent_Calls::Entry> Recent_Calls::find(const Query &query, bool &more) {
+  std::vector<Entry> found;
+  more = false;
+  std::lock_guard<std::mutex> lock(mutex);
+
+  const std::vector<Entry> *calls = &by_time;
+  if (!query.short_name.empty()) {
+    const std::vector<Entry> *narrowest = NULL;
+    if (query.unit >= 0) {
+      std::unordered_map<Key, std::vector<Entry>, Key_Hash>::const_iterator it = by_unit.find(Key(query.short_name, query.unit));
+      narrowest = (it != by_unit.end()) ? &it->second : NULL;
+    } else if (query.talkgroup >= 0) {
+      std::unordered_map<Key, std::vector<Entry>, Key_Hash>::const_iterator it = by_talkgroup.find(Key(query.short_name, query.talkgroup));
+      narrowest = (it != by_talkgroup.end()) ? &it->second : NULL;
+    } else {
+      std::unordered_map<std::string, std::vector<Entry>>::const_iterator it = by_system.find(query.short_name);
+      narrowest = (it != by_system.end()) ? &it->second : NULL;
+    }
+    if (!narrowest) {
+      return found;
+    }
+    calls = narrowest;
+  }
+
+  std::vector<Entry>::const_iterator first = std::lower_bound(calls->begin(), calls->end(), query.after_ms, started_before);
+  std::vector<Entry>::const_iterator it = std::lower_bound(first, calls->end(), query.before_ms, started_before);
+  while (it != first) {
+    --it;
+    const Recent_Call &call = **it;
+    if ((query.talkgroup >= 0) && (call.talkgroup != query.talkgroup)) {
+      continue;
+    }
+    if ((query.unit >= 0) && (std::find(call.units.begin(), call.units.end(), query.unit) == call.units.end())) {
+      continue;
+    }
+    if (!query.short_name.empty() && (call.short_name != query.short_name)) {
+      continue;
+    }
+    if (found.size() == query.limit) {
+      more = true;
+      break;
+    }
+    found.push_back(*it);
+  }
+  return found;
+}
+
+// GET /calls?system=<shortName>&talkgroup=<n>&unit=<n>&start=<time>&end=<time>&limit=<n>
+Control_Api::Response Recent_Calls::handle_request(const Control_Api::Request &request) {
+  Control_Api::Response response;
+  if (request.method != "GET") {
+    response.status = 405;
+    response.body = nlohmann::json{{"error", "GET the calls"}}.dump();
+    return response;
+  }
+
+  Query query;
+  std::map<std::string, std::string>::const_iterator system = request.query.find("system");
+  query.short_name = (system != request.query.end()) ? system->second : "";
+  query.talkgroup = -1;
+  query.unit = -1;
+  query.after_ms = std::numeric_limits<std::int64_t>::min();
+  query.before_ms = std::numeric_limits<std::int64_t>::max();
+  query.limit = DEFAULT_LIMIT;
+
+  double value;
+  bool bad = false;
+  if (request.number("talkgroup", value, bad)) {
+    query.talkgroup = (long)value;
+  }
+  if (request.number("unit", value, bad)) {
+    query.unit = (long)value;
+  }
+  if (request.number("start", value, bad)) {
+    query.after_ms = (std::int64_t)(value * 1000);
+  }
+  if (request.number("end", value, bad)) {
+    query.before_ms = (std::int64_t)(value * 1000);
+  }
+  if (request.number("limit", value, bad) && (value >= 1)) {
+    query.limit = std::min((size_t)value, MAX_LIMIT);
+  }
+  if (bad) {
+    response.status = 400;
+    response.body = nlohmann::json{{"error", "talkgroup, unit, start, end and limit are numbers"}}.dump();
+    return response;
+  }
+  if (((query.talkgroup >= 0) || (query.unit >= 0)) && query.short_name.empty()) {
+    response.status = 400;
+    response.body = nlohmann::json{{"error", "a talkgroup or unit needs a system"}}.dump();
+    return response;
+  }
+
+  bool more;
+  std::vector<Entry> found = find(query, more);
+  nlohmann::json calls = nlohmann::json::array();
+  for (std::vector<Entry>::const_iterator it = found.begin(); it != found.end(); ++it) {
+    const Recent_Call &call = **it;
+    nlohmann::json entry = {{"callNum", call.call_num},
+                            {"shortName", call.short_name},
+                            {"talkgroup", call.talkgroup},
+                            {"talkgroupTag", call.talkgroup_alpha_tag},
+                            {"startTime", call.start_time_ms / 1000},
+                            {"stopTime", call.stop_time_ms / 1000},
+                            {"startTimeMs", call.start_time_ms},
+                            {"stopTimeMs", call.stop_time_ms},
+                            {"length", call.length},
+                            {"freq", call.freq},
+                            {"emergency", call.emergency},
+                            {"encrypted", call.encrypted},
+                            {"units", call.units}};
+    if (!call.audio.empty()) {
+      entry["audio"] = call.audio;
+    }
+    if (!call.converted.empty()) {
+      entry["converted"] = call.converted;
+    }
+    if (!call.json.empty()) {
+      entry["json"] = call.json;
+    }
+    if (call.archived) {
+      entry["segment"] = {{"file", call.location.segment},
+                          {"audioOffset", call.location.audio_offset},
+                          {"audioLength", call.location.audio_length},
+                          {"audioFormat", call.location.audio_format},
+                          {"jsonOffset", call.location.json_offset},
+                          {"jsonLength", call.location.json_length}};
+    }
+    calls.push_back(entry);
+  }
+  response.status = 200;
+  response.body = nlohmann::json{{"calls", calls}, {"more", more}}.dump();
+  return response;
+}
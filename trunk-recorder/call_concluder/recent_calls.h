@@ -0,0 +1,101 @@
+#ifndef RECENT_CALLS_H
+#define RECENT_CALLS_H
+
+#include "../control_api.h"
+#include "../global_structs.h"
+#include "archive_segments.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A concluded call and where its files were left
+struct Recent_Call {
+  long call_num;
+  std::string short_name;
+  long talkgroup;
+  std::string talkgroup_alpha_tag;
+  std::int64_t start_time_ms;
+  std::int64_t stop_time_ms;
+  double length;
+  double freq;
+  bool emergency;
+  bool encrypted;
+  std::vector<long> units; // each once, in the order they first spoke
+  std::string audio;       // the files that were kept, "" for one that wasn't
+  std::string converted;
+  std::string json;
+  bool archived;           // into the Archive_Segments, at location
+  Segment_Location location;
+};
+
+/*
+ * Recent_Calls
+ *   The calls concluded over the last recentCallsHours, kept in memory and
+ *   served by the Control API at GET /calls, so a playback front end can
+ *   find them without listing the capture directory.
+ *
+ * A call is added when the Call_Concluder has finished with it, with the
+ * files it left behind: the wav and m4a when the audio is archived, the
+ * JSON when there is a call log and the segment and offsets when it went
+ * into the Archive_Segments instead. Calls it gave up on aren't added.
+ *
+ * The calls are kept in a vector sorted by start time, and again in one
+ * for each System, each talkgroup and each unit of a System, found in
+ * hash maps. Calls mostly arrive in the order they started, so they are
+ * added at or near the end. The oldest are dropped once they are more
+ * than a minute past recentCallsHours, so the vectors are only cut every
+ * minute or so.
+ *
+ * A query is answered from the narrowest of the vectors that fits it,
+ * newest first, on the Control API's thread. The calls are shared, so it
+ * only holds the lock while it picks them. Nothing here touches the disk.
+ */
+class Recent_Calls {
+public:
+  typedef std::shared_ptr<const Recent_Call> Entry;
+
+  struct Query {
+    std::string short_name; // "" for every System
+    long talkgroup;         // -1 for any, only with a short_name
+    long unit;              // -1 for any, only with a short_name
+    std::int64_t after_ms;  // started at or after
+    std::int64_t before_ms; // started before
+    size_t limit;
+  };
+
+  static void set_hours(double hours);
+  static bool enabled();
+  static void add(const Call_Data_t &call_info, const Segment_Location *location);
+  // Newest first, more is set if there were more than limit
+  static std::vector<Entry> find(const Query &query, bool &more);
+  static Control_Api::Response handle_request(const Control_Api::Request &request);
+
+private:
+  typedef std::pair<std::string, long> Key; // System and talkgroup or unit
+  struct Key_Hash {
+    size_t operator()(const Key &k) const {
+      size_t h = std::hash<long>()(k.second);
+      h ^= std::hash<std::string>()(k.first) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  static void insert(std::vector<Entry> &calls, const Entry &entry);
+  static void cut(std::vector<Entry> &calls, std::int64_t cutoff_ms);
+  static void expire(std::int64_t now_ms);
+
+  static std::mutex mutex;
+  static std::int64_t keep_ms;
+  static std::vector<Entry> by_time;
+  static std::unordered_map<std::string, std::vector<Entry>> by_system;
+  static std::unordered_map<Key, std::vector<Entry>, Key_Hash> by_talkgroup;
+  static std::unordered_map<Key, std::vector<Entry>, Key_Hash> by_unit;
+};
+
+#endif // RECENT_CALLS_H
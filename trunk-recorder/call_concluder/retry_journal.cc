@@ -0,0 +1,229 @@
+#include "retry_journal.h"
+#include "../plugin_manager/plugin_manager.h"
+
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <json.hpp>
+#include <unistd.h>
+
+std::string Retry_Journal::path;
+FILE *Retry_Journal::fp = NULL;
+std::map<std::string, std::string> Retry_Journal::live;
+size_t Retry_Journal::dead_records = 0;
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Source_Allocation, candidates, free_recorders, load, edge, score)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Duplicate_Grant, short_name, sys_num, nac, rfss_site, source, time_ms, decode_rate, superseded)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Call_Source, source, time, position, emergency, signal_system, tag)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Call_Error, time, position, total_len, error_count, spike_count)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Silence_Span, position, length)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(Transmission, source, talkgroup, slot, color_code, dcs_code, ctcss_tone, start_time, stop_time, start_time_ms, stop_time_ms, sample_count, spike_count, error_count, peak, freq, length, silence_removed, silence_list, filename)
+
+// Everything in a Call_Data_t but the plugins to retry and the call JSON
+#define RETRY_JOURNAL_FIELDS(FIELD)                                                                                         \
+  FIELD(talkgroup)                                                                                                          \
+  FIELD(color_code)                                                                                                         \
+  FIELD(patched_talkgroups)                                                                                                 \
+  FIELD(talkgroup_tag)                                                                                                      \
+  FIELD(talkgroup_alpha_tag)                                                                                                \
+  FIELD(talkgroup_description)                                                                                              \
+  FIELD(talkgroup_display)                                                                                                  \
+  FIELD(talkgroup_group)                                                                                                    \
+  FIELD(talkgroup_priority)                                                                                                 \
+  FIELD(call_num)                                                                                                           \
+  FIELD(freq)                                                                                                               \
+  FIELD(freq_error)                                                                                                         \
+  FIELD(source_num)                                                                                                         \
+  FIELD(recorder_num)                                                                                                       \
+  FIELD(source_allocation)                                                                                                  \
+  FIELD(duplicate_grants)                                                                                                   \
+  FIELD(signal)                                                                                                             \
+  FIELD(noise)                                                                                                              \
+  FIELD(start_time)                                                                                                         \
+  FIELD(stop_time)                                                                                                          \
+  FIELD(start_time_ms)                                                                                                      \
+  FIELD(stop_time_ms)                                                                                                       \
+  FIELD(error_count)                                                                                                        \
+  FIELD(spike_count)                                                                                                        \
+  FIELD(encrypted)                                                                                                          \
+  FIELD(emergency)                                                                                                          \
+  FIELD(priority)                                                                                                           \
+  FIELD(mode)                                                                                                               \
+  FIELD(duplex)                                                                                                             \
+  FIELD(audio_archive)                                                                                                      \
+  FIELD(transmission_archive)                                                                                               \
+  FIELD(archive_files_on_failure)                                                                                           \
+  FIELD(call_log)                                                                                                           \
+  FIELD(compress_wav)                                                                                                       \
+  FIELD(filename)                                                                                                           \
+  FIELD(status_filename)                                                                                                    \
+  FIELD(converted)                                                                                                          \
+  FIELD(encoded_filename)                                                                                                   \
+  FIELD(min_transmissions_removed)                                                                                          \
+  FIELD(sys_num)                                                                                                            \
+  FIELD(short_name)                                                                                                         \
+  FIELD(upload_script)                                                                                                      \
+  FIELD(audio_type)                                                                                                         \
+  FIELD(tdma_slot)                                                                                                          \
+  FIELD(length)                                                                                                             \
+  FIELD(call_length_ms)                                                                                                     \
+  FIELD(phase2_tdma)                                                                                                        \
+  FIELD(transmission_source_list)                                                                                           \
+  FIELD(transmission_error_list)                                                                                            \
+  FIELD(silence_list)                                                                                                       \
+  FIELD(transmission_list)                                                                                                  \
+  FIELD(status)                                                                                                             \
+  FIELD(process_call_time)                                                                                                  \
+  FIELD(retry_attempt)
+
+static std::string to_line(const Call_Data_t &call_info) {
+  nlohmann::json call;
+#define WRITE_FIELD(name) call[#name] = call_info.name;
+  RETRY_JOURNAL_FIELDS(WRITE_FIELD)
+#undef WRITE_FIELD
+
+  nlohmann::json plugins = nlohmann::json::array();
+  for (std::vector<int>::const_iterator it = call_info.plugin_retry_list.begin(); it != call_info.plugin_retry_list.end(); ++it) {
+    plugins.push_back(plugman_plugin_name(*it));
+  }
+  call["plugin_retry_list"] = plugins;
+  if (call_info.call_json) {
+    call["call_json"] = *call_info.call_json;
+  }
+
+  nlohmann::json record = {{"add", call}};
+  return record.dump() + "\n";
+}
+
+static Call_Data_t from_json(const nlohmann::json &call) {
+  Call_Data_t call_info = Call_Data_t();
+#define READ_FIELD(name) call_info.name = call.value(#name, call_info.name);
+  RETRY_JOURNAL_FIELDS(READ_FIELD)
+#undef READ_FIELD
+
+  std::vector<std::string> plugins = call.value("plugin_retry_list", std::vector<std::string>());
+  for (std::vector<std::string>::iterator it = plugins.begin(); it != plugins.end(); ++it) {
+    int index = plugman_plugin_index(*it);
+    if (index < 0) {
+      BOOST_LOG_TRIVIAL(error) << "Retry Journal: plugin " << *it << " is no longer loaded, not retrying it for " << call_info.filename;
+    } else {
+      call_info.plugin_retry_list.push_back(index);
+    }
+  }
+  if (call.contains("call_json")) {
+    call_info.call_json = std::make_shared<const std::string>(call["call_json"].get<std::string>());
+  }
+  return call_info;
+}
+
+std::vector<Call_Data_t> Retry_Journal::open(const std::string &filename) {
+  std::vector<Call_Data_t> calls;
+  path = filename;
+  live.clear();
+  dead_records = 0;
+
+  std::ifstream in(path);
+  std::string line;
+  size_t bad_records = 0;
+  while (std::getline(in, line)) {
+    // A crash can leave the last line cut short
+    nlohmann::json record = nlohmann::json::parse(line, nullptr, false);
+    if (record.is_discarded() || !record.is_object()) {
+      bad_records++;
+      continue;
+    }
+    if (record.contains("add") && record["add"].is_object()) {
+      live[record["add"].value("status_filename", "")] = line + "\n";
+    } else if (record.contains("done")) {
+      live.erase(record["done"].get<std::string>());
+    }
+  }
+  in.close();
+  if (bad_records) {
+    BOOST_LOG_TRIVIAL(error) << "Retry Journal: skipped " << bad_records << " unreadable records in " << path;
+  }
+
+  for (std::map<std::string, std::string>::iterator it = live.begin(); it != live.end(); ++it) {
+    try {
+      calls.push_back(from_json(nlohmann::json::parse(it->second)["add"]));
+    } catch (nlohmann::json::exception &e) {
+      BOOST_LOG_TRIVIAL(error) << "Retry Journal: could not restore " << it->first << ": " << e.what();
+    }
+  }
+
+  compact();
+  BOOST_LOG_TRIVIAL(info) << "Retry Journal: " << path << " has " << calls.size() << " calls to retry";
+  return calls;
+}
+
+bool Retry_Journal::is_open() {
+  return fp != NULL;
+}
+
+size_t Retry_Journal::size() {
+  return live.size();
+}
+
+void Retry_Journal::add(const Call_Data_t &call_info) {
+  if (!fp) {
+    return;
+  }
+  if (live.count(call_info.status_filename)) {
+    dead_records++;
+  }
+  std::string line = to_line(call_info);
+  live[call_info.status_filename] = line;
+  append(line);
+}
+
+void Retry_Journal::remove(const Call_Data_t &call_info) {
+  if (!fp || !live.erase(call_info.status_filename)) {
+    return;
+  }
+  nlohmann::json record = {{"done", call_info.status_filename}};
+  append(record.dump() + "\n");
+  dead_records += 2;
+
+  if (dead_records > 2 * live.size() + 100) {
+    compact();
+  }
+}
+
+void Retry_Journal::append(const std::string &line) {
+  if ((fwrite(line.data(), 1, line.size(), fp) != line.size()) || (fflush(fp) != 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Retry Journal: unable to write to " << path << ": " << strerror(errno);
+  }
+}
+
+// Rewrites the journal with just the live records, replacing the old one
+// only once the new one is safely on disk
+void Retry_Journal::compact() {
+  if (fp) {
+    fclose(fp);
+    fp = NULL;
+  }
+
+  std::string temp_path = path + ".tmp";
+  FILE *out = fopen(temp_path.c_str(), "w");
+  bool ok = (out != NULL);
+  for (std::map<std::string, std::string>::iterator it = live.begin(); ok && (it != live.end()); ++it) {
+    ok = (fwrite(it->second.data(), 1, it->second.size(), out) == it->second.size());
+  }
+  if (out) {
+    ok = (fflush(out) == 0) && (fsync(fileno(out)) == 0) && ok;
+    ok = (fclose(out) == 0) && ok;
+  }
+  ok = ok && (rename(temp_path.c_str(), path.c_str()) == 0);
+  if (!ok) {
+    BOOST_LOG_TRIVIAL(error) << "Retry Journal: unable to rewrite " << path << ": " << strerror(errno);
+    std::remove(temp_path.c_str());
+  } else {
+    dead_records = 0;
+  }
+
+  fp = fopen(path.c_str(), "a");
+  if (!fp) {
+    BOOST_LOG_TRIVIAL(error) << "Retry Journal: unable to open " << path << ", retries will not survive a restart: " << strerror(errno);
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef RETRY_JOURNAL_H
+#define RETRY_JOURNAL_H
+
+#include "../global_structs.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Retry_Journal
+ *   Keeps the calls waiting for an upload retry in a file, so a restart
+ *   doesn't lose them.
+ *
+ * The file is append only, one JSON line per change: the whole call when
+ * it is put up for a retry, and just its status filename, which is unique
+ * to the call, when it is done with. open() replays it, keeping the last
+ * record of each call that isn't done, and rewrites the file with only
+ * those. The same is done whenever finished records outnumber live ones
+ * by more than two to one.
+ *
+ * Failed plugins are kept by name, since their place in the plugin list
+ * can change between runs. Audio that was only held in memory is gone
+ * after a restart, so only the call's files on disk are retried.
+ *
+ * The Call_Concluder uses it on the main thread only.
+ */
+class Retry_Journal {
+public:
+  static std::vector<Call_Data_t> open(const std::string &filename);
+  static bool is_open();
+  static void add(const Call_Data_t &call_info);
+  static void remove(const Call_Data_t &call_info);
+  static size_t size();
+
+private:
+  static void append(const std::string &line);
+  static void compact();
+
+  static std::string path;
+  static FILE *fp;
+  static std::map<std::string, std::string> live; // status filename to the line that added it
+  static size_t dead_records;
+};
+
+#endif // RETRY_JOURNAL_H
@@ -2,10 +2,11 @@
 #include "call_conventional.h"
 #include "formatter.h"
 #include "recorders/recorder.h"
+#include "replay_clock.h"
 #include <boost/algorithm/string.hpp>
 #include <chrono>
 
-Call_conventional::Call_conventional(long t, double f, System *s, Config c, double squelch_db, bool signal_detection) : Call_impl(t, f, s, c) {
+Call_conventional::Call_conventional(long t, double f, System *s, const Config &c, double squelch_db, bool signal_detection) : Call_impl(t, f, s, c) {
   this->squelch_db = squelch_db;
   this->signal_detection = signal_detection;
   BOOST_LOG_TRIVIAL(info) << "[" << sys->get_short_name() << "]\tFreq: " << format_freq(f) << "\tSquelch: " << squelch_db << " dB\tSignal Detection: " << signal_detection;
@@ -18,13 +19,12 @@ void Call_conventional::restart_call() {
   noise = DB_UNSET;
   curr_src_id = -1;
 
-  auto now = std::chrono::system_clock::now();
-  start_time    = std::chrono::system_clock::to_time_t(now);
-  start_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+  start_time_ms = Replay_Clock::now_ms();
+  start_time    = static_cast<time_t>(start_time_ms / 1000);
   stop_time     = start_time;
   stop_time_ms  = start_time_ms;
 
-  last_update = time(NULL);
+  last_update = Replay_Clock::now();
   state = RECORDING;
   debug_recording = false;
   phase2_tdma = false;
@@ -50,9 +50,8 @@ void Call_conventional::set_recorder(Recorder *r) {
 }
 
 void Call_conventional::recording_started() {
-  auto now = std::chrono::system_clock::now();
-  start_time    = std::chrono::system_clock::to_time_t(now);
-  start_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+  start_time_ms = Replay_Clock::now_ms();
+  start_time    = static_cast<time_t>(start_time_ms / 1000);
 }
 
 double Call_conventional::get_squelch_db() {
@@ -1,21 +1,24 @@
 #include "call_impl.h"
 #include "call.h"
 #include "call_concluder/call_concluder.h"
+#include "call_latency.h"
 #include "formatter.h"
 #include "recorder_globals.h"
 #include "recorders/recorder.h"
+#include "replay_clock.h"
 #include "source.h"
 #include <boost/algorithm/string.hpp>
 #include <signal.h>
 #include <stdio.h>
 #include <chrono>
+#include <mutex>
 
 std::string Call_impl::get_capture_dir() {
-  return this->config.capture_dir;
+  return this->config->capture_dir;
 }
 
 std::string Call_impl::get_temp_dir() {
-  return this->config.temp_dir;
+  return this->config->temp_dir;
 }
 
 /*
@@ -24,12 +27,44 @@ Call * Call::make(long t, double f, System *s, Config c) {
   return (Call *) new Call_impl(t, f, s, c);
 }*/
 
-Call *Call::make(TrunkMessage message, System *s, Config c) {
+Call *Call::make(TrunkMessage message, System *s, const Config &c) {
   return (Call *)new Call_impl(message, s, c);
 }
 
-Call_impl::Call_impl(long t, double f, System *s, Config c) {
-  config = c;
+// Enough for the Calls that end in a busy second, past that they go back to
+// the heap. Call_conventional is bigger and always comes from the heap.
+static const size_t CALL_POOL_SIZE = 256;
+static std::mutex call_pool_mutex;
+static std::vector<void *> call_pool;
+
+void *Call_impl::operator new(size_t size) {
+  if (size == sizeof(Call_impl)) {
+    std::lock_guard<std::mutex> lock(call_pool_mutex);
+    if (!call_pool.empty()) {
+      void *p = call_pool.back();
+      call_pool.pop_back();
+      return p;
+    }
+  }
+  return ::operator new(size);
+}
+
+void Call_impl::operator delete(void *p, size_t size) {
+  if (size == sizeof(Call_impl)) {
+    std::lock_guard<std::mutex> lock(call_pool_mutex);
+    if (call_pool.capacity() < CALL_POOL_SIZE) {
+      call_pool.reserve(CALL_POOL_SIZE);
+    }
+    if (call_pool.size() < CALL_POOL_SIZE) {
+      call_pool.push_back(p);
+      return;
+    }
+  }
+  ::operator delete(p);
+}
+
+Call_impl::Call_impl(long t, double f, System *s, const Config &c) {
+  config = &c;
   call_num = call_counter++;
   noise = DB_UNSET;
   signal = DB_UNSET;
@@ -40,14 +75,11 @@ Call_impl::Call_impl(long t, double f, System *s, Config c) {
   curr_src_id = -1;
   talkgroup = t;
   sys = s;
-  start_time = time(NULL);
-  stop_time = time(NULL);
-  start_time_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
+  start_time = Replay_Clock::now();
+  stop_time = Replay_Clock::now();
+  start_time_ms = Replay_Clock::now_ms();
   stop_time_ms = 0;
-  last_update = time(NULL);
+  last_update = Replay_Clock::now();
   state = MONITORING;
   monitoringState = UNSPECIFIED;
   debug_recording = false;
@@ -60,14 +92,20 @@ Call_impl::Call_impl(long t, double f, System *s, Config c) {
   duplex = false;
   mode = false;
   is_analog = false;
+  source_allocation = Source_Allocation();
+  for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+    latency_marks[i] = 0;
+  }
+  mark_latency(LATENCY_GRANT);
+  pre_tuned = false;
   was_update = false;
   priority = 0;
   set_freq(f);
   this->update_talkgroup_display();
 }
 
-Call_impl::Call_impl(TrunkMessage message, System *s, Config c) {
-  config = c;
+Call_impl::Call_impl(TrunkMessage message, System *s, const Config &c) {
+  config = &c;
   call_num = call_counter++;
   noise = DB_UNSET;
   signal = DB_UNSET;
@@ -78,14 +116,11 @@ Call_impl::Call_impl(TrunkMessage message, System *s, Config c) {
   freq_error = 0;
   talkgroup = message.talkgroup;
   sys = s;
-  start_time = time(NULL);
-  stop_time = time(NULL);
-  start_time_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
+  start_time = Replay_Clock::now();
+  stop_time = Replay_Clock::now();
+  start_time_ms = Replay_Clock::now_ms();
   stop_time_ms = 0;
-  last_update = time(NULL);
+  last_update = Replay_Clock::now();
   state = MONITORING;
   monitoringState = UNSPECIFIED;
   debug_recording = false;
@@ -98,6 +133,12 @@ Call_impl::Call_impl(TrunkMessage message, System *s, Config c) {
   duplex = message.duplex;
   mode = message.mode;
   is_analog = false;
+  source_allocation = Source_Allocation();
+  for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+    latency_marks[i] = 0;
+  }
+  mark_latency(LATENCY_GRANT);
+  pre_tuned = false;
   priority = message.priority;
   if (message.message_type == GRANT) {
     was_update = false;
@@ -133,11 +174,8 @@ long Call_impl::get_call_num() {
 void Call_impl::conclude_call() {
 
   // BOOST_LOG_TRIVIAL(info) << "conclude_call()";
-  stop_time = time(NULL);
-  stop_time_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
+  stop_time = Replay_Clock::now();
+  stop_time_ms = Replay_Clock::now_ms();
 
   if (state == RECORDING || (state == MONITORING && monitoringState == SUPERSEDED)) {
     if (!recorder) {
@@ -168,6 +206,7 @@ void Call_impl::conclude_call() {
     }
     freq_error = this->get_recorder()->get_freq_error();
     this->get_recorder()->stop();
+    Call_Latency::record(this);
 
     if (this->get_sigmf_recording() == true) {
       this->get_sigmf_recorder()->stop();
@@ -182,14 +221,14 @@ void Call_impl::conclude_call() {
       // Conventional DMR is recorded on two slots, so we need to conclude the call for each slot
       transmission_list = recorder->get_transmission_list(0);
       tdma_slot = 0;
-      Call_Concluder::conclude_call(this, sys, config);
+      Call_Concluder::conclude_call(this, sys, *config);
       transmission_list = recorder->get_transmission_list(1);
       tdma_slot = 1;
-      Call_Concluder::conclude_call(this, sys, config);
+      Call_Concluder::conclude_call(this, sys, *config);
     } else {
       // All other system types do not have multiple recorders
       transmission_list = this->get_recorder()->get_transmission_list();
-      Call_Concluder::conclude_call(this, sys, config);
+      Call_Concluder::conclude_call(this, sys, *config);
    }
 
   }
@@ -305,6 +344,36 @@ bool Call_impl::get_is_analog() {
   return is_analog;
 }
 
+void Call_impl::set_source_allocation(Source_Allocation a) {
+  source_allocation = a;
+}
+
+Source_Allocation Call_impl::get_source_allocation() {
+  return source_allocation;
+}
+
+void Call_impl::add_duplicate_grant(Duplicate_Grant grant) {
+  duplicate_grants.push_back(grant);
+}
+
+std::vector<Duplicate_Grant> Call_impl::get_duplicate_grants() {
+  return duplicate_grants;
+}
+
+// Only the first time a stage is reached counts, later transmissions of the
+// same call go through the same stages again.
+void Call_impl::mark_latency(Call_Latency_Stage stage) {
+  std::int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+  std::int64_t unset = 0;
+  latency_marks[stage].compare_exchange_strong(unset, now);
+}
+
+std::int64_t Call_impl::get_latency_mark(Call_Latency_Stage stage) {
+  return latency_marks[stage];
+}
+
 bool Call_impl::get_sigmf_recording() {
   return sigmf_recording;
 }
@@ -423,7 +492,7 @@ bool Call_impl::add_source(long src) {
 }
 
 bool Call_impl::update(TrunkMessage message) {
-  last_update = time(NULL);
+  last_update = Replay_Clock::now();
   if ((message.freq != this->curr_freq) || (message.talkgroup != this->talkgroup)) {
     std::string loghdr = log_header( sys->get_short_name(), this->get_call_num(), this->get_talkgroup_display(), this->get_freq());
     BOOST_LOG_TRIVIAL(error) << loghdr << "C\033[0m\tCall_impl Update, message mismatch - \ttMsg Tg: " << message.talkgroup << "\tMsg Freq: " << message.freq;
@@ -434,7 +503,7 @@ bool Call_impl::update(TrunkMessage message) {
 }
 
 int Call_impl::since_last_update() {
-  return time(NULL) - last_update;
+  return Replay_Clock::now() - last_update;
 }
 
 double Call_impl::since_last_voice_update() {
@@ -448,7 +517,7 @@ double Call_impl::since_last_voice_update() {
 }
 
 long Call_impl::elapsed() {
-  return time(NULL) - start_time;
+  return Replay_Clock::now() - start_time;
 }
 
 int Call_impl::get_idle_count() {
@@ -484,6 +553,14 @@ std::string Call_impl::get_talkgroup_tag() {
   return talkgroup_tag;
 }
 
+void Call_impl::set_encoded_filename(std::string filename) {
+  encoded_filename = filename;
+}
+
+std::string Call_impl::get_encoded_filename() {
+  return encoded_filename;
+}
+
 bool Call_impl::get_conversation_mode() {
   if (!sys) {
     BOOST_LOG_TRIVIAL(error) << "\tWEIRD! for some reason, call has no sys - Call_impl TG: " << get_talkgroup() << "\t Call_impl Freq: " << get_freq();
@@ -507,7 +584,7 @@ void Call_impl::update_talkgroup_display() {
   } else {
     snprintf(formattedTalkgroup, 61, "%c[%dm%10ld%c[0m", 0x1B, color, talkgroup, 0x1B);
   }
-  talkgroup_display = boost::lexical_cast<std::string>(formattedTalkgroup);
+  talkgroup_display.assign(formattedTalkgroup);
 }
 
 boost::property_tree::ptree Call_impl::get_stats() {
@@ -3,6 +3,7 @@
 
 #include "./global_structs.h"
 #include "gr_blocks/decoder_wrapper.h"
+#include <atomic>
 #include <boost/log/trivial.hpp>
 #include <string>
 #include <sys/time.h>
@@ -21,8 +22,14 @@ class System;
 
 class Call_impl : public Call {
 public:
-  Call_impl(long t, double f, System *s, Config c);
-  Call_impl(TrunkMessage message, System *s, Config c);
+  Call_impl(long t, double f, System *s, const Config &c);
+  Call_impl(TrunkMessage message, System *s, const Config &c);
+
+  // There is a Call for every grant, most of them for talkgroups that are
+  // never recorded, so the memory of the ones that are deleted is kept and
+  // handed to the next ones
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
 
   long get_call_num();
   virtual void restart_call();
@@ -66,6 +73,14 @@ public:
   int get_tdma_slot();
   bool get_is_analog();
   void set_is_analog(bool a);
+  void set_source_allocation(Source_Allocation a);
+  Source_Allocation get_source_allocation();
+  void add_duplicate_grant(Duplicate_Grant grant);
+  std::vector<Duplicate_Grant> get_duplicate_grants();
+  void mark_latency(Call_Latency_Stage stage);
+  std::int64_t get_latency_mark(Call_Latency_Stage stage);
+  void set_pre_tuned(bool m) { pre_tuned = m; }
+  bool get_pre_tuned() { return pre_tuned; }
   const char *get_xor_mask();
   virtual time_t get_start_time() { return start_time; }
   virtual std::int64_t get_start_time_ms();
@@ -88,6 +103,8 @@ public:
   boost::property_tree::ptree get_stats();
 
   std::string get_talkgroup_tag();
+  void set_encoded_filename(std::string filename);
+  std::string get_encoded_filename();
   std::string get_system_type();
   double get_final_length();
   long get_current_source_id();
@@ -107,7 +124,6 @@ protected:
   int freq_error;
   std::vector<Transmission> transmission_list;
   System *sys;
-  std::string short_name;
   long curr_src_id;
   long error_list_count;
   long freq_count;
@@ -125,19 +141,19 @@ protected:
   bool mode;
   bool duplex;
   bool is_analog;
+  Source_Allocation source_allocation;
+  std::vector<Duplicate_Grant> duplicate_grants;
+  // steady_clock microseconds for each Call_Latency_Stage, 0 until reached.
+  // The transmission_sink marks the last two from the flowgraph thread.
+  std::atomic<std::int64_t> latency_marks[LATENCY_STAGE_COUNT];
+  bool pre_tuned; // the recorder was already on the channel, see Recorder_Pool
   int priority;
-  std::string filename;
-  std::string transmission_filename;
-  std::string converted_filename;
-  std::string status_filename;
-  std::string debug_filename;
-  std::string sigmf_filename;
-  std::string path;
+  std::string encoded_filename; // m4a made by the streaming encoder while recording
   bool phase2_tdma;
   int tdma_slot;
   double final_length;
 
-  Config config;
+  const Config *config; // the one load_config() filled in, it outlives every Call
   Recorder *recorder;
   Recorder *debug_recorder;
   Recorder *sigmf_recorder;
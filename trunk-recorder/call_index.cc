@@ -0,0 +1,89 @@
+#include "call_index.h"
+#include "call.h"
+#include "systems/system.h"
+
+#include <algorithm>
+
+void Call_Index::add(Call *call) {
+  talkgroups[call->get_talkgroup()].push_back(call);
+  channels[make_channel(call->get_sys_num(), call->get_freq(), call->get_tdma_slot())].push_back(call);
+
+  System *sys = call->get_system();
+  if (!call->is_conventional() && sys && sys->get_multiSite()) {
+    Grant grant = {sys->get_wacn(), sys->get_sys_id(), call->get_talkgroup(), call->get_current_source_id()};
+    grants[grant].push_back(call);
+    call_grants[call] = grant;
+  }
+}
+
+void Call_Index::remove_from(std::vector<Call *> &bucket, Call *call) {
+  std::vector<Call *>::iterator it = std::find(bucket.begin(), bucket.end(), call);
+  if (it != bucket.end()) {
+    bucket.erase(it);
+  }
+}
+
+void Call_Index::remove(Call *call) {
+  std::unordered_map<long, std::vector<Call *>>::iterator tg_it = talkgroups.find(call->get_talkgroup());
+  if (tg_it != talkgroups.end()) {
+    remove_from(tg_it->second, call);
+    if (tg_it->second.empty()) {
+      talkgroups.erase(tg_it);
+    }
+  }
+
+  std::unordered_map<Channel, std::vector<Call *>, Channel_Hash>::iterator ch_it = channels.find(make_channel(call->get_sys_num(), call->get_freq(), call->get_tdma_slot()));
+  if (ch_it != channels.end()) {
+    remove_from(ch_it->second, call);
+    if (ch_it->second.empty()) {
+      channels.erase(ch_it);
+    }
+  }
+
+  std::unordered_map<Call *, Grant>::iterator call_it = call_grants.find(call);
+  if (call_it != call_grants.end()) {
+    std::unordered_map<Grant, std::vector<Call *>, Grant_Hash>::iterator grant_it = grants.find(call_it->second);
+    if (grant_it != grants.end()) {
+      remove_from(grant_it->second, call);
+      if (grant_it->second.empty()) {
+        grants.erase(grant_it);
+      }
+    }
+    call_grants.erase(call_it);
+  }
+}
+
+void Call_Index::rebuild(const std::vector<Call *> &calls) {
+  talkgroups.clear();
+  channels.clear();
+  grants.clear();
+  call_grants.clear();
+  for (std::vector<Call *>::const_iterator it = calls.begin(); it != calls.end(); ++it) {
+    add(*it);
+  }
+}
+
+const std::vector<Call *> &Call_Index::find_talkgroup(long talkgroup) const {
+  std::unordered_map<long, std::vector<Call *>>::const_iterator it = talkgroups.find(talkgroup);
+  if (it == talkgroups.end()) {
+    return none;
+  }
+  return it->second;
+}
+
+const std::vector<Call *> &Call_Index::find_channel(int sys_num, double freq, int tdma_slot) const {
+  std::unordered_map<Channel, std::vector<Call *>, Channel_Hash>::const_iterator it = channels.find(make_channel(sys_num, freq, tdma_slot));
+  if (it == channels.end()) {
+    return none;
+  }
+  return it->second;
+}
+
+const std::vector<Call *> &Call_Index::find_grant(unsigned long wacn, unsigned long sys_id, long talkgroup, long source) const {
+  Grant grant = {wacn, sys_id, talkgroup, source};
+  std::unordered_map<Grant, std::vector<Call *>, Grant_Hash>::const_iterator it = grants.find(grant);
+  if (it == grants.end()) {
+    return none;
+  }
+  return it->second;
+}
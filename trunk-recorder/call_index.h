@@ -0,0 +1,86 @@
+#ifndef CALL_INDEX_H
+#define CALL_INDEX_H
+
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class Call;
+
+/*
+ * Call_Index
+ *   Hash lookups over the active Calls, so a GRANT or UPDATE only looks at
+ *   the Calls it could match instead of walking every active Call.
+ *
+ * Calls are indexed by talkgroup, across all Systems, which covers the
+ * exact match and the Multi-Site duplicate check, and by System, freq and
+ * TDMA slot, which covers a different talkgroup taking over a channel.
+ * The talkgroup, System, freq and slot of a Call don't change once it has
+ * been made, so a Call only has to be added when it is pushed onto the
+ * calls vector and removed when it is erased from it. Each bucket keeps
+ * the Calls in the order they were added, the same order as the vector.
+ *
+ * Calls on Multi-Site Systems are also indexed by their grant: the WACN,
+ * System ID, talkgroup and unit, which is the same on every site of the
+ * system that carries the call. The unit of a Call can change after it is
+ * made, so the grant it was indexed under is kept for removing it.
+ */
+class Call_Index {
+public:
+  void add(Call *call);
+  void remove(Call *call);
+  void rebuild(const std::vector<Call *> &calls);
+
+  const std::vector<Call *> &find_talkgroup(long talkgroup) const;
+  const std::vector<Call *> &find_channel(int sys_num, double freq, int tdma_slot) const;
+  const std::vector<Call *> &find_grant(unsigned long wacn, unsigned long sys_id, long talkgroup, long source) const;
+
+private:
+  struct Channel {
+    int sys_num;
+    long long freq_hz;
+    int tdma_slot;
+    bool operator==(const Channel &other) const { return (sys_num == other.sys_num) && (freq_hz == other.freq_hz) && (tdma_slot == other.tdma_slot); }
+  };
+  struct Channel_Hash {
+    size_t operator()(const Channel &c) const {
+      size_t h = std::hash<long long>()(c.freq_hz);
+      h ^= std::hash<int>()(c.sys_num) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      h ^= std::hash<int>()(c.tdma_slot) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  struct Grant {
+    unsigned long wacn;
+    unsigned long sys_id;
+    long talkgroup;
+    long source;
+    bool operator==(const Grant &other) const { return (wacn == other.wacn) && (sys_id == other.sys_id) && (talkgroup == other.talkgroup) && (source == other.source); }
+  };
+  struct Grant_Hash {
+    size_t operator()(const Grant &g) const {
+      size_t h = std::hash<long>()(g.talkgroup);
+      h ^= std::hash<long>()(g.source) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      h ^= std::hash<unsigned long>()(g.wacn) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      h ^= std::hash<unsigned long>()(g.sys_id) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  static Channel make_channel(int sys_num, double freq, int tdma_slot) {
+    Channel c = {sys_num, std::llround(freq), tdma_slot};
+    return c;
+  }
+  static void remove_from(std::vector<Call *> &bucket, Call *call);
+
+  std::unordered_map<long, std::vector<Call *>> talkgroups;
+  std::unordered_map<Channel, std::vector<Call *>, Channel_Hash> channels;
+  std::unordered_map<Grant, std::vector<Call *>, Grant_Hash> grants;
+  std::unordered_map<Call *, Grant> call_grants;
+  std::vector<Call *> none;
+};
+
+#endif // CALL_INDEX_H
@@ -0,0 +1,110 @@
+#include "call_latency.h"
+#include "call.h"
+#include "recorders/recorder.h"
+#include "source.h"
+
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+#include <sstream>
+
+std::map<std::string, Call_Latency::Histograms> Call_Latency::systems;
+std::map<int, Call_Latency::Histograms> Call_Latency::sources;
+
+static void record_interval(Latency_Histogram &histogram, Call *call, Call_Latency_Stage from, Call_Latency_Stage to) {
+  std::int64_t start = call->get_latency_mark(from);
+  std::int64_t end = call->get_latency_mark(to);
+  if (start && end) {
+    histogram.record(end - start);
+  }
+}
+
+void Call_Latency::add(Histograms &histograms, Call *call) {
+  histograms.calls++;
+  if (!call->get_latency_mark(LATENCY_FIRST_WRITE)) {
+    histograms.no_audio++;
+  }
+  record_interval(histograms.grant_to_start, call, LATENCY_GRANT, LATENCY_RECORDER_START);
+  record_interval(histograms.start_to_retune, call, LATENCY_RECORDER_START, LATENCY_RETUNE);
+  record_interval(histograms.retune_to_frame, call, LATENCY_RETUNE, LATENCY_FIRST_FRAME);
+  record_interval(histograms.frame_to_write, call, LATENCY_FIRST_FRAME, LATENCY_FIRST_WRITE);
+  record_interval(histograms.grant_to_write, call, LATENCY_GRANT, LATENCY_FIRST_WRITE);
+  if (call->get_pre_tuned()) {
+    histograms.pre_tuned++;
+    record_interval(histograms.pre_tuned_grant_to_write, call, LATENCY_GRANT, LATENCY_FIRST_WRITE);
+  } else {
+    record_interval(histograms.retuned_grant_to_write, call, LATENCY_GRANT, LATENCY_FIRST_WRITE);
+  }
+}
+
+void Call_Latency::record(Call *call) {
+  if (call->is_conventional() || !call->get_latency_mark(LATENCY_RECORDER_START)) {
+    return;
+  }
+
+  add(systems[call->get_short_name()], call);
+
+  Recorder *recorder = call->get_recorder();
+  if (recorder && recorder->get_source()) {
+    add(sources[recorder->get_source()->get_num()], call);
+  }
+}
+
+Latency_Summary Call_Latency::summarize(const Latency_Histogram &histogram) {
+  Latency_Summary summary;
+  summary.count = histogram.count();
+  summary.p50_ms = histogram.percentile(0.50) / 1000.0;
+  summary.p90_ms = histogram.percentile(0.90) / 1000.0;
+  summary.p99_ms = histogram.percentile(0.99) / 1000.0;
+  summary.max_ms = histogram.max() / 1000.0;
+  return summary;
+}
+
+Call_Latency_Stats Call_Latency::summarize(std::string type, std::string name, const Histograms &histograms) {
+  Call_Latency_Stats stats;
+  stats.type = type;
+  stats.name = name;
+  stats.calls = histograms.calls;
+  stats.no_audio = histograms.no_audio;
+  stats.grant_to_start = summarize(histograms.grant_to_start);
+  stats.start_to_retune = summarize(histograms.start_to_retune);
+  stats.retune_to_frame = summarize(histograms.retune_to_frame);
+  stats.frame_to_write = summarize(histograms.frame_to_write);
+  stats.grant_to_write = summarize(histograms.grant_to_write);
+  stats.pre_tuned = histograms.pre_tuned;
+  stats.pre_tuned_grant_to_write = summarize(histograms.pre_tuned_grant_to_write);
+  stats.retuned_grant_to_write = summarize(histograms.retuned_grant_to_write);
+  return stats;
+}
+
+std::vector<Call_Latency_Stats> Call_Latency::get_stats() {
+  std::vector<Call_Latency_Stats> stats;
+  for (std::map<std::string, Histograms>::const_iterator it = systems.begin(); it != systems.end(); ++it) {
+    stats.push_back(summarize("system", it->first, it->second));
+  }
+  for (std::map<int, Histograms>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+    stats.push_back(summarize("source", std::to_string(it->first), it->second));
+  }
+  return stats;
+}
+
+static std::string format_summary(const Latency_Summary &summary) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << summary.p50_ms << "/" << summary.p90_ms << "/" << summary.p99_ms << "/" << summary.max_ms;
+  return out.str();
+}
+
+void Call_Latency::print_stats() {
+  std::vector<Call_Latency_Stats> stats = get_stats();
+  if (stats.empty()) {
+    return;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Call Start Latency (p50/p90/p99/max ms): ";
+  for (std::vector<Call_Latency_Stats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+    std::string label = (it->type == "system") ? "[" + it->name + "]" : "[Source " + it->name + "]";
+    BOOST_LOG_TRIVIAL(info) << label << "\tCalls: " << it->calls << " No Audio: " << it->no_audio << "\tGrant to Start: " << format_summary(it->grant_to_start) << "\tRetune: " << format_summary(it->start_to_retune) << "\tFirst Frame: " << format_summary(it->retune_to_frame) << "\tFirst Write: " << format_summary(it->frame_to_write) << "\tTotal: " << format_summary(it->grant_to_write);
+    if (it->pre_tuned) {
+      BOOST_LOG_TRIVIAL(info) << label << "\tPre-tuned: " << it->pre_tuned << " (" << std::fixed << std::setprecision(1) << 100.0 * it->pre_tuned / it->calls << "%)\tPre-tuned Total: " << format_summary(it->pre_tuned_grant_to_write) << "\tRetuned Total: " << format_summary(it->retuned_grant_to_write);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef CALL_LATENCY_H
+#define CALL_LATENCY_H
+
+#include "global_structs.h"
+#include "latency_histogram.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Call;
+
+/*
+ * Call_Latency
+ *   How long trunked calls take to get from the GRANT to audio on disk,
+ *   the delay that clips the first syllable of a call.
+ *
+ * A Call timestamps each Call_Latency_Stage the first time it gets there.
+ * When a recorded call is concluded its stages are added to the histograms
+ * of its System and of the Source that recorded it:
+ *
+ *   grant to start    - control channel handling before start_recorder()
+ *   start to retune   - picking the Source and recorder and tuning it
+ *   retune to frame   - the recorder locking on and decoding the first audio
+ *   frame to write    - the Wav_Writer making the first transmission's file
+ *   grant to write    - all of it
+ *
+ * The totals are also split between the calls that got a recorder already
+ * tuned to their channel, see Pre_Tuner, and the ones that had to retune.
+ *
+ * Totals are kept from startup. Calls are concluded and the status printed
+ * on the main thread, so it doesn't need a lock.
+ */
+class Call_Latency {
+public:
+  static void record(Call *call);
+  static std::vector<Call_Latency_Stats> get_stats();
+  static void print_stats();
+  static Latency_Summary summarize(const Latency_Histogram &histogram);
+
+private:
+  struct Histograms {
+    long calls;
+    long no_audio;
+    Latency_Histogram grant_to_start;
+    Latency_Histogram start_to_retune;
+    Latency_Histogram retune_to_frame;
+    Latency_Histogram frame_to_write;
+    Latency_Histogram grant_to_write;
+    long pre_tuned;
+    Latency_Histogram pre_tuned_grant_to_write;
+    Latency_Histogram retuned_grant_to_write;
+    Histograms() : calls(0), no_audio(0), pre_tuned(0) {}
+  };
+
+  static void add(Histograms &histograms, Call *call);
+  static Call_Latency_Stats summarize(std::string type, std::string name, const Histograms &histograms);
+
+  static std::map<std::string, Histograms> systems;
+  static std::map<int, Histograms> sources;
+};
+
+#endif // CALL_LATENCY_H
@@ -0,0 +1,64 @@
+#include "call_preemption.h"
+#include "call.h"
+
+void Call_Preemption::add(Call *call, Source *source, bool analog, int priority) {
+  remove(call);
+  Pool_Key key(source, analog);
+  Entry entry = {call->get_emergency(), priority, call->get_call_num(), call};
+  pools[key].insert(entry);
+  entries[call] = std::make_pair(key, entry);
+}
+
+void Call_Preemption::remove(Call *call) {
+  std::unordered_map<Call *, std::pair<Pool_Key, Entry>>::iterator it = entries.find(call);
+  if (it == entries.end()) {
+    return;
+  }
+  std::map<Pool_Key, std::set<Entry>>::iterator pool = pools.find(it->second.first);
+  if (pool != pools.end()) {
+    pool->second.erase(it->second.second);
+    if (pool->second.empty()) {
+      pools.erase(pool);
+    }
+  }
+  entries.erase(it);
+}
+
+void Call_Preemption::clear() {
+  pools.clear();
+  entries.clear();
+}
+
+Call *Call_Preemption::find_victim(Source *source, bool analog, int priority, bool emergency) {
+  std::map<Pool_Key, std::set<Entry>>::iterator pool = pools.find(Pool_Key(source, analog));
+  if (pool == pools.end()) {
+    return NULL;
+  }
+  std::set<Entry> &calls = pool->second;
+
+  while (!calls.empty()) {
+    Entry entry = *calls.begin();
+    Call *call = entry.call;
+
+    if ((call->get_state() != RECORDING) || !call->get_recorder()) {
+      calls.erase(calls.begin());
+      entries.erase(call);
+      continue;
+    }
+    if (call->get_emergency() != entry.emergency) {
+      calls.erase(calls.begin());
+      entry.emergency = call->get_emergency();
+      calls.insert(entry);
+      entries[call].second = entry;
+      continue;
+    }
+
+    // The rest all matter at least as much as this one
+    if ((emergency && !entry.emergency) || ((emergency == entry.emergency) && (priority < entry.priority))) {
+      return call;
+    }
+    return NULL;
+  }
+  pools.erase(pool);
+  return NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef CALL_PREEMPTION_H
+#define CALL_PREEMPTION_H
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+class Call;
+class Source;
+
+/*
+ * Call_Preemption
+ *   The trunked Calls being recorded on each Source, ordered from the one
+ *   that matters least, so when a Source has no recorders left a grant for
+ *   a talkgroup that matters more can take the recorder of that one.
+ *
+ * A Call that isn't an emergency comes before one that is, then the one
+ * with the highest talkgroup priority number, then the newest, which has
+ * the least recorded to lose. Analog and digital Calls are kept apart,
+ * since they are on recorders from different pools.
+ *
+ * A Call is added when its recorder starts and removed when it is erased
+ * from the calls vector, alongside the Call_Index. It is left in while it
+ * is concluded in the meantime, and a Call that isn't recording any more,
+ * or has become an emergency since it was added, is sorted out when
+ * find_victim() comes to it. The priority is the one the Call was started
+ * with.
+ */
+class Call_Preemption {
+public:
+  void add(Call *call, Source *source, bool analog, int priority);
+  void remove(Call *call);
+  void clear();
+
+  // The Call on source recording with a recorder of the kind asked for that
+  // matters least, if it matters less than a call with priority and
+  // emergency, or NULL
+  Call *find_victim(Source *source, bool analog, int priority, bool emergency);
+
+private:
+  struct Entry {
+    bool emergency;
+    int priority;
+    long call_num;
+    Call *call;
+    // Least important first
+    bool operator<(const Entry &other) const {
+      if (emergency != other.emergency) {
+        return !emergency;
+      }
+      if (priority != other.priority) {
+        return priority > other.priority;
+      }
+      if (call_num != other.call_num) {
+        return call_num > other.call_num;
+      }
+      return call < other.call;
+    }
+  };
+  typedef std::pair<Source *, bool> Pool_Key;
+
+  std::map<Pool_Key, std::set<Entry>> pools;
+  std::unordered_map<Call *, std::pair<Pool_Key, Entry>> entries;
+};
+
+#endif // CALL_PREEMPTION_H
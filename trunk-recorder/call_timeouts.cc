@@ -0,0 +1,58 @@
+#include "call_timeouts.h"
+
+void Call_Timeouts::arm(Call *call, time_t deadline) {
+  if ((next_second != 0) && (deadline < next_second)) {
+    // The slot for that second has already been looked at this time around
+    deadline = next_second;
+  }
+  deadlines[call] = deadline;
+  slots[deadline % SLOTS].push_back(std::make_pair(call, deadline));
+}
+
+void Call_Timeouts::remove(Call *call) {
+  deadlines.erase(call);
+}
+
+void Call_Timeouts::clear() {
+  deadlines.clear();
+  for (int i = 0; i < SLOTS; i++) {
+    slots[i].clear();
+  }
+  next_second = 0;
+}
+
+void Call_Timeouts::expire(time_t now, std::vector<Call *> &expired) {
+  if (next_second == 0) {
+    // The first look goes all the way around
+    next_second = now - SLOTS + 1;
+  }
+
+  // Past a whole turn of the wheel, every slot is looked at once
+  time_t last = now;
+  if (now - next_second >= SLOTS) {
+    last = next_second + SLOTS - 1;
+  }
+
+  for (time_t second = next_second; second <= last; second++) {
+    std::vector<std::pair<Call *, time_t>> &slot = slots[second % SLOTS];
+    size_t kept = 0;
+    for (size_t i = 0; i < slot.size(); i++) {
+      Call *call = slot[i].first;
+      if (call == NULL) {
+        continue;
+      }
+      std::unordered_map<Call *, time_t>::iterator it = deadlines.find(call);
+      if ((it == deadlines.end()) || (it->second != slot[i].second)) {
+        continue;
+      }
+      if (slot[i].second > now) {
+        slot[kept++] = slot[i];
+        continue;
+      }
+      deadlines.erase(it);
+      expired.push_back(call);
+    }
+    slot.resize(kept);
+  }
+  next_second = now + 1;
+}
@@ -0,0 +1,51 @@
+#ifndef CALL_TIMEOUTS_H
+#define CALL_TIMEOUTS_H
+
+#include <ctime>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Call;
+
+/*
+ * Call_Timeouts
+ *   A timer wheel of when each trunked Call could next time out, so
+ *   manage_calls() only looks at the Calls that might have.
+ *
+ * A Call is armed for the first second it could time out in, worked out
+ * from how long it has been since its last UPDATE and, when it is
+ * recording, since its Recorder last wrote. Neither arming it again on
+ * every UPDATE nor on every write from a GNU Radio thread is needed: an
+ * UPDATE or a write only makes the Call time out later, so when its
+ * second comes manage_calls() checks it the way it always has and arms it
+ * again if it hasn't timed out after all.
+ *
+ * The wheel has a slot for each second, deadlines more than SLOTS seconds
+ * out go around it and are left in their slot until their turn. The
+ * seconds are Replay_Clock's, so a replayed capture times out calls on the
+ * samples' clock.
+ */
+class Call_Timeouts {
+public:
+  // Arms call for deadline, in place of one it was armed for before
+  void arm(Call *call, time_t deadline);
+  void remove(Call *call);
+  void clear();
+
+  // Adds the Calls whose deadline is now or has gone by to expired and takes
+  // them off the wheel
+  void expire(time_t now, std::vector<Call *> &expired);
+
+private:
+  static const int SLOTS = 64;
+
+  // A Call's entries in the slots that don't match its deadline here are
+  // left over from when it was armed before, or removed, and are dropped
+  // when their slot comes around
+  std::unordered_map<Call *, time_t> deadlines;
+  std::vector<std::pair<Call *, time_t>> slots[SLOTS];
+  time_t next_second = 0;
+};
+
+#endif // CALL_TIMEOUTS_H
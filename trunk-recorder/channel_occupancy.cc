@@ -0,0 +1,249 @@
+#include "channel_occupancy.h"
+#include "call.h"
+#include "replay_clock.h"
+#include "systems/system.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cmath>
+
+// Room for each System, with one more slot for what doesn't fit
+static const size_t CHANNEL_SLOTS = 256;
+static const size_t TALKGROUP_SLOTS = 4096;
+
+// Longer than this with no message for any call on a channel or talkgroup
+// and it wasn't in use in between
+static const std::int64_t BUSY_GAP_MS = 2000;
+
+std::vector<Channel_Occupancy::System_Counts> Channel_Occupancy::systems;
+std::int64_t Channel_Occupancy::last_snapshot = 0;
+FILE *Channel_Occupancy::file = NULL;
+
+void Channel_Occupancy::Table::resize(size_t size) {
+  Slot empty = {false, 0, {0, 0, 0, 0, 0, 0}};
+  slots.assign(size + 1, empty);
+  used = 0;
+}
+
+Channel_Occupancy::Slot &Channel_Occupancy::Table::find(std::int64_t key) {
+  size_t capacity = slots.size() - 1;
+  size_t index = (size_t)(((std::uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32) % capacity;
+  for (size_t probes = 0; probes < capacity; probes++) {
+    Slot &slot = slots[index];
+    if (slot.used && (slot.key == key)) {
+      return slot;
+    }
+    if (!slot.used) {
+      // Kept to 7/8 full, so a search for a key that isn't there ends soon
+      if (used >= capacity - capacity / 8) {
+        break;
+      }
+      slot.used = true;
+      slot.key = key;
+      used++;
+      return slot;
+    }
+    index = (index + 1) % capacity;
+  }
+  return slots[capacity];
+}
+
+void Channel_Occupancy::open(const std::string &filename, const std::vector<System *> &systems_in) {
+  systems.clear();
+  systems.resize(systems_in.size());
+  for (std::vector<System *>::const_iterator it = systems_in.begin(); it != systems_in.end(); ++it) {
+    System *sys = *it;
+    if ((sys->get_sys_num() < 0) || ((size_t)sys->get_sys_num() >= systems.size())) {
+      continue;
+    }
+    System_Counts &counts = systems[sys->get_sys_num()];
+    counts.short_name = sys->get_short_name();
+    counts.grants = 0;
+    counts.active = 0;
+    counts.peak = 0;
+    counts.channels.resize(CHANNEL_SLOTS);
+    counts.talkgroups.resize(TALKGROUP_SLOTS);
+  }
+  last_snapshot = Replay_Clock::now_ms();
+
+  if (filename == "") {
+    return;
+  }
+  file = fopen(filename.c_str(), "a");
+  if (!file) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to open the channel occupancy file: " << filename;
+    return;
+  }
+  if (ftell(file) == 0) {
+    fputs("time,system,type,freq,slot,talkgroup,grants,airtime,peak\n", file);
+  }
+  BOOST_LOG_TRIVIAL(info) << "Writing channel occupancy to: " << filename;
+}
+
+void Channel_Occupancy::close() {
+  if (file) {
+    fclose(file);
+    file = NULL;
+  }
+}
+
+void Channel_Occupancy::open_counter(Counter &counter, std::int64_t now) {
+  counter.grants++;
+  if (counter.active == 0) {
+    counter.busy_since = now;
+  } else if (now - counter.last_seen > BUSY_GAP_MS) {
+    counter.airtime_ms += counter.last_seen - counter.busy_since;
+    counter.busy_since = now;
+  }
+  counter.active++;
+  counter.peak = std::max(counter.peak, counter.active);
+  counter.last_seen = now;
+}
+
+void Channel_Occupancy::see_counter(Counter &counter, std::int64_t now) {
+  if (counter.active == 0) {
+    return;
+  }
+  if (now - counter.last_seen > BUSY_GAP_MS) {
+    counter.airtime_ms += counter.last_seen - counter.busy_since;
+    counter.busy_since = now;
+  }
+  counter.last_seen = now;
+}
+
+void Channel_Occupancy::close_counter(Counter &counter) {
+  if (counter.active == 0) {
+    return;
+  }
+  counter.active--;
+  if (counter.active == 0) {
+    counter.airtime_ms += counter.last_seen - counter.busy_since;
+  }
+}
+
+// What was counted since the last time, with the span still going cut at
+// the last message
+Occupancy_Counts Channel_Occupancy::take_counter(Counter &counter) {
+  Occupancy_Counts counts;
+  counts.grants = counter.grants;
+  counts.airtime = counter.airtime_ms / 1000.0;
+  counts.peak = counter.peak;
+  if (counter.active > 0) {
+    counts.airtime += (counter.last_seen - counter.busy_since) / 1000.0;
+    counter.busy_since = counter.last_seen;
+  }
+  counter.grants = 0;
+  counter.airtime_ms = 0;
+  counter.peak = counter.active;
+  return counts;
+}
+
+Channel_Occupancy::System_Counts *Channel_Occupancy::find_system(Call *call) {
+  int sys_num = call->get_sys_num();
+  if (call->is_conventional() || (sys_num < 0) || ((size_t)sys_num >= systems.size()) || !systems[sys_num].channels.size()) {
+    return NULL;
+  }
+  return &systems[sys_num];
+}
+
+static std::int64_t channel_key(Call *call) {
+  return llround(call->get_freq()) * 2 + (call->get_tdma_slot() & 1);
+}
+
+void Channel_Occupancy::grant(Call *call) {
+  System_Counts *counts = find_system(call);
+  if (!counts) {
+    return;
+  }
+  std::int64_t now = Replay_Clock::now_ms();
+  counts->grants++;
+  counts->active++;
+  counts->peak = std::max(counts->peak, counts->active);
+  open_counter(counts->channels.find(channel_key(call)).counter, now);
+  open_counter(counts->talkgroups.find(call->get_talkgroup()).counter, now);
+}
+
+void Channel_Occupancy::update(Call *call) {
+  System_Counts *counts = find_system(call);
+  if (!counts) {
+    return;
+  }
+  std::int64_t now = Replay_Clock::now_ms();
+  see_counter(counts->channels.find(channel_key(call)).counter, now);
+  see_counter(counts->talkgroups.find(call->get_talkgroup()).counter, now);
+}
+
+void Channel_Occupancy::release(Call *call) {
+  System_Counts *counts = find_system(call);
+  if (!counts) {
+    return;
+  }
+  if (counts->active > 0) {
+    counts->active--;
+  }
+  close_counter(counts->channels.find(channel_key(call)).counter);
+  close_counter(counts->talkgroups.find(call->get_talkgroup()).counter);
+}
+
+std::vector<System_Occupancy_Stats> Channel_Occupancy::snapshot() {
+  std::vector<System_Occupancy_Stats> stats;
+  std::int64_t now = Replay_Clock::now_ms();
+  double interval = (now - last_snapshot) / 1000.0;
+  last_snapshot = now;
+  time_t time = now / 1000;
+
+  for (std::vector<System_Counts>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    System_Counts &counts = *it;
+    if (!counts.channels.size()) {
+      continue;
+    }
+    System_Occupancy_Stats system;
+    system.short_name = counts.short_name;
+    system.time = time;
+    system.interval = interval;
+    system.counts.grants = counts.grants;
+    system.counts.airtime = 0;
+    system.counts.peak = counts.peak;
+    counts.grants = 0;
+    counts.peak = counts.active;
+
+    for (size_t i = 0; i < counts.channels.size(); i++) {
+      Slot &slot = counts.channels.at(i);
+      if ((!slot.used && !counts.channels.is_overflow(i)) || (!slot.counter.grants && !slot.counter.airtime_ms && !slot.counter.active)) {
+        continue;
+      }
+      Channel_Occupancy_Stats channel;
+      channel.freq = counts.channels.is_overflow(i) ? 0 : slot.key / 2;
+      channel.tdma_slot = counts.channels.is_overflow(i) ? 0 : slot.key % 2;
+      channel.counts = take_counter(slot.counter);
+      system.counts.airtime += channel.counts.airtime;
+      system.channels.push_back(channel);
+    }
+    for (size_t i = 0; i < counts.talkgroups.size(); i++) {
+      Slot &slot = counts.talkgroups.at(i);
+      if ((!slot.used && !counts.talkgroups.is_overflow(i)) || (!slot.counter.grants && !slot.counter.airtime_ms && !slot.counter.active)) {
+        continue;
+      }
+      Talkgroup_Occupancy_Stats talkgroup;
+      talkgroup.talkgroup = counts.talkgroups.is_overflow(i) ? -1 : slot.key;
+      talkgroup.counts = take_counter(slot.counter);
+      system.talkgroups.push_back(talkgroup);
+    }
+    stats.push_back(system);
+  }
+
+  if (file) {
+    for (std::vector<System_Occupancy_Stats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+      const System_Occupancy_Stats &system = *it;
+      fprintf(file, "%ld,%s,S,,,,%ld,%.1f,%d\n", (long)system.time, system.short_name.c_str(), system.counts.grants, system.counts.airtime, system.counts.peak);
+      for (std::vector<Channel_Occupancy_Stats>::const_iterator ch = system.channels.begin(); ch != system.channels.end(); ++ch) {
+        fprintf(file, "%ld,%s,C,%.0f,%d,,%ld,%.1f,%d\n", (long)system.time, system.short_name.c_str(), ch->freq, ch->tdma_slot, ch->counts.grants, ch->counts.airtime, ch->counts.peak);
+      }
+      for (std::vector<Talkgroup_Occupancy_Stats>::const_iterator tg = system.talkgroups.begin(); tg != system.talkgroups.end(); ++tg) {
+        fprintf(file, "%ld,%s,T,,,%ld,%ld,%.1f,%d\n", (long)system.time, system.short_name.c_str(), tg->talkgroup, tg->counts.grants, tg->counts.airtime, tg->counts.peak);
+      }
+    }
+    fflush(file);
+  }
+  return stats;
+}
@@ -0,0 +1,104 @@
+#ifndef CHANNEL_OCCUPANCY_H
+#define CHANNEL_OCCUPANCY_H
+
+#include "global_structs.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class Call;
+class System;
+
+/*
+ * Channel_Occupancy
+ *   How much each voice channel and talkgroup of the trunked systems is in
+ *   use, for sizing the recorders of a site: the grants, the airtime and
+ *   the most calls there were at once, over each interval.
+ *
+ * A Call is opened on its channel, its talkgroup and its System when it is
+ * made for a grant, seen each time a GRANT or UPDATE for it comes in and
+ * closed when it is erased from the calls vector. The airtime is how long
+ * the control channel had the channel or talkgroup in use: from the grant
+ * of a call to the last message for any call on it. The calls linger for
+ * callTimeout after the control channel has let them go, and a gap of more
+ * than a couple of seconds with no messages for any of them isn't counted.
+ *
+ * Each System gets tables with room for a fixed number of channels and
+ * talkgroups when Trunk Recorder starts, so the counting allocates nothing
+ * while calls come and go. Once a table is full the channels or talkgroups
+ * that don't fit are counted together, as freq 0 or talkgroup -1.
+ *
+ * snapshot() hands back what has been counted since the one before, only
+ * for the channels and talkgroups in use over it, and appends it to the
+ * occupancyFile as lines of
+ *
+ *   time,system,type,freq,slot,talkgroup,grants,airtime,peak
+ *
+ * where type is S for the whole System, C for a channel and T for a
+ * talkgroup. Everything is called from the main loop, under the lock the
+ * grants are handled with.
+ */
+class Channel_Occupancy {
+public:
+  static void open(const std::string &filename, const std::vector<System *> &systems);
+  static void close();
+
+  static void grant(Call *call);
+  static void update(Call *call);
+  static void release(Call *call);
+
+  static std::vector<System_Occupancy_Stats> snapshot();
+
+private:
+  struct Counter {
+    long grants;
+    std::int64_t airtime_ms;
+    int active;
+    int peak;
+    std::int64_t busy_since; // ms, while active
+    std::int64_t last_seen;
+  };
+
+  struct Slot {
+    bool used;
+    std::int64_t key;
+    Counter counter;
+  };
+
+  // Open addressing on the key, with the last slot for what doesn't fit
+  class Table {
+  public:
+    void resize(size_t size);
+    Slot &find(std::int64_t key);
+    size_t size() const { return slots.size(); }
+    Slot &at(size_t index) { return slots[index]; }
+    bool is_overflow(size_t index) const { return index == slots.size() - 1; }
+
+  private:
+    std::vector<Slot> slots;
+    size_t used;
+  };
+
+  struct System_Counts {
+    std::string short_name;
+    long grants;
+    int active;
+    int peak;
+    Table channels;
+    Table talkgroups;
+  };
+
+  static void open_counter(Counter &counter, std::int64_t now);
+  static void see_counter(Counter &counter, std::int64_t now);
+  static void close_counter(Counter &counter);
+  static Occupancy_Counts take_counter(Counter &counter);
+  static System_Counts *find_system(Call *call);
+
+  static std::vector<System_Counts> systems;
+  static std::int64_t last_snapshot;
+  static FILE *file;
+};
+
+#endif // CHANNEL_OCCUPANCY_H
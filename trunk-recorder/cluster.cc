@@ -0,0 +1,369 @@
+#include "cluster.h"
+#include "call.h"
+#include "formatter.h"
+#include "source.h"
+#include "systems/system.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Cluster::Role Cluster::role = Cluster::NONE;
+int Cluster::sock = -1;
+struct sockaddr_in Cluster::control_addr;
+std::vector<Cluster::Node> Cluster::nodes;
+std::map<long, size_t> Cluster::dispatched;
+long Cluster::no_node = 0;
+
+namespace {
+
+const std::uint32_t MAGIC = 0x5452434c; // "TRCL"
+const std::uint8_t VERSION = 1;
+
+const size_t HEADER_SIZE = 6;
+const size_t CALL_SIZE = HEADER_SIZE + 36;
+const size_t SOURCE_SIZE = 20;
+// A capacity report for every Source still fits in one Ethernet frame
+const size_t MAX_SOURCES = 64;
+const size_t MAX_DATAGRAM = 1500;
+
+const std::uint8_t FLAG_PHASE2 = 1;
+const std::uint8_t FLAG_ENCRYPTED = 2;
+const std::uint8_t FLAG_EMERGENCY = 4;
+
+void put(std::uint8_t *&p, std::uint64_t value, int bytes) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    *p++ = (value >> (8 * i)) & 0xff;
+  }
+}
+
+std::uint64_t get(const std::uint8_t *&p, int bytes) {
+  std::uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value = (value << 8) | *p++;
+  }
+  return value;
+}
+
+void put_header(std::uint8_t *&p, std::uint8_t type) {
+  put(p, MAGIC, 4);
+  put(p, VERSION, 1);
+  put(p, type, 1);
+}
+
+// host:port, to an IPv4 address
+bool resolve(const std::string &host_port, struct sockaddr_in &addr) {
+  size_t colon = host_port.rfind(':');
+  if ((colon == std::string::npos) || (colon == 0)) {
+    return false;
+  }
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  struct addrinfo *result = NULL;
+  if (getaddrinfo(host_port.substr(0, colon).c_str(), host_port.substr(colon + 1).c_str(), &hints, &result) != 0) {
+    return false;
+  }
+  memcpy(&addr, result->ai_addr, sizeof(addr));
+  freeaddrinfo(result);
+  return true;
+}
+
+bool same_addr(const struct sockaddr_in &a, const struct sockaddr_in &b) {
+  return (a.sin_addr.s_addr == b.sin_addr.s_addr) && (a.sin_port == b.sin_port);
+}
+
+std::string addr_name(const struct sockaddr_in &addr) {
+  char host[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+  return std::string(host) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+} // namespace
+
+bool Cluster::start(Config &config) {
+  if (config.cluster_role == "control") {
+    role = CONTROL;
+  } else if (config.cluster_role == "voice") {
+    role = VOICE;
+    if (!resolve(config.cluster_control, control_addr)) {
+      BOOST_LOG_TRIVIAL(error) << "Cluster: unable to resolve the control node's address: " << config.cluster_control;
+      return false;
+    }
+  } else {
+    return true;
+  }
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    BOOST_LOG_TRIVIAL(error) << "Cluster: unable to open a socket: " << strerror(errno);
+    return false;
+  }
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+  fcntl(sock, F_SETFD, FD_CLOEXEC);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(config.cluster_port);
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "Cluster: unable to listen on port " << config.cluster_port << ": " << strerror(errno);
+    close(sock);
+    sock = -1;
+    return false;
+  }
+
+  if (role == CONTROL) {
+    BOOST_LOG_TRIVIAL(info) << "Cluster: control node, waiting for voice nodes on port " << config.cluster_port;
+  } else {
+    BOOST_LOG_TRIVIAL(info) << "Cluster: voice node on port " << config.cluster_port << ", reporting to " << addr_name(control_addr);
+  }
+  return true;
+}
+
+void Cluster::stop() {
+  if (sock >= 0) {
+    close(sock);
+    sock = -1;
+  }
+  nodes.clear();
+  dispatched.clear();
+  role = NONE;
+}
+
+bool Cluster::dispatch(Call *call, const TrunkMessage &message, bool analog, int priority) {
+  if (role != CONTROL) {
+    return false;
+  }
+
+  time_t now = time(NULL);
+  std::int64_t freq = llround(call->get_freq());
+  int needed = std::max(1, priority);
+  size_t best = nodes.size();
+  Node_Source *best_source = NULL;
+  int best_free = 0;
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    Node &node = nodes[i];
+    if (difftime(now, node.last_report) > NODE_TIMEOUT) {
+      continue;
+    }
+    for (std::vector<Node_Source>::iterator it = node.sources.begin(); it != node.sources.end(); ++it) {
+      if ((it->min_hz > freq) || (it->max_hz < freq)) {
+        continue;
+      }
+      int available = analog ? it->free_analog : it->free_digital;
+      if ((available >= needed) && (available > best_free)) {
+        best = i;
+        best_source = &*it;
+        best_free = available;
+      }
+    }
+  }
+
+  std::string loghdr = log_header(call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+  if (!best_source) {
+    no_node++;
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mNo voice node has a free " << (analog ? "analog" : "digital") << " recorder for this Freq\u001b[0m";
+    return false;
+  }
+
+  // Taken until the node's next report says otherwise
+  if (analog) {
+    best_source->free_analog--;
+  } else {
+    best_source->free_digital--;
+  }
+  nodes[best].dispatched++;
+  dispatched[call->get_call_num()] = best;
+  send_call(nodes[best], GRANT_MESSAGE, call, message);
+  BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[32mSent to voice node " << nodes[best].name << "\u001b[0m";
+  return true;
+}
+
+void Cluster::update(Call *call, const TrunkMessage &message) {
+  if ((role != CONTROL) || dispatched.empty()) {
+    return;
+  }
+  std::map<long, size_t>::iterator it = dispatched.find(call->get_call_num());
+  if (it != dispatched.end()) {
+    send_call(nodes[it->second], UPDATE_MESSAGE, call, message);
+  }
+}
+
+void Cluster::release(Call *call) {
+  if (!dispatched.empty()) {
+    dispatched.erase(call->get_call_num());
+  }
+}
+
+void Cluster::send_call(const Node &node, Message_Type type, Call *call, const TrunkMessage &message) {
+  std::uint8_t buf[CALL_SIZE];
+  std::uint8_t *p = buf;
+  std::uint8_t flags = (message.phase2_tdma ? FLAG_PHASE2 : 0) | (message.encrypted ? FLAG_ENCRYPTED : 0) | (message.emergency ? FLAG_EMERGENCY : 0);
+
+  put_header(p, type);
+  put(p, (std::uint32_t)call->get_call_num(), 4);
+  put(p, (std::uint16_t)call->get_sys_num(), 2);
+  put(p, (std::uint8_t)message.tdma_slot, 1);
+  put(p, flags, 1);
+  put(p, (std::uint16_t)(std::int16_t)message.priority, 2);
+  put(p, (std::uint64_t)llround(message.freq), 8);
+  put(p, (std::uint64_t)(std::int64_t)message.talkgroup, 8);
+  put(p, (std::uint64_t)(std::int64_t)message.source, 8);
+
+  if (sendto(sock, buf, sizeof(buf), 0, (const struct sockaddr *)&node.addr, sizeof(node.addr)) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "Cluster: unable to send to voice node " << node.name << ": " << strerror(errno);
+  }
+}
+
+void Cluster::report(std::vector<Source *> &sources) {
+  if (role != VOICE) {
+    return;
+  }
+  std::uint8_t buf[HEADER_SIZE + 1 + MAX_SOURCES * SOURCE_SIZE];
+  std::uint8_t *p = buf;
+  size_t count = std::min(sources.size(), MAX_SOURCES);
+
+  put_header(p, CAPACITY_MESSAGE);
+  put(p, count, 1);
+  for (size_t i = 0; i < count; i++) {
+    Source *source = sources[i];
+    put(p, (std::uint64_t)llround(source->get_min_hz()), 8);
+    put(p, (std::uint64_t)llround(source->get_max_hz()), 8);
+    put(p, (std::uint16_t)std::max(0, source->get_num_available_digital_recorders()), 2);
+    put(p, (std::uint16_t)std::max(0, source->get_num_available_analog_recorders()), 2);
+  }
+
+  if (sendto(sock, buf, p - buf, 0, (const struct sockaddr *)&control_addr, sizeof(control_addr)) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "Cluster: unable to report to the control node: " << strerror(errno);
+  }
+}
+
+void Cluster::receive(std::vector<System *> &systems, Handler handler) {
+  std::uint8_t buf[MAX_DATAGRAM];
+  struct sockaddr_in from;
+
+  while (true) {
+    socklen_t from_len = sizeof(from);
+    ssize_t length = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    const std::uint8_t *p = buf;
+    if ((length < (ssize_t)HEADER_SIZE) || (get(p, 4) != MAGIC)) {
+      continue;
+    }
+    if (get(p, 1) != VERSION) {
+      BOOST_LOG_TRIVIAL(error) << "Cluster: a message from " << addr_name(from) << " is from a different version";
+      continue;
+    }
+    Message_Type type = (Message_Type)get(p, 1);
+
+    if ((role == CONTROL) && (type == CAPACITY_MESSAGE)) {
+      handle_capacity(from, p, length - HEADER_SIZE);
+    } else if ((role == VOICE) && ((type == GRANT_MESSAGE) || (type == UPDATE_MESSAGE)) && same_addr(from, control_addr)) {
+      handle_call(p, length - HEADER_SIZE, type, systems, handler);
+    }
+  }
+}
+
+void Cluster::handle_capacity(const struct sockaddr_in &from, const std::uint8_t *data, size_t length) {
+  if (length < 1) {
+    return;
+  }
+  size_t count = get(data, 1);
+  if (length < 1 + count * SOURCE_SIZE) {
+    return;
+  }
+
+  size_t index = 0;
+  while ((index < nodes.size()) && !same_addr(nodes[index].addr, from)) {
+    index++;
+  }
+  if (index == nodes.size()) {
+    Node node;
+    node.addr = from;
+    node.name = addr_name(from);
+    node.dispatched = 0;
+    nodes.push_back(node);
+    BOOST_LOG_TRIVIAL(info) << "Cluster: voice node " << node.name << " joined with " << count << " Sources";
+  } else if (difftime(time(NULL), nodes[index].last_report) > NODE_TIMEOUT) {
+    BOOST_LOG_TRIVIAL(info) << "Cluster: voice node " << nodes[index].name << " is back";
+  }
+
+  Node &node = nodes[index];
+  node.last_report = time(NULL);
+  node.sources.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    node.sources[i].min_hz = (std::int64_t)get(data, 8);
+    node.sources[i].max_hz = (std::int64_t)get(data, 8);
+    node.sources[i].free_digital = get(data, 2);
+    node.sources[i].free_analog = get(data, 2);
+  }
+}
+
+void Cluster::handle_call(const std::uint8_t *data, size_t length, Message_Type type, std::vector<System *> &systems, Handler handler) {
+  if (length < CALL_SIZE - HEADER_SIZE) {
+    return;
+  }
+  static std::vector<TrunkMessage> messages(1);
+  TrunkMessage &message = messages[0];
+  message = TrunkMessage();
+
+  long call_id = get(data, 4);
+  int sys_num = get(data, 2);
+  message.message_type = (type == GRANT_MESSAGE) ? GRANT : UPDATE;
+  message.sys_num = sys_num;
+  message.tdma_slot = get(data, 1);
+  std::uint8_t flags = get(data, 1);
+  message.phase2_tdma = flags & FLAG_PHASE2;
+  message.encrypted = flags & FLAG_ENCRYPTED;
+  message.emergency = flags & FLAG_EMERGENCY;
+  message.priority = (std::int16_t)get(data, 2);
+  message.freq = (double)(std::int64_t)get(data, 8);
+  message.talkgroup = (long)(std::int64_t)get(data, 8);
+  message.source = (long)(std::int64_t)get(data, 8);
+
+  for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    System *system = *it;
+    if (system->get_sys_num() == sys_num) {
+      if (type == GRANT_MESSAGE) {
+        BOOST_LOG_TRIVIAL(debug) << "[" << system->get_short_name() << "]\tGrant from the control node for its call " << call_id << "C, TG: " << message.talkgroup << " Freq: " << format_freq(message.freq);
+      }
+      handler(system, messages);
+      return;
+    }
+  }
+  BOOST_LOG_TRIVIAL(error) << "Cluster: the control node sent a call for System " << sys_num << ", which isn't configured here";
+}
+
+void Cluster::print_stats() {
+  if (role != CONTROL) {
+    return;
+  }
+  time_t now = time(NULL);
+  BOOST_LOG_TRIVIAL(info) << "Cluster: " << nodes.size() << " voice nodes, " << dispatched.size() << " calls on them now, " << no_node << " calls none had room for";
+  for (std::vector<Node>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+    int free_digital = 0;
+    int free_analog = 0;
+    for (std::vector<Node_Source>::iterator src_it = it->sources.begin(); src_it != it->sources.end(); ++src_it) {
+      free_digital += src_it->free_digital;
+      free_analog += src_it->free_analog;
+    }
+    BOOST_LOG_TRIVIAL(info) << "[" << it->name << "]\tSources: " << it->sources.size() << " Free Digital: " << free_digital << " Free Analog: " << free_analog << " Calls Sent: " << it->dispatched << " Last Report: " << (long)difftime(now, it->last_report) << "s ago";
+  }
+}
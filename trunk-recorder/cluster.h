@@ -0,0 +1,115 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "global_structs.h"
+#include "systems/parser.h"
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+class Call;
+class Source;
+class System;
+
+/*
+ * Cluster
+ *   Spreads the calls of the trunked Systems over more than one host, for
+ *   clusterRole "control" and "voice".
+ *
+ * The control node decodes the control channels and handles the grants.
+ * A call it has no Source or free recorder for is handed to a voice node
+ * instead: the voice nodes own the SDRs and recorders, and each one sends
+ * a capacity report every second with the range each of its Sources covers
+ * and the recorders each has free. The control node picks the voice node
+ * with the most free recorders of the call's type on a Source covering
+ * its channel, with at least as many free as the talkgroup's priority,
+ * the same rule as a local Source. It counts the recorder as taken until
+ * the node's next report, sends it the grant and monitors the call, and
+ * passes on the UPDATEs for the call until it ends.
+ *
+ * A voice node doesn't tune any control channels. The grants and UPDATEs
+ * it gets are handled as if its own Systems had decoded them, so the
+ * talkgroups, recording and uploads are all its own configuration. The
+ * Systems are matched by their number, so every node has to list them in
+ * the same order.
+ *
+ * The messages are UDP datagrams, with the integers in network byte order:
+ *
+ *   uint32 magic "TRCL", uint8 version, uint8 type, then for
+ *   GRANT and UPDATE:
+ *     uint32 call id, uint16 sys num, uint8 slot, uint8 flags,
+ *     int16 priority, int64 freq Hz, int64 talkgroup, int64 source unit
+ *   CAPACITY:
+ *     uint8 source count, then for each Source:
+ *     int64 min Hz, int64 max Hz, uint16 free digital, uint16 free analog
+ *
+ * Everything runs on the main loop, so it doesn't need a lock.
+ */
+class Cluster {
+public:
+  typedef std::function<void(System *, const std::vector<TrunkMessage> &)> Handler;
+
+  static bool start(Config &config);
+  static void stop();
+  static int get_fd() { return sock; }
+  static bool is_control() { return role == CONTROL; }
+  static bool is_voice() { return role == VOICE; }
+
+  // A control node handing calls to the voice nodes
+  static bool dispatch(Call *call, const TrunkMessage &message, bool analog, int priority);
+  static void update(Call *call, const TrunkMessage &message);
+  static void release(Call *call);
+
+  // A voice node telling the control node what it has free
+  static void report(std::vector<Source *> &sources);
+
+  // Takes in the datagrams waiting on the socket. Grants and UPDATEs are
+  // handed to handler, with the System they are for.
+  static void receive(std::vector<System *> &systems, Handler handler);
+  static void print_stats();
+
+private:
+  enum Role { NONE,
+              CONTROL,
+              VOICE };
+
+  enum Message_Type { GRANT_MESSAGE = 1,
+                      UPDATE_MESSAGE = 2,
+                      CAPACITY_MESSAGE = 3 };
+
+  struct Node_Source {
+    std::int64_t min_hz;
+    std::int64_t max_hz;
+    int free_digital; // less the grants sent since the report
+    int free_analog;
+  };
+
+  struct Node {
+    struct sockaddr_in addr;
+    std::string name; // address:port
+    time_t last_report;
+    std::vector<Node_Source> sources;
+    long dispatched;
+  };
+
+  // A voice node that hasn't reported in this long isn't handed calls
+  static const int NODE_TIMEOUT = 5;
+
+  static void send_call(const Node &node, Message_Type type, Call *call, const TrunkMessage &message);
+  static void handle_capacity(const struct sockaddr_in &from, const uint8_t *data, size_t length);
+  static void handle_call(const uint8_t *data, size_t length, Message_Type type, std::vector<System *> &systems, Handler handler);
+
+  static Role role;
+  static int sock;
+  static struct sockaddr_in control_addr;
+  static std::vector<Node> nodes;
+  static std::map<long, size_t> dispatched; // call num to index in nodes
+  static long no_node;                      // calls no voice node had room for
+};
+
+#endif // CLUSTER_H
@@ -4,6 +4,18 @@
  * Parameters: <#parameters#>
  */
 #include "./config.h"
+#include "config_validator.h"
+#include "cpu_dispatch.h"
+#include "flowgraph_profiler.h"
+#include "stage_latency.h"
+#include "state_checkpoint.h"
+#include "table_cache.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <thread>
 
 using json = nlohmann::json;
 
@@ -15,7 +27,16 @@ namespace sinks = boost::log::sinks;
 using namespace std;
 
 // Global log sink for SIGHUP rotation support
-boost::shared_ptr<sinks::synchronous_sink<sinks::text_file_backend>> global_log_sink;
+boost::shared_ptr<sinks::sink> global_log_sink;
+static boost::shared_ptr<sinks::sink> console_log_sink;
+
+// With logAsync each sink gets a thread of its own that takes the records off
+// a lock free queue, formats them and writes them out, so a GNU Radio work
+// thread that logs doesn't wait on the terminal or the disk
+typedef sinks::asynchronous_sink<sinks::text_ostream_backend, sinks::unbounded_fifo_queue> async_console_sink;
+typedef sinks::synchronous_sink<sinks::text_ostream_backend> sync_console_sink;
+typedef sinks::asynchronous_sink<sinks::text_file_backend, sinks::unbounded_fifo_queue> async_file_sink;
+typedef sinks::synchronous_sink<sinks::text_file_backend> sync_file_sink;
 
 void set_logging_level(std::string log_level) {
   boost::log::trivial::severity_level sev_level = boost::log::trivial::info;
@@ -46,53 +67,79 @@ struct NoColorLoggingFormatter {
     auto message = rec.attribute_values()[logging::aux::default_attribute_names::message()];
     auto message_str = message.extract<std::string>().get();
 
-    std::regex escape_seq_regex("\u001B\\[[0-9;]+m");
+    static const std::regex escape_seq_regex("\u001B\\[[0-9;]+m");
     strm << std::regex_replace(message_str, escape_seq_regex, "");
   }
 };
 
-void setup_console_log(std::string log_color, std::string time_fmt) {
-  boost::shared_ptr<sinks::synchronous_sink<sinks::basic_text_ostream_backend<char>>> console_sink = logging::add_console_log(std::clog);
+template <typename Sink>
+static boost::shared_ptr<Sink> add_log_sink(boost::shared_ptr<typename Sink::sink_backend_type> backend, bool color, std::string time_fmt) {
+  boost::shared_ptr<Sink> sink = boost::make_shared<Sink>(backend);
 
-  if ((log_color == "console") || (log_color == "all")) {
-    console_sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
-                                logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
-                                logging::expressions::attr<logging::trivial::severity_level>("Severity") %
-                                logging::expressions::smessage);
+  if (color) {
+    sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
+                        logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
+                        logging::expressions::attr<logging::trivial::severity_level>("Severity") %
+                        logging::expressions::smessage);
   } else {
-    console_sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
-                                logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
-                                logging::expressions::attr<logging::trivial::severity_level>("Severity") %
-                                logging::expressions::wrap_formatter(NoColorLoggingFormatter{}));
+    sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
+                        logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
+                        logging::expressions::attr<logging::trivial::severity_level>("Severity") %
+                        logging::expressions::wrap_formatter(NoColorLoggingFormatter{}));
   }
+  logging::core::get()->add_sink(sink);
+  return sink;
+}
+
+void setup_console_log(std::string log_color, std::string time_fmt, bool async) {
+  boost::shared_ptr<sinks::text_ostream_backend> backend = boost::make_shared<sinks::text_ostream_backend>();
+  backend->add_stream(boost::shared_ptr<std::ostream>(&std::clog, boost::null_deleter()));
+  bool color = (log_color == "console") || (log_color == "all");
 
-  std::locale loc = std::locale("C");
-  console_sink->imbue(loc);
+  if (async) {
+    boost::shared_ptr<async_console_sink> sink = add_log_sink<async_console_sink>(backend, color, time_fmt);
+    sink->imbue(std::locale("C"));
+    console_log_sink = sink;
+  } else {
+    boost::shared_ptr<sync_console_sink> sink = add_log_sink<sync_console_sink>(backend, color, time_fmt);
+    sink->imbue(std::locale("C"));
+    console_log_sink = sink;
+  }
 }
 
-void setup_file_log(std::string log_dir, std::string log_color, std::string time_fmt, bool syslog_friendly) {
+void setup_file_log(std::string log_dir, std::string log_color, std::string time_fmt, bool syslog_friendly, bool async) {
+  boost::shared_ptr<sinks::text_file_backend> backend;
   if (syslog_friendly) {
-    global_log_sink = logging::add_file_log(
+    backend = boost::make_shared<sinks::text_file_backend>(
         keywords::file_name = log_dir + "/trunk-recorder.log",
         keywords::auto_flush = true);
   } else {
-    global_log_sink = logging::add_file_log(
+    backend = boost::make_shared<sinks::text_file_backend>(
         keywords::file_name = log_dir + "/%m-%d-%Y_%H%M_%2N.log",
         keywords::rotation_size = 100 * 1024 * 1024,
         keywords::time_based_rotation = sinks::file::rotation_at_time_point(0, 0, 0),
         keywords::auto_flush = true);
   }
+  bool color = (log_color == "logfile") || (log_color == "all");
 
-  if ((log_color == "logfile") || (log_color == "all")) {
-    global_log_sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
-                            logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
-                            logging::expressions::attr<logging::trivial::severity_level>("Severity") %
-                            logging::expressions::smessage);
+  if (async) {
+    global_log_sink = add_log_sink<async_file_sink>(backend, color, time_fmt);
   } else {
-    global_log_sink->set_formatter(logging::expressions::format("[%1%] (%2%)   %3%") %
-                            logging::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", time_fmt) %
-                            logging::expressions::attr<logging::trivial::severity_level>("Severity") %
-                            logging::expressions::wrap_formatter(NoColorLoggingFormatter{}));
+    global_log_sink = add_log_sink<sync_file_sink>(backend, color, time_fmt);
+  }
+}
+
+// Writes out what the log threads haven't yet and stops them. Registered with
+// atexit() too, so an exit() on the way out doesn't lose the reason for it.
+void flush_logs() {
+  logging::core::get()->flush();
+  if (boost::shared_ptr<async_console_sink> sink = boost::dynamic_pointer_cast<async_console_sink>(console_log_sink)) {
+    sink->stop();
+    sink->flush();
+  }
+  if (boost::shared_ptr<async_file_sink> sink = boost::dynamic_pointer_cast<async_file_sink>(global_log_sink)) {
+    sink->stop();
+    sink->flush();
   }
 }
 
@@ -132,9 +179,14 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
 
     config.log_color = data.value("logColor", (color ? "console" : "none"));
 
+    config.log_async = data.value("logAsync", true);
+    if (config.log_async) {
+      std::atexit(flush_logs);
+    }
+
     config.console_log = data.value("consoleLog", true);
     if (config.console_log) {
-      setup_console_log(config.log_color, "%Y-%m-%d %H:%M:%S.%f");
+      setup_console_log(config.log_color, "%Y-%m-%d %H:%M:%S.%f", config.log_async);
     }
 
     BOOST_LOG_TRIVIAL(info) << "\n-------------------------------------\n     Trunk Recorder\n-------------------------------------\n";
@@ -145,7 +197,7 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
     config.log_dir = data.value("logDir", "logs");
     config.syslog_friendly = data.value("syslogFriendly", false);
     if (config.log_file) {
-      setup_file_log(config.log_dir, config.log_color, "%Y-%m-%d %H:%M:%S.%f", config.syslog_friendly);
+      setup_file_log(config.log_dir, config.log_color, "%Y-%m-%d %H:%M:%S.%f", config.syslog_friendly, config.log_async);
     }
 
     double config_ver = data.value("ver", 0.0);
@@ -157,13 +209,26 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
       return false;
     }
 
+    std::vector<std::string> config_errors;
+    if (!Config_Validator::validate(data, config_errors)) {
+      for (std::vector<std::string>::iterator it = config_errors.begin(); it != config_errors.end(); ++it) {
+        BOOST_LOG_TRIVIAL(error) << "Config: " << *it;
+      }
+      BOOST_LOG_TRIVIAL(error) << "Found " << config_errors.size() << " problem" << (config_errors.size() == 1 ? "" : "s") << " in " << config_file << ", fix them and start again";
+      return false;
+    }
+
     BOOST_LOG_TRIVIAL(info) << "Using Config file: " << config_file << "\n";
     BOOST_LOG_TRIVIAL(info) << PROJECT_NAME << ": "
                             << "Version: " << PROJECT_VER << "\n";
+#ifdef CPU_DISPATCH
+    BOOST_LOG_TRIVIAL(info) << "DSP loops built for: " << cpu_dispatch_level();
+#endif
 
     BOOST_LOG_TRIVIAL(info) << "Log to File: " << config.log_file;
     BOOST_LOG_TRIVIAL(info) << "Log Directory: " << config.log_dir;
     BOOST_LOG_TRIVIAL(info) << "Syslog Friendly Mode: " << config.syslog_friendly;
+    BOOST_LOG_TRIVIAL(info) << "Log on a Thread of its Own: " << config.log_async;
 
     std::string defaultTempDir = boost::filesystem::current_path().string();
 
@@ -179,8 +244,66 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
 
     BOOST_LOG_TRIVIAL(info) << "Temporary Transmission Directory: " << config.temp_dir;
 
+    config.wav_buffer_seconds = data.value("wavBufferSeconds", 10.0);
+    BOOST_LOG_TRIVIAL(info) << "Wav File Buffer: " << config.wav_buffer_seconds << " seconds";
+    config.wav_mmap = data.value("wavMmap", false);
+    BOOST_LOG_TRIVIAL(info) << "Memory Map Wav Files: " << config.wav_mmap;
+    config.memory_transmissions = data.value("memoryTransmissions", false);
+    BOOST_LOG_TRIVIAL(info) << "Keep Transmissions in Memory: " << config.memory_transmissions;
+    config.memory_spill_seconds = data.value("memorySpillSeconds", 30.0);
+    if (config.memory_transmissions) {
+      BOOST_LOG_TRIVIAL(info) << "Write Transmissions to Disk After: " << config.memory_spill_seconds << " seconds";
+    }
+    config.streaming_encoder = data.value("streamingEncoder", false);
+    BOOST_LOG_TRIVIAL(info) << "Compress Calls While Recording: " << config.streaming_encoder;
+    config.sigmf_format = data.value("sigmfFormat", "cf32");
+    if ((config.sigmf_format != "cf32") && (config.sigmf_format != "ci16")) {
+      BOOST_LOG_TRIVIAL(error) << "Unknown sigmfFormat: " << config.sigmf_format << ", it should be cf32 or ci16. Using cf32";
+      config.sigmf_format = "cf32";
+    }
+    config.sigmf_compression = data.value("sigmfCompression", "none");
+    if ((config.sigmf_compression != "none") && (config.sigmf_compression != "zstd")) {
+      BOOST_LOG_TRIVIAL(error) << "Unknown sigmfCompression: " << config.sigmf_compression << ", it should be none or zstd. Using none";
+      config.sigmf_compression = "none";
+    }
+    config.sigmf_direct_io = data.value("sigmfDirectIO", false);
+    BOOST_LOG_TRIVIAL(info) << "SigMF Recordings: " << config.sigmf_format << ", Compression: " << config.sigmf_compression << ", Direct I/O: " << config.sigmf_direct_io;
+    config.call_concluder_threads = data.value("callConcluderThreads", 0);
+    BOOST_LOG_TRIVIAL(info) << "Call Concluder Threads: " << (config.call_concluder_threads > 0 ? std::to_string(config.call_concluder_threads) : "auto");
+    config.upload_connections_per_host = data.value("uploadConnectionsPerHost", 4);
+    if (config.upload_connections_per_host < 1) {
+      BOOST_LOG_TRIVIAL(error) << "Invalid uploadConnectionsPerHost: " << config.upload_connections_per_host << ", it should be at least 1. Using 4";
+      config.upload_connections_per_host = 4;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Upload Connections per Host: " << config.upload_connections_per_host;
+    config.vocoder_threads = data.value("vocoderThreads", 0);
+    BOOST_LOG_TRIVIAL(info) << "Vocoder Threads: " << (config.vocoder_threads > 0 ? std::to_string(config.vocoder_threads) : "none, each recorder decodes its own audio");
+    config.backlog_max_seconds = data.value("backlogMaxSeconds", 0.0);
+    config.backlog_max_mb = data.value("backlogMaxMB", 0.0);
+    if ((config.backlog_max_seconds > 0) || (config.backlog_max_mb > 0)) {
+      BOOST_LOG_TRIVIAL(info) << "Shed Low Priority Calls at a Backlog of: " << config.backlog_max_seconds << " seconds or " << config.backlog_max_mb << " MB";
+    }
+    config.admission_cpu_budget = data.value("admissionCpuBudget", 0.0);
+    config.admission_defer_seconds = data.value("admissionDeferSeconds", 2.0);
+    if (config.admission_cpu_budget > 0) {
+      BOOST_LOG_TRIVIAL(info) << "Defer Low Priority Calls Over a CPU Budget of: " << config.admission_cpu_budget << "% for up to " << config.admission_defer_seconds << " seconds";
+    }
+
     config.archive_files_on_failure = data.value("archiveFilesOnFailure", false);
     BOOST_LOG_TRIVIAL(info) << "Archive Files on Failure: " << config.archive_files_on_failure;
+    config.archive_segments = data.value("archiveSegments", false);
+    config.archive_sync_seconds = data.value("archiveSyncSeconds", 5.0);
+    if (config.archive_segments) {
+      BOOST_LOG_TRIVIAL(info) << "Archive Calls to Hourly Segments, Synced Every: " << config.archive_sync_seconds << " seconds";
+    }
+    config.recent_calls_hours = data.value("recentCallsHours", 0.0);
+    if (config.recent_calls_hours > 0) {
+      BOOST_LOG_TRIVIAL(info) << "Recent Calls Kept For: " << config.recent_calls_hours << " hours";
+    }
+    config.retry_journal = data.value("retryJournal", true);
+    BOOST_LOG_TRIVIAL(info) << "Keep Upload Retries Across Restarts: " << config.retry_journal;
+    config.retry_rate = data.value("retryRate", 5.0);
+    BOOST_LOG_TRIVIAL(info) << "Upload Retries per Second: " << config.retry_rate;
 
     config.capture_dir = data.value("captureDir", boost::filesystem::current_path().string());
     pos = config.capture_dir.find_last_of("/");
@@ -196,6 +319,18 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
     BOOST_LOG_TRIVIAL(info) << "Broadcastify Calls Server: " << config.bcfy_calls_server;
     config.status_server = data.value("statusServer", "");
     BOOST_LOG_TRIVIAL(info) << "Status Server: " << config.status_server;
+    config.status_calls_delta = data.value("statusCallsDelta", false);
+    if (config.status_calls_delta) {
+      BOOST_LOG_TRIVIAL(info) << "Status Server Calls Delta: " << config.status_calls_delta;
+    }
+    config.status_format = data.value("statusFormat", "json");
+    if ((config.status_format != "json") && (config.status_format != "cbor") && (config.status_format != "msgpack")) {
+      BOOST_LOG_TRIVIAL(error) << "Unknown statusFormat: " << config.status_format << ", it should be json, cbor or msgpack. Using json";
+      config.status_format = "json";
+    }
+    BOOST_LOG_TRIVIAL(info) << "Status Server Format: " << config.status_format;
+    config.status_send_buffer = data.value("statusSendBuffer", 1048576);
+    BOOST_LOG_TRIVIAL(info) << "Status Server Send Buffer (bytes): " << config.status_send_buffer;
     config.instance_key = data.value("instanceKey", "");
     BOOST_LOG_TRIVIAL(info) << "Instance Key: " << config.instance_key;
     config.instance_id = data.value("instanceId", "");
@@ -210,10 +345,99 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
     BOOST_LOG_TRIVIAL(info) << "Control channel warning rate: " << config.control_message_warn_rate;
     config.control_retune_limit = data.value("controlRetuneLimit", 0);
     BOOST_LOG_TRIVIAL(info) << "Control channel retune limit: " << config.control_retune_limit;
+    config.source_reopen_limit = data.value("sourceReopenLimit", 5);
+    BOOST_LOG_TRIVIAL(info) << "Source reopen limit: " << config.source_reopen_limit;
+    config.control_channel_hunt = data.value("controlChannelHunt", true);
+    BOOST_LOG_TRIVIAL(info) << "Control channel hunt: " << config.control_channel_hunt;
     config.soft_vocoder = data.value("softVocoder", false);
     BOOST_LOG_TRIVIAL(info) << "Phase 1 Software Vocoder: " << config.soft_vocoder;
     config.enable_audio_streaming = data.value("audioStreaming", false);
     BOOST_LOG_TRIVIAL(info) << "Enable Audio Streaming: " << config.enable_audio_streaming;
+    config.system_workers = data.value("systemWorkers", false);
+    BOOST_LOG_TRIVIAL(info) << "System Workers: " << config.system_workers;
+    config.cluster_role = data.value("clusterRole", "");
+    config.cluster_port = data.value("clusterPort", 5750);
+    config.cluster_control = data.value("clusterControl", "");
+    if (config.cluster_role != "") {
+      BOOST_LOG_TRIVIAL(info) << "Cluster Role: " << config.cluster_role << " Port: " << config.cluster_port;
+    }
+    config.control_api_port = data.value("controlApiPort", 0);
+    config.control_api_address = data.value("controlApiAddress", "127.0.0.1");
+    if (config.control_api_port > 0) {
+      BOOST_LOG_TRIVIAL(info) << "Control API: " << config.control_api_address << ":" << config.control_api_port;
+    }
+    config.multi_site_window = data.value("multiSiteWindow", 1.0);
+    BOOST_LOG_TRIVIAL(info) << "Multi-Site Window (seconds): " << config.multi_site_window;
+    config.control_channel_capture = data.value("controlChannelCapture", "");
+    if (config.control_channel_capture != "") {
+      BOOST_LOG_TRIVIAL(info) << "Control Channel Capture: " << config.control_channel_capture;
+    }
+    config.table_cache_dir = data.value("tableCacheDir", "");
+    if (config.table_cache_dir != "") {
+      BOOST_LOG_TRIVIAL(info) << "Table Cache Directory: " << config.table_cache_dir;
+    }
+    Table_Cache::set_directory(config.table_cache_dir);
+    config.state_checkpoint_dir = data.value("stateCheckpointDir", "");
+    config.state_checkpoint_interval = data.value("stateCheckpointInterval", 60);
+    if (config.state_checkpoint_dir != "") {
+      BOOST_LOG_TRIVIAL(info) << "State Checkpoint Directory: " << config.state_checkpoint_dir << " Interval: " << config.state_checkpoint_interval;
+    }
+    State_Checkpoint::set_directory(config.state_checkpoint_dir);
+    State_Checkpoint::set_interval(config.state_checkpoint_interval);
+    config.parallel_source_startup = data.value("parallelSourceStartup", true);
+    BOOST_LOG_TRIVIAL(info) << "Open Sources in Parallel: " << config.parallel_source_startup;
+    config.single_branch_recorders = data.value("singleBranchRecorders", false);
+    BOOST_LOG_TRIVIAL(info) << "Single Branch Digital Recorders: " << config.single_branch_recorders;
+    config.fused_analog_audio = data.value("fusedAnalogAudio", false);
+    BOOST_LOG_TRIVIAL(info) << "Fused Analog Audio Chain: " << config.fused_analog_audio;
+    config.share_tdma_slots = data.value("shareTdmaSlots", false);
+    BOOST_LOG_TRIVIAL(info) << "Share TDMA Slots: " << config.share_tdma_slots;
+    config.preempt_calls = data.value("preemptCalls", false);
+    BOOST_LOG_TRIVIAL(info) << "Preempt Calls: " << config.preempt_calls;
+    config.recorder_thread_model = data.value("recorderThreadModel", "block");
+    if ((config.recorder_thread_model != "block") && (config.recorder_thread_model != "recorder")) {
+      BOOST_LOG_TRIVIAL(error) << "Unknown recorderThreadModel: " << config.recorder_thread_model << ", it should be block or recorder. Using block";
+      config.recorder_thread_model = "block";
+    }
+    BOOST_LOG_TRIVIAL(info) << "Recorder Thread Model: " << config.recorder_thread_model;
+    config.recorder_cpu_stats = data.value("recorderCpuStats", false);
+    BOOST_LOG_TRIVIAL(info) << "Recorder CPU Stats: " << config.recorder_cpu_stats;
+    if (config.recorder_cpu_stats) {
+      // Before the flowgraph is built, the counters are set up with the blocks
+      Flowgraph_Profiler::enable_counters();
+    }
+    config.latency_tracing = data.value("latencyTracing", false);
+    BOOST_LOG_TRIVIAL(info) << "Latency Tracing: " << config.latency_tracing;
+    if (config.latency_tracing) {
+      // Before the recorders are built, so they are built with the probes
+      Stage_Latency::enable();
+    }
+    config.trace_file = data.value("traceFile", "");
+    BOOST_LOG_TRIVIAL(info) << "Trace File: " << config.trace_file;
+    config.tone_scan = data.value("toneScan", false);
+    BOOST_LOG_TRIVIAL(info) << "Tone Scan: " << config.tone_scan;
+    config.tone_scan_interval = data.value("toneScanInterval", 60);
+    if (config.tone_scan) {
+      BOOST_LOG_TRIVIAL(info) << "Tone Scan Interval: " << config.tone_scan_interval;
+    }
+    config.occupancy_file = data.value("occupancyFile", "");
+    BOOST_LOG_TRIVIAL(info) << "Channel Occupancy File: " << config.occupancy_file;
+    config.occupancy_interval = data.value("occupancyInterval", 60);
+    BOOST_LOG_TRIVIAL(info) << "Channel Occupancy Interval: " << config.occupancy_interval;
+    config.unit_activity_file = data.value("unitActivityFile", "");
+    config.unit_activity_mb = data.value("unitActivityMb", 256);
+    if (config.unit_activity_file != "") {
+      BOOST_LOG_TRIVIAL(info) << "Unit Activity File: " << config.unit_activity_file << " up to " << config.unit_activity_mb << " MB";
+    }
+    config.recorder_buffer_items.clear();
+    if (data.contains("recorderBufferItems")) {
+      for (auto it = data["recorderBufferItems"].begin(); it != data["recorderBufferItems"].end(); ++it) {
+        config.recorder_buffer_items[it.key()] = it.value();
+        BOOST_LOG_TRIVIAL(info) << "Recorder Buffer Items: " << it.key() << " " << config.recorder_buffer_items[it.key()];
+      }
+    }
+    config.decoder_thread = data.value("decoderThread", false);
+    BOOST_LOG_TRIVIAL(info) << "Signal Decoder Thread: " << config.decoder_thread;
     config.record_uu_v_calls = data.value("recordUUVCalls", true);
     BOOST_LOG_TRIVIAL(info) << "Record Unit to Unit Voice Calls: " << config.record_uu_v_calls;
     config.new_call_from_update = data.value("newCallFromUpdate", true);
@@ -242,6 +466,14 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
     config.debug_recorder = data.value("debugRecorder", 0);
     config.debug_recorder_address = data.value("debugRecorderAddress", "127.0.0.1");
     config.debug_recorder_port = data.value("debugRecorderPort", 1234);
+    config.debug_recorder_payload = data.value("debugRecorderPayload", 1472);
+    config.debug_recorder_format = data.value("debugRecorderFormat", "cf32");
+    if ((config.debug_recorder_format != "cf32") && (config.debug_recorder_format != "ci16")) {
+      BOOST_LOG_TRIVIAL(error) << "Unknown debugRecorderFormat: " << config.debug_recorder_format << ", it should be cf32 or ci16. Using cf32";
+      config.debug_recorder_format = "cf32";
+    }
+    config.debug_recorder_seq_num = data.value("debugRecorderSeqNum", false);
+    config.debug_recorder_zerocopy = data.value("debugRecorderZeroCopy", false);
 
     BOOST_LOG_TRIVIAL(info) << "\n-------------------------------------\nSYSTEMS\n-------------------------------------\n";
 
@@ -285,7 +517,10 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
           } else if (channel_file_exist) {
             std::string channel_file = element["channelFile"];
             BOOST_LOG_TRIVIAL(info) << "Channel File: " << channel_file;
-            system->set_channel_file(channel_file);
+            {
+              Flowgraph_Profiler::Phase_Timer csv_timer(STARTUP_CSV_LOAD);
+              system->set_channel_file(channel_file);
+            }
           } else {
             BOOST_LOG_TRIVIAL(error) << "Either \"channels\" or \"channelFile\" need to be defined for a conventional system!";
             return false;
@@ -300,7 +535,10 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
           for (unsigned int i = 0; i < control_channels.size(); i++) {
             BOOST_LOG_TRIVIAL(info) << "  " << format_freq(control_channels[i]);
           }
-          system->set_talkgroups_file(element.value("talkgroupsFile", ""));
+          {
+            Flowgraph_Profiler::Phase_Timer csv_timer(STARTUP_CSV_LOAD);
+            system->set_talkgroups_file(element.value("talkgroupsFile", ""));
+          }
           BOOST_LOG_TRIVIAL(info) << "Talkgroups File: " << system->get_talkgroups_file();
 
           bool custom_freq_table_file_exists = element.contains("customFrequencyTableFile");
@@ -373,7 +611,10 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
         BOOST_LOG_TRIVIAL(info) << "Audio Archive: " << system->get_audio_archive();
         system->set_transmission_archive(element.value("transmissionArchive", false));
         BOOST_LOG_TRIVIAL(info) << "Transmission Archive: " << system->get_transmission_archive();
-        system->set_unit_tags_file(element.value("unitTagsFile", ""));
+        {
+          Flowgraph_Profiler::Phase_Timer csv_timer(STARTUP_CSV_LOAD);
+          system->set_unit_tags_file(element.value("unitTagsFile", ""));
+        }
         BOOST_LOG_TRIVIAL(info) << "Unit Tags File: " << system->get_unit_tags_file();
         system->set_unit_tags_ota_file(element.value("unitTagsOTA", ""));
         BOOST_LOG_TRIVIAL(info) << "Unit Tags OTA File: " << system->get_unit_tags_ota_file();
@@ -391,6 +632,18 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
         BOOST_LOG_TRIVIAL(info) << "Decode TPS: " << system->get_tps_enabled();
         system->set_dcs_enabled(element.value("decodeDCS", false));
         BOOST_LOG_TRIVIAL(info) << "Decode DCS: " << system->get_dcs_enabled();
+        system->set_signal_decoder_names(element.value("signalDecoders", std::vector<std::string>()));
+        BOOST_LOG_TRIVIAL(info) << "Signal Decoders: " << boost::algorithm::join(system->get_signal_decoder_names(), ", ");
+        system->set_tone_squelch_gate(element.value("toneSquelchGate", false));
+        BOOST_LOG_TRIVIAL(info) << "Tone Squelch Gate: " << system->get_tone_squelch_gate();
+        system->set_low_latency(element.value("lowLatency", false));
+        BOOST_LOG_TRIVIAL(info) << "Low Latency Recorders: " << system->get_low_latency();
+        system->set_control_channel_only(element.value("controlChannelOnly", false));
+        BOOST_LOG_TRIVIAL(info) << "Control Channel Only: " << system->get_control_channel_only();
+        system->set_pre_tune_recorders(element.value("preTuneRecorders", 0));
+        if (system->get_pre_tune_recorders() > 0) {
+          BOOST_LOG_TRIVIAL(info) << "Pre-Tune Recorders: " << system->get_pre_tune_recorders();
+        }
         std::string talkgroup_display_format_string = element.value("talkgroupDisplayFormat", "Id");
         if (boost::iequals(talkgroup_display_format_string, "id_tag")) {
           system->set_talkgroup_display_format(talkGroupDisplayFormat_id_tag);
@@ -440,6 +693,24 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
         BOOST_LOG_TRIVIAL(info) << "Maximum Call Duration (in seconds): " << system->get_max_duration();
         system->set_min_tx_duration(element.value("minTransmissionDuration", 0.0));
         BOOST_LOG_TRIVIAL(info) << "Minimum Transmission Duration (in seconds): " << system->get_min_tx_duration();
+        system->set_max_silence(element.value("maxSilence", 0.0));
+        system->set_silence_level(element.value("silenceLevel", system->get_silence_level()));
+        if (system->get_max_silence() > 0) {
+          BOOST_LOG_TRIVIAL(info) << "Maximum Silence (in seconds): " << system->get_max_silence() << " below level: " << system->get_silence_level();
+        }
+        system->set_admission_priority(element.value("admissionPriority", system->get_admission_priority()));
+        if (config.admission_cpu_budget > 0) {
+          BOOST_LOG_TRIVIAL(info) << "Always Record Talkgroups up to Priority: " << system->get_admission_priority();
+        }
+        system->set_control_iq_ring_seconds(element.value("controlIqRingSeconds", 0.0));
+        system->set_control_iq_dump_rate(element.value("controlIqDumpRate", system->get_control_iq_dump_rate()));
+        if (system->get_control_iq_ring_seconds() > 0) {
+          BOOST_LOG_TRIVIAL(info) << "Control Channel IQ Ring: " << system->get_control_iq_ring_seconds() << " seconds, saved below " << system->get_control_iq_dump_rate() << " msg/sec";
+        }
+        if ((system->get_system_type() == "conventionalP25") || (system->get_system_type() == "conventionalDMR")) {
+          system->set_sync_wake(element.value("syncWake", false));
+          BOOST_LOG_TRIVIAL(info) << "Decode Only After a Frame Sync: " << system->get_sync_wake();
+        }
         system->set_multiSite(element.value("multiSite", false));
         BOOST_LOG_TRIVIAL(info) << "Multiple Site System: " << system->get_multiSite();
         system->set_multiSiteSystemName(element.value("multiSiteSystemName", ""));
@@ -463,29 +734,121 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
       }
     }
 
+    // When every system only follows its control channel, nothing is ever
+    // recorded, so the Sources are left without voice recorders
+    bool control_channel_only = !systems.empty();
+    for (std::vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
+      control_channel_only = control_channel_only && (*sys_it)->get_control_channel_only();
+    }
+
+    // A single branch P25 recorder is built for the modulation most of the
+    // P25 systems use, and adds the other one if it is ever needed
+    int qpsk_systems = 0;
+    int fsk4_systems = 0;
+    for (std::vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
+      if (((*sys_it)->get_system_type() == "p25") || ((*sys_it)->get_system_type() == "conventionalP25")) {
+        if ((*sys_it)->get_qpsk_mod()) {
+          qpsk_systems++;
+        } else {
+          fsk4_systems++;
+        }
+      }
+    }
+    config.digital_recorder_qpsk = (qpsk_systems >= fsk4_systems);
+    if (config.single_branch_recorders) {
+      BOOST_LOG_TRIVIAL(info) << "Digital Recorders will be built for " << (config.digital_recorder_qpsk ? "QPSK" : "FSK4") << (qpsk_systems && fsk4_systems ? ", the other modulation is added to a recorder the first time it needs it" : "");
+    }
+
     BOOST_LOG_TRIVIAL(info) << "\n\n-------------------------------------\nSOURCES\n-------------------------------------\n";
+    // Opening an SDR and probing its gains can take seconds, so each Source
+    // is opened on its own thread once its settings have been read. Its
+    // recorders are made afterwards, one Source at a time, since they are
+    // connected to the top_block as they are made.
+    struct Source_Setup {
+      std::function<Source *()> open;
+      int digital_recorders;
+      int analog_recorders;
+      int sigmf_recorders;
+      int warm_digital_recorders;
+      int warm_analog_recorders;
+      int recorder_low_watermark;
+      Source *source;
+    };
+    std::vector<Source_Setup> source_setups;
+    // File sources with the same replayGroup, and the streams of a SigMF
+    // collection, are replayed in lockstep
+    std::map<std::string, Replay_Lockstep::sptr> replay_groups;
+
     for (json element : data["sources"]) {
 
       bool source_enabled = element.value("enabled", true);
       if (source_enabled) {
-        Source *source;
-        bool gain_set = false;
+        std::vector<std::function<Source *()>> open_sources;
         std::string driver = element.value("driver", "");
 
-        if ((driver != "osmosdr") && (driver != "usrp") && (driver != "sigmf") && (driver != "iqfile")) {
-          BOOST_LOG_TRIVIAL(error) << "Driver specified in config.json not recognized, needs to be osmosdr, sigmf, iqfile or usrp";
+        if ((driver != "osmosdr") && (driver != "usrp") && (driver != "sigmf") && (driver != "iqfile") && (driver != "shm")) {
+          BOOST_LOG_TRIVIAL(error) << "Driver specified in config.json not recognized, needs to be osmosdr, sigmf, iqfile, shm or usrp";
           return false;
         }
 
         int digital_recorders = element.value("digitalRecorders", 0);
         int sigmf_recorders = element.value("sigmfRecorders", 0);
         int analog_recorders = element.value("analogRecorders", 0);
+        int warm_digital_recorders = element.value("warmDigitalRecorders", -1);
+        int warm_analog_recorders = element.value("warmAnalogRecorders", -1);
+        int recorder_low_watermark = element.value("recorderLowWatermark", 1);
+        if (control_channel_only && (digital_recorders || analog_recorders)) {
+          BOOST_LOG_TRIVIAL(info) << "Every System is Control Channel Only, not making the Digital or Analog Recorders";
+          digital_recorders = 0;
+          analog_recorders = 0;
+        }
+
+        Replay_Lockstep::sptr lockstep;
+        std::string replay_group = element.value("replayGroup", "");
+        if ((replay_group != "") && ((driver == "sigmf") || (driver == "iqfile"))) {
+          BOOST_LOG_TRIVIAL(info) << "Replay Group: " << replay_group;
+          Replay_Lockstep::sptr &group = replay_groups[replay_group];
+          if (!group) {
+            group = std::make_shared<Replay_Lockstep>();
+          }
+          lockstep = group;
+        }
 
         if (driver == "sigmf") {
           string sigmf_data = element.value("sigmfData", "");
           string sigmf_meta = element.value("sigmfMeta", "");
+          string sigmf_collection = element.value("sigmfCollection", "");
           bool repeat = element.value("repeat", false);
-          source = new Source(sigmf_meta, sigmf_data, repeat, &config);
+          double replay_speed = element.value("replaySpeed", 1.0);
+          BOOST_LOG_TRIVIAL(info) << "Replay Speed: " << replay_speed;
+          if (sigmf_collection != "") {
+            // A Source for each recording in the collection, all with the
+            // recorders this one is given
+            json collection;
+            try {
+              std::ifstream f(sigmf_collection);
+              collection = json::parse(f);
+            } catch (const json::parse_error &e) {
+              BOOST_LOG_TRIVIAL(error) << "Unable to parse SigMF Collection " << sigmf_collection << ": " << e.what();
+              return false;
+            }
+            json streams = collection["collection"].value("core:streams", json::array());
+            if (streams.empty()) {
+              BOOST_LOG_TRIVIAL(error) << "SigMF Collection " << sigmf_collection << " has no core:streams";
+              return false;
+            }
+            if (!lockstep) {
+              lockstep = std::make_shared<Replay_Lockstep>();
+            }
+            boost::filesystem::path dir = boost::filesystem::path(sigmf_collection).parent_path();
+            BOOST_LOG_TRIVIAL(info) << "SigMF Collection: " << sigmf_collection << " Streams: " << streams.size();
+            for (json stream : streams) {
+              std::string stream_meta = (dir / (stream.value("name", "") + ".sigmf-meta")).string();
+              open_sources.push_back([stream_meta, repeat, replay_speed, lockstep, &config]() { return new Source(stream_meta, "", repeat, replay_speed, lockstep, &config); });
+            }
+          } else {
+            open_sources.push_back([sigmf_meta, sigmf_data, repeat, replay_speed, lockstep, &config]() { return new Source(sigmf_meta, sigmf_data, repeat, replay_speed, lockstep, &config); });
+          }
         } else if (driver == "iqfile") {
           string iq_file = element.value("iqFile", "");
           string iq_type = element.value("iqType", "");
@@ -496,7 +859,9 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
             BOOST_LOG_TRIVIAL(error) << "IQ Type specified in config.json not recognized, needs to be complex or float";
             return false;
           }
-          source = new Source(iq_file, center, rate, repeat, &config);
+          double replay_speed = element.value("replaySpeed", 1.0);
+          BOOST_LOG_TRIVIAL(info) << "Replay Speed: " << replay_speed;
+          open_sources.push_back([iq_file, center, rate, repeat, replay_speed, lockstep, &config]() { return new Source(iq_file, repeat, center, rate, replay_speed, lockstep, &config); });
         } else {
 
           std::string device = element.value("device", "");
@@ -509,6 +874,19 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
           double error = element.value("error", 0.0);
           double ppm = element.value("ppm", 0.0);
           bool autotune = element.value("autoTune", false);
+          std::string channelizer = element.value("channelizer", "xlat");
+          double pfb_channel_spacing = element.value("pfbChannelSpacing", 12500.0);
+          double tile_width = element.value("tileWidth", 1000000.0);
+          int fft_threads = element.value("fftThreads", 1);
+          int analog_fft_threads = element.value("analogFftThreads", 0);
+          int digital_fft_threads = element.value("digitalFftThreads", 0);
+          std::string wire_format = element.value("wireFormat", "");
+          std::string host_format = element.value("hostFormat", "fc32");
+          int host_decimation = element.value("hostDecimation", 1);
+          std::string shm_ring = element.value("shmRing", "");
+          int shm_ring_blocks = element.value("shmRingBlocks", 512);
+          double iq_ring_seconds = element.value("iqRingSeconds", 0.0);
+          bool low_latency = element.value("lowLatency", false);
           bool agc = element.value("agc", false);
           double gain = element.value("gain", 0.0);
           double if_gain = element.value("ifGain", 0.0);
@@ -529,6 +907,28 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
           BOOST_LOG_TRIVIAL(info) << "Error: " << element.value("error", 0.0);
           BOOST_LOG_TRIVIAL(info) << "PPM Error: " << element.value("ppm", 0.0);
           BOOST_LOG_TRIVIAL(info) << "P25 Autotune: " << element.value("autoTune", false);
+          BOOST_LOG_TRIVIAL(info) << "Channelizer: " << channelizer;
+          if ((channelizer == "pfb") || (channelizer == "fft")) {
+            BOOST_LOG_TRIVIAL(info) << "PFB Channel Spacing: " << pfb_channel_spacing;
+          }
+          if (channelizer == "tile") {
+            BOOST_LOG_TRIVIAL(info) << "Tile Width: " << FormatSamplingRate(tile_width);
+          }
+          BOOST_LOG_TRIVIAL(info) << "FFT Threads: " << fft_threads << " Analog: " << (analog_fft_threads ? analog_fft_threads : fft_threads) << " Digital: " << (digital_fft_threads ? digital_fft_threads : fft_threads);
+          if (wire_format != "") {
+            BOOST_LOG_TRIVIAL(info) << "Wire Format: " << wire_format;
+          }
+          BOOST_LOG_TRIVIAL(info) << "Host Format: " << host_format;
+          if (host_format == "sc16") {
+            BOOST_LOG_TRIVIAL(info) << "Host Decimation: " << host_decimation;
+          }
+          if (shm_ring != "") {
+            BOOST_LOG_TRIVIAL(info) << "Shared Memory Ring: " << shm_ring << " Blocks: " << shm_ring_blocks;
+          }
+          if (iq_ring_seconds > 0) {
+            BOOST_LOG_TRIVIAL(info) << "IQ Ring per Recorder: " << iq_ring_seconds << " seconds";
+          }
+          BOOST_LOG_TRIVIAL(info) << "Low Latency Recorders: " << low_latency;
           BOOST_LOG_TRIVIAL(info) << "Auto gain control: " << element.value("agc", false);
           BOOST_LOG_TRIVIAL(info) << "Gain: " << element.value("gain", 0.0);
           BOOST_LOG_TRIVIAL(info) << "IF Gain: " << element.value("ifGain", 0.0);
@@ -552,112 +952,187 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
             BOOST_LOG_TRIVIAL(info) << "Both PPM and Error should not be set at the same time. Setting Error to 0.";
             error = 0;
           }
-          source = new Source(center, rate, error, driver, device, &config);
-
-          // SoapySDRPlay3 quirk: autogain must be disabled before any of the gains can be set
-          if (source->get_device().find("sdrplay") != std::string::npos) {
-            source->set_gain_mode(agc);
+          if ((host_format != "fc32") && (host_format != "sc16")) {
+            BOOST_LOG_TRIVIAL(error) << "Host Format specified in config.json not recognized, needs to be fc32 or sc16";
+            return false;
           }
-
-          if (element.contains("signalDetectorThreshold")) {
-            source->set_signal_detector_threshold(element["signalDetectorThreshold"]);
+          if ((wire_format != "") && (wire_format != "sc16") && (wire_format != "sc12") && (wire_format != "sc8")) {
+            BOOST_LOG_TRIVIAL(error) << "Wire Format specified in config.json not recognized, needs to be sc16, sc12 or sc8";
+            return false;
           }
+          open_sources.push_back([=, &config]() {
+            Source *source = new Source(center, rate, error, driver, device, wire_format, host_format, host_decimation, &config);
+            bool gain_set = false;
 
-          source->set_autotune_source(autotune);
+            // SoapySDRPlay3 quirk: autogain must be disabled before any of the gains can be set
+            if (source->get_device().find("sdrplay") != std::string::npos) {
+              source->set_gain_mode(agc);
+            }
 
-          if (element.contains("gainSettings")) {
-            for (auto it = element["gainSettings"].begin(); it != element["gainSettings"].end(); ++it) {
+            if (element.contains("signalDetectorThreshold")) {
+              source->set_signal_detector_threshold(element["signalDetectorThreshold"]);
+            }
+            if (element.contains("signalDetectorRate")) {
+              source->set_signal_detector_rate(element["signalDetectorRate"]);
+            }
 
-              source->set_gain_by_name(it.key(), it.value());
-              gain_set = true;
+            source->set_autotune_source(autotune);
+            source->set_channelizer(channelizer, pfb_channel_spacing, tile_width);
+            source->set_fft_threads(fft_threads, analog_fft_threads, digital_fft_threads);
+            source->set_shm_ring(shm_ring, shm_ring_blocks);
+            source->set_iq_ring_seconds(iq_ring_seconds);
+            source->set_low_latency(low_latency);
+
+            if (element.contains("cpuAffinity")) {
+              source->set_cpu_affinity(element["cpuAffinity"].get<std::vector<int>>());
+            } else if (element.contains("numaNode")) {
+              source->set_numa_node(element["numaNode"]);
             }
-          }
 
-          if (if_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("IF", if_gain);
-          }
+            if (element.contains("gainSettings")) {
+              for (auto it = element["gainSettings"].begin(); it != element["gainSettings"].end(); ++it) {
 
-          if (bb_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("BB", bb_gain);
-          }
+                source->set_gain_by_name(it.key(), it.value());
+                gain_set = true;
+              }
+            }
 
-          if (mix_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("MIX", mix_gain);
-          }
+            if (if_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("IF", if_gain);
+            }
 
-          if (lna_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("LNA", lna_gain);
-          }
+            if (bb_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("BB", bb_gain);
+            }
 
-          if (tia_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("TIA", tia_gain);
-          }
+            if (mix_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("MIX", mix_gain);
+            }
 
-          if (pga_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("PGA", pga_gain);
-          }
+            if (lna_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("LNA", lna_gain);
+            }
 
-          if (amp_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("AMP", amp_gain);
-          }
+            if (tia_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("TIA", tia_gain);
+            }
 
-          if (vga_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("VGA", vga_gain);
-          }
+            if (pga_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("PGA", pga_gain);
+            }
 
-          if (vga1_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("VGA1", vga1_gain);
-          }
+            if (amp_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("AMP", amp_gain);
+            }
 
-          if (vga2_gain != 0) {
-            gain_set = true;
-            source->set_gain_by_name("VGA2", vga2_gain);
-          }
+            if (vga_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("VGA", vga_gain);
+            }
 
-          if (gain != 0) {
-            gain_set = true;
-            source->set_gain(gain);
-          }
+            if (vga1_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("VGA1", vga1_gain);
+            }
 
-          if (!gain_set) {
-            BOOST_LOG_TRIVIAL(error) << "! No Gain was specified! Things will probably not work";
-          }
+            if (vga2_gain != 0) {
+              gain_set = true;
+              source->set_gain_by_name("VGA2", vga2_gain);
+            }
 
-          source->set_gain_mode(agc);
-          source->set_antenna(antenna);
-          source->set_silence_frames(silence_frames);
+            if (gain != 0) {
+              gain_set = true;
+              source->set_gain(gain);
+            }
 
-          if (ppm != 0) {
-            source->set_freq_corr(ppm);
-          }
+            if (!gain_set) {
+              BOOST_LOG_TRIVIAL(error) << "! No Gain was specified! Things will probably not work";
+            }
+
+            source->set_gain_mode(agc);
+            source->set_antenna(antenna);
+            source->set_silence_frames(silence_frames);
+
+            if (ppm != 0) {
+              source->set_freq_corr(ppm);
+            }
+            return source;
+          });
         }
-        BOOST_LOG_TRIVIAL(info) << "Max Frequency: " << format_freq(source->get_max_hz());
-        BOOST_LOG_TRIVIAL(info) << "Min Frequency: " << format_freq(source->get_min_hz());
-        BOOST_LOG_TRIVIAL(info) << "Digital Recorders: " << element.value("digitalRecorders", 0);
-        BOOST_LOG_TRIVIAL(info) << "SigMF Recorders: " << element.value("sigmfRecorders", 0);
-        BOOST_LOG_TRIVIAL(info) << "Analog Recorders: " << element.value("analogRecorders", 0);
-        source->create_digital_recorders(tb, digital_recorders);
-        source->create_analog_recorders(tb, analog_recorders);
-        source->create_sigmf_recorders(tb, sigmf_recorders);
-        if (config.debug_recorder) {
-          source->create_debug_recorder(tb, source_count);
+        BOOST_LOG_TRIVIAL(info) << "Digital Recorders: " << digital_recorders;
+        BOOST_LOG_TRIVIAL(info) << "SigMF Recorders: " << sigmf_recorders;
+        BOOST_LOG_TRIVIAL(info) << "Analog Recorders: " << analog_recorders;
+        if ((warm_digital_recorders >= 0) || (warm_analog_recorders >= 0)) {
+          BOOST_LOG_TRIVIAL(info) << "Warm Digital Recorders: " << ((warm_digital_recorders < 0) ? "All" : std::to_string(warm_digital_recorders));
+          BOOST_LOG_TRIVIAL(info) << "Warm Analog Recorders: " << ((warm_analog_recorders < 0) ? "All" : std::to_string(warm_analog_recorders));
+          BOOST_LOG_TRIVIAL(info) << "Recorder Low Watermark: " << recorder_low_watermark;
         }
 
-        sources.push_back(source);
-        source_count++;
+        for (size_t i = 0; i < open_sources.size(); i++) {
+          Source_Setup setup = {open_sources[i], digital_recorders, analog_recorders, sigmf_recorders, warm_digital_recorders, warm_analog_recorders, recorder_low_watermark, NULL};
+          source_setups.push_back(setup);
+        }
         BOOST_LOG_TRIVIAL(info) << "\n-------------------------------------\n\n";
       }
     }
 
+    std::chrono::steady_clock::time_point open_start = std::chrono::steady_clock::now();
+    std::vector<std::string> open_errors(source_setups.size());
+    std::function<void(size_t)> open_setup = [&source_setups, &open_errors](size_t i) {
+      try {
+        source_setups[i].source = source_setups[i].open();
+      } catch (std::exception const &e) {
+        open_errors[i] = e.what();
+      }
+    };
+    if (config.parallel_source_startup && (source_setups.size() > 1)) {
+      std::vector<std::thread> openers;
+      for (size_t i = 0; i < source_setups.size(); i++) {
+        openers.push_back(std::thread(open_setup, i));
+      }
+      for (std::vector<std::thread>::iterator it = openers.begin(); it != openers.end(); ++it) {
+        it->join();
+      }
+    } else {
+      for (size_t i = 0; i < source_setups.size(); i++) {
+        open_setup(i);
+      }
+    }
+    for (size_t i = 0; i < source_setups.size(); i++) {
+      if (!source_setups[i].source) {
+        BOOST_LOG_TRIVIAL(error) << "Unable to open Source " << i << ": " << open_errors[i];
+        return false;
+      }
+    }
+    double open_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - open_start).count();
+    Flowgraph_Profiler::add_phase_time(STARTUP_SOURCE_INIT, open_seconds);
+
+    std::chrono::steady_clock::time_point recorders_start = std::chrono::steady_clock::now();
+    for (std::vector<Source_Setup>::iterator it = source_setups.begin(); it != source_setups.end(); ++it) {
+      Source *source = it->source;
+      BOOST_LOG_TRIVIAL(info) << "Source " << source_count << " - " << source->get_driver() << " " << source->get_device() << " Max Frequency: " << format_freq(source->get_max_hz()) << " Min Frequency: " << format_freq(source->get_min_hz());
+      source->set_warm_recorders(it->warm_digital_recorders, it->warm_analog_recorders, it->recorder_low_watermark);
+      source->create_digital_recorders(tb, it->digital_recorders);
+      source->create_analog_recorders(tb, it->analog_recorders);
+      source->create_sigmf_recorders(tb, it->sigmf_recorders);
+      if (config.debug_recorder) {
+        source->create_debug_recorder(tb, source_count);
+      }
+
+      sources.push_back(source);
+      source_count++;
+    }
+    double recorders_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - recorders_start).count();
+    Flowgraph_Profiler::add_phase_time(STARTUP_RECORDER_BUILD, recorders_seconds);
+    BOOST_LOG_TRIVIAL(info) << "Opened " << source_setups.size() << " Sources in " << std::fixed << std::setprecision(2) << open_seconds << " sec" << (config.parallel_source_startup ? " (in parallel)" : "") << ", made their Recorders in " << recorders_seconds << " sec";
+
     BOOST_LOG_TRIVIAL(info) << "\n\n-------------------------------------\nPLUGINS\n-------------------------------------\n";
     add_internal_plugin("openmhz_uploader", "libopenmhz_uploader.so", data);
     add_internal_plugin("broadcastify_uploader", "libbroadcastify_uploader.so", data);
@@ -670,6 +1145,7 @@ bool load_config(string config_file, Config &config, gr::top_block_sptr &tb, std
   if (config.debug_recorder) {
     BOOST_LOG_TRIVIAL(info) << "\n\n-------------------------------------\nDEBUG RECORDER\n-------------------------------------\n";
     BOOST_LOG_TRIVIAL(info) << "  Address: " << config.debug_recorder_address;
+    BOOST_LOG_TRIVIAL(info) << "  Payload: " << config.debug_recorder_payload << " bytes of " << config.debug_recorder_format << (config.debug_recorder_seq_num ? " with sequence numbers" : "") << (config.debug_recorder_zerocopy ? ", zero copy" : "");
 
     for (vector<Source *>::iterator it = sources.begin(); it != sources.end(); it++) {
       Source *source = *it;
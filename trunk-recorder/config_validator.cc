@@ -0,0 +1,415 @@
+#include "config_validator.h"
+
+#include <sstream>
+
+using json = nlohmann::json;
+
+// What load_config() reads, and as what
+static const Config_Validator::Setting instance_settings[] = {
+    {"ver", Config_Validator::NUMBER},
+    {"logColor", Config_Validator::STRING},
+    {"consoleLog", Config_Validator::BOOL},
+    {"logFile", Config_Validator::BOOL},
+    {"logAsync", Config_Validator::BOOL},
+    {"logDir", Config_Validator::STRING},
+    {"logLevel", Config_Validator::STRING},
+    {"syslogFriendly", Config_Validator::BOOL},
+    {"tempDir", Config_Validator::STRING},
+    {"captureDir", Config_Validator::STRING},
+    {"wavBufferSeconds", Config_Validator::NUMBER},
+    {"wavMmap", Config_Validator::BOOL},
+    {"memoryTransmissions", Config_Validator::BOOL},
+    {"memorySpillSeconds", Config_Validator::NUMBER},
+    {"streamingEncoder", Config_Validator::BOOL},
+    {"sigmfFormat", Config_Validator::STRING},
+    {"sigmfCompression", Config_Validator::STRING},
+    {"sigmfDirectIO", Config_Validator::BOOL},
+    {"callConcluderThreads", Config_Validator::NUMBER},
+    {"uploadConnectionsPerHost", Config_Validator::NUMBER},
+    {"vocoderThreads", Config_Validator::NUMBER},
+    {"backlogMaxSeconds", Config_Validator::NUMBER},
+    {"backlogMaxMB", Config_Validator::NUMBER},
+    {"admissionCpuBudget", Config_Validator::NUMBER},
+    {"admissionDeferSeconds", Config_Validator::NUMBER},
+    {"archiveFilesOnFailure", Config_Validator::BOOL},
+    {"archiveSegments", Config_Validator::BOOL},
+    {"archiveSyncSeconds", Config_Validator::NUMBER},
+    {"recentCallsHours", Config_Validator::NUMBER},
+    {"retryJournal", Config_Validator::BOOL},
+    {"retryRate", Config_Validator::NUMBER},
+    {"uploadServer", Config_Validator::STRING},
+    {"broadcastifyCallsServer", Config_Validator::STRING},
+    {"statusServer", Config_Validator::STRING},
+    {"statusCallsDelta", Config_Validator::BOOL},
+    {"statusFormat", Config_Validator::STRING},
+    {"statusSendBuffer", Config_Validator::NUMBER},
+    {"statusAsString", Config_Validator::BOOL},
+    {"instanceKey", Config_Validator::STRING},
+    {"instanceId", Config_Validator::STRING},
+    {"broadcastSignals", Config_Validator::BOOL},
+    {"defaultMode", Config_Validator::STRING},
+    {"callTimeout", Config_Validator::NUMBER},
+    {"controlWarnRate", Config_Validator::NUMBER},
+    {"controlRetuneLimit", Config_Validator::NUMBER},
+    {"controlChannelHunt", Config_Validator::BOOL},
+    {"sourceReopenLimit", Config_Validator::NUMBER},
+    {"softVocoder", Config_Validator::BOOL},
+    {"audioStreaming", Config_Validator::BOOL},
+    {"systemWorkers", Config_Validator::BOOL},
+    {"clusterRole", Config_Validator::STRING},
+    {"clusterPort", Config_Validator::NUMBER},
+    {"clusterControl", Config_Validator::STRING},
+    {"controlApiPort", Config_Validator::NUMBER},
+    {"controlApiAddress", Config_Validator::STRING},
+    {"multiSiteWindow", Config_Validator::NUMBER},
+    {"controlChannelCapture", Config_Validator::STRING},
+    {"tableCacheDir", Config_Validator::STRING},
+    {"stateCheckpointDir", Config_Validator::STRING},
+    {"stateCheckpointInterval", Config_Validator::NUMBER},
+    {"parallelSourceStartup", Config_Validator::BOOL},
+    {"singleBranchRecorders", Config_Validator::BOOL},
+    {"fusedAnalogAudio", Config_Validator::BOOL},
+    {"shareTdmaSlots", Config_Validator::BOOL},
+    {"preemptCalls", Config_Validator::BOOL},
+    {"recorderThreadModel", Config_Validator::STRING},
+    {"recorderCpuStats", Config_Validator::BOOL},
+    {"latencyTracing", Config_Validator::BOOL},
+    {"traceFile", Config_Validator::STRING},
+    {"toneScan", Config_Validator::BOOL},
+    {"toneScanInterval", Config_Validator::NUMBER},
+    {"occupancyFile", Config_Validator::STRING},
+    {"occupancyInterval", Config_Validator::NUMBER},
+    {"unitActivityFile", Config_Validator::STRING},
+    {"unitActivityMb", Config_Validator::NUMBER},
+    {"recorderBufferItems", Config_Validator::OBJECT},
+    {"decoderThread", Config_Validator::BOOL},
+    {"recordUUVCalls", Config_Validator::BOOL},
+    {"newCallFromUpdate", Config_Validator::BOOL},
+    {"frequencyFormat", Config_Validator::STRING},
+    {"filenameFormat", Config_Validator::STRING},
+    {"debugRecorder", Config_Validator::NUMBER},
+    {"debugRecorderAddress", Config_Validator::STRING},
+    {"debugRecorderPort", Config_Validator::NUMBER},
+    {"debugRecorderPayload", Config_Validator::NUMBER},
+    {"debugRecorderFormat", Config_Validator::STRING},
+    {"debugRecorderSeqNum", Config_Validator::BOOL},
+    {"debugRecorderZeroCopy", Config_Validator::BOOL}};
+
+static const Config_Validator::Setting system_settings[] = {
+    {"enabled", Config_Validator::BOOL},
+    {"shortName", Config_Validator::STRING},
+    {"type", Config_Validator::STRING},
+    {"channels", Config_Validator::NUMBERS},
+    {"channelFile", Config_Validator::STRING},
+    {"control_channels", Config_Validator::NUMBERS},
+    {"talkgroupsFile", Config_Validator::STRING},
+    {"customFrequencyTableFile", Config_Validator::STRING},
+    {"modulation", Config_Validator::STRING},
+    {"digitalLevels", Config_Validator::NUMBER},
+    {"analogLevels", Config_Validator::NUMBER},
+    {"squelch", Config_Validator::NUMBER},
+    {"deemphasisTau", Config_Validator::NUMBER},
+    {"maxDev", Config_Validator::NUMBER},
+    {"filterWidth", Config_Validator::NUMBER},
+    {"conversationMode", Config_Validator::BOOL},
+    {"apiKey", Config_Validator::STRING},
+    {"broadcastifyApiKey", Config_Validator::STRING},
+    {"broadcastifySystemId", Config_Validator::NUMBER},
+    {"uploadScript", Config_Validator::STRING},
+    {"compressWav", Config_Validator::BOOL},
+    {"callLog", Config_Validator::BOOL},
+    {"audioArchive", Config_Validator::BOOL},
+    {"transmissionArchive", Config_Validator::BOOL},
+    {"unitTagsFile", Config_Validator::STRING},
+    {"unitTagsOTA", Config_Validator::STRING},
+    {"unitTagsMode", Config_Validator::STRING},
+    {"recordUnknown", Config_Validator::BOOL},
+    {"decodeMDC", Config_Validator::BOOL},
+    {"decodeFSync", Config_Validator::BOOL},
+    {"decodeStar", Config_Validator::BOOL},
+    {"decodeTPS", Config_Validator::BOOL},
+    {"decodeDCS", Config_Validator::BOOL},
+    {"signalDecoders", Config_Validator::STRINGS},
+    {"toneSquelchGate", Config_Validator::BOOL},
+    {"lowLatency", Config_Validator::BOOL},
+    {"controlChannelOnly", Config_Validator::BOOL},
+    {"preTuneRecorders", Config_Validator::NUMBER},
+    {"talkgroupDisplayFormat", Config_Validator::STRING},
+    {"sysId", Config_Validator::NUMBER},
+    {"nac", Config_Validator::NUMBER},
+    {"wacn", Config_Validator::NUMBER},
+    {"bandplan", Config_Validator::STRING},
+    {"bandplanBase", Config_Validator::NUMBER},
+    {"bandplanHigh", Config_Validator::NUMBER},
+    {"bandplanSpacing", Config_Validator::NUMBER},
+    {"bandplanOffset", Config_Validator::NUMBER},
+    {"hideEncrypted", Config_Validator::BOOL},
+    {"monitorEncrypted", Config_Validator::BOOL},
+    {"hideUnknownTalkgroups", Config_Validator::BOOL},
+    {"minDuration", Config_Validator::NUMBER},
+    {"maxDuration", Config_Validator::NUMBER},
+    {"minTransmissionDuration", Config_Validator::NUMBER},
+    {"maxSilence", Config_Validator::NUMBER},
+    {"silenceLevel", Config_Validator::NUMBER},
+    {"admissionPriority", Config_Validator::NUMBER},
+    {"controlIqRingSeconds", Config_Validator::NUMBER},
+    {"controlIqDumpRate", Config_Validator::NUMBER},
+    {"syncWake", Config_Validator::BOOL},
+    {"multiSite", Config_Validator::BOOL},
+    {"multiSiteSystemName", Config_Validator::STRING},
+    {"multiSiteSystemNumber", Config_Validator::NUMBER},
+    {"filenameFormat", Config_Validator::STRING}};
+
+static const Config_Validator::Setting source_settings[] = {
+    {"enabled", Config_Validator::BOOL},
+    {"driver", Config_Validator::STRING},
+    {"device", Config_Validator::STRING},
+    {"digitalRecorders", Config_Validator::NUMBER},
+    {"sigmfRecorders", Config_Validator::NUMBER},
+    {"analogRecorders", Config_Validator::NUMBER},
+    {"warmDigitalRecorders", Config_Validator::NUMBER},
+    {"warmAnalogRecorders", Config_Validator::NUMBER},
+    {"recorderLowWatermark", Config_Validator::NUMBER},
+    {"replayGroup", Config_Validator::STRING},
+    {"sigmfData", Config_Validator::STRING},
+    {"sigmfMeta", Config_Validator::STRING},
+    {"sigmfCollection", Config_Validator::STRING},
+    {"repeat", Config_Validator::BOOL},
+    {"replaySpeed", Config_Validator::NUMBER},
+    {"iqFile", Config_Validator::STRING},
+    {"iqType", Config_Validator::STRING},
+    {"center", Config_Validator::NUMBER},
+    {"rate", Config_Validator::NUMBER},
+    {"error", Config_Validator::NUMBER},
+    {"ppm", Config_Validator::NUMBER},
+    {"autoTune", Config_Validator::BOOL},
+    {"silenceFrames", Config_Validator::NUMBER},
+    {"silenceFrame", Config_Validator::NUMBER},
+    {"channelizer", Config_Validator::STRING},
+    {"pfbChannelSpacing", Config_Validator::NUMBER},
+    {"tileWidth", Config_Validator::NUMBER},
+    {"fftThreads", Config_Validator::NUMBER},
+    {"analogFftThreads", Config_Validator::NUMBER},
+    {"digitalFftThreads", Config_Validator::NUMBER},
+    {"wireFormat", Config_Validator::STRING},
+    {"hostFormat", Config_Validator::STRING},
+    {"hostDecimation", Config_Validator::NUMBER},
+    {"shmRing", Config_Validator::STRING},
+    {"shmRingBlocks", Config_Validator::NUMBER},
+    {"iqRingSeconds", Config_Validator::NUMBER},
+    {"lowLatency", Config_Validator::BOOL},
+    {"agc", Config_Validator::BOOL},
+    {"gain", Config_Validator::NUMBER},
+    {"ifGain", Config_Validator::NUMBER},
+    {"bbGain", Config_Validator::NUMBER},
+    {"mixGain", Config_Validator::NUMBER},
+    {"lnaGain", Config_Validator::NUMBER},
+    {"pgaGain", Config_Validator::NUMBER},
+    {"tiaGain", Config_Validator::NUMBER},
+    {"ampGain", Config_Validator::NUMBER},
+    {"vgaGain", Config_Validator::NUMBER},
+    {"vga1Gain", Config_Validator::NUMBER},
+    {"vga2Gain", Config_Validator::NUMBER},
+    {"antenna", Config_Validator::STRING},
+    {"signalDetectorThreshold", Config_Validator::NUMBER},
+    {"signalDetectorRate", Config_Validator::NUMBER},
+    {"cpuAffinity", Config_Validator::NUMBERS},
+    {"numaNode", Config_Validator::NUMBER},
+    {"gainSettings", Config_Validator::OBJECT}};
+
+#define SETTING_COUNT(settings) (sizeof(settings) / sizeof(settings[0]))
+
+bool Config_Validator::matches(const json &value, Kind kind) {
+  switch (kind) {
+  case BOOL:
+    return value.is_boolean();
+  case NUMBER:
+    return value.is_number() || value.is_boolean();
+  case STRING:
+    return value.is_string();
+  case NUMBERS:
+  case STRINGS:
+    if (!value.is_array()) {
+      return false;
+    }
+    for (const json &item : value) {
+      if ((kind == NUMBERS) ? !item.is_number() : !item.is_string()) {
+        return false;
+      }
+    }
+    return true;
+  case OBJECT:
+    return value.is_object();
+  }
+  return false;
+}
+
+const char *Config_Validator::describe(Kind kind) {
+  switch (kind) {
+  case BOOL:
+    return "true or false";
+  case NUMBER:
+    return "a number";
+  case STRING:
+    return "a string";
+  case NUMBERS:
+    return "a list of numbers";
+  case STRINGS:
+    return "a list of strings";
+  case OBJECT:
+    return "an object";
+  }
+  return "";
+}
+
+void Config_Validator::check_settings(const json &object, const Setting *settings, size_t count, const std::string &where, std::vector<std::string> &errors) {
+  for (size_t i = 0; i < count; i++) {
+    json::const_iterator it = object.find(settings[i].name);
+    if ((it != object.end()) && !matches(*it, settings[i].kind)) {
+      errors.push_back(where + "\"" + settings[i].name + "\" should be " + describe(settings[i].kind) + ", not " + it->dump());
+    }
+  }
+}
+
+void Config_Validator::check_system(const json &system, size_t index, std::vector<std::string> &errors) {
+  std::stringstream where;
+  where << "System " << index;
+  json::const_iterator short_name = system.find("shortName");
+  if ((short_name != system.end()) && short_name->is_string()) {
+    where << " (" << short_name->get<std::string>() << ")";
+  }
+  where << ": ";
+
+  if (!system.is_object()) {
+    errors.push_back(where.str() + "should be an object");
+    return;
+  }
+  check_settings(system, system_settings, SETTING_COUNT(system_settings), where.str(), errors);
+  if (!system.value("enabled", true)) {
+    return;
+  }
+
+  std::string type = system.contains("type") && system["type"].is_string() ? system["type"].get<std::string>() : "";
+  if ((type == "conventional") || (type == "conventionalP25") || (type == "conventionalDMR") || (type == "conventionalSIGMF")) {
+    if (system.contains("channels") == system.contains("channelFile")) {
+      errors.push_back(where.str() + "a conventional System needs either \"channels\" or \"channelFile\", and not both");
+    }
+  } else if ((type == "smartnet") || (type == "p25")) {
+    if (!system.contains("control_channels") || !system["control_channels"].is_array() || system["control_channels"].empty()) {
+      errors.push_back(where.str() + "a trunked System needs a list of \"control_channels\"");
+    }
+  } else {
+    errors.push_back(where.str() + "\"type\" should be conventional, conventionalP25, conventionalDMR, conventionalSIGMF, smartnet or p25");
+  }
+
+  if (system.contains("preTuneRecorders") && system["preTuneRecorders"].is_number() && (system["preTuneRecorders"].get<double>() < 0)) {
+    errors.push_back(where.str() + "\"preTuneRecorders\" should not be negative");
+  }
+
+  bool compress_wav = !system.contains("compressWav") || !system["compressWav"].is_boolean() || system["compressWav"].get<bool>();
+  bool uploads = (system.contains("apiKey") && (system["apiKey"] != "")) || (system.contains("broadcastifyApiKey") && (system["broadcastifyApiKey"] != ""));
+  if (!compress_wav && uploads) {
+    errors.push_back(where.str() + "\"compressWav\" has to be true to upload to OpenMHz or Broadcastify");
+  }
+}
+
+void Config_Validator::check_source(const json &source, size_t index, std::vector<std::string> &errors) {
+  std::stringstream where;
+  where << "Source " << index << ": ";
+
+  if (!source.is_object()) {
+    errors.push_back(where.str() + "should be an object");
+    return;
+  }
+  check_settings(source, source_settings, SETTING_COUNT(source_settings), where.str(), errors);
+  if (!source.value("enabled", true)) {
+    return;
+  }
+  if (source.contains("signalDetectorRate") && source["signalDetectorRate"].is_number() && !(source["signalDetectorRate"].get<double>() > 0)) {
+    errors.push_back(where.str() + "\"signalDetectorRate\" should be more than 0");
+  }
+
+  json::const_iterator driver_it = source.find("driver");
+  std::string driver = ((driver_it != source.end()) && driver_it->is_string()) ? driver_it->get<std::string>() : "";
+  if (driver == "iqfile") {
+    std::string iq_type = (source.contains("iqType") && source["iqType"].is_string()) ? source["iqType"].get<std::string>() : "";
+    if ((iq_type != "complex") && (iq_type != "float")) {
+      errors.push_back(where.str() + "\"iqType\" should be complex or float");
+    }
+    if (!source.contains("iqFile")) {
+      errors.push_back(where.str() + "an iqfile Source needs an \"iqFile\"");
+    }
+  } else if (driver == "sigmf") {
+    if (!source.contains("sigmfMeta") && !source.contains("sigmfCollection")) {
+      errors.push_back(where.str() + "a sigmf Source needs a \"sigmfMeta\" or a \"sigmfCollection\"");
+    }
+  } else if ((driver == "osmosdr") || (driver == "usrp") || (driver == "shm")) {
+    if (!source.contains("center") || !source.contains("rate")) {
+      errors.push_back(where.str() + "a " + driver + " Source needs a \"center\" and a \"rate\"");
+    }
+    std::string host_format = (source.contains("hostFormat") && source["hostFormat"].is_string()) ? source["hostFormat"].get<std::string>() : "fc32";
+    if ((host_format != "fc32") && (host_format != "sc16")) {
+      errors.push_back(where.str() + "\"hostFormat\" should be fc32 or sc16");
+    }
+    std::string wire_format = (source.contains("wireFormat") && source["wireFormat"].is_string()) ? source["wireFormat"].get<std::string>() : "";
+    if ((wire_format != "") && (wire_format != "sc16") && (wire_format != "sc12") && (wire_format != "sc8")) {
+      errors.push_back(where.str() + "\"wireFormat\" should be sc16, sc12 or sc8");
+    }
+  } else {
+    errors.push_back(where.str() + "\"driver\" should be osmosdr, sigmf, iqfile, shm or usrp");
+  }
+}
+
+bool Config_Validator::validate(const json &data, std::vector<std::string> &errors) {
+  size_t errors_before = errors.size();
+
+  if (!data.is_object()) {
+    errors.push_back("The config should be a JSON object");
+    return false;
+  }
+  check_settings(data, instance_settings, SETTING_COUNT(instance_settings), "", errors);
+
+  std::string cluster_role = (data.contains("clusterRole") && data["clusterRole"].is_string()) ? data["clusterRole"].get<std::string>() : "";
+  if ((cluster_role != "") && (cluster_role != "control") && (cluster_role != "voice")) {
+    errors.push_back("\"clusterRole\" should be control or voice");
+  }
+  if ((cluster_role == "voice") && !(data.contains("clusterControl") && data["clusterControl"].is_string())) {
+    errors.push_back("a voice node needs \"clusterControl\", the host:port of the control node");
+  }
+
+  json::const_iterator systems = data.find("systems");
+  if ((systems == data.end()) || !systems->is_array() || systems->empty()) {
+    errors.push_back("\"systems\" should be a list of at least one System");
+  } else {
+    for (size_t i = 0; i < systems->size(); i++) {
+      check_system((*systems)[i], i, errors);
+    }
+  }
+
+  json::const_iterator sources = data.find("sources");
+  if ((sources == data.end()) || !sources->is_array() || sources->empty()) {
+    errors.push_back("\"sources\" should be a list of at least one Source");
+  } else {
+    for (size_t i = 0; i < sources->size(); i++) {
+      check_source((*sources)[i], i, errors);
+    }
+  }
+
+  json::const_iterator plugins = data.find("plugins");
+  if (plugins != data.end()) {
+    if (!plugins->is_array()) {
+      errors.push_back("\"plugins\" should be a list");
+    } else {
+      for (size_t i = 0; i < plugins->size(); i++) {
+        const json &plugin = (*plugins)[i];
+        if (!plugin.is_object() || !plugin.contains("library") || !plugin["library"].is_string()) {
+          std::stringstream error;
+          error << "Plugin " << i << ": needs a \"library\"";
+          errors.push_back(error.str());
+        }
+      }
+    }
+  }
+
+  return errors.size() == errors_before;
+}
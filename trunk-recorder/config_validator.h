@@ -0,0 +1,55 @@
+#ifndef CONFIG_VALIDATOR_H
+#define CONFIG_VALIDATOR_H
+
+#include <json.hpp>
+#include <string>
+#include <vector>
+
+/*
+ * Config_Validator
+ *   Checks a config.json before load_config() starts setting anything up
+ *   from it, and reports everything wrong with it at once.
+ *
+ * load_config() stops at the first thing it doesn't like, and a setting of
+ * the wrong type, like "squelch": "-50", comes out of json::value() as the
+ * exception nlohmann throws, with no word of which setting it was. With a
+ * big config that is a start, a fix and another start for every mistake.
+ * This goes through the whole thing first: the type of every setting
+ * load_config() reads at the top level and in each System and Source,
+ * the System types and Source drivers, and the settings a System or Source
+ * of that kind can't do without. Each error names the setting and the
+ * System's shortName or the Source's number.
+ *
+ * Settings it doesn't know aren't errors, the plugins read settings of
+ * their own out of the same objects. The checks that only fall back to a
+ * default with an error in load_config() are left to it.
+ */
+class Config_Validator {
+public:
+  // Adds a line to errors for each problem, true if there were none
+  static bool validate(const nlohmann::json &data, std::vector<std::string> &errors);
+
+  enum Kind {
+    BOOL,
+    NUMBER, // json::value() will take a boolean for a number as well
+    STRING,
+    NUMBERS,
+    STRINGS,
+    OBJECT
+  };
+
+  struct Setting {
+    const char *name;
+    Kind kind;
+  };
+
+private:
+
+  static bool matches(const nlohmann::json &value, Kind kind);
+  static const char *describe(Kind kind);
+  static void check_settings(const nlohmann::json &object, const Setting *settings, size_t count, const std::string &where, std::vector<std::string> &errors);
+  static void check_system(const nlohmann::json &system, size_t index, std::vector<std::string> &errors);
+  static void check_source(const nlohmann::json &source, size_t index, std::vector<std::string> &errors);
+};
+
+#endif // CONFIG_VALIDATOR_H
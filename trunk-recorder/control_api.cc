@@ -0,0 +1,271 @@
+#include "control_api.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int Control_Api::listen_fd = -1;
+int Control_Api::notify_pipe[2] = {-1, -1};
+std::thread Control_Api::server;
+std::atomic<bool> Control_Api::running(false);
+std::mutex Control_Api::pending_mutex;
+std::condition_variable Control_Api::pending_cv;
+std::deque<Control_Api::Pending *> Control_Api::pending;
+std::map<std::string, Control_Api::Handler> Control_Api::routes;
+
+// How long a request waits for the main loop
+static const std::chrono::seconds REQUEST_TIMEOUT(10);
+
+static std::string url_decode(const std::string &text) {
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); i++) {
+    if ((text[i] == '%') && (i + 2 < text.size()) && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2])) {
+      decoded += (char)strtol(text.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    } else if (text[i] == '+') {
+      decoded += ' ';
+    } else {
+      decoded += text[i];
+    }
+  }
+  return decoded;
+}
+
+static const char *status_text(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 409:
+    return "Conflict";
+  default:
+    return "Service Unavailable";
+  }
+}
+
+static void send_all(int fd, const std::string &data) {
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t sent = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    done += sent;
+  }
+}
+
+void Control_Api::add_route(const std::string &path, Handler handler) {
+  routes[path] = handler;
+}
+
+bool Control_Api::start(Config &config) {
+  if (config.control_api_port <= 0) {
+    return true;
+  }
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "Control API - socket failed: " << strerror(errno);
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(config.control_api_port);
+  if (inet_pton(AF_INET, config.control_api_address.c_str(), &addr.sin_addr) != 1) {
+    BOOST_LOG_TRIVIAL(error) << "Control API - address is not an IPv4 address: " << config.control_api_address;
+    close(listen_fd);
+    listen_fd = -1;
+    return false;
+  }
+  if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(listen_fd, 8) < 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Control API - could not listen on " << config.control_api_address << ":" << config.control_api_port << " : " << strerror(errno);
+    close(listen_fd);
+    listen_fd = -1;
+    return false;
+  }
+  if (pipe(notify_pipe) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "Control API - pipe failed: " << strerror(errno);
+    close(listen_fd);
+    listen_fd = -1;
+    return false;
+  }
+  fcntl(notify_pipe[0], F_SETFL, fcntl(notify_pipe[0], F_GETFL) | O_NONBLOCK);
+
+  running = true;
+  server = std::thread(&Control_Api::serve);
+  BOOST_LOG_TRIVIAL(info) << "Control API serving http://" << config.control_api_address << ":" << config.control_api_port << "/";
+  return true;
+}
+
+void Control_Api::stop() {
+  if (!running.exchange(false)) {
+    return;
+  }
+  pending_cv.notify_all();
+  server.join();
+  close(listen_fd);
+  close(notify_pipe[0]);
+  close(notify_pipe[1]);
+  listen_fd = -1;
+  notify_pipe[0] = notify_pipe[1] = -1;
+}
+
+void Control_Api::run(Handler handler) {
+  char drain[64];
+  while (read(notify_pipe[0], drain, sizeof(drain)) > 0) {
+  }
+  while (true) {
+    Pending *next;
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex);
+      if (pending.empty()) {
+        return;
+      }
+      next = pending.front();
+      pending.pop_front();
+    }
+    Response response = handler(next->request);
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex);
+      next->response = response;
+      next->done = true;
+    }
+    pending_cv.notify_all();
+  }
+}
+
+bool Control_Api::Request::number(const std::string &name, double &value, bool &bad) const {
+  std::map<std::string, std::string>::const_iterator it = query.find(name);
+  if (it == query.end()) {
+    return false;
+  }
+  char *end;
+  value = strtod(it->second.c_str(), &end);
+  if (it->second.empty() || (*end != '\0')) {
+    bad = true;
+    return false;
+  }
+  return true;
+}
+
+// METHOD /path?a=1&b=2 HTTP/1.1
+bool Control_Api::parse(const std::string &text, Request &request) {
+  size_t line_end = text.find("\r\n");
+  std::istringstream line(text.substr(0, line_end));
+  std::string target, version;
+  if (!(line >> request.method >> target >> version) || (target.empty()) || (target[0] != '/')) {
+    return false;
+  }
+  size_t question = target.find('?');
+  request.path = url_decode(target.substr(0, question));
+  if (request.path.size() > 1 && request.path[request.path.size() - 1] == '/') {
+    request.path.resize(request.path.size() - 1);
+  }
+  if (question == std::string::npos) {
+    return true;
+  }
+  std::istringstream query(target.substr(question + 1));
+  std::string pair;
+  while (std::getline(query, pair, '&')) {
+    size_t equals = pair.find('=');
+    if (equals == std::string::npos) {
+      request.query[url_decode(pair)] = "";
+    } else {
+      request.query[url_decode(pair.substr(0, equals))] = url_decode(pair.substr(equals + 1));
+    }
+  }
+  return true;
+}
+
+// One request per connection
+void Control_Api::handle(int fd) {
+  struct timeval timeout = {2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string text;
+  char buffer[1024];
+  while ((text.find("\r\n\r\n") == std::string::npos) && (text.size() < 8192)) {
+    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+    if (got <= 0) {
+      break;
+    }
+    text.append(buffer, got);
+  }
+
+  Pending request;
+  request.done = false;
+  request.response.status = 400;
+  request.response.body = "{\"error\":\"not an HTTP request\"}";
+  bool parsed = parse(text, request.request);
+  std::map<std::string, Handler>::iterator route = parsed ? routes.find(request.request.path) : routes.end();
+  if (route != routes.end()) {
+    request.response = route->second(request.request);
+  } else if (parsed) {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    pending.push_back(&request);
+    lock.unlock();
+    char wake = 1;
+    if (write(notify_pipe[1], &wake, 1) < 0) {
+      // the pipe is full of wake ups already
+    }
+    lock.lock();
+    pending_cv.wait_for(lock, REQUEST_TIMEOUT, [&]() { return request.done || !running.load(); });
+    if (!request.done) {
+      std::deque<Pending *>::iterator it = std::find(pending.begin(), pending.end(), &request);
+      if (it != pending.end()) {
+        pending.erase(it);
+        request.response.status = 503;
+        request.response.body = "{\"error\":\"trunk-recorder is busy or shutting down\"}";
+      } else {
+        // The main loop has it, it won't be long
+        pending_cv.wait(lock, [&]() { return request.done; });
+      }
+    }
+  }
+
+  std::ostringstream response;
+  response << "HTTP/1.1 " << request.response.status << " " << status_text(request.response.status) << "\r\n"
+           << "Content-Type: application/json\r\n"
+           << "Content-Length: " << request.response.body.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << request.response.body;
+  send_all(fd, response.str());
+}
+
+void Control_Api::serve() {
+  while (running.load()) {
+    struct pollfd pfd;
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 500) <= 0) {
+      continue;
+    }
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    handle(fd);
+    close(fd);
+  }
+}
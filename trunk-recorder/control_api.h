@@ -0,0 +1,79 @@
+#ifndef CONTROL_API_H
+#define CONTROL_API_H
+
+#include "global_structs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Control_Api
+ *   A small HTTP server, on controlApiAddress:controlApiPort, for changing
+ *   what is recorded without a restart: resizing a Source's recorder
+ *   pools, adding and removing conventional channels, and turning Systems
+ *   on and off.
+ *
+ * The server has a thread of its own that reads one request from each
+ * connection and hands it to the main loop, which carries it out between
+ * messages and timers, the same as anything else that touches the calls
+ * and recorders, and passes back the JSON to reply with. get_fd() is
+ * readable while requests are waiting for run(). A request the main loop
+ * hasn't got to in 10 seconds, or that comes in while it is shutting
+ * down, gets a 503.
+ *
+ * A path added with add_route() before start() is answered by its handler
+ * on the server's thread instead, without waiting for the main loop, for
+ * lookups that keep their own lock and don't touch the calls or recorders.
+ */
+class Control_Api {
+public:
+  struct Request {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> query;
+
+    // True if name is in the query as a number. bad is set if it is there
+    // but isn't one, so a handler can check several and answer 400 once.
+    bool number(const std::string &name, double &value, bool &bad) const;
+  };
+  struct Response {
+    int status;
+    std::string body;
+  };
+  typedef std::function<Response(const Request &)> Handler;
+
+  static void add_route(const std::string &path, Handler handler);
+  static bool start(Config &config);
+  static void stop();
+  static int get_fd() { return notify_pipe[0]; }
+  // On the main loop: handles the requests waiting for it
+  static void run(Handler handler);
+
+private:
+  struct Pending {
+    Request request;
+    Response response;
+    bool done;
+  };
+
+  static void serve();
+  static void handle(int fd);
+  static bool parse(const std::string &text, Request &request);
+
+  static int listen_fd;
+  static int notify_pipe[2];
+  static std::thread server;
+  static std::atomic<bool> running;
+  static std::mutex pending_mutex;
+  static std::condition_variable pending_cv;
+  static std::deque<Pending *> pending;
+  static std::map<std::string, Handler> routes;
+};
+
+#endif // CONTROL_API_H
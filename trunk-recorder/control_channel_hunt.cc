@@ -0,0 +1,132 @@
+#include "control_channel_hunt.h"
+#include "formatter.h"
+#include "replay_clock.h"
+#include "systems/p25_trunking.h"
+#include "systems/smartnet_impl.h"
+#include "systems/smartnet_parser.h"
+
+#include <boost/log/trivial.hpp>
+
+Control_Channel_Hunt::Control_Channel_Hunt(System_impl *system, gr::top_block_sptr tb, std::vector<Source *> &sources)
+    : system(system), tb(tb), winner(-1) {
+  std::vector<double> control_channels = system->get_control_channels();
+  size_t count = control_channels.size();
+
+  // In the order the System would have stepped through them, so a tie goes
+  // to the one it would have tried first
+  for (size_t i = 1; i <= count; i++) {
+    double freq = control_channels[(system->current_control_channel + i) % count];
+
+    for (std::vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
+      Source *source = *src_it;
+
+      if ((source->get_min_hz() <= freq) && (source->get_max_hz() >= freq)) {
+        Probe probe;
+        probe.freq = freq;
+        probe.source = source;
+        probe.queue = gr::msg_queue::make(100);
+        probe.valid_messages = 0;
+
+        if (system->get_system_type() == "smartnet") {
+          smartnet_impl::sptr smartnet = smartnet_impl::make(freq, source->get_center(), source->get_rate(), probe.queue, system->get_sys_num());
+          smartnet->set_fft_threads(source->get_fft_threads());
+          probe.block = smartnet;
+        } else {
+          p25_trunking_sptr p25 = make_p25_trunking(freq, source->get_center(), source->get_rate(), probe.queue, system->get_qpsk_mod(), system->get_sys_num());
+          p25->set_fft_threads(source->get_fft_threads());
+          probe.block = p25;
+        }
+        source->pin_block(probe.block);
+        probes.push_back(probe);
+        break;
+      }
+    }
+  }
+
+  if (probes.empty()) {
+    return;
+  }
+
+  tb->lock();
+  for (std::vector<Probe>::iterator it = probes.begin(); it != probes.end(); ++it) {
+    it->source->connect_output(tb, it->block);
+  }
+  tb->unlock();
+
+  started = Replay_Clock::steady_now();
+  BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "] Hunting for a Control Channel on " << probes.size() << " frequencies";
+}
+
+Control_Channel_Hunt::~Control_Channel_Hunt() {
+  if (probes.empty()) {
+    return;
+  }
+
+  tb->lock();
+  for (std::vector<Probe>::iterator it = probes.begin(); it != probes.end(); ++it) {
+    it->source->disconnect_output(tb, it->block);
+  }
+  tb->unlock();
+}
+
+// The messages the parsers would count towards the decode rate: TSBKs and
+// MBTs with the System's NAC, if it has one, or good OSWs
+bool Control_Channel_Hunt::is_valid(gr::message::sptr msg) const {
+  long type = msg->type();
+
+  if (system->get_system_type() == "smartnet") {
+    return ((type >> 16) == 2) && ((type & 0xffff) == M_SMARTNET_OSW);
+  }
+
+  if (((type != 7) && (type != 12)) || (msg->length() < 2)) {
+    return false;
+  }
+  const unsigned char *s = msg->msg();
+  unsigned long nac = (s[0] << 8) + s[1];
+  return (nac != 0xffff) && ((system->get_nac() == 0) || (nac == system->get_nac()));
+}
+
+bool Control_Channel_Hunt::poll() {
+  if (probes.empty()) {
+    return true;
+  }
+
+  for (size_t i = 0; i < probes.size(); i++) {
+    Probe &probe = probes[i];
+    while (gr::message::sptr msg = probe.queue->delete_head_nowait()) {
+      if (is_valid(msg)) {
+        probe.valid_messages++;
+      }
+    }
+    if ((winner < 0) && (probe.valid_messages >= lock_messages)) {
+      winner = i;
+    }
+  }
+  if (winner < 0) {
+    if (Replay_Clock::steady_now() - started < std::chrono::milliseconds(window_ms)) {
+      return false;
+    }
+
+    int most = 0;
+    for (size_t i = 0; i < probes.size(); i++) {
+      if (probes[i].valid_messages > most) {
+        most = probes[i].valid_messages;
+        winner = i;
+      }
+    }
+  }
+
+  if (winner >= 0) {
+    BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "] Control Channel hunt found " << format_freq(probes[winner].freq) << " with " << probes[winner].valid_messages << " messages";
+  } else {
+    BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "] Control Channel hunt found nothing on any of the frequencies";
+  }
+  return true;
+}
+
+double Control_Channel_Hunt::get_winner() const {
+  if (winner < 0) {
+    return 0;
+  }
+  return probes[winner].freq;
+}
@@ -0,0 +1,68 @@
+#ifndef CONTROL_CHANNEL_HUNT_H
+#define CONTROL_CHANNEL_HUNT_H
+
+#include "source.h"
+#include "systems/system_impl.h"
+
+#include <chrono>
+#include <gnuradio/msg_queue.h>
+#include <gnuradio/top_block.h>
+#include <vector>
+
+/*
+ * Control_Channel_Hunt
+ *   Listens to all of a System's control channels at once when the one it
+ *   is on goes quiet, to find one that is up without going through them one
+ *   at a time.
+ *
+ * Stepping through the list, each channel is only given up on after a
+ * decode rate check, so a system with 5 control channels could be off the
+ * air for 15 seconds before getting back to the one that is up. A hunt
+ * connects a trunking chain of its own, a probe, for every control channel
+ * a Source covers, each with its own queue, and counts the TSBKs and MBTs
+ * or OSWs that come off them. The first probe to get lock_messages wins.
+ * If none of them get that many in the window, the one with the most does,
+ * and if none of them decoded anything there is no winner and the next
+ * check starts another hunt.
+ *
+ * The System's own control channel chain stays where it was until a winner
+ * is found and it is retuned there. The probes are connected under a lock
+ * of the flowgraph, like a retune is, and are taken off it again when the
+ * hunt is deleted. Everything runs on the main thread.
+ */
+class Control_Channel_Hunt {
+public:
+  Control_Channel_Hunt(System_impl *system, gr::top_block_sptr tb, std::vector<Source *> &sources);
+  ~Control_Channel_Hunt();
+
+  int probe_count() const { return probes.size(); }
+
+  // Takes what the probes decoded off their queues, true once there is a
+  // winner or the window has gone by
+  bool poll();
+
+  // The control channel to tune to, 0 if none of them decoded anything
+  double get_winner() const;
+
+  static const int lock_messages = 5;
+  static const int window_ms = 1500;
+
+private:
+  struct Probe {
+    double freq;
+    Source *source;
+    gr::basic_block_sptr block;
+    gr::msg_queue::sptr queue;
+    int valid_messages;
+  };
+
+  bool is_valid(gr::message::sptr msg) const;
+
+  System_impl *system;
+  gr::top_block_sptr tb;
+  std::vector<Probe> probes;
+  std::chrono::steady_clock::time_point started;
+  int winner;
+};
+
+#endif // CONTROL_CHANNEL_HUNT_H
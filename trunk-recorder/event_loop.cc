@@ -0,0 +1,150 @@
+#include "event_loop.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+Event_Loop::Event_Loop() : poll_fds(1), ready(ready_capacity) {
+  poll_fds[0].fd = -1;
+  poll_fds[0].events = POLLIN;
+  if (pipe(wake_pipe) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to create the main loop's wake up pipe, falling back to polling";
+    wake_pipe[0] = -1;
+    wake_pipe[1] = -1;
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    fcntl(wake_pipe[i], F_SETFL, fcntl(wake_pipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+  poll_fds[0].fd = wake_pipe[0];
+}
+
+Event_Loop::~Event_Loop() {
+  shutdown();
+  if (wake_pipe[0] >= 0) {
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+  }
+}
+
+void Event_Loop::add_timer(std::chrono::milliseconds period, Task task) {
+  Timer timer = {Clock::now() + period, period, task};
+  timers.push(timer);
+}
+
+void Event_Loop::watch_queue(System *system, gr::msg_queue::sptr queue, Handler handler) {
+  queues.push_back(queue);
+  feeders.push_back(std::thread(&Event_Loop::feed, this, system, queue, handler));
+}
+
+void Event_Loop::feed(System *system, gr::msg_queue::sptr queue, Handler handler) {
+  while (true) {
+    gr::message::sptr msg = queue->delete_head();
+    if (msg->type() == shutdown_msg_type) {
+      return;
+    }
+    if (handler) {
+      handler(system, msg);
+      continue;
+    }
+    std::pair<System *, gr::message::sptr> item(system, msg);
+    msg.reset();
+    while (!ready.push(std::move(item))) {
+      wake();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    wake();
+  }
+}
+
+void Event_Loop::watch_fd(int fd, Task task) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  poll_fds.push_back(pfd);
+  fd_tasks.push_back(task);
+}
+
+// Runs the task of each watched descriptor that is readable now
+void Event_Loop::run_fds() {
+  if (fd_tasks.empty() || (poll(&poll_fds[1], fd_tasks.size(), 0) <= 0)) {
+    return;
+  }
+  for (size_t i = 0; i < fd_tasks.size(); i++) {
+    if (poll_fds[i + 1].revents & POLLIN) {
+      fd_tasks[i]();
+    }
+  }
+}
+
+bool Event_Loop::next_message(System *&system, gr::message::sptr &msg) {
+  std::pair<System *, gr::message::sptr> item;
+  if (!ready.pop(item)) {
+    return false;
+  }
+  system = item.first;
+  msg = std::move(item.second);
+  return true;
+}
+
+void Event_Loop::run_timers() {
+  Clock::time_point now = Clock::now();
+  while (!timers.empty() && (timers.top().due <= now)) {
+    Timer timer = timers.top();
+    timers.pop();
+    timer.task();
+    timer.due += timer.period;
+    if (timer.due <= now) {
+      timer.due = now + timer.period;
+    }
+    timers.push(timer);
+  }
+}
+
+void Event_Loop::wait() {
+  if (!ready.empty()) {
+    return;
+  }
+
+  int timeout_ms = -1;
+  if (!timers.empty()) {
+    Clock::duration until = timers.top().due - Clock::now();
+    timeout_ms = std::max(0L, (long)std::chrono::duration_cast<std::chrono::milliseconds>(until + std::chrono::microseconds(999)).count());
+  }
+
+  if (wake_pipe[0] < 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 0 ? 10 : std::min(timeout_ms, 10)));
+    return;
+  }
+
+  if ((poll(poll_fds.data(), poll_fds.size(), timeout_ms) > 0) && (poll_fds[0].revents & POLLIN)) {
+    char buf[64];
+    while (read(wake_pipe[0], buf, sizeof(buf)) > 0) {
+    }
+  }
+}
+
+void Event_Loop::wake() {
+  if (wake_pipe[1] >= 0) {
+    char c = 0;
+    // A full pipe already has a wake up pending
+    ssize_t ret = write(wake_pipe[1], &c, 1);
+    (void)ret;
+  }
+}
+
+void Event_Loop::shutdown() {
+  for (size_t i = 0; i < queues.size(); i++) {
+    queues[i]->insert_tail(gr::message::make(shutdown_msg_type));
+  }
+  for (size_t i = 0; i < feeders.size(); i++) {
+    feeders[i].join();
+  }
+  queues.clear();
+  feeders.clear();
+}
@@ -0,0 +1,88 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <chrono>
+#include <functional>
+#include <poll.h>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gnuradio/message.h>
+#include <gnuradio/msg_queue.h>
+
+#include "mpsc_ring.h"
+
+class System;
+
+/*
+ * Event_Loop
+ *   Runs the main loop in monitor_messages().
+ *
+ * Each trunked System's gr::msg_queue gets a small thread. The thread
+ * blocks on the queue and hands every control channel message to the
+ * loop as soon as it arrives, or, if the queue was given a handler,
+ * runs the handler on the message itself. The threads hand messages over
+ * through an MPSC_Ring, so they never wait on the loop, or on each other,
+ * for a lock; if the loop falls a whole ring behind a thread waits for it
+ * to catch up and the System's queue takes up the slack. wait() sleeps
+ * until a message is ready, a timer is due or wake() is called. wake() only writes a byte
+ * to a pipe, so it is safe to call from a signal handler.
+ *
+ * A file descriptor can be watched as well: wait() also wakes when it is
+ * readable, and run_fds() runs its task on the loop's thread.
+ *
+ * Timers are periodic and kept in a heap ordered by the next time they
+ * are due. A timer that falls behind runs once and then picks up its
+ * period from then; it doesn't run the missed times back to back.
+ */
+class Event_Loop {
+public:
+  typedef std::function<void()> Task;
+  typedef std::function<void(System *, gr::message::sptr)> Handler;
+  typedef std::chrono::steady_clock Clock;
+
+  Event_Loop();
+  ~Event_Loop();
+
+  void add_timer(std::chrono::milliseconds period, Task task);
+  void watch_queue(System *system, gr::msg_queue::sptr queue, Handler handler = nullptr);
+  void watch_fd(int fd, Task task);
+
+  bool next_message(System *&system, gr::message::sptr &msg);
+  void run_timers();
+  void run_fds();
+  void wait();
+  void wake();
+  void shutdown();
+
+private:
+  struct Timer {
+    Clock::time_point due;
+    std::chrono::milliseconds period;
+    Task task;
+  };
+  struct Timer_Later {
+    bool operator()(const Timer &a, const Timer &b) const { return a.due > b.due; }
+  };
+
+  // A message of this type tells a queue's thread to stop
+  static const long shutdown_msg_type = -100;
+  // Messages handed to the loop and not taken yet, a few seconds of a
+  // busy site on every system
+  static const size_t ready_capacity = 4096;
+
+  void feed(System *system, gr::msg_queue::sptr queue, Handler handler);
+
+  std::priority_queue<Timer, std::vector<Timer>, Timer_Later> timers;
+  // The wake up pipe and then the watched descriptors, with their tasks
+  std::vector<struct pollfd> poll_fds;
+  std::vector<Task> fd_tasks;
+  std::vector<gr::msg_queue::sptr> queues;
+  std::vector<std::thread> feeders;
+  MPSC_Ring<std::pair<System *, gr::message::sptr>> ready;
+  int wake_pipe[2];
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,270 @@
+#include "flowgraph_profiler.h"
+#include "recorders/recorder.h"
+#include "source.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include <gnuradio/block.h>
+#include <gnuradio/block_detail.h>
+#include <gnuradio/block_registry.h>
+#include <gnuradio/hier_block2.h>
+#include <gnuradio/high_res_timer.h>
+#include <gnuradio/prefs.h>
+#include <pmt/pmt.h>
+
+static const size_t REPORT_OWNERS = 10;
+static const size_t REPORT_BLOCKS = 20;
+
+static const char *phase_names[STARTUP_PHASE_COUNT] = {"Config Parse", "CSV Load", "Source Init", "Recorder Build", "Systems Setup", "Flowgraph Start"};
+
+bool Flowgraph_Profiler::profiling = false;
+bool Flowgraph_Profiler::counters = false;
+double Flowgraph_Profiler::phase_seconds[STARTUP_PHASE_COUNT] = {0};
+gr::top_block_sptr Flowgraph_Profiler::top_block;
+std::vector<Source *> *Flowgraph_Profiler::profiled_sources = NULL;
+std::chrono::steady_clock::time_point Flowgraph_Profiler::run_started;
+std::chrono::steady_clock::time_point Flowgraph_Profiler::last_report;
+std::map<std::string, double> Flowgraph_Profiler::run_work_ticks;
+std::map<std::string, double> Flowgraph_Profiler::report_work_ticks;
+std::map<Recorder *, std::vector<std::string>> Flowgraph_Profiler::recorder_aliases;
+
+// The performance counters are read when the flowgraph starts, so this
+// has to be called before it is
+void Flowgraph_Profiler::enable() {
+  profiling = true;
+  enable_counters();
+  BOOST_LOG_TRIVIAL(info) << "Profiling the flowgraph, a report will be printed with the status and at shutdown";
+}
+
+bool Flowgraph_Profiler::enabled() {
+  return profiling;
+}
+
+void Flowgraph_Profiler::enable_counters() {
+  counters = true;
+  gr::prefs::singleton()->set_bool("PerfCounters", "on", true);
+}
+
+bool Flowgraph_Profiler::counters_enabled() {
+  return counters;
+}
+
+void Flowgraph_Profiler::add_phase_time(Startup_Phase phase, double seconds) {
+  phase_seconds[phase] += seconds;
+}
+
+double Flowgraph_Profiler::get_phase_time(Startup_Phase phase) {
+  return phase_seconds[phase];
+}
+
+void Flowgraph_Profiler::start(gr::top_block_sptr tb, std::vector<Source *> &sources) {
+  if (!counters) {
+    return;
+  }
+  top_block = tb;
+  profiled_sources = &sources;
+  run_started = std::chrono::steady_clock::now();
+  last_report = run_started;
+  if (profiling) {
+    print_startup();
+  }
+}
+
+void Flowgraph_Profiler::print_report() {
+  if (profiling && top_block) {
+    print_report(false);
+  }
+}
+
+void Flowgraph_Profiler::stop() {
+  if (profiling && top_block) {
+    print_startup();
+    print_report(true);
+  }
+  top_block.reset();
+}
+
+// Totals for the whole run. The samples are counted where the most come
+// out of any one block of the recorder, which is the channelizer, and it
+// only puts them out while the recorder is enabled.
+void Flowgraph_Profiler::update_recorder_cpu() {
+  if (!top_block) {
+    return;
+  }
+  double tps = gr::high_res_timer_tps();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_started).count();
+  for (std::vector<Source *>::iterator it = profiled_sources->begin(); it != profiled_sources->end(); ++it) {
+    std::vector<Recorder *> recorders = (*it)->get_recorders();
+    for (std::vector<Recorder *>::iterator rx = recorders.begin(); rx != recorders.end(); ++rx) {
+      double ticks = 0;
+      uint64_t samples = 0;
+      std::vector<std::string> aliases = recorder_blocks(*rx);
+      for (std::vector<std::string>::iterator alias = aliases.begin(); alias != aliases.end(); ++alias) {
+        gr::basic_block_sptr found;
+        try {
+          found = gr::global_block_registry.block_lookup(pmt::intern(*alias));
+        } catch (std::exception const &e) {
+          continue;
+        }
+        gr::block *block = dynamic_cast<gr::block *>(found.get());
+        if (!block || !block->detail()) {
+          continue;
+        }
+        ticks += block->pc_work_time_total();
+        if (block->detail()->noutputs() > 0) {
+          samples = std::max(samples, block->nitems_written(0));
+        }
+      }
+      double work_seconds = ticks / tps;
+      (*rx)->set_cpu_stats(work_seconds, samples, (seconds > 0) ? work_seconds / seconds : 0);
+    }
+  }
+}
+
+void Flowgraph_Profiler::print_startup() {
+  double total = 0;
+  std::stringstream phases;
+  phases << std::fixed << std::setprecision(2);
+  for (int i = 0; i < STARTUP_PHASE_COUNT; i++) {
+    phases << (i ? ", " : "") << phase_names[i] << ": " << phase_seconds[i] << " sec";
+    total += phase_seconds[i];
+  }
+  BOOST_LOG_TRIVIAL(info) << "Profile - Startup: " << std::fixed << std::setprecision(2) << total << " sec - " << phases.str();
+}
+
+// What a recorder is made of, once it is flattened down to the blocks
+// that do the work, from the labels of its dot graph
+std::vector<std::string> Flowgraph_Profiler::recorder_blocks(Recorder *recorder) {
+  std::map<Recorder *, std::vector<std::string>>::iterator cached = recorder_aliases.find(recorder);
+  if (cached != recorder_aliases.end()) {
+    return cached->second;
+  }
+
+  std::vector<std::string> aliases;
+  gr::hier_block2 *hier = dynamic_cast<gr::hier_block2 *>(recorder);
+  if (hier) {
+    try {
+      std::string dot = gr::dot_graph(hier->to_hier_block2());
+      const std::string label = "label=\"";
+      for (size_t pos = dot.find(label); pos != std::string::npos; pos = dot.find(label, pos)) {
+        pos += label.size();
+        size_t end = dot.find('"', pos);
+        if (end == std::string::npos) {
+          break;
+        }
+        aliases.push_back(dot.substr(pos, end - pos));
+      }
+    } catch (std::exception const &e) {
+      BOOST_LOG_TRIVIAL(debug) << "Unable to list the blocks of Recorder " << recorder->get_num() << ": " << e.what();
+    }
+  }
+  recorder_aliases[recorder] = aliases;
+  return aliases;
+}
+
+std::map<std::string, std::string> Flowgraph_Profiler::block_owners() {
+  std::map<std::string, std::string> owners;
+  for (std::vector<Source *>::iterator it = profiled_sources->begin(); it != profiled_sources->end(); ++it) {
+    Source *source = *it;
+    std::string source_label = "Source " + std::to_string(source->get_num());
+    if (source->get_src_block()) {
+      owners[source->get_src_block()->alias()] = source_label;
+    }
+
+    std::vector<Recorder *> recorders = source->get_recorders();
+    for (std::vector<Recorder *>::iterator rx = recorders.begin(); rx != recorders.end(); ++rx) {
+      std::stringstream label;
+      label << source_label << " [ " << std::setw(2) << (*rx)->get_num() << " ] " << (*rx)->get_type_string();
+      std::vector<std::string> aliases = recorder_blocks(*rx);
+      for (std::vector<std::string>::iterator alias = aliases.begin(); alias != aliases.end(); ++alias) {
+        owners[*alias] = label.str();
+      }
+    }
+  }
+  return owners;
+}
+
+// The blocks of the running flowgraph and how much of a core each has
+// used over seconds, from how far its work time has gone since it was last
+// looked at
+std::vector<Flowgraph_Profiler::Block_Profile> Flowgraph_Profiler::sample(double seconds, std::map<std::string, double> &since) {
+  std::set<std::string> aliases;
+  std::istringstream edges(top_block->edge_list());
+  std::string edge;
+  while (std::getline(edges, edge)) {
+    size_t arrow = edge.find("->");
+    if (arrow == std::string::npos) {
+      continue;
+    }
+    std::string src = edge.substr(0, arrow);
+    std::string dst = edge.substr(arrow + 2);
+    aliases.insert(src.substr(0, src.rfind(':')));
+    aliases.insert(dst.substr(0, dst.rfind(':')));
+  }
+
+  std::map<std::string, std::string> owners = block_owners();
+  double tps = gr::high_res_timer_tps();
+  std::vector<Block_Profile> profiles;
+  for (std::set<std::string>::iterator it = aliases.begin(); it != aliases.end(); ++it) {
+    gr::basic_block_sptr found;
+    try {
+      found = gr::global_block_registry.block_lookup(pmt::intern(*it));
+    } catch (std::exception const &e) {
+      continue;
+    }
+    gr::block *block = dynamic_cast<gr::block *>(found.get());
+    if (!block) {
+      continue;
+    }
+
+    double ticks = block->pc_work_time_total();
+    double &last = since[*it];
+    Block_Profile profile;
+    profile.alias = *it;
+    std::map<std::string, std::string>::iterator owner = owners.find(*it);
+    profile.owner = (owner != owners.end()) ? owner->second : "-";
+    profile.core_share = (seconds > 0) ? (ticks - last) / tps / seconds : 0;
+    profile.work_time_avg_us = block->pc_work_time_avg() / tps * 1e6;
+    profile.throughput_avg = block->pc_throughput_avg();
+    last = ticks;
+    profiles.push_back(profile);
+  }
+
+  std::sort(profiles.begin(), profiles.end(), [](const Block_Profile &a, const Block_Profile &b) { return a.core_share > b.core_share; });
+  return profiles;
+}
+
+void Flowgraph_Profiler::print_report(bool whole_run) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - (whole_run ? run_started : last_report)).count();
+  std::vector<Block_Profile> profiles = sample(seconds, whole_run ? run_work_ticks : report_work_ticks);
+  if (!whole_run) {
+    last_report = now;
+  }
+
+  std::map<std::string, std::pair<double, int>> owner_totals;
+  double total = 0;
+  for (std::vector<Block_Profile>::iterator it = profiles.begin(); it != profiles.end(); ++it) {
+    std::pair<double, int> &owner = owner_totals[it->owner];
+    owner.first += it->core_share;
+    owner.second++;
+    total += it->core_share;
+  }
+  std::vector<std::pair<std::string, std::pair<double, int>>> owners(owner_totals.begin(), owner_totals.end());
+  std::sort(owners.begin(), owners.end(), [](const std::pair<std::string, std::pair<double, int>> &a, const std::pair<std::string, std::pair<double, int>> &b) { return a.second.first > b.second.first; });
+
+  BOOST_LOG_TRIVIAL(info) << "Profile - " << (whole_run ? "Whole Run" : "Since Last Report") << ": " << std::fixed << std::setprecision(0) << seconds << " sec, " << profiles.size() << " Blocks using " << std::setprecision(1) << total * 100 << "% of a Core";
+  BOOST_LOG_TRIVIAL(info) << "  Recorders & Sources by CPU: ";
+  for (size_t i = 0; (i < owners.size()) && (i < REPORT_OWNERS); i++) {
+    BOOST_LOG_TRIVIAL(info) << "\t" << std::fixed << std::setprecision(1) << std::setw(6) << owners[i].second.first * 100 << "%\t" << owners[i].first << " (" << owners[i].second.second << " Blocks)";
+  }
+  BOOST_LOG_TRIVIAL(info) << "  Blocks by CPU: ";
+  for (size_t i = 0; (i < profiles.size()) && (i < REPORT_BLOCKS); i++) {
+    const Block_Profile &profile = profiles[i];
+    BOOST_LOG_TRIVIAL(info) << "\t" << std::fixed << std::setprecision(1) << std::setw(6) << profile.core_share * 100 << "%\t" << std::left << std::setw(32) << profile.alias << std::right << " Work Avg: " << std::setw(8) << profile.work_time_avg_us << " us\tThroughput Avg: " << std::setprecision(0) << std::setw(10) << profile.throughput_avg << " items/sec\t" << profile.owner;
+  }
+}
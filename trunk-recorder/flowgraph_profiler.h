@@ -0,0 +1,98 @@
+#ifndef FLOWGRAPH_PROFILER_H
+#define FLOWGRAPH_PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gnuradio/top_block.h>
+
+class Recorder;
+class Source;
+
+enum Startup_Phase {
+  STARTUP_CONFIG_PARSE,
+  STARTUP_CSV_LOAD,
+  STARTUP_SOURCE_INIT,
+  STARTUP_RECORDER_BUILD,
+  STARTUP_SYSTEMS_SETUP,
+  STARTUP_FLOWGRAPH_START,
+  STARTUP_PHASE_COUNT
+};
+
+/*
+ * Flowgraph_Profiler
+ *   Where the time goes, for --profile: how long each part of startup
+ *   took, and how much of a core each block of the flowgraph has been
+ *   using, ranked, so a recorder chain eating a core can be found without
+ *   an external profiler.
+ *
+ * The block numbers come from GNU Radio's performance counters, which
+ * enable() turns on before the flowgraph starts. The blocks are the ones
+ * in the flattened flowgraph, and each is put down to the Recorder it is
+ * part of. A report is printed with the status, covering the time since
+ * the last one, and at shutdown, covering the whole run.
+ *
+ * The startup phases are always timed, they are only printed when
+ * profiling. Everything runs on the main thread.
+ *
+ * The counters can also be turned on without the report, with
+ * recorderCpuStats, for the CPU accounting of each Recorder:
+ * update_recorder_cpu() adds up the blocks of each one and hands the
+ * totals to it, for print_recorders() and the plugins.
+ */
+class Flowgraph_Profiler {
+public:
+  // Adds the time since it was made to a Startup_Phase
+  class Phase_Timer {
+  public:
+    Phase_Timer(Startup_Phase phase) : phase(phase), started(std::chrono::steady_clock::now()) {}
+    ~Phase_Timer() { add_phase_time(phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count()); }
+
+  private:
+    Startup_Phase phase;
+    std::chrono::steady_clock::time_point started;
+  };
+
+  static void enable();
+  static bool enabled();
+  static void enable_counters();
+  static bool counters_enabled();
+  static void add_phase_time(Startup_Phase phase, double seconds);
+  static double get_phase_time(Startup_Phase phase);
+
+  static void start(gr::top_block_sptr tb, std::vector<Source *> &sources);
+  static void print_report();
+  static void update_recorder_cpu();
+  static void stop();
+  // The aliases of the blocks a Recorder is made of, also for the Memory_Report
+  static std::vector<std::string> recorder_blocks(Recorder *recorder);
+
+private:
+  struct Block_Profile {
+    std::string alias;
+    std::string owner;
+    double core_share;
+    double work_time_avg_us;
+    double throughput_avg;
+  };
+
+  static void print_startup();
+  static void print_report(bool whole_run);
+  static std::vector<Block_Profile> sample(double seconds, std::map<std::string, double> &since);
+  static std::map<std::string, std::string> block_owners();
+
+  static bool profiling;
+  static bool counters;
+  static double phase_seconds[STARTUP_PHASE_COUNT];
+  static gr::top_block_sptr top_block;
+  static std::vector<Source *> *profiled_sources;
+  static std::chrono::steady_clock::time_point run_started;
+  static std::chrono::steady_clock::time_point last_report;
+  static std::map<std::string, double> run_work_ticks;
+  static std::map<std::string, double> report_work_ticks;
+  static std::map<Recorder *, std::vector<std::string>> recorder_aliases;
+};
+
+#endif // FLOWGRAPH_PROFILER_H
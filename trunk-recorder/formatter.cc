@@ -1,5 +1,6 @@
 #include "formatter.h"
 #include <boost/lexical_cast.hpp>
+#include <stdio.h>
 
 int frequency_format = 0;
 bool statusAsString = true;
@@ -43,6 +44,10 @@ std::string format_state(State state, MonitoringState monitoringState) {
           case ENCRYPTED:    ss << ": " << Color::RED << "ENCRYPTED" << Color::RST; break;
           case DUPLICATE:    ss << ": " << Color::CYN << "DUPLICATE" << Color::RST; break;
           case SUPERSEDED:   ss << ": " << Color::CYN << "SUPERSEDED" << Color::RST; break;
+          case BACKLOG:      ss << ": " << Color::YEL << "CONCLUDER BACKLOG" << Color::RST; break;
+          case REMOTE:       ss << ": " << Color::GRN << "VOICE NODE" << Color::RST; break;
+          case PREEMPTED:    ss << ": " << Color::YEL << "PREEMPTED" << Color::RST; break;
+          case ADMISSION:    ss << ": " << Color::YEL << "OVER CPU BUDGET" << Color::RST; break;
           default: break;  // UNSPECIFIED
         }
         break;
@@ -61,9 +66,20 @@ std::string format_state(State state, MonitoringState monitoringState) {
   return boost::lexical_cast<std::string>(state);
 }
 
-std::string log_header(std::string short_name,long call_num, std::string talkgroup_display, double freq) {
-  std::stringstream ss;
-  ss << "[" << short_name << "]\t" << Color::BLU << call_num << "C" << Color::RST 
-     << "\tTG: " << talkgroup_display << "\tFreq: " << format_freq(freq) << "\t";
-  return ss.str();
+// Put together with appends and snprintf rather than a stringstream and
+// format_freq()'s boost::format, it goes in front of most of the log lines
+std::string log_header(const std::string &short_name, long call_num, const std::string &talkgroup_display, double freq) {
+  char freq_str[32];
+  if (frequency_format == 1)
+    snprintf(freq_str, sizeof(freq_str), "%10.6f MHz", freq / 1000000.0);
+  else if (frequency_format == 2)
+    snprintf(freq_str, sizeof(freq_str), "%.0f Hz", freq);
+  else
+    snprintf(freq_str, sizeof(freq_str), "%e", freq);
+
+  std::string header;
+  header.reserve(short_name.size() + talkgroup_display.size() + 80);
+  header.append("[").append(short_name).append("]\t").append(Color::BLU).append(std::to_string(call_num)).append("C").append(Color::RST);
+  header.append("\tTG: ").append(talkgroup_display).append("\tFreq: ").append(freq_str).append("\t");
+  return header;
 }
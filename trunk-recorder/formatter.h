@@ -32,7 +32,7 @@ extern boost::format FormatSamplingRate(float f);
 extern boost::format format_time(float f);
 extern std::string format_state(State state, MonitoringState monitoringState = UNSPECIFIED);
 std::string get_frequency_format();
-extern std::string log_header(std::string short_name,long call_num, std::string talkgroup_display, double freq);
+extern std::string log_header(const std::string &short_name, long call_num, const std::string &talkgroup_display, double freq);
 extern int frequency_format;
 extern bool statusAsString;
 
@@ -2,17 +2,36 @@
 #define GLOBAL_STRUCTS_H
 #include <cstdint>
 #include <ctime>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <json.hpp>
 
 const int DB_UNSET = 999;
 
+struct Transmission_Audio;
+class Upload_Engine;
+namespace gr {
+namespace blocks {
+struct signal_decoder_plugin;
+}
+}
+
+// Silence cut out of a transmission, at position seconds into the audio
+// that was kept
+struct Silence_Span {
+  double position;
+  double length;
+};
+
 struct Transmission {
   long source;
   long talkgroup;
   unsigned int slot;
   unsigned int color_code;
+  int dcs_code; // -1 if none; decimal DCS code, plus 1000 when inverted
+  double ctcss_tone; // 0 if none; CTCSS tone in Hz
   long start_time;
   long stop_time;
   std::int64_t start_time_ms;
@@ -20,9 +39,13 @@ struct Transmission {
   long sample_count;
   long spike_count;
   long error_count;
+  int peak; // largest absolute 16 bit sample, -1 if not known
   double freq;
   double length;
+  double silence_removed; // seconds of silence cut out, not in length
+  std::vector<Silence_Span> silence_list;
   std::string filename;
+  std::shared_ptr<Transmission_Audio> audio; // the samples, if they were kept in memory instead of in filename
 };
 
 struct Config {
@@ -31,6 +54,9 @@ struct Config {
   std::string upload_server;
   std::string bcfy_calls_server;
   std::string status_server;
+  bool status_calls_delta;
+  std::string status_format;
+  size_t status_send_buffer;
   std::string instance_key;
   std::string instance_id;
   std::string capture_dir;
@@ -41,22 +67,195 @@ struct Config {
   bool new_call_from_update;
   bool debug_recorder;
   int debug_recorder_port;
+  int debug_recorder_payload;
+  std::string debug_recorder_format;
+  bool debug_recorder_seq_num;
+  bool debug_recorder_zerocopy;
   double call_timeout;
   bool console_log;
   bool log_file;
+  bool log_async;
   bool syslog_friendly;
   std::string log_color;
   int control_message_warn_rate;
   int control_retune_limit;
+  int source_reopen_limit;
+  bool control_channel_hunt;
   bool broadcast_signals;
   bool enable_audio_streaming;
+  bool tone_scan;
+  int tone_scan_interval;
+  std::string occupancy_file;
+  int occupancy_interval;
+  std::string unit_activity_file; // "" for no Unit_Activity
+  int unit_activity_mb;
+  std::map<std::string, int> recorder_buffer_items; // by recorder type, see Source::get_recorder_buffer_items()
+  bool system_workers;
+  std::string cluster_role;    // "control" or "voice", "" for a host of its own
+  int cluster_port;
+  std::string cluster_control; // host:port of the control node, for a voice node
+  int control_api_port;        // 0 for no Control API
+  std::string control_api_address;
+  std::string control_channel_capture;
+  std::string table_cache_dir;
+  std::string state_checkpoint_dir;
+  int state_checkpoint_interval;
+  bool parallel_source_startup;
+  bool single_branch_recorders;
+  bool digital_recorder_qpsk; // the modulation single branch recorders are built for
+  bool fused_analog_audio;
+  bool share_tdma_slots;
+  bool preempt_calls;
+  std::string recorder_thread_model;
+  bool recorder_cpu_stats;
+  bool latency_tracing;
+  std::string trace_file;
+  double multi_site_window;
+  bool decoder_thread;
   bool soft_vocoder;
   bool record_uu_v_calls;
   bool archive_files_on_failure;
+  bool archive_segments;
+  double archive_sync_seconds;
+  double recent_calls_hours; // 0 for no Recent_Calls
+  bool retry_journal;
+  double retry_rate;
+  double wav_buffer_seconds;
+  bool wav_mmap;
+  bool memory_transmissions;
+  double memory_spill_seconds;
+  bool streaming_encoder;
+  std::string sigmf_format;
+  std::string sigmf_compression;
+  bool sigmf_direct_io;
+  int call_concluder_threads;
+  long upload_connections_per_host;
+  Upload_Engine *upload_engine;
+  // gr::blocks::register_signal_decoder() of the core, for the plugins
+  uint32_t (*register_signal_decoder)(const gr::blocks::signal_decoder_plugin &plugin);
+  int vocoder_threads;
+  double backlog_max_seconds;
+  double backlog_max_mb;
+  double admission_cpu_budget; // percent of all the cores, 0 for no Admission_Control
+  double admission_defer_seconds;
   int frequency_format;
   std::string filename_format;
 };
 
+struct Tone_Scan_Result {
+  std::string short_name;
+  double freq;
+  long talkgroup;
+  long windows;                         // 1 s analysis windows scanned
+  std::string best_tone;                // Tone column syntax, e.g. "131.8" or "D023N"; empty if none seen
+  long best_count;                      // windows in which best_tone was present
+  std::map<std::string, long> histogram; // windows in which each tone/code was present
+};
+
+// Points in a trunked call's life that are timestamped, in order
+enum Call_Latency_Stage {
+  LATENCY_GRANT,          // the Call was made for a GRANT
+  LATENCY_RECORDER_START, // start_recorder() was called for it
+  LATENCY_RETUNE,         // the recorder was tuned to the voice channel
+  LATENCY_FIRST_FRAME,    // the first decoded audio reached the transmission_sink
+  LATENCY_FIRST_WRITE,    // the wav file was made and ready for samples
+  LATENCY_STAGE_COUNT
+};
+
+struct Latency_Summary {
+  long count;
+  double p50_ms;
+  double p90_ms;
+  double p99_ms;
+  double max_ms;
+};
+
+struct Call_Latency_Stats {
+  std::string type; // "system" or "source"
+  std::string name; // System short name, or Source number
+  long calls;       // recorded calls concluded
+  long no_audio;    // of those, calls that never wrote a sample
+  Latency_Summary grant_to_start;
+  Latency_Summary start_to_retune;
+  Latency_Summary retune_to_frame;
+  Latency_Summary frame_to_write;
+  Latency_Summary grant_to_write;
+  long pre_tuned;   // of those, calls whose recorder was already on the channel
+  Latency_Summary pre_tuned_grant_to_write;
+  Latency_Summary retuned_grant_to_write;
+};
+
+// What the Wav_Writer has done for the recorders on one Source
+struct Wav_Writer_Stats {
+  int source_num;        // -1 for transmissions from recorders without a Source
+  long files_opened;
+  long files_open;       // right now
+  long open_failures;
+  long long bytes_written;
+  long dropped_samples;  // the Wav_Writer was too far behind to take them
+  long orphaned_samples; // arrived when the transmission_sink had no call to record them for
+  Latency_Summary open;
+  Latency_Summary write;
+  Latency_Summary close;
+};
+
+// How far behind the Call_Concluder is
+struct Concluder_Load {
+  long calls_pending;      // queued or being concluded
+  int workers_busy;
+  long long bytes_pending; // audio of those calls, in the temp dir or memory
+  double oldest_seconds;   // since the longest waiting of them was queued
+  double level;            // the larger of oldest_seconds and bytes_pending over their limits, 0 without limits
+};
+
+// What a voice channel, talkgroup or System was used for over an interval,
+// see Channel_Occupancy
+struct Occupancy_Counts {
+  long grants;    // calls started
+  double airtime; // seconds
+  int peak;       // most calls at once
+};
+
+struct Channel_Occupancy_Stats {
+  double freq;   // 0 for the channels a full table couldn't keep apart
+  int tdma_slot;
+  Occupancy_Counts counts;
+};
+
+struct Talkgroup_Occupancy_Stats {
+  long talkgroup; // -1 for the talkgroups a full table couldn't keep apart
+  Occupancy_Counts counts;
+};
+
+struct System_Occupancy_Stats {
+  std::string short_name;
+  time_t time;             // the end of the interval
+  double interval;         // seconds
+  Occupancy_Counts counts; // airtime summed over the channels
+  std::vector<Channel_Occupancy_Stats> channels;
+  std::vector<Talkgroup_Occupancy_Stats> talkgroups;
+};
+
+// What a part of Trunk Recorder is holding in memory, see Memory_Report
+struct Memory_Usage {
+  std::string subsystem; // "GNU Radio", "Wav Writer", "Tables"...
+  std::string name;      // what in it, like "P25 recorders" or a System's talkgroups
+  long count;            // recorders, buffers, rows...
+  long long bytes;
+};
+
+struct Memory_Stats {
+  long long rss_bytes;       // resident set of the process
+  long long accounted_bytes; // the usage added up
+  std::vector<Memory_Usage> usage;
+};
+
+// How long the Call_Concluder has taken over one step of concluding calls
+struct Concluder_Stage_Stats {
+  std::string stage;
+  Latency_Summary latency;
+};
+
 struct Call_Source {
   long source;
   long time;
@@ -98,6 +297,27 @@ enum Recorder_Type { DEBUG,
                       DMR,
                       SMARTNET };
 
+// How start_recorder() picked the Source for a call, kept for capacity analysis
+struct Source_Allocation {
+  int candidates;     // Sources covering the call's freq
+  int free_recorders; // free recorders of the call's type on the chosen Source
+  double load;        // 0 idle to 1 saturated
+  double edge;        // 0 at the band edge to 1 at the center
+  double score;
+};
+
+// A grant for a Multi-Site call from another site, that wasn't recorded
+struct Duplicate_Grant {
+  std::string short_name; // the other site's System
+  int sys_num;
+  unsigned long nac;
+  unsigned long rfss_site; // RRRRssss
+  long source;             // the unit in the grant
+  std::int64_t time_ms;
+  int decode_rate; // the other site's control channel, in msg/sec
+  bool superseded; // the other site was recording and this site took the call over
+};
+
 struct Call_Data_t {
   long talkgroup;
   long color_code;
@@ -107,11 +327,14 @@ struct Call_Data_t {
   std::string talkgroup_description;
   std::string talkgroup_display;
   std::string talkgroup_group;
+  int talkgroup_priority;
   long call_num;
   double freq;
   int freq_error;
   int source_num;
   int recorder_num;
+  Source_Allocation source_allocation;
+  std::vector<Duplicate_Grant> duplicate_grants;
   double signal;
   double noise;
   long start_time;
@@ -133,6 +356,8 @@ struct Call_Data_t {
   std::string filename;
   std::string status_filename;
   std::string converted;
+  std::string encoded_filename; // m4a from the streaming encoder, if it still matches the call's audio
+  std::shared_ptr<const std::string> converted_audio; // the contents of converted, shared by every copy so the uploaders don't read the file; may be NULL
   int min_transmissions_removed;
 
   int sys_num;
@@ -147,6 +372,7 @@ struct Call_Data_t {
 
   std::vector<Call_Source> transmission_source_list;
   std::vector<Call_Error> transmission_error_list;
+  std::vector<Silence_Span> silence_list; // positions in the call's audio
   std::vector<Transmission> transmission_list;
 
   Call_Data_Status status;
@@ -154,7 +380,7 @@ struct Call_Data_t {
   int retry_attempt;
 
   std::vector<int> plugin_retry_list;
-  nlohmann::ordered_json call_json;
+  std::shared_ptr<const std::string> call_json; // the status file as written, shared by every copy; nlohmann::json::parse() it for the values
 };
 
 #endif
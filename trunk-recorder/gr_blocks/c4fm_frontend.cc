@@ -0,0 +1,91 @@
+#include "c4fm_frontend.h"
+#include "filter_taps.h"
+
+#include <algorithm>
+#include <gnuradio/math.h>
+#include <math.h>
+#include <string.h>
+#include <volk/volk.h>
+
+c4fm_frontend_sptr make_c4fm_frontend(double channel_rate, double symbol_rate) {
+  return gnuradio::get_initial_sptr(new c4fm_frontend(channel_rate, symbol_rate));
+}
+
+c4fm_frontend::c4fm_frontend(double channel_rate, double symbol_rate)
+    : gr::sync_block("c4fm_frontend",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(1, 1, sizeof(float))),
+      d_phase(0), d_freq(0) {
+  // The same loop and filters the recorders built out of separate blocks
+  const double freq_to_norm_radians = M_PI / (channel_rate / 2.0);
+  const double fc = 0.0;
+  const double fd = 600.0;
+  const double loop_bw = (symbol_rate / 2.0 * 1.2) * freq_to_norm_radians;
+  const double damping = sqrt(2.0) / 2.0;
+  const double denom = 1.0 + 2.0 * damping * loop_bw + loop_bw * loop_bw;
+  d_alpha = (4 * damping * loop_bw) / denom;
+  d_beta = (4 * loop_bw * loop_bw) / denom;
+  d_max_freq = (fc + (3 * fd * 1.9)) * freq_to_norm_radians;
+  d_min_freq = (fc + (-3 * fd * 1.9)) * freq_to_norm_radians;
+  d_gain = 1.0 / (fd * freq_to_norm_radians);
+
+  const std::vector<float> &noise_taps = *Filter_Taps::low_pass_2(1.0, channel_rate, symbol_rate / 2.0 * 1.175, symbol_rate / 2.0 * 0.125, 20.0, Filter_Taps::KAISER, 6.76);
+
+  // The symbol filter is a moving average over one symbol
+  const int samples_per_symbol = (int)lrint(channel_rate / symbol_rate);
+  std::vector<float> taps(noise_taps.size() + samples_per_symbol - 1, 0.0f);
+  for (size_t i = 0; i < noise_taps.size(); i++) {
+    for (int j = 0; j < samples_per_symbol; j++) {
+      taps[i + j] += noise_taps[i] / samples_per_symbol;
+    }
+  }
+  d_taps.assign(taps.rbegin(), taps.rend());
+  d_baseband.assign(d_taps.size() - 1 + TILE, 0.0f);
+}
+
+int c4fm_frontend::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  float *out = (float *)output_items[0];
+  const size_t history = d_taps.size() - 1;
+  float *baseband = d_baseband.data();
+
+  for (int done = 0; done < noutput_items; done += TILE) {
+    const int count = std::min(TILE, noutput_items - done);
+
+    // pll_freqdet_cf: the output is the loop's frequency before it takes
+    // the sample in
+    float *tile = baseband + history;
+    for (int i = 0; i < count; i++) {
+      tile[i] = d_freq * d_gain;
+      const gr_complex &sample = in[done + i];
+      float error = gr::fast_atan2f(sample.imag(), sample.real()) - d_phase;
+      if (error > GR_M_PI) {
+        error -= 2.0 * GR_M_PI;
+      } else if (error < -GR_M_PI) {
+        error += 2.0 * GR_M_PI;
+      }
+      d_freq = d_freq + d_beta * error;
+      d_phase = d_phase + d_freq + d_alpha * error;
+      while (d_phase > (2.0 * GR_M_PI)) {
+        d_phase -= 2.0 * GR_M_PI;
+      }
+      while (d_phase < (-2.0 * GR_M_PI)) {
+        d_phase += 2.0 * GR_M_PI;
+      }
+      if (d_freq > d_max_freq) {
+        d_freq = d_max_freq;
+      } else if (d_freq < d_min_freq) {
+        d_freq = d_min_freq;
+      }
+    }
+
+    for (int i = 0; i < count; i++) {
+      volk_32f_x2_dot_prod_32f(&out[done + i], baseband + i, d_taps.data(), d_taps.size());
+    }
+    memmove(baseband, baseband + count, history * sizeof(float));
+  }
+
+  return noutput_items;
+}
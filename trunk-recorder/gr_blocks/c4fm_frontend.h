@@ -0,0 +1,58 @@
+#ifndef INCLUDED_C4FM_FRONTEND_H
+#define INCLUDED_C4FM_FRONTEND_H
+
+#include <vector>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+// The front of a C4FM (P25 Phase 1 and DMR) demodulator in one block: the
+// PLL frequency discriminator, its gain, the baseband noise filter and the
+// symbol filter. It used to be four blocks, pll_freqdet_cf,
+// multiply_const_ff, fft_filter_fff and fir_filter_fff, each with its own
+// thread and buffer, for each recorder.
+//
+// The noise and symbol filters are both FIRs with no decimation, so they
+// are run as the one FIR they add up to. The discriminator goes through a
+// tile of samples into a buffer that stays in cache, and each output is a
+// VOLK dot product over it. The output is the discriminator's frequency,
+// scaled so the outer symbols are +/-3, at the channel rate, for
+// fsk4_demod_ff to recover the symbols from.
+
+class c4fm_frontend;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<c4fm_frontend> c4fm_frontend_sptr;
+#else
+typedef std::shared_ptr<c4fm_frontend> c4fm_frontend_sptr;
+#endif
+
+c4fm_frontend_sptr make_c4fm_frontend(double channel_rate, double symbol_rate);
+
+class c4fm_frontend : public gr::sync_block {
+
+  friend c4fm_frontend_sptr make_c4fm_frontend(double channel_rate, double symbol_rate);
+
+  static const int TILE = 2048;
+
+  // pll_freqdet_cf's control loop
+  float d_phase;
+  float d_freq;
+  float d_alpha;
+  float d_beta;
+  float d_max_freq;
+  float d_min_freq;
+  float d_gain;
+
+  std::vector<float> d_taps;     // noise filter convolved with the symbol filter, reversed
+  std::vector<float> d_baseband; // the last ntaps - 1 discriminator outputs, then a tile
+
+  c4fm_frontend(double channel_rate, double symbol_rate);
+
+public:
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
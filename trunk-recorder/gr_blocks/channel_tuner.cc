@@ -0,0 +1,85 @@
+#include "channel_tuner.h"
+#include "filter_taps.h"
+
+#include <boost/log/trivial.hpp>
+#include <cmath>
+
+channel_tuner::Decim channel_tuner::two_stage_decim(long speed, const std::vector<long> &if_freqs) {
+  Decim decim_settings = {-1, -1};
+  for (size_t i = 0; i < if_freqs.size(); i++) {
+    long if_freq = if_freqs[i];
+    if (speed % if_freq != 0) {
+      continue;
+    }
+    long q = speed / if_freq;
+    if (q & 1) {
+      continue;
+    }
+
+    if ((q >= 40) && ((q & 3) == 0)) {
+      decim_settings.decim = q / 4;
+      decim_settings.decim2 = 4;
+    } else {
+      decim_settings.decim = q / 2;
+      decim_settings.decim2 = 2;
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Channel Tuner Decim: " << decim_settings.decim << " Decim2:  " << decim_settings.decim2;
+    return decim_settings;
+  }
+  BOOST_LOG_TRIVIAL(debug) << "Channel Tuner Decim: Nothing found";
+  return decim_settings;
+}
+
+channel_tuner::sptr channel_tuner::make(double input_rate, long decim) {
+  return gnuradio::get_initial_sptr(new channel_tuner(input_rate, decim));
+}
+
+channel_tuner::channel_tuner(double input_rate, long decim)
+    : gr::hier_block2("channel_tuner",
+                      gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                      gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_input_rate(input_rate) {
+
+  if (decim > 1) {
+    // The bandpass filter the channel was taken out with, now put on the
+    // channel by freq_xlating_fft_filter, which also turns it down to 0 Hz
+    long if1 = input_rate / decim;
+    Filter_Taps::Complex bandpass_filter_coeffs = Filter_Taps::complex_band_pass(1.0, input_rate, -if1 / 2, if1 / 2, if1 / 2);
+    freq_xlat = make_freq_xlating_fft_filter(decim, *bandpass_filter_coeffs, 0, input_rate);
+    connect(self(), 0, freq_xlat, 0);
+    connect(freq_xlat, 0, self(), 0);
+  } else {
+    rotator = make_gated_rotator_cc(0);
+    connect(self(), 0, rotator, 0);
+    connect(rotator, 0, self(), 0);
+  }
+}
+
+void channel_tuner::tune_offset(double f) {
+  if (rotator) {
+    rotator->set_phase_inc(2.0 * M_PI * f / d_input_rate);
+  } else {
+    freq_xlat->set_center_freq(-f);
+  }
+}
+
+void channel_tuner::set_enabled(bool enabled) {
+  if (rotator) {
+    rotator->set_enabled(enabled);
+  } else {
+    freq_xlat->set_enabled(enabled);
+  }
+}
+
+bool channel_tuner::is_enabled() {
+  if (rotator) {
+    return rotator->enabled();
+  }
+  return freq_xlat->is_enabled();
+}
+
+void channel_tuner::set_nthreads(int nthreads) {
+  if (freq_xlat) {
+    freq_xlat->set_nthreads(nthreads);
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef CHANNEL_TUNER_H
+#define CHANNEL_TUNER_H
+
+#include <vector>
+
+#include "./freq_xlating_fft_filter.h"
+#include "./gated_rotator.h"
+#include <gnuradio/hier_block2.h>
+
+// The first stage of the channelizer and the debug_recorder: takes the
+// channel down to 0 Hz, and with a decimation above 1 filters it to the
+// first IF and decimates it on the way.
+//
+// Both used to tune with a sig_source_c at the full rate, or at the IF
+// after a bandpass filter, into a multiply_cc, which is two more blocks
+// and buffers for each recorder than a rotator. Here it is one block, a
+// gated_rotator_cc or a freq_xlating_fft_filter, that can also be
+// switched off in place of a valve, and retuning reuses the taps of a
+// recent frequency instead of designing new ones.
+
+class channel_tuner : public gr::hier_block2 {
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<channel_tuner> sptr;
+#else
+  typedef std::shared_ptr<channel_tuner> sptr;
+#endif
+
+  struct Decim {
+    long decim;
+    long decim2;
+  };
+
+  // Two decimations that take speed down to one of if_freqs, the second
+  // of them 2 or 4, or -1 for both if none of them fit
+  static Decim two_stage_decim(long speed, const std::vector<long> &if_freqs);
+
+  static sptr make(double input_rate, long decim);
+  channel_tuner(double input_rate, long decim);
+
+  // f is center - freq, the way the channelizers are tuned
+  void tune_offset(double f);
+  void set_enabled(bool enabled);
+  bool is_enabled();
+  void set_nthreads(int nthreads);
+
+private:
+  double d_input_rate;
+  freq_xlating_fft_filter_sptr freq_xlat;
+  gated_rotator_cc_sptr rotator;
+};
+
+#endif
@@ -13,31 +13,7 @@ const double channelizer::phase2_symbol_rate;
 const double channelizer::smartnet_symbol_rate;
 
 channelizer::DecimSettings channelizer::get_decim(long speed) {
-  long s = speed;
-  long if_freqs[] = {24000, 25000, 32000};
-  DecimSettings decim_settings = {-1, -1};
-  for (int i = 0; i < 3; i++) {
-    long if_freq = if_freqs[i];
-    if (s % if_freq != 0) {
-      continue;
-    }
-    long q = s / if_freq;
-    if (q & 1) {
-      continue;
-    }
-
-    if ((q >= 40) && ((q & 3) == 0)) {
-      decim_settings.decim = q / 4;
-      decim_settings.decim2 = 4;
-    } else {
-      decim_settings.decim = q / 2;
-      decim_settings.decim2 = 2;
-    }
-    BOOST_LOG_TRIVIAL(debug) << "P25 recorder Decim: " << decim_settings.decim << " Decim2:  " << decim_settings.decim2;
-    return decim_settings;
-  }
-  BOOST_LOG_TRIVIAL(error) << "P25 recorder Decim: Nothing found";
-  return decim_settings;
+  return channel_tuner::two_stage_decim(speed, {24000, 25000, 32000});
 }
 
 channelizer::channelizer(double input_rate, int samples_per_symbol, double symbol_rate, double center_freq, bool conventional)
@@ -56,9 +32,6 @@ channelizer::channelizer(double input_rate, int samples_per_symbol, double symbo
 
   const float pi = M_PI;
 
-  lo = gr::analog::sig_source_c::make(d_input_rate, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
-  mixer = gr::blocks::multiply_cc::make();
-
   DecimSettings decim_settings = get_decim(input_rate);
 
   if (decim_settings.decim != -1) {
@@ -69,33 +42,23 @@ channelizer::channelizer(double input_rate, int samples_per_symbol, double symbo
     long fa = 6250;
     long fb = if2 / 2;
 
-    bandpass_filter_coeffs = gr::filter::firdes::complex_band_pass(1.0, input_rate, -if1 / 2, if1 / 2, if1 / 2);
-#if GNURADIO_VERSION < 0x030900
-    lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, if1, (fb + fa) / 2, fb - fa, gr::filter::firdes::WIN_HAMMING);
-#else
-    lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, if1, (fb + fa) / 2, fb - fa, gr::fft::window::WIN_HAMMING);
-#endif
-    bandpass_filter = gr::filter::fft_filter_ccc::make(decim_settings.decim, bandpass_filter_coeffs);
-    lowpass_filter = gr::filter::fft_filter_ccf::make(decim_settings.decim2, lowpass_filter_coeffs);
+    tuner = channel_tuner::make(input_rate, decim);
+    Filter_Taps::Real lowpass_filter_coeffs = Filter_Taps::low_pass(1.0, if1, (fb + fa) / 2, fb - fa, Filter_Taps::HAMMING);
+    lowpass_filter = gr::filter::fft_filter_ccf::make(decim_settings.decim2, *lowpass_filter_coeffs);
     resampled_rate = if2;
-    BOOST_LOG_TRIVIAL(info) << "\t Channelizer two-stage decimator - Initial decimated rate: " << if1 << " Second decimated rate: " << if2 << " Resampled Rate: " << resampled_rate << " Bandpass Size: " << bandpass_filter_coeffs.size() << " Lowpass Size: " << lowpass_filter_coeffs.size();
-
-    bfo = gr::analog::sig_source_c::make(if1, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
+    BOOST_LOG_TRIVIAL(info) << "\t Channelizer two-stage decimator - Initial decimated rate: " << if1 << " Second decimated rate: " << if2 << " Resampled Rate: " << resampled_rate << " Lowpass Size: " << lowpass_filter_coeffs->size();
   } else {
     double_decim = false;
+    if1 = 0;
     long fa = 6250;
     long fb = fa + 1250;
-    lo = gr::analog::sig_source_c::make(input_rate, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
+    tuner = channel_tuner::make(input_rate, 1);
 
-#if GNURADIO_VERSION < 0x030900
-    lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, input_rate, (fb + fa) / 2, fb - fa, gr::filter::firdes::WIN_HAMMING);
-#else
-    lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, input_rate, (fb + fa) / 2, fb - fa, gr::fft::window::WIN_HAMMING);
-#endif
+    Filter_Taps::Real lowpass_filter_coeffs = Filter_Taps::low_pass(1.0, input_rate, (fb + fa) / 2, fb - fa, Filter_Taps::HAMMING);
     decim = floor(input_rate / channel_rate);
     resampled_rate = input_rate / decim;
-    lowpass_filter = gr::filter::fft_filter_ccf::make(decim, lowpass_filter_coeffs);
-    BOOST_LOG_TRIVIAL(info) << "\t Channelizer single-stage decimator - Decim: " << decim << " Resampled Rate: " << resampled_rate << " Lowpass Size: " << lowpass_filter_coeffs.size();
+    lowpass_filter = gr::filter::fft_filter_ccf::make(decim, *lowpass_filter_coeffs);
+    BOOST_LOG_TRIVIAL(info) << "\t Channelizer single-stage decimator - Decim: " << decim << " Resampled Rate: " << resampled_rate << " Lowpass Size: " << lowpass_filter_coeffs->size();
   }
 
   // ARB Resampler
@@ -112,6 +75,7 @@ channelizer::channelizer(double input_rate, int samples_per_symbol, double symbo
   // the half-band here is 0.5*rate.
   double percent = 0.80;
 
+  Filter_Taps::Real arb_taps;
   if (arb_rate <= 1) {
     double halfband = 0.5 * arb_rate;
     double bw = percent * halfband;
@@ -122,16 +86,12 @@ channelizer::channelizer(double input_rate, int samples_per_symbol, double symbo
 
 // As we drop the bw factor, the optfir filter has a harder time converging;
 // using the firdes method here for better results.
-#if GNURADIO_VERSION < 0x030900
-    arb_taps = gr::filter::firdes::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, gr::filter::firdes::WIN_BLACKMAN_HARRIS);
-#else
-    arb_taps = gr::filter::firdes::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, gr::fft::window::WIN_BLACKMAN_HARRIS);
-#endif
+    arb_taps = Filter_Taps::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, Filter_Taps::BLACKMAN_HARRIS);
   } else {
     BOOST_LOG_TRIVIAL(error) << "Something is probably wrong! Resampling rate too low";
     exit(1);
   }
-  arb_resampler = gr::filter::pfb_arb_resampler_ccf::make(arb_rate, arb_taps);
+  arb_resampler = gr::filter::pfb_arb_resampler_ccf::make(arb_rate, *arb_taps);
   double sps = d_samples_per_symbol;
   double def_excess_bw = 0.2;
   // Squelch DB
@@ -145,16 +105,8 @@ channelizer::channelizer(double input_rate, int samples_per_symbol, double symbo
   rms_agc = gr::blocks::rms_agc::make(0.45, 0.85);
   fll_band_edge = gr::digital::fll_band_edge_cc::make(sps, def_excess_bw, 2 * sps + 1, (2.0 * pi) / sps / 250); // OP25 has this set to 350 instead of 250
 
- 
-  if (double_decim) {
-    connect(self(), 0, bandpass_filter, 0);
-    connect(bandpass_filter, 0, mixer, 0);
-    connect(bfo, 0, mixer, 1);
-  } else {
-    connect(self(), 0, mixer, 0);
-    connect(lo, 0, mixer, 1);
-  }
-  connect(mixer, 0, lowpass_filter, 0);
+  connect(self(), 0, tuner, 0);
+  connect(tuner, 0, lowpass_filter, 0);
 
   if (d_conventional) {
     if (arb_rate == 1.0) {
@@ -198,22 +150,7 @@ void channelizer::tune_offset(double f) {
   if (abs(freq) > ((d_input_rate / 2) - (if1 / 2))) {
     BOOST_LOG_TRIVIAL(info) << "Channelizer - Tune Offset: Freq exceeds limit: " << abs(freq) << " compared to: " << ((d_input_rate / 2) - (if1 / 2));
   }
-  if (double_decim) {
-    bandpass_filter_coeffs = gr::filter::firdes::complex_band_pass(1.0, d_input_rate, -freq - if1 / 2, -freq + if1 / 2, if1 / 2);
-    bandpass_filter->set_taps(bandpass_filter_coeffs);
-    float bfz = (static_cast<float>(decim) * -freq) / (float)d_input_rate;
-    bfz = bfz - static_cast<int>(bfz);
-    if (bfz < -0.5) {
-      bfz = bfz + 1.0;
-    }
-    if (bfz > 0.5) {
-      bfz = bfz - 1.0;
-    }
-    bfo->set_frequency(-bfz * if1);
-
-  } else {
-    lo->set_frequency(freq);
-  }
+  tuner->tune_offset(freq);
 }
 
 void channelizer::set_squelch_db(double squelch_db) {
@@ -4,7 +4,9 @@
 #include <boost/log/trivial.hpp>
 #include <iomanip>
 
+#include "./channel_tuner.h"
 #include "./rms_agc.h"
+#include "./filter_taps.h"
 #include "./pwr_squelch_cc.h"
 #include <gnuradio/blocks/copy.h>
 #include <gnuradio/digital/fll_band_edge_cc.h>
@@ -15,13 +17,9 @@
 #include <gnuradio/hier_block2.h>
 
 #if GNURADIO_VERSION < 0x030800
-#include <gnuradio/analog/sig_source_c.h>
-#include <gnuradio/blocks/multiply_cc.h>
 #include <gnuradio/blocks/multiply_const_ff.h>
 #include <gnuradio/blocks/multiply_const_ss.h>
 #else
-#include <gnuradio/analog/sig_source.h>
-#include <gnuradio/blocks/multiply.h>
 #include <gnuradio/blocks/multiply_const.h>
 #endif
 
@@ -29,10 +27,7 @@
 
 class channelizer : public gr::hier_block2 {
 public:
-  struct DecimSettings {
-    long decim;
-    long decim2;
-  };
+  typedef channel_tuner::Decim DecimSettings;
 
 private:
   bool double_decim;
@@ -48,20 +43,13 @@ private:
   double squelch_db;
   long decim;
 
-  std::vector<float> arb_taps;
-  std::vector<gr_complex> bandpass_filter_coeffs;
-  std::vector<float> lowpass_filter_coeffs;
-  std::vector<float> cutoff_filter_coeffs;
 
   gr::analog::pwr_squelch_cc::sptr squelch;
   gr::digital::fll_band_edge_cc::sptr fll_band_edge;
   gr::blocks::rms_agc::sptr rms_agc;
 
-  gr::analog::sig_source_c::sptr lo;
-  gr::analog::sig_source_c::sptr bfo;
-  gr::blocks::multiply_cc::sptr mixer;
+  channel_tuner::sptr tuner;
 
-  gr::filter::fft_filter_ccc::sptr bandpass_filter;
   gr::filter::fft_filter_ccf::sptr lowpass_filter;
   gr::filter::fft_filter_ccf::sptr cutoff_filter;
 
@@ -0,0 +1,141 @@
+#include "cqpsk_demod.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <gnuradio/expj.h>
+#include <gnuradio/math.h>
+#include <math.h>
+#include <volk/volk.h>
+
+cqpsk_demod_sptr make_cqpsk_demod(float samples_per_symbol, float gain_mu, float gain_omega, float costas_alpha, float costas_max_phase) {
+  return gnuradio::get_initial_sptr(new cqpsk_demod(samples_per_symbol, gain_mu, gain_omega, costas_alpha, costas_max_phase));
+}
+
+cqpsk_demod::cqpsk_demod(float samples_per_symbol, float gain_mu, float gain_omega, float costas_alpha, float costas_max_phase)
+    : gr::block("cqpsk_demod",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(float))),
+      d_mu(0),
+      d_gain_omega(gain_omega),
+      d_omega_rel(0.002),
+      d_gain_mu(gain_mu),
+      d_last_sample(0),
+      d_dl_index(0),
+      d_prev_symbol(0),
+      d_phase(0), d_freq(0),
+      d_max_freq(1.0), d_min_freq(-1.0),
+      d_max_phase(costas_max_phase), d_min_phase(-costas_max_phase),
+      d_symbols(TILE) {
+  std::fill(&d_dl[0], &d_dl[DELAY_LINE], gr_complex(0, 0));
+
+  // costas_loop_cc's gains, critically damped
+  const float damping = sqrtf(2.0f) / 2.0f;
+  const float denom = (1.0 + 2.0 * damping * costas_alpha + costas_alpha * costas_alpha);
+  d_alpha = (4 * damping * costas_alpha) / denom;
+  d_beta = (4 * costas_alpha * costas_alpha) / denom;
+
+  set_omega(samples_per_symbol);
+  set_relative_rate(1.0 / d_omega);
+}
+
+void cqpsk_demod::set_omega(float omega) {
+  gr::thread::scoped_lock lock(d_mutex);
+  assert(omega >= 2.0);
+  d_omega = omega;
+  d_min_omega = omega * (1.0 - d_omega_rel);
+  d_max_omega = omega * (1.0 + d_omega_rel);
+  d_omega_mid = 0.5 * (d_min_omega + d_max_omega);
+  d_twice_sps = 2 * (int)ceilf(d_omega);
+}
+
+void cqpsk_demod::reset() {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_phase = 0;
+  d_freq = 0;
+  d_last_sample = 0;
+}
+
+void cqpsk_demod::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  std::fill(ninput_items_required.begin(), ninput_items_required.end(), (int)ceil((noutput_items * d_omega) + d_interp.ntaps()));
+}
+
+int cqpsk_demod::general_work(int noutput_items,
+                              gr_vector_int &ninput_items,
+                              gr_vector_const_void_star &input_items,
+                              gr_vector_void_star &output_items) {
+  gr::thread::scoped_lock lock(d_mutex);
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  float *out = (float *)output_items[0];
+  const int ninput = ninput_items[0];
+
+  int i = 0, o = 0;
+
+  while ((o < noutput_items) && (i < ninput)) {
+    const int tile_end = std::min(noutput_items - o, TILE);
+    int count = 0;
+
+    while ((count < tile_end) && (i < ninput)) {
+      while ((d_mu > 1.0) && (i < ninput)) {
+        d_mu--;
+        const gr_complex sample = (in[i] == in[i]) ? in[i] : gr_complex(0, 0); // Check for NaN values and set to 0
+        d_dl[d_dl_index] = sample;
+        d_dl[d_dl_index + d_twice_sps] = sample;
+        d_dl_index++;
+        d_dl_index = d_dl_index % d_twice_sps;
+        i++;
+      }
+
+      if (i < ninput) {
+        // gardner_cc: two points half a symbol apart, interp_samp is (we
+        // hope) at the optimum sampling point
+        float half_omega = d_omega / 2.0;
+        int half_sps = (int)floorf(half_omega);
+        float half_mu = d_mu + half_omega - (float)half_sps;
+        if (half_mu > 1.0) {
+          half_mu -= 1.0;
+          half_sps += 1;
+        }
+        gr_complex interp_samp_mid = d_interp.interpolate(&d_dl[d_dl_index], d_mu);
+        gr_complex interp_samp = d_interp.interpolate(&d_dl[d_dl_index + half_sps], half_mu);
+
+        float error_real = (d_last_sample.real() - interp_samp.real()) * interp_samp_mid.real();
+        float error_imag = (d_last_sample.imag() - interp_samp.imag()) * interp_samp_mid.imag();
+        d_last_sample = interp_samp;
+        float symbol_error = error_real + error_imag; // Gardner loop error
+        if (std::isnan(symbol_error))
+          symbol_error = 0.0;
+        if (symbol_error < -1.0)
+          symbol_error = -1.0;
+        if (symbol_error > 1.0)
+          symbol_error = 1.0;
+
+        d_omega = d_omega + (d_gain_omega * symbol_error * abs(interp_samp));          // update omega based on loop error
+        d_omega = d_omega_mid + gr::branchless_clip(d_omega - d_omega_mid, d_omega_rel); // make sure we don't walk away
+        d_mu += d_omega + d_gain_mu * symbol_error;                                    // update mu based on loop error
+
+        // diff_phasor_cc
+        const gr_complex diff = interp_samp * conj(d_prev_symbol);
+        d_prev_symbol = interp_samp;
+
+        // costas_loop_cc, 4th order, with the phase limited rather than wrapped
+        const gr_complex symbol = diff * gr_expj(-d_phase);
+        float error = ((symbol.real() > 0 ? 1.0 : -1.0) * symbol.imag() -
+                       (symbol.imag() > 0 ? 1.0 : -1.0) * symbol.real());
+        error = gr::branchless_clip(error, 1.0);
+        d_freq = d_freq + d_beta * error;
+        d_phase = d_phase + d_freq + d_alpha * error;
+        d_phase = std::min(std::max(d_phase, d_min_phase), d_max_phase);
+        d_freq = std::min(std::max(d_freq, d_min_freq), d_max_freq);
+
+        d_symbols[count++] = symbol;
+      }
+    }
+
+    // complex_to_arg and multiply_const_ff: radians to -3/-1/+1/+3
+    volk_32fc_s32f_atan2_32f(out + o, d_symbols.data(), M_PI / 4, count);
+    o += count;
+  }
+
+  consume_each(i);
+  return o;
+}
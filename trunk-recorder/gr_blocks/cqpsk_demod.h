@@ -0,0 +1,82 @@
+#ifndef INCLUDED_CQPSK_DEMOD_H
+#define INCLUDED_CQPSK_DEMOD_H
+
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/filter/mmse_fir_interpolator_cc.h>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/io_signature.h>
+#include <boost/thread/mutex.hpp>
+
+// The CQPSK (P25 Phase 1 LSM and Phase 2) demodulator in one block: the
+// op25 gardner_cc symbol timing recovery, diff_phasor_cc, the op25
+// costas_loop_cc and complex_to_arg with its rescale. It used to be five
+// blocks, each with its own thread and buffer, for each recorder.
+//
+// Each symbol goes through the timing loop, the differential decoder and
+// the carrier loop while it is still in registers, and lands in a tile of
+// symbols that stays in cache. The angles of a whole tile are then taken
+// with one VOLK call, which also scales them so the symbols are -3/-1/+1/+3.
+// The output is one float per symbol, for the frame assembler's slicer.
+//
+// gardner_cc's lock detector isn't run, nothing reads it.
+
+class cqpsk_demod;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<cqpsk_demod> cqpsk_demod_sptr;
+#else
+typedef std::shared_ptr<cqpsk_demod> cqpsk_demod_sptr;
+#endif
+
+cqpsk_demod_sptr make_cqpsk_demod(float samples_per_symbol, float gain_mu, float gain_omega, float costas_alpha, float costas_max_phase);
+
+class cqpsk_demod : public gr::block {
+
+  friend cqpsk_demod_sptr make_cqpsk_demod(float samples_per_symbol, float gain_mu, float gain_omega, float costas_alpha, float costas_max_phase);
+
+  static const int TILE = 1024;
+  static const int DELAY_LINE = 100;
+
+  boost::mutex d_mutex;
+
+  // gardner_cc's timing loop
+  float d_mu;
+  float d_omega, d_gain_omega, d_omega_rel, d_min_omega, d_max_omega, d_omega_mid;
+  float d_gain_mu;
+  int d_twice_sps;
+  gr_complex d_last_sample;
+  gr::filter::mmse_fir_interpolator_cc d_interp;
+  gr_complex d_dl[DELAY_LINE]; // the last d_twice_sps samples, twice over
+  int d_dl_index;
+
+  // diff_phasor_cc
+  gr_complex d_prev_symbol;
+
+  // costas_loop_cc's control loop
+  float d_phase, d_freq;
+  float d_max_freq, d_min_freq;
+  float d_max_phase, d_min_phase;
+  float d_alpha, d_beta;
+
+  std::vector<gr_complex> d_symbols; // a tile of symbols out of the carrier loop
+
+  cqpsk_demod(float samples_per_symbol, float gain_mu, float gain_omega, float costas_alpha, float costas_max_phase);
+
+public:
+  void set_omega(float omega);
+
+  // What p25_recorder_qpsk_demod::reset() did to the blocks: the carrier
+  // loop's phase and frequency go to 0, and gardner_cc::reset()
+  void reset();
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
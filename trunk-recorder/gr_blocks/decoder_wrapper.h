@@ -73,6 +73,10 @@ public:
   virtual bool get_tps_enabled() { return false; }
   virtual bool get_dcs_enabled() { return false; }
 
+  // Enable exactly the signal_decoder_sink decoders in mask (SignalDecoder bits)
+  virtual void set_signal_decoders(unsigned int mask){};
+  virtual unsigned int get_signal_decoders() { return 0; }
+
   virtual void process_message_queues(void){};
 };
 
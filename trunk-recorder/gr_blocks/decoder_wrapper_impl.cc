@@ -40,16 +40,16 @@ namespace gr {
 namespace blocks {
 
 decoder_wrapper_impl::sptr
-decoder_wrapper_impl::make(unsigned int sample_rate, decoder_callback callback) {
-  return gnuradio::get_initial_sptr(new decoder_wrapper_impl(sample_rate, callback));
+decoder_wrapper_impl::make(unsigned int sample_rate, decoder_callback callback, bool threaded) {
+  return gnuradio::get_initial_sptr(new decoder_wrapper_impl(sample_rate, callback, threaded));
 }
 
-decoder_wrapper_impl::decoder_wrapper_impl(unsigned int sample_rate, decoder_callback callback)
+decoder_wrapper_impl::decoder_wrapper_impl(unsigned int sample_rate, decoder_callback callback, bool threaded)
     : hier_block2("decoder_wrapper_impl",
                   io_signature::make(1, 1, sizeof(float)),
                   io_signature::make(0, 0, 0)),
       d_callback(callback) {
-  d_signal_decoder_sink = gr::blocks::signal_decoder_sink_impl::make(sample_rate, callback);
+  d_signal_decoder_sink = gr::blocks::signal_decoder_sink_impl::make(sample_rate, callback, threaded);
   d_tps_decoder_sink = gr::blocks::tps_decoder_sink_impl::make(sample_rate, callback);
 
   connect(self(), 0, d_signal_decoder_sink, 0);
@@ -73,6 +73,9 @@ bool decoder_wrapper_impl::get_star_enabled() { return d_signal_decoder_sink->ge
 bool decoder_wrapper_impl::get_tps_enabled() { return d_tps_decoder_sink->get_enabled(); };
 bool decoder_wrapper_impl::get_dcs_enabled() { return d_signal_decoder_sink->get_dcs_enabled(); };
 
+void decoder_wrapper_impl::set_signal_decoders(unsigned int mask) { d_signal_decoder_sink->set_enabled_decoders(mask); };
+unsigned int decoder_wrapper_impl::get_signal_decoders() { return d_signal_decoder_sink->get_enabled_decoders(); };
+
 void decoder_wrapper_impl::log_decoder_msg(long unitId, const char *signaling_type, SignalType signal) {
   if (d_callback != NULL) {
     d_callback(unitId, signaling_type, signal);
@@ -80,6 +83,7 @@ void decoder_wrapper_impl::log_decoder_msg(long unitId, const char *signaling_ty
 }
 
 void decoder_wrapper_impl::process_message_queues() {
+  d_signal_decoder_sink->process_message_queues();
   d_tps_decoder_sink->process_message_queues();
 }
 } /* namespace blocks */
@@ -50,9 +50,12 @@ public:
    * \param sample_rate Sample rate [S/s]
    * \param bits_per_sample 16 or 8 bit, default is 16
    */
-  static sptr make(unsigned int sample_rate, decoder_callback callback);
+  /*
+   * \param threaded Run the signal decoders on their own thread instead of the flowgraph's
+   */
+  static sptr make(unsigned int sample_rate, decoder_callback callback, bool threaded = false);
 
-  decoder_wrapper_impl(unsigned int sample_rate, decoder_callback callback);
+  decoder_wrapper_impl(unsigned int sample_rate, decoder_callback callback, bool threaded);
   ~decoder_wrapper_impl();
 
   void set_mdc_enabled(bool b);
@@ -67,6 +70,9 @@ public:
   bool get_tps_enabled();
   bool get_dcs_enabled();
 
+  void set_signal_decoders(unsigned int mask);
+  unsigned int get_signal_decoders();
+
   void log_decoder_msg(long unitId, const char *signaling_type, SignalType signal);
   void process_message_queues(void);
 };
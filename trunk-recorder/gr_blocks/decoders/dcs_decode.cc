@@ -11,11 +11,20 @@
  * (per EIA/TIA-603 standard for DCS subaudible coding)
  *
  * Algorithm:
- *   1. First-order IIR low-pass filter at ~300 Hz isolates the DCS tone
+ *   1. Decimating FIR low-pass (~300 Hz cutoff) isolates the DCS signal and
+ *      drops the input to a low internal rate (~2.4 kHz).  Only every
+ *      decim-th output is computed, each one a single VOLK dot product.
  *   2. Integration over each bit period + threshold for bit decision
  *   3. Zero-crossing clock recovery nudges the bit clock for better sync
  *   4. Dual sliding 23-bit windows (both bit orderings) feed Golay decode
- *   5. Two consecutive matching valid codewords required before callback
+ *   5. Two matching valid codewords, one word period apart at the same bit
+ *      phase, required before callback; the decoder then locks to that
+ *      code and phase, and reports nothing else until it fades
+ *
+ * Steps 2-5 only ever see the decimated stream, so their per-sample
+ * branching runs at ~2.4 kHz regardless of the audio input rate.  The
+ * same stream is offered to an optional low-pass callback, so other
+ * sub-audio detectors can reuse the filter.
  */
 
 #include "dcs_decode.h"
@@ -23,12 +32,23 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <volk/volk.h>
+
+#define DCS_BIT_RATE       134.4f
+#define DCS_LPF_CUTOFF     300.0f
+#define DCS_INTERNAL_RATE  2400   /* target rate after decimation */
+#define DCS_TAPS_PER_PHASE 8      /* FIR length = decim * this + 1 */
+#define DCS_BLOCK_SIZE     2048   /* input samples filtered per pass */
+#define DCS_WORD_BITS      23     /* the codeword repeats every 23 bits */
+#define DCS_CANDIDATES     8      /* codes being confirmed at once */
+#define DCS_MAX_COUNT      3      /* word periods a lock rides through */
+#define DCS_MAX_DIFF_BITS  1      /* raw bits the first two codewords may differ by */
 
 /* --------------------------------------------------------------------------
  * Standard DCS codes (decimal values converted from EIA-603 octal table).
  * 105 codes total.
  * -------------------------------------------------------------------------- */
-static const uint16_t DCS_VALID_CODES[] = {
+static constexpr uint16_t DCS_VALID_CODES[] = {
      19,  21,  22,  25,  26,  30,  35,  39,  41,  43,  44,  53,
      57,  58,  59,  60,
      76,  77,  78,  82,  85,  89,  90,  92,  99, 101, 106, 109,
@@ -50,11 +70,11 @@ static const uint16_t DCS_VALID_CODES[] = {
  * -------------------------------------------------------------------------- */
 #define GOLAY_POLY  0xC75U   /* 12-bit representation including x^11 term */
 #define GOLAY_SYN_INVALID 0xFFFFFFFFU
+#define DCS_CODE_SPACE  512  /* 9-bit code field */
 
-static uint32_t golay_syndrome(uint32_t word) {
+static constexpr uint32_t golay_syndrome(uint32_t word) {
     uint32_t reg = word & 0x7FFFFFU;  /* 23 bits */
-    int i;
-    for (i = 22; i >= 11; i--) {
+    for (int i = 22; i >= 11; i--) {
         if ((reg >> i) & 1U) {
             reg ^= (GOLAY_POLY << (i - 11));
         }
@@ -63,52 +83,66 @@ static uint32_t golay_syndrome(uint32_t word) {
 }
 
 /*
- * Build a 2048-entry syndrome → error-pattern table.
- * The (23,12,7) Golay code corrects up to 3 errors; the 2048 syndromes
- * map exactly to the 1 + C(23,1) + C(23,2) + C(23,3) = 2048 correctable
- * error patterns.
+ * Lookup tables shared read-only by every decoder instance.
+ *
+ * syndrome   - 2048-entry syndrome → error-pattern table.  The (23,12,7)
+ *              Golay code corrects up to 3 errors; the 2048 syndromes map
+ *              exactly to the 1 + C(23,1) + C(23,2) + C(23,3) = 2048
+ *              correctable error patterns.
+ * valid_code - 1 for each standard DCS code, indexed by the 9-bit code.
+ *
+ * Both are computed at compile time, so creating a decoder costs nothing
+ * beyond the calloc of its (small) state struct.
  */
-static void build_syndrome_table(uint32_t *tbl) {
-    int i, j, k;
-    for (i = 0; i < 2048; i++) tbl[i] = GOLAY_SYN_INVALID;
+struct dcs_tables {
+    uint32_t syndrome[2048];
+    uint8_t  valid_code[DCS_CODE_SPACE];
+};
+
+static constexpr dcs_tables build_dcs_tables() {
+    dcs_tables t{};
+    for (int i = 0; i < 2048; i++) t.syndrome[i] = GOLAY_SYN_INVALID;
 
     /* 0 errors */
-    tbl[0] = 0;
+    t.syndrome[0] = 0;
 
     /* 1-bit errors */
-    for (i = 0; i < 23; i++) {
+    for (int i = 0; i < 23; i++) {
         uint32_t e = 1U << i;
         uint32_t s = golay_syndrome(e);
-        if (tbl[s] == GOLAY_SYN_INVALID) tbl[s] = e;
+        if (t.syndrome[s] == GOLAY_SYN_INVALID) t.syndrome[s] = e;
     }
 
     /* 2-bit errors */
-    for (i = 0; i < 23; i++) {
-        for (j = i + 1; j < 23; j++) {
+    for (int i = 0; i < 23; i++) {
+        for (int j = i + 1; j < 23; j++) {
             uint32_t e = (1U << i) | (1U << j);
             uint32_t s = golay_syndrome(e);
-            if (tbl[s] == GOLAY_SYN_INVALID) tbl[s] = e;
+            if (t.syndrome[s] == GOLAY_SYN_INVALID) t.syndrome[s] = e;
         }
     }
 
     /* 3-bit errors */
-    for (i = 0; i < 23; i++) {
-        for (j = i + 1; j < 23; j++) {
-            for (k = j + 1; k < 23; k++) {
+    for (int i = 0; i < 23; i++) {
+        for (int j = i + 1; j < 23; j++) {
+            for (int k = j + 1; k < 23; k++) {
                 uint32_t e = (1U << i) | (1U << j) | (1U << k);
                 uint32_t s = golay_syndrome(e);
-                if (tbl[s] == GOLAY_SYN_INVALID) tbl[s] = e;
+                if (t.syndrome[s] == GOLAY_SYN_INVALID) t.syndrome[s] = e;
             }
         }
     }
-}
 
-static int is_valid_dcs_code(int code) {
-    int i;
-    for (i = 0; i < DCS_NUM_CODES; i++) {
-        if (DCS_VALID_CODES[i] == (uint16_t)code) return 1;
+    for (int i = 0; i < DCS_NUM_CODES; i++) {
+        t.valid_code[DCS_VALID_CODES[i]] = 1;
     }
-    return 0;
+    return t;
+}
+
+static constexpr dcs_tables DCS_TABLES = build_dcs_tables();
+
+static inline int is_valid_dcs_code(int code) {
+    return (code >= 0 && code < DCS_CODE_SPACE) ? DCS_TABLES.valid_code[code] : 0;
 }
 
 /*
@@ -116,16 +150,17 @@ static int is_valid_dcs_code(int code) {
  * The systematic layout assumed is: bits [22..11] = data, bits [10..0] = parity.
  * Returns 1 if a valid recognized DCS code is found, fills *out_code and *out_inverted.
  */
-static int try_decode_word(const uint32_t *syn_tbl, uint32_t word,
-                           int *out_code, int *out_inverted, int polarity_inv) {
+static int try_decode_word(uint32_t word, int *out_code, int *out_inverted,
+                           int *out_errors, int polarity_inv) {
     uint32_t s = golay_syndrome(word);
-    if (s < 2048U && syn_tbl[s] != GOLAY_SYN_INVALID) {
-        uint32_t corrected = word ^ syn_tbl[s];
+    if (DCS_TABLES.syndrome[s] != GOLAY_SYN_INVALID) {
+        uint32_t corrected = word ^ DCS_TABLES.syndrome[s];
         int data = (int)((corrected >> 11) & 0xFFFU);
         /* Bits 11..9 of data must be 0 for any standard DCS code */
         if ((data & 0xE00) == 0 && is_valid_dcs_code(data)) {
             *out_code = data;
             *out_inverted = polarity_inv;
+            *out_errors = __builtin_popcount(DCS_TABLES.syndrome[s]);
             return 1;
         }
     }
@@ -135,13 +170,40 @@ static int try_decode_word(const uint32_t *syn_tbl, uint32_t word,
 /* --------------------------------------------------------------------------
  * Decoder state
  * -------------------------------------------------------------------------- */
+
+/* A code that has decoded in a window at some bit phase, and how many
+ * word periods it has kept decoding there.  Every rotation of a Golay
+ * codeword is a codeword, so the word on the air also decodes as other
+ * standard codes at other phases, and the reversed word can decode in the
+ * other window with a few bits corrected.  These aliases are tracked like
+ * any other code, so they can be told apart from the real one, but once a
+ * code is locked none of them is reported. */
+typedef struct {
+    int code;
+    int inverted;
+    int window;            /* 0 for window_a, 1 for window_b */
+    int count;             /* codewords, up to DCS_MAX_COUNT; 0 for a free slot */
+    int bits_since_match;  /* bits since the word was last due */
+    uint32_t first_word;   /* the window its first codeword decoded from */
+    int last_errors;       /* bits the Golay decode corrected in its last codeword */
+    int errors;            /* and in the last two */
+    unsigned confirmed;    /* bit_count when it was confirmed */
+} dcs_candidate_t;
+
 struct dcs_decoder {
-    /* Low-pass filter (first-order IIR, cutoff ~300 Hz) */
-    float lp_alpha;
-    float lp_state;
+    /* Decimating low-pass front end */
+    int    decim;
+    int    decim_phase;  /* input samples remaining until next output */
+    int    ntaps;
+    float *taps;         /* symmetric, so no reversal needed for the dot product */
+    float *history;      /* ntaps-1 carried samples followed by DCS_BLOCK_SIZE new ones */
+    float *lp_out;       /* decimated output of one pass */
+    unsigned long long samples_in;  /* input samples consumed since creation */
+    unsigned long long lp_pos;      /* input index of the decimated sample in process */
+
     float lp_prev;      /* previous filtered sample, for zero-crossing detection */
 
-    /* Bit clock */
+    /* Bit clock (in units of decimated samples) */
     float samples_per_bit;
     float bit_phase;    /* fractional sample count within current bit period */
     float bit_accum;    /* accumulated filtered samples for current bit */
@@ -154,19 +216,196 @@ struct dcs_decoder {
     uint32_t window_a;
     uint32_t window_b;
 
-    /* Confirmation: require 2 consecutive matching valid codewords */
-    int last_code;
-    int last_inverted;
-    int confirm_count;
-
-    /* Golay syndrome table */
-    uint32_t syndrome_tbl[2048];
+    /* Confirmation: require 2 matching valid codewords, one word period
+     * apart at the same phase.  locked is the candidate being reported, -1
+     * while there is none; settle counts down the bits left to wait for a
+     * better one once a code is confirmed with bits corrected. */
+    dcs_candidate_t candidates[DCS_CANDIDATES];
+    int locked;
+    int settle;          /* -1 when not choosing */
+    unsigned bit_count;  /* bits decided since creation */
 
     /* Callback */
     dcs_callback_t callback;
     void *callback_ctx;
+
+    /* Consumer of the decimated stream, if any */
+    dcs_lowpass_callback_t lowpass_callback;
+    void *lowpass_callback_ctx;
 };
 
+/*
+ * Windowed-sinc (Hamming) low-pass, normalised to unity DC gain.
+ */
+static void design_lowpass(float *taps, int ntaps, float cutoff, float rate) {
+    int i;
+    float fc  = cutoff / rate;
+    int   mid = (ntaps - 1) / 2;
+    float sum = 0.0f;
+    for (i = 0; i < ntaps; i++) {
+        int   n = i - mid;
+        float h = (n == 0) ? 2.0f * fc
+                           : sinf(2.0f * 3.14159265f * fc * (float)n) / (3.14159265f * (float)n);
+        float w = 0.54f - 0.46f * cosf(2.0f * 3.14159265f * (float)i / (float)(ntaps - 1));
+        taps[i] = h * w;
+        sum += taps[i];
+    }
+    for (i = 0; i < ntaps; i++) taps[i] /= sum;
+}
+
+/*
+ * Lock the confirmed code with the fewest bits corrected in its two
+ * codewords, and of those the first confirmed.  On a clean signal the real
+ * code is confirmed first, as its first word is the first one complete;
+ * a reversed alias can get there before it, but only with bits corrected.
+ */
+static void choose_lock(dcs_decoder_t *dec) {
+    int best = -1;
+    for (int c = 0; c < DCS_CANDIDATES; c++) {
+        dcs_candidate_t *cand = &dec->candidates[c];
+        if (cand->count < 2) continue;
+        if (best < 0 || cand->errors < dec->candidates[best].errors ||
+            (cand->errors == dec->candidates[best].errors && cand->confirmed < dec->candidates[best].confirmed)) {
+            best = c;
+        }
+    }
+    dec->settle = -1;
+    dec->locked = best;
+    if (best >= 0 && dec->callback) {
+        dec->callback(dec->candidates[best].code, dec->candidates[best].inverted, dec->callback_ctx);
+    }
+}
+
+/*
+ * Count a decode of code in window, from the 23 bits in word with errors
+ * of them corrected.  It is the next codeword when it comes a word period
+ * after the last one, give or take a bit of clock slip; a decode in between
+ * is the same word a bit off and is ignored.  A second codeword has to be
+ * the first one over again: before a transmission the noise can be
+ * corrected into the start of an alias just ahead of the real code.
+ *
+ * A code confirmed clean is locked at once, one with bits corrected only
+ * after waiting a word period for a cleaner one.  The callback fires when a
+ * code is locked and on each codeword of it after that, for squelch
+ * refresh.  The lock only passes to another code once the locked one has
+ * faded out.
+ */
+static void confirm_code(dcs_decoder_t *dec, uint32_t word, int code, int inverted, int window, int errors) {
+    dcs_candidate_t *free_slot = NULL;
+    for (int c = 0; c < DCS_CANDIDATES; c++) {
+        dcs_candidate_t *cand = &dec->candidates[c];
+        if (cand->count == 0) {
+            if (!free_slot) free_slot = cand;
+            continue;
+        }
+        if (cand->code != code || cand->inverted != inverted || cand->window != window) continue;
+        if (cand->bits_since_match >= DCS_WORD_BITS - 1) {
+            if (cand->count == 1 && __builtin_popcount(word ^ cand->first_word) > DCS_MAX_DIFF_BITS) {
+                /* Start again from this one */
+                cand->first_word = word;
+                cand->bits_since_match = 0;
+                return;
+            }
+            if (cand->count < DCS_MAX_COUNT) cand->count++;
+            /* Follow the clock: the next word is due a period from here */
+            cand->bits_since_match = 0;
+            cand->errors = cand->last_errors + errors;
+            cand->last_errors = errors;
+            if (cand->count == 2) cand->confirmed = dec->bit_count;
+            if (dec->locked < 0 && dec->settle < 0 && cand->count >= 2) {
+                dec->settle = cand->errors ? DCS_WORD_BITS - 1 : 0;
+            }
+            if (dec->settle == 0) choose_lock(dec);
+            else if (dec->locked == c && dec->callback) {
+                dec->callback(code, inverted, dec->callback_ctx);
+            }
+        }
+        return;
+    }
+    if (free_slot) {
+        free_slot->code = code;
+        free_slot->inverted = inverted;
+        free_slot->window = window;
+        free_slot->count = 1;
+        free_slot->bits_since_match = 0;
+        free_slot->first_word = word;
+        free_slot->last_errors = errors;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Bit recovery on the decimated stream
+ * -------------------------------------------------------------------------- */
+static void process_decimated(dcs_decoder_t *dec, const float *lp, int n,
+                              unsigned long long first_pos) {
+    int i;
+    for (i = 0; i < n; i++) {
+        float filtered = lp[i];
+        dec->lp_pos = first_pos + (unsigned long long)i * dec->decim;
+
+        /* --- Zero-crossing clock recovery ---
+         * When a zero crossing occurs, nudge the bit clock so the
+         * crossings land on the bit boundaries, and the integration
+         * period on the centre of each bit.
+         */
+        if ((dec->lp_prev < 0.0f) != (filtered < 0.0f)) {
+            float half = dec->samples_per_bit * 0.5f;
+            if (dec->bit_phase < half) {
+                /* Crossing in first half: clock edge is early, delay slightly */
+                dec->bit_phase -= dec->samples_per_bit * 0.05f;
+            } else {
+                /* Crossing in second half: clock edge is late, advance slightly */
+                dec->bit_phase += dec->samples_per_bit * 0.05f;
+            }
+        }
+        dec->lp_prev = filtered;
+
+        /* --- Integrate sample into current bit accumulator --- */
+        dec->bit_accum += filtered;
+        dec->bit_phase  += 1.0f;
+
+        /* --- Bit boundary reached? --- */
+        if (dec->bit_phase >= dec->samples_per_bit) {
+            dec->bit_phase -= dec->samples_per_bit;
+
+            /* Threshold: positive average → 1, negative → 0 */
+            int bit = (dec->bit_accum > 0.0f) ? 1 : 0;
+            dec->bit_count++;
+            dec->bit_accum = 0.0f;
+
+            /* Update both sliding windows */
+            dec->window_a = (dec->window_a >> 1) | ((uint32_t)bit << 22);
+            dec->window_b = ((dec->window_b << 1) | (uint32_t)bit) & 0x7FFFFFU;
+
+            /* A word only lines up with a window once per word period, so
+             * a code that hasn't decoded when it was due, give or take a
+             * bit of clock slip, loses a codeword.  It stays due at the
+             * same phase; one that has lost them all is dropped. */
+            for (int c = 0; c < DCS_CANDIDATES; c++) {
+                dcs_candidate_t *cand = &dec->candidates[c];
+                if (cand->count > 0 && ++cand->bits_since_match > DCS_WORD_BITS + 1) {
+                    cand->count--;
+                    cand->bits_since_match -= DCS_WORD_BITS;
+                    if (cand->count == 0 && dec->locked == c) dec->locked = -1;
+                }
+            }
+
+            if (dec->settle > 0 && --dec->settle == 0) choose_lock(dec);
+
+            /* Try to decode both windows, both polarities */
+            int code = 0, inverted = 0, errors = 0;
+            if (try_decode_word(dec->window_a, &code, &inverted, &errors, 0))
+                confirm_code(dec, dec->window_a, code, inverted, 0, errors);
+            if (try_decode_word((~dec->window_a) & 0x7FFFFFU, &code, &inverted, &errors, 1))
+                confirm_code(dec, dec->window_a, code, inverted, 0, errors);
+            if (try_decode_word(dec->window_b, &code, &inverted, &errors, 0))
+                confirm_code(dec, dec->window_b, code, inverted, 1, errors);
+            if (try_decode_word((~dec->window_b) & 0x7FFFFFU, &code, &inverted, &errors, 1))
+                confirm_code(dec, dec->window_b, code, inverted, 1, errors);
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------
  * Public API
  * -------------------------------------------------------------------------- */
@@ -175,32 +414,50 @@ dcs_decoder_t *dcs_decoder_new(int sampleRate) {
     dcs_decoder_t *dec = (dcs_decoder_t *)calloc(1, sizeof(dcs_decoder_t));
     if (!dec) return NULL;
 
-    /* First-order IIR LP: alpha = 1 - e^(-2*pi*fc/fs), fc = 300 Hz */
-    dec->lp_alpha  = 1.0f - expf(-2.0f * 3.14159265f * 300.0f / (float)sampleRate);
-    dec->lp_state  = 0.0f;
-    dec->lp_prev   = 0.0f;
+    dec->decim = sampleRate / DCS_INTERNAL_RATE;
+    if (dec->decim < 1) dec->decim = 1;
+    dec->decim_phase = dec->decim;
+    dec->ntaps = dec->decim * DCS_TAPS_PER_PHASE + 1;
+
+    size_t align = volk_get_alignment();
+    dec->taps    = (float *)volk_malloc(sizeof(float) * dec->ntaps, align);
+    dec->history = (float *)volk_malloc(sizeof(float) * (dec->ntaps - 1 + DCS_BLOCK_SIZE), align);
+    dec->lp_out  = (float *)volk_malloc(sizeof(float) * (DCS_BLOCK_SIZE / dec->decim + 1), align);
+    if (!dec->taps || !dec->history || !dec->lp_out) {
+        dcs_decoder_delete(dec);
+        return NULL;
+    }
+    design_lowpass(dec->taps, dec->ntaps, DCS_LPF_CUTOFF, (float)sampleRate);
+    memset(dec->history, 0, sizeof(float) * (dec->ntaps - 1));
+    dec->lp_prev = 0.0f;
 
-    dec->samples_per_bit = (float)sampleRate / 134.4f;
+    dec->samples_per_bit = ((float)sampleRate / (float)dec->decim) / DCS_BIT_RATE;
     dec->bit_phase = 0.0f;
     dec->bit_accum = 0.0f;
 
     dec->window_a = 0;
     dec->window_b = 0;
 
-    dec->last_code    = -1;
-    dec->last_inverted = 0;
-    dec->confirm_count = 0;
-
-    build_syndrome_table(dec->syndrome_tbl);
+    memset(dec->candidates, 0, sizeof(dec->candidates));
+    dec->locked = -1;
+    dec->settle = -1;
+    dec->bit_count = 0;
 
     dec->callback     = NULL;
     dec->callback_ctx = NULL;
 
+    dec->lowpass_callback     = NULL;
+    dec->lowpass_callback_ctx = NULL;
+
     return dec;
 }
 
 void dcs_decoder_delete(dcs_decoder_t *dec) {
-    if (dec) free(dec);
+    if (!dec) return;
+    volk_free(dec->taps);
+    volk_free(dec->history);
+    volk_free(dec->lp_out);
+    free(dec);
 }
 
 void dcs_decoder_set_callback(dcs_decoder_t *dec, dcs_callback_t cb, void *ctx) {
@@ -209,84 +466,69 @@ void dcs_decoder_set_callback(dcs_decoder_t *dec, dcs_callback_t cb, void *ctx)
     dec->callback_ctx = ctx;
 }
 
+void dcs_decoder_set_lowpass_callback(dcs_decoder_t *dec, dcs_lowpass_callback_t cb, void *ctx) {
+    if (!dec) return;
+    dec->lowpass_callback     = cb;
+    dec->lowpass_callback_ctx = ctx;
+}
+
+int dcs_decoder_get_decimation(const dcs_decoder_t *dec) {
+    return dec ? dec->decim : 1;
+}
+
+unsigned long long dcs_decoder_get_position(const dcs_decoder_t *dec) {
+    return dec ? dec->lp_pos : 0;
+}
+
 void dcs_decoder_process_samples(dcs_decoder_t *dec,
                                  const dcs_sample_t *samples,
                                  int numSamples) {
-    int i;
-    float alpha        = dec->lp_alpha;
-    float one_minus_a  = 1.0f - alpha;
+    int carry = dec->ntaps - 1;
 
-    for (i = 0; i < numSamples; i++) {
-        /* --- Low-pass filter --- */
-        float filtered = alpha * samples[i] + one_minus_a * dec->lp_state;
-        dec->lp_state = filtered;
+    while (numSamples > 0) {
+        int chunk = (numSamples < DCS_BLOCK_SIZE) ? numSamples : DCS_BLOCK_SIZE;
+        int nout  = 0;
+        int pos;
+        unsigned long long first_pos = dec->samples_in + dec->decim_phase - 1;
 
-        /* --- Zero-crossing clock recovery ---
-         * When a zero crossing occurs, nudge the bit clock so the
-         * sampling point lands near the centre of each bit period.
-         */
-        if ((dec->lp_prev < 0.0f) != (filtered < 0.0f)) {
-            float half = dec->samples_per_bit * 0.5f;
-            if (dec->bit_phase < half) {
-                /* Crossing in first half: clock edge is early, delay slightly */
-                dec->bit_phase += dec->samples_per_bit * 0.05f;
-            } else {
-                /* Crossing in second half: clock edge is late, advance slightly */
-                dec->bit_phase -= dec->samples_per_bit * 0.05f;
-            }
-        }
-        dec->lp_prev = filtered;
+        memcpy(dec->history + carry, samples, sizeof(float) * chunk);
 
-        /* --- Integrate sample into current bit accumulator --- */
-        dec->bit_accum += filtered;
-        dec->bit_phase  += 1.0f;
+        /* Polyphase decimation: evaluate the FIR only at output instants.
+         * Output for input sample k uses history[k .. k+ntaps-1].        */
+        for (pos = dec->decim_phase - 1; pos < chunk; pos += dec->decim) {
+            volk_32f_x2_dot_prod_32f(&dec->lp_out[nout++], dec->history + pos,
+                                     dec->taps, dec->ntaps);
+        }
+        dec->decim_phase = pos - chunk + 1;
 
-        /* --- Bit boundary reached? --- */
-        if (dec->bit_phase >= dec->samples_per_bit) {
-            dec->bit_phase -= dec->samples_per_bit;
+        memmove(dec->history, dec->history + chunk, sizeof(float) * carry);
 
-            /* Threshold: positive average → 1, negative → 0 */
-            int bit = (dec->bit_accum > 0.0f) ? 1 : 0;
-            dec->bit_accum = 0.0f;
+        if (dec->lowpass_callback && nout > 0) {
+            dec->lowpass_callback(dec->lp_out, nout, first_pos, dec->lowpass_callback_ctx);
+        }
+        process_decimated(dec, dec->lp_out, nout, first_pos);
 
-            /* Update both sliding windows */
-            dec->window_a = (dec->window_a >> 1) | ((uint32_t)bit << 22);
-            dec->window_b = ((dec->window_b << 1) | (uint32_t)bit) & 0x7FFFFFU;
+        dec->samples_in += chunk;
+        samples    += chunk;
+        numSamples -= chunk;
+    }
+}
 
-            /* Try to decode both windows, both polarities */
-            int code = 0, inverted = 0, found = 0;
-
-            if (!found) found = try_decode_word(dec->syndrome_tbl,
-                                                dec->window_a, &code, &inverted, 0);
-            if (!found) found = try_decode_word(dec->syndrome_tbl,
-                                                (~dec->window_a) & 0x7FFFFFU,
-                                                &code, &inverted, 1);
-            if (!found) found = try_decode_word(dec->syndrome_tbl,
-                                                dec->window_b, &code, &inverted, 0);
-            if (!found) found = try_decode_word(dec->syndrome_tbl,
-                                                (~dec->window_b) & 0x7FFFFFU,
-                                                &code, &inverted, 1);
-
-            if (found) {
-                if (code == dec->last_code && inverted == dec->last_inverted) {
-                    dec->confirm_count++;
-                    /* Fire callback on first confirmation (2nd consecutive match) */
-                    if (dec->confirm_count == 2 && dec->callback) {
-                        dec->callback(code, inverted, dec->callback_ctx);
-                    }
-                    /* Continue firing every bit for ongoing squelch refresh */
-                    if (dec->confirm_count > 2 && dec->callback) {
-                        dec->callback(code, inverted, dec->callback_ctx);
-                    }
-                } else {
-                    dec->last_code    = code;
-                    dec->last_inverted = inverted;
-                    dec->confirm_count = 1;
-                }
-            } else {
-                /* Decay confirmation counter when no valid code seen */
-                if (dec->confirm_count > 0) dec->confirm_count--;
+int dcs_code_aliases(int code, int inverted, int *codes, int *inverted_out, int max) {
+    int n = 0;
+    if (!is_valid_dcs_code(code)) return 0;
+    uint32_t word = ((uint32_t)code << 11) | golay_syndrome((uint32_t)code << 11);
+    for (int r = 1; r < DCS_WORD_BITS; r++) {
+        uint32_t rotated = ((word >> r) | (word << (DCS_WORD_BITS - r))) & 0x7FFFFFU;
+        for (int flip = 0; flip < 2; flip++) {
+            uint32_t w = flip ? (~rotated) & 0x7FFFFFU : rotated;
+            int data = (int)(w >> 11);
+            if (golay_syndrome(w) == 0 && is_valid_dcs_code(data) && n < max) {
+                codes[n] = data;
+                inverted_out[n] = inverted ^ flip;
+                n++;
             }
         }
     }
+    return n;
 }
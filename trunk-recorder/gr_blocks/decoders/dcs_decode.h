@@ -16,6 +16,12 @@
 
 #include "dcs_types.h"
 
+/* Lowest input rate to hand the decoder; it decimates to ~2.4 kHz itself */
+#define DCS_MIN_SAMPLE_RATE 8000
+
+/* Most codes dcs_code_aliases can return: 22 rotations, both polarities */
+#define DCS_MAX_ALIASES 44
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -23,17 +29,36 @@ extern "C" {
 typedef struct dcs_decoder dcs_decoder_t;
 
 /*
- * Callback fired on each confirmed DCS decode.
+ * Callback fired on each confirmed DCS decode, once per codeword from the
+ * second one on.  Only the one code locked on is reported, not the
+ * standard codes that are rotations of it (see dcs_code_aliases).
  *   code     - decimal DCS code number (e.g. 19 for D023, 21 for D025)
  *   inverted - 1 if inverted polarity ("N" suffix), 0 for normal
  *   context  - user context pointer passed to dcs_decoder_set_callback
  */
 typedef void (*dcs_callback_t)(int code, int inverted, void *context);
 
+/*
+ * Callback fired with each block of low-passed, decimated samples, before
+ * bit recovery runs on them.  Lets other sub-audio detectors (e.g. CTCSS)
+ * share the decoder's filter instead of running their own.
+ *   samples       - filtered samples, dcs_decoder_get_decimation() input
+ *                   samples apart
+ *   numSamples    - number of filtered samples
+ *   firstPosition - absolute input-sample index of samples[0]
+ *   context       - user context pointer passed to
+ *                   dcs_decoder_set_lowpass_callback
+ */
+typedef void (*dcs_lowpass_callback_t)(const dcs_sample_t *samples, int numSamples,
+                                       unsigned long long firstPosition,
+                                       void *context);
+
 /*
  * dcs_decoder_new
  *   Allocate and initialize a new DCS decoder.
- *   sampleRate - audio sample rate in Hz (typically 16000 or 96000)
+ *   sampleRate - audio sample rate in Hz (typically 16000 or 96000).
+ *                The input is decimated internally to ~2.4 kHz before
+ *                bit recovery, so higher rates cost little extra.
  *   Returns pointer to decoder, or NULL on allocation failure.
  */
 dcs_decoder_t *dcs_decoder_new(int sampleRate);
@@ -62,6 +87,41 @@ void dcs_decoder_set_callback(dcs_decoder_t *decoder,
                               dcs_callback_t callback,
                               void *context);
 
+/*
+ * dcs_decoder_set_lowpass_callback
+ *   Set the callback that receives the decimated sub-audio stream.
+ */
+void dcs_decoder_set_lowpass_callback(dcs_decoder_t *decoder,
+                                      dcs_lowpass_callback_t callback,
+                                      void *context);
+
+/*
+ * dcs_decoder_get_decimation
+ *   Input samples per decimated sample; the internal rate is
+ *   sampleRate / decimation.
+ */
+int dcs_decoder_get_decimation(const dcs_decoder_t *decoder);
+
+/*
+ * dcs_decoder_get_position
+ *   Absolute input-sample index (counted from dcs_decoder_new) of the
+ *   sample that completed the codeword being reported.  Only meaningful
+ *   from within the callback; lets callers place stream tags on the
+ *   sample where the code was confirmed rather than the buffer start.
+ */
+unsigned long long dcs_decoder_get_position(const dcs_decoder_t *decoder);
+
+/*
+ * dcs_code_aliases
+ *   The standard codes whose codeword is a rotation of code's, so the
+ *   continuous bitstream on the air is the same one.  Which of them is
+ *   reported only depends on where the decoder first found a whole word,
+ *   which is where the transmission started unless the noise before it
+ *   happened to match.  Fills up to max codes and their polarities and
+ *   returns how many there were, at most DCS_MAX_ALIASES.
+ */
+int dcs_code_aliases(int code, int inverted, int *codes, int *inverted_out, int max);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,40 +35,6 @@
 #include "fsync_decode.h"
 #include <stdlib.h>
 
-static float _sintable[] = {
-    0.000000, 0.024541, 0.049068, 0.073565, 0.098017, 0.122411, 0.146730, 0.170962,
-    0.195090, 0.219101, 0.242980, 0.266713, 0.290285, 0.313682, 0.336890, 0.359895,
-    0.382683, 0.405241, 0.427555, 0.449611, 0.471397, 0.492898, 0.514103, 0.534998,
-    0.555570, 0.575808, 0.595699, 0.615232, 0.634393, 0.653173, 0.671559, 0.689541,
-    0.707107, 0.724247, 0.740951, 0.757209, 0.773010, 0.788346, 0.803208, 0.817585,
-    0.831470, 0.844854, 0.857729, 0.870087, 0.881921, 0.893224, 0.903989, 0.914210,
-    0.923880, 0.932993, 0.941544, 0.949528, 0.956940, 0.963776, 0.970031, 0.975702,
-    0.980785, 0.985278, 0.989177, 0.992480, 0.995185, 0.997290, 0.998795, 0.999699,
-    1.000000, 0.999699, 0.998795, 0.997290, 0.995185, 0.992480, 0.989177, 0.985278,
-    0.980785, 0.975702, 0.970031, 0.963776, 0.956940, 0.949528, 0.941544, 0.932993,
-    0.923880, 0.914210, 0.903989, 0.893224, 0.881921, 0.870087, 0.857729, 0.844854,
-    0.831470, 0.817585, 0.803208, 0.788346, 0.773010, 0.757209, 0.740951, 0.724247,
-    0.707107, 0.689541, 0.671559, 0.653173, 0.634393, 0.615232, 0.595699, 0.575808,
-    0.555570, 0.534998, 0.514103, 0.492898, 0.471397, 0.449611, 0.427555, 0.405241,
-    0.382683, 0.359895, 0.336890, 0.313682, 0.290285, 0.266713, 0.242980, 0.219101,
-    0.195090, 0.170962, 0.146730, 0.122411, 0.098017, 0.073565, 0.049068, 0.024541,
-    0.000000, -0.024541, -0.049068, -0.073565, -0.098017, -0.122411, -0.146730, -0.170962,
-    -0.195090, -0.219101, -0.242980, -0.266713, -0.290285, -0.313682, -0.336890, -0.359895,
-    -0.382683, -0.405241, -0.427555, -0.449611, -0.471397, -0.492898, -0.514103, -0.534998,
-    -0.555570, -0.575808, -0.595699, -0.615232, -0.634393, -0.653173, -0.671559, -0.689541,
-    -0.707107, -0.724247, -0.740951, -0.757209, -0.773010, -0.788346, -0.803208, -0.817585,
-    -0.831470, -0.844854, -0.857729, -0.870087, -0.881921, -0.893224, -0.903989, -0.914210,
-    -0.923880, -0.932993, -0.941544, -0.949528, -0.956940, -0.963776, -0.970031, -0.975702,
-    -0.980785, -0.985278, -0.989177, -0.992480, -0.995185, -0.997290, -0.998795, -0.999699,
-    -1.000000, -0.999699, -0.998795, -0.997290, -0.995185, -0.992480, -0.989177, -0.985278,
-    -0.980785, -0.975702, -0.970031, -0.963776, -0.956940, -0.949528, -0.941544, -0.932993,
-    -0.923880, -0.914210, -0.903989, -0.893224, -0.881921, -0.870087, -0.857729, -0.844854,
-    -0.831470, -0.817585, -0.803208, -0.788346, -0.773010, -0.757209, -0.740951, -0.724247,
-    -0.707107, -0.689541, -0.671559, -0.653173, -0.634393, -0.615232, -0.595699, -0.575808,
-    -0.555570, -0.534998, -0.514103, -0.492898, -0.471397, -0.449611, -0.427555, -0.405241,
-    -0.382683, -0.359895, -0.336890, -0.313682, -0.290285, -0.266713, -0.242980, -0.219101,
-    -0.195090, -0.170962, -0.146730, -0.122411, -0.098017, -0.073565, -0.049068, -0.024541};
-
 static int _fsync_crc(int word1, int word2) {
 
   int paritybit = 0;
@@ -145,11 +111,17 @@ fsync_decoder_t *fsync_decoder_new(int sampleRate) {
   decoder->actives = 0;
   decoder->level = 0;
 
+  afsk_correlator_init(&decoder->corr, FSYNC_ND);
+
   for (i = 0; i < FSYNC_ND; i++) {
     decoder->th[i] = 0.0 + (((fsync_float_t)i) * (TWOPI / (fsync_float_t)FSYNC_ND_12));
     while (decoder->th[i] >= TWOPI)
       decoder->th[i] -= TWOPI;
-    decoder->thx[i] = decoder->th[i];
+    // 1200 baud: 1800 Hz space, 1200 Hz mark; 2400 baud: 2400 Hz space, 1200 Hz mark
+    if (i < FSYNC_ND_12)
+      afsk_correlator_set_tones(&decoder->corr, i, 1800.0, 1200.0, sampleRate);
+    else
+      afsk_correlator_set_tones(&decoder->corr, i, 2400.0, 1200.0, sampleRate);
     decoder->zc[i] = 0;
     decoder->xorb[i] = 0;
     decoder->shstate[i] = 0;
@@ -512,43 +484,18 @@ int fsync_decoder_process_samples(fsync_decoder_t *decoder,
     }
 #else /* ZEROCROSSING */
 
-    for (j = 0; j < FSYNC_ND; j++) {
-      int th_zero, th_one;
-      if (j < FSYNC_ND_12) {
-        th_zero = (int)((256.0 / TWOPI) * decoder->thx[j]);
-        th_one = (int)((256.0 / TWOPI) * decoder->th[j]);
-      } else {
-        th_zero = (int)((256.0 / TWOPI) * decoder->th[j]);
-        th_one = (int)((256.0 / TWOPI) * decoder->thx[j]);
-      }
-
-      decoder->accum0[j] += _sintable[th_zero] * value;
-      decoder->accum1[j] += _sintable[th_one] * value;
-
-      decoder->accum0i[j] += _sintable[(th_zero + 64) % 256] * value;
-      decoder->accum1i[j] += _sintable[(th_one + 64) % 256] * value;
-      //
+    // Correlate against both tones for every hypothesis at once, then
+    // clock out the hypotheses that reached a bit boundary
+    afsk_correlator_update(&decoder->corr, value);
 
-      if (j < FSYNC_ND_12) {
+    for (j = 0; j < FSYNC_ND; j++) {
+      if (j < FSYNC_ND_12)
         decoder->th[j] += decoder->incr;
-        decoder->thx[j] += 1.5 * decoder->incr;
-      } else {
+      else
         decoder->th[j] += 2 * (decoder->incr);
-        decoder->thx[j] += decoder->incr;
-      }
-
-      while (decoder->thx[j] >= TWOPI)
-        decoder->thx[j] -= TWOPI;
 
       if (decoder->th[j] >= TWOPI) {
-        if (
-            (decoder->accum0[j] * decoder->accum0[j]) + (decoder->accum0i[j] * decoder->accum0i[j]) > (decoder->accum1[j] * decoder->accum1[j]) + (decoder->accum1i[j] * decoder->accum1i[j]))
-          decoder->xorb[j] = 0;
-        else
-          decoder->xorb[j] = 1;
-
-        decoder->accum0[j] = decoder->accum1[j] = 0.0;
-        decoder->accum0i[j] = decoder->accum1i[j] = 0.0;
+        decoder->xorb[j] = afsk_correlator_decide(&decoder->corr, j);
 
         _shiftin(decoder, j);
 
@@ -35,6 +35,7 @@
 #ifndef _FSYNC_DECODE_H_
 #define _FSYNC_DECODE_H_
 
+#include "afsk_correlator.h"
 #include "fsync_types.h"
 
 #ifndef TWOPI
@@ -46,6 +47,8 @@
 
 #define FSYNC_GDTHRESH 4 // "good bits" threshold
 
+#define FSYNC_MIN_SAMPLE_RATE 16000 // keeps enough samples per bit for 2400 baud FleetSync II
+
 #define DIFFERENTIATOR
 
 // #define ZEROCROSSING /* turn off for better correlator method */
@@ -55,14 +58,10 @@ typedef void (*fsync_decoder_callback_t)(int cmd, int subcmd, int from_fleet, in
 typedef struct {
   fsync_float_t hyst;
   fsync_float_t incr;
-  fsync_float_t th[FSYNC_ND];
-  fsync_float_t thx[FSYNC_ND];
+  fsync_float_t th[FSYNC_ND]; // bit clock of each hypothesis
   fsync_int_t level;
   fsync_float_t lastvalue;
-  fsync_float_t accum0[FSYNC_ND];
-  fsync_float_t accum1[FSYNC_ND];
-  fsync_float_t accum0i[FSYNC_ND];
-  fsync_float_t accum1i[FSYNC_ND];
+  afsk_correlator_t corr;     // tone 0 = space, tone 1 = mark (1200 Hz)
   fsync_int_t zc[FSYNC_ND];
   fsync_int_t xorb[FSYNC_ND];
   fsync_u32_t synclow[FSYNC_ND];
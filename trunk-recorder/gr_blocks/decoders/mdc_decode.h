@@ -47,10 +47,12 @@
 
 #ifdef MDC_FOURPOINT
 #define MDC_ND 5 // recommended for four-point method
+#define MDC_MIN_SAMPLE_RATE 16000 // lowest rate the four-point method works at
 #endif
 
 #ifdef MDC_ONEPOINT
 #define MDC_ND 4 // recommended for one-point method
+#define MDC_MIN_SAMPLE_RATE 8000
 #endif
 
 typedef void (*mdc_decoder_callback_t)(int frameCount, // 1 or 2 - if 2 then extra0-3 are valid
@@ -23,13 +23,70 @@
 #ifndef INCLUDED_GR_SIGNAL_DECODER_SINK_H
 #define INCLUDED_GR_SIGNAL_DECODER_SINK_H
 
+#include "../decoder_wrapper.h"
 #include <boost/log/trivial.hpp>
 #include <gnuradio/blocks/api.h>
 #include <gnuradio/sync_block.h>
+#include <stdint.h>
+#include <string>
 
 namespace gr {
 namespace blocks {
 
+/* Bits for signal_decoder_sink::set_enabled_decoders().  Registered
+ * decoders get the bits from SIGNAL_DECODER_FIRST_PLUGIN up, as many as
+ * are left in a signal_decoder_mask_t. */
+typedef uint32_t signal_decoder_mask_t;
+
+enum SignalDecoder : signal_decoder_mask_t { SIGNAL_DECODER_DCS = 1u << 0,
+                                             SIGNAL_DECODER_MDC = 1u << 1,
+                                             SIGNAL_DECODER_FSYNC = 1u << 2,
+                                             SIGNAL_DECODER_STAR = 1u << 3,
+                                             SIGNAL_DECODER_FIRST_PLUGIN = 1u << 4 };
+
+#define SIGNAL_DECODER_BUILTINS 4
+#define SIGNAL_DECODER_MAX_PLUGINS (32 - SIGNAL_DECODER_BUILTINS)
+
+static_assert(SIGNAL_DECODER_BUILTINS + SIGNAL_DECODER_MAX_PLUGINS <= sizeof(signal_decoder_mask_t) * 8,
+              "every signal decoder needs a bit of signal_decoder_mask_t");
+
+/* A decoder calls this for every decode.  unit_id and signal are passed to
+ * the signal() plugin call as they are; payload, if not NULL, is included
+ * in the log line (truncated to 64 characters).  Safe to call from
+ * process() only. */
+typedef void (*signal_decoder_report_t)(void *report_context, long unit_id, SignalType signal, const char *payload);
+
+/*!
+ * \brief A signalling decoder supplied from outside the sink, e.g. by a
+ * plugin from its init().
+ *
+ * \details
+ * Each signal_decoder_sink that enables it calls create() once with the
+ * rate it will be fed, which is between min_sample_rate and the recorder's
+ * audio rate: sinks decimate once for all the decoders that can run at
+ * the same rate.  process() is then called with every buffer, on the
+ * flowgraph thread or the decoder thread, and must not block.
+ */
+struct signal_decoder_plugin {
+  std::string name; // used in the log line and by the signalDecoders system option
+  int min_sample_rate;
+  void *(*create)(int sample_rate, signal_decoder_report_t report, void *report_context);
+  void (*process)(void *decoder, const float *samples, int n);
+  void (*destroy)(void *decoder);
+};
+
+/* Make a decoder available to every signal_decoder_sink.  Returns its
+ * SignalDecoder bit, or 0 if the name is taken or there is no room.
+ *
+ * The registry is the one the core's sinks use.  A plugin links its own
+ * copy of this code, with a registry of its own that no sink ever reads,
+ * so it must call the core's through Config::register_signal_decoder
+ * rather than this directly. */
+BLOCKS_API signal_decoder_mask_t register_signal_decoder(const signal_decoder_plugin &plugin);
+
+/* SignalDecoder bit of a registered decoder, or 0 if there is none by that name */
+BLOCKS_API signal_decoder_mask_t find_signal_decoder(const std::string &name);
+
 /*!
  * \brief Connects a gnuradio audio block to non-gnuradio signal decoders.
  * \ingroup audio_blk
@@ -57,6 +114,13 @@ public:
   virtual bool get_fsync_enabled() { return false; };
   virtual bool get_star_enabled() { return false; };
   virtual bool get_dcs_enabled() { return false; };
+
+  // Enable exactly the decoders in mask, a combination of SignalDecoder bits
+  virtual void set_enabled_decoders(signal_decoder_mask_t mask){};
+  virtual signal_decoder_mask_t get_enabled_decoders() { return 0; };
+
+  // Deliver decodes queued since the last call, from the main loop
+  virtual void process_message_queues(){};
 };
 
 } /* namespace blocks */
@@ -23,15 +23,20 @@
 
 #include "signal_decoder_sink_impl.h"
 #include "signal_decoder_sink.h"
+#include <algorithm>
 #include <boost/math/special_functions/round.hpp>
+#include <chrono>
 #include <climits>
+#include <cstdlib>
 #include <cmath>
 #include <cstring>
 #include <fcntl.h>
 #include <gnuradio/io_signature.h>
 #include <gnuradio/thread/thread.h>
+#include <mutex>
 #include <stdexcept>
 #include <stdio.h>
+#include <volk/volk.h>
 
 #include "dcs_decode.h"
 #include "fsync_decode.h"
@@ -41,6 +46,49 @@
 namespace gr {
 namespace blocks {
 
+// Decoders added with register_signal_decoder(), by bit position -
+// SIGNAL_DECODER_BUILTINS.  Only ever appended to.
+static std::mutex registry_mutex;
+static std::vector<signal_decoder_plugin> registry;
+
+static signal_decoder_mask_t plugin_bit(size_t index) {
+  return (signal_decoder_mask_t)SIGNAL_DECODER_FIRST_PLUGIN << index;
+}
+
+signal_decoder_mask_t register_signal_decoder(const signal_decoder_plugin &plugin) {
+  std::lock_guard<std::mutex> guard(registry_mutex);
+
+  if (plugin.name.empty() || !plugin.create || !plugin.process || (plugin.min_sample_rate <= 0)) {
+    BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: decoder \"" << plugin.name << "\" needs a name, a minimum sample rate, create() and process()";
+    return 0;
+  }
+  for (const signal_decoder_plugin &existing : registry) {
+    if (existing.name == plugin.name) {
+      BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: a decoder named \"" << plugin.name << "\" is already registered";
+      return 0;
+    }
+  }
+  if (registry.size() >= SIGNAL_DECODER_MAX_PLUGINS) {
+    BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: no room to register decoder \"" << plugin.name << "\", all " << SIGNAL_DECODER_MAX_PLUGINS << " plugin bits are taken";
+    return 0;
+  }
+
+  registry.push_back(plugin);
+  BOOST_LOG_TRIVIAL(info) << "signal_decoder_sink: registered decoder \"" << plugin.name << "\", minimum sample rate " << plugin.min_sample_rate;
+  return plugin_bit(registry.size() - 1);
+}
+
+signal_decoder_mask_t find_signal_decoder(const std::string &name) {
+  std::lock_guard<std::mutex> guard(registry_mutex);
+
+  for (size_t i = 0; i < registry.size(); i++) {
+    if (registry[i].name == name) {
+      return plugin_bit(i);
+    }
+  }
+  return 0;
+}
+
 SignalType get_mdc_signal_type(unsigned char op, unsigned char arg) {
   switch (op) {
   case 0x00:
@@ -71,18 +119,16 @@ SignalType get_mdc_signal_type(unsigned char op, unsigned char arg) {
     return SignalType::Normal;
   }
 }
+// The decoder callbacks run on the DSP thread (or the decoder thread), so
+// they only copy what was decoded into the event ring.  The log lines and
+// plugin calls happen when the main loop drains it.
 void dcs_callback(int code, int inverted, void *context) {
-  char json_buffer[256];
-  char label[16];
-  /* Format code as octal with D prefix: N = normal, I = inverted */
-  snprintf(label, sizeof(label), "D%03o%s", code, inverted ? "I" : "N");
-  snprintf(json_buffer, sizeof(json_buffer),
-           "{\"type\":\"DCS\",\"timestamp\":\"%d\",\"code\":\"%s\"}\n",
-           (int)time(NULL), label);
-  BOOST_LOG_TRIVIAL(info) << json_buffer;
-
   signal_decoder_sink_impl *decoder = (signal_decoder_sink_impl *)context;
-  decoder->log_decoder_msg((long)code, "DCS", SignalType::Normal);
+  signal_event *ev = decoder->new_event(SIGNAL_DECODER_DCS, code, SignalType::Normal);
+  if (ev) {
+    ev->args[0] = inverted;
+    decoder->push_event();
+  }
 }
 
 void mdc_callback(int frameCount, // 1 or 2 - if 2 then extra0-3 are valid
@@ -94,127 +140,506 @@ void mdc_callback(int frameCount, // 1 or 2 - if 2 then extra0-3 are valid
                   unsigned char extra2,
                   unsigned char extra3,
                   void *context) {
-  char json_buffer[2048];
-  snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"MDC1200\","
-                                             "\"timestamp\":\"%d\","
-                                             "\"op\":\"%02x\","
-                                             "\"arg\":\"%02x\","
-                                             "\"unitID\":\"%04x\","
-                                             "\"ex0\":\"%02x\","
-                                             "\"ex1\":\"%02x\","
-                                             "\"ex2\":\"%02x\","
-                                             "\"ex3\":\"%02x\"}\n",
-           (int)time(NULL), op, arg, unitID, extra0, extra1, extra2, extra3);
-
-  BOOST_LOG_TRIVIAL(info) << json_buffer;
-
   signal_decoder_sink_impl *decoder = (signal_decoder_sink_impl *)context;
-
-  decoder->log_decoder_msg(unitID, "MDC1200", get_mdc_signal_type(op, arg));
+  signal_event *ev = decoder->new_event(SIGNAL_DECODER_MDC, unitID, get_mdc_signal_type(op, arg));
+  if (ev) {
+    ev->args[0] = op;
+    ev->args[1] = arg;
+    ev->args[2] = extra0;
+    ev->args[3] = extra1;
+    ev->args[4] = extra2;
+    ev->args[5] = extra3;
+    decoder->push_event();
+  }
 }
 
 void fsync_callback(int cmd, int subcmd, int from_fleet, int from_unit, int to_fleet, int to_unit, int allflag, unsigned char *payload, int payload_len, unsigned char *raw_msg, int raw_msg_len, void *context, int is_fsync2, int is_2400) {
-  char json_buffer[2048];
-  snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"FLEETSYNC\","
-                                             "\"timestamp\":\"%d\","
-                                             "\"cmd\":\"%d\","
-                                             "\"subcmd\":\"%d\","
-                                             "\"from_fleet\":\"%d\","
-                                             "\"from_unit\":\"%d\","
-                                             "\"to_fleet\":\"%d\","
-                                             "\"to_unit\":\"%d\","
-                                             "\"all_flag\":\"%d\","
-                                             "\"payload\":\"%.*s\","
-                                             "\"fsync2\":\"%d\","
-                                             "\"2400\":\"%d\"}\n",
-           (int)time(NULL), cmd, subcmd, from_fleet, from_unit,
-           to_fleet, to_unit, allflag,
-           payload_len, payload,
-           is_fsync2, is_2400);
-
-  BOOST_LOG_TRIVIAL(info) << json_buffer;
-
   signal_decoder_sink_impl *decoder = (signal_decoder_sink_impl *)context;
-  decoder->log_decoder_msg(from_unit, "FLEETSYNC", SignalType::Normal);
+  signal_event *ev = decoder->new_event(SIGNAL_DECODER_FSYNC, from_unit, SignalType::Normal);
+  if (ev) {
+    ev->args[0] = cmd;
+    ev->args[1] = subcmd;
+    ev->args[2] = from_fleet;
+    ev->args[3] = to_fleet;
+    ev->args[4] = to_unit;
+    ev->args[5] = allflag;
+    ev->args[6] = is_fsync2;
+    ev->args[7] = is_2400;
+    ev->payload_len = std::max(0, std::min(payload_len, (int)sizeof(ev->payload)));
+    if (payload && ev->payload_len > 0) {
+      memcpy(ev->payload, payload, ev->payload_len);
+    }
+    decoder->push_event();
+  }
 }
 
 void star_callback(int unitID, int tag, int status, int message, void *context) {
+  signal_decoder_sink_impl *decoder = (signal_decoder_sink_impl *)context;
+  signal_event *ev = decoder->new_event(SIGNAL_DECODER_STAR, unitID, SignalType::Normal);
+  if (ev) {
+    ev->args[0] = tag;
+    ev->args[1] = status;
+    ev->args[2] = message;
+    decoder->push_event();
+  }
+}
+
+void plugin_callback(void *context, long unit_id, SignalType signal, const char *payload) {
+  signal_decoder_instance *instance = (signal_decoder_instance *)context;
+  signal_event *ev = instance->sink->new_event(instance->bit, unit_id, signal);
+  if (ev) {
+    if (payload) {
+      ev->payload_len = strnlen(payload, sizeof(ev->payload));
+      memcpy(ev->payload, payload, ev->payload_len);
+    }
+    instance->sink->push_event();
+  }
+}
+
+// Log an event the way the decoders used to, then hand it on
+void signal_decoder_sink_impl::deliver_event(const signal_event &ev) {
   char json_buffer[2048];
-  snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"STAR\","
-                                             "\"timestamp\":\"%d\","
-                                             "\"unitID\":\"%d\","
-                                             "\"tag\":\"%d\","
-                                             "\"status\":\"%d\","
-                                             "\"message\":\"%d\"}\n",
-           (int)time(NULL), unitID, tag, status, message);
+  const char *signaling_type = "";
 
-  BOOST_LOG_TRIVIAL(info) << json_buffer;
+  switch (ev.decoder) {
+  case SIGNAL_DECODER_DCS: {
+    char label[16];
+    /* Format code as octal with D prefix: N = normal, I = inverted */
+    snprintf(label, sizeof(label), "D%03o%s", (int)ev.unit_id, ev.args[0] ? "I" : "N");
+    snprintf(json_buffer, sizeof(json_buffer),
+             "{\"type\":\"DCS\",\"timestamp\":\"%d\",\"code\":\"%s\"}\n",
+             (int)ev.timestamp, label);
+    signaling_type = "DCS";
+    break;
+  }
+  case SIGNAL_DECODER_MDC:
+    snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"MDC1200\","
+                                               "\"timestamp\":\"%d\","
+                                               "\"op\":\"%02x\","
+                                               "\"arg\":\"%02x\","
+                                               "\"unitID\":\"%04x\","
+                                               "\"ex0\":\"%02x\","
+                                               "\"ex1\":\"%02x\","
+                                               "\"ex2\":\"%02x\","
+                                               "\"ex3\":\"%02x\"}\n",
+             (int)ev.timestamp, ev.args[0], ev.args[1], (unsigned int)ev.unit_id, ev.args[2], ev.args[3], ev.args[4], ev.args[5]);
+    signaling_type = "MDC1200";
+    break;
+  case SIGNAL_DECODER_FSYNC:
+    snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"FLEETSYNC\","
+                                               "\"timestamp\":\"%d\","
+                                               "\"cmd\":\"%d\","
+                                               "\"subcmd\":\"%d\","
+                                               "\"from_fleet\":\"%d\","
+                                               "\"from_unit\":\"%d\","
+                                               "\"to_fleet\":\"%d\","
+                                               "\"to_unit\":\"%d\","
+                                               "\"all_flag\":\"%d\","
+                                               "\"payload\":\"%.*s\","
+                                               "\"fsync2\":\"%d\","
+                                               "\"2400\":\"%d\"}\n",
+             (int)ev.timestamp, ev.args[0], ev.args[1], ev.args[2], (int)ev.unit_id,
+             ev.args[3], ev.args[4], ev.args[5],
+             ev.payload_len, (const char *)ev.payload,
+             ev.args[6], ev.args[7]);
+    signaling_type = "FLEETSYNC";
+    break;
+  case SIGNAL_DECODER_STAR:
+    snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"STAR\","
+                                               "\"timestamp\":\"%d\","
+                                               "\"unitID\":\"%d\","
+                                               "\"tag\":\"%d\","
+                                               "\"status\":\"%d\","
+                                               "\"message\":\"%d\"}\n",
+             (int)ev.timestamp, (int)ev.unit_id, ev.args[0], ev.args[1], ev.args[2]);
+    signaling_type = "STAR";
+    break;
+  default: {
+    const int index = __builtin_ctz(ev.decoder) - SIGNAL_DECODER_BUILTINS;
+    if ((index < 0) || (index >= SIGNAL_DECODER_MAX_PLUGINS) || !d_plugins[index].decoder) {
+      return;
+    }
+    signaling_type = d_plugins[index].plugin.name.c_str();
+    snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"%s\","
+                                               "\"timestamp\":\"%d\","
+                                               "\"unitID\":\"%ld\","
+                                               "\"payload\":\"%.*s\"}\n",
+             signaling_type, (int)ev.timestamp, ev.unit_id, ev.payload_len, (const char *)ev.payload);
+    break;
+  }
+  }
 
-  signal_decoder_sink_impl *decoder = (signal_decoder_sink_impl *)context;
-  decoder->log_decoder_msg(unitID, "STAR", SignalType::Normal);
+  BOOST_LOG_TRIVIAL(info) << json_buffer;
+  log_decoder_msg(ev.unit_id, signaling_type, ev.signal);
 }
 
+// Minimum input rate of each built in decoder, indexed by SignalDecoder bit position
+static const int DECODER_MIN_RATE[SIGNAL_DECODER_BUILTINS] = {DCS_MIN_SAMPLE_RATE, MDC_MIN_SAMPLE_RATE, FSYNC_MIN_SAMPLE_RATE, STAR_MIN_SAMPLE_RATE};
+
+// Largest chunk the worker decodes while holding the mutex
+#define WORKER_CHUNK 4096
+
 signal_decoder_sink_impl::sptr
-signal_decoder_sink_impl::make(unsigned int sample_rate, decoder_callback callback) {
-  return gnuradio::get_initial_sptr(new signal_decoder_sink_impl(sample_rate, callback));
+signal_decoder_sink_impl::make(unsigned int sample_rate, decoder_callback callback, bool threaded) {
+  return gnuradio::get_initial_sptr(new signal_decoder_sink_impl(sample_rate, callback, threaded));
 }
 
-signal_decoder_sink_impl::signal_decoder_sink_impl(unsigned int sample_rate, decoder_callback callback)
+signal_decoder_sink_impl::signal_decoder_sink_impl(unsigned int sample_rate, decoder_callback callback, bool threaded)
     : sync_block("signal_decoder_sink_impl",
                  io_signature::make(1, 1, sizeof(float)),
                  io_signature::make(0, 0, 0)),
+      d_sample_rate(sample_rate),
+      d_dcs_decoder(NULL),
+      d_mdc_decoder(NULL),
+      d_fsync_decoder(NULL),
+      d_star_decoder(NULL),
       d_callback(callback),
-      d_dcs_enabled(false),
-      d_mdc_enabled(false),
-      d_fsync_enabled(false),
-      d_star_enabled(false) {
-  d_dcs_decoder  = dcs_decoder_new(sample_rate);
-  d_mdc_decoder  = mdc_decoder_new(sample_rate);
-  d_fsync_decoder = fsync_decoder_new(sample_rate);
-  d_star_decoder  = star_decoder_new(sample_rate);
-
-  dcs_decoder_set_callback(d_dcs_decoder, dcs_callback, this);
-  mdc_decoder_set_callback(d_mdc_decoder, mdc_callback, this);
-  fsync_decoder_set_callback(d_fsync_decoder, fsync_callback, this);
-  star_decoder_set_callback(d_star_decoder, star_format_1_16383, star_callback, this);
-}
-
-void signal_decoder_sink_impl::set_dcs_enabled(bool b) { d_dcs_enabled = b; };
-void signal_decoder_sink_impl::set_mdc_enabled(bool b) { d_mdc_enabled = b; };
-void signal_decoder_sink_impl::set_fsync_enabled(bool b) { d_fsync_enabled = b; };
-void signal_decoder_sink_impl::set_star_enabled(bool b) { d_star_enabled = b; };
-
-bool signal_decoder_sink_impl::get_dcs_enabled() { return d_dcs_enabled; };
-bool signal_decoder_sink_impl::get_mdc_enabled() { return d_mdc_enabled; };
-bool signal_decoder_sink_impl::get_fsync_enabled() { return d_fsync_enabled; };
-bool signal_decoder_sink_impl::get_star_enabled() { return d_star_enabled; };
+      d_enabled(0),
+      d_threaded(threaded),
+      d_ring_mask(0),
+      d_ring_head(0),
+      d_ring_tail(0),
+      d_dropped(0),
+      d_running(false),
+      d_event_head(0),
+      d_event_tail(0),
+      d_events_dropped(0),
+      d_processed(0),
+      d_buffer_offset(0) {
+  for (int i = 0; i < SIGNAL_DECODER_BUILTINS + SIGNAL_DECODER_MAX_PLUGINS; i++) {
+    d_decoder_stage[i] = -1;
+  }
+  for (int i = 0; i < SIGNAL_DECODER_MAX_PLUGINS; i++) {
+    d_plugins[i].sink = this;
+    d_plugins[i].bit = plugin_bit(i);
+    d_plugins[i].decoder = NULL;
+  }
+
+  if (d_threaded) {
+    // Two seconds of audio, enough to ride out a busy worker
+    size_t size = 1;
+    while (size < 2 * (size_t)sample_rate) {
+      size <<= 1;
+    }
+    d_ring.assign(size, 0.0f);
+    d_ring_mask = size - 1;
+    d_running = true;
+    d_worker = std::thread(&signal_decoder_sink_impl::worker, this);
+  }
+}
+
+signal_decoder_sink_impl::~signal_decoder_sink_impl() {
+  if (d_running.exchange(false) && d_worker.joinable()) {
+    d_worker.join();
+  }
+
+  // mdc, fsync and star decoders are a single malloc'd struct each
+  dcs_decoder_delete(d_dcs_decoder);
+  free(d_mdc_decoder);
+  free(d_fsync_decoder);
+  free(d_star_decoder);
+  for (int i = 0; i < SIGNAL_DECODER_MAX_PLUGINS; i++) {
+    if (d_plugins[i].decoder && d_plugins[i].plugin.destroy) {
+      d_plugins[i].plugin.destroy(d_plugins[i].decoder);
+    }
+  }
+}
+
+int signal_decoder_sink_impl::min_rate(int decoder) {
+  if (decoder < SIGNAL_DECODER_BUILTINS) {
+    return DECODER_MIN_RATE[decoder];
+  }
+  return d_plugins[decoder - SIGNAL_DECODER_BUILTINS].plugin.min_sample_rate;
+}
+
+int signal_decoder_sink_impl::stage_for(int decoder) {
+  int factor = d_sample_rate / min_rate(decoder);
+  while ((factor > 1) && (d_sample_rate % factor != 0)) {
+    factor--;
+  }
+  if (factor <= 1) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < d_stages.size(); i++) {
+    if (d_stages[i].factor == factor) {
+      return i;
+    }
+  }
+
+  decim_stage stage;
+  double out_rate = (double)d_sample_rate / factor;
+  stage.factor = factor;
+  stage.taps = Filter_Taps::low_pass(1, d_sample_rate, 0.4 * out_rate, 0.2 * out_rate, Filter_Taps::HANN);
+  stage.history.assign(stage.taps->size() - 1, 0.0f);
+  stage.next = stage.taps->size() - 1;
+  d_stages.push_back(stage);
+
+  BOOST_LOG_TRIVIAL(info) << "signal_decoder_sink: decimating " << d_sample_rate << " to " << out_rate << " Hz with " << stage.taps->size() << " taps";
+  return d_stages.size() - 1;
+}
+
+int signal_decoder_sink_impl::decoder_rate(int decoder) {
+  d_decoder_stage[decoder] = stage_for(decoder);
+  if (d_decoder_stage[decoder] < 0) {
+    return d_sample_rate;
+  }
+  return d_sample_rate / d_stages[d_decoder_stage[decoder]].factor;
+}
+
+signal_decoder_mask_t signal_decoder_sink_impl::create_decoders(signal_decoder_mask_t mask) {
+  if ((mask & SIGNAL_DECODER_DCS) && !d_dcs_decoder) {
+    d_dcs_decoder = dcs_decoder_new(decoder_rate(0));
+    if (d_dcs_decoder) {
+      dcs_decoder_set_callback(d_dcs_decoder, dcs_callback, this);
+    }
+  }
+  if ((mask & SIGNAL_DECODER_MDC) && !d_mdc_decoder) {
+    d_mdc_decoder = mdc_decoder_new(decoder_rate(1));
+    if (d_mdc_decoder) {
+      mdc_decoder_set_callback(d_mdc_decoder, mdc_callback, this);
+    }
+  }
+  if ((mask & SIGNAL_DECODER_FSYNC) && !d_fsync_decoder) {
+    d_fsync_decoder = fsync_decoder_new(decoder_rate(2));
+    if (d_fsync_decoder) {
+      fsync_decoder_set_callback(d_fsync_decoder, fsync_callback, this);
+    }
+  }
+  if ((mask & SIGNAL_DECODER_STAR) && !d_star_decoder) {
+    d_star_decoder = star_decoder_new(decoder_rate(3));
+    if (d_star_decoder) {
+      star_decoder_set_callback(d_star_decoder, star_format_1_16383, star_callback, this);
+    }
+  }
+
+  if (mask >= SIGNAL_DECODER_FIRST_PLUGIN) {
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    for (int i = 0; i < SIGNAL_DECODER_MAX_PLUGINS; i++) {
+      signal_decoder_instance &instance = d_plugins[i];
+      if (!(mask & instance.bit) || instance.decoder || (i >= (int)registry.size())) {
+        continue;
+      }
+      instance.plugin = registry[i];
+      instance.decoder = instance.plugin.create(decoder_rate(SIGNAL_DECODER_BUILTINS + i), plugin_callback, &instance);
+    }
+  }
+
+  signal_decoder_mask_t created = 0;
+  for (int i = 0; i < SIGNAL_DECODER_MAX_PLUGINS; i++) {
+    created |= d_plugins[i].decoder ? d_plugins[i].bit : 0;
+  }
+  created |= d_dcs_decoder ? SIGNAL_DECODER_DCS : 0;
+  created |= d_mdc_decoder ? SIGNAL_DECODER_MDC : 0;
+  created |= d_fsync_decoder ? SIGNAL_DECODER_FSYNC : 0;
+  created |= d_star_decoder ? SIGNAL_DECODER_STAR : 0;
+  return created;
+}
+
+void signal_decoder_sink_impl::set_enabled_decoders(signal_decoder_mask_t mask) {
+  gr::thread::scoped_lock guard(d_mutex);
+
+  signal_decoder_mask_t created = create_decoders(mask);
+  if ((mask & created) != mask) {
+    BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: unable to create decoders 0x" << std::hex << (mask & ~created) << std::dec;
+  }
+  d_enabled = mask & created;
+}
+
+signal_decoder_mask_t signal_decoder_sink_impl::get_enabled_decoders() { return d_enabled; };
+
+void signal_decoder_sink_impl::set_dcs_enabled(bool b) { set_enabled_decoders(b ? (d_enabled | SIGNAL_DECODER_DCS) : (d_enabled & ~SIGNAL_DECODER_DCS)); };
+void signal_decoder_sink_impl::set_mdc_enabled(bool b) { set_enabled_decoders(b ? (d_enabled | SIGNAL_DECODER_MDC) : (d_enabled & ~SIGNAL_DECODER_MDC)); };
+void signal_decoder_sink_impl::set_fsync_enabled(bool b) { set_enabled_decoders(b ? (d_enabled | SIGNAL_DECODER_FSYNC) : (d_enabled & ~SIGNAL_DECODER_FSYNC)); };
+void signal_decoder_sink_impl::set_star_enabled(bool b) { set_enabled_decoders(b ? (d_enabled | SIGNAL_DECODER_STAR) : (d_enabled & ~SIGNAL_DECODER_STAR)); };
+
+bool signal_decoder_sink_impl::get_dcs_enabled() { return (d_enabled & SIGNAL_DECODER_DCS) != 0; };
+bool signal_decoder_sink_impl::get_mdc_enabled() { return (d_enabled & SIGNAL_DECODER_MDC) != 0; };
+bool signal_decoder_sink_impl::get_fsync_enabled() { return (d_enabled & SIGNAL_DECODER_FSYNC) != 0; };
+bool signal_decoder_sink_impl::get_star_enabled() { return (d_enabled & SIGNAL_DECODER_STAR) != 0; };
 
 int signal_decoder_sink_impl::work(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
 
+  if (d_threaded) {
+    // Most recorders have no signalling decoders enabled at all
+    if (d_enabled == 0) {
+      return noutput_items;
+    }
+
+    const float *in = (const float *)input_items[0];
+    const size_t size = d_ring.size();
+    size_t head = d_ring_head.load(std::memory_order_relaxed);
+    size_t tail = d_ring_tail.load(std::memory_order_acquire);
+    size_t count = std::min((size_t)noutput_items, size - (head - tail));
+    if (count < (size_t)noutput_items) {
+      d_dropped += noutput_items - count;
+    }
+
+    size_t pos = head & d_ring_mask;
+    size_t first = std::min(count, size - pos);
+    memcpy(&d_ring[pos], in, first * sizeof(float));
+    memcpy(&d_ring[0], in + first, (count - first) * sizeof(float));
+    d_ring_head.store(head + count, std::memory_order_release);
+    return noutput_items;
+  }
+
   gr::thread::scoped_lock guard(d_mutex); // hold mutex for duration of this
 
   return dowork(noutput_items, input_items, output_items);
 }
 
 int signal_decoder_sink_impl::dowork(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
+  process((float *)input_items[0], noutput_items);
+  return noutput_items;
+}
 
-  if (d_dcs_enabled) {
-    dcs_decoder_process_samples(d_dcs_decoder, (float *)input_items[0], noutput_items);
+void signal_decoder_sink_impl::worker() {
+  while (d_running) {
+    size_t tail = d_ring_tail.load(std::memory_order_relaxed);
+    size_t head = d_ring_head.load(std::memory_order_acquire);
+    if (head == tail) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    while (tail != head) {
+      size_t pos = tail & d_ring_mask;
+      size_t n = std::min(std::min(head - tail, d_ring.size() - pos), (size_t)WORKER_CHUNK);
+      {
+        gr::thread::scoped_lock guard(d_mutex);
+        process(&d_ring[pos], n);
+      }
+      tail += n;
+      d_ring_tail.store(tail, std::memory_order_release);
+    }
+
+    unsigned long dropped = d_dropped.exchange(0);
+    if (dropped > 0) {
+      BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: decoder thread fell behind, dropped " << dropped << " samples";
+    }
   }
+}
 
-  if (d_mdc_enabled) {
-    mdc_decoder_process_samples(d_mdc_decoder, (float *)input_items[0], noutput_items);
+void signal_decoder_sink_impl::run_stage(decim_stage &stage, const float *in, int n) {
+  const int ntaps = stage.taps->size();
+
+  // Only every factor-th output of the filter is computed
+  stage.history.insert(stage.history.end(), in, in + n);
+  stage.out.clear();
+  for (; stage.next < (int)stage.history.size(); stage.next += stage.factor) {
+    float y;
+    volk_32f_x2_dot_prod_32f(&y, &stage.history[stage.next - (ntaps - 1)], stage.taps->data(), ntaps);
+    stage.out.push_back(y);
+  }
+
+  const int drop = stage.history.size() - (ntaps - 1);
+  stage.history.erase(stage.history.begin(), stage.history.begin() + drop);
+  stage.next -= drop;
+}
+
+void signal_decoder_sink_impl::process(float *samples, int n) {
+  const signal_decoder_mask_t enabled = d_enabled;
+  d_buffer_offset = d_processed;
+  d_processed += n;
+
+  // Most recorders have no signalling decoders enabled at all
+  if (enabled == 0) {
+    return;
   }
 
-  if (d_fsync_enabled) {
-    fsync_decoder_process_samples(d_fsync_decoder, (float *)input_items[0], noutput_items);
+  // Decimate once for every stage an enabled decoder reads from
+  for (size_t s = 0; s < d_stages.size(); s++) {
+    for (signal_decoder_mask_t bits = enabled; bits != 0; bits &= bits - 1) {
+      if (d_decoder_stage[__builtin_ctz(bits)] == (int)s) {
+        run_stage(d_stages[s], samples, n);
+        break;
+      }
+    }
   }
 
-  if (d_star_enabled) {
-    star_decoder_process_samples(d_star_decoder, (float *)input_items[0], noutput_items);
+  float *in[SIGNAL_DECODER_BUILTINS + SIGNAL_DECODER_MAX_PLUGINS];
+  int count[SIGNAL_DECODER_BUILTINS + SIGNAL_DECODER_MAX_PLUGINS];
+  for (signal_decoder_mask_t bits = enabled; bits != 0; bits &= bits - 1) {
+    const int i = __builtin_ctz(bits);
+    if (d_decoder_stage[i] < 0) {
+      in[i] = samples;
+      count[i] = n;
+    } else {
+      in[i] = d_stages[d_decoder_stage[i]].out.data();
+      count[i] = d_stages[d_decoder_stage[i]].out.size();
+    }
   }
 
-  return noutput_items;
+  if (enabled & SIGNAL_DECODER_DCS) {
+    dcs_decoder_process_samples(d_dcs_decoder, in[0], count[0]);
+  }
+
+  if (enabled & SIGNAL_DECODER_MDC) {
+    mdc_decoder_process_samples(d_mdc_decoder, in[1], count[1]);
+  }
+
+  if (enabled & SIGNAL_DECODER_FSYNC) {
+    fsync_decoder_process_samples(d_fsync_decoder, in[2], count[2]);
+  }
+
+  if (enabled & SIGNAL_DECODER_STAR) {
+    star_decoder_process_samples(d_star_decoder, in[3], count[3]);
+  }
+
+  // Registered decoders get the whole buffer in one call
+  for (signal_decoder_mask_t bits = enabled / SIGNAL_DECODER_FIRST_PLUGIN; bits != 0; bits &= bits - 1) {
+    const int i = __builtin_ctz(bits);
+    d_plugins[i].plugin.process(d_plugins[i].decoder, in[SIGNAL_DECODER_BUILTINS + i], count[SIGNAL_DECODER_BUILTINS + i]);
+  }
+}
+
+signal_event *signal_decoder_sink_impl::new_event(signal_decoder_mask_t decoder, long unit_id, SignalType signal) {
+  size_t head = d_event_head.load(std::memory_order_relaxed);
+  size_t tail = d_event_tail.load(std::memory_order_acquire);
+  if (head - tail >= EVENT_RING_SIZE) {
+    d_events_dropped++;
+    return NULL;
+  }
+
+  signal_event *ev = &d_events[head & (EVENT_RING_SIZE - 1)];
+  ev->decoder = decoder;
+  ev->unit_id = unit_id;
+  ev->signal = signal;
+  ev->sample_offset = d_buffer_offset;
+  ev->timestamp = time(NULL);
+  ev->payload_len = 0;
+  return ev;
+}
+
+void signal_decoder_sink_impl::push_event() {
+  size_t head = d_event_head.load(std::memory_order_relaxed);
+  size_t tail = d_event_tail.load(std::memory_order_acquire);
+  const signal_event &ev = d_events[head & (EVENT_RING_SIZE - 1)];
+
+  // The consumer only reads slots, so the previous one can be compared to
+  // as long as it hasn't been released
+  if ((ev.decoder == SIGNAL_DECODER_DCS) && (head != tail)) {
+    const signal_event &prev = d_events[(head - 1) & (EVENT_RING_SIZE - 1)];
+    if ((prev.decoder == SIGNAL_DECODER_DCS) && (prev.unit_id == ev.unit_id) && (prev.args[0] == ev.args[0])) {
+      return;
+    }
+  }
+  d_event_head.store(head + 1, std::memory_order_release);
+}
+
+void signal_decoder_sink_impl::process_message_queues() {
+  size_t tail = d_event_tail.load(std::memory_order_relaxed);
+  size_t head = d_event_head.load(std::memory_order_acquire);
+
+  for (; tail != head; tail++) {
+    deliver_event(d_events[tail & (EVENT_RING_SIZE - 1)]);
+  }
+  d_event_tail.store(tail, std::memory_order_release);
+
+  unsigned long dropped = d_events_dropped.exchange(0);
+  if (dropped > 0) {
+    BOOST_LOG_TRIVIAL(error) << "signal_decoder_sink: event queue full, dropped " << dropped << " decodes";
+  }
 }
 
 void signal_decoder_sink_impl::log_decoder_msg(long unitId, const char *signaling_type, SignalType signal) {
@@ -24,8 +24,12 @@
 #define INCLUDED_GR_SIGNAL_DECODER_SINK_IMPL_H
 
 #include "../decoder_wrapper.h"
+#include "../filter_taps.h"
 #include "signal_decoder_sink.h"
+#include <atomic>
 #include <boost/log/trivial.hpp>
+#include <thread>
+#include <vector>
 
 #include "dcs_decode.h"
 #include "fsync_decode.h"
@@ -35,18 +39,96 @@
 namespace gr {
 namespace blocks {
 
+// One decode, as queued by the decoder callbacks for the main loop
+struct signal_event {
+  signal_decoder_mask_t decoder; // SignalDecoder bit
+  long unit_id;           // unit ID, or the DCS code
+  SignalType signal;
+  uint64_t sample_offset; // decoder input samples before the buffer it was decoded in
+  time_t timestamp;
+  int args[8];            // decoder specific fields for the log line
+  int payload_len;        // FleetSync message text, truncated
+  unsigned char payload[64];
+};
+
+class signal_decoder_sink_impl;
+
+// A registered decoder created by one sink; the context of its report calls
+struct signal_decoder_instance {
+  signal_decoder_sink_impl *sink;
+  signal_decoder_mask_t bit;
+  signal_decoder_plugin plugin;
+  void *decoder;
+};
+
 class signal_decoder_sink_impl : public signal_decoder_sink {
 private:
+  // Each decoder is created the first time it is enabled and kept after
+  unsigned int d_sample_rate;
   dcs_decoder_t  *d_dcs_decoder;
   mdc_decoder_t  *d_mdc_decoder;
   fsync_decoder_t *d_fsync_decoder;
   star_decoder_t  *d_star_decoder;
   decoder_callback d_callback;
 
-  bool d_dcs_enabled;
-  bool d_mdc_enabled;
-  bool d_fsync_enabled;
-  bool d_star_enabled;
+  std::atomic<signal_decoder_mask_t> d_enabled; // SignalDecoder bits
+
+  // Shared decimation ahead of the decoders.  A decoder is fed from the
+  // stage with the largest factor its minimum sample rate allows, so
+  // decoders needing the same rate share one filter.  Stages are created
+  // with the first decoder that needs them.
+  struct decim_stage {
+    int factor;
+    Filter_Taps::Real taps;     // symmetric low-pass, shared
+    std::vector<float> history; // taps.size() - 1 carried samples, then new ones
+    int next;                   // history index of the last sample of the next output
+    std::vector<float> out;
+  };
+  std::vector<decim_stage> d_stages;
+  int d_decoder_stage[SIGNAL_DECODER_BUILTINS + SIGNAL_DECODER_MAX_PLUGINS]; // per decoder bit, index into d_stages or -1 for full rate
+
+  // Registered decoders, by bit position - SIGNAL_DECODER_BUILTINS
+  signal_decoder_instance d_plugins[SIGNAL_DECODER_MAX_PLUGINS];
+
+  // Optional worker thread: work() only copies into a single-producer,
+  // single-consumer ring and the decoders run on the worker instead of
+  // the flowgraph thread.
+  bool d_threaded;
+  std::vector<float> d_ring; // size is a power of two
+  size_t d_ring_mask;
+  std::atomic<size_t> d_ring_head; // written by work()
+  std::atomic<size_t> d_ring_tail; // written by the worker
+  std::atomic<unsigned long> d_dropped;
+  std::atomic<bool> d_running;
+  std::thread d_worker;
+
+  // Events from the decoders to the main loop: single producer (whichever
+  // thread runs process()), single consumer (process_message_queues()).
+  // Preallocated, so decoding never allocates; if the main loop falls
+  // that far behind, new events are dropped and counted.
+  static const size_t EVENT_RING_SIZE = 128; // power of two
+  signal_event d_events[EVENT_RING_SIZE];
+  std::atomic<size_t> d_event_head;
+  std::atomic<size_t> d_event_tail;
+  std::atomic<unsigned long> d_events_dropped;
+  uint64_t d_processed;     // samples given to process() so far
+  uint64_t d_buffer_offset; // of those, the ones before the current buffer
+
+  void deliver_event(const signal_event &ev);
+
+  // Create any decoders in mask that don't exist yet; returns the bits that do
+  signal_decoder_mask_t create_decoders(signal_decoder_mask_t mask);
+
+  // Index of the stage decoder (a bit position) should read from,
+  // creating it if needed
+  int min_rate(int decoder);
+  int stage_for(int decoder);
+  int decoder_rate(int decoder);
+  void run_stage(decim_stage &stage, const float *in, int n);
+
+  // Run the enabled decoders over samples; called with d_mutex held
+  void process(float *samples, int n);
+  void worker();
 
 protected:
   boost::mutex d_mutex;
@@ -61,9 +143,10 @@ public:
   /*
    * \param sample_rate Sample rate [S/s]
    */
-  static sptr make(unsigned int sample_rate, decoder_callback callback);
+  static sptr make(unsigned int sample_rate, decoder_callback callback, bool threaded = false);
 
-  signal_decoder_sink_impl(unsigned int sample_rate, decoder_callback callback);
+  signal_decoder_sink_impl(unsigned int sample_rate, decoder_callback callback, bool threaded);
+  ~signal_decoder_sink_impl();
 
   virtual int work(int noutput_items,
                    gr_vector_const_void_star &input_items,
@@ -77,7 +160,19 @@ public:
   bool get_mdc_enabled();
   bool get_fsync_enabled();
   bool get_star_enabled();
+  void set_enabled_decoders(signal_decoder_mask_t mask);
+  signal_decoder_mask_t get_enabled_decoders();
   void log_decoder_msg(long unitId, const char *signaling_type, SignalType signal);
+
+  // Called from the decoder callbacks: new_event() returns the next free
+  // slot with the common fields filled in, or NULL if the ring is full;
+  // push_event() publishes it.  Repeats of a DCS code still waiting in
+  // the ring are merged, as DCS reports every bit while it is present.
+  signal_event *new_event(signal_decoder_mask_t decoder, long unit_id, SignalType signal);
+  void push_event();
+
+  // Log and deliver queued events; called from the main loop
+  void process_message_queues();
 };
 
 } /* namespace blocks */
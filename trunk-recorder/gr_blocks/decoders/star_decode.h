@@ -41,6 +41,8 @@
 #define NDEC 4
 #define THINCR (TWOPI / 8)
 
+#define STAR_MIN_SAMPLE_RATE 8000 // five samples per cycle of the 1600 Hz carrier
+
 /*
  callback function is called based on format set when callback installed
 */
@@ -0,0 +1,132 @@
+/*
+ * tps_decode.cc
+ *   Motorola TPS message decoder, see tps_decode.h.
+ *
+ * Fields are numbered the way OP25's trunking code numbers them: the
+ * message is one big-endian number with zero bits appended where the CRC
+ * was stripped (16 for a TSBK or MBT header), and bit 0 is the last bit.
+ */
+
+#include "tps_decode.h"
+
+#include <string.h>
+
+/* Bits of mask, shifted down by shift, out of msg with pad zero bits appended */
+static unsigned long _field(const unsigned char *msg, size_t len, int pad, int shift, unsigned long mask) {
+  unsigned long result = 0;
+
+  for (int b = 0; mask >> b; b++) {
+    if (!((mask >> b) & 1UL)) {
+      continue;
+    }
+    long pos = (long)shift + b - pad;
+    if ((pos < 0) || ((size_t)(pos / 8) >= len)) {
+      continue;
+    }
+    if ((msg[len - 1 - pos / 8] >> (pos % 8)) & 1) {
+      result |= 1UL << b;
+    }
+  }
+  return result;
+}
+
+static void _decode_tsbk(const unsigned char *msg, size_t len, long *unit_id, int *emergency) {
+  const int pad = 16; // missing CRC
+  unsigned long opcode = _field(msg, len, pad, 88, 0x3f);
+
+  switch (opcode) {
+  case 0x00: // Group Voice Channel Grant
+  case 0x04: // Unit to Unit Voice Service Channel Grant (UU_V_CH_GRANT)
+  case 0x06: // Unit to Unit Voice Channel Grant Update (UU_V_CH_GRANT_UPDT)
+    *emergency = _field(msg, len, pad, 72, 0x80) != 0;
+    *unit_id = _field(msg, len, pad, 16, 0xffffff);
+    break;
+  case 0x02: // Group Voice Channel Grant Update, unit ID only from Motorola
+    *emergency = _field(msg, len, pad, 72, 0x80) != 0;
+    if (_field(msg, len, pad, 80, 0xff) == 0x90) {
+      *unit_id = _field(msg, len, pad, 16, 0xffffff);
+    }
+    break;
+  case 0x20: // Acknowledge Response
+  case 0x28: // Unit Group Affiliation Response
+  case 0x2f: // Unit Deregistration Ack
+    *unit_id = _field(msg, len, pad, 16, 0xffffff);
+    break;
+  case 0x2c: // Unit Registration Response
+    *unit_id = _field(msg, len, pad, 40, 0xffffff);
+    break;
+  default:
+    break;
+  }
+}
+
+static void _decode_mbt(const unsigned char *msg, size_t len, long *unit_id, int *emergency) {
+  // Only the header, the first 10 bytes, carries anything used here
+  const size_t header_len = (len < 10) ? len : 10;
+  const int pad = 16; // missing CRC
+  unsigned long opcode = _field(msg, header_len, pad, 32, 0x3f);
+
+  if ((opcode == 0x00) || (opcode == 0x04)) { // Group / Unit to Unit Voice Channel Grant - Extended
+    *emergency = _field(msg, header_len, pad, 24, 0x80) != 0;
+    *unit_id = _field(msg, header_len, pad, 48, 0xffffff);
+  }
+}
+
+/* Value of "srcaddr" in a JSON message from the frame assembler, or 0 */
+static long _json_srcaddr(const unsigned char *msg, size_t len) {
+  static const char key[] = "\"srcaddr\"";
+  const size_t key_len = sizeof(key) - 1;
+
+  for (size_t i = 0; i + key_len <= len; i++) {
+    if (memcmp(msg + i, key, key_len) != 0) {
+      continue;
+    }
+
+    // Skip to the value, which may be quoted
+    size_t j = i + key_len;
+    while ((j < len) && ((msg[j] == ' ') || (msg[j] == ':') || (msg[j] == '"'))) {
+      j++;
+    }
+    long value = 0;
+    while ((j < len) && (msg[j] >= '0') && (msg[j] <= '9')) {
+      value = value * 10 + (msg[j] - '0');
+      j++;
+    }
+    return value;
+  }
+  return 0;
+}
+
+int tps_decode_message(long type, const unsigned char *msg, size_t len, long *unit_id, int *emergency) {
+  *unit_id = 0;
+  *emergency = 0;
+
+  if (type == TPS_MSG_JSON_DATA) {
+    *unit_id = _json_srcaddr(msg, len);
+    return *unit_id > 0;
+  }
+
+  if (type < 0) {
+    return 0;
+  }
+
+  if (len < 2) {
+    return -1;
+  }
+
+  // The NAC is always the first two bytes; all ones is a dummy message
+  if (((msg[0] << 8) | msg[1]) == 0xffff) {
+    return 0;
+  }
+
+  if (type == TPS_MSG_TSBK) {
+    _decode_tsbk(msg, len, unit_id, emergency);
+  } else if (type == TPS_MSG_MBT) {
+    if (len < 10) {
+      return -1;
+    }
+    _decode_mbt(msg, len, unit_id, emergency);
+  }
+
+  return (*unit_id > 0) || *emergency;
+}
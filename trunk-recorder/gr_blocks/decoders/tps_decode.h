@@ -0,0 +1,46 @@
+/*
+ * tps_decode.h
+ *   Header for the Motorola TPS (Tactical Public Safety) message decoder.
+ *
+ * TPS radios talk P25 on a conventional analog channel.  The OP25 frame
+ * assembler in tps_decoder_sink turns the audio into messages; this pulls
+ * the unit ID and emergency flag out of the ones that carry them:
+ *   - TSBKs: voice grants and updates, acknowledge, affiliation,
+ *     registration and deregistration responses
+ *   - MBTs: extended voice grants
+ *   - JSON link control data with a "srcaddr"
+ *
+ * The message bytes are read in place, so decoding doesn't allocate.
+ */
+
+#ifndef TPS_DECODE_H
+#define TPS_DECODE_H
+
+#include <stddef.h>
+
+/* Frame assembler message types, as in op25_msg_types.h */
+#define TPS_MSG_JSON_DATA -3
+#define TPS_MSG_TSBK 7
+#define TPS_MSG_MBT 12
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decode one frame assembler message.
+ *   type      - the message type
+ *   msg, len  - the message contents; binary messages start with the NAC
+ *   unit_id   - set to the unit ID the message names, or 0
+ *   emergency - set to 1 if the message has the emergency bit set
+ *
+ * Returns 1 if the message named a unit or an emergency, 0 if there was
+ * nothing to report, or -1 if it was too short to decode.
+ */
+int tps_decode_message(long type, const unsigned char *msg, size_t len, long *unit_id, int *emergency);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPS_DECODE_H */
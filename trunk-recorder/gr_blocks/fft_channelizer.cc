@@ -0,0 +1,175 @@
+#include "fft_channelizer.h"
+#include "filter_taps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <volk/volk.h>
+
+fft_channelizer_ccc_sptr make_fft_channelizer_ccc(double input_rate, double channel_rate, int nthreads) {
+  return gnuradio::get_initial_sptr(new fft_channelizer_ccc(input_rate, channel_rate, nthreads));
+}
+
+fft_channelizer_ccc::fft_channelizer_ccc(double input_rate, double channel_rate, int nthreads)
+    : gr::block("fft_channelizer_ccc",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(0, -1, sizeof(gr_complex))),
+      d_input_rate(input_rate),
+      d_blocks(0) {
+
+  d_decimation = lround(input_rate / channel_rate);
+
+  // Flat out to 0.3 of the channel rate and down 60 dB by half of it, so
+  // nothing folds back into the channel when it is decimated
+  Filter_Taps::Real taps = Filter_Taps::low_pass_2(1.0, input_rate, 0.4 * channel_rate, 0.2 * channel_rate, 60, Filter_Taps::BLACKMAN_HARRIS);
+  d_taps = taps->size();
+
+  // The inverse FFT is at least four times the samples the filter spoils
+  // at its start, so three quarters or more of each block is kept
+  d_discard = (d_taps - 1 + d_decimation - 1) / d_decimation;
+  d_ifft_size = 32;
+  while (d_ifft_size < 4 * d_discard) {
+    d_ifft_size *= 2;
+  }
+  d_keep = d_ifft_size - d_discard;
+  d_fft_size = d_ifft_size * d_decimation;
+
+#if GNURADIO_VERSION < 0x030900
+  d_fwd = new gr::fft::fft_complex(d_fft_size, true, nthreads);
+  d_rev = new gr::fft::fft_complex(d_ifft_size, false, 1);
+#else
+  d_fwd = new gr::fft::fft_complex_fwd(d_fft_size, nthreads);
+  d_rev = new gr::fft::fft_complex_rev(d_ifft_size, 1);
+#endif
+
+  // The filter's response, over the bins a channel takes out, in the
+  // order the inverse FFT wants them: the positive half first. Both FFTs
+  // are unscaled, so the 1/N is folded in here.
+  gr_complex *buf = d_fwd->get_inbuf();
+  memset(buf, 0, sizeof(gr_complex) * d_fft_size);
+  for (size_t i = 0; i < d_taps; i++) {
+    buf[i] = gr_complex((*taps)[i], 0);
+  }
+  d_fwd->execute();
+  d_response.resize(d_ifft_size);
+  for (int j = 0; j < d_ifft_size; j++) {
+    int bin = (j < d_ifft_size / 2) ? j : d_fft_size - (d_ifft_size - j);
+    d_response[j] = d_fwd->get_outbuf()[bin] / (float)d_fft_size;
+  }
+
+  d_block_turn.resize(d_ifft_size);
+  for (int m = 0; m < d_ifft_size; m++) {
+    d_block_turn[m] = std::polar(1.0f, (float)(-2 * M_PI * m / d_ifft_size));
+  }
+
+  // Each block is the new samples with the ones the filter still needs
+  // from the block before in front of them
+  set_history(d_fft_size - d_keep * d_decimation + 1);
+  set_output_multiple(d_keep);
+  set_relative_rate(1.0 / d_decimation);
+}
+
+fft_channelizer_ccc::~fft_channelizer_ccc() {
+  delete d_fwd;
+  delete d_rev;
+}
+
+int fft_channelizer_ccc::add_channel() {
+  std::lock_guard<std::mutex> lock(d_channels_mutex);
+  Channel channel = {0, false};
+  d_channels.push_back(channel);
+  return d_channels.size() - 1;
+}
+
+double fft_channelizer_ccc::set_channel(int channel, double offset) {
+  long bin = lround(offset / get_bin_spacing());
+  long limit = d_fft_size / 2 - d_ifft_size / 2;
+  bin = std::max(-limit, std::min(limit, bin));
+
+  std::lock_guard<std::mutex> lock(d_channels_mutex);
+  d_channels[channel].bin = bin;
+  return offset - bin * get_bin_spacing();
+}
+
+void fft_channelizer_ccc::set_channel_enabled(int channel, bool enabled) {
+  std::lock_guard<std::mutex> lock(d_channels_mutex);
+  d_channels[channel].enabled = enabled;
+}
+
+// count bins of the spectrum from first on, wrapping around its end
+void fft_channelizer_ccc::copy_bins(const gr_complex *spectrum, long first, int count, gr_complex *out) const {
+  first = ((first % d_fft_size) + d_fft_size) % d_fft_size;
+  int head = std::min((long)count, d_fft_size - first);
+  memcpy(out, spectrum + first, sizeof(gr_complex) * head);
+  if (head < count) {
+    memcpy(out + head, spectrum, sizeof(gr_complex) * (count - head));
+  }
+}
+
+void fft_channelizer_ccc::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  ninput_items_required[0] = (noutput_items / d_keep) * d_keep * d_decimation;
+}
+
+int fft_channelizer_ccc::general_work(int noutput_items,
+                                      gr_vector_int &ninput_items,
+                                      gr_vector_const_void_star &input_items,
+                                      gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  int step = d_keep * d_decimation;
+  int blocks = std::min(noutput_items / d_keep, ninput_items[0] / step);
+
+  {
+    std::lock_guard<std::mutex> lock(d_channels_mutex);
+    d_snapshot = d_channels;
+  }
+  size_t channels = std::min(d_snapshot.size(), output_items.size());
+  bool any_enabled = false;
+  for (size_t c = 0; c < channels; c++) {
+    any_enabled = any_enabled || d_snapshot[c].enabled;
+  }
+
+  // With every channel parked there is nothing to work out
+  if (!any_enabled) {
+    consume_each(blocks * step);
+    d_blocks += blocks;
+    return 0;
+  }
+
+  int half = d_ifft_size / 2;
+  gr_complex *bins = d_rev->get_inbuf();
+  const gr_complex *channel_out = d_rev->get_outbuf();
+
+  for (int b = 0; b < blocks; b++) {
+    memcpy(d_fwd->get_inbuf(), in + b * step, sizeof(gr_complex) * d_fft_size);
+    d_fwd->execute();
+    const gr_complex *spectrum = d_fwd->get_outbuf();
+
+    for (size_t c = 0; c < channels; c++) {
+      const Channel &channel = d_snapshot[c];
+      if (!channel.enabled) {
+        continue;
+      }
+      copy_bins(spectrum, channel.bin, half, bins);
+      copy_bins(spectrum, channel.bin - half, half, bins + half);
+      volk_32fc_x2_multiply_32fc(bins, bins, &d_response[0], d_ifft_size);
+      d_rev->execute();
+
+      // Taking the channel's bins down to 0 shifts it relative to the
+      // start of the block, so each block is turned on by where it starts
+      long bin_mod = ((channel.bin % d_ifft_size) + d_ifft_size) % d_ifft_size;
+      long turn = (bin_mod * (d_keep % d_ifft_size) % d_ifft_size) * (long)((d_blocks + b) % d_ifft_size) % d_ifft_size;
+      gr_complex phase = d_block_turn[turn];
+      gr_complex *out = (gr_complex *)output_items[c] + b * d_keep;
+      for (int n = 0; n < d_keep; n++) {
+        out[n] = channel_out[d_discard + n] * phase;
+      }
+    }
+  }
+
+  for (size_t c = 0; c < output_items.size(); c++) {
+    produce(c, (c < channels && d_snapshot[c].enabled) ? blocks * d_keep : 0);
+  }
+  consume_each(blocks * step);
+  d_blocks += blocks;
+  return WORK_CALLED_PRODUCE;
+}
@@ -0,0 +1,101 @@
+#ifndef INCLUDED_GR_FFT_CHANNELIZER_H
+#define INCLUDED_GR_FFT_CHANNELIZER_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/fft/fft.h>
+#include <gnuradio/io_signature.h>
+
+// Picks any number of channels out of a wideband stream with a single FFT,
+// for a Source's "fft" channelizer.
+//
+// It is an overlap-save fast convolution filterbank. Each block of input
+// goes through one forward FFT, shared by all of the channels. A channel
+// then only takes the few bins around its frequency, weights them with
+// the response of the channel filter, and runs a small inverse FFT that
+// comes out already decimated to the channel rate. The cost of each
+// channel is a small fraction of the forward FFT, so it grows much more
+// slowly with the number of recorders than a freq_xlating filter for each
+// recorder at the full sample rate, and unlike a polyphase filterbank only
+// the channels that are in use are worked out.
+//
+// A channel is centered on the nearest FFT bin, a few hundred Hz apart,
+// and its recorder tunes out what is left. A channel that is switched off
+// produces nothing, the way a recorder's own filter drops its input while
+// it is parked. The channels are retuned and switched under a lock that
+// each work call only holds to copy them, so a retune for a grant never
+// waits for a buffer of samples to be worked through.
+
+class fft_channelizer_ccc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<fft_channelizer_ccc> fft_channelizer_ccc_sptr;
+#else
+typedef std::shared_ptr<fft_channelizer_ccc> fft_channelizer_ccc_sptr;
+#endif
+
+fft_channelizer_ccc_sptr make_fft_channelizer_ccc(double input_rate, double channel_rate, int nthreads = 1);
+
+class fft_channelizer_ccc : public gr::block {
+
+  friend fft_channelizer_ccc_sptr make_fft_channelizer_ccc(double input_rate, double channel_rate, int nthreads);
+
+  struct Channel {
+    long bin; // signed, from the center of the input
+    bool enabled;
+  };
+
+  double d_input_rate;
+  int d_decimation;  // input samples for each channel sample
+  int d_fft_size;    // of the forward FFT, d_decimation * d_ifft_size
+  int d_ifft_size;   // the bins each channel takes out
+  int d_discard;     // channel samples at the start of each inverse FFT that wrapped around
+  int d_keep;        // the rest, that are passed out
+  size_t d_taps;
+  uint64_t d_blocks; // done so far, for the channels' phase
+
+  std::vector<gr_complex> d_response;   // the channel filter, over the d_ifft_size bins, scaled for both FFTs
+  std::vector<gr_complex> d_block_turn; // exp(-j 2 pi m / d_ifft_size)
+
+#if GNURADIO_VERSION < 0x030900
+  gr::fft::fft_complex *d_fwd;
+  gr::fft::fft_complex *d_rev;
+#else
+  gr::fft::fft_complex_fwd *d_fwd;
+  gr::fft::fft_complex_rev *d_rev;
+#endif
+
+  std::mutex d_channels_mutex;
+  std::vector<Channel> d_channels;
+  std::vector<Channel> d_snapshot; // the block thread's copy
+
+  fft_channelizer_ccc(double input_rate, double channel_rate, int nthreads);
+
+  void copy_bins(const gr_complex *spectrum, long first, int count, gr_complex *out) const;
+
+public:
+  ~fft_channelizer_ccc();
+
+  // The next output, parked on the center of the input until it is tuned
+  int add_channel();
+  // offset is where the signal is, in Hz from the center of the input.
+  // Returns how far from the channel's center it sits.
+  double set_channel(int channel, double offset);
+  void set_channel_enabled(int channel, bool enabled);
+
+  double get_channel_rate() const { return d_input_rate / d_decimation; }
+  double get_bin_spacing() const { return d_input_rate / d_fft_size; }
+  int get_fft_size() const { return d_fft_size; }
+  size_t get_taps() const { return d_taps; }
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "filter_taps.h"
+
+#include <gnuradio/filter/firdes.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+
+enum Design {
+  LOW_PASS,
+  LOW_PASS_2,
+  HIGH_PASS,
+  COMPLEX_BAND_PASS,
+  COMPLEX_BAND_PASS_2
+};
+
+// The design, its arguments and the window
+typedef std::tuple<int, double, double, double, double, double, double, int, double> Key;
+
+std::mutex cache_mutex;
+std::map<Key, Filter_Taps::Real> real_taps;
+std::map<Key, Filter_Taps::Complex> complex_taps;
+
+#if GNURADIO_VERSION < 0x030900
+typedef gr::filter::firdes::win_type win_type;
+
+win_type gr_window(Filter_Taps::Window window) {
+  switch (window) {
+  case Filter_Taps::HANN:
+    return gr::filter::firdes::WIN_HANN;
+  case Filter_Taps::BLACKMAN_HARRIS:
+    return gr::filter::firdes::WIN_BLACKMAN_HARRIS;
+  case Filter_Taps::KAISER:
+    return gr::filter::firdes::WIN_KAISER;
+  case Filter_Taps::HAMMING:
+  default:
+    return gr::filter::firdes::WIN_HAMMING;
+  }
+}
+#else
+typedef gr::fft::window::win_type win_type;
+
+win_type gr_window(Filter_Taps::Window window) {
+  switch (window) {
+  case Filter_Taps::HANN:
+    return gr::fft::window::WIN_HANN;
+  case Filter_Taps::BLACKMAN_HARRIS:
+    return gr::fft::window::WIN_BLACKMAN_HARRIS;
+  case Filter_Taps::KAISER:
+    return gr::fft::window::WIN_KAISER;
+  case Filter_Taps::HAMMING:
+  default:
+    return gr::fft::window::WIN_HAMMING;
+  }
+}
+#endif
+
+// Designs the taps with design() the first time key is asked for
+template <typename Taps, typename F>
+Taps cached(std::map<Key, Taps> &cache, const Key &key, F design) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  typename std::map<Key, Taps>::iterator it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+  Taps taps = std::make_shared<typename Taps::element_type>(design());
+  cache.insert(std::make_pair(key, taps));
+  return taps;
+}
+
+} // namespace
+
+Filter_Taps::Real Filter_Taps::low_pass(double gain, double rate, double cutoff, double transition, Window window, double param) {
+  return cached(real_taps, Key(LOW_PASS, gain, rate, cutoff, transition, 0, 0, window, param), [&] {
+    return gr::filter::firdes::low_pass(gain, rate, cutoff, transition, gr_window(window), param);
+  });
+}
+
+Filter_Taps::Real Filter_Taps::low_pass_2(double gain, double rate, double cutoff, double transition, double attenuation, Window window, double param) {
+  return cached(real_taps, Key(LOW_PASS_2, gain, rate, cutoff, transition, attenuation, 0, window, param), [&] {
+    return gr::filter::firdes::low_pass_2(gain, rate, cutoff, transition, attenuation, gr_window(window), param);
+  });
+}
+
+Filter_Taps::Real Filter_Taps::high_pass(double gain, double rate, double cutoff, double transition, Window window, double param) {
+  return cached(real_taps, Key(HIGH_PASS, gain, rate, cutoff, transition, 0, 0, window, param), [&] {
+    return gr::filter::firdes::high_pass(gain, rate, cutoff, transition, gr_window(window), param);
+  });
+}
+
+Filter_Taps::Complex Filter_Taps::complex_band_pass(double gain, double rate, double low, double high, double transition, Window window, double param) {
+  return cached(complex_taps, Key(COMPLEX_BAND_PASS, gain, rate, low, high, transition, 0, window, param), [&] {
+    return gr::filter::firdes::complex_band_pass(gain, rate, low, high, transition, gr_window(window), param);
+  });
+}
+
+Filter_Taps::Complex Filter_Taps::complex_band_pass_2(double gain, double rate, double low, double high, double transition, double attenuation, Window window, double param) {
+  return cached(complex_taps, Key(COMPLEX_BAND_PASS_2, gain, rate, low, high, transition, attenuation, window, param), [&] {
+    return gr::filter::firdes::complex_band_pass_2(gain, rate, low, high, transition, attenuation, gr_window(window), param);
+  });
+}
+
+Memory_Usage Filter_Taps::get_memory_usage() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  Memory_Usage usage;
+  usage.subsystem = "Filter Taps";
+  usage.name = "designs";
+  usage.count = real_taps.size() + complex_taps.size();
+  usage.bytes = 0;
+  for (std::map<Key, Real>::const_iterator it = real_taps.begin(); it != real_taps.end(); ++it) {
+    usage.bytes += it->second->capacity() * sizeof(float);
+  }
+  for (std::map<Key, Complex>::const_iterator it = complex_taps.begin(); it != complex_taps.end(); ++it) {
+    usage.bytes += it->second->capacity() * sizeof(std::complex<float>);
+  }
+  return usage;
+}
@@ -0,0 +1,50 @@
+#ifndef FILTER_TAPS_H
+#define FILTER_TAPS_H
+
+#include "../../trunk-recorder/global_structs.h"
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+/*
+ * Filter_Taps
+ *   firdes filter designs, made once for the process and shared.
+ *
+ * Every recorder on a Source has the same rates, so each one designed the
+ * same taps for its channelizer, its ARB resampler and its audio filters
+ * and kept its own copy of them. A design here is made the first time it
+ * is asked for and kept, and the recorders that ask for it after that all
+ * get the same read-only taps. The blocks the taps are handed to still
+ * take a copy of them.
+ *
+ * Only designs that follow from the configuration belong here, taps that
+ * follow a tuned frequency would make the cache grow without end.
+ *
+ * The Window is given without the GNU Radio version's type for it, so the
+ * callers don't need one design for each version.
+ */
+class Filter_Taps {
+public:
+  enum Window {
+    HAMMING,
+    HANN,
+    BLACKMAN_HARRIS,
+    KAISER
+  };
+
+  typedef std::shared_ptr<const std::vector<float>> Real;
+  typedef std::shared_ptr<const std::vector<std::complex<float>>> Complex;
+
+  // The firdes designs of the same names, with firdes' defaults
+  static Real low_pass(double gain, double rate, double cutoff, double transition, Window window = HAMMING, double param = 6.76);
+  static Real low_pass_2(double gain, double rate, double cutoff, double transition, double attenuation, Window window = HAMMING, double param = 6.76);
+  static Real high_pass(double gain, double rate, double cutoff, double transition, Window window = HAMMING, double param = 6.76);
+  static Complex complex_band_pass(double gain, double rate, double low, double high, double transition, Window window = HAMMING, double param = 6.76);
+  static Complex complex_band_pass_2(double gain, double rate, double low, double high, double transition, double attenuation, Window window = HAMMING, double param = 6.76);
+
+  // The designs kept and the taps they hold, not counting the blocks' copies
+  static Memory_Usage get_memory_usage();
+};
+
+#endif // FILTER_TAPS_H
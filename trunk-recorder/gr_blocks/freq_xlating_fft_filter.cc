@@ -1,8 +1,15 @@
 
 #include "freq_xlating_fft_filter.h"
+#include "volk_rotator.h"
+#include <volk/volk.h>
+
+const int freq_xlating_fft_filter::tap_cache_size;
+const double freq_xlating_fft_filter::tap_cache_step;
 
 void freq_xlating_fft_filter::set_taps(std::vector<gr_complex> taps) {
   this->taps = taps;
+  this->tap_cache.clear();
+  this->tap_cache_index.clear();
   this->refresh();
 }
 void freq_xlating_fft_filter::set_center_freq(double center_freq) {
@@ -10,6 +17,15 @@ void freq_xlating_fft_filter::set_center_freq(double center_freq) {
   this->refresh();
 }
 
+// While disabled the filter drops its input unread, see gated_fft_filter.h
+void freq_xlating_fft_filter::set_enabled(bool enabled) {
+  this->filter->set_enabled(enabled);
+}
+
+bool freq_xlating_fft_filter::is_enabled() {
+  return this->filter->enabled();
+}
+
 void freq_xlating_fft_filter::set_nthreads(int nthreads) {
   this->filter->set_nthreads(nthreads);
 }
@@ -17,42 +33,61 @@ void freq_xlating_fft_filter::declare_sample_delay(double samp_delay) {
   this->filter->declare_sample_delay(samp_delay);
 }
 
-freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, std::vector<gr_complex> &taps, double center_freq, double sampling_freq) {
+freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, const std::vector<gr_complex> &taps, double center_freq, double sampling_freq) {
   return gnuradio::get_initial_sptr(new freq_xlating_fft_filter(decimation, taps, center_freq, sampling_freq));
 }
 
 //  return [ x * cmath.exp(i * phase_inc * 1j) for i,x in enumerate(taps) ]
+// The phasor is stepped with VOLK's rotator kernel, not an exp per tap.
 std::vector<gr_complex> freq_xlating_fft_filter::rotate_taps(float phase_inc) {
-  std::vector<gr_complex> rtaps;
-  gr_complex I = gr_complex(0.0, 1.0);
-
-  int i = 0;
-  for (std::vector<gr_complex>::iterator it = this->taps.begin(); it != this->taps.end(); it++) {
-    gr_complex f = *it;
-    // dcomp result = i * phase_inc * I;
+  std::vector<gr_complex> rtaps(this->taps.size());
+  gr_complex phase = gr_complex(1.0, 0.0);
+  gr_complex phase_step = std::polar(1.0f, phase_inc);
 
-    // gr_complex new_value = f * exp(result.real());
-    rtaps.push_back(f * exp(i * phase_inc * I));
-    i++;
+  if (!this->taps.empty()) {
+#ifdef HAVE_VOLK_ROTATOR2
+    volk_32fc_s32fc_x2_rotator2_32fc(&rtaps[0], &this->taps[0], &phase_step, &phase, this->taps.size());
+#else
+    volk_32fc_s32fc_x2_rotator_32fc(&rtaps[0], &this->taps[0], phase_step, &phase, this->taps.size());
+#endif
   }
   return rtaps;
 }
 
+// Looks up the taps rotated to key * tap_cache_step, rotating and caching
+// them on a miss and dropping the least recently used set when full.
+const std::vector<gr_complex> &freq_xlating_fft_filter::cached_taps(long key) {
+  std::unordered_map<long, std::list<tap_cache_entry>::iterator>::iterator found = this->tap_cache_index.find(key);
+
+  if (found != this->tap_cache_index.end()) {
+    this->tap_cache.splice(this->tap_cache.begin(), this->tap_cache, found->second);
+    return found->second->second;
+  }
+
+  float phase_inc = (2.0 * M_PI * key * tap_cache_step) / this->samp_rate;
+  this->tap_cache.push_front(tap_cache_entry(key, this->rotate_taps(phase_inc)));
+  this->tap_cache_index[key] = this->tap_cache.begin();
+
+  if (this->tap_cache.size() > (size_t)tap_cache_size) {
+    this->tap_cache_index.erase(this->tap_cache.back().first);
+    this->tap_cache.pop_back();
+  }
+  return this->tap_cache.front().second;
+}
+
+// The taps and the shift change together, at the start of the filter's
+// next buffer, see gated_fft_filter.h
 void freq_xlating_fft_filter::refresh() {
   const float pi = M_PI; // boost::math::constants::pi<double>();
 
-  std::vector<gr_complex> rtaps;
-
   float phase_inc = (2.0 * pi * this->center_freq) / this->samp_rate;
-  rtaps = this->rotate_taps(phase_inc);
-  this->filter->set_taps(rtaps);
-  this->rotator->set_phase_inc(-1 * this->decim * phase_inc);
+  this->filter->retune(this->cached_taps(lround(this->center_freq / tap_cache_step)), -1 * this->decim * phase_inc);
 }
 
 freq_xlating_fft_filter::~freq_xlating_fft_filter() {
 }
 
-freq_xlating_fft_filter::freq_xlating_fft_filter(int decim, std::vector<gr_complex> &taps, double center_freq, double samp_rate)
+freq_xlating_fft_filter::freq_xlating_fft_filter(int decim, const std::vector<gr_complex> &taps, double center_freq, double samp_rate)
     : gr::hier_block2("freq_xlating_fft_filter_ccc",
                       gr::io_signature::make(1, 1, sizeof(gr_complex)),
                       gr::io_signature::make(1, 1, sizeof(gr_complex))) {
@@ -62,11 +97,9 @@ freq_xlating_fft_filter::freq_xlating_fft_filter(int decim, std::vector<gr_compl
   this->center_freq = center_freq;
   this->samp_rate = samp_rate;
 
-  this->filter = gr::filter::fft_filter_ccc::make(this->decim, taps);
-  this->rotator = gr::blocks::rotator_cc::make(0.0);
+  this->filter = make_gated_fft_filter_ccc(this->decim, taps);
   connect(self(), 0, filter, 0);
-  connect(filter, 0, rotator, 0);
-  connect(rotator, 0, self(), 0);
+  connect(filter, 0, self(), 0);
 
   // Refresh
   this->refresh();
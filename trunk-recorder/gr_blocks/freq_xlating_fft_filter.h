@@ -1,10 +1,11 @@
 #ifndef INCLUDED_GR_XLATING_FFT_FILTER_H
 #define INCLUDED_GR_XLATING_FFT_FILTER_H
+#include <list>
 #include <math.h>
+#include <unordered_map>
 
 #include <gnuradio/blocks/api.h>
-#include <gnuradio/blocks/rotator_cc.h>
-#include <gnuradio/filter/fft_filter_ccc.h>
+#include "gated_fft_filter.h"
 #include <gnuradio/hier_block2.h>
 #include <gnuradio/io_signature.h>
 
@@ -16,28 +17,41 @@ typedef boost::shared_ptr<freq_xlating_fft_filter> freq_xlating_fft_filter_sptr;
 typedef std::shared_ptr<freq_xlating_fft_filter> freq_xlating_fft_filter_sptr;
 #endif
 
-freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, std::vector<gr_complex> &taps, double center_freq, double samp_rate);
+freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, const std::vector<gr_complex> &taps, double center_freq, double samp_rate);
 
 class freq_xlating_fft_filter : public gr::hier_block2 {
 
-  friend freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, std::vector<gr_complex> &taps, double center_freq, double samp_rate);
+  friend freq_xlating_fft_filter_sptr make_freq_xlating_fft_filter(int decimation, const std::vector<gr_complex> &taps, double center_freq, double samp_rate);
 
-  gr::blocks::rotator_cc::sptr rotator;
-  gr::filter::fft_filter_ccc::sptr filter;
+  // Filters, decimates and shifts the passband down to 0 Hz
+  gated_fft_filter_ccc_sptr filter;
   int decim;
   std::vector<gr_complex> taps;
   double center_freq;
   double samp_rate;
 
+  // Rotated taps for the most recently used center frequencies, keyed by
+  // the frequency in units of tap_cache_step. The taps only place the
+  // passband; the rotator still shifts by the exact frequency, so a tap set
+  // is good for every frequency within half a step of its key.
+  static const int tap_cache_size = 16;
+  static constexpr double tap_cache_step = 1000;
+  typedef std::pair<long, std::vector<gr_complex>> tap_cache_entry;
+  std::list<tap_cache_entry> tap_cache;
+  std::unordered_map<long, std::list<tap_cache_entry>::iterator> tap_cache_index;
+
   void set_taps(std::vector<gr_complex> taps);
   std::vector<gr_complex> rotate_taps(float phase_inc);
+  const std::vector<gr_complex> &cached_taps(long key);
   void refresh();
 
   ~freq_xlating_fft_filter();
-  freq_xlating_fft_filter(int decimation, std::vector<gr_complex> &taps, double center_freq, double sampling_freq);
+  freq_xlating_fft_filter(int decimation, const std::vector<gr_complex> &taps, double center_freq, double sampling_freq);
 
 public:
   void set_center_freq(double center_freq);
+  void set_enabled(bool enabled);
+  bool is_enabled();
   void set_nthreads(int nthreads);
   void declare_sample_delay(double samp_delay);
 };
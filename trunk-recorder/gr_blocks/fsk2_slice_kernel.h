@@ -0,0 +1,118 @@
+#ifndef INCLUDED_FSK2_SLICE_KERNEL_H
+#define INCLUDED_FSK2_SLICE_KERNEL_H
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/math.h>
+
+#include "fsk4_timing.h"
+
+// The SmartNet control channel demodulator up to the bits, without the
+// GNU Radio block around it so utils/smartnet-demod-bench can run it:
+// quadrature_demod_cf, the op25 rmsagc_ff, the moving average symbol
+// filter, fsk4_demod_ff's timing loop and binary_slicer_fb.
+//
+// A tile of samples goes through the discriminator, the AGC and the filter
+// in one loop and stays in cache for the timing loop, which hands its
+// symbols straight to the slicer. The discriminator's conjugate multiply is
+// written out rather than left to std::complex, which would check every
+// product for NaNs. The sums are made in the same precision and order as
+// the blocks made them, the bits only differ where a rounding lands a
+// symbol right on 0.
+
+class fsk2_slice_kernel {
+public:
+  static const int TILE = 1024;
+  static const int MAX_SAMPLES_PER_SYMBOL = 8;
+
+  fsk2_slice_kernel(int samples_per_symbol, double symbol_rate, double deviation)
+      : d_sps(std::min(samples_per_symbol, MAX_SAMPLES_PER_SYMBOL)),
+        d_timing(symbol_rate / (symbol_rate * samples_per_symbol), false) {
+    const double channel_rate = symbol_rate * samples_per_symbol;
+    d_fm_gain = channel_rate / (2 * M_PI * deviation);
+    d_agc_alpha = 0.01;
+    d_agc_beta = 1 - d_agc_alpha;
+    d_agc_gain = 1.0;
+    d_sym_tap = 1.0 / samples_per_symbol;
+    reset();
+  }
+
+  // Back to how a newly made chain would start
+  void reset() {
+    d_last_sample = gr_complex(0, 0);
+    d_agc_avg = 1.0;
+    std::fill(&d_agc[0], &d_agc[MAX_SAMPLES_PER_SYMBOL + TILE], 0.0f);
+    d_timing.reset();
+  }
+
+  // Demodulates nsamples and writes a bit, 0 or 1, for each symbol to out.
+  // A sample makes one symbol at most, out needs room for nsamples of them.
+  int work(const gr_complex *in, int nsamples, uint8_t *out) {
+    int nbits = 0;
+    for (int start = 0; start < nsamples; start += TILE) {
+      int n = std::min(TILE, nsamples - start);
+      front_end(&in[start], n);
+
+      int nsym = d_timing.work(d_filtered, n, d_symbols);
+      for (int i = 0; i < nsym; i++) {
+        out[nbits + i] = (d_symbols[i] >= 0) ? 1 : 0;
+      }
+      nbits += nsym;
+    }
+    return nbits;
+  }
+
+private:
+  int d_sps;
+
+  // quadrature_demod_cf
+  float d_fm_gain;
+  gr_complex d_last_sample;
+
+  // rmsagc_ff
+  double d_agc_alpha, d_agc_beta, d_agc_gain;
+  double d_agc_avg;
+
+  // the symbol filter, the AGC's output for the tile after the last
+  // d_sps - 1 of the one before
+  float d_sym_tap;
+  float d_agc[MAX_SAMPLES_PER_SYMBOL + TILE];
+  float d_filtered[TILE];
+
+  gr::op25_repeater::fsk4_timing d_timing;
+  float d_symbols[TILE];
+
+  void front_end(const gr_complex *in, int n) {
+    float *agc = &d_agc[d_sps - 1];
+    gr_complex last = d_last_sample;
+    double avg = d_agc_avg;
+    for (int i = 0; i < n; i++) {
+      // A NaN would stay in the AGC's average for good
+      const gr_complex sample = (in[i] == in[i]) ? in[i] : gr_complex(0, 0);
+      const float re = sample.real() * last.real() + sample.imag() * last.imag();
+      const float im = sample.imag() * last.real() - sample.real() * last.imag();
+      last = sample;
+      const float fm = d_fm_gain * gr::fast_atan2f(im, re);
+
+      const double mag_sqrd = fm * fm;
+      avg = d_agc_beta * avg + d_agc_alpha * mag_sqrd;
+      agc[i] = (avg > 0) ? d_agc_gain * fm / sqrt(avg) : d_agc_gain * fm;
+    }
+    d_last_sample = last;
+    d_agc_avg = avg;
+
+    for (int i = 0; i < n; i++) {
+      float sum = 0;
+      for (int k = 0; k < d_sps; k++) {
+        sum += d_sym_tap * d_agc[i + k];
+      }
+      d_filtered[i] = sum;
+    }
+    std::copy(&d_agc[n], &d_agc[n + d_sps - 1], &d_agc[0]);
+  }
+};
+
+#endif
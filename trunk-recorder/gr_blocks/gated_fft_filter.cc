@@ -0,0 +1,90 @@
+#include "gated_fft_filter.h"
+#include "volk_rotator.h"
+#include <volk/volk.h>
+
+gated_fft_filter_ccc_sptr make_gated_fft_filter_ccc(int decimation, const std::vector<gr_complex> &taps, int nthreads) {
+  return gnuradio::get_initial_sptr(new gated_fft_filter_ccc(decimation, taps, nthreads));
+}
+
+gated_fft_filter_ccc::gated_fft_filter_ccc(int decimation, const std::vector<gr_complex> &taps, int nthreads)
+    : gr::block("gated_fft_filter_ccc",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_decimation(decimation),
+      d_enabled(true),
+      d_pending(NULL),
+      d_new_nthreads(0),
+      d_filter(decimation, taps, nthreads),
+      d_rotate(false),
+      d_phase(1.0, 0.0),
+      d_phase_step(1.0, 0.0) {
+
+  d_nsamples = d_filter.set_taps(taps);
+  set_output_multiple(d_nsamples);
+  set_relative_rate(1.0 / decimation);
+}
+
+gated_fft_filter_ccc::~gated_fft_filter_ccc() {
+  delete d_pending.exchange(NULL);
+}
+
+// Whichever of the two swaps the Retune out owns it, so one general_work()
+// hasn't picked up yet can be dropped here
+void gated_fft_filter_ccc::publish(Retune *retune) {
+  delete d_pending.exchange(retune, std::memory_order_acq_rel);
+}
+
+void gated_fft_filter_ccc::retune(const std::vector<gr_complex> &taps, float phase_inc) {
+  publish(new Retune{taps, true, phase_inc});
+}
+
+void gated_fft_filter_ccc::set_taps(const std::vector<gr_complex> &taps) {
+  publish(new Retune{taps, false, 0});
+}
+
+void gated_fft_filter_ccc::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  ninput_items_required[0] = noutput_items * d_decimation;
+}
+
+int gated_fft_filter_ccc::general_work(int noutput_items,
+                                       gr_vector_int &ninput_items,
+                                       gr_vector_const_void_star &input_items,
+                                       gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  gr_complex *out = (gr_complex *)output_items[0];
+
+  if (!d_enabled.load(std::memory_order_relaxed)) {
+    consume_each(ninput_items[0]);
+    return 0;
+  }
+
+  int nthreads = d_new_nthreads.exchange(0, std::memory_order_relaxed);
+  if (nthreads) {
+    d_filter.set_nthreads(nthreads);
+  }
+
+  // Setting the taps clears the filter's tail, so a retune on a grant also
+  // drops whatever was left from before the filter was switched off
+  Retune *retune = d_pending.exchange(NULL, std::memory_order_acq_rel);
+  if (retune) {
+    d_nsamples = d_filter.set_taps(retune->taps);
+    if (retune->set_phase_inc) {
+      d_phase_step = std::polar(1.0f, retune->phase_inc);
+      d_rotate = (retune->phase_inc != 0);
+    }
+    delete retune;
+    set_output_multiple(d_nsamples);
+    return 0; // output multiple may have changed
+  }
+
+  d_filter.filter(noutput_items, in, out);
+  if (d_rotate) {
+#ifdef HAVE_VOLK_ROTATOR2
+    volk_32fc_s32fc_x2_rotator2_32fc(out, out, &d_phase_step, &d_phase, noutput_items);
+#else
+    volk_32fc_s32fc_x2_rotator_32fc(out, out, d_phase_step, &d_phase, noutput_items);
+#endif
+  }
+  consume_each(noutput_items * d_decimation);
+  return noutput_items;
+}
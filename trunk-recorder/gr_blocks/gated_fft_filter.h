@@ -0,0 +1,74 @@
+#ifndef INCLUDED_GR_GATED_FFT_FILTER_H
+#define INCLUDED_GR_GATED_FFT_FILTER_H
+
+#include <atomic>
+
+#include <gnuradio/block.h>
+#include <gnuradio/filter/fft_filter.h>
+#include <gnuradio/io_signature.h>
+
+// A decimating FFT filter, like fft_filter_ccc, that can be switched off.
+// While it is off it consumes its input without reading it and produces
+// nothing, so a recorder can read straight from its Source's buffer
+// instead of through a copy, and costs nothing while it is idle.
+//
+// It also shifts its output by a phase increment per sample, like a
+// rotator_cc after it would, so freq_xlating_fft_filter is one block.
+// retune() hands over new taps and a new increment together, and the
+// filter picks them up at the start of its next work call, between two
+// buffers. Nothing on either side takes a lock, so retuning a recorder for
+// a grant never waits on the recorder's thread, or holds it up.
+
+class gated_fft_filter_ccc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<gated_fft_filter_ccc> gated_fft_filter_ccc_sptr;
+#else
+typedef std::shared_ptr<gated_fft_filter_ccc> gated_fft_filter_ccc_sptr;
+#endif
+
+gated_fft_filter_ccc_sptr make_gated_fft_filter_ccc(int decimation, const std::vector<gr_complex> &taps, int nthreads = 1);
+
+class gated_fft_filter_ccc : public gr::block {
+
+  friend gated_fft_filter_ccc_sptr make_gated_fft_filter_ccc(int decimation, const std::vector<gr_complex> &taps, int nthreads);
+
+  // What retune() hands to general_work()
+  struct Retune {
+    std::vector<gr_complex> taps;
+    bool set_phase_inc;
+    float phase_inc;
+  };
+
+  int d_decimation;
+  int d_nsamples;
+  std::atomic<bool> d_enabled;
+  std::atomic<Retune *> d_pending;
+  std::atomic<int> d_new_nthreads; // 0 when there is no change
+  gr::filter::kernel::fft_filter_ccc d_filter;
+  bool d_rotate;
+  gr_complex d_phase;
+  gr_complex d_phase_step;
+
+  gated_fft_filter_ccc(int decimation, const std::vector<gr_complex> &taps, int nthreads);
+  void publish(Retune *retune);
+
+public:
+  ~gated_fft_filter_ccc();
+
+  // Each of these takes effect on the next call to general_work, without
+  // any locking. A newer retune replaces one that hasn't been picked up.
+  void retune(const std::vector<gr_complex> &taps, float phase_inc);
+  void set_taps(const std::vector<gr_complex> &taps);
+  void set_nthreads(int n) { d_new_nthreads.store(n, std::memory_order_relaxed); }
+  void set_enabled(bool enabled) { d_enabled.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return d_enabled.load(std::memory_order_relaxed); }
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
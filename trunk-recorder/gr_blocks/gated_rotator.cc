@@ -0,0 +1,53 @@
+#include "gated_rotator.h"
+
+#include <algorithm>
+#include <string.h>
+#include "volk_rotator.h"
+#include <volk/volk.h>
+
+gated_rotator_cc_sptr make_gated_rotator_cc(float phase_inc) {
+  return gnuradio::get_initial_sptr(new gated_rotator_cc(phase_inc));
+}
+
+gated_rotator_cc::gated_rotator_cc(float phase_inc)
+    : gr::block("gated_rotator_cc",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_enabled(true),
+      d_new_phase_inc(phase_inc),
+      d_phase_inc(phase_inc),
+      d_phase(1.0, 0.0),
+      d_phase_step(std::polar(1.0f, phase_inc)) {
+}
+
+int gated_rotator_cc::general_work(int noutput_items,
+                                   gr_vector_int &ninput_items,
+                                   gr_vector_const_void_star &input_items,
+                                   gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  gr_complex *out = (gr_complex *)output_items[0];
+
+  if (!d_enabled.load(std::memory_order_relaxed)) {
+    consume_each(ninput_items[0]);
+    return 0;
+  }
+
+  float phase_inc = d_new_phase_inc.load(std::memory_order_relaxed);
+  if (phase_inc != d_phase_inc) {
+    d_phase_inc = phase_inc;
+    d_phase_step = std::polar(1.0f, phase_inc);
+  }
+
+  const int n = std::min(noutput_items, ninput_items[0]);
+  if (d_phase_inc == 0) {
+    memcpy(out, in, n * sizeof(gr_complex));
+  } else {
+#ifdef HAVE_VOLK_ROTATOR2
+    volk_32fc_s32fc_x2_rotator2_32fc(out, in, &d_phase_step, &d_phase, n);
+#else
+    volk_32fc_s32fc_x2_rotator_32fc(out, in, d_phase_step, &d_phase, n);
+#endif
+  }
+  consume_each(n);
+  return n;
+}
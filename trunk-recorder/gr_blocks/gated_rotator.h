@@ -0,0 +1,48 @@
+#ifndef INCLUDED_GATED_ROTATOR_H
+#define INCLUDED_GATED_ROTATOR_H
+
+#include <atomic>
+
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+
+// A rotator_cc that can be switched off like gated_fft_filter_ccc, for the
+// channelizer of a channel the Source has already split out. It takes the
+// place of a copy block used as a valve and a rotator after it. A new
+// phase increment is picked up at the start of the next work call, without
+// any locking, and the phase carries on from where it was.
+
+class gated_rotator_cc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<gated_rotator_cc> gated_rotator_cc_sptr;
+#else
+typedef std::shared_ptr<gated_rotator_cc> gated_rotator_cc_sptr;
+#endif
+
+gated_rotator_cc_sptr make_gated_rotator_cc(float phase_inc);
+
+class gated_rotator_cc : public gr::block {
+
+  friend gated_rotator_cc_sptr make_gated_rotator_cc(float phase_inc);
+
+  std::atomic<bool> d_enabled;
+  std::atomic<float> d_new_phase_inc;
+  float d_phase_inc;
+  gr_complex d_phase;
+  gr_complex d_phase_step;
+
+  gated_rotator_cc(float phase_inc);
+
+public:
+  void set_phase_inc(float phase_inc) { d_new_phase_inc.store(phase_inc, std::memory_order_relaxed); }
+  void set_enabled(bool enabled) { d_enabled.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return d_enabled.load(std::memory_order_relaxed); }
+
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
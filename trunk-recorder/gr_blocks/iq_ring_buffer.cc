@@ -0,0 +1,117 @@
+#include "iq_ring_buffer.h"
+#include "iq_writer.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <json.hpp>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+iq_ring_buffer_sptr make_iq_ring_buffer(double sample_rate, double seconds) {
+  return gnuradio::get_initial_sptr(new iq_ring_buffer(sample_rate, seconds));
+}
+
+iq_ring_buffer::iq_ring_buffer(double sample_rate, double seconds)
+    : gr::sync_block("iq_ring_buffer",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(0, 0, 0)),
+      d_ring(std::max((size_t)1, (size_t)(sample_rate * seconds))),
+      d_sample_rate(sample_rate),
+      d_writing(0),
+      d_written(0) {
+  d_snapshot.reserve(d_ring.size());
+}
+
+double iq_ring_buffer::get_seconds() {
+  return std::min(d_written.load(std::memory_order_acquire), (uint64_t)d_ring.size()) / d_sample_rate;
+}
+
+int iq_ring_buffer::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  const size_t capacity = d_ring.size();
+  uint64_t written = d_written.load(std::memory_order_relaxed);
+
+  // Only the newest samples of a work call bigger than the ring are kept
+  size_t count = noutput_items;
+  if (count > capacity) {
+    in += count - capacity;
+    written += count - capacity;
+    count = capacity;
+  }
+
+  d_writing.store(written + count, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const size_t pos = written % capacity;
+  const size_t first = std::min(count, capacity - pos);
+  memcpy(&d_ring[pos], in, first * sizeof(gr_complex));
+  memcpy(&d_ring[0], in + first, (count - first) * sizeof(gr_complex));
+
+  d_written.store(written + count, std::memory_order_release);
+  return noutput_items;
+}
+
+bool iq_ring_buffer::snapshot(const std::string &base, double freq, const std::string &hw, int source_num) {
+  gr::thread::scoped_lock lock(d_snapshot_mutex);
+  const size_t capacity = d_ring.size();
+
+  const uint64_t end = d_written.load(std::memory_order_acquire);
+  uint64_t start = (end > capacity) ? end - capacity : 0;
+  d_snapshot.resize(end - start);
+  for (uint64_t i = start; i < end;) {
+    const size_t pos = i % capacity;
+    const size_t count = std::min((uint64_t)(capacity - pos), end - i);
+    memcpy(&d_snapshot[i - start], &d_ring[pos], count * sizeof(gr_complex));
+    i += count;
+  }
+
+  // Anything work() started writing over while it was being copied is gone
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t writing = d_writing.load(std::memory_order_relaxed);
+  size_t skip = 0;
+  if (writing > start + capacity) {
+    skip = std::min((uint64_t)d_snapshot.size(), writing - capacity - start);
+    start += skip;
+  }
+  if (skip == d_snapshot.size()) {
+    return false;
+  }
+
+  // When the first sample in it came out of the channelizer
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  double first_sample = now.tv_sec + now.tv_usec / 1e6 - (end - start) / d_sample_rate;
+  time_t first_second = (time_t)first_sample;
+  char buf[sizeof "2011-10-08T07:07:09"];
+  strftime(buf, sizeof buf, "%FT%T", gmtime(&first_second));
+  char fraction[sizeof ".000000Z"];
+  snprintf(fraction, sizeof fraction, ".%06dZ", (int)((first_sample - first_second) * 1e6));
+
+  std::shared_ptr<IQ_File> file = std::make_shared<IQ_File>();
+  file->base = base;
+  file->source_num = source_num;
+  file->meta = {
+      {"global", {{"core:sample_rate", d_sample_rate}, {"core:hw", hw}, {"core:recorder", "Trunk Recorder"}, {"core:version", "1.0.0"}}},
+      {"captures", nlohmann::json::array({nlohmann::json::object({{"core:sample_start", 0}, {"core:frequency", freq}, {"core:datetime", std::string(buf) + fraction}})})},
+      {"annotations", nlohmann::json::array({})}};
+
+  IQ_Writer::open(file);
+  long dropped_samples = 0;
+  size_t done = skip;
+  while (done < d_snapshot.size()) {
+    IQ_Writer::Buffer *buffer = IQ_Writer::get_buffer();
+    if (!buffer) {
+      dropped_samples = d_snapshot.size() - done;
+      break;
+    }
+    done += IQ_Writer::fill(buffer, &d_snapshot[done], d_snapshot.size() - done);
+    IQ_Writer::write(file, buffer);
+  }
+  IQ_Writer::close(file, dropped_samples);
+
+  BOOST_LOG_TRIVIAL(info) << "IQ Snapshot: " << (d_snapshot.size() - skip) / d_sample_rate << " sec to " << base;
+  return true;
+}
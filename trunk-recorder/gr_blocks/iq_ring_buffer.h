@@ -0,0 +1,60 @@
+#ifndef INCLUDED_IQ_RING_BUFFER_H
+#define INCLUDED_IQ_RING_BUFFER_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+
+// Keeps the last few seconds of a recorder's channel, as it comes out of
+// the channelizer, so they can be saved as a SigMF recording after the
+// fact: a call turns out to be an emergency, or has a unit on it someone is
+// looking for. The ring is allocated once, when the recorder is built.
+//
+// work() copies the samples into the ring without taking a lock. Before it
+// writes, it moves d_writing past the samples it is about to overwrite, so
+// snapshot() can copy the ring from another thread and then throw away the
+// oldest samples if work() got to them while it was copying. The copy is
+// handed to the IQ_Writer, which writes it out on its own thread.
+
+class iq_ring_buffer;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<iq_ring_buffer> iq_ring_buffer_sptr;
+#else
+typedef std::shared_ptr<iq_ring_buffer> iq_ring_buffer_sptr;
+#endif
+
+iq_ring_buffer_sptr make_iq_ring_buffer(double sample_rate, double seconds);
+
+class iq_ring_buffer : public gr::sync_block {
+
+  friend iq_ring_buffer_sptr make_iq_ring_buffer(double sample_rate, double seconds);
+
+  iq_ring_buffer(double sample_rate, double seconds);
+
+  std::vector<gr_complex> d_ring;
+  double d_sample_rate;
+  std::atomic<uint64_t> d_writing; // the samples work() has started to write
+  std::atomic<uint64_t> d_written; // the samples that are in the ring
+
+  gr::thread::mutex d_snapshot_mutex;
+  std::vector<gr_complex> d_snapshot;
+
+public:
+  double get_sample_rate() { return d_sample_rate; }
+  double get_seconds();
+
+  // Writes what is in the ring to base.sigmf-data and base.sigmf-meta,
+  // false if it is empty
+  bool snapshot(const std::string &base, double freq, const std::string &hw, int source_num);
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif // INCLUDED_IQ_RING_BUFFER_H
@@ -0,0 +1,336 @@
+#include "iq_writer.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+#include <volk/volk.h>
+
+#ifdef O_LARGEFILE
+#define OUR_O_LARGEFILE O_LARGEFILE
+#else // ifdef O_LARGEFILE
+#define OUR_O_LARGEFILE 0
+#endif // ifdef O_LARGEFILE
+
+std::mutex IQ_Writer::queue_mutex;
+std::condition_variable IQ_Writer::not_empty;
+std::deque<IQ_Writer::Command> IQ_Writer::queue;
+bool IQ_Writer::running = false;
+std::thread IQ_Writer::worker;
+
+std::mutex IQ_Writer::pool_mutex;
+std::vector<IQ_Writer::Buffer *> IQ_Writer::free_buffers;
+size_t IQ_Writer::allocated_buffers = 0;
+
+IQ_Writer::Format IQ_Writer::format = IQ_Writer::CF32;
+IQ_Writer::Compression IQ_Writer::compression = IQ_Writer::NO_COMPRESSION;
+bool IQ_Writer::direct_io = false;
+
+// Call these before start()
+void IQ_Writer::set_format(Format f) {
+  format = f;
+}
+
+void IQ_Writer::set_compression(Compression c) {
+  compression = c;
+}
+
+void IQ_Writer::set_direct_io(bool enabled) {
+#ifdef O_DIRECT
+  direct_io = enabled;
+#else
+  if (enabled) {
+    BOOST_LOG_TRIVIAL(error) << "Direct I/O isn't available here, writing SigMF files through the page cache";
+  }
+#endif
+}
+
+IQ_Writer::Format IQ_Writer::get_format() {
+  return format;
+}
+
+size_t IQ_Writer::get_sample_size() {
+  return (format == CI16) ? 2 * sizeof(int16_t) : 2 * sizeof(float);
+}
+
+std::string IQ_Writer::get_datatype() {
+  return (format == CI16) ? "ci16_le" : "cf32_le";
+}
+
+void IQ_Writer::start() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  running = true;
+  if (compression == ZSTD) {
+    // A write to a zstd that has exited should fail, not end the program
+    signal(SIGPIPE, SIG_IGN);
+  }
+  worker = std::thread(&IQ_Writer::run);
+  BOOST_LOG_TRIVIAL(info) << "IQ Writer started - Format: " << get_datatype() << (compression == ZSTD ? " zstd" : "") << ((direct_io && compression != ZSTD) ? " Direct I/O" : "");
+}
+
+void IQ_Writer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  not_empty.notify_all();
+  // The worker finishes whatever is still queued before it returns
+  worker.join();
+}
+
+IQ_Writer::Buffer *IQ_Writer::get_buffer() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  Buffer *buffer = NULL;
+  if (!free_buffers.empty()) {
+    buffer = free_buffers.back();
+    free_buffers.pop_back();
+  } else if (allocated_buffers < MAX_BUFFERS) {
+    void *data = NULL;
+    if (posix_memalign(&data, DIRECT_ALIGNMENT, BUFFER_SIZE) == 0) {
+      buffer = new Buffer;
+      buffer->data = (unsigned char *)data;
+      allocated_buffers++;
+    }
+  }
+  if (buffer) {
+    buffer->used = 0;
+  }
+  return buffer;
+}
+
+void IQ_Writer::release_buffer(Buffer *buffer) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  free_buffers.push_back(buffer);
+}
+
+size_t IQ_Writer::fill(Buffer *buffer, const std::complex<float> *samples, size_t count) {
+  const size_t sample_size = get_sample_size();
+  count = std::min(count, (BUFFER_SIZE - buffer->used) / sample_size);
+  unsigned char *out = buffer->data + buffer->used;
+  if (format == CI16) {
+    volk_32f_s32f_convert_16i((int16_t *)out, (const float *)samples, 32767.0f, 2 * count);
+  } else {
+    memcpy(out, samples, count * sizeof(std::complex<float>));
+  }
+  buffer->used += count * sample_size;
+  return count;
+}
+
+void IQ_Writer::open(std::shared_ptr<IQ_File> file) {
+  Command command;
+  command.type = OPEN;
+  command.file = file;
+  command.buffer = NULL;
+  command.dropped_samples = 0;
+  push(command);
+}
+
+// Only the last buffer of a recording may be partly full
+void IQ_Writer::write(std::shared_ptr<IQ_File> file, Buffer *buffer) {
+  Command command;
+  command.type = WRITE;
+  command.file = file;
+  command.buffer = buffer;
+  command.dropped_samples = 0;
+  push(command);
+}
+
+void IQ_Writer::close(std::shared_ptr<IQ_File> file, long dropped_samples) {
+  Command command;
+  command.type = CLOSE;
+  command.file = file;
+  command.buffer = NULL;
+  command.dropped_samples = dropped_samples;
+  push(command);
+}
+
+void IQ_Writer::push(Command &command) {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  if (!running) {
+    lock.unlock();
+    execute(command);
+    return;
+  }
+  queue.push_back(command);
+  lock.unlock();
+  not_empty.notify_one();
+}
+
+void IQ_Writer::open_file(IQ_File &file) {
+  file.fd = -1;
+  file.pipe = NULL;
+  file.direct = false;
+  file.bytes_written = 0;
+  file.dropped_samples = 0;
+  file.failed = true;
+
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(boost::filesystem::path(file.base).parent_path(), ec);
+  if (ec) {
+    BOOST_LOG_TRIVIAL(error) << "create_directories failed for " << file.base << " : " << ec.message();
+  }
+
+  if (compression == ZSTD) {
+    file.data_filename = file.base + ".sigmf-data.zst";
+    std::string shell_command = "zstd -q -f -o '" + file.data_filename + "'";
+    file.pipe = popen(shell_command.c_str(), "w");
+    if (!file.pipe) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to start zstd for: " << file.data_filename << " Make sure you have zstd installed.";
+      return;
+    }
+    file.failed = false;
+    return;
+  }
+
+  file.data_filename = file.base + ".sigmf-data";
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | OUR_O_LARGEFILE;
+#ifdef O_DIRECT
+  if (direct_io) {
+    // Not every filesystem takes O_DIRECT, tmpfs doesn't
+    file.fd = ::open(file.data_filename.c_str(), flags | O_DIRECT, 0664);
+    if (file.fd >= 0) {
+      file.direct = true;
+    } else {
+      BOOST_LOG_TRIVIAL(debug) << "Could not open with O_DIRECT, writing through the page cache: " << file.data_filename;
+    }
+  }
+#endif
+  if (file.fd < 0) {
+    file.fd = ::open(file.data_filename.c_str(), flags, 0664);
+  }
+  if (file.fd < 0) {
+    perror(file.data_filename.c_str());
+    BOOST_LOG_TRIVIAL(error) << "SigMF error opening: " << file.data_filename;
+    return;
+  }
+  file.failed = false;
+}
+
+void IQ_Writer::write_file(IQ_File &file, Buffer *buffer) {
+  if (file.failed || !buffer->used) {
+    return;
+  }
+
+  if (file.pipe) {
+    if (fwrite(buffer->data, 1, buffer->used, file.pipe) < buffer->used) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write to zstd for: " << file.data_filename;
+      file.failed = true;
+      return;
+    }
+    file.bytes_written += buffer->used;
+    return;
+  }
+
+  // O_DIRECT writes whole blocks, the padding is cut off when it is closed
+  size_t size = buffer->used;
+  if (file.direct && (size % DIRECT_ALIGNMENT)) {
+    size_t padded = (size + DIRECT_ALIGNMENT - 1) & ~(DIRECT_ALIGNMENT - 1);
+    memset(buffer->data + size, 0, padded - size);
+    size = padded;
+  }
+
+  size_t done = 0;
+  while (done < size) {
+    ssize_t written = ::write(file.fd, buffer->data + done, size - done);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror(file.data_filename.c_str());
+      BOOST_LOG_TRIVIAL(error) << "SigMF error writing: " << file.data_filename;
+      file.failed = true;
+      return;
+    }
+    done += written;
+  }
+  file.bytes_written += buffer->used;
+}
+
+void IQ_Writer::close_file(IQ_File &file) {
+  if (file.pipe) {
+    int rc = pclose(file.pipe);
+    file.pipe = NULL;
+    if (rc != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to compress SigMF recording: " << file.data_filename << " Make sure you have zstd installed.";
+      file.failed = true;
+    }
+  }
+  if (file.fd >= 0) {
+    if (file.direct && (ftruncate(file.fd, file.bytes_written) != 0)) {
+      perror(file.data_filename.c_str());
+    }
+    ::close(file.fd);
+    file.fd = -1;
+  }
+  if (file.dropped_samples) {
+    BOOST_LOG_TRIVIAL(error) << "SigMF recording dropped " << file.dropped_samples << " samples, the disk is not keeping up: " << file.data_filename;
+  }
+  write_meta(file);
+}
+
+void IQ_Writer::write_meta(IQ_File &file) {
+  nlohmann::json meta = file.meta;
+  meta["global"]["core:datatype"] = get_datatype();
+  if (compression == ZSTD) {
+    meta["global"]["core:dataset"] = boost::filesystem::path(file.data_filename).filename().string();
+    meta["global"]["core:extensions"] = nlohmann::json::array({{{"name", "trunk_recorder"}, {"version", "1.0.0"}, {"optional", true}}});
+    meta["global"]["trunk_recorder:compression"] = "zstd";
+  }
+  if (file.dropped_samples) {
+    meta["global"]["core:description"] = std::to_string(file.dropped_samples) + " samples were dropped while recording";
+  }
+
+  std::ofstream o(file.base + ".sigmf-meta");
+  o << std::setw(4) << meta << std::endl;
+  o.close();
+}
+
+void IQ_Writer::execute(Command &command) {
+  IQ_File &file = *command.file;
+  switch (command.type) {
+  case OPEN:
+    open_file(file);
+    break;
+  case WRITE:
+    write_file(file, command.buffer);
+    release_buffer(command.buffer);
+    break;
+  case CLOSE:
+    file.dropped_samples = command.dropped_samples;
+    close_file(file);
+    break;
+  }
+}
+
+void IQ_Writer::run() {
+  std::deque<Command> batch;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      not_empty.wait(lock, [] { return !queue.empty() || !running; });
+      if (queue.empty() && !running) {
+        return;
+      }
+      batch.swap(queue);
+    }
+
+    for (std::deque<Command>::iterator it = batch.begin(); it != batch.end(); ++it) {
+      execute(*it);
+    }
+    batch.clear();
+  }
+}
@@ -0,0 +1,133 @@
+#ifndef IQ_WRITER_H
+#define IQ_WRITER_H
+
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <json.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * IQ_File
+ *   One SigMF recording, a .sigmf-data file of samples and the
+ *   .sigmf-meta file that describes it. The sink fills in where it goes
+ *   and the metadata, and the IQ_Writer makes, writes and closes it.
+ */
+struct IQ_File {
+  // Set by the sink
+  std::string base; // the path, without .sigmf-data or .sigmf-meta
+  nlohmann::json meta;
+  int source_num;
+
+  // Only touched by the writer
+  std::string data_filename;
+  int fd;
+  FILE *pipe;
+  bool direct;
+  size_t bytes_written; // of samples, not counting the padding of the last O_DIRECT write
+  long dropped_samples;
+  bool failed;
+};
+
+/*
+ * IQ_Writer
+ *   Does the file I/O for SigMF recordings on a thread of its own, so a
+ *   disk stall holds up the writer instead of the flowgraph.
+ *
+ * A sink fills buffers of BUFFER_SIZE with samples in the format the
+ * recordings are kept in and queues them. They are written as they are,
+ * with one write() each. The buffers are page aligned and come from a pool
+ * that grows up to MAX_BUFFERS and then only reuses what the writer gives
+ * back. If the disk falls that far behind, samples are dropped and
+ * counted.
+ *
+ * The samples can be kept as cf32, as they come out of the channelizer,
+ * or as ci16, at half the size. With direct I/O on, the data file is opened
+ * with O_DIRECT so the samples don't go through the page cache. The last
+ * buffer is padded out to a whole block and the file cut back to size when
+ * it is closed. With zstd compression on, the samples are piped to a zstd
+ * process instead and the data file is a .sigmf-data.zst.
+ *
+ * The .sigmf-meta is written when the recording is closed. Its datatype is
+ * what the samples were kept as, and a compressed data file is named in
+ * core:dataset.
+ *
+ * Before start() or after stop() the commands are carried out right away
+ * by the caller.
+ */
+class IQ_Writer {
+public:
+  static const size_t BUFFER_SIZE = 1 << 20;
+  static const size_t MAX_BUFFERS = 64;
+  static const size_t DIRECT_ALIGNMENT = 4096;
+
+  enum Format { CF32,
+                CI16 };
+  enum Compression { NO_COMPRESSION,
+                     ZSTD };
+
+  struct Buffer {
+    unsigned char *data; // BUFFER_SIZE bytes, DIRECT_ALIGNMENT aligned
+    size_t used;
+  };
+
+  static void set_format(Format format);
+  static void set_compression(Compression compression);
+  static void set_direct_io(bool enabled);
+  static Format get_format();
+  static size_t get_sample_size();
+  static std::string get_datatype();
+  static void start();
+  static void stop();
+
+  static Buffer *get_buffer();
+  static void release_buffer(Buffer *buffer);
+  // Converts as many of the samples as fit into the buffer, returns how many
+  static size_t fill(Buffer *buffer, const std::complex<float> *samples, size_t count);
+
+  static void open(std::shared_ptr<IQ_File> file);
+  static void write(std::shared_ptr<IQ_File> file, Buffer *buffer);
+  static void close(std::shared_ptr<IQ_File> file, long dropped_samples);
+
+private:
+  enum Command_Type { OPEN,
+                      WRITE,
+                      CLOSE };
+
+  struct Command {
+    Command_Type type;
+    std::shared_ptr<IQ_File> file;
+    Buffer *buffer;
+    long dropped_samples;
+  };
+
+  static void push(Command &command);
+  static void execute(Command &command);
+  static void open_file(IQ_File &file);
+  static void write_file(IQ_File &file, Buffer *buffer);
+  static void close_file(IQ_File &file);
+  static void write_meta(IQ_File &file);
+  static void run();
+
+  static std::mutex queue_mutex;
+  static std::condition_variable not_empty;
+  static std::deque<Command> queue;
+  static bool running;
+  static std::thread worker;
+
+  static std::mutex pool_mutex;
+  static std::vector<Buffer *> free_buffers;
+  static size_t allocated_buffers;
+
+  static Format format;
+  static Compression compression;
+  static bool direct_io;
+};
+
+#endif // IQ_WRITER_H
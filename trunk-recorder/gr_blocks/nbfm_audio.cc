@@ -0,0 +1,233 @@
+#include "nbfm_audio.h"
+
+#include <algorithm>
+#include <gnuradio/math.h>
+#include <math.h>
+#include <string.h>
+#include <volk/volk.h>
+
+nbfm_audio_sptr make_nbfm_audio(bool demodulate,
+                                float quad_gain,
+                                const std::vector<double> &fftaps,
+                                const std::vector<double> &fbtaps,
+                                int decimation,
+                                const std::vector<float> &decim_taps,
+                                const std::vector<float> &high_taps,
+                                const std::vector<float> &low_taps) {
+  return gnuradio::get_initial_sptr(new nbfm_audio(demodulate, quad_gain, fftaps, fbtaps, decimation, decim_taps, high_taps, low_taps));
+}
+
+nbfm_demod_sptr make_nbfm_demod(float quad_gain,
+                                const std::vector<double> &fftaps,
+                                const std::vector<double> &fbtaps) {
+  return gnuradio::get_initial_sptr(new nbfm_demod(quad_gain, fftaps, fbtaps));
+}
+
+nbfm_discriminator::nbfm_discriminator(float quad_gain, const std::vector<double> &fftaps, const std::vector<double> &fbtaps)
+    : d_last(0, 0), d_gain(quad_gain), d_last_in(0), d_last_out(0) {
+  set_taps(fftaps, fbtaps);
+}
+
+// The taps are the ones iir_filter_ffd takes with oldstyle false
+void nbfm_discriminator::set_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps) {
+  d_b0 = fftaps[0];
+  d_b1 = fftaps[1];
+  d_a1 = -fbtaps[1];
+}
+
+void nbfm_discriminator::demodulate(const gr_complex *in, float *out, int n) {
+  for (int i = 0; i < n; i++) {
+    gr_complex product = in[i] * std::conj(d_last);
+    d_last = in[i];
+    float audio = d_gain * gr::fast_atan2f(product.imag(), product.real());
+
+    double deemph = d_b0 * audio + d_b1 * d_last_in + d_a1 * d_last_out;
+    d_last_in = audio;
+    d_last_out = deemph;
+    out[i] = (float)deemph;
+  }
+}
+
+nbfm_audio::nbfm_audio(bool demodulate,
+                       float quad_gain,
+                       const std::vector<double> &fftaps,
+                       const std::vector<double> &fbtaps,
+                       int decimation,
+                       const std::vector<float> &decim_taps,
+                       const std::vector<float> &high_taps,
+                       const std::vector<float> &low_taps)
+    : gr::block("nbfm_audio",
+                gr::io_signature::make(1, 1, demodulate ? sizeof(gr_complex) : sizeof(float)),
+                gr::io_signature::make2(1, 2, sizeof(short), sizeof(float))),
+      d_demodulate(demodulate),
+      d_discriminator(quad_gain, fftaps, fbtaps),
+      d_decimation(decimation),
+      d_level(1.0),
+      d_threshold(pow(10.0, -200 / 10.0)),
+      d_alpha(0.01),
+      d_pwr(0),
+      d_unmuted(false),
+      d_tag_next_unmuted(true),
+      d_sob_key(pmt::intern("squelch_sob")),
+      d_eob_key(pmt::intern("squelch_eob")) {
+  d_decim_taps.assign(decim_taps.rbegin(), decim_taps.rend());
+
+  std::vector<float> band_taps(high_taps.size() + low_taps.size() - 1, 0.0f);
+  for (size_t i = 0; i < high_taps.size(); i++) {
+    for (size_t j = 0; j < low_taps.size(); j++) {
+      band_taps[i + j] += high_taps[i] * low_taps[j];
+    }
+  }
+  d_band_taps.assign(band_taps.rbegin(), band_taps.rend());
+
+  d_audio.assign(d_decim_taps.size() - 1 + TILE * d_decimation, 0.0f);
+  d_band.assign(d_band_taps.size() - 1 + TILE, 0.0f);
+  d_tags.reserve(16);
+
+  // The outputs don't keep pace with each other while the gate is closed,
+  // and the tags have to land where their samples came out of it
+#if GNURADIO_VERSION < 0x030800
+  set_tag_propagation_policy(TPP_DONT);
+#else
+  set_tag_propagation_policy(gr::TPP_DONT);
+#endif
+  set_relative_rate(1.0 / d_decimation);
+}
+
+void nbfm_audio::set_quad_gain(float quad_gain) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_discriminator.set_gain(quad_gain);
+}
+
+void nbfm_audio::set_deemph_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_discriminator.set_taps(fftaps, fbtaps);
+}
+
+void nbfm_audio::set_level(float level) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_level = level;
+}
+
+void nbfm_audio::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  ninput_items_required[0] = noutput_items * d_decimation;
+}
+
+int nbfm_audio::general_work(int noutput_items,
+                             gr_vector_int &ninput_items,
+                             gr_vector_const_void_star &input_items,
+                             gr_vector_void_star &output_items) {
+  gr::thread::scoped_lock lock(d_mutex);
+
+  const int n = std::min(noutput_items, ninput_items[0] / d_decimation);
+  if (n <= 0) {
+    return 0;
+  }
+
+  short *out = (short *)output_items[0];
+  float *decoded = (output_items.size() > 1) ? (float *)output_items[1] : NULL;
+  const size_t audio_history = d_decim_taps.size() - 1;
+  const size_t band_history = d_band_taps.size() - 1;
+  const uint64_t read = nitems_read(0);
+  const uint64_t written = nitems_written(0);
+  const float scale = d_level * 32767.0f;
+
+  d_tags.clear();
+  get_tags_in_range(d_tags, 0, read, read + (uint64_t)n * d_decimation);
+  size_t next_tag = 0;
+
+  int j = 0;
+  for (int done = 0; done < n; done += TILE) {
+    const int count = std::min(TILE, n - done);
+    const int in_count = count * d_decimation;
+    float *audio = d_audio.data() + audio_history;
+
+    if (d_demodulate) {
+      d_discriminator.demodulate((const gr_complex *)input_items[0] + done * d_decimation, audio, in_count);
+    } else {
+      memcpy(audio, (const float *)input_items[0] + done * d_decimation, in_count * sizeof(float));
+    }
+
+    float *band = d_band.data() + band_history;
+    for (int k = 0; k < count; k++) {
+      volk_32f_x2_dot_prod_32f(&band[k], d_audio.data() + k * d_decimation, d_decim_taps.data(), d_decim_taps.size());
+    }
+    memmove(d_audio.data(), d_audio.data() + in_count, audio_history * sizeof(float));
+    if (decoded) {
+      memcpy(decoded + done, band, count * sizeof(float));
+    }
+
+    for (int k = 0; k < count; k++) {
+      float sample;
+      volk_32f_x2_dot_prod_32f(&sample, d_band.data() + k, d_band_taps.data(), d_band_taps.size());
+
+      // A tag goes on the next sample out after the one it was on went in
+      while ((next_tag < d_tags.size()) && ((int)((d_tags[next_tag].offset - read) / d_decimation) <= done + k)) {
+        add_item_tag(0, written + j, d_tags[next_tag].key, d_tags[next_tag].value, d_tags[next_tag].srcid);
+        next_tag++;
+      }
+
+      // pwr_squelch_ff with no ramp, gating
+      d_pwr = d_alpha * ((double)sample * sample) + (1.0 - d_alpha) * d_pwr;
+      const bool mute = d_pwr < d_threshold;
+      if (!d_unmuted) {
+        if (!mute) {
+          d_unmuted = true;
+          d_tag_next_unmuted = true;
+        }
+      } else {
+        if (d_tag_next_unmuted) {
+          d_tag_next_unmuted = false;
+          add_item_tag(0, written + j, d_sob_key, pmt::PMT_NIL);
+        }
+        if (mute) {
+          d_unmuted = false;
+          add_item_tag(0, written + j, d_eob_key, pmt::PMT_NIL);
+        }
+      }
+
+      if (d_unmuted) {
+        float level = rintf(sample * scale);
+        if (level > 32767.0f) {
+          level = 32767.0f;
+        } else if (level < -32768.0f) {
+          level = -32768.0f;
+        }
+        out[j++] = (short)level;
+      }
+    }
+    memmove(d_band.data(), d_band.data() + count, band_history * sizeof(float));
+  }
+
+  consume_each(n * d_decimation);
+  produce(0, j);
+  if (decoded) {
+    produce(1, n);
+  }
+  return WORK_CALLED_PRODUCE;
+}
+
+nbfm_demod::nbfm_demod(float quad_gain, const std::vector<double> &fftaps, const std::vector<double> &fbtaps)
+    : gr::sync_block("nbfm_demod",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(1, 1, sizeof(float))),
+      d_discriminator(quad_gain, fftaps, fbtaps) {
+}
+
+void nbfm_demod::set_quad_gain(float quad_gain) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_discriminator.set_gain(quad_gain);
+}
+
+void nbfm_demod::set_deemph_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_discriminator.set_taps(fftaps, fbtaps);
+}
+
+int nbfm_demod::work(int noutput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items) {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_discriminator.demodulate((const gr_complex *)input_items[0], (float *)output_items[0], noutput_items);
+  return noutput_items;
+}
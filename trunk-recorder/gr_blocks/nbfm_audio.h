@@ -0,0 +1,154 @@
+#ifndef INCLUDED_NBFM_AUDIO_H
+#define INCLUDED_NBFM_AUDIO_H
+
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+#include <pmt/pmt.h>
+
+// The audio chain of an analog recorder in one block: the FM
+// discriminator, de-emphasis, the decimation to the wav rate, the 300 to
+// 3250 Hz band pass, the squelch gate that drops the samples between
+// transmissions, the level and the conversion to 16 bit samples. It used to
+// be eight blocks, quadrature_demod_cf, iir_filter_ffd, three
+// fir_filter_fff, pwr_squelch_ff, multiply_const_ff and float_to_short,
+// each with its own thread and buffer, for each recorder.
+//
+// The decimation filter and the band pass are FIRs, the high and low pass
+// halves of the band pass are run as the one FIR they add up to, and the
+// work goes through a tile of samples in buffers that stay in cache. Each
+// FIR output is a VOLK dot product.
+//
+// Output 0 is the gated 16 bit audio, with the squelch_sob and squelch_eob
+// tags pwr_squelch_ff put on it and the tags from upstream moved to where
+// their samples came out. Output 1, if it is connected, is the decimated
+// audio before the band pass and the gate, for the signal decoders.
+//
+// A tone or DCS squelch, or the tone scanner, needs the de-emphasized
+// audio at the channel rate, so the chain can be split there: nbfm_demod
+// does the discriminator and de-emphasis, and an nbfm_audio made with
+// demodulate false takes the audio back after the tone squelch.
+
+class nbfm_audio;
+class nbfm_demod;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<nbfm_audio> nbfm_audio_sptr;
+typedef boost::shared_ptr<nbfm_demod> nbfm_demod_sptr;
+#else
+typedef std::shared_ptr<nbfm_audio> nbfm_audio_sptr;
+typedef std::shared_ptr<nbfm_demod> nbfm_demod_sptr;
+#endif
+
+nbfm_audio_sptr make_nbfm_audio(bool demodulate,
+                                float quad_gain,
+                                const std::vector<double> &fftaps,
+                                const std::vector<double> &fbtaps,
+                                int decimation,
+                                const std::vector<float> &decim_taps,
+                                const std::vector<float> &high_taps,
+                                const std::vector<float> &low_taps);
+
+nbfm_demod_sptr make_nbfm_demod(float quad_gain,
+                                const std::vector<double> &fftaps,
+                                const std::vector<double> &fbtaps);
+
+// quadrature_demod_cf followed by iir_filter_ffd, de-emphasis being a one
+// pole IIR
+class nbfm_discriminator {
+  gr_complex d_last;
+  float d_gain;
+  double d_b0;
+  double d_b1;
+  double d_a1;
+  float d_last_in;
+  double d_last_out;
+
+public:
+  nbfm_discriminator(float quad_gain, const std::vector<double> &fftaps, const std::vector<double> &fbtaps);
+
+  void set_gain(float quad_gain) { d_gain = quad_gain; }
+  void set_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps);
+  void demodulate(const gr_complex *in, float *out, int n);
+};
+
+class nbfm_audio : public gr::block {
+
+  friend nbfm_audio_sptr make_nbfm_audio(bool demodulate,
+                                         float quad_gain,
+                                         const std::vector<double> &fftaps,
+                                         const std::vector<double> &fbtaps,
+                                         int decimation,
+                                         const std::vector<float> &decim_taps,
+                                         const std::vector<float> &high_taps,
+                                         const std::vector<float> &low_taps);
+
+  static const int TILE = 512; // outputs at the wav rate
+
+  gr::thread::mutex d_mutex;
+
+  bool d_demodulate;
+  nbfm_discriminator d_discriminator;
+  int d_decimation;
+  float d_level;
+
+  std::vector<float> d_decim_taps; // reversed
+  std::vector<float> d_band_taps;  // high pass convolved with the low pass, reversed
+  std::vector<float> d_audio;      // the last ntaps - 1 channel rate samples, then a tile
+  std::vector<float> d_band;       // the last ntaps - 1 decimated samples, then a tile
+  std::vector<gr::tag_t> d_tags;
+
+  // pwr_squelch_ff(-200, 0.01, 0, true)
+  double d_threshold;
+  double d_alpha;
+  double d_pwr;
+  bool d_unmuted;
+  bool d_tag_next_unmuted;
+  pmt::pmt_t d_sob_key;
+  pmt::pmt_t d_eob_key;
+
+  nbfm_audio(bool demodulate,
+             float quad_gain,
+             const std::vector<double> &fftaps,
+             const std::vector<double> &fbtaps,
+             int decimation,
+             const std::vector<float> &decim_taps,
+             const std::vector<float> &high_taps,
+             const std::vector<float> &low_taps);
+
+public:
+  void set_quad_gain(float quad_gain);
+  void set_deemph_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps);
+  void set_level(float level);
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+class nbfm_demod : public gr::sync_block {
+
+  friend nbfm_demod_sptr make_nbfm_demod(float quad_gain,
+                                         const std::vector<double> &fftaps,
+                                         const std::vector<double> &fbtaps);
+
+  gr::thread::mutex d_mutex;
+  nbfm_discriminator d_discriminator;
+
+  nbfm_demod(float quad_gain, const std::vector<double> &fftaps, const std::vector<double> &fbtaps);
+
+public:
+  void set_quad_gain(float quad_gain);
+  void set_deemph_taps(const std::vector<double> &fftaps, const std::vector<double> &fbtaps);
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
@@ -13,6 +13,7 @@
 #endif
 
 #include "./pwr_squelch_cc_impl.h"
+#include <volk/volk.h>
 
 namespace gr {
 namespace analog {
@@ -54,6 +55,25 @@ void pwr_squelch_cc_impl::update_state(const gr_complex& in)
     d_pwr = d_iir.filter(in.real() * in.real() + in.imag() * in.imag());
 }
 
+int pwr_squelch_cc_impl::update_state_run(const gr_complex* in, int n, bool muted)
+{
+    if (d_mag_sq.size() < (size_t)n) {
+        d_mag_sq.resize(n);
+    }
+    volk_32fc_magnitude_squared_32f(d_mag_sq.data(), in, n);
+
+    // The average still has to go a sample at a time, but without a virtual
+    // call for each and with the threshold check folded in
+    const double threshold = d_threshold;
+    for (int i = 0; i < n; i++) {
+        d_pwr = d_iir.filter(d_mag_sq[i]);
+        if ((d_pwr < threshold) != muted) {
+            return i;
+        }
+    }
+    return n;
+}
+
 double pwr_squelch_cc_impl::get_pwr() 
 {
     double db = 10 * std::log10(d_pwr);
@@ -25,10 +25,12 @@ private:
     double d_threshold;
     double d_pwr;
     filter::single_pole_iir<double, double, double> d_iir;
+    std::vector<float> d_mag_sq;
 
 protected:
     void update_state(const gr_complex& in) override;
     bool mute() const override { return d_pwr < d_threshold; }
+    int update_state_run(const gr_complex* in, int n, bool muted) override;
 
 public:
     pwr_squelch_cc_impl(double db,
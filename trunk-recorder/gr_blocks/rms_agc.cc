@@ -17,24 +17,12 @@ rms_agc::sptr rms_agc::make(double alpha, double reference) {
       new rms_agc(alpha, reference));
 }
 
-rms_agc::rms_agc(double a, double r) : gr::hier_block2("RMS AGC",
-                                                       gr::io_signature::make(1, 1, sizeof(gr_complex)),
-                                                       gr::io_signature::make(1, 1, sizeof(gr_complex))) {
+rms_agc::rms_agc(double a, double r) : gr::sync_block("RMS AGC",
+                                                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                                                     gr::io_signature::make(1, 1, sizeof(gr_complex))),
+                                       d_agc(a, r, 0.0) {
   alpha = a;
   reference = r;
-  rms_cf = gr::blocks::rms_cf::make(alpha);
-  multiply_const = gr::blocks::multiply_const_ff::make(1.0 / reference);
-  float_to_complex = gr::blocks::float_to_complex::make(1);
-  divide = gr::blocks::divide_cc::make(1);
-  add_const = gr::blocks::add_const_ff::make(1e-18);
-
-  connect(add_const, 0, float_to_complex, 0);
-  connect(divide, 0, self(), 0);
-  connect(float_to_complex, 0, divide, 1);
-  connect(multiply_const, 0, add_const, 0);
-  connect(rms_cf, 0, multiply_const, 0);
-  connect(self(), 0, divide, 0);
-  connect(self(), 0, rms_cf, 0);
 }
 
 double rms_agc::get_alpha() {
@@ -43,7 +31,7 @@ double rms_agc::get_alpha() {
 
 void rms_agc::set_alpha(double a) {
   alpha = a;
-  rms_cf->set_alpha(alpha);
+  d_agc.set_alpha(alpha);
 }
 
 double rms_agc::get_reference() {
@@ -52,7 +40,14 @@ double rms_agc::get_reference() {
 
 void rms_agc::set_reference(double r) {
   reference = r;
-  multiply_const->set_k(1.0 / reference);
+  d_agc.set_gain(reference);
+}
+
+int rms_agc::work(int noutput_items,
+                  gr_vector_const_void_star &input_items,
+                  gr_vector_void_star &output_items) {
+  d_agc.agc((const gr_complex *)input_items[0], (gr_complex *)output_items[0], noutput_items);
+  return noutput_items;
 }
 
 } // namespace blocks
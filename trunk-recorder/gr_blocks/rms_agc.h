@@ -1,27 +1,20 @@
 #ifndef INCLUDED_GR_RMS_AGC_H
 #define INCLUDED_GR_RMS_AGC_H
-#include <gnuradio/block.h>
 #include <gnuradio/blocks/api.h>
-#include <gnuradio/blocks/float_to_complex.h>
-#include <gnuradio/blocks/rms_cf.h>
-#include <gnuradio/hier_block2.h>
 #include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
 
-#include <gnuradio/blocks/add_const_ff.h>
-
-#if GNURADIO_VERSION < 0x030800
-#include <gnuradio/blocks/divide_cc.h>
-#include <gnuradio/blocks/multiply_const_ff.h>
-#else
-#include <gnuradio/blocks/divide.h>
-#include <gnuradio/blocks/multiply_const.h>
-#endif
+#include <rms_agc_kernel.h>
 
 class rms_agc;
 namespace gr {
 namespace blocks {
 
-class BLOCKS_API rms_agc : virtual public gr::hier_block2 {
+// Scales the signal to reference over its RMS. It was a flowgraph of an
+// rms_cf, a multiply_const, an add_const, a float_to_complex and a
+// divide_cc, it's a single block now, with the op25 rms_agc_kernel doing
+// the work.
+class BLOCKS_API rms_agc : public gr::sync_block {
 public:
 #if GNURADIO_VERSION < 0x030900
   typedef boost::shared_ptr<rms_agc> sptr;
@@ -34,18 +27,19 @@ public:
   double alpha;
   double reference;
 
-  gr::blocks::rms_cf::sptr rms_cf;
-  gr::blocks::multiply_const_ff::sptr multiply_const;
-  gr::blocks::float_to_complex::sptr float_to_complex;
-  gr::blocks::divide_cc::sptr divide;
-  gr::blocks::add_const_ff::sptr add_const;
-
   double get_alpha();
   void set_alpha(double a);
   double get_reference();
   void set_reference(double r);
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+
+private:
+  gr::op25_repeater::rms_agc_kernel d_agc;
 };
 
 } // namespace blocks
 } // namespace gr
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,45 @@
+#ifndef INCLUDED_SC16_DECIMATOR_H
+#define INCLUDED_SC16_DECIMATOR_H
+
+#include <complex>
+#include <stdint.h>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_decimator.h>
+
+// The first decimation for an SDR that delivers complex int16 samples. The
+// low-pass filter runs on the int16 samples, with int32 accumulators, and
+// only the decimated output is converted to complex float, so a wideband
+// source only has to move half the bytes until its rate has come down.
+//
+// With a decimation of 1 there is no filter and the samples are only
+// converted.
+
+class sc16_decimator;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<sc16_decimator> sc16_decimator_sptr;
+#else
+typedef std::shared_ptr<sc16_decimator> sc16_decimator_sptr;
+#endif
+
+sc16_decimator_sptr make_sc16_decimator(int decimation, double rate);
+
+class sc16_decimator : public gr::sync_decimator {
+
+  friend sc16_decimator_sptr make_sc16_decimator(int decimation, double rate);
+
+  int d_decimation;
+  std::vector<int16_t> d_taps; // Q15, reversed
+  std::vector<int16_t> d_in_i;
+  std::vector<int16_t> d_in_q;
+
+  sc16_decimator(int decimation, double rate);
+
+public:
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
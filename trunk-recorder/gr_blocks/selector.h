@@ -60,6 +60,11 @@ public:
   virtual void set_output_index(unsigned int output_index) = 0;
   virtual int output_index() const = 0;
   virtual bool got_samples() = 0;
+
+  // Every sample the selector has been given, and the number of times the
+  // stream restarted after an overflow, which UHD marks with an rx_time tag
+  virtual uint64_t get_sample_count() = 0;
+  virtual uint64_t get_overflow_count() = 0;
 };
 
 } /* namespace blocks */
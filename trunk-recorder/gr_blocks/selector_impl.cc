@@ -46,20 +46,38 @@ selector_impl::selector_impl(size_t itemsize,
       d_output_index(output_index),
       d_num_inputs(0),
       d_got_samples(true),
-      d_num_outputs(0) {
+      d_num_outputs(0),
+      d_sample_count(0),
+      d_rx_time_tags(0) {
 
-  d_enabled_output_ports = std::vector<bool>(d_max_port, false);
+  d_rx_time_key = pmt::intern("rx_time");
+
+  for (unsigned int out_idx = 0; out_idx < d_max_port; out_idx++) {
+    d_enabled_output_ports[out_idx] = false;
+  }
   // TODO: add message ports for input_index and output_index
 }
 
 selector_impl::~selector_impl() {}
 
+const unsigned int selector_impl::d_max_port;
+
 bool selector_impl::got_samples() {
   bool current_got_samples = d_got_samples;
   d_got_samples = false;
   return current_got_samples;
 }
 
+uint64_t selector_impl::get_sample_count() {
+  return d_sample_count.load(std::memory_order_relaxed);
+}
+
+// The first rx_time tag marks the start of streaming, the rest an overflow
+uint64_t selector_impl::get_overflow_count() {
+  uint64_t tags = d_rx_time_tags.load(std::memory_order_relaxed);
+  return tags ? tags - 1 : 0;
+}
+
 void selector_impl::set_input_index(unsigned int input_index) {
   gr::thread::scoped_lock l(d_mutex);
 
@@ -85,11 +103,7 @@ void selector_impl::set_output_index(unsigned int output_index) {
     throw std::out_of_range("output_index must be < noutputs");
 
   for (unsigned int out_idx = 0; out_idx < d_max_port; out_idx++) {
-    if (output_index == out_idx) {
-      d_enabled_output_ports[out_idx] = true;
-    } else {
-      d_enabled_output_ports[out_idx] = false;
-    }
+    d_enabled_output_ports[out_idx].store(output_index == out_idx, std::memory_order_relaxed);
   }
 }
 
@@ -118,8 +132,7 @@ void selector_impl::set_port_enabled(unsigned int port, bool enabled) {
     return;
   }
 
-  gr::thread::scoped_lock l(d_mutex);
-  d_enabled_output_ports[port] = enabled;
+  d_enabled_output_ports[port].store(enabled, std::memory_order_relaxed);
 }
 
 bool selector_impl::is_port_enabled(unsigned int port) {
@@ -128,8 +141,7 @@ bool selector_impl::is_port_enabled(unsigned int port) {
     return false;
   }
 
-  gr::thread::scoped_lock l(d_mutex);
-  return d_enabled_output_ports[port];
+  return d_enabled_output_ports[port].load(std::memory_order_relaxed);
 }
 
 int selector_impl::general_work(int noutput_items,
@@ -145,8 +157,13 @@ int selector_impl::general_work(int noutput_items,
     d_got_samples = true;
   }
 
+  std::vector<tag_t> rx_time_tags;
+  get_tags_in_range(rx_time_tags, d_input_index, nitems_read(d_input_index), nitems_read(d_input_index) + noutput_items, d_rx_time_key);
+  d_rx_time_tags.fetch_add(rx_time_tags.size(), std::memory_order_relaxed);
+  d_sample_count.fetch_add(noutput_items, std::memory_order_relaxed);
+
   for (size_t out_idx = 0; out_idx < output_items.size(); out_idx++) {
-    if (d_enabled_output_ports[out_idx]) {
+    if (d_enabled_output_ports[out_idx].load(std::memory_order_relaxed)) {
       std::copy(in[d_input_index],
                 in[d_input_index] + noutput_items * d_itemsize,
                 out[out_idx]);
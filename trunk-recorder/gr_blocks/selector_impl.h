@@ -24,6 +24,7 @@
 #define INCLUDED_GR_SELECTOR_IMPL_H
 
 #include "selector.h"
+#include <atomic>
 #include <boost/log/trivial.hpp>
 #include <gnuradio/thread/thread.h>
 
@@ -35,11 +36,17 @@ private:
   size_t d_itemsize;
   bool d_enabled;
   bool d_got_samples;
-  std::vector<bool> d_enabled_output_ports;
+  static const unsigned int d_max_port = 100;
+  // Parked ports are skipped by general_work, so an idle recorder gets no
+  // samples and does no work. The flags are flipped without taking d_mutex,
+  // so unparking a recorder on a grant never waits out a work call.
+  std::atomic<bool> d_enabled_output_ports[d_max_port];
   unsigned int d_input_index, d_output_index;
   unsigned int d_num_inputs, d_num_outputs; // keep track of the topology
-  const unsigned int d_max_port = 100;
   gr::thread::mutex d_mutex;
+  std::atomic<uint64_t> d_sample_count;
+  std::atomic<uint64_t> d_rx_time_tags;
+  pmt::pmt_t d_rx_time_key;
 
 
 public:
@@ -61,6 +68,8 @@ public:
   int output_index() const { return d_output_index; }
 
   bool got_samples();
+  uint64_t get_sample_count();
+  uint64_t get_overflow_count();
 
   int general_work(int noutput_items,
                    gr_vector_int &ninput_items,
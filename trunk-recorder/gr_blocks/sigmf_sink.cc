@@ -0,0 +1,84 @@
+#include "sigmf_sink.h"
+
+sigmf_sink_sptr make_sigmf_sink() {
+  return gnuradio::get_initial_sptr(new sigmf_sink());
+}
+
+sigmf_sink::sigmf_sink()
+    : gr::sync_block("sigmf_sink",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(0, 0, 0)),
+      d_buffer(NULL),
+      d_dropped_samples(0) {
+}
+
+sigmf_sink::~sigmf_sink() {
+  close();
+}
+
+void sigmf_sink::open(const std::string &base, const nlohmann::json &meta, int source_num) {
+  gr::thread::scoped_lock lock(d_mutex);
+  if (d_file) {
+    if (d_buffer) {
+      IQ_Writer::write(d_file, d_buffer);
+      d_buffer = NULL;
+    }
+    IQ_Writer::close(d_file, d_dropped_samples);
+  }
+
+  d_file = std::make_shared<IQ_File>();
+  d_file->base = base;
+  d_file->meta = meta;
+  d_file->source_num = source_num;
+  d_dropped_samples = 0;
+  IQ_Writer::open(d_file);
+}
+
+void sigmf_sink::close() {
+  gr::thread::scoped_lock lock(d_mutex);
+  if (!d_file) {
+    return;
+  }
+  if (d_buffer) {
+    IQ_Writer::write(d_file, d_buffer);
+    d_buffer = NULL;
+  }
+  IQ_Writer::close(d_file, d_dropped_samples);
+  d_file.reset();
+}
+
+bool sigmf_sink::is_open() {
+  gr::thread::scoped_lock lock(d_mutex);
+  return d_file != NULL;
+}
+
+int sigmf_sink::work(int noutput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items) {
+  gr::thread::scoped_lock lock(d_mutex);
+  if (!d_file) {
+    return noutput_items;
+  }
+
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  int done = 0;
+  while (done < noutput_items) {
+    if (!d_buffer) {
+      d_buffer = IQ_Writer::get_buffer();
+      if (!d_buffer) {
+        // Every buffer is waiting on the disk
+        d_dropped_samples += noutput_items - done;
+        break;
+      }
+    }
+
+    const size_t count = IQ_Writer::fill(d_buffer, in + done, noutput_items - done);
+    done += count;
+
+    if (d_buffer->used + IQ_Writer::get_sample_size() > IQ_Writer::BUFFER_SIZE) {
+      IQ_Writer::write(d_file, d_buffer);
+      d_buffer = NULL;
+    }
+  }
+  return noutput_items;
+}
@@ -0,0 +1,55 @@
+#ifndef INCLUDED_SIGMF_SINK_H
+#define INCLUDED_SIGMF_SINK_H
+
+#include <memory>
+#include <string>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+#include <json.hpp>
+
+#include "iq_writer.h"
+
+// Takes a channel's complex samples and hands them to the IQ_Writer for a
+// SigMF recording. work() only converts the samples into a writer buffer,
+// in the format the recordings are kept in, and queues the buffer when it
+// is full; the file I/O is all on the writer's thread. While it isn't
+// open, the samples are thrown away.
+
+class sigmf_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<sigmf_sink> sigmf_sink_sptr;
+#else
+typedef std::shared_ptr<sigmf_sink> sigmf_sink_sptr;
+#endif
+
+sigmf_sink_sptr make_sigmf_sink();
+
+class sigmf_sink : public gr::sync_block {
+
+  friend sigmf_sink_sptr make_sigmf_sink();
+
+  sigmf_sink();
+
+  gr::thread::mutex d_mutex;
+  std::shared_ptr<IQ_File> d_file;
+  IQ_Writer::Buffer *d_buffer;
+  long d_dropped_samples;
+
+public:
+  ~sigmf_sink();
+
+  // base is the path without the .sigmf-data or .sigmf-meta, meta is the
+  // SigMF metadata less the datatype, which the writer fills in
+  void open(const std::string &base, const nlohmann::json &meta, int source_num);
+  void close();
+  bool is_open();
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif // INCLUDED_SIGMF_SINK_H
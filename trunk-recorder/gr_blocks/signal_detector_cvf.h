@@ -21,6 +21,7 @@
 #ifndef INCLUDED_INSPECTOR_SIGNAL_DETECTOR_CVF_H
 #define INCLUDED_INSPECTOR_SIGNAL_DETECTOR_CVF_H
 
+#include <functional>
 #include <gnuradio/sync_decimator.h>
 /*
 namespace gr {
@@ -118,10 +119,29 @@ public:
     virtual void set_window_type(int d_window) = 0;
     virtual std::vector<Detected_Signal> get_detected_signals() = 0; 
 
+    /*!
+     * Signals that appeared and went away since the last call, matched by
+     * overlapping bins. Returns false when there are none, off a single
+     * atomic load. Neither this nor get_detected_signals() ever locks.
+     */
+    virtual bool get_signal_changes(std::vector<Detected_Signal> &appeared, std::vector<Detected_Signal> &lost) = 0;
+
+    /*!
+     * Called from the block's thread whenever signals appear or go away.
+     */
+    virtual void set_change_callback(std::function<void()> callback) = 0;
+
     virtual void set_threshold(float d_threshold) = 0;
     virtual void set_sensitivity(float d_sensitivity) = 0;
     virtual void set_auto_threshold(bool d_auto_threshold) = 0;
     virtual void set_average(float d_average) = 0;
+
+    /*!
+     * How many times a second to take an FFT and look for signals, on the
+     * sample clock. The vectors in between are consumed without being
+     * looked at.
+     */
+    virtual void set_rate(float rate) = 0;
 };
 
 //} // namespace inspector
@@ -23,6 +23,7 @@
 #endif
 
 #include "signal_detector_cvf_impl.h"
+#include <algorithm>
 #include <cmath>
 #include <gnuradio/io_signature.h>
 #include <volk/volk.h>
@@ -55,9 +56,9 @@ signal_detector_cvf::sptr signal_detector_cvf::make(double samp_rate,
                                                                  filename));
 }
 
-uint64_t signal_detector_cvf_impl::time_since_epoch_millisec() {
-  using namespace std::chrono;
-  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+void signal_detector_cvf_impl::update_vectors_per_fft() {
+  d_vectors_per_fft = std::max(1L, lround(d_samp_rate / d_fft_len / d_rate));
+  d_vectors_to_fft = std::min(d_vectors_to_fft, d_vectors_per_fft);
 }
 
 /*
@@ -96,7 +97,12 @@ signal_detector_cvf_impl::signal_detector_cvf_impl(double samp_rate,
   d_max_bw = max_bw;
   d_filename = filename;
   d_detected_signals = std::vector<Detected_Signal>();
-  last_conventional_channel_detection_check = time_since_epoch_millisec();
+  d_published = std::make_shared<const Detection>(Detection{0, std::vector<Detected_Signal>()});
+  d_seen = d_published;
+  d_generation = 0;
+  d_rate = 10;
+  d_vectors_to_fft = 0;
+  update_vectors_per_fft();
 
 
   BOOST_LOG_TRIVIAL(info) << "signal_detector_cvf_impl: " << "samp_rate: " << samp_rate << " fft_len: " << fft_len << " window_type: " << window_type << " threshold: " << threshold << " sensitivity: " << sensitivity << " auto_threshold: " << auto_threshold << " average: " << average << " quantization: " << quantization << " min_bw: " << min_bw << " filename: " << filename;
@@ -115,11 +121,10 @@ signal_detector_cvf_impl::signal_detector_cvf_impl(double samp_rate,
   d_fft = new gr::fft::fft_complex_fwd(fft_len, true);
 #endif
 
-  d_avg_filter.resize(d_fft_len);
+  // the average starts from 0, as single_pole_iir's did
+  memset(d_pxx_out, 0, sizeof(float) * d_fft_len);
+  d_threshold_order.clear();
   build_window();
-  for (unsigned int i = 0; i < d_fft_len; i++) {
-    d_avg_filter[i].set_taps(d_average);
-  }
 
   d_freq = build_freq();
 
@@ -153,13 +158,13 @@ void signal_detector_cvf_impl::set_fft_len(int fft_len) {
   d_tmp_pxx = static_cast<float *>(volk_malloc(sizeof(float) * d_fft_len, volk_get_alignment()));
   d_pxx = static_cast<float *>(volk_malloc(sizeof(float) * d_fft_len, volk_get_alignment()));
   d_pxx_out = (float *)volk_malloc(sizeof(float) * d_fft_len, volk_get_alignment());
-  d_avg_filter.resize(d_fft_len);
+  // the average starts from 0, as single_pole_iir's did
+  memset(d_pxx_out, 0, sizeof(float) * d_fft_len);
+  d_threshold_order.clear();
   build_window();
-  for (unsigned int i = 0; i < d_fft_len; i++) {
-    d_avg_filter[i].set_taps(d_average);
-  }
   set_decimation(fft_len);
   d_freq = build_freq();
+  update_vectors_per_fft();
 }
 
 void signal_detector_cvf_impl::set_window_type(int window) {
@@ -225,13 +230,44 @@ void signal_detector_cvf_impl::build_window() {
 
 // set auto threshold by searching for jumps between bins
 void signal_detector_cvf_impl::build_threshold() {
-  // copy array to work with
-  memcpy(d_tmp_pxx, d_pxx_out, sizeof(float) * d_fft_len);
-  // sort bins
+  // The averaged spectrum only moves a little from one FFT to the next, so
+  // the bins are sorted starting from the order they were in last time, by
+  // an insertion sort that has little to do. A spectrum that has moved too
+  // much for that to pay is left to std::sort.
+  if (d_threshold_order.size() != d_fft_len) {
+    d_threshold_order.resize(d_fft_len);
+    for (unsigned int i = 0; i < d_fft_len; i++) {
+      d_threshold_order[i] = i;
+    }
+  }
+  unsigned int *order = &d_threshold_order[0];
+  for (unsigned int i = 0; i < d_fft_len; i++) {
+    d_tmp_pxx[i] = d_pxx_out[order[i]];
+  }
   d_threshold = 500;
-  
-  std::sort(d_tmp_pxx, d_tmp_pxx + d_fft_len);
-  
+
+  size_t moves = 0;
+  const size_t max_moves = 8 * (size_t)d_fft_len;
+  unsigned int sorted = 1;
+  for (; (sorted < d_fft_len) && (moves < max_moves); sorted++) {
+    float value = d_tmp_pxx[sorted];
+    unsigned int bin = order[sorted];
+    unsigned int j = sorted;
+    while ((j > 0) && (d_tmp_pxx[j - 1] > value)) {
+      d_tmp_pxx[j] = d_tmp_pxx[j - 1];
+      order[j] = order[j - 1];
+      j--;
+    }
+    moves += sorted - j;
+    d_tmp_pxx[j] = value;
+    order[j] = bin;
+  }
+  if (sorted < d_fft_len) {
+    std::sort(order, order + d_fft_len, [this](unsigned int a, unsigned int b) { return d_pxx_out[a] < d_pxx_out[b]; });
+    for (unsigned int i = 0; i < d_fft_len; i++) {
+      d_tmp_pxx[i] = d_pxx_out[order[i]];
+    }
+  }
 
   float range = d_tmp_pxx[d_fft_len - 1] - d_tmp_pxx[0];
   // float median = d_tmp_pxx[int(d_fft_len/2)];
@@ -379,12 +415,49 @@ std::vector<Detected_Signal> signal_detector_cvf_impl::find_signal_edges() {
       return flanks;*/
 }
 
+// Adds the signals in a that don't overlap any signal in b to out
+static bool _unmatched_signals(const std::vector<Detected_Signal> &a, const std::vector<Detected_Signal> &b, std::vector<Detected_Signal> &out) {
+  bool found = false;
+  for (std::vector<Detected_Signal>::const_iterator it = a.begin(); it != a.end(); it++) {
+    bool matched = false;
+    for (std::vector<Detected_Signal>::const_iterator other = b.begin(); other != b.end(); other++) {
+      if ((it->start_bin <= other->end_bin) && (other->start_bin <= it->end_bin)) {
+        matched = true;
+        break;
+      }
+    }
+    if (!matched) {
+      out.push_back(*it);
+      found = true;
+    }
+  }
+  return found;
+}
+
+// The signals that appeared and went away between the Detection it looked
+// at last and the newest one. Only one thread is meant to call it, the
+// Source's.
+bool signal_detector_cvf_impl::get_signal_changes(std::vector<Detected_Signal> &appeared, std::vector<Detected_Signal> &lost) {
+  if (d_generation.load(std::memory_order_acquire) == d_seen->generation) {
+    return false;
+  }
+  std::shared_ptr<const Detection> latest = std::atomic_load(&d_published);
+  _unmatched_signals(latest->signals, d_seen->signals, appeared);
+  _unmatched_signals(d_seen->signals, latest->signals, lost);
+  d_seen = latest;
+  return true;
+}
+
+void signal_detector_cvf_impl::set_change_callback(std::function<void()> callback) {
+  std::shared_ptr<const std::function<void()>> shared;
+  if (callback) {
+    shared = std::make_shared<const std::function<void()>>(callback);
+  }
+  std::atomic_store(&d_change_callback, shared);
+}
+
 std::vector<Detected_Signal> signal_detector_cvf_impl::get_detected_signals() {
-  gr::thread::scoped_lock guard(d_mutex);
-  // BOOST_LOG_TRIVIAL(info) << "get_detected_freqs" << std::endl;
-  // BOOST_LOG_TRIVIAL(info) << "d_detected_freqs.size() = " << d_detected_freqs.size() << std::endl;
-  std::vector<Detected_Signal> safe_version = d_detected_signals;
-  return safe_version;
+  return std::atomic_load(&d_published)->signals;
 }
 
 //</editor-fold>
@@ -397,27 +470,50 @@ int signal_detector_cvf_impl::work(int noutput_items,
   const gr_complex *in = (const gr_complex *)input_items[0];
   // float* out = (float*)output_items[0];
 
-    uint64_t current_time_ms = time_since_epoch_millisec();
-    if ((current_time_ms - last_conventional_channel_detection_check) >= 100.0) { //0.05) {
-
-      periodogram(d_pxx, in);
-
-      // averaging
+    // Only one FFT is taken every d_vectors_per_fft vectors (see set_rate()),
+    // of the newest vector in the buffer; everything else is consumed
+    // without being looked at. Counting vectors rather than the time keeps
+    // the rate on the sample clock, so a replayed capture is looked at as
+    // often as a live one. Taking the whole buffer in one call keeps the
+    // scheduler from calling back for every fft_len samples at the full
+    // source rate.
+    d_vectors_to_fft -= noutput_items;
+    if (d_vectors_to_fft <= 0) {
+
+      periodogram(d_pxx, in + (noutput_items - 1) * d_fft_len);
+
+      // averaging, the single pole IIR of each bin over the whole spectrum
+      // at once
+      const float alpha = d_average;
+      const float beta = 1.0f - d_average;
       for (unsigned int i = 0; i < d_fft_len; i++) {
-        d_pxx_out[i] = d_avg_filter[i].filter(d_pxx[i]);
+        d_pxx_out[i] = alpha * d_pxx[i] + beta * d_pxx_out[i];
       }
 
       if (d_auto_threshold) {
         build_threshold();
       }
 
-      gr::thread::scoped_lock guard(d_mutex);
-      d_detected_signals = find_signal_edges();
-      last_conventional_channel_detection_check = current_time_ms;
+      std::vector<Detected_Signal> signals = find_signal_edges();
+      d_changed_signals.clear();
+      bool changed = _unmatched_signals(signals, d_detected_signals, d_changed_signals);
+      changed = _unmatched_signals(d_detected_signals, signals, d_changed_signals) || changed;
+      d_detected_signals.swap(signals);
+      if (changed) {
+        uint64_t generation = d_generation.load(std::memory_order_relaxed) + 1;
+        std::atomic_store(&d_published, std::make_shared<const Detection>(Detection{generation, d_detected_signals}));
+        d_generation.store(generation, std::memory_order_release);
+
+        std::shared_ptr<const std::function<void()>> callback = std::atomic_load(&d_change_callback);
+        if (callback) {
+          (*callback)();
+        }
+      }
+      d_vectors_to_fft = d_vectors_per_fft;
     }
   // BOOST_LOG_TRIVIAL(info) << "d_detected_signals.size() = " << d_detected_signals.size() << std::endl;
 
-  return 1; // one vector has been processed
+  return noutput_items;
 }
 
 //} /* namespace inspector */
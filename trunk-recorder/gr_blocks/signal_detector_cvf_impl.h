@@ -21,19 +21,19 @@
 #ifndef INCLUDED_INSPECTOR_SIGNAL_DETECTOR_CVF_IMPL_H
 #define INCLUDED_INSPECTOR_SIGNAL_DETECTOR_CVF_IMPL_H
 #include "./signal_detector_cvf.h"
+#include <atomic>
+#include <memory>
 #include <boost/log/trivial.hpp>
 #include <fstream>
 #include <gnuradio/fft/fft.h>
 #include <gnuradio/fft/window.h>
 #include <gnuradio/filter/firdes.h>
-#include <gnuradio/filter/single_pole_iir.h>
 /*
 namespace gr {
 namespace inspector {*/
 
 class signal_detector_cvf_impl : public signal_detector_cvf {
 private:
-  boost::mutex d_mutex;
   bool d_auto_threshold;
   unsigned int d_fft_len;
   unsigned int d_tmpbuflen;
@@ -41,17 +41,43 @@ private:
   float *d_pxx, *d_tmp_pxx, *d_pxx_out, *d_tmpbuf;
   double d_samp_rate;
 
-  std::vector<gr::filter::single_pole_iir<float, float, double>> d_avg_filter;
+  // the vectors between FFTs, and how many are left until the next one
+  float d_rate;
+  long d_vectors_per_fft;
+  long d_vectors_to_fft;
+
+  // the bins in the order of their power the last time build_threshold()
+  // sorted them
+  std::vector<unsigned int> d_threshold_order;
 #if GNURADIO_VERSION < 0x030900
   gr::filter::firdes::win_type d_window_type;
 #else
   gr::fft::window::win_type d_window_type;
 #endif
-  uint64_t last_conventional_channel_detection_check;
   std::vector<float> d_window;
   std::vector<std::vector<float>> d_signal_edges;
   std::vector<std::vector<float>> d_rf_map;
+
+  // When the signals the block thread finds change, they are published as
+  // a Detection that is never changed once it is, swapped in with
+  // std::atomic_store, so neither side ever waits on the other.
+  // d_generation goes up with each one, so a reader that has seen it can
+  // tell nothing has changed without going near the Detection.
+  struct Detection {
+    uint64_t generation;
+    std::vector<Detected_Signal> signals;
+  };
+  std::shared_ptr<const Detection> d_published;
+  std::atomic<uint64_t> d_generation;
+  std::shared_ptr<const std::function<void()>> d_change_callback;
+
+  // the block thread's own, what it published last and scratch for
+  // comparing with it
   std::vector<Detected_Signal> d_detected_signals;
+  std::vector<Detected_Signal> d_changed_signals;
+
+  // get_signal_changes()'s own, the Detection it compared against last
+  std::shared_ptr<const Detection> d_seen;
 #if GNURADIO_VERSION < 0x030900
   gr::fft::fft_complex *d_fft;
 #else
@@ -59,7 +85,8 @@ private:
 #endif
   std::vector<float> d_freq;
   const char *d_filename;
-  uint64_t time_since_epoch_millisec();
+
+  void update_vectors_per_fft();
 
 public:
   signal_detector_cvf_impl(double samp_rate,
@@ -89,6 +116,8 @@ public:
   void periodogram(float *pxx, const gr_complex *signal);
 
   std::vector<Detected_Signal> get_detected_signals();
+  bool get_signal_changes(std::vector<Detected_Signal> &appeared, std::vector<Detected_Signal> &lost);
+  void set_change_callback(std::function<void()> callback);
 
   int work(int noutput_items,
            gr_vector_const_void_star &input_items,
@@ -96,6 +125,12 @@ public:
 
   void set_samp_rate(double d_samp_rate) {
     signal_detector_cvf_impl::d_samp_rate = d_samp_rate;
+    update_vectors_per_fft();
+  }
+
+  void set_rate(float rate) {
+    d_rate = rate;
+    update_vectors_per_fft();
   }
 
   void set_fft_len(int fft_len);
@@ -116,9 +151,6 @@ public:
 
   void set_average(float d_average) {
     signal_detector_cvf_impl::d_average = d_average;
-    for (unsigned int i = 0; i < d_fft_len; i++) {
-      d_avg_filter[i].set_taps(d_average);
-    }
   }
 
   void set_quantization(float d_quantization) {
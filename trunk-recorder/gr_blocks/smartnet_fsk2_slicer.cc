@@ -0,0 +1,63 @@
+#include "smartnet_fsk2_slicer.h"
+
+#include <algorithm>
+#include <math.h>
+
+smartnet_fsk2_slicer_sptr make_smartnet_fsk2_slicer(int samples_per_symbol, double symbol_rate, double deviation) {
+  return gnuradio::get_initial_sptr(new smartnet_fsk2_slicer(samples_per_symbol, symbol_rate, deviation));
+}
+
+smartnet_fsk2_slicer::smartnet_fsk2_slicer(int samples_per_symbol, double symbol_rate, double deviation)
+    : gr::block("smartnet_fsk2_slicer",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(char))),
+      d_samples_per_symbol(samples_per_symbol),
+      d_kernel(samples_per_symbol, symbol_rate, deviation),
+      d_bits(fsk2_slice_kernel::TILE),
+      d_pending_start(0),
+      d_pending_end(0) {
+  set_relative_rate(1.0 / samples_per_symbol);
+}
+
+void smartnet_fsk2_slicer::reset() {
+  gr::thread::scoped_lock lock(d_mutex);
+  d_kernel.reset();
+  d_pending_start = 0;
+  d_pending_end = 0;
+}
+
+void smartnet_fsk2_slicer::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  std::fill(ninput_items_required.begin(), ninput_items_required.end(), noutput_items * d_samples_per_symbol);
+}
+
+int smartnet_fsk2_slicer::general_work(int noutput_items,
+                                       gr_vector_int &ninput_items,
+                                       gr_vector_const_void_star &input_items,
+                                       gr_vector_void_star &output_items) {
+  gr::thread::scoped_lock lock(d_mutex);
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  uint8_t *out = (uint8_t *)output_items[0];
+  const int ninput = ninput_items[0];
+
+  int i = 0, o = 0;
+
+  while (o < noutput_items) {
+    if (d_pending_start == d_pending_end) {
+      if (i == ninput) {
+        break;
+      }
+      const int count = std::min(ninput - i, fsk2_slice_kernel::TILE);
+      d_pending_start = 0;
+      d_pending_end = d_kernel.work(&in[i], count, d_bits.data());
+      i += count;
+    }
+
+    const int count = std::min(noutput_items - o, d_pending_end - d_pending_start);
+    std::copy(&d_bits[d_pending_start], &d_bits[d_pending_start + count], &out[o]);
+    d_pending_start += count;
+    o += count;
+  }
+
+  consume_each(i);
+  return o;
+}
@@ -0,0 +1,58 @@
+#ifndef INCLUDED_SMARTNET_FSK2_SLICER_H
+#define INCLUDED_SMARTNET_FSK2_SLICER_H
+
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/gr_complex.h>
+#include <gnuradio/io_signature.h>
+#include <boost/thread/mutex.hpp>
+
+#include "fsk2_slice_kernel.h"
+
+// The SmartNet control channel demodulator in one block, from the
+// channelizer's samples to a bit a symbol for the frame assembler:
+// quadrature_demod_cf, rmsagc_ff, the symbol filter, fsk4_demod_ff and
+// binary_slicer_fb. It used to be five blocks, each with its own thread and
+// buffer, for each control channel. The work is done by fsk2_slice_kernel.
+//
+// The timing loop can put out a symbol a little sooner than every
+// samples_per_symbol samples, so a tile is demodulated whole and whatever
+// bits don't fit in the output are kept for the next call.
+
+class smartnet_fsk2_slicer;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<smartnet_fsk2_slicer> smartnet_fsk2_slicer_sptr;
+#else
+typedef std::shared_ptr<smartnet_fsk2_slicer> smartnet_fsk2_slicer_sptr;
+#endif
+
+smartnet_fsk2_slicer_sptr make_smartnet_fsk2_slicer(int samples_per_symbol, double symbol_rate, double deviation);
+
+class smartnet_fsk2_slicer : public gr::block {
+
+  friend smartnet_fsk2_slicer_sptr make_smartnet_fsk2_slicer(int samples_per_symbol, double symbol_rate, double deviation);
+
+  boost::mutex d_mutex;
+  int d_samples_per_symbol;
+  fsk2_slice_kernel d_kernel;
+
+  std::vector<uint8_t> d_bits; // a tile of bits
+  int d_pending_start;
+  int d_pending_end;
+
+  smartnet_fsk2_slicer(int samples_per_symbol, double symbol_rate, double deviation);
+
+public:
+  void reset();
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
@@ -15,6 +15,8 @@
 #include "./squelch_base_cc_impl.h"
 #include <gnuradio/io_signature.h>
 #include <gnuradio/math.h>
+#include <volk/volk.h>
+#include <cstring>
 
 namespace gr {
 namespace analog {
@@ -57,6 +59,17 @@ bool squelch_base_cc_impl::unmuted() const
     return (d_state == ST_UNMUTED || d_state == ST_ATTACK);
 }
 
+int squelch_base_cc_impl::update_state_run(const gr_complex* in, int n, bool muted)
+{
+    for (int i = 0; i < n; i++) {
+        update_state(in[i]);
+        if (mute() != muted) {
+            return i;
+        }
+    }
+    return n;
+}
+
 int squelch_base_cc_impl::general_work(int noutput_items,
                                        gr_vector_int& ninput_items,
                                        gr_vector_const_void_star& input_items,
@@ -70,7 +83,40 @@ int squelch_base_cc_impl::general_work(int noutput_items,
     gr::thread::scoped_lock l(d_setlock);
 
     for (int i = 0; i < noutput_items; i++) {
-        update_state(in[i]);
+        // While it stays muted or unmuted nothing is ramped or tagged, so
+        // the samples up to the next change are handled all at once and
+        // only the one it changes on goes through the state machine
+        if (d_state == ST_MUTED || d_state == ST_UNMUTED) {
+            bool muted = (d_state == ST_MUTED);
+            if (!muted && d_tag_next_unmuted) {
+                d_tag_next_unmuted = false;
+                add_item_tag(0, nitems_written(0) + j, d_sob_key, pmt::PMT_NIL);
+            }
+
+            int n = update_state_run(&in[i], noutput_items - i, muted);
+            if (!muted) {
+                if (d_envelope == 1.0) {
+                    memcpy(&out[j], &in[i], n * sizeof(gr_complex));
+                } else {
+                    volk_32f_s32f_multiply_32f((float*)&out[j],
+                                               (const float*)&in[i],
+                                               (float)d_envelope,
+                                               2 * n);
+                }
+                j += n;
+            } else if (!d_gate) {
+                memset(&out[j], 0, n * sizeof(gr_complex));
+                j += n;
+            }
+
+            i += n;
+            if (i == noutput_items) {
+                break;
+            }
+            // update_state() has already been called for in[i]
+        } else {
+            update_state(in[i]);
+        }
 
         // Adjust envelope based on current state
         switch (d_state) {
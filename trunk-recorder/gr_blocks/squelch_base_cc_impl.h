@@ -31,6 +31,12 @@ protected:
     void update_state(const gr_complex& sample) override{};
     bool mute() const override { return false; };
 
+    // Calls update_state() for each of the n samples until mute() is no
+    // longer muted, and returns how many samples it got through before that
+    // one, or n if it never changed. A squelch that can work out its state
+    // for a whole buffer at once overrides it.
+    virtual int update_state_run(const gr_complex* in, int n, bool muted);
+
 public:
     squelch_base_cc_impl(const char* name, int ramp, bool gate);
     ~squelch_base_cc_impl() override;
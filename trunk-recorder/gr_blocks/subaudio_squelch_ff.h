@@ -0,0 +1,110 @@
+/* -*- c++ -*- */
+/*
+ * subaudio_squelch_ff.h
+ *   GNU Radio block that gates float audio on a detected CTCSS tone or
+ *   DCS code.
+ *
+ * Takes the FM-demodulated audio stream as input and produces the same audio
+ * on output, but zeroes the output whenever none of the configured tones or
+ * codes is present.  Replaces gr::analog::ctcss_squelch_ff for CTCSS and
+ * handles DCS (134.4 bps Golay-coded) with the same block: both detectors
+ * share one sub-300 Hz low-pass/decimation stage, with Goertzel filters for
+ * CTCSS and bit recovery for DCS running on the decimated stream.
+ *
+ * Placement in the flowgraph:
+ *   de-emphasis → [subaudio_squelch_ff] → decim_audio → ...
+ *
+ * Parameters:
+ *   sample_rate   - input sample rate in Hz (typically system_channel_rate)
+ *   tail_ms       - squelch tail in milliseconds after the last detection
+ *                   (default 250 ms)
+ *   gate          - if true, produce no output while closed instead of
+ *                   zeros, so downstream filters sit idle (default false)
+ *
+ * Targets are added with add_ctcss_target() and add_dcs_target().  Any mix
+ * of tones and (code, polarity) pairs may be configured, and whichever one
+ * appears opens the squelch, so a single demod can serve every talkgroup
+ * sharing an RF channel.  DCS membership is a 512-bit bitmap lookup per
+ * polarity; each CTCSS target costs three Goertzel filters at the decimated
+ * rate.
+ *
+ * Whenever the squelch opens, or the matched target changes while open, a
+ * tag naming the target is placed on the first sample of the open run:
+ * "dcs_code" with the decimal code plus 1000 for inverted polarity (the
+ * code decoded, which can be one sharing the target's bitstream), or
+ * "ctcss_tone" with the tone in Hz (the same values the channel file loader
+ * uses for the Tone column).
+ *
+ * Output is delayed by a fixed pre-roll of four DCS codewords (~714 ms) so
+ * the gate can open at the estimated start of the first codeword or CTCSS
+ * window instead of at its confirmation; tags are carried through the same
+ * delay.
+ *
+ * Like gr::analog::squelch_base_ff, "squelch_sob" and "squelch_eob" tags mark
+ * the first and last sample of each open run.  In gate mode these are the
+ * only record of where audio was dropped.
+ *
+ * Threading: target changes may be made from any one control thread while
+ * the flowgraph runs.  They are staged and handed to the scheduler thread
+ * through a single atomic slot, taking effect at the next buffer boundary.
+ * The squelch state is published the other way as a snapshot at the end
+ * of every buffer, so get_state() and is_open() never block the flowgraph.
+ */
+
+#ifndef INCLUDED_SUBAUDIO_SQUELCH_FF_H
+#define INCLUDED_SUBAUDIO_SQUELCH_FF_H
+
+#include <gnuradio/blocks/api.h>
+#include <gnuradio/block.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace gr {
+namespace blocks {
+
+/* Squelch state as of the end of the last buffer processed */
+struct subaudio_squelch_state {
+    bool     open;
+    float    matched_tone;  /* last target to open, in the Tone encoding; 0 if none */
+    time_t   last_open;     /* wall clock time the squelch was last open; 0 if never */
+    uint64_t samples_in;    /* input samples processed */
+    uint64_t samples_open;  /* of those, samples passed while open */
+};
+
+class BLOCKS_API subaudio_squelch_ff : virtual public block {
+public:
+#if GNURADIO_VERSION < 0x030900
+    typedef boost::shared_ptr<subaudio_squelch_ff> sptr;
+#else
+    typedef std::shared_ptr<subaudio_squelch_ff> sptr;
+#endif
+
+    static sptr make(int sample_rate,
+                     float tail_ms = 250.0f,
+                     bool gate = false);
+
+    /* Add a target in the channel file's Tone encoding: positive is a
+     * CTCSS tone in Hz, negative a DCS code (-(code), -(code + 1000) when
+     * inverted).  Returns false if the value names no valid target.      */
+    virtual bool add_target(float tone) = 0;
+    virtual void add_ctcss_target(float tone_hz) = 0;
+    virtual void add_dcs_target(int code, bool inverted) = 0;
+    virtual void clear_targets() = 0;
+    virtual bool has_ctcss_targets() const = 0;
+    virtual bool has_dcs_targets() const = 0;
+    virtual bool is_open() const = 0;
+    virtual bool gate() const = 0;
+
+    /* Target that last opened the squelch, in the Tone encoding above;
+     * 0 if none yet.                                                     */
+    virtual float get_matched_tone() const = 0;
+
+    /* Consistent copy of the published state; lock-free, safe to call
+     * from any thread.                                                   */
+    virtual subaudio_squelch_state get_state() const = 0;
+};
+
+} /* namespace blocks */
+} /* namespace gr */
+
+#endif /* INCLUDED_SUBAUDIO_SQUELCH_FF_H */
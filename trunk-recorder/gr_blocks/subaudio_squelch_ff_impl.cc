@@ -0,0 +1,591 @@
+/* -*- c++ -*- */
+/*
+ * subaudio_squelch_ff_impl.cc
+ *   GNU Radio float→float squelch gate driven by CTCSS and DCS detection.
+ *
+ * The DCS decoder runs on every input sample.  Its decimating low-pass
+ * front end is the only sub-audio filter in the block: the decimated
+ * stream goes to DCS bit recovery and, through the decoder's low-pass
+ * callback, to a small Goertzel bank for the CTCSS targets.  Whenever any
+ * target is confirmed the squelch opens and a tail timer is (re)started.
+ * Audio passes through unchanged while the squelch is open; zeros are
+ * output while it is closed, or nothing at all in gate mode.
+ *
+ * A DCS code is only confirmed on its second consecutive codeword, about
+ * 340 ms in, or a word later when its bits needed correcting, and a CTCSS
+ * tone at the end of a 250 ms window.  To keep the first syllable, audio is
+ * passed through a pre-roll delay line four codewords long and the gate is
+ * evaluated in delayed time, opening at the estimated start of the first
+ * codeword or window.
+ *
+ * Nothing the scheduler thread works on is shared: target changes arrive
+ * as whole target sets through an atomic pointer swapped in at the top of
+ * general_work(), and state goes out through a sequence-counted snapshot
+ * written at the bottom.
+ */
+
+#include "subaudio_squelch_ff_impl.h"
+#include "decoders/ctcss_tones.h"
+#include <gnuradio/io_signature.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* Pre-roll: two 23-bit codewords, the word period the decoder waits when
+ * they had bits corrected, one more for a first word lost while the bit
+ * clock pulls in, and slack for the filter delay.                        */
+#define DCS_PREROLL_BITS 96
+#define DCS_BIT_RATE     134.4f
+
+/* 250 ms windows put the first Goertzel null 4 Hz out, so the nearest
+ * standard tones (2.3 Hz apart) still come out well below the target.    */
+#define CTCSS_WINDOW_MS        250
+/* Minimum tone amplitude, as for gr::analog::ctcss_squelch_ff's level    */
+#define CTCSS_LEVEL            0.01f
+/* Target power must beat both neighbours by this factor (3 dB)           */
+#define CTCSS_NEIGHBOUR_RATIO  2.0f
+/* Neighbour spacing for tones with no standard tone next to them         */
+#define CTCSS_NEIGHBOUR_HZ     3.0f
+
+namespace gr {
+namespace blocks {
+
+/* -------------------------------------------------------------------------
+ * Factory / constructor / destructor
+ * ---------------------------------------------------------------------- */
+
+subaudio_squelch_ff_impl::sptr
+subaudio_squelch_ff_impl::make(int sample_rate, float tail_ms, bool gate) {
+    return gnuradio::get_initial_sptr(
+        new subaudio_squelch_ff_impl(sample_rate, tail_ms, gate));
+}
+
+subaudio_squelch_ff_impl::subaudio_squelch_ff_impl(int sample_rate, float tail_ms,
+                                                   bool gate)
+    : block("subaudio_squelch_ff",
+            io_signature::make(1, 1, sizeof(float)),
+            io_signature::make(1, 1, sizeof(float))),
+      d_decim(1),
+      d_pending_config(nullptr),
+      d_has_dcs(false),
+      d_clear_gen(0),
+      d_ctcss_count(0),
+      d_matched_key(-1),
+      d_dcs_key(pmt::intern("dcs_code")),
+      d_ctcss_key(pmt::intern("ctcss_tone")),
+      d_sob_key(pmt::intern("squelch_sob")),
+      d_eob_key(pmt::intern("squelch_eob")),
+      d_gate(gate),
+      d_squelch_open(false),
+      d_ring_pos(0),
+      d_nspans(0),
+      d_samples_open(0),
+      d_last_open(0) {
+
+    memset(d_targets, 0, sizeof(d_targets));
+    memset(d_staged.targets, 0, sizeof(d_staged.targets));
+    d_staged.has_dcs   = false;
+    d_staged.clear_gen = 0;
+    d_ctcss.reserve(8);
+    d_events.reserve(64);
+    d_tags.reserve(16);
+    d_pending_tags.reserve(16);
+
+    d_tail_samples_max = (int)((float)sample_rate * tail_ms / 1000.0f);
+
+    d_preroll = (int)((float)sample_rate * DCS_PREROLL_BITS / DCS_BIT_RATE);
+    d_ring.assign(d_preroll, 0.0f);
+
+    d_state.seq.store(0);
+    d_state.open.store(false);
+    d_state.matched_tone.store(0.0f);
+    d_state.last_open.store(0);
+    d_state.samples_in.store(0);
+    d_state.samples_open.store(0);
+
+    /* Output lags input by the pre-roll, and in gate mode samples are
+     * dropped, so tags are carried through the delay by general_work().  */
+    set_tag_propagation_policy(TPP_DONT);
+
+    d_dcs_decoder = dcs_decoder_new(sample_rate);
+    if (d_dcs_decoder) {
+        dcs_decoder_set_callback(d_dcs_decoder, subaudio_squelch_ff_impl::dcs_callback, this);
+        dcs_decoder_set_lowpass_callback(d_dcs_decoder, subaudio_squelch_ff_impl::lowpass_callback, this);
+        d_decim = dcs_decoder_get_decimation(d_dcs_decoder);
+    }
+    d_lp_rate          = (float)sample_rate / (float)d_decim;
+    d_ctcss_window     = (int)(d_lp_rate * CTCSS_WINDOW_MS / 1000.0f);
+    d_ctcss_window_in  = d_ctcss_window * d_decim;
+
+    BOOST_LOG_TRIVIAL(info) << "Sub-audio squelch: tail=" << tail_ms << " ms"
+                            << "  pre-roll=" << (d_preroll * 1000 / sample_rate) << " ms"
+                            << "  sample_rate=" << sample_rate
+                            << "  decimated_rate=" << d_lp_rate
+                            << (d_gate ? "  gate" : "");
+}
+
+subaudio_squelch_ff_impl::~subaudio_squelch_ff_impl() {
+    dcs_decoder_delete(d_dcs_decoder);
+    delete d_pending_config.load();
+}
+
+/* -------------------------------------------------------------------------
+ * Target and state hand-off between the control and scheduler threads
+ * ---------------------------------------------------------------------- */
+void subaudio_squelch_ff_impl::publish_config() {
+    /* A set the scheduler never picked up is simply superseded */
+    target_config *old = d_pending_config.exchange(new target_config(d_staged),
+                                                   std::memory_order_acq_rel);
+    delete old;
+}
+
+void subaudio_squelch_ff_impl::apply_config(target_config *config) {
+    if (config->clear_gen != d_clear_gen) {
+        d_ctcss.clear();
+        d_ctcss_count  = 0;
+        d_matched_key  = -1;
+        d_squelch_open = false;
+        d_nspans       = 0;
+        d_clear_gen    = config->clear_gen;
+    }
+    memcpy(d_targets, config->targets, sizeof(d_targets));
+    d_has_dcs = config->has_dcs;
+    for (size_t t = d_ctcss.size(); t < config->ctcss.size(); t++) {
+        d_ctcss.push_back(config->ctcss[t]);
+    }
+}
+
+void subaudio_squelch_ff_impl::publish_state(uint64_t samples_in, bool was_open) {
+    if (was_open) {
+        d_last_open = time(NULL);
+    }
+
+    const uint32_t seq = d_state.seq.load(std::memory_order_relaxed);
+    d_state.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    d_state.open.store(d_squelch_open, std::memory_order_relaxed);
+    d_state.matched_tone.store(key_tone(d_matched_key), std::memory_order_relaxed);
+    d_state.last_open.store(d_last_open, std::memory_order_relaxed);
+    d_state.samples_in.store(samples_in, std::memory_order_relaxed);
+    d_state.samples_open.store(d_samples_open, std::memory_order_relaxed);
+    d_state.seq.store(seq + 2, std::memory_order_release);
+}
+
+float subaudio_squelch_ff_impl::key_tone(int key) const {
+    if (key < 0) {
+        return 0;
+    }
+    if (key >= CTCSS_KEY_BASE) {
+        return d_ctcss[key - CTCSS_KEY_BASE].tone;
+    }
+    return -(float)key;
+}
+
+/* -------------------------------------------------------------------------
+ * Detector callbacks
+ * Called from within dcs_decoder_process_samples().  Both only record
+ * events; general_work() turns them into open spans.
+ * ---------------------------------------------------------------------- */
+void subaudio_squelch_ff_impl::dcs_callback(int code, int inverted, void *context) {
+    subaudio_squelch_ff_impl *self = static_cast<subaudio_squelch_ff_impl *>(context);
+    bool inv = (inverted != 0);
+    if (!self->has_target(code, inv)) {
+        return;
+    }
+
+    subaudio_event ev;
+    ev.offset = dcs_decoder_get_position(self->d_dcs_decoder);
+    ev.key    = code + (inv ? 1000 : 0);
+    self->d_events.push_back(ev);
+}
+
+void subaudio_squelch_ff_impl::lowpass_callback(const float *samples, int n,
+                                                unsigned long long first_pos,
+                                                void *context) {
+    static_cast<subaudio_squelch_ff_impl *>(context)->detect_ctcss(samples, n, first_pos);
+}
+
+void subaudio_squelch_ff_impl::detect_ctcss(const float *samples, int n,
+                                            unsigned long long first_pos) {
+    const int ntargets = (int)d_ctcss.size();
+    if (ntargets == 0) {
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const float x = samples[i];
+        for (int t = 0; t < ntargets; t++) {
+            ctcss_target &target = d_ctcss[t];
+            for (int k = 0; k < 3; k++) {
+                float s0 = x + target.coeff[k] * target.s1[k] - target.s2[k];
+                target.s2[k] = target.s1[k];
+                target.s1[k] = s0;
+            }
+        }
+
+        if (++d_ctcss_count < d_ctcss_window) {
+            continue;
+        }
+        d_ctcss_count = 0;
+
+        int   best       = -1;
+        float best_power = 0.0f;
+        for (int t = 0; t < ntargets; t++) {
+            ctcss_target &target = d_ctcss[t];
+            float power[3];
+            for (int k = 0; k < 3; k++) {
+                power[k] = target.s1[k] * target.s1[k] + target.s2[k] * target.s2[k] -
+                           target.coeff[k] * target.s1[k] * target.s2[k];
+                target.s1[k] = 0.0f;
+                target.s2[k] = 0.0f;
+            }
+            if (power[0] > best_power &&
+                power[0] > CTCSS_NEIGHBOUR_RATIO * power[1] &&
+                power[0] > CTCSS_NEIGHBOUR_RATIO * power[2]) {
+                best       = t;
+                best_power = power[0];
+            }
+        }
+
+        /* A sinusoid of amplitude A leaves (A * N / 2)^2 in its bin */
+        if (best >= 0 && 2.0f * sqrtf(best_power) / d_ctcss_window > CTCSS_LEVEL) {
+            subaudio_event ev;
+            ev.offset = first_pos + (unsigned long long)i * d_decim;
+            ev.key    = CTCSS_KEY_BASE + best;
+            d_events.push_back(ev);
+        }
+    }
+}
+
+/* A confirmation at sample e opens [e - preroll, e + tail).  CTCSS is only
+ * re-confirmed once per window, so its spans also cover the next window.
+ * Refreshes of the same target extend the last span; a different target
+ * starts a new span where its own pre-roll begins, cutting the previous
+ * one short.                                                              */
+void subaudio_squelch_ff_impl::add_span(const subaudio_event &ev) {
+    int64_t start = (int64_t)ev.offset - d_preroll;
+    int64_t end   = INT64_MAX;
+    if (d_tail_samples_max > 0) {
+        end = (int64_t)ev.offset + d_tail_samples_max;
+        if (ev.key >= CTCSS_KEY_BASE) {
+            end += d_ctcss_window_in;
+        }
+    }
+
+    if (d_nspans > 0) {
+        subaudio_span &last = d_spans[d_nspans - 1];
+        if (start <= last.end && ev.key == last.key) {
+            last.end = std::max(last.end, end);
+            return;
+        }
+        if (start < last.end) {
+            /* Spans are added before this call's audio goes out, so only
+             * keep the cut span from becoming empty                       */
+            start = std::max(start, last.start + 1);
+            last.end = start;
+        }
+        if (d_nspans == MAX_SPANS) {
+            last.end = std::max(last.end, end);
+            return;
+        }
+    }
+
+    subaudio_span &span = d_spans[d_nspans++];
+    span.start = start;
+    span.end   = end;
+    span.key   = ev.key;
+}
+
+void subaudio_squelch_ff_impl::add_match_tag(uint64_t out_offset, int key) {
+    if (key >= CTCSS_KEY_BASE) {
+        add_item_tag(0, out_offset, d_ctcss_key,
+                     pmt::from_double(d_ctcss[key - CTCSS_KEY_BASE].tone));
+    } else {
+        add_item_tag(0, out_offset, d_dcs_key, pmt::from_long(key));
+    }
+}
+
+void subaudio_squelch_ff_impl::copy_delayed(float *out, const float *in, int j, int n) const {
+    /* Outputs j < preroll come from the ring, the rest from this buffer */
+    while (n > 0 && j < d_preroll) {
+        int pos   = (d_ring_pos + j) % d_preroll;
+        int chunk = std::min(n, std::min(d_preroll - j, d_preroll - pos));
+        memcpy(out, &d_ring[pos], chunk * sizeof(float));
+        out += chunk;
+        j   += chunk;
+        n   -= chunk;
+    }
+    if (n > 0) {
+        memcpy(out, in + (j - d_preroll), n * sizeof(float));
+    }
+}
+
+void subaudio_squelch_ff_impl::forward_tags(int64_t t, int n, uint64_t out_offset) {
+    for (size_t k = 0; k < d_pending_tags.size(); k++) {
+        int64_t offset = (int64_t)d_pending_tags[k].offset;
+        if (offset >= t && offset < t + n) {
+            add_item_tag(0, out_offset + (offset - t),
+                         d_pending_tags[k].key, d_pending_tags[k].value,
+                         d_pending_tags[k].srcid);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------
+ * GNU Radio general_work() — processes one buffer of samples
+ *
+ * Output sample j of this call carries input sample nitems_read - preroll
+ * + j.  The gate state only changes at span boundaries, so the buffer is
+ * walked as runs between them: open runs are copied and closed runs zeroed
+ * (or skipped in gate mode) in one call each.
+ * ---------------------------------------------------------------------- */
+void subaudio_squelch_ff_impl::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+    ninput_items_required[0] = noutput_items;
+}
+
+int subaudio_squelch_ff_impl::general_work(int noutput_items,
+                                           gr_vector_int &ninput_items,
+                                           gr_vector_const_void_star &input_items,
+                                           gr_vector_void_star &output_items) {
+    const float *in  = static_cast<const float *>(input_items[0]);
+    float       *out = static_cast<float *>(output_items[0]);
+    const int ninput = std::min(noutput_items, ninput_items[0]);
+
+    const uint64_t in_base  = nitems_read(0);
+    const uint64_t out_base = nitems_written(0);
+    const int64_t  t0       = (int64_t)in_base - d_preroll;  /* time of output 0 */
+    bool was_open = d_squelch_open;
+
+    /* Retunes only take effect here, between buffers */
+    target_config *config = d_pending_config.exchange(nullptr, std::memory_order_acquire);
+    if (config) {
+        apply_config(config);
+        delete config;
+    }
+
+    /* Run the detectors over input — collects target confirmations into
+     * d_events.  Each detector reports in sample order, but CTCSS events
+     * for a filter block come ahead of its DCS events, so a channel with
+     * both kinds of target needs them merged.                             */
+    d_events.clear();
+    if (d_dcs_decoder) {
+        dcs_decoder_process_samples(d_dcs_decoder, in, ninput);
+    }
+    if (d_has_dcs && !d_ctcss.empty() && d_events.size() > 1) {
+        std::sort(d_events.begin(), d_events.end(),
+                  [](const subaudio_event &a, const subaudio_event &b) { return a.offset < b.offset; });
+    }
+    for (size_t e = 0; e < d_events.size(); e++) {
+        add_span(d_events[e]);
+    }
+
+    d_tags.clear();
+    get_tags_in_range(d_tags, 0, in_base, in_base + ninput);
+    d_pending_tags.insert(d_pending_tags.end(), d_tags.begin(), d_tags.end());
+
+    int j = 0;      /* delayed position, one per input sample */
+    int o = 0;      /* output position */
+
+    /* Closed with nothing pending: in gate mode the whole buffer is dropped */
+    if (d_gate && !d_squelch_open && d_nspans == 0) {
+        j = ninput;
+    }
+
+    while (j < ninput) {
+        const int64_t t = t0 + j;
+        int run = ninput - j;
+
+        /* Retire spans that have fully gone out */
+        while (d_nspans > 0 && d_spans[0].end <= t) {
+            memmove(&d_spans[0], &d_spans[1], (d_nspans - 1) * sizeof(subaudio_span));
+            d_nspans--;
+        }
+
+        if (d_nspans > 0 && d_spans[0].start <= t) {
+            const subaudio_span &span = d_spans[0];
+            if (span.end - t < run) {
+                run = (int)(span.end - t);
+            }
+
+            if (!d_squelch_open) {
+                add_item_tag(0, out_base + o, d_sob_key, pmt::PMT_NIL);
+            }
+            if (!d_squelch_open || span.key != d_matched_key) {
+                add_match_tag(out_base + o, span.key);
+            }
+            d_matched_key  = span.key;
+            d_squelch_open = true;
+
+            copy_delayed(out + o, in, j, run);
+            forward_tags(t, run, out_base + o);
+            o += run;
+            d_samples_open += run;
+            was_open = true;
+
+            /* Close unless the next span carries straight on */
+            if (t + run == span.end && (d_nspans < 2 || d_spans[1].start > span.end)) {
+                add_item_tag(0, out_base + o - 1, d_eob_key, pmt::PMT_NIL);
+                d_squelch_open = false;
+            }
+        } else {
+            if (d_nspans > 0 && d_spans[0].start - t < run) {
+                run = (int)(d_spans[0].start - t);
+            }
+            d_squelch_open = false;
+            if (!d_gate) {
+                memset(out + o, 0, run * sizeof(float));
+                forward_tags(t, run, out_base + o);
+                o += run;
+            }
+        }
+        j += run;
+    }
+
+    /* Drop tags that have come out of (or been skipped by) the delay */
+    size_t done = 0;
+    while (done < d_pending_tags.size() &&
+           (int64_t)d_pending_tags[done].offset < t0 + ninput) {
+        done++;
+    }
+    d_pending_tags.erase(d_pending_tags.begin(), d_pending_tags.begin() + done);
+
+    /* Keep the newest preroll input samples in the ring */
+    if (ninput >= d_preroll) {
+        memcpy(&d_ring[0], in + (ninput - d_preroll), d_preroll * sizeof(float));
+        d_ring_pos = 0;
+    } else {
+        int first = std::min(ninput, d_preroll - d_ring_pos);
+        memcpy(&d_ring[d_ring_pos], in, first * sizeof(float));
+        memcpy(&d_ring[0], in + first, (ninput - first) * sizeof(float));
+        d_ring_pos = (d_ring_pos + ninput) % d_preroll;
+    }
+
+    publish_state(in_base + ninput, was_open);
+
+    consume_each(ninput);
+    return o;
+}
+
+/* -------------------------------------------------------------------------
+ * Public control methods
+ * Target changes edit d_staged and publish it; state comes from d_state.
+ * ---------------------------------------------------------------------- */
+bool subaudio_squelch_ff_impl::add_target(float tone) {
+    if (tone > 0) {
+        add_ctcss_target(tone);
+        return true;
+    }
+    if (tone < 0) {
+        /* DCS encoded as negative: -(code) normal, -(code+1000) inverted */
+        int raw = (int)(-tone + 0.5f);
+        add_dcs_target(raw % 1000, raw >= 1000);
+        return true;
+    }
+    return false;
+}
+
+void subaudio_squelch_ff_impl::add_ctcss_target(float tone_hz) {
+    if (tone_hz <= 0 || tone_hz >= d_lp_rate / 2) {
+        BOOST_LOG_TRIVIAL(error) << "Sub-audio squelch: ignoring out of range CTCSS tone " << tone_hz;
+        return;
+    }
+    for (size_t t = 0; t < d_staged.ctcss.size(); t++) {
+        if (fabsf(d_staged.ctcss[t].tone - tone_hz) < 0.05f) {
+            return;
+        }
+    }
+
+    /* Nearest standard tones either side, skipping the target itself */
+    float lower = tone_hz - CTCSS_NEIGHBOUR_HZ;
+    float upper = tone_hz + CTCSS_NEIGHBOUR_HZ;
+    for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+        if (CTCSS_TONES[k] < tone_hz - 1.0f) {
+            lower = CTCSS_TONES[k];
+        } else if (CTCSS_TONES[k] > tone_hz + 1.0f) {
+            upper = CTCSS_TONES[k];
+            break;
+        }
+    }
+
+    ctcss_target target;
+    const float freqs[3] = {tone_hz, lower, upper};
+    target.tone = tone_hz;
+    for (int k = 0; k < 3; k++) {
+        target.coeff[k] = 2.0f * cosf(2.0f * (float)M_PI * freqs[k] / d_lp_rate);
+        target.s1[k]    = 0.0f;
+        target.s2[k]    = 0.0f;
+    }
+    d_staged.ctcss.push_back(target);
+    publish_config();
+
+    BOOST_LOG_TRIVIAL(info) << "Sub-audio squelch: CTCSS target " << tone_hz << " Hz"
+                            << "  neighbours " << lower << "/" << upper << " Hz";
+}
+
+void subaudio_squelch_ff_impl::add_dcs_target(int code, bool inverted) {
+    if (code < 0 || code >= 512) {
+        BOOST_LOG_TRIVIAL(error) << "Sub-audio squelch: ignoring out of range DCS code " << code;
+        return;
+    }
+    d_staged.targets[inverted ? 1 : 0][code >> 6] |= (uint64_t)1 << (code & 63);
+    /* The decoder reports one code of those sharing a bitstream, whichever
+     * it found a whole word of first, so any of them opens the squelch    */
+    int aliases[DCS_MAX_ALIASES];
+    int aliases_inverted[DCS_MAX_ALIASES];
+    int naliases = dcs_code_aliases(code, inverted ? 1 : 0, aliases, aliases_inverted, DCS_MAX_ALIASES);
+    for (int i = 0; i < naliases; i++) {
+        d_staged.targets[aliases_inverted[i]][aliases[i] >> 6] |= (uint64_t)1 << (aliases[i] & 63);
+    }
+    d_staged.has_dcs = true;
+    publish_config();
+
+    BOOST_LOG_TRIVIAL(info) << "Sub-audio squelch: DCS target D"
+                            << std::oct << code << std::dec
+                            << (inverted ? "I" : "N");
+}
+
+void subaudio_squelch_ff_impl::clear_targets() {
+    memset(d_staged.targets, 0, sizeof(d_staged.targets));
+    d_staged.has_dcs = false;
+    d_staged.ctcss.clear();
+    d_staged.clear_gen++;
+    publish_config();
+}
+
+bool subaudio_squelch_ff_impl::has_ctcss_targets() const {
+    return !d_staged.ctcss.empty();
+}
+
+bool subaudio_squelch_ff_impl::has_dcs_targets() const {
+    return d_staged.has_dcs;
+}
+
+bool subaudio_squelch_ff_impl::is_open() const {
+    return d_state.open.load(std::memory_order_acquire);
+}
+
+bool subaudio_squelch_ff_impl::gate() const {
+    return d_gate;
+}
+
+float subaudio_squelch_ff_impl::get_matched_tone() const {
+    return d_state.matched_tone.load(std::memory_order_relaxed);
+}
+
+subaudio_squelch_state subaudio_squelch_ff_impl::get_state() const {
+    subaudio_squelch_state state;
+    uint32_t seq;
+    do {
+        seq = d_state.seq.load(std::memory_order_acquire);
+        state.open         = d_state.open.load(std::memory_order_relaxed);
+        state.matched_tone = d_state.matched_tone.load(std::memory_order_relaxed);
+        state.last_open    = (time_t)d_state.last_open.load(std::memory_order_relaxed);
+        state.samples_in   = d_state.samples_in.load(std::memory_order_relaxed);
+        state.samples_open = d_state.samples_open.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1U) || seq != d_state.seq.load(std::memory_order_relaxed));
+    return state;
+}
+
+} /* namespace blocks */
+} /* namespace gr */
@@ -0,0 +1,196 @@
+/* -*- c++ -*- */
+/*
+ * subaudio_squelch_ff_impl.h
+ *   Implementation header for subaudio_squelch_ff.
+ */
+
+#ifndef INCLUDED_SUBAUDIO_SQUELCH_FF_IMPL_H
+#define INCLUDED_SUBAUDIO_SQUELCH_FF_IMPL_H
+
+#include "subaudio_squelch_ff.h"
+#include "decoders/dcs_decode.h"
+#include <boost/log/trivial.hpp>
+#include <pmt/pmt.h>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace gr {
+namespace blocks {
+
+class subaudio_squelch_ff_impl : public subaudio_squelch_ff {
+private:
+    /* The DCS decoder owns the shared low-pass/decimation stage; CTCSS
+     * detection taps its decimated output.                               */
+    dcs_decoder_t *d_dcs_decoder;
+    int   d_decim;              /* input samples per decimated sample */
+    float d_lp_rate;            /* decimated sample rate in Hz */
+
+    /* 512-bit target bitmap per polarity, indexed by the 9-bit DCS code */
+    static const int TARGET_WORDS = 512 / 64;
+
+    /* CTCSS targets.  Each tone is tested against its nearest standard
+     * neighbours, so a tone only counts if it beats both of them.        */
+    struct ctcss_target {
+        float tone;
+        float coeff[3];         /* Goertzel 2cos(w): tone, lower, upper */
+        float s1[3];
+        float s2[3];
+    };
+
+    /* A complete target set.  The control thread edits d_staged and
+     * publishes a copy through d_pending_config; general_work() takes it
+     * at the start of the next buffer.  CTCSS targets are only ever
+     * appended, so indices into ctcss (and match keys) stay valid until a
+     * clear, which bumps clear_gen.                                       */
+    struct target_config {
+        uint64_t targets[2][TARGET_WORDS];
+        bool has_dcs;
+        std::vector<ctcss_target> ctcss;
+        unsigned clear_gen;
+    };
+    target_config d_staged;
+    std::atomic<target_config *> d_pending_config;
+
+    /* The set in use; only touched by the scheduler thread */
+    uint64_t d_targets[2][TARGET_WORDS];
+    bool  d_has_dcs;
+    std::vector<ctcss_target> d_ctcss;
+    unsigned d_clear_gen;
+    int   d_ctcss_window;       /* decimated samples per Goertzel window */
+    int   d_ctcss_count;        /* samples into the current window */
+    int   d_ctcss_window_in;    /* the window in input samples */
+
+    /* Match keys: DCS code + 1000 if inverted, or CTCSS_KEY_BASE + the
+     * index into d_ctcss.                                                */
+    static const int CTCSS_KEY_BASE = 2000;
+    int   d_matched_key;        /* -1 until a target has been seen */
+    pmt::pmt_t d_dcs_key;
+    pmt::pmt_t d_ctcss_key;
+    pmt::pmt_t d_sob_key;
+    pmt::pmt_t d_eob_key;
+    bool  d_gate;               /* drop samples while closed */
+
+    bool  d_squelch_open;
+    int   d_tail_samples_max;   /* tail length in samples */
+
+    /* Pre-roll delay line.  Output lags input by d_preroll samples so the
+     * gate can open at the estimated start of the first codeword, which
+     * the decoder only confirms two frames later.  d_ring holds the last
+     * d_preroll input samples, oldest at d_ring_pos.                      */
+    int   d_preroll;
+    std::vector<float> d_ring;
+    int   d_ring_pos;
+
+    /* Target confirmations seen while decoding the current buffer */
+    struct subaudio_event {
+        uint64_t offset;        /* absolute input sample of the confirmation */
+        int key;
+    };
+    std::vector<subaudio_event> d_events;
+
+    /* Pending open spans, in input-sample time: [start, end) for one key.
+     * Spans never overlap and rarely number more than two, since a new
+     * span only starts after a gap longer than the tail.                  */
+    struct subaudio_span {
+        int64_t start;
+        int64_t end;
+        int key;
+    };
+    static const int MAX_SPANS = 16;
+    subaudio_span d_spans[MAX_SPANS];
+    int   d_nspans;
+
+    /* State published at the end of each buffer.  Single writer (the
+     * scheduler thread) with a sequence count, so readers retry instead
+     * of locking; on its own cache line so polling it doesn't bounce the
+     * line the block's working members sit on.                           */
+    struct alignas(64) shared_state {
+        std::atomic<uint32_t> seq;  /* odd while an update is in progress */
+        std::atomic<bool>     open;
+        std::atomic<float>    matched_tone;
+        std::atomic<int64_t>  last_open;
+        std::atomic<uint64_t> samples_in;
+        std::atomic<uint64_t> samples_open;
+    };
+    shared_state d_state;
+    uint64_t d_samples_open;    /* scheduler thread copies of the above */
+    time_t   d_last_open;
+
+    /* Upstream tags waiting to come out of the delay line */
+    std::vector<tag_t> d_tags;
+    std::vector<tag_t> d_pending_tags;
+
+    /* Called from within dcs_decoder_process_samples when a code matches */
+    static void dcs_callback(int code, int inverted, void *context);
+
+    /* Called from within dcs_decoder_process_samples with decimated audio */
+    static void lowpass_callback(const float *samples, int n,
+                                 unsigned long long first_pos, void *context);
+
+    /* Run the CTCSS Goertzel bank over decimated samples */
+    void detect_ctcss(const float *samples, int n, unsigned long long first_pos);
+
+    /* Hand d_staged to the scheduler thread */
+    void publish_config();
+
+    /* Switch to a published target set, at a buffer boundary */
+    void apply_config(target_config *config);
+
+    /* Update d_state after a buffer */
+    void publish_state(uint64_t samples_in, bool was_open);
+
+    /* Target behind a match key, in the Tone encoding */
+    float key_tone(int key) const;
+
+    /* Turn a confirmation into (or merge it with) an open span */
+    void add_span(const subaudio_event &ev);
+
+    /* Place the tag naming the target behind key at out_offset */
+    void add_match_tag(uint64_t out_offset, int key);
+
+    /* Copy delayed samples [j, j + n) of this call (j counts outputs) */
+    void copy_delayed(float *out, const float *in, int j, int n) const;
+
+    /* Re-emit pending upstream tags for input times [t, t + n) at out_offset */
+    void forward_tags(int64_t t, int n, uint64_t out_offset);
+
+    bool has_target(int code, bool inverted) const {
+        return (code >= 0) && (code < 512) &&
+               ((d_targets[inverted ? 1 : 0][code >> 6] >> (code & 63)) & 1U);
+    }
+
+public:
+#if GNURADIO_VERSION < 0x030900
+    typedef boost::shared_ptr<subaudio_squelch_ff_impl> sptr;
+#else
+    typedef std::shared_ptr<subaudio_squelch_ff_impl> sptr;
+#endif
+
+    static sptr make(int sample_rate, float tail_ms = 250.0f, bool gate = false);
+
+    subaudio_squelch_ff_impl(int sample_rate, float tail_ms, bool gate);
+    ~subaudio_squelch_ff_impl();
+
+    void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+    int general_work(int noutput_items,
+                     gr_vector_int &ninput_items,
+                     gr_vector_const_void_star &input_items,
+                     gr_vector_void_star &output_items);
+
+    bool add_target(float tone);
+    void add_ctcss_target(float tone_hz);
+    void add_dcs_target(int code, bool inverted);
+    void clear_targets();
+    bool has_ctcss_targets() const;
+    bool has_dcs_targets() const;
+    bool is_open() const;
+    bool gate() const;
+    float get_matched_tone() const;
+    subaudio_squelch_state get_state() const;
+};
+
+} /* namespace blocks */
+} /* namespace gr */
+
+#endif /* INCLUDED_SUBAUDIO_SQUELCH_FF_IMPL_H */
@@ -0,0 +1,176 @@
+#include "subband_tiler.h"
+#include "filter_taps.h"
+#include "volk_rotator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <volk/volk.h>
+
+subband_tiler_ccc_sptr make_subband_tiler_ccc(double input_rate, int decimation, double guard, int nthreads) {
+  return gnuradio::get_initial_sptr(new subband_tiler_ccc(input_rate, decimation, guard, nthreads));
+}
+
+subband_tiler_ccc::subband_tiler_ccc(double input_rate, int decimation, double guard, int nthreads)
+    : gr::block("subband_tiler_ccc",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(0, -1, sizeof(gr_complex))),
+      d_input_rate(input_rate),
+      d_decimation(decimation) {
+
+  double tile_rate = input_rate / decimation;
+
+  // Flat out to 3/8 of the tile rate and down 60 dB by 5/8 of it, which
+  // folds back to just past 3/8 when it is decimated, so the middle 3/4 of
+  // each tile is clean
+  Filter_Taps::Complex taps = Filter_Taps::complex_band_pass_2(1.0, input_rate, -0.5 * tile_rate, 0.5 * tile_rate, 0.25 * tile_rate, 60, Filter_Taps::BLACKMAN_HARRIS);
+  d_taps = taps->size();
+  d_reach = std::max(1.0, 0.375 * tile_rate - guard);
+
+  // Enough tiles on the grid for any channel in the input to be within
+  // reach of one
+  long half = ceil((input_rate / 2) / d_reach);
+  d_tiles.resize(2 * half + 1);
+  for (size_t t = 0; t < d_tiles.size(); t++) {
+    Tile &tile = d_tiles[t];
+    tile.center = ((long)t - half) * d_reach;
+
+    // The taps are moved up to the tile's center and its output is turned
+    // back down by the same amount, one decimated sample at a time
+    double phase_inc = 2.0 * M_PI * tile.center / input_rate;
+    tile.taps.resize(d_taps);
+    for (size_t i = 0; i < d_taps; i++) {
+      tile.taps[i] = (*taps)[i] * gr_complex(std::polar(1.0, phase_inc * i));
+    }
+    tile.filter = new gr::filter::kernel::fft_filter_ccc(decimation, tile.taps, nthreads);
+    d_nsamples = tile.filter->set_taps(tile.taps);
+    tile.phase = gr_complex(1.0, 0.0);
+    tile.phase_step = gr_complex(std::polar(1.0, fmod(-phase_inc * decimation, 2.0 * M_PI)));
+    tile.active = false;
+  }
+  d_first_reader.resize(d_tiles.size());
+
+  set_output_multiple(d_nsamples);
+  set_relative_rate(1.0 / decimation);
+}
+
+subband_tiler_ccc::~subband_tiler_ccc() {
+  for (size_t t = 0; t < d_tiles.size(); t++) {
+    delete d_tiles[t].filter;
+  }
+}
+
+int subband_tiler_ccc::add_output() {
+  std::lock_guard<std::mutex> lock(d_outputs_mutex);
+  Output output = {-1, false};
+  d_outputs.push_back(output);
+  return d_outputs.size() - 1;
+}
+
+bool subband_tiler_ccc::fits(int tile, double offset) const {
+  return (tile >= 0) && (fabs(offset - d_tiles[tile].center) <= d_reach);
+}
+
+double subband_tiler_ccc::set_output(int output, double offset) {
+  long half = d_tiles.size() / 2;
+  long nearest = std::max(-half, std::min(half, lround(offset / d_reach)));
+
+  std::lock_guard<std::mutex> lock(d_outputs_mutex);
+  int tile = d_outputs[output].tile;
+
+  // A tile that is being worked out already is the best place for it, then
+  // one another recorder is parked on, then the nearest point on the grid
+  if (!fits(tile, offset)) {
+    int shared = -1;
+    for (int pass = 0; (pass < 2) && (shared < 0); pass++) {
+      for (size_t o = 0; o < d_outputs.size(); o++) {
+        const Output &other = d_outputs[o];
+        if (((int)o == output) || !fits(other.tile, offset) || ((pass == 0) && !other.enabled)) {
+          continue;
+        }
+        if ((shared < 0) || (fabs(offset - d_tiles[other.tile].center) < fabs(offset - d_tiles[shared].center))) {
+          shared = other.tile;
+        }
+      }
+    }
+    tile = (shared >= 0) ? shared : nearest + half;
+  }
+  d_outputs[output].tile = tile;
+  return offset - d_tiles[tile].center;
+}
+
+void subband_tiler_ccc::set_output_enabled(int output, bool enabled) {
+  std::lock_guard<std::mutex> lock(d_outputs_mutex);
+  d_outputs[output].enabled = enabled;
+}
+
+void subband_tiler_ccc::forecast(int noutput_items, gr_vector_int &ninput_items_required) {
+  ninput_items_required[0] = noutput_items * d_decimation;
+}
+
+int subband_tiler_ccc::general_work(int noutput_items,
+                                    gr_vector_int &ninput_items,
+                                    gr_vector_const_void_star &input_items,
+                                    gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+
+  {
+    std::lock_guard<std::mutex> lock(d_outputs_mutex);
+    d_snapshot = d_outputs;
+  }
+  size_t outputs = std::min(d_snapshot.size(), output_items.size());
+
+  // The first enabled output on each tile gets the tile filtered straight
+  // into its buffer, the others on it copy that
+  std::fill(d_first_reader.begin(), d_first_reader.end(), -1);
+  bool any_enabled = false;
+  for (size_t o = 0; o < outputs; o++) {
+    const Output &output = d_snapshot[o];
+    if (output.enabled && (output.tile >= 0)) {
+      any_enabled = true;
+      if (d_first_reader[output.tile] < 0) {
+        d_first_reader[output.tile] = o;
+      }
+    }
+  }
+
+  // With every recorder parked there is nothing to work out
+  if (!any_enabled) {
+    for (size_t t = 0; t < d_tiles.size(); t++) {
+      d_tiles[t].active = false;
+    }
+    consume_each(noutput_items * d_decimation);
+    return 0;
+  }
+
+  for (size_t t = 0; t < d_tiles.size(); t++) {
+    Tile &tile = d_tiles[t];
+    if (d_first_reader[t] < 0) {
+      tile.active = false;
+      continue;
+    }
+    // Setting the taps clears what the filter had left over from the last
+    // time the tile was in use
+    if (!tile.active) {
+      tile.filter->set_taps(tile.taps);
+      tile.active = true;
+    }
+    gr_complex *out = (gr_complex *)output_items[d_first_reader[t]];
+    tile.filter->filter(noutput_items, in, out);
+#ifdef HAVE_VOLK_ROTATOR2
+    volk_32fc_s32fc_x2_rotator2_32fc(out, out, &tile.phase_step, &tile.phase, noutput_items);
+#else
+    volk_32fc_s32fc_x2_rotator_32fc(out, out, tile.phase_step, &tile.phase, noutput_items);
+#endif
+  }
+
+  for (size_t o = 0; o < output_items.size(); o++) {
+    bool reads = (o < outputs) && d_snapshot[o].enabled && (d_snapshot[o].tile >= 0);
+    if (reads && (d_first_reader[d_snapshot[o].tile] != (int)o)) {
+      memcpy(output_items[o], output_items[d_first_reader[d_snapshot[o].tile]], sizeof(gr_complex) * noutput_items);
+    }
+    produce(o, reads ? noutput_items : 0);
+  }
+  consume_each(noutput_items * d_decimation);
+  return WORK_CALLED_PRODUCE;
+}
@@ -0,0 +1,98 @@
+#ifndef INCLUDED_GR_SUBBAND_TILER_H
+#define INCLUDED_GR_SUBBAND_TILER_H
+
+#include <mutex>
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/filter/fft_filter.h>
+#include <gnuradio/io_signature.h>
+
+// Cuts a wideband stream into a few wide sub-bands, or tiles, for a
+// Source's "tile" channelizer. Each recorder reads one tile, at a fraction
+// of the full rate, and its own channelizer only has to take that down to
+// its channel.
+//
+// With the "xlat" channelizer every recorder with a call filters the full
+// sample rate on its own, so a busy site with its voice channels close
+// together does nearly the same work once for each recorder. Here the
+// full rate is only filtered once for each tile in use, and recorders on
+// channels near each other share a tile.
+//
+// The tiles sit on a grid, reach apart, and a recorder's channel is put
+// in the nearest tile with a call on it that it fits in, within reach of
+// the tile's center, or else on the nearest point of the grid. A tile is
+// only worked out while an enabled output reads it, and a recorder keeps
+// its tile when it is retuned if the new channel still fits. An output
+// that is switched off produces nothing. The outputs are retuned and
+// switched under a lock that each work call only holds to copy them.
+
+class subband_tiler_ccc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<subband_tiler_ccc> subband_tiler_ccc_sptr;
+#else
+typedef std::shared_ptr<subband_tiler_ccc> subband_tiler_ccc_sptr;
+#endif
+
+// guard is how far either side of its channel a recorder needs the tile
+// to be clean, for its own filter
+subband_tiler_ccc_sptr make_subband_tiler_ccc(double input_rate, int decimation, double guard, int nthreads = 1);
+
+class subband_tiler_ccc : public gr::block {
+
+  friend subband_tiler_ccc_sptr make_subband_tiler_ccc(double input_rate, int decimation, double guard, int nthreads);
+
+  struct Output {
+    int tile; // -1 until it is tuned
+    bool enabled;
+  };
+
+  struct Tile {
+    double center; // Hz from the center of the input
+    std::vector<gr_complex> taps;
+    gr::filter::kernel::fft_filter_ccc *filter;
+    gr_complex phase;
+    gr_complex phase_step;
+    bool active;
+  };
+
+  double d_input_rate;
+  int d_decimation;
+  double d_reach;
+  int d_nsamples;
+  size_t d_taps;
+  std::vector<Tile> d_tiles; // one for each point of the grid, index - d_tiles.size() / 2 reach from the center
+
+  std::mutex d_outputs_mutex;
+  std::vector<Output> d_outputs;
+  std::vector<Output> d_snapshot; // the block thread's copy
+  std::vector<int> d_first_reader;
+
+  subband_tiler_ccc(double input_rate, int decimation, double guard, int nthreads);
+
+  bool fits(int tile, double offset) const;
+
+public:
+  ~subband_tiler_ccc();
+
+  // The next output, not on any tile until it is tuned
+  int add_output();
+  // offset is where the signal is, in Hz from the center of the input.
+  // Returns how far from the center of its tile it sits.
+  double set_output(int output, double offset);
+  void set_output_enabled(int output, bool enabled);
+
+  double get_tile_rate() const { return d_input_rate / d_decimation; }
+  double get_reach() const { return d_reach; }
+  int get_tile_count() const { return d_tiles.size(); }
+  size_t get_taps() const { return d_taps; }
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required);
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "sync_gate.h"
+
+#include <algorithm>
+#include <bitset>
+#include <string.h>
+
+// The syncs as dibits, first symbol in the top bits, with +3 as 01 and -3
+// as 11, the same for P25 and DMR
+static const uint64_t SYNC_MASK = 0xFFFFFFFFFFFFULL;
+static const uint64_t SYNCS[] = {
+    0x5575F5FF77FFULL, // P25 frame sync
+    0x755FD7DF75F7ULL, // DMR base station voice
+    0xDFF57D75DF5DULL, // DMR base station data
+    0x7F7D5DD57DFDULL, // DMR mobile station voice
+    0xD5D7F77FD757ULL  // DMR mobile station data
+};
+// Bits of the 48 that can be wrong. Noise comes this close to one of them
+// about once every few hours, which only costs a second of decoding.
+static const size_t MAX_SYNC_ERRORS = 4;
+
+sync_gate_cc_sptr make_sync_gate_cc(int samples_per_symbol, double sample_rate, double hangtime, double preroll) {
+  return gnuradio::get_initial_sptr(new sync_gate_cc(samples_per_symbol, sample_rate, hangtime, preroll));
+}
+
+sync_gate_cc::sync_gate_cc(int samples_per_symbol, double sample_rate, double hangtime, double preroll)
+    : gr::block("sync_gate_cc",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_wake(false),
+      d_open(false),
+      d_wakes(0),
+      d_sps(std::max(1, samples_per_symbol)),
+      d_timing(0),
+      d_hang_samples((long)(hangtime * sample_rate)),
+      d_since_sync(0),
+      d_delay(d_sps, gr_complex(1.0, 0.0)),
+      d_symbols(d_sps, 0),
+      d_preroll(std::max(1L, (long)(preroll * sample_rate))),
+      d_preroll_next(0),
+      d_preroll_filled(0),
+      d_pending(0) {
+}
+
+// The phase turned over the last symbol is what the C4FM deviation, or the
+// CQPSK phase change, was: forward for +1 and +3, back for -1 and -3, and
+// past 90 degrees for the outer two. DMR's 4FSK falls the same way.
+bool sync_gate_cc::shift_symbol(gr_complex sample) {
+  gr_complex &last = d_delay[d_timing];
+  gr_complex turn = sample * std::conj(last);
+  last = sample;
+  uint64_t dibit = ((turn.imag() < 0) ? 2 : 0) | ((turn.real() < 0) ? 1 : 0);
+
+  uint64_t &symbols = d_symbols[d_timing];
+  symbols = ((symbols << 2) | dibit) & SYNC_MASK;
+  d_timing = (d_timing + 1) % d_sps;
+
+  for (size_t i = 0; i < sizeof(SYNCS) / sizeof(SYNCS[0]); i++) {
+    if (std::bitset<48>(symbols ^ SYNCS[i]).count() <= MAX_SYNC_ERRORS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int sync_gate_cc::general_work(int noutput_items,
+                               gr_vector_int &ninput_items,
+                               gr_vector_const_void_star &input_items,
+                               gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  gr_complex *out = (gr_complex *)output_items[0];
+  const int ninput = ninput_items[0];
+
+  if (!d_wake.load(std::memory_order_relaxed)) {
+    d_open.store(false, std::memory_order_relaxed);
+    d_preroll_filled = 0;
+    d_pending = 0;
+    const int n = std::min(noutput_items, ninput);
+    memcpy(out, in, n * sizeof(gr_complex));
+    consume_each(n);
+    return n;
+  }
+
+  // The samples from before the sync go out before any new ones
+  if (d_pending > 0) {
+    const size_t size = d_preroll.size();
+    const int n = std::min((size_t)noutput_items, d_pending);
+    size_t from = (d_preroll_next + size - d_pending) % size;
+    for (int i = 0; i < n; i++) {
+      out[i] = d_preroll[from];
+      from = (from + 1) % size;
+    }
+    d_pending -= n;
+    consume_each(0);
+    return n;
+  }
+
+  if (!d_open.load(std::memory_order_relaxed)) {
+    for (int i = 0; i < ninput; i++) {
+      d_preroll[d_preroll_next] = in[i];
+      d_preroll_next = (d_preroll_next + 1) % d_preroll.size();
+      d_preroll_filled = std::min(d_preroll_filled + 1, d_preroll.size());
+      if (shift_symbol(in[i])) {
+        d_open.store(true, std::memory_order_relaxed);
+        d_wakes.fetch_add(1, std::memory_order_relaxed);
+        d_since_sync = 0;
+        d_pending = d_preroll_filled;
+        consume_each(i + 1);
+        return 0;
+      }
+    }
+    consume_each(ninput);
+    return 0;
+  }
+
+  int n = std::min(noutput_items, ninput);
+  for (int i = 0; i < n; i++) {
+    if (shift_symbol(in[i])) {
+      d_since_sync = 0;
+    } else if (++d_since_sync > d_hang_samples) {
+      d_open.store(false, std::memory_order_relaxed);
+      d_preroll_filled = 0;
+      n = i + 1;
+      break;
+    }
+  }
+  memcpy(out, in, n * sizeof(gr_complex));
+  consume_each(n);
+  return n;
+}
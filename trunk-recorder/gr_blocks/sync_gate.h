@@ -0,0 +1,67 @@
+#ifndef INCLUDED_SYNC_GATE_H
+#define INCLUDED_SYNC_GATE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+
+// Holds back a conventional P25 or DMR channel until there is a frame sync
+// on it, so the demod and decoder after it have nothing to do while the
+// channel is idle. The phase turned over each symbol is sliced into a dibit
+// with a sign test, at every sample, and shifted into a register for each
+// of the samples_per_symbol timings. A register within a few bits of the
+// P25 frame sync or one of the DMR voice or data syncs opens the gate. The
+// preroll before it is sent first, so the decoder still gets the sync, and
+// the gate closes again after hangtime without one.
+//
+// It passes everything through until set_wake(true), which is picked up at
+// the start of the next work call.
+
+class sync_gate_cc;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<sync_gate_cc> sync_gate_cc_sptr;
+#else
+typedef std::shared_ptr<sync_gate_cc> sync_gate_cc_sptr;
+#endif
+
+sync_gate_cc_sptr make_sync_gate_cc(int samples_per_symbol, double sample_rate, double hangtime, double preroll);
+
+class sync_gate_cc : public gr::block {
+
+  friend sync_gate_cc_sptr make_sync_gate_cc(int samples_per_symbol, double sample_rate, double hangtime, double preroll);
+
+  std::atomic<bool> d_wake;
+  std::atomic<bool> d_open;
+  std::atomic<long> d_wakes;
+  int d_sps;
+  int d_timing;
+  long d_hang_samples;
+  long d_since_sync;
+  std::vector<gr_complex> d_delay;  // the last symbol's samples
+  std::vector<uint64_t> d_symbols;  // the last 24 dibits, for each timing
+  std::vector<gr_complex> d_preroll;
+  size_t d_preroll_next;
+  size_t d_preroll_filled;
+  size_t d_pending; // preroll still to be sent
+
+  sync_gate_cc(int samples_per_symbol, double sample_rate, double hangtime, double preroll);
+  bool shift_symbol(gr_complex sample);
+
+public:
+  void set_wake(bool wake) { d_wake.store(wake, std::memory_order_relaxed); }
+  bool wake() const { return d_wake.load(std::memory_order_relaxed); }
+  // Passing samples, always when it isn't waiting for a sync
+  bool is_open() const { return !wake() || d_open.load(std::memory_order_relaxed); }
+  long get_wakes() const { return d_wakes.load(std::memory_order_relaxed); }
+
+  int general_work(int noutput_items,
+                   gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items);
+};
+
+#endif
@@ -0,0 +1,26 @@
+/* -*- c++ -*- */
+
+#include "tone_scan_sink.h"
+#include "../tone_scanner.h"
+
+namespace gr {
+namespace blocks {
+
+tone_scan_sink::sptr
+tone_scan_sink::make(int channel) {
+  return gnuradio::get_initial_sptr(new tone_scan_sink(channel));
+}
+
+tone_scan_sink::tone_scan_sink(int channel)
+    : sync_block("tone_scan_sink",
+                 io_signature::make(1, 1, sizeof(float)),
+                 io_signature::make(0, 0, 0)),
+      d_channel(channel) {}
+
+int tone_scan_sink::work(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
+  Tone_Scanner::push_samples(d_channel, (const float *)input_items[0], noutput_items);
+  return noutput_items;
+}
+
+} /* namespace blocks */
+} /* namespace gr */
@@ -0,0 +1,48 @@
+/* -*- c++ -*- */
+/*
+ * tone_scan_sink.h
+ *   Feeds decimated sub-audio from a recorder to the Tone_Scanner.
+ */
+
+#ifndef INCLUDED_TONE_SCAN_SINK_H
+#define INCLUDED_TONE_SCAN_SINK_H
+
+#include <gnuradio/blocks/api.h>
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+namespace gr {
+namespace blocks {
+
+/*!
+ * \brief Hands every input sample to Tone_Scanner::push_samples().
+ *
+ * \details
+ * Input must already be at Tone_Scanner::SAMPLE_RATE.  The block only
+ * copies into the scanner's queue; the analysis runs on the scanner's
+ * own thread so it never stalls the flowgraph.
+ */
+class BLOCKS_API tone_scan_sink : virtual public sync_block {
+private:
+  int d_channel;
+
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<tone_scan_sink> sptr;
+#else
+  typedef std::shared_ptr<tone_scan_sink> sptr;
+#endif
+
+  static sptr make(int channel);
+
+  tone_scan_sink(int channel);
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+} /* namespace blocks */
+} /* namespace gr */
+
+#endif /* INCLUDED_TONE_SCAN_SINK_H */
@@ -23,12 +23,16 @@
 
 #include "transmission_sink.h"
 #include "../../trunk-recorder/call.h"
-#include <boost/filesystem.hpp>
+#include "../../trunk-recorder/recorders/recorder.h"
+#include "../../trunk-recorder/replay_clock.h"
+#include "../../trunk-recorder/source.h"
+#include "../../trunk-recorder/trace.h"
+#include <algorithm>
 #include <boost/math/special_functions/round.hpp>
 #include <climits>
 #include <cmath>
 #include <cstring>
-#include <fcntl.h>
+#include <ctime>
 #include <gnuradio/io_signature.h>
 #include <gnuradio/thread/thread.h>
 #include <sstream>
@@ -36,25 +40,20 @@
 #include <stdio.h>
 #include <chrono>
 
-// win32 (mingw/msvc) specific
-#ifdef HAVE_IO_H
-#include <io.h>
-#endif // ifdef HAVE_IO_H
-#ifdef O_BINARY
-#define OUR_O_BINARY O_BINARY
-#else // ifdef O_BINARY
-#define OUR_O_BINARY 0
-#endif // ifdef O_BINARY
-
-// should be handled via configure
-#ifdef O_LARGEFILE
-#define OUR_O_LARGEFILE O_LARGEFILE
-#else // ifdef O_LARGEFILE
-#define OUR_O_LARGEFILE 0
-#endif // ifdef O_LARGEFILE
-
 namespace gr {
 namespace blocks {
+
+// Interned once, pmt::intern() takes a lock on the global symbol table
+const pmt::pmt_t transmission_sink::src_id_key = pmt::intern("src_id");           // This is the src id from Phase 1, Phase 2 and DMR
+const pmt::pmt_t transmission_sink::grp_id_key = pmt::intern("grp_id");           // This is the talkgroup id from Phase 1, Phase 2 and DMR
+const pmt::pmt_t transmission_sink::cc_key = pmt::intern("cc");                   // This is the channel color code from DMR
+const pmt::pmt_t transmission_sink::terminate_key = pmt::intern("terminate");
+const pmt::pmt_t transmission_sink::spike_count_key = pmt::intern("spike_count");
+const pmt::pmt_t transmission_sink::error_count_key = pmt::intern("error_count");
+const pmt::pmt_t transmission_sink::dcs_code_key = pmt::intern("dcs_code");       // DCS code that opened the squelch, from subaudio_squelch_ff
+const pmt::pmt_t transmission_sink::ctcss_tone_key = pmt::intern("ctcss_tone");   // CTCSS tone that opened the squelch, from subaudio_squelch_ff
+const pmt::pmt_t transmission_sink::squelch_eob_key = pmt::intern("squelch_eob");
+
 transmission_sink::sptr
 transmission_sink::make(int n_channels, unsigned int sample_rate, int bits_per_sample) {
   return gnuradio::get_initial_sptr(new transmission_sink(n_channels, sample_rate, bits_per_sample));
@@ -67,7 +66,14 @@ transmission_sink::transmission_sink(int n_channels, unsigned int sample_rate, i
       d_sample_rate(sample_rate),
       d_nchans(n_channels),
       d_current_call(NULL),
-      d_fp(0) {
+      d_commands(16),
+      d_commands_posted(0),
+      d_commands_done(0),
+      d_expected_state(AVAILABLE),
+      d_state(AVAILABLE),
+      d_stop_command(0),
+      d_buffer(NULL),
+      d_last_command(0) {
 
   if ((bits_per_sample != 8) && (bits_per_sample != 16)) {
     throw std::runtime_error("Invalid bits per sample (supports 8 and 16)");
@@ -76,172 +82,141 @@ transmission_sink::transmission_sink(int n_channels, unsigned int sample_rate, i
   d_sample_count = 0;
   d_slot = -1;
   d_termination_flag = false;
+  d_end_on_squelch_eob = false;
+  d_dropped_samples = 0;
+  d_max_silence_items = 0;
+  d_silence_level = 0;
+  d_quiet_run = 0;
+  d_silence_removed = 0;
+  d_source_num = -1;
+  d_last_file_ms = 0;
+  d_file_sequence = 0;
+  d_stop_time = 0;
+  d_last_write_time = Replay_Clock::steady_now();
   state = AVAILABLE;
 }
 
-void transmission_sink::create_filename() {
-  using std::ostringstream;
-  using std::setw;
-  using std::setfill;
-
-  // <temp>/<short_name>
-  boost::filesystem::path dir =
-      boost::filesystem::path(d_current_call_temp_dir) / d_current_call_short_name;
-
-  boost::system::error_code ec;
-  boost::filesystem::create_directories(dir, ec);
-  if (ec) {
-    BOOST_LOG_TRIVIAL(error) << "create_directories failed for " << dir.string()
-                             << " : " << ec.message();
-  }
-
-  // Seconds.milliseconds from d_start_time_ms
-  const long long start_ms = static_cast<long long>(d_start_time_ms);
-  const long long sec     = start_ms / 1000;
-  const int       milli   = static_cast<int>(start_ms % 1000);
-
-  // Normalize frequency to integer
-  const long long freq_i  = static_cast<long long>(std::llround(d_current_call_freq));
-
-  auto make_stem = [&](int suffix) {
-    ostringstream ts;
-    ts << sec << '.' << setw(3) << setfill('0') << milli;   // e.g. 1718145678.042
-
-    ostringstream oss;
-    oss << d_current_call_talkgroup << "-" << ts.str() << "_" << freq_i;
-    if (d_slot != -1) oss << "." << d_slot;
-    if (suffix > 0)    oss << "-" << suffix;                // collision suffix
-    oss << ".wav";
-    return oss.str();
-  };
-
-  boost::filesystem::path candidate = dir / make_stem(0);
-  for (int i = 1; boost::filesystem::exists(candidate) && i <= 99; ++i) {
-    candidate = dir / make_stem(i);
-  }
-
-  current_filename = candidate.string();
-}
-
-const std::string &transmission_sink::get_filename() {
-  return current_filename;
-}
-
 bool transmission_sink::start_recording(Call *call, int slot) {
-  this->d_slot = slot;
-  this->start_recording(call);
-  return true;
+  Command command;
+  command.has_slot = true;
+  command.slot = slot;
+  return post_start(call, command);
 }
 
 bool transmission_sink::start_recording(Call *call) {
-  gr::thread::scoped_lock guard(d_mutex);
-  if (d_current_call && d_fp) {
-    BOOST_LOG_TRIVIAL(trace) << "Start() - Current_Call & fp are not null! current_filename is: " << current_filename << " Length: " << d_sample_count << std::endl;
-  }
-  d_current_call = call;
-  d_current_call_num = call->get_call_num();
-  d_current_call_freq = call->get_freq();
-  d_conventional = call->is_conventional();
-  if (d_conventional && (call->get_system_type() == "conventionalDMR")) {
+  Command command;
+  command.has_slot = false;
+  command.slot = -1;
+  return post_start(call, command);
+}
+
+bool transmission_sink::post_start(Call *call, Command &command) {
+  command.type = Command::START;
+  command.call = call;
+  command.call_num = call->get_call_num();
+  command.freq = call->get_freq();
+  command.conventional = call->is_conventional();
+  if (command.conventional && (call->get_system_type() == "conventionalDMR")) {
     BOOST_LOG_TRIVIAL(debug) << "transmission_sink::start_recording - Conventional DMR - dynamically assigning talkgroups";
-    d_current_call_talkgroup = 0;
-    d_current_call_talkgroup_display = "N/A";
-    d_current_call_talkgroup_encoded = 0;
+    command.talkgroup = 0;
+    command.talkgroup_display = "N/A";
+    command.talkgroup_encoded = 0;
   } else {
-    d_current_call_talkgroup = call->get_talkgroup();
-    d_current_call_talkgroup_display = call->get_talkgroup_display();
+    command.talkgroup = call->get_talkgroup();
+    command.talkgroup_display = call->get_talkgroup_display();
     if (call->get_system_type() == "smartnet") {
-      d_current_call_talkgroup_encoded = (call->get_talkgroup() >> 4);
+      command.talkgroup_encoded = (call->get_talkgroup() >> 4);
     } else {
-      d_current_call_talkgroup_encoded = call->get_talkgroup();
+      command.talkgroup_encoded = call->get_talkgroup();
     }
   }
-  d_current_call_short_name = call->get_short_name();
-  d_current_call_temp_dir = call->get_temp_dir();
-  d_prior_transmission_length = 0;
-  d_error_count = 0;
-  d_spike_count = 0;
-  d_current_color_code = -1;
-  d_last_write_time = std::chrono::steady_clock::now(); // we want to make sure the call doesn't get cleaned up before data starts coming in.
-
-  this->clear_transmission_list();
-
+  command.short_name = call->get_short_name();
+  command.temp_dir = call->get_temp_dir();
+
+  if (Wav_Writer::get_streaming_encoder() && call->get_system()->get_compress_wav() && (d_bytes_per_sample == 2)) {
+    time_t start_time = call->get_start_time();
+    std::string title = call->get_talkgroup_tag();
+    command.encoder = std::make_shared<Call_Encoder>();
+    command.encoder->filename = command.temp_dir + "/" + command.short_name + "/" + std::to_string(call->get_talkgroup()) + "-" + std::to_string(start_time) + "-call_" + std::to_string(command.call_num) + ".m4a";
+    command.encoder->date = std::ctime(&start_time);
+    command.encoder->short_name = command.short_name;
+    command.encoder->title = (title.empty() || (title == "-")) ? std::to_string(call->get_talkgroup()) : title;
+    command.encoder->sample_rate = d_sample_rate;
+    command.encoder->nchans = d_nchans;
+    command.encoder->pipe = NULL;
+    command.encoder->failed = false;
+  }
+  command.max_silence_items = (long)(call->get_system()->get_max_silence() * d_sample_rate);
+  command.silence_level = call->get_system()->get_silence_level();
+  command.src = call->get_current_source_id();
 
-  curr_src_id = d_current_call->get_current_source_id();
-  d_sample_count = 0;
+  d_last_write_time = Replay_Clock::steady_now(); // we want to make sure the call doesn't get cleaned up before data starts coming in.
 
   // when a wav_sink first gets associated with a call, set its lifecycle to idle;
-  state = IDLE;
-  /* Should reset more variables here */
-  std::string loghdr = log_header(d_current_call_short_name,d_current_call_num,d_current_call_talkgroup_display,d_current_call_freq);
-  BOOST_LOG_TRIVIAL(trace) << loghdr << "Starting wavfile sink SRC ID: " << curr_src_id << " Conventional: " << d_conventional;
-
+  d_expected_state = IDLE;
+  post(std::move(command));
   return true;
 }
 
-bool transmission_sink::open_internal(const char *filename) {
-  // we use the open system call to get access to the O_LARGEFILE flag.
-  //  O_APPEND|
-  int fd;
-
-  if ((fd = ::open(filename,
-                   O_RDWR | O_CREAT | OUR_O_LARGEFILE | OUR_O_BINARY,
-                   0664)) < 0) {
-    perror(filename);
-    BOOST_LOG_TRIVIAL(error) << "wav error opening: " << filename << std::endl;
-    return false;
+void transmission_sink::apply_start(Command &command) {
+  if (d_current_call && d_file) {
+    BOOST_LOG_TRIVIAL(trace) << "Start() - Current_Call & file are not null! Length: " << d_sample_count << std::endl;
   }
-
-  if (d_fp) { // if we've already got a new one open, close it
-    BOOST_LOG_TRIVIAL(trace) << "File pointer already open, closing " << d_fp << " more" << current_filename << " for " << filename << std::endl;
-
-    // fclose(d_fp);
-    // d_fp = NULL;
+  if (command.has_slot) {
+    d_slot = command.slot;
   }
+  d_current_call = command.call;
+  d_current_call_num = command.call_num;
+  d_current_call_freq = command.freq;
+  d_conventional = command.conventional;
+  d_current_call_talkgroup = command.talkgroup;
+  d_current_call_talkgroup_display = command.talkgroup_display;
+  d_current_call_talkgroup_encoded = command.talkgroup_encoded;
+  d_current_call_short_name = command.short_name;
+  d_current_call_temp_dir = command.temp_dir;
+  d_prior_transmission_length = 0;
+  d_error_count = 0;
+  d_spike_count = 0;
+  d_current_color_code = -1;
+  d_current_dcs_code = -1;
+  d_current_ctcss_tone = 0;
 
-  if ((d_fp = fdopen(fd, "rb+")) == NULL) {
-    perror(filename);
-    ::close(fd); // don't leak file descriptor if fdopen fails.
-    BOOST_LOG_TRIVIAL(error) << "wav open failed" << std::endl;
-    return false;
-  }
-  if (std::setvbuf(d_fp, nullptr, _IOFBF, 1000000) != 0) {
-    BOOST_LOG_TRIVIAL(error) << "setvbuf failed"; // POSIX version sets errno
-  }
-  d_sample_count = 0;
+  this->clear_transmission_list();
 
-  if (!wavheader_write(d_fp, d_sample_rate, d_nchans, d_bytes_per_sample)) {
-    fprintf(stderr, "[%s] could not write to WAV file\n", __FILE__);
-    return false;
+  if (d_encoder) {
+    // the last call was never stopped, its m4a is of no use
+    d_last_command = Wav_Writer::finish(d_encoder, false);
   }
+  d_encoder = command.encoder;
+  d_max_silence_items = command.max_silence_items;
+  d_silence_level = command.silence_level;
 
-  if (d_bytes_per_sample == 1) {
-    d_max_sample_val = UCHAR_MAX;
-    d_min_sample_val = 0;
-    d_normalize_fac = d_max_sample_val / 2;
-    d_normalize_shift = 1;
-  } else if (d_bytes_per_sample == 2) {
-    d_max_sample_val = SHRT_MAX;
-    d_min_sample_val = SHRT_MIN;
-    d_normalize_fac = d_max_sample_val;
-    d_normalize_shift = 0;
-  }
+  curr_src_id = command.src;
+  d_sample_count = 0;
 
-  return true;
+  state = IDLE;
+  /* Should reset more variables here */
+  BOOST_LOG_TRIVIAL(trace) << loghdr() << "Starting wavfile sink SRC ID: " << curr_src_id << " Conventional: " << d_conventional;
 }
 
 void transmission_sink::set_source(long src) {
-  std::string loghdr = log_header(d_current_call_short_name,d_current_call_num,d_current_call_talkgroup_display,d_current_call_freq);
+  Command command;
+  command.type = Command::SET_SOURCE;
+  command.call = NULL;
+  command.src = src;
+  post(std::move(command));
+}
+
+void transmission_sink::apply_set_source(long src) {
   if (curr_src_id == -1) {
 
-    BOOST_LOG_TRIVIAL(info) << loghdr << "Unit ID set via Control Channel, ext: " << src << "\tcurrent: " << curr_src_id << "\t samples: " << d_sample_count;
+    BOOST_LOG_TRIVIAL(info) << loghdr() << "Unit ID set via Control Channel, ext: " << src << "\tcurrent: " << curr_src_id << "\t samples: " << d_sample_count;
 
     curr_src_id = src;
   }
   else if (d_conventional && (src != curr_src_id)) {
     if ((state == RECORDING) && (d_sample_count > 0)) {
-        gr::thread::scoped_lock guard(d_mutex);
-        BOOST_LOG_TRIVIAL(error) << loghdr << "Unit ID externally set, ext: " << src << "\tcurrent: " << curr_src_id << "\t samples: " << d_sample_count;
+        BOOST_LOG_TRIVIAL(error) << loghdr() << "Unit ID externally set, ext: " << src << "\tcurrent: " << curr_src_id << "\t samples: " << d_sample_count;
         end_transmission();
         state = IDLE;
         curr_src_id = src;
@@ -250,17 +225,59 @@ void transmission_sink::set_source(long src) {
   }
 }
 
-void transmission_sink::end_transmission() {
-  if (d_sample_count > 0) {
-    if (d_fp) {
-      close_wav(false);
-    } else {
-      BOOST_LOG_TRIVIAL(error) << "Ending transmission, sample_count is greater than 0 but d_fp is null" << std::endl;
+// Queues a command, and carries it out straight away if work() isn't in
+// the middle of a buffer. Main loop only. Returns its place in the order
+// the commands are carried out in.
+uint64_t transmission_sink::post(Command &&command) {
+  while (!d_commands.push(std::move(command))) {
+    // Only if work() has been stuck on one buffer for as long as it took
+    // to post a mailbox full of commands
+    gr::thread::scoped_lock guard(d_mutex);
+    drain_commands();
+  }
+  uint64_t seq = ++d_commands_posted;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  gr::thread::scoped_lock guard(d_mutex, boost::try_to_lock);
+  if (guard.owns_lock()) {
+    drain_commands();
+  }
+  return seq;
+}
+
+// With d_mutex held
+void transmission_sink::drain_commands() {
+  Command command;
+  while (d_commands.pop(command)) {
+    switch (command.type) {
+    case Command::START:
+      apply_start(command);
+      break;
+    case Command::STOP:
+      apply_stop();
+      break;
+    case Command::SET_SOURCE:
+      apply_set_source(command.src);
+      break;
     }
+    command = Command();
+    d_state.store(state, std::memory_order_relaxed);
+    d_commands_done.fetch_add(1, std::memory_order_release);
+  }
+}
+
+// Used when an upstream squelch drops samples rather than zeroing them, so
+// the end of a transmission is only visible as a squelch_eob tag.
+void transmission_sink::set_end_on_squelch_eob(bool end_on_eob) {
+  d_end_on_squelch_eob = end_on_eob;
+}
 
+void transmission_sink::end_transmission() {
+  if (d_sample_count > 0) {
+    // It was on the air for the silence that was cut out as well
     const std::int64_t dur_ms = (d_nchans > 0)
         ? (std::int64_t)std::llround(1000.0 *
-           (double)d_sample_count / ((double)d_sample_rate * (double)d_nchans))
+           ((double)d_sample_count / ((double)d_sample_rate * (double)d_nchans) + (double)d_silence_removed / (double)d_sample_rate))
         : 0;
 
     // Assign canonical stop time from sample count
@@ -279,19 +296,30 @@ void transmission_sink::end_transmission() {
     transmission.error_count = d_error_count;
     transmission.slot = d_slot;
     transmission.color_code = d_current_color_code;
+    transmission.dcs_code = d_current_dcs_code;
+    transmission.ctcss_tone = d_current_ctcss_tone;
     transmission.length = length_in_seconds(); // length in seconds
+    transmission.silence_removed = (double)d_silence_removed / (double)d_sample_rate;
+    transmission.silence_list.swap(d_silence_list);
     d_prior_transmission_length = d_prior_transmission_length + transmission.length;
-    transmission.filename = current_filename;
     transmission.talkgroup = d_current_call_talkgroup;
 
-    BOOST_LOG_TRIVIAL(debug) << "Adding transmission: " << transmission.filename << " Slot: " << transmission.slot << " Talkgroup: " << transmission.talkgroup << " Length: " << transmission.length << " Samples: " << d_sample_count;
-    this->add_transmission(transmission);
+    // The filename is filled in, and the transmission added, by the
+    // Wav_Writer once the file is closed
+    if (d_file) {
+      close_wav(&transmission);
+    } else {
+      BOOST_LOG_TRIVIAL(error) << "Ending transmission, sample_count is greater than 0 but there is no file" << std::endl;
+    }
 
     // Reset the recorder to be ready to record the next Transmission
     state = IDLE;
     d_sample_count = 0;
     d_error_count = 0;
     d_spike_count = 0;
+    d_quiet_run = 0;
+    d_silence_removed = 0;
+    d_silence_list.clear();
     curr_src_id = -1;
     d_current_color_code = -1;
 
@@ -302,8 +330,25 @@ void transmission_sink::end_transmission() {
 }
 
 void transmission_sink::stop_recording() {
-  gr::thread::scoped_lock guard(d_mutex);
+  Command command;
+  command.type = Command::STOP;
+  command.call = NULL;
+  d_expected_state = AVAILABLE;
+  uint64_t seq = post(std::move(command));
+
+  if (d_commands_done.load(std::memory_order_acquire) < seq) {
+    // work() is part way through a buffer and carries the stop out at the
+    // end of it, which is as long as this waits for the lock
+    gr::thread::scoped_lock guard(d_mutex);
+    drain_commands();
+  }
 
+  // The call is concluded from the transmission list once this returns, so
+  // wait for the files to be closed, without holding up work() meanwhile
+  Wav_Writer::wait(d_stop_command.load(std::memory_order_acquire));
+}
+
+void transmission_sink::apply_stop() {
   if (state == RECORDING) {
     BOOST_LOG_TRIVIAL(trace) << "stop_recording() - stopping wavfile sink but recorder state is: " << state << " Sample Count is: " << d_sample_count << std::endl;
   }
@@ -311,17 +356,121 @@ void transmission_sink::stop_recording() {
   if (d_sample_count > 0) {
     end_transmission();
   }
+  if (d_file) {
+    close_wav(NULL);
+  }
+  if (d_encoder) {
+    if (d_current_call) {
+      d_current_call->set_encoded_filename(d_encoder->filename);
+    }
+    d_last_command = Wav_Writer::finish(d_encoder, d_current_call != NULL);
+    d_encoder.reset();
+  }
 
   d_current_call = NULL;
   d_termination_flag = false;
   state = AVAILABLE;
+  d_stop_command.store(d_last_command, std::memory_order_release);
+}
+
+void transmission_sink::flush_buffer() {
+  if (d_buffer) {
+    d_last_command = Wav_Writer::write(d_file, d_buffer);
+    d_buffer = NULL;
+  }
+}
+
+void transmission_sink::close_wav(const Transmission *transmission) {
+  flush_buffer();
+  if (Trace::enabled() && d_file) {
+    Trace::complete("transmission", d_trace_begin, std::chrono::steady_clock::now(), d_file->call_num, TRACE_FLOW_STEP);
+  }
+  d_last_command = Wav_Writer::close(d_file, transmission, [this](const Transmission &t) {
+    BOOST_LOG_TRIVIAL(debug) << "Adding transmission: " << t.filename << " Slot: " << t.slot << " Talkgroup: " << t.talkgroup << " Length: " << t.length << " Samples: " << t.sample_count;
+    this->add_transmission(t);
+  });
+  d_file.reset();
+}
+
+// A run of silence longer than the System's maxSilence is cut down to
+// it: what is past that is dropped here, before it is converted, and noted
+// in d_silence_list. Returns how many items were kept.
+int transmission_sink::queue_samples(const int16_t *const *in, int n_in_chans, int nitems) {
+  if (d_max_silence_items <= 0) {
+    return convert_samples(in, n_in_chans, 0, nitems);
+  }
+
+  int kept = 0;
+  int from = 0;
+  for (int i = 0; i < nitems; i++) {
+    bool quiet = true;
+    for (int c = 0; quiet && (c < n_in_chans); c++) {
+      quiet = (std::abs((int)in[c][i]) <= d_silence_level);
+    }
+    if (!quiet) {
+      d_quiet_run = 0;
+      continue;
+    }
+    if (++d_quiet_run <= d_max_silence_items) {
+      continue;
+    }
+    if (from < i) {
+      kept += convert_samples(in, n_in_chans, from, i - from);
+    }
+    from = i + 1;
+    if (d_quiet_run == d_max_silence_items + 1) {
+      Silence_Span span = {length_in_seconds(), 0};
+      d_silence_list.push_back(span);
+    }
+    d_silence_list.back().length += 1.0 / d_sample_rate;
+    d_silence_removed++;
+  }
+  if (from < nitems) {
+    kept += convert_samples(in, n_in_chans, from, nitems - from);
+  }
+  return kept;
 }
 
-void transmission_sink::close_wav(bool close_call) {
-  unsigned int byte_count = d_sample_count * d_bytes_per_sample;
-  wavheader_complete(d_fp, byte_count);
-  fclose(d_fp);
-  d_fp = NULL;
+// Converts nitems samples, from first on, into pool buffers, handing each
+// to the Wav_Writer as it fills. If the pool has run dry the rest are
+// dropped. Returns how many items were kept.
+int transmission_sink::convert_samples(const int16_t *const *in, int n_in_chans, int first, int nitems) {
+  size_t frame_bytes = d_nchans * d_bytes_per_sample;
+  int done = 0;
+
+  while (done < nitems) {
+    if (!d_buffer) {
+      d_buffer = Wav_Writer::get_buffer();
+      if (!d_buffer) {
+        break;
+      }
+    }
+    int room = (int)((Wav_Writer::BUFFER_SIZE - d_buffer->used) / frame_bytes);
+    int count = std::min(room, nitems - done);
+    wav_convert_samples(d_buffer->data + d_buffer->used, in, first + done, n_in_chans, d_nchans, count, d_bytes_per_sample);
+    d_buffer->used += count * frame_bytes;
+    done += count;
+    d_sample_count += count * d_nchans;
+    if (d_buffer->used + frame_bytes > Wav_Writer::BUFFER_SIZE) {
+      flush_buffer();
+    }
+  }
+
+  if (done < nitems) {
+    long dropped = (long)(nitems - done) * d_nchans;
+    if (d_dropped_samples == 0) {
+      BOOST_LOG_TRIVIAL(error) << loghdr() << "Wav Writer is behind, dropping samples";
+    }
+    d_dropped_samples += dropped;
+    Wav_Writer::count_dropped(d_source_num, dropped);
+  }
+  return done;
+}
+
+// Only built when a log statement is going to be written, BOOST_LOG_TRIVIAL
+// skips the whole stream expression for severities that are filtered out
+std::string transmission_sink::loghdr() const {
+  return log_header(d_current_call_short_name, d_current_call_num, d_current_call_talkgroup_display, d_current_call_freq);
 }
 
 transmission_sink::~transmission_sink() {
@@ -332,26 +481,233 @@ bool transmission_sink::stop() {
   return true;
 }
 
+// Main loop only
 State transmission_sink::get_state() {
-  return this->state;
+  if (d_commands_done.load(std::memory_order_acquire) < d_commands_posted.load(std::memory_order_relaxed)) {
+    return d_expected_state;
+  }
+  return d_state.load(std::memory_order_relaxed);
+}
+
+// Maps the interned key of a tag to what it is. Symbols are unique, so a
+// key is matched by its pointer: the table is indexed by a few bits of the
+// pointer, with the shift picked at startup so the known keys don't collide.
+transmission_sink::Tag_Table transmission_sink::make_tag_table() {
+  const pmt::pmt_t keys[] = {src_id_key, grp_id_key, cc_key, terminate_key, spike_count_key, error_count_key, dcs_code_key, ctcss_tone_key, squelch_eob_key};
+  const Tag_Type types[] = {TAG_SRC_ID, TAG_GRP_ID, TAG_CC, TAG_TERMINATE, TAG_SPIKE_COUNT, TAG_ERROR_COUNT, TAG_DCS_CODE, TAG_CTCSS_TONE, TAG_SQUELCH_EOB};
+  const size_t num_keys = sizeof(keys) / sizeof(keys[0]);
+
+  Tag_Table table;
+  for (table.shift = 0; table.shift < sizeof(uintptr_t) * 8 - TAG_TABLE_BITS; table.shift++) {
+    table.keys.fill(NULL);
+    table.types.fill(TAG_UNKNOWN);
+
+    bool collision = false;
+    for (size_t i = 0; (i < num_keys) && !collision; i++) {
+      size_t slot = table.slot(keys[i].get());
+      collision = (table.keys[slot] != NULL);
+      table.keys[slot] = keys[i].get();
+      table.types[slot] = types[i];
+    }
+    if (!collision) {
+      return table;
+    }
+  }
+
+  // No shift worked, fall back to comparing against every key
+  table.shift = -1;
+  for (size_t i = 0; i < num_keys; i++) {
+    table.keys[i] = keys[i].get();
+    table.types[i] = types[i];
+  }
+  return table;
+}
+
+const transmission_sink::Tag_Table transmission_sink::tag_table = transmission_sink::make_tag_table();
+
+transmission_sink::Tag_Type transmission_sink::tag_type(const pmt::pmt_t &key) {
+  const pmt::pmt_base *ptr = key.get();
+  if (tag_table.shift >= 0) {
+    size_t slot = tag_table.slot(ptr);
+    return (tag_table.keys[slot] == ptr) ? tag_table.types[slot] : TAG_UNKNOWN;
+  }
+  for (size_t i = 0; i < tag_table.keys.size(); i++) {
+    if (tag_table.keys[i] == ptr) {
+      return tag_table.types[i];
+    }
+  }
+  return TAG_UNKNOWN;
+}
+
+void transmission_sink::handle_grp_id(const gr::tag_t &tag, int noutput_items) {
+  long grp_id = pmt::to_long(tag.value);
+
+  if ((state == RECORDING) || (state == IDLE)) {
+    if (d_current_call_talkgroup_encoded != grp_id) {
+      if (!d_conventional) {
+        BOOST_LOG_TRIVIAL(info) << loghdr() << "GROUP MISMATCH -  Recorder TG: " << d_current_call_talkgroup_encoded << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
+        if (d_sample_count > 0) {
+          BOOST_LOG_TRIVIAL(info) << loghdr() << "Ending Transmission and IGNORING Rest - count: " << d_sample_count;
+          end_transmission();
+        }
+        state = IGNORE;
+      } else {
+        if (d_current_call_talkgroup != grp_id) {
+          if (d_current_call_talkgroup != 0) {
+            BOOST_LOG_TRIVIAL(debug) << loghdr() << "Conventional Call - TALKGROUP MISMATCH - Talkgroup already set - Recorder TG: " << d_current_call_talkgroup << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
+            // this is where we would conclude the current call and start a new one.
+          }
+          BOOST_LOG_TRIVIAL(debug) << loghdr() << "Conventional Call - TALKGROUP set via Control Channel - Recorder TG: " << d_current_call_talkgroup << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
+          // Retain the OTA talkgroup for conventional systems, only apply it for DMR
+          d_current_call_talkgroup_encoded = grp_id;
+          if (d_current_call->get_system_type() == "conventionalDMR") {
+            d_current_call_talkgroup = grp_id;
+            d_current_call_talkgroup_display = std::to_string(grp_id);
+          }
+        }
+      }
+    }
+  }
+}
+
+void transmission_sink::handle_color_code(const gr::tag_t &tag) {
+  long cc = pmt::to_long(tag.value);
+
+  if ((state == RECORDING) || (state == IDLE)) {
+    if (cc != d_current_color_code) {
+      if (d_current_call->get_system_type() == "conventionalDMR") {
+        d_current_color_code = cc;
+        BOOST_LOG_TRIVIAL(info) << loghdr() << "DMR Color Code set to: " << d_current_color_code << " Recorder state: " << format_state(state);
+      } 
+    }
+  }
+}
+
+void transmission_sink::handle_dcs_code(const gr::tag_t &tag) {
+  long dcs_code = pmt::to_long(tag.value);
+
+  if (d_conventional && ((dcs_code != d_current_dcs_code) || (d_current_ctcss_tone != 0))) {
+    // A different code on a shared DCS channel is a different talkgroup
+    if ((state == RECORDING) && (d_sample_count > 0)) {
+      BOOST_LOG_TRIVIAL(debug) << loghdr() << "Conventional Call - DCS code changed from: " << d_current_dcs_code << " to: " << dcs_code << " - ending transmission";
+      end_transmission();
+      state = IDLE;
+    }
+    d_current_dcs_code = dcs_code;
+    d_current_ctcss_tone = 0;
+
+    Talkgroup *tg = d_current_call->get_system()->find_talkgroup_by_dcs(d_current_call_freq, dcs_code % 1000, dcs_code >= 1000);
+    if (tg) {
+      d_current_call_talkgroup = tg->number;
+      d_current_call_talkgroup_encoded = tg->number;
+      d_current_call_talkgroup_display = std::to_string(tg->number);
+    }
+  }
+}
+
+void transmission_sink::handle_ctcss_tone(const gr::tag_t &tag) {
+  double ctcss_tone = pmt::to_double(tag.value);
+
+  if (d_conventional && ((std::fabs(ctcss_tone - d_current_ctcss_tone) > 0.05) || (d_current_dcs_code != -1))) {
+    // Likewise a different tone, on a channel shared by several CTCSS and DCS talkgroups
+    if ((state == RECORDING) && (d_sample_count > 0)) {
+      BOOST_LOG_TRIVIAL(debug) << loghdr() << "Conventional Call - CTCSS tone changed from: " << d_current_ctcss_tone << " to: " << ctcss_tone << " - ending transmission";
+      end_transmission();
+      state = IDLE;
+    }
+    d_current_ctcss_tone = ctcss_tone;
+    d_current_dcs_code = -1;
+
+    Talkgroup *tg = d_current_call->get_system()->find_talkgroup_by_ctcss(d_current_call_freq, ctcss_tone);
+    if (tg) {
+      d_current_call_talkgroup = tg->number;
+      d_current_call_talkgroup_encoded = tg->number;
+      d_current_call_talkgroup_display = std::to_string(tg->number);
+    }
+  }
+}
+
+void transmission_sink::handle_src_id(const gr::tag_t &tag, unsigned &pos) {
+  long src_id = pmt::to_long(tag.value);
+  pos = d_sample_count + (tag.offset - nitems_read(0));
+
+  if (curr_src_id == -1) {
+    // BOOST_LOG_TRIVIAL(info) << "Updated Voice Channel source id: " << src_id << " pos: " << pos << " offset: " << tag.offset - nitems_read(0);
+
+    curr_src_id = src_id;
+  } else if (src_id != curr_src_id) {
+    if (state == RECORDING) {
+
+      // BOOST_LOG_TRIVIAL(info) << "ENDING TRANSMISSION from TAGS Voice Channel mismatch source id - current: "<< curr_src_id << " new: " << src_id << " pos: " << pos << " offset: " << tag.offset - nitems_read(0);
+      /*
+          if (d_conventional && (d_sample_count > 0)) {
+              end_transmission();
+              state = IDLE;
+          }
+        state = STOPPED;
+        if (!record_more_transmissions) {
+          state = STOPPED;
+        } else {
+          state = IDLE;
+        }*/
+
+      curr_src_id = src_id;
+    }
+    // BOOST_LOG_TRIVIAL(info) << "Updated Voice Channel source id: " << src_id << " pos: " << pos << " offset: " << tag.offset - nitems_read(0);
+  }
+}
+
+// Applies the last spike and error counts seen, before anything that could
+// end the transmission and once all of the tags in the buffer are handled
+void transmission_sink::apply_frame_stats(const gr::tag_t *&spike_count_tag, const gr::tag_t *&error_count_tag, unsigned pos) {
+  if (spike_count_tag) {
+    d_spike_count = pmt::to_long(spike_count_tag->value);
+    BOOST_LOG_TRIVIAL(trace) << loghdr() << "Spike Count: " << d_spike_count << " pos: " << pos << " offset: " << spike_count_tag->offset;
+    spike_count_tag = NULL;
+  }
+  if (error_count_tag) {
+    d_error_count = pmt::to_long(error_count_tag->value);
+    BOOST_LOG_TRIVIAL(trace) << loghdr() << "Error Count: " << d_error_count << " pos: " << pos << " offset: " << error_count_tag->offset;
+    error_count_tag = NULL;
+  }
 }
 
 int transmission_sink::work(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
+  int nwritten;
+  {
+    gr::thread::scoped_lock guard(d_mutex); // hold mutex for duration of the buffer
+    drain_commands();
+    nwritten = handle_buffer(noutput_items, input_items, output_items);
+    d_state.store(state, std::memory_order_relaxed);
+    drain_commands();
+  }
+
+  // A command posted after the last drain, while the lock was still held,
+  // would otherwise sit in the mailbox until the next buffer
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (d_commands_done.load(std::memory_order_acquire) < d_commands_posted.load(std::memory_order_relaxed)) {
+    gr::thread::scoped_lock guard(d_mutex, boost::try_to_lock);
+    if (!guard.owns_lock()) {
+      break;
+    }
+    drain_commands();
+  }
+  return nwritten;
+}
 
-  gr::thread::scoped_lock guard(d_mutex); // hold mutex for duration of this function
-  std::string loghdr = log_header(d_current_call_short_name,d_current_call_num,d_current_call_talkgroup_display,d_current_call_freq);
-  
+int transmission_sink::handle_buffer(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
   // it is possible that we could get part of a transmission after a call has stopped. We shouldn't do any recording if this happens.... this could mean that we miss part of the recording though
   if (!d_current_call) {
-    time_t now = time(NULL);
+    time_t now = Replay_Clock::now();
     double its_been = difftime(now, d_stop_time);
 
     // It is possible the P25 Frame Assembler passes a TDU after the call has timed out.
     // In this case, the termination tag will be transferred on a blank sample and can safely be ignored.
     if (noutput_items == 1) {
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "Dropping " << noutput_items << " samples - current_call is null\t Rec State: " << format_state(this->state) << "\tSince close: " << its_been;
+      BOOST_LOG_TRIVIAL(trace) << loghdr() << "Dropping " << noutput_items << " samples - current_call is null\t Rec State: " << format_state(this->state) << "\tSince close: " << its_been;
     } else {
-      BOOST_LOG_TRIVIAL(error) << loghdr << "Dropping " << noutput_items << " samples - current_call is null\t Rec State: " << format_state(this->state) << "\tSince close: " << its_been;
+      BOOST_LOG_TRIVIAL(error) << loghdr() << "Dropping " << noutput_items << " samples - current_call is null\t Rec State: " << format_state(this->state) << "\tSince close: " << its_been;
+      Wav_Writer::count_orphaned(d_source_num, noutput_items);
     }
 
     return noutput_items;
@@ -361,7 +717,8 @@ int transmission_sink::work(int noutput_items, gr_vector_const_void_star &input_
   if ((state == STOPPED) || (state == AVAILABLE)) {
     if (noutput_items > 1) {
 
-      BOOST_LOG_TRIVIAL(error) << loghdr << "Dropping " << noutput_items << " samples - Recorder state is: " << format_state(this->state);
+      BOOST_LOG_TRIVIAL(error) << loghdr() << "Dropping " << noutput_items << " samples - Recorder state is: " << format_state(this->state);
+      Wav_Writer::count_orphaned(d_source_num, noutput_items);
 
       // BOOST_LOG_TRIVIAL(info) << "WAV - state is: " << format_state(this->state) << "\t Dropping samples: " << noutput_items << " Since close: " << its_been << std::endl;
     }
@@ -369,116 +726,76 @@ int transmission_sink::work(int noutput_items, gr_vector_const_void_star &input_
   }
 
   std::vector<gr::tag_t> tags;
-  pmt::pmt_t src_id_key(pmt::intern("src_id")); // This is the src id from Phase 1, Phase 2 and DMR
-  pmt::pmt_t grp_id_key(pmt::intern("grp_id")); // This is the talkgroup id from Phase 1, Phase 2 and DMR
-  pmt::pmt_t cc_key(pmt::intern("cc"));         // This is the channel color code from DMR
-  pmt::pmt_t terminate_key(pmt::intern("terminate"));
-  pmt::pmt_t spike_count_key(pmt::intern("spike_count"));
-  pmt::pmt_t error_count_key(pmt::intern("error_count"));
-
-  // pmt::pmt_t squelch_key(pmt::intern("squelch_eob"));
   // get_tags_in_range(tags, 0, nitems_read(0), nitems_read(0) + noutput_items);
   get_tags_in_window(tags, 0, 0, noutput_items);
   unsigned pos = 0;
   // long curr_src_id = 0;
 
+  // Spike and error counts are running totals for the transmission, sent
+  // with every frame, so only the last of each in the buffer is applied
+  const gr::tag_t *spike_count_tag = NULL;
+  const gr::tag_t *error_count_tag = NULL;
+
   for (unsigned int i = 0; i < tags.size(); i++) {
     // BOOST_LOG_TRIVIAL(info) << "TAG! " << tags[i].key;
-    if (pmt::eq(grp_id_key, tags[i].key)) {
-      long grp_id = pmt::to_long(tags[i].value);
-
-      if ((state == RECORDING) || (state == IDLE)) {
-        if (d_current_call_talkgroup_encoded != grp_id) {
-          if (!d_conventional) {
-            BOOST_LOG_TRIVIAL(info) << loghdr << "GROUP MISMATCH -  Recorder TG: " << d_current_call_talkgroup_encoded << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
-            if (d_sample_count > 0) {
-              BOOST_LOG_TRIVIAL(info) << loghdr << "Ending Transmission and IGNORING Rest - count: " << d_sample_count;
-              end_transmission();
-            }
-            state = IGNORE;
-          } else {
-            if (d_current_call_talkgroup != grp_id) {
-              if (d_current_call_talkgroup != 0) {
-                BOOST_LOG_TRIVIAL(debug) << loghdr << "Conventional Call - TALKGROUP MISMATCH - Talkgroup already set - Recorder TG: " << d_current_call_talkgroup << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
-                // this is where we would conclude the current call and start a new one.
-              }
-              BOOST_LOG_TRIVIAL(debug) << loghdr << "Conventional Call - TALKGROUP set via Control Channel - Recorder TG: " << d_current_call_talkgroup << " Received TG: " << grp_id << " Recorder state: " << format_state(state) << " incoming: " << noutput_items;
-              // Retain the OTA talkgroup for conventional systems, only apply it for DMR
-              d_current_call_talkgroup_encoded = grp_id;
-              if (d_current_call->get_system_type() == "conventionalDMR") {
-                d_current_call_talkgroup = grp_id;
-                d_current_call_talkgroup_display = std::to_string(grp_id);
-              }
-            }
-          }
-        }
+    switch (tag_type(tags[i].key)) {
+    case TAG_GRP_ID:
+      apply_frame_stats(spike_count_tag, error_count_tag, pos);
+      handle_grp_id(tags[i], noutput_items);
+      break;
+
+    case TAG_CC:
+      handle_color_code(tags[i]);
+      break;
+
+    case TAG_DCS_CODE:
+      apply_frame_stats(spike_count_tag, error_count_tag, pos);
+      handle_dcs_code(tags[i]);
+      break;
+
+    case TAG_CTCSS_TONE:
+      apply_frame_stats(spike_count_tag, error_count_tag, pos);
+      handle_ctcss_tone(tags[i]);
+      break;
+
+    case TAG_SRC_ID:
+      handle_src_id(tags[i], pos);
+      break;
+
+    case TAG_SQUELCH_EOB:
+      // Handled like a terminator: write what has arrived, then end the transmission
+      if (d_end_on_squelch_eob && d_conventional && (state == RECORDING)) {
+        d_termination_flag = true;
       }
-    }
-    if (pmt::eq(cc_key, tags[i].key)) {
-      long cc = pmt::to_long(tags[i].value);
+      break;
 
-      if ((state == RECORDING) || (state == IDLE)) {
-        if (cc != d_current_color_code) {
-          if (d_current_call->get_system_type() == "conventionalDMR") {
-            d_current_color_code = cc;
-            BOOST_LOG_TRIVIAL(info) << loghdr << "DMR Color Code set to: " << d_current_color_code << " Recorder state: " << format_state(state);
-          } 
-        }
-      }
-    }
-    if (pmt::eq(src_id_key, tags[i].key)) {
-      long src_id = pmt::to_long(tags[i].value);
-      pos = d_sample_count + (tags[i].offset - nitems_read(0));
-
-      if (curr_src_id == -1) {
-        // BOOST_LOG_TRIVIAL(info) << "Updated Voice Channel source id: " << src_id << " pos: " << pos << " offset: " << tags[i].offset - nitems_read(0);
-
-        curr_src_id = src_id;
-      } else if (src_id != curr_src_id) {
-        if (state == RECORDING) {
-
-          // BOOST_LOG_TRIVIAL(info) << "ENDING TRANSMISSION from TAGS Voice Channel mismatch source id - current: "<< curr_src_id << " new: " << src_id << " pos: " << pos << " offset: " << tags[i].offset - nitems_read(0);
-          /*
-              if (d_conventional && (d_sample_count > 0)) {
-                  end_transmission();
-                  state = IDLE;
-              }
-            state = STOPPED;
-            if (!record_more_transmissions) {
-              state = STOPPED;
-            } else {
-              state = IDLE;
-            }*/
-
-          curr_src_id = src_id;
-        }
-        // BOOST_LOG_TRIVIAL(info) << "Updated Voice Channel source id: " << src_id << " pos: " << pos << " offset: " << tags[i].offset - nitems_read(0);
-      }
-    }
-
-    if (pmt::eq(terminate_key, tags[i].key)) {
+    case TAG_TERMINATE:
       d_termination_flag = true;
       pos = d_sample_count + (tags[i].offset - nitems_read(0));
 
       // BOOST_LOG_TRIVIAL(info) << "[" << d_current_call_short_name << "]\t\033[0;34m" << d_current_call_num << "C\033[0m\tTG: " << d_current_call_talkgroup_display << "\tFreq: " << format_freq(d_current_call_freq) << "\tTermination - rec sample count " << d_sample_count << " pos: " << pos << " offset: " << tags[i].offset;
 
       // BOOST_LOG_TRIVIAL(info) << "TERMINATOR!!";
-    }
+      break;
 
     // Only process Spike and Error Count tags if the sink is currently recording
-    if (state == RECORDING) {
-      if (pmt::eq(spike_count_key, tags[i].key)) {
-        d_spike_count = pmt::to_long(tags[i].value);
-
-        BOOST_LOG_TRIVIAL(trace) << loghdr << "Spike Count: " << d_spike_count << " pos: " << pos << " offset: " << tags[i].offset;
+    case TAG_SPIKE_COUNT:
+      if (state == RECORDING) {
+        spike_count_tag = &tags[i];
       }
-      if (pmt::eq(error_count_key, tags[i].key)) {
-        d_error_count = pmt::to_long(tags[i].value);
+      break;
 
-        BOOST_LOG_TRIVIAL(trace) << loghdr << "Error Count: " << d_error_count << " pos: " << pos << " offset: " << tags[i].offset;
+    case TAG_ERROR_COUNT:
+      if (state == RECORDING) {
+        error_count_tag = &tags[i];
       }
+      break;
+
+    default:
+      break;
     }
   }
+  apply_frame_stats(spike_count_tag, error_count_tag, pos);
   tags.clear();
 
   // if the System for this call is in Transmission Mode, and we have a recording and we got a flag that a Transmission ended...
@@ -496,29 +813,30 @@ time_t transmission_sink::get_stop_time() {
 }
 
 std::chrono::time_point<std::chrono::steady_clock> transmission_sink::get_last_write_time() {
-  return d_last_write_time;
+  return d_last_write_time.load(std::memory_order_relaxed);
 }
 
 void transmission_sink::add_transmission(Transmission t) {
+  gr::thread::scoped_lock guard(d_transmission_mutex);
   transmission_list.push_back(t);
 }
 
 void transmission_sink::clear_transmission_list() {
+  gr::thread::scoped_lock guard(d_transmission_mutex);
   transmission_list.clear();
   transmission_list.shrink_to_fit();
 }
 
 std::vector<Transmission> transmission_sink::get_transmission_list() {
+  gr::thread::scoped_lock guard(d_transmission_mutex);
   return transmission_list;
 }
 
 int transmission_sink::dowork(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items) {
   // block
   int n_in_chans = input_items.size();
-  int16_t sample_buf_s;
   int nwritten = 0;
   bool terminate_after_write = false;
-  std::string loghdr = log_header(d_current_call_short_name,d_current_call_num,d_current_call_talkgroup_display,d_current_call_freq);
 
   if (state == STOPPED) {
     return noutput_items;
@@ -536,7 +854,7 @@ int transmission_sink::dowork(int noutput_items, gr_vector_const_void_star &inpu
     }
 
     if (state == IGNORE) {
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "Resetting state from IGNORE to IDLE: " << noutput_items;
+      BOOST_LOG_TRIVIAL(trace) << loghdr() << "Resetting state from IGNORE to IDLE: " << noutput_items;
       state = IDLE;
 
       return noutput_items;
@@ -544,88 +862,100 @@ int transmission_sink::dowork(int noutput_items, gr_vector_const_void_star &inpu
 
     // The TDU can come in with voice samples. Write the voice samples and then end the transmission.
     if (d_sample_count > 0 && noutput_items > 1) {
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "Terminator received with items. Ending transmission after writing. Sample Count: " << d_sample_count << " Noutput Items: " << noutput_items;
+      BOOST_LOG_TRIVIAL(trace) << loghdr() << "Terminator received with items. Ending transmission after writing. Sample Count: " << d_sample_count << " Noutput Items: " << noutput_items;
       terminate_after_write = true;
       // Handle the case of a terminator coming in without voice samples. End the transmission immediately.
     } else if (d_sample_count > 0) {
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "Terminator received without items. Ending transmission immediately. " << d_sample_count << " Noutput Items: " << noutput_items;
+      BOOST_LOG_TRIVIAL(trace) << loghdr() << "Terminator received without items. Ending transmission immediately. " << d_sample_count << " Noutput Items: " << noutput_items;
       end_transmission();
       return noutput_items;
     } else {
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "TERM - skipped....   - count: " << d_sample_count;
+      BOOST_LOG_TRIVIAL(trace) << loghdr() << "TERM - skipped....   - count: " << d_sample_count;
       return noutput_items;
     }
   }
 
   if (state == IGNORE) {
-    BOOST_LOG_TRIVIAL(trace) << loghdr << "IGNORE missing count: " << noutput_items;
+    BOOST_LOG_TRIVIAL(trace) << loghdr() << "IGNORE missing count: " << noutput_items;
     return noutput_items;
   }
 
   if (state == IDLE) {
-    // BOOST_LOG_TRIVIAL(info) << loghdr << "IDLE but haven't seen Group ID yet, missing count: " << noutput_items;
+    // BOOST_LOG_TRIVIAL(info) << loghdr() << "IDLE but haven't seen Group ID yet, missing count: " << noutput_items;
     // return noutput_items;
-    if (d_fp) {
+    if (d_file) {
       // if we are already recording a file for this call, close it before starting a new one.
-      BOOST_LOG_TRIVIAL(info) << "WAV - Weird! we have an existing FP, but STATE was IDLE:  " << current_filename << std::endl;
+      BOOST_LOG_TRIVIAL(info) << "WAV - Weird! we have an existing file, but STATE was IDLE" << std::endl;
 
-      close_wav(false);
+      close_wav(NULL);
     }
 
-    auto now_sys = std::chrono::system_clock::now();
-    d_start_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-      now_sys.time_since_epoch()).count();
+    if (d_current_call) {
+      d_current_call->mark_latency(LATENCY_FIRST_FRAME);
+      // the recorder is set on the call once it has started, so by the first samples
+      Recorder *recorder = d_current_call->get_recorder();
+      if (recorder && recorder->get_source()) {
+        d_source_num = recorder->get_source()->get_num();
+      }
+    }
+
+    d_start_time_ms = Replay_Clock::now_ms();
     d_start_time = static_cast<time_t>(d_start_time_ms / 1000);
 
-    // create a new filename, based on the current time and source.
-    create_filename();
-    if (!open_internal(current_filename.c_str())) {
-      BOOST_LOG_TRIVIAL(error) << "can't open file";
-      return noutput_items;
+    // the Wav_Writer names the file from the current time and source and
+    // makes it off of this thread
+    d_file = std::make_shared<Wav_File>();
+    d_file->call = d_current_call;
+    d_file->call_num = d_current_call ? d_current_call->get_call_num() : 0;
+    d_file->source_num = d_source_num;
+    d_file->temp_dir = d_current_call_temp_dir;
+    d_file->short_name = d_current_call_short_name;
+    d_file->talkgroup = d_current_call_talkgroup;
+    d_file->start_time_ms = d_start_time_ms;
+    d_file->freq = d_current_call_freq;
+    d_file->slot = d_slot;
+    d_file->sample_rate = d_sample_rate;
+    d_file->nchans = d_nchans;
+    d_file->bytes_per_sample = d_bytes_per_sample;
+    d_file_sequence = (d_start_time_ms == d_last_file_ms) ? d_file_sequence + 1 : 0;
+    d_last_file_ms = d_start_time_ms;
+    d_file->sequence = d_file_sequence;
+    d_file->encoder = d_encoder;
+    d_last_command = Wav_Writer::open(d_file);
+    if (Trace::enabled()) {
+      d_trace_begin = std::chrono::steady_clock::now();
     }
+    d_sample_count = 0;
+    d_dropped_samples = 0;
+    d_quiet_run = 0;
+    d_silence_removed = 0;
+    d_silence_list.clear();
 
-    BOOST_LOG_TRIVIAL(trace) << loghdr << "Starting new Transmission \tSrc ID:  " << curr_src_id;
+    BOOST_LOG_TRIVIAL(trace) << loghdr() << "Starting new Transmission \tSrc ID:  " << curr_src_id;
 
     // curr_src_id = d_current_call->get_current_source_id();
     state = RECORDING;
   }
 
-  if (!d_fp) // drop output on the floor
+  if (!d_file) // drop output on the floor
   {
-    BOOST_LOG_TRIVIAL(error) << "Wav - Dropping items, no fp or Current Call: " << noutput_items << " Filename: " << current_filename << " Current sample count: " << d_sample_count << std::endl;
+    BOOST_LOG_TRIVIAL(error) << "Wav - Dropping items, no file or Current Call: " << noutput_items << " Current sample count: " << d_sample_count << std::endl;
     return noutput_items;
   }
 
   if (state == RECORDING) {
-    for (nwritten = 0; nwritten < noutput_items; nwritten++) {
-      for (int chan = 0; chan < d_nchans; chan++) {
-        // Write zeros to channels which are in the WAV file
-        // but don't have any inputs here
-        if (chan < n_in_chans) {
-          int16_t **in = (int16_t **)&input_items[0];
-          sample_buf_s = in[chan][nwritten];
-        } else {
-          sample_buf_s = 0;
-        }
-
-        wav_write_sample(d_fp, sample_buf_s, d_bytes_per_sample);
-
-        d_sample_count++;
-      }
-    }
+    // Channels which are in the WAV file but don't have any inputs here
+    // are written as zeros
+    nwritten = queue_samples((const int16_t *const *)&input_items[0], n_in_chans, noutput_items);
 
     if (terminate_after_write) {
       end_transmission();
     }
   }
 
-  d_last_write_time = std::chrono::steady_clock::now();
+  d_last_write_time = Replay_Clock::steady_now();
 
-  if (nwritten < noutput_items) {
-    BOOST_LOG_TRIVIAL(error) << loghdr << "Failed to Write! Wrote: " << nwritten << " of " << noutput_items;
-  } else {
-    BOOST_LOG_TRIVIAL(trace) << loghdr << "Wrote: " << nwritten << " of " << noutput_items;
-  }
+  BOOST_LOG_TRIVIAL(trace) << loghdr() << "Wrote: " << nwritten << " of " << noutput_items;
   return noutput_items;
 }
 
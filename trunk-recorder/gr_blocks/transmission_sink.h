@@ -23,15 +23,19 @@
 #ifndef INCLUDED_TRANSMISSION_SINK_H
 #define INCLUDED_TRANSMISSION_SINK_H
 
+#include "wav_writer.h"
 #include "wavfile_gr3.8.h"
 #include <sys/time.h>
 
 #include "../../trunk-recorder/formatter.h"
 #include "../../trunk-recorder/global_structs.h"
+#include "../../trunk-recorder/mpsc_ring.h"
 
 #include <boost/log/trivial.hpp>
 #include <gnuradio/blocks/api.h>
 #include <gnuradio/sync_block.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 
 class Call;
@@ -39,28 +43,38 @@ struct Transmission;
 namespace gr {
 namespace blocks {
 
+// The main loop starts, stops and sets the source of a transmission_sink
+// by posting a command to its mailbox rather than taking d_mutex, which
+// work() holds while it handles a buffer. Whichever thread next holds
+// d_mutex carries the commands out: the poster itself, if it can take the
+// lock straight away, or else work() at the end of the buffer it is on.
+// get_state() and get_last_write_time() read atomic copies, and until the
+// commands have been carried out get_state() gives the state the last one
+// will leave the sink in, so a recorder that has just been started never
+// looks available. stop_recording() is the one that waits, for at most the
+// rest of the buffer work() is on, because the call is concluded from the
+// transmission list as soon as it returns.
 class BLOCKS_API transmission_sink : virtual public sync_block {
 private:
   unsigned d_sample_rate;
   int d_nchans;
-  int d_max_sample_val;
   int d_slot;
-  int d_min_sample_val;
-  int d_normalize_shift;
-  int d_normalize_fac;
   bool d_conventional;
   bool d_first_work;
   bool d_termination_flag;
+  bool d_end_on_squelch_eob;
   time_t d_start_time;
-  time_t d_stop_time;
+  std::atomic<time_t> d_stop_time;
   std::int64_t d_start_time_ms;
   std::int64_t d_stop_time_ms;
-  std::chrono::time_point<std::chrono::steady_clock> d_last_write_time;
+  std::chrono::steady_clock::time_point d_trace_begin; // for the transmission's Trace span
+  std::atomic<std::chrono::time_point<std::chrono::steady_clock>> d_last_write_time;
   long d_spike_count;
   long d_error_count;
   long curr_src_id;
   unsigned int d_current_color_code;
-  std::string current_filename;
+  long d_current_dcs_code;
+  double d_current_ctcss_tone;
   Call *d_current_call;
   long d_current_call_num;
   std::string d_current_call_short_name;
@@ -70,12 +84,109 @@ private:
   long d_current_call_talkgroup;
   long d_current_call_talkgroup_encoded;
   std::string d_current_call_talkgroup_display;
+  long d_max_silence_items; // 0 if silence isn't trimmed
+  int d_silence_level;
+  long d_quiet_run;         // items in a row no louder than d_silence_level
+  long d_silence_removed;   // items cut out of this transmission
+  std::vector<Silence_Span> d_silence_list;
+
+  static const pmt::pmt_t src_id_key;
+  static const pmt::pmt_t grp_id_key;
+  static const pmt::pmt_t cc_key;
+  static const pmt::pmt_t terminate_key;
+  static const pmt::pmt_t spike_count_key;
+  static const pmt::pmt_t error_count_key;
+  static const pmt::pmt_t dcs_code_key;
+  static const pmt::pmt_t ctcss_tone_key;
+  static const pmt::pmt_t squelch_eob_key;
+
+  std::string loghdr() const;
+
+  enum Tag_Type { TAG_UNKNOWN,
+                  TAG_SRC_ID,
+                  TAG_GRP_ID,
+                  TAG_CC,
+                  TAG_TERMINATE,
+                  TAG_SPIKE_COUNT,
+                  TAG_ERROR_COUNT,
+                  TAG_DCS_CODE,
+                  TAG_CTCSS_TONE,
+                  TAG_SQUELCH_EOB };
+
+  static const int TAG_TABLE_BITS = 5;
+
+  struct Tag_Table {
+    int shift; // -1 if no shift avoided collisions and keys are searched instead
+    std::array<const pmt::pmt_base *, 1 << TAG_TABLE_BITS> keys;
+    std::array<Tag_Type, 1 << TAG_TABLE_BITS> types;
+
+    size_t slot(const pmt::pmt_base *key) const {
+      return ((uintptr_t)key >> shift) & ((1 << TAG_TABLE_BITS) - 1);
+    }
+  };
+
+  static const Tag_Table tag_table;
+  static Tag_Table make_tag_table();
+  static Tag_Type tag_type(const pmt::pmt_t &key);
+
+  struct Command {
+    enum Type { START,
+                STOP,
+                SET_SOURCE } type;
+    // START, with what is needed from the Call read on the main loop
+    Call *call;
+    bool has_slot;
+    int slot;
+    long call_num;
+    double freq;
+    bool conventional;
+    long talkgroup;
+    long talkgroup_encoded;
+    std::string talkgroup_display;
+    std::string short_name;
+    std::string temp_dir;
+    std::shared_ptr<Call_Encoder> encoder;
+    long max_silence_items;
+    int silence_level;
+    // START and SET_SOURCE
+    long src;
+  };
+
+  MPSC_Ring<Command> d_commands;
+  std::atomic<uint64_t> d_commands_posted;
+  std::atomic<uint64_t> d_commands_done;
+  State d_expected_state;               // main loop only, what the last command posted leaves the sink in
+  std::atomic<State> d_state;           // state, as of the last command or buffer
+  std::atomic<uint64_t> d_stop_command; // the last Wav_Writer command of the last stop
+
+  bool post_start(Call *call, Command &command);
+  uint64_t post(Command &&command);
+  void drain_commands();
+  void apply_start(Command &command);
+  void apply_stop();
+  void apply_set_source(long src);
+
+  int handle_buffer(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items);
+  void handle_grp_id(const gr::tag_t &tag, int noutput_items);
+  void handle_color_code(const gr::tag_t &tag);
+  void handle_dcs_code(const gr::tag_t &tag);
+  void handle_ctcss_tone(const gr::tag_t &tag);
+  void handle_src_id(const gr::tag_t &tag, unsigned &pos);
+  void apply_frame_stats(const gr::tag_t *&spike_count_tag, const gr::tag_t *&error_count_tag, unsigned pos);
 
 protected:
   unsigned d_sample_count;
   int d_bytes_per_sample;
-  FILE *d_fp;
-  boost::mutex d_mutex;
+  std::shared_ptr<Wav_File> d_file;  // the transmission being recorded, written by the Wav_Writer
+  std::shared_ptr<Call_Encoder> d_encoder; // compresses the call as it is recorded, if the streaming encoder is on
+  Wav_Writer::Buffer *d_buffer;      // samples not yet handed to the Wav_Writer
+  uint64_t d_last_command;           // the last Wav_Writer command queued
+  long d_dropped_samples;
+  int d_source_num;                  // of the last call's recorder, for the Wav_Writer's stats
+  std::int64_t d_last_file_ms;       // start of the last transmission, and how many before it
+  int d_file_sequence;               // started in the same millisecond, to keep filenames unique
+  boost::mutex d_mutex;              // held by work() and whoever is carrying out the commands
+  boost::mutex d_transmission_mutex; // transmission_list, added to by the Wav_Writer
   virtual int dowork(int noutput_items, gr_vector_const_void_star &input_items, gr_vector_void_star &output_items);
 
   /*!
@@ -86,16 +197,19 @@ protected:
   void do_update();
 
   /*!
-   * \brief Writes information to the WAV header which is not available
-   * a-priori (chunk size etc.) and closes the file. Not thread-safe and
-   * assumes d_fp is a valid file pointer, should thus only be called by
-   * other methods.
+   * \brief Hands the buffered samples to the Wav_Writer and has it close
+   * the file. The Wav_Writer adds \p transmission, if there is one, to
+   * the transmission list once the file is complete. Not thread-safe and
+   * assumes d_file is set, should thus only be called by other methods.
    */
-  void close_wav(bool close_call);
+  void close_wav(const Transmission *transmission);
+
+  int queue_samples(const int16_t *const *in, int n_in_chans, int nitems);
+  int convert_samples(const int16_t *const *in, int n_in_chans, int first, int nitems);
+  void flush_buffer();
 
 protected:
   bool stop();
-  bool open_internal(const char *filename);
 
   std::vector<Transmission> transmission_list;
   State state;
@@ -121,13 +235,12 @@ public:
                     unsigned int sample_rate,
                     int bits_per_sample);
   virtual ~transmission_sink();
-  void create_filename();
-  const std::string &get_filename();
   bool start_recording(Call *call);
   bool start_recording(Call *call, int slot);
   void stop_recording();
   void end_transmission();
   void set_source(long src);
+  void set_end_on_squelch_eob(bool end_on_eob);
   void set_sample_rate(unsigned int sample_rate);
   void set_bits_per_sample(int bits_per_sample);
   void clear_transmission_list();
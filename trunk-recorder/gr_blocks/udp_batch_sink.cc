@@ -0,0 +1,252 @@
+#include "udp_batch_sink.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <volk/volk.h>
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define HAVE_UDP_ZEROCOPY 1
+#endif
+
+udp_batch_sink_sptr make_udp_batch_sink(const std::string &address, int port, int payload_size, bool ci16, bool seq_num, bool zerocopy) {
+  return gnuradio::get_initial_sptr(new udp_batch_sink(address, port, payload_size, ci16, seq_num, zerocopy));
+}
+
+udp_batch_sink::udp_batch_sink(const std::string &address, int port, int payload_size, bool ci16, bool seq_num, bool zerocopy)
+    : gr::sync_block("udp_batch_sink",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(0, 0, 0)),
+      d_fd(-1),
+      d_addr_len(0),
+      d_ci16(ci16),
+      d_seq_num(seq_num),
+      d_zerocopy(false),
+      d_header_size(seq_num ? sizeof(uint64_t) : 0),
+      d_sample_size(ci16 ? 2 * sizeof(int16_t) : sizeof(gr_complex)),
+      d_sequence(0),
+      d_batch(0),
+      d_packets(0),
+      d_filled(0),
+      d_zerocopy_sent(0),
+      d_zerocopy_done(0),
+      d_zerocopy_batch_end(ZEROCOPY_BATCHES, 0),
+      d_dropped_packets(0) {
+  // As in gr::network, the payload size takes in the header. Whole samples only.
+  d_payload_size = std::max((size_t)std::max(payload_size - (int)d_header_size, 0) / d_sample_size, (size_t)1) * d_sample_size;
+
+  struct addrinfo hints;
+  struct addrinfo *result = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  std::string port_string = std::to_string(port);
+  int rc = getaddrinfo(address.c_str(), port_string.c_str(), &hints, &result);
+  if ((rc != 0) || !result) {
+    BOOST_LOG_TRIVIAL(error) << "UDP Batch Sink: can't resolve " << address << ": " << gai_strerror(rc);
+  } else {
+    d_fd = socket(result->ai_family, SOCK_DGRAM, 0);
+    memcpy(&d_addr, result->ai_addr, result->ai_addrlen);
+    d_addr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+  }
+  if (d_fd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "UDP Batch Sink: can't open a socket for " << address << ":" << port;
+  }
+
+#ifdef HAVE_UDP_ZEROCOPY
+  if (zerocopy && (d_fd >= 0)) {
+    int one = 1;
+    if (setsockopt(d_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+      d_zerocopy = true;
+    } else {
+      BOOST_LOG_TRIVIAL(error) << "UDP Batch Sink: SO_ZEROCOPY is not supported, the packets will be copied: " << strerror(errno);
+    }
+  }
+#else
+  if (zerocopy) {
+    BOOST_LOG_TRIVIAL(error) << "UDP Batch Sink: zero copy sends are Linux only, the packets will be copied";
+  }
+#endif
+
+  const int batches = d_zerocopy ? ZEROCOPY_BATCHES : 1;
+  d_pool.assign((size_t)batches * BATCH_PACKETS * (d_header_size + d_payload_size), 0);
+  d_iovecs.resize(batches * BATCH_PACKETS);
+  d_msgs.resize(BATCH_PACKETS);
+  for (int i = 0; i < batches * BATCH_PACKETS; i++) {
+    d_iovecs[i].iov_base = packet(i / BATCH_PACKETS, i % BATCH_PACKETS);
+    d_iovecs[i].iov_len = d_header_size + d_payload_size;
+  }
+  start_packet();
+}
+
+udp_batch_sink::~udp_batch_sink() {
+  if (d_fd >= 0) {
+    close(d_fd);
+  }
+}
+
+unsigned char *udp_batch_sink::packet(int batch, int index) {
+  return &d_pool[((size_t)batch * BATCH_PACKETS + index) * (d_header_size + d_payload_size)];
+}
+
+void udp_batch_sink::start_packet() {
+  if (d_seq_num) {
+    memcpy(packet(d_batch, d_packets), &d_sequence, sizeof(d_sequence));
+  }
+  d_sequence++;
+  d_filled = 0;
+}
+
+// The kernel tells us in order which zero copy sends it is done with
+void udp_batch_sink::reap_zerocopy(int timeout_ms) {
+#ifdef HAVE_UDP_ZEROCOPY
+  if (timeout_ms > 0) {
+    struct pollfd pfd;
+    pfd.fd = d_fd;
+    pfd.events = 0; // only POLLERR, for the error queue
+    pfd.revents = 0;
+    poll(&pfd, 1, timeout_ms);
+  }
+  while (true) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(d_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      return;
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      struct sock_extended_err *err = (struct sock_extended_err *)CMSG_DATA(cm);
+      if (err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+        // ee_info to ee_data are the sends that are done
+        if ((int32_t)(err->ee_data + 1 - d_zerocopy_done) > 0) {
+          d_zerocopy_done = err->ee_data + 1;
+        }
+      }
+    }
+  }
+#endif
+}
+
+void udp_batch_sink::flush() {
+  if (!d_packets) {
+    return;
+  }
+
+  const int first = d_batch * BATCH_PACKETS;
+  for (int i = 0; i < d_packets; i++) {
+#ifdef __linux__
+    struct msghdr &msg = d_msgs[i].msg_hdr;
+    d_msgs[i].msg_len = 0;
+#else
+    struct msghdr &msg = d_msgs[i];
+#endif
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &d_addr;
+    msg.msg_namelen = d_addr_len;
+    msg.msg_iov = &d_iovecs[first + i];
+    msg.msg_iovlen = 1;
+  }
+
+  if (d_fd >= 0) {
+#ifdef __linux__
+    int flags = 0;
+#ifdef HAVE_UDP_ZEROCOPY
+    if (d_zerocopy) {
+      flags = MSG_ZEROCOPY;
+    }
+#endif
+    int sent = 0;
+    while (sent < d_packets) {
+      int rc = sendmmsg(d_fd, &d_msgs[sent], d_packets - sent, flags);
+      if (rc < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if ((errno == ENOBUFS) && flags) {
+          // Out of memory for pinning pages, copy this batch instead
+          flags = 0;
+          continue;
+        }
+        d_dropped_packets += d_packets - sent;
+        break;
+      }
+      if (flags) {
+        d_zerocopy_sent += rc;
+      }
+      sent += rc;
+    }
+#else
+    for (int i = 0; i < d_packets; i++) {
+      if (sendmsg(d_fd, &d_msgs[i], 0) < 0) {
+        d_dropped_packets++;
+      }
+    }
+#endif
+  } else {
+    d_dropped_packets += d_packets;
+  }
+
+  if (d_zerocopy) {
+    // This batch can't be filled again until the kernel is done sending it
+    d_zerocopy_batch_end[d_batch] = d_zerocopy_sent;
+    d_batch = (d_batch + 1) % ZEROCOPY_BATCHES;
+    reap_zerocopy(0);
+    for (int wait = 0; (wait < 10) && ((int32_t)(d_zerocopy_batch_end[d_batch] - d_zerocopy_done) > 0); wait++) {
+      reap_zerocopy(1);
+    }
+    // If it still isn't, the packets still in flight may go out with the
+    // newer samples in them, which is better than holding up the flowgraph
+  }
+}
+
+int udp_batch_sink::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  const size_t samples_per_packet = d_payload_size / d_sample_size;
+  int done = 0;
+
+  while (done < noutput_items) {
+    const size_t count = std::min((size_t)(noutput_items - done), samples_per_packet - d_filled / d_sample_size);
+    unsigned char *out = packet(d_batch, d_packets) + d_header_size + d_filled;
+    if (d_ci16) {
+      volk_32f_s32f_convert_16i((int16_t *)out, (const float *)(in + done), 32767.0f, 2 * count);
+    } else {
+      memcpy(out, in + done, count * sizeof(gr_complex));
+    }
+    d_filled += count * d_sample_size;
+    done += count;
+
+    if (d_filled == d_payload_size) {
+      d_packets++;
+      if (d_packets == BATCH_PACKETS) {
+        flush();
+        d_packets = 0;
+      }
+      start_packet();
+    }
+  }
+
+  // A packet that isn't full yet waits for the next call, and is moved to
+  // the front of the batch so it goes out in order
+  if (d_packets) {
+    const int partial = d_packets;
+    const int batch = d_batch;
+    flush();
+    memmove(packet(d_batch, 0), packet(batch, partial), d_header_size + d_filled);
+    d_packets = 0;
+  }
+  return noutput_items;
+}
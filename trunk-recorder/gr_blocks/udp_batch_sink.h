@@ -0,0 +1,94 @@
+#ifndef INCLUDED_UDP_BATCH_SINK_H
+#define INCLUDED_UDP_BATCH_SINK_H
+
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+// Sends complex samples over UDP in packets of a fixed payload size, the
+// way gr::network::udp_sink does, but with each work call's packets handed
+// to the kernel in one sendmmsg() instead of a send() each. The packets are
+// built in place in a pool allocated up front.
+//
+// The payload can be cf32, as the samples come in, or ci16 at half the
+// size. With seq_num on, each packet starts with the 64 bit sequence number
+// of gr::network's HEADERTYPE_SEQNUM, so a network_udp_source with that
+// header type can tell when packets were lost.
+//
+// With zerocopy on, the packets are sent with MSG_ZEROCOPY and the kernel
+// sends them straight from the pool. A batch of the pool is only filled
+// again once the kernel says it is done with it. That only pays for itself
+// with big payloads, like jumbo frames, and on Linux 4.14 or later; where it
+// isn't available the packets are copied as usual.
+
+class udp_batch_sink;
+
+#if GNURADIO_VERSION < 0x030900
+typedef boost::shared_ptr<udp_batch_sink> udp_batch_sink_sptr;
+#else
+typedef std::shared_ptr<udp_batch_sink> udp_batch_sink_sptr;
+#endif
+
+udp_batch_sink_sptr make_udp_batch_sink(const std::string &address, int port, int payload_size, bool ci16, bool seq_num, bool zerocopy);
+
+class udp_batch_sink : public gr::sync_block {
+
+  friend udp_batch_sink_sptr make_udp_batch_sink(const std::string &address, int port, int payload_size, bool ci16, bool seq_num, bool zerocopy);
+
+  udp_batch_sink(const std::string &address, int port, int payload_size, bool ci16, bool seq_num, bool zerocopy);
+
+  static const int BATCH_PACKETS = 64;
+  static const int ZEROCOPY_BATCHES = 4;
+
+  int d_fd;
+  struct sockaddr_storage d_addr;
+  socklen_t d_addr_len;
+
+  bool d_ci16;
+  bool d_seq_num;
+  bool d_zerocopy;
+  size_t d_header_size;
+  size_t d_payload_size; // bytes of samples in a packet
+  size_t d_sample_size;
+  uint64_t d_sequence;
+
+  // The pool is ZEROCOPY_BATCHES batches of BATCH_PACKETS packets, only the
+  // first batch is used without zerocopy
+  std::vector<unsigned char> d_pool;
+  std::vector<struct iovec> d_iovecs;
+#ifdef __linux__
+  std::vector<struct mmsghdr> d_msgs;
+#else
+  std::vector<struct msghdr> d_msgs;
+#endif
+  int d_batch;      // the batch being filled
+  int d_packets;    // full packets in it
+  size_t d_filled;  // bytes of samples in the packet after them
+
+  uint32_t d_zerocopy_sent;                  // sends the kernel will tell us about
+  uint32_t d_zerocopy_done;                  // sends it has told us it is done with
+  std::vector<uint32_t> d_zerocopy_batch_end; // the send count each batch is done at
+
+  long d_dropped_packets;
+
+  unsigned char *packet(int batch, int index);
+  void start_packet();
+  void flush();
+  void reap_zerocopy(int timeout_ms);
+
+public:
+  ~udp_batch_sink();
+
+  long get_dropped_packets() { return d_dropped_packets; }
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif // INCLUDED_UDP_BATCH_SINK_H
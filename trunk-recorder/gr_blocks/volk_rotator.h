@@ -0,0 +1,14 @@
+#ifndef VOLK_ROTATOR_H
+#define VOLK_ROTATOR_H
+
+#include <volk/volk.h>
+#include <volk/volk_version.h>
+
+// volk_32fc_s32fc_x2_rotator2_32fc takes the phase step by pointer, which
+// the older rotator kernel takes by value. It first shipped in VOLK 3.1.0;
+// the blocks that rotate with VOLK use the older kernel before that.
+#if defined(VOLK_VERSION) && VOLK_VERSION >= 030100
+#define HAVE_VOLK_ROTATOR2 1
+#endif
+
+#endif
@@ -0,0 +1,764 @@
+#include "wav_writer.h"
+#include "../../trunk-recorder/call.h"
+#include "../../trunk-recorder/call_latency.h"
+#include "../../trunk-recorder/trace.h"
+#include "wavfile_gr3.8.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef O_BINARY
+#define OUR_O_BINARY O_BINARY
+#else // ifdef O_BINARY
+#define OUR_O_BINARY 0
+#endif // ifdef O_BINARY
+
+#ifdef O_LARGEFILE
+#define OUR_O_LARGEFILE O_LARGEFILE
+#else // ifdef O_LARGEFILE
+#define OUR_O_LARGEFILE 0
+#endif // ifdef O_LARGEFILE
+
+std::mutex Wav_Writer::queue_mutex;
+std::condition_variable Wav_Writer::not_empty;
+std::condition_variable Wav_Writer::done;
+std::deque<Wav_Writer::Command> Wav_Writer::queue;
+bool Wav_Writer::running = false;
+std::thread Wav_Writer::worker;
+uint64_t Wav_Writer::queued_seq = 0;
+uint64_t Wav_Writer::done_seq = 0;
+size_t Wav_Writer::max_depth = 0;
+
+std::mutex Wav_Writer::pool_mutex;
+std::vector<Wav_Writer::Buffer *> Wav_Writer::free_buffers;
+size_t Wav_Writer::allocated_buffers = 0;
+long Wav_Writer::dropped_samples = 0;
+
+std::mutex Wav_Writer::dirs_mutex;
+std::set<std::string> Wav_Writer::made_dirs;
+
+std::map<size_t, std::vector<char *>> Wav_Writer::free_file_buffers;
+size_t Wav_Writer::file_buffer_bytes = 0;
+size_t Wav_Writer::held_buffers = 0;
+size_t Wav_Writer::file_buffer_count = 0;
+
+std::mutex Wav_Writer::stats_mutex;
+std::map<int, Wav_Writer::Source_Stats> Wav_Writer::source_stats;
+
+double Wav_Writer::buffer_seconds = 10;
+bool Wav_Writer::memory_transmissions = false;
+double Wav_Writer::spill_seconds = 30;
+bool Wav_Writer::streaming_encoder = false;
+bool Wav_Writer::mmap_files = false;
+
+// Call these before start()
+void Wav_Writer::set_buffer_seconds(double seconds) {
+  buffer_seconds = std::max(0.0, seconds);
+}
+
+void Wav_Writer::set_memory_transmissions(bool enabled, double seconds) {
+  memory_transmissions = enabled;
+  spill_seconds = std::max(0.0, seconds);
+}
+
+void Wav_Writer::set_streaming_encoder(bool enabled) {
+  streaming_encoder = enabled;
+}
+
+void Wav_Writer::set_mmap_files(bool enabled) {
+#ifdef __linux__
+  mmap_files = enabled;
+#else
+  if (enabled) {
+    BOOST_LOG_TRIVIAL(error) << "Memory mapped wav files need Linux, writing them through stdio";
+  }
+#endif
+}
+
+bool Wav_Writer::get_streaming_encoder() {
+  return streaming_encoder;
+}
+
+void Wav_Writer::start() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  running = true;
+  if (streaming_encoder) {
+    // A write to an encoder that has exited should fail, not end the program
+    signal(SIGPIPE, SIG_IGN);
+  }
+  worker = std::thread(&Wav_Writer::run);
+  BOOST_LOG_TRIVIAL(info) << "Wav Writer started";
+}
+
+void Wav_Writer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  not_empty.notify_all();
+  // The worker finishes whatever is still queued before it returns
+  worker.join();
+}
+
+Wav_Writer::Buffer *Wav_Writer::get_buffer() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  Buffer *buffer = NULL;
+  if (!free_buffers.empty()) {
+    buffer = free_buffers.back();
+    free_buffers.pop_back();
+  } else if (allocated_buffers < MAX_BUFFERS) {
+    buffer = new Buffer;
+    allocated_buffers++;
+  }
+  if (buffer) {
+    buffer->used = 0;
+  }
+  return buffer;
+}
+
+void Wav_Writer::release_buffer(Buffer *buffer) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  free_buffers.push_back(buffer);
+}
+
+void Wav_Writer::release_held(std::vector<Buffer *> &buffers) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  free_buffers.insert(free_buffers.end(), buffers.begin(), buffers.end());
+  held_buffers -= buffers.size();
+  buffers.clear();
+}
+
+char *Wav_Writer::get_file_buffer(size_t size) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  std::vector<char *> &free = free_file_buffers[size];
+  if (free.empty()) {
+    file_buffer_bytes += size;
+    file_buffer_count++;
+    return new char[size];
+  }
+  char *buffer = free.back();
+  free.pop_back();
+  return buffer;
+}
+
+void Wav_Writer::release_file_buffer(char *buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  free_file_buffers[size].push_back(buffer);
+}
+
+void Wav_Writer::count_dropped(int source_num, long samples) {
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    dropped_samples += samples;
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  source_stats[source_num].dropped_samples += samples;
+}
+
+void Wav_Writer::count_orphaned(int source_num, long samples) {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  source_stats[source_num].orphaned_samples += samples;
+}
+
+uint64_t Wav_Writer::open(std::shared_ptr<Wav_File> file) {
+  Command command;
+  command.type = OPEN;
+  command.file = file;
+  command.buffer = NULL;
+  command.has_transmission = false;
+  command.keep = false;
+  return push(command);
+}
+
+uint64_t Wav_Writer::write(std::shared_ptr<Wav_File> file, Buffer *buffer) {
+  Command command;
+  command.type = WRITE;
+  command.file = file;
+  command.buffer = buffer;
+  command.has_transmission = false;
+  command.keep = false;
+  return push(command);
+}
+
+uint64_t Wav_Writer::close(std::shared_ptr<Wav_File> file, const Transmission *transmission, Close_Handler on_close) {
+  Command command;
+  command.type = CLOSE;
+  command.file = file;
+  command.buffer = NULL;
+  command.has_transmission = (transmission != NULL);
+  if (transmission) {
+    command.transmission = *transmission;
+  }
+  command.on_close = on_close;
+  command.keep = false;
+  return push(command);
+}
+
+uint64_t Wav_Writer::finish(std::shared_ptr<Call_Encoder> encoder, bool keep) {
+  Command command;
+  command.type = FINISH;
+  command.buffer = NULL;
+  command.has_transmission = false;
+  command.encoder = encoder;
+  command.keep = keep;
+  return push(command);
+}
+
+uint64_t Wav_Writer::push(Command &command) {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  command.seq = ++queued_seq;
+  uint64_t seq = command.seq;
+
+  if (!running) {
+    lock.unlock();
+    execute(command);
+    lock.lock();
+    done_seq = std::max(done_seq, seq);
+    return seq;
+  }
+
+  queue.push_back(std::move(command));
+  max_depth = std::max(max_depth, queue.size());
+  lock.unlock();
+  not_empty.notify_one();
+  return seq;
+}
+
+void Wav_Writer::wait(uint64_t seq) {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  done.wait(lock, [seq] { return done_seq >= seq; });
+}
+
+// Makes <temp>/<short_name> the first time a file goes in it, after that
+// the directory is known to be there and nothing is checked
+std::string Wav_Writer::make_directory(const Wav_File &file) {
+  boost::filesystem::path dir = boost::filesystem::path(file.temp_dir) / file.short_name;
+  std::string dir_name = dir.string();
+
+  std::lock_guard<std::mutex> lock(dirs_mutex);
+  if (made_dirs.count(dir_name) == 0) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir, ec);
+    if (ec) {
+      BOOST_LOG_TRIVIAL(error) << "create_directories failed for " << dir_name
+                               << " : " << ec.message();
+    } else {
+      made_dirs.insert(dir_name);
+    }
+  }
+  return dir_name;
+}
+
+// If the directory has been removed since, it is made again on the next file
+void Wav_Writer::forget_directory(const Wav_File &file) {
+  std::lock_guard<std::mutex> lock(dirs_mutex);
+  made_dirs.erase((boost::filesystem::path(file.temp_dir) / file.short_name).string());
+}
+
+// A sink that starts two transmissions in the same millisecond numbers the
+// second one, so the name is unique without looking at what is on disk.
+// Disk files are opened with O_EXCL and bump the suffix in the rare case
+// that another recorder made the same name.
+std::string Wav_Writer::make_filename(const Wav_File &file, int suffix) {
+  using std::ostringstream;
+  using std::setfill;
+  using std::setw;
+
+  // Seconds.milliseconds from start_time_ms
+  const long long start_ms = static_cast<long long>(file.start_time_ms);
+  const long long sec = start_ms / 1000;
+  const int milli = static_cast<int>(start_ms % 1000);
+
+  // Normalize frequency to integer
+  const long long freq_i = static_cast<long long>(std::llround(file.freq));
+
+  ostringstream ts;
+  ts << sec << '.' << setw(3) << setfill('0') << milli; // e.g. 1718145678.042
+
+  ostringstream oss;
+  oss << file.directory << "/" << file.talkgroup << "-" << ts.str() << "_" << freq_i;
+  if (file.slot != -1) oss << "." << file.slot;
+  if (suffix > 0) oss << "-" << suffix; // collision suffix
+  oss << ".wav";
+  return oss.str();
+}
+
+void Wav_Writer::open_file(Wav_File &file) {
+  file.directory = make_directory(file);
+  file.filename = make_filename(file, file.sequence);
+  file.bytes_written = 0;
+  file.peak = (file.bytes_per_sample == 2) ? 0 : -1;
+  file.fp = NULL;
+  file.file_buffer = NULL;
+  file.file_buffer_size = 0;
+  file.map = NULL;
+  file.map_size = 0;
+  file.failed = true;
+
+  if (!memory_transmissions) {
+    open_disk_file(file);
+    return;
+  }
+
+  file.audio = std::make_shared<Transmission_Audio>();
+  file.audio->sample_rate = file.sample_rate;
+  file.audio->nchans = file.nchans;
+  file.audio->bytes_per_sample = file.bytes_per_sample;
+  file.audio->bytes = 0;
+  file.failed = false;
+  if (file.call) {
+    file.call->mark_latency(LATENCY_FIRST_WRITE);
+  }
+}
+
+void Wav_Writer::open_disk_file(Wav_File &file) {
+  // we use the open system call to get access to the O_LARGEFILE flag.
+  int fd;
+  int suffix = file.sequence;
+  bool made_directory = false;
+  while ((fd = ::open(file.filename.c_str(),
+                      O_RDWR | O_CREAT | O_EXCL | OUR_O_LARGEFILE | OUR_O_BINARY,
+                      0664)) < 0) {
+    if ((errno == EEXIST) && (suffix < file.sequence + 99)) {
+      file.filename = make_filename(file, ++suffix);
+    } else if ((errno == ENOENT) && !made_directory) {
+      forget_directory(file);
+      make_directory(file);
+      made_directory = true;
+    } else {
+      perror(file.filename.c_str());
+      BOOST_LOG_TRIVIAL(error) << "wav error opening: " << file.filename;
+      return;
+    }
+  }
+
+  if ((file.fp = fdopen(fd, "rb+")) == NULL) {
+    perror(file.filename.c_str());
+    ::close(fd); // don't leak file descriptor if fdopen fails.
+    BOOST_LOG_TRIVIAL(error) << "wav open failed";
+    return;
+  }
+  // Rounded up to whole pages, so sinks at the same rate share buffers
+  size_t size = (size_t)(buffer_seconds * file.sample_rate) * file.nchans * file.bytes_per_sample;
+  size = (size + 4095) & ~(size_t)4095;
+  if (mmap_files) {
+    // only the header goes through stdio
+    if (std::setvbuf(file.fp, nullptr, _IONBF, 0) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "setvbuf failed"; // POSIX version sets errno
+    }
+  } else if (size) {
+    file.file_buffer = get_file_buffer(size);
+    file.file_buffer_size = size;
+    if (std::setvbuf(file.fp, file.file_buffer, _IOFBF, size) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "setvbuf failed"; // POSIX version sets errno
+    }
+  } else if (std::setvbuf(file.fp, nullptr, _IONBF, 0) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "setvbuf failed"; // POSIX version sets errno
+  }
+
+  if (!gr::blocks::wavheader_write(file.fp, file.sample_rate, file.nchans, file.bytes_per_sample)) {
+    BOOST_LOG_TRIVIAL(error) << "could not write to WAV file: " << file.filename;
+    close_file(file);
+    return;
+  }
+
+  if (mmap_files && !map_file(file, std::max(size, (size_t)BUFFER_SIZE) + HEADER_SIZE)) {
+    BOOST_LOG_TRIVIAL(debug) << "Could not memory map, writing through stdio: " << file.filename;
+  }
+
+  file.failed = false;
+  if (file.call) {
+    file.call->mark_latency(LATENCY_FIRST_WRITE);
+  }
+}
+
+// Keeps the buffer with the transmission's other samples, unless the
+// transmission has got too long or too much of the pool is held already
+bool Wav_Writer::hold(Wav_File &file, Buffer *buffer) {
+  size_t spill_bytes = (size_t)(spill_seconds * file.sample_rate) * file.nchans * file.bytes_per_sample;
+  if (file.audio->bytes + buffer->used > spill_bytes) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  if (held_buffers >= MAX_BUFFERS / 2) {
+    return false;
+  }
+  held_buffers++;
+  file.audio->buffers.push_back(buffer);
+  file.audio->bytes += buffer->used;
+  return true;
+}
+
+// Makes the file for a transmission that was being kept in memory and
+// writes out what has been held so far
+void Wav_Writer::spill(Wav_File &file) {
+  std::shared_ptr<Transmission_Audio> audio = file.audio;
+  file.audio.reset();
+
+  BOOST_LOG_TRIVIAL(debug) << "Writing transmission to disk after " << audio->bytes << " bytes: " << file.filename;
+  open_disk_file(file);
+  if (!file.fp) {
+    return;
+  }
+  for (std::vector<Buffer *>::iterator it = audio->buffers.begin(); it != audio->buffers.end(); ++it) {
+    file.bytes_written += write_data(file, (*it)->data, (*it)->used);
+  }
+}
+
+void Wav_Writer::scan_peak(Wav_File &file, const Buffer *buffer) {
+  int peak = file.peak;
+  for (size_t i = 0; i + 1 < buffer->used; i += 2) {
+    int sample = (int16_t)(buffer->data[i] | (buffer->data[i + 1] << 8));
+    peak = std::max(peak, std::abs(sample));
+  }
+  file.peak = peak;
+}
+
+void Wav_Writer::write_file(Wav_File &file, Buffer *buffer) {
+  if (file.peak >= 0) {
+    scan_peak(file, buffer);
+  }
+
+  if (file.encoder) {
+    encode(*file.encoder, buffer);
+  }
+
+  if (file.audio) {
+    if (hold(file, buffer)) {
+      return;
+    }
+    spill(file);
+  }
+
+  if (file.fp && buffer->used) {
+    size_t written = write_data(file, buffer->data, buffer->used);
+    file.bytes_written += written;
+    if (written < buffer->used) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to Write! Wrote: " << written << " of " << buffer->used << " bytes to " << file.filename;
+    }
+  }
+  release_buffer(buffer);
+}
+
+// Preallocates the file to size bytes and maps all of it. On failure the
+// file is left as written so far, for stdio to carry on from.
+bool Wav_Writer::map_file(Wav_File &file, size_t size) {
+#ifdef __linux__
+  int fd = fileno(file.fp);
+  size = (size + 4095) & ~(size_t)4095;
+  // Unlike ftruncate() this reserves the blocks, a sparse file could SIGBUS
+  // a write into the mapping when the disk is full
+  if (fallocate(fd, 0, 0, size) == 0) {
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+      file.map = (unsigned char *)map;
+      file.map_size = size;
+      return true;
+    }
+  }
+  if (ftruncate(fd, HEADER_SIZE + file.bytes_written) != 0) {
+    perror(file.filename.c_str());
+  }
+  fseek(file.fp, 0, SEEK_END);
+#endif
+  return false;
+}
+
+size_t Wav_Writer::write_data(Wav_File &file, const unsigned char *data, size_t size) {
+  if (file.map) {
+    size_t offset = HEADER_SIZE + file.bytes_written;
+    if (offset + size > file.map_size) {
+      size_t map_size = file.map_size;
+      munmap(file.map, file.map_size);
+      file.map = NULL;
+      if (!map_file(file, std::max(map_size * 2, offset + size))) {
+        BOOST_LOG_TRIVIAL(error) << "Could not grow the memory mapped file, writing through stdio: " << file.filename;
+      }
+    }
+    if (file.map) {
+      memcpy(file.map + offset, data, size);
+      return size;
+    }
+  }
+  return fwrite(data, 1, size, file.fp);
+}
+
+void Wav_Writer::close_file(Wav_File &file) {
+  if (!file.fp) {
+    return;
+  }
+  if (file.map) {
+    munmap(file.map, file.map_size);
+    file.map = NULL;
+    // drop what was preallocated but not used
+    if (ftruncate(fileno(file.fp), HEADER_SIZE + file.bytes_written) != 0) {
+      perror(file.filename.c_str());
+    }
+  }
+  gr::blocks::wavheader_complete(file.fp, file.bytes_written);
+  fclose(file.fp);
+  file.fp = NULL;
+  if (file.file_buffer) {
+    release_file_buffer(file.file_buffer, file.file_buffer_size);
+    file.file_buffer = NULL;
+  }
+}
+
+void Wav_Writer::encode(Call_Encoder &encoder, const Buffer *buffer) {
+  if (encoder.failed || !buffer->used) {
+    return;
+  }
+
+  if (!encoder.pipe) {
+    std::stringstream shell_command;
+    shell_command << "fdkaac --silent -p 2 -R --raw-channels " << encoder.nchans << " --raw-rate " << encoder.sample_rate
+                  << " --raw-format S16L --date '" << encoder.date << "' --artist '" << encoder.short_name << "' --title '" << encoder.title
+                  << "' --moov-before-mdat -b 8000 -o '" << encoder.filename << "' -";
+    BOOST_LOG_TRIVIAL(trace) << "Encoding: " << encoder.filename;
+    BOOST_LOG_TRIVIAL(trace) << "Command: " << shell_command.str();
+
+    encoder.pipe = popen(shell_command.str().c_str(), "w");
+    if (!encoder.pipe) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to start the encoder for: " << encoder.filename << " Make sure you have fdkaac installed.";
+      encoder.failed = true;
+      return;
+    }
+  }
+
+  if (fwrite(buffer->data, 1, buffer->used, encoder.pipe) < buffer->used) {
+    BOOST_LOG_TRIVIAL(error) << "Failed to write to the encoder for: " << encoder.filename;
+    encoder.failed = true;
+  }
+}
+
+void Wav_Writer::finish_encoder(Call_Encoder &encoder, bool keep) {
+  if (encoder.pipe) {
+    int rc = pclose(encoder.pipe);
+    encoder.pipe = NULL;
+    if (rc != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to encode call recording: " << encoder.filename << " Make sure you have fdkaac installed.";
+      encoder.failed = true;
+    }
+  }
+
+  // Leave nothing behind that the Call_Concluder could mistake for the call's m4a
+  if (!keep || encoder.failed) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(encoder.filename, ec);
+  }
+}
+
+void Wav_Writer::execute(Command &command) {
+  if (command.type == FINISH) {
+    finish_encoder(*command.encoder, command.keep);
+    return;
+  }
+
+  Wav_File &file = *command.file;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  size_t bytes = 0;
+
+  switch (command.type) {
+  case OPEN:
+    open_file(file);
+    break;
+  case WRITE:
+    bytes = command.buffer->used;
+    write_file(file, command.buffer);
+    break;
+  case FINISH:
+    break;
+  case CLOSE:
+    close_file(file);
+    break;
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  std::int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+  if (Trace::enabled() && (command.type != WRITE)) {
+    Trace::complete((command.type == OPEN) ? "wav open" : "wav close", begin, end, file.call_num, TRACE_FLOW_STEP);
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    Source_Stats &stats = source_stats[file.source_num];
+    switch (command.type) {
+    case OPEN:
+      stats.open.record(us);
+      if (file.failed) {
+        stats.open_failures++;
+      } else {
+        stats.files_opened++;
+        stats.files_open++;
+      }
+      break;
+    case WRITE:
+      stats.write.record(us);
+      stats.bytes_written += bytes;
+      break;
+    case FINISH:
+      break;
+    case CLOSE:
+      stats.close.record(us);
+      if (!file.failed) {
+        stats.files_open--;
+      }
+      break;
+    }
+  }
+
+  if (command.type == CLOSE) {
+    if (!command.has_transmission) {
+      file.audio.reset();
+      return;
+    }
+    if (file.failed) {
+      BOOST_LOG_TRIVIAL(error) << "Dropping transmission, the wav file could not be made: " << file.filename;
+      return;
+    }
+    command.transmission.filename = file.filename;
+    command.transmission.audio = file.audio;
+    command.transmission.peak = file.peak;
+    file.audio.reset();
+    if (command.on_close) {
+      command.on_close(command.transmission);
+    }
+  }
+}
+
+void Wav_Writer::run() {
+  std::deque<Command> batch;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      not_empty.wait(lock, [] { return !queue.empty() || !running; });
+      if (queue.empty() && !running) {
+        return;
+      }
+      batch.swap(queue);
+    }
+
+    for (std::deque<Command>::iterator it = batch.begin(); it != batch.end(); ++it) {
+      execute(*it);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      done_seq = std::max(done_seq, batch.back().seq);
+    }
+    done.notify_all();
+    batch.clear();
+  }
+}
+
+bool Wav_Writer::save(const std::vector<Transmission> &transmissions, const std::string &filename) {
+  if (transmissions.empty()) {
+    return false;
+  }
+  const Transmission_Audio *format = transmissions.front().audio.get();
+  for (std::vector<Transmission>::const_iterator it = transmissions.begin(); it != transmissions.end(); ++it) {
+    const Transmission_Audio *audio = it->audio.get();
+    if (!audio || (audio->sample_rate != format->sample_rate) || (audio->nchans != format->nchans) || (audio->bytes_per_sample != format->bytes_per_sample)) {
+      return false;
+    }
+  }
+
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    perror(filename.c_str());
+    BOOST_LOG_TRIVIAL(error) << "wav error opening: " << filename;
+    return false;
+  }
+
+  bool ok = gr::blocks::wavheader_write(fp, format->sample_rate, format->nchans, format->bytes_per_sample);
+  size_t bytes = 0;
+  for (std::vector<Transmission>::const_iterator it = transmissions.begin(); ok && (it != transmissions.end()); ++it) {
+    const std::vector<Buffer *> &buffers = it->audio->buffers;
+    for (std::vector<Buffer *>::const_iterator b = buffers.begin(); b != buffers.end(); ++b) {
+      bytes += fwrite((*b)->data, 1, (*b)->used, fp);
+    }
+  }
+  ok = ok && !ferror(fp) && gr::blocks::wavheader_complete(fp, bytes);
+  fclose(fp);
+
+  if (!ok) {
+    BOOST_LOG_TRIVIAL(error) << "could not write to WAV file: " << filename;
+  }
+  return ok;
+}
+
+// The pools only grow, so this is what they have taken, in use or not
+std::vector<Memory_Usage> Wav_Writer::get_memory_usage() {
+  std::lock_guard<std::mutex> lock(pool_mutex);
+  std::vector<Memory_Usage> usage(2);
+  usage[0].subsystem = "Wav Writer";
+  usage[0].name = "sample buffers";
+  usage[0].count = allocated_buffers;
+  usage[0].bytes = (long long)allocated_buffers * sizeof(Buffer);
+  usage[1].subsystem = "Wav Writer";
+  usage[1].name = "file buffers";
+  usage[1].count = file_buffer_count;
+  usage[1].bytes = file_buffer_bytes;
+  return usage;
+}
+
+void Wav_Writer::print_stats() {
+  size_t depth;
+  size_t max_queued;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    depth = queue.size();
+    max_queued = max_depth;
+    max_depth = depth;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    BOOST_LOG_TRIVIAL(info) << "Wav Writer - Queued: " << depth << " Max Queued: " << max_queued << " Buffers in use: " << (allocated_buffers - free_buffers.size()) << "/" << MAX_BUFFERS << " Held: " << held_buffers << " Dropped Samples: " << dropped_samples << " File Buffers: " << file_buffer_bytes / 1024 << " KB";
+  }
+
+  std::vector<Wav_Writer_Stats> stats = get_stats();
+  for (std::vector<Wav_Writer_Stats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+    std::string label = (it->source_num < 0) ? "[No Source]" : "[Source " + std::to_string(it->source_num) + "]";
+    BOOST_LOG_TRIVIAL(info) << label << "\tFiles: " << it->files_opened << " Open: " << it->files_open << " Failed: " << it->open_failures << " Written: " << it->bytes_written / 1024 << " KB Dropped: " << it->dropped_samples << " Orphaned: " << it->orphaned_samples
+                            << std::fixed << std::setprecision(1) << "\tOpen p99/max ms: " << it->open.p99_ms << "/" << it->open.max_ms << "\tWrite: " << it->write.p99_ms << "/" << it->write.max_ms << "\tClose: " << it->close.p99_ms << "/" << it->close.max_ms;
+  }
+}
+
+std::vector<Wav_Writer_Stats> Wav_Writer::get_stats() {
+  std::vector<Wav_Writer_Stats> stats;
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  for (std::map<int, Source_Stats>::const_iterator it = source_stats.begin(); it != source_stats.end(); ++it) {
+    Wav_Writer_Stats s;
+    s.source_num = it->first;
+    s.files_opened = it->second.files_opened;
+    s.files_open = it->second.files_open;
+    s.open_failures = it->second.open_failures;
+    s.bytes_written = it->second.bytes_written;
+    s.dropped_samples = it->second.dropped_samples;
+    s.orphaned_samples = it->second.orphaned_samples;
+    s.open = Call_Latency::summarize(it->second.open);
+    s.write = Call_Latency::summarize(it->second.write);
+    s.close = Call_Latency::summarize(it->second.close);
+    stats.push_back(s);
+  }
+  return stats;
+}
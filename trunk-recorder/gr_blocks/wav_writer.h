@@ -0,0 +1,274 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include "../../trunk-recorder/global_structs.h"
+#include "../../trunk-recorder/latency_histogram.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Call;
+struct Transmission_Audio;
+
+/*
+ * Call_Encoder
+ *   A call's audio being compressed while it is recorded. The Wav_Writer
+ *   starts an fdkaac process for it with the first samples and feeds it
+ *   every transmission of the call, so the m4a is done when the call ends.
+ */
+struct Call_Encoder {
+  // Set by the transmission_sink
+  std::string filename;
+  std::string date;
+  std::string short_name;
+  std::string title;
+  unsigned int sample_rate;
+  int nchans;
+
+  // Only touched by the writer
+  FILE *pipe;
+  bool failed;
+};
+
+/*
+ * Wav_File
+ *   One transmission's wav file. The transmission_sink fills in what the
+ *   file is for and the Wav_Writer makes, writes and closes it.
+ */
+struct Wav_File {
+  // Set by the transmission_sink
+  Call *call;
+  long call_num;
+  int source_num;
+  std::string temp_dir;
+  std::string short_name;
+  long talkgroup;
+  std::int64_t start_time_ms;
+  double freq;
+  int slot;
+  unsigned int sample_rate;
+  int nchans;
+  int bytes_per_sample;
+  int sequence; // transmissions this sink has already started in the same millisecond
+
+  // Only touched by the writer
+  std::string directory;
+  std::string filename;
+  FILE *fp;
+  char *file_buffer; // stdio buffer from the Wav_Writer's pool
+  size_t file_buffer_size;
+  unsigned char *map; // the whole file, when it is memory mapped
+  size_t map_size;
+  size_t bytes_written;
+  int peak; // for Transmission.peak
+  bool failed;
+  std::shared_ptr<Transmission_Audio> audio; // samples held in memory, until spilled
+  std::shared_ptr<Call_Encoder> encoder;      // also fed the samples, if the call is being compressed
+};
+
+/*
+ * Wav_Writer
+ *   Does the file I/O for every transmission_sink on a thread of its own,
+ *   so a slow disk or a stalled NFS mount holds up the writer instead of
+ *   the flowgraph.
+ *
+ * A sink queues an open when a transmission starts, full buffers of
+ * converted samples while it is recording and a close when it ends. The
+ * writer works through them in order: it makes the directory and picks
+ * the filename, writes the header, appends the samples and, on close,
+ * fills in the data size, closes the file and hands the Transmission back
+ * to the sink.
+ *
+ * Sample buffers come from a pool that grows up to a fixed limit and then
+ * only reuses what the writer has given back. If the disk falls that far
+ * behind, samples are dropped and counted. The file header always matches
+ * what was written.
+ *
+ * Each open file is given a stdio buffer big enough for buffer_seconds of
+ * its audio, so a typical transmission reaches the disk in one write when
+ * it is closed. These buffers are kept in a pool by size and reused, so
+ * once there are enough of them recording doesn't allocate any memory.
+ *
+ * With mmap files on, the file is instead preallocated for buffer_seconds
+ * of audio and memory mapped, samples are copied straight into the mapping
+ * and it is doubled in size whenever it fills up. On close it is cut down
+ * to what was written and the header is filled in. If the filesystem can't
+ * preallocate the file, it is written through stdio as usual.
+ *
+ * With memory transmissions on, a transmission's samples are kept in the
+ * pool buffers they arrived in rather than written, and handed over with
+ * the Transmission as a Transmission_Audio, so the Call_Concluder can
+ * write the call's wav file straight from them. The file is only made, and
+ * what has been held written to it, once the transmission is longer than
+ * spill_seconds or half the pool is already held by other transmissions.
+ *
+ * The loudest sample of each 16 bit transmission is found as it is written
+ * and passed on in Transmission.peak, so the Call_Concluder knows the gain
+ * to normalize the call with without reading it an extra time.
+ *
+ * With the streaming encoder on, the samples of each transmission of a
+ * call are also piped to the call's Call_Encoder as they are written, and
+ * finish() closes it once the call has stopped recording.
+ *
+ * How long each open, write and close takes and how many samples were
+ * dropped is kept per Source, for the status output and plugins.
+ *
+ * Every queued command gets a sequence number and wait() lets a sink hold
+ * off until its commands are done, which stop_recording() does so a call
+ * isn't concluded before its files are closed. Before start() or after
+ * stop() the commands are carried out right away by the caller.
+ */
+class Wav_Writer {
+public:
+  static const size_t BUFFER_SIZE = 32768;
+  static const size_t MAX_BUFFERS = 2048;
+  static const size_t HEADER_SIZE = 44; // the wav header written by wavheader_write()
+
+  struct Buffer {
+    unsigned char data[BUFFER_SIZE];
+    size_t used;
+  };
+
+  typedef std::function<void(const Transmission &)> Close_Handler;
+
+  static void set_buffer_seconds(double seconds);
+  static void set_memory_transmissions(bool enabled, double spill_seconds);
+  static void set_streaming_encoder(bool enabled);
+  static void set_mmap_files(bool enabled);
+  static bool get_streaming_encoder();
+  static void start();
+  static void stop();
+
+  static Buffer *get_buffer();
+  static void count_dropped(int source_num, long samples);
+  static void count_orphaned(int source_num, long samples);
+
+  static uint64_t open(std::shared_ptr<Wav_File> file);
+  static uint64_t write(std::shared_ptr<Wav_File> file, Buffer *buffer);
+  static uint64_t close(std::shared_ptr<Wav_File> file, const Transmission *transmission, Close_Handler on_close);
+  // Waits for the encoder to write out the m4a, or removes it if keep is false
+  static uint64_t finish(std::shared_ptr<Call_Encoder> encoder, bool keep);
+  static void wait(uint64_t seq);
+
+  // Writes the audio of transmissions, which must all be held in memory
+  // and be in the same format, to one wav file
+  static bool save(const std::vector<Transmission> &transmissions, const std::string &filename);
+
+  static std::vector<Wav_Writer_Stats> get_stats();
+  static std::vector<Memory_Usage> get_memory_usage();
+  static void print_stats();
+
+private:
+  enum Command_Type { OPEN,
+                      WRITE,
+                      CLOSE,
+                      FINISH };
+
+  struct Source_Stats {
+    long files_opened;
+    long files_open;
+    long open_failures;
+    long long bytes_written;
+    long dropped_samples;
+    long orphaned_samples;
+    Latency_Histogram open;
+    Latency_Histogram write;
+    Latency_Histogram close;
+    Source_Stats() : files_opened(0), files_open(0), open_failures(0), bytes_written(0), dropped_samples(0), orphaned_samples(0) {}
+  };
+
+  struct Command {
+    Command_Type type;
+    std::shared_ptr<Wav_File> file;
+    Buffer *buffer;
+    bool has_transmission;
+    Transmission transmission;
+    Close_Handler on_close;
+    std::shared_ptr<Call_Encoder> encoder;
+    bool keep;
+    uint64_t seq;
+  };
+
+  static uint64_t push(Command &command);
+  static void execute(Command &command);
+  static void open_file(Wav_File &file);
+  static void open_disk_file(Wav_File &file);
+  static void spill(Wav_File &file);
+  static bool hold(Wav_File &file, Buffer *buffer);
+  static void write_file(Wav_File &file, Buffer *buffer);
+  static void scan_peak(Wav_File &file, const Buffer *buffer);
+  static void close_file(Wav_File &file);
+  static bool map_file(Wav_File &file, size_t size);
+  static size_t write_data(Wav_File &file, const unsigned char *data, size_t size);
+  static void encode(Call_Encoder &encoder, const Buffer *buffer);
+  static void finish_encoder(Call_Encoder &encoder, bool keep);
+  static std::string make_directory(const Wav_File &file);
+  static void forget_directory(const Wav_File &file);
+  static std::string make_filename(const Wav_File &file, int suffix);
+  static void release_buffer(Buffer *buffer);
+  static void release_held(std::vector<Buffer *> &buffers);
+  static char *get_file_buffer(size_t size);
+  static void release_file_buffer(char *buffer, size_t size);
+  static void run();
+
+  static std::mutex queue_mutex;
+  static std::condition_variable not_empty;
+  static std::condition_variable done;
+  static std::deque<Command> queue;
+  static bool running;
+  static std::thread worker;
+  static uint64_t queued_seq;
+  static uint64_t done_seq;
+  static size_t max_depth;
+
+  static std::mutex pool_mutex;
+  static std::vector<Buffer *> free_buffers;
+  static size_t allocated_buffers;
+  static long dropped_samples;
+  static std::map<size_t, std::vector<char *>> free_file_buffers;
+  static size_t file_buffer_bytes;
+  static size_t file_buffer_count;
+  static size_t held_buffers;
+
+  static std::mutex dirs_mutex;
+  static std::set<std::string> made_dirs;
+
+  static std::mutex stats_mutex;
+  static std::map<int, Source_Stats> source_stats;
+
+  static double buffer_seconds;
+  static bool memory_transmissions;
+  static double spill_seconds;
+  static bool streaming_encoder;
+  static bool mmap_files;
+
+  friend struct Transmission_Audio;
+};
+
+/*
+ * Transmission_Audio
+ *   The samples of a transmission kept in Wav_Writer pool buffers, already
+ *   in wav sample format. The buffers go back to the pool when the last
+ *   Transmission sharing it is gone.
+ */
+struct Transmission_Audio {
+  unsigned int sample_rate;
+  int nchans;
+  int bytes_per_sample;
+  size_t bytes;
+  std::vector<Wav_Writer::Buffer *> buffers;
+
+  ~Transmission_Audio() { Wav_Writer::release_held(buffers); }
+};
+
+#endif // WAV_WRITER_H
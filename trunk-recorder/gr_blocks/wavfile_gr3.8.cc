@@ -229,6 +229,58 @@ void wav_write_sample(FILE *fp, short int sample, int bytes_per_sample) {
   fwrite(data_ptr, 1, bytes_per_sample, fp);
 }
 
+void wav_convert_samples(unsigned char *out,
+                         const int16_t *const *in,
+                         int first,
+                         int n_in_chans,
+                         int nchans,
+                         int nitems,
+                         int bytes_per_sample) {
+  if (bytes_per_sample == 1) {
+    for (int chan = 0; chan < nchans; chan++) {
+      const int16_t *samples = (chan < n_in_chans) ? in[chan] + first : NULL;
+      for (int i = 0; i < nitems; i++) {
+        out[i * nchans + chan] = samples ? (unsigned char)samples[i] : 0;
+      }
+    }
+  } else {
+    int16_t *out_16bit = (int16_t *)out;
+    for (int chan = 0; chan < nchans; chan++) {
+      const int16_t *samples = (chan < n_in_chans) ? in[chan] + first : NULL;
+      for (int i = 0; i < nitems; i++) {
+        out_16bit[i * nchans + chan] = samples ? host_to_wav(samples[i]) : 0;
+      }
+    }
+  }
+}
+
+int wav_write_samples(FILE *fp,
+                      const int16_t *const *in,
+                      int n_in_chans,
+                      int nchans,
+                      int nitems,
+                      int bytes_per_sample,
+                      std::vector<unsigned char> &scratch) {
+  size_t frame_bytes = (size_t)nchans * bytes_per_sample;
+
+  if (nitems <= 0 || frame_bytes == 0) {
+    return 0;
+  }
+
+#ifndef GR_IS_BIG_ENDIAN
+  if ((nchans == 1) && (n_in_chans >= 1) && (bytes_per_sample == 2)) {
+    return (int)fwrite(in[0], frame_bytes, nitems, fp);
+  }
+#endif
+
+  if (scratch.size() < frame_bytes * nitems) {
+    scratch.resize(frame_bytes * nitems);
+  }
+  wav_convert_samples(scratch.data(), in, 0, n_in_chans, nchans, nitems, bytes_per_sample);
+
+  return (int)fwrite(scratch.data(), frame_bytes, nitems, fp);
+}
+
 bool wavheader_complete(FILE *fp, unsigned int byte_count) {
   uint32_t chunk_size = (uint32_t)byte_count;
   chunk_size = host_to_wav(chunk_size);
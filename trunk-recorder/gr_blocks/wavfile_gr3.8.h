@@ -26,8 +26,10 @@
 #ifndef _GR_WAVFILE_GR_3_8_H_
 #define _GR_WAVFILE_GR_3_8_H_
 
+#include <cstdint>
 #include <cstdio>
 #include <gnuradio/blocks/api.h>
+#include <vector>
 
 namespace gr {
 namespace blocks {
@@ -80,6 +82,43 @@ wavheader_write(FILE *fp, unsigned int sample_rate, int nchans, int bytes_per_sa
  */
 BLOCKS_API void wav_write_sample(FILE *fp, short int sample, int bytes_per_sample);
 
+/*!
+ * \brief Convert a block of samples to WAV sample format in memory.
+ *
+ * \details
+ * Takes care of endianness and interleaves items \p first to
+ * \p first + \p nitems of each channel into \p out, which must have room
+ * for \p nitems * \p nchans * \p bytes_per_sample bytes. WAV channels
+ * past \p n_in_chans are written as zeros.
+ */
+BLOCKS_API void wav_convert_samples(unsigned char *out,
+                                    const int16_t *const *in,
+                                    int first,
+                                    int n_in_chans,
+                                    int nchans,
+                                    int nitems,
+                                    int bytes_per_sample);
+
+/*!
+ * \brief Write a block of samples to an open WAV file at the current position.
+ *
+ * \details
+ * Takes care of endianness and interleaves the channels. WAV channels
+ * past \p n_in_chans are written as zeros. A mono 16 bit block on a
+ * little-endian host goes straight to fwrite(), anything else is
+ * converted into \p scratch first, which grows to fit and can be reused
+ * from one call to the next, so it is still a single fwrite().
+ *
+ * \return The number of items (one sample from each channel) written.
+ */
+BLOCKS_API int wav_write_samples(FILE *fp,
+                                 const int16_t *const *in,
+                                 int n_in_chans,
+                                 int nchans,
+                                 int nitems,
+                                 int bytes_per_sample,
+                                 std::vector<unsigned char> &scratch);
+
 /*!
  * \brief Complete a WAV header
  *
@@ -11,6 +11,8 @@ const int xlat_channelizer::phase2_samples_per_symbol;
 const double xlat_channelizer::phase1_symbol_rate;
 const double xlat_channelizer::phase2_symbol_rate;
 const double xlat_channelizer::smartnet_symbol_rate;
+const double xlat_channelizer::sync_wake_hangtime;
+const double xlat_channelizer::sync_wake_preroll;
 
 xlat_channelizer::DecimSettings xlat_channelizer::get_decim(long speed) {
   long s = speed;
@@ -56,7 +58,10 @@ xlat_channelizer::xlat_channelizer(double input_rate, int samples_per_symbol, do
 
   const float pi = M_PI;
 
-  int initial_decim = floor(input_rate / 96000);
+  // Input below the IF rate has already been channelized, e.g. by a
+  // Source's PFB channelizer, and only needs fine tuning
+  bool prechannelized = input_rate < 96000;
+  int initial_decim = prechannelized ? 1 : floor(input_rate / 96000);
   initial_rate = double(input_rate) / double(initial_decim);
   int decim = floor(initial_rate / channel_rate);
   double resampled_rate = double(initial_rate) / double(decim);
@@ -64,16 +69,21 @@ xlat_channelizer::xlat_channelizer(double input_rate, int samples_per_symbol, do
   int decimation = floor(input_rate / channel_rate);
   // double resampled_rate = float(input_rate) / float(decimation);
 
-  std::vector<gr_complex> if_coeffs;
-  if_coeffs = gr::filter::firdes::complex_band_pass_2(1, input_rate, -24000, 24000, 12000, 10);
+  size_t if_taps = 0;
+  if (prechannelized) {
+    rotator = make_gated_rotator_cc(0);
+  } else {
+    Filter_Taps::Complex if_coeffs = Filter_Taps::complex_band_pass_2(1, input_rate, -24000, 24000, 12000, 10);
+    if_taps = if_coeffs->size();
 
-  freq_xlat = make_freq_xlating_fft_filter(initial_decim, if_coeffs, 0, input_rate); // inital_lpf_taps, 0, input_rate);
+    freq_xlat = make_freq_xlating_fft_filter(initial_decim, *if_coeffs, 0, input_rate); // inital_lpf_taps, 0, input_rate);
+  }
 
-  std::vector<float> channel_lpf_taps = gr::filter::firdes::low_pass_2(1.0, initial_rate, d_bandwidth / 2, d_bandwidth / 4, 60);
-  channel_lpf = gr::filter::fft_filter_ccf::make(decim, channel_lpf_taps);
+  Filter_Taps::Real channel_lpf_taps = Filter_Taps::low_pass_2(1.0, initial_rate, d_bandwidth / 2, d_bandwidth / 4, 60);
+  channel_lpf = gr::filter::fft_filter_ccf::make(decim, *channel_lpf_taps);
 
   // BOOST_LOG_TRIVIAL(info) << "\t Xlating Channelizer single-stage decimator - Decim: " << decimation << " Resampled Rate: " << resampled_rate << " Lowpass Taps: " << if_coeffs.size();
-  BOOST_LOG_TRIVIAL(info) << "\t Xlating Channelizer decimator - freq_xlating taps: " << if_coeffs.size() << " Decim: " << decim << " Resampled Rate: " << resampled_rate << " Lowpass Taps: " << channel_lpf_taps.size();
+  BOOST_LOG_TRIVIAL(info) << "\t Xlating Channelizer decimator - freq_xlating taps: " << if_taps << " Decim: " << decim << " Resampled Rate: " << resampled_rate << " Lowpass Taps: " << channel_lpf_taps->size();
   // ARB Resampler
   double arb_rate = channel_rate / resampled_rate;
 
@@ -98,13 +108,9 @@ xlat_channelizer::xlat_channelizer(double input_rate, int samples_per_symbol, do
 
 // As we drop the bw factor, the optfir filter has a harder time converging;
 // using the firdes method here for better results.
-#if GNURADIO_VERSION < 0x030900
-    arb_taps = gr::filter::firdes::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, gr::filter::firdes::WIN_BLACKMAN_HARRIS);
-#else
-    arb_taps = gr::filter::firdes::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, gr::fft::window::WIN_BLACKMAN_HARRIS);
-#endif
-    BOOST_LOG_TRIVIAL(info) << "\t Channelizer ARB - Symbol Rate: " << channel_rate << " Resampled Rate: " << resampled_rate << " ARB Rate: " << arb_rate << " ARB Taps: " << arb_taps.size() << " BW: " << bw << " TB: " << tb;
-    arb_resampler = gr::filter::pfb_arb_resampler_ccf::make(arb_rate, arb_taps);
+    Filter_Taps::Real arb_taps = Filter_Taps::low_pass_2(arb_size, arb_size, bw, tb, arb_atten, Filter_Taps::BLACKMAN_HARRIS);
+    BOOST_LOG_TRIVIAL(info) << "\t Channelizer ARB - Symbol Rate: " << channel_rate << " Resampled Rate: " << resampled_rate << " ARB Rate: " << arb_rate << " ARB Taps: " << arb_taps->size() << " BW: " << bw << " TB: " << tb;
+    arb_resampler = gr::filter::pfb_arb_resampler_ccf::make(arb_rate, *arb_taps);
   } else if (arb_rate > 1) {
     BOOST_LOG_TRIVIAL(error) << "Something is probably wrong! Resampling rate too low";
     exit(1);
@@ -122,8 +128,13 @@ xlat_channelizer::xlat_channelizer(double input_rate, int samples_per_symbol, do
   rms_agc = gr::blocks::rms_agc::make(0.45, 0.85);
   fll_band_edge = gr::digital::fll_band_edge_cc::make(d_samples_per_symbol, excess_bw, 2 * d_samples_per_symbol + 1, (2.0 * pi) / d_samples_per_symbol / 250); // OP25 has this set to 350 instead of 250
 
-  connect(self(), 0, freq_xlat, 0);
-  connect(freq_xlat, 0, channel_lpf, 0);
+  if (prechannelized) {
+    connect(self(), 0, rotator, 0);
+    connect(rotator, 0, channel_lpf, 0);
+  } else {
+    connect(self(), 0, freq_xlat, 0);
+    connect(freq_xlat, 0, channel_lpf, 0);
+  }
   if (d_use_squelch) {
     BOOST_LOG_TRIVIAL(info) << "Conventional - with Squelch";
     if (arb_rate == 1.0) {
@@ -143,7 +154,13 @@ xlat_channelizer::xlat_channelizer(double input_rate, int samples_per_symbol, do
   }
 
   connect(rms_agc, 0, fll_band_edge, 0);
-  connect(fll_band_edge, 0, self(), 0);
+  if (d_use_squelch) {
+    sync_gate = make_sync_gate_cc(d_samples_per_symbol, channel_rate, sync_wake_hangtime, sync_wake_preroll);
+    connect(fll_band_edge, 0, sync_gate, 0);
+    connect(sync_gate, 0, self(), 0);
+  } else {
+    connect(fll_band_edge, 0, self(), 0);
+  }
 }
 
 int xlat_channelizer::get_freq_error() { // get frequency error from FLL and convert to Hz
@@ -152,7 +169,11 @@ int xlat_channelizer::get_freq_error() { // get frequency error from FLL and con
   return int((fll_band_edge->get_frequency() / (2 * pi)) * if_rate);
 }
 
+// A channel waiting for a frame sync is as quiet as a squelched one
 bool xlat_channelizer::is_squelched() {
+  if (sync_gate && !sync_gate->is_open()) {
+    return true;
+  }
   return !squelch->unmuted();
 }
 
@@ -168,12 +189,40 @@ void xlat_channelizer::tune_offset(double f) {
 
   float freq = static_cast<float>(f);
 
-  freq_xlat->set_center_freq(-freq);
+  if (rotator) {
+    rotator->set_phase_inc(2.0 * M_PI * freq / d_input_rate);
+  } else {
+    freq_xlat->set_center_freq(-freq);
+  }
+}
+
+// A disabled channelizer drops its input, in freq_xlat or the rotator,
+// which lets a recorder read the Source's buffer directly with no copy
+void xlat_channelizer::set_enabled(bool enabled) {
+  if (rotator) {
+    rotator->set_enabled(enabled);
+  } else {
+    freq_xlat->set_enabled(enabled);
+  }
+}
+
+bool xlat_channelizer::is_enabled() {
+  if (rotator) {
+    return rotator->enabled();
+  }
+  return freq_xlat->is_enabled();
+}
+
+// FFTW threads for the FFT filters, which do nearly all of the work
+void xlat_channelizer::set_nthreads(int nthreads) {
+  if (freq_xlat) {
+    freq_xlat->set_nthreads(nthreads);
+  }
+  channel_lpf->set_nthreads(nthreads);
 }
 
 void xlat_channelizer::set_max_dev(double max_dev) {
-  std::vector<float> channel_lpf_taps = gr::filter::firdes::low_pass_2(1.0, initial_rate, max_dev, d_bandwidth / 2, 60);
-  channel_lpf->set_taps(channel_lpf_taps);
+  channel_lpf->set_taps(*Filter_Taps::low_pass_2(1.0, initial_rate, max_dev, d_bandwidth / 2, 60));
 }
 
 void xlat_channelizer::set_squelch_db(double squelch_db) {
@@ -192,6 +241,18 @@ void xlat_channelizer::set_analog_squelch(bool analog_squelch) {
   }
 }
 
+// The demod and decoder only get the channel once there is a frame sync on
+// it, the channelizer keeps running to look for one
+void xlat_channelizer::set_sync_wake(bool sync_wake) {
+  if (sync_gate) {
+    sync_gate->set_wake(sync_wake);
+  }
+}
+
+long xlat_channelizer::get_sync_wakes() {
+  return sync_gate ? sync_gate->get_wakes() : 0;
+}
+
 void xlat_channelizer::set_samples_per_symbol(int samples_per_symbol) {
   fll_band_edge->set_samples_per_symbol(samples_per_symbol);
 }
\ No newline at end of file
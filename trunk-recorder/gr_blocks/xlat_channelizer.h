@@ -5,8 +5,11 @@
 #include <iomanip>
 
 #include "./rms_agc.h"
+#include "./filter_taps.h"
 #include "./freq_xlating_fft_filter.h"
+#include "./gated_rotator.h"
 #include "./pwr_squelch_cc.h"
+#include "./sync_gate.h"
 #include <gnuradio/blocks/copy.h>
 #include <gnuradio/digital/fll_band_edge_cc.h>
 #include <gnuradio/filter/fft_filter_ccc.h>
@@ -56,15 +59,23 @@ public:
   static constexpr double phase2_symbol_rate = 6000;
   static constexpr double smartnet_symbol_rate = 3600;
   static constexpr double channel_bandwidth = 12500;
+  // For the sync_gate of a conventional channel
+  static constexpr double sync_wake_hangtime = 1.0;
+  static constexpr double sync_wake_preroll = 0.1;
 
   int get_freq_error();
   bool is_squelched();
   double get_pwr();
   void tune_offset(double f);
+  void set_enabled(bool enabled);
+  bool is_enabled();
+  void set_nthreads(int nthreads);
   void set_samples_per_symbol(int samples_per_symbol);
   void set_squelch_db(double squelch_db);
   void set_analog_squelch(bool analog_squelch);
   void set_max_dev(double max_dev); 
+  void set_sync_wake(bool sync_wake);
+  long get_sync_wakes();
 
 private:
   bool double_decim;
@@ -85,12 +96,12 @@ private:
 
   // gr::filter::freq_xlating_fir_filter<gr_complex, gr_complex, float>::sptr freq_xlat;
   freq_xlating_fft_filter_sptr freq_xlat;
-  std::vector<float> arb_taps;
-  std::vector<gr_complex> bandpass_filter_coeffs;
-  std::vector<float> lowpass_filter_coeffs;
-  std::vector<float> cutoff_filter_coeffs;
+  // Used instead of freq_xlat when the input is already a single channel
+  gated_rotator_cc_sptr rotator;
 
   gr::analog::pwr_squelch_cc::sptr squelch;
+  // Only for conventional channels, which can wait for a frame sync
+  sync_gate_cc_sptr sync_gate;
   gr::digital::fll_band_edge_cc::sptr fll_band_edge;
   gr::blocks::rms_agc::sptr rms_agc;
 
@@ -0,0 +1,130 @@
+#include "json_writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <json.hpp>
+
+Json_Writer::Json_Writer(std::string &out, int indent) : out(out), indent(indent), after_key(false) {}
+
+// Starts a new value: a comma after the last one and a new line, unless it
+// is the value for the key just written
+void Json_Writer::separate() {
+  if (after_key) {
+    after_key = false;
+    return;
+  }
+  if (counts.empty()) {
+    return;
+  }
+  if (counts.back()++ > 0) {
+    out += ',';
+  }
+  out += '\n';
+  out.append(counts.size() * indent, ' ');
+}
+
+void Json_Writer::close(char bracket) {
+  int count = counts.back();
+  counts.pop_back();
+  if (count > 0) {
+    out += '\n';
+    out.append(counts.size() * indent, ' ');
+  }
+  out += bracket;
+}
+
+void Json_Writer::begin_object() {
+  separate();
+  out += '{';
+  counts.push_back(0);
+}
+
+void Json_Writer::end_object() {
+  close('}');
+}
+
+void Json_Writer::begin_array() {
+  separate();
+  out += '[';
+  counts.push_back(0);
+}
+
+void Json_Writer::end_array() {
+  close(']');
+}
+
+void Json_Writer::key(const char *name) {
+  separate();
+  write_string(name, strlen(name));
+  out += ": ";
+  after_key = true;
+}
+
+void Json_Writer::value(long long number) {
+  separate();
+  char buffer[24];
+  int length = snprintf(buffer, sizeof(buffer), "%lld", number);
+  out.append(buffer, length);
+}
+
+void Json_Writer::value(double number) {
+  separate();
+  if (!std::isfinite(number)) {
+    out += "null";
+    return;
+  }
+  // The shortest text that reads back as the same double, like nlohmann::json
+  char buffer[64];
+  char *end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), number);
+  out.append(buffer, end - buffer);
+}
+
+void Json_Writer::value(const std::string &text) {
+  separate();
+  write_string(text.data(), text.size());
+}
+
+void Json_Writer::value(const char *text) {
+  separate();
+  write_string(text, strlen(text));
+}
+
+void Json_Writer::write_string(const char *text, size_t length) {
+  out += '"';
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = text[i];
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (c < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        out += escaped;
+      } else {
+        out += (char)c;
+      }
+    }
+  }
+  out += '"';
+}
@@ -0,0 +1,60 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Json_Writer
+ *   Writes JSON text straight into a string as values are added, without
+ *   building a tree first. The output is the same as nlohmann::json's
+ *   dump(indent), so files written with it don't change.
+ *
+ * Objects and arrays are opened and closed in order, and every value in an
+ * object follows a key():
+ *
+ *   Json_Writer json(text);
+ *   json.begin_object();
+ *   json.field("freq", 851012500L);
+ *   json.key("srcList");
+ *   json.begin_array();
+ *   ...
+ *   json.end_array();
+ *   json.end_object();
+ */
+class Json_Writer {
+public:
+  explicit Json_Writer(std::string &out, int indent = 2);
+
+  void begin_object();
+  void end_object();
+  void begin_array();
+  void end_array();
+  void key(const char *name);
+
+  void value(int number) { value((long long)number); }
+  void value(long number) { value((long long)number); }
+  void value(long long number);
+  void value(double number);
+  void value(const std::string &text);
+  void value(const char *text);
+
+  template <typename T>
+  void field(const char *name, const T &v) {
+    key(name);
+    value(v);
+  }
+
+private:
+  void separate();
+  void close(char bracket);
+  void write_string(const char *text, size_t length);
+
+  std::string &out;
+  int indent;
+  std::vector<int> counts; // values written so far at each open level
+  bool after_key;
+};
+
+#endif // JSON_WRITER_H
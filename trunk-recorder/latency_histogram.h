@@ -0,0 +1,97 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Latency_Histogram
+ *   Counts latencies in microseconds, HDR style: every power of two is
+ *   split into 16 buckets, so a value is kept to within 1/16th (about 6%)
+ *   of what it was, from 1 us up to about 35 minutes, in a fixed 449
+ *   buckets. Anything longer goes in the last bucket.
+ *
+ * Values below 32 get a bucket each. Past that, a value with its top bit
+ * at position b keeps its top 5 bits and goes in bucket 16 * (b - 4) plus
+ * those 5 bits.
+ */
+class Latency_Histogram {
+public:
+  static const int sub_buckets = 16;
+  static const int max_bits = 31;
+  static const int num_buckets = sub_buckets * (max_bits - 3) + 1;
+
+  Latency_Histogram() : counts(num_buckets, 0), total(0), highest(0) {}
+
+  void record(int64_t us) {
+    if (us < 0) {
+      us = 0;
+    }
+    counts[bucket(us)]++;
+    total++;
+    if (us > highest) {
+      highest = us;
+    }
+  }
+
+  // The highest value that falls in the same bucket as the value at
+  // fraction p (0 - 1) of the recorded values
+  int64_t percentile(double p) const {
+    if (total == 0) {
+      return 0;
+    }
+    uint64_t rank = (uint64_t)(p * total + 0.5);
+    if (rank < 1) {
+      rank = 1;
+    }
+    if (rank > total) {
+      rank = total;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < num_buckets; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        int64_t value = upper_value(i);
+        return value < highest ? value : highest;
+      }
+    }
+    return highest;
+  }
+
+  uint64_t count() const { return total; }
+  int64_t max() const { return highest; }
+
+  void reset() {
+    counts.assign(num_buckets, 0);
+    total = 0;
+    highest = 0;
+  }
+
+private:
+  static int bucket(int64_t us) {
+    if (us < 2 * sub_buckets) {
+      return (int)us;
+    }
+    int top = 63 - __builtin_clzll((unsigned long long)us);
+    if (top >= max_bits) {
+      return num_buckets - 1;
+    }
+    int shift = top - 4;
+    return sub_buckets * shift + (int)(us >> shift);
+  }
+
+  static int64_t upper_value(int index) {
+    if (index < 2 * sub_buckets) {
+      return index;
+    }
+    int shift = index / sub_buckets - 1;
+    int64_t top = index % sub_buckets + sub_buckets;
+    return ((top + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> counts;
+  uint64_t total;
+  int64_t highest;
+};
+
+#endif // LATENCY_HISTOGRAM_H
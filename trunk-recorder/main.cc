@@ -24,6 +24,7 @@
 #include <cmath>
 #include <exception>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <signal.h>
 #include <sstream>
@@ -37,6 +38,7 @@
 
 #include "./global_structs.h"
 #include "config.h"
+#include "flowgraph_profiler.h"
 #include "recorder_globals.h"
 #include "source.h"
 
@@ -44,8 +46,27 @@
 #include "recorders/p25_recorder.h"
 #include "recorders/recorder.h"
 
+#include "admission_control.h"
 #include "call.h"
+#include "call_concluder/archive_segments.h"
+#include "call_concluder/call_concluder.h"
+#include "call_concluder/recent_calls.h"
 #include "call_conventional.h"
+#include "channel_occupancy.h"
+#include "cluster.h"
+#include "control_api.h"
+#include "gr_blocks/decoders/signal_decoder_sink.h"
+#include "gr_blocks/iq_writer.h"
+#include "gr_blocks/wav_writer.h"
+#include "memory_report.h"
+#include "message_capture.h"
+#include "ota_alias_writer.h"
+#include "recorder_builder.h"
+#include "replay_clock.h"
+#include "trace.h"
+#include "unit_activity.h"
+#include "upload_engine.h"
+#include <op25_repeater/include/op25_repeater/vocoder_service.h>
 
 #include "systems/p25_trunking.h"
 #include "systems/parser.h"
@@ -84,6 +105,7 @@ std::vector<Call *> monitored_calls;
 gr::top_block_sptr tb;
 
 Config config;
+Upload_Engine upload_engine;
 
 int main(int argc, char **argv) {
   // BOOST_STATIC_ASSERT(true) __attribute__((unused));
@@ -97,7 +119,7 @@ int main(int argc, char **argv) {
   boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
 
   boost::program_options::options_description desc("Options");
-  desc.add_options()("help,h", "Help screen")("config,c", boost::program_options::value<string>()->default_value("./config.json"), "Config File")("version,v", "Version Information");
+  desc.add_options()("help,h", "Help screen")("config,c", boost::program_options::value<string>()->default_value("./config.json"), "Config File")("version,v", "Version Information")("profile", "Time startup and report how much CPU each block of the flowgraph uses");
 
   boost::program_options::variables_map vm;
   boost::program_options::store(parse_command_line(argc, argv, desc), vm);
@@ -114,20 +136,92 @@ int main(int argc, char **argv) {
     exit(0);
   }
   string config_file = vm["config"].as<string>();
+  if (vm.count("profile")) {
+    Flowgraph_Profiler::enable();
+  }
 
   tb = gr::make_top_block("Trunking");
 
+  // The plugins pick these up when they are initialized, while the config is loaded
+  config.upload_engine = &upload_engine;
+  config.register_signal_decoder = &gr::blocks::register_signal_decoder;
+
+  std::chrono::steady_clock::time_point startup = std::chrono::steady_clock::now();
   if (!load_config(config_file, config, tb, sources, systems)) {
     exit(1);
   }
+  double config_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startup).count();
+  Flowgraph_Profiler::add_phase_time(STARTUP_CONFIG_PARSE, config_seconds - Flowgraph_Profiler::get_phase_time(STARTUP_CSV_LOAD) - Flowgraph_Profiler::get_phase_time(STARTUP_SOURCE_INIT) - Flowgraph_Profiler::get_phase_time(STARTUP_RECORDER_BUILD));
 
+  upload_engine.start(config.upload_connections_per_host);
+  gr::op25_repeater::vocoder_service::start(config.vocoder_threads);
   start_plugins(sources, systems);
+  if (!Cluster::start(config)) {
+    exit(1);
+  }
+  Recent_Calls::set_hours(config.recent_calls_hours);
+  if (Recent_Calls::enabled()) {
+    Control_Api::add_route("/calls", &Recent_Calls::handle_request);
+  }
+  if (config.unit_activity_file != "") {
+    Control_Api::add_route("/units", &Unit_Activity::handle_request);
+  }
+  if (!Control_Api::start(config)) {
+    exit(1);
+  }
 
+  std::chrono::steady_clock::time_point systems_start = std::chrono::steady_clock::now();
   if (setup_systems(config, tb, sources, systems, calls)) {
-
+    double systems_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - systems_start).count();
+    Flowgraph_Profiler::add_phase_time(STARTUP_SYSTEMS_SETUP, systems_seconds);
+
+    Wav_Writer::set_buffer_seconds(config.wav_buffer_seconds);
+    Wav_Writer::set_mmap_files(config.wav_mmap);
+    Wav_Writer::set_memory_transmissions(config.memory_transmissions, config.memory_spill_seconds);
+    Wav_Writer::set_streaming_encoder(config.streaming_encoder);
+    Wav_Writer::start();
+    IQ_Writer::set_format(config.sigmf_format == "ci16" ? IQ_Writer::CI16 : IQ_Writer::CF32);
+    IQ_Writer::set_compression(config.sigmf_compression == "zstd" ? IQ_Writer::ZSTD : IQ_Writer::NO_COMPRESSION);
+    IQ_Writer::set_direct_io(config.sigmf_direct_io);
+    IQ_Writer::start();
+    OTA_Alias_Writer::start();
+    Recorder_Builder::start();
+    Call_Concluder::set_worker_count(config.call_concluder_threads);
+    Call_Concluder::set_retry_rate(config.retry_rate);
+    Call_Concluder::set_backlog_limits(config.backlog_max_seconds, config.backlog_max_mb);
+    Admission_Control::set_budget(config.admission_cpu_budget, config.admission_defer_seconds);
+    Archive_Segments::set_enabled(config.archive_segments, config.archive_sync_seconds);
+    if (config.retry_journal) {
+      Call_Concluder::set_retry_journal(config.capture_dir + "/retry_journal.jsonl");
+    }
+    if (config.control_channel_capture != "") {
+      Message_Capture::open(config.control_channel_capture, systems);
+    }
+    Channel_Occupancy::open(config.occupancy_file, systems);
+    Unit_Activity::open(config.unit_activity_file, config.unit_activity_mb, systems);
+    Trace::start(config.trace_file);
+    std::chrono::steady_clock::time_point flowgraph_start = std::chrono::steady_clock::now();
     tb->start();
+    double flowgraph_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - flowgraph_start).count();
+    Flowgraph_Profiler::add_phase_time(STARTUP_FLOWGRAPH_START, flowgraph_seconds);
+    BOOST_LOG_TRIVIAL(info) << std::fixed << std::setprecision(2) << "Startup took " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startup).count() << " sec - Config, Sources & Recorders: " << config_seconds << " sec, Systems: " << systems_seconds << " sec, Starting the Flowgraph: " << flowgraph_seconds << " sec";
+
+    Flowgraph_Profiler::start(tb, sources);
+    Memory_Report::start(tb);
 
     exit_code = monitor_messages(config, tb, sources, systems, calls);
+    Message_Capture::close();
+    Channel_Occupancy::close();
+    Unit_Activity::close();
+    Trace::stop();
+    Control_Api::stop();
+    Cluster::stop();
+    Flowgraph_Profiler::stop();
+    Memory_Report::stop();
+    if (Replay_Clock::enabled()) {
+      Replay_Clock::print_summary();
+      Call_Concluder::print_stats();
+    }
 
     // ------------------------------------------------------------------
     // -- stop flow graph execution
@@ -135,12 +229,19 @@ int main(int argc, char **argv) {
     BOOST_LOG_TRIVIAL(info) << "stopping flow graph" << std::endl;
     tb->stop();
     tb->wait();
+    gr::op25_repeater::vocoder_service::stop();
+    Wav_Writer::stop();
+    IQ_Writer::stop();
+    OTA_Alias_Writer::stop();
+    Recorder_Builder::stop();
 
     BOOST_LOG_TRIVIAL(info) << "stopping plugins" << std::endl;
     stop_plugins();
   } else {
     BOOST_LOG_TRIVIAL(error) << "Unable to setup a System to record, exiting..." << std::endl;
   }
+  upload_engine.stop();
+  flush_logs();
 
   return exit_code;
 }
@@ -0,0 +1,162 @@
+#include "memory_report.h"
+#include "call_concluder/call_concluder.h"
+#include "flowgraph_profiler.h"
+#include "gr_blocks/filter_taps.h"
+#include "gr_blocks/wav_writer.h"
+#include "recorders/recorder.h"
+#include "source.h"
+#include "systems/system_impl.h"
+
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+#include <gnuradio/block.h>
+#include <gnuradio/block_detail.h>
+#include <gnuradio/block_registry.h>
+#include <gnuradio/buffer.h>
+#include <pmt/pmt.h>
+
+gr::top_block_sptr Memory_Report::top_block;
+
+void Memory_Report::start(gr::top_block_sptr tb) {
+  top_block = tb;
+}
+
+void Memory_Report::stop() {
+  top_block.reset();
+}
+
+// What the output buffers of a block of the running flowgraph take
+long long Memory_Report::block_buffer_bytes(const std::string &alias) {
+  gr::basic_block_sptr found;
+  try {
+    found = gr::global_block_registry.block_lookup(pmt::intern(alias));
+  } catch (std::exception const &e) {
+    return 0;
+  }
+  gr::block *block = dynamic_cast<gr::block *>(found.get());
+  if (!block || !block->detail()) {
+    return 0;
+  }
+  long long bytes = 0;
+  for (int i = 0; i < block->detail()->noutputs(); i++) {
+    gr::buffer_sptr buffer = block->detail()->output(i);
+    if (buffer) {
+      bytes += (long long)buffer->bufsize() * block->output_signature()->sizeof_stream_item(i);
+    }
+  }
+  return bytes;
+}
+
+long long Memory_Report::read_rss() {
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (!statm) {
+    return 0;
+  }
+  long long size = 0;
+  long long resident = 0;
+  if (fscanf(statm, "%lld %lld", &size, &resident) != 2) {
+    resident = 0;
+  }
+  fclose(statm);
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+Memory_Stats Memory_Report::get_stats(std::vector<Source *> &sources, std::vector<System *> &systems) {
+  Memory_Stats stats;
+  stats.rss_bytes = read_rss();
+
+  if (top_block) {
+    // Each type in the order it is first seen
+    std::vector<std::string> types;
+    std::map<std::string, Memory_Usage> by_type;
+    std::set<std::string> recorder_aliases;
+    for (std::vector<Source *>::iterator it = sources.begin(); it != sources.end(); ++it) {
+      std::vector<Recorder *> recorders = (*it)->get_recorders();
+      for (std::vector<Recorder *>::iterator rx = recorders.begin(); rx != recorders.end(); ++rx) {
+        long long bytes = 0;
+        std::vector<std::string> aliases = Flowgraph_Profiler::recorder_blocks(*rx);
+        for (std::vector<std::string>::iterator alias = aliases.begin(); alias != aliases.end(); ++alias) {
+          if (recorder_aliases.insert(*alias).second) {
+            bytes += block_buffer_bytes(*alias);
+          }
+        }
+        (*rx)->set_buffer_bytes(bytes);
+
+        std::string type = (*rx)->get_type_string();
+        std::map<std::string, Memory_Usage>::iterator usage = by_type.find(type);
+        if (usage == by_type.end()) {
+          Memory_Usage fresh = {"GNU Radio", type + " recorders", 0, 0};
+          usage = by_type.insert(std::make_pair(type, fresh)).first;
+          types.push_back(type);
+        }
+        usage->second.count++;
+        usage->second.bytes += bytes;
+      }
+    }
+    for (std::vector<std::string>::iterator it = types.begin(); it != types.end(); ++it) {
+      stats.usage.push_back(by_type[*it]);
+    }
+
+    Memory_Usage rest = {"GNU Radio", "other blocks", 0, 0};
+    std::set<std::string> aliases;
+    std::istringstream edges(top_block->edge_list());
+    std::string edge;
+    while (std::getline(edges, edge)) {
+      size_t arrow = edge.find("->");
+      if (arrow == std::string::npos) {
+        continue;
+      }
+      std::string src = edge.substr(0, arrow);
+      std::string dst = edge.substr(arrow + 2);
+      aliases.insert(src.substr(0, src.rfind(':')));
+      aliases.insert(dst.substr(0, dst.rfind(':')));
+    }
+    for (std::set<std::string>::iterator it = aliases.begin(); it != aliases.end(); ++it) {
+      if (!recorder_aliases.count(*it)) {
+        long long bytes = block_buffer_bytes(*it);
+        if (bytes) {
+          rest.count++;
+          rest.bytes += bytes;
+        }
+      }
+    }
+    stats.usage.push_back(rest);
+  }
+
+  std::vector<Memory_Usage> wav_writer = Wav_Writer::get_memory_usage();
+  stats.usage.insert(stats.usage.end(), wav_writer.begin(), wav_writer.end());
+  stats.usage.push_back(Filter_Taps::get_memory_usage());
+
+  for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    std::vector<Memory_Usage> tables = ((System_impl *)*it)->get_memory_usage();
+    stats.usage.insert(stats.usage.end(), tables.begin(), tables.end());
+  }
+
+  // Their audio is in the Wav Writer's buffers or on disk, so only the
+  // calls themselves are counted
+  Concluder_Load load = Call_Concluder::get_load();
+  Memory_Usage backlog = {"Call Concluder", "calls waiting", load.calls_pending, load.calls_pending * (long long)sizeof(Call_Data_t)};
+  stats.usage.push_back(backlog);
+
+  stats.accounted_bytes = 0;
+  for (std::vector<Memory_Usage>::const_iterator it = stats.usage.begin(); it != stats.usage.end(); ++it) {
+    stats.accounted_bytes += it->bytes;
+  }
+  return stats;
+}
+
+void Memory_Report::print_stats(const Memory_Stats &stats) {
+  BOOST_LOG_TRIVIAL(info) << "Memory - RSS: " << stats.rss_bytes / (1024 * 1024) << " MB Accounted For: " << stats.accounted_bytes / (1024 * 1024) << " MB";
+  for (std::vector<Memory_Usage>::const_iterator it = stats.usage.begin(); it != stats.usage.end(); ++it) {
+    if (!it->count && !it->bytes) {
+      continue;
+    }
+    BOOST_LOG_TRIVIAL(info) << "\t" << std::left << std::setw(16) << it->subsystem << std::setw(32) << it->name << std::right << std::setw(8) << it->count << std::setw(10) << it->bytes / 1024 << " KB";
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include "global_structs.h"
+
+#include <string>
+#include <vector>
+
+#include <gnuradio/top_block.h>
+
+class Source;
+class System;
+
+/*
+ * Memory_Report
+ *   Where the memory of the process goes, for the status and the plugins,
+ *   so a Trunk Recorder that has grown to gigabytes can be cut back in the
+ *   right place.
+ *
+ * The biggest part is usually the GNU Radio buffers: every output of every
+ * block has one, sized for throughput. They are added up for each Recorder
+ * from the blocks it is made of, which is kept on the Recorder as its
+ * bufferBytes, and then for each type of recorder. The blocks of the
+ * flowgraph that aren't in a recorder, the sources and what feeds the
+ * recorders, are counted together. recorderBufferItems caps the buffers
+ * of a type of recorder.
+ *
+ * The rest comes from the parts that hold it: the Wav_Writer's sample and
+ * stdio buffer pools, the Filter_Taps designs, the talkgroups, unit tags
+ * and OTA aliases of each System and the calls waiting for the
+ * Call_Concluder. The tables are estimates from their sizes, and the
+ * buffers GNU Radio blocks keep inside themselves, like their copies of
+ * the taps, can't be seen from here. What isn't accounted for is the
+ * difference from the resident size.
+ *
+ * Everything is called from the main loop, with the status.
+ */
+class Memory_Report {
+public:
+  static void start(gr::top_block_sptr tb);
+  static void stop();
+  static Memory_Stats get_stats(std::vector<Source *> &sources, std::vector<System *> &systems);
+  static void print_stats(const Memory_Stats &stats);
+
+private:
+  static long long block_buffer_bytes(const std::string &alias);
+  static long long read_rss();
+
+  static gr::top_block_sptr top_block;
+};
+
+#endif // MEMORY_REPORT_H
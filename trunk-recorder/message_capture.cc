@@ -0,0 +1,138 @@
+#include "message_capture.h"
+#include "systems/system.h"
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <json.hpp>
+
+static const char *CAPTURE_MAGIC = "trunk-recorder control channel capture 1\n";
+// Bigger than any message OP25 or the SmartNet decoder hands up
+static const uint32_t MAX_PAYLOAD = 65536;
+
+std::mutex Message_Capture::capture_mutex;
+FILE *Message_Capture::capture_file = NULL;
+std::atomic<bool> Message_Capture::capturing(false);
+
+bool Message_Capture::open(const std::string &filename, const std::vector<System *> &systems) {
+  std::lock_guard<std::mutex> lock(capture_mutex);
+  if (capture_file) {
+    fclose(capture_file);
+    capturing = false;
+  }
+  capture_file = fopen(filename.c_str(), "wb");
+  if (!capture_file) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to open control channel capture: " << filename;
+    return false;
+  }
+
+  nlohmann::json header = nlohmann::json::array();
+  for (std::vector<System *>::const_iterator it = systems.begin(); it != systems.end(); ++it) {
+    System *sys = *it;
+    header.push_back({{"sys_num", sys->get_sys_num()},
+                      {"type", sys->get_system_type()},
+                      {"short_name", sys->get_short_name()},
+                      {"custom_freq_table_file", sys->has_custom_freq_table_file() ? sys->get_custom_freq_table_file() : std::string()},
+                      {"bandplan", sys->get_bandplan()},
+                      {"bandplan_base", sys->get_bandplan_base()},
+                      {"bandplan_high", sys->get_bandplan_high()},
+                      {"bandplan_spacing", sys->get_bandplan_spacing()},
+                      {"bandplan_offset", sys->get_bandplan_offset()}});
+  }
+  std::string line = header.dump() + "\n";
+  fputs(CAPTURE_MAGIC, capture_file);
+  fputs(line.c_str(), capture_file);
+  capturing = true;
+  BOOST_LOG_TRIVIAL(info) << "Capturing control channel messages to: " << filename;
+  return true;
+}
+
+void Message_Capture::record(System *system, const gr::message::sptr &msg) {
+  if (!capturing) {
+    return;
+  }
+  int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  int32_t sys_num = system->get_sys_num();
+  int64_t type = msg->type();
+  double arg1 = msg->arg1();
+  double arg2 = msg->arg2();
+  uint32_t length = (uint32_t)msg->length();
+
+  std::lock_guard<std::mutex> lock(capture_mutex);
+  if (!capture_file) {
+    return;
+  }
+  fwrite(&time_us, sizeof(time_us), 1, capture_file);
+  fwrite(&sys_num, sizeof(sys_num), 1, capture_file);
+  fwrite(&type, sizeof(type), 1, capture_file);
+  fwrite(&arg1, sizeof(arg1), 1, capture_file);
+  fwrite(&arg2, sizeof(arg2), 1, capture_file);
+  fwrite(&length, sizeof(length), 1, capture_file);
+  if (length > 0) {
+    fwrite(msg->msg(), 1, length, capture_file);
+  }
+}
+
+void Message_Capture::close() {
+  std::lock_guard<std::mutex> lock(capture_mutex);
+  capturing = false;
+  if (capture_file) {
+    fclose(capture_file);
+    capture_file = NULL;
+  }
+}
+
+bool Message_Capture::read_header(FILE *fp, std::vector<System_Info> &systems) {
+  char line[256];
+  if (!fgets(line, sizeof(line), fp) || (std::string(line) != CAPTURE_MAGIC)) {
+    return false;
+  }
+
+  std::string json_line;
+  int c;
+  while (((c = fgetc(fp)) != EOF) && (c != '\n')) {
+    json_line += (char)c;
+  }
+
+  nlohmann::json header = nlohmann::json::parse(json_line, nullptr, false);
+  if (!header.is_array()) {
+    return false;
+  }
+  systems.clear();
+  for (nlohmann::json::const_iterator it = header.begin(); it != header.end(); ++it) {
+    System_Info info;
+    info.sys_num = it->value("sys_num", 0);
+    info.type = it->value("type", "");
+    info.short_name = it->value("short_name", "");
+    info.custom_freq_table_file = it->value("custom_freq_table_file", "");
+    info.bandplan = it->value("bandplan", "");
+    info.bandplan_base = it->value("bandplan_base", 0.0);
+    info.bandplan_high = it->value("bandplan_high", 0.0);
+    info.bandplan_spacing = it->value("bandplan_spacing", 0.0);
+    info.bandplan_offset = it->value("bandplan_offset", 0);
+    systems.push_back(info);
+  }
+  return true;
+}
+
+bool Message_Capture::read_record(FILE *fp, Record &record) {
+  int64_t time_us;
+  int32_t sys_num;
+  int64_t type;
+  uint32_t length;
+  if ((fread(&time_us, sizeof(time_us), 1, fp) != 1) ||
+      (fread(&sys_num, sizeof(sys_num), 1, fp) != 1) ||
+      (fread(&type, sizeof(type), 1, fp) != 1) ||
+      (fread(&record.arg1, sizeof(record.arg1), 1, fp) != 1) ||
+      (fread(&record.arg2, sizeof(record.arg2), 1, fp) != 1) ||
+      (fread(&length, sizeof(length), 1, fp) != 1) ||
+      (length > MAX_PAYLOAD)) {
+    return false;
+  }
+  record.time_us = time_us;
+  record.sys_num = sys_num;
+  record.type = (long)type;
+  record.payload.resize(length);
+  if ((length > 0) && (fread(&record.payload[0], 1, length, fp) != length)) {
+    return false;
+  }
+  return true;
+}
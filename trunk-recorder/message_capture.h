@@ -0,0 +1,68 @@
+#ifndef MESSAGE_CAPTURE_H
+#define MESSAGE_CAPTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <gnuradio/message.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class System;
+
+/*
+ * Message_Capture
+ *   Records the messages coming off every trunked system's msg_queue to a
+ *   file, so a control channel can be played back through the parsers and
+ *   the call handling without the radio. utils/cc-replay plays them back.
+ *
+ * The file starts with a line naming the format and a line of JSON with
+ * each system's number, type, short name and what its parser needs to
+ * know about it. After that each message is:
+ *
+ *   int64 time_us, int32 sys_num, int64 type, double arg1, double arg2,
+ *   uint32 length, then length bytes of payload
+ *
+ * in the byte order of the machine that made it. time_us is the wall
+ * clock when the message was taken off the queue. Messages from systems
+ * with workers of their own are written as they come, under one lock.
+ */
+class Message_Capture {
+public:
+  struct System_Info {
+    int sys_num;
+    std::string type;
+    std::string short_name;
+    std::string custom_freq_table_file;
+    std::string bandplan;
+    double bandplan_base;
+    double bandplan_high;
+    double bandplan_spacing;
+    int bandplan_offset;
+  };
+
+  struct Record {
+    std::int64_t time_us;
+    int sys_num;
+    long type;
+    double arg1;
+    double arg2;
+    std::string payload;
+  };
+
+  static bool open(const std::string &filename, const std::vector<System *> &systems);
+  static void record(System *system, const gr::message::sptr &msg);
+  static void close();
+
+  // Reading a capture back
+  static bool read_header(FILE *fp, std::vector<System_Info> &systems);
+  static bool read_record(FILE *fp, Record &record);
+
+private:
+  static std::mutex capture_mutex;
+  static FILE *capture_file;
+  static std::atomic<bool> capturing; // so record() doesn't lock when there is no capture
+};
+
+#endif // MESSAGE_CAPTURE_H
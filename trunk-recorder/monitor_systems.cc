@@ -1,32 +1,199 @@
 #include "monitor_systems.h"
+#include "admission_control.h"
+#include "call_concluder/call_concluder.h"
+#include "call_index.h"
+#include "call_preemption.h"
+#include "call_timeouts.h"
+#include "call_latency.h"
+#include "channel_occupancy.h"
+#include "cluster.h"
+#include "control_api.h"
+#include "control_channel_hunt.h"
+#include "stage_latency.h"
+#include "event_loop.h"
+#include "flowgraph_profiler.h"
+#include "gr_blocks/wav_writer.h"
+#include "memory_report.h"
+#include "message_capture.h"
+#include "pre_tuner.h"
+#include "recorder_builder.h"
 #include "recorders/p25_recorder.h"
+#include "replay_clock.h"
+#include "setup_systems.h"
+#include "state_checkpoint.h"
+#include "trace.h"
+#include "tone_scanner.h"
+#include "unit_activity.h"
+#include "upload_engine.h"
+#include <boost/algorithm/string.hpp>
+#include <json.hpp>
+#include <op25_repeater/include/op25_repeater/vocoder_service.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <boost/log/sinks/sink.hpp>
 #include <boost/log/sinks/text_file_backend.hpp>
 #include <boost/log/core.hpp>
 
 using namespace std;
 
 // External reference to global log sink for SIGHUP rotation
-extern boost::shared_ptr<boost::log::sinks::synchronous_sink<boost::log::sinks::text_file_backend>> global_log_sink;
+extern boost::shared_ptr<boost::log::sinks::sink> global_log_sink;
 
 volatile sig_atomic_t exit_flag = 0;
 volatile sig_atomic_t rotate_log_flag = 0;
+volatile sig_atomic_t reload_tables_flag = 0;
 int exit_code = EXIT_SUCCESS;
 
+Event_Loop *volatile main_loop = NULL;
+
+// Every Call pushed onto or erased from calls after monitor_messages() starts
+// has to go through the index as well
+static Call_Index call_index;
+static Call_Preemption call_preemption;
+static Call_Timeouts call_timeouts;
+// manage_calls() runs these every time, they don't time out
+static std::vector<Call *> conventional_calls;
+
 void exit_interupt(int sig) { // can be called asynchronously
   exit_flag = 1;              // set flag
+  if (main_loop) {
+    main_loop->wake();
+  }
 }
 
 void rotate_log_signal(int sig) { // can be called asynchronously
   rotate_log_flag = 1;          // set flag
+  if (main_loop) {
+    main_loop->wake();
+  }
 }
 
-uint64_t time_since_epoch_millisec() {
-  using namespace std::chrono;
-  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+void reload_tables_signal(int sig) { // can be called asynchronously
+  request_table_reload();
+}
+
+void request_table_reload() {
+  reload_tables_flag = 1;
+  if (main_loop) {
+    main_loop->wake();
+  }
+}
+
+// Reloads every system's talkgroup, channel and unit tag files, one reload
+// at a time, off the main thread
+static std::thread reload_thread;
+static std::atomic<bool> reloading(false);
+
+static void start_table_reload(std::vector<System *> &systems) {
+  if (reloading) {
+    BOOST_LOG_TRIVIAL(info) << "Already reloading the talkgroup and unit tag files, try again once it is done";
+    return;
+  }
+  if (reload_thread.joinable()) {
+    reload_thread.join();
+  }
+  reloading = true;
+  reload_thread = std::thread([systems]() {
+    BOOST_LOG_TRIVIAL(info) << "Reloading the talkgroup and unit tag files...";
+    for (std::vector<System *>::const_iterator it = systems.begin(); it != systems.end(); ++it) {
+      (*it)->reload_tables();
+    }
+    BOOST_LOG_TRIVIAL(info) << "Reloading the talkgroup and unit tag files is done";
+    reloading = false;
+  });
+}
+
+// Picks the Source to record a call on from every Source that covers its
+// freq, in one pass. Free recorders of the call's type count most, a busy
+// Source's free recorders count for half as much, and the distance from the
+// band edge, where the SDR's own filter rolls off, breaks ties.
+static Source *select_source(std::vector<Source *> &sources, double freq, bool analog, Source_Allocation &allocation) {
+  Source *best = NULL;
+  allocation = Source_Allocation();
+
+  for (vector<Source *>::iterator it = sources.begin(); it != sources.end(); it++) {
+    Source *source = *it;
+    if ((source->get_min_hz() > freq) || (source->get_max_hz() < freq)) {
+      continue;
+    }
+    allocation.candidates++;
+
+    int free_recorders = analog ? source->get_num_available_analog_recorders() : source->get_num_available_digital_recorders();
+    double half_span = (source->get_max_hz() - source->get_min_hz()) / 2;
+    double edge = half_span > 0 ? std::min(freq - source->get_min_hz(), source->get_max_hz() - freq) / half_span : 0;
+    double load = source->get_load();
+    double score = free_recorders * (1.0 - 0.5 * load) + edge;
+
+    if (!best || (score > allocation.score)) {
+      best = source;
+      allocation.free_recorders = free_recorders;
+      allocation.load = load;
+      allocation.edge = edge;
+      allocation.score = score;
+    }
+  }
+  return best;
+}
+
+// A call the control node of a cluster can't record itself goes to one of
+// the voice nodes, and is monitored here while it records there
+static bool dispatch_to_voice_node(Call *call, const TrunkMessage &message, Talkgroup *talkgroup, bool analog) {
+  if (!Cluster::is_control()) {
+    return false;
+  }
+  if (!Cluster::dispatch(call, message, analog, talkgroup ? talkgroup->get_priority() : 0)) {
+    return false;
+  }
+  if (analog) {
+    call->set_is_analog(true);
+  }
+  call->set_state(MONITORING);
+  call->set_monitoring_state(REMOTE);
+  return true;
+}
+
+// With no recorder of the kind call needs free on source, concludes the
+// call there that matters least, if it matters less, and starts call with
+// its recorder
+static Recorder *preempt_recorder(Call *call, Source *source, bool analog, int priority) {
+  int free_recorders = analog ? source->get_num_available_analog_recorders() : source->get_num_available_digital_recorders();
+  if (free_recorders > 0) {
+    // the free ones are being kept for talkgroups with a lower priority number
+    return NULL;
+  }
+
+  Recorder *recorder = NULL;
+  Call *victim;
+  while (!recorder && (victim = call_preemption.find_victim(source, analog, priority, call->get_emergency()))) {
+    std::string loghdr = log_header( victim->get_short_name(), victim->get_call_num(), victim->get_talkgroup_display(), victim->get_freq());
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mPreempted\u001b[0m for TG: " << call->get_talkgroup_display() << (call->get_emergency() ? " (emergency)" : "") << " Freq: " << format_freq(call->get_freq());
+
+    Recorder *victim_recorder = victim->get_recorder();
+    victim->conclude_call();
+    if (victim_recorder != NULL) {
+      plugman_setup_recorder(victim_recorder);
+    }
+    victim->set_state(MONITORING);
+    victim->set_monitoring_state(PREEMPTED);
+    call_preemption.remove(victim);
+    source->count_preempted_call();
+
+    recorder = analog ? source->get_analog_recorder(call) : source->get_digital_recorder(call);
+  }
+  return recorder;
 }
 
 bool start_recorder(Call *call, TrunkMessage message, Config &config, System *sys, std::vector<Source *> &sources) {
+  Trace::Span span("start_recorder", call->get_call_num(), TRACE_FLOW_STEP);
+  call->mark_latency(LATENCY_RECORDER_START);
   Talkgroup *talkgroup = sys->find_talkgroup(call->get_talkgroup());
 
   bool source_found = false;
@@ -84,98 +251,140 @@ bool start_recorder(Call *call, TrunkMessage message, Config &config, System *sy
     }
   }
 
-  for (vector<Source *>::iterator it = sources.begin(); it != sources.end(); it++) {
-    Source *source = *it;
+  // Let low priority calls go while the Call_Concluder is too far behind
+  int shed_priority = talkgroup ? talkgroup->get_priority() : std::numeric_limits<int>::max();
+  BOOST_FOREACH (auto &TGID, sys->get_talkgroup_patch(call->get_talkgroup())) {
+    if (sys->find_talkgroup(TGID) != NULL) {
+      shed_priority = std::min(shed_priority, sys->find_talkgroup(TGID)->get_priority());
+    }
+  }
+  if (!call->get_emergency() && Call_Concluder::shed_call(shed_priority)) {
+    call->set_state(MONITORING);
+    call->set_monitoring_state(BACKLOG);
+    Concluder_Load load = Call_Concluder::get_load();
+    std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mNot Recording: Call Concluder backlog of " << load.calls_pending << " calls, " << load.bytes_pending / (1024 * 1024) << " MB, oldest " << (int)load.oldest_seconds << " s\u001b[0m ";
+    return false;
+  }
 
-    if ((source->get_min_hz() <= call->get_freq()) &&
-        (source->get_max_hz() >= call->get_freq())) {
-      source_found = true;
-
-      if (talkgroup) {
-        int priority = talkgroup->get_priority();
-        BOOST_FOREACH (auto &TGID, sys->get_talkgroup_patch(call->get_talkgroup())) {
-          if (sys->find_talkgroup(TGID) != NULL) {
-            if (sys->find_talkgroup(TGID)->get_priority() < priority) {
-              priority = sys->find_talkgroup(TGID)->get_priority();
-              BOOST_LOG_TRIVIAL(info) << "Temporarily increased priority of talkgroup " << call->get_talkgroup() << " to " << sys->find_talkgroup(TGID)->get_priority() << " due to active patch with talkgroup " << TGID;
-            }
+  bool analog = talkgroup ? (talkgroup->mode.compare("A") == 0) : ((config.default_mode == "analog") && (sys->get_system_type() == "smartnet"));
+  Source_Allocation allocation;
+  Source *source = select_source(sources, call->get_freq(), analog, allocation);
+
+  if (source) {
+    source_found = true;
+    call->set_source_allocation(allocation);
+    if (allocation.candidates > 1) {
+      BOOST_LOG_TRIVIAL(debug) << log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq()) << "Source " << source->get_num() << " picked from " << allocation.candidates << " - Free Recorders: " << allocation.free_recorders << " Load: " << allocation.load << " Edge: " << allocation.edge << " Score: " << allocation.score;
+    }
+
+    // Hold low priority calls back while the host is out of CPU
+    if (!Admission_Control::admit(call, sys, source, shed_priority)) {
+      call->set_state(MONITORING);
+      call->set_monitoring_state(ADMISSION);
+      return false;
+    }
+
+    // Unknown talkgroups matter least
+    int priority = std::numeric_limits<int>::max();
+    if (talkgroup) {
+      priority = talkgroup->get_priority();
+      BOOST_FOREACH (auto &TGID, sys->get_talkgroup_patch(call->get_talkgroup())) {
+        if (sys->find_talkgroup(TGID) != NULL) {
+          if (sys->find_talkgroup(TGID)->get_priority() < priority) {
+            priority = sys->find_talkgroup(TGID)->get_priority();
+            BOOST_LOG_TRIVIAL(info) << "Temporarily increased priority of talkgroup " << call->get_talkgroup() << " to " << sys->find_talkgroup(TGID)->get_priority() << " due to active patch with talkgroup " << TGID;
           }
         }
-        if (talkgroup->mode.compare("A") == 0) {
-          recorder = source->get_analog_recorder(talkgroup, priority, call);
-          call->set_is_analog(true);
-        } else {
-          recorder = source->get_digital_recorder(talkgroup, priority, call);
-        }
+      }
+      if (analog) {
+        recorder = source->get_analog_recorder(talkgroup, priority, call);
+        call->set_is_analog(true);
       } else {
-        std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
-        BOOST_LOG_TRIVIAL(info) << loghdr << "TG not in Talkgroup File ";
-
-        // A talkgroup was not found from the talkgroup file.
-        // Use an analog recorder if this is a Type II trunk and defaultMode is analog.
-        // All other cases use a digital recorder.
-        if ((config.default_mode == "analog") && (sys->get_system_type() == "smartnet")) {
-          recorder = source->get_analog_recorder(call);
-          call->set_is_analog(true);
-        } else {
-          recorder = source->get_digital_recorder(call);
-        }
+        recorder = source->get_digital_recorder(talkgroup, priority, call);
       }
-
-      if (recorder) {
-        if (message.meta.length()) {
-          BOOST_LOG_TRIVIAL(trace) << message.meta;
-        }
-
-        if (recorder->start(call)) {
-          call->set_recorder(recorder);
-          call->set_state(RECORDING);
-          plugman_setup_recorder(recorder);
-          recorder_found = true;
-        } else {
-          call->set_state(MONITORING);
-          // call->set_monitoring_state(NO_SOURCE);
-          recorder_found = false;
-          return false;
-        }
+    } else {
+      std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+      BOOST_LOG_TRIVIAL(info) << loghdr << "TG not in Talkgroup File ";
+
+      // A talkgroup was not found from the talkgroup file.
+      // Use an analog recorder if this is a Type II trunk and defaultMode is analog.
+      // All other cases use a digital recorder.
+      if (analog) {
+        recorder = source->get_analog_recorder(call);
+        call->set_is_analog(true);
       } else {
-        // not recording call either because the priority was too low or no
-        // recorders were available
-        return false;
+        recorder = source->get_digital_recorder(call);
       }
+    }
 
-      debug_recorder = source->get_debug_recorder();
+    if (!recorder && config.preempt_calls && (priority != -1)) {
+      recorder = preempt_recorder(call, source, analog, priority);
+    }
 
-      if (debug_recorder) {
-        debug_recorder->start(call);
-        call->set_debug_recorder(debug_recorder);
-        call->set_debug_recording(true);
-        plugman_setup_recorder(debug_recorder);
-        recorder_found = true;
-      } else {
-        // BOOST_LOG_TRIVIAL(info) << "\tNot debug recording call";
+    if (recorder) {
+      if (message.meta.length()) {
+        BOOST_LOG_TRIVIAL(trace) << message.meta;
       }
 
-      sigmf_recorder = source->get_sigmf_recorder();
-
-      if (sigmf_recorder) {
-        sigmf_recorder->start(call);
-        call->set_sigmf_recorder(sigmf_recorder);
-        call->set_sigmf_recording(true);
-        plugman_setup_recorder(sigmf_recorder);
+      bool started;
+      {
+        Trace::Span recorder_span("recorder start", call->get_call_num(), TRACE_FLOW_STEP);
+        started = recorder->start(call);
+      }
+      if (started) {
+        call->set_recorder(recorder);
+        call->set_state(RECORDING);
+        plugman_setup_recorder(recorder);
+        call_preemption.add(call, source, analog, priority);
         recorder_found = true;
       } else {
-        // BOOST_LOG_TRIVIAL(info) << "\tNot SIGMF recording call";
+        call->set_state(MONITORING);
+        // call->set_monitoring_state(NO_SOURCE);
+        recorder_found = false;
+        return false;
       }
+    } else {
+      // not recording call either because the priority was too low or no
+      // recorders were available
+      dispatch_to_voice_node(call, message, talkgroup, analog);
+      return false;
+    }
 
-      if (recorder_found) {
-        // recording successfully started.
-        return true;
-      }
+    debug_recorder = source->get_debug_recorder();
+
+    if (debug_recorder) {
+      debug_recorder->start(call);
+      call->set_debug_recorder(debug_recorder);
+      call->set_debug_recording(true);
+      plugman_setup_recorder(debug_recorder);
+      recorder_found = true;
+    } else {
+      // BOOST_LOG_TRIVIAL(info) << "\tNot debug recording call";
+    }
+
+    sigmf_recorder = source->get_sigmf_recorder();
+
+    if (sigmf_recorder) {
+      sigmf_recorder->start(call);
+      call->set_sigmf_recorder(sigmf_recorder);
+      call->set_sigmf_recording(true);
+      plugman_setup_recorder(sigmf_recorder);
+      recorder_found = true;
+    } else {
+      // BOOST_LOG_TRIVIAL(info) << "\tNot SIGMF recording call";
+    }
+
+    if (recorder_found) {
+      // recording successfully started.
+      return true;
     }
   }
 
   if (!source_found) {
+    if (dispatch_to_voice_node(call, message, talkgroup, analog)) {
+      return false;
+    }
     call->set_state(MONITORING);
     call->set_monitoring_state(NO_SOURCE);
     std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
@@ -222,7 +431,7 @@ void print_status(std::vector<Source *> &sources, std::vector<System *> &systems
     if ((sys->get_system_type() != "conventional") && (sys->get_system_type() != "conventionalP25") && (sys->get_system_type() != "conventionalDMR") && (sys->get_system_type() != "conventionalSIGMF")) {
       BOOST_LOG_TRIVIAL(info) << "[" << sys->get_short_name() << "]\t" << format_freq(sys->get_current_control_channel()) << "\t" << sys->get_decode_rate() << " msg/sec";
       
-      if ((sys->get_source()->get_autotune_source()) && (sys->get_system_type() == "p25")) {
+      if (sys->get_source() && (sys->get_source()->get_autotune_source()) && (sys->get_system_type() == "p25")) {
         // If control channel source has autotune enabled, perform autotune adjustments and log to console
         autotune_control_channel(sys);
       }
@@ -230,11 +439,37 @@ void print_status(std::vector<Source *> &sources, std::vector<System *> &systems
   }
 
   BOOST_LOG_TRIVIAL(info) << "Recorders: ";
+  Flowgraph_Profiler::update_recorder_cpu();
 
   for (vector<Source *>::iterator it = sources.begin(); it != sources.end(); it++) {
     Source *source = *it;
     source->print_recorders();
   }
+
+  Wav_Writer::print_stats();
+  if (plugman_wants(PLUGIN_HOOK_WAV_WRITER_STATS)) {
+    plugman_wav_writer_stats(Wav_Writer::get_stats());
+  }
+  Call_Latency::print_stats();
+  if (plugman_wants(PLUGIN_HOOK_CALL_LATENCY)) {
+    plugman_call_latency(Call_Latency::get_stats());
+  }
+  Pre_Tuner::print_stats();
+  Cluster::print_stats();
+  Stage_Latency::print_stats();
+  if (plugman_wants(PLUGIN_HOOK_CONCLUDER_LOAD)) {
+    plugman_concluder_load(Call_Concluder::get_load());
+  }
+  Call_Concluder::print_stats();
+  Admission_Control::print_stats();
+  Memory_Stats memory = Memory_Report::get_stats(sources, systems);
+  Memory_Report::print_stats(memory);
+  if (plugman_wants(PLUGIN_HOOK_MEMORY_USAGE)) {
+    plugman_memory_usage(memory);
+  }
+
+  plugman_print_dispatch_stats();
+  Flowgraph_Profiler::print_report();
 }
 
 void manage_conventional_call(Call *call, Config &config) {
@@ -290,24 +525,37 @@ void manage_conventional_call(Call *call, Config &config) {
   }
 }
 
+// Arms call for the first second it could time out in, the first one
+// manage_calls() would find it past config.call_timeout
+static void arm_call_timeout(Call *call, Config &config) {
+  double since = call->since_last_update();
+  if (call->get_state() == RECORDING) {
+    since = std::min(since, call->get_recorder()->since_last_write());
+  }
+  time_t wait = (time_t)floor(config.call_timeout - since) + 1;
+  call_timeouts.arm(call, Replay_Clock::now() + std::max(wait, (time_t)1));
+}
+
 void manage_calls(Config &config, std::vector<Call *> &calls) {
-  bool ended_call = false;
-  for (vector<Call *>::iterator it = calls.begin(); it != calls.end();) {
-    Call *call = *it;
-    State state = call->get_state();
-    // Handle Conventional Calls
-    if (call->is_conventional()) {
-      manage_conventional_call(call, config);
-      ++it;
-      continue;
+  // Handle Conventional Calls
+  for (vector<Call *>::iterator it = conventional_calls.begin(); it != conventional_calls.end(); ++it) {
+    if ((*it)->get_system()->get_enabled()) {
+      manage_conventional_call(*it, config);
     }
+  }
+
+  // Handle Trunked Calls, the ones that might have timed out
+  static std::vector<Call *> expired;
+  std::vector<Call *> ended;
+  expired.clear();
+  call_timeouts.expire(Replay_Clock::now(), expired);
 
-    // Handle Trunked Calls
+  for (vector<Call *>::iterator it = expired.begin(); it != expired.end(); ++it) {
+    Call *call = *it;
+    State state = call->get_state();
 
     if ((state == MONITORING) && (call->since_last_update() > config.call_timeout)) {
-      ended_call = true;
-      it = calls.erase(it);
-      delete call;
+      ended.push_back(call);
       continue;
     }
 
@@ -318,27 +566,40 @@ void manage_calls(Config &config, std::vector<Call *> &calls) {
       // - there hasn't been an UPDATE for it on the Control Channel in X seconds AND the recorder hasn't written anything in X seconds
 
       if ((recorder->since_last_write() > config.call_timeout) && (call->since_last_update() > config.call_timeout)) {
-        std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
-        BOOST_LOG_TRIVIAL(trace) << loghdr << "\u001b[36m Stopping Call because of Recorder \u001b[0m Rec last write: " << recorder->since_last_write() << " State: " << format_state(recorder->get_state());
+        BOOST_LOG_TRIVIAL(trace) << log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq()) << "\u001b[36m Stopping Call because of Recorder \u001b[0m Rec last write: " << recorder->since_last_write() << " State: " << format_state(recorder->get_state());
         call->conclude_call();
-        // The State of the Recorders has changed, so lets send an update
-        ended_call = true;
         if (recorder != NULL) {
           plugman_setup_recorder(recorder);
         }
-        it = calls.erase(it);
-        delete call;
+        ended.push_back(call);
         continue;
       }
     } else if (call->since_last_update() > config.call_timeout) {
       Recorder *recorder = call->get_recorder();
-      std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "\u001b[36m  Call UPDATEs has been inactive for more than " << config.call_timeout << " Sec \u001b[0m Rec last write: " << recorder->since_last_write() << " State: " << format_state(recorder->get_state());
+      BOOST_LOG_TRIVIAL(trace) << log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq()) << "\u001b[36m  Call UPDATEs has been inactive for more than " << config.call_timeout << " Sec \u001b[0m Rec last write: " << recorder->since_last_write() << " State: " << format_state(recorder->get_state());
+    }
+    arm_call_timeout(call, config);
+  }
+
+  if (!ended.empty()) {
+    // One pass over the calls, rather than an erase from the middle of them
+    // for each one that ended
+    std::sort(ended.begin(), ended.end());
+    calls.erase(std::remove_if(calls.begin(), calls.end(), [&](Call *call) {
+                  return std::binary_search(ended.begin(), ended.end(), call);
+                }),
+                calls.end());
+    for (vector<Call *>::iterator it = ended.begin(); it != ended.end(); ++it) {
+      call_index.remove(*it);
+      call_preemption.remove(*it);
+      Channel_Occupancy::release(*it);
+      Cluster::release(*it);
+      plugman_release_call(*it);
+      delete *it;
     }
-    ++it;
-  } // foreach loggers
 
-  if (ended_call) {
+    // The State of the Recorders has changed, so lets send an update
+    Flowgraph_Profiler::update_recorder_cpu();
     plugman_calls_active(calls);
   }
 }
@@ -358,37 +619,81 @@ void current_system_sysid(TrunkMessage message, System *sys) {
 }
 
 void unit_registration(System *sys, long source_id) {
+  Unit_Activity::record(sys, source_id, -1, Unit_Activity::REGISTRATION);
   plugman_unit_registration(sys, source_id);
 }
 
 void unit_deregistration(System *sys, long source_id) {
+  Unit_Activity::record(sys, source_id, -1, Unit_Activity::DEREGISTRATION);
   plugman_unit_deregistration(sys, source_id);
 }
 
 void unit_acknowledge_response(System *sys, long source_id) {
+  Unit_Activity::record(sys, source_id, -1, Unit_Activity::ACKNOWLEDGE);
   plugman_unit_acknowledge_response(sys, source_id);
 }
 
 void unit_group_affiliation(System *sys, long source_id, long talkgroup_num) {
+  Unit_Activity::record(sys, source_id, talkgroup_num, Unit_Activity::AFFILIATION);
   plugman_unit_group_affiliation(sys, source_id, talkgroup_num);
 }
 
 void unit_data_grant(System *sys, long source_id) {
+  Unit_Activity::record(sys, source_id, -1, Unit_Activity::DATA_GRANT);
   plugman_unit_data_grant(sys, source_id);
 }
 
 void unit_answer_request(System *sys, long source_id, long talkgroup) {
+  Unit_Activity::record(sys, source_id, talkgroup, Unit_Activity::ANSWER_REQUEST);
   plugman_unit_answer_request(sys, source_id, talkgroup);
 }
 
 void unit_location(System *sys, long source_id, long talkgroup_num) {
+  Unit_Activity::record(sys, source_id, talkgroup_num, Unit_Activity::LOCATION);
   plugman_unit_location(sys, source_id, talkgroup_num);
 }
 
 
 
 
+// A better site has to decode its control channel this much faster to take
+// a call over, so two sites that are about as good don't trade it back and
+// forth
+static const double BEST_SITE_MARGIN = 1.25;
+
+// Whether the site of sys is enough better than the one recording call to
+// take it over. Control channels aren't squelched, so there is no RSSI for
+// them; how many messages a second a control channel decodes goes down with
+// its signal and stands in for it. Only the start of a call can move, for
+// multiSiteWindow seconds after its grant.
+static bool better_site(System *sys, Call *call, Config &config) {
+  if (config.multi_site_window <= 0) {
+    return false;
+  }
+  std::int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  if ((now - call->get_latency_mark(LATENCY_GRANT)) > config.multi_site_window * 1000000) {
+    return false;
+  }
+  int decode_rate = sys->get_decode_rate();
+  int call_decode_rate = call->get_system()->get_decode_rate();
+  return (decode_rate > 0) && (decode_rate > call_decode_rate * BEST_SITE_MARGIN);
+}
+
+static Duplicate_Grant make_duplicate_grant(System *sys, long source, bool superseded) {
+  Duplicate_Grant grant;
+  grant.short_name = sys->get_short_name();
+  grant.sys_num = sys->get_sys_num();
+  grant.nac = sys->get_nac();
+  grant.rfss_site = sys->get_sys_rfss() * 10000 + sys->get_sys_site_id();
+  grant.source = source;
+  grant.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  grant.decode_rate = sys->get_decode_rate();
+  grant.superseded = superseded;
+  return grant;
+}
+
 void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Config &config, std::vector<Source *> &sources, std::vector<Call *> &calls) {
+  Trace::Span span("handle_call_grant");
   bool call_found = false;
   bool duplicate_grant = false;
   bool superseding_grant = false;
@@ -415,60 +720,67 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
     message_preferredNAC = message_talkgroup->get_preferredNAC();
   }
 
-  for (vector<Call *>::iterator it = calls.begin(); it != calls.end();) {
+  // Multi-Site P25: the same grant, for the same unit, from another site of
+  // the same WACN and System ID that is already recording it
+  bool best_site = false;
+  if (sys->get_multiSite() && (sys->get_multiSiteSystemName() == "")) {
+    sys_rfss_site = sys->get_sys_rfss() * 10000 + sys->get_sys_site_id();
+    const std::vector<Call *> &grant_calls = call_index.find_grant(sys->get_wacn(), sys->get_sys_id(), message.talkgroup, message.source);
+    for (vector<Call *>::const_iterator it = grant_calls.begin(); it != grant_calls.end(); ++it) {
+      Call *call = *it;
+      System *call_sys = call->get_system();
+      call_rfss_site = call_sys->get_sys_rfss() * 10000 + call_sys->get_sys_site_id();
+      if ((call->get_sys_num() == message.sys_num) || (sys_rfss_site == call_rfss_site) || (call_sys->get_multiSiteSystemName() != "") || (call->get_state() != RECORDING)) {
+        continue;
+      }
+
+      duplicate_grant = true;
+      original_call = call;
+
+      unsigned long call_preferredNAC = 0;
+      Talkgroup *call_talkgroup = call_sys->find_talkgroup(message.talkgroup);
+      if (call_talkgroup) {
+        call_preferredNAC = call_talkgroup->get_preferredNAC();
+      }
+
+      // Evaluate superseding grants by comparing call NAC or RFSS-Site against preferred NAC/site in talkgroup .csv
+      if ((call_preferredNAC != call_sys->get_nac()) && (message_preferredNAC == sys->get_nac())) {
+        superseding_grant = true;
+      } else if ((call_preferredNAC != call_rfss_site) && (message_preferredNAC == sys_rfss_site)) {
+        superseding_grant = true;
+      } else if (!message_preferredNAC && better_site(sys, call, config)) {
+        superseding_grant = true;
+        best_site = true;
+      }
+      break;
+    }
+  }
+
+  // Only Calls on the same talkgroup can be a duplicate or the call this message is for
+  const std::vector<Call *> &talkgroup_calls = call_index.find_talkgroup(message.talkgroup);
+  for (vector<Call *>::const_iterator it = talkgroup_calls.begin(); it != talkgroup_calls.end(); ++it) {
     Call *call = *it;
 
     /* This is for Multi-Site support */
-    // Find candidate duplicate calls with the same talkgroup and different multisite-enabled systems
-    if (call->get_talkgroup() == message.talkgroup) {
-      if (call->get_sys_num() != message.sys_num) {
-        if (call->get_system()->get_multiSite() && sys->get_multiSite()) {
-          if (call->get_system()->get_wacn() == sys->get_wacn()) {
-            // Default mode to match WACN and use RFSS/Site to identify duplicate calls
-            sys_rfss_site = sys->get_sys_rfss() * 10000 + sys->get_sys_site_id();
-            call_rfss_site = call->get_system()->get_sys_rfss() * 10000 + call->get_system()->get_sys_site_id();
-            if ((sys_rfss_site != call_rfss_site) && (call->get_system()->get_multiSiteSystemName() == "")) {
-              if (call->get_state() == RECORDING) {
-
-                duplicate_grant = true;
-                original_call = call;
-
-                unsigned long call_preferredNAC = 0;
-                Talkgroup *call_talkgroup = call->get_system()->find_talkgroup(message.talkgroup);
-                if (call_talkgroup) {
-                  call_preferredNAC = call_talkgroup->get_preferredNAC();
-                }
-
-                // Evaluate superseding grants by comparing call NAC or RFSS-Site against preferred NAC/site in talkgroup .csv
-                if ((call_preferredNAC != call->get_system()->get_nac()) && (message_preferredNAC == sys->get_nac())) {
-                  superseding_grant = true;
-                } else if ((call_preferredNAC != call_rfss_site) && (message_preferredNAC == sys_rfss_site)) {
-                  superseding_grant = true;
-                }
-              }
+    // Multi-Site systems matched by multiSiteSystemName use multiSiteSystemNumber to identify duplicate calls.
+    // We check that the multiSiteSystemName is present, and that the Call and System multiSiteSystemNames are the same.
+    if ((call->get_talkgroup() == message.talkgroup) && (call->get_sys_num() != message.sys_num) && !duplicate_grant) {
+      if (call->get_system()->get_multiSite() && sys->get_multiSite() && (call->get_system()->get_wacn() == sys->get_wacn())) {
+        if ((call->get_system()->get_multiSiteSystemName() != "") && (call->get_system()->get_multiSiteSystemName() == sys->get_multiSiteSystemName())) {
+          if (call->get_state() == RECORDING) {
+
+            duplicate_grant = true;
+            original_call = call;
+
+            unsigned long call_preferredNAC = 0;
+            Talkgroup *call_talkgroup = call->get_system()->find_talkgroup(message.talkgroup);
+            if (call_talkgroup) {
+              call_preferredNAC = call_talkgroup->get_preferredNAC();
             }
 
-            // Secondary mode to match multiSiteSystemName and use multiSiteSystemNumber.
-            // If a multiSiteSystemName has been manually entered;
-            // We already know that Call's system number does not match the message system number.
-            // In this case, we check that the multiSiteSystemName is present, and that the Call and System multiSiteSystemNames are the same.
-            else if ((call->get_system()->get_multiSiteSystemName() != "") && (call->get_system()->get_multiSiteSystemName() == sys->get_multiSiteSystemName())) {
-              if (call->get_state() == RECORDING) {
-
-                duplicate_grant = true;
-                original_call = call;
-
-                unsigned long call_preferredNAC = 0;
-                Talkgroup *call_talkgroup = call->get_system()->find_talkgroup(message.talkgroup);
-                if (call_talkgroup) {
-                  call_preferredNAC = call_talkgroup->get_preferredNAC();
-                }
-
-                if ((call->get_system()->get_multiSiteSystemNumber() != 0) && (sys->get_multiSiteSystemNumber() != 0)) {
-                  if ((call_preferredNAC != call->get_system()->get_multiSiteSystemNumber()) && (message_preferredNAC == sys->get_multiSiteSystemNumber())) {
-                    superseding_grant = true;
-                  }
-                }
+            if ((call->get_system()->get_multiSiteSystemNumber() != 0) && (sys->get_multiSiteSystemNumber() != 0)) {
+              if ((call_preferredNAC != call->get_system()->get_multiSiteSystemNumber()) && (message_preferredNAC == sys->get_multiSiteSystemNumber())) {
+                superseding_grant = true;
               }
             }
           }
@@ -479,10 +791,21 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
     if ((call->get_talkgroup() == message.talkgroup) && (call->get_sys_num() == message.sys_num) && (call->get_freq() == message.freq) && (call->get_tdma_slot() == message.tdma_slot) && (call->get_phase2_tdma() == message.phase2_tdma)) {
       call_found = true;
       bool source_updated = call->update(message);
-      if (source_updated) {
+      Channel_Occupancy::update(call);
+      if (Admission_Control::can_retry(call) && start_recorder(call, message, config, sys, sources)) {
+        Admission_Control::count_resumed(sys);
+        BOOST_LOG_TRIVIAL(info) << log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq()) << "\u001b[36mRecording after being deferred\u001b[0m for " << call->elapsed() << " s";
+        plugman_call_start(call);
+      } else if (source_updated) {
         plugman_call_start(call);
       }
+      Cluster::update(call, message);
     }
+  }
+
+  const std::vector<Call *> &channel_calls = call_index.find_channel(message.sys_num, message.freq, message.tdma_slot);
+  for (vector<Call *>::const_iterator it = channel_calls.begin(); it != channel_calls.end(); ++it) {
+    Call *call = *it;
 
     // There is an existing call on freq and slot that the new call will be started on. We should stop the older call. The older recorder will
     // keep writing to the file until it hits a termination flag, so no packets should be dropped.
@@ -492,15 +815,13 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
       if (recorder != NULL) {
         recorder_state = format_state(recorder->get_state());
       }
-      std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
-      BOOST_LOG_TRIVIAL(trace) << loghdr << "\u001b[36mShould be Stopping RECORDING call, Recorder State: " << recorder_state << " RX overlapping TG message Freq, TG:" << message.talkgroup << "\u001b[0m";
+      BOOST_LOG_TRIVIAL(trace) << log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq()) << "\u001b[36mShould be Stopping RECORDING call, Recorder State: " << recorder_state << " RX overlapping TG message Freq, TG:" << message.talkgroup << "\u001b[0m";
     }
-
-    it++;
   }
 
   if (!call_found) {
     Call *call = Call::make(message, sys, config);
+    span.set_call(call->get_call_num(), TRACE_FLOW_START);
 
     Talkgroup *talkgroup = sys->find_talkgroup(call->get_talkgroup());
 
@@ -509,6 +830,8 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
     } else {
       call->set_talkgroup_tag("-");
     }
+    bool analog = talkgroup ? (talkgroup->mode.compare("A") == 0) : ((config.default_mode == "analog") && (sys->get_system_type() == "smartnet"));
+    Pre_Tuner::grant(sys, call->get_freq(), analog);
 
     boost::format original_call_data;
     boost::format grant_call_data;
@@ -525,11 +848,18 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
     if (superseding_grant) {
       std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
 
-      BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[36mSuperseding Grant\u001b[0m - Stopping original call: " << original_call_data << "- Superseding call: " << grant_call_data;
+      BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[36mSuperseding Grant\u001b[0m" << (best_site ? " from a better site" : "") << " - Stopping original call: " << original_call_data << "- Superseding call: " << grant_call_data;
       // Attempt to start a new call on the preferred NAC.
       recording_started = start_recorder(call, message, config, sys, sources);
 
       if (recording_started) {
+        // The new call carries the sites that were passed over, the original among them
+        std::vector<Duplicate_Grant> duplicates = original_call->get_duplicate_grants();
+        for (std::vector<Duplicate_Grant>::iterator grant_it = duplicates.begin(); grant_it != duplicates.end(); ++grant_it) {
+          call->add_duplicate_grant(*grant_it);
+        }
+        call->add_duplicate_grant(make_duplicate_grant(original_call->get_system(), original_call->get_current_source_id(), true));
+
         // Clean up the original call.
         original_call->set_state(MONITORING);
         original_call->set_monitoring_state(SUPERSEDED);
@@ -537,11 +867,13 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
       } else {
 
         BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[36mCould not start Superseding recorder.\u001b[0m Continuing original call: " << original_call->get_call_num() << "C";
+        original_call->add_duplicate_grant(make_duplicate_grant(sys, message.source, false));
       }
     } else if (duplicate_grant) {
       std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
       call->set_state(MONITORING);
       call->set_monitoring_state(DUPLICATE);
+      original_call->add_duplicate_grant(make_duplicate_grant(sys, message.source, false));
       BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[36mDuplicate Grant\u001b[0m - Not recording: " << grant_call_data << "- Original call: " << original_call_data;
     } else {
       recording_started = start_recorder(call, message, config, sys, sources);
@@ -551,7 +883,11 @@ void handle_call_grant(TrunkMessage message, System *sys, bool grant_message, Co
       }
     }
     calls.push_back(call);
+    call_index.add(call);
+    Channel_Occupancy::grant(call);
+    arm_call_timeout(call, config);
     plugman_call_start(call);
+    Flowgraph_Profiler::update_recorder_cpu();
     plugman_calls_active(calls);
   }
 }
@@ -567,7 +903,8 @@ void handle_call_update(TrunkMessage message, System *sys, std::vector<Call *> &
   going until it gets a termination flag.
   */
 
-  for (vector<Call *>::iterator it = calls.begin(); it != calls.end(); ++it) {
+  const std::vector<Call *> &talkgroup_calls = call_index.find_talkgroup(message.talkgroup);
+  for (vector<Call *>::const_iterator it = talkgroup_calls.begin(); it != talkgroup_calls.end(); ++it) {
     Call *call = *it;
 
     // BOOST_LOG_TRIVIAL(info) << "TG: " << call->get_talkgroup() << " | " << message.talkgroup << " sys num: " << call->get_sys_num() << " | " << message.sys_num << " freq: " << call->get_freq() << " | " << message.freq << " TDMA Slot" << call->get_tdma_slot() << " | " << message.tdma_slot << " TDMA: " << call->get_phase2_tdma() << " | " << message.phase2_tdma;
@@ -584,9 +921,11 @@ void handle_call_update(TrunkMessage message, System *sys, std::vector<Call *> &
       }
 
       bool source_updated = call->update(message);
+      Channel_Occupancy::update(call);
       if (source_updated) {
         plugman_call_start(call);
       }
+      Cluster::update(call, message);
     }
   }
 
@@ -596,9 +935,18 @@ void handle_call_update(TrunkMessage message, System *sys, std::vector<Call *> &
   }
 }
 
-void handle_message(std::vector<TrunkMessage> messages, System *sys, Config &config, std::vector<Source *> &sources, std::vector<Call *> &calls, gr::top_block_sptr &tb) {
-  for (std::vector<TrunkMessage>::iterator it = messages.begin(); it != messages.end(); it++) {
-    TrunkMessage message = *it;
+void handle_message(const std::vector<TrunkMessage> &messages, System *sys, Config &config, std::vector<Source *> &sources, std::vector<Call *> &calls, gr::top_block_sptr &tb) {
+  // A System turned off through the Control API is handled the same way
+  bool control_channel_only = sys->get_control_channel_only() || !sys->get_enabled();
+
+  for (std::vector<TrunkMessage>::const_iterator it = messages.begin(); it != messages.end(); it++) {
+    const TrunkMessage &message = *it;
+
+    // A Control Channel Only system never makes Calls, only the unit and
+    // system activity is passed on
+    if (control_channel_only && ((message.message_type == GRANT) || (message.message_type == UPDATE) || (message.message_type == UU_V_GRANT) || (message.message_type == UU_V_UPDATE))) {
+      continue;
+    }
 
     switch (message.message_type) {
     case GRANT:
@@ -694,11 +1042,11 @@ void handle_message(std::vector<TrunkMessage> messages, System *sys, Config &con
   }
 }
 
-void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &sources) {
-  System_impl *system = (System_impl *)sys;
+// Moves the System's control channel chain to control_channel_freq, on
+// another Source if the one it is on doesn't cover it
+static void tune_control_channel(System_impl *system, double control_channel_freq, gr::top_block_sptr &tb, std::vector<Source *> &sources) {
   bool source_found = false;
   Source *current_source = system->get_source();
-  double control_channel_freq = system->get_next_control_channel();
 
   BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "] Retuning to Control Channel: " << format_freq(control_channel_freq);
 
@@ -729,9 +1077,11 @@ void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &s
           system->set_source(source);
           // We must lock the flow graph in order to disconnect and reconnect blocks
           tb->lock();
-          tb->disconnect(current_source->get_src_block(), 0, system->smartnet_trunking, 0);
-          system->smartnet_trunking = smartnet_impl::make(control_channel_freq, source->get_center(), source->get_rate(), system->get_msg_queue(), system->get_sys_num());
-          tb->connect(source->get_src_block(), 0, system->smartnet_trunking, 0);
+          current_source->disconnect_output(tb, system->smartnet_trunking);
+          system->smartnet_trunking = smartnet_impl::make(control_channel_freq, source->get_center(), source->get_rate(), system->get_msg_queue(), system->get_sys_num(), system->get_control_iq_ring_seconds());
+          system->smartnet_trunking->set_fft_threads(source->get_fft_threads());
+          source->pin_block(system->smartnet_trunking);
+          source->connect_output(tb, system->smartnet_trunking);
           tb->unlock();
           //system->smartnet_trunking->reset();
         } else if (system->get_system_type() == "p25") {
@@ -741,9 +1091,11 @@ void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &s
           //   If there are unexplained issues around control channel tuning, we should look at alternet
           //   approaches. See PR #1090 )
           tb->lock();
-          tb->disconnect(current_source->get_src_block(), 0, system->p25_trunking, 0);
-          system->p25_trunking = make_p25_trunking(control_channel_freq, source->get_center(), source->get_rate(), system->get_msg_queue(), system->get_qpsk_mod(), system->get_sys_num());
-          tb->connect(source->get_src_block(), 0, system->p25_trunking, 0);
+          current_source->disconnect_output(tb, system->p25_trunking);
+          system->p25_trunking = make_p25_trunking(control_channel_freq, source->get_center(), source->get_rate(), system->get_msg_queue(), system->get_qpsk_mod(), system->get_sys_num(), system->get_control_iq_ring_seconds());
+          system->p25_trunking->set_fft_threads(source->get_fft_threads());
+          source->pin_block(system->p25_trunking);
+          source->connect_output(tb, system->p25_trunking);
           tb->unlock();
         } else {
           BOOST_LOG_TRIVIAL(error) << "\t - Unkown system type for Retune";
@@ -765,18 +1117,127 @@ void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &s
   }
 }
 
+void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &sources) {
+  System_impl *system = (System_impl *)sys;
+  tune_control_channel(system, system->get_next_control_channel(), tb, sources);
+}
+
+// The hunts going on, at most one for each System
+static std::map<System *, std::unique_ptr<Control_Channel_Hunt>> control_channel_hunts;
+
+static void hunt_control_channel(System_impl *system, gr::top_block_sptr &tb, std::vector<Source *> &sources) {
+  std::unique_ptr<Control_Channel_Hunt> hunt(new Control_Channel_Hunt(system, tb, sources));
+  if (hunt->probe_count() == 0) {
+    retune_system(system, tb, sources);
+    return;
+  }
+  control_channel_hunts[system] = std::move(hunt);
+}
+
+// Retunes a System once its hunt has found a control channel that is up
+static void check_control_channel_hunts(gr::top_block_sptr &tb, std::vector<Source *> &sources) {
+  std::map<System *, std::unique_ptr<Control_Channel_Hunt>>::iterator it = control_channel_hunts.begin();
+  while (it != control_channel_hunts.end()) {
+    if (!it->second->poll()) {
+      ++it;
+      continue;
+    }
+    System_impl *system = (System_impl *)it->first;
+    double control_channel_freq = it->second->get_winner();
+
+    // The probes come off the flowgraph before the System's chain is moved
+    it = control_channel_hunts.erase(it);
+    if (control_channel_freq != 0) {
+      system->set_current_control_channel(control_channel_freq);
+      tune_control_channel(system, control_channel_freq, tb, sources);
+      system->message_count = 0;
+    }
+  }
+}
+
+// The first time a System's decode rate falls below controlIqDumpRate,
+// before anything retunes it, what its control channel ring holds is saved
+// to control_iq/ in the captureDir, with a config that plays it back
+// through the parser and writes the messages for cc-replay
+static void dump_control_iq(System_impl *sys, int msgs_decoded_per_second, Config &config) {
+  if (sys->get_control_iq_ring_seconds() <= 0) {
+    return;
+  }
+  if (msgs_decoded_per_second >= sys->get_control_iq_dump_rate()) {
+    sys->control_iq_dumped = false;
+    return;
+  }
+  if (sys->control_iq_dumped || !sys->get_source()) {
+    return;
+  }
+  sys->control_iq_dumped = true;
+
+  Source *source = sys->get_source();
+  double freq = sys->get_current_control_channel();
+  time_t now = Replay_Clock::now();
+  char timestamp[sizeof "20111008-070709"];
+  strftime(timestamp, sizeof timestamp, "%Y%m%d-%H%M%S", localtime(&now));
+  std::string base = config.capture_dir + "/control_iq/" + sys->get_short_name() + "-" + timestamp + "-" + std::to_string((long)freq);
+  std::string hw = source->get_driver() + ": " + source->get_device() + " - " + source->get_antenna();
+
+  bool saved = false;
+  if ((sys->get_system_type() == "smartnet") && sys->smartnet_trunking) {
+    saved = sys->smartnet_trunking->snapshot_iq(base, hw, source->get_num());
+  } else if ((sys->get_system_type() == "p25") && sys->p25_trunking) {
+    saved = sys->p25_trunking->snapshot_iq(base, hw, source->get_num());
+  }
+  if (!saved) {
+    return;
+  }
+
+  nlohmann::json system = {{"shortName", sys->get_short_name()},
+                           {"type", sys->get_system_type()},
+                           {"control_channels", {freq}},
+                           {"modulation", sys->get_qpsk_mod() ? "qpsk" : "fsk4"}};
+  if (sys->get_system_type() == "smartnet") {
+    system["bandplan"] = sys->get_bandplan();
+    system["bandplanBase"] = sys->get_bandplan_base();
+    system["bandplanHigh"] = sys->get_bandplan_high();
+    system["bandplanSpacing"] = sys->get_bandplan_spacing();
+    system["bandplanOffset"] = sys->get_bandplan_offset();
+  }
+  nlohmann::json replay = {{"ver", 2},
+                           {"captureDir", base + "-replay"},
+                           {"controlChannelCapture", base + ".capture"},
+                           {"sources", {{{"driver", "sigmf"}, {"sigmfMeta", base + ".sigmf-meta"}, {"replaySpeed", 0}, {"digitalRecorders", 0}}}},
+                           {"systems", {system}}};
+  std::ofstream file(base + ".replay.json");
+  file << replay.dump(2) << std::endl;
+  BOOST_LOG_TRIVIAL(error) << "[" << sys->get_short_name() << "]\tControl Channel Decode Rate: " << msgs_decoded_per_second << "/sec, saved its IQ to " << base << ".sigmf-meta";
+}
+
 void check_message_count(float timeDiff, Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<System *> &systems) {
   plugman_setup_config(sources, systems);
   plugman_system_rates(systems, timeDiff);
 
+  for (std::vector<Source *>::iterator it = sources.begin(); it != sources.end(); ++it) {
+    Source *source = *it;
+    source->update_stats(timeDiff);
+  }
+  plugman_source_rates(sources, timeDiff);
+  Admission_Control::update(sources, timeDiff);
+
   for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
     System_impl *sys = (System_impl *)*it;
 
     if ((sys->get_system_type() != "conventional") && (sys->get_system_type() != "conventionalP25") && (sys->get_system_type() != "conventionalDMR") && (sys->get_system_type() != "conventionalSIGMF")) {
+      // A voice node of a cluster has no control channel of its own
+      if (Cluster::is_voice()) {
+        continue;
+      }
       int msgs_decoded_per_second = std::floor(sys->message_count / timeDiff);
       sys->set_decode_rate(msgs_decoded_per_second);
+      dump_control_iq(sys, msgs_decoded_per_second, config);
 
-      if (msgs_decoded_per_second < 2) {
+      if ((msgs_decoded_per_second < 2) && Admission_Control::saturated(sys->get_source())) {
+        // Another control channel would be starved the same way
+        BOOST_LOG_TRIVIAL(error) << "[" << sys->get_short_name() << "]\tControl channel decode rate is low while over the CPU budget, not retuning";
+      } else if (msgs_decoded_per_second < 2) {
 
         // if it loses track of the control channel, quit after a while
         if (config.control_retune_limit > 0) {
@@ -790,7 +1251,12 @@ void check_message_count(float timeDiff, Config &config, gr::top_block_sptr &tb,
           }
         }
         if (sys->control_channel_count() > 1) {
-          retune_system(sys, tb, sources);
+          // A hunt that is still going on is left to finish
+          if (!config.control_channel_hunt) {
+            retune_system(sys, tb, sources);
+          } else if (!control_channel_hunts.count(sys)) {
+            hunt_control_channel(sys, tb, sources);
+          }
         } else {
           BOOST_LOG_TRIVIAL(error) << "[" << sys->get_short_name() << "]\tThere is only one control channel defined";
         }
@@ -829,60 +1295,604 @@ void process_message_queues(std::vector<System *> &systems) {
   }
 }
 
+// The recorder found the voice on the channel encrypted, though the grant
+// didn't say so. What it has recorded is concluded and the recorder is
+// freed, and the call is monitored until the UPDATEs for it stop, like
+// one that was granted encrypted.
+static void stop_encrypted_call(Call *call) {
+  System *sys = call->get_system();
+  Recorder *recorder = call->get_recorder();
+  if (sys->get_hideEncrypted() == false) {
+    std::string loghdr = log_header( sys->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[31mStopping Recording: ENCRYPTED\u001b[0m - found on the voice channel";
+  }
+  call->conclude_call();
+  if (recorder != NULL) {
+    plugman_setup_recorder(recorder);
+  }
+  call->set_state(MONITORING);
+  call->set_monitoring_state(ENCRYPTED);
+}
+
 // Process message queues for recorders associated with Calls
 void process_recorder_message_queues(std::vector<Call *> &calls) {
+  bool stopped = false;
   for (vector<Call *>::iterator it = calls.begin(); it != calls.end(); ++it) {
     Call *call = *it;
     if (call->get_state() == RECORDING) {
       Recorder *recorder = call->get_recorder();
       if (recorder && (recorder->get_type() == P25 || recorder->get_type() == P25C)) {
-        p25_recorder *p25_rec = dynamic_cast<p25_recorder *>(recorder);
         // Verify recorder status as conventionals calls may be in a RECORDING:IDLE state
-        if (p25_rec && (p25_rec->is_active())) {
-          p25_rec->process_message_queues();
+        // This may be a p25_slot_recorder, which isn't a p25_recorder
+        if (recorder->is_active()) {
+          recorder->process_message_queues();
+        }
+        if (call->get_encrypted() && !call->is_conventional() && !call->get_system()->get_monitorEncrypted()) {
+          stop_encrypted_call(call);
+          stopped = true;
+          continue;
+        }
+      }
+      // Signalling decoded on trunked analog calls; conventional recorders are handled by process_message_queues()
+      if (recorder && (recorder->get_type() == ANALOG)) {
+        analog_recorder *analog_rec = dynamic_cast<analog_recorder *>(recorder);
+        if (analog_rec && (analog_rec->is_active())) {
+          analog_rec->process_message_queues();
+        }
+      }
+    }
+  }
+
+  if (stopped) {
+    Flowgraph_Profiler::update_recorder_cpu();
+    plugman_calls_active(calls);
+  }
+}
+
+void report_tone_scan() {
+  std::vector<Tone_Scan_Result> results = Tone_Scanner::get_results();
+
+  for (std::vector<Tone_Scan_Result>::iterator it = results.begin(); it != results.end(); ++it) {
+    if (it->windows == 0) {
+      continue;
+    }
+    if (it->best_count > 0) {
+      BOOST_LOG_TRIVIAL(info) << "[" << it->short_name << "]\tTG: " << it->talkgroup << " Freq: " << format_freq(it->freq) << "\tTone Scan: " << it->best_tone << " in " << it->best_count << " of " << it->windows << " sec";
+    } else {
+      BOOST_LOG_TRIVIAL(debug) << "[" << it->short_name << "]\tTG: " << it->talkgroup << " Freq: " << format_freq(it->freq) << "\tTone Scan: no tone in " << it->windows << " sec";
+    }
+  }
+  plugman_tone_scan(results);
+}
+
+// Concludes a Call and forgets it, for callers that decide when calls end
+// on a clock of their own, like utils/cc-replay
+void end_call(Call *call, std::vector<Call *> &calls) {
+  call->conclude_call();
+  call_index.remove(call);
+  call_preemption.remove(call);
+  Channel_Occupancy::release(call);
+  Cluster::release(call);
+  call_timeouts.remove(call);
+  std::vector<Call *>::iterator it = std::find(calls.begin(), calls.end(), call);
+  if (it != calls.end()) {
+    calls.erase(it);
+  }
+  plugman_release_call(call);
+  delete call;
+}
+
+// Times in a row each stalled Source has been reopened
+static std::map<Source *, int> reopen_attempts;
+
+// A Source that has stopped delivering samples has its calls ended, since
+// what they recorded is cut off, and its SDR closed and opened again.
+// Returns false once that has been tried sourceReopenLimit times, or
+// can't be tried at all.
+static bool recover_source(Config &config, gr::top_block_sptr &tb, Source *source, std::vector<Call *> &calls) {
+  int &attempts = reopen_attempts[source];
+  if (!source->can_reopen() || (attempts >= config.source_reopen_limit)) {
+    return false;
+  }
+  attempts++;
+  BOOST_LOG_TRIVIAL(error) << "Source " << source->get_num() << " has stopped receiving samples - Reopening it, attempt " << attempts << " of " << config.source_reopen_limit;
+
+  std::vector<Call *> stalled;
+  for (std::vector<Call *>::iterator it = calls.begin(); it != calls.end(); ++it) {
+    Recorder *recorder = (*it)->get_recorder();
+    if (recorder && (recorder->get_source() == source)) {
+      stalled.push_back(*it);
+    }
+  }
+  for (std::vector<Call *>::iterator it = stalled.begin(); it != stalled.end(); ++it) {
+    end_call(*it, calls);
+  }
+  if (!stalled.empty()) {
+    Flowgraph_Profiler::update_recorder_cpu();
+    plugman_calls_active(calls);
+  }
+
+  source->reopen(tb);
+  return true;
+}
+
+static void dispatch_trunk_messages(const std::vector<TrunkMessage> &trunk_messages, gr::message::sptr msg, System_impl *system, Config &config, std::vector<Source *> &sources, std::vector<Call *> &calls, gr::top_block_sptr &tb) {
+  system->set_message_count(system->get_message_count() + 1);
+  handle_message(trunk_messages, system, config, sources, calls, tb);
+  plugman_trunk_message(trunk_messages, system);
+
+  if (msg->type() == -1) {
+    BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "]\t process_data_unit timeout";
+  }
+}
+
+/* -- Control API, see Control_Api. These run on the main loop. -- */
+
+static Control_Api::Response control_response(int status, const nlohmann::json &body) {
+  Control_Api::Response response;
+  response.status = status;
+  response.body = body.dump();
+  return response;
+}
+
+static Control_Api::Response control_error(int status, const std::string &error) {
+  return control_response(status, nlohmann::json{{"error", error}});
+}
+
+static bool query_number(const Control_Api::Request &request, const std::string &name, double &value) {
+  std::map<std::string, std::string>::const_iterator it = request.query.find(name);
+  if (it == request.query.end()) {
+    return false;
+  }
+  char *end;
+  value = strtod(it->second.c_str(), &end);
+  return !it->second.empty() && (*end == '\0');
+}
+
+static System *find_system(std::vector<System *> &systems, const std::string &short_name) {
+  for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    if ((*it)->get_short_name() == short_name) {
+      return *it;
+    }
+  }
+  return NULL;
+}
+
+static bool is_conventional_system(System *system) {
+  std::string type = system->get_system_type();
+  return (type == "conventional") || (type == "conventionalP25") || (type == "conventionalDMR");
+}
+
+static nlohmann::json control_status(std::vector<Source *> &sources, std::vector<System *> &systems) {
+  nlohmann::json status;
+  status["sources"] = nlohmann::json::array();
+  for (std::vector<Source *>::iterator it = sources.begin(); it != sources.end(); ++it) {
+    Source *source = *it;
+    status["sources"].push_back({{"num", source->get_num()},
+                                 {"center", source->get_center()},
+                                 {"rate", source->get_rate()},
+                                 {"digitalRecorders", source->get_max_recorders(P25)},
+                                 {"digitalAvailable", source->get_num_available_digital_recorders()},
+                                 {"analogRecorders", source->get_max_recorders(ANALOG)},
+                                 {"analogAvailable", source->get_num_available_analog_recorders()}});
+  }
+  status["systems"] = nlohmann::json::array();
+  for (std::vector<System *>::iterator it = systems.begin(); it != systems.end(); ++it) {
+    System *system = *it;
+    nlohmann::json entry = {{"shortName", system->get_short_name()}, {"type", system->get_system_type()}, {"enabled", system->get_enabled()}};
+    if (is_conventional_system(system)) {
+      entry["channels"] = nlohmann::json::array();
+      for (std::vector<Call *>::iterator call_it = conventional_calls.begin(); call_it != conventional_calls.end(); ++call_it) {
+        if ((*call_it)->get_system() == system) {
+          entry["channels"].push_back({{"freq", (*call_it)->get_freq()}, {"talkgroup", (*call_it)->get_talkgroup()}});
         }
       }
     }
+    status["systems"].push_back(entry);
+  }
+  return status;
+}
+
+// POST /sources/<num>/recorders?digital=<n>&analog=<n>
+static Control_Api::Response control_recorders(const Control_Api::Request &request, const std::string &num, std::vector<Source *> &sources) {
+  Source *source = NULL;
+  for (std::vector<Source *>::iterator it = sources.begin(); it != sources.end(); ++it) {
+    if (std::to_string((*it)->get_num()) == num) {
+      source = *it;
+    }
+  }
+  if (!source) {
+    return control_error(404, "no Source " + num);
+  }
+  double digital, analog;
+  bool has_digital = query_number(request, "digital", digital);
+  bool has_analog = query_number(request, "analog", analog);
+  if ((!has_digital && !has_analog) || (has_digital && digital < 0) || (has_analog && analog < 0)) {
+    return control_error(400, "give digital=<count> and/or analog=<count>");
+  }
+  if (has_digital) {
+    source->set_max_recorders(P25, (int)digital);
+  }
+  if (has_analog) {
+    source->set_max_recorders(ANALOG, (int)analog);
+  }
+  return control_response(200, {{"num", source->get_num()}, {"digitalRecorders", source->get_max_recorders(P25)}, {"analogRecorders", source->get_max_recorders(ANALOG)}});
+}
+
+// POST /systems/<shortName>/enable and /disable. The calls of a trunked
+// System are ended, a conventional System's channels are concluded and
+// stopped until it is turned back on.
+static Control_Api::Response control_enable(System *system, bool enabled, std::vector<Call *> &calls) {
+  if (system->get_enabled() == enabled) {
+    return control_response(200, {{"shortName", system->get_short_name()}, {"enabled", enabled}});
+  }
+  system->set_enabled(enabled);
+  BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\t" << (enabled ? "Enabled" : "Disabled") << " through the Control API";
+
+  if (is_conventional_system(system)) {
+    for (std::vector<Call *>::iterator it = conventional_calls.begin(); it != conventional_calls.end(); ++it) {
+      Call *call = *it;
+      if (call->get_system() != system) {
+        continue;
+      }
+      if (!enabled) {
+        call->conclude_call();
+        call->set_state(INACTIVE);
+      } else {
+        call->restart_call();
+        plugman_setup_recorder(call->get_recorder());
+        plugman_call_start(call);
+      }
+    }
+  } else if (!enabled) {
+    std::vector<Call *> ended;
+    for (std::vector<Call *>::iterator it = calls.begin(); it != calls.end(); ++it) {
+      if (((*it)->get_system() == system) && !(*it)->is_conventional()) {
+        ended.push_back(*it);
+      }
+    }
+    for (std::vector<Call *>::iterator it = ended.begin(); it != ended.end(); ++it) {
+      end_call(*it, calls);
+    }
+  }
+  Flowgraph_Profiler::update_recorder_cpu();
+  plugman_calls_active(calls);
+  return control_response(200, {{"shortName", system->get_short_name()}, {"enabled", enabled}});
+}
+
+// POST /systems/<shortName>/channels?freq=<Hz>&talkgroup=<n> adds one, the
+// talkgroup is the row of a channelFile, else the next free number.
+// DELETE with freq or talkgroup removes it.
+static Control_Api::Response control_channel(const Control_Api::Request &request, System *system, Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<Call *> &calls) {
+  if (!is_conventional_system(system)) {
+    return control_error(400, "channels can only be added to or removed from a conventional System");
+  }
+  double freq = 0, talkgroup = 0;
+  bool has_freq = query_number(request, "freq", freq);
+  bool has_talkgroup = query_number(request, "talkgroup", talkgroup);
+
+  if (request.method == "DELETE") {
+    Call *call = NULL;
+    for (std::vector<Call *>::iterator it = conventional_calls.begin(); it != conventional_calls.end(); ++it) {
+      if (((*it)->get_system() == system) && ((has_freq && (fabs((*it)->get_freq() - freq) < 1)) || (has_talkgroup && ((*it)->get_talkgroup() == (long)talkgroup)))) {
+        call = *it;
+        conventional_calls.erase(it);
+        break;
+      }
+    }
+    if (!call) {
+      return control_error(404, "no such channel");
+    }
+    // Every tone or code sharing the channel's recorder goes with it
+    Recorder *recorder = call->get_recorder();
+    double removed_freq = call->get_freq();
+    long removed_talkgroup = call->get_talkgroup();
+    end_call(call, calls);
+    if (recorder) {
+      system->remove_conventional_recorder(recorder);
+      if (recorder->get_source()) {
+        recorder->get_source()->remove_conventional_recorder(tb, recorder);
+      }
+    }
+    BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tRemoved channel " << format_freq(removed_freq) << " Talkgroup: " << removed_talkgroup << " through the Control API";
+    Flowgraph_Profiler::update_recorder_cpu();
+    plugman_calls_active(calls);
+    return control_response(200, {{"shortName", system->get_short_name()}, {"removed", {{"freq", removed_freq}, {"talkgroup", removed_talkgroup}}}});
+  }
+
+  if (request.method != "POST") {
+    return control_error(405, "POST to add a channel, DELETE to remove one");
+  }
+  if (system->has_channel_file()) {
+    Talkgroup *tg = has_talkgroup ? system->find_talkgroup((long)talkgroup) : NULL;
+    if (!tg) {
+      return control_error(400, "give the talkgroup of a row in the System's channelFile");
+    }
+    freq = tg->freq;
+  } else if (!has_freq) {
+    return control_error(400, "give freq=<Hz>");
+  } else if (!has_talkgroup) {
+    talkgroup = 1;
+    for (std::vector<Call *>::iterator it = conventional_calls.begin(); it != conventional_calls.end(); ++it) {
+      if ((*it)->get_system() == system) {
+        talkgroup = std::max(talkgroup, (double)(*it)->get_talkgroup() + 1);
+      }
+    }
+  }
+  for (std::vector<Call *>::iterator it = conventional_calls.begin(); it != conventional_calls.end(); ++it) {
+    if (((*it)->get_system() == system) && ((*it)->get_talkgroup() == (long)talkgroup)) {
+      return control_error(409, "the System already has talkgroup " + std::to_string((long)talkgroup));
+    }
+  }
+
+  // The recorder is made and connected with the flowgraph locked once
+  size_t before = calls.size();
+  tb->lock();
+  bool added = setup_conventional_channel(system, freq, (long)talkgroup, config, tb, sources, calls);
+  tb->unlock();
+  if (!added) {
+    return control_error(400, "no Source covers " + boost::str(format_freq(freq)));
+  }
+  for (size_t i = before; i < calls.size(); i++) {
+    conventional_calls.push_back(calls[i]);
+    call_index.add(calls[i]);
+    if (!system->get_enabled()) {
+      calls[i]->conclude_call();
+      calls[i]->set_state(INACTIVE);
+    }
+  }
+  plugman_calls_active(calls);
+  return control_response(200, {{"shortName", system->get_short_name()}, {"added", {{"freq", freq}, {"talkgroup", (long)talkgroup}}}});
+}
+
+static Control_Api::Response handle_control_request(const Control_Api::Request &request, Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<System *> &systems, std::vector<Call *> &calls) {
+  std::vector<std::string> parts;
+  boost::split(parts, request.path, boost::is_any_of("/"));
+  parts.erase(parts.begin()); // before the leading slash
+
+  if ((parts.size() == 1) && (parts[0] == "status" || parts[0] == "")) {
+    return control_response(200, control_status(sources, systems));
+  }
+  if ((parts.size() == 3) && (parts[0] == "sources") && (parts[2] == "recorders")) {
+    if (request.method != "POST") {
+      return control_error(405, "POST to change the recorders");
+    }
+    return control_recorders(request, parts[1], sources);
+  }
+  if ((parts.size() == 3) && (parts[0] == "systems")) {
+    System *system = find_system(systems, parts[1]);
+    if (!system) {
+      return control_error(404, "no System " + parts[1]);
+    }
+    if ((parts[2] == "enable") || (parts[2] == "disable")) {
+      if (request.method != "POST") {
+        return control_error(405, "POST to " + parts[2] + " a System");
+      }
+      return control_enable(system, parts[2] == "enable", calls);
+    }
+    if (parts[2] == "channels") {
+      return control_channel(request, system, config, tb, sources, calls);
+    }
   }
+  return control_error(404, "unknown request " + request.method + " " + request.path);
 }
 
 int monitor_messages(Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<System *> &systems, std::vector<Call *> &calls) {
   gr::message::sptr msg;
+  System *msg_system;
+  Event_Loop loop;
+  Event_Loop::Clock::time_point last_decode_rate_check = Event_Loop::Clock::now();
+
+  // Guards the calls, the recorders and everything else grants touch. It is
+  // only contended when the systems have their own workers.
+  std::mutex state_mutex;
+
+  // The conventional Calls were made while the systems were set up
+  call_index.rebuild(calls);
+  call_preemption.clear();
+  call_timeouts.clear();
+  conventional_calls.clear();
+  for (vector<Call *>::iterator it = calls.begin(); it != calls.end(); ++it) {
+    if ((*it)->is_conventional()) {
+      conventional_calls.push_back(*it);
+    } else {
+      arm_call_timeout(*it, config);
+    }
+  }
 
-  time_t last_status_time = time(NULL);
-  time_t last_decode_rate_check = time(NULL);
-  time_t management_timestamp = time(NULL);
-  uint64_t last_conventional_channel_detection_check = time_since_epoch_millisec();
-  time_t current_time = time(NULL);
-  uint64_t current_time_ms = time_since_epoch_millisec();
-  std::vector<TrunkMessage> trunk_messages;
-  SmartnetParser *smartnet_parser;
-  P25Parser *p25_parser;
-
+  main_loop = &loop;
   signal(SIGINT, exit_interupt);
   signal(SIGHUP, rotate_log_signal);
+  signal(SIGUSR1, reload_tables_signal);
+
+  for (vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
+    System_impl *system = (System_impl *)*sys_it;
+    // Each system parses its messages with a parser of its own
+    TrunkParser *parser = system->get_parser();
+    if (!parser) {
+      continue;
+    }
+    if (State_Checkpoint::restore(system)) {
+      plugman_setup_system(system);
+    }
+
+    if (!config.system_workers) {
+      loop.watch_queue(system, system->get_msg_queue());
+      continue;
+    }
+
+    // A burst on one system is decoded by its worker while grants on the
+    // others are being handled
+    loop.watch_queue(system, system->get_msg_queue(), [&, parser](System *msg_system, gr::message::sptr msg) {
+      System_impl *system = (System_impl *)msg_system;
+      Message_Capture::record(system, msg);
+      Trace::Span span("message");
+      Trace::Clock::time_point parse_begin = Trace::enabled() ? Trace::Clock::now() : Trace::Clock::time_point();
+      const std::vector<TrunkMessage> &trunk_messages = parser->parse_message(msg, system);
+      if (Trace::enabled()) {
+        Trace::complete("parse", parse_begin, Trace::Clock::now());
+      }
+
+      std::lock_guard<std::mutex> lock(state_mutex);
+      dispatch_trunk_messages(trunk_messages, msg, system, config, sources, calls, tb);
+      State_Checkpoint::parsed(system);
+    });
+  }
+
+  // The signal detectors wake the loop when a signal appears or goes away
+  for (vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
+    Source *source = *src_it;
+    source->set_signal_change_callback([&loop]() { loop.wake(); });
+  }
+
+  // The grants and UPDATEs a cluster's control node sends a voice node are
+  // handled as if its own Systems had decoded them
+  if (Cluster::get_fd() >= 0) {
+    loop.watch_fd(Cluster::get_fd(), [&]() {
+      Cluster::receive(systems, [&](System *sys, const std::vector<TrunkMessage> &messages) {
+        handle_message(messages, sys, config, sources, calls, tb);
+      });
+    });
+  }
+  if (Cluster::is_voice()) {
+    loop.add_timer(std::chrono::seconds(1), [&]() {
+      Cluster::report(sources);
+    });
+  }
+
+  if (Control_Api::get_fd() >= 0) {
+    loop.watch_fd(Control_Api::get_fd(), [&]() {
+      Control_Api::run([&](const Control_Api::Request &request) {
+        return handle_control_request(request, config, tb, sources, systems, calls);
+      });
+    });
+  }
+
+  // The recorders' and plugins' queues can't wake the loop, so they are
+  // still polled
+  loop.add_timer(std::chrono::milliseconds(10), [&]() {
+    process_message_queues(systems);
+    process_recorder_message_queues(calls);
+    check_control_channel_hunts(tb, sources);
+    plugman_poll_one();
+  });
+
+  // Replaying a file faster than real time, a call timeout goes by in a
+  // fraction of a second, so the calls are looked at more often
+  std::chrono::milliseconds manage_interval = Replay_Clock::enabled() ? std::chrono::milliseconds(50) : std::chrono::milliseconds(1000);
+  Event_Loop::Clock::time_point replay_finished;
+  loop.add_timer(manage_interval, [&]() {
+    manage_calls(config, calls);
+    Pre_Tuner::update(systems, sources);
+    Call_Concluder::manage_call_data_workers();
+    Recorder_Builder::connect_built(tb);
+
+    // The recorders are given a second to work through what the file
+    // source had already put out
+    if (Replay_Clock::finished() && !exit_flag) {
+      if (replay_finished == Event_Loop::Clock::time_point()) {
+        replay_finished = Event_Loop::Clock::now();
+      } else if (Event_Loop::Clock::now() - replay_finished > std::chrono::seconds(1)) {
+        BOOST_LOG_TRIVIAL(info) << "Replay of the IQ file is done - Stopping trunk recorder";
+        exit_flag = 1;
+      }
+    }
+  });
+
+  loop.add_timer(std::chrono::seconds(3), [&]() {
+    Event_Loop::Clock::time_point now = Event_Loop::Clock::now();
+    float decode_rate_check_time_diff = std::chrono::duration<float>(now - last_decode_rate_check).count();
+    last_decode_rate_check = now;
+
+    check_message_count(decode_rate_check_time_diff, config, tb, sources, systems);
+    for (vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
+      Source *source = *src_it;
+      if (source->got_samples() || Replay_Clock::finished()) {
+        reopen_attempts.erase(source);
+        continue;
+      }
+      if (!recover_source(config, tb, source, calls)) {
+        BOOST_LOG_TRIVIAL(error) << "Source " << source->get_num() << " has stopped receiving samples - Terminating trunk recorder";
+        exit_code = EXIT_FAILURE;
+        exit_flag = 1;
+        break;
+      }
+    }
+    for (vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
+      System *system = *sys_it;
+      if (system->get_system_type() == "p25") {
+        system->clear_stale_talkgroup_patches();
+      }
+    }
+  });
 
-  smartnet_parser = new SmartnetParser(systems.front()); // this has to eventually be generic;
-  p25_parser = new P25Parser();
+  if (config.tone_scan) {
+    loop.add_timer(std::chrono::seconds(config.tone_scan_interval), [&]() {
+      report_tone_scan();
+    });
+  }
+
+  if (config.occupancy_interval > 0) {
+    loop.add_timer(std::chrono::seconds(config.occupancy_interval), [&]() {
+      if (config.occupancy_file.empty() && !plugman_wants(PLUGIN_HOOK_CHANNEL_OCCUPANCY)) {
+        return;
+      }
+      std::vector<System_Occupancy_Stats> occupancy = Channel_Occupancy::snapshot();
+      plugman_channel_occupancy(occupancy);
+    });
+  }
+
+  loop.add_timer(std::chrono::seconds(200), [&]() {
+    print_status(sources, systems, calls);
+    config.upload_engine->print_stats();
+    gr::op25_repeater::vocoder_service::print_stats();
+  });
 
   while (1) {
 
     if (exit_flag) { // my action when signal set it 1
       BOOST_LOG_TRIVIAL(info) << "Caught an Exit Signal...";
+      main_loop = NULL;
+      for (vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
+        Source *source = *src_it;
+        source->set_signal_change_callback(nullptr);
+      }
+      loop.shutdown();
+      // The system workers have stopped, so the parsers can be saved from here
+      for (vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
+        State_Checkpoint::save((System_impl *)*sys_it);
+      }
+      control_channel_hunts.clear();
       for (vector<Call *>::iterator it = calls.begin(); it != calls.end();) {
         Call *call = *it;
 
         call->conclude_call();
 
+        call_index.remove(call);
+        call_preemption.remove(call);
+        Channel_Occupancy::release(call);
+        Cluster::release(call);
+        call_timeouts.remove(call);
         it = calls.erase(it);
+        plugman_release_call(call);
         delete call;
       }
+      conventional_calls.clear();
 
       BOOST_LOG_TRIVIAL(info) << "Cleaning up & Exiting...";
+      if (reload_thread.joinable()) {
+        reload_thread.join();
+      }
+      Tone_Scanner::stop();
       Call_Concluder::shutdown_call_data_workers(std::chrono::seconds(10));
       return exit_code;
     }
 
+    if (reload_tables_flag) { // SIGUSR1 or a plugin asked for the tables to be reloaded
+      reload_tables_flag = 0;
+      start_table_reload(systems);
+    }
+
     if (rotate_log_flag) { // SIGHUP received for log rotation
       rotate_log_flag = 0;  // reset flag
       if (global_log_sink) {
@@ -896,83 +1906,31 @@ int monitor_messages(Config &config, gr::top_block_sptr &tb, std::vector<Source
       }
     }
 
-    process_message_queues(systems);
-    process_recorder_message_queues(calls);
-
-    plugman_poll_one();
-
-    for (vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
-      System_impl *system = (System_impl *)*sys_it;
+    {
+      std::lock_guard<std::mutex> lock(state_mutex);
+      Trace::Span span("main loop");
+
+      while (loop.next_message(msg_system, msg)) {
+        System_impl *system = (System_impl *)msg_system;
+
+        Message_Capture::record(system, msg);
+        Trace::Span span("message");
+        Trace::Clock::time_point parse_begin = Trace::enabled() ? Trace::Clock::now() : Trace::Clock::time_point();
+        const std::vector<TrunkMessage> &trunk_messages = system->get_parser()->parse_message(msg, system);
+        if (Trace::enabled()) {
+          Trace::complete("parse", parse_begin, Trace::Clock::now());
+        }
+        dispatch_trunk_messages(trunk_messages, msg, system, config, sources, calls, tb);
+        State_Checkpoint::parsed(system);
 
-      if ((system->get_system_type() == "p25") || (system->get_system_type() == "smartnet")) {
         msg.reset();
-        msg = system->get_msg_queue()->delete_head_nowait();
-        while (msg != 0) {
-          system->set_message_count(system->get_message_count() + 1);
-
-          if (system->get_system_type() == "smartnet") {
-            trunk_messages = smartnet_parser->parse_message(msg, system);
-            handle_message(trunk_messages, system, config, sources, calls, tb);
-            plugman_trunk_message(trunk_messages, system);
-          }
-
-          if (system->get_system_type() == "p25") {
-            trunk_messages = p25_parser->parse_message(msg, system);
-            handle_message(trunk_messages, system, config, sources, calls, tb);
-            plugman_trunk_message(trunk_messages, system);
-          }
-
-          if (msg->type() == -1) {
-            BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "]\t process_data_unit timeout";
-          }
-
-          msg.reset();
-          msg = system->get_msg_queue()->delete_head_nowait();
-        }
       }
-    }
-    current_time = time(NULL);
-    current_time_ms = time_since_epoch_millisec();
-    if ((current_time_ms - last_conventional_channel_detection_check) >= 0.1) {
-      check_conventional_channel_detection(sources);
-      last_conventional_channel_detection_check = current_time_ms;
-    }
-
-    if ((current_time - management_timestamp) >= 1.0) {
-      manage_calls(config, calls);
-      Call_Concluder::manage_call_data_workers();
-      management_timestamp = current_time;
-    }
 
-    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
-
-    float decode_rate_check_time_diff = current_time - last_decode_rate_check;
-
-    if (decode_rate_check_time_diff >= 3.0) {
-      check_message_count(decode_rate_check_time_diff, config, tb, sources, systems);
-      for (vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
-        Source *source = *src_it;
-        if (!source->got_samples()) {
-          BOOST_LOG_TRIVIAL(error) << "Source " << source->get_num() << " has stopped receiving samples - Terminating trunk recorder";
-          exit_code = EXIT_FAILURE;
-          exit_flag = 1;
-          break;
-        }
-      }
-      last_decode_rate_check = current_time;
-      for (vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); sys_it++) {
-        System *system = *sys_it;
-        if (system->get_system_type() == "p25") {
-          system->clear_stale_talkgroup_patches();
-        }
-      }
+      check_conventional_channel_detection(sources);
+      loop.run_fds();
+      loop.run_timers();
     }
 
-    float print_status_time_diff = current_time - last_status_time;
-
-    if (print_status_time_diff > 200) {
-      last_status_time = current_time;
-      print_status(sources, systems, calls);
-    }
+    loop.wait();
   }
 }
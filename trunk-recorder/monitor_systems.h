@@ -15,5 +15,9 @@
 #include <gnuradio/top_block.h>
 
 int monitor_messages(Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<System *> &systems, std::vector<Call *> &calls);
+void handle_message(const std::vector<TrunkMessage> &messages, System *sys, Config &config, std::vector<Source *> &sources, std::vector<Call *> &calls, gr::top_block_sptr &tb);
+void end_call(Call *call, std::vector<Call *> &calls);
 void retune_system(System *sys, gr::top_block_sptr &tb, std::vector<Source *> &sources);
+// Reloads the talkgroup, channel and unit tag files in the background, like SIGUSR1
+void request_table_reload();
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/*
+ * MPSC_Ring
+ *   A bounded queue that any number of threads push to and one thread
+ *   pops from, without a lock.
+ *
+ * The cells are allocated once, a power of two of them. Each cell has a
+ * sequence number that says whose turn it is: a producer claims the cell
+ * at the tail by moving the tail on with a compare and swap, fills it and
+ * then bumps its sequence, which is what tells the consumer it is ready.
+ * The consumer takes the item out, leaves a default constructed one behind
+ * so a shared_ptr is let go of straight away, and sets the sequence to
+ * where the producers will next find the cell. A producer only ever waits
+ * on the consumer when the ring is full, and then push() returns false
+ * rather than waiting.
+ */
+template <typename T>
+class MPSC_Ring {
+public:
+  explicit MPSC_Ring(size_t min_capacity) : head(0), tail(0) {
+    size_t capacity = 2;
+    while (capacity < min_capacity) {
+      capacity <<= 1;
+    }
+    mask = capacity - 1;
+    cells.reset(new Cell[capacity]);
+    for (size_t i = 0; i < capacity; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Any thread. item is only moved from if it was queued.
+  bool push(T &&item) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.item = std::move(item);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // The consumer thread only
+  bool pop(T &item) {
+    Cell &cell = cells[head & mask];
+    if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    item = std::move(cell.item);
+    cell.item = T();
+    cell.sequence.store(head + mask + 1, std::memory_order_release);
+    head++;
+    return true;
+  }
+
+  // The consumer thread only
+  bool empty() const {
+    return cells[head & mask].sequence.load(std::memory_order_acquire) != head + 1;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+  alignas(64) size_t head;
+  alignas(64) std::atomic<size_t> tail;
+};
+
+#endif // MPSC_RING_H
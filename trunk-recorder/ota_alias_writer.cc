@@ -0,0 +1,116 @@
+#include "ota_alias_writer.h"
+#include "unit_tags.h"
+
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <csv-parser/csv.hpp>
+#include <fstream>
+
+using namespace csv;
+
+const int OTA_Alias_Writer::FLUSH_SECONDS;
+const size_t OTA_Alias_Writer::FLUSH_ROWS;
+const size_t OTA_Alias_Writer::COMPACT_ROWS;
+
+std::mutex OTA_Alias_Writer::queue_mutex;
+std::condition_variable OTA_Alias_Writer::queue_cv;
+std::thread OTA_Alias_Writer::worker;
+bool OTA_Alias_Writer::running = false;
+OTA_Alias_Writer::Batch OTA_Alias_Writer::pending;
+size_t OTA_Alias_Writer::pending_rows = 0;
+std::map<std::string, size_t> OTA_Alias_Writer::appended;
+
+void OTA_Alias_Writer::start() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  running = true;
+  worker = std::thread(&OTA_Alias_Writer::run);
+}
+
+void OTA_Alias_Writer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  queue_cv.notify_one();
+  worker.join();
+}
+
+void OTA_Alias_Writer::append(const std::string &filename, const std::vector<std::string> &row) {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  if (!running) {
+    lock.unlock();
+    Batch batch;
+    batch[filename].push_back(row);
+    write(batch);
+    return;
+  }
+  pending[filename].push_back(row);
+  if (++pending_rows >= FLUSH_ROWS) {
+    lock.unlock();
+    queue_cv.notify_one();
+  }
+}
+
+void OTA_Alias_Writer::run() {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  while (true) {
+    queue_cv.wait_for(lock, std::chrono::seconds(FLUSH_SECONDS), [] { return !running || (pending_rows >= FLUSH_ROWS); });
+
+    Batch batch;
+    batch.swap(pending);
+    pending_rows = 0;
+    bool stopping = !running;
+    lock.unlock();
+    write(batch);
+    lock.lock();
+
+    if (stopping) {
+      break;
+    }
+  }
+  // anything that came in while the last batch was written
+  Batch batch;
+  batch.swap(pending);
+  pending_rows = 0;
+  lock.unlock();
+  write(batch);
+}
+
+void OTA_Alias_Writer::write(const Batch &batch) {
+  for (Batch::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+    const std::string &filename = it->first;
+    try {
+      std::ofstream out(filename, std::ios::app);
+      if (!out.is_open()) {
+        BOOST_LOG_TRIVIAL(error) << "Failed to open " << filename << " for writing OTA alias.";
+        continue;
+      }
+      CSVWriter<std::ofstream> writer(out);
+      for (size_t i = 0; i < it->second.size(); i++) {
+        writer << it->second[i];
+      }
+      out.close();
+    } catch (std::exception &e) {
+      BOOST_LOG_TRIVIAL(error) << "Error writing to OTA file " << filename << ": " << e.what();
+      continue;
+    }
+
+    size_t rows;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      rows = (appended[filename] += it->second.size());
+      if (rows >= COMPACT_ROWS) {
+        appended[filename] = 0;
+      }
+    }
+    if (rows >= COMPACT_ROWS) {
+      UnitTags::compact_ota_file(filename);
+    }
+  }
+}
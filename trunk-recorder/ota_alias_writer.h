@@ -0,0 +1,54 @@
+#ifndef OTA_ALIAS_WRITER_H
+#define OTA_ALIAS_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * OTA_Alias_Writer
+ *   Appends OTA aliases to the unitTagsOTA files on a thread of its own, so
+ *   an alias storm, like a fleet being reprogrammed, doesn't open a file
+ *   for every message on the control channel path.
+ *
+ * Rows are held and written out together, each file opened once per
+ * batch, every FLUSH_SECONDS or as soon as FLUSH_ROWS are waiting. Once
+ * COMPACT_ROWS have been appended to a file it is rewritten with just the
+ * newest row for each unit, the same as loading it does, so the file
+ * doesn't grow with enriched entries between restarts and it stays quick
+ * to load. Several systems can share a file, since it is compacted from
+ * what is in it rather than what one system knows.
+ *
+ * Before start() or after stop() rows are written right away by the caller.
+ * stop() writes out whatever is still waiting.
+ */
+class OTA_Alias_Writer {
+public:
+  static const int FLUSH_SECONDS = 5;
+  static const size_t FLUSH_ROWS = 100;
+  static const size_t COMPACT_ROWS = 1000;
+
+  static void start();
+  static void stop();
+  static void append(const std::string &filename, const std::vector<std::string> &row);
+
+private:
+  typedef std::map<std::string, std::vector<std::vector<std::string>>> Batch; // rows by file
+
+  static void run();
+  static void write(const Batch &batch);
+
+  static std::mutex queue_mutex;
+  static std::condition_variable queue_cv;
+  static std::thread worker;
+  static bool running;
+  static Batch pending;
+  static size_t pending_rows;
+  static std::map<std::string, size_t> appended; // rows added to each file since it was last compacted
+};
+
+#endif // OTA_ALIAS_WRITER_H
@@ -8,6 +8,7 @@
 #include "../systems/parser.h"
 #include "../formatter.h"
 
+#include <atomic>
 #include <json.hpp>
 
 typedef enum {
@@ -21,6 +22,51 @@ typedef enum {
 
 using json = nlohmann::json;
 
+// The hooks, for Plugin_Api::hooks() and handles()
+typedef enum {
+  PLUGIN_HOOK_TRUNK_MESSAGE = 1 << 0,
+  PLUGIN_HOOK_CALLS_ACTIVE = 1 << 1,
+  PLUGIN_HOOK_SYSTEM_RATES = 1 << 2,
+  PLUGIN_HOOK_SOURCE_RATES = 1 << 3,
+  PLUGIN_HOOK_CALLS_CHANGED = 1 << 4,
+  PLUGIN_HOOK_POLL_ONE = 1 << 5,
+  PLUGIN_HOOK_SIGNAL = 1 << 6,
+  PLUGIN_HOOK_AUDIO_STREAM = 1 << 7,
+  PLUGIN_HOOK_CALL_START = 1 << 8,
+  PLUGIN_HOOK_CALL_END = 1 << 9,
+  PLUGIN_HOOK_SETUP_RECORDER = 1 << 10,
+  PLUGIN_HOOK_SETUP_SYSTEM = 1 << 11,
+  PLUGIN_HOOK_SETUP_SYSTEMS = 1 << 12,
+  PLUGIN_HOOK_SETUP_SOURCES = 1 << 13,
+  PLUGIN_HOOK_SETUP_CONFIG = 1 << 14,
+  PLUGIN_HOOK_TONE_SCAN = 1 << 15,
+  PLUGIN_HOOK_CALL_LATENCY = 1 << 16,
+  PLUGIN_HOOK_CONCLUDER_LOAD = 1 << 17,
+  PLUGIN_HOOK_WAV_WRITER_STATS = 1 << 18,
+  PLUGIN_HOOK_UNIT_REGISTRATION = 1 << 19,
+  PLUGIN_HOOK_UNIT_DEREGISTRATION = 1 << 20,
+  PLUGIN_HOOK_UNIT_ACKNOWLEDGE_RESPONSE = 1 << 21,
+  PLUGIN_HOOK_UNIT_GROUP_AFFILIATION = 1 << 22,
+  PLUGIN_HOOK_UNIT_DATA_GRANT = 1 << 23,
+  PLUGIN_HOOK_UNIT_ANSWER_REQUEST = 1 << 24,
+  PLUGIN_HOOK_UNIT_LOCATION = 1 << 25,
+  PLUGIN_HOOK_CHANNEL_OCCUPANCY = 1 << 26,
+  PLUGIN_HOOK_MEMORY_USAGE = 1 << 27
+} plugin_hook_t;
+
+const int PLUGIN_HOOK_COUNT = 28;
+const unsigned int PLUGIN_HOOK_ALL = (1u << PLUGIN_HOOK_COUNT) - 1;
+const unsigned int PLUGIN_HOOK_UNIT_EVENTS = PLUGIN_HOOK_UNIT_REGISTRATION | PLUGIN_HOOK_UNIT_DEREGISTRATION | PLUGIN_HOOK_UNIT_ACKNOWLEDGE_RESPONSE | PLUGIN_HOOK_UNIT_GROUP_AFFILIATION | PLUGIN_HOOK_UNIT_DATA_GRANT | PLUGIN_HOOK_UNIT_ANSWER_REQUEST | PLUGIN_HOOK_UNIT_LOCATION;
+
+// The active calls that changed since the last calls_changed(). version
+// goes up by one each time, so a consumer can tell if it missed one.
+struct Calls_Delta {
+  uint64_t version;
+  std::vector<Call *> added;
+  std::vector<Call *> changed;
+  std::vector<long> removed; // call numbers
+};
+
 class Plugin_Api {
 public:
   virtual int init(Config *config, std::vector<Source *> sources, std::vector<System *> systems) { frequency_format = config->frequency_format; return 0; };
@@ -30,16 +76,24 @@ public:
   virtual int poll_one() { return 0; };
   virtual int signal(long unitId, const char *signaling_type, gr::blocks::SignalType sig_type, Call *call, System *system, Recorder *recorder) { return 0; };
   virtual int audio_stream(Call *call, Recorder *recorder, int16_t *samples, int sampleCount) { return 0; };
-  virtual int trunk_message(std::vector<TrunkMessage> messages, System *system) { return 0; };
+  virtual int trunk_message(std::vector<TrunkMessage> messages, System *system) { unused_hooks |= PLUGIN_HOOK_TRUNK_MESSAGE; return 0; };
   virtual int call_start(Call *call) { return 0; };
-  virtual int call_end(Call_Data_t call_info) { return 0; }; //= 0; //{ BOOST_LOG_TRIVIAL(info) << "plugin_api call_end"; return 0; };
-  virtual int calls_active(std::vector<Call *> calls) { return 0; };
+  virtual int call_end(Call_Data_t call_info) { unused_hooks |= PLUGIN_HOOK_CALL_END; return 0; };
+  virtual int calls_active(std::vector<Call *> calls) { unused_hooks |= PLUGIN_HOOK_CALLS_ACTIVE; return 0; };
+  virtual int calls_changed(const Calls_Delta &delta) { unused_hooks |= PLUGIN_HOOK_CALLS_CHANGED; return 0; };
   virtual int setup_recorder(Recorder *recorder) { return 0; };
   virtual int setup_system(System *system) { return 0; };
   virtual int setup_systems(std::vector<System *> systems) { return 0; };
   virtual int setup_sources(std::vector<Source *> sources) { return 0; };
   virtual int setup_config(std::vector<Source *> sources, std::vector<System *> systems) { return 0; };
-  virtual int system_rates(std::vector<System *> systems, float timeDiff) { return 0; };
+  virtual int system_rates(std::vector<System *> systems, float timeDiff) { unused_hooks |= PLUGIN_HOOK_SYSTEM_RATES; return 0; };
+  virtual int source_rates(std::vector<Source *> sources, float timeDiff) { unused_hooks |= PLUGIN_HOOK_SOURCE_RATES; return 0; };
+  virtual int tone_scan(std::vector<Tone_Scan_Result> results) { return 0; };
+  virtual int call_latency(const std::vector<Call_Latency_Stats> &stats) { return 0; };
+  virtual int concluder_load(const Concluder_Load &load) { return 0; };
+  virtual int wav_writer_stats(const std::vector<Wav_Writer_Stats> &stats) { return 0; };
+  virtual int channel_occupancy(const std::vector<System_Occupancy_Stats> &stats) { return 0; };
+  virtual int memory_usage(const Memory_Stats &stats) { return 0; };
   virtual int unit_registration(System *sys, long source_id) { return 0; };
   virtual int unit_deregistration(System *sys, long source_id) { return 0; };
   virtual int unit_acknowledge_response(System *sys, long source_id) { return 0; };
@@ -47,8 +101,38 @@ public:
   virtual int unit_data_grant(System *sys, long source_id) { return 0; };
   virtual int unit_answer_request(System *sys, long source_id, long talkgroup) { return 0; };
   virtual int unit_location(System *sys, long source_id, long talkgroup_num) { return 0; };
+
+  // The plugin manager calls these const reference versions of the hooks
+  // that take vectors or a Call_Data_t, so handing a batch or a concluded
+  // call to every plugin doesn't copy it. A plugin that doesn't override
+  // them gets the by-value hooks above, at the cost of a copy each. One
+  // with neither version of call_end is only handed that copy once.
+  virtual int call_end_view(const Call_Data_t &call_info) { return call_end(call_info); };
+  virtual int trunk_message_view(const std::vector<TrunkMessage> &messages, System *system) { return trunk_message(messages, system); };
+  virtual int calls_active_view(const std::vector<Call *> &calls) { return calls_active(calls); };
+  virtual int setup_systems_view(const std::vector<System *> &systems) { return setup_systems(systems); };
+  virtual int setup_sources_view(const std::vector<Source *> &sources) { return setup_sources(sources); };
+  virtual int setup_config_view(const std::vector<Source *> &sources, const std::vector<System *> &systems) { return setup_config(sources, systems); };
+  virtual int system_rates_view(const std::vector<System *> &systems, float timeDiff) { return system_rates(systems, timeDiff); };
+  virtual int source_rates_view(const std::vector<Source *> &sources, float timeDiff) { return source_rates(sources, timeDiff); };
+  virtual int tone_scan_view(const std::vector<Tone_Scan_Result> &results) { return tone_scan(results); };
+
+  // The hooks the plugin overrides, asked for once after init(). The plugin
+  // manager only calls a plugin for these, and when no plugin wants a hook
+  // Trunk Recorder doesn't gather what it would be passed. A plugin that
+  // doesn't say gets every hook.
+  virtual unsigned int hooks() { return PLUGIN_HOOK_ALL; };
+
+  // False once the default of a hook has run, which means the plugin
+  // overrides neither version of it and it doesn't have to be called again
+  bool handles(plugin_hook_t hook) const { return !(unused_hooks & hook); };
+
   //void set_frequency_format(int f) { frequencyFormat = f; }
   virtual ~Plugin_Api(){};
+
+protected:
+  // Set from the concluder's threads by call_end
+  std::atomic<unsigned int> unused_hooks{0};
 };
 
 #endif
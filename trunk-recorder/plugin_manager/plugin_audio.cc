@@ -0,0 +1,204 @@
+#include "plugin_audio.h"
+#include "../call.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cstring>
+
+Plugin_Audio::Plugin_Audio(std::string name, boost::shared_ptr<Plugin_Api> api, size_t frames)
+    : name(name),
+      api(api),
+      capacity(std::max((size_t)1, frames)),
+      ring_count(0),
+      unringed(0),
+      running(false),
+      pending(false),
+      delivered(0),
+      stale(0) {}
+
+Plugin_Audio::~Plugin_Audio() {
+  stop();
+}
+
+Plugin_Audio::Thread_Rings::~Thread_Rings() {
+  for (std::vector<std::pair<Plugin_Audio *, Ring *>>::iterator it = rings.begin(); it != rings.end(); ++it) {
+    it->second->owned.store(false, std::memory_order_release);
+  }
+}
+
+void Plugin_Audio::start() {
+  if (running.exchange(true)) {
+    return;
+  }
+  worker = std::thread(&Plugin_Audio::run, this);
+}
+
+void Plugin_Audio::stop() {
+  if (!running.exchange(false)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+  }
+  wake.notify_all();
+  // The worker delivers whatever is still waiting before it returns
+  worker.join();
+}
+
+// Only the first audio from a thread takes the lock
+Plugin_Audio::Ring *Plugin_Audio::thread_ring() {
+  static thread_local Thread_Rings local;
+  for (std::vector<std::pair<Plugin_Audio *, Ring *>>::iterator it = local.rings.begin(); it != local.rings.end(); ++it) {
+    if (it->first == this) {
+      return it->second;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  Ring *ring = NULL;
+  size_t count = ring_count.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < count; i++) {
+    Ring *candidate = rings[i].get();
+    if (!candidate->owned.load(std::memory_order_acquire) && (candidate->head.load(std::memory_order_relaxed) == candidate->tail.load(std::memory_order_acquire))) {
+      candidate->owned.store(true, std::memory_order_relaxed);
+      ring = candidate;
+      break;
+    }
+  }
+  if (!ring) {
+    if (count == MAX_RINGS) {
+      return NULL;
+    }
+    rings[count].reset(new Ring(capacity));
+    ring = rings[count].get();
+    ring_count.store(count + 1, std::memory_order_release);
+  }
+  local.rings.push_back(std::make_pair(this, ring));
+  return ring;
+}
+
+void Plugin_Audio::audio_stream(Call *call, Recorder *recorder, int16_t *samples, int sampleCount) {
+  if (!running.load(std::memory_order_acquire)) {
+    api->audio_stream(call, recorder, samples, sampleCount);
+    return;
+  }
+
+  Ring *ring = thread_ring();
+  if (!ring) {
+    unringed.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  long call_num = call ? call->get_call_num() : -1;
+  size_t head = ring->head.load(std::memory_order_relaxed);
+  for (int done = 0; done < sampleCount; done += FRAME_SAMPLES) {
+    if (head - ring->tail.load(std::memory_order_acquire) >= capacity) {
+      ring->dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    Frame &frame = ring->frames[head % capacity];
+    frame.call = call;
+    frame.call_num = call_num;
+    frame.recorder = recorder;
+    frame.count = std::min(FRAME_SAMPLES, sampleCount - done);
+    memcpy(frame.samples, samples + done, frame.count * sizeof(int16_t));
+    head++;
+    ring->head.store(head, std::memory_order_release);
+  }
+
+  // A wakeup that is missed is picked up by the worker's next poll
+  if (!pending.exchange(true, std::memory_order_acq_rel)) {
+    wake.notify_one();
+  }
+}
+
+void Plugin_Audio::release_call(Call *call) {
+  if (!running.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(deliver_mutex);
+  std::vector<size_t> &heads = released_calls[call->get_call_num()];
+  size_t count = ring_count.load(std::memory_order_acquire);
+  heads.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    heads[i] = rings[i]->head.load(std::memory_order_acquire);
+  }
+}
+
+// Returns true if the ring had nothing waiting
+bool Plugin_Audio::drain(Ring *ring) {
+  size_t tail = ring->tail.load(std::memory_order_relaxed);
+  size_t head = ring->head.load(std::memory_order_acquire);
+  if (tail == head) {
+    return true;
+  }
+  while (tail != head) {
+    Frame &frame = ring->frames[tail % capacity];
+    {
+      std::lock_guard<std::mutex> lock(deliver_mutex);
+      if (frame.call && released_calls.count(frame.call_num)) {
+        stale++;
+      } else {
+        api->audio_stream(frame.call, frame.recorder, frame.samples, frame.count);
+        delivered++;
+      }
+    }
+    tail++;
+    ring->tail.store(tail, std::memory_order_release);
+  }
+  return false;
+}
+
+void Plugin_Audio::run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex);
+      wake.wait_for(lock, std::chrono::milliseconds(10), [this] { return pending.load(std::memory_order_acquire) || !running.load(std::memory_order_acquire); });
+    }
+    bool stopping = !running.load(std::memory_order_acquire);
+    pending.store(false, std::memory_order_release);
+
+    bool idle = true;
+    size_t count = ring_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      idle = drain(rings[i].get()) && idle;
+    }
+
+    // A released call has no frames left once every ring has been read past
+    // where it had been written to when the call was released. A ring that
+    // is idle now may still have been handed a frame before the release.
+    {
+      std::lock_guard<std::mutex> lock(deliver_mutex);
+      for (std::map<long, std::vector<size_t>>::iterator it = released_calls.begin(); it != released_calls.end();) {
+        bool passed = true;
+        for (size_t i = 0; passed && i < it->second.size(); i++) {
+          passed = rings[i]->tail.load(std::memory_order_relaxed) >= it->second[i];
+        }
+        if (passed) {
+          it = released_calls.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    if (stopping && idle) {
+      return;
+    }
+  }
+}
+
+void Plugin_Audio::print_stats() {
+  size_t count = ring_count.load(std::memory_order_acquire);
+  size_t owned = 0;
+  size_t waiting = 0;
+  uint64_t dropped = unringed.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < count; i++) {
+    Ring *ring = rings[i].get();
+    owned += ring->owned.load(std::memory_order_relaxed) ? 1 : 0;
+    waiting += ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_relaxed);
+    dropped += ring->dropped.load(std::memory_order_relaxed);
+  }
+  std::lock_guard<std::mutex> lock(deliver_mutex);
+  BOOST_LOG_TRIVIAL(info) << "Plugin " << name << " audio - Rings: " << owned << "/" << count << " Waiting: " << waiting << " Frames Delivered: " << delivered << " Dropped: " << dropped << " Stale: " << stale;
+}
@@ -0,0 +1,106 @@
+#ifndef PLUGIN_AUDIO_H
+#define PLUGIN_AUDIO_H
+
+#include "plugin_api.h"
+
+#include <atomic>
+#include <boost/shared_ptr.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Plugin_Audio
+ *   Delivers a plugin's audio_stream() calls on a thread of its own, so a
+ *   plugin that sends the audio somewhere slow can't hold up the recorder
+ *   that made it, and through it the source.
+ *
+ * Each thread that hands over audio, which is the thread of a recorder's
+ * plugin_wrapper block, gets a ring of its own the first time it does.
+ * A ring has one writer and one reader, so putting audio on it takes no
+ * lock. The frames are allocated with the ring and reused, and audio that
+ * is longer than a frame is split across several. When a ring is full the
+ * new frame is dropped and counted. A thread that exits gives its ring
+ * back once it has been drained, for the next thread to take.
+ *
+ * The worker delivers the frames of each ring in order. The frames point
+ * at the Call they are for, so release_call() has to be called before a
+ * Call is deleted: frames for it that are still waiting are dropped, and
+ * it waits for an audio_stream() that is using it to return.
+ *
+ * Before start() or after stop() the audio is delivered right away.
+ */
+class Plugin_Audio {
+public:
+  static const int FRAME_SAMPLES = 1024;
+  static const size_t MAX_RINGS = 256;
+
+  Plugin_Audio(std::string name, boost::shared_ptr<Plugin_Api> api, size_t frames);
+  ~Plugin_Audio();
+
+  void start();
+  void stop();
+
+  void audio_stream(Call *call, Recorder *recorder, int16_t *samples, int sampleCount);
+  void release_call(Call *call);
+
+  void print_stats();
+
+private:
+  struct Frame {
+    Call *call;
+    long call_num;
+    Recorder *recorder;
+    int count;
+    int16_t samples[FRAME_SAMPLES];
+  };
+
+  struct Ring {
+    Ring(size_t frames) : frames(frames), head(0), tail(0), owned(true), dropped(0) {}
+    std::vector<Frame> frames;
+    std::atomic<size_t> head; // written by the thread that owns the ring
+    std::atomic<size_t> tail; // written by the worker
+    std::atomic<bool> owned;
+    std::atomic<uint64_t> dropped;
+  };
+
+  // The rings the current thread writes to, one per Plugin_Audio
+  struct Thread_Rings {
+    ~Thread_Rings();
+    std::vector<std::pair<Plugin_Audio *, Ring *>> rings;
+  };
+
+  Ring *thread_ring();
+  bool drain(Ring *ring);
+  void run();
+
+  std::string name;
+  boost::shared_ptr<Plugin_Api> api;
+  size_t capacity;
+
+  std::mutex ring_mutex; // only for taking a ring
+  std::unique_ptr<Ring> rings[MAX_RINGS];
+  std::atomic<size_t> ring_count;
+  std::atomic<uint64_t> unringed; // dropped because every ring was taken
+
+  std::atomic<bool> running;
+  std::atomic<bool> pending;
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+  std::thread worker;
+
+  // Held while a frame is delivered, so a Call isn't deleted under it
+  std::mutex deliver_mutex;
+  // The head of each ring when a call was released. Its frames are dropped
+  // until the worker has read every ring past there.
+  std::map<long, std::vector<size_t>> released_calls;
+  uint64_t delivered;
+  uint64_t stale;
+};
+
+#endif // PLUGIN_AUDIO_H
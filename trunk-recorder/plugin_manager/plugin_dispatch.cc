@@ -0,0 +1,191 @@
+#include "plugin_dispatch.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+
+bool Plugin_Dispatch::parse_policy(std::string name, Overflow_Policy &policy) {
+  if (name == "dropOldest") {
+    policy = DROP_OLDEST;
+  } else if (name == "coalesce") {
+    policy = COALESCE;
+  } else if (name == "block") {
+    policy = BLOCK;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Plugin_Dispatch::Plugin_Dispatch(std::string name, boost::shared_ptr<Plugin_Api> api, size_t capacity, Overflow_Policy policy)
+    : name(name),
+      api(api),
+      capacity(std::max((size_t)1, capacity)),
+      policy(policy),
+      running(false),
+      delivered(0),
+      dropped(0),
+      coalesced(0),
+      blocked(0),
+      max_depth(0),
+      max_lag_ms(0) {}
+
+Plugin_Dispatch::~Plugin_Dispatch() {
+  stop();
+}
+
+void Plugin_Dispatch::start() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  running = true;
+  worker = std::thread(&Plugin_Dispatch::run, this);
+}
+
+void Plugin_Dispatch::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  not_empty.notify_all();
+  not_full.notify_all();
+  // The worker delivers whatever is still queued before it returns
+  worker.join();
+}
+
+void Plugin_Dispatch::trunk_message(const std::vector<TrunkMessage> &messages, System *system) {
+  Event event;
+  event.type = TRUNK_MESSAGE;
+  event.system = system;
+  event.source_id = 0;
+  event.talkgroup = 0;
+  event.messages = messages;
+  push(event);
+}
+
+void Plugin_Dispatch::unit_event(Event_Type type, System *system, long source_id, long talkgroup) {
+  Event event;
+  event.type = type;
+  event.system = system;
+  event.source_id = source_id;
+  event.talkgroup = talkgroup;
+  push(event);
+}
+
+// Called with queue_mutex held and the queue full
+bool Plugin_Dispatch::coalesce(Event &event) {
+  for (std::deque<Event>::reverse_iterator it = queue.rbegin(); it != queue.rend(); ++it) {
+    if ((it->type != event.type) || (it->system != event.system)) {
+      continue;
+    }
+    if (event.type == TRUNK_MESSAGE) {
+      it->messages.insert(it->messages.end(), event.messages.begin(), event.messages.end());
+      return true;
+    }
+    if ((it->source_id == event.source_id) && (it->talkgroup == event.talkgroup)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Plugin_Dispatch::push(Event &event) {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  if (!running) {
+    lock.unlock();
+    deliver(event);
+    return;
+  }
+
+  if (queue.size() >= capacity) {
+    if ((policy == COALESCE) && coalesce(event)) {
+      coalesced++;
+      return;
+    }
+    if (policy == BLOCK) {
+      blocked++;
+      not_full.wait(lock, [this] { return (queue.size() < capacity) || !running; });
+      if (!running) {
+        lock.unlock();
+        deliver(event);
+        return;
+      }
+    } else {
+      queue.pop_front();
+      dropped++;
+    }
+  }
+
+  event.queued = Clock::now();
+  queue.push_back(std::move(event));
+  max_depth = std::max(max_depth, queue.size());
+  lock.unlock();
+  not_empty.notify_one();
+}
+
+void Plugin_Dispatch::deliver(Event &event) {
+  switch (event.type) {
+  case TRUNK_MESSAGE:
+    api->trunk_message_view(event.messages, event.system);
+    break;
+  case UNIT_REGISTRATION:
+    api->unit_registration(event.system, event.source_id);
+    break;
+  case UNIT_DEREGISTRATION:
+    api->unit_deregistration(event.system, event.source_id);
+    break;
+  case UNIT_ACKNOWLEDGE_RESPONSE:
+    api->unit_acknowledge_response(event.system, event.source_id);
+    break;
+  case UNIT_GROUP_AFFILIATION:
+    api->unit_group_affiliation(event.system, event.source_id, event.talkgroup);
+    break;
+  case UNIT_DATA_GRANT:
+    api->unit_data_grant(event.system, event.source_id);
+    break;
+  case UNIT_ANSWER_REQUEST:
+    api->unit_answer_request(event.system, event.source_id, event.talkgroup);
+    break;
+  case UNIT_LOCATION:
+    api->unit_location(event.system, event.source_id, event.talkgroup);
+    break;
+  }
+}
+
+void Plugin_Dispatch::run() {
+  std::deque<Event> batch;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex);
+      not_empty.wait(lock, [this] { return !queue.empty() || !running; });
+      if (queue.empty() && !running) {
+        return;
+      }
+      batch.swap(queue);
+    }
+    not_full.notify_all();
+
+    long lag_ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - batch.front().queued).count();
+    for (std::deque<Event>::iterator it = batch.begin(); it != batch.end(); ++it) {
+      deliver(*it);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      delivered += batch.size();
+      max_lag_ms = std::max(max_lag_ms, lag_ms);
+    }
+    batch.clear();
+  }
+}
+
+void Plugin_Dispatch::print_stats() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  BOOST_LOG_TRIVIAL(info) << "Plugin " << name << " events - Queued: " << queue.size() << "/" << capacity << " Max Queued: " << max_depth << " Max Lag: " << max_lag_ms << " ms Delivered: " << delivered << " Dropped: " << dropped << " Coalesced: " << coalesced << " Blocked: " << blocked;
+  max_depth = queue.size();
+  max_lag_ms = 0;
+}
@@ -0,0 +1,102 @@
+#ifndef PLUGIN_DISPATCH_H
+#define PLUGIN_DISPATCH_H
+
+#include "plugin_api.h"
+
+#include <boost/shared_ptr.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Plugin_Dispatch
+ *   Delivers a plugin's trunk_message() and unit_*() events on a thread of
+ *   its own, so a plugin that is slow to handle them doesn't hold up grants.
+ *
+ * Events wait in a bounded queue. The worker takes everything that is
+ * queued in one go and hands it to the plugin in order. When the queue is
+ * full the plugin's overflow policy decides what happens:
+ *
+ *   dropOldest - the oldest queued event is thrown away
+ *   coalesce   - trunk messages are added to the newest queued batch for
+ *                the same System and a unit event that is already queued
+ *                is not queued twice; anything else drops the oldest
+ *   block      - the caller waits for room
+ *
+ * Only these events are queued because they carry nothing but the System,
+ * which lives as long as the program, and values. The call events hand out
+ * Call pointers that can be deleted before a worker would get to them, so
+ * they are always delivered right away.
+ */
+class Plugin_Dispatch {
+public:
+  enum Overflow_Policy { DROP_OLDEST,
+                         COALESCE,
+                         BLOCK };
+
+  enum Event_Type { TRUNK_MESSAGE,
+                    UNIT_REGISTRATION,
+                    UNIT_DEREGISTRATION,
+                    UNIT_ACKNOWLEDGE_RESPONSE,
+                    UNIT_GROUP_AFFILIATION,
+                    UNIT_DATA_GRANT,
+                    UNIT_ANSWER_REQUEST,
+                    UNIT_LOCATION };
+
+  static bool parse_policy(std::string name, Overflow_Policy &policy);
+
+  Plugin_Dispatch(std::string name, boost::shared_ptr<Plugin_Api> api, size_t capacity, Overflow_Policy policy);
+  ~Plugin_Dispatch();
+
+  void start();
+  void stop();
+
+  void trunk_message(const std::vector<TrunkMessage> &messages, System *system);
+  void unit_event(Event_Type type, System *system, long source_id, long talkgroup = 0);
+
+  void print_stats();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Event {
+    Event_Type type;
+    System *system;
+    long source_id;
+    long talkgroup;
+    std::vector<TrunkMessage> messages;
+    Clock::time_point queued;
+  };
+
+  void push(Event &event);
+  bool coalesce(Event &event);
+  void deliver(Event &event);
+  void run();
+
+  std::string name;
+  boost::shared_ptr<Plugin_Api> api;
+  size_t capacity;
+  Overflow_Policy policy;
+
+  std::mutex queue_mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<Event> queue;
+  bool running;
+  std::thread worker;
+
+  // Lag counters, read under queue_mutex
+  uint64_t delivered;
+  uint64_t dropped;
+  uint64_t coalesced;
+  uint64_t blocked;
+  size_t max_depth;
+  long max_lag_ms;
+};
+
+#endif // PLUGIN_DISPATCH_H
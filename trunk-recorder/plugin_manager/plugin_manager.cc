@@ -1,6 +1,7 @@
 #include "plugin_manager.h"
 
 #include "../global_structs.h"
+#include <algorithm>
 #include <boost/dll/import.hpp> // for import_alias
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
@@ -8,11 +9,47 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
+#include <future>
 #include <stdlib.h>
+#include <unordered_map>
 #include <vector>
 
 std::vector<Plugin *> plugins;
 
+// The running plugins that take each hook, in the order they were loaded.
+// They are set by start_plugins() and stop_plugins(). A plugin that turns
+// out to only have the default of trunk_message, calls_active,
+// calls_changed, system_rates or source_rates is dropped from that list,
+// which is safe because only the main loop calls those.
+static std::vector<Plugin *> hook_plugins[PLUGIN_HOOK_COUNT];
+
+static std::vector<Plugin *> &subscribers(plugin_hook_t hook) {
+  return hook_plugins[__builtin_ctz(hook)];
+}
+
+static void update_subscribers() {
+  for (int i = 0; i < PLUGIN_HOOK_COUNT; i++) {
+    plugin_hook_t hook = (plugin_hook_t)(1u << i);
+    hook_plugins[i].clear();
+    for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+      Plugin *plugin = *it;
+      if ((plugin->state == PLUGIN_RUNNING) && (plugin->hooks & hook) && plugin->api->handles(hook)) {
+        hook_plugins[i].push_back(plugin);
+      }
+    }
+  }
+}
+
+static void drop_unhandled(plugin_hook_t hook) {
+  std::vector<Plugin *> &subscribed = subscribers(hook);
+  subscribed.erase(std::remove_if(subscribed.begin(), subscribed.end(), [hook](Plugin *plugin) { return !plugin->api->handles(hook); }), subscribed.end());
+}
+
+// So a caller can skip gathering what a hook would be passed
+bool plugman_wants(plugin_hook_t hook) {
+  return !subscribers(hook).empty();
+}
+
 Plugin *setup_plugin(std::string plugin_lib, std::string plugin_name) {
   BOOST_LOG_TRIVIAL(info) << "Setting up plugin -  Name: " << plugin_name << "\t Library file: " << plugin_lib;
   // Plugin *plugin = plugin_new(plugin_lib == "" ? NULL : plugin_lib.c_str(), plugin_name.c_str());
@@ -28,6 +65,7 @@ Plugin *setup_plugin(std::string plugin_lib, std::string plugin_name) {
 
   plugin->api = plugin->creator();
   plugin->name = plugin_name;
+  plugin->hooks = PLUGIN_HOOK_ALL;
   plugins.push_back(plugin);
 
   return plugin;
@@ -54,6 +92,24 @@ void initialize_plugins(json config_data, Config *config, std::vector<Source *>
       if (plugin_enabled) {
         Plugin *plugin = setup_plugin(plugin_lib, plugin_name);
         plugin->api->parse_config(element);
+
+        if (element.value("asyncEvents", false)) {
+          int queue_size = element.value("eventQueueSize", 4096);
+          std::string policy_name = element.value("overflowPolicy", "dropOldest");
+          Plugin_Dispatch::Overflow_Policy policy;
+          if (!Plugin_Dispatch::parse_policy(policy_name, policy)) {
+            BOOST_LOG_TRIVIAL(error) << "Plugin " << plugin_name << " - unknown overflowPolicy: " << policy_name << ", must be dropOldest, coalesce or block. Using dropOldest";
+            policy = Plugin_Dispatch::DROP_OLDEST;
+          }
+          plugin->dispatch.reset(new Plugin_Dispatch(plugin_name, plugin->api, queue_size, policy));
+          BOOST_LOG_TRIVIAL(info) << "Plugin " << plugin_name << " - Async Events: true Queue Size: " << queue_size << " Overflow Policy: " << policy_name;
+        }
+
+        if (element.value("asyncAudio", false)) {
+          int audio_frames = element.value("audioQueueFrames", 64);
+          plugin->audio.reset(new Plugin_Audio(plugin_name, plugin->api, audio_frames));
+          BOOST_LOG_TRIVIAL(info) << "Plugin " << plugin_name << " - Async Audio: true Queue Frames: " << audio_frames;
+        }
       }
     }
 
@@ -75,6 +131,7 @@ void initialize_plugins(json config_data, Config *config, std::vector<Source *>
       plugin->state = PLUGIN_FAILED;
     } else {
       plugin->state = PLUGIN_INITIALIZED;
+      plugin->hooks = plugin->api->hooks();
       ret = 0;
     }
   }
@@ -100,21 +157,36 @@ void start_plugins(std::vector<Source *> sources, std::vector<System *> systems)
     }
     plugin->state = PLUGIN_RUNNING;
 
+    if (plugin->dispatch) {
+      plugin->dispatch->start();
+    }
+    if (plugin->audio) {
+      plugin->audio->start();
+    }
+
     /* ----- Plugin Setup Sources ----- */
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_sources(sources);
+    if ((plugin->state == PLUGIN_RUNNING) && (plugin->hooks & PLUGIN_HOOK_SETUP_SOURCES)) {
+      plugin->api->setup_sources_view(sources);
     }
 
     /* ----- Plugin Setup Systems ----- */
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_systems(systems);
+    if ((plugin->state == PLUGIN_RUNNING) && (plugin->hooks & PLUGIN_HOOK_SETUP_SYSTEMS)) {
+      plugin->api->setup_systems_view(systems);
     }
   }
+  update_subscribers();
 }
 
 void stop_plugins() {
+  for (int i = 0; i < PLUGIN_HOOK_COUNT; i++) {
+    hook_plugins[i].clear();
+  }
   for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
     Plugin *plugin = *it;
+    // Anything still queued is delivered before the worker stops, and
+    // anything after this is delivered directly
+    plugin->dispatch.reset();
+    plugin->audio.reset();
     if (plugin->state == PLUGIN_RUNNING) {
       int err = plugin->api->stop();
       if (err != 0) {
@@ -127,56 +199,110 @@ void stop_plugins() {
 }
 
 void plugman_poll_one() {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_POLL_ONE);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->poll_one();
+  }
+}
+
+void plugman_print_dispatch_stats() {
   for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->poll_one();
+    if (plugin->dispatch && (plugin->state == PLUGIN_RUNNING)) {
+      plugin->dispatch->print_stats();
+    }
+    if (plugin->audio && (plugin->state == PLUGIN_RUNNING)) {
+      plugin->audio->print_stats();
     }
   }
 }
 
 void plugman_audio_callback(Call *call, Recorder *recorder, int16_t *samples, int sampleCount) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_AUDIO_STREAM);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->audio) {
+      plugin->audio->audio_stream(call, recorder, samples, sampleCount);
+    } else {
       plugin->api->audio_stream(call, recorder, samples, sampleCount);
     }
   }
 }
 
-int plugman_signal(long unitId, const char *signaling_type, gr::blocks::SignalType sig_type, Call *call, System *system, Recorder *recorder) {
-  int error = 0;
+// Before a Call is deleted, so audio for it that is still waiting isn't
+// handed to a plugin
+void plugman_release_call(Call *call) {
   for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->signal(unitId, signaling_type, sig_type, call, system, recorder);
+    if (plugin->audio) {
+      plugin->audio->release_call(call);
     }
   }
+}
+
+int plugman_signal(long unitId, const char *signaling_type, gr::blocks::SignalType sig_type, Call *call, System *system, Recorder *recorder) {
+  int error = 0;
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SIGNAL);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->signal(unitId, signaling_type, sig_type, call, system, recorder);
+  }
   return error;
 }
 
-int plugman_trunk_message(std::vector<TrunkMessage> messages, System *system) {
+int plugman_trunk_message(const std::vector<TrunkMessage> &messages, System *system) {
   int error = 0;
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_TRUNK_MESSAGE);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->trunk_message(messages, system);
+    if (plugin->dispatch) {
+      plugin->dispatch->trunk_message(messages, system);
+    } else {
+      plugin->api->trunk_message_view(messages, system);
     }
   }
+  drop_unhandled(PLUGIN_HOOK_TRUNK_MESSAGE);
   return error;
 }
 
 int plugman_call_start(Call *call) {
   int error = 0;
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_CALL_START);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->call_start(call);
-    }
+    plugin->api->call_start(call);
   }
   return error;
 }
 
+// Runs call_end for the plugins at indexes all at once, each on a thread of
+// its own but the first, which runs on the caller's. Returns the indexes of
+// the plugins that failed, so only they are retried.
+static std::vector<int> run_call_end(const std::vector<int> &indexes, const Call_Data_t &call_info, const std::string &loghdr) {
+  std::vector<std::future<int>> results;
+  for (std::vector<int>::const_iterator it = indexes.begin(); it != indexes.end(); it++) {
+    Plugin *plugin = plugins[*it];
+    std::launch policy = (it == indexes.begin()) ? std::launch::deferred : std::launch::async;
+    results.push_back(std::async(policy, [plugin, &call_info, &loghdr]() {
+      try {
+        return plugin->api->call_end_view(call_info);
+      } catch (std::exception &e) {
+        BOOST_LOG_TRIVIAL(error) << loghdr << "Plugin Manager: call_end - " << plugin->name << " threw: " << e.what();
+        return 1;
+      }
+    }));
+  }
+
+  std::vector<int> failed;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].get()) {
+      failed.push_back(indexes[i]);
+    }
+  }
+  return failed;
+}
+
 int plugman_call_end(Call_Data_t& call_info) {
   std::vector<int> plugin_retry_list;
   
@@ -184,35 +310,40 @@ int plugman_call_end(Call_Data_t& call_info) {
   logstream << "[" << call_info.short_name << "]\t\033[0;34m" << call_info.call_num << "C\033[0m\tTG: " << call_info.talkgroup_display << "\tFreq: " << format_freq(call_info.freq) << "\t";
   std::string loghdr = logstream.str();
 
-  // On INITIAL, run call_end for all active plugins and note failues 
+  // On INITIAL, run call_end for all active plugins and note failues. A
+  // plugin whose call_end turned out to be the default is skipped, so it
+  // isn't handed a copy of every call.
   if (call_info.status == INITIAL)
   {
+    std::vector<int> indexes;
     for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
-      Plugin *plugin = *it;
-      if (plugin->state == PLUGIN_RUNNING) {
-        int plugin_error = plugin->api->call_end(call_info);
-        if (plugin_error) {
-          BOOST_LOG_TRIVIAL(error) << loghdr << "Plugin Manager: call_end -  " << plugin->name << " failed.";
-          int plugin_index = std::distance(plugins.begin(), it );
-          plugin_retry_list.push_back(plugin_index);
-        }
+      if (((*it)->state == PLUGIN_RUNNING) && ((*it)->hooks & PLUGIN_HOOK_CALL_END) && (*it)->api->handles(PLUGIN_HOOK_CALL_END)) {
+        indexes.push_back(std::distance(plugins.begin(), it));
       }
     }
+    plugin_retry_list = run_call_end(indexes, call_info, loghdr);
+    for (std::vector<int>::iterator it = plugin_retry_list.begin(); it != plugin_retry_list.end(); it++) {
+      BOOST_LOG_TRIVIAL(error) << loghdr << "Plugin Manager: call_end -  " << plugins[*it]->name << " failed.";
+    }
   } 
   // On RETRY, run call_end only for plugins reporting previous failue
   else if (call_info.status == RETRY)
   {
+    std::vector<int> indexes;
     for (std::vector<int>::iterator it = call_info.plugin_retry_list.begin(); it != call_info.plugin_retry_list.end(); it++) {
+      if ((*it < 0) || (*it >= (int)plugins.size())) {
+        continue;
+      }
       Plugin *plugin = plugins[*it];
       if (plugin->state == PLUGIN_RUNNING) {
         BOOST_LOG_TRIVIAL(info) << loghdr << "Plugin Manager: call_end - retry (" << call_info.retry_attempt << "/" << Call_Concluder::MAX_RETRY << ") - " << plugin->name;
-        int plugin_error = plugin->api->call_end(call_info);
-        if (plugin_error) {
-          BOOST_LOG_TRIVIAL(error) << loghdr << "Plugin Manager: call_end - retry (" << call_info.retry_attempt << "/" << Call_Concluder::MAX_RETRY << ") - " << plugin->name << " failed.";
-          plugin_retry_list.push_back(*it);
-        }
+        indexes.push_back(*it);
       }
     }
+    plugin_retry_list = run_call_end(indexes, call_info, loghdr);
+    for (std::vector<int>::iterator it = plugin_retry_list.begin(); it != plugin_retry_list.end(); it++) {
+      BOOST_LOG_TRIVIAL(error) << loghdr << "Plugin Manager: call_end - retry (" << call_info.retry_attempt << "/" << Call_Concluder::MAX_RETRY << ") - " << plugins[*it]->name << " failed.";
+    }
   }
 
   if (plugin_retry_list.size() == 0) {
@@ -223,123 +354,287 @@ int plugman_call_end(Call_Data_t& call_info) {
   }
 }
 
-int plugman_calls_active(std::vector<Call *> calls) {
-  int error = 0;
+// Plugins are found by name for the calls in the retry journal, since their
+// index can change between runs
+std::string plugman_plugin_name(int index) {
+  if ((index < 0) || (index >= (int)plugins.size())) {
+    return "";
+  }
+  return plugins[index]->name;
+}
+
+int plugman_plugin_index(const std::string &name) {
   for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
-    Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->calls_active(calls);
+    if ((*it)->name == name) {
+      return std::distance(plugins.begin(), it);
+    }
+  }
+  return -1;
+}
+
+// What a dashboard shows for a call. A call is only in a Calls_Delta's
+// changed list if one of these is different; its length and elapsed time
+// move every second and can be worked out from its start time.
+struct Call_Summary {
+  Call *call;
+  State state;
+  MonitoringState monitoring_state;
+  long source_id;
+  bool encrypted;
+  bool emergency;
+  Recorder *recorder;
+  State recorder_state;
+
+  bool operator!=(const Call_Summary &other) const {
+    return (call != other.call) || (state != other.state) || (monitoring_state != other.monitoring_state) || (source_id != other.source_id) || (encrypted != other.encrypted) || (emergency != other.emergency) || (recorder != other.recorder) || (recorder_state != other.recorder_state);
+  }
+};
+
+static std::unordered_map<long, Call_Summary> last_calls;
+static uint64_t calls_version = 0;
+
+static Call_Summary summarize_call(Call *call) {
+  Call_Summary summary;
+  summary.call = call;
+  summary.state = call->get_state();
+  summary.monitoring_state = call->get_monitoring_state();
+  summary.source_id = call->get_current_source_id();
+  summary.encrypted = call->get_encrypted();
+  summary.emergency = call->get_emergency();
+  summary.recorder = call->get_recorder();
+  summary.recorder_state = summary.recorder ? summary.recorder->get_state() : INACTIVE;
+  return summary;
+}
+
+static bool update_calls_delta(const std::vector<Call *> &calls, Calls_Delta &delta) {
+  std::unordered_map<long, Call_Summary> current;
+  current.reserve(calls.size());
+
+  for (std::vector<Call *>::const_iterator it = calls.begin(); it != calls.end(); it++) {
+    Call *call = *it;
+    Call_Summary summary = summarize_call(call);
+    current[call->get_call_num()] = summary;
+
+    std::unordered_map<long, Call_Summary>::iterator last = last_calls.find(call->get_call_num());
+    if (last == last_calls.end()) {
+      delta.added.push_back(call);
+    } else if (last->second != summary) {
+      delta.changed.push_back(call);
     }
   }
+
+  for (std::unordered_map<long, Call_Summary>::iterator it = last_calls.begin(); it != last_calls.end(); it++) {
+    if (current.find(it->first) == current.end()) {
+      delta.removed.push_back(it->first);
+    }
+  }
+
+  last_calls.swap(current);
+  if (delta.added.empty() && delta.changed.empty() && delta.removed.empty()) {
+    return false;
+  }
+  delta.version = ++calls_version;
+  return true;
+}
+
+int plugman_calls_active(const std::vector<Call *> &calls) {
+  int error = 0;
+
+  std::vector<Plugin *> &active_subscribed = subscribers(PLUGIN_HOOK_CALLS_ACTIVE);
+  for (std::vector<Plugin *>::iterator it = active_subscribed.begin(); it != active_subscribed.end(); it++) {
+    (*it)->api->calls_active_view(calls);
+  }
+  drop_unhandled(PLUGIN_HOOK_CALLS_ACTIVE);
+
+  // Only worked out while some plugin wants it
+  std::vector<Plugin *> &changed_subscribed = subscribers(PLUGIN_HOOK_CALLS_CHANGED);
+  Calls_Delta delta;
+  if (!changed_subscribed.empty() && update_calls_delta(calls, delta)) {
+    for (std::vector<Plugin *>::iterator it = changed_subscribed.begin(); it != changed_subscribed.end(); it++) {
+      (*it)->api->calls_changed(delta);
+    }
+    drop_unhandled(PLUGIN_HOOK_CALLS_CHANGED);
+  }
   return error;
 }
 
 void plugman_setup_recorder(Recorder *recorder) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SETUP_RECORDER);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_recorder(recorder);
-    }
+    plugin->api->setup_recorder(recorder);
   }
 }
 
 void plugman_setup_system(System *system) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SETUP_SYSTEM);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_system(system);
-    }
+    plugin->api->setup_system(system);
   }
 }
 
-void plugman_setup_systems(std::vector<System *> systems) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+void plugman_setup_systems(const std::vector<System *> &systems) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SETUP_SYSTEMS);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_systems(systems);
-    }
+    plugin->api->setup_systems_view(systems);
   }
 }
 
-void plugman_setup_sources(std::vector<Source *> sources) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+void plugman_setup_sources(const std::vector<Source *> &sources) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SETUP_SOURCES);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_sources(sources);
-    }
+    plugin->api->setup_sources_view(sources);
   }
 }
 
-void plugman_setup_config(std::vector<Source *> sources, std::vector<System *> systems) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+void plugman_setup_config(const std::vector<Source *> &sources, const std::vector<System *> &systems) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SETUP_CONFIG);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->setup_config(sources, systems);
-    }
+    plugin->api->setup_config_view(sources, systems);
   }
 }
 
-void plugman_system_rates(std::vector<System *> systems, float timeDiff) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+void plugman_system_rates(const std::vector<System *> &systems, float timeDiff) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SYSTEM_RATES);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    (*it)->api->system_rates_view(systems, timeDiff);
+  }
+  drop_unhandled(PLUGIN_HOOK_SYSTEM_RATES);
+}
+
+void plugman_source_rates(const std::vector<Source *> &sources, float timeDiff) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_SOURCE_RATES);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    (*it)->api->source_rates_view(sources, timeDiff);
+  }
+  drop_unhandled(PLUGIN_HOOK_SOURCE_RATES);
+}
+
+void plugman_tone_scan(const std::vector<Tone_Scan_Result> &results) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_TONE_SCAN);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
-      plugin->api->system_rates(systems, timeDiff);
-    }
+    plugin->api->tone_scan_view(results);
+  }
+}
+
+void plugman_call_latency(const std::vector<Call_Latency_Stats> &stats) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_CALL_LATENCY);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->call_latency(stats);
+  }
+}
+
+void plugman_concluder_load(const Concluder_Load &load) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_CONCLUDER_LOAD);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->concluder_load(load);
+  }
+}
+
+void plugman_wav_writer_stats(const std::vector<Wav_Writer_Stats> &stats) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_WAV_WRITER_STATS);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->wav_writer_stats(stats);
+  }
+}
+
+void plugman_channel_occupancy(const std::vector<System_Occupancy_Stats> &stats) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_CHANNEL_OCCUPANCY);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->channel_occupancy(stats);
+  }
+}
+
+void plugman_memory_usage(const Memory_Stats &stats) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_MEMORY_USAGE);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
+    Plugin *plugin = *it;
+    plugin->api->memory_usage(stats);
   }
 }
 
 void plugman_unit_registration(System *system, long source_id) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_REGISTRATION);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_REGISTRATION, system, source_id);
+    } else {
       plugin->api->unit_registration(system, source_id);
     }
   }
 }
 void plugman_unit_deregistration(System *system, long source_id) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_DEREGISTRATION);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_DEREGISTRATION, system, source_id);
+    } else {
       plugin->api->unit_deregistration(system, source_id);
     }
   }
 }
 void plugman_unit_acknowledge_response(System *system, long source_id) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_ACKNOWLEDGE_RESPONSE);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_ACKNOWLEDGE_RESPONSE, system, source_id);
+    } else {
       plugin->api->unit_acknowledge_response(system, source_id);
     }
   }
 }
 void plugman_unit_group_affiliation(System *system, long source_id, long talkgroup_num) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_GROUP_AFFILIATION);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_GROUP_AFFILIATION, system, source_id, talkgroup_num);
+    } else {
       plugin->api->unit_group_affiliation(system, source_id, talkgroup_num);
     }
   }
 }
 void plugman_unit_data_grant(System *system, long source_id) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_DATA_GRANT);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_DATA_GRANT, system, source_id);
+    } else {
       plugin->api->unit_data_grant(system, source_id);
     }
   }
 }
 void plugman_unit_answer_request(System *system, long source_id, long talkgroup) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_ANSWER_REQUEST);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_ANSWER_REQUEST, system, source_id, talkgroup);
+    } else {
       plugin->api->unit_answer_request(system, source_id, talkgroup);
     }
   }
 }
 void plugman_unit_location(System *system, long source_id, long talkgroup_num) {
-  for (std::vector<Plugin *>::iterator it = plugins.begin(); it != plugins.end(); it++) {
+  std::vector<Plugin *> &subscribed = subscribers(PLUGIN_HOOK_UNIT_LOCATION);
+  for (std::vector<Plugin *>::iterator it = subscribed.begin(); it != subscribed.end(); it++) {
     Plugin *plugin = *it;
-    if (plugin->state == PLUGIN_RUNNING) {
+    if (plugin->dispatch) {
+      plugin->dispatch->unit_event(Plugin_Dispatch::UNIT_LOCATION, system, source_id, talkgroup_num);
+    } else {
       plugin->api->unit_location(system, source_id, talkgroup_num);
     }
   }
@@ -8,11 +8,14 @@
 #include "../systems/system_impl.h"
 
 #include "plugin_api.h"
+#include "plugin_audio.h"
+#include "plugin_dispatch.h"
 #if GNURADIO_VERSION >= 0x030a00
 #include <boost/function.hpp>
 #endif
 #include <boost/optional/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <memory>
 #include <stdlib.h>
 #include <vector>
 
@@ -23,6 +26,9 @@ struct Plugin {
   boost::shared_ptr<Plugin_Api> api;
   plugin_state_t state;
   std::string name;
+  std::unique_ptr<Plugin_Dispatch> dispatch; // set when the plugin takes its trunk and unit events asynchronously
+  std::unique_ptr<Plugin_Audio> audio;       // set when the plugin takes its audio asynchronously
+  unsigned int hooks;                        // what Plugin_Api::hooks() returned after init
 };
 
 void initialize_plugins(json config_data, Config *config, std::vector<Source *> sources, std::vector<System *> systems);
@@ -30,19 +36,31 @@ void add_internal_plugin(std::string name, std::string library, json config_data
 void start_plugins(std::vector<Source *> sources, std::vector<System *> systems);
 void stop_plugins();
 
+bool plugman_wants(plugin_hook_t hook);
 void plugman_poll_one();
+void plugman_print_dispatch_stats();
 void plugman_audio_callback(Call *call, Recorder *recorder, int16_t *samples, int sampleCount);
+void plugman_release_call(Call *call);
 int plugman_signal(long unitId, const char *signaling_type, gr::blocks::SignalType sig_type, Call *call, System *system, Recorder *recorder);
-int plugman_trunk_message(std::vector<TrunkMessage> messages, System *system);
+int plugman_trunk_message(const std::vector<TrunkMessage> &messages, System *system);
 int plugman_call_start(Call *call);
 int plugman_call_end(Call_Data_t& call_info);
-int plugman_calls_active(std::vector<Call *> calls);
+std::string plugman_plugin_name(int index);
+int plugman_plugin_index(const std::string &name);
+int plugman_calls_active(const std::vector<Call *> &calls);
 void plugman_setup_recorder(Recorder *recorder);
 void plugman_setup_system(System *system);
-void plugman_setup_systems(std::vector<System *> systems);
-void plugman_setup_sources(std::vector<Source *> sources);
-void plugman_setup_config(std::vector<Source *> sources, std::vector<System *> systems);
-void plugman_system_rates(std::vector<System *> systems, float timeDiff);
+void plugman_setup_systems(const std::vector<System *> &systems);
+void plugman_setup_sources(const std::vector<Source *> &sources);
+void plugman_setup_config(const std::vector<Source *> &sources, const std::vector<System *> &systems);
+void plugman_system_rates(const std::vector<System *> &systems, float timeDiff);
+void plugman_source_rates(const std::vector<Source *> &sources, float timeDiff);
+void plugman_tone_scan(const std::vector<Tone_Scan_Result> &results);
+void plugman_call_latency(const std::vector<Call_Latency_Stats> &stats);
+void plugman_concluder_load(const Concluder_Load &load);
+void plugman_wav_writer_stats(const std::vector<Wav_Writer_Stats> &stats);
+void plugman_channel_occupancy(const std::vector<System_Occupancy_Stats> &stats);
+void plugman_memory_usage(const Memory_Stats &stats);
 void plugman_unit_registration(System *system, long source_id);
 void plugman_unit_deregistration(System *system, long source_id);
 void plugman_unit_acknowledge_response(System *system, long source_id);
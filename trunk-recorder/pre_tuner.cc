@@ -0,0 +1,108 @@
+#include "pre_tuner.h"
+#include "formatter.h"
+#include "replay_clock.h"
+#include "source.h"
+#include "systems/system.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cmath>
+#include <iomanip>
+#include <set>
+
+std::map<int, std::map<long, Pre_Tuner::Channel>> Pre_Tuner::channels;
+long Pre_Tuner::parked = 0;
+
+// Channels that have decayed to this are forgotten
+static const double FORGOTTEN = 0.05;
+
+double Pre_Tuner::decayed(const Channel &channel, time_t now) {
+  double seconds = std::max(0.0, difftime(now, channel.updated));
+  return channel.grants * std::exp2(-seconds / HALF_LIFE);
+}
+
+void Pre_Tuner::grant(System *system, double freq, bool analog) {
+  if (system->get_pre_tune_recorders() <= 0) {
+    return;
+  }
+  time_t now = Replay_Clock::now();
+  std::map<long, Channel> &system_channels = channels[system->get_sys_num()];
+  long hz = lround(freq);
+  std::map<long, Channel>::iterator it = system_channels.find(hz);
+  if (it == system_channels.end()) {
+    Channel channel = {1.0, now, analog};
+    system_channels[hz] = channel;
+    return;
+  }
+  it->second.grants = decayed(it->second, now) + 1.0;
+  it->second.updated = now;
+  it->second.analog = analog;
+}
+
+void Pre_Tuner::update(std::vector<System *> &systems, std::vector<Source *> &sources) {
+  if (channels.empty()) {
+    return;
+  }
+  time_t now = Replay_Clock::now();
+
+  struct Busy {
+    double grants;
+    long freq;
+    bool analog;
+    bool operator<(const Busy &other) const { return grants > other.grants; }
+  };
+  std::vector<Busy> busiest;
+  std::set<long> wanted;
+
+  for (std::vector<System *>::iterator sys_it = systems.begin(); sys_it != systems.end(); ++sys_it) {
+    System *system = *sys_it;
+    std::map<int, std::map<long, Channel>>::iterator found = channels.find(system->get_sys_num());
+    if (found == channels.end()) {
+      continue;
+    }
+
+    std::vector<Busy> system_busiest;
+    std::map<long, Channel> &system_channels = found->second;
+    for (std::map<long, Channel>::iterator it = system_channels.begin(); it != system_channels.end();) {
+      double grants = decayed(it->second, now);
+      if (grants < FORGOTTEN) {
+        it = system_channels.erase(it);
+        continue;
+      }
+      Busy busy = {grants, it->first, it->second.analog};
+      system_busiest.push_back(busy);
+      ++it;
+    }
+
+    size_t n = std::min(system_busiest.size(), (size_t)std::max(0, system->get_pre_tune_recorders()));
+    std::partial_sort(system_busiest.begin(), system_busiest.begin() + n, system_busiest.end());
+    for (size_t i = 0; i < n; i++) {
+      busiest.push_back(system_busiest[i]);
+      wanted.insert(system_busiest[i].freq);
+    }
+  }
+
+  // The busiest channels of all the Systems get the free recorders first.
+  // A channel is parked on the first Source that covers it.
+  std::sort(busiest.begin(), busiest.end());
+  for (std::vector<Busy>::iterator it = busiest.begin(); it != busiest.end(); ++it) {
+    for (std::vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); ++src_it) {
+      Source *source = *src_it;
+      if ((source->get_min_hz() > it->freq) || (source->get_max_hz() < it->freq)) {
+        continue;
+      }
+      if (source->pre_tune_recorder(it->analog ? ANALOG : P25, it->freq, wanted)) {
+        parked++;
+        BOOST_LOG_TRIVIAL(debug) << "[Source " << source->get_num() << "] Parked a free " << (it->analog ? "analog" : "digital") << " recorder on " << format_freq(it->freq) << ", " << std::fixed << std::setprecision(1) << it->grants << " recent grants";
+      }
+      break;
+    }
+  }
+}
+
+void Pre_Tuner::print_stats() {
+  if (channels.empty()) {
+    return;
+  }
+  BOOST_LOG_TRIVIAL(info) << "Pre-Tuner: " << parked << " recorders parked on busy voice channels";
+}
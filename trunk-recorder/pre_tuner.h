@@ -0,0 +1,52 @@
+#ifndef PRE_TUNER_H
+#define PRE_TUNER_H
+
+#include <ctime>
+#include <map>
+#include <vector>
+
+class Source;
+class System;
+
+/*
+ * Pre_Tuner
+ *   Parks free recorders on the voice channels a trunked System grants
+ *   most, for the Systems that have preTuneRecorders.
+ *
+ * Each new call counts as a grant on its channel. The counts decay with a
+ * half-life of a few minutes, so they follow what the site is doing now.
+ * Every time the calls are managed, the busiest channels of each System
+ * that don't have a free recorder on them get the recorder that has been
+ * free the longest, tuned there by Source::pre_tune_recorder(). The
+ * Recorder_Pool then hands that recorder to the next call on the channel,
+ * and it starts without a retune.
+ *
+ * A parked recorder is as idle as any other free recorder. Its
+ * channelizer drops the samples, so it isn't demodulating, only tuned.
+ *
+ * Grants are counted and the recorders parked on the main thread, so it
+ * doesn't need a lock.
+ */
+class Pre_Tuner {
+public:
+  static void grant(System *system, double freq, bool analog);
+  static void update(std::vector<System *> &systems, std::vector<Source *> &sources);
+  static void print_stats();
+
+private:
+  struct Channel {
+    double grants; // decayed as of updated
+    time_t updated;
+    bool analog; // the last call on it was
+  };
+
+  static const int HALF_LIFE = 300;
+
+  static double decayed(const Channel &channel, time_t now);
+
+  // By System number, then by frequency in Hz
+  static std::map<int, std::map<long, Channel>> channels;
+  static long parked;
+};
+
+#endif // PRE_TUNER_H
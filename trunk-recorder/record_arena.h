@@ -0,0 +1,90 @@
+#ifndef RECORD_ARENA_H
+#define RECORD_ARENA_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+ * Record_Arena
+ *   Makes the records of a table, like the Talkgroups read from a CSV, in
+ *   blocks of BLOCK_SIZE instead of one allocation each, and frees them all
+ *   with the table.
+ *
+ * A block is never grown past the size it was reserved at, so a record
+ * stays where it was made and pointers to it can be handed out. Records
+ * made one after another sit next to each other, which is what a walk
+ * over the whole table wants.
+ */
+template <typename T>
+class Record_Arena {
+public:
+  static const size_t BLOCK_SIZE = 256;
+
+  Record_Arena() : count(0) {}
+
+  template <typename... Args>
+  T *make(Args &&...args) {
+    if (blocks.empty() || (blocks.back().size() == BLOCK_SIZE)) {
+      blocks.push_back(std::vector<T>());
+      blocks.back().reserve(BLOCK_SIZE);
+    }
+    blocks.back().emplace_back(std::forward<Args>(args)...);
+    count++;
+    return &blocks.back().back();
+  }
+
+  size_t size() const { return count; }
+  // The blocks are reserved whole, so this is what they take
+  size_t bytes() const { return blocks.size() * BLOCK_SIZE * sizeof(T); }
+
+  void swap(Record_Arena &other) {
+    blocks.swap(other.blocks);
+    std::swap(count, other.count);
+  }
+
+private:
+  Record_Arena(const Record_Arena &);
+  Record_Arena &operator=(const Record_Arena &);
+
+  std::vector<std::vector<T>> blocks;
+  size_t count;
+};
+
+// About what a hash index takes: a node for each entry and the buckets,
+// for the memory accounting of the tables
+template <typename Map>
+size_t index_bytes(const Map &map) {
+  return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void *)) + map.bucket_count() * sizeof(void *);
+}
+
+// What a string has on the heap, if it is too long to be kept in place
+inline size_t string_bytes(const std::string &s) {
+  return (s.capacity() > 15) ? s.capacity() + 1 : 0;
+}
+
+/*
+ * String_Pool
+ *   Keeps one copy of each distinct string given to it. The fields that
+ *   repeat down a table, like a talkgroup's mode or category, are kept as
+ *   references to the pool's copy, which lasts as long as the pool.
+ */
+class String_Pool {
+public:
+  const std::string &intern(const std::string &s) { return *strings.insert(s).first; }
+  size_t size() const { return strings.size(); }
+  size_t bytes() const {
+    size_t total = index_bytes(strings);
+    for (std::unordered_set<std::string>::const_iterator it = strings.begin(); it != strings.end(); ++it) {
+      total += string_bytes(*it);
+    }
+    return total;
+  }
+
+private:
+  std::unordered_set<std::string> strings; // nodes don't move when it rehashes
+};
+
+#endif // RECORD_ARENA_H
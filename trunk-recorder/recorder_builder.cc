@@ -0,0 +1,96 @@
+#include "recorder_builder.h"
+#include "source.h"
+
+#include <boost/log/trivial.hpp>
+
+std::mutex Recorder_Builder::queue_mutex;
+std::condition_variable Recorder_Builder::queue_cv;
+std::thread Recorder_Builder::worker;
+bool Recorder_Builder::running = false;
+std::deque<Recorder_Builder::Request> Recorder_Builder::requests;
+std::vector<Recorder_Builder::Built> Recorder_Builder::built;
+
+void Recorder_Builder::start() {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  running = true;
+  worker = std::thread(&Recorder_Builder::run);
+}
+
+void Recorder_Builder::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  queue_cv.notify_one();
+  worker.join();
+}
+
+void Recorder_Builder::request(Source *source, Recorder_Type type) {
+  Request request = {source, type};
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  if (!running) {
+    lock.unlock();
+    Built recorder = build(request);
+    lock.lock();
+    built.push_back(recorder);
+    return;
+  }
+  requests.push_back(request);
+  lock.unlock();
+  queue_cv.notify_one();
+}
+
+Recorder_Builder::Built Recorder_Builder::build(const Request &request) {
+  Built recorder;
+  recorder.source = request.source;
+  if (request.type == P25) {
+    recorder.digital = make_p25_recorder(request.source, P25);
+  } else {
+    recorder.analog = make_analog_recorder(request.source, ANALOG);
+  }
+  return recorder;
+}
+
+void Recorder_Builder::run() {
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  while (true) {
+    queue_cv.wait(lock, [] { return !running || !requests.empty(); });
+    if (!running) {
+      break;
+    }
+    Request request = requests.front();
+    requests.pop_front();
+    lock.unlock();
+    Built recorder = build(request);
+    lock.lock();
+    built.push_back(recorder);
+  }
+}
+
+void Recorder_Builder::connect_built(gr::top_block_sptr tb) {
+  std::vector<Built> ready;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (built.empty()) {
+      return;
+    }
+    ready.swap(built);
+  }
+
+  tb->lock();
+  for (std::vector<Built>::iterator it = ready.begin(); it != ready.end(); ++it) {
+    if (it->digital) {
+      it->source->add_built_recorder(tb, it->digital);
+    } else {
+      it->source->add_built_recorder(tb, it->analog);
+    }
+  }
+  tb->unlock();
+  BOOST_LOG_TRIVIAL(info) << "Connected " << ready.size() << " more Recorders";
+}
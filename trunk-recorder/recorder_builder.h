@@ -0,0 +1,62 @@
+#ifndef RECORDER_BUILDER_H
+#define RECORDER_BUILDER_H
+
+#include "global_structs.h"
+#include "recorders/analog_recorder.h"
+#include "recorders/p25_recorder.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gnuradio/top_block.h>
+
+class Source;
+
+/*
+ * Recorder_Builder
+ *   Makes the trunking recorders a Source asks for once its free ones run
+ *   low, on a thread of its own, so designing their filters doesn't hold
+ *   up the main loop.
+ *
+ * A recorder is only made on the builder's thread. It is connected to the
+ * flowgraph by connect_built(), which the main loop calls, and which locks
+ * the top_block once for everything that has been made since it was last
+ * called. Connecting pauses the flowgraph for a moment, which is why a
+ * Source asks for more before it runs out rather than when it has.
+ *
+ * Before start() or after stop() a recorder is made right away by the
+ * caller, and still handed over by connect_built().
+ */
+class Recorder_Builder {
+public:
+  static void start();
+  static void stop();
+  static void request(Source *source, Recorder_Type type);
+  static void connect_built(gr::top_block_sptr tb);
+
+private:
+  struct Request {
+    Source *source;
+    Recorder_Type type;
+  };
+  struct Built {
+    Source *source;
+    p25_recorder_sptr digital;
+    analog_recorder_sptr analog;
+  };
+
+  static void run();
+  static Built build(const Request &request);
+
+  static std::mutex queue_mutex;
+  static std::condition_variable queue_cv;
+  static std::thread worker;
+  static bool running;
+  static std::deque<Request> requests;
+  static std::vector<Built> built;
+};
+
+#endif // RECORDER_BUILDER_H
@@ -0,0 +1,92 @@
+#ifndef RECORDER_POOL_H
+#define RECORDER_POOL_H
+
+#include <cmath>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <unordered_map>
+
+class Recorder;
+
+/*
+ * Recorder_Pool
+ *   The trunking recorders of one type on a Source that are free to take
+ *   a call.
+ *
+ * A recorder leaves the pool when it starts a call and goes back in when
+ * it is stopped, so handing one out and counting the free ones don't have
+ * to look at every recorder.
+ *
+ * A stopped recorder stays tuned to the channel of its last call, and a
+ * site grants the same few voice channels over and over, so a call goes
+ * to a free recorder that is still on its channel when there is one. The
+ * recorder doesn't have to retune and its demodulator's loops are already
+ * locked to the channel. Otherwise the recorder that has been free the
+ * longest is handed out, which leaves the ones on the channels used last
+ * where they are for a while longer.
+ */
+class Recorder_Pool {
+public:
+  // tuned_freq is the channel the recorder is still tuned to, 0 if none
+  void release(Recorder *recorder, double tuned_freq = 0) {
+    if (entries.find(recorder) != entries.end()) {
+      return;
+    }
+    Entry entry;
+    entry.order = free.insert(free.end(), recorder);
+    entry.tuned = tuned.end();
+    if (tuned_freq != 0) {
+      entry.tuned = tuned.insert(std::make_pair(lround(tuned_freq), recorder));
+    }
+    entries[recorder] = entry;
+  }
+
+  void take(Recorder *recorder) {
+    std::unordered_map<Recorder *, Entry>::iterator it = entries.find(recorder);
+    if (it == entries.end()) {
+      return;
+    }
+    free.erase(it->second.order);
+    if (it->second.tuned != tuned.end()) {
+      tuned.erase(it->second.tuned);
+    }
+    entries.erase(it);
+  }
+
+  // A free recorder still tuned to freq, else the one free the longest
+  Recorder *next(double freq) const {
+    std::multimap<long, Recorder *>::const_iterator it = tuned.find(lround(freq));
+    if (it != tuned.end()) {
+      return it->second;
+    }
+    return next();
+  }
+
+  Recorder *next() const { return free.empty() ? NULL : free.front(); }
+  int available() const { return (int)free.size(); }
+
+  bool tuned_to(double freq) const { return tuned.find(lround(freq)) != tuned.end(); }
+  // The channel a free recorder is tuned to, 0 if none
+  double tuned_freq(Recorder *recorder) const {
+    std::unordered_map<Recorder *, Entry>::const_iterator it = entries.find(recorder);
+    if ((it == entries.end()) || (it->second.tuned == tuned.end())) {
+      return 0;
+    }
+    return it->second.tuned->first;
+  }
+
+private:
+  struct Entry {
+    std::list<Recorder *>::iterator order;
+    std::multimap<long, Recorder *>::iterator tuned;
+  };
+
+  // In the order they were released
+  std::list<Recorder *> free;
+  // The ones still tuned to a channel, by its frequency in Hz
+  std::multimap<long, Recorder *> tuned;
+  std::unordered_map<Recorder *, Entry> entries;
+};
+
+#endif // RECORDER_POOL_H
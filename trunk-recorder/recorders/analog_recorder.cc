@@ -1,49 +1,48 @@
 
 #include "analog_recorder.h"
 #include "../formatter.h"
-#include "../gr_blocks/dcs_squelch_ff_impl.h"
 #include "../gr_blocks/decoder_wrapper_impl.h"
 #include "../gr_blocks/plugin_wrapper_impl.h"
+#include "../gr_blocks/subaudio_squelch_ff_impl.h"
 #include "../gr_blocks/transmission_sink.h"
 #include "../plugin_manager/plugin_manager.h"
 #include "../recorder_globals.h"
+#include "../replay_clock.h"
+#include "../tone_scanner.h"
 
 using namespace std;
 
 bool analog_recorder::logging = false;
 // static int rec_counter = 0;
 
-std::vector<float> design_filter(double interpolation, double deci) {
+Filter_Taps::Real design_filter(double interpolation, double deci) {
   float beta = 5.0;
   float trans_width = 0.5 - 0.4;
   float mid_transition_band = 0.5 - trans_width / 2;
 
-#if GNURADIO_VERSION < 0x030900
-  std::vector<float> result = gr::filter::firdes::low_pass(
+  return Filter_Taps::low_pass(
       interpolation,
       1,
       mid_transition_band / interpolation,
       trans_width / interpolation,
-      gr::filter::firdes::WIN_KAISER,
+      Filter_Taps::KAISER,
       beta);
-#else
-  std::vector<float> result = gr::filter::firdes::low_pass(
-      interpolation,
-      1,
-      mid_transition_band / interpolation,
-      trans_width / interpolation,
-      gr::fft::window::WIN_KAISER,
-      beta);
-#endif
-  return result;
 }
 
 analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type) {
-  return gnuradio::get_initial_sptr(new analog_recorder(src, static_cast<System*>(nullptr), type, -1));
+  return make_analog_recorder(src, type, 0, false);
 }
 
-analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq) {
-  return gnuradio::get_initial_sptr(new analog_recorder(src, static_cast<System*>(nullptr), type, tone_freq));
+analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq, bool tone_squelch_gate) {
+  analog_recorder_sptr recorder = gnuradio::get_initial_sptr(new analog_recorder(src, static_cast<System*>(nullptr), type, tone_freq, tone_squelch_gate));
+  if (src->get_low_latency()) {
+    recorder->enable_low_latency();
+  }
+  int buffer_items = src->get_recorder_buffer_items(type);
+  if (buffer_items > 0) {
+    recorder->set_max_output_buffer(buffer_items);
+  }
+  return recorder;
 }
 
 void analog_recorder::set_tau(float tau) {
@@ -52,6 +51,11 @@ void analog_recorder::set_tau(float tau) {
   if (deemph) {
     deemph->set_taps(d_fftaps, d_fbtaps);
   }
+  if (fused_demod) {
+    fused_demod->set_deemph_taps(d_fftaps, d_fbtaps);
+  } else if (fused_audio) {
+    fused_audio->set_deemph_taps(d_fftaps, d_fbtaps);
+  }
 }
 
 float analog_recorder::get_tau() const {
@@ -84,7 +88,7 @@ void analog_recorder::calculate_iir_taps(float tau) {
   d_fbtaps[1] = -p1;
 }
 
-analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type, float tone_freq)
+analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type, float tone_freq, bool tone_squelch_gate)
     : gr::hier_block2("analog_recorder",
                       gr::io_signature::make(1, 1, sizeof(gr_complex)),
                       gr::io_signature::make(0, 0, sizeof(float))),
@@ -95,6 +99,7 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
   this->system = system;
   chan_freq = source->get_center();
   center_freq = source->get_center();
+  tuned_offset = NAN;
   config = source->get_config();
   input_rate = source->get_rate();
   squelch_db = 0;
@@ -105,39 +110,30 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
   rec_num = rec_counter++;
   state = INACTIVE;
 
-  timestamp = time(NULL);
-  starttime = time(NULL);
+  timestamp = Replay_Clock::now();
+  starttime = Replay_Clock::now();
 
   bool use_streaming = false;
+  bool use_tone_scan = false;
 
-  use_dcs_squelch = false;
-  dcs_code = 0;
-  dcs_inverted = false;
-
-  if (tone_freq > 0) {
-    use_tone_squelch = true;
-    this->tone_freq = tone_freq;
-  } else if (tone_freq < 0) {
-    /* DCS encoded as negative: -(code) normal, -(code+1000) inverted */
-    use_tone_squelch = false;
-    this->tone_freq = 0;
-    use_dcs_squelch = true;
-    int raw = (int)(-tone_freq + 0.5f);
-    dcs_code     = raw % 1000;
-    dcs_inverted = (raw >= 1000);
-  } else {
-    use_tone_squelch = false;
-    this->tone_freq = 0;
-  }
+  this->tone_squelch_gate = tone_squelch_gate;
 
+  /* Positive is a CTCSS tone, negative a DCS code; either uses the sub-audio squelch */
+  this->tone_freq = tone_freq;
+  use_subaudio_squelch = (tone_freq != 0);
+
+  bool use_fused_audio = false;
   if (config != NULL) {
     use_streaming = config->enable_audio_streaming;
+    use_tone_scan = config->tone_scan;
+    use_fused_audio = config->fused_analog_audio;
   }
 
   if (type == ANALOGC) {
     conventional = true;
   } else {
     conventional = false;
+    use_tone_scan = false; // trunked channels carry no tone of interest
   }
 
   int samp_per_sym        = 2;
@@ -148,43 +144,55 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
   // The Prefilter provides the initial squelch for the channel
   prefilter = xlat_channelizer::make(input_rate, samp_per_sym, system_channel_rate / samp_per_sym, bandwidth, center_freq, true);
   prefilter->set_analog_squelch(true);
+  prefilter->set_enabled(false); // parked until it is started
+  prefilter->set_nthreads(source->get_analog_fft_threads());
 
   //  based on squelch code form ham2mon
   // set low -200 since its after demod and its just gate for previous squelch so that the audio
   // recording doesn't contain blank spaces between transmissions
-  squelch_two = gr::analog::pwr_squelch_ff::make(-200, 0.01, 0, true);
-
-  if (use_tone_squelch) {
-    tone_squelch = gr::analog::ctcss_squelch_ff::make(system_channel_rate, this->tone_freq, 0.01, 0, 0, false);
+  if (!use_fused_audio) {
+    squelch_two = gr::analog::pwr_squelch_ff::make(-200, 0.01, 0, true);
   }
-  if (use_dcs_squelch) {
-    dcs_squelch = gr::blocks::dcs_squelch_ff_impl::make((int)system_channel_rate, dcs_code, dcs_inverted, 250.0f);
+
+  if (use_subaudio_squelch) {
+    subaudio_squelch = gr::blocks::subaudio_squelch_ff_impl::make((int)system_channel_rate, 250.0f, tone_squelch_gate);
+    subaudio_squelch->add_target(this->tone_freq);
   }
   // k = quad_rate/(2*math.pi*max_dev) = 48k / (6.283185*5000) = 1.527
 
   int d_max_dev = 5000;
   /* demodulator gain */
   quad_gain = system_channel_rate / (2.0 * M_PI * d_max_dev);
-  demod = gr::analog::quadrature_demod_cf::make(quad_gain);
-  levels = gr::blocks::multiply_const_ff::make(1); // 33);
-  converter = gr::blocks::float_to_short::make(1, 32767);
+  if (!use_fused_audio) {
+    demod = gr::analog::quadrature_demod_cf::make(quad_gain);
+    levels = gr::blocks::multiply_const_ff::make(1); // 33);
+    converter = gr::blocks::float_to_short::make(1, 32767);
+  }
 
   /* de-emphasis */
   d_tau = (system != nullptr) ? system->get_tau() : 0.000075f;  // Default to 75us if system is not provided
   d_fftaps.resize(2);
   d_fbtaps.resize(2);
   calculate_iir_taps(d_tau);
-  deemph = gr::filter::iir_filter_ffd::make(d_fftaps, d_fbtaps, false);
+  if (!use_fused_audio) {
+    deemph = gr::filter::iir_filter_ffd::make(d_fftaps, d_fbtaps, false);
+  }
 
   audio_resampler_taps = design_filter(1, (system_channel_rate / wav_sample_rate)); // Calculated to make sample rate changable -- must be an integer
 
-  BOOST_LOG_TRIVIAL(info) << "Audio Resampler Taps: " << audio_resampler_taps.size() << " Decimation: " << (system_channel_rate / wav_sample_rate);
+  BOOST_LOG_TRIVIAL(info) << "Audio Resampler Taps: " << audio_resampler_taps->size() << " Decimation: " << (system_channel_rate / wav_sample_rate);
   // downsample from 48k to 8k
-  decim_audio = gr::filter::fir_filter_fff::make((system_channel_rate / wav_sample_rate), audio_resampler_taps); // Calculated to make sample rate changable
+  if (!use_fused_audio) {
+    decim_audio = gr::filter::fir_filter_fff::make((system_channel_rate / wav_sample_rate), *audio_resampler_taps); // Calculated to make sample rate changable
+  }
 
   // tm *ltm = localtime(&starttime);
 
   wav_sink = gr::blocks::transmission_sink::make(1, wav_sample_rate, 16); //  Configurable
+  // With a gated tone squelch no samples arrive while it is closed, so the sink ends transmissions on its squelch tags
+  if (tone_squelch_gate && use_subaudio_squelch) {
+    wav_sink->set_end_on_squelch_eob(true);
+  }
 
   if (use_streaming) {
     BOOST_LOG_TRIVIAL(info) << "\t Creating plugin sink..." << std::endl;
@@ -193,39 +201,101 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
   }
 
   BOOST_LOG_TRIVIAL(info) << "\t Creating decoder sink..." << std::endl;
-  decoder_sink = gr::blocks::decoder_wrapper_impl::make(wav_sample_rate, std::bind(&analog_recorder::decoder_callback_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+  decoder_sink = gr::blocks::decoder_wrapper_impl::make(wav_sample_rate, std::bind(&analog_recorder::decoder_callback_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), (config != NULL) && config->decoder_thread);
   BOOST_LOG_TRIVIAL(info) << "\t Decoder sink created!" << std::endl;
 
   // Analog audio band pass from 300 to 3000 Hz
   // can't use gnuradio.filter.firdes.band_pass since we have different transition widths
   // 300 Hz high pass (275-325 Hz): removes CTCSS/DCS and Type II 150 bps Low Speed Data (LSD), or "FSK wobble"
-#if GNURADIO_VERSION < 0x030900
-  high_f_taps = gr::filter::firdes::high_pass(1, wav_sample_rate, 300, 50, gr::filter::firdes::WIN_HANN); // Configurable
-  low_f_taps = gr::filter::firdes::low_pass(1, wav_sample_rate, 3250, 500, gr::filter::firdes::WIN_HANN);
-#else
-  high_f_taps = gr::filter::firdes::high_pass(1, wav_sample_rate, 300, 50, gr::fft::window::WIN_HANN); // Configurable
-  low_f_taps = gr::filter::firdes::low_pass(1, wav_sample_rate, 3250, 500, gr::fft::window::WIN_HANN);
-#endif
+  high_f_taps = Filter_Taps::high_pass(1, wav_sample_rate, 300, 50, Filter_Taps::HANN); // Configurable
+  low_f_taps = Filter_Taps::low_pass(1, wav_sample_rate, 3250, 500, Filter_Taps::HANN);
+
+  if (use_fused_audio) {
+    // The whole chain in one block, split at the de-emphasis when the tone squelch or the tone scanner needs the audio there
+    if (use_subaudio_squelch || use_tone_scan) {
+      fused_demod = make_nbfm_demod(quad_gain, d_fftaps, d_fbtaps);
+    }
+    fused_audio = make_nbfm_audio(!fused_demod, quad_gain, d_fftaps, d_fbtaps, (system_channel_rate / wav_sample_rate), *audio_resampler_taps, *high_f_taps, *low_f_taps);
+  } else {
+    high_f = gr::filter::fir_filter_fff::make(1, *high_f_taps);
+    // 3000 Hz low pass (3000-3500 Hz)
+
+    low_f = gr::filter::fir_filter_fff::make(1, *low_f_taps);
+  }
 
-  high_f = gr::filter::fir_filter_fff::make(1, high_f_taps);
-  // 3000 Hz low pass (3000-3500 Hz)
+  // Sub-audio for the tone scanner, taken before any tone squelch so a closed squelch doesn't hide the tone
+  tone_scan_channel = -1;
+  if (use_tone_scan) {
+    tone_scan_taps = Filter_Taps::low_pass(1, system_channel_rate, 300, 200, Filter_Taps::HANN);
+    tone_scan_lpf = gr::filter::fir_filter_fff::make((system_channel_rate / Tone_Scanner::SAMPLE_RATE), *tone_scan_taps);
+    tone_scan_channel = Tone_Scanner::add_channel();
+    tone_scan = gr::blocks::tone_scan_sink::make(tone_scan_channel);
+    Tone_Scanner::start();
+  }
 
-  low_f = gr::filter::fir_filter_fff::make(1, low_f_taps);
+  bool tracing = Stage_Latency::enabled();
+  if (tracing) {
+    // There is no frame assembler, and the subaudio squelch and the fused
+    // audio don't pass the stamps on, so the sink has none in those chains
+    latency_tagger = Stage_Latency::make_tagger(sizeof(gr_complex), input_rate);
+    channelizer_probe = Stage_Latency::make_probe(get_type_string(), TRACE_CHANNELIZER, sizeof(gr_complex));
+    demod_probe = Stage_Latency::make_probe(get_type_string(), TRACE_DEMOD, sizeof(float));
+    sink_probe = Stage_Latency::make_probe(get_type_string(), TRACE_SINK, sizeof(short));
+    connect(self(), 0, latency_tagger, 0);
+    connect(latency_tagger, 0, prefilter, 0);
+    connect(prefilter, 0, channelizer_probe, 0);
+  } else {
+    connect(self(), 0, prefilter, 0);
+  }
+  if (source->get_iq_ring_seconds() > 0) {
+    iq_ring = make_iq_ring_buffer(system_channel_rate, source->get_iq_ring_seconds());
+    connect(prefilter, 0, iq_ring, 0);
+  }
+  if (use_fused_audio) {
+    if (fused_demod) {
+      connect(prefilter, 0, fused_demod, 0);
+      if (use_subaudio_squelch) {
+        connect(fused_demod, 0, subaudio_squelch, 0);
+        connect(subaudio_squelch, 0, fused_audio, 0);
+      } else {
+        connect(fused_demod, 0, fused_audio, 0);
+      }
+      if (use_tone_scan) {
+        connect(fused_demod, 0, tone_scan_lpf, 0);
+        connect(tone_scan_lpf, 0, tone_scan, 0);
+      }
+    } else {
+      connect(prefilter, 0, fused_audio, 0);
+    }
+    if (tracing) {
+      if (fused_demod) {
+        connect(fused_demod, 0, demod_probe, 0);
+      }
+      connect(fused_audio, 0, sink_probe, 0);
+    }
+    connect(fused_audio, 0, wav_sink, 0);
+    connect(fused_audio, 1, decoder_sink, 0);
+    if (use_streaming) {
+      connect(fused_audio, 0, plugin_sink, 0);
+    }
+    return;
+  }
 
   // using squelch
-  connect(self(), 0, prefilter, 0);
   connect(prefilter, 0, demod, 0);
   connect(demod, 0, deemph, 0);
-  if (use_tone_squelch) {
-    connect(deemph, 0, tone_squelch, 0);
-    connect(tone_squelch, 0, decim_audio, 0);
-  } else if (use_dcs_squelch) {
-    connect(deemph, 0, dcs_squelch, 0);
-    connect(dcs_squelch, 0, decim_audio, 0);
+  if (use_subaudio_squelch) {
+    connect(deemph, 0, subaudio_squelch, 0);
+    connect(subaudio_squelch, 0, decim_audio, 0);
   } else {
     connect(deemph, 0, decim_audio, 0);
   }
 
+  if (use_tone_scan) {
+    connect(deemph, 0, tone_scan_lpf, 0);
+    connect(tone_scan_lpf, 0, tone_scan, 0);
+  }
+
   connect(decim_audio, 0, decoder_sink, 0);
   connect(decim_audio, 0, high_f, 0);
   connect(high_f, 0, low_f, 0);
@@ -233,6 +303,10 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
   connect(squelch_two, 0, levels, 0);
   connect(levels, 0, converter, 0);
   connect(converter, 0, wav_sink, 0);
+  if (tracing) {
+    connect(demod, 0, demod_probe, 0);
+    connect(converter, 0, sink_probe, 0);
+  }
 
   if (use_streaming) {
     connect(converter, 0, plugin_sink, 0);
@@ -241,6 +315,43 @@ analog_recorder::analog_recorder(Source *src, System *system, Recorder_Type type
 
 analog_recorder::~analog_recorder() {}
 
+// The fused audio chain without the fused demod doesn't pass the strobes
+// on, it only has its buffers capped
+void analog_recorder::enable_low_latency() {
+  if (low_latency) {
+    return;
+  }
+  low_latency = true;
+  gr::basic_block_sptr next;
+  if (!fused_audio) {
+    next = demod;
+  } else if (fused_demod) {
+    next = fused_demod;
+  }
+  if (next) {
+    latency_manager = Low_Latency_Profile::make_manager(sizeof(gr_complex), system_channel_rate);
+    disconnect(prefilter, 0, next, 0);
+    connect(prefilter, 0, latency_manager, 0);
+    connect(latency_manager, 0, next, 0);
+    Low_Latency_Profile::return_strobes(this, next, 0, sizeof(float), latency_manager);
+  }
+
+  std::vector<gr::basic_block_sptr> blocks;
+  blocks.push_back(demod);
+  blocks.push_back(deemph);
+  blocks.push_back(subaudio_squelch);
+  blocks.push_back(decim_audio);
+  blocks.push_back(high_f);
+  blocks.push_back(low_f);
+  blocks.push_back(squelch_two);
+  blocks.push_back(levels);
+  blocks.push_back(converter);
+  blocks.push_back(tone_scan_lpf);
+  blocks.push_back(fused_demod);
+  blocks.push_back(fused_audio);
+  Low_Latency_Profile::cap_buffers(blocks);
+}
+
 long analog_recorder::get_wav_hz() { return wav_sample_rate; };
 
 State analog_recorder::get_state() {
@@ -248,7 +359,7 @@ State analog_recorder::get_state() {
 }
 
 double analog_recorder::since_last_write() {
-  time_t now = time(NULL);
+  time_t now = Replay_Clock::now();
   return now - wav_sink->get_stop_time();
 }
 
@@ -266,15 +377,17 @@ void analog_recorder::stop() {
     state = INACTIVE;
     set_enabled(false);
     wav_sink->stop_recording();
+    source->release_recorder(this);
   } else {
 
     BOOST_LOG_TRIVIAL(error) << "analog_recorder.cc: Stopping an inactive Logger \t[ " << rec_num << " ] - freq[ " << format_freq(chan_freq) << "] \t talkgroup[ " << talkgroup << " ]";
   }
 
-  decoder_sink->set_mdc_enabled(false);
-  decoder_sink->set_fsync_enabled(false);
-  decoder_sink->set_star_enabled(false);
+  decoder_sink->set_signal_decoders(0);
   decoder_sink->set_tps_enabled(false);
+
+  // Deliver anything decoded before the decoders were turned off while this call is still set
+  decoder_sink->process_message_queues();
 }
 
 void analog_recorder::process_message_queues() {
@@ -294,23 +407,36 @@ bool analog_recorder::is_active() {
 }
 
 bool analog_recorder::is_enabled() {
-  return source->is_selector_port_enabled(selector_port);
+  return prefilter->is_enabled();
 }
 
 void analog_recorder::set_enabled(bool enabled) {
-  source->set_selector_port_enabled(selector_port, enabled);
+  prefilter->set_enabled(enabled);
 }
 
 bool analog_recorder::is_squelched() {
   return prefilter->is_squelched();
 }
 
+bool analog_recorder::add_tone_target(float tone) {
+  if (!use_subaudio_squelch) {
+    return false;
+  }
+  return subaudio_squelch->add_target(tone);
+}
+
 double analog_recorder::get_pwr() {
   return prefilter->get_pwr();
 }
 
 bool analog_recorder::is_idle() {
   if (state == ACTIVE) {
+    if (tone_squelch_gate) {
+      // a closed tone/DCS squelch means nothing is being written, even with a carrier present
+      if (use_subaudio_squelch && !subaudio_squelch->is_open()) {
+        return true;
+      }
+    }
     return prefilter->is_squelched();
   }
   return true;
@@ -336,12 +462,20 @@ Source *analog_recorder::get_source() {
   return source;
 }
 
+bool analog_recorder::snapshot_iq(const std::string &base) {
+  if (!iq_ring) {
+    return false;
+  }
+  std::string hw = source->get_driver() + ": " + source->get_device() + " - " + source->get_antenna();
+  return iq_ring->snapshot(base, chan_freq, hw, source->get_num());
+}
+
 int analog_recorder::lastupdate() {
-  return time(NULL) - timestamp;
+  return Replay_Clock::now() - timestamp;
 }
 
 long analog_recorder::elapsed() {
-  return time(NULL) - starttime;
+  return Replay_Clock::now() - starttime;
 }
 
 time_t analog_recorder::get_start_time() {
@@ -357,6 +491,7 @@ void analog_recorder::tune_freq(double f) {
   int offset_amount = (center_freq - f);
 
   prefilter->tune_offset(offset_amount);
+  tuned_offset = offset_amount;
 }
 
 void analog_recorder::decoder_callback_handler(long unitId, const char *signaling_type, gr::blocks::SignalType signal) {
@@ -373,15 +508,13 @@ void analog_recorder::plugin_callback_handler(int16_t *samples, int sampleCount)
 }
 
 void analog_recorder::setup_decoders_for_system(System *system) {
-  decoder_sink->set_dcs_enabled(system->get_dcs_enabled());
-  decoder_sink->set_mdc_enabled(system->get_mdc_enabled());
-  decoder_sink->set_fsync_enabled(system->get_fsync_enabled());
-  decoder_sink->set_star_enabled(system->get_star_enabled());
+  // Decoders are only built the first time a system needs them
+  decoder_sink->set_signal_decoders(system->get_signal_decoders());
   decoder_sink->set_tps_enabled(system->get_tps_enabled());
 }
 
 bool analog_recorder::start(Call *call) {
-  starttime = time(NULL);
+  starttime = Replay_Clock::now();
   System *system = call->get_system();
   this->call = call;
 
@@ -394,22 +527,44 @@ bool analog_recorder::start(Call *call) {
 
   // BOOST_LOG_TRIVIAL(error) << "Setting squelch to: " << squelch_db << " block says: " << squelch->threshold();
   
-  levels->set_k(system->get_analog_levels());
   int d_max_dev = system->get_max_dev();
   prefilter->set_max_dev(d_max_dev);
   quad_gain = system_channel_rate / (2.0 * M_PI * (d_max_dev + 1000));
-  demod->set_gain(quad_gain);
+  if (fused_audio) {
+    fused_audio->set_level(system->get_analog_levels());
+    if (fused_demod) {
+      fused_demod->set_quad_gain(quad_gain);
+    } else {
+      fused_audio->set_quad_gain(quad_gain);
+    }
+  } else {
+    levels->set_k(system->get_analog_levels());
+    demod->set_gain(quad_gain);
+  }
+  // Still on the channel of its last call, see Recorder_Pool
   int offset_amount = (center_freq - chan_freq);
-  prefilter->tune_offset(offset_amount);
+  if (offset_amount != tuned_offset) {
+    prefilter->tune_offset(offset_amount);
+    tuned_offset = offset_amount;
+  } else {
+    call->set_pre_tuned(true);
+  }
+  call->mark_latency(LATENCY_RETUNE);
 
   wav_sink->start_recording(call);
 
+  if (tone_scan_channel >= 0) {
+    Tone_Scanner::set_channel_info(tone_scan_channel, call->get_short_name(), chan_freq, talkgroup);
+  }
+
   state = ACTIVE;
+  source->take_recorder(this);
   if (conventional) {
     Call_conventional *conventional_call = dynamic_cast<Call_conventional *>(call);
     squelch_db = conventional_call->get_squelch_db();
     if (conventional_call->get_signal_detection()) {
       set_enabled(false);
+      source->arm_detected_recorder(this);
     } else {
       set_enabled(true); // If signal detection is not being used, open up the Value/Selector from the start
     }
@@ -33,7 +33,6 @@
 #include <gnuradio/filter/firdes.h>
 #include <gnuradio/filter/iir_filter_ffd.h>
 
-#include <gnuradio/analog/ctcss_squelch_ff.h>
 #include <gnuradio/analog/pwr_squelch_cc.h>
 #include <gnuradio/analog/pwr_squelch_ff.h>
 #include <gnuradio/analog/quadrature_demod_cf.h>
@@ -46,14 +45,20 @@ class Source;
 class analog_recorder;
 
 #include "../gr_blocks/channelizer.h"
-#include "../gr_blocks/dcs_squelch_ff.h"
 #include "../gr_blocks/decoder_wrapper.h"
+#include "../gr_blocks/filter_taps.h"
 #include "../gr_blocks/freq_xlating_fft_filter.h"
+#include "../gr_blocks/iq_ring_buffer.h"
+#include "../gr_blocks/nbfm_audio.h"
 #include "../gr_blocks/plugin_wrapper.h"
+#include "../gr_blocks/subaudio_squelch_ff.h"
+#include "../gr_blocks/tone_scan_sink.h"
 #include "../gr_blocks/transmission_sink.h"
 #include "../gr_blocks/xlat_channelizer.h"
 #include "../systems/system.h"
 #include "../call_conventional.h"
+#include "../stage_latency.h"
+#include "low_latency_profile.h"
 #include "recorder.h"
 
 #if GNURADIO_VERSION < 0x030900
@@ -67,13 +72,13 @@ typedef std::shared_ptr<analog_recorder> analog_recorder_sptr;
 int plugman_signal(long unitId, const char *signaling_type, gr::blocks::SignalType sig_type, Call *call, System *system, Recorder *recorder);
 
 analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type);
-analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq);
+analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq, bool tone_squelch_gate = false);
 class analog_recorder : public gr::hier_block2, public Recorder {
   friend analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type);
-  friend analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq);
+  friend analog_recorder_sptr make_analog_recorder(Source *src, Recorder_Type type, float tone_freq, bool tone_squelch_gate);
 
 protected:
-  analog_recorder(Source *src, System *system, Recorder_Type type, float tone_freq);
+  analog_recorder(Source *src, System *system, Recorder_Type type, float tone_freq, bool tone_squelch_gate);
 
 public:
   ~analog_recorder();
@@ -94,6 +99,7 @@ public:
   bool is_analog();
   bool is_idle();
   bool is_squelched();
+  bool add_tone_target(float tone);
   double get_pwr();
   std::vector<Transmission> get_transmission_list();
   State get_state();
@@ -108,9 +114,12 @@ public:
   double since_last_write();
   void set_tau(float tau);
   float get_tau() const;
+  bool snapshot_iq(const std::string &base);
+  void enable_low_latency();
 
 private:
   double center_freq, chan_freq;
+  double tuned_offset; // the offset the channelizer is tuned to, NAN before the first call
   long talkgroup;
   long input_rate;
   float tone_freq;
@@ -121,18 +130,18 @@ private:
   double squelch_db;
   time_t timestamp;
   time_t starttime;
-  bool use_tone_squelch;
-  bool use_dcs_squelch;
-  int  dcs_code;
-  bool dcs_inverted;
+  bool use_subaudio_squelch;
+  bool tone_squelch_gate; // drop samples instead of zeroing them while the tone/DCS squelch is closed
+  int tone_scan_channel;  // Tone_Scanner channel, -1 if not scanning
 
   State state;
   std::vector<float> channel_lpf_taps;
   std::vector<float> lpf_taps;
-  std::vector<float> audio_resampler_taps;
+  Filter_Taps::Real audio_resampler_taps;
   std::vector<float> sym_taps;
-  std::vector<float> high_f_taps;
-  std::vector<float> low_f_taps;
+  Filter_Taps::Real high_f_taps;
+  Filter_Taps::Real low_f_taps;
+  Filter_Taps::Real tone_scan_taps;
   /* De-emph IIR filter taps */
   std::vector<double> d_fftaps; /*! Feed forward taps. */
   std::vector<double> d_fbtaps; /*! Feed back taps. */
@@ -157,11 +166,21 @@ private:
   gr::filter::fir_filter_fff::sptr high_f;
   gr::filter::fir_filter_fff::sptr low_f;
   gr::analog::pwr_squelch_ff::sptr squelch_two;
-  gr::analog::ctcss_squelch_ff::sptr tone_squelch;
-  gr::blocks::dcs_squelch_ff::sptr dcs_squelch;
+  gr::blocks::subaudio_squelch_ff::sptr subaudio_squelch;
+  gr::filter::fir_filter_fff::sptr tone_scan_lpf;
+  gr::blocks::tone_scan_sink::sptr tone_scan;
 
   gr::analog::quadrature_demod_cf::sptr demod;
   gr::blocks::float_to_short::sptr converter;
+  nbfm_demod_sptr fused_demod;
+  nbfm_audio_sptr fused_audio;
+  iq_ring_buffer_sptr iq_ring;
+  gr::gr_latency::latency_tagger::sptr latency_tagger;
+  gr::gr_latency::latency_probe::sptr channelizer_probe;
+  gr::gr_latency::latency_probe::sptr demod_probe;
+  gr::gr_latency::latency_probe::sptr sink_probe;
+  gr::latency_manager::latency_manager::sptr latency_manager;
+  bool low_latency = false;
 
   gr::blocks::transmission_sink::sptr wav_sink;
   gr::blocks::decoder_wrapper::sptr decoder_sink;
@@ -1,15 +1,17 @@
 
 #include "debug_recorder_impl.h"
 #include "debug_recorder.h"
+#include "../replay_clock.h"
 #include <boost/log/trivial.hpp>
-#if GNURADIO_VERSION >= 0x030a00
-#include <gnuradio/network/udp_header_types.h>
-#endif
 
 // static int rec_counter=0;
 
 debug_recorder_sptr make_debug_recorder(Source *src, std::string address, int port) {
   debug_recorder *recorder = new debug_recorder_impl(src, address, port);
+  int buffer_items = src->get_recorder_buffer_items(DEBUG);
+  if (buffer_items > 0) {
+    recorder->set_max_output_buffer(buffer_items);
+  }
 
   return gnuradio::get_initial_sptr(recorder);
 }
@@ -48,30 +50,8 @@ void debug_recorder_impl::generate_arb_taps() {
 }
 
 debug_recorder_impl::DecimSettings debug_recorder_impl::get_decim(long speed) {
-  long s = speed;
-  long if_freqs[] = {32000};
-  DecimSettings decim_settings = {-1, -1};
-  for (int i = 0; i < 3; i++) {
-    long if_freq = if_freqs[i];
-    if (s % if_freq != 0) {
-      continue;
-    }
-    long q = s / if_freq;
-    if (q & 1) {
-      continue;
-    }
-
-    if ((q >= 40) && ((q & 3) == 0)) {
-      decim_settings.decim = q / 4;
-      decim_settings.decim2 = 4;
-    } else {
-      decim_settings.decim = q / 2;
-      decim_settings.decim2 = 2;
-    }
-    BOOST_LOG_TRIVIAL(debug) << "debug recorder Decim: " << decim_settings.decim << " Decim2:  " << decim_settings.decim2;
-    return decim_settings;
-  }
-  BOOST_LOG_TRIVIAL(error) << "debug recorder Decim: Nothing found";
+  channel_tuner::Decim decim = channel_tuner::two_stage_decim(speed, {32000});
+  DecimSettings decim_settings = {decim.decim, decim.decim2};
   return decim_settings;
 }
 
@@ -87,11 +67,6 @@ void debug_recorder_impl::initialize_prefilter() {
   symbol_rate = phase1_symbol_rate;
   system_channel_rate = 32000; // symbol_rate * samples_per_symbol;
 
-  valve = gr::blocks::copy::make(sizeof(gr_complex));
-  valve->set_enabled(false);
-  lo = gr::analog::sig_source_c::make(input_rate, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
-  mixer = gr::blocks::multiply_cc::make();
-
   debug_recorder_impl::DecimSettings decim_settings = get_decim(input_rate);
   if (decim_settings.decim != -1) {
     double_decim = true;
@@ -101,16 +76,14 @@ void debug_recorder_impl::initialize_prefilter() {
     fa = 6250;
     fb = if2 / 2;
     BOOST_LOG_TRIVIAL(info) << "\t P25 Recorder two-stage decimator - Initial decimated rate: " << if1 << " Second decimated rate: " << if2 << " FA: " << fa << " FB: " << fb << " System Rate: " << input_rate;
-    bandpass_filter_coeffs = gr::filter::firdes::complex_band_pass(1.0, input_rate, -if1 / 2, if1 / 2, if1 / 2);
+    tuner = channel_tuner::make(input_rate, decim);
     lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, if1, (fb + fa) / 2, fb - fa);
-    bandpass_filter = gr::filter::fft_filter_ccc::make(decim_settings.decim, bandpass_filter_coeffs);
     lowpass_filter = gr::filter::fft_filter_ccf::make(decim_settings.decim2, lowpass_filter_coeffs);
     resampled_rate = if2;
-    bfo = gr::analog::sig_source_c::make(if1, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
   } else {
     double_decim = false;
     BOOST_LOG_TRIVIAL(info) << "\t P25 Recorder single-stage decimator - Initial decimated rate: " << if1 << " Second decimated rate: " << if2 << " Initial Decimation: " << decim << " System Rate: " << input_rate;
-    lo = gr::analog::sig_source_c::make(input_rate, gr::analog::GR_SIN_WAVE, 0, 1.0, 0.0);
+    tuner = channel_tuner::make(input_rate, 1);
     lowpass_filter_coeffs = gr::filter::firdes::low_pass(1.0, input_rate, 12000, 2000);
     decim = floor(input_rate / if_rate);
     resampled_rate = input_rate / decim;
@@ -118,6 +91,8 @@ void debug_recorder_impl::initialize_prefilter() {
     lowpass_filter = gr::filter::fft_filter_ccf::make(decim, lowpass_filter_coeffs);
     resampled_rate = input_rate / decim;
   }
+  // Nothing is worked out until a call is started
+  tuner->set_enabled(false);
 
   // ARB Resampler
   arb_rate = if_rate / resampled_rate;
@@ -131,16 +106,8 @@ void debug_recorder_impl::initialize_prefilter() {
   // the received audio is high-passed above the cutoff and then fed to a
   // reverse squelch. If the power is then BELOW a threshold, open the squelch.
 
-  connect(self(), 0, valve, 0);
-  if (double_decim) {
-    connect(valve, 0, bandpass_filter, 0);
-    connect(bandpass_filter, 0, mixer, 0);
-    connect(bfo, 0, mixer, 1);
-  } else {
-    connect(valve, 0, mixer, 0);
-    connect(lo, 0, mixer, 1);
-  }
-  connect(mixer, 0, lowpass_filter, 0);
+  connect(self(), 0, tuner, 0);
+  connect(tuner, 0, lowpass_filter, 0);
   connect(lowpass_filter, 0, arb_resampler, 0);
 }
 
@@ -158,15 +125,11 @@ debug_recorder_impl::debug_recorder_impl(Source *src, std::string address, int p
 
   state = INACTIVE;
 
-  timestamp = time(NULL);
-  starttime = time(NULL);
+  timestamp = Replay_Clock::now();
+  starttime = Replay_Clock::now();
 
   initialize_prefilter();
-#if GNURADIO_VERSION < 0x030a00
-  udp_sink = gr::blocks::udp_sink::make(sizeof(gr_complex), address, port);
-#else
-  udp_sink = gr::network::udp_sink::make(sizeof(gr_complex), 1, address, port, HEADERTYPE_NONE, 1472, true);
-#endif
+  udp_sink = make_udp_batch_sink(address, port, config->debug_recorder_payload, config->debug_recorder_format == "ci16", config->debug_recorder_seq_num, config->debug_recorder_zerocopy);
   connect(arb_resampler, 0, udp_sink, 0);
 }
 
@@ -203,11 +166,11 @@ double debug_recorder_impl::get_current_length() {
 }
 
 int debug_recorder_impl::lastupdate() {
-  return time(NULL) - timestamp;
+  return Replay_Clock::now() - timestamp;
 }
 
 long debug_recorder_impl::elapsed() {
-  return time(NULL) - starttime;
+  return Replay_Clock::now() - starttime;
 }
 
 void debug_recorder_impl::tune_freq(double f) {
@@ -222,22 +185,7 @@ void debug_recorder_impl::tune_offset(double f) {
   if (abs(freq) > ((input_rate / 2) - (if1 / 2))) {
     BOOST_LOG_TRIVIAL(info) << "Tune Offset: Freq exceeds limit: " << abs(freq) << " compared to: " << ((input_rate / 2) - (if1 / 2));
   }
-  if (double_decim) {
-    bandpass_filter_coeffs = gr::filter::firdes::complex_band_pass(1.0, input_rate, -freq - if1 / 2, -freq + if1 / 2, if1 / 2);
-    bandpass_filter->set_taps(bandpass_filter_coeffs);
-    float bfz = (static_cast<float>(decim) * -freq) / (float)input_rate;
-    bfz = bfz - static_cast<int>(bfz);
-    if (bfz < -0.5) {
-      bfz = bfz + 1.0;
-    }
-    if (bfz > 0.5) {
-      bfz = bfz - 1.0;
-    }
-    bfo->set_frequency(-bfz * if1);
-
-  } else {
-    lo->set_frequency(freq);
-  }
+  tuner->tune_offset(freq);
 }
 
 State debug_recorder_impl::get_state() {
@@ -248,7 +196,7 @@ void debug_recorder_impl::stop() {
   if (state == ACTIVE) {
     BOOST_LOG_TRIVIAL(error) << "debug_recorder.cc: Stopping Logger \t[ " << rec_num << " ] - freq[ " << chan_freq << "] \t talkgroup[ " << talkgroup << " ]";
     state = INACTIVE;
-    valve->set_enabled(false);
+    tuner->set_enabled(false);
   } else {
     BOOST_LOG_TRIVIAL(error) << "debug_recorder.cc: Trying to Stop an Inactive Logger!!!";
   }
@@ -256,8 +204,8 @@ void debug_recorder_impl::stop() {
 
 bool debug_recorder_impl::start(Call *call) {
   if (state == INACTIVE) {
-    timestamp = time(NULL);
-    starttime = time(NULL);
+    timestamp = Replay_Clock::now();
+    starttime = Replay_Clock::now();
 
     talkgroup = call->get_talkgroup();
     chan_freq = call->get_freq();
@@ -268,7 +216,7 @@ bool debug_recorder_impl::start(Call *call) {
     tune_offset(offset_amount);
 
     state = ACTIVE;
-    valve->set_enabled(true);
+    tuner->set_enabled(true);
   } else {
     BOOST_LOG_TRIVIAL(error) << "debug_recorder.cc: Trying to Start an already Active Logger!!!";
     return false;
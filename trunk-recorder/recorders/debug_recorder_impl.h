@@ -13,11 +13,6 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/shared_ptr.hpp>
-#if GNURADIO_VERSION < 0x030a00
-#include <gnuradio/blocks/udp_sink.h>
-#else
-#include <gnuradio/network/udp_sink.h>
-#endif
 
 #include <gnuradio/hier_block2.h>
 #include <gnuradio/io_signature.h>
@@ -30,15 +25,11 @@
 #include <gnuradio/filter/pfb_arb_resampler_ccf.h>
 
 #if GNURADIO_VERSION < 0x030800
-#include <gnuradio/analog/sig_source_c.h>
-#include <gnuradio/blocks/multiply_cc.h>
 #include <gnuradio/blocks/multiply_const_ff.h>
 #include <gnuradio/blocks/multiply_const_ss.h>
 #include <gnuradio/filter/fir_filter_ccf.h>
 #include <gnuradio/filter/fir_filter_fff.h>
 #else
-#include <gnuradio/analog/sig_source.h>
-#include <gnuradio/blocks/multiply.h>
 #include <gnuradio/blocks/multiply_const.h>
 #include <gnuradio/filter/fir_filter_blk.h>
 #endif
@@ -61,7 +52,8 @@
 #include <gnuradio/message.h>
 #include <gnuradio/msg_queue.h>
 
-#include "../gr_blocks/freq_xlating_fft_filter.h"
+#include "../gr_blocks/channel_tuner.h"
+#include "../gr_blocks/udp_batch_sink.h"
 #include "../source.h"
 #include "debug_recorder.h"
 #include "recorder.h"
@@ -129,23 +121,14 @@ private:
   std::vector<float> arb_taps;
   std::vector<float> sym_taps;
   std::vector<float> baseband_noise_filter_taps;
-  std::vector<gr_complex> bandpass_filter_coeffs;
   std::vector<float> lowpass_filter_coeffs;
   std::vector<float> cutoff_filter_coeffs;
 
-  gr::filter::fft_filter_ccc::sptr bandpass_filter;
   gr::filter::fft_filter_ccf::sptr lowpass_filter;
   gr::filter::fft_filter_ccf::sptr cutoff_filter;
 
-  gr::blocks::copy::sptr valve;
-  gr::analog::sig_source_c::sptr lo;
-  gr::analog::sig_source_c::sptr bfo;
-  gr::blocks::multiply_cc::sptr mixer;
-#if GNURADIO_VERSION >= 0x030a00
-  gr::network::udp_sink::sptr udp_sink;
-#else
-  gr::blocks::udp_sink::sptr udp_sink;
-#endif
+  channel_tuner::sptr tuner;
+  udp_batch_sink_sptr udp_sink;
   gr::filter::pfb_arb_resampler_ccf::sptr arb_resampler;
 };
 
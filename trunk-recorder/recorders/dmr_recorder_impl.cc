@@ -4,12 +4,20 @@
 #include "../formatter.h"
 #include "../gr_blocks/plugin_wrapper_impl.h"
 #include "../plugin_manager/plugin_manager.h"
+#include "../replay_clock.h"
 #include <boost/log/trivial.hpp>
+#include <sstream>
 
 dmr_recorder_sptr make_dmr_recorder(Source *src, Recorder_Type type) {
-  dmr_recorder *recorder = new dmr_recorder_impl(src, type);
-
-  return gnuradio::get_initial_sptr(recorder);
+  dmr_recorder_sptr recorder = gnuradio::get_initial_sptr(new dmr_recorder_impl(src, type));
+  if (src->get_low_latency()) {
+    recorder->enable_low_latency();
+  }
+  int buffer_items = src->get_recorder_buffer_items(type);
+  if (buffer_items > 0) {
+    recorder->set_max_output_buffer(buffer_items);
+  }
+  return recorder;
 }
 
 dmr_recorder_impl::dmr_recorder_impl(Source *src, Recorder_Type type)
@@ -27,7 +35,7 @@ void dmr_recorder_impl::initialize(Source *src) {
   center_freq = source->get_center();
   config = source->get_config();
   d_soft_vocoder = config->soft_vocoder;
-  input_rate = source->get_rate();
+  input_rate = source->get_digital_recorder_rate();
   silence_frames = source->get_silence_frames();
   squelch_db = 0;
 
@@ -45,40 +53,18 @@ void dmr_recorder_impl::initialize(Source *src) {
 
   state = INACTIVE;
 
-  timestamp = time(NULL);
-  starttime = time(NULL);
+  timestamp = Replay_Clock::now();
+  starttime = Replay_Clock::now();
 
   prefilter = xlat_channelizer::make(input_rate, channelizer::phase1_samples_per_symbol, channelizer::phase1_symbol_rate, xlat_channelizer::channel_bandwidth, center_freq, conventional);
+  prefilter->set_enabled(false); // parked until it is started
+  prefilter->set_nthreads(source->get_digital_fft_threads());
 
   /* FSK4 Demod */
   const double phase1_channel_rate = phase1_symbol_rate * phase1_samples_per_symbol;
-  const double pi = M_PI;
-
-  // FSK4: Phase Loop Lock - can only be Phase 1, so locking at that rate.
-  double freq_to_norm_radians = pi / (phase1_channel_rate / 2.0);
-  double fc = 0.0;
-  double fd = 600.0;
-  double pll_demod_gain = 1.0 / (fd * freq_to_norm_radians);
-  double samples_per_symbol = 5;
-  pll_freq_lock = gr::analog::pll_freqdet_cf::make((phase1_symbol_rate / 2.0 * 1.2) * freq_to_norm_radians, (fc + (3 * fd * 1.9)) * freq_to_norm_radians, (fc + (-3 * fd * 1.9)) * freq_to_norm_radians);
-  pll_amp = gr::blocks::multiply_const_ff::make(pll_demod_gain * 1.0);
-
-  // FSK4: noise filter - can only be Phase 1, so locking at that rate.
-#if GNURADIO_VERSION < 0x030900
-  baseband_noise_filter_taps = gr::filter::firdes::low_pass_2(1.0, phase1_channel_rate, phase1_symbol_rate / 2.0 * 1.175, phase1_symbol_rate / 2.0 * 0.125, 20.0, gr::filter::firdes::WIN_KAISER, 6.76);
-#else
-  baseband_noise_filter_taps = gr::filter::firdes::low_pass_2(1.0, phase1_channel_rate, phase1_symbol_rate / 2.0 * 1.175, phase1_symbol_rate / 2.0 * 0.125, 20.0, gr::fft::window::WIN_KAISER, 6.76);
-
-#endif
-  noise_filter = gr::filter::fft_filter_fff::make(1.0, baseband_noise_filter_taps);
-
-  // FSK4: Symbol Taps
-  double symbol_decim = 1;
-
-  for (int i = 0; i < samples_per_symbol; i++) {
-    sym_taps.push_back(1.0 / samples_per_symbol);
-  }
-  sym_filter = gr::filter::fir_filter_fff::make(symbol_decim, sym_taps);
+
+  // FSK4: the PLL discriminator, noise filter and symbol filter, in one block
+  c4fm = make_c4fm_frontend(phase1_channel_rate, phase1_symbol_rate);
 
   // FSK4: FSK4 Demod - locked at Phase 1 rates, since it can only be Phase 1
   tune_queue = gr::msg_queue::make(20);
@@ -104,16 +90,38 @@ void dmr_recorder_impl::initialize(Source *src) {
   plugin_sink_slot0 = gr::blocks::plugin_wrapper_impl::make(std::bind(&dmr_recorder_impl::plugin_callback_handler, this, std::placeholders::_1, std::placeholders::_2));
   plugin_sink_slot1 = gr::blocks::plugin_wrapper_impl::make(std::bind(&dmr_recorder_impl::plugin_callback_handler, this, std::placeholders::_1, std::placeholders::_2));
 
-  connect(self(), 0, prefilter, 0);
-  connect(prefilter, 0, pll_freq_lock, 0);
-  connect(pll_freq_lock, 0, pll_amp, 0);
-  connect(pll_amp, 0, noise_filter, 0);
-  connect(noise_filter, 0, sym_filter, 0);
-  connect(sym_filter, 0, fsk4_demod, 0);
+  if (Stage_Latency::enabled()) {
+    // The framer feeds the transmission_sinks, the relays after it are the
+    // last stage there is
+    latency_tagger = Stage_Latency::make_tagger(sizeof(gr_complex), input_rate);
+    channelizer_probe = Stage_Latency::make_probe(get_type_string(), TRACE_CHANNELIZER, sizeof(gr_complex));
+    demod_probe = Stage_Latency::make_probe(get_type_string(), TRACE_DEMOD, sizeof(float));
+    latency_relay_slot0 = Stage_Latency::make_relay(sizeof(int16_t), 8000, demod_probe);
+    latency_relay_slot1 = Stage_Latency::make_relay(sizeof(int16_t), 8000, demod_probe);
+    frame_assembler_probe_slot0 = Stage_Latency::make_probe(get_type_string(), TRACE_FRAME_ASSEMBLER, sizeof(int16_t));
+    frame_assembler_probe_slot1 = Stage_Latency::make_probe(get_type_string(), TRACE_FRAME_ASSEMBLER, sizeof(int16_t));
+    connect(self(), 0, latency_tagger, 0);
+    connect(latency_tagger, 0, prefilter, 0);
+    connect(prefilter, 0, channelizer_probe, 0);
+    connect(fsk4_demod, 0, demod_probe, 0);
+  } else {
+    connect(self(), 0, prefilter, 0);
+  }
+  connect(prefilter, 0, c4fm, 0);
+  connect(c4fm, 0, fsk4_demod, 0);
   connect(fsk4_demod, 0, slicer, 0);
   connect(slicer, 0, framer, 0);
-  connect(framer, 0, wav_sink_slot0, 0);
-  connect(framer, 1, wav_sink_slot1, 0);
+  if (Stage_Latency::enabled()) {
+    connect(framer, 0, latency_relay_slot0, 0);
+    connect(framer, 1, latency_relay_slot1, 0);
+    connect(latency_relay_slot0, 0, frame_assembler_probe_slot0, 0);
+    connect(latency_relay_slot1, 0, frame_assembler_probe_slot1, 0);
+    connect(latency_relay_slot0, 0, wav_sink_slot0, 0);
+    connect(latency_relay_slot1, 0, wav_sink_slot1, 0);
+  } else {
+    connect(framer, 0, wav_sink_slot0, 0);
+    connect(framer, 1, wav_sink_slot1, 0);
+  }
 
   if (use_streaming) {
     connect(framer, 0, plugin_sink_slot0, 0);
@@ -121,6 +129,26 @@ void dmr_recorder_impl::initialize(Source *src) {
   }
 }
 
+void dmr_recorder_impl::enable_low_latency() {
+  if (latency_manager) {
+    return;
+  }
+  latency_manager = Low_Latency_Profile::make_manager(sizeof(gr_complex), phase1_samples_per_symbol * phase1_symbol_rate);
+  disconnect(prefilter, 0, c4fm, 0);
+  connect(prefilter, 0, latency_manager, 0);
+  connect(latency_manager, 0, c4fm, 0);
+  Low_Latency_Profile::return_strobes(this, fsk4_demod, 0, sizeof(float), latency_manager);
+
+  std::vector<gr::basic_block_sptr> blocks;
+  blocks.push_back(c4fm);
+  blocks.push_back(fsk4_demod);
+  blocks.push_back(slicer);
+  blocks.push_back(framer);
+  blocks.push_back(latency_relay_slot0);
+  blocks.push_back(latency_relay_slot1);
+  Low_Latency_Profile::cap_buffers(blocks);
+}
+
 void dmr_recorder_impl::plugin_callback_handler(int16_t *samples, int sampleCount) {
   plugman_audio_callback(call, this, samples, sampleCount);
 }
@@ -143,7 +171,7 @@ int dmr_recorder_impl::get_num() {
 }
 
 double dmr_recorder_impl::since_last_write() {
-  time_t now = time(NULL);
+  time_t now = Replay_Clock::now();
   return now - wav_sink_slot0->get_stop_time();
 }
 
@@ -159,11 +187,12 @@ bool dmr_recorder_impl::is_active() {
   }
 }
 bool dmr_recorder_impl::is_enabled() {
-  return source->is_selector_port_enabled(selector_port);
+  return prefilter->is_enabled();
 }
 
 void dmr_recorder_impl::set_enabled(bool enabled) {
-  source->set_selector_port_enabled(selector_port, enabled);
+  prefilter->set_enabled(enabled);
+  source->set_channel_enabled(selector_port, enabled);
 }
 
 bool dmr_recorder_impl::is_squelched() {
@@ -203,17 +232,17 @@ double dmr_recorder_impl::get_current_length() {
 }
 
 int dmr_recorder_impl::lastupdate() {
-  return time(NULL) - timestamp;
+  return Replay_Clock::now() - timestamp;
 }
 
 long dmr_recorder_impl::elapsed() {
-  return time(NULL) - starttime;
+  return Replay_Clock::now() - starttime;
 }
 
 void dmr_recorder_impl::tune_freq(double f) {
   chan_freq = f;
   float freq = (center_freq - f);
-  prefilter->tune_offset(freq);
+  prefilter->tune_offset(source->tune_channel(selector_port, freq));
 }
 
 bool compareTransmissions(Transmission t1, Transmission t2) {
@@ -246,6 +275,11 @@ void dmr_recorder_impl::stop() {
   if (state == ACTIVE) {
 
     recording_duration += wav_sink_slot0->total_length_in_seconds();
+
+    if (source->get_autotune_source()) {
+      // Send last tuning measurements to autotune manager
+      source->add_autotune_error_measurement(this->get_freq_error(), autotune_offset);
+    }
     
     //std::string loghdr = log_header(this->call->get_short_name(),this->call->get_call_num(),this->call->get_talkgroup_display(),chan_freq);
     // BOOST_LOG_TRIVIAL(info) << loghdr << "Stopping P25 Recorder Num [" << rec_num << "]\tTDMA: " << d_phase2_tdma << "\tSlot: " << tdma_slot;
@@ -268,19 +302,29 @@ bool dmr_recorder_impl::start(Call *call) {
     System *system = call->get_system();
     set_tdma_slot(0);
 
-    timestamp = time(NULL);
-    starttime = time(NULL);
+    timestamp = Replay_Clock::now();
+    starttime = Replay_Clock::now();
 
     talkgroup = call->get_talkgroup();
     short_name = call->get_short_name();
     chan_freq = call->get_freq();
     this->call = call;
     std::string loghdr = log_header(this->call->get_short_name(),this->call->get_call_num(),this->call->get_talkgroup_display(),chan_freq);
-    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[32mStarting DMR Recorder Num [" << rec_num << "]\u001b[0m\tTDMA: " << call->get_phase2_tdma() << "\tSlot: " << call->get_tdma_slot();
+    autotune_offset = 0;
+    std::ostringstream autotune_info;
+
+    if (source->get_autotune_source()) {
+      // Retrieve current autotune offset from the source's autotune manager
+      autotune_offset = source->get_source_error();
+      autotune_info << " AutoTune: " << std::showpos << autotune_offset << std::noshowpos << " Hz";
+    }
+
+    BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[32mStarting DMR Recorder Num [" << rec_num << "]\u001b[0m\tTDMA: " << call->get_phase2_tdma() << "\tSlot: " << call->get_tdma_slot() << autotune_info.str();
 
-    int offset_amount = (center_freq - chan_freq);
+    int offset_amount = (center_freq - chan_freq + autotune_offset);
 
-    prefilter->tune_offset(offset_amount);
+    prefilter->tune_offset(source->tune_channel(selector_port, offset_amount));
+    call->mark_latency(LATENCY_RETUNE);
     levels->set_k(call->get_system()->get_digital_levels());
     wav_sink_slot0->start_recording(call, 0);
     wav_sink_slot1->start_recording(call, 1);
@@ -289,8 +333,10 @@ bool dmr_recorder_impl::start(Call *call) {
   if (conventional) {
     Call_conventional *conventional_call = dynamic_cast<Call_conventional *>(call);
     squelch_db = conventional_call->get_squelch_db();
+    prefilter->set_sync_wake(system->get_sync_wake());
     if (conventional_call->get_signal_detection()) {
       set_enabled(false);
+      source->arm_detected_recorder(this);
     } else {
       set_enabled(true); // If signal detection is not being used, open up the Value/Selector from the start
     }
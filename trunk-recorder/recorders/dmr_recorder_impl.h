@@ -73,6 +73,7 @@
 #include <gnuradio/message.h>
 #include <gnuradio/msg_queue.h>
 
+#include "../gr_blocks/c4fm_frontend.h"
 #include "../gr_blocks/channelizer.h"
 #include "../gr_blocks/plugin_wrapper_impl.h"
 #include "../gr_blocks/selector.h"
@@ -80,7 +81,9 @@
 #include "../gr_blocks/xlat_channelizer.h"
 #include "../source.h"
 #include "../call_conventional.h"
+#include "../stage_latency.h"
 #include "dmr_recorder.h"
+#include "low_latency_profile.h"
 #include "recorder.h"
 
 class dmr_recorder_impl : public dmr_recorder {
@@ -113,6 +116,7 @@ public:
   int lastupdate();
   long elapsed();
   Source *get_source();
+  void enable_low_latency();
 
   void plugin_callback_handler(int16_t *samples, int sampleCount);
 
@@ -148,15 +152,9 @@ private:
 
   /* FSK4 Stuff */
 
-  std::vector<float> baseband_noise_filter_taps;
-  std::vector<float> sym_taps;
   gr::msg_queue::sptr tune_queue;
 
-  gr::filter::fft_filter_fff::sptr noise_filter;
-  gr::filter::fir_filter_fff::sptr sym_filter;
-
-  gr::blocks::multiply_const_ff::sptr pll_amp;
-  gr::analog::pll_freqdet_cf::sptr pll_freq_lock;
+  c4fm_frontend_sptr c4fm;
   gr::op25_repeater::fsk4_demod_ff::sptr fsk4_demod;
   gr::op25_repeater::fsk4_slicer_fb::sptr slicer;
 
@@ -173,6 +171,16 @@ private:
   gr::blocks::transmission_sink::sptr wav_sink_slot1;
   gr::blocks::plugin_wrapper::sptr plugin_sink_slot0;
   gr::blocks::plugin_wrapper::sptr plugin_sink_slot1;
+
+  /* Latency Tracing */
+  gr::gr_latency::latency_tagger::sptr latency_tagger;
+  gr::gr_latency::latency_probe::sptr channelizer_probe;
+  gr::gr_latency::latency_probe::sptr demod_probe;
+  gr::gr_latency::latency_tagger::sptr latency_relay_slot0;
+  gr::gr_latency::latency_tagger::sptr latency_relay_slot1;
+  gr::gr_latency::latency_probe::sptr frame_assembler_probe_slot0;
+  gr::gr_latency::latency_probe::sptr frame_assembler_probe_slot1;
+  gr::latency_manager::latency_manager::sptr latency_manager;
 };
 
 #endif // ifndef dmr_recorder_H
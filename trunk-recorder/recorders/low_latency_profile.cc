@@ -0,0 +1,40 @@
+#include "low_latency_profile.h"
+
+#include "../../lib/gr-latency-manager/include/tag_to_msg.h"
+
+#include <gnuradio/block.h>
+
+gr::latency_manager::latency_manager::sptr Low_Latency_Profile::make_manager(std::size_t item_size, double sample_rate) {
+  int interval = (int)(sample_rate * strobe_ms / 1000);
+  gr::latency_manager::latency_manager::sptr manager = gr::latency_manager::latency_manager::make(strobes_in_flight, interval > 0 ? interval : 1, item_size);
+  manager->set_starved_timeout(starved_ms / 1000.0);
+  return manager;
+}
+
+void Low_Latency_Profile::return_strobes(gr::hier_block2 *chain, gr::basic_block_sptr block, int port, std::size_t item_size, gr::latency_manager::latency_manager::sptr manager) {
+  gr::latency_manager::tag_to_msg::sptr strobes = gr::latency_manager::tag_to_msg::make(item_size, "low latency", "latency_strobe");
+  strobes->set_display(false);
+  chain->connect(block, port, strobes, 0);
+  chain->msg_connect(strobes, pmt::mp("msg"), manager, pmt::mp("token"));
+}
+
+// The demods and decoders are hier blocks, their cap goes to the blocks in them
+void Low_Latency_Profile::cap_buffers(const std::vector<gr::basic_block_sptr> &blocks) {
+  for (std::vector<gr::basic_block_sptr>::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+    if (!*it) {
+      continue;
+    }
+#if GNURADIO_VERSION < 0x030900
+    gr::block_sptr block = boost::dynamic_pointer_cast<gr::block>(*it);
+    gr::hier_block2_sptr hier = boost::dynamic_pointer_cast<gr::hier_block2>(*it);
+#else
+    gr::block_sptr block = std::dynamic_pointer_cast<gr::block>(*it);
+    gr::hier_block2_sptr hier = std::dynamic_pointer_cast<gr::hier_block2>(*it);
+#endif
+    if (block) {
+      block->set_max_output_buffer(max_output_items);
+    } else if (hier) {
+      hier->set_max_output_buffer(max_output_items);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef LOW_LATENCY_PROFILE_H
+#define LOW_LATENCY_PROFILE_H
+
+#include <gnuradio/basic_block.h>
+#include <gnuradio/hier_block2.h>
+
+#include "../../lib/gr-latency-manager/include/latency_manager.h"
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Low_Latency_Profile
+ *   How a recorder is built for live listening, where the audio getting
+ *   out soon matters more than the CPU it takes, with lowLatency on the
+ *   System or the Source.
+ *
+ * GNU Radio sizes each buffer for throughput, so a block that is slower
+ * than the one in front of it lets seconds of samples pile up in between.
+ * The profile does two things about that. A latency_manager after the
+ * channelizer lets no more than strobes_in_flight * strobe_ms of the
+ * channel go by before its strobes come back from a tag_to_msg after the
+ * demod, and the blocks after it have their output buffers capped at
+ * max_output_items. Anything held up waits in the channelizer's buffer,
+ * which is left as it is, so a recorder falling behind doesn't hold up the
+ * Source: if no strobe comes back for starved_ms the tokens are handed
+ * back anyway, and the recorder does no worse than without the profile.
+ *
+ * Everything is done while the recorder is being wired, on the thread
+ * building it.
+ */
+class Low_Latency_Profile {
+public:
+  static const int strobe_ms = 10;
+  static const int strobes_in_flight = 4;
+  static const int starved_ms = 20;
+  static const int max_output_items = 2048;
+
+  static gr::latency_manager::latency_manager::sptr make_manager(std::size_t item_size, double sample_rate);
+  // Hands the strobes that get to port of block back to manager
+  static void return_strobes(gr::hier_block2 *chain, gr::basic_block_sptr block, int port, std::size_t item_size, gr::latency_manager::latency_manager::sptr manager);
+  static void cap_buffers(const std::vector<gr::basic_block_sptr> &blocks);
+};
+
+#endif // LOW_LATENCY_PROFILE_H
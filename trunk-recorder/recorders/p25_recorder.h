@@ -59,6 +59,7 @@ public:
   virtual long elapsed() = 0;
   virtual Source *get_source() = 0;
   virtual void autotune() = 0;
+  virtual Recorder *share_slot(Call *call) { return NULL; };
 };
 
 #endif // ifndef P25_RECORDER_H
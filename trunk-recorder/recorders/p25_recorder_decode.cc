@@ -4,6 +4,7 @@
 #include "../plugin_manager/plugin_manager.h"
 #include "../systems/system_impl.h"
 #include "../formatter.h"
+#include "../replay_clock.h"
 #include "../unit_tags_ota.h"
 #include <chrono>
 
@@ -66,7 +67,7 @@ State p25_recorder_decode::get_state() {
 }
 
 double p25_recorder_decode::since_last_write() {
-  auto end = std::chrono::steady_clock::now();
+  auto end = Replay_Clock::steady_now();
   std::chrono::duration<double> diff = end - wav_sink->get_last_write_time();
   return diff.count();
 }
@@ -110,7 +111,22 @@ void p25_recorder_decode::initialize(int silence_frames, bool d_soft_vocoder) {
 
   connect(self(), 0, slicer, 0);
   connect(slicer, 0, op25_frame_assembler, 0);
-  connect(op25_frame_assembler, 0, levels, 0);
+  if (Stage_Latency::enabled()) {
+    // The demod's output is this decoder's input, its probe is here so the
+    // relay after the frame assembler can carry on from it
+    std::string type = d_recorder->get_type_string();
+    demod_probe = Stage_Latency::make_probe(type, TRACE_DEMOD, sizeof(float));
+    latency_relay = Stage_Latency::make_relay(sizeof(int16_t), 8000, demod_probe);
+    frame_assembler_probe = Stage_Latency::make_probe(type, TRACE_FRAME_ASSEMBLER, sizeof(int16_t));
+    sink_probe = Stage_Latency::make_probe(type, TRACE_SINK, sizeof(int16_t));
+    connect(self(), 0, demod_probe, 0);
+    connect(op25_frame_assembler, 0, latency_relay, 0);
+    connect(latency_relay, 0, frame_assembler_probe, 0);
+    connect(latency_relay, 0, levels, 0);
+    connect(levels, 0, sink_probe, 0);
+  } else {
+    connect(op25_frame_assembler, 0, levels, 0);
+  }
 
   if (use_streaming) {
     connect(levels, 0, plugin_sink, 0);
@@ -149,21 +165,28 @@ gr::op25_repeater::p25_frame_assembler::sptr p25_recorder_decode::get_transmissi
   return op25_frame_assembler;
 }
 
+// The voice frames are encrypted and there is no key for them, whatever
+// the grant said. The call is marked encrypted and the main loop stops
+// recording it, unless its System monitors encrypted calls.
+void p25_recorder_decode::handle_encrypted_voice(const nlohmann::json& j) {
+  if (d_call->get_encrypted()) {
+    return;
+  }
+  BOOST_LOG_TRIVIAL(debug) << log_header(d_call->get_short_name(), d_call->get_call_num(), d_call->get_talkgroup_display(), d_call->get_freq()) << "Encrypted voice, algid: " << j.value("algid", 0) << " keyid: " << j.value("keyid", 0);
+  d_call->set_encrypted(true);
+}
+
 void p25_recorder_decode::handle_alias_message(const nlohmann::json& j) {
   int messages = j.contains("messages") ? j["messages"].get<int>() : 0;
-  std::array<std::vector<uint8_t>, 10> alias_buffer;
+  OTAAliasBlocks alias_buffer;
   
   // Decode hex strings back to binary (all formats use blocks)
   if (j.contains("blocks")) {
     for (auto& [key, value] : j["blocks"].items()) {
       int idx = std::stoi(key);
-      if (idx >= 0 && idx < 10) {
-        std::string hex_str = value.get<std::string>();
-        alias_buffer[idx].clear();
-        alias_buffer[idx].reserve(hex_str.length() / 2);
-        for (size_t i = 0; i + 1 < hex_str.length(); i += 2) {
-          uint8_t byte = static_cast<uint8_t>(std::stoul(hex_str.substr(i, 2), nullptr, 16));
-          alias_buffer[idx].push_back(byte);
+      if (idx >= 0 && idx < (int)OTAAliasBlocks::MAX_BLOCKS) {
+        if (!alias_buffer.set_hex(idx, value.get<std::string>())) {
+          BOOST_LOG_TRIVIAL(debug) << "Alias block " << idx << " is malformed or too long, skipping";
         }
       }
     }
@@ -310,6 +333,8 @@ void p25_recorder_decode::check_message_queue() {
           if (json_msg_type == "motorola_alias_p1" || json_msg_type == "motorola_alias_p2" ||
               json_msg_type == "harris_alias_p1" || json_msg_type == "harris_alias_p2") {
             handle_alias_message(j);
+          } else if (json_msg_type == "encrypted_voice") {
+            handle_encrypted_voice(j);
           }
           // Add some more JSON handlers as we find other things to decode!
         }
@@ -25,6 +25,7 @@
 
 #include "../gr_blocks/plugin_wrapper.h"
 #include "../gr_blocks/transmission_sink.h"
+#include "../stage_latency.h"
 #include "recorder.h"
 
 class p25_recorder_decode;
@@ -52,6 +53,10 @@ protected:
   gr::blocks::multiply_const_ss::sptr levels;
   gr::blocks::transmission_sink::sptr wav_sink;
   gr::blocks::plugin_wrapper::sptr plugin_sink;
+  gr::gr_latency::latency_probe::sptr demod_probe;
+  gr::gr_latency::latency_tagger::sptr latency_relay;
+  gr::gr_latency::latency_probe::sptr frame_assembler_probe;
+  gr::gr_latency::latency_probe::sptr sink_probe;
 
 public:
   p25_recorder_decode(Recorder *recorder);
@@ -77,5 +82,6 @@ public:
 
 private:
   void handle_alias_message(const nlohmann::json& j);
+  void handle_encrypted_voice(const nlohmann::json& j);
 };
 #endif
\ No newline at end of file
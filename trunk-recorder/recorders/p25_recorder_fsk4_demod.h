@@ -21,6 +21,7 @@
 #include <gnuradio/blocks/multiply_const.h>
 #include <gnuradio/filter/fir_filter_blk.h>
 #endif
+#include "../gr_blocks/c4fm_frontend.h"
 #include "../gr_blocks/rms_agc.h"
 #include <op25_repeater/fsk4_slicer_fb.h>
 #include <op25_repeater/rmsagc_ff.h>
@@ -51,15 +52,12 @@ public:
 private:
   const int phase1_samples_per_symbol = 5;
   const double phase1_symbol_rate = 4800;
-  std::vector<float> baseband_noise_filter_taps;
   std::vector<float> sym_taps;
   gr::msg_queue::sptr tune_queue;
   std::vector<float> cutoff_filter_coeffs;
-  gr::filter::fft_filter_fff::sptr noise_filter;
   gr::filter::fir_filter_fff::sptr sym_filter;
   gr::filter::fft_filter_ccf::sptr cutoff_filter;
-  gr::blocks::multiply_const_ff::sptr pll_amp;
-  gr::analog::pll_freqdet_cf::sptr pll_freq_lock;
+  c4fm_frontend_sptr c4fm;
   gr::analog::quadrature_demod_cf::sptr fm_demod;
   gr::op25_repeater::rmsagc_ff::sptr baseband_amp;
   gr::op25_repeater::fsk4_demod_ff::sptr fsk4_demod;
@@ -1,13 +1,20 @@
 
 #include "p25_recorder_impl.h"
 #include "../formatter.h"
+#include "../replay_clock.h"
 #include "p25_recorder.h"
 #include <boost/log/trivial.hpp>
 
 p25_recorder_sptr make_p25_recorder(Source *src, Recorder_Type type) {
-  p25_recorder *recorder = new p25_recorder_impl(src, type);
-
-  return gnuradio::get_initial_sptr(recorder);
+  p25_recorder_sptr recorder = gnuradio::get_initial_sptr(new p25_recorder_impl(src, type));
+  if (src->get_low_latency()) {
+    recorder->enable_low_latency();
+  }
+  int buffer_items = src->get_recorder_buffer_items(type);
+  if (buffer_items > 0) {
+    recorder->set_max_output_buffer(buffer_items);
+  }
+  return recorder;
 }
 
 p25_recorder_impl::p25_recorder_impl(Source *src, Recorder_Type type)
@@ -29,20 +36,22 @@ void p25_recorder_impl::initialize(Source *src) {
   center_freq = source->get_center();
   config = source->get_config();
   d_soft_vocoder = config->soft_vocoder;
-  input_rate = source->get_rate();
+  input_rate = source->get_digital_recorder_rate();
   qpsk_mod = true;
   silence_frames = source->get_silence_frames();
   squelch_db = 0;
   talkgroup = 0;
   d_phase2_tdma = false;
+  tuned_system = NULL;
+  tuned_offset = NAN;
   rec_num = rec_counter++;
   recording_count = 0;
   recording_duration = 0;
 
   state = INACTIVE;
 
-  timestamp = time(NULL);
-  starttime = time(NULL);
+  timestamp = Replay_Clock::now();
+  starttime = Replay_Clock::now();
 
   if (config == NULL) {
     this->set_enable_audio_streaming(false);
@@ -51,21 +60,205 @@ void p25_recorder_impl::initialize(Source *src) {
   }
 
   prefilter = xlat_channelizer::make(input_rate, channelizer::phase1_samples_per_symbol, channelizer::phase1_symbol_rate, xlat_channelizer::channel_bandwidth, center_freq, conventional);
+  prefilter->set_enabled(false); // parked until it is started
+  prefilter->set_nthreads(source->get_digital_fft_threads());
   // initialize_prefilter();
   //  initialize_p25();
 
-  modulation_selector = gr::blocks::selector::make(sizeof(gr_complex), 0, 0);
-  qpsk_demod = make_p25_recorder_qpsk_demod();
-  qpsk_p25_decode = make_p25_recorder_decode(this, silence_frames, d_soft_vocoder);
-  fsk4_demod = make_p25_recorder_fsk4_demod();
-  fsk4_p25_decode = make_p25_recorder_decode(this, silence_frames, d_soft_vocoder);
+  if (Stage_Latency::enabled()) {
+    latency_tagger = Stage_Latency::make_tagger(sizeof(gr_complex), input_rate);
+    channelizer_probe = Stage_Latency::make_probe(get_type_string(), TRACE_CHANNELIZER, sizeof(gr_complex));
+    connect(self(), 0, latency_tagger, 0);
+    connect(latency_tagger, 0, prefilter, 0);
+    connect(prefilter, 0, channelizer_probe, 0);
+  } else {
+    connect(self(), 0, prefilter, 0);
+  }
+  if (source->get_iq_ring_seconds() > 0) {
+    // Phase 1 and Phase 2 come out of the channelizer at the same rate
+    iq_ring = make_iq_ring_buffer(phase1_samples_per_symbol * phase1_symbol_rate, source->get_iq_ring_seconds());
+    connect(prefilter, 0, iq_ring, 0);
+  }
+  if (config && config->single_branch_recorders) {
+    // Only the modulation the systems use is built, the prefilter feeds it
+    // directly and the selector is only added along with the other one
+    qpsk_mod = config->digital_recorder_qpsk;
+    build_branch(qpsk_mod);
+    if (qpsk_mod) {
+      connect(prefilter, 0, qpsk_demod, 0);
+    } else {
+      connect(prefilter, 0, fsk4_demod, 0);
+    }
+  } else {
+    build_branch(false);
+    build_branch(true);
+    connect_selector();
+  }
+}
+
+// The demods are fed by the latency_manager once there is one
+gr::basic_block_sptr p25_recorder_impl::branch_input() {
+  if (latency_manager) {
+    return latency_manager;
+  }
+  return prefilter;
+}
+
+void p25_recorder_impl::build_branch(bool qpsk) {
+  if (qpsk) {
+    qpsk_demod = make_p25_recorder_qpsk_demod();
+    qpsk_p25_decode = make_p25_recorder_decode(this, silence_frames, d_soft_vocoder);
+    connect(qpsk_demod, 0, qpsk_p25_decode, 0);
+  } else {
+    fsk4_demod = make_p25_recorder_fsk4_demod();
+    fsk4_p25_decode = make_p25_recorder_decode(this, silence_frames, d_soft_vocoder);
+    connect(fsk4_demod, 0, fsk4_p25_decode, 0);
+  }
+}
 
-  connect(self(), 0, prefilter, 0);
-  connect(prefilter, 0, modulation_selector, 0);
+// The strobes come back from the demod, the decoder's buffers are capped
+// along with its own
+void p25_recorder_impl::bound_branch(bool qpsk) {
+  std::vector<gr::basic_block_sptr> blocks;
+  if (qpsk) {
+    Low_Latency_Profile::return_strobes(this, qpsk_demod, 0, sizeof(float), latency_manager);
+    blocks.push_back(qpsk_demod);
+    blocks.push_back(qpsk_p25_decode);
+  } else {
+    Low_Latency_Profile::return_strobes(this, fsk4_demod, 0, sizeof(float), latency_manager);
+    blocks.push_back(fsk4_demod);
+    blocks.push_back(fsk4_p25_decode);
+  }
+  Low_Latency_Profile::cap_buffers(blocks);
+}
+
+void p25_recorder_impl::enable_low_latency() {
+  if (latency_manager) {
+    return;
+  }
+  gr::basic_block_sptr next;
+  if (modulation_selector) {
+    next = modulation_selector;
+  } else if (qpsk_demod) {
+    next = qpsk_demod;
+  } else {
+    next = fsk4_demod;
+  }
+  latency_manager = Low_Latency_Profile::make_manager(sizeof(gr_complex), phase1_samples_per_symbol * phase1_symbol_rate);
+  disconnect(prefilter, 0, next, 0);
+  connect(prefilter, 0, latency_manager, 0);
+  connect(latency_manager, 0, next, 0);
+  if (modulation_selector) {
+    Low_Latency_Profile::cap_buffers(std::vector<gr::basic_block_sptr>(1, modulation_selector));
+  }
+  if (qpsk_demod) {
+    bound_branch(true);
+  }
+  if (fsk4_demod) {
+    bound_branch(false);
+  }
+}
+
+void p25_recorder_impl::connect_selector() {
+  modulation_selector = gr::blocks::selector::make(sizeof(gr_complex), 0, qpsk_mod ? 1 : 0);
+  if (latency_manager) {
+    Low_Latency_Profile::cap_buffers(std::vector<gr::basic_block_sptr>(1, modulation_selector));
+  }
+  connect(branch_input(), 0, modulation_selector, 0);
   connect(modulation_selector, 0, fsk4_demod, 0);
-  connect(fsk4_demod, 0, fsk4_p25_decode, 0);
   connect(modulation_selector, 1, qpsk_demod, 0);
-  connect(qpsk_demod, 0, qpsk_p25_decode, 0);
+}
+
+// A single branch recorder asked for the modulation it wasn't built for
+// gets it now, with the flowgraph locked while it is connected
+void p25_recorder_impl::add_branch(bool qpsk) {
+  if (qpsk ? (bool)qpsk_demod : (bool)fsk4_demod) {
+    return;
+  }
+  BOOST_LOG_TRIVIAL(info) << "P25 Recorder Num [" << rec_num << "] adding the " << (qpsk ? "QPSK" : "FSK4") << " demodulator";
+  gr::top_block_sptr tb = source->get_top_block();
+  if (tb) {
+    tb->lock();
+  }
+  if (qpsk) {
+    disconnect(branch_input(), 0, fsk4_demod, 0);
+  } else {
+    disconnect(branch_input(), 0, qpsk_demod, 0);
+  }
+  build_branch(qpsk);
+  if (latency_manager) {
+    bound_branch(qpsk);
+  }
+  connect_selector();
+  pin_to_recorder(qpsk ? (gr::basic_block_sptr)qpsk_demod : (gr::basic_block_sptr)fsk4_demod);
+  pin_to_recorder(qpsk ? (gr::basic_block_sptr)qpsk_p25_decode : (gr::basic_block_sptr)fsk4_p25_decode);
+  pin_to_recorder(modulation_selector);
+  if (tb) {
+    tb->unlock();
+  }
+}
+
+// A Phase 2 call on the other slot of the channel this recorder is tuned
+// to can use its front end. If this recorder's own decoder is busy the call
+// goes to the slot recorder, if it is the slot recorder that is busy the
+// call comes back here.
+Recorder *p25_recorder_impl::share_slot(Call *call) {
+  if (!d_phase2_tdma || !qpsk_mod || !call->get_phase2_tdma() || (call->get_system() != tuned_system) || (call->get_freq() != chan_freq)) {
+    return NULL;
+  }
+  if ((state == ACTIVE) && !slot_active() && (call->get_tdma_slot() != tdma_slot)) {
+    add_slot_recorder();
+    return slot_recorder.get();
+  }
+  if ((state == INACTIVE) && slot_active() && (call->get_tdma_slot() != slot_recorder->get_tdma_slot())) {
+    return this;
+  }
+  return NULL;
+}
+
+bool p25_recorder_impl::slot_active() {
+  return slot_recorder && slot_recorder->is_active();
+}
+
+// The slot recorder's decoder is fed the same symbols as this recorder's
+// QPSK decoder, it is connected with the flowgraph locked
+void p25_recorder_impl::add_slot_recorder() {
+  if (slot_recorder) {
+    return;
+  }
+  BOOST_LOG_TRIVIAL(info) << "P25 Recorder Num [" << rec_num << "] adding a decoder for the second TDMA slot";
+  slot_recorder.reset(new p25_slot_recorder(this, silence_frames, d_soft_vocoder));
+  if (latency_manager) {
+    Low_Latency_Profile::cap_buffers(std::vector<gr::basic_block_sptr>(1, slot_recorder->get_decode()));
+  }
+  gr::top_block_sptr tb = source->get_top_block();
+  if (tb) {
+    tb->lock();
+  }
+  connect(qpsk_demod, 0, slot_recorder->get_decode(), 0);
+  pin_to_recorder(slot_recorder->get_decode());
+  if (tb) {
+    tb->unlock();
+  }
+}
+
+// The front end was kept up for the slot recorder after this recorder's
+// own call stopped, it can go back now
+void p25_recorder_impl::slot_stopped() {
+  if (state == INACTIVE) {
+    set_enabled(false);
+    clear();
+    source->release_recorder(this);
+  }
+}
+
+// Blocks added after the recorder was pinned go on the cores its other
+// blocks are on
+void p25_recorder_impl::pin_to_recorder(gr::basic_block_sptr block) {
+  std::vector<int> cores = prefilter->processor_affinity();
+  if (!cores.empty()) {
+    block->set_processor_affinity(cores);
+  }
 }
 
 void p25_recorder_impl::switch_tdma(bool phase2) {
@@ -124,10 +317,17 @@ void p25_recorder_impl::clear() {
   //reset_block(fsk4_p25_decode);  // bad - Seg Faults
 
   */
-  qpsk_demod->reset();
-  qpsk_p25_decode->reset();
-  fsk4_demod->reset();
-  fsk4_p25_decode->reset();
+  // The demodulators are reset when the recorder is tuned to another
+  // channel, see start()
+  if (qpsk_demod) {
+    qpsk_p25_decode->reset();
+  }
+  if (fsk4_demod) {
+    fsk4_p25_decode->reset();
+  }
+  if (slot_recorder) {
+    slot_recorder->clear();
+  }
 }
 
 void p25_recorder_impl::autotune() {
@@ -152,6 +352,14 @@ Source *p25_recorder_impl::get_source() {
   return source;
 }
 
+bool p25_recorder_impl::snapshot_iq(const std::string &base) {
+  if (!iq_ring) {
+    return false;
+  }
+  std::string hw = source->get_driver() + ": " + source->get_device() + " - " + source->get_antenna();
+  return iq_ring->snapshot(base, chan_freq, hw, source->get_num());
+}
+
 int p25_recorder_impl::get_num() {
   return rec_num;
 }
@@ -181,11 +389,12 @@ State p25_recorder_impl::get_state() {
 }
 
 bool p25_recorder_impl::is_enabled() {
-  return source->is_selector_port_enabled(selector_port);
+  return prefilter->is_enabled();
 }
 
 void p25_recorder_impl::set_enabled(bool enabled) {
-  source->set_selector_port_enabled(selector_port, enabled);
+  prefilter->set_enabled(enabled);
+  source->set_channel_enabled(selector_port, enabled);
 }
 
 bool p25_recorder_impl::is_active() {
@@ -233,17 +442,25 @@ double p25_recorder_impl::get_current_length() {
 }
 
 int p25_recorder_impl::lastupdate() {
-  return time(NULL) - timestamp;
+  return Replay_Clock::now() - timestamp;
 }
 
 long p25_recorder_impl::elapsed() {
-  return time(NULL) - starttime;
+  return Replay_Clock::now() - starttime;
 }
 
 void p25_recorder_impl::tune_freq(double f) {
   chan_freq = f;
   float freq = (center_freq - f);
-  prefilter->tune_offset(freq);
+  prefilter->tune_offset(source->tune_channel(selector_port, freq));
+  tuned_offset = freq;
+  // Parked on a channel for the next call, see Pre_Tuner
+  if (qpsk_demod) {
+    qpsk_demod->reset();
+  }
+  if (fsk4_demod) {
+    fsk4_demod->reset();
+  }
 }
 
 void p25_recorder_impl::set_source(long src) {
@@ -278,6 +495,12 @@ void p25_recorder_impl::stop() {
     BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[33mStopping P25 Recorder Num [" << rec_num << "]\u001b[0m\tTDMA: " << d_phase2_tdma << "\tSlot: " << tdma_slot << "\tTuningErr: " << std::showpos << this->get_freq_error() << std::noshowpos << " Hz";
 
     state = INACTIVE;
+    if (slot_active()) {
+      // The other slot is still recording, the front end stays up for it
+      // and this recorder is released when it stops
+      qpsk_p25_decode->stop();
+      return;
+    }
     set_enabled(false);
 
     clear();
@@ -286,6 +509,7 @@ void p25_recorder_impl::stop() {
     } else {
       fsk4_p25_decode->stop();
     }
+    source->release_recorder(this);
   } else {
     BOOST_LOG_TRIVIAL(error) << "p25_recorder.cc: Trying to Stop an Inactive Logger!!!";
   }
@@ -303,6 +527,9 @@ void p25_recorder_impl::set_tdma_slot(int slot) {
 bool p25_recorder_impl::start(Call *call) {
   if (state == INACTIVE) {
     System *system = call->get_system();
+    const bool was_qpsk = qpsk_mod;
+    const bool was_phase2 = d_phase2_tdma;
+    add_branch(system->get_qpsk_mod());
     qpsk_mod = system->get_qpsk_mod();
     set_tdma(call->get_phase2_tdma());
     if (call->get_phase2_tdma()) {
@@ -322,8 +549,8 @@ bool p25_recorder_impl::start(Call *call) {
       set_tdma_slot(0);
     }
 
-    timestamp = time(NULL);
-    starttime = time(NULL);
+    timestamp = Replay_Clock::now();
+    starttime = Replay_Clock::now();
 
     talkgroup = call->get_talkgroup();
     short_name = call->get_short_name();
@@ -342,24 +569,47 @@ bool p25_recorder_impl::start(Call *call) {
 
     BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[32mStarting P25 Recorder Num [" << rec_num << "]\u001b[0m\tTDMA: " << call->get_phase2_tdma() << "\tSlot: " << call->get_tdma_slot() << "\tQPSK: " << qpsk_mod << autotune_info.str();
 
-    int offset_amount = (center_freq - chan_freq + autotune_offset);
-
-    prefilter->tune_offset(offset_amount);
+    // Sharing the front end with the slot recorder, it is already tuned.
+    // A recorder the pool handed out because it is still on the channel
+    // of its last call keeps its filters and its demodulator's loops as
+    // they are, unless the modulation has changed.
+    if (!slot_active()) {
+      int offset_amount = (center_freq - chan_freq + autotune_offset);
+
+      if ((offset_amount != tuned_offset) || (qpsk_mod != was_qpsk) || (d_phase2_tdma != was_phase2)) {
+        prefilter->tune_offset(source->tune_channel(selector_port, offset_amount));
+        tuned_offset = offset_amount;
+        if (qpsk_demod) {
+          qpsk_demod->reset();
+        }
+        if (fsk4_demod) {
+          fsk4_demod->reset();
+        }
+      } else {
+        call->set_pre_tuned(true);
+      }
+    }
+    call->mark_latency(LATENCY_RETUNE);
+    tuned_system = system;
 
+    if (modulation_selector) {
+      modulation_selector->set_output_index(qpsk_mod ? 1 : 0);
+    }
     if (qpsk_mod) {
-      modulation_selector->set_output_index(1);
       qpsk_p25_decode->start(call);
     } else {
-      modulation_selector->set_output_index(0);
       fsk4_p25_decode->start(call);
     }
     state = ACTIVE;
+    source->take_recorder(this);
 
     if (conventional) {
       Call_conventional *conventional_call = dynamic_cast<Call_conventional *>(call);
       squelch_db = conventional_call->get_squelch_db();
+      prefilter->set_sync_wake(system->get_sync_wake());
       if (conventional_call->get_signal_detection()) {
         set_enabled(false);
+        source->arm_detected_recorder(this);
       } else {
         set_enabled(true); // If signal detection is not being used, open up the Value/Selector from the start
       }
@@ -378,4 +628,4 @@ bool p25_recorder_impl::start(Call *call) {
   return true;
 }
 
-int Recorder::rec_counter = 0;
+std::atomic<int> Recorder::rec_counter(0);
@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <iostream>
 #include <math.h>
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -54,6 +55,7 @@
 #include "../gr_blocks/channelizer.h"
 #include "../gr_blocks/selector.h"
 #include "../gr_blocks/transmission_sink.h"
+#include "../gr_blocks/iq_ring_buffer.h"
 #include "../gr_blocks/xlat_channelizer.h"
 
 // #include <op25_repeater/include/op25_repeater/rmsagc_ff.h>
@@ -63,10 +65,13 @@
 #include "../../lib/gr-latency/latency_tagger.h"
 #include "../gr_blocks/rms_agc.h"
 #include "../call_conventional.h"
+#include "../stage_latency.h"
+#include "low_latency_profile.h"
 #include "p25_recorder.h"
 #include "p25_recorder_decode.h"
 #include "p25_recorder_fsk4_demod.h"
 #include "p25_recorder_qpsk_demod.h"
+#include "p25_slot_recorder.h"
 #include "recorder.h"
 
 class Source;
@@ -75,6 +80,7 @@ class p25_recorder;
 #include "../source.h"
 
 class p25_recorder_impl : public p25_recorder {
+  friend class p25_slot_recorder;
 
 protected:
   void initialize(Source *src);
@@ -111,6 +117,10 @@ public:
   long elapsed();
   Source *get_source();
   void autotune();
+  Recorder *share_slot(Call *call);
+  void slot_stopped();
+  bool snapshot_iq(const std::string &base);
+  void enable_low_latency();
 
 protected:
   State state;
@@ -125,7 +135,10 @@ protected:
   double center_freq;
   bool qpsk_mod;
   double squelch_db;
+  System *tuned_system; // the system of the last call, which the front end is still tuned for
+  double tuned_offset;  // the offset the front end is tuned to, NAN before the first call
   gr::blocks::selector::sptr modulation_selector;
+  std::unique_ptr<p25_slot_recorder> slot_recorder;
 
   p25_recorder_fsk4_demod_sptr fsk4_demod;
   p25_recorder_decode_sptr fsk4_p25_decode;
@@ -133,6 +146,10 @@ protected:
   p25_recorder_decode_sptr qpsk_p25_decode;
   // channelizer::sptr prefilter;
   xlat_channelizer::sptr prefilter;
+  iq_ring_buffer_sptr iq_ring;
+  gr::gr_latency::latency_tagger::sptr latency_tagger;
+  gr::gr_latency::latency_probe::sptr channelizer_probe;
+  gr::latency_manager::latency_manager::sptr latency_manager;
 
 private:
   int silence_frames;
@@ -147,6 +164,14 @@ private:
 
   gr::blocks::multiply_const_ff::sptr rescale;
   void reset_block(gr::basic_block_sptr block);
+  gr::basic_block_sptr branch_input();
+  void build_branch(bool qpsk);
+  void bound_branch(bool qpsk);
+  void connect_selector();
+  void add_branch(bool qpsk);
+  void add_slot_recorder();
+  void pin_to_recorder(gr::basic_block_sptr block);
+  bool slot_active();
 };
 
 #endif // ifndef P25_RECORDER_H
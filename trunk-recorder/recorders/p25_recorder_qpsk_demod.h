@@ -11,13 +11,9 @@
 #include <gnuradio/filter/fft_filter_fff.h>
 #include <gnuradio/msg_queue.h>
 
-#include <gnuradio/analog/feedforward_agc_cc.h>
-#include <gnuradio/blocks/complex_to_arg.h>
 #include <gnuradio/filter/fft_filter_ccf.h>
 
-#include <gnuradio/digital/diff_phasor_cc.h>
-#include <op25_repeater/costas_loop_cc.h>
-#include <op25_repeater/gardner_cc.h>
+#include "../gr_blocks/cqpsk_demod.h"
 
 #if GNURADIO_VERSION < 0x030800
 #include <gnuradio/blocks/multiply_const_ff.h>
@@ -43,8 +39,7 @@ class p25_recorder_qpsk_demod : public gr::hier_block2 {
 protected:
   virtual void initialize();
 
-   gr::op25_repeater::gardner_cc::sptr clock;
-  gr::op25_repeater::costas_loop_cc::sptr costas;
+  cqpsk_demod_sptr demod;
 
 public:
   p25_recorder_qpsk_demod();
@@ -65,10 +60,6 @@ private:
   std::vector<float> cutoff_filter_coeffs;
   gr::filter::fft_filter_fff::sptr noise_filter;
   gr::filter::fir_filter_fff::sptr sym_filter;
-  gr::analog::feedforward_agc_cc::sptr agc;
-  gr::digital::diff_phasor_cc::sptr diffdec;
-  gr::blocks::complex_to_arg::sptr to_float;
-  gr::blocks::multiply_const_ff::sptr rescale;
 
     void reset_block(gr::basic_block_sptr block); 
 };
@@ -0,0 +1,133 @@
+
+#include "p25_slot_recorder.h"
+#include "../formatter.h"
+#include "p25_recorder_impl.h"
+#include <boost/log/trivial.hpp>
+
+p25_slot_recorder::p25_slot_recorder(p25_recorder_impl *recorder, int silence_frames, bool soft_vocoder)
+    : Recorder(P25) {
+  this->recorder = recorder;
+  conventional = false;
+  rec_num = rec_counter++;
+  recording_count = 0;
+  recording_duration = 0;
+  state = INACTIVE;
+  tdma_slot = 0;
+  set_enable_audio_streaming(recorder->get_enable_audio_streaming());
+
+  decode = make_p25_recorder_decode(this, silence_frames, soft_vocoder);
+  decode->switch_tdma(true);
+}
+
+bool p25_slot_recorder::start(Call *call) {
+  if (state != INACTIVE) {
+    BOOST_LOG_TRIVIAL(error) << "p25_slot_recorder.cc: Trying to Start an already Active Logger!!!";
+    return false;
+  }
+  if (!call->get_xor_mask()) {
+    BOOST_LOG_TRIVIAL(info) << "Error - can't set XOR Mask for TDMA";
+    return false;
+  }
+
+  set_tdma_slot(call->get_tdma_slot());
+  decode->set_xor_mask(call->get_xor_mask());
+
+  std::string loghdr = log_header(call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
+  BOOST_LOG_TRIVIAL(info) << loghdr << "\u001b[32mStarting P25 Slot Recorder Num [" << rec_num << "]\u001b[0m\tTDMA: 1\tSlot: " << tdma_slot << "\tSharing P25 Recorder Num [" << recorder->get_num() << "]";
+
+  decode->start(call);
+  state = ACTIVE;
+  recording_count++;
+  return true;
+}
+
+void p25_slot_recorder::stop() {
+  if (state != ACTIVE) {
+    BOOST_LOG_TRIVIAL(error) << "p25_slot_recorder.cc: Trying to Stop an Inactive Logger!!!";
+    return;
+  }
+  recording_duration += decode->get_current_length();
+  BOOST_LOG_TRIVIAL(info) << "\u001b[33mStopping P25 Slot Recorder Num [" << rec_num << "]\u001b[0m\tSlot: " << tdma_slot;
+
+  state = INACTIVE;
+  decode->stop();
+  recorder->slot_stopped();
+}
+
+void p25_slot_recorder::clear() {
+  decode->reset();
+}
+
+double p25_slot_recorder::get_freq() {
+  return recorder->get_freq();
+}
+
+int p25_slot_recorder::get_freq_error() {
+  return recorder->get_freq_error();
+}
+
+void p25_slot_recorder::set_tdma_slot(int slot) {
+  tdma_slot = slot;
+  decode->set_tdma_slot(slot);
+}
+
+void p25_slot_recorder::set_source(long src) {
+  decode->set_source(src);
+}
+
+double p25_slot_recorder::since_last_write() {
+  return decode->since_last_write();
+}
+
+void p25_slot_recorder::process_message_queues() {
+  decode->check_message_queue();
+}
+
+double p25_slot_recorder::get_current_length() {
+  return decode->get_current_length();
+}
+
+// The front end is the p25_recorder's, it is on while either slot is recording
+void p25_slot_recorder::set_enabled(bool enabled) {
+  recorder->prefilter->set_enabled(enabled);
+}
+
+bool p25_slot_recorder::is_enabled() {
+  return recorder->prefilter->is_enabled();
+}
+
+bool p25_slot_recorder::is_active() {
+  return state == ACTIVE;
+}
+
+bool p25_slot_recorder::is_idle() {
+  return (decode->get_state() == IDLE) || (decode->get_state() == STOPPED);
+}
+
+bool p25_slot_recorder::is_squelched() {
+  if (state == ACTIVE) {
+    return recorder->prefilter->is_squelched();
+  }
+  return true;
+}
+
+double p25_slot_recorder::get_pwr() {
+  return recorder->get_pwr();
+}
+
+std::vector<Transmission> p25_slot_recorder::get_transmission_list() {
+  return decode->get_transmission_list();
+}
+
+State p25_slot_recorder::get_state() {
+  return decode->get_state();
+}
+
+Source *p25_slot_recorder::get_source() {
+  return recorder->get_source();
+}
+
+// Both slots are in the p25_recorder's channel
+bool p25_slot_recorder::snapshot_iq(const std::string &base) {
+  return recorder->snapshot_iq(base);
+}
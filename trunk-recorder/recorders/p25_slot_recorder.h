@@ -0,0 +1,58 @@
+#ifndef P25_SLOT_RECORDER_H
+#define P25_SLOT_RECORDER_H
+
+#include "p25_recorder_decode.h"
+#include "recorder.h"
+
+class p25_recorder_impl;
+
+/*
+ * p25_slot_recorder
+ *   The other TDMA slot of a P25 Phase 2 voice channel that a p25_recorder
+ *   is already tuned to and demodulating. It has its own decoder and
+ *   transmission_sink, fed from the p25_recorder's symbols, so a call on
+ *   the second slot doesn't need a channelizer and demodulator of its own.
+ *
+ * The p25_recorder makes it the first time it is needed and owns it. It
+ * is never in the Source's pool: Source::get_digital_recorder() hands it
+ * out when a grant is for the slot the p25_recorder isn't on. The front
+ * end stays up until the calls on both slots have stopped.
+ */
+class p25_slot_recorder : public Recorder {
+public:
+  p25_slot_recorder(p25_recorder_impl *recorder, int silence_frames, bool soft_vocoder);
+
+  p25_recorder_decode_sptr get_decode() { return decode; }
+  int get_tdma_slot() { return tdma_slot; }
+
+  bool start(Call *call);
+  void stop();
+  void clear();
+  double get_freq();
+  int get_num() { return rec_num; }
+  int get_freq_error();
+  void set_tdma_slot(int slot);
+  void set_source(long src);
+  double since_last_write();
+  void process_message_queues();
+  double get_current_length();
+  void set_enabled(bool enabled);
+  bool is_enabled();
+  bool is_active();
+  bool is_idle();
+  bool is_squelched();
+  double get_pwr();
+  std::vector<Transmission> get_transmission_list();
+  State get_state();
+  Source *get_source();
+  double get_output_sample_rate() { return decode->get_output_sample_rate(); }
+  bool snapshot_iq(const std::string &base);
+
+private:
+  p25_recorder_impl *recorder;
+  p25_recorder_decode_sptr decode;
+  State state;
+  int tdma_slot;
+};
+
+#endif // P25_SLOT_RECORDER_H
@@ -4,6 +4,7 @@
 
 Recorder::Recorder(Recorder_Type type) {
   this->type = type;
+  selector_port = 0;
 }
 
 boost::property_tree::ptree Recorder::get_stats() {
@@ -15,6 +16,10 @@ boost::property_tree::ptree Recorder::get_stats() {
   node.put("count", recording_count);
   node.put("duration", recording_duration);
   node.put("state", get_state());
+  node.put("workSeconds", get_work_seconds());
+  node.put("samplesProcessed", get_samples_processed());
+  node.put("activeFraction", get_active_fraction());
+  node.put("bufferBytes", get_buffer_bytes());
   return node;
 }
 
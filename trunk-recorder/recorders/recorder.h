@@ -1,6 +1,7 @@
 #ifndef RECORDER_H
 #define RECORDER_H
 
+#include <atomic>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
@@ -68,7 +69,7 @@ public:
 
   int rec_num;
   int rssi=0;
-  static int rec_counter;
+  static std::atomic<int> rec_counter; // recorders are also made on the Recorder_Builder thread
   std::string get_type_string();
   bool conventional;
   unsigned int selector_port;
@@ -114,6 +115,25 @@ public:
   virtual int get_output_channels() { return 1; }
   virtual bool get_enable_audio_streaming() { return d_enable_audio_streaming; };
   virtual void set_enable_audio_streaming(bool enable_audio_streaming) { d_enable_audio_streaming = enable_audio_streaming; };
+  // Saves the last iqRingSeconds of the channel to base.sigmf-data and
+  // base.sigmf-meta, in the background. False if the recorder keeps no ring.
+  virtual bool snapshot_iq(const std::string &base) { return false; };
+  // Rewires the recorder with the Low_Latency_Profile, before it is
+  // started. Doing it again does nothing.
+  virtual void enable_low_latency(){};
+  // From the performance counters of the blocks that make up the recorder,
+  // over the whole run. Zero unless recorderCpuStats or --profile is on.
+  double get_work_seconds() { return work_seconds; };
+  uint64_t get_samples_processed() { return samples_processed; };
+  double get_active_fraction() { return active_fraction; };
+  void set_cpu_stats(double work, uint64_t samples, double fraction) {
+    work_seconds = work;
+    samples_processed = samples;
+    active_fraction = fraction;
+  };
+  // What the output buffers of its blocks take, from the last Memory_Report
+  long long get_buffer_bytes() { return buffer_bytes; };
+  void set_buffer_bytes(long long bytes) { buffer_bytes = bytes; };
 
 protected:
   int recording_count;
@@ -121,6 +141,11 @@ protected:
   double recording_duration;
   Recorder_Type  type;
   int autotune_offset = 0;
+  // Set on the main thread, read by the plugins
+  std::atomic<double> work_seconds{0};
+  std::atomic<uint64_t> samples_processed{0};
+  std::atomic<double> active_fraction{0};
+  std::atomic<long long> buffer_bytes{0};
 };
 
 #endif
@@ -1,5 +1,6 @@
 
 #include "sigmf_recorder_impl.h"
+#include "../replay_clock.h"
 #include <boost/log/trivial.hpp>
 #include <cmath>
 
@@ -9,6 +10,10 @@
 
 sigmf_recorder_sptr make_sigmf_recorder(Source *src, Recorder_Type type) {
   sigmf_recorder *recorder = new sigmf_recorder_impl(src, type);
+  int buffer_items = src->get_recorder_buffer_items(type);
+  if (buffer_items > 0) {
+    recorder->set_max_output_buffer(buffer_items);
+  }
 
   return gnuradio::get_initial_sptr(recorder);
 }
@@ -44,22 +49,23 @@ sigmf_recorder_impl::sigmf_recorder_impl(Source *src, Recorder_Type type)
 
   // double symbol_rate         = 4800;
 
-  timestamp = time(NULL);
-  starttime = time(NULL);
+  timestamp = Replay_Clock::now();
+  starttime = Replay_Clock::now();
 
 
 
   // tm *ltm = localtime(&starttime);
 
-  filename = std::to_string(talkgroup) + "-" + std::to_string(starttime) + "_" + std::to_string(freq) + ".raw";
-  raw_sink = gr::blocks::file_sink::make(sizeof(gr_complex), filename.c_str());
+  // The samples are written out by the IQ_Writer, off the flowgraph's threads
+  raw_sink = make_sigmf_sink();
 
   //initialize_prefilter();
   //initialize_prefilter_xlat();
   
   prefilter = xlat_channelizer::make(input_rate, channelizer::phase1_samples_per_symbol, channelizer::phase1_symbol_rate, xlat_channelizer::channel_bandwidth, center, conventional);
   set_enabled(false);
-  connect(squelch, 0, raw_sink, 0);
+  connect(self(), 0, prefilter, 0);
+  connect(prefilter, 0, raw_sink, 0);
 }
 
 int sigmf_recorder_impl::get_num() {
@@ -95,11 +101,11 @@ double sigmf_recorder_impl::get_current_length() {
 }
 
 int sigmf_recorder_impl::lastupdate() {
-  return time(NULL) - timestamp;
+  return Replay_Clock::now() - timestamp;
 }
 
 long sigmf_recorder_impl::elapsed() {
-  return time(NULL) - starttime;
+  return Replay_Clock::now() - starttime;
 }
 /*
 void sigmf_recorder_impl::tune_offset(double f) {
@@ -128,8 +134,8 @@ void sigmf_recorder_impl::stop() {
 
 bool sigmf_recorder_impl::start(Call *call) {
   if (state == INACTIVE) {
-    timestamp = time(NULL);
-    starttime = time(NULL);
+    timestamp = Replay_Clock::now();
+    starttime = Replay_Clock::now();
     tm *ltm = localtime(&starttime);
     this->call = call;
     System *system = call->get_system();
@@ -152,9 +158,7 @@ bool sigmf_recorder_impl::start(Call *call) {
 
     filename = path_string + "/" + std::to_string(talkgroup) + "-" + std::to_string(starttime) + "_" +
                std::to_string(static_cast<long>(std::llround(call->get_freq()))) + "-call_" +
-               std::to_string(call->get_call_num()) + ".sigmf-data";
-
-    raw_sink->open(filename.c_str());
+               std::to_string(call->get_call_num());
     state = ACTIVE;
 
   if (conventional) {
@@ -179,7 +183,6 @@ bool sigmf_recorder_impl::start(Call *call) {
     std::string start_time(buf);
     nlohmann::json j = {
       {"global", {
-        {"core:datatype", "cf32_le"},
         {"core:sample_rate", channelizer::phase1_samples_per_symbol * channelizer::phase1_symbol_rate},
         {"core:hw", src_description},
         {"core:recorder", "Trunk Recorder"},
@@ -196,12 +199,8 @@ bool sigmf_recorder_impl::start(Call *call) {
       {"annotations", nlohmann::json::array({})}
     };
 
-    filename = path_string + "/" + std::to_string(talkgroup) + "-" + std::to_string(starttime) + "_" +
-               std::to_string(static_cast<long>(std::llround(call->get_freq()))) + "-call_" +
-               std::to_string(call->get_call_num()) + ".sigmf-meta";
-    std::ofstream o(filename);
-    o << std::setw(4) << j << std::endl;
-    o.close();
+    // The IQ_Writer adds the datatype and writes the .sigmf-meta when it is closed
+    raw_sink->open(filename, j, source->get_num());
 
   } else {
     BOOST_LOG_TRIVIAL(error) << "sigmf_recorder.cc: Trying to Start an already Active Logger!!!";
@@ -71,6 +71,7 @@
 #include "../gr_blocks/rms_agc.h"
 #include "../gr_blocks/channelizer.h"
 #include "../gr_blocks/xlat_channelizer.h"
+#include "../gr_blocks/sigmf_sink.h"
 #include "recorder.h"
 
 #include "../source.h"
@@ -135,7 +136,7 @@ private:
   gr::digital::fll_band_edge_cc::sptr fll_band_edge;
   gr::blocks::rms_agc::sptr rms_agc;
   gr::analog::pwr_squelch_cc::sptr squelch;
-  gr::blocks::file_sink::sptr raw_sink;
+  sigmf_sink_sptr raw_sink;
   gr::blocks::copy::sptr valve;
 };
 
@@ -0,0 +1,65 @@
+#include "replay_clock.h"
+
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+#include <sys/resource.h>
+
+std::atomic<bool> Replay_Clock::replaying(false);
+std::atomic<bool> Replay_Clock::done(false);
+std::atomic<uint64_t> Replay_Clock::samples_read(0);
+double Replay_Clock::rate = 0;
+int64_t Replay_Clock::start_ms = 0;
+std::chrono::steady_clock::time_point Replay_Clock::start_steady;
+
+bool Replay_Clock::start(double sample_rate) {
+  if (enabled()) {
+    BOOST_LOG_TRIVIAL(info) << "Replay Clock - already following another file source, the call timing only follows the first one";
+    return false;
+  }
+  rate = sample_rate;
+  start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  start_steady = std::chrono::steady_clock::now();
+  replaying.store(true, std::memory_order_release);
+  return true;
+}
+
+double Replay_Clock::capture_seconds() {
+  return samples_read.load(std::memory_order_relaxed) / rate;
+}
+
+time_t Replay_Clock::now() {
+  if (!enabled()) {
+    return time(NULL);
+  }
+  return static_cast<time_t>(now_ms() / 1000);
+}
+
+int64_t Replay_Clock::now_ms() {
+  if (!enabled()) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+  return start_ms + static_cast<int64_t>(capture_seconds() * 1000.0);
+}
+
+std::chrono::steady_clock::time_point Replay_Clock::steady_now() {
+  if (!enabled()) {
+    return std::chrono::steady_clock::now();
+  }
+  return start_steady + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(capture_seconds()));
+}
+
+void Replay_Clock::print_summary() {
+  if (!enabled()) {
+    return;
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_steady).count();
+  double capture = capture_seconds();
+
+  struct rusage usage;
+  double cpu = 0;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Replay - " << std::fixed << std::setprecision(1) << capture << " sec of capture in " << wall << " sec, " << std::setprecision(2) << (wall > 0 ? capture / wall : 0) << "x real time, CPU: " << std::setprecision(1) << cpu << " sec (" << (wall > 0 ? cpu / wall * 100 : 0) << "% of a Core)" << (finished() ? "" : ", stopped before the end of the file");
+}
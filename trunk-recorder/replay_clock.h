@@ -0,0 +1,52 @@
+#ifndef REPLAY_CLOCK_H
+#define REPLAY_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+/*
+ * Replay_Clock
+ *   The time for the call and recorder timing, taken from how far an IQ
+ *   file has been read when it is replayed faster than real time.
+ *
+ * Normally this is the wall clock. A file source with a replaySpeed other
+ * than 1 starts it, and it then goes forward by a sample period for every
+ * sample the source puts out, from the wall clock time the source was
+ * made. The call timeouts, the transmission start and stop times and the
+ * recorders' idle times then come out the same at 20x real time, or as
+ * fast as the file can be read, as they would have when it was recorded.
+ * Only the first replay source drives it, with more than one they should
+ * all be replayed at the same speed.
+ *
+ * The source calls advance() on its flowgraph thread, everything else
+ * only reads, so nothing is locked.
+ */
+class Replay_Clock {
+public:
+  static bool start(double sample_rate);
+  static bool enabled() { return replaying.load(std::memory_order_relaxed); }
+
+  static void advance(uint64_t samples) { samples_read.fetch_add(samples, std::memory_order_relaxed); }
+  static void finish() { done.store(true, std::memory_order_release); }
+  static bool finished() { return done.load(std::memory_order_acquire); }
+
+  static time_t now();
+  static int64_t now_ms();
+  static std::chrono::steady_clock::time_point steady_now();
+
+  // Seconds of the capture played back so far
+  static double capture_seconds();
+  static void print_summary();
+
+private:
+  static std::atomic<bool> replaying;
+  static std::atomic<bool> done;
+  static std::atomic<uint64_t> samples_read;
+  static double rate;
+  static int64_t start_ms;
+  static std::chrono::steady_clock::time_point start_steady;
+};
+
+#endif // REPLAY_CLOCK_H
@@ -1,4 +1,6 @@
 #include "./setup_systems.h"
+#include "cluster.h"
+#include "gr_blocks/decoders/signal_decoder_sink.h"
 using namespace std;
 bool setup_conventional_channel(System *system, double frequency, long channel_index, Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<Call *> &calls) {
   bool channel_added = false;
@@ -18,7 +20,8 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
 
       Call_conventional *call = NULL;
       if (system->has_channel_file()) {
-        Talkgroup *tg = system->find_talkgroup_by_freq(frequency);
+        // Look the row up by its number; several rows may share a frequency with different DCS codes
+        Talkgroup *tg = system->find_talkgroup(channel_index);
         tone_freq = tg->tone;
         /* DCS: encode as negative tone_freq (inverted adds 1000 offset) */
         if (tg->dcs_code > 0) {
@@ -26,6 +29,19 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
                                        : -(float)tg->dcs_code;
         }
 
+        // One demod and sub-audio squelch can serve every tone and code on a frequency, so add this one to an existing recorder.
+        // With both CTCSS and DCS rows on a frequency, whichever appears opens the squelch.
+        if ((tone_freq != 0.0) && (system->get_system_type() == "conventional")) {
+          std::vector<analog_recorder_sptr> conv_recorders = system->get_conventional_recorders();
+          for (std::vector<analog_recorder_sptr>::iterator rec_it = conv_recorders.begin(); rec_it != conv_recorders.end(); rec_it++) {
+            analog_recorder_sptr shared_rec = *rec_it;
+            if ((shared_rec->get_freq() == tg->freq) && shared_rec->add_tone_target(tone_freq)) {
+              BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tMonitoring " << system->get_system_type() << " channel: " << format_freq(frequency) << " Talkgroup: " << channel_index << " (sharing tone squelch recorder)";
+              return true;
+            }
+          }
+        }
+
         // If there is a per channel squelch setting, use it, otherwise use the system squelch setting
         if (tg->squelch_db != DB_UNSET) {
           call = new Call_conventional(tg->number, tg->freq, system, config, tg->squelch_db, tg->signal_detection);
@@ -41,11 +57,14 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
       BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tMonitoring " << system->get_system_type() << " channel: " << format_freq(frequency) << " Talkgroup: " << channel_index;
       if (system->get_system_type() == "conventional") {
         analog_recorder_sptr rec;
-        if (tone_freq > 0.0) {
-          rec = source->create_conventional_recorder(tb, tone_freq);
+        if (tone_freq != 0.0) {
+          rec = source->create_conventional_recorder(tb, tone_freq, system->get_tone_squelch_gate());
         } else {
           rec = source->create_conventional_recorder(tb);
         }
+        if (system->get_low_latency()) {
+          rec->enable_low_latency();
+        }
         rec->start(call);
         rec->set_tau(system->get_tau()); //set the tau value for the recorder from the system config
         call->set_is_analog(true);
@@ -61,6 +80,9 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
         // the manage_conventional_calls() function handles adding and starting the P25 Recorder
         dmr_recorder_sptr rec;
         rec = source->create_dmr_conventional_recorder(tb);
+        if (system->get_low_latency()) {
+          rec->enable_low_latency();
+        }
         call->set_recorder((Recorder *)rec.get());
         system->add_conventionalDMR_recorder(rec);
         calls.push_back(call);
@@ -70,6 +92,9 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
         // the manage_conventional_calls() function handles adding and starting the P25 Recorder
         p25_recorder_sptr rec;
         rec = source->create_digital_conventional_recorder(tb);
+        if (system->get_low_latency()) {
+          rec->enable_low_latency();
+        }
         call->set_recorder((Recorder *)rec.get());
         system->add_conventionalP25_recorder(rec);
         calls.push_back(call);
@@ -93,6 +118,14 @@ bool setup_conventional_channel(System *system, double frequency, long channel_i
 bool setup_conventional_system(System *system, Config &config, gr::top_block_sptr &tb, std::vector<Source *> &sources, std::vector<Call *> &calls) {
   bool system_added = false;
 
+  // Plugins have registered their decoders by now
+  std::vector<std::string> decoder_names = system->get_signal_decoder_names();
+  for (std::vector<std::string>::iterator it = decoder_names.begin(); it != decoder_names.end(); it++) {
+    if (gr::blocks::find_signal_decoder(*it) == 0) {
+      BOOST_LOG_TRIVIAL(error) << "[" << system->get_short_name() << "]\tSignal decoder not registered by any plugin: " << *it;
+    }
+  }
+
   if (system->has_channel_file()) {
     std::vector<Talkgroup *> talkgroups = system->get_talkgroups();
     for (vector<Talkgroup *>::iterator tg_it = talkgroups.begin(); tg_it != talkgroups.end(); tg_it++) {
@@ -139,6 +172,10 @@ bool setup_systems(Config &config, gr::top_block_sptr &tb, std::vector<Source *>
     } else {
       // If it's not a conventional system, then it's a trunking system
       double control_channel_freq = system->get_current_control_channel();
+      if (Cluster::is_voice()) {
+        BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tVoice node, the grants come from the cluster's control node";
+        continue;
+      }
       BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tStarted with Control Channel: " << format_freq(control_channel_freq);
 
       for (vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
@@ -155,8 +192,11 @@ bool setup_systems(Config &config, gr::top_block_sptr &tb, std::vector<Source *>
                                                                source->get_center(),
                                                                source->get_rate(),
                                                                system->get_msg_queue(),
-                                                               system->get_sys_num());
-            tb->connect(source->get_src_block(), 0, system->smartnet_trunking, 0);
+                                                               system->get_sys_num(),
+                                                               system->get_control_iq_ring_seconds());
+            system->smartnet_trunking->set_fft_threads(source->get_fft_threads());
+            source->pin_block(system->smartnet_trunking);
+            source->connect_output(tb, system->smartnet_trunking);
           }
 
           if (system->get_system_type() == "p25") {
@@ -165,8 +205,11 @@ bool setup_systems(Config &config, gr::top_block_sptr &tb, std::vector<Source *>
                                                      source->get_rate(),
                                                      system->get_msg_queue(),
                                                      system->get_qpsk_mod(),
-                                                     system->get_sys_num());
-            tb->connect(source->get_src_block(), 0, system->p25_trunking, 0);
+                                                     system->get_sys_num(),
+                                                     system->get_control_iq_ring_seconds());
+            system->p25_trunking->set_fft_threads(source->get_fft_threads());
+            source->pin_block(system->p25_trunking);
+            source->connect_output(tb, system->p25_trunking);
           }
 
           break;
@@ -178,5 +221,11 @@ bool setup_systems(Config &config, gr::top_block_sptr &tb, std::vector<Source *>
       }
     }
   }
+
+  for (std::vector<Source *>::iterator src_it = sources.begin(); src_it != sources.end(); src_it++) {
+    Source *source = *src_it;
+    source->attach_shm_sink(tb);
+    source->apply_cpu_affinity();
+  }
   return true;
 }
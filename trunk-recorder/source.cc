@@ -1,9 +1,18 @@
 #include "source.h"
+#include "flowgraph_profiler.h"
 #include "formatter.h"
+#include "recorder_builder.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <thread>
 
 using json = nlohmann::json;
 
 static int src_counter = 0;
+int Source::next_recorder_core = 0;
 
 int Source::get_num() {
   return src_num;
@@ -13,6 +22,10 @@ gr::basic_block_sptr Source::get_src_block() {
   return source_block;
 }
 
+gr::top_block_sptr Source::get_top_block() {
+  return top_block;
+}
+
 Config *Source::get_config() {
   return config;
 }
@@ -42,10 +55,12 @@ void Source::set_min_max() {
   max_hz = center + ((rate / 2) - (if1 / 2));
 }
 
-Source::Source(double c, double r, double e, std::string drv, std::string dev, Config *cfg) {
+Source::Source(double c, double r, double e, std::string drv, std::string dev, std::string wire_format, std::string host_format, int host_decimation, Config *cfg) {
   rate = r;
   center = c;
   error = e;
+  ppm = 0;
+  gain_mode = false;
   set_min_max();
   driver = drv;
   device = dev;
@@ -61,15 +76,45 @@ Source::Source(double c, double r, double e, std::string drv, std::string dev, C
   max_debug_recorders = 0;
   max_sigmf_recorders = 0;
   max_analog_recorders = 0;
+  warm_digital_recorders = -1;
+  warm_analog_recorders = -1;
+  recorder_low_watermark = 1;
+  pending_digital_recorders = 0;
+  pending_analog_recorders = 0;
   debug_recorder_port = 0;
   attached_detector = false;
   attached_selector = false;
   next_selector_port = 0;
   autotune_source = false;
   autotune_manager = new AutotuneManager(this);
+  channelizer_mode = "xlat";
+  fft_threads = 1;
+  analog_fft_threads = 0;
+  digital_fft_threads = 0;
+  stats_samples = 0;
+  stats_overflows = 0;
+  stats_dropped = 0;
+  stats_rate = 0;
+  preempted_calls = 0;
+  stats_window_overflows = 0;
+  pfb_channel_spacing = 0;
+  attached_pfb_channelizer = false;
+  attached_fft_channelizer = false;
+  attached_subband_tiler = false;
+  tile_width = 1000000;
+  shm_ring_blocks = 0;
+  iq_ring_seconds = 0;
+  low_latency = false;
+  attached_shm_sink = false;
 
   recorder_selector = gr::blocks::selector::make(sizeof(gr_complex), 0, 0);
 
+  this->wire_format = wire_format;
+  this->host_format = host_format;
+  this->host_decimation = host_decimation;
+  device_rate = rate;
+  open_device();
+
   // parameters for signal_detector_cvf
   float threshold_sensitivity = 0.9;
   bool auto_threshold = true;
@@ -82,29 +127,32 @@ Source::Source(double c, double r, double e, std::string drv, std::string dev, C
 
   signal_detector = signal_detector_cvf::make(rate, fft_len, 0, threshold, threshold_sensitivity, auto_threshold, average, quantization, min_bw, max_bw, "");
   BOOST_LOG_TRIVIAL(info) << "Made the Signal Detector";
+}
 
+// Opens the SDR, at the start and again by reopen()
+void Source::open_device() {
   if (driver == "osmosdr") {
     osmosdr::source::sptr osmo_src;
     std::vector<std::string> gain_names;
-    if (dev == "") {
+    if (device == "") {
       BOOST_LOG_TRIVIAL(info) << "Source Device not specified";
       osmo_src = osmosdr::source::make();
     } else {
       std::ostringstream msg;
 
-      if (isdigit(dev[0])) {  // Assume this is a serial number and fail back
+      if (isdigit(device[0])) {  // Assume this is a serial number and fail back
                               // to using rtl as default
-        msg << "rtl=" << dev; // <<  ",buflen=32764,buffers=8";
+        msg << "rtl=" << device; // <<  ",buflen=32764,buffers=8";
         BOOST_LOG_TRIVIAL(info) << "Source device name missing, defaulting to rtl device";
       } else {
-        msg << dev; // << ",buflen=32764,buffers=8";
+        msg << device; // << ",buflen=32764,buffers=8";
       }
       BOOST_LOG_TRIVIAL(info) << "Source Device: " << msg.str();
       osmo_src = osmosdr::source::make(msg.str());
     }
     BOOST_LOG_TRIVIAL(info) << "SOURCE TYPE OSMOSDR (osmosdr)";
-    BOOST_LOG_TRIVIAL(info) << "Setting sample rate to: " << FormatSamplingRate(rate);
-    osmo_src->set_sample_rate(rate);
+    BOOST_LOG_TRIVIAL(info) << "Setting sample rate to: " << FormatSamplingRate(device_rate);
+    osmo_src->set_sample_rate(device_rate);
     actual_rate = osmo_src->get_sample_rate();
     rate = round(actual_rate);
     BOOST_LOG_TRIVIAL(info) << "Actual sample rate: " << FormatSamplingRate(actual_rate);
@@ -128,27 +176,155 @@ Source::Source(double c, double r, double e, std::string drv, std::string dev, C
       BOOST_LOG_TRIVIAL(info) << "Gain Stage: " << gain_name << " supported values: " << gain_opt_str;
     }
 
+    device_block = osmo_src;
     source_block = osmo_src;
+
+    if ((wire_format != "") || (host_format != "fc32")) {
+      BOOST_LOG_TRIVIAL(error) << "OsmoSDR only delivers complex float samples, ignoring wireFormat and hostFormat";
+    }
   }
 
   if (driver == "usrp") {
     gr::uhd::usrp_source::sptr usrp_src;
-    usrp_src = gr::uhd::usrp_source::make(device, uhd::stream_args_t("fc32"));
+    uhd::stream_args_t stream_args(host_format == "sc16" ? "sc16" : "fc32");
+    if (wire_format != "") {
+      stream_args.otw_format = wire_format;
+    }
+    usrp_src = gr::uhd::usrp_source::make(device, stream_args);
 
     BOOST_LOG_TRIVIAL(info) << "SOURCE TYPE USRP (UHD)";
+    BOOST_LOG_TRIVIAL(info) << "Host format: " << stream_args.cpu_format << " Wire format: " << (wire_format != "" ? wire_format : "default");
 
-    BOOST_LOG_TRIVIAL(info) << "Setting sample rate to: " << FormatSamplingRate(rate);
-    usrp_src->set_samp_rate(rate);
+    BOOST_LOG_TRIVIAL(info) << "Setting sample rate to: " << FormatSamplingRate(device_rate);
+    usrp_src->set_samp_rate(device_rate);
     actual_rate = usrp_src->get_samp_rate();
     BOOST_LOG_TRIVIAL(info) << "Actual sample rate: " << FormatSamplingRate(actual_rate);
     BOOST_LOG_TRIVIAL(info) << "Tuning to " << format_freq(center + error);
     usrp_src->set_center_freq(center + error, 0);
 
+    device_block = usrp_src;
     source_block = usrp_src;
+
+    if (host_format == "sc16") {
+      // The rest of the Source runs at the decimated rate
+      if (host_decimation < 1) {
+        host_decimation = 1;
+      }
+      BOOST_LOG_TRIVIAL(info) << "Decimating by " << host_decimation << " before converting to complex float, Source rate: " << FormatSamplingRate(actual_rate / host_decimation);
+      source_block = sc16_source::make(usrp_src, host_decimation, actual_rate);
+      rate = actual_rate / host_decimation;
+      actual_rate = rate;
+      set_min_max();
+    }
+  }
+
+  if (driver == "shm") {
+    shm_iq_source::sptr shm_src;
+    shm_src = shm_iq_source::make(device, rate, center);
+
+    BOOST_LOG_TRIVIAL(info) << "SOURCE TYPE SHARED MEMORY (" << device << ")";
+    BOOST_LOG_TRIVIAL(info) << "Sample rate: " << FormatSamplingRate(rate);
+    actual_rate = rate;
+
+    device_block = shm_src;
+    source_block = shm_src;
+  }
+}
+
+void Source::connect_output(gr::top_block_sptr tb, gr::basic_block_sptr block, int port) {
+  outputs.push_back(std::make_pair(block, port));
+  // While the SDR is being reopened, the placeholder stands in for it
+  if (idle_block) {
+    tb->connect(idle_block, 0, block, port);
+  } else {
+    tb->connect(source_block, 0, block, port);
   }
 }
 
-void Source::set_iq_source(std::string iq_file, bool repeat, double center, double rate) {
+void Source::disconnect_output(gr::top_block_sptr tb, gr::basic_block_sptr block, int port) {
+  for (std::vector<std::pair<gr::basic_block_sptr, int>>::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+    if ((it->first == block) && (it->second == port)) {
+      outputs.erase(it);
+      break;
+    }
+  }
+  if (idle_block) {
+    tb->disconnect(idle_block, 0, block, port);
+  } else {
+    tb->disconnect(source_block, 0, block, port);
+  }
+}
+
+void Source::move_outputs(gr::top_block_sptr tb, gr::basic_block_sptr from, gr::basic_block_sptr to) {
+  tb->lock();
+  for (std::vector<std::pair<gr::basic_block_sptr, int>>::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+    tb->disconnect(from, 0, it->first, it->second);
+    tb->connect(to, 0, it->first, it->second);
+  }
+  tb->unlock();
+}
+
+bool Source::can_reopen() {
+  return (driver == "osmosdr") || (driver == "usrp");
+}
+
+// A flowgraph can't be stopped in part, so the SDR is swapped out from
+// under it: everything it fed is moved over to an idle_source while the
+// device is closed and opened again, then moved back. The recorders and
+// control channels keep their place and just see a gap in the samples.
+bool Source::reopen(gr::top_block_sptr tb) {
+  if (!can_reopen()) {
+    return false;
+  }
+
+  if (!idle_block) {
+    BOOST_LOG_TRIVIAL(info) << "[ Source " << src_num << ": " << format_freq(center) << " ] Closing " << device;
+    idle_block = idle_source::make(sizeof(gr_complex));
+    move_outputs(tb, source_block, idle_block);
+    source_block.reset();
+    device_block.reset();
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "[ Source " << src_num << ": " << format_freq(center) << " ] Opening " << device << " again";
+  try {
+    open_device();
+  } catch (std::exception &e) {
+    BOOST_LOG_TRIVIAL(error) << "[ Source " << src_num << ": " << format_freq(center) << " ] Unable to open " << device << ": " << e.what();
+    source_block.reset();
+    device_block.reset();
+    return false;
+  }
+
+  // The same settings, in the same order, as when it was set up
+  try {
+    if (device.find("sdrplay") != std::string::npos) {
+      set_gain_mode(gain_mode);
+    }
+    std::vector<Gain_Stage_t> stages = gain_stages;
+    gain_stages.clear();
+    for (std::vector<Gain_Stage_t>::iterator it = stages.begin(); it != stages.end(); ++it) {
+      set_gain_by_name(it->stage_name, it->value);
+    }
+    if (gain != 0) {
+      set_gain(gain);
+    }
+    set_gain_mode(gain_mode);
+    set_antenna(antenna);
+    if (ppm != 0) {
+      set_freq_corr(ppm);
+    }
+  } catch (std::exception &e) {
+    BOOST_LOG_TRIVIAL(error) << "[ Source " << src_num << ": " << format_freq(center) << " ] Unable to set up " << device << ": " << e.what();
+  }
+
+  move_outputs(tb, idle_block, source_block);
+  idle_block.reset();
+  pin_block(source_block);
+  BOOST_LOG_TRIVIAL(info) << "[ Source " << src_num << ": " << format_freq(center) << " ] Reopened " << device;
+  return true;
+}
+
+void Source::set_iq_source(std::string iq_file, bool repeat, double center, double rate, double speed, mmap_iq_source::Datatype datatype, Replay_Lockstep::sptr lockstep) {
   this->rate = rate;
   this->center = center;
   error = 0;
@@ -167,38 +343,58 @@ void Source::set_iq_source(std::string iq_file, bool repeat, double center, doub
   max_debug_recorders = 0;
   max_sigmf_recorders = 0;
   max_analog_recorders = 0;
+  warm_digital_recorders = -1;
+  warm_analog_recorders = -1;
+  recorder_low_watermark = 1;
+  pending_digital_recorders = 0;
+  pending_analog_recorders = 0;
   debug_recorder_port = 0;
   attached_detector = false;
   attached_selector = false;
   next_selector_port = 0;
   autotune_source = false;
   autotune_manager = new AutotuneManager(this);
+  channelizer_mode = "xlat";
+  fft_threads = 1;
+  analog_fft_threads = 0;
+  digital_fft_threads = 0;
+  stats_samples = 0;
+  stats_overflows = 0;
+  stats_dropped = 0;
+  stats_rate = 0;
+  preempted_calls = 0;
+  stats_window_overflows = 0;
+  pfb_channel_spacing = 0;
+  attached_pfb_channelizer = false;
+  attached_fft_channelizer = false;
+  attached_subband_tiler = false;
+  tile_width = 1000000;
+  shm_ring_blocks = 0;
+  iq_ring_seconds = 0;
+  low_latency = false;
+  attached_shm_sink = false;
 
   iq_file_source::sptr iq_file_src;
-  iq_file_src = iq_file_source::make(iq_file, this->rate, repeat);
+  iq_file_src = iq_file_source::make(iq_file, this->rate, repeat, speed, datatype, lockstep);
 
   BOOST_LOG_TRIVIAL(info) << "SOURCE TYPE IQ FILE";
   BOOST_LOG_TRIVIAL(info) << "Setting Center to: " << FormatSamplingRate(center);
   BOOST_LOG_TRIVIAL(info) << "Setting sample rate to: " << FormatSamplingRate(rate);
 
+  device_block = iq_file_src;
   source_block = iq_file_src;
 }
 
-Source::Source(std::string sigmf_meta, std::string sigmf_data, bool repeat, Config *cfg) {
+Source::Source(std::string sigmf_meta, std::string sigmf_data, bool repeat, double speed, Replay_Lockstep::sptr lockstep, Config *cfg) {
   json data;
-  std::cout << sigmf_meta << std::endl;
+  BOOST_LOG_TRIVIAL(info) << "SigMF Meta: " << sigmf_meta;
   try {
     std::ifstream f(sigmf_meta);
     data = json::parse(f);
   } catch (const json::parse_error &e) {
-    // output exception information
-    std::cout << "message: " << e.what() << '\n'
-              << "exception id: " << e.id << '\n'
-              << "byte position of error: " << e.byte << std::endl;
-    exit(1);
+    throw std::runtime_error("Unable to parse SigMF meta " + sigmf_meta + ": " + e.what());
   }
 
-  std::cout << data.dump(4) << std::endl;
   json global = data["global"];
 
   config = cfg;
@@ -206,13 +402,29 @@ Source::Source(std::string sigmf_meta, std::string sigmf_data, bool repeat, Conf
 
   json capture = data["captures"][0];
   this->center = capture["core:frequency"];
-  std::cout << "Rate: " << rate << "Center: " << center << std::endl;
-  set_iq_source(sigmf_data, repeat, center, rate);
+
+  std::string datatype_name = global.value("core:datatype", "cf32_le");
+  mmap_iq_source::Datatype datatype;
+  if (!mmap_iq_source::parse_datatype(datatype_name, datatype)) {
+    throw std::runtime_error("SigMF datatype " + datatype_name + " of " + sigmf_meta + " isn't supported, it needs to be cf32_le, ci16_le or ci8");
+  }
+
+  // The data file goes with the meta file, unless it is given
+  if (sigmf_data == "") {
+    sigmf_data = sigmf_meta;
+    std::string::size_type ext = sigmf_data.rfind(".sigmf-meta");
+    if (ext != std::string::npos) {
+      sigmf_data.erase(ext);
+    }
+    sigmf_data += ".sigmf-data";
+  }
+  BOOST_LOG_TRIVIAL(info) << "SigMF Data: " << sigmf_data << " Datatype: " << datatype_name << " Rate: " << FormatSamplingRate(rate) << " Center: " << format_freq(center);
+  set_iq_source(sigmf_data, repeat, center, rate, speed, datatype, lockstep);
 }
 
-Source::Source(std::string iq_file, bool repeat, double center, double rate, Config *cfg) {
+Source::Source(std::string iq_file, bool repeat, double center, double rate, double speed, Replay_Lockstep::sptr lockstep, Config *cfg) {
   config = cfg;
-  set_iq_source(iq_file, repeat, center, rate);
+  set_iq_source(iq_file, repeat, center, rate, speed, mmap_iq_source::CF32, lockstep);
 }
 
 void Source::set_selector_port_enabled(unsigned int port, bool enabled) {
@@ -227,14 +439,398 @@ void Source::attach_selector(gr::top_block_sptr tb) {
   if (!attached_selector) {
     attached_selector = true;
     recorder_selector = gr::blocks::selector::make(sizeof(gr_complex), 0, 0);
-    tb->connect(source_block, 0, recorder_selector, 0);
+    connect_output(tb, recorder_selector);
+    // Recorders with a channelizer read source_block directly, so the
+    // selector may have nothing else on it. Port 0 is never enabled; it
+    // keeps the selector in the flowgraph for got_samples().
+    tb->connect(recorder_selector, next_selector_port, gr::blocks::null_sink::make(sizeof(gr_complex)), 0);
+    next_selector_port++;
+  }
+}
+
+void Source::attach_pfb_channelizer(gr::top_block_sptr tb) {
+  if (!attached_pfb_channelizer) {
+    attached_pfb_channelizer = true;
+    int channels = round(rate / pfb_channel_spacing);
+    // Each channel is passed out at twice the spacing, so its full width
+    // is usable and a signal between two raster points still fits
+#if GNURADIO_VERSION < 0x030900
+    std::vector<float> taps = gr::filter::firdes::low_pass_2(1.0, rate, pfb_channel_spacing, pfb_channel_spacing / 5, 60, gr::filter::firdes::WIN_BLACKMAN_HARRIS);
+#else
+    std::vector<float> taps = gr::filter::firdes::low_pass_2(1.0, rate, pfb_channel_spacing, pfb_channel_spacing / 5, 60, gr::fft::window::WIN_BLACKMAN_HARRIS);
+#endif
+    pfb_channelizer = gr::filter::pfb_channelizer_ccf::make(channels, taps, 2.0);
+    BOOST_LOG_TRIVIAL(info) << "\t PFB Channelizer - Channels: " << channels << " Spacing: " << FormatSamplingRate(pfb_channel_spacing) << " Taps: " << taps.size() << " Taps per Channel: " << ceil(taps.size() / (double)channels);
+    connect_output(tb, pfb_channelizer);
+  }
+}
+
+void Source::attach_fft_channelizer(gr::top_block_sptr tb) {
+  if (!attached_fft_channelizer) {
+    attached_fft_channelizer = true;
+    fft_channelizer = make_fft_channelizer_ccc(rate, 2 * pfb_channel_spacing, std::max(1, fft_threads));
+    BOOST_LOG_TRIVIAL(info) << "\t FFT Channelizer - Channel Rate: " << FormatSamplingRate(fft_channelizer->get_channel_rate()) << " FFT Size: " << fft_channelizer->get_fft_size() << " Bin Spacing: " << FormatSamplingRate(fft_channelizer->get_bin_spacing()) << " Taps: " << fft_channelizer->get_taps();
+    connect_output(tb, fft_channelizer);
+  }
+}
+
+// Each recorder needs 36 kHz either side of its channel, for the IF filter
+// of its xlat_channelizer, and the rest of the tile is reach
+void Source::attach_subband_tiler(gr::top_block_sptr tb) {
+  if (!attached_subband_tiler) {
+    attached_subband_tiler = true;
+    subband_tiler = make_subband_tiler_ccc(rate, tile_decimation(), 40000, std::max(1, fft_threads));
+    BOOST_LOG_TRIVIAL(info) << "\t Sub-band Tiler - Tile Rate: " << FormatSamplingRate(subband_tiler->get_tile_rate()) << " Tiles: " << subband_tiler->get_tile_count() << " Spacing: " << FormatSamplingRate(subband_tiler->get_reach()) << " Taps: " << subband_tiler->get_taps();
+    connect_output(tb, subband_tiler);
+  }
+}
+
+int Source::tile_decimation() {
+  return std::max(2, (int)floor(rate / tile_width));
+}
+
+// The P25 and DMR recorders take their channel from the Source's shared
+// channelizer when it has one. The selector is attached either way, since
+// the sample stats and got_samples() are counted by it.
+void Source::connect_digital_recorder(gr::top_block_sptr tb, gr::basic_block_sptr block, Recorder *log) {
+  attach_selector(tb);
+  if (channelizer_mode == "tile") {
+    attach_subband_tiler(tb);
+    int output = subband_tiler->add_output();
+    log->set_selector_port(pfb_port_base + output);
+    tb->connect(subband_tiler, output, block, 0);
+  } else if (channelizer_mode == "fft") {
+    attach_fft_channelizer(tb);
+    int output = fft_channelizer->add_channel();
+    log->set_selector_port(pfb_port_base + output);
+    tb->connect(fft_channelizer, output, block, 0);
+  } else if (channelizer_mode == "pfb") {
+    // The filterbank's outputs have to be connected in order, so each
+    // recorder takes the next one and is steered by the channel map
+    attach_pfb_channelizer(tb);
+    int output = pfb_channel_map.size();
+    pfb_channel_map.push_back(0);
+    pfb_channelizer->set_channel_map(pfb_channel_map);
+    log->set_selector_port(pfb_port_base + output);
+    tb->connect(pfb_channelizer, output, block, 0);
+  } else {
+    connect_recorder(tb, block);
+  }
+}
+
+void Source::connect_recorder(gr::top_block_sptr tb, gr::basic_block_sptr log) {
+  // The recorder's channelizer drops its input while it is parked, so it
+  // can share source_block's buffer with the others instead of being fed a
+  // copy through the selector
+  attach_selector(tb);
+  connect_output(tb, log);
+}
+
+void Source::set_channelizer(std::string mode, double channel_spacing, double tile_width) {
+  if (mode == "tile") {
+    // A tile has to leave room for a channel and its recorder's filter,
+    // and be a real cut of the source's bandwidth
+    if ((tile_width < 250000) || (rate / tile_width < 2)) {
+      BOOST_LOG_TRIVIAL(error) << "The tile channelizer's tile width must be at least 250000 and no more than half the sample rate, rate: " << FormatSamplingRate(rate) << " width: " << tile_width << " - using the xlat channelizer";
+      mode = "xlat";
+    }
+  } else if ((mode == "pfb") || (mode == "fft")) {
+    long channels = round(rate / channel_spacing);
+    // A channel comes out at twice the spacing, which the P25 recorders
+    // need to be between their 24 kHz channel rate and the 96 kHz IF rate
+    if ((channel_spacing < 12000) || (channel_spacing >= 48000)) {
+      BOOST_LOG_TRIVIAL(error) << "The " << mode << " channelizer's spacing must be at least 12000 and less than 48000, spacing: " << channel_spacing << " - using the xlat channelizer";
+      mode = "xlat";
+    } else if ((fabs(channels * channel_spacing - rate) > 1) || (channels & 1)) {
+      BOOST_LOG_TRIVIAL(error) << "The " << mode << " channelizer needs the sample rate to be an even multiple of the channel spacing, rate: " << FormatSamplingRate(rate) << " spacing: " << channel_spacing << " - using the xlat channelizer";
+      mode = "xlat";
+    }
+  } else if (mode != "xlat") {
+    BOOST_LOG_TRIVIAL(error) << "Unknown channelizer: " << mode << " - using the xlat channelizer";
+    mode = "xlat";
+  }
+  channelizer_mode = mode;
+  pfb_channel_spacing = channel_spacing;
+  this->tile_width = tile_width;
+}
+
+std::string Source::get_channelizer() {
+  return channelizer_mode;
+}
+
+double Source::get_digital_recorder_rate() {
+  if (channelizer_mode == "tile") {
+    return rate / tile_decimation();
+  }
+  if ((channelizer_mode == "pfb") || (channelizer_mode == "fft")) {
+    return 2 * pfb_channel_spacing;
+  }
+  return rate;
+}
+
+double Source::tune_channel(unsigned int port, double offset_amount) {
+  if (port < pfb_port_base) {
+    return offset_amount;
+  }
+
+  // The tiler leaves the recorder to tune from the center of its tile
+  if (channelizer_mode == "tile") {
+    return -subband_tiler->set_output(port - pfb_port_base, -offset_amount);
+  }
+
+  // The FFT filterbank centers the channel on the nearest of its bins
+  if (channelizer_mode == "fft") {
+    return -fft_channelizer->set_channel(port - pfb_port_base, -offset_amount);
+  }
+
+  // offset_amount is center - freq, so the signal sits at -offset_amount
+  // in the source's baseband. Take the nearest filterbank channel and
+  // leave the recorder to tune out what is left over.
+  long channels = round(rate / pfb_channel_spacing);
+  long nearest = lround(-offset_amount / pfb_channel_spacing);
+  int channel = ((nearest % channels) + channels) % channels;
+
+  pfb_channel_map[port - pfb_port_base] = channel;
+  pfb_channelizer->set_channel_map(pfb_channel_map);
+  return offset_amount + nearest * pfb_channel_spacing;
+}
+
+// Only the channels of the "fft" channelizer, and the tiles of the "tile"
+// one, with a recorder on them are worked out
+void Source::set_channel_enabled(unsigned int port, bool enabled) {
+  if ((port >= pfb_port_base) && (channelizer_mode == "fft")) {
+    fft_channelizer->set_channel_enabled(port - pfb_port_base, enabled);
+  } else if ((port >= pfb_port_base) && (channelizer_mode == "tile")) {
+    subband_tiler->set_output_enabled(port - pfb_port_base, enabled);
+  }
+}
+
+// Analog and digital recorders use the source's thread count unless they
+// have their own, 0 meaning unset
+void Source::set_fft_threads(int all, int analog, int digital) {
+  fft_threads = all;
+  analog_fft_threads = analog;
+  digital_fft_threads = digital;
+}
+
+int Source::get_fft_threads() {
+  return fft_threads;
+}
+
+int Source::get_analog_fft_threads() {
+  return analog_fft_threads ? analog_fft_threads : fft_threads;
+}
+
+int Source::get_digital_fft_threads() {
+  return digital_fft_threads ? digital_fft_threads : fft_threads;
+}
+
+// Formats a core list as ranges, e.g. "0-7,16-23"
+static std::string format_cpu_list(const std::vector<int> &cores) {
+  std::ostringstream list;
+  for (size_t i = 0; i < cores.size(); i++) {
+    size_t j = i;
+    while ((j + 1 < cores.size()) && (cores[j + 1] == cores[j] + 1)) {
+      j++;
+    }
+    if (i) {
+      list << ",";
+    }
+    list << cores[i];
+    if (j > i) {
+      list << "-" << cores[j];
+    }
+    i = j;
+  }
+  return list.str();
+}
+
+void Source::set_cpu_affinity(std::vector<int> cores) {
+  std::sort(cores.begin(), cores.end());
+  cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+  cpu_affinity = cores;
+  BOOST_LOG_TRIVIAL(info) << " - Setting CPU Affinity to: " << format_cpu_list(cpu_affinity);
+}
+
+// Pins to the cores of a NUMA node, as listed by the kernel in
+// /sys/devices/system/node/node<N>/cpulist, e.g. "0-7,16-23"
+bool Source::set_numa_node(int node) {
+  std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+  std::ifstream cpulist(path);
+  std::string ranges;
+
+  if (!std::getline(cpulist, ranges)) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to read the CPUs of NUMA node " << node << " from " << path;
+    return false;
+  }
+
+  std::vector<int> cores;
+  std::istringstream ranges_stream(ranges);
+  std::string range;
+  while (std::getline(ranges_stream, range, ',')) {
+    int first, last;
+    if (sscanf(range.c_str(), "%d-%d", &first, &last) == 2) {
+      for (int core = first; core <= last; core++) {
+        cores.push_back(core);
+      }
+    } else if (sscanf(range.c_str(), "%d", &first) == 1) {
+      cores.push_back(first);
+    }
+  }
+
+  if (cores.empty()) {
+    BOOST_LOG_TRIVIAL(error) << "NUMA node " << node << " has no CPUs";
+    return false;
+  }
+  BOOST_LOG_TRIVIAL(info) << " - NUMA Node: " << node;
+  set_cpu_affinity(cores);
+  return true;
+}
+
+std::vector<int> Source::get_cpu_affinity() {
+  return cpu_affinity;
+}
+
+// Hier blocks pass the mask on to every block inside them; GNU Radio
+// applies it when each block's thread starts
+void Source::pin_block(gr::basic_block_sptr block) {
+  if (cpu_affinity.empty() || !block) {
+    return;
+  }
+  block->set_processor_affinity(cpu_affinity);
+}
+
+// In the "recorder" thread model every block of a recorder runs on one
+// core, so its threads hand buffers to each other in that core's cache
+// rather than being moved around by the kernel. The recorders are dealt
+// out over the Source's cores, or all of them when it has no cpuAffinity.
+void Source::pin_recorder(gr::basic_block_sptr recorder) {
+  if (!recorder) {
+    return;
+  }
+  if (!config || (config->recorder_thread_model != "recorder")) {
+    pin_block(recorder);
+    return;
+  }
+
+  std::vector<int> cores = cpu_affinity;
+  if (cores.empty()) {
+    int count = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int core = 0; core < count; core++) {
+      cores.push_back(core);
+    }
+  }
+  int core = cores[next_recorder_core % cores.size()];
+  next_recorder_core++;
+  recorder->set_processor_affinity(std::vector<int>(1, core));
+}
+
+// Pins the source and everything hanging off it. Control channels are
+// pinned by whoever connects them, since they belong to a System.
+void Source::apply_cpu_affinity() {
+  std::vector<Recorder *> recorders = get_recorders();
+  for (std::vector<Recorder *>::iterator it = recorders.begin(); it != recorders.end(); it++) {
+    gr::basic_block *block = dynamic_cast<gr::basic_block *>(*it);
+    if (block) {
+      pin_recorder(block->to_basic_block());
+    }
+  }
+
+  if (cpu_affinity.empty()) {
+    return;
+  }
+  pin_block(source_block);
+  if (attached_selector) {
+    pin_block(recorder_selector);
+  }
+  if (attached_detector) {
+    pin_block(signal_detector);
+  }
+  if (attached_pfb_channelizer) {
+    pin_block(pfb_channelizer);
+  }
+  if (attached_fft_channelizer) {
+    pin_block(fft_channelizer);
+  }
+  if (attached_subband_tiler) {
+    pin_block(subband_tiler);
+  }
+  if (attached_shm_sink) {
+    pin_block(shm_sink);
+  }
+}
+
+void Source::set_shm_ring(std::string name, int blocks) {
+  shm_ring = name;
+  shm_ring_blocks = blocks;
+}
+
+std::string Source::get_shm_ring() {
+  return shm_ring;
+}
+
+// Each analog and P25 recorder on the source keeps this many seconds of its
+// channel for Recorder::snapshot_iq(), 0 for none
+void Source::set_iq_ring_seconds(double seconds) {
+  iq_ring_seconds = seconds;
+}
+
+double Source::get_iq_ring_seconds() {
+  return iq_ring_seconds;
+}
+
+// The recorders made for the source are built with the Low_Latency_Profile
+void Source::set_low_latency(bool enabled) {
+  low_latency = enabled;
+}
+
+bool Source::get_low_latency() {
+  return low_latency;
+}
+
+int Source::get_recorder_buffer_items(Recorder_Type type) {
+  if (!config) {
+    return 0;
+  }
+  std::string name;
+  switch (type) {
+  case ANALOG:
+  case ANALOGC:
+    name = "analog";
+    break;
+  case P25:
+  case P25C:
+    name = "p25";
+    break;
+  case DMR:
+    name = "dmr";
+    break;
+  case SIGMF:
+  case SIGMFC:
+    name = "sigmf";
+    break;
+  case DEBUG:
+    name = "debug";
+    break;
+  default:
+    return 0;
+  }
+  std::map<std::string, int>::const_iterator it = config->recorder_buffer_items.find(name);
+  return (it != config->recorder_buffer_items.end()) ? it->second : 0;
+}
+
+void Source::attach_shm_sink(gr::top_block_sptr tb) {
+  if (!attached_shm_sink && (shm_ring != "")) {
+    attached_shm_sink = true;
+    shm_sink = shm_iq_sink::make(shm_ring, rate, center, shm_ring_blocks);
+    connect_output(tb, shm_sink);
   }
 }
 
 void Source::attach_detector(gr::top_block_sptr tb) {
   if (!attached_detector) {
     attached_detector = true;
-    tb->connect(source_block, 0, signal_detector, 0);
+    connect_output(tb, signal_detector);
   }
 }
 
@@ -242,13 +838,13 @@ void Source::set_antenna(std::string ant) {
   antenna = ant;
 
   if (driver == "osmosdr") {
-    cast_to_osmo_sptr(source_block)->set_antenna(antenna, 0);
-    BOOST_LOG_TRIVIAL(info) << "Setting antenna to [" << cast_to_osmo_sptr(source_block)->get_antenna() << "]";
+    cast_to_osmo_sptr(device_block)->set_antenna(antenna, 0);
+    BOOST_LOG_TRIVIAL(info) << "Setting antenna to [" << cast_to_osmo_sptr(device_block)->get_antenna() << "]";
   }
 
   if (driver == "usrp") {
     BOOST_LOG_TRIVIAL(info) << "Setting antenna to [" << antenna << "]";
-    cast_to_usrp_sptr(source_block)->set_antenna(antenna, 0);
+    cast_to_usrp_sptr(device_block)->set_antenna(antenna, 0);
   }
 }
 
@@ -287,6 +883,72 @@ bool Source::got_samples() {
   return true;
 }
 
+// Samples the SDR dropped show up as the source delivering less than its
+// rate; overflows UHD reports are counted by the selector from rx_time
+// tags. Shortfalls under 1% are taken to be timing jitter.
+void Source::update_stats(float timeDiff) {
+  if (!attached_selector || (timeDiff <= 0)) {
+    return;
+  }
+
+  uint64_t samples = recorder_selector->get_sample_count();
+  uint64_t overflows = recorder_selector->get_overflow_count();
+
+  // The first window includes startup, before streaming began
+  if (stats_samples > 0) {
+    double received = samples - stats_samples;
+    double expected = rate * timeDiff;
+    if (received < expected * 0.99) {
+      stats_dropped += expected - received;
+    }
+    stats_rate = received / timeDiff;
+    stats_window_overflows = overflows - stats_overflows;
+  }
+  stats_samples = samples;
+  stats_overflows = overflows;
+}
+
+uint64_t Source::get_stats_samples() {
+  return stats_samples;
+}
+
+uint64_t Source::get_stats_overflows() {
+  return stats_overflows;
+}
+
+long Source::get_stats_window_overflows() {
+  return stats_window_overflows;
+}
+
+uint64_t Source::get_stats_dropped() {
+  return stats_dropped;
+}
+
+void Source::count_preempted_call() {
+  preempted_calls++;
+}
+
+uint64_t Source::get_preempted_calls() {
+  return preempted_calls;
+}
+
+double Source::get_stats_rate() {
+  return stats_rate;
+}
+
+boost::property_tree::ptree Source::get_stats_current() {
+  boost::property_tree::ptree source_node;
+  source_node.put("id", src_num);
+  source_node.put("samples", stats_samples);
+  source_node.put("rate", stats_rate);
+  source_node.put("overflows", stats_overflows);
+  source_node.put("window_overflows", stats_window_overflows);
+  source_node.put("dropped", stats_dropped);
+  source_node.put("preempted_calls", preempted_calls);
+
+  return source_node;
+}
+
 std::string Source::get_driver() {
   return driver;
 }
@@ -299,8 +961,8 @@ void Source::set_freq_corr(double p) {
   ppm = p;
 
   if (driver == "osmosdr") {
-    cast_to_osmo_sptr(source_block)->set_freq_corr(ppm);
-    BOOST_LOG_TRIVIAL(info) << "PPM set to: " << cast_to_osmo_sptr(source_block)->get_freq_corr();
+    cast_to_osmo_sptr(device_block)->set_freq_corr(ppm);
+    BOOST_LOG_TRIVIAL(info) << "PPM set to: " << cast_to_osmo_sptr(device_block)->get_freq_corr();
   }
 }
 
@@ -317,8 +979,8 @@ double Source::get_error() {
 void Source::set_gain(double r) {
   if (driver == "osmosdr") {
     gain = r;
-    cast_to_osmo_sptr(source_block)->set_gain(gain);
-    double current_gain = cast_to_osmo_sptr(source_block)->get_gain();
+    cast_to_osmo_sptr(device_block)->set_gain(gain);
+    double current_gain = cast_to_osmo_sptr(device_block)->get_gain();
     if (current_gain != gain) {
       BOOST_LOG_TRIVIAL(error) << "Requested Gain of " << gain << " not supported, driver using: " << current_gain;
     }
@@ -327,7 +989,7 @@ void Source::set_gain(double r) {
 
   if (driver == "usrp") {
     gain = r;
-    cast_to_usrp_sptr(source_block)->set_gain(gain);
+    cast_to_usrp_sptr(device_block)->set_gain(gain);
   }
 }
 
@@ -342,8 +1004,8 @@ std::vector<Gain_Stage_t> Source::get_gain_stages() {
 
 void Source::set_gain_by_name(std::string name, double new_gain) {
   if (driver == "osmosdr") {
-    cast_to_osmo_sptr(source_block)->set_gain(new_gain, name);
-    double current_gain = cast_to_osmo_sptr(source_block)->get_gain(name);
+    cast_to_osmo_sptr(device_block)->set_gain(new_gain, name);
+    double current_gain = cast_to_osmo_sptr(device_block)->get_gain(name);
     if (current_gain != new_gain) {
       BOOST_LOG_TRIVIAL(error) << "Requested " << name << " Gain of " << new_gain << " not supported, driver using: " << current_gain;
     }
@@ -357,7 +1019,7 @@ void Source::set_gain_by_name(std::string name, double new_gain) {
 int Source::get_gain_by_name(std::string name) {
   if (driver == "osmosdr") {
     try {
-      return cast_to_osmo_sptr(source_block)->get_gain(name, 0);
+      return cast_to_osmo_sptr(device_block)->get_gain(name, 0);
     } catch (std::exception &e) {
       BOOST_LOG_TRIVIAL(error) << name << " Gain unsupported or other error: " << e.what();
     }
@@ -374,8 +1036,8 @@ double Source::get_gain() {
 void Source::set_gain_mode(bool m) {
   if (driver == "osmosdr") {
     gain_mode = m;
-    cast_to_osmo_sptr(source_block)->set_gain_mode(gain_mode);
-    if (cast_to_osmo_sptr(source_block)->get_gain_mode()) {
+    cast_to_osmo_sptr(device_block)->set_gain_mode(gain_mode);
+    if (cast_to_osmo_sptr(device_block)->get_gain_mode()) {
       BOOST_LOG_TRIVIAL(info) << "Auto gain control is ON";
     } else {
       BOOST_LOG_TRIVIAL(info) << "Auto gain control is OFF";
@@ -433,95 +1095,314 @@ bool Source::get_autotune_source() {
 
 /* -- Recorders -- */
 
-std::vector<Recorder *> Source::find_conventional_recorders_by_freq(Detected_Signal signal) {
-  double freq = center + signal.center_freq;
-
-  std::vector<Recorder *> recorders;
-  long max_freq_diff = 12500;
-  for (std::vector<p25_recorder_sptr>::iterator it = digital_conv_recorders.begin(); it != digital_conv_recorders.end(); it++) {
-    p25_recorder_sptr rx = *it;
-    double recorder_freq = rx->get_freq();
+// Only the conventional recorders waiting for a signal are checked, and only
+// against the signals that showed up since the last time
+void Source::enable_detected_recorders() {
+  std::vector<Detected_Signal> appeared;
+  std::vector<Detected_Signal> lost;
 
-    if (std::abs(freq - recorder_freq) < max_freq_diff) {
-      recorders.push_back((Recorder *)rx.get());
-    }
+  if (!attached_detector || !signal_detector->get_signal_changes(appeared, lost)) {
+    return;
   }
 
-  for (std::vector<dmr_recorder_sptr>::iterator it = dmr_conv_recorders.begin(); it != dmr_conv_recorders.end(); it++) {
-    dmr_recorder_sptr rx = *it;
-    double recorder_freq = rx->get_freq();
+  for (std::vector<Detected_Signal>::iterator it = lost.begin(); it != lost.end(); it++) {
+    BOOST_LOG_TRIVIAL(debug) << "Source " << src_num << " - Lost Signal: " << format_freq(center + it->center_freq);
+  }
 
-    if (std::abs(freq - recorder_freq) < max_freq_diff) {
-      recorders.push_back((Recorder *)rx.get());
-    }
+  for (std::vector<Detected_Signal>::iterator it = appeared.begin(); it != appeared.end() && !armed_recorders.empty(); it++) {
+    enable_armed_recorders(*it);
   }
+}
 
-  for (std::vector<analog_recorder_sptr>::iterator it = analog_conv_recorders.begin(); it != analog_conv_recorders.end(); it++) {
-    analog_recorder_sptr rx = *it;
-    double recorder_freq = rx->get_freq();
+// armed_recorders is kept sorted by frequency, so only the ones within
+// max_freq_diff of the signal are looked at, however many channels the
+// Source has
+void Source::enable_armed_recorders(Detected_Signal signal) {
+  double freq = center + signal.center_freq;
+  long max_freq_diff = 12500;
 
-    if (std::abs(freq - recorder_freq) < max_freq_diff) {
-      recorders.push_back((Recorder *)rx.get());
+  std::vector<std::pair<double, Recorder *>>::iterator it = std::lower_bound(armed_recorders.begin(), armed_recorders.end(), std::make_pair(freq - max_freq_diff, (Recorder *)NULL));
+  while ((it != armed_recorders.end()) && (it->first < freq + max_freq_diff)) {
+    Recorder *recorder = it->second;
+    if (recorder->is_enabled()) {
+      it = armed_recorders.erase(it);
+      continue;
     }
+    if (std::abs(freq - it->first) < max_freq_diff) {
+      recorder->set_enabled(true);
+      BOOST_LOG_TRIVIAL(info) << "\t[ " << recorder->get_num() << " ] " << recorder->get_type_string() << "\tEnabled - Freq: " << format_freq(recorder->get_freq()) << "\t Detected Signal: " << floor(signal.max_rssi) << "dBM (Threshold: " << floor(signal.threshold) << "dBM)";
+      it = armed_recorders.erase(it);
+      continue;
+    }
+    it++;
   }
-
-  return recorders;
 }
 
-void Source::enable_detected_recorders() {
-  std::vector<Detected_Signal> signals = signal_detector->get_detected_signals();
+// Called by a conventional recorder when it starts waiting for the signal
+// detector. A signal that is already there turns it on straight away.
+void Source::arm_detected_recorder(Recorder *recorder) {
+  // Recorders that were turned on some other way, or that have moved since
+  // they were armed, aren't waiting on that frequency any more. Dropping
+  // them here, whatever frequency they were armed on, keeps the list to
+  // one entry for each recorder that is waiting.
+  armed_recorders.erase(std::remove_if(armed_recorders.begin(), armed_recorders.end(),
+                                       [recorder](const std::pair<double, Recorder *> &armed) {
+                                         return (armed.second == recorder) || armed.second->is_enabled() || (armed.first != armed.second->get_freq());
+                                       }),
+                        armed_recorders.end());
 
-  for (std::vector<Detected_Signal>::iterator it = signals.begin(); it != signals.end(); it++) {
-    Detected_Signal signal = *it;
-
-    float rssi = signal.max_rssi;
-    float threshold = signal.threshold;
+  std::pair<double, Recorder *> armed(recorder->get_freq(), recorder);
+  std::vector<std::pair<double, Recorder *>>::iterator it = std::lower_bound(armed_recorders.begin(), armed_recorders.end(), armed);
+  armed_recorders.insert(it, armed);
 
-    std::vector<Recorder *> recorders = find_conventional_recorders_by_freq(signal);
-    for (std::vector<Recorder *>::iterator it = recorders.begin(); it != recorders.end(); it++) {
-      Recorder *recorder = *it;
-      if (!recorder->is_enabled()) {
-        recorder->set_enabled(true);
-        BOOST_LOG_TRIVIAL(info) << "\t[ " << recorder->get_num() << " ] " << recorder->get_type_string() << "\tEnabled - Freq: " << format_freq(recorder->get_freq()) << "\t Detected Signal: " << floor(rssi) << "dBM (Threshold: " << floor(threshold) << "dBM)";
-      }
+  if (!attached_detector) {
+    return;
+  }
+  std::vector<Detected_Signal> signals = signal_detector->get_detected_signals();
+  for (std::vector<Detected_Signal>::iterator it = signals.begin(); it != signals.end(); it++) {
+    enable_armed_recorders(*it);
+    if (recorder->is_enabled()) {
+      break;
     }
   }
 }
 
+void Source::set_signal_change_callback(std::function<void()> callback) {
+  if (signal_detector) {
+    signal_detector->set_change_callback(callback);
+  }
+}
+
 void Source::set_signal_detector_threshold(float threshold) {
 BOOST_LOG_TRIVIAL(info) << " - Setting Signal Detector Threshold to: " << threshold;
   signal_detector->set_threshold(threshold);
 }
 
+void Source::set_signal_detector_rate(float rate) {
+  BOOST_LOG_TRIVIAL(info) << " - Setting Signal Detector Rate to: " << rate << " FFTs a second";
+  signal_detector->set_rate(rate);
+}
+
 void Source::create_analog_recorders(gr::top_block_sptr tb, int r) {
-  if (r > 0) {
-    attach_selector(tb);
-  }
   max_analog_recorders = r;
+  top_block = tb;
+  int warm = ((warm_analog_recorders < 0) || (warm_analog_recorders > r)) ? r : warm_analog_recorders;
 
-  for (int i = 0; i < max_analog_recorders; i++) {
+  for (int i = 0; i < warm; i++) {
     analog_recorder_sptr log = make_analog_recorder(this, ANALOG);
     analog_recorders.push_back(log);
-    log->set_selector_port(next_selector_port);
-    tb->connect(recorder_selector, next_selector_port, log, 0);
-    next_selector_port++;
+    connect_recorder(tb, log);
+  }
+  // Released in order so the lowest numbered recorder is handed out first
+  for (std::vector<analog_recorder_sptr>::iterator it = analog_recorders.begin(); it != analog_recorders.end(); it++) {
+    analog_pool.release((Recorder *)it->get());
+  }
+  if (warm < r) {
+    BOOST_LOG_TRIVIAL(info) << "Made " << warm << " of " << r << " Analog Recorders, the rest will be made as they are needed";
   }
 }
 
 void Source::create_digital_recorders(gr::top_block_sptr tb, int r) {
-
-  if (r > 0) {
-    attach_selector(tb);
-  }
   max_digital_recorders = r;
+  top_block = tb;
+  int warm = ((warm_digital_recorders < 0) || (warm_digital_recorders > r)) ? r : warm_digital_recorders;
 
-  for (int i = 0; i < max_digital_recorders; i++) {
+  for (int i = 0; i < warm; i++) {
     p25_recorder_sptr log = make_p25_recorder(this, P25);
     digital_recorders.push_back(log);
-    log->set_selector_port(next_selector_port);
-    tb->connect(recorder_selector, next_selector_port, log, 0);
-    next_selector_port++;
+    connect_digital_recorder(tb, log, log.get());
+  }
+  for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin(); it != digital_recorders.end(); it++) {
+    digital_pool.release((Recorder *)it->get());
+  }
+  if (warm < r) {
+    BOOST_LOG_TRIVIAL(info) << "Made " << warm << " of " << r << " Digital Recorders, the rest will be made as they are needed";
+  }
+}
+
+void Source::set_warm_recorders(int digital, int analog, int low_watermark) {
+  warm_digital_recorders = digital;
+  warm_analog_recorders = analog;
+  recorder_low_watermark = low_watermark;
+}
+
+// Asks the Recorder_Builder for another trunking recorder once the free
+// ones are down to the watermark, counting the ones already asked for
+void Source::check_recorder_watermark(Recorder_Type type) {
+  if (type == P25) {
+    if ((digital_pool.available() + pending_digital_recorders < recorder_low_watermark) && (made_recorder_count(P25) + pending_digital_recorders < max_digital_recorders)) {
+      pending_digital_recorders++;
+      Recorder_Builder::request(this, P25);
+    }
+  } else if (type == ANALOG) {
+    if ((analog_pool.available() + pending_analog_recorders < recorder_low_watermark) && (made_recorder_count(ANALOG) + pending_analog_recorders < max_analog_recorders)) {
+      pending_analog_recorders++;
+      Recorder_Builder::request(this, ANALOG);
+    }
+  }
+}
+
+// Every free recorder is in use but there is room for more: rather than
+// miss the call, make one here and wait for it
+Recorder *Source::build_recorder_now(Recorder_Type type) {
+  if (!top_block) {
+    return NULL;
+  }
+  if ((type == P25) && (made_recorder_count(P25) + pending_digital_recorders < max_digital_recorders)) {
+    p25_recorder_sptr log = make_p25_recorder(this, P25);
+    pending_digital_recorders++;
+    top_block->lock();
+    add_built_recorder(top_block, log);
+    top_block->unlock();
+    return digital_pool.next();
+  }
+  if ((type == ANALOG) && (made_recorder_count(ANALOG) + pending_analog_recorders < max_analog_recorders)) {
+    analog_recorder_sptr log = make_analog_recorder(this, ANALOG);
+    pending_analog_recorders++;
+    top_block->lock();
+    add_built_recorder(top_block, log);
+    top_block->unlock();
+    return analog_pool.next();
+  }
+  return NULL;
+}
+
+// A recorder the Recorder_Builder made, connected with the top_block locked
+void Source::add_built_recorder(gr::top_block_sptr tb, p25_recorder_sptr recorder) {
+  pending_digital_recorders--;
+  digital_recorders.push_back(recorder);
+  connect_digital_recorder(tb, recorder, recorder.get());
+  pin_recorder(recorder);
+  return_to_pool((Recorder *)recorder.get());
+}
+
+void Source::add_built_recorder(gr::top_block_sptr tb, analog_recorder_sptr recorder) {
+  pending_analog_recorders--;
+  analog_recorders.push_back(recorder);
+  connect_recorder(tb, recorder);
+  pin_recorder(recorder);
+  return_to_pool((Recorder *)recorder.get());
+}
+
+// The trunking recorders of a type that are in use or in the pool, not
+// counting the ones retired by set_max_recorders()
+int Source::made_recorder_count(Recorder_Type type) {
+  if (type == P25) {
+    return (int)digital_recorders.size() - (int)retired_digital_recorders.size();
+  }
+  return (int)analog_recorders.size() - (int)retired_analog_recorders.size();
+}
+
+// A free trunking recorder goes back in its pool, unless the pool has been
+// made smaller than the recorders there are
+void Source::return_to_pool(Recorder *recorder) {
+  bool digital = (recorder->get_type() == P25);
+  std::vector<Recorder *> &retired = digital ? retired_digital_recorders : retired_analog_recorders;
+  if (std::find(retired.begin(), retired.end(), recorder) != retired.end()) {
+    return;
   }
+  if (made_recorder_count(recorder->get_type()) > (digital ? max_digital_recorders : max_analog_recorders)) {
+    retired.push_back(recorder);
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << recorder->get_num() << " ] " << recorder->get_type_string() << "\tRetired, the pool is down to " << (digital ? max_digital_recorders : max_analog_recorders);
+    return;
+  }
+  Recorder_Pool &pool = digital ? digital_pool : analog_pool;
+  pool.release(recorder, recorder->get_freq());
+}
+
+// Changes how many trunking recorders of a type the Source can have while
+// it runs. Growing puts back any it retired before and then leaves the
+// rest to be made off the main loop, all at once if they are all made up
+// front and as they are needed otherwise. Shrinking retires free ones
+// straight away and busy ones when their call ends. Retired recorders stay
+// connected, parked, so neither way locks the flowgraph.
+void Source::set_max_recorders(Recorder_Type type, int count) {
+  bool digital = (type == P25);
+  Recorder_Pool &pool = digital ? digital_pool : analog_pool;
+  std::vector<Recorder *> &retired = digital ? retired_digital_recorders : retired_analog_recorders;
+  int &max = digital ? max_digital_recorders : max_analog_recorders;
+  int &pending = digital ? pending_digital_recorders : pending_analog_recorders;
+  int warm = digital ? warm_digital_recorders : warm_analog_recorders;
+  max = std::max(0, count);
+
+  while ((made_recorder_count(type) < max) && !retired.empty()) {
+    Recorder *recorder = retired.back();
+    retired.pop_back();
+    pool.release(recorder, recorder->get_freq());
+  }
+  while (made_recorder_count(type) > max) {
+    Recorder *recorder = pool.next();
+    if (!recorder) {
+      break;
+    }
+    pool.take(recorder);
+    retired.push_back(recorder);
+  }
+
+  if (warm < 0) {
+    while (made_recorder_count(type) + pending < max) {
+      pending++;
+      Recorder_Builder::request(this, type);
+    }
+  } else {
+    check_recorder_watermark(type);
+  }
+  BOOST_LOG_TRIVIAL(info) << "[ Source " << src_num << ": " << format_freq(center) << " ] " << (digital ? "Digital" : "Analog") << " Recorders set to " << max << ", " << made_recorder_count(type) << " made, " << pool.available() << " free";
+}
+
+int Source::get_max_recorders(Recorder_Type type) {
+  return (type == P25) ? max_digital_recorders : max_analog_recorders;
+}
+
+// The recorder of a conventional channel that has been removed. One fed
+// straight from the SDR is disconnected, one on a channelizer's output
+// stays where it is, stopped.
+void Source::remove_conventional_recorder(gr::top_block_sptr tb, Recorder *recorder) {
+  gr::basic_block_sptr block;
+  for (std::vector<analog_recorder_sptr>::iterator it = analog_conv_recorders.begin(); !block && (it != analog_conv_recorders.end()); ++it) {
+    if ((Recorder *)it->get() == recorder) {
+      block = *it;
+      analog_conv_recorders.erase(it);
+      break;
+    }
+  }
+  for (std::vector<p25_recorder_sptr>::iterator it = digital_conv_recorders.begin(); !block && (it != digital_conv_recorders.end()); ++it) {
+    if ((Recorder *)it->get() == recorder) {
+      block = *it;
+      digital_conv_recorders.erase(it);
+      break;
+    }
+  }
+  for (std::vector<dmr_recorder_sptr>::iterator it = dmr_conv_recorders.begin(); !block && (it != dmr_conv_recorders.end()); ++it) {
+    if ((Recorder *)it->get() == recorder) {
+      block = *it;
+      dmr_conv_recorders.erase(it);
+      break;
+    }
+  }
+  if (!block) {
+    return;
+  }
+  for (std::vector<std::pair<double, Recorder *>>::iterator it = armed_recorders.begin(); it != armed_recorders.end();) {
+    it = (it->second == recorder) ? armed_recorders.erase(it) : it + 1;
+  }
+  for (std::vector<std::pair<gr::basic_block_sptr, int>>::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+    if (it->first == block) {
+      tb->lock();
+      disconnect_output(tb, block, it->second);
+      tb->unlock();
+      break;
+    }
+  }
+  removed_recorders.push_back(block);
+}
+
+// A trunking recorder that isn't part of this Source's flowgraph, handed
+// out from its pool like the ones it made. utils/cc-replay uses these to
+// run grants through the call handling without any DSP.
+void Source::add_external_recorder(Recorder *recorder) {
+  external_recorders.push_back(recorder);
+  release_recorder(recorder);
 }
 
 void Source::create_sigmf_recorders(gr::top_block_sptr tb, int r) {
@@ -539,17 +1420,14 @@ void Source::create_sigmf_recorders(gr::top_block_sptr tb, int r) {
   }
 }
 
-analog_recorder_sptr Source::create_conventional_recorder(gr::top_block_sptr tb, float tone_freq) {
+analog_recorder_sptr Source::create_conventional_recorder(gr::top_block_sptr tb, float tone_freq, bool tone_squelch_gate) {
   // Not adding it to the vector of analog_recorders. We don't want it to be available for trunk recording.
   // Conventional recorders are tracked seperately in analog_conv_recorders
   attach_detector(tb);
-  attach_selector(tb);
 
-  analog_recorder_sptr log = make_analog_recorder(this, ANALOGC, tone_freq);
+  analog_recorder_sptr log = make_analog_recorder(this, ANALOGC, tone_freq, tone_squelch_gate);
   analog_conv_recorders.push_back(log);
-  log->set_selector_port(next_selector_port);
-  tb->connect(recorder_selector, next_selector_port, log, 0);
-  next_selector_port++;
+  connect_recorder(tb, log);
   return log;
 }
 
@@ -557,13 +1435,10 @@ analog_recorder_sptr Source::create_conventional_recorder(gr::top_block_sptr tb)
   // Not adding it to the vector of analog_recorders. We don't want it to be available for trunk recording.
   // Conventional recorders are tracked seperately in analog_conv_recorders
   attach_detector(tb);
-  attach_selector(tb);
 
   analog_recorder_sptr log = make_analog_recorder(this, ANALOGC);
   analog_conv_recorders.push_back(log);
-  log->set_selector_port(next_selector_port);
-  tb->connect(recorder_selector, next_selector_port, log, 0);
-  next_selector_port++;
+  connect_recorder(tb, log);
   return log;
 }
 sigmf_recorder_sptr Source::create_sigmf_conventional_recorder(gr::top_block_sptr tb) {
@@ -583,13 +1458,11 @@ p25_recorder_sptr Source::create_digital_conventional_recorder(gr::top_block_spt
   // Not adding it to the vector of digital_recorders. We don't want it to be available for trunk recording.
   // Conventional recorders are tracked seperately in digital_conv_recorders
   attach_detector(tb);
-  attach_selector(tb);
+  top_block = tb;
 
   p25_recorder_sptr log = make_p25_recorder(this, P25C);
   digital_conv_recorders.push_back(log);
-  log->set_selector_port(next_selector_port);
-  tb->connect(recorder_selector, next_selector_port, log, 0);
-  next_selector_port++;
+  connect_digital_recorder(tb, log, log.get());
   return log;
 }
 
@@ -597,13 +1470,10 @@ dmr_recorder_sptr Source::create_dmr_conventional_recorder(gr::top_block_sptr tb
   // Not adding it to the vector of digital_recorders. We don't want it to be available for trunk recording.
   // Conventional recorders are tracked seperately in digital_conv_recorders
   attach_detector(tb);
-  attach_selector(tb);
 
   dmr_recorder_sptr log = make_dmr_recorder(this, DMR);
   dmr_conv_recorders.push_back(log);
-  log->set_selector_port(next_selector_port);
-  tb->connect(recorder_selector, next_selector_port, log, 0);
-  next_selector_port++;
+  connect_digital_recorder(tb, log, log.get());
   return log;
 }
 
@@ -612,7 +1482,7 @@ void Source::create_debug_recorder(gr::top_block_sptr tb, int source_num) {
   debug_recorder_port = config->debug_recorder_port + source_num;
   debug_recorder_sptr log = make_debug_recorder(this, config->debug_recorder_address, debug_recorder_port);
   debug_recorders.push_back(log);
-  tb->connect(source_block, 0, log, 0);
+  connect_output(tb, log);
 }
 
 Recorder *Source::get_analog_recorder(Talkgroup *talkgroup, int priority, Call *call) {
@@ -636,22 +1506,39 @@ Recorder *Source::get_analog_recorder(Talkgroup *talkgroup, int priority, Call *
 }
 
 Recorder *Source::get_analog_recorder(Call *call) {
-  for (std::vector<analog_recorder_sptr>::iterator it = analog_recorders.begin();
-       it != analog_recorders.end(); it++) {
-    analog_recorder_sptr rx = *it;
-
-    if (rx->get_state() == AVAILABLE) {
-      return (Recorder *)rx.get();
-
-      break;
-    }
+  Recorder *rx = analog_pool.next(call->get_freq());
+  if (!rx) {
+    rx = build_recorder_now(ANALOG);
+  }
+  if (rx) {
+    return rx;
   }
   std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
   BOOST_LOG_TRIVIAL(error) << loghdr << "[ " << device << " ] No Analog Recorders Available.";
   return NULL;
 }
 
+// A Phase 2 call on a channel a recorder is already on shares its front
+// end with the call on the other slot
+Recorder *Source::get_shared_slot_recorder(Call *call) {
+  if (!config || !config->share_tdma_slots || !call->get_phase2_tdma()) {
+    return NULL;
+  }
+  for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin(); it != digital_recorders.end(); it++) {
+    Recorder *rx = (*it)->share_slot(call);
+    if (rx) {
+      return rx;
+    }
+  }
+  return NULL;
+}
+
 Recorder *Source::get_digital_recorder(Talkgroup *talkgroup, int priority, Call *call) {
+  Recorder *shared = get_shared_slot_recorder(call);
+  if (shared && !(talkgroup && (priority == -1))) {
+    return shared;
+  }
+
   int num_available_recorders = get_num_available_digital_recorders();
   std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
 
@@ -673,15 +1560,16 @@ Recorder *Source::get_digital_recorder(Talkgroup *talkgroup, int priority, Call
 }
 
 Recorder *Source::get_digital_recorder(Call *call) {
-  for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin();
-       it != digital_recorders.end(); it++) {
-    p25_recorder_sptr rx = *it;
-
-    if (rx->get_state() == AVAILABLE) {
-      return (Recorder *)rx.get();
-
-      break;
-    }
+  Recorder *rx = get_shared_slot_recorder(call);
+  if (rx) {
+    return rx;
+  }
+  rx = digital_pool.next(call->get_freq());
+  if (!rx) {
+    rx = build_recorder_now(P25);
+  }
+  if (rx) {
+    return rx;
   }
   std::string loghdr = log_header( call->get_short_name(), call->get_call_num(), call->get_talkgroup_display(), call->get_freq());
   BOOST_LOG_TRIVIAL(error) << loghdr << "[ " << device << " ] No Digital Recorders Available.";
@@ -689,11 +1577,47 @@ Recorder *Source::get_digital_recorder(Call *call) {
   for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin();
        it != digital_recorders.end(); it++) {
     p25_recorder_sptr rx = *it;
-    BOOST_LOG_TRIVIAL(info) << "[ " << rx->get_num() << " ] State: " << format_state(rx->get_state()) << " Freq: " << rx->get_freq();
+    BOOST_LOG_TRIVIAL(debug) << "[ " << rx->get_num() << " ] State: " << format_state(rx->get_state()) << " Freq: " << rx->get_freq();
   }
   return NULL;
 }
 
+// Trunking recorders leave their pool when they start a call and go back
+// when they are stopped. Conventional recorders are never in a pool.
+void Source::take_recorder(Recorder *recorder) {
+  if (recorder->get_type() == ANALOG) {
+    analog_pool.take(recorder);
+  } else if (recorder->get_type() == P25) {
+    digital_pool.take(recorder);
+  }
+  check_recorder_watermark(recorder->get_type());
+}
+
+// A stopped recorder is still tuned to its last call's channel
+void Source::release_recorder(Recorder *recorder) {
+  if ((recorder->get_type() == ANALOG) || (recorder->get_type() == P25)) {
+    return_to_pool(recorder);
+  }
+}
+
+// Parks the free recorder that has been free the longest on freq, unless
+// one already is or it is parked on another channel in wanted, see
+// Pre_Tuner. It goes back in the pool as the one free the least time.
+bool Source::pre_tune_recorder(Recorder_Type type, double freq, const std::set<long> &wanted) {
+  Recorder_Pool &pool = (type == ANALOG) ? analog_pool : digital_pool;
+  if (pool.tuned_to(freq)) {
+    return false;
+  }
+  Recorder *rx = pool.next();
+  if (!rx || wanted.count(lround(pool.tuned_freq(rx)))) {
+    return false;
+  }
+  pool.take(rx);
+  rx->tune_freq(freq);
+  pool.release(rx, freq);
+  return true;
+}
+
 Recorder *Source::get_debug_recorder() {
   for (std::vector<debug_recorder_sptr>::iterator it = debug_recorders.begin();
        it != debug_recorders.end(); it++) {
@@ -726,6 +1650,16 @@ Recorder *Source::get_sigmf_recorder() {
   return NULL;
 }
 
+// The share of a core the recorder has used over the run, and its totals
+static std::string format_recorder_cpu(Recorder *recorder) {
+  if (!Flowgraph_Profiler::counters_enabled()) {
+    return "";
+  }
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1) << "\tCPU: " << recorder->get_active_fraction() * 100 << "%\tWork: " << recorder->get_work_seconds() << " sec\tSamples: " << recorder->get_samples_processed();
+  return ss.str();
+}
+
 void Source::print_recorders() {
   // If autotune is enabled, show the average correction being applied for this source
   std::string autotune_status;
@@ -734,40 +1668,51 @@ void Source::print_recorders() {
   }
 
   BOOST_LOG_TRIVIAL(info) << "[ Source " << src_num << ": " << format_freq(center) << " ] " << device << autotune_status;
+  BOOST_LOG_TRIVIAL(info) << "\tRate: " << FormatSamplingRate(stats_rate) << "\tOverflows: " << stats_overflows << "\tDropped Samples: " << stats_dropped << "\tPreempted Calls: " << preempted_calls;
+  // With an affinity set, show where each block has actually been placed
+  std::string cpus;
+  if (!cpu_affinity.empty()) {
+    if (source_block) {
+      BOOST_LOG_TRIVIAL(info) << "\tSource Block CPUs: " << format_cpu_list(source_block->processor_affinity());
+    }
+    cpus = "\tCPUs: ";
+  } else if (config && (config->recorder_thread_model == "recorder")) {
+    cpus = "\tCPUs: ";
+  }
 
   for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin();
        it != digital_recorders.end(); it++) {
     p25_recorder_sptr rx = *it;
 
-    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state());
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state()) << cpus << (cpus.empty() ? "" : format_cpu_list(rx->processor_affinity())) << format_recorder_cpu(rx.get());
   }
 
   for (std::vector<p25_recorder_sptr>::iterator it = digital_conv_recorders.begin();
        it != digital_conv_recorders.end(); it++) {
     p25_recorder_sptr rx = *it;
 
-    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state());
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state()) << cpus << (cpus.empty() ? "" : format_cpu_list(rx->processor_affinity())) << format_recorder_cpu(rx.get());
   }
 
   for (std::vector<dmr_recorder_sptr>::iterator it = dmr_conv_recorders.begin();
        it != dmr_conv_recorders.end(); it++) {
     dmr_recorder_sptr rx = *it;
 
-    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state());
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state()) << cpus << (cpus.empty() ? "" : format_cpu_list(rx->processor_affinity())) << format_recorder_cpu(rx.get());
   }
 
   for (std::vector<analog_recorder_sptr>::iterator it = analog_recorders.begin();
        it != analog_recorders.end(); it++) {
     analog_recorder_sptr rx = *it;
 
-    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state());
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state()) << cpus << (cpus.empty() ? "" : format_cpu_list(rx->processor_affinity())) << format_recorder_cpu(rx.get());
   }
 
   for (std::vector<analog_recorder_sptr>::iterator it = analog_conv_recorders.begin();
        it != analog_conv_recorders.end(); it++) {
     analog_recorder_sptr rx = *it;
 
-    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state());
+    BOOST_LOG_TRIVIAL(info) << "\t[ " << std::setw(2) << rx->get_num() << " ] " << rx->get_type_string() << "\tState: " << format_state(rx->get_state()) << cpus << (cpus.empty() ? "" : format_cpu_list(rx->processor_affinity())) << format_recorder_cpu(rx.get());
   }
 }
 
@@ -787,31 +1732,29 @@ int Source::sigmf_recorder_count() {
   return sigmf_recorders.size();
 }
 
+// Recorders that haven't been made yet count as available, so priorities
+// work out the same as when they are all made up front
 int Source::get_num_available_digital_recorders() {
-  int num_available_recorders = 0;
-
-  for (std::vector<p25_recorder_sptr>::iterator it = digital_recorders.begin();
-       it != digital_recorders.end(); it++) {
-    p25_recorder_sptr rx = *it;
-
-    if (rx->get_state() == AVAILABLE) {
-      num_available_recorders++;
-    }
-  }
-  return num_available_recorders;
+  return digital_pool.available() + std::max(0, max_digital_recorders - made_recorder_count(P25));
 }
 
 int Source::get_num_available_analog_recorders() {
-  int num_available_recorders = 0;
-
-  for (std::vector<analog_recorder_sptr>::iterator it = analog_recorders.begin(); it != analog_recorders.end(); it++) {
-    analog_recorder_sptr rx = *it;
+  return analog_pool.available() + std::max(0, max_analog_recorders - made_recorder_count(ANALOG));
+}
 
-    if (rx->get_state() == AVAILABLE) {
-      num_available_recorders++;
-    }
+// How busy this Source's flowgraph is, from 0 to 1. Each active recorder
+// is a chunk of DSP on the scheduler's threads, so the share of trunking
+// recorders in use stands in for CPU load, and a Source that overflowed in
+// the last stats window is already saturated.
+double Source::get_load() {
+  if (stats_window_overflows > 0) {
+    return 1.0;
+  }
+  int total = std::max(max_analog_recorders, made_recorder_count(ANALOG)) + std::max(max_digital_recorders, made_recorder_count(P25)) + external_recorders.size();
+  if (total == 0) {
+    return 0;
   }
-  return num_available_recorders;
+  return 1.0 - (double)(get_num_available_analog_recorders() + get_num_available_digital_recorders()) / total;
 }
 
 std::vector<Recorder *> Source::get_recorders() {
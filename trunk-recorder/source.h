@@ -1,20 +1,31 @@
 #ifndef SOURCE_H
 #define SOURCE_H
 #include "./global_structs.h"
+#include "./gr_blocks/fft_channelizer.h"
 #include "./gr_blocks/selector.h"
 #include "./gr_blocks/signal_detector_cvf.h"
+#include "./gr_blocks/subband_tiler.h"
 #include "./autotune.h"
+#include "./recorder_pool.h"
 #include "recorders/analog_recorder.h"
 #include "recorders/debug_recorder.h"
 #include "recorders/dmr_recorder.h"
 #include "recorders/p25_recorder.h"
 #include "recorders/sigmf_recorder.h"
+#include "sources/idle_source.h"
 #include "sources/iq_file_source.h"
+#include "sources/sc16_source.h"
+#include "sources/shm_iq_sink.h"
+#include "sources/shm_iq_source.h"
+#include <boost/property_tree/ptree.hpp>
 #include <gnuradio/basic_block.h>
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/filter/pfb_channelizer_ccf.h>
 #include <gnuradio/top_block.h>
 #include <gnuradio/uhd/usrp_source.h>
 #include <iostream>
 #include <numeric>
+#include <set>
 #include <osmosdr/source.h>
 
 #include <json.hpp>
@@ -50,11 +61,50 @@ class Source {
   int max_debug_recorders;
   int max_sigmf_recorders;
   int max_analog_recorders;
+  // Trunking recorders made up front, the rest are made as the free ones
+  // drop below recorder_low_watermark; -1 makes them all up front
+  int warm_digital_recorders;
+  int warm_analog_recorders;
+  int recorder_low_watermark;
+  int pending_digital_recorders; // asked of the Recorder_Builder, not connected yet
+  int pending_analog_recorders;
+  // Trunking recorders taken out of their pool when it was made smaller
+  // at runtime, kept connected and parked so it can grow back without
+  // locking the flowgraph, see set_max_recorders()
+  std::vector<Recorder *> retired_digital_recorders;
+  std::vector<Recorder *> retired_analog_recorders;
+  // Conventional recorders whose channel was removed at runtime. Plugins
+  // may still hold them, so they are kept.
+  std::vector<gr::basic_block_sptr> removed_recorders;
+  gr::top_block_sptr top_block;
   int debug_recorder_port;
   int next_selector_port;
   int silence_frames;
   Config *config;
   bool autotune_source;
+  std::string channelizer_mode;
+  int fft_threads;
+  int analog_fft_threads;
+  int digital_fft_threads;
+  std::vector<int> cpu_affinity;
+
+  // Sample stats, updated once per decode rate check
+  uint64_t stats_samples;
+  uint64_t stats_overflows;
+  uint64_t stats_dropped;
+  double stats_rate;
+  uint64_t preempted_calls;
+  long stats_window_overflows;
+  double pfb_channel_spacing;
+  bool attached_pfb_channelizer;
+  bool attached_fft_channelizer;
+  bool attached_subband_tiler;
+  double tile_width;
+  std::string shm_ring;
+  int shm_ring_blocks;
+  double iq_ring_seconds;
+  bool low_latency;
+  bool attached_shm_sink;
 
   std::vector<p25_recorder_sptr> digital_recorders;
   std::vector<p25_recorder_sptr> digital_conv_recorders;
@@ -64,26 +114,76 @@ class Source {
   std::vector<analog_recorder_sptr> analog_recorders;
   std::vector<analog_recorder_sptr> analog_conv_recorders;
   std::vector<dmr_recorder_sptr> dmr_conv_recorders;
+  // conventional recorders waiting for a detected signal, by the frequency
+  // they are on, see enable_armed_recorders()
+  std::vector<std::pair<double, Recorder *>> armed_recorders;
+  std::vector<Recorder *> external_recorders; // trunking recorders not made by this Source, see add_external_recorder()
+  Recorder_Pool analog_pool;
+  Recorder_Pool digital_pool;
   std::vector<Gain_Stage_t> gain_stages;
   std::string driver;
   std::string device;
   std::string antenna;
-  gr::basic_block_sptr source_block;
+  gr::basic_block_sptr source_block; // where the complex float samples come out
+  gr::basic_block_sptr device_block; // the SDR itself, for tuning and gain
+  std::string wire_format;           // kept from the constructor for open_device()
+  std::string host_format;
+  int host_decimation;
+  double device_rate;
+  // every input source_block feeds, so reopen() can move them
+  std::vector<std::pair<gr::basic_block_sptr, int>> outputs;
+  idle_source::sptr idle_block; // in place of source_block while it is reopened
   gr::blocks::selector::sptr recorder_selector;
   signal_detector_cvf::sptr signal_detector;
+  shm_iq_sink::sptr shm_sink;
+
+  // "pfb" channelizer: P25 recorders hang off one output each of a polyphase
+  // filterbank instead of each filtering the full source rate. Their
+  // selector ports are numbered from pfb_port_base so they never collide
+  // with the selector's own outputs.
+  static const unsigned int pfb_port_base = 0x10000;
+  static int next_recorder_core; // round robin for recorderThreadModel "recorder", over every Source
+  gr::filter::pfb_channelizer_ccf::sptr pfb_channelizer;
+  std::vector<int> pfb_channel_map;
+  // "fft" channelizer: the same, but the recorders hang off a filterbank
+  // that only works out the channels that are in use
+  fft_channelizer_ccc_sptr fft_channelizer;
+  // "tile" channelizer: the recorders each read a sub-band, about
+  // tile_width wide, that is shared with the others on channels near it
+  subband_tiler_ccc_sptr subband_tiler;
+  int tile_decimation();
 
   void add_gain_stage(std::string stage_name, double value);
+  void open_device();
+  void move_outputs(gr::top_block_sptr tb, gr::basic_block_sptr from, gr::basic_block_sptr to);
+  void enable_armed_recorders(Detected_Signal signal);
+  void check_recorder_watermark(Recorder_Type type);
+  Recorder *build_recorder_now(Recorder_Type type);
+  int made_recorder_count(Recorder_Type type);
+  void return_to_pool(Recorder *recorder);
 
 public:
   int get_num();
   Config *get_config();
-  Source(double c, double r, double e, std::string driver, std::string device, Config *cfg);
-  Source(std::string sigmf_meta, std::string sigmf_data, bool repeat, Config *cfg);
-  Source(std::string iq_file, bool repeat, double center, double rate, Config *cfg);
-  void set_iq_source(std::string iq_file, bool repeat, double center, double rate);
+  Source(double c, double r, double e, std::string driver, std::string device, std::string wire_format, std::string host_format, int host_decimation, Config *cfg);
+  Source(std::string sigmf_meta, std::string sigmf_data, bool repeat, double speed, Replay_Lockstep::sptr lockstep, Config *cfg);
+  Source(std::string iq_file, bool repeat, double center, double rate, double speed, Replay_Lockstep::sptr lockstep, Config *cfg);
+  void set_iq_source(std::string iq_file, bool repeat, double center, double rate, double speed, mmap_iq_source::Datatype datatype, Replay_Lockstep::sptr lockstep);
   gr::basic_block_sptr get_src_block();
+  gr::top_block_sptr get_top_block();
+  // Everything reading the Source's samples connects through these
+  void connect_output(gr::top_block_sptr tb, gr::basic_block_sptr block, int port = 0);
+  void disconnect_output(gr::top_block_sptr tb, gr::basic_block_sptr block, int port = 0);
+  bool can_reopen();
+  bool reopen(gr::top_block_sptr tb);
   void attach_detector(gr::top_block_sptr tb);
   void attach_selector(gr::top_block_sptr tb);
+  void attach_pfb_channelizer(gr::top_block_sptr tb);
+  void attach_fft_channelizer(gr::top_block_sptr tb);
+  void attach_subband_tiler(gr::top_block_sptr tb);
+  void attach_shm_sink(gr::top_block_sptr tb);
+  void connect_recorder(gr::top_block_sptr tb, gr::basic_block_sptr log);
+  void connect_digital_recorder(gr::top_block_sptr tb, gr::basic_block_sptr block, Recorder *log);
   double get_min_hz();
   double get_max_hz();
   void set_min_max();
@@ -94,6 +194,15 @@ public:
   double get_center();
   double get_rate();
   bool got_samples();
+  void update_stats(float timeDiff);
+  boost::property_tree::ptree get_stats_current();
+  uint64_t get_stats_samples();
+  uint64_t get_stats_overflows();
+  long get_stats_window_overflows();
+  uint64_t get_stats_dropped();
+  void count_preempted_call();
+  uint64_t get_preempted_calls();
+  double get_stats_rate();
   std::string get_driver();
   std::string get_device();
   void set_antenna(std::string ant);
@@ -102,6 +211,35 @@ public:
   double get_error();
   void set_freq_corr(double p);
 
+  /* -- Channelizer -- */
+  void set_channelizer(std::string mode, double channel_spacing, double tile_width = 1000000);
+  std::string get_channelizer();
+  double get_digital_recorder_rate();
+  double tune_channel(unsigned int port, double offset_amount);
+  void set_channel_enabled(unsigned int port, bool enabled);
+  void set_fft_threads(int all, int analog, int digital);
+  int get_fft_threads();
+  int get_analog_fft_threads();
+  int get_digital_fft_threads();
+
+  /* -- Shared Memory IQ -- */
+  void set_shm_ring(std::string name, int blocks);
+  std::string get_shm_ring();
+  void set_iq_ring_seconds(double seconds);
+  double get_iq_ring_seconds();
+  void set_low_latency(bool enabled);
+  bool get_low_latency();
+  // The recorderBufferItems for a type of recorder, 0 to leave its buffers to GNU Radio
+  int get_recorder_buffer_items(Recorder_Type type);
+
+  /* -- CPU Affinity -- */
+  void set_cpu_affinity(std::vector<int> cores);
+  bool set_numa_node(int node);
+  std::vector<int> get_cpu_affinity();
+  void pin_block(gr::basic_block_sptr block);
+  void pin_recorder(gr::basic_block_sptr recorder);
+  void apply_cpu_affinity();
+
   /* -- Gain -- */
   void set_if_gain(double i);
   double get_if_gain();
@@ -130,18 +268,31 @@ public:
   int analog_recorder_count();
   int get_num_available_analog_recorders();
   int get_num_available_digital_recorders();
+  double get_load();
   void set_signal_detector_threshold(float t);
-  std::vector<Recorder *> find_conventional_recorders_by_freq(Detected_Signal ds);
+  void set_signal_detector_rate(float rate);
   void enable_detected_recorders();
+  void arm_detected_recorder(Recorder *recorder);
+  Recorder *get_shared_slot_recorder(Call *call);
+  void take_recorder(Recorder *recorder);
+  void release_recorder(Recorder *recorder);
+  void set_signal_change_callback(std::function<void()> callback);
   void set_selector_port_enabled(unsigned int port, bool enabled);
   bool is_selector_port_enabled(unsigned int port);
   void create_debug_recorder(gr::top_block_sptr tb, int source_num);
   void create_sigmf_recorders(gr::top_block_sptr tb, int r);
   void create_analog_recorders(gr::top_block_sptr tb, int r);
   void create_digital_recorders(gr::top_block_sptr tb, int r);
+  void add_external_recorder(Recorder *recorder);
+  void set_warm_recorders(int digital, int analog, int low_watermark);
+  void add_built_recorder(gr::top_block_sptr tb, p25_recorder_sptr recorder);
+  void add_built_recorder(gr::top_block_sptr tb, analog_recorder_sptr recorder);
+  void set_max_recorders(Recorder_Type type, int count);
+  int get_max_recorders(Recorder_Type type);
+  void remove_conventional_recorder(gr::top_block_sptr tb, Recorder *recorder);
 
   analog_recorder_sptr create_conventional_recorder(gr::top_block_sptr tb);
-  analog_recorder_sptr create_conventional_recorder(gr::top_block_sptr tb, float tone_freq);
+  analog_recorder_sptr create_conventional_recorder(gr::top_block_sptr tb, float tone_freq, bool tone_squelch_gate = false);
   sigmf_recorder_sptr create_sigmf_conventional_recorder(gr::top_block_sptr tb);
   p25_recorder_sptr create_digital_conventional_recorder(gr::top_block_sptr tb);
   dmr_recorder_sptr create_dmr_conventional_recorder(gr::top_block_sptr tb);
@@ -150,6 +301,7 @@ public:
   Recorder *get_digital_recorder(Talkgroup *talkgroup, int priority, Call *call);
   Recorder *get_analog_recorder(Call *call);
   Recorder *get_analog_recorder(Talkgroup *talkgroup, int priority, Call *call);
+  bool pre_tune_recorder(Recorder_Type type, double freq, const std::set<long> &wanted);
   Recorder *get_debug_recorder();
   Recorder *get_sigmf_recorder();
   std::vector<Recorder *> get_recorders();
@@ -0,0 +1,20 @@
+#include "idle_source.h"
+
+#include <boost/thread/thread.hpp>
+
+idle_source::sptr idle_source::make(size_t item_size) {
+  return gnuradio::get_initial_sptr(new idle_source(item_size));
+}
+
+idle_source::idle_source(size_t item_size)
+    : gr::sync_block("idle_source",
+                     gr::io_signature::make(0, 0, 0),
+                     gr::io_signature::make(1, 1, item_size)) {
+}
+
+int idle_source::work(int noutput_items,
+                      gr_vector_const_void_star &input_items,
+                      gr_vector_void_star &output_items) {
+  boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+  return 0;
+}
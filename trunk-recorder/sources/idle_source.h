@@ -0,0 +1,28 @@
+#ifndef IDLE_SOURCE_H
+#define IDLE_SOURCE_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+// A source that never has any samples. While a Source's SDR is being
+// opened again, everything that read from it reads from one of these, so
+// the flowgraph stays whole and the blocks downstream just wait, without
+// seeing the end of their stream or spinning on zeros.
+
+class idle_source : public gr::sync_block {
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<idle_source> sptr;
+#else
+  typedef std::shared_ptr<idle_source> sptr;
+#endif
+  static sptr make(size_t item_size);
+
+  idle_source(size_t item_size);
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
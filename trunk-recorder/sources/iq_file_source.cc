@@ -1,24 +1,40 @@
 #include "iq_file_source.h"
+#include "../replay_clock.h"
+
+#include <boost/log/trivial.hpp>
 
 
 iq_file_source::sptr
-iq_file_source::make(std::string filename,  double rate, bool repeat=false) {
-  return gnuradio::get_initial_sptr(new iq_file_source(filename, rate, repeat));
+iq_file_source::make(std::string filename,  double rate, bool repeat, double speed, mmap_iq_source::Datatype datatype, Replay_Lockstep::sptr lockstep) {
+  return gnuradio::get_initial_sptr(new iq_file_source(filename, rate, repeat, speed, datatype, lockstep));
 }
 
-iq_file_source::iq_file_source(std::string filename,  double rate, bool repeat=false)
+iq_file_source::iq_file_source(std::string filename,  double rate, bool repeat, double speed, mmap_iq_source::Datatype datatype, Replay_Lockstep::sptr lockstep)
     : gr::hier_block2("iq_file_source",
                  gr::io_signature::make(0, 0, 0),
                  gr::io_signature::make(1, 1, sizeof(gr_complex))),
       d_filename(filename),
       d_rate(rate),
-      d_repeat(repeat) {
-
-    file_source = gr::blocks::file_source::make(sizeof(gr_complex), filename.c_str(), repeat);
-    throttle = gr::blocks::throttle::make(sizeof(gr_complex), rate);
-    connect(file_source, 0, throttle, 0);
-    connect(throttle, 0, self(), 0);
-}
+      d_repeat(repeat),
+      d_speed(speed) {
 
+    if ((speed == 1.0) && (datatype == mmap_iq_source::CF32) && !lockstep) {
+      file_source = gr::blocks::file_source::make(sizeof(gr_complex), filename.c_str(), repeat);
+      throttle = gr::blocks::throttle::make(sizeof(gr_complex), rate);
+      connect(file_source, 0, throttle, 0);
+      connect(throttle, 0, self(), 0);
+      return;
+    }
 
-  
\ No newline at end of file
+    bool clock = (speed != 1.0) && Replay_Clock::start(rate);
+    mmap_source = mmap_iq_source::make(filename, datatype, rate, repeat, clock, lockstep);
+    if (speed > 0) {
+      BOOST_LOG_TRIVIAL(info) << "Replaying " << filename << " at " << speed << "x real time";
+      throttle = gr::blocks::throttle::make(sizeof(gr_complex), rate * speed);
+      connect(mmap_source, 0, throttle, 0);
+      connect(throttle, 0, self(), 0);
+    } else {
+      BOOST_LOG_TRIVIAL(info) << "Replaying " << filename << " as fast as it can be decoded";
+      connect(mmap_source, 0, self(), 0);
+    }
+}
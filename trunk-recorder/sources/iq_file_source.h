@@ -5,7 +5,14 @@
 #include <gnuradio/blocks/throttle.h>
 #include <gnuradio/hier_block2.h>
 
+#include "mmap_iq_source.h"
 
+// Plays an IQ file at the rate it was recorded at, or, with a speed other
+// than 1, that many times faster, or with a speed of 0 as fast as the
+// flowgraph can take it. Replaying faster reads the file with an
+// mmap_iq_source and has the call timing follow the samples, see
+// Replay_Clock. Files that aren't cf32, or that are replayed in lockstep
+// with others, are read with one at any speed.
 
 class iq_file_source : public gr::hier_block2 {
     private:
@@ -13,7 +20,9 @@ class iq_file_source : public gr::hier_block2 {
   std::string d_filename;
     double d_rate;
     bool d_repeat;
+    double d_speed;
     gr::blocks::file_source::sptr file_source;
+    mmap_iq_source::sptr mmap_source;
     gr::blocks::throttle::sptr throttle;
 
 public:
@@ -22,10 +31,10 @@ public:
 #else
   typedef std::shared_ptr<iq_file_source> sptr;
 #endif
-  static sptr make(std::string filename,  double rate, bool repeat);
+  static sptr make(std::string filename,  double rate, bool repeat, double speed = 1.0, mmap_iq_source::Datatype datatype = mmap_iq_source::CF32, Replay_Lockstep::sptr lockstep = Replay_Lockstep::sptr());
          
 
-  iq_file_source(std::string filename,  double rate, bool repeat);
+  iq_file_source(std::string filename,  double rate, bool repeat, double speed, mmap_iq_source::Datatype datatype, Replay_Lockstep::sptr lockstep);
 
 
 
@@ -34,4 +43,4 @@ public:
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,153 @@
+#include "mmap_iq_source.h"
+#include "../replay_clock.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <volk/volk.h>
+
+// Samples in the output buffer, a 2 MB read at a time of cf32
+static const int mmap_buffer_samples = 262144;
+
+bool mmap_iq_source::parse_datatype(std::string name, Datatype &datatype) {
+  if ((name == "cf32_le") || (name == "cf32")) {
+    datatype = CF32;
+  } else if ((name == "ci16_le") || (name == "ci16")) {
+    datatype = CI16;
+  } else if (name == "ci8") {
+    datatype = CI8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+size_t mmap_iq_source::sample_size(Datatype datatype) {
+  switch (datatype) {
+  case CI16:
+    return 2 * sizeof(int16_t);
+  case CI8:
+    return 2 * sizeof(int8_t);
+  default:
+    return sizeof(gr_complex);
+  }
+}
+
+mmap_iq_source::sptr mmap_iq_source::make(std::string filename, Datatype datatype, double rate, bool repeat, bool clock, Replay_Lockstep::sptr lockstep) {
+  return gnuradio::get_initial_sptr(new mmap_iq_source(filename, datatype, rate, repeat, clock, lockstep));
+}
+
+mmap_iq_source::mmap_iq_source(std::string filename, Datatype datatype, double rate, bool repeat, bool clock, Replay_Lockstep::sptr lockstep)
+    : gr::sync_block("mmap_iq_source",
+                     gr::io_signature::make(0, 0, 0),
+                     gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_filename(filename),
+      d_datatype(datatype),
+      d_repeat(repeat),
+      d_clock(clock),
+      d_lockstep(lockstep),
+      d_member(-1),
+      d_data(NULL),
+      d_sample_size(sample_size(datatype)),
+      d_count(0),
+      d_next(0),
+      d_size(0) {
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("mmap_iq_source: can't open " + filename + ": " + strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("mmap_iq_source: can't stat " + filename + ": " + strerror(errno));
+  }
+  d_count = st.st_size / d_sample_size;
+  if (d_count == 0) {
+    close(fd);
+    throw std::runtime_error("mmap_iq_source: " + filename + " has no samples in it");
+  }
+  d_size = d_count * d_sample_size;
+  void *mem = mmap(NULL, d_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    throw std::runtime_error("mmap_iq_source: can't map " + filename + ": " + strerror(errno));
+  }
+  madvise(mem, d_size, MADV_SEQUENTIAL);
+  d_data = (const char *)mem;
+
+  if (d_lockstep) {
+    d_member = d_lockstep->join(rate);
+  }
+
+  set_min_output_buffer(mmap_buffer_samples);
+  BOOST_LOG_TRIVIAL(info) << "Mapped IQ file " << filename << ", " << d_count << " samples of " << (datatype == CI16 ? "ci16" : (datatype == CI8 ? "ci8" : "cf32"));
+}
+
+mmap_iq_source::~mmap_iq_source() {
+  if (d_data) {
+    munmap((void *)d_data, d_size);
+  }
+}
+
+void mmap_iq_source::convert(gr_complex *out, size_t first, size_t n) {
+  const char *in = d_data + first * d_sample_size;
+  switch (d_datatype) {
+  case CI16:
+    volk_16i_s32f_convert_32f((float *)out, (const int16_t *)in, 32768.0f, 2 * n);
+    break;
+  case CI8:
+    volk_8i_s32f_convert_32f((float *)out, (const int8_t *)in, 128.0f, 2 * n);
+    break;
+  default:
+    memcpy(out, in, n * sizeof(gr_complex));
+  }
+}
+
+int mmap_iq_source::work(int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items) {
+  gr_complex *out = (gr_complex *)output_items[0];
+  int produced = 0;
+
+  if (d_lockstep && !d_lockstep->wait_turn(d_member)) {
+    return 0;
+  }
+
+  while (produced < noutput_items) {
+    if (d_next == d_count) {
+      if (!d_repeat) {
+        break;
+      }
+      d_next = 0;
+    }
+    size_t n = std::min((size_t)(noutput_items - produced), d_count - d_next);
+    convert(out + produced, d_next, n);
+    d_next += n;
+    produced += n;
+  }
+
+  if (d_clock) {
+    Replay_Clock::advance(produced);
+  }
+  if (produced == 0) {
+    if (d_clock) {
+      Replay_Clock::finish();
+    }
+    if (d_lockstep) {
+      d_lockstep->leave(d_member);
+    }
+    BOOST_LOG_TRIVIAL(info) << "End of IQ file " << d_filename;
+    return WORK_DONE;
+  }
+  if (d_lockstep) {
+    d_lockstep->advance(d_member, produced);
+  }
+  return produced;
+}
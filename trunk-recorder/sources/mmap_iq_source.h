@@ -0,0 +1,61 @@
+#ifndef MMAP_IQ_SOURCE_H
+#define MMAP_IQ_SOURCE_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+#include "replay_lockstep.h"
+
+// Plays an IQ file back out of a read-only mapping of it, for replaying a
+// capture faster than it was recorded or in a format other than cf32. Each
+// call to work() converts as much as the output buffer has room for, which
+// the large buffer it asks for makes a big sequential read, and the kernel
+// is told the file is read straight through so it reads ahead. ci16 and ci8
+// samples are scaled to +/-1 with VOLK as they are copied out.
+//
+// With clock set, the samples put out move the Replay_Clock forward, and
+// the end of the file, when it isn't repeated, finishes it. With a
+// Replay_Lockstep it waits for the other sources in it to catch up.
+
+class mmap_iq_source : public gr::sync_block {
+public:
+  enum Datatype { CF32,
+                  CI16,
+                  CI8 };
+
+  // The SigMF core:datatype names, the little endian ones for ci16 and cf32
+  static bool parse_datatype(std::string name, Datatype &datatype);
+  static size_t sample_size(Datatype datatype);
+
+private:
+  std::string d_filename;
+  Datatype d_datatype;
+  bool d_repeat;
+  bool d_clock;
+  Replay_Lockstep::sptr d_lockstep;
+  int d_member;
+  const char *d_data;
+  size_t d_sample_size;
+  size_t d_count;
+  size_t d_next;
+  size_t d_size;
+
+  void convert(gr_complex *out, size_t first, size_t n);
+
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<mmap_iq_source> sptr;
+#else
+  typedef std::shared_ptr<mmap_iq_source> sptr;
+#endif
+  static sptr make(std::string filename, Datatype datatype, double rate, bool repeat, bool clock, Replay_Lockstep::sptr lockstep = Replay_Lockstep::sptr());
+
+  mmap_iq_source(std::string filename, Datatype datatype, double rate, bool repeat, bool clock, Replay_Lockstep::sptr lockstep);
+  ~mmap_iq_source();
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
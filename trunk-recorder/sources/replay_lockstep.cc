@@ -0,0 +1,44 @@
+#include "replay_lockstep.h"
+
+#include <chrono>
+
+const double Replay_Lockstep::window_seconds = 0.25;
+
+int Replay_Lockstep::join(double rate) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Member member = {rate, 0, true};
+  members.push_back(member);
+  return members.size() - 1;
+}
+
+// Called with the mutex held
+bool Replay_Lockstep::behind_window(int member) const {
+  double mine = seconds(members[member]);
+  for (size_t i = 0; i < members.size(); i++) {
+    if (members[i].active && (seconds(members[i]) + window_seconds < mine)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Replay_Lockstep::wait_turn(int member) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return moved.wait_for(lock, std::chrono::milliseconds(wait_ms), [this, member]() { return behind_window(member); });
+}
+
+void Replay_Lockstep::advance(int member, uint64_t samples) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    members[member].samples += samples;
+  }
+  moved.notify_all();
+}
+
+void Replay_Lockstep::leave(int member) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    members[member].active = false;
+  }
+  moved.notify_all();
+}
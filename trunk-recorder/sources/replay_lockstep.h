@@ -0,0 +1,53 @@
+#ifndef REPLAY_LOCKSTEP_H
+#define REPLAY_LOCKSTEP_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Replay_Lockstep
+ *   Keeps the file sources replaying the captures of a multi-SDR site at
+ *   the same point in the capture, so a grant decoded from one SDR's
+ *   control channel finds the voice channel on another SDR where it was
+ *   when the captures were made.
+ *
+ * Each source joins with its sample rate and says how many samples it
+ * has put out. One that has got more than window_seconds of capture
+ * ahead of the one furthest behind waits for it, for up to wait_ms, and
+ * puts nothing out if it is still ahead. A source at the end of its file
+ * leaves, so the others don't wait on it. Replayed in real time the
+ * throttles keep them together anyway; as fast as they can be decoded the
+ * SDR with the most going on sets the pace for all of them.
+ */
+class Replay_Lockstep {
+public:
+  typedef std::shared_ptr<Replay_Lockstep> sptr;
+
+  static const double window_seconds;
+  static const int wait_ms = 100;
+
+  int join(double rate);
+  // False if the member is still ahead after waiting
+  bool wait_turn(int member);
+  void advance(int member, uint64_t samples);
+  void leave(int member);
+
+private:
+  struct Member {
+    double rate;
+    uint64_t samples;
+    bool active;
+  };
+
+  double seconds(const Member &member) const { return member.samples / member.rate; }
+  bool behind_window(int member) const;
+
+  std::mutex mutex;
+  std::condition_variable moved;
+  std::vector<Member> members;
+};
+
+#endif // REPLAY_LOCKSTEP_H
@@ -0,0 +1,15 @@
+#include "sc16_source.h"
+
+sc16_source::sptr sc16_source::make(gr::basic_block_sptr device, int decimation, double rate) {
+  return gnuradio::get_initial_sptr(new sc16_source(device, decimation, rate));
+}
+
+sc16_source::sc16_source(gr::basic_block_sptr device, int decimation, double rate)
+    : gr::hier_block2("sc16_source",
+                      gr::io_signature::make(0, 0, 0),
+                      gr::io_signature::make(1, 1, sizeof(gr_complex))) {
+
+  decimator = make_sc16_decimator(decimation, rate);
+  connect(device, 0, decimator, 0);
+  connect(decimator, 0, self(), 0);
+}
@@ -0,0 +1,27 @@
+#ifndef SC16_SOURCE_H
+#define SC16_SOURCE_H
+
+#include <gnuradio/hier_block2.h>
+
+#include "../gr_blocks/sc16_decimator.h"
+
+// Wraps an SDR block that puts out complex int16 samples, so the rest of a
+// Source still sees complex float: the samples go through an sc16_decimator
+// before anything else reads them.
+
+class sc16_source : public gr::hier_block2 {
+private:
+  sc16_decimator_sptr decimator;
+
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<sc16_source> sptr;
+#else
+  typedef std::shared_ptr<sc16_source> sptr;
+#endif
+  static sptr make(gr::basic_block_sptr device, int decimation, double rate);
+
+  sc16_source(gr::basic_block_sptr device, int decimation, double rate);
+};
+
+#endif
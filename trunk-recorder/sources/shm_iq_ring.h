@@ -0,0 +1,61 @@
+#ifndef SHM_IQ_RING_H
+#define SHM_IQ_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <gnuradio/gr_complex.h>
+
+// Layout of the shared-memory ring a Source's IQ stream is published through.
+//
+// One process, the producer, writes; any number of other processes read it
+// without ever writing to it, so a slow or stopped reader can't hold up the
+// producer or the other readers. The ring is a header followed by
+// block_count fixed-size blocks, each starting on a cache line.
+//
+// Every block carries a sequence number that works as a seqlock: it is
+// 2n + 1 while block n is being written and 2n + 2 once it is complete. A
+// reader copies a block out and then checks the number hasn't moved; if it
+// has, the producer lapped it and it skips ahead to the newest block.
+
+#define SHM_IQ_RING_MAGIC 0x51495254 // "TRIQ"
+#define SHM_IQ_RING_VERSION 1
+#define SHM_IQ_RING_BLOCK_SAMPLES 4096
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the IQ ring needs lock-free 64 bit atomics to be shared between processes");
+
+struct alignas(64) shm_iq_ring_header {
+  uint32_t magic; // written last, once the rest of the ring is set up
+  uint32_t version;
+  uint32_t block_samples;
+  uint32_t block_count;
+  uint64_t session; // changes every time a producer creates the ring
+  double rate;
+  double center;
+  alignas(64) std::atomic<uint64_t> write_seq; // number of complete blocks
+};
+
+struct alignas(64) shm_iq_block_header {
+  std::atomic<uint64_t> seq;
+  uint64_t first_sample; // index of the block's first sample in the stream
+};
+
+inline size_t shm_iq_ring_block_stride(uint32_t block_samples) {
+  return sizeof(shm_iq_block_header) + (size_t)block_samples * sizeof(gr_complex);
+}
+
+inline size_t shm_iq_ring_size(uint32_t block_samples, uint32_t block_count) {
+  return sizeof(shm_iq_ring_header) + shm_iq_ring_block_stride(block_samples) * block_count;
+}
+
+inline shm_iq_block_header *shm_iq_ring_block(shm_iq_ring_header *ring, uint64_t n) {
+  char *base = (char *)ring + sizeof(shm_iq_ring_header);
+  return (shm_iq_block_header *)(base + shm_iq_ring_block_stride(ring->block_samples) * (n % ring->block_count));
+}
+
+inline gr_complex *shm_iq_block_samples(shm_iq_block_header *block) {
+  return (gr_complex *)(block + 1);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "shm_iq_sink.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+shm_iq_sink::sptr shm_iq_sink::make(std::string name, double rate, double center, int block_count) {
+  return gnuradio::get_initial_sptr(new shm_iq_sink(name, rate, center, block_count));
+}
+
+shm_iq_sink::shm_iq_sink(std::string name, double rate, double center, int block_count)
+    : gr::sync_block("shm_iq_sink",
+                     gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                     gr::io_signature::make(0, 0, 0)),
+      d_name(name),
+      d_fd(-1),
+      d_size(0),
+      d_ring(NULL),
+      d_seq(0),
+      d_fill(0),
+      d_samples(0) {
+
+  if (block_count < 2) {
+    block_count = 2;
+  }
+  d_size = shm_iq_ring_size(SHM_IQ_RING_BLOCK_SAMPLES, block_count);
+
+  // Start from a fresh object: readers of one left behind by an earlier
+  // producer keep their mapping until they notice it has gone quiet
+  shm_unlink(d_name.c_str());
+  d_fd = shm_open(d_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if ((d_fd < 0) || (ftruncate(d_fd, d_size) != 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to create shared memory IQ ring " << d_name << ": " << strerror(errno);
+    return;
+  }
+
+  void *mem = mmap(NULL, d_size, PROT_READ | PROT_WRITE, MAP_SHARED, d_fd, 0);
+  if (mem == MAP_FAILED) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to map shared memory IQ ring " << d_name << ": " << strerror(errno);
+    close(d_fd);
+    d_fd = -1;
+    return;
+  }
+  d_ring = (shm_iq_ring_header *)mem;
+
+  d_ring->version = SHM_IQ_RING_VERSION;
+  d_ring->block_samples = SHM_IQ_RING_BLOCK_SAMPLES;
+  d_ring->block_count = block_count;
+  d_ring->session = std::chrono::steady_clock::now().time_since_epoch().count() ^ ((uint64_t)getpid() << 32);
+  d_ring->rate = rate;
+  d_ring->center = center;
+  d_ring->write_seq.store(0, std::memory_order_relaxed);
+  for (int i = 0; i < block_count; i++) {
+    shm_iq_ring_block(d_ring, i)->seq.store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic_thread_fence(std::memory_order_release);
+  d_ring->magic = SHM_IQ_RING_MAGIC;
+
+  BOOST_LOG_TRIVIAL(info) << "Publishing IQ to shared memory ring " << d_name << " - " << block_count << " blocks of " << SHM_IQ_RING_BLOCK_SAMPLES << " samples";
+}
+
+shm_iq_sink::~shm_iq_sink() {
+  if (d_ring) {
+    d_ring->magic = 0;
+    munmap(d_ring, d_size);
+    shm_unlink(d_name.c_str());
+  }
+  if (d_fd >= 0) {
+    close(d_fd);
+  }
+}
+
+int shm_iq_sink::work(int noutput_items,
+                      gr_vector_const_void_star &input_items,
+                      gr_vector_void_star &output_items) {
+  const gr_complex *in = (const gr_complex *)input_items[0];
+
+  if (!d_ring) {
+    return noutput_items;
+  }
+
+  int done = 0;
+  while (done < noutput_items) {
+    shm_iq_block_header *block = shm_iq_ring_block(d_ring, d_seq);
+
+    if (d_fill == 0) {
+      block->seq.store(2 * d_seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      block->first_sample = d_samples;
+    }
+
+    uint32_t n = std::min((uint32_t)(noutput_items - done), d_ring->block_samples - d_fill);
+    memcpy(shm_iq_block_samples(block) + d_fill, in + done, n * sizeof(gr_complex));
+    d_fill += n;
+    d_samples += n;
+    done += n;
+
+    if (d_fill == d_ring->block_samples) {
+      block->seq.store(2 * d_seq + 2, std::memory_order_release);
+      d_seq++;
+      d_ring->write_seq.store(d_seq, std::memory_order_release);
+      d_fill = 0;
+    }
+  }
+
+  return noutput_items;
+}
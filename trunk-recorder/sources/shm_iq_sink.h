@@ -0,0 +1,40 @@
+#ifndef SHM_IQ_SINK_H
+#define SHM_IQ_SINK_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+#include "shm_iq_ring.h"
+
+// Publishes a Source's samples into a shared-memory ring, see shm_iq_ring.h,
+// so trunk-recorder instances using the "shm" driver can share the SDR.
+// The samples are copied once, straight from the flowgraph's buffer into
+// the ring, and the producer never waits for the readers.
+
+class shm_iq_sink : public gr::sync_block {
+private:
+  std::string d_name;
+  int d_fd;
+  size_t d_size;
+  shm_iq_ring_header *d_ring;
+  uint64_t d_seq;      // block currently being filled
+  uint32_t d_fill;     // samples already in it
+  uint64_t d_samples;  // samples written since the ring was created
+
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<shm_iq_sink> sptr;
+#else
+  typedef std::shared_ptr<shm_iq_sink> sptr;
+#endif
+  static sptr make(std::string name, double rate, double center, int block_count);
+
+  shm_iq_sink(std::string name, double rate, double center, int block_count);
+  ~shm_iq_sink();
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "shm_iq_source.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <boost/thread/thread.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// How long work() waits for the producer before returning empty handed, and
+// how long the ring can go quiet before it is opened again
+static const long shm_wait_ms = 100;
+static const long shm_reopen_ms = 1000;
+
+shm_iq_source::sptr shm_iq_source::make(std::string name, double rate, double center) {
+  return gnuradio::get_initial_sptr(new shm_iq_source(name, rate, center));
+}
+
+shm_iq_source::shm_iq_source(std::string name, double rate, double center)
+    : gr::sync_block("shm_iq_source",
+                     gr::io_signature::make(0, 0, 0),
+                     gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      d_name(name),
+      d_rate(rate),
+      d_center(center),
+      d_size(0),
+      d_ring(NULL),
+      d_session(0),
+      d_next(0),
+      d_offset(0),
+      d_tag_pending(true),
+      d_idle_ms(0),
+      d_overruns(0),
+      d_logged_session(0),
+      d_logged_stop(false) {
+
+  d_rx_time_key = pmt::intern("rx_time");
+  set_output_multiple(SHM_IQ_RING_BLOCK_SAMPLES);
+
+  if (!open_ring()) {
+    BOOST_LOG_TRIVIAL(info) << "Shared memory IQ ring " << d_name << " isn't available yet, waiting for it to be published";
+  }
+}
+
+shm_iq_source::~shm_iq_source() {
+  close_ring();
+}
+
+bool shm_iq_source::open_ring() {
+  int fd = shm_open(d_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  void *mem = MAP_FAILED;
+  if ((fstat(fd, &st) == 0) && ((size_t)st.st_size >= sizeof(shm_iq_ring_header))) {
+    mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+
+  shm_iq_ring_header *ring = (shm_iq_ring_header *)mem;
+  bool ready = ring->magic == SHM_IQ_RING_MAGIC;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!ready || (ring->version != SHM_IQ_RING_VERSION) || (ring->block_samples != SHM_IQ_RING_BLOCK_SAMPLES) || ((size_t)st.st_size < shm_iq_ring_size(ring->block_samples, ring->block_count))) {
+    munmap(mem, st.st_size);
+    return false;
+  }
+
+  bool fresh = ring->session != d_logged_session;
+  if ((ring->rate != d_rate) || (ring->center != d_center)) {
+    if (fresh) {
+      BOOST_LOG_TRIVIAL(error) << "Shared memory IQ ring " << d_name << " is publishing Rate: " << ring->rate << " Center: " << ring->center << " but this Source is set to Rate: " << d_rate << " Center: " << d_center;
+    } else {
+      BOOST_LOG_TRIVIAL(debug) << "Shared memory IQ ring " << d_name << " is still publishing Rate: " << ring->rate << " Center: " << ring->center;
+    }
+  }
+
+  d_ring = ring;
+  d_size = st.st_size;
+  d_session = ring->session;
+  d_idle_ms = 0;
+  resync();
+  if (fresh) {
+    BOOST_LOG_TRIVIAL(info) << "Reading IQ from shared memory ring " << d_name << " - " << d_ring->block_count << " blocks of " << d_ring->block_samples << " samples";
+    d_logged_session = d_session;
+    d_logged_stop = false;
+  } else {
+    BOOST_LOG_TRIVIAL(debug) << "Reading IQ from shared memory ring " << d_name << " again";
+  }
+  return true;
+}
+
+void shm_iq_source::close_ring() {
+  if (d_ring) {
+    munmap(d_ring, d_size);
+    d_ring = NULL;
+  }
+}
+
+void shm_iq_source::resync() {
+  // Pick up at the newest complete block
+  uint64_t written = d_ring->write_seq.load(std::memory_order_acquire);
+  d_next = written ? written - 1 : 0;
+  d_offset = 0;
+  d_tag_pending = true;
+}
+
+int shm_iq_source::work(int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items) {
+  gr_complex *out = (gr_complex *)output_items[0];
+  int produced = 0;
+  long waited_ms = 0;
+
+  while (produced == 0) {
+    if (!d_ring) {
+      if (!open_ring()) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(shm_reopen_ms));
+        return 0;
+      }
+    }
+
+    while (produced < noutput_items) {
+      uint64_t written = d_ring->write_seq.load(std::memory_order_acquire);
+      if (d_next >= written) {
+        break;
+      }
+
+      // The producer may already be writing into the slot after the last
+      // complete one, so anything a whole ring behind is gone
+      if (written - d_next >= d_ring->block_count) {
+        d_overruns++;
+        resync();
+        continue;
+      }
+
+      shm_iq_block_header *block = shm_iq_ring_block(d_ring, d_next);
+      uint64_t seq = block->seq.load(std::memory_order_acquire);
+      uint64_t first_sample = block->first_sample;
+      uint32_t n = std::min((uint32_t)(noutput_items - produced), d_ring->block_samples - d_offset);
+      memcpy(out + produced, shm_iq_block_samples(block) + d_offset, n * sizeof(gr_complex));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if ((seq != 2 * d_next + 2) || (block->seq.load(std::memory_order_relaxed) != seq)) {
+        d_overruns++;
+        resync();
+        continue;
+      }
+
+      if (d_tag_pending) {
+        double t = (first_sample + d_offset) / d_ring->rate;
+        double secs = floor(t);
+        add_item_tag(0, nitems_written(0) + produced, d_rx_time_key, pmt::make_tuple(pmt::from_uint64((uint64_t)secs), pmt::from_double(t - secs)));
+        d_tag_pending = false;
+      }
+
+      produced += n;
+      d_offset += n;
+      if (d_offset == d_ring->block_samples) {
+        d_offset = 0;
+        d_next++;
+      }
+    }
+
+    if (produced == 0) {
+      if ((d_ring->magic != SHM_IQ_RING_MAGIC) || (d_ring->session != d_session) || (d_idle_ms >= shm_reopen_ms)) {
+        if (!d_logged_stop) {
+          BOOST_LOG_TRIVIAL(info) << "Shared memory IQ ring " << d_name << " stopped, opening it again";
+          d_logged_stop = true;
+        } else {
+          BOOST_LOG_TRIVIAL(debug) << "Shared memory IQ ring " << d_name << " still stopped, opening it again";
+        }
+        close_ring();
+        continue;
+      }
+      if (waited_ms >= shm_wait_ms) {
+        return 0;
+      }
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      waited_ms++;
+      d_idle_ms++;
+    }
+  }
+
+  d_idle_ms = 0;
+  return produced;
+}
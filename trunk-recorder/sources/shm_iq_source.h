@@ -0,0 +1,59 @@
+#ifndef SHM_IQ_SOURCE_H
+#define SHM_IQ_SOURCE_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <pmt/pmt.h>
+
+#include "shm_iq_ring.h"
+
+// Reads the samples another trunk-recorder publishes with shm_iq_sink. The
+// ring is mapped read-only; if the producer isn't running yet, or restarts,
+// the ring is opened again once it shows up. A ring a dead producer left
+// behind is opened again every second, so it is only logged at info or
+// error the first time, and at debug until a producer starts a new one.
+//
+// Samples lost because this reader fell more than a ring behind are skipped,
+// and the first sample after the gap gets an rx_time tag the way UHD marks
+// an overflow, so they show up in the Source's overflow stats.
+
+class shm_iq_source : public gr::sync_block {
+private:
+  std::string d_name;
+  double d_rate;
+  double d_center;
+  size_t d_size;
+  shm_iq_ring_header *d_ring;
+  uint64_t d_session;
+  uint64_t d_next;     // next block to read
+  uint32_t d_offset;   // samples already read out of it
+  bool d_tag_pending;
+  long d_idle_ms;
+  long d_overruns;
+  uint64_t d_logged_session; // the session last logged at info, 0 for none
+  bool d_logged_stop;        // and whether it has been logged as stopped
+  pmt::pmt_t d_rx_time_key;
+
+  bool open_ring();
+  void close_ring();
+  void resync();
+
+public:
+#if GNURADIO_VERSION < 0x030900
+  typedef boost::shared_ptr<shm_iq_source> sptr;
+#else
+  typedef std::shared_ptr<shm_iq_source> sptr;
+#endif
+  static sptr make(std::string name, double rate, double center);
+
+  shm_iq_source(std::string name, double rate, double center);
+  ~shm_iq_source();
+
+  long get_overruns() { return d_overruns; }
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "stage_latency.h"
+#include "call_latency.h"
+
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+#include <sstream>
+
+static const char *latency_key = "latency";
+static const char *stage_names[TRACE_STAGE_COUNT] = {"Channelizer", "Demod", "Frame Assembler", "Sink"};
+
+bool Stage_Latency::tracing = false;
+std::mutex Stage_Latency::probes_mutex;
+std::vector<Stage_Latency::Probe> Stage_Latency::probes;
+std::map<std::string, Stage_Latency::Histograms> Stage_Latency::recorder_types;
+
+void Stage_Latency::enable() {
+  tracing = true;
+}
+
+bool Stage_Latency::enabled() {
+  return tracing;
+}
+
+static int stamp_interval(double sample_rate) {
+  int interval = (int)(sample_rate / Stage_Latency::stamps_per_second);
+  return interval > 0 ? interval : 1;
+}
+
+gr::gr_latency::latency_tagger::sptr Stage_Latency::make_tagger(std::size_t item_size, double sample_rate) {
+  return gr::gr_latency::latency_tagger::make(item_size, stamp_interval(sample_rate), latency_key);
+}
+
+gr::gr_latency::latency_tagger::sptr Stage_Latency::make_relay(std::size_t item_size, double sample_rate, gr::gr_latency::latency_probe::sptr origin) {
+  return gr::gr_latency::latency_tagger::make(item_size, stamp_interval(sample_rate), latency_key, origin);
+}
+
+// Recorders can be built on more than one thread
+gr::gr_latency::latency_probe::sptr Stage_Latency::make_probe(std::string recorder_type, Latency_Trace_Stage stage, std::size_t item_size) {
+  Probe probe;
+  probe.recorder_type = recorder_type;
+  probe.stage = stage;
+  probe.probe = gr::gr_latency::latency_probe::make(item_size, std::vector<std::string>(1, latency_key));
+  std::lock_guard<std::mutex> lock(probes_mutex);
+  probes.push_back(probe);
+  return probe.probe;
+}
+
+void Stage_Latency::collect() {
+  std::lock_guard<std::mutex> lock(probes_mutex);
+  for (std::vector<Probe>::iterator it = probes.begin(); it != probes.end(); ++it) {
+    Latency_Histogram &histogram = recorder_types[it->recorder_type].stages[it->stage];
+    std::vector<double> delays = it->probe->take_delays(latency_key);
+    for (std::vector<double>::iterator delay = delays.begin(); delay != delays.end(); ++delay) {
+      histogram.record((std::int64_t)(*delay * 1e6));
+    }
+  }
+}
+
+static std::string format_summary(const Latency_Summary &summary) {
+  if (!summary.count) {
+    return "-";
+  }
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << summary.p50_ms << "/" << summary.p90_ms << "/" << summary.p99_ms << "/" << summary.max_ms;
+  return out.str();
+}
+
+void Stage_Latency::print_stats() {
+  if (!tracing) {
+    return;
+  }
+  collect();
+  if (recorder_types.empty()) {
+    return;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Recorder Stage Latency from the input (p50/p90/p99/max ms): ";
+  for (std::map<std::string, Histograms>::iterator it = recorder_types.begin(); it != recorder_types.end(); ++it) {
+    std::ostringstream line;
+    line << "[" << it->first << "]";
+    for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+      line << "\t" << stage_names[stage] << ": " << format_summary(Call_Latency::summarize(it->second.stages[stage]));
+    }
+    BOOST_LOG_TRIVIAL(info) << line.str();
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef STAGE_LATENCY_H
+#define STAGE_LATENCY_H
+
+#include "latency_histogram.h"
+
+#include "../lib/gr-latency/latency_probe.h"
+#include "../lib/gr-latency/latency_tagger.h"
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum Latency_Trace_Stage {
+  TRACE_CHANNELIZER,
+  TRACE_DEMOD,
+  TRACE_FRAME_ASSEMBLER,
+  TRACE_SINK,
+  TRACE_STAGE_COUNT
+};
+
+/*
+ * Stage_Latency
+ *   With latencyTracing, how long the samples a recorder is given take to
+ *   get through each stage of it, for finding the stage that holds them up
+ *   on their way from the Source to the WAV file.
+ *
+ * A latency_tagger at the input of each recorder stamps a sample 20 times
+ * a second with the time, and latency_probes hanging off the output of the
+ * channelizer, the demod, the frame assembler and the block feeding the
+ * transmission_sink measure how long ago the stamp was made when the
+ * sample gets to them, so each stage's number is from the input to there.
+ * A frame assembler's audio doesn't line up with the symbols it was made
+ * from, the stamps can't go through it: a relay after it stamps the audio
+ * with the last time a probe saw at its input instead, which leaves out
+ * anything it holds on to for longer than that.
+ *
+ * The gr-latency blocks run on the flowgraph threads and keep what they
+ * measure, it is taken off them and added to the histograms of each
+ * recorder type when the status is printed, on the main thread. Stages a
+ * chain doesn't have, or that the stamps don't get through, like tone
+ * squelch, have nothing in them.
+ */
+class Stage_Latency {
+public:
+  static void enable();
+  static bool enabled();
+
+  // How many times a second the taggers and relays stamp their stream
+  static const int stamps_per_second = 20;
+
+  static gr::gr_latency::latency_tagger::sptr make_tagger(std::size_t item_size, double sample_rate);
+  static gr::gr_latency::latency_tagger::sptr make_relay(std::size_t item_size, double sample_rate, gr::gr_latency::latency_probe::sptr origin);
+  static gr::gr_latency::latency_probe::sptr make_probe(std::string recorder_type, Latency_Trace_Stage stage, std::size_t item_size);
+  static void print_stats();
+
+private:
+  struct Probe {
+    std::string recorder_type;
+    Latency_Trace_Stage stage;
+    gr::gr_latency::latency_probe::sptr probe;
+  };
+
+  struct Histograms {
+    Latency_Histogram stages[TRACE_STAGE_COUNT];
+  };
+
+  static void collect();
+
+  static bool tracing;
+  static std::mutex probes_mutex;
+  static std::vector<Probe> probes;
+  static std::map<std::string, Histograms> recorder_types;
+};
+
+#endif // STAGE_LATENCY_H
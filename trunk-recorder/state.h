@@ -18,6 +18,10 @@ enum MonitoringState {
              NO_RECORDER = 4,
              ENCRYPTED = 5,
              DUPLICATE = 6,
-             SUPERSEDED = 7};
+             SUPERSEDED = 7,
+             BACKLOG = 8,
+             REMOTE = 9,
+             PREEMPTED = 10,
+             ADMISSION = 11};
 
 #endif
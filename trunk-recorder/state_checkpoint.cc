@@ -0,0 +1,190 @@
+#include "state_checkpoint.h"
+#include "systems/parser.h"
+#include "systems/system_impl.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <cstring>
+
+static const char CHECKPOINT_MAGIC[8] = {'T', 'R', 'S', 'T', 'A', 'T', 'E', '1'};
+static const std::uint32_t CHECKPOINT_VERSION = 1;
+static const size_t CHECKPOINT_MAX_SIZE = 1 << 20;
+
+std::string State_Checkpoint::directory;
+int State_Checkpoint::interval = 60;
+std::map<System_impl *, std::time_t> State_Checkpoint::next_save;
+
+static std::uint64_t fnv1a(const std::string &data) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < data.size(); i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+void Checkpoint_Writer::put_string(const std::string &value) {
+  put_u32(value.size());
+  buffer.append(value);
+}
+
+bool Checkpoint_Reader::get(void *value, size_t len) {
+  if (!good || (buffer.size() - pos < len)) {
+    good = false;
+    memset(value, 0, len);
+    return false;
+  }
+  memcpy(value, buffer.data() + pos, len);
+  pos += len;
+  return true;
+}
+
+std::uint32_t Checkpoint_Reader::get_u32() {
+  std::uint32_t value;
+  get(&value, sizeof(value));
+  return value;
+}
+
+std::uint64_t Checkpoint_Reader::get_u64() {
+  std::uint64_t value;
+  get(&value, sizeof(value));
+  return value;
+}
+
+std::int64_t Checkpoint_Reader::get_i64() {
+  std::int64_t value;
+  get(&value, sizeof(value));
+  return value;
+}
+
+double Checkpoint_Reader::get_double() {
+  double value;
+  get(&value, sizeof(value));
+  return value;
+}
+
+std::string Checkpoint_Reader::get_string() {
+  std::uint32_t len = get_u32();
+  if (!good || (buffer.size() - pos < len)) {
+    good = false;
+    return "";
+  }
+  std::string value = buffer.substr(pos, len);
+  pos += len;
+  return value;
+}
+
+void State_Checkpoint::set_directory(const std::string &dir) {
+  directory = dir;
+}
+
+void State_Checkpoint::set_interval(int seconds) {
+  interval = seconds;
+}
+
+bool State_Checkpoint::enabled() {
+  return !directory.empty();
+}
+
+std::string State_Checkpoint::filename(System_impl *system) {
+  return directory + "/" + system->get_short_name() + ".state";
+}
+
+bool State_Checkpoint::restore(System_impl *system) {
+  if (!enabled() || !system->get_parser()) {
+    return false;
+  }
+  next_save[system] = time(NULL) + interval;
+
+  std::string name = filename(system);
+  FILE *fp = fopen(name.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+  std::string contents;
+  char buffer[4096];
+  size_t len;
+  while (((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) && (contents.size() <= CHECKPOINT_MAX_SIZE)) {
+    contents.append(buffer, len);
+  }
+  fclose(fp);
+
+  std::uint64_t hash;
+  if ((contents.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(hash)) || (contents.size() > CHECKPOINT_MAX_SIZE) ||
+      (memcmp(contents.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)) {
+    BOOST_LOG_TRIVIAL(warning) << "[" << system->get_short_name() << "]\tIgnoring state checkpoint that isn't one: " << name;
+    return false;
+  }
+  memcpy(&hash, contents.data() + contents.size() - sizeof(hash), sizeof(hash));
+  contents.resize(contents.size() - sizeof(hash));
+  if (hash != fnv1a(contents)) {
+    BOOST_LOG_TRIVIAL(warning) << "[" << system->get_short_name() << "]\tIgnoring damaged state checkpoint: " << name;
+    return false;
+  }
+
+  std::string fields = contents.substr(sizeof(CHECKPOINT_MAGIC));
+  Checkpoint_Reader in(fields);
+  std::uint32_t version = in.get_u32();
+  std::string type = in.get_string();
+  std::time_t saved_at = in.get_i64();
+  if ((version != CHECKPOINT_VERSION) || (type != system->get_system_type())) {
+    BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tIgnoring state checkpoint from another version or type of system: " << name;
+    return false;
+  }
+
+  if (!system->restore_state(in) || !system->get_parser()->restore_state(in) || !in.ok() || !in.at_end()) {
+    BOOST_LOG_TRIVIAL(warning) << "[" << system->get_short_name() << "]\tState checkpoint could not be read: " << name;
+    return false;
+  }
+  BOOST_LOG_TRIVIAL(info) << "[" << system->get_short_name() << "]\tRestored the control channel state saved " << (time(NULL) - saved_at) << " seconds ago";
+  return true;
+}
+
+void State_Checkpoint::parsed(System_impl *system) {
+  std::map<System_impl *, std::time_t>::iterator next = next_save.find(system);
+  if (next == next_save.end()) {
+    return;
+  }
+  std::time_t now = time(NULL);
+  if (now < next->second) {
+    return;
+  }
+  next->second = now + interval;
+  save(system);
+}
+
+void State_Checkpoint::save(System_impl *system) {
+  if (!enabled() || !system->get_parser()) {
+    return;
+  }
+  Checkpoint_Writer out;
+  out.put_u32(CHECKPOINT_VERSION);
+  out.put_string(system->get_system_type());
+  out.put_i64(time(NULL));
+  system->save_state(out);
+  system->get_parser()->save_state(out);
+
+  std::string contents(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  contents.append(out.data());
+  std::uint64_t hash = fnv1a(contents);
+  contents.append((const char *)&hash, sizeof(hash));
+
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory, ec);
+  std::string name = filename(system);
+  std::string temp_name = name + ".tmp";
+  FILE *fp = fopen(temp_name.c_str(), "wb");
+  if (!fp) {
+    BOOST_LOG_TRIVIAL(warning) << "Unable to write state checkpoint: " << temp_name;
+    return;
+  }
+  bool ok = (fwrite(contents.data(), 1, contents.size(), fp) == contents.size());
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || (rename(temp_name.c_str(), name.c_str()) != 0)) {
+    BOOST_LOG_TRIVIAL(warning) << "Unable to write state checkpoint: " << name;
+    remove(temp_name.c_str());
+    return;
+  }
+  BOOST_LOG_TRIVIAL(debug) << "[" << system->get_short_name() << "]\tWrote state checkpoint " << name << ", " << contents.size() << " bytes";
+}
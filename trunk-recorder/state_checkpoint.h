@@ -0,0 +1,92 @@
+#ifndef STATE_CHECKPOINT_H
+#define STATE_CHECKPOINT_H
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+
+class System_impl;
+
+// What a System and its parser put in a checkpoint, as a run of fields in
+// the byte order of the machine
+class Checkpoint_Writer {
+public:
+  void put_u32(std::uint32_t value) { put(&value, sizeof(value)); }
+  void put_u64(std::uint64_t value) { put(&value, sizeof(value)); }
+  void put_i64(std::int64_t value) { put(&value, sizeof(value)); }
+  void put_double(double value) { put(&value, sizeof(value)); }
+  void put_string(const std::string &value);
+  const std::string &data() const { return buffer; }
+
+private:
+  void put(const void *value, size_t len) { buffer.append((const char *)value, len); }
+  std::string buffer;
+};
+
+// Reads the fields back in the order they were put. Reading past the end
+// gives zeros and ok() is false from then on.
+class Checkpoint_Reader {
+public:
+  Checkpoint_Reader(const std::string &data) : buffer(data), pos(0), good(true) {}
+  std::uint32_t get_u32();
+  std::uint64_t get_u64();
+  std::int64_t get_i64();
+  double get_double();
+  std::string get_string();
+  bool ok() const { return good; }
+  bool at_end() const { return pos == buffer.size(); }
+
+private:
+  bool get(void *value, size_t len);
+  const std::string &buffer;
+  size_t pos;
+  bool good;
+};
+
+/*
+ * State_Checkpoint
+ *   Keeps what each trunked system has learned from its control channel in
+ *   a file in stateCheckpointDir, so a restart can handle the first grants
+ *   without waiting for the site to broadcast it all again.
+ *
+ * For a P25 system that is its WACN, System ID, NAC, RFSS and site, its
+ * patches and the IDEN frequency tables; for SmartNet the system and site
+ * IDs, patches, adjacent sites and alternate control channels. Each
+ * system has a <shortName>.state file:
+ *
+ *   char magic[8], uint32 version, string type, int64 saved_at,
+ *   the System's fields, the parser's fields, uint64 FNV-1a hash of all
+ *   that came before it
+ *
+ * A file for a system of another type, or that doesn't check out, is
+ * ignored. What came from the config wins over what was saved, and
+ * whatever the control channel says replaces it as it is heard; patches,
+ * sites and channels that would have gone stale since are dropped.
+ *
+ * The parsers are only touched on the thread that parses their messages,
+ * so each system is saved there, right after a message has been handled,
+ * once stateCheckpointInterval has gone by. That is with the lock the
+ * messages are handled under held.
+ */
+class State_Checkpoint {
+public:
+  static void set_directory(const std::string &directory);
+  static void set_interval(int seconds);
+  static bool enabled();
+
+  // Before the system's messages are parsed; true if it had a checkpoint
+  static bool restore(System_impl *system);
+  // After a message of the system's has been handled
+  static void parsed(System_impl *system);
+  static void save(System_impl *system);
+
+private:
+  static std::string filename(System_impl *system);
+
+  static std::string directory;
+  static int interval;
+  static std::map<System_impl *, std::time_t> next_save; // filled by restore(), before any worker starts
+};
+
+#endif // STATE_CHECKPOINT_H
@@ -0,0 +1,103 @@
+#ifndef FLAT_MAP_H
+#define FLAT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Flat_Map
+ *   A hash table with open addressing, for the per-OSW lookups of a
+ *   trunking parser: talkgroups and voice channels by integer key.
+ *
+ * Entries sit in one array and a lookup probes forward from where the key
+ * hashes to, so a hit is usually one cache line and nothing is allocated
+ * once the table has grown to the size of the system. It is kept at most
+ * half full. Nothing is ever removed, which is all the parsers need, and
+ * a pointer from find() is good until the next insert.
+ */
+template <typename Key, typename Value>
+class Flat_Map {
+public:
+  Flat_Map() : count(0) {}
+
+  Value *find(Key key) {
+    if (count == 0) {
+      return NULL;
+    }
+    for (size_t i = home(key);; i = (i + 1) & (slots.size() - 1)) {
+      if (!slots[i].used) {
+        return NULL;
+      }
+      if (slots[i].key == key) {
+        return &slots[i].value;
+      }
+    }
+  }
+
+  // Adds a value-initialized entry if key isn't there
+  Value &operator[](Key key) {
+    Value *value = find(key);
+    if (value) {
+      return *value;
+    }
+    if ((count + 1) * 2 > slots.size()) {
+      grow();
+    }
+    return insert(key, Value());
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  // f(key, value) for every entry, in no particular order
+  template <typename F>
+  void for_each(F f) const {
+    for (size_t i = 0; i < slots.size(); i++) {
+      if (slots[i].used) {
+        f(slots[i].key, slots[i].value);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    bool used;
+    Key key;
+    Value value;
+  };
+
+  std::vector<Slot> slots; // a power of 2 of them
+  size_t count;
+
+  size_t home(Key key) const {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & (slots.size() - 1);
+  }
+
+  // Only called when there is a free slot
+  Value &insert(Key key, const Value &value) {
+    size_t i = home(key);
+    while (slots[i].used) {
+      i = (i + 1) & (slots.size() - 1);
+    }
+    slots[i].used = true;
+    slots[i].key = key;
+    slots[i].value = value;
+    count++;
+    return slots[i].value;
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.empty() ? 16 : slots.size() * 2, Slot());
+    old.swap(slots);
+    count = 0;
+    for (size_t i = 0; i < old.size(); i++) {
+      if (old[i].used) {
+        insert(old[i].key, old[i].value);
+      }
+    }
+  }
+};
+
+#endif // FLAT_MAP_H
@@ -0,0 +1,75 @@
+#ifndef P25_BITS_H
+#define P25_BITS_H
+
+#include <cstdint>
+
+/*
+ * P25_Bits
+ *   A TSBK or MBT held as a fixed width integer of Words 64 bit words,
+ *   for pulling fields out of without a heap allocation or a copy of the
+ *   whole message per field.
+ *
+ * Bytes are pushed in most significant first, as they come from OP25, so
+ * the last byte pushed ends up in the bottom 8 bits, and then the whole
+ * thing is shifted up to leave room for the CRC OP25 has stripped off.
+ * Bits pushed past the top are lost, which only happens to messages
+ * longer than any field looks at.
+ *
+ * field<Shift, Mask>() is (bits >> Shift) & Mask and field_left<Shift,
+ * Mask>() is (bits << Shift) & Mask, the same as the old
+ * bitset_shift_mask() and bitset_shift_left_mask() on a dynamic_bitset.
+ * Shift and Mask are constants for each field of each opcode, so every
+ * field comes down to a shift or two and an and.
+ *
+ * A TSBK and an MBT header fit in 2 words, the data blocks of an MBT in 3.
+ */
+template <int Words>
+class P25_Bits {
+public:
+  static const int bits = Words * 64;
+
+  P25_Bits() : word() {}
+
+  void push_byte(unsigned char c) {
+    for (int i = Words - 1; i > 0; i--) {
+      word[i] = (word[i] << 8) | (word[i - 1] >> 56);
+    }
+    word[0] = (word[0] << 8) | c;
+  }
+
+  // shift is 1 to 63
+  void shift_up(int shift) {
+    for (int i = Words - 1; i > 0; i--) {
+      word[i] = (word[i] << shift) | (word[i - 1] >> (64 - shift));
+    }
+    word[0] <<= shift;
+  }
+
+  template <int Shift, unsigned long long Mask>
+  unsigned long field() const {
+    static_assert(Shift >= 0 && Shift < bits, "field starts past the end of the message");
+    const int index = Shift / 64;
+    const int offset = Shift % 64;
+    uint64_t value = word[index] >> offset;
+    if ((offset != 0) && (index + 1 < Words)) {
+      value |= word[index + 1] << (64 - offset);
+    }
+    return value & Mask;
+  }
+
+  // Only the bottom word can land under a 64 bit mask
+  template <int Shift, unsigned long long Mask>
+  unsigned long field_left() const {
+    static_assert(Shift >= 0 && Shift < 64, "shift is wider than a word");
+    return (word[0] << Shift) & Mask;
+  }
+
+private:
+  uint64_t word[Words]; // word[0] is the least significant
+};
+
+typedef P25_Bits<2> Tsbk_Bits;
+typedef P25_Bits<2> Mbt_Header_Bits;
+typedef P25_Bits<3> Mbt_Data_Bits;
+
+#endif // P25_BITS_H
@@ -1,13 +1,13 @@
 #ifndef P25_PARSE_H
 #define P25_PARSE_H
 #include "parser.h"
-#include <bitset>
-#include <boost/dynamic_bitset.hpp>
+#include "p25_bits.h"
 #include <boost/log/trivial.hpp>
 #include <gnuradio/message.h>
 #include "system.h"
 #include "system_impl.h"
 #include <iomanip>
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -25,26 +25,33 @@ struct Freq_Table {
   double bandwidth;
 };
 
+// One per System, so the frequency tables are that system's. A channel ID
+// has a 4 bit IDEN that picks one of 16 tables, which are kept in an array
+// with a bit in freq_tables_known for each that has been heard.
 class P25Parser : public TrunkParser {
-  std::map<int, std::map<int, Freq_Table>> freq_tables;
-  std::map<int, Freq_Table>::iterator it;
+  static const int FREQ_TABLE_COUNT = 16;
+  Freq_Table freq_tables[FREQ_TABLE_COUNT];
+  uint16_t freq_tables_known;
   bool custom_freq_table_loaded = false;
+  bool describe; // build the text of messages, for the debug and trace logs
+  std::vector<TrunkMessage> messages; // what parse_message() returns, reused, and decode_*() add to
+
+  const Freq_Table *find_freq_table(int chan_id) const;
 
 public:
   P25Parser();
-  long get_tdma_slot(int chan_id, int sys_num);
-  double get_bandwidth(int chan_id, int sys_num);
-  std::vector<TrunkMessage> decode_mbt_data(unsigned long opcode, boost::dynamic_bitset<> &header, boost::dynamic_bitset<> &mbt_data, unsigned long link_id, unsigned long nac, int sys_num);
-  std::vector<TrunkMessage> decode_tsbk(boost::dynamic_bitset<> &tsbk, unsigned long nac, int sys_num);
-  unsigned long bitset_shift_mask(boost::dynamic_bitset<> &tsbk, int shift, unsigned long long mask);
-  unsigned long bitset_shift_left_mask(boost::dynamic_bitset<> &tsbk, int shift, unsigned long long mask);
-  std::string channel_id_to_freq_string(int chan_id, int sys_num);
-  void print_bitset(boost::dynamic_bitset<> &tsbk);
-  void add_freq_table(int freq_table_id, Freq_Table table, int sys_num);
-  void load_freq_table(std::string custom_freq_table_file, int sys_num);
-  double channel_id_to_frequency(int chan_id, int sys_num);
-  std::string channel_to_string(int chan, int sys_num);
-  std::vector<TrunkMessage> parse_message(gr::message::sptr msg, System *system);
+  long get_tdma_slot(int chan_id) const;
+  double get_bandwidth(int chan_id) const;
+  void decode_mbt_data(unsigned long opcode, const Mbt_Header_Bits &header, const Mbt_Data_Bits &mbt_data, unsigned long link_id, unsigned long nac, int sys_num);
+  void decode_tsbk(const Tsbk_Bits &tsbk, unsigned long nac, int sys_num);
+  std::string channel_id_to_freq_string(int chan_id) const;
+  void add_freq_table(int freq_table_id, Freq_Table table);
+  void load_freq_table(std::string custom_freq_table_file);
+  double channel_id_to_frequency(int chan_id) const;
+  std::string channel_to_string(int chan) const;
+  const std::vector<TrunkMessage> &parse_message(gr::message::sptr msg, System *system) override;
+  void save_state(Checkpoint_Writer &out) override;
+  bool restore_state(Checkpoint_Reader &in) override;
 };
 
 #endif
\ No newline at end of file
@@ -2,8 +2,8 @@
 #include "p25_trunking.h"
 #include <boost/log/trivial.hpp>
 
-p25_trunking_sptr make_p25_trunking(double freq, double center, long s, gr::msg_queue::sptr queue, bool qpsk, int sys_num) {
-  return gnuradio::get_initial_sptr(new p25_trunking(freq, center, s, queue, qpsk, sys_num));
+p25_trunking_sptr make_p25_trunking(double freq, double center, long s, gr::msg_queue::sptr queue, bool qpsk, int sys_num, double iq_ring_seconds) {
+  return gnuradio::get_initial_sptr(new p25_trunking(freq, center, s, queue, qpsk, sys_num, iq_ring_seconds));
 }
 
 void p25_trunking::initialize_fsk4() {
@@ -119,7 +119,7 @@ void p25_trunking::initialize_p25() {
   connect(slicer, 0, op25_frame_assembler, 0);
 }
 
-p25_trunking::p25_trunking(double f, double c, long s, gr::msg_queue::sptr queue, bool qpsk, int sys_num)
+p25_trunking::p25_trunking(double f, double c, long s, gr::msg_queue::sptr queue, bool qpsk, int sys_num, double iq_ring_seconds)
     : gr::hier_block2("p25_trunking",
                       gr::io_signature::make(1, 1, sizeof(gr_complex)),
                       gr::io_signature::make(0, 0, sizeof(float))) {
@@ -141,6 +141,10 @@ p25_trunking::p25_trunking(double f, double c, long s, gr::msg_queue::sptr queue
   } else {
     initialize_qpsk();
   }
+  if (iq_ring_seconds > 0) {
+    iq_ring = make_iq_ring_buffer(system_channel_rate, iq_ring_seconds);
+    connect(prefilter, 0, iq_ring, 0);
+  }
   tune_freq(chan_freq);
 }
 
@@ -177,6 +181,17 @@ int p25_trunking::get_freq_error() {
   return prefilter->get_freq_error();
 }
 
+void p25_trunking::set_fft_threads(int nthreads) {
+  prefilter->set_nthreads(nthreads);
+}
+
+bool p25_trunking::snapshot_iq(const std::string &base, const std::string &hw, int source_num) {
+  if (!iq_ring) {
+    return false;
+  }
+  return iq_ring->snapshot(base, chan_freq, hw, source_num);
+}
+
 void p25_trunking::finetune_control_freq(double f) {
   // Minor tuning adjustment without resetting costas or phase
   chan_freq = f;
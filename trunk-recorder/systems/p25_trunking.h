@@ -61,6 +61,7 @@
 #include "../gr_blocks/freq_xlating_fft_filter.h"
 #include "../gr_blocks/channelizer.h"
 #include "../gr_blocks/xlat_channelizer.h"
+#include "../gr_blocks/iq_ring_buffer.h"
 
 class p25_trunking;
 
@@ -75,7 +76,8 @@ p25_trunking_sptr make_p25_trunking(double f,
                                     long s,
                                     gr::msg_queue::sptr queue,
                                     bool qpsk,
-                                    int sys_num);
+                                    int sys_num,
+                                    double iq_ring_seconds = 0);
 
 class p25_trunking : public gr::hier_block2 {
   struct DecimSettings {
@@ -87,7 +89,8 @@ class p25_trunking : public gr::hier_block2 {
                                              long s,
                                              gr::msg_queue::sptr queue,
                                              bool qpsk,
-                                             int sys_num);
+                                             int sys_num,
+                                             double iq_ring_seconds);
 
 protected:
   p25_trunking(double f,
@@ -95,7 +98,8 @@ protected:
                long s,
                gr::msg_queue::sptr queue,
                bool qpsk,
-               int sys_num);
+               int sys_num,
+               double iq_ring_seconds);
 
 public:
   ~p25_trunking();
@@ -106,7 +110,12 @@ public:
   double get_freq();
   void enable();
   int get_freq_error();
+  void set_fft_threads(int nthreads);
   void finetune_control_freq(double f);
+  // Saves the last controlIqRingSeconds of the control channel to
+  // base.sigmf-data and base.sigmf-meta, false if it keeps no ring
+  bool snapshot_iq(const std::string &base, const std::string &hw, int source_num);
+  double get_channel_rate() { return system_channel_rate; }
   int autotune_offset;
 
   gr::msg_queue::sptr tune_queue;
@@ -146,6 +155,7 @@ private:
 
   //channelizer::sptr prefilter;
   xlat_channelizer::sptr prefilter;
+  iq_ring_buffer_sptr iq_ring;
   gr::analog::sig_source_c::sptr lo;
   gr::analog::sig_source_c::sptr bfo;
   gr::blocks::multiply_cc::sptr mixer;
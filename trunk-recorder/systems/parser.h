@@ -1,8 +1,13 @@
 #ifndef PARSE_H
 #define PARSE_H
+#include <gnuradio/message.h>
 #include <iostream>
 #include <vector>
 
+class System;
+class Checkpoint_Writer;
+class Checkpoint_Reader;
+
 enum MessageType {
   GRANT = 0,
   STATUS = 1,
@@ -56,7 +61,19 @@ struct TrunkMessage {
   
 };
 
+// Turns control channel messages into TrunkMessages. Each System has one of
+// its own, so the state kept between messages is only ever that system's.
+// parse_message() returns a vector the parser keeps and reuses, which is
+// good until the next call.
+//
+// save_state() and restore_state() are what the parser has learned from
+// the control channel, for a State_Checkpoint. Both are only called on the
+// thread that parses the system's messages.
 class TrunkParser {
-  std::vector<TrunkMessage> parse_message(std::string s);
+public:
+  virtual ~TrunkParser() {}
+  virtual const std::vector<TrunkMessage> &parse_message(gr::message::sptr msg, System *system) = 0;
+  virtual void save_state(Checkpoint_Writer &out) {}
+  virtual bool restore_state(Checkpoint_Reader &in) { return true; }
 };
 #endif
@@ -4,25 +4,25 @@
 #include "smartnet_fsk2_demod.h"
 #include <boost/log/trivial.hpp>
 
-smartnet_impl::sptr smartnet_impl::make(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num) {
-  smartnet_impl *smartnet = new smartnet_impl(freq, center, s, queue, sys_num);
+smartnet_impl::sptr smartnet_impl::make(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num, double iq_ring_seconds) {
+  smartnet_impl *smartnet = new smartnet_impl(freq, center, s, queue, sys_num, iq_ring_seconds);
 
   return gnuradio::get_initial_sptr(smartnet);
 }
 
-smartnet_impl::smartnet_impl(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num)
+smartnet_impl::smartnet_impl(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num, double iq_ring_seconds)
     : gr::hier_block2("smartnet_impl",
                       gr::io_signature::make(1, 1, sizeof(gr_complex)),
                       gr::io_signature::make(0, 0, sizeof(float)))
 {
-  initialize(freq, center, s, queue, sys_num);
+  initialize(freq, center, s, queue, sys_num, iq_ring_seconds);
 }
 
 smartnet_impl::~smartnet_impl() {
 
 }
 
-void smartnet_impl::initialize(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num) {
+void smartnet_impl::initialize(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num, double iq_ring_seconds) {
   chan_freq = freq;
   center_freq = center;
   input_rate = s;
@@ -41,6 +41,10 @@ void smartnet_impl::initialize(double freq, double center, long s, gr::msg_queue
 
   connect(self(), 0, prefilter, 0);
   connect(prefilter, 0, fsk2_demod, 0);
+  if (iq_ring_seconds > 0) {
+    iq_ring = make_iq_ring_buffer(get_channel_rate(), iq_ring_seconds);
+    connect(prefilter, 0, iq_ring, 0);
+  }
 
 }
 
@@ -50,6 +54,10 @@ int smartnet_impl::get_freq_error() { // get frequency error from FLL and conver
   return prefilter->get_freq_error();
 }
 
+void smartnet_impl::set_fft_threads(int nthreads) {
+  prefilter->set_nthreads(nthreads);
+}
+
 
 double smartnet_impl::get_pwr() {
   return prefilter->get_pwr();
@@ -81,6 +89,13 @@ void smartnet_impl::enable() {
   
 }
 
+bool smartnet_impl::snapshot_iq(const std::string &base, const std::string &hw, int source_num) {
+  if (!iq_ring) {
+    return false;
+  }
+  return iq_ring->snapshot(base, chan_freq, hw, source_num);
+}
+
 void smartnet_impl::finetune_control_freq(double f) {
    tune_freq(f);
 }
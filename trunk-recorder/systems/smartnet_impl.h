@@ -24,6 +24,7 @@
 #include <gnuradio/msg_queue.h>
 #include <gnuradio/blocks/null_sink.h>
 
+#include "../gr_blocks/iq_ring_buffer.h"
 #include "../gr_blocks/xlat_channelizer.h"
 #include "smartnet_fsk2_demod.h"
 
@@ -43,12 +44,14 @@ class smartnet_impl : public gr::hier_block2 {
                                         double c,
                                         long s,
                                         gr::msg_queue::sptr queue,
-                                        int sys_num);
+                                        int sys_num,
+                                        double iq_ring_seconds = 0);
   smartnet_impl(double f,
                double c,
                long s,
                gr::msg_queue::sptr queue,
-               int sys_num);
+               int sys_num,
+               double iq_ring_seconds);
 
 
   ~smartnet_impl();
@@ -60,13 +63,18 @@ class smartnet_impl : public gr::hier_block2 {
   double get_freq();
   void enable();
   int get_freq_error();
+  void set_fft_threads(int nthreads);
   void finetune_control_freq(double f);
+  // Saves the last controlIqRingSeconds of the control channel to
+  // base.sigmf-data and base.sigmf-meta, false if it keeps no ring
+  bool snapshot_iq(const std::string &base, const std::string &hw, int source_num);
+  double get_channel_rate() { return xlat_channelizer::smartnet_samples_per_symbol * xlat_channelizer::smartnet_symbol_rate; }
   int autotune_offset;
 
   gr::msg_queue::sptr rx_queue;
 
 private:
-  void initialize(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num);
+  void initialize(double freq, double center, long s, gr::msg_queue::sptr queue, int sys_num, double iq_ring_seconds);
 
   double center_freq, chan_freq;
   long input_rate;
@@ -77,6 +85,7 @@ private:
   xlat_channelizer::sptr prefilter;
 
   smartnet_fsk2_demod::sptr fsk2_demod;
+  iq_ring_buffer_sptr iq_ring;
 
 };
 
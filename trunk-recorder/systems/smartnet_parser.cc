@@ -1,4 +1,5 @@
 #include "smartnet_parser.h"
+#include "../state_checkpoint.h"
 #include <algorithm>
 #include <boost/log/trivial.hpp>
 #include <cmath>
@@ -86,10 +87,10 @@ void SmartnetParser::log_bandplan() {
                              << " Rebanded: " << is_rebanded;
 }
 
-std::vector<TrunkMessage> SmartnetParser::parse_message(gr::message::sptr msg, System *system) {
+const std::vector<TrunkMessage> &SmartnetParser::parse_message(gr::message::sptr msg, System *system) {
     int sysnum = system->get_sys_num();
     time_t curr_time = time(NULL);
-    std::vector<TrunkMessage> messages;
+    messages.clear();
 
 
     
@@ -114,25 +115,22 @@ std::vector<TrunkMessage> SmartnetParser::parse_message(gr::message::sptr msg, S
         enqueue(0xffff, 0x1, OSW_QUEUE_RESET_CMD, m_ts);
     } else if (m_type == M_SMARTNET_OSW) {
         if (osw_count == 0) log_bandplan(); // Log bandplan on first OSW
-        std::string s = msg->to_string();
-        if (s.length() >= 5) {
-            int osw_addr = ((unsigned char)s[0] << 8) | (unsigned char)s[1];
-            int osw_grp = (unsigned char)s[2];
-            int osw_cmd = ((unsigned char)s[3] << 8) | (unsigned char)s[4];
+        const unsigned char *s = msg->msg();
+        if (msg->length() >= 5) {
+            int osw_addr = (s[0] << 8) | s[1];
+            int osw_grp = s[2];
+            int osw_cmd = (s[3] << 8) | s[4];
             enqueue(osw_addr, osw_grp, osw_cmd, m_ts);
             osw_count++;
             last_osw = m_ts;
         }
     }
 
-    std::vector<TrunkMessage> new_msgs = process_osws(curr_time);
-    messages.insert(messages.end(), new_msgs.begin(), new_msgs.end());
+    process_osws(curr_time);
 
     if (curr_time >= last_expiry_check + EXPIRY_TIMER) {
         expire_talkgroups(curr_time);
-        expire_patches(curr_time);
-        expire_adjacent_sites(curr_time);
-        expire_alternate_cc_freqs(curr_time);
+        expiry.advance(curr_time, [&](const SmartnetExpiry &item) { expire(item, curr_time); });
         last_expiry_check = curr_time;
     }
 
@@ -140,14 +138,14 @@ std::vector<TrunkMessage> SmartnetParser::parse_message(gr::message::sptr msg, S
     return messages;
 }
 
-std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
-    std::vector<TrunkMessage> messages;
+// Adds what the OSWs at the front of the queue make to messages
+void SmartnetParser::process_osws(time_t curr_time) {
     if (osw_q.empty()) {
-        return messages;
+        return;
     }
     
     if (osw_q.size() < OSW_QUEUE_SIZE) {
-        return messages;
+        return;
     }
     
     OSW osw2 = osw_q.front();
@@ -183,7 +181,7 @@ std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
                 // If we only had more than one queue reset message, we need to put one back and wait for more OSWs
                 osw_q.push_front(queue_reset);
                 if (this->debug_level >= 11) BOOST_LOG_TRIVIAL(info) << "[" << msgq_id << "] SMARTNET PARSE MESSAGE QUEUE RESET PUSHED BACK";
-                return messages;
+                return;
             }
         }
     }
@@ -193,7 +191,7 @@ std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
     // first, but then fall back to non-OBT-specific parsing if that fails.
     if (is_obt_system() && osw2.ch_tx) {
         if (osw_q.empty()) {
-            return messages;
+            return;
         }
         // Get next OSW in the queue
         OSW osw1 = osw_q.front(); 
@@ -207,7 +205,7 @@ std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
             //     osw_q.push_front(osw1); 
             //     osw_q.push_front(osw2); 
             //     if (this->debug_level >= 11) BOOST_LOG_TRIVIAL(info) << "[" << msgq_id << "] SMARTNET PARSE MESSAGE OSW QUEUE PUSHED FRONT";
-            //     return messages; 
+            //     return; 
             //  }
              OSW osw0 = osw_q.front(); osw_q.pop_front(); // Line 861 from Python implementation
              
@@ -302,7 +300,7 @@ std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
     }
     // Two- or three-OSW message
     else if (osw2.cmd == 0x308) {
-        if (osw_q.empty()) { osw_q.push_front(osw2); return messages; }
+        if (osw_q.empty()) { osw_q.push_front(osw2); return; }
         OSW osw1 = osw_q.front(); osw_q.pop_front();
         
         // Two-OSW system ID + control channel broadcast line 987
@@ -799,8 +797,6 @@ std::vector<TrunkMessage> SmartnetParser::process_osws(time_t curr_time) {
                                      << " ch_rx=" << osw2.ch_rx << " ch_tx=" << osw2.ch_tx;
         }
     }
-    
-    return messages;
 }
 
 std::vector<TrunkMessage> SmartnetParser::update_voice_frequency(double ts, double freq, long tgid, int srcaddr, int mode) {
@@ -813,21 +809,17 @@ std::vector<TrunkMessage> SmartnetParser::update_voice_frequency(double ts, doub
     int base_tgid = tgid & 0xfff0;
     int flags = tgid & 0x000f;
     
-    if (voice_frequencies.find(frequency) == voice_frequencies.end()) {
-        VoiceFrequency vf;
-        vf.frequency = frequency;
-        vf.counter = 0;
-        voice_frequencies[frequency] = vf;
-    }
+    VoiceFrequency &vf = voice_frequencies[frequency];
+    vf.frequency = frequency;
     
     if (mode != -1) {
-        voice_frequencies[frequency].mode = mode;
+        vf.mode = mode;
     }
     
-    voice_frequencies[frequency].tgid = base_tgid;
-    voice_frequencies[frequency].flags = flags;
-    voice_frequencies[frequency].counter++;
-    voice_frequencies[frequency].time = ts;
+    vf.tgid = base_tgid;
+    vf.flags = flags;
+    vf.counter++;
+    vf.time = ts;
     
     return msgs;
 }
@@ -837,8 +829,9 @@ std::vector<TrunkMessage> SmartnetParser::update_talkgroups(double ts, int frequ
     update_talkgroup(ts, frequency, tgid, srcaddr, mode);
     
     std::lock_guard<std::mutex> lock(patches_mutex);
-    if (patches.find(tgid) != patches.end()) {
-        for (auto const& [sub_tgid, val] : patches[tgid]) {
+    auto patch = patches.find(tgid);
+    if (patch != patches.end()) {
+        for (auto const& [sub_tgid, val] : patch->second) {
              update_talkgroup(ts, frequency, sub_tgid, srcaddr, mode);
         }
     }
@@ -850,18 +843,20 @@ bool SmartnetParser::update_talkgroup(double ts, int frequency, long tgid, int s
     int tgid_stat = tgid & 0x000f;
     
     std::lock_guard<std::mutex> lock(talkgroups_mutex);
-    if (talkgroups.find(base_tgid) == talkgroups.end()) {
+    TalkgroupInfo *tg = talkgroups.find(base_tgid);
+    if (!tg) {
         add_default_tgid(base_tgid);
-    } else if (ts < talkgroups[base_tgid].release_time) {
+        tg = talkgroups.find(base_tgid);
+    } else if (ts < tg->release_time) {
         return false;
     }
     
-    talkgroups[base_tgid].time = ts; 
-    talkgroups[base_tgid].release_time = 0;
-    talkgroups[base_tgid].frequency = frequency;
-    talkgroups[base_tgid].status = tgid_stat;
-    if (srcaddr >= 0) talkgroups[base_tgid].srcaddr = srcaddr;
-    if (mode >= 0) talkgroups[base_tgid].mode = mode;
+    tg->time = ts; 
+    tg->release_time = 0;
+    tg->frequency = frequency;
+    tg->status = tgid_stat;
+    if (srcaddr >= 0) tg->srcaddr = srcaddr;
+    if (mode >= 0) tg->mode = mode;
     
     return true;
 }
@@ -881,10 +876,11 @@ void SmartnetParser::add_default_tgid(long tgid) {
 
 void SmartnetParser::add_patch(double ts, long tgid, long sub_tgid, int mode) {
     std::lock_guard<std::mutex> lock(patches_mutex);
-    if (patches.find(tgid) == patches.end()) {
-        patches[tgid] = std::map<long, std::pair<double, int>>();
+    std::map<long, std::pair<double, int>> &patch = patches[tgid];
+    if (patch.find(sub_tgid) == patch.end()) {
+        expiry.schedule(ts, PATCH_EXPIRY_TIME, {SmartnetExpiry::PATCH, tgid, sub_tgid});
     }
-    patches[tgid][sub_tgid] = std::make_pair(ts, mode);
+    patch[sub_tgid] = std::make_pair(ts, mode);
 }
 
 void SmartnetParser::delete_patches(long tgid) {
@@ -898,45 +894,39 @@ bool SmartnetParser::expire_talkgroups(double curr_time) {
     return true;
 }
 
-bool SmartnetParser::expire_patches(double curr_time) {
-    std::lock_guard<std::mutex> lock(patches_mutex);
-    for (auto it = patches.begin(); it != patches.end(); ) {
-        for (auto sub_it = it->second.begin(); sub_it != it->second.end(); ) {
-             if (curr_time > sub_it->second.first + PATCH_EXPIRY_TIME) {
-                 sub_it = it->second.erase(sub_it);
-             } else {
-                 ++sub_it;
-             }
-        }
-        if (it->second.empty()) {
-            it = patches.erase(it);
+// Called by the expiry wheel. Something that was heard again since it was
+// put on goes back on for its new time; something no longer in its table
+// was already removed.
+void SmartnetParser::expire(const SmartnetExpiry &item, double curr_time) {
+    if (item.kind == SmartnetExpiry::PATCH) {
+        std::lock_guard<std::mutex> lock(patches_mutex);
+        auto patch = patches.find(item.key);
+        if (patch == patches.end()) return;
+        auto sub = patch->second.find(item.sub_key);
+        if (sub == patch->second.end()) return;
+        if (curr_time > sub->second.first + PATCH_EXPIRY_TIME) {
+            patch->second.erase(sub);
+            if (patch->second.empty()) patches.erase(patch);
         } else {
-            ++it;
+            expiry.schedule(curr_time, sub->second.first + PATCH_EXPIRY_TIME - curr_time, item);
         }
-    }
-    return true;
-}
-
-bool SmartnetParser::expire_adjacent_sites(double curr_time) {
-    for (auto it = adjacent_sites.begin(); it != adjacent_sites.end(); ) {
+    } else if (item.kind == SmartnetExpiry::ADJACENT_SITE) {
+        auto it = adjacent_sites.find(item.key);
+        if (it == adjacent_sites.end()) return;
         if (curr_time > it->second.time + ADJ_SITE_EXPIRY_TIME) {
-            it = adjacent_sites.erase(it);
+            adjacent_sites.erase(it);
         } else {
-            ++it;
+            expiry.schedule(curr_time, it->second.time + ADJ_SITE_EXPIRY_TIME - curr_time, item);
         }
-    }
-    return true;
-}
-
-bool SmartnetParser::expire_alternate_cc_freqs(double curr_time) {
-    for (auto it = alternate_cc_freqs.begin(); it != alternate_cc_freqs.end(); ) {
+    } else {
+        auto it = alternate_cc_freqs.find(item.key);
+        if (it == alternate_cc_freqs.end()) return;
         if (curr_time > it->second.time + ALT_CC_EXPIRY_TIME) {
-            it = alternate_cc_freqs.erase(it);
+            alternate_cc_freqs.erase(it);
         } else {
-            ++it;
+            expiry.schedule(curr_time, it->second.time + ALT_CC_EXPIRY_TIME - curr_time, item);
         }
     }
-    return true;
 }
 
 void SmartnetParser::add_adjacent_site(double ts, int site, double cc_rx_freq, double cc_tx_freq) {
@@ -944,6 +934,9 @@ void SmartnetParser::add_adjacent_site(double ts, int site, double cc_rx_freq, d
     as.time = ts;
     as.cc_rx_freq = cc_rx_freq;
     as.cc_tx_freq = cc_tx_freq;
+    if (adjacent_sites.find(site) == adjacent_sites.end()) {
+        expiry.schedule(ts, ADJ_SITE_EXPIRY_TIME, {SmartnetExpiry::ADJACENT_SITE, site, 0});
+    }
     adjacent_sites[site] = as;
 }
 
@@ -953,9 +946,81 @@ void SmartnetParser::add_alternate_cc_freq(double ts, double cc_rx_freq, double
     ac.cc_rx_freq = cc_rx_freq;
     ac.cc_tx_freq = cc_tx_freq;
     int key = (int)(cc_rx_freq * 1000000.0);
+    if (alternate_cc_freqs.find(key) == alternate_cc_freqs.end()) {
+        expiry.schedule(ts, ALT_CC_EXPIRY_TIME, {SmartnetExpiry::ALTERNATE_CC, key, 0});
+    }
     alternate_cc_freqs[key] = ac;
 }
 
+void SmartnetParser::save_state(Checkpoint_Writer &out) {
+    out.put_i64(rx_sys_id);
+    out.put_i64(rx_site_id);
+    {
+        std::lock_guard<std::mutex> lock(patches_mutex);
+        size_t count = 0;
+        for (auto patch = patches.begin(); patch != patches.end(); ++patch) {
+            count += patch->second.size();
+        }
+        out.put_u32(count);
+        for (auto patch = patches.begin(); patch != patches.end(); ++patch) {
+            for (auto sub = patch->second.begin(); sub != patch->second.end(); ++sub) {
+                out.put_i64(patch->first);
+                out.put_i64(sub->first);
+                out.put_double(sub->second.first);
+                out.put_i64(sub->second.second);
+            }
+        }
+    }
+    out.put_u32(adjacent_sites.size());
+    for (auto it = adjacent_sites.begin(); it != adjacent_sites.end(); ++it) {
+        out.put_i64(it->first);
+        out.put_double(it->second.time);
+        out.put_double(it->second.cc_rx_freq);
+        out.put_double(it->second.cc_tx_freq);
+    }
+    out.put_u32(alternate_cc_freqs.size());
+    for (auto it = alternate_cc_freqs.begin(); it != alternate_cc_freqs.end(); ++it) {
+        out.put_double(it->second.time);
+        out.put_double(it->second.cc_rx_freq);
+        out.put_double(it->second.cc_tx_freq);
+    }
+}
+
+// Whatever would have expired while trunk-recorder was stopped is left out,
+// and the rest goes on the expiry wheel for the time it was last heard
+bool SmartnetParser::restore_state(Checkpoint_Reader &in) {
+    double now = time(NULL);
+    rx_sys_id = in.get_i64();
+    rx_site_id = in.get_i64();
+    for (std::uint32_t count = in.get_u32(); in.ok() && count > 0; count--) {
+        long tgid = in.get_i64();
+        long sub_tgid = in.get_i64();
+        double ts = in.get_double();
+        int mode = in.get_i64();
+        if (in.ok() && (now <= ts + PATCH_EXPIRY_TIME)) {
+            add_patch(ts, tgid, sub_tgid, mode);
+        }
+    }
+    for (std::uint32_t count = in.get_u32(); in.ok() && count > 0; count--) {
+        int site = in.get_i64();
+        double ts = in.get_double();
+        double cc_rx_freq = in.get_double();
+        double cc_tx_freq = in.get_double();
+        if (in.ok() && (now <= ts + ADJ_SITE_EXPIRY_TIME)) {
+            add_adjacent_site(ts, site, cc_rx_freq, cc_tx_freq);
+        }
+    }
+    for (std::uint32_t count = in.get_u32(); in.ok() && count > 0; count--) {
+        double ts = in.get_double();
+        double cc_rx_freq = in.get_double();
+        double cc_tx_freq = in.get_double();
+        if (in.ok() && (now <= ts + ALT_CC_EXPIRY_TIME)) {
+            add_alternate_cc_freq(ts, cc_rx_freq, cc_tx_freq);
+        }
+    }
+    return in.ok();
+}
+
 std::tuple<std::string, bool, bool, bool, bool> SmartnetParser::get_bandplan_details() {
     std::string bandplan = system->get_bandplan();
     
@@ -1086,14 +1151,14 @@ std::string SmartnetParser::to_json() {
     j["top_line"] = top_line;
     
     json freqs = json::object();
-    for (const auto& [freq, vf] : voice_frequencies) {
+    voice_frequencies.for_each([&](int freq, const VoiceFrequency &vf) {
         json f_data;
         f_data["tgid"] = vf.tgid;
         f_data["mode"] = vf.mode;
         f_data["count"] = vf.counter;
         f_data["time"] = vf.time;
         freqs[std::to_string(freq)] = f_data;
-    }
+    });
     j["frequencies"] = freqs;
     
     return j.dump();
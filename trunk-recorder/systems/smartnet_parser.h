@@ -3,8 +3,9 @@
 
 #include "system.h"
 #include "parser.h"
+#include "flat_map.h"
+#include "timer_wheel.h"
 #include <gnuradio/message.h>
-#include <deque>
 #include <map>
 #include <mutex>
 #include <string>
@@ -31,6 +32,44 @@ struct OSW {
     double ts;
 };
 
+// The last few OSWs, oldest at the front. A fixed ring, so queueing OSWs
+// and putting them back while matching a message never allocates.
+// push_back() drops the oldest when it is full and push_front() the
+// newest.
+class Osw_Ring {
+public:
+    Osw_Ring() : head(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    void clear() { head = 0; count = 0; }
+    const OSW &front() const { return osw[head]; }
+
+    void pop_front() {
+        head = (head + 1) & (CAPACITY - 1);
+        count--;
+    }
+
+    void push_front(const OSW &o) {
+        head = (head + CAPACITY - 1) & (CAPACITY - 1);
+        osw[head] = o;
+        if (count < CAPACITY) count++;
+    }
+
+    void push_back(const OSW &o) {
+        if (count == CAPACITY) pop_front();
+        osw[(head + count) & (CAPACITY - 1)] = o;
+        count++;
+    }
+
+private:
+    static const size_t CAPACITY = 8; // a power of 2
+    static_assert(CAPACITY >= OSW_QUEUE_SIZE, "the ring must hold a full OSW queue");
+    OSW osw[CAPACITY];
+    size_t head;
+    size_t count;
+};
+
 struct VoiceFrequency {
     int frequency;
     long tgid;
@@ -64,13 +103,22 @@ struct AdjacentSite {
     double cc_tx_freq;
 };
 
-class SmartnetParser {
+// Something in the tables that goes stale, on the expiry wheel
+struct SmartnetExpiry {
+    enum Kind { PATCH, ADJACENT_SITE, ALTERNATE_CC } kind;
+    long key;
+    long sub_key; // the patched talkgroup, for a PATCH
+};
+
+class SmartnetParser : public TrunkParser {
 public:
     SmartnetParser(System *system);
     ~SmartnetParser();
 
-    std::vector<TrunkMessage> parse_message(gr::message::sptr msg, System *system);
-    std::vector<TrunkMessage> process_osws(time_t curr_time);
+    const std::vector<TrunkMessage> &parse_message(gr::message::sptr msg, System *system) override;
+    void save_state(Checkpoint_Writer &out) override;
+    bool restore_state(Checkpoint_Reader &in) override;
+    void process_osws(time_t curr_time);
     
     std::string to_json();
     void set_debug(int level) { debug_level = level; }
@@ -81,11 +129,13 @@ private:
     int debug_level;
     int sysnum;
     int msgq_id;
+
+    std::vector<TrunkMessage> messages; // what parse_message() returns, reused
     
-    std::deque<OSW> osw_q;
+    Osw_Ring osw_q;
     
-    std::map<int, VoiceFrequency> voice_frequencies;
-    std::map<long, TalkgroupInfo> talkgroups;
+    Flat_Map<int, VoiceFrequency> voice_frequencies;
+    Flat_Map<long, TalkgroupInfo> talkgroups;
     std::mutex talkgroups_mutex;
     
     // tgid -> sub_tgid -> pair<time, mode>
@@ -94,6 +144,10 @@ private:
 
     std::map<int, AlternateCCFreq> alternate_cc_freqs;
     std::map<int, AdjacentSite> adjacent_sites;
+
+    // Patches, adjacent sites and alternate control channels, each put on
+    // when it is first heard. The longest expiry is 60 seconds.
+    Timer_Wheel<SmartnetExpiry, 64> expiry;
     
     // Stats
     long osw_count;
@@ -113,9 +167,7 @@ private:
     bool update_talkgroup(double ts, int frequency, long tgid, int srcaddr, int mode);
     
     bool expire_talkgroups(double curr_time);
-    bool expire_patches(double curr_time);
-    bool expire_adjacent_sites(double curr_time);
-    bool expire_alternate_cc_freqs(double curr_time);
+    void expire(const SmartnetExpiry &item, double curr_time);
 
     void add_adjacent_site(double ts, int site, double cc_rx_freq, double cc_tx_freq);
     void add_alternate_cc_freq(double ts, double cc_rx_freq, double cc_tx_freq);
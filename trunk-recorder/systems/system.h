@@ -23,6 +23,7 @@
 #include <boost/property_tree/ptree.hpp>
 
 class Source;
+class Recorder;
 class analog_recorder;
 class p25_recorder;
 class dmr_recorder;
@@ -65,6 +66,18 @@ public:
   virtual void set_max_duration(double duration) = 0;
   virtual double get_min_tx_duration() = 0;
   virtual void set_min_tx_duration(double duration) = 0;
+  virtual double get_max_silence() = 0;
+  virtual void set_max_silence(double seconds) = 0;
+  virtual int get_silence_level() = 0;
+  virtual void set_silence_level(int level) = 0;
+  virtual int get_admission_priority() = 0;
+  virtual void set_admission_priority(int priority) = 0;
+  virtual double get_control_iq_ring_seconds() = 0;
+  virtual void set_control_iq_ring_seconds(double seconds) = 0;
+  virtual double get_control_iq_dump_rate() = 0;
+  virtual void set_control_iq_dump_rate(double rate) = 0;
+  virtual bool get_sync_wake() = 0;
+  virtual void set_sync_wake(bool sync_wake) = 0;
   virtual bool get_audio_archive() = 0;
   virtual void set_audio_archive(bool) = 0;
   virtual bool get_transmission_archive() = 0;
@@ -86,6 +99,17 @@ public:
   virtual bool get_star_enabled() = 0;
   virtual bool get_tps_enabled() = 0;
   virtual bool get_dcs_enabled() = 0;
+  virtual void set_signal_decoder_names(std::vector<std::string> names) = 0;
+  virtual std::vector<std::string> get_signal_decoder_names() = 0;
+  virtual unsigned int get_signal_decoders() = 0;
+  virtual void set_tone_squelch_gate(bool b) = 0;
+  virtual bool get_tone_squelch_gate() = 0;
+  virtual void set_low_latency(bool b) = 0;
+  virtual bool get_low_latency() = 0;
+  virtual void set_control_channel_only(bool b) = 0;
+  virtual bool get_control_channel_only() = 0;
+  virtual void set_pre_tune_recorders(int n) = 0;
+  virtual int get_pre_tune_recorders() = 0;
 
   virtual void set_analog_levels(double r) = 0;
   virtual double get_analog_levels() = 0;
@@ -103,6 +127,7 @@ public:
   virtual double get_filter_width() = 0;
   virtual gr::msg_queue::sptr get_msg_queue() = 0;
   virtual std::string get_system_type() = 0;
+  virtual TrunkParser *get_parser() = 0;
   virtual unsigned long get_sys_id() = 0;
   virtual unsigned long get_wacn() = 0;
   virtual unsigned long get_nac() = 0;
@@ -120,6 +145,8 @@ public:
   virtual void set_source(Source *) = 0;
   virtual Talkgroup *find_talkgroup(long tg) = 0;
   virtual Talkgroup *find_talkgroup_by_freq(double freq) = 0;
+  virtual Talkgroup *find_talkgroup_by_dcs(double freq, int dcs_code, bool dcs_inverted) = 0;
+  virtual Talkgroup *find_talkgroup_by_ctcss(double freq, double tone) = 0;
   virtual std::string find_unit_tag(long unitID) = 0;
   virtual void set_talkgroups_file(std::string) = 0;
   virtual void set_channel_file(std::string channel_file) = 0;
@@ -136,6 +163,7 @@ public:
   virtual void add_control_channel(double channel) = 0;
   virtual double get_next_control_channel() = 0;
   virtual double get_current_control_channel() = 0;
+  virtual void set_current_control_channel(double channel) = 0;
   virtual int channel_count() = 0;
   virtual int get_message_count() = 0;
   virtual void set_message_count(int count) = 0;
@@ -150,9 +178,13 @@ public:
   virtual std::vector<sigmf_recorder_sptr> get_conventionalSIGMF_recorders() = 0;
   virtual std::vector<p25_recorder_sptr> get_conventionalP25_recorders() = 0;
   virtual std::vector<dmr_recorder_sptr> get_conventionalDMR_recorders() = 0;
+  virtual void remove_conventional_recorder(Recorder *rec) = 0;
   virtual std::vector<double> get_channels() = 0;
   virtual std::vector<double> get_control_channels() = 0;
   virtual std::vector<Talkgroup *> get_talkgroups() = 0;
+  // Reads the talkgroup, channel and unit tag files again and swaps them in,
+  // keeping what was there if one of them has a problem
+  virtual bool reload_tables() = 0;
   virtual std::vector<UnitTag *> get_unit_tags() = 0;
   virtual std::vector<UnitTagOTA *> get_unit_tags_ota() = 0;
   virtual void set_bandplan(std::string) = 0;
@@ -178,6 +210,10 @@ public:
   virtual bool get_hideUnknown() = 0;
   virtual void set_hideUnknown(bool hideUnknown) = 0;
 
+  // A disabled System's messages are still parsed, but nothing is recorded
+  virtual bool get_enabled() = 0;
+  virtual void set_enabled(bool enabled) = 0;
+
   virtual int get_freq_error() = 0;
   virtual void finetune_control_freq(double f) = 0;
   virtual int get_autotune_offset() = 0;
@@ -1,5 +1,15 @@
 #include "system_impl.h"
 #include "system.h"
+#include "p25_parser.h"
+#include "smartnet_parser.h"
+#include "../gr_blocks/decoders/signal_decoder_sink.h"
+#include "../state_checkpoint.h"
+#include <algorithm>
+
+// seconds without a patch message before a talkgroup drops out of its patch, hard coded for now
+static const std::time_t TALKGROUP_PATCH_TIMEOUT = 10;
+// seconds a table replaced by reload_tables() is kept before it is freed
+static const std::time_t RETIRED_TABLE_SECONDS = 60;
 
 System *System::make(int sys_num) {
   return (System *)new System_impl(sys_num);
@@ -77,6 +87,54 @@ void System_impl::set_min_tx_duration(double duration) {
   this->min_transmission_duration = duration;
 }
 
+double System_impl::get_max_silence() {
+  return this->max_silence;
+}
+
+void System_impl::set_max_silence(double seconds) {
+  this->max_silence = seconds;
+}
+
+int System_impl::get_silence_level() {
+  return this->silence_level;
+}
+
+void System_impl::set_silence_level(int level) {
+  this->silence_level = level;
+}
+
+int System_impl::get_admission_priority() {
+  return this->admission_priority;
+}
+
+void System_impl::set_admission_priority(int priority) {
+  this->admission_priority = priority;
+}
+
+double System_impl::get_control_iq_ring_seconds() {
+  return this->control_iq_ring_seconds;
+}
+
+void System_impl::set_control_iq_ring_seconds(double seconds) {
+  this->control_iq_ring_seconds = seconds;
+}
+
+double System_impl::get_control_iq_dump_rate() {
+  return this->control_iq_dump_rate;
+}
+
+void System_impl::set_control_iq_dump_rate(double rate) {
+  this->control_iq_dump_rate = rate;
+}
+
+bool System_impl::get_sync_wake() {
+  return this->d_sync_wake;
+}
+
+void System_impl::set_sync_wake(bool sync_wake) {
+  this->d_sync_wake = sync_wake;
+}
+
 System_impl::System_impl(int sys_num) {
   this->sys_num = sys_num;
   sys_id = 0;
@@ -95,11 +153,23 @@ System_impl::System_impl(int sys_num) {
   d_hideEncrypted = false;
   d_monitorEncrypted = false;
   d_hideUnknown = false;
+  d_enabled = true;
   d_mdc_enabled = false;
   d_fsync_enabled = false;
   d_star_enabled = false;
   d_tps_enabled = false;
   d_dcs_enabled = false;
+  d_tone_squelch_gate = false;
+  d_low_latency = false;
+  d_control_channel_only = false;
+  d_pre_tune_recorders = 0;
+  max_silence = 0;
+  silence_level = 64;
+  admission_priority = 1;
+  control_iq_ring_seconds = 0;
+  control_iq_dump_rate = 2;
+  control_iq_dumped = false;
+  d_sync_wake = false;
   retune_attempts = 0;
   message_count = 0;
   decode_rate = 0;
@@ -113,8 +183,7 @@ void System_impl::set_xor_mask(unsigned long sys_id, unsigned long wacn, unsigne
     this->nac = nac;
     BOOST_LOG_TRIVIAL(info) << "Setting XOR Mask: System_impl ID " << std::dec << sys_id << " WACN: " << wacn << " NAC: " << nac << std::dec;
     if (sys_id && wacn && nac) {
-      lfsr = new p25p2_lfsr(nac, sys_id, wacn);
-      xor_mask = lfsr->getXorChars(xor_mask_len);
+      xor_mask = p25p2_lfsr::getXorChars(nac, sys_id, wacn, xor_mask_len);
 
       BOOST_LOG_TRIVIAL(info) << "XOR Mask len: " << xor_mask_len;
       for (unsigned i = 0; i < xor_mask_len; i++) {
@@ -132,8 +201,7 @@ bool System_impl::update_status(TrunkMessage message) {
                             << std::hex << std::uppercase << message.sys_id << " WACN: "
                             << std::hex << std::uppercase << message.wacn << " NAC: " << std::hex << std::uppercase << message.nac;
     if (sys_id && wacn && nac) {
-      lfsr = new p25p2_lfsr(nac, sys_id, wacn);
-      xor_mask = lfsr->getXorChars(xor_mask_len);
+      xor_mask = p25p2_lfsr::getXorChars(nac, sys_id, wacn, xor_mask_len);
       /*
      BOOST_LOG_TRIVIAL(info) << "XOR Mask len: " << xor_mask_len;
      for (unsigned i=0; i<xor_mask_len; i++) {
@@ -158,6 +226,63 @@ bool System_impl::update_sysid(TrunkMessage message) {
   return false;
 }
 
+void System_impl::save_state(Checkpoint_Writer &out) {
+  out.put_u64(sys_id);
+  out.put_u64(wacn);
+  out.put_u64(nac);
+  out.put_i64(sys_rfss);
+  out.put_i64(sys_site_id);
+  size_t count = 0;
+  for (std::map<unsigned long, std::map<unsigned long, std::time_t>>::iterator sg = talkgroup_patches.begin(); sg != talkgroup_patches.end(); ++sg) {
+    count += sg->second.size();
+  }
+  out.put_u32(count);
+  for (std::map<unsigned long, std::map<unsigned long, std::time_t>>::iterator sg = talkgroup_patches.begin(); sg != talkgroup_patches.end(); ++sg) {
+    for (std::map<unsigned long, std::time_t>::iterator tg = sg->second.begin(); tg != sg->second.end(); ++tg) {
+      out.put_u64(sg->first);
+      out.put_u64(tg->first);
+      out.put_i64(tg->second);
+    }
+  }
+}
+
+// The IDs from the config are kept, and patch members that would have gone
+// stale since they were saved are left out
+bool System_impl::restore_state(Checkpoint_Reader &in) {
+  unsigned long saved_sys_id = in.get_u64();
+  unsigned long saved_wacn = in.get_u64();
+  unsigned long saved_nac = in.get_u64();
+  int saved_rfss = in.get_i64();
+  int saved_site_id = in.get_i64();
+  std::time_t now = std::time(nullptr);
+  for (std::uint32_t count = in.get_u32(); in.ok() && (count > 0); count--) {
+    unsigned long sg = in.get_u64();
+    unsigned long tg = in.get_u64();
+    std::time_t update_time = in.get_i64();
+    if (in.ok() && (now - update_time < TALKGROUP_PATCH_TIMEOUT)) {
+      refresh_talkgroup_patch_member(sg, tg, update_time);
+    }
+  }
+  if (!in.ok()) {
+    return false;
+  }
+
+  if (!sys_id && !wacn && !nac && saved_sys_id && saved_wacn && saved_nac) {
+    sys_id = saved_sys_id;
+    wacn = saved_wacn;
+    nac = saved_nac;
+    xor_mask = p25p2_lfsr::getXorChars(nac, sys_id, wacn, xor_mask_len);
+    BOOST_LOG_TRIVIAL(info) << "[" << short_name << "]\tRestored System ID "
+                            << std::hex << std::uppercase << sys_id << " WACN: "
+                            << std::hex << std::uppercase << wacn << " NAC: " << std::hex << std::uppercase << nac << std::dec;
+  }
+  if (!sys_rfss && !sys_site_id) {
+    sys_rfss = saved_rfss;
+    sys_site_id = saved_site_id;
+  }
+  return true;
+}
+
  gr::msg_queue::sptr System_impl::get_msg_queue() {
   return msg_queue;
  }
@@ -266,6 +391,41 @@ bool System_impl::get_star_enabled() { return d_star_enabled; };
 bool System_impl::get_tps_enabled() { return d_tps_enabled; };
 bool System_impl::get_dcs_enabled() { return d_dcs_enabled; };
 
+void System_impl::set_signal_decoder_names(std::vector<std::string> names) { d_signal_decoder_names = names; }
+std::vector<std::string> System_impl::get_signal_decoder_names() { return d_signal_decoder_names; }
+
+// The signal_decoder_sink decoders analog recorders on this system need.
+// Registered decoders are looked up each time, as plugins register theirs
+// after the config is read.
+unsigned int System_impl::get_signal_decoders() {
+  unsigned int mask = 0;
+  if (d_dcs_enabled) {
+    mask |= gr::blocks::SIGNAL_DECODER_DCS;
+  }
+  if (d_mdc_enabled) {
+    mask |= gr::blocks::SIGNAL_DECODER_MDC;
+  }
+  if (d_fsync_enabled) {
+    mask |= gr::blocks::SIGNAL_DECODER_FSYNC;
+  }
+  if (d_star_enabled) {
+    mask |= gr::blocks::SIGNAL_DECODER_STAR;
+  }
+  for (const std::string &name : d_signal_decoder_names) {
+    mask |= gr::blocks::find_signal_decoder(name);
+  }
+  return mask;
+}
+
+void System_impl::set_tone_squelch_gate(bool b) { d_tone_squelch_gate = b; }
+bool System_impl::get_tone_squelch_gate() { return d_tone_squelch_gate; }
+void System_impl::set_low_latency(bool b) { d_low_latency = b; }
+bool System_impl::get_low_latency() { return d_low_latency; }
+void System_impl::set_control_channel_only(bool b) { d_control_channel_only = b; }
+bool System_impl::get_control_channel_only() { return d_control_channel_only; }
+void System_impl::set_pre_tune_recorders(int n) { d_pre_tune_recorders = n; }
+int System_impl::get_pre_tune_recorders() { return d_pre_tune_recorders; }
+
 bool System_impl::get_audio_archive() {
   return this->audio_archive;
 }
@@ -298,6 +458,20 @@ void System_impl::set_system_type(std::string sys_type) {
   this->system_type = sys_type;
 }
 
+// Made the first time it is asked for, once the system is configured, by
+// monitor_messages() before any system worker starts. NULL for conventional
+// systems.
+TrunkParser *System_impl::get_parser() {
+  if (!parser) {
+    if (system_type == "smartnet") {
+      parser.reset(new SmartnetParser(this));
+    } else if (system_type == "p25") {
+      parser.reset(new P25Parser());
+    }
+  }
+  return parser.get();
+}
+
 std::string System_impl::get_talkgroups_file() {
   return this->talkgroups_file;
 }
@@ -309,7 +483,9 @@ std::string System_impl::get_unit_tags_file() {
 void System_impl::set_channel_file(std::string channel_file) {
   BOOST_LOG_TRIVIAL(info) << "Loading Talkgroups...";
   this->channel_file = channel_file;
-  this->talkgroups->load_channels(sys_num, channel_file);
+  if (!this->talkgroups.load()->load_channels(sys_num, channel_file)) {
+    exit(0);
+  }
   for (auto& tg : this->get_talkgroups()) {
     this->add_channel(tg->freq);
   }
@@ -326,7 +502,9 @@ bool System_impl::has_channel_file() {
 void System_impl::set_talkgroups_file(std::string talkgroups_file) {
   BOOST_LOG_TRIVIAL(info) << "Loading Talkgroups...";
   this->talkgroups_file = talkgroups_file;
-  this->talkgroups->load_talkgroups(sys_num, talkgroups_file);
+  if (!this->talkgroups.load()->load_talkgroups(sys_num, talkgroups_file)) {
+    exit(0);
+  }
 }
 
 void System_impl::set_unit_tags_file(std::string unit_tags_file) {
@@ -386,11 +564,19 @@ void System_impl::set_source(Source *s) {
 }
 
 Talkgroup *System_impl::find_talkgroup(long tg_number) {
-  return talkgroups->find_talkgroup(sys_num, tg_number);
+  return talkgroups.load()->find_talkgroup(sys_num, tg_number);
 }
 
 Talkgroup *System_impl::find_talkgroup_by_freq(double freq) {
-  return talkgroups->find_talkgroup_by_freq(sys_num, freq);
+  return talkgroups.load()->find_talkgroup_by_freq(sys_num, freq);
+}
+
+Talkgroup *System_impl::find_talkgroup_by_dcs(double freq, int dcs_code, bool dcs_inverted) {
+  return talkgroups.load()->find_talkgroup_by_dcs(sys_num, freq, dcs_code, dcs_inverted);
+}
+
+Talkgroup *System_impl::find_talkgroup_by_ctcss(double freq, double tone) {
+  return talkgroups.load()->find_talkgroup_by_ctcss(sys_num, freq, tone);
 }
 std::string System_impl::find_unit_tag(long unitID) {
   return unit_tags->find_unit_tag(unitID);
@@ -401,7 +587,56 @@ std::vector<double> System_impl::get_channels() {
 }
 
 std::vector<Talkgroup *> System_impl::get_talkgroups() {
-  return talkgroups->get_talkgroups();
+  return talkgroups.load()->get_talkgroups();
+}
+
+bool System_impl::reload_tables() {
+  std::time_t now = std::time(nullptr);
+  bool reloaded = true;
+
+  // A Talkgroup is only used for as long as it takes to handle a grant or
+  // conclude a call, so a minute after a reload the old tables can go
+  while (!retired_talkgroups.empty() && (now - retired_talkgroups.front().first >= RETIRED_TABLE_SECONDS)) {
+    delete retired_talkgroups.front().second;
+    retired_talkgroups.erase(retired_talkgroups.begin());
+  }
+  while (!retired_unit_tags.empty() && (now - retired_unit_tags.front().first >= RETIRED_TABLE_SECONDS)) {
+    delete retired_unit_tags.front().second;
+    retired_unit_tags.erase(retired_unit_tags.begin());
+  }
+
+  if ((talkgroups_file != "") || (channel_file != "")) {
+    Talkgroups *fresh = new Talkgroups();
+    bool loaded = false;
+    try {
+      loaded = fresh->load_channels(sys_num, channel_file) && fresh->load_talkgroups(sys_num, talkgroups_file);
+    } catch (std::exception &e) {
+      BOOST_LOG_TRIVIAL(error) << "[" << short_name << "]\tError reloading talkgroups: " << e.what();
+    }
+    if (loaded) {
+      retired_talkgroups.push_back(std::make_pair(now, talkgroups.exchange(fresh)));
+      BOOST_LOG_TRIVIAL(info) << "[" << short_name << "]\tReloaded talkgroups";
+    } else {
+      delete fresh;
+      BOOST_LOG_TRIVIAL(error) << "[" << short_name << "]\tKeeping the talkgroups that were already loaded";
+      reloaded = false;
+    }
+  }
+
+  if (unit_tags_file != "") {
+    UnitTags *fresh = new UnitTags();
+    if (fresh->load_unit_tags(unit_tags_file)) {
+      // fresh ends up with the old user tags, the OTA aliases stay where they are
+      unit_tags->replace_user_tags(*fresh);
+      retired_unit_tags.push_back(std::make_pair(now, fresh));
+      BOOST_LOG_TRIVIAL(info) << "[" << short_name << "]\tReloaded unit tags";
+    } else {
+      delete fresh;
+      BOOST_LOG_TRIVIAL(error) << "[" << short_name << "]\tKeeping the unit tags that were already loaded";
+      reloaded = false;
+    }
+  }
+  return reloaded;
 }
 
 std::vector<UnitTag *> System_impl::get_unit_tags() {
@@ -418,6 +653,20 @@ std::vector<UnitTagOTA *> System_impl::get_unit_tags_ota() {
   return std::vector<UnitTagOTA *>();
 }
 
+// The tables of the System, each named for it
+std::vector<Memory_Usage> System_impl::get_memory_usage() {
+  std::vector<Memory_Usage> usage;
+  usage.push_back(talkgroups.load()->get_memory_usage());
+  if (unit_tags) {
+    std::vector<Memory_Usage> tags = unit_tags->get_memory_usage();
+    usage.insert(usage.end(), tags.begin(), tags.end());
+  }
+  for (std::vector<Memory_Usage>::iterator it = usage.begin(); it != usage.end(); ++it) {
+    it->name = "[" + short_name + "] " + it->name;
+  }
+  return usage;
+}
+
 int System_impl::channel_count() {
   return channels.size();
 }
@@ -453,6 +702,24 @@ std::vector<dmr_recorder_sptr> System_impl::get_conventionalDMR_recorders() {
   return conventionalDMR_recorders;
 }
 
+// For a conventional channel removed at runtime
+template <typename T>
+static void remove_recorder(std::vector<T> &recorders, Recorder *rec) {
+  for (typename std::vector<T>::iterator it = recorders.begin(); it != recorders.end(); ++it) {
+    if ((Recorder *)it->get() == rec) {
+      recorders.erase(it);
+      return;
+    }
+  }
+}
+
+void System_impl::remove_conventional_recorder(Recorder *rec) {
+  remove_recorder(conventional_recorders, rec);
+  remove_recorder(conventionalP25_recorders, rec);
+  remove_recorder(conventionalDMR_recorders, rec);
+  remove_recorder(conventionalSIGMF_recorders, rec);
+}
+
 void System_impl::add_channel(double channel) {
   if (channels.size() == 0) {
     channels.push_back(channel);
@@ -509,6 +776,16 @@ double System_impl::get_next_control_channel() {
   return this->control_channels[current_control_channel];
 }
 
+// Moves to one of the control channels, so the stepping carries on from it
+void System_impl::set_current_control_channel(double channel) {
+  for (unsigned int i = 0; i < control_channels.size(); i++) {
+    if (control_channels[i] == channel) {
+      current_control_channel = i;
+      return;
+    }
+  }
+}
+
 void System_impl::set_conversation_mode(bool mode) {
   this->conversation_mode = mode;
 }
@@ -594,6 +871,14 @@ void System_impl::set_hideUnknown(bool hideUnknown) {
   d_hideUnknown = hideUnknown;
 }
 
+bool System_impl::get_enabled() {
+  return d_enabled;
+}
+
+void System_impl::set_enabled(bool enabled) {
+  d_enabled = enabled;
+}
+
 int System_impl::get_freq_error() {
   if (p25_trunking) {
     return p25_trunking->get_freq_error();
@@ -651,93 +936,106 @@ boost::property_tree::ptree System_impl::get_stats_current(float timeDiff) {
 std::vector<unsigned long> System_impl::get_talkgroup_patch(unsigned long talkgroup) {
   // Given a single TGID, return a vector of TGIDs that are part of the same patch
   std::vector<unsigned long> patched_tgids;
-  BOOST_FOREACH (auto &patch, talkgroup_patches) {
-    if (patch.second.find(talkgroup) != patch.second.end()) {
-      // talkgroup passed in is part of this patch, so add all talkgroups from this patch to our output vector
-      BOOST_FOREACH (auto &patch_element, patch.second) {
-        patched_tgids.push_back(patch_element.first);
-      }
+  std::unordered_map<unsigned long, std::vector<unsigned long>>::const_iterator index = talkgroup_patch_index.find(talkgroup);
+  if (index == talkgroup_patch_index.end()) {
+    return patched_tgids;
+  }
+  BOOST_FOREACH (unsigned long sg, index->second) {
+    // talkgroup passed in is part of this patch, so add all talkgroups from this patch to our output vector
+    BOOST_FOREACH (auto &patch_element, talkgroup_patches[sg]) {
+      patched_tgids.push_back(patch_element.first);
     }
   }
   return patched_tgids;
 }
 
-void System_impl::update_active_talkgroup_patches(PatchData patch_data) {
-  std::time_t update_time = std::time(nullptr);
-  bool new_flag = true;
+void System_impl::refresh_talkgroup_patch_member(unsigned long sg, unsigned long tg, std::time_t update_time) {
+  std::pair<std::map<unsigned long, std::time_t>::iterator, bool> member = talkgroup_patches[sg].insert(std::make_pair(tg, update_time));
+  if (!member.second) {
+    // already in the patch, its entry in the expiry heap will notice the new time
+    member.first->second = update_time;
+    return;
+  }
+  std::vector<unsigned long> &sgs = talkgroup_patch_index[tg];
+  sgs.insert(std::lower_bound(sgs.begin(), sgs.end(), sg), sg);
+  talkgroup_patch_expiry.push({update_time + TALKGROUP_PATCH_TIMEOUT, sg, tg});
+}
 
-  BOOST_FOREACH (auto &patch, talkgroup_patches) {
-    if (patch.first == patch_data.sg) {
-      new_flag = false;
-      if (0 != patch_data.sg) {
-        patch.second[patch_data.sg] = update_time;
-      }
-      if (0 != patch_data.ga1) {
-        patch.second[patch_data.ga1] = update_time;
-      }
-      if (0 != patch_data.ga2) {
-        patch.second[patch_data.ga2] = update_time;
-      }
-      if (0 != patch_data.ga3) {
-        patch.second[patch_data.ga3] = update_time;
-      }
+void System_impl::remove_talkgroup_patch_member(unsigned long sg, unsigned long tg) {
+  // its entry in the expiry heap is left to find it gone
+  std::map<unsigned long, std::map<unsigned long, std::time_t>>::iterator patch = talkgroup_patches.find(sg);
+  if ((patch == talkgroup_patches.end()) || (patch->second.erase(tg) == 0)) {
+    return;
+  }
+  std::unordered_map<unsigned long, std::vector<unsigned long>>::iterator index = talkgroup_patch_index.find(tg);
+  if (index != talkgroup_patch_index.end()) {
+    index->second.erase(std::remove(index->second.begin(), index->second.end(), sg), index->second.end());
+    if (index->second.empty()) {
+      talkgroup_patch_index.erase(index);
     }
   }
-  if (new_flag == true) {
+  if (patch->second.empty()) {
+    BOOST_LOG_TRIVIAL(debug) << "Going to remove entire patch with sg id " << sg;
+    talkgroup_patches.erase(patch);
+  }
+}
+
+void System_impl::update_active_talkgroup_patches(PatchData patch_data) {
+  std::time_t update_time = std::time(nullptr);
+
+  if (talkgroup_patches.find(patch_data.sg) == talkgroup_patches.end()) {
     // TGIDs from the Message were not found in an existing patch, so add them to a new one
     BOOST_LOG_TRIVIAL(debug) << "tsbk00\tNew Motorola patch fround, \tsg: " << patch_data.sg << "\tga1: " << patch_data.ga1 << "\tga2: " << patch_data.ga2 << "\tga3: " << patch_data.ga3;
-    std::map<unsigned long, std::time_t> new_patch;
-    if (0 != patch_data.sg) {
-      new_patch[patch_data.sg] = update_time;
-    }
-    if (0 != patch_data.ga1) {
-      new_patch[patch_data.ga1] = update_time;
-    }
-    if (0 != patch_data.ga2) {
-      new_patch[patch_data.ga2] = update_time;
-    }
-    if (0 != patch_data.ga3) {
-      new_patch[patch_data.ga3] = update_time;
-    }
-    talkgroup_patches[patch_data.sg] = new_patch;
+  }
+  if (0 != patch_data.sg) {
+    refresh_talkgroup_patch_member(patch_data.sg, patch_data.sg, update_time);
+  }
+  if (0 != patch_data.ga1) {
+    refresh_talkgroup_patch_member(patch_data.sg, patch_data.ga1, update_time);
+  }
+  if (0 != patch_data.ga2) {
+    refresh_talkgroup_patch_member(patch_data.sg, patch_data.ga2, update_time);
+  }
+  if (0 != patch_data.ga3) {
+    refresh_talkgroup_patch_member(patch_data.sg, patch_data.ga3, update_time);
   }
 }
 
 void System_impl::delete_talkgroup_patch(PatchData patch_data) {
-  BOOST_FOREACH (auto &patch, talkgroup_patches) {
-    if (patch.first == patch_data.sg) {
-      patch.second.erase(patch_data.ga1);
-      patch.second.erase(patch_data.ga2);
-      patch.second.erase(patch_data.ga3);
-    }
-  }
+  remove_talkgroup_patch_member(patch_data.sg, patch_data.ga1);
+  remove_talkgroup_patch_member(patch_data.sg, patch_data.ga2);
+  remove_talkgroup_patch_member(patch_data.sg, patch_data.ga3);
 }
 
 void System_impl::clear_stale_talkgroup_patches() {
-  std::vector<unsigned long> stale_patches;
+  std::time_t now = std::time(nullptr);
+  bool changed = false;
 
-  BOOST_FOREACH (auto &patch, talkgroup_patches) {
-    // patch.first (map key) is supergroup TGID, patch.second (map value) is the map of all TGIDs in this patch and associated timestamps
-    std::vector<unsigned long> stale_talkgroups;
-    BOOST_FOREACH (auto &patch_element, patch.second) {
-      // patch_element.first (map key) is TGID, patch.second (map value) is the timestamp
-      if (std::time(nullptr) - patch_element.second >= 10) { // 10 second hard coded timeout for now
-        stale_talkgroups.push_back(patch_element.first);     // add this tgid to the list that we'll delete from this patch since it's expired
-      }
+  while (!talkgroup_patch_expiry.empty() && (talkgroup_patch_expiry.top().time <= now)) {
+    Patch_Expiry expiry = talkgroup_patch_expiry.top();
+    talkgroup_patch_expiry.pop();
+
+    std::map<unsigned long, std::map<unsigned long, std::time_t>>::iterator patch = talkgroup_patches.find(expiry.sg);
+    if (patch == talkgroup_patches.end()) {
+      continue;
     }
-    BOOST_FOREACH (auto &stale_talkgroup, stale_talkgroups) {
-      BOOST_LOG_TRIVIAL(debug) << "Going to remove stale TGID " << stale_talkgroup << "from patch with sg id " << patch.first;
-      patch.second.erase(stale_talkgroup);
+    std::map<unsigned long, std::time_t>::iterator member = patch->second.find(expiry.tg);
+    if (member == patch->second.end()) {
+      continue;
     }
-    if (patch.second.size() == 0) {
-      stale_patches.push_back(patch.first); // This patch is not empty, so add it to the list of patches we'll delete
+    if (now - member->second < TALKGROUP_PATCH_TIMEOUT) {
+      // heard again since it was queued
+      talkgroup_patch_expiry.push({member->second + TALKGROUP_PATCH_TIMEOUT, expiry.sg, expiry.tg});
+      continue;
     }
-  }
-  BOOST_FOREACH (auto &stale_patch, stale_patches) {
-    BOOST_LOG_TRIVIAL(debug) << "Going to remove entire patch with sg id " << stale_patch;
-    talkgroup_patches.erase(stale_patch);
+    BOOST_LOG_TRIVIAL(debug) << "Going to remove stale TGID " << expiry.tg << "from patch with sg id " << expiry.sg;
+    remove_talkgroup_patch_member(expiry.sg, expiry.tg);
+    changed = true;
   }
 
+  if (!changed) {
+    return;
+  }
   // Print out all active patches to the console
   BOOST_LOG_TRIVIAL(debug) << "Found " << talkgroup_patches.size() << " active talkgroup patches:";
   BOOST_FOREACH (auto &patch, talkgroup_patches) {
@@ -25,6 +25,12 @@
 #endif
 
 #include <boost/property_tree/ptree.hpp>
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
 
 class Source;
 class analog_recorder;
@@ -51,11 +57,11 @@ class System_impl : public System {
   unsigned long nac;
   int sys_rfss;
   int sys_site_id;
+  std::unique_ptr<TrunkParser> parser;
 
 public:
-  Talkgroups *talkgroups;
+  std::atomic<Talkgroups *> talkgroups; // swapped whole by reload_tables()
   UnitTags *unit_tags;
-  p25p2_lfsr *lfsr;
   Source *source;
   std::string talkgroups_file;
   std::string channel_file;
@@ -86,6 +92,13 @@ public:
   double min_call_duration;
   double max_call_duration;
   double min_transmission_duration;
+  double max_silence;
+  int silence_level;
+  int admission_priority;
+  double control_iq_ring_seconds;
+  double control_iq_dump_rate;
+  bool control_iq_dumped; // since the decode rate was last above control_iq_dump_rate
+  bool d_sync_wake;
   bool compress_wav;
   bool conversation_mode;
   bool qpsk_mod;
@@ -111,6 +124,7 @@ public:
   smartnet_impl::sptr smartnet_trunking;
   p25_trunking_sptr p25_trunking;
 
+  // supergroup -> member talkgroups and when each was last heard in a patch message
   std::map<unsigned long, std::map<unsigned long, std::time_t>> talkgroup_patches;
 
   std::string get_short_name() override;
@@ -131,6 +145,18 @@ public:
   void set_max_duration(double duration) override;
   double get_min_tx_duration() override;
   void set_min_tx_duration(double duration) override;
+  double get_max_silence() override;
+  void set_max_silence(double seconds) override;
+  int get_silence_level() override;
+  void set_silence_level(int level) override;
+  int get_admission_priority() override;
+  void set_admission_priority(int priority) override;
+  double get_control_iq_ring_seconds() override;
+  void set_control_iq_ring_seconds(double seconds) override;
+  double get_control_iq_dump_rate() override;
+  void set_control_iq_dump_rate(double rate) override;
+  bool get_sync_wake() override;
+  void set_sync_wake(bool sync_wake) override;
   bool get_audio_archive() override;
   void set_audio_archive(bool) override;
   bool get_transmission_archive() override;
@@ -152,6 +178,17 @@ public:
   bool get_star_enabled() override;
   bool get_tps_enabled() override;
   bool get_dcs_enabled() override;
+  void set_signal_decoder_names(std::vector<std::string> names) override;
+  std::vector<std::string> get_signal_decoder_names() override;
+  unsigned int get_signal_decoders() override;
+  void set_tone_squelch_gate(bool b) override;
+  bool get_tone_squelch_gate() override;
+  void set_low_latency(bool b) override;
+  bool get_low_latency() override;
+  void set_control_channel_only(bool b) override;
+  bool get_control_channel_only() override;
+  void set_pre_tune_recorders(int n) override;
+  int get_pre_tune_recorders() override;
 
   void set_analog_levels(double r) override;
   double get_analog_levels() override;
@@ -169,6 +206,7 @@ public:
   double get_filter_width() override;
   gr::msg_queue::sptr get_msg_queue() override;
   std::string get_system_type() override;
+  TrunkParser *get_parser() override;
   unsigned long get_sys_id() override;
   unsigned long get_wacn() override;
   unsigned long get_nac() override;
@@ -178,6 +216,9 @@ public:
   const char *get_xor_mask() override;
   bool update_status(TrunkMessage message) override;
   bool update_sysid(TrunkMessage message) override;
+  // Its IDs and patches, for a State_Checkpoint
+  void save_state(Checkpoint_Writer &out);
+  bool restore_state(Checkpoint_Reader &in);
   int get_sys_num() override;
   void set_system_type(std::string) override;
   std::string get_talkgroups_file() override;
@@ -186,6 +227,8 @@ public:
   void set_source(Source *) override;
   Talkgroup *find_talkgroup(long tg) override;
   Talkgroup *find_talkgroup_by_freq(double freq) override;
+  Talkgroup *find_talkgroup_by_dcs(double freq, int dcs_code, bool dcs_inverted) override;
+  Talkgroup *find_talkgroup_by_ctcss(double freq, double tone) override;
   std::string find_unit_tag(long unitID) override;
   void set_talkgroups_file(std::string) override;
   void set_channel_file(std::string channel_file) override;
@@ -206,6 +249,7 @@ public:
   void add_control_channel(double channel) override;
   double get_next_control_channel() override;
   double get_current_control_channel() override;
+  void set_current_control_channel(double channel) override;
   int channel_count() override;
   void add_channel(double channel) override;
   void add_conventional_recorder(analog_recorder_sptr rec) override;
@@ -216,11 +260,15 @@ public:
   std::vector<analog_recorder_sptr> get_conventional_recorders() override;
   std::vector<sigmf_recorder_sptr> get_conventionalSIGMF_recorders() override;
   std::vector<dmr_recorder_sptr> get_conventionalDMR_recorders() override;
+  void remove_conventional_recorder(Recorder *rec) override;
   std::vector<double> get_channels() override;
   std::vector<double> get_control_channels() override;
   std::vector<Talkgroup *> get_talkgroups() override;
+  bool reload_tables() override;
   std::vector<UnitTag *> get_unit_tags() override;
   std::vector<UnitTagOTA *> get_unit_tags_ota() override;
+  // Its talkgroup and unit tag tables, for the Memory_Report
+  std::vector<Memory_Usage> get_memory_usage();
   gr::msg_queue::sptr msg_queue;
   System_impl(int sys_id);
   void set_bandplan(std::string) override;
@@ -245,6 +293,8 @@ public:
 
   bool get_hideUnknown() override;
   void set_hideUnknown(bool hideUnknown) override;
+  bool get_enabled() override;
+  void set_enabled(bool enabled) override;
 
   int get_freq_error() override;
   void finetune_control_freq(double f) override;
@@ -276,6 +326,7 @@ private:
   bool d_hideEncrypted;
   bool d_monitorEncrypted;
   bool d_hideUnknown;
+  bool d_enabled;
   bool d_multiSite;
   std::string d_multiSiteSystemName;
   unsigned long d_multiSiteSystemNumber;
@@ -285,5 +336,38 @@ private:
   bool d_star_enabled;
   bool d_tps_enabled;
   bool d_dcs_enabled;
+  std::vector<std::string> d_signal_decoder_names;
+  bool d_tone_squelch_gate;
+  bool d_low_latency;
+  bool d_control_channel_only;
+  int d_pre_tune_recorders;
+
+  /*
+   * Alongside talkgroup_patches: the supergroups each talkgroup is in, so a
+   * lookup doesn't walk every patch, and a min-heap of when each member
+   * goes stale. A member only has one entry in the heap; one that has been
+   * heard again since is put back with its new time when it comes up, so
+   * clearing stale patches only looks at members that are due. One that is
+   * deleted and comes back before its old entry is up has two until it goes
+   * stale, which only means an extra look.
+   */
+  struct Patch_Expiry {
+    std::time_t time;
+    unsigned long sg;
+    unsigned long tg;
+    bool operator>(const Patch_Expiry &other) const {
+      return time > other.time;
+    }
+  };
+  std::unordered_map<unsigned long, std::vector<unsigned long>> talkgroup_patch_index; // kept sorted by supergroup
+  std::priority_queue<Patch_Expiry, std::vector<Patch_Expiry>, std::greater<Patch_Expiry>> talkgroup_patch_expiry;
+
+  // Tables replaced by reload_tables(), kept until nothing can still be
+  // using a Talkgroup or UnitTag from them. Only reload_tables() touches these.
+  std::vector<std::pair<std::time_t, Talkgroups *>> retired_talkgroups;
+  std::vector<std::pair<std::time_t, UnitTags *>> retired_unit_tags;
+
+  void refresh_talkgroup_patch_member(unsigned long sg, unsigned long tg, std::time_t update_time);
+  void remove_talkgroup_patch_member(unsigned long sg, unsigned long tg);
 };
 #endif
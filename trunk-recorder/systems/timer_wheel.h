@@ -0,0 +1,62 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/*
+ * Timer_Wheel
+ *   Items that are due at some whole second, in one slot per second, so
+ *   expiring things only looks at what is due instead of walking every
+ *   table each time.
+ *
+ * There are Slots seconds of slots and an item can only be put up to
+ * Slots - 1 seconds ahead; one due further out is put in the last slot and
+ * comes round early. Either way the expire function should check whether
+ * the item really has expired, and schedule it again if it hasn't, which
+ * also covers things that were refreshed after they were scheduled.
+ *
+ * Times are seconds, the same clock for schedule() and advance(). If the
+ * clock jumps ahead everything due in between runs on the next advance().
+ */
+template <typename T, int Slots>
+class Timer_Wheel {
+public:
+  Timer_Wheel() : next(-1) {}
+
+  void schedule(double now, double seconds, const T &item) {
+    if (next < 0) {
+      next = (long long)now;
+    }
+    long long second = (long long)(now + seconds) + 1;
+    second = std::min(std::max(second, next), next + Slots - 1);
+    slots[second % Slots].push_back(item);
+  }
+
+  // expire(item) for everything that has come due by now
+  template <typename F>
+  void advance(double now, F expire) {
+    if (next < 0) {
+      return;
+    }
+    long long until = (long long)now;
+    for (int n = 0; (next <= until) && (n < Slots); n++) {
+      // next moves on first, so anything expire() puts back lands in a
+      // later slot instead of the one being run
+      due.swap(slots[next++ % Slots]);
+      for (size_t i = 0; i < due.size(); i++) {
+        expire(due[i]);
+      }
+      due.clear();
+    }
+    next = std::max(next, until + 1);
+  }
+
+private:
+  std::vector<T> slots[Slots];
+  std::vector<T> due;
+  long long next; // the second of the next slot to run, -1 until the first item
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,249 @@
+#include "table_cache.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CACHE_MAGIC[8] = {'T', 'R', 'T', 'A', 'B', 'L', 'E', '1'};
+
+struct Cache_Header {
+  char magic[8];
+  char kind[24];
+  std::uint64_t csv_size;
+  std::int64_t csv_mtime_ns;
+  std::uint64_t csv_hash;
+  std::uint32_t ints;
+  std::uint32_t strings;
+  std::uint64_t rows;
+  std::uint64_t string_count;
+  std::uint64_t string_bytes;
+};
+
+std::string Table_Cache::directory;
+
+static std::uint64_t fnv1a(std::uint64_t hash, const unsigned char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static const std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+
+static size_t align8(size_t n) {
+  return (n + 7) & ~(size_t)7;
+}
+
+Table_Cache::Writer::Writer(const std::string &csv_filename, int ints, int strings) : stamped(false), ints_per_row(ints), strings_per_row(strings), rows(0) {
+  if (enabled()) {
+    stamped = stamp(csv_filename, csv);
+  }
+}
+
+void Table_Cache::Writer::add(const std::int64_t *row_ints, const std::string *row_strings) {
+  ints.insert(ints.end(), row_ints, row_ints + ints_per_row);
+  for (int i = 0; i < strings_per_row; i++) {
+    std::pair<std::unordered_map<std::string, std::uint32_t>::iterator, bool> id = interned.insert(std::make_pair(row_strings[i], (std::uint32_t)strings.size()));
+    if (id.second) {
+      strings.push_back(row_strings[i]);
+    }
+    string_ids.push_back(id.first->second);
+  }
+  rows++;
+}
+
+Table_Cache::Reader::Reader() : map(NULL), map_size(0), ints_per_row(0), strings_per_row(0), rows(0), ints(NULL), string_ids(NULL), string_count(0), string_offsets(NULL), string_bytes(NULL) {}
+
+Table_Cache::Reader::~Reader() {
+  if (map) {
+    munmap(map, map_size);
+  }
+}
+
+double Table_Cache::Reader::get_double(size_t row, int field) const {
+  std::int64_t bits = get_int(row, field);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+std::string Table_Cache::Reader::get_string(size_t row, int field) const {
+  std::uint32_t id = string_ids[row * strings_per_row + field];
+  return std::string(string_bytes + string_offsets[id], string_offsets[id + 1] - string_offsets[id]);
+}
+
+void Table_Cache::set_directory(const std::string &dir) {
+  directory = dir;
+}
+
+bool Table_Cache::enabled() {
+  return !directory.empty();
+}
+
+std::int64_t Table_Cache::from_double(double value) {
+  std::int64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+bool Table_Cache::stamp(const std::string &csv_filename, Csv_Stamp &csv) {
+  struct stat st;
+  if (stat(csv_filename.c_str(), &st) != 0) {
+    return false;
+  }
+  csv.size = st.st_size;
+  csv.mtime_ns = (std::int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+  FILE *fp = fopen(csv_filename.c_str(), "rb");
+  if (!fp) {
+    return false;
+  }
+  unsigned char buffer[65536];
+  size_t len;
+  csv.hash = FNV_OFFSET;
+  while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    csv.hash = fnv1a(csv.hash, buffer, len);
+  }
+  fclose(fp);
+  return true;
+}
+
+std::string Table_Cache::cache_filename(const std::string &csv_filename, const std::string &kind) {
+  std::string path = boost::filesystem::absolute(csv_filename).string();
+  std::uint64_t hash = fnv1a(FNV_OFFSET, (const unsigned char *)path.data(), path.size());
+  char name[64];
+  snprintf(name, sizeof(name), "-%016llx.cache", (unsigned long long)hash);
+  return directory + "/" + boost::filesystem::path(csv_filename).filename().string() + "-" + kind + name;
+}
+
+bool Table_Cache::open(const std::string &csv_filename, const std::string &kind, int ints, int strings, Reader &reader) {
+  if (!enabled()) {
+    return false;
+  }
+  Csv_Stamp csv;
+  if (!stamp(csv_filename, csv)) {
+    return false;
+  }
+  std::string filename = cache_filename(csv_filename, kind);
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(Cache_Header))) {
+    ::close(fd);
+    return false;
+  }
+  size_t map_size = st.st_size;
+  void *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const Cache_Header *header = (const Cache_Header *)map;
+  char header_kind[sizeof(header->kind)] = {0};
+  strncpy(header_kind, kind.c_str(), sizeof(header_kind) - 1);
+  bool valid = (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0) &&
+               (memcmp(header->kind, header_kind, sizeof(header_kind)) == 0) &&
+               (header->csv_size == csv.size) && (header->csv_mtime_ns == csv.mtime_ns) && (header->csv_hash == csv.hash) &&
+               (header->ints == (std::uint32_t)ints) && (header->strings == (std::uint32_t)strings);
+
+  size_t ints_offset = align8(sizeof(Cache_Header));
+  size_t ids_offset = 0, offsets_offset = 0, bytes_offset = 0;
+  if (valid) {
+    ids_offset = ints_offset + header->rows * ints * sizeof(std::int64_t);
+    offsets_offset = align8(ids_offset + header->rows * strings * sizeof(std::uint32_t));
+    bytes_offset = offsets_offset + (header->string_count + 1) * sizeof(std::uint64_t);
+    valid = (bytes_offset + header->string_bytes == map_size);
+  }
+  if (valid) {
+    const std::uint32_t *ids = (const std::uint32_t *)((const char *)map + ids_offset);
+    const std::uint64_t *offsets = (const std::uint64_t *)((const char *)map + offsets_offset);
+    for (size_t i = 0; valid && (i < header->rows * strings); i++) {
+      valid = (ids[i] < header->string_count);
+    }
+    for (size_t i = 0; valid && (i < header->string_count); i++) {
+      valid = (offsets[i] <= offsets[i + 1]);
+    }
+    valid = valid && (offsets[header->string_count] == header->string_bytes);
+  }
+  if (!valid) {
+    munmap(map, map_size);
+    return false;
+  }
+
+  if (reader.map) {
+    munmap(reader.map, reader.map_size);
+  }
+  reader.map = map;
+  reader.map_size = map_size;
+  reader.ints_per_row = ints;
+  reader.strings_per_row = strings;
+  reader.rows = header->rows;
+  reader.ints = (const std::int64_t *)((const char *)map + ints_offset);
+  reader.string_ids = (const std::uint32_t *)((const char *)map + ids_offset);
+  reader.string_count = header->string_count;
+  reader.string_offsets = (const std::uint64_t *)((const char *)map + offsets_offset);
+  reader.string_bytes = (const char *)map + bytes_offset;
+  return true;
+}
+
+void Table_Cache::save(const std::string &csv_filename, const std::string &kind, const Writer &writer) {
+  if (!enabled() || !writer.stamped) {
+    return;
+  }
+  const Csv_Stamp &csv = writer.csv;
+
+  Cache_Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  strncpy(header.kind, kind.c_str(), sizeof(header.kind) - 1);
+  header.csv_size = csv.size;
+  header.csv_mtime_ns = csv.mtime_ns;
+  header.csv_hash = csv.hash;
+  header.ints = writer.ints_per_row;
+  header.strings = writer.strings_per_row;
+  header.rows = writer.rows;
+  header.string_count = writer.strings.size();
+
+  std::vector<std::uint64_t> offsets(1, 0);
+  for (size_t i = 0; i < writer.strings.size(); i++) {
+    offsets.push_back(offsets.back() + writer.strings[i].size());
+  }
+  header.string_bytes = offsets.back();
+
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory, ec);
+  std::string filename = cache_filename(csv_filename, kind);
+  std::string temp_filename = filename + ".tmp";
+  FILE *fp = fopen(temp_filename.c_str(), "wb");
+  if (!fp) {
+    BOOST_LOG_TRIVIAL(warning) << "Unable to write table cache: " << temp_filename;
+    return;
+  }
+  static const char padding[8] = {0};
+  size_t ids_end = align8(sizeof(Cache_Header)) + writer.ints.size() * sizeof(std::int64_t) + writer.string_ids.size() * sizeof(std::uint32_t);
+  bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+            (fwrite(padding, 1, align8(sizeof(header)) - sizeof(header), fp) == align8(sizeof(header)) - sizeof(header)) &&
+            (fwrite(writer.ints.data(), sizeof(std::int64_t), writer.ints.size(), fp) == writer.ints.size()) &&
+            (fwrite(writer.string_ids.data(), sizeof(std::uint32_t), writer.string_ids.size(), fp) == writer.string_ids.size()) &&
+            (fwrite(padding, 1, align8(ids_end) - ids_end, fp) == align8(ids_end) - ids_end) &&
+            (fwrite(offsets.data(), sizeof(std::uint64_t), offsets.size(), fp) == offsets.size());
+  for (size_t i = 0; ok && (i < writer.strings.size()); i++) {
+    ok = (fwrite(writer.strings[i].data(), 1, writer.strings[i].size(), fp) == writer.strings[i].size());
+  }
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || (rename(temp_filename.c_str(), filename.c_str()) != 0)) {
+    BOOST_LOG_TRIVIAL(warning) << "Unable to write table cache: " << filename;
+    remove(temp_filename.c_str());
+    return;
+  }
+  BOOST_LOG_TRIVIAL(debug) << "Wrote table cache " << filename << " with " << writer.rows << " rows";
+}
@@ -0,0 +1,100 @@
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Table_Cache
+ *   Keeps what was read from a talkgroup, channel or unit tag CSV in a
+ *   binary file in tableCacheDir, so a restart can map it in instead of
+ *   parsing the CSV again.
+ *
+ * A table is rows of a fixed number of integer fields and string fields.
+ * The file is a header, the integers of every row, the string ids of
+ * every row, and then each distinct string once, so the many rows with
+ * the same mode or category share it:
+ *
+ *   Header, int64 ints[rows][ints], uint32 string_ids[rows][strings],
+ *   padding to 8 bytes, uint64 string_offsets[string_count + 1],
+ *   string bytes
+ *
+ * The CSV is what counts. A cache is only used if the CSV's size,
+ * modification time and a hash of its contents are what they were when
+ * the cache was written, and the kind names the loader and the version of
+ * what it keeps. Anything else, and the CSV is read as usual and the
+ * cache written again. With no tableCacheDir nothing is cached.
+ */
+class Table_Cache {
+public:
+  struct Csv_Stamp {
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+    std::uint64_t hash;
+  };
+
+  // Rows read from csv_filename; it is stamped before it is read, so an
+  // edit while it is being read makes a cache that won't match
+  class Writer {
+  public:
+    Writer(const std::string &csv_filename, int ints, int strings);
+    void add(const std::int64_t *ints, const std::string *strings);
+
+  private:
+    friend class Table_Cache;
+    bool stamped;
+    Csv_Stamp csv;
+    int ints_per_row;
+    int strings_per_row;
+    size_t rows;
+    std::vector<std::int64_t> ints;
+    std::vector<std::uint32_t> string_ids;
+    std::unordered_map<std::string, std::uint32_t> interned;
+    std::vector<std::string> strings;
+  };
+
+  class Reader {
+  public:
+    Reader();
+    ~Reader();
+    size_t size() const { return rows; }
+    std::int64_t get_int(size_t row, int field) const { return ints[row * ints_per_row + field]; }
+    double get_double(size_t row, int field) const;
+    std::string get_string(size_t row, int field) const;
+
+  private:
+    friend class Table_Cache;
+    Reader(const Reader &);
+    Reader &operator=(const Reader &);
+
+    void *map;
+    size_t map_size;
+    int ints_per_row;
+    int strings_per_row;
+    size_t rows;
+    const std::int64_t *ints;
+    const std::uint32_t *string_ids;
+    size_t string_count;
+    const std::uint64_t *string_offsets;
+    const char *string_bytes;
+  };
+
+  static void set_directory(const std::string &directory);
+  static bool enabled();
+  static std::int64_t from_double(double value);
+
+  // Maps the cache of csv_filename, if there is one that still matches it
+  static bool open(const std::string &csv_filename, const std::string &kind, int ints, int strings, Reader &reader);
+  static void save(const std::string &csv_filename, const std::string &kind, const Writer &writer);
+
+private:
+  static bool stamp(const std::string &csv_filename, Csv_Stamp &csv);
+  static std::string cache_filename(const std::string &csv_filename, const std::string &kind);
+
+  static std::string directory;
+};
+
+#endif // TABLE_CACHE_H
@@ -1,13 +1,9 @@
 #include "talkgroup.h"
 
-Talkgroup::Talkgroup(int sys_num, long num, std::string mode, std::string alpha_tag, std::string description, std::string tag, std::string group, int priority, unsigned long preferredNAC) {
+Talkgroup::Talkgroup(String_Pool &strings, int sys_num, long num, const std::string &mode, const std::string &alpha_tag, const std::string &description, const std::string &tag, const std::string &group, int priority, unsigned long preferredNAC)
+    : mode(strings.intern(mode)), alpha_tag(strings.intern(alpha_tag)), description(strings.intern(description)), tag(strings.intern(tag)), group(strings.intern(group)) {
   this->sys_num = sys_num;
   this->number = num;
-  this->mode = mode;
-  this->alpha_tag = alpha_tag;
-  this->description = description;
-  this->tag = tag;
-  this->group = group;
   this->priority = priority;
   this->active = false;
   this->preferredNAC = preferredNAC;
@@ -22,14 +18,10 @@ Talkgroup::Talkgroup(int sys_num, long num, std::string mode, std::string alpha_
 
 }
 
-Talkgroup::Talkgroup(int sys_num, long num, double freq, double tone, std::string alpha_tag, std::string description, std::string tag, std::string group, double squelch_db, bool signal_detection) {
+Talkgroup::Talkgroup(String_Pool &strings, int sys_num, long num, double freq, double tone, const std::string &alpha_tag, const std::string &description, const std::string &tag, const std::string &group, double squelch_db, bool signal_detection)
+    : mode(strings.intern("Z")), alpha_tag(strings.intern(alpha_tag)), description(strings.intern(description)), tag(strings.intern(tag)), group(strings.intern(group)) {
   this->sys_num = sys_num;
   this->number = num;
-  this->mode = "Z";
-  this->alpha_tag = alpha_tag;
-  this->description = description;
-  this->tag = tag;
-  this->group = group;
   this->active = false;
   this->freq = freq;
   this->tone = tone;
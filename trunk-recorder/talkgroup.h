@@ -5,16 +5,19 @@
 #include <stdio.h>
 #include <string>
 #include "global_structs.h"
+#include "record_arena.h"
 //#include <sstream>
 
 class Talkgroup {
 public:
   long number;
-  std::string mode;
-  std::string alpha_tag;
-  std::string description;
-  std::string tag;
-  std::string group;
+  // The strings are kept once in the String_Pool of the Talkgroups they
+  // came from, so they last as long as it does
+  const std::string &mode;
+  const std::string &alpha_tag;
+  const std::string &description;
+  const std::string &tag;
+  const std::string &group;
   int priority;
   int sys_num;
   double squelch_db;
@@ -27,8 +30,8 @@ public:
   int dcs_code;       // 0 = no DCS; otherwise decimal DCS code (e.g. 19 for D023)
   bool dcs_inverted;  // true for inverted polarity ("N" suffix, e.g. D023N)
 
-  Talkgroup(int sys_num, long num, std::string mode, std::string alpha_tag, std::string description, std::string tag, std::string group, int priority, unsigned long preferredNAC);
-  Talkgroup(int sys_num, long num, double freq, double tone, std::string alpha_tag, std::string description, std::string tag, std::string group, double squelch_db, bool signal_detection);
+  Talkgroup(String_Pool &strings, int sys_num, long num, const std::string &mode, const std::string &alpha_tag, const std::string &description, const std::string &tag, const std::string &group, int priority, unsigned long preferredNAC);
+  Talkgroup(String_Pool &strings, int sys_num, long num, double freq, double tone, const std::string &alpha_tag, const std::string &description, const std::string &tag, const std::string &group, double squelch_db, bool signal_detection);
 
   bool is_active();
   int get_priority();
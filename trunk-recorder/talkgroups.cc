@@ -7,25 +7,42 @@
 #include <boost/tokenizer.hpp>
 
 #include "csv_helper.h"
+#include "table_cache.h"
 #include <csv-parser/csv.hpp>
 
 #include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 
+// Bump these when what the loaders keep for a row changes
+static const char *TALKGROUPS_CACHE = "talkgroups1";
+static const char *CHANNELS_CACHE = "channels1";
+
 Talkgroups::Talkgroups() {}
 
 using namespace csv;
 
-void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
+bool Talkgroups::load_talkgroups(int sys_num, std::string filename) {
   if (filename == "") {
-    return;
+    return true;
   } else {
     BOOST_LOG_TRIVIAL(info) << "Reading Talkgroup CSV File: " << filename;
   }
 
+  // number, priority, preferred NAC; mode, alpha tag, description, tag, category
+  Table_Cache::Reader cache;
+  if (Table_Cache::open(filename, TALKGROUPS_CACHE, 3, 5, cache)) {
+    for (size_t i = 0; i < cache.size(); i++) {
+      add(records.make(strings, sys_num, cache.get_int(i, 0), cache.get_string(i, 0), cache.get_string(i, 1), cache.get_string(i, 2), cache.get_string(i, 3), cache.get_string(i, 4), cache.get_int(i, 1), cache.get_int(i, 2)));
+    }
+    BOOST_LOG_TRIVIAL(info) << "Read " << cache.size() << " talkgroups from the table cache.";
+    return true;
+  }
+  Table_Cache::Writer cached(filename, 3, 5);
+
   CSVFormat format;
   format.trim({' ', '\t'});
   CSVReader reader(filename, format);
@@ -38,7 +55,7 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
     BOOST_LOG_TRIVIAL(error) << "The first column must be 'Decimal'";
     BOOST_LOG_TRIVIAL(error) << "Required columns are: 'Decimal', 'Mode', 'Description'";
     BOOST_LOG_TRIVIAL(error) << "Optional columns are: 'Alpha Tag', 'Hex', 'Category', 'Tag', 'Priority', 'Preferred NAC'";
-    exit(0);
+    return false;
   } else {
     BOOST_LOG_TRIVIAL(info) << "Found Columns: " << internals::format_row(reader.get_col_names(), ", ");
   }
@@ -48,7 +65,7 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
       BOOST_LOG_TRIVIAL(error) << "Unknown column header: " << headers[i];
       BOOST_LOG_TRIVIAL(error) << "Required columns are: 'Decimal', 'Mode', 'Description'";
       BOOST_LOG_TRIVIAL(error) << "Optional columns are: 'Alpha Tag', 'Hex', 'Category', 'Tag', 'Priority', 'Preferred NAC'";
-      exit(0);
+      return false;
     }
   }
 
@@ -68,7 +85,7 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
       tg_number = row["Decimal"].get<long>();
     } else {
       BOOST_LOG_TRIVIAL(error) << "'Decimal' is required for specifying the Talkgroup number - Row: " << reader.n_rows();
-      exit(0);
+      return false;
     }
 
     if ((reader.index_of("Mode") >= 0) && row["Mode"].is_str()) {
@@ -76,7 +93,7 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
     } else {
       BOOST_LOG_TRIVIAL(error) << "Mode is required for Row: " << reader.n_rows();
       ;
-      exit(0);
+      return false;
     }
 
     if (reader.index_of("Description") >= 0) {
@@ -84,7 +101,7 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
     } else {
       BOOST_LOG_TRIVIAL(error) << "Description is required for Row: " << reader.n_rows();
       ;
-      exit(0);
+      return false;
     }
 
     if (reader.index_of("Alpha Tag") >= 0) {
@@ -106,22 +123,42 @@ void Talkgroups::load_talkgroups(int sys_num, std::string filename) {
     if ((reader.index_of("Preferred NAC") >= 0) && row["Preferred NAC"].is_int()) {
       preferredNAC = row["Preferred NAC"].get<unsigned long>();
     }
-    tg = new Talkgroup(sys_num, tg_number, mode, alpha_tag, description, tag, group, priority, preferredNAC);
-    talkgroups.push_back(tg);
+    tg = records.make(strings, sys_num, tg_number, mode, alpha_tag, description, tag, group, priority, preferredNAC);
+    add(tg);
     lines_pushed++;
+
+    const std::int64_t cache_ints[] = {tg_number, priority, (std::int64_t)preferredNAC};
+    const std::string cache_strings[] = {mode, alpha_tag, description, tag, group};
+    cached.add(cache_ints, cache_strings);
   }
 
   BOOST_LOG_TRIVIAL(info) << "Read " << lines_pushed << " talkgroups.";
+  Table_Cache::save(filename, TALKGROUPS_CACHE, cached);
+  return true;
 }
 
-void Talkgroups::load_channels(int sys_num, std::string filename) {
+bool Talkgroups::load_channels(int sys_num, std::string filename) {
 
   if (filename == "") {
-    return;
+    return true;
   } else {
     BOOST_LOG_TRIVIAL(info) << "Reading Channel CSV File: " << filename;
   }
 
+  // number, freq, tone, squelch, signal detector, DCS code, DCS inverted; alpha tag, description, tag, category
+  Table_Cache::Reader cache;
+  if (Table_Cache::open(filename, CHANNELS_CACHE, 7, 4, cache)) {
+    for (size_t i = 0; i < cache.size(); i++) {
+      Talkgroup *tg = records.make(strings, sys_num, cache.get_int(i, 0), cache.get_double(i, 1), cache.get_double(i, 2), cache.get_string(i, 0), cache.get_string(i, 1), cache.get_string(i, 2), cache.get_string(i, 3), cache.get_double(i, 3), cache.get_int(i, 4) != 0);
+      tg->dcs_code = cache.get_int(i, 5);
+      tg->dcs_inverted = (cache.get_int(i, 6) != 0);
+      add(tg);
+    }
+    BOOST_LOG_TRIVIAL(info) << "Read " << cache.size() << " channels from the table cache.";
+    return true;
+  }
+  Table_Cache::Writer cached(filename, 7, 4);
+
   CSVFormat format;
   format.trim({' ', '\t'});
   CSVReader reader(filename, format);
@@ -134,7 +171,7 @@ void Talkgroups::load_channels(int sys_num, std::string filename) {
     BOOST_LOG_TRIVIAL(error) << "The first column must be 'TG Number'";
     BOOST_LOG_TRIVIAL(error) << "Required columns are: 'TG Number', 'Frequency'";
     BOOST_LOG_TRIVIAL(error) << "Optional columns are: 'Alpha Tag', 'Tone', 'Description', 'Category', 'Tag', 'Enable', 'Comment', 'Signal Detector', 'Squelch'";
-    exit(0);
+    return false;
   } else {
     BOOST_LOG_TRIVIAL(info) << "Found Columns: " << internals::format_row(reader.get_col_names(), ", ");
   }
@@ -144,7 +181,7 @@ void Talkgroups::load_channels(int sys_num, std::string filename) {
       BOOST_LOG_TRIVIAL(error) << "Unknown column header: " << headers[i];
       BOOST_LOG_TRIVIAL(error) << "Required columns are: 'TG Number', 'Frequency'";
       BOOST_LOG_TRIVIAL(error) << "Optional columns are: 'Alpha Tag', 'Tone', 'Description', 'Category', 'Tag', 'Enable', 'Comment', 'Signal Detector', 'Squelch'";
-      exit(0);
+      return false;
     }
   }
 
@@ -166,7 +203,7 @@ void Talkgroups::load_channels(int sys_num, std::string filename) {
       tg_number = row["TG Number"].get<long>();
     } else {
       BOOST_LOG_TRIVIAL(error) << "'TG Number' is required for specifying the Talkgroup number - Row: " << reader.n_rows();
-      exit(0);
+      return false;
     }
 
     if ((reader.index_of("Description") >= 0) && row["Description"].is_str()) {
@@ -239,48 +276,103 @@ void Talkgroups::load_channels(int sys_num, std::string filename) {
       /* For DCS, tone is encoded as a negative value; pass 0 to constructor
        * and set the dedicated dcs_code / dcs_inverted fields instead.      */
       double ctor_tone = (tone < 0.0) ? 0.0 : tone;
-      tg = new Talkgroup(sys_num, tg_number, freq, ctor_tone, alpha_tag, description, tag, group, squelch_db, signal_detector);
+      tg = records.make(strings, sys_num, tg_number, freq, ctor_tone, alpha_tag, description, tag, group, squelch_db, signal_detector);
       if (tone < 0.0) {
         int raw = (int)(-tone + 0.5);
         tg->dcs_code     = raw % 1000;
         tg->dcs_inverted = (raw >= 1000);
       }
-      talkgroups.push_back(tg);
+      add(tg);
       lines_pushed++;
+
+      const std::int64_t cache_ints[] = {tg_number, Table_Cache::from_double(freq), Table_Cache::from_double(ctor_tone), Table_Cache::from_double(squelch_db), signal_detector, tg->dcs_code, tg->dcs_inverted};
+      const std::string cache_strings[] = {alpha_tag, description, tag, group};
+      cached.add(cache_ints, cache_strings);
     }
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Read " << lines_pushed << " channels.";
+  Table_Cache::save(filename, CHANNELS_CACHE, cached);
+  return true;
+}
 
-    BOOST_LOG_TRIVIAL(info) << "Read " << lines_pushed << " channels.";
+void Talkgroups::add(Talkgroup *tg) {
+  talkgroups.push_back(tg);
+  Key number = {tg->sys_num, tg->number};
+  by_number.insert(std::make_pair(number, tg)); // keeps the first with this number
+  by_freq[make_freq_key(tg->sys_num, tg->freq)].push_back(tg);
+}
+
+const std::vector<Talkgroup *> &Talkgroups::find_freq(int sys_num, double freq) const {
+  std::unordered_map<Key, std::vector<Talkgroup *>, Key_Hash>::const_iterator it = by_freq.find(make_freq_key(sys_num, freq));
+  if (it == by_freq.end()) {
+    return none;
   }
+  return it->second;
 }
 
 Talkgroup *Talkgroups::find_talkgroup(int sys_num, long tg_number) {
-  Talkgroup *tg_match = NULL;
+  Key number = {sys_num, tg_number};
+  std::unordered_map<Key, Talkgroup *, Key_Hash>::const_iterator it = by_number.find(number);
+  if (it == by_number.end()) {
+    return NULL;
+  }
+  return it->second;
+}
+
+Talkgroup *Talkgroups::find_talkgroup_by_freq(int sys_num, double freq) {
+  const std::vector<Talkgroup *> &bucket = find_freq(sys_num, freq);
 
-  for (std::vector<Talkgroup *>::iterator it = talkgroups.begin(); it != talkgroups.end(); ++it) {
+  for (std::vector<Talkgroup *>::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
     Talkgroup *tg = (Talkgroup *)*it;
 
-    if ((tg->sys_num == sys_num) && (tg->number == tg_number)) {
-      tg_match = tg;
-      break;
+    if (tg->freq == freq) {
+      return tg;
     }
   }
-  return tg_match;
+  return NULL;
 }
 
-Talkgroup *Talkgroups::find_talkgroup_by_freq(int sys_num, double freq) {
-  Talkgroup *tg_match = NULL;
+Talkgroup *Talkgroups::find_talkgroup_by_dcs(int sys_num, double freq, int dcs_code, bool dcs_inverted) {
+  const std::vector<Talkgroup *> &bucket = find_freq(sys_num, freq);
+
+  for (std::vector<Talkgroup *>::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
+    Talkgroup *tg = (Talkgroup *)*it;
+
+    if ((tg->freq == freq) && (tg->dcs_code == dcs_code) && (tg->dcs_inverted == dcs_inverted)) {
+      return tg;
+    }
+  }
+  return NULL;
+}
+
+Talkgroup *Talkgroups::find_talkgroup_by_ctcss(int sys_num, double freq, double tone) {
+  const std::vector<Talkgroup *> &bucket = find_freq(sys_num, freq);
 
-  for (std::vector<Talkgroup *>::iterator it = talkgroups.begin(); it != talkgroups.end(); ++it) {
+  for (std::vector<Talkgroup *>::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
     Talkgroup *tg = (Talkgroup *)*it;
 
-    if ((tg->sys_num == sys_num) && (tg->freq == freq)) {
-      tg_match = tg;
-      break;
+    // The tone comes back from the squelch as a float, so allow for rounding
+    if ((tg->freq == freq) && (tg->dcs_code == 0) && (std::fabs(tg->tone - tone) < 0.05)) {
+      return tg;
     }
   }
-  return tg_match;
+  return NULL;
 }
 
 std::vector<Talkgroup *> Talkgroups::get_talkgroups() {
   return talkgroups;
 }
+
+// The records, their strings and the indexes, roughly
+Memory_Usage Talkgroups::get_memory_usage() const {
+  Memory_Usage usage;
+  usage.subsystem = "Tables";
+  usage.name = "talkgroups";
+  usage.count = records.size();
+  usage.bytes = records.bytes() + strings.bytes() + talkgroups.capacity() * sizeof(Talkgroup *) + index_bytes(by_number) + index_bytes(by_freq);
+  for (std::unordered_map<Key, std::vector<Talkgroup *>, Key_Hash>::const_iterator it = by_freq.begin(); it != by_freq.end(); ++it) {
+    usage.bytes += it->second.capacity() * sizeof(Talkgroup *);
+  }
+  return usage;
+}
@@ -1,20 +1,67 @@
 #ifndef TALKGROUPS_H
 #define TALKGROUPS_H
 
+#include "global_structs.h"
+#include "record_arena.h"
 #include "talkgroup.h"
 #include <boost/algorithm/string.hpp>
+#include <cmath>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+/*
+ * Talkgroups
+ *   The talkgroups and conventional channels read from each system's CSV.
+ *
+ * They are kept in the order they were read, for iteration, and indexed
+ * by system and talkgroup number and by system and frequency, so the
+ * lookups on every grant and conventional call don't walk the whole list.
+ * Where two rows match, the one read first wins, as it always has.
+ * Frequencies are indexed to the nearest Hz and then compared exactly.
+ *
+ * The Talkgroups themselves are made in a Record_Arena, and their strings
+ * kept once in a String_Pool, since a few modes and categories are shared
+ * by thousands of rows. All of it goes when the Talkgroups does.
+ */
 class Talkgroups {
+  struct Key {
+    int sys_num;
+    long long value;
+    bool operator==(const Key &other) const { return (sys_num == other.sys_num) && (value == other.value); }
+  };
+  struct Key_Hash {
+    size_t operator()(const Key &k) const {
+      size_t h = std::hash<long long>()(k.value);
+      h ^= std::hash<int>()(k.sys_num) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  static Key make_freq_key(int sys_num, double freq) {
+    Key k = {sys_num, std::llround(freq)};
+    return k;
+  }
+  void add(Talkgroup *tg);
+  const std::vector<Talkgroup *> &find_freq(int sys_num, double freq) const;
+
+  String_Pool strings;
+  Record_Arena<Talkgroup> records;
   std::vector<Talkgroup *> talkgroups;
+  std::unordered_map<Key, Talkgroup *, Key_Hash> by_number;
+  std::unordered_map<Key, std::vector<Talkgroup *>, Key_Hash> by_freq; // in the order they were read
+  std::vector<Talkgroup *> none;
 
 public:
   Talkgroups();
-  void load_talkgroups(int sys_num, std::string filename);
-  void load_channels(int sys_num, std::string filename);
+  // false if the file has a problem, which has been logged
+  bool load_talkgroups(int sys_num, std::string filename);
+  bool load_channels(int sys_num, std::string filename);
   Talkgroup *find_talkgroup(int sys_num, long tg);
   Talkgroup *find_talkgroup_by_freq(int sys_num, double freq);
+  Talkgroup *find_talkgroup_by_dcs(int sys_num, double freq, int dcs_code, bool dcs_inverted);
+  Talkgroup *find_talkgroup_by_ctcss(int sys_num, double freq, double tone);
   std::vector<Talkgroup *> get_talkgroups();
+  Memory_Usage get_memory_usage() const;
 };
 #endif // TALKGROUPS_H
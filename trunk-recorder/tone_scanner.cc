@@ -0,0 +1,251 @@
+#include "tone_scanner.h"
+#include "gr_blocks/decoders/ctcss_tones.h"
+#include "gr_blocks/decoders/dcs_decode.h"
+#include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// 1 s windows resolve the closest standard tones (2.3 Hz apart)
+static const int WINDOW_SAMPLES = Tone_Scanner::SAMPLE_RATE;
+// Fraction of window energy a tone needs to count, 1.0 being a pure tone
+static const float CTCSS_THRESHOLD = 0.4f;
+// Samples a channel may queue before new ones are dropped (10 s)
+static const size_t MAX_PENDING = 10 * Tone_Scanner::SAMPLE_RATE;
+
+struct Tone_Scanner::Channel {
+  std::mutex mutex;
+  std::vector<float> pending;
+  std::string short_name;
+  double freq;
+  long talkgroup;
+
+  // Histogram, written by the worker under mutex
+  long windows;
+  long ctcss_hits[NUM_CTCSS_TONES];
+  std::map<int, long> dcs_hits;
+
+  // Only touched by the worker thread
+  std::vector<float> work;
+  dcs_decoder_t *dcs_decoder;
+  float s1[NUM_CTCSS_TONES];
+  float s2[NUM_CTCSS_TONES];
+  float energy;
+  int window_count;
+  std::vector<int> window_dcs; // DCS codes seen this window, +1000 if inverted
+};
+
+static float ctcss_coeff[NUM_CTCSS_TONES];
+
+std::mutex Tone_Scanner::channels_mutex;
+std::vector<Tone_Scanner::Channel *> Tone_Scanner::channels;
+std::thread Tone_Scanner::worker_thread;
+std::atomic<bool> Tone_Scanner::running(false);
+
+int Tone_Scanner::add_channel() {
+  Channel *ch = new Channel();
+  ch->freq = 0;
+  ch->talkgroup = 0;
+  ch->pending.reserve(MAX_PENDING);
+  ch->work.reserve(MAX_PENDING);
+  ch->dcs_decoder = dcs_decoder_new(SAMPLE_RATE);
+  if (ch->dcs_decoder) {
+    dcs_decoder_set_callback(ch->dcs_decoder, Tone_Scanner::dcs_callback, ch);
+  }
+  for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+    ch->s1[k] = 0;
+    ch->s2[k] = 0;
+    ch->ctcss_hits[k] = 0;
+  }
+  ch->energy = 0;
+  ch->window_count = 0;
+  ch->windows = 0;
+
+  std::lock_guard<std::mutex> lock(channels_mutex);
+  channels.push_back(ch);
+  return channels.size() - 1;
+}
+
+void Tone_Scanner::set_channel_info(int channel, std::string short_name, double freq, long talkgroup) {
+  std::lock_guard<std::mutex> lock(channels_mutex);
+  if ((channel < 0) || (channel >= (int)channels.size())) {
+    return;
+  }
+  Channel *ch = channels[channel];
+  std::lock_guard<std::mutex> ch_lock(ch->mutex);
+  ch->short_name = short_name;
+  ch->freq = freq;
+  ch->talkgroup = talkgroup;
+}
+
+// Called from the flowgraph; only appends, the worker does the processing
+void Tone_Scanner::push_samples(int channel, const float *samples, int count) {
+  Channel *ch;
+  {
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    if ((channel < 0) || (channel >= (int)channels.size())) {
+      return;
+    }
+    ch = channels[channel];
+  }
+  std::lock_guard<std::mutex> ch_lock(ch->mutex);
+  size_t room = MAX_PENDING - ch->pending.size();
+  if ((size_t)count > room) {
+    count = room;
+  }
+  ch->pending.insert(ch->pending.end(), samples, samples + count);
+}
+
+void Tone_Scanner::start() {
+  if (running.exchange(true)) {
+    return;
+  }
+  for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+    ctcss_coeff[k] = 2.0f * cosf(2.0f * (float)M_PI * CTCSS_TONES[k] / SAMPLE_RATE);
+  }
+  worker_thread = std::thread(Tone_Scanner::worker);
+  BOOST_LOG_TRIVIAL(info) << "Tone Scanner started";
+}
+
+void Tone_Scanner::stop() {
+  if (!running.exchange(false)) {
+    return;
+  }
+  if (worker_thread.joinable()) {
+    worker_thread.join();
+  }
+}
+
+void Tone_Scanner::worker() {
+  while (running) {
+    std::vector<Channel *> current;
+    {
+      std::lock_guard<std::mutex> lock(channels_mutex);
+      current = channels;
+    }
+
+    for (std::vector<Channel *>::iterator it = current.begin(); it != current.end(); ++it) {
+      Channel *ch = *it;
+      {
+        std::lock_guard<std::mutex> ch_lock(ch->mutex);
+        ch->work.swap(ch->pending);
+      }
+      if (!ch->work.empty()) {
+        process(ch, ch->work.data(), ch->work.size());
+        ch->work.clear();
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+void Tone_Scanner::process(Channel *ch, const float *samples, int count) {
+  int i = 0;
+  while (i < count) {
+    int n = std::min(count - i, WINDOW_SAMPLES - ch->window_count);
+
+    if (ch->dcs_decoder) {
+      dcs_decoder_process_samples(ch->dcs_decoder, samples + i, n);
+    }
+
+    // Goertzel bank: the tone loop is innermost so it vectorizes across tones
+    for (int j = i; j < i + n; j++) {
+      const float x = samples[j];
+      ch->energy += x * x;
+      for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+        float s0 = x + ctcss_coeff[k] * ch->s1[k] - ch->s2[k];
+        ch->s2[k] = ch->s1[k];
+        ch->s1[k] = s0;
+      }
+    }
+
+    ch->window_count += n;
+    i += n;
+    if (ch->window_count == WINDOW_SAMPLES) {
+      end_window(ch);
+    }
+  }
+}
+
+void Tone_Scanner::end_window(Channel *ch) {
+  int best = -1;
+  float best_power = 0;
+  for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+    float power = ch->s1[k] * ch->s1[k] + ch->s2[k] * ch->s2[k] - ctcss_coeff[k] * ch->s1[k] * ch->s2[k];
+    if (power > best_power) {
+      best_power = power;
+      best = k;
+    }
+    ch->s1[k] = 0;
+    ch->s2[k] = 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> ch_lock(ch->mutex);
+
+    // A pure tone puts N^2/4 * A^2 in its bin against N * A^2 / 2 of energy
+    if ((best >= 0) && (ch->energy > 0) &&
+        (2.0f * best_power / (WINDOW_SAMPLES * ch->energy) > CTCSS_THRESHOLD)) {
+      ch->ctcss_hits[best]++;
+    }
+
+    for (std::vector<int>::iterator it = ch->window_dcs.begin(); it != ch->window_dcs.end(); ++it) {
+      ch->dcs_hits[*it]++;
+    }
+    ch->windows++;
+  }
+  ch->window_dcs.clear();
+
+  ch->energy = 0;
+  ch->window_count = 0;
+}
+
+void Tone_Scanner::dcs_callback(int code, int inverted, void *context) {
+  Channel *ch = static_cast<Channel *>(context);
+  int key = code + (inverted ? 1000 : 0);
+  for (std::vector<int>::iterator it = ch->window_dcs.begin(); it != ch->window_dcs.end(); ++it) {
+    if (*it == key) {
+      return;
+    }
+  }
+  ch->window_dcs.push_back(key);
+}
+
+std::vector<Tone_Scan_Result> Tone_Scanner::get_results() {
+  std::vector<Tone_Scan_Result> results;
+  std::lock_guard<std::mutex> lock(channels_mutex);
+
+  for (std::vector<Channel *>::iterator it = channels.begin(); it != channels.end(); ++it) {
+    Channel *ch = *it;
+    Tone_Scan_Result result;
+    std::lock_guard<std::mutex> ch_lock(ch->mutex);
+    result.short_name = ch->short_name;
+    result.freq = ch->freq;
+    result.talkgroup = ch->talkgroup;
+    result.windows = ch->windows;
+    result.best_count = 0;
+
+    char name[16];
+    for (int k = 0; k < NUM_CTCSS_TONES; k++) {
+      if (ch->ctcss_hits[k] > 0) {
+        snprintf(name, sizeof(name), "%.1f", CTCSS_TONES[k]);
+        result.histogram[name] = ch->ctcss_hits[k];
+      }
+    }
+    for (std::map<int, long>::iterator dcs_it = ch->dcs_hits.begin(); dcs_it != ch->dcs_hits.end(); ++dcs_it) {
+      snprintf(name, sizeof(name), "D%03o%c", dcs_it->first % 1000, (dcs_it->first >= 1000) ? 'I' : 'N');
+      result.histogram[name] = dcs_it->second;
+    }
+
+    for (std::map<std::string, long>::iterator hist_it = result.histogram.begin(); hist_it != result.histogram.end(); ++hist_it) {
+      if (hist_it->second > result.best_count) {
+        result.best_count = hist_it->second;
+        result.best_tone = hist_it->first;
+      }
+    }
+    results.push_back(result);
+  }
+  return results;
+}
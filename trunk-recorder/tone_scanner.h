@@ -0,0 +1,49 @@
+#ifndef TONE_SCANNER_H
+#define TONE_SCANNER_H
+
+#include "global_structs.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Tone_Scanner
+ *   Finds the CTCSS tone or DCS code in use on conventional analog channels.
+ *
+ * Each analog recorder registers a channel and feeds it low-passed,
+ * decimated sub-audio (see gr_blocks/tone_scan_sink.h).  A single worker
+ * thread drains every channel in turn and runs a Goertzel bank over the
+ * standard CTCSS tones and a DCS decoder on it, counting per 1 s window
+ * which tone or code was present.  The histograms are reported through
+ * the tone_scan() plugin hook, with the winner in channel-file Tone
+ * column syntax ("131.8", "D023N").
+ */
+class Tone_Scanner {
+public:
+  static const int SAMPLE_RATE = 1600;
+
+  static int add_channel();
+  static void set_channel_info(int channel, std::string short_name, double freq, long talkgroup);
+  static void push_samples(int channel, const float *samples, int count);
+
+  static void start();
+  static void stop();
+  static std::vector<Tone_Scan_Result> get_results();
+
+private:
+  struct Channel;
+
+  static void worker();
+  static void process(Channel *ch, const float *samples, int count);
+  static void end_window(Channel *ch);
+  static void dcs_callback(int code, int inverted, void *context);
+
+  static std::mutex channels_mutex;
+  static std::vector<Channel *> channels;
+  static std::thread worker_thread;
+  static std::atomic<bool> running;
+};
+
+#endif // TONE_SCANNER_H
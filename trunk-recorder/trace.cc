@@ -0,0 +1,166 @@
+#include "trace.h"
+
+#include <boost/log/trivial.hpp>
+#include <pthread.h>
+
+std::atomic<bool> Trace::tracing(false);
+Trace::Clock::time_point Trace::epoch;
+std::mutex Trace::buffers_mutex;
+std::vector<Trace::Thread_Buffer *> Trace::buffers;
+FILE *Trace::file = NULL;
+bool Trace::first_event = true;
+std::thread Trace::writer;
+std::atomic<bool> Trace::writing(false);
+
+static const std::chrono::milliseconds WRITE_INTERVAL(100);
+
+bool Trace::start(const std::string &filename) {
+  if (tracing || filename.empty()) {
+    return true;
+  }
+  file = fopen(filename.c_str(), "w");
+  if (!file) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to open the trace file: " << filename;
+    return false;
+  }
+  fputs("[\n", file);
+  first_event = true;
+  epoch = Clock::now();
+  writing = true;
+  writer = std::thread(&Trace::run_writer);
+  tracing = true;
+  BOOST_LOG_TRIVIAL(info) << "Tracing to: " << filename;
+  return true;
+}
+
+// The buffers are left, since a thread could still be pushing a span it
+// started before tracing stopped
+void Trace::stop() {
+  if (!tracing.exchange(false)) {
+    return;
+  }
+  writing = false;
+  writer.join();
+  write_events();
+
+  long dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (std::vector<Thread_Buffer *>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+      dropped += (*it)->dropped.load();
+    }
+  }
+  fputs("\n]\n", file);
+  fclose(file);
+  file = NULL;
+  if (dropped) {
+    BOOST_LOG_TRIVIAL(error) << "Trace - " << dropped << " spans were dropped, the writer fell behind";
+  }
+}
+
+Trace::Thread_Buffer *Trace::thread_buffer() {
+  static thread_local Thread_Buffer *buffer = NULL;
+  if (!buffer) {
+    buffer = new Thread_Buffer();
+    char name[64] = "";
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    for (char *c = name; *c; c++) {
+      if ((*c == '"') || (*c == '\\') || ((unsigned char)*c < 0x20)) {
+        *c = '_';
+      }
+    }
+    buffer->name = name;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer->tid = buffers.size() + 1;
+    buffers.push_back(buffer);
+  }
+  return buffer;
+}
+
+void Trace::push(const Event &event) {
+  Thread_Buffer *buffer = thread_buffer();
+  Event copy = event;
+  if (!buffer->events.push(std::move(copy))) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Trace::complete(const char *name, Clock::time_point begin, Clock::time_point end, long call_num, Trace_Flow flow) {
+  if (!enabled()) {
+    return;
+  }
+  Event event;
+  event.name = name;
+  event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(begin - epoch).count();
+  event.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+  event.call_num = call_num;
+  event.flow = flow;
+  push(event);
+}
+
+void Trace::instant(const char *name, long call_num, Trace_Flow flow) {
+  if (!enabled()) {
+    return;
+  }
+  Event event;
+  event.name = name;
+  event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch).count();
+  event.duration_us = -1;
+  event.call_num = call_num;
+  event.flow = flow;
+  push(event);
+}
+
+void Trace::run_writer() {
+  while (writing.load()) {
+    std::this_thread::sleep_for(WRITE_INTERVAL);
+    write_events();
+  }
+}
+
+void Trace::write_events() {
+  std::vector<Thread_Buffer *> current;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    current = buffers;
+  }
+  for (std::vector<Thread_Buffer *>::iterator it = current.begin(); it != current.end(); ++it) {
+    Thread_Buffer &buffer = **it;
+    if (!buffer.named && !buffer.name.empty()) {
+      fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first_event ? "" : ",\n", buffer.tid, buffer.name.c_str());
+      first_event = false;
+    }
+    buffer.named = true;
+    Event event;
+    while (buffer.events.pop(event)) {
+      write_event(buffer, event);
+    }
+  }
+  fflush(file);
+}
+
+void Trace::write_event(const Thread_Buffer &buffer, const Event &event) {
+  const char *separator = first_event ? "" : ",\n";
+  first_event = false;
+  if (event.duration_us < 0) {
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":1,\"tid\":%d", separator, event.name, (long long)event.start_us, buffer.tid);
+  } else {
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d", separator, event.name, (long long)event.start_us, (long long)event.duration_us, buffer.tid);
+  }
+  if (event.call_num) {
+    fprintf(file, ",\"args\":{\"call\":%ld}}", event.call_num);
+  } else {
+    fputs("}", file);
+  }
+
+  // Bound to the span it is in, at its start, or for the end of a call at
+  // its end, so the arrow comes after the steps inside it
+  static const char *const phases[] = {"", "s", "t", "f"};
+  if ((event.flow != TRACE_FLOW_NONE) && event.call_num) {
+    std::int64_t ts = event.start_us;
+    if ((event.flow == TRACE_FLOW_END) && (event.duration_us > 0)) {
+      ts += event.duration_us - 1;
+    }
+    fprintf(file, ",\n{\"name\":\"call\",\"cat\":\"call\",\"ph\":\"%s\",\"bp\":\"e\",\"id\":%ld,\"ts\":%lld,\"pid\":1,\"tid\":%d}", phases[event.flow], event.call_num, (long long)ts, buffer.tid);
+  }
+}
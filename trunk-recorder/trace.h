@@ -0,0 +1,118 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_ring.h"
+
+// How a span is linked to the others of its call
+enum Trace_Flow {
+  TRACE_FLOW_NONE,
+  TRACE_FLOW_START, // the grant
+  TRACE_FLOW_STEP,
+  TRACE_FLOW_END // concluded
+};
+
+/*
+ * Trace
+ *   A timeline of what the main loop, the recorders, the Wav_Writer and the
+ *   Call_Concluder spend their time on, written to the traceFile as Chrome
+ *   trace JSON, for opening in Perfetto or chrome://tracing.
+ *
+ * A span is a name, a start and a duration on the thread that was in it,
+ * with the number of the call it was for when there was one. The spans of
+ * a call are joined by flow arrows, from handle_call_grant through
+ * start_recorder, the recorder, its transmissions and their files to the
+ * Call_Concluder's stages, so a grant can be followed across the threads.
+ *
+ * Each thread has a ring of its own for its spans, made the first time it
+ * records one, and only that thread pushes to it, so recording a span takes
+ * no lock. A writer thread takes them out of all the rings every 100 ms and
+ * appends them to the file. When a thread's ring is full its spans are
+ * dropped and counted. With no traceFile a Span is one relaxed load of a
+ * flag.
+ *
+ * The names are kept as pointers, so they have to be string literals.
+ */
+class Trace {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static bool start(const std::string &filename);
+  static void stop();
+  static bool enabled() { return tracing.load(std::memory_order_relaxed); }
+
+  static void complete(const char *name, Clock::time_point begin, Clock::time_point end, long call_num = 0, Trace_Flow flow = TRACE_FLOW_NONE);
+  static void instant(const char *name, long call_num = 0, Trace_Flow flow = TRACE_FLOW_NONE);
+
+  // Records the span from when it is made to when it goes out of scope
+  class Span {
+  public:
+    Span(const char *name, long call_num = 0, Trace_Flow flow = TRACE_FLOW_NONE) : name(name), call_num(call_num), flow(flow), active(Trace::enabled()) {
+      if (active) {
+        begin = Clock::now();
+      }
+    }
+    ~Span() {
+      if (active) {
+        Trace::complete(name, begin, Clock::now(), call_num, flow);
+      }
+    }
+    // For a span that only finds out which call it is for part way through
+    void set_call(long num, Trace_Flow call_flow = TRACE_FLOW_STEP) {
+      call_num = num;
+      flow = call_flow;
+    }
+
+  private:
+    const char *name;
+    long call_num;
+    Trace_Flow flow;
+    bool active;
+    Clock::time_point begin;
+  };
+
+private:
+  struct Event {
+    const char *name;
+    std::int64_t start_us;
+    std::int64_t duration_us; // -1 for an instant
+    long call_num;
+    Trace_Flow flow;
+  };
+
+  struct Thread_Buffer {
+    Thread_Buffer() : events(RING_SIZE), tid(0), named(false), dropped(0) {}
+    MPSC_Ring<Event> events;
+    int tid;
+    std::string name;
+    bool named; // the writer has written its name
+    std::atomic<long> dropped;
+  };
+
+  static const size_t RING_SIZE = 16384;
+
+  static Thread_Buffer *thread_buffer();
+  static void push(const Event &event);
+  static void run_writer();
+  static void write_events();
+  static void write_event(const Thread_Buffer &buffer, const Event &event);
+
+  static std::atomic<bool> tracing;
+  static Clock::time_point epoch;
+  static std::mutex buffers_mutex;
+  static std::vector<Thread_Buffer *> buffers;
+  static FILE *file;
+  static bool first_event;
+  static std::thread writer;
+  static std::atomic<bool> writing;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,450 @@
+#include "unit_activity.h"
+#include "replay_clock.h"
+#include "systems/system.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <json.hpp>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char ACTIVITY_MAGIC[8] = {'T', 'R', 'U', 'N', 'I', 'T', 'S', '1'};
+static const size_t HEADER_SIZE = 4096;
+static const size_t MAX_SYSTEMS = 64;
+static const size_t NAME_SIZE = 48;
+
+struct Activity_Header {
+  char magic[8];
+  std::uint32_t block_events;
+  std::uint32_t systems;
+  std::uint64_t blocks;
+  std::uint64_t count;
+  char names[MAX_SYSTEMS][NAME_SIZE];
+};
+static_assert(sizeof(Activity_Header) <= HEADER_SIZE, "the header has to fit before the first block");
+
+// A block is the columns of BLOCK_EVENTS events, each a whole number of
+// pages: the times in ms, the units, the talkgroups, the Systems' indexes
+// in the header and the event types
+static const size_t BLOCK_EVENTS = 4096;
+static const size_t TIMES_OFFSET = 0;
+static const size_t UNITS_OFFSET = TIMES_OFFSET + BLOCK_EVENTS * sizeof(std::int64_t);
+static const size_t TALKGROUPS_OFFSET = UNITS_OFFSET + BLOCK_EVENTS * sizeof(std::int32_t);
+static const size_t SYSTEMS_OFFSET = TALKGROUPS_OFFSET + BLOCK_EVENTS * sizeof(std::int32_t);
+static const size_t TYPES_OFFSET = SYSTEMS_OFFSET + BLOCK_EVENTS * sizeof(std::uint16_t);
+static const size_t BLOCK_BYTES = TYPES_OFFSET + BLOCK_EVENTS * sizeof(std::uint8_t);
+
+static const size_t DEFAULT_LIMIT = 100;
+static const size_t MAX_LIMIT = 10000;
+
+std::mutex Unit_Activity::mutex;
+std::string Unit_Activity::filename;
+std::uint64_t Unit_Activity::max_blocks = 0;
+std::shared_ptr<Unit_Activity::Mapping> Unit_Activity::mapping;
+std::uint64_t Unit_Activity::count = 0;
+std::vector<int> Unit_Activity::sys_index;
+std::unordered_map<Unit_Activity::Key, Unit_Activity::Unit_State, Unit_Activity::Key_Hash> Unit_Activity::units;
+
+static Activity_Header *header_of(unsigned char *map) {
+  return (Activity_Header *)map;
+}
+
+template <typename T>
+static T *column(unsigned char *map, std::uint64_t block, size_t offset) {
+  return (T *)(map + HEADER_SIZE + block * BLOCK_BYTES + offset);
+}
+
+static void apply_event(Unit_Activity::Unit_State &state, std::int64_t time_ms, long talkgroup, Unit_Activity::Event_Type type) {
+  state.time_ms = time_ms;
+  state.type = type;
+  if (talkgroup >= 0) {
+    state.talkgroup = talkgroup;
+  }
+  if (type == Unit_Activity::DEREGISTRATION) {
+    state.registered = false;
+  } else if ((type == Unit_Activity::REGISTRATION) || (type == Unit_Activity::AFFILIATION)) {
+    state.registered = true;
+  }
+  state.events++;
+}
+
+Unit_Activity::Mapping::~Mapping() {
+  if (map) {
+    munmap(map, size);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+// A new file is made blocks big, an existing one is mapped as it is
+std::shared_ptr<Unit_Activity::Mapping> Unit_Activity::map_file(const std::string &name, std::uint64_t blocks) {
+  int fd = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to open the unit activity file: " << name << " - " << strerror(errno);
+    return std::shared_ptr<Mapping>();
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return std::shared_ptr<Mapping>();
+  }
+  bool created = (st.st_size == 0);
+  size_t size = created ? HEADER_SIZE + blocks * BLOCK_BYTES : (size_t)st.st_size;
+  if (created && (ftruncate(fd, size) != 0)) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to size the unit activity file: " << name << " - " << strerror(errno);
+    ::close(fd);
+    return std::shared_ptr<Mapping>();
+  }
+
+  std::shared_ptr<Mapping> file(new Mapping());
+  file->fd = fd;
+  file->size = size;
+  file->map = NULL;
+  file->blocks = 0;
+  if (size < HEADER_SIZE) {
+    return file;
+  }
+  void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to map the unit activity file: " << name << " - " << strerror(errno);
+    return std::shared_ptr<Mapping>();
+  }
+  file->map = (unsigned char *)map;
+
+  Activity_Header *header = header_of(file->map);
+  if (created) {
+    memcpy(header->magic, ACTIVITY_MAGIC, sizeof(header->magic));
+    header->block_events = BLOCK_EVENTS;
+    header->systems = 0;
+    header->blocks = blocks;
+    header->count = 0;
+  }
+  if ((memcmp(header->magic, ACTIVITY_MAGIC, sizeof(header->magic)) == 0) && (header->block_events == BLOCK_EVENTS) &&
+      (header->systems <= MAX_SYSTEMS) && (header->count <= header->blocks * BLOCK_EVENTS) && (size == HEADER_SIZE + header->blocks * BLOCK_BYTES)) {
+    file->blocks = header->blocks;
+  }
+  return file;
+}
+
+// Carries on with the file if it is one, otherwise moves it out of the way
+// and makes a new one. Called with the lock held.
+bool Unit_Activity::start_file() {
+  mapping = map_file(filename, max_blocks);
+  if (mapping && !mapping->blocks) {
+    mapping.reset();
+    std::string old = filename + ".1";
+    if (rename(filename.c_str(), old.c_str()) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to move the unit activity file to: " << old << " - " << strerror(errno);
+      return false;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Moved the unit activity file to: " << old;
+    mapping = map_file(filename, max_blocks);
+  }
+  if (!mapping || !mapping->blocks) {
+    mapping.reset();
+    return false;
+  }
+  count = header_of(mapping->map)->count;
+  return true;
+}
+
+// Where short_name is in the header, added if it isn't there yet. Called
+// with the lock held.
+int Unit_Activity::system_index(const std::string &short_name) {
+  Activity_Header *header = header_of(mapping->map);
+  for (std::uint32_t i = 0; i < header->systems; i++) {
+    if (strncmp(header->names[i], short_name.c_str(), NAME_SIZE) == 0) {
+      return i;
+    }
+  }
+  if ((header->systems >= MAX_SYSTEMS) || (short_name.size() >= NAME_SIZE)) {
+    return -1;
+  }
+  strncpy(header->names[header->systems], short_name.c_str(), NAME_SIZE);
+  return header->systems++;
+}
+
+bool Unit_Activity::open(const std::string &name, int max_mb, const std::vector<System *> &systems) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (name.empty()) {
+    return true;
+  }
+  filename = name;
+  max_blocks = std::max((std::uint64_t)1, (std::uint64_t)std::max(0, max_mb) * 1024 * 1024 / BLOCK_BYTES);
+  units.clear();
+  if (!start_file()) {
+    return false;
+  }
+
+  // The last state of the units comes back from what is already in the file
+  unsigned char *map = mapping->map;
+  for (std::uint64_t i = 0; i < count; i++) {
+    std::uint64_t block = i / BLOCK_EVENTS;
+    size_t at = i % BLOCK_EVENTS;
+    Key key(column<std::uint16_t>(map, block, SYSTEMS_OFFSET)[at], column<std::int32_t>(map, block, UNITS_OFFSET)[at]);
+    Unit_State &state = units.insert(std::make_pair(key, Unit_State{0, REGISTRATION, -1, false, 0})).first->second;
+    apply_event(state, column<std::int64_t>(map, block, TIMES_OFFSET)[at], column<std::int32_t>(map, block, TALKGROUPS_OFFSET)[at],
+                (Event_Type)column<std::uint8_t>(map, block, TYPES_OFFSET)[at]);
+  }
+
+  sys_index.clear();
+  for (std::vector<System *>::const_iterator it = systems.begin(); it != systems.end(); ++it) {
+    System *sys = *it;
+    if (sys->get_sys_num() < 0) {
+      continue;
+    }
+    if ((size_t)sys->get_sys_num() >= sys_index.size()) {
+      sys_index.resize(sys->get_sys_num() + 1, -1);
+    }
+    sys_index[sys->get_sys_num()] = system_index(sys->get_short_name());
+    if (sys_index[sys->get_sys_num()] < 0) {
+      BOOST_LOG_TRIVIAL(error) << "No room in the unit activity file for the System: " << sys->get_short_name();
+    }
+  }
+  BOOST_LOG_TRIVIAL(info) << "Writing unit activity to: " << filename << " - " << count << " events and " << units.size() << " units already in it";
+  return true;
+}
+
+void Unit_Activity::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  mapping.reset();
+  count = 0;
+  sys_index.clear();
+  units.clear();
+}
+
+bool Unit_Activity::enabled() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return (bool)mapping;
+}
+
+void Unit_Activity::record(System *sys, long unit, long talkgroup, Event_Type type) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!mapping || (sys->get_sys_num() < 0) || ((size_t)sys->get_sys_num() >= sys_index.size()) || (sys_index[sys->get_sys_num()] < 0)) {
+    return;
+  }
+  if (count >= mapping->blocks * BLOCK_EVENTS) {
+    // Full, so it makes way for a new one. The names go with it, so the
+    // Systems are added to the new header again.
+    std::vector<std::string> names;
+    Activity_Header *header = header_of(mapping->map);
+    for (std::uint32_t i = 0; i < header->systems; i++) {
+      names.push_back(std::string(header->names[i], strnlen(header->names[i], NAME_SIZE)));
+    }
+    mapping.reset();
+    std::string old = filename + ".1";
+    if (rename(filename.c_str(), old.c_str()) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to move the full unit activity file to: " << old << " - " << strerror(errno);
+      return;
+    }
+    BOOST_LOG_TRIVIAL(info) << "The unit activity file is full, moved it to: " << old;
+    if (!start_file()) {
+      return;
+    }
+    for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+      system_index(*it);
+    }
+  }
+
+  std::int64_t now = Replay_Clock::now_ms();
+  int index = sys_index[sys->get_sys_num()];
+  std::uint64_t block = count / BLOCK_EVENTS;
+  size_t at = count % BLOCK_EVENTS;
+  unsigned char *map = mapping->map;
+  column<std::int64_t>(map, block, TIMES_OFFSET)[at] = now;
+  column<std::int32_t>(map, block, UNITS_OFFSET)[at] = (std::int32_t)unit;
+  column<std::int32_t>(map, block, TALKGROUPS_OFFSET)[at] = (std::int32_t)talkgroup;
+  column<std::uint16_t>(map, block, SYSTEMS_OFFSET)[at] = (std::uint16_t)index;
+  column<std::uint8_t>(map, block, TYPES_OFFSET)[at] = (std::uint8_t)type;
+  count++;
+  header_of(map)->count = count;
+
+  Key key(index, (std::int32_t)unit);
+  Unit_State &state = units.insert(std::make_pair(key, Unit_State{0, REGISTRATION, -1, false, 0})).first->second;
+  apply_event(state, now, talkgroup, type);
+}
+
+bool Unit_Activity::get_state(const std::string &short_name, long unit, Unit_State &state) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!mapping) {
+    return false;
+  }
+  Activity_Header *header = header_of(mapping->map);
+  for (std::uint32_t i = 0; i < header->systems; i++) {
+    if (strncmp(header->names[i], short_name.c_str(), NAME_SIZE) == 0) {
+      std::unordered_map<Key, Unit_State, Key_Hash>::const_iterator it = units.find(Key(i, (std::int32_t)unit));
+      if (it == units.end()) {
+        return false;
+      }
+      state = it->second;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<Unit_Activity::Event> Unit_Activity::find(const std::string &short_name, long unit, std::int64_t after_ms, std::int64_t before_ms, size_t limit, bool &more) {
+  std::vector<Event> found;
+  more = false;
+  std::shared_ptr<Mapping> file;
+  std::uint64_t events = 0;
+  int index = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!mapping) {
+      return found;
+    }
+    Activity_Header *header = header_of(mapping->map);
+    for (std::uint32_t i = 0; i < header->systems; i++) {
+      if (strncmp(header->names[i], short_name.c_str(), NAME_SIZE) == 0) {
+        index = i;
+      }
+    }
+    file = mapping;
+    events = count;
+  }
+  if (index < 0) {
+    return found;
+  }
+
+  // Newest first, a block at a time. The events were appended as they
+  // came in, so the first one from before after_ms is the end of it.
+  const std::int32_t want = (std::int32_t)unit;
+  for (std::uint64_t end = events; end > 0;) {
+    std::uint64_t block = (end - 1) / BLOCK_EVENTS;
+    size_t n = end - block * BLOCK_EVENTS;
+    end = block * BLOCK_EVENTS;
+    const std::int32_t *units_column = column<std::int32_t>(file->map, block, UNITS_OFFSET);
+    for (size_t at = n; at > 0; at--) {
+      if (units_column[at - 1] != want) {
+        continue;
+      }
+      if (column<std::uint16_t>(file->map, block, SYSTEMS_OFFSET)[at - 1] != index) {
+        continue;
+      }
+      std::int64_t time_ms = column<std::int64_t>(file->map, block, TIMES_OFFSET)[at - 1];
+      if (time_ms < after_ms) {
+        return found;
+      }
+      if (time_ms >= before_ms) {
+        continue;
+      }
+      if (found.size() == limit) {
+        more = true;
+        return found;
+      }
+      Event event;
+      event.time_ms = time_ms;
+      event.short_name = short_name;
+      event.unit = unit;
+      event.talkgroup = column<std::int32_t>(file->map, block, TALKGROUPS_OFFSET)[at - 1];
+      event.type = (Event_Type)column<std::uint8_t>(file->map, block, TYPES_OFFSET)[at - 1];
+      found.push_back(event);
+    }
+  }
+  return found;
+}
+
+const char *Unit_Activity::type_name(Event_Type type) {
+  switch (type) {
+  case REGISTRATION:
+    return "registration";
+  case DEREGISTRATION:
+    return "deregistration";
+  case ACKNOWLEDGE:
+    return "acknowledge";
+  case AFFILIATION:
+    return "affiliation";
+  case DATA_GRANT:
+    return "dataGrant";
+  case ANSWER_REQUEST:
+    return "answerRequest";
+  case LOCATION:
+    return "location";
+  default:
+    return "unknown";
+  }
+}
+
+// GET /units?system=<shortName>&unit=<n>&start=<time>&end=<time>&limit=<n>
+Control_Api::Response Unit_Activity::handle_request(const Control_Api::Request &request) {
+  Control_Api::Response response;
+  if (request.method != "GET") {
+    response.status = 405;
+    response.body = nlohmann::json{{"error", "GET the units"}}.dump();
+    return response;
+  }
+
+  std::map<std::string, std::string>::const_iterator system = request.query.find("system");
+  std::string short_name = (system != request.query.end()) ? system->second : "";
+  long unit = -1;
+  std::int64_t after_ms = std::numeric_limits<std::int64_t>::min();
+  std::int64_t before_ms = std::numeric_limits<std::int64_t>::max();
+  size_t limit = DEFAULT_LIMIT;
+
+  double value;
+  bool bad = false;
+  if (request.number("unit", value, bad)) {
+    unit = (long)value;
+  }
+  if (request.number("start", value, bad)) {
+    after_ms = (std::int64_t)(value * 1000);
+  }
+  if (request.number("end", value, bad)) {
+    before_ms = (std::int64_t)(value * 1000);
+  }
+  if (request.number("limit", value, bad) && (value >= 1)) {
+    limit = std::min((size_t)value, MAX_LIMIT);
+  }
+  if (bad) {
+    response.status = 400;
+    response.body = nlohmann::json{{"error", "unit, start, end and limit are numbers"}}.dump();
+    return response;
+  }
+  if (short_name.empty() || (unit < 0)) {
+    response.status = 400;
+    response.body = nlohmann::json{{"error", "a system and a unit are needed"}}.dump();
+    return response;
+  }
+  if (!enabled()) {
+    response.status = 503;
+    response.body = nlohmann::json{{"error", "the unit activity file isn't open"}}.dump();
+    return response;
+  }
+
+  nlohmann::json body = {{"shortName", short_name}, {"unit", unit}};
+  Unit_State state;
+  if (get_state(short_name, unit, state)) {
+    body["last"] = {{"time", state.time_ms / 1000},
+                    {"timeMs", state.time_ms},
+                    {"type", type_name(state.type)},
+                    {"talkgroup", state.talkgroup},
+                    {"registered", state.registered},
+                    {"events", state.events}};
+  } else {
+    body["last"] = nullptr;
+  }
+
+  bool more;
+  std::vector<Event> found = find(short_name, unit, after_ms, before_ms, limit, more);
+  nlohmann::json events = nlohmann::json::array();
+  for (std::vector<Event>::const_iterator it = found.begin(); it != found.end(); ++it) {
+    events.push_back({{"time", it->time_ms / 1000},
+                      {"timeMs", it->time_ms},
+                      {"type", type_name(it->type)},
+                      {"talkgroup", it->talkgroup}});
+  }
+  body["events"] = events;
+  body["more"] = more;
+  response.status = 200;
+  response.body = body.dump();
+  return response;
+}
@@ -0,0 +1,118 @@
+#ifndef UNIT_ACTIVITY_H
+#define UNIT_ACTIVITY_H
+
+#include "control_api.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class System;
+
+/*
+ * Unit_Activity
+ *   A log of what the radios of the trunked systems did on the control
+ *   channel: the registrations, affiliations, locations and the rest of
+ *   the unit messages, kept in unitActivityFile, with the last of them for
+ *   each unit in memory. The Control API answers GET /units from it, so
+ *   where a radio has been can be looked up without a unit_script.
+ *
+ * The file is memory mapped and only ever appended to. It is a header,
+ * with the short names of the Systems, and then blocks of 4096 events.
+ * Each block is kept as columns: the times, the units, the talkgroups, the
+ * Systems and the types of the events, so looking for a unit only reads
+ * the units of each block and the rest of an event is only read when it
+ * matches. The file is made unitActivityMb big up front, as a sparse file,
+ * and is moved to the same name with .1 on the end when it is full. A
+ * Trunk Recorder that is started again on the same file carries on
+ * appending to it.
+ *
+ * The units are found in a hash map on the System and unit, with the
+ * last event seen for each, the last talkgroup it was on and whether it
+ * is registered.
+ *
+ * record() is called from the main loop. A query is answered on the
+ * Control API's thread. It only holds the lock while it looks up the unit
+ * and takes the events written so far: they don't change once they have
+ * been, and the mapping it scans is kept until it is done with it, even
+ * if the file has been moved on since.
+ */
+class Unit_Activity {
+public:
+  enum Event_Type {
+    REGISTRATION = 0,
+    DEREGISTRATION,
+    ACKNOWLEDGE,
+    AFFILIATION,
+    DATA_GRANT,
+    ANSWER_REQUEST,
+    LOCATION,
+    EVENT_TYPES
+  };
+
+  struct Event {
+    std::int64_t time_ms;
+    std::string short_name;
+    long unit;
+    long talkgroup; // -1 for the messages without one
+    Event_Type type;
+  };
+
+  struct Unit_State {
+    std::int64_t time_ms; // of the last event
+    Event_Type type;
+    long talkgroup;       // the last one it was on, -1 for none yet
+    bool registered;
+    long events;
+  };
+
+  static bool open(const std::string &filename, int max_mb, const std::vector<System *> &systems);
+  static void close();
+  static bool enabled();
+  static void record(System *sys, long unit, long talkgroup, Event_Type type);
+
+  static bool get_state(const std::string &short_name, long unit, Unit_State &state);
+  // The events of a unit from after_ms up to before_ms, newest first, more
+  // is set if there were more than limit
+  static std::vector<Event> find(const std::string &short_name, long unit, std::int64_t after_ms, std::int64_t before_ms, size_t limit, bool &more);
+  static Control_Api::Response handle_request(const Control_Api::Request &request);
+  static const char *type_name(Event_Type type);
+
+private:
+  // The file as it is mapped, unmapped when the last user lets it go
+  struct Mapping {
+    int fd;
+    unsigned char *map;
+    size_t size;
+    std::uint64_t blocks;
+    ~Mapping();
+  };
+
+  typedef std::pair<int, long> Key; // the System's index in the file and the unit
+  struct Key_Hash {
+    size_t operator()(const Key &k) const {
+      size_t h = std::hash<long>()(k.second);
+      h ^= std::hash<int>()(k.first) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      return h;
+    }
+  };
+
+  static std::shared_ptr<Mapping> map_file(const std::string &filename, std::uint64_t blocks);
+  static bool start_file();
+  static int system_index(const std::string &short_name);
+
+  static std::mutex mutex;
+  static std::string filename;
+  static std::uint64_t max_blocks;
+  static std::shared_ptr<Mapping> mapping;
+  static std::uint64_t count;        // events in the file
+  static std::vector<int> sys_index; // for each sys_num, its index in the file
+  static std::unordered_map<Key, Unit_State, Key_Hash> units;
+};
+
+#endif // UNIT_ACTIVITY_H
@@ -1,4 +1,6 @@
 #include "unit_tags.h"
+#include "ota_alias_writer.h"
+#include "table_cache.h"
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -10,16 +12,32 @@
 #include <csv-parser/csv.hpp>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <climits>
 #include <fstream>
 #include <iostream>
 #include <map>
 
 using namespace csv;
 
-void UnitTags::load_unit_tags(std::string filename) {
+// Bump this when what load_unit_tags() keeps for a row changes
+static const char *UNIT_TAGS_CACHE = "unittags1";
+
+bool UnitTags::load_unit_tags(std::string filename) {
   if (filename == "") {
-    return;
+    return true;
+  }
+
+  // unit id, tag
+  Table_Cache::Reader cache;
+  if (Table_Cache::open(filename, UNIT_TAGS_CACHE, 0, 2, cache)) {
+    for (size_t i = 0; i < cache.size(); i++) {
+      add(cache.get_string(i, 0), cache.get_string(i, 1));
+    }
+    BOOST_LOG_TRIVIAL(info) << "Read " << cache.size() << " unit tags from the table cache.";
+    return true;
   }
+  Table_Cache::Writer cached(filename, 0, 2);
 
   CSVFormat format;
   format.trim({' ', '\t'});
@@ -40,31 +58,51 @@ void UnitTags::load_unit_tags(std::string filename) {
       
       add(pattern, tag);
       lines_loaded++;
+
+      const std::string cache_strings[] = {pattern, tag};
+      cached.add(NULL, cache_strings);
     }
     
     BOOST_LOG_TRIVIAL(info) << "Read " << lines_loaded << " unit tags.";
+    Table_Cache::save(filename, UNIT_TAGS_CACHE, cached);
   } catch (std::exception &e) {
     BOOST_LOG_TRIVIAL(error) << "Error reading Unit Tag File: " << filename << " - " << e.what();
+    return false;
   }
+  return true;
 }
 
-void UnitTags::load_unit_tags_ota(std::string filename) {
-  ota_filename = filename;
-  
-  if (filename == "") {
-    return;
+UnitTags::~UnitTags() {
+  for (std::vector<UnitTagOTA *>::iterator it = unit_tags_ota.begin(); it != unit_tags_ota.end(); ++it) {
+    delete *it;
   }
+}
 
-  if (mode == TAG_NONE) {
-    return;
-  }
+void UnitTags::replace_user_tags(UnitTags &fresh) {
+  std::lock_guard<std::mutex> lock(tags_mutex);
+  unit_tag_records.swap(fresh.unit_tag_records);
+  unit_tags.swap(fresh.unit_tags);
+  exact_tags.swap(fresh.exact_tags);
+  range_tags.swap(fresh.range_tags);
+  range_max_high.swap(fresh.range_max_high);
+  regex_tags.swap(fresh.regex_tags);
+  cache.clear();
+  cache_index.clear();
+}
 
-  std::ifstream test(filename);
-  if (!test.good()) {
-    return;  // File doesn't exist yet, that's ok!
-  }
-  test.close();
+// One row of the OTA CSV: unitID,alias,source,timestamp,WACN,SYS,talkgroup
+std::vector<std::string> UnitTags::ota_row(const UnitTagOTA *ota_tag) {
+  return std::vector<std::string>{
+      std::to_string(ota_tag->unit_id),
+      ota_tag->alias,
+      ota_tag->source,
+      std::to_string(ota_tag->timestamp),
+      ota_tag->wacn,
+      ota_tag->sys,
+      (ota_tag->talkgroup_id == -1) ? "" : std::to_string(ota_tag->talkgroup_id)};
+}
 
+bool UnitTags::read_ota_file(const std::string &filename, std::vector<UnitTagOTA *> &tags, int &lines_needing_update) {
   CSVFormat format;
   format.trim({' ', '\t'});
   format.header_row(-1);  // No header row
@@ -73,8 +111,6 @@ void UnitTags::load_unit_tags_ota(std::string filename) {
   try {
     CSVReader reader(filename, format);
     
-    int lines_loaded = 0;
-    int lines_needing_update = 0;
     for (CSVRow &row : reader) {
       if (row.size() < 2) {
         continue;
@@ -96,164 +132,292 @@ void UnitTags::load_unit_tags_ota(std::string filename) {
         lines_needing_update++;
       }
       
-      UnitTagOTA *ota_tag = new UnitTagOTA(unit_id, tag, source, wacn, sys, tg, ts);
-      unit_tags_ota.push_back(ota_tag);
-      lines_loaded++;
+      tags.push_back(new UnitTagOTA(unit_id, tag, source, wacn, sys, tg, ts));
     }
+  } catch (std::exception &e) {
+    BOOST_LOG_TRIVIAL(error) << "Error reading OTA Unit Tag File: " << filename << " - " << e.what();
+    return false;
+  }
+  return true;
+}
+
+int UnitTags::dedupe_ota(std::vector<UnitTagOTA *> &tags) {
+  // Deduplicate: keep newest entry per unit_id
+  std::map<long, UnitTagOTA*> unique_tags;
+  int duplicates_removed = 0;
+  
+  for (auto ota_tag : tags) {
+    auto result = unique_tags.insert(std::make_pair(ota_tag->unit_id, ota_tag));
     
-    if (lines_loaded > 0) {
-      BOOST_LOG_TRIVIAL(info) << "Loaded " << lines_loaded << " OTA unit tags.";
-      
-      // Check if data is already sorted by unit_id
-      bool is_sorted = true;
-      for (size_t i = 1; i < unit_tags_ota.size(); i++) {
-        if (unit_tags_ota[i-1]->unit_id > unit_tags_ota[i]->unit_id) {
-          is_sorted = false;
-          break;
-        }
-      }
-      
-      // Deduplicate: keep newest entry per unit_id
-      std::map<long, UnitTagOTA*> unique_tags;
-      int duplicates_removed = 0;
-      
-      for (auto ota_tag : unit_tags_ota) {
-        auto result = unique_tags.insert(std::make_pair(ota_tag->unit_id, ota_tag));
-        
-        if (!result.second) {
-          // Duplicate found - compare timestamps and metadata completeness
-          UnitTagOTA *current = result.first->second;
-          bool replace = false;
-          if (ota_tag->timestamp > current->timestamp) {
-            replace = true;
-          } else if (ota_tag->timestamp == current->timestamp && !ota_tag->wacn.empty() && current->wacn.empty()) {
-            replace = true;
-          }
-          
-          if (replace) {
-            delete current;
-            result.first->second = ota_tag;
-          } else {
-            delete ota_tag;
-          }
-          duplicates_removed++;
-        }
+    if (!result.second) {
+      // Duplicate found - compare timestamps and metadata completeness
+      UnitTagOTA *current = result.first->second;
+      bool replace = false;
+      if (ota_tag->timestamp > current->timestamp) {
+        replace = true;
+      } else if (ota_tag->timestamp == current->timestamp && !(ota_tag->wacn.empty() && !current->wacn.empty())) {
+        // rows are appended, so of two from the same second the later one is newer,
+        // unless it would lose the decode metadata
+        replace = true;
       }
       
-      if (duplicates_removed > 0 || !is_sorted || lines_needing_update > 0) {
-        if (duplicates_removed > 0) {
-          BOOST_LOG_TRIVIAL(info) << " Found " << duplicates_removed << " duplicate OTA entries";
-        }
-        if (!is_sorted) {
-          BOOST_LOG_TRIVIAL(info) << " OTA CSV is unsorted, reorganizing by unit ID";
-        }
-        if (lines_needing_update > 0) {
-          BOOST_LOG_TRIVIAL(info) << " " << lines_needing_update << " OTA tags with incomplete metadata, will update as discovered";
-        }
-        
-        unit_tags_ota.clear();
-        for (auto &pair : unique_tags) {
-          unit_tags_ota.push_back(pair.second);
-        }
-        
-        // Atomic rewrite: temp file + rename
-        try {
-          std::string temp_file = filename + ".tmp";
-          std::ofstream out(temp_file, std::ios::trunc);
-          if (out.is_open()) {
-            CSVWriter<std::ofstream> writer(out);
-            for (UnitTagOTA *ota_tag : unit_tags_ota) {
-              writer << std::vector<std::string>{
-                std::to_string(ota_tag->unit_id),
-                ota_tag->alias,
-                ota_tag->source,
-                std::to_string(ota_tag->timestamp),
-                ota_tag->wacn,
-                ota_tag->sys,
-                (ota_tag->talkgroup_id == -1) ? "" : std::to_string(ota_tag->talkgroup_id)
-              };
-            }
-            out.close();
-            
-            if (std::rename(temp_file.c_str(), filename.c_str()) == 0) {
-              BOOST_LOG_TRIVIAL(info) << "OTA CSV cleaned and sorted successfully (" << unique_tags.size() << " entries)";
-            } else {
-              BOOST_LOG_TRIVIAL(error) << "Failed to rename cleaned CSV";
-            }
-          }
-        } catch (std::exception &e) {
-          BOOST_LOG_TRIVIAL(error) << "Error rewriting CSV: " << e.what();
-        }
+      if (replace) {
+        delete current;
+        result.first->second = ota_tag;
+      } else {
+        delete ota_tag;
       }
+      duplicates_removed++;
+    }
+  }
+
+  tags.clear();
+  for (auto &pair : unique_tags) {
+    tags.push_back(pair.second);
+  }
+  return duplicates_removed;
+}
+
+bool UnitTags::write_ota_file(const std::string &filename, const std::vector<UnitTagOTA *> &tags) {
+  // Atomic rewrite: temp file + rename
+  try {
+    std::string temp_file = filename + ".tmp";
+    std::ofstream out(temp_file, std::ios::trunc);
+    if (!out.is_open()) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to open " << temp_file << " for rewriting OTA CSV";
+      return false;
+    }
+    CSVWriter<std::ofstream> writer(out);
+    for (UnitTagOTA *ota_tag : tags) {
+      writer << ota_row(ota_tag);
+    }
+    out.close();
+    
+    if (std::rename(temp_file.c_str(), filename.c_str()) != 0) {
+      BOOST_LOG_TRIVIAL(error) << "Failed to rename cleaned CSV";
+      return false;
     }
   } catch (std::exception &e) {
-    BOOST_LOG_TRIVIAL(error) << "Error reading OTA Unit Tag File: " << filename << " - " << e.what();
+    BOOST_LOG_TRIVIAL(error) << "Error rewriting CSV: " << e.what();
+    return false;
   }
+  return true;
 }
 
-std::string UnitTags::find_unit_tag(long tg_number) {
-  // TAG_NONE: Don't search any tags
-  if (mode == TAG_NONE) {
-    return "";
+void UnitTags::compact_ota_file(const std::string &filename) {
+  std::vector<UnitTagOTA *> tags;
+  int lines_needing_update = 0;
+  if (read_ota_file(filename, tags, lines_needing_update)) {
+    size_t lines = tags.size();
+    int duplicates_removed = dedupe_ota(tags);
+    if ((duplicates_removed > 0) && write_ota_file(filename, tags)) {
+      BOOST_LOG_TRIVIAL(debug) << "Compacted OTA CSV " << filename << " from " << lines << " to " << tags.size() << " entries";
+    }
   }
+  for (UnitTagOTA *ota_tag : tags) {
+    delete ota_tag;
+  }
+}
 
-  std::string tg_num_str = std::to_string(tg_number);
+void UnitTags::load_unit_tags_ota(std::string filename) {
+  ota_filename = filename;
   
-  // Helper lambda: Search user tags
-  auto search_user_tags = [&]() -> std::string {
-    for (std::vector<UnitTag *>::iterator it = unit_tags.begin(); it != unit_tags.end(); ++it) {
-      UnitTag *tg = (UnitTag *)*it;
-      if (regex_match(tg_num_str, tg->pattern)) {
-        return regex_replace(tg_num_str, tg->pattern, tg->tag, boost::regex_constants::format_no_copy | boost::regex_constants::format_all);
+  if (filename == "") {
+    return;
+  }
+
+  if (mode == TAG_NONE) {
+    return;
+  }
+
+  std::ifstream test(filename);
+  if (!test.good()) {
+    return;  // File doesn't exist yet, that's ok!
+  }
+  test.close();
+
+  std::vector<UnitTagOTA *> loaded;
+  int lines_needing_update = 0;
+  if (read_ota_file(filename, loaded, lines_needing_update) && (loaded.size() > 0)) {
+    BOOST_LOG_TRIVIAL(info) << "Loaded " << loaded.size() << " OTA unit tags.";
+    
+    // Check if data is already sorted by unit_id
+    bool is_sorted = true;
+    for (size_t i = 1; i < loaded.size(); i++) {
+      if (loaded[i-1]->unit_id > loaded[i]->unit_id) {
+        is_sorted = false;
+        break;
       }
     }
-    return "";
-  };
-  
-  // Helper lambda: Search OTA tags
-  auto search_ota_tags = [&]() -> std::string {
-    for (auto it = unit_tags_ota.rbegin(); it != unit_tags_ota.rend(); ++it) {
-      UnitTagOTA *ota_tag = *it;
-      if (ota_tag->unit_id == tg_number) {
-        return ota_tag->alias;
+    
+    int duplicates_removed = dedupe_ota(loaded);
+    
+    if (duplicates_removed > 0 || !is_sorted || lines_needing_update > 0) {
+      if (duplicates_removed > 0) {
+        BOOST_LOG_TRIVIAL(info) << " Found " << duplicates_removed << " duplicate OTA entries";
+      }
+      if (!is_sorted) {
+        BOOST_LOG_TRIVIAL(info) << " OTA CSV is unsorted, reorganizing by unit ID";
+      }
+      if (lines_needing_update > 0) {
+        BOOST_LOG_TRIVIAL(info) << " " << lines_needing_update << " OTA tags with incomplete metadata, will update as discovered";
+      }
+      
+      if (write_ota_file(filename, loaded)) {
+        BOOST_LOG_TRIVIAL(info) << "OTA CSV cleaned and sorted successfully (" << loaded.size() << " entries)";
       }
     }
+  }
+
+  std::lock_guard<std::mutex> lock(tags_mutex);
+  unit_tags_ota.insert(unit_tags_ota.end(), loaded.begin(), loaded.end());
+  ota_by_unit.clear();
+  for (auto ota_tag : unit_tags_ota) {
+    index_ota(ota_tag);
+  }
+}
+
+void UnitTags::index_ota(UnitTagOTA *ota_tag) {
+  // the newest one wins, as the list used to be searched from the end
+  ota_by_unit[ota_tag->unit_id] = ota_tag;
+}
+
+std::string UnitTags::find_user_tag(long unitID) {
+  std::unordered_map<long, std::list<std::pair<long, std::string>>::iterator>::iterator cached = cache_index.find(unitID);
+  if (cached != cache_index.end()) {
+    cache.splice(cache.begin(), cache, cached->second);
+    return cached->second->second;
+  }
+
+  // The first row in the file that matches wins, whichever kind it is
+  size_t best_order = SIZE_MAX;
+  std::string tag;
+
+  std::unordered_map<long, Exact_Tag>::const_iterator exact = exact_tags.find(unitID);
+  if (exact != exact_tags.end()) {
+    best_order = exact->second.order;
+    tag = exact->second.unit_tag->tag;
+  }
+
+  // ranges that start at or below unitID, back as far as one could still reach it
+  std::vector<Range_Tag>::const_iterator first_above = std::upper_bound(range_tags.begin(), range_tags.end(), unitID, [](long id, const Range_Tag &range) { return id < range.low; });
+  for (size_t i = first_above - range_tags.begin(); (i > 0) && (range_max_high[i - 1] >= unitID); i--) {
+    const Range_Tag &range = range_tags[i - 1];
+    if ((range.high >= unitID) && (range.order < best_order)) {
+      best_order = range.order;
+      tag = range.unit_tag->tag;
+    }
+  }
+
+  std::string unit_id_str = std::to_string(unitID);
+  for (std::vector<Regex_Tag>::const_iterator it = regex_tags.begin(); (it != regex_tags.end()) && (it->order < best_order); ++it) {
+    UnitTag *unit_tag = it->unit_tag;
+    if (regex_match(unit_id_str, unit_tag->pattern)) {
+      tag = regex_replace(unit_id_str, unit_tag->pattern, unit_tag->tag, boost::regex_constants::format_no_copy | boost::regex_constants::format_all);
+      break;
+    }
+  }
+
+  cache.push_front(std::make_pair(unitID, tag));
+  cache_index[unitID] = cache.begin();
+  if (cache.size() > CACHE_SIZE) {
+    cache_index.erase(cache.back().first);
+    cache.pop_back();
+  }
+  return tag;
+}
+
+std::string UnitTags::find_ota_tag(long unitID) {
+  std::unordered_map<long, UnitTagOTA *>::const_iterator it = ota_by_unit.find(unitID);
+  if (it == ota_by_unit.end()) {
     return "";
-  };
-  
+  }
+  return it->second->alias;
+}
+
+std::string UnitTags::find_unit_tag(long tg_number) {
+  // TAG_NONE: Don't search any tags
+  if (mode == TAG_NONE) {
+    return "";
+  }
+
+  std::lock_guard<std::mutex> lock(tags_mutex);
+
   // TAG_USER_FIRST: Search user tags first, then OTA
   if (mode == TAG_USER_FIRST) {
-    std::string tag = search_user_tags();
+    std::string tag = find_user_tag(tg_number);
     if (!tag.empty()) return tag;
-    return search_ota_tags();
+    return find_ota_tag(tg_number);
   }
   
   // TAG_OTA_FIRST: Search OTA tags first, then user tags
   if (mode == TAG_OTA_FIRST) {
-    std::string tag = search_ota_tags();
+    std::string tag = find_ota_tag(tg_number);
     if (!tag.empty()) return tag;
-    return search_user_tags();
+    return find_user_tag(tg_number);
   }
 
   // TAG_USER_ONLY: Only search user tags
   if (mode == TAG_USER_ONLY) {
-    return search_user_tags();
+    return find_user_tag(tg_number);
   }
 
   return "";
 }
 
+// A plain number, as std::to_string would write it
+static bool parse_unit_id(const std::string &s, long &id) {
+  if (s.empty() || (s.length() > 18) || ((s[0] == '0') && (s.length() > 1))) {
+    return false;
+  }
+  for (size_t i = 0; i < s.length(); i++) {
+    if (!isdigit((unsigned char)s[i])) {
+      return false;
+    }
+  }
+  id = std::stol(s);
+  return true;
+}
+
 void UnitTags::add(std::string pattern, std::string tag) {
+  std::lock_guard<std::mutex> lock(tags_mutex);
+  size_t order = unit_tags.size();
+  std::string unit_id = pattern;
+
   // If the pattern is like /someregex/
   if (pattern.substr(0, 1).compare("/") == 0 && pattern.substr(pattern.length()-1, 1).compare("/") == 0) {
     // then remove the / at the beginning and end
     pattern = pattern.substr(1, pattern.length()-2);
+    unit_id = "";
   } else {
     // otherwise add ^ and $ to the pattern e.g. ^123$ to make a regex for simple IDs
     pattern = "^" + pattern + "$";
   }
-  UnitTag *unit_tag = new UnitTag(pattern, tag);
+  UnitTag *unit_tag = unit_tag_records.make(pattern, tag);
   unit_tags.push_back(unit_tag);
+  cache.clear();
+  cache_index.clear();
+
+  // A tag with none of the format characters comes out of regex_replace as it is
+  bool literal_tag = (tag.find_first_of("$\\()?:") == std::string::npos);
+  size_t dash = unit_id.find('-');
+  long low, high;
+
+  if (literal_tag && parse_unit_id(unit_id, low)) {
+    Exact_Tag exact = {order, unit_tag};
+    exact_tags.insert(std::make_pair(low, exact)); // keeps the first row for an ID
+  } else if ((dash != std::string::npos) && parse_unit_id(unit_id.substr(0, dash), low) && parse_unit_id(unit_id.substr(dash + 1), high) && (low <= high)) {
+    // A range like 100000-199999; as a regex it could never match a unit ID
+    Range_Tag range = {low, high, order, unit_tag};
+    range_tags.insert(std::upper_bound(range_tags.begin(), range_tags.end(), low, [](long id, const Range_Tag &r) { return id < r.low; }), range);
+    range_max_high.resize(range_tags.size());
+    for (size_t i = 0; i < range_tags.size(); i++) {
+      range_max_high[i] = (i == 0) ? range_tags[i].high : std::max(range_max_high[i - 1], range_tags[i].high);
+    }
+  } else {
+    Regex_Tag regex = {order, unit_tag};
+    regex_tags.push_back(regex);
+  }
 }
 
 bool UnitTags::add_ota(const OTAAlias& ota_alias) {
@@ -266,14 +430,13 @@ bool UnitTags::add_ota(const OTAAlias& ota_alias) {
     return false;
   }
   
+  std::lock_guard<std::mutex> lock(tags_mutex);
+
   // Check if this unit already has an OTA tag (search OTA list only)
   UnitTagOTA *existing_ota = nullptr;
-  for (auto it = unit_tags_ota.rbegin(); it != unit_tags_ota.rend(); ++it) {
-    UnitTagOTA *ota_tag = *it;
-    if (ota_tag->unit_id == ota_alias.radio_id) {
-      existing_ota = ota_tag;
-      break;
-    }
+  std::unordered_map<long, UnitTagOTA *>::const_iterator found = ota_by_unit.find(ota_alias.radio_id);
+  if (found != ota_by_unit.end()) {
+    existing_ota = found->second;
   }
   
   if (existing_ota) {
@@ -294,18 +457,7 @@ bool UnitTags::add_ota(const OTAAlias& ota_alias) {
         
         // Append enriched entry to CSV
         if (!ota_filename.empty()) {
-          try {
-            std::ofstream out(ota_filename, std::ios::app);
-            if (out.is_open()) {
-              CSVWriter<std::ofstream> writer(out);
-              writer << std::vector<std::string>{std::to_string(ota_alias.radio_id), ota_alias.alias, ota_alias.source, std::to_string(existing_ota->timestamp), ota_alias.wacn, ota_alias.sys, (ota_alias.talkgroup_id == -1) ? "" : std::to_string(ota_alias.talkgroup_id)};
-              out.close();
-            } else {
-              BOOST_LOG_TRIVIAL(error) << "Failed to open " << ota_filename << " for appending enriched entry";
-            }
-          } catch (std::exception &e) {
-            BOOST_LOG_TRIVIAL(error) << "Error appending enriched OTA entry: " << e.what();
-          }
+          OTA_Alias_Writer::append(ota_filename, ota_row(existing_ota));
         }
         return false;
       }
@@ -317,21 +469,11 @@ bool UnitTags::add_ota(const OTAAlias& ota_alias) {
   
   UnitTagOTA *ota_tag = new UnitTagOTA(ota_alias.radio_id, ota_alias.alias, ota_alias.source, ota_alias.wacn, ota_alias.sys, ota_alias.talkgroup_id, std::time(nullptr));
   unit_tags_ota.push_back(ota_tag);
+  index_ota(ota_tag);
 
   // Write to OTA file if configured
   if (!ota_filename.empty()) {
-    try {
-      std::ofstream out(ota_filename, std::ios::app);
-      if (out.is_open()) {
-        CSVWriter<std::ofstream> writer(out);
-        writer << std::vector<std::string>{std::to_string(ota_alias.radio_id), ota_alias.alias, ota_alias.source, std::to_string(ota_tag->timestamp), ota_alias.wacn, ota_alias.sys, (ota_alias.talkgroup_id == -1) ? "" : std::to_string(ota_alias.talkgroup_id)};
-        out.close();
-      } else {
-        BOOST_LOG_TRIVIAL(error) << "Failed to open " << ota_filename << " for writing OTA alias.";
-      }
-    } catch (std::exception &e) {
-      BOOST_LOG_TRIVIAL(error) << "Error writing to OTA file " << ota_filename << ": " << e.what();
-    }
+    OTA_Alias_Writer::append(ota_filename, ota_row(ota_tag));
   }
   
   return true;
@@ -350,5 +492,32 @@ std::vector<UnitTag *> UnitTags::get_unit_tags() {
 }
 
 std::vector<UnitTagOTA *> UnitTags::get_unit_tags_ota() {
+  std::lock_guard<std::mutex> lock(tags_mutex);
   return unit_tags_ota;
 }
+
+// Roughly, the compiled regexes only by their size
+std::vector<Memory_Usage> UnitTags::get_memory_usage() {
+  std::lock_guard<std::mutex> lock(tags_mutex);
+  std::vector<Memory_Usage> usage(2);
+  usage[0].subsystem = "Tables";
+  usage[0].name = "unit tags";
+  usage[0].count = unit_tag_records.size();
+  usage[0].bytes = unit_tag_records.bytes() + unit_tags.capacity() * sizeof(UnitTag *) + index_bytes(exact_tags) + range_tags.capacity() * sizeof(Range_Tag) + range_max_high.capacity() * sizeof(long) + regex_tags.capacity() * sizeof(Regex_Tag) + index_bytes(cache_index);
+  for (std::vector<UnitTag *>::const_iterator it = unit_tags.begin(); it != unit_tags.end(); ++it) {
+    usage[0].bytes += string_bytes((*it)->tag);
+  }
+  for (std::list<std::pair<long, std::string>>::const_iterator it = cache.begin(); it != cache.end(); ++it) {
+    usage[0].bytes += sizeof(*it) + 2 * sizeof(void *) + string_bytes(it->second);
+  }
+
+  usage[1].subsystem = "Tables";
+  usage[1].name = "OTA aliases";
+  usage[1].count = unit_tags_ota.size();
+  usage[1].bytes = unit_tags_ota.capacity() * sizeof(UnitTagOTA *) + index_bytes(ota_by_unit);
+  for (std::vector<UnitTagOTA *>::const_iterator it = unit_tags_ota.begin(); it != unit_tags_ota.end(); ++it) {
+    const UnitTagOTA *ota = *it;
+    usage[1].bytes += sizeof(UnitTagOTA) + string_bytes(ota->alias) + string_bytes(ota->source) + string_bytes(ota->wacn) + string_bytes(ota->sys);
+  }
+  return usage;
+}
@@ -1,10 +1,16 @@
 #ifndef UNIT_TAGS_H
 #define UNIT_TAGS_H
 
+#include "global_structs.h"
+#include "record_arena.h"
 #include "unit_tag.h"
 #include "unit_tags_ota.h"
 
+#include <list>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 enum UnitTagMode {
@@ -14,21 +20,81 @@ enum UnitTagMode {
   TAG_NONE = -1       // Don't search any tags
 };
 
+/*
+ * UnitTags
+ *   The user tags from unitTagsFile and the OTA aliases for a system.
+ *
+ * User tags are matched in the order they are in the file, but a row that
+ * is just a unit ID goes in a hash map and a row that is a range like
+ * 100000-199999 goes in a sorted list of ranges, so only the rows that
+ * really are regexes get run, and only the ones ahead of the best match
+ * found so far. The user tag found for each unit ID is kept in a small LRU
+ * cache, since the same radios come up again and again.
+ *
+ * The UnitTags are made in a Record_Arena and the hash map and ranges
+ * point into it rather than keeping their own copy of each tag.
+ *
+ * OTA aliases are looked up by unit ID in a hash map of the newest alias
+ * for each.
+ */
 class UnitTags {
+  Record_Arena<UnitTag> unit_tag_records;
   std::vector<UnitTag *> unit_tags;                  // Manual tags from unitTagsFile (regex patterns)
   std::vector<UnitTagOTA *> unit_tags_ota;           // OTA tags: simple (unitID, alias) pairs
   std::string ota_filename;
   UnitTagMode mode = TAG_USER_FIRST;                 // Default to user tags first
 
+  struct Exact_Tag {
+    size_t order; // row in unitTagsFile
+    const UnitTag *unit_tag;
+  };
+  struct Range_Tag {
+    long low;
+    long high;
+    size_t order;
+    const UnitTag *unit_tag;
+  };
+  struct Regex_Tag {
+    size_t order;
+    UnitTag *unit_tag;
+  };
+  std::unordered_map<long, Exact_Tag> exact_tags;    // first row for each ID
+  std::vector<Range_Tag> range_tags;                 // sorted by low
+  std::vector<long> range_max_high;                  // highest high of range_tags[0..i]
+  std::vector<Regex_Tag> regex_tags;                 // in file order
+
+  static const size_t CACHE_SIZE = 4096;
+  std::list<std::pair<long, std::string>> cache;     // most recently used first
+  std::unordered_map<long, std::list<std::pair<long, std::string>>::iterator> cache_index;
+
+  std::unordered_map<long, UnitTagOTA *> ota_by_unit; // newest alias for each unit
+  std::mutex tags_mutex;                             // lookups come from the concluder and plugins too
+
+  std::string find_user_tag(long unitID);
+  std::string find_ota_tag(long unitID);
+  void index_ota(UnitTagOTA *ota_tag);
+
 public:
-  void load_unit_tags(std::string filename);
+  ~UnitTags();
+  bool load_unit_tags(std::string filename); // false if the file couldn't be read, which has been logged
   void load_unit_tags_ota(std::string filename);
   std::string find_unit_tag(long unitID);
   void add(std::string pattern, std::string tag);
   bool add_ota(const OTAAlias& ota_alias);
+  // Takes the user tags of fresh, which gets these ones, and keeps the OTA aliases
+  void replace_user_tags(UnitTags &fresh);
   void set_mode(UnitTagMode mode);
   UnitTagMode get_mode();
   std::vector<UnitTag *> get_unit_tags();
   std::vector<UnitTagOTA *> get_unit_tags_ota();
+  // The user tags with their cache, and the OTA aliases
+  std::vector<Memory_Usage> get_memory_usage();
+
+  // The OTA CSV, shared with the OTA_Alias_Writer
+  static std::vector<std::string> ota_row(const UnitTagOTA *ota_tag);
+  static bool read_ota_file(const std::string &filename, std::vector<UnitTagOTA *> &tags, int &lines_needing_update);
+  static int dedupe_ota(std::vector<UnitTagOTA *> &tags); // keeps the newest for each unit, sorted by unit ID
+  static bool write_ota_file(const std::string &filename, const std::vector<UnitTagOTA *> &tags);
+  static void compact_ota_file(const std::string &filename);
 };
 #endif // UNIT_TAGS_H
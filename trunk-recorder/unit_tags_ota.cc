@@ -4,9 +4,6 @@
 #include "unit_tags_ota.h"
 
 #include <boost/log/trivial.hpp>
-#include <sstream>
-#include <iomanip>
-#include <map>
 #include <array>
 #include <cctype>
 
@@ -17,259 +14,211 @@ static void rtrim_whitespace(std::string &s) {
   }
 }
 
-// OTA Motorola alias handling tools
-
-OTAAlias UnitTagsOTA::decode_motorola_alias(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages) {
-  // Validate input
-  if (messages <= 0 || messages >= (int)alias_buffer.size()) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: invalid message count " << messages;
-    return OTAAlias();
-  }
+static const char HEX_DIGITS[] = "0123456789abcdef";
 
-  // Assemble the payload from all message fragments
-  std::string payload_hex = assemble_payload(alias_buffer, messages);
-  if (payload_hex.length() < 32) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: assembled payload too short (" << payload_hex.length() << " chars)";
-    return OTAAlias();
-  }
-
-  // Extract components
-  std::string tg = payload_hex.substr(0, 4);           // Talkgroup ID
-  std::string msg_count = payload_hex.substr(4, 2);    // # of Data blocks
-  std::string unknown_4 = payload_hex.substr(6, 4);    // [unknown] - format?
-  std::string sequence_id = payload_hex.substr(10, 1); // Sequence ID char
-  std::string unknown_3 = payload_hex.substr(11, 3);   // [unknown] - checksum?
-  std::string wacn = payload_hex.substr(14, 5);        // WACN 
-  std::string sys = payload_hex.substr(19, 3);         // System ID
-  std::string radio = payload_hex.substr(22, 6);       // Radio ID
-  std::string length_code = payload_hex.substr(28, 2); // Alias length code (first 2 chars of alias)
-  
-  static const std::map<std::string, int> length_lookup = {
-    {"94", 1}, {"32", 2}, {"95", 3}, {"9d", 4}, {"1b", 5}, {"77", 6}, {"b5", 7},
-    {"6e", 8}, {"24", 9}, {"61", 10}, {"2d", 11}, {"7d", 12}, {"83", 13}, {"29", 14}
-  };
-
-  auto it = length_lookup.find(length_code);
-  int alias_len = (it != length_lookup.end()) ? it->second : 0;
+static int hex_digit(char c) {
+  if ((c >= '0') && (c <= '9')) return c - '0';
+  if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+  return -1;
+}
 
-  if (alias_len == 0) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: unknown alias length code: " << length_code;
-    return OTAAlias();
+bool OTAAliasBlocks::set_hex(size_t block, const std::string &hex) {
+  if ((block >= MAX_BLOCKS) || (hex.length() / 2 > MAX_BLOCK_BYTES)) {
+    return false;
   }
-
-  size_t required_len = 28 + alias_len * 4 + 4;
-  if (payload_hex.length() < required_len) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: payload too short for alias length " << alias_len;
-    return OTAAlias();
+  size_t length = 0;
+  for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+    int hi = hex_digit(hex[i]);
+    int lo = hex_digit(hex[i + 1]);
+    if ((hi < 0) || (lo < 0)) {
+      size[block] = 0;
+      return false;
+    }
+    data[block][length++] = static_cast<uint8_t>((hi << 4) | lo);
   }
+  size[block] = length;
+  return true;
+}
 
-  std::string alias_code = payload_hex.substr(28, alias_len * 4);
-  std::string checksum = payload_hex.substr(28 + alias_len * 4, 4);
-
-  // Convert radio ID to decimal
-  unsigned long radio_decimal = std::stoul(radio, nullptr, 16);
-  unsigned long tg_decimal = std::stoul(tg, nullptr, 16);
-
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: WACN: " << wacn << ", SYS: " << sys << ", Radio: " << radio_decimal << " (0x" << radio << ")" << ", TG: " << tg_decimal << " (0x" << tg << ")";
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: Alias Length: " << alias_len << ", Code: " << alias_code << ", Checksum: " << checksum;
+// OTA Motorola alias handling tools
 
-  // Validate CRC
-  std::string crc_payload = wacn + sys + radio + alias_code;
-  if (!validate_crc(crc_payload, checksum)) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: CRC-16/GSM check failed";
+OTAAlias UnitTagsOTA::decode_motorola_alias(const OTAAliasBlocks& alias_buffer, int messages) {
+  // Validate input
+  if (messages <= 0 || messages >= (int)OTAAliasBlocks::MAX_BLOCKS) {
+    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: invalid message count " << messages;
     return OTAAlias();
   }
 
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: CRC-16/GSM check passed";
-
-  // Convert hex string to bytes
-  std::vector<uint8_t> payload_bytes = hex_string_to_uint8_vector(crc_payload);
-  if (payload_bytes.empty()) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: failed to parse hex payload";
+  // Assemble the payload from all message fragments
+  Payload payload;
+  if (!assemble_payload(alias_buffer, messages, payload)) {
     return OTAAlias();
   }
-
-  // Need at least 8 bytes (7 byte offset + 1 byte minimum encoded data)
-  if (payload_bytes.size() < 8) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: payload too short for decoding (" << payload_bytes.size() << " bytes)";
+  if (payload.length < 32) {
+    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: assembled payload too short (" << payload.length << " chars)";
     return OTAAlias();
   }
 
-  // Extract encoded portion (skip first 7 bytes)
-  std::vector<int8_t> encoded(payload_bytes.begin() + 7, payload_bytes.end());
-
-  std::string alias = decode_mot_alias(encoded);
-
-  // Trim trailing whitespace from alias
-  rtrim_whitespace(alias);
-
-  if (!alias.empty()) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: Decoded alias: '" << alias << "' for radio " << radio_decimal << " (0x" << radio << ")" << ", TG: " << tg_decimal << " (0x" << tg << ")";
-    return OTAAlias(radio_decimal, alias, "MotoP25_FDMA", wacn, sys, tg_decimal);
-  }
-
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: Decrypt returned empty alias";
-  return OTAAlias();
+  // TG (4), # of data blocks (2), [unknown] (4), sequence ID (1), [unknown] (3), then the WACN
+  return decode_motorola_payload(payload, 14, "MOTOROLA", "MotoP25_FDMA");
 }
 
-// Phase 1 FDMA: assemble payload hex string from message buffer
-std::string UnitTagsOTA::assemble_payload(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages) {
-  std::stringstream ss;
-
-  if (alias_buffer[0].size() < 9) {
+// Phase 1 FDMA: assemble the payload nibbles from the message buffer
+bool UnitTagsOTA::assemble_payload(const OTAAliasBlocks& alias_buffer, int messages, Payload& payload) {
+  if (alias_buffer.size[0] < 9) {
     BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: header too small";
-    return "";
+    return false;
   }
 
-  // Header block - extract bytes 2-8 (7 bytes) - discarding opcode/mfr (bytes 0-1)
-  std::vector<uint8_t> header_slice(alias_buffer[0].begin() + 2, alias_buffer[0].begin() + 9);
-  ss << uint8_vector_to_hex_string(header_slice);
+  payload.length = 0;
+  // Header block - bytes 2-8 (7 bytes) - discarding opcode/mfr (bytes 0-1)
+  for (size_t i = 2; i < 9; i++) {
+    payload.nibble[payload.length++] = alias_buffer.data[0][i] >> 4;
+    payload.nibble[payload.length++] = alias_buffer.data[0][i] & 0xf;
+  }
 
-  for (int i = 1; i <= messages; i++) {
-    if (alias_buffer[i].size() < 9) {
-      BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: alias_buffer[" << i << "] too small";
-      return "";
+  for (int m = 1; m <= messages; m++) {
+    if (alias_buffer.size[m] < 9) {
+      BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: alias_buffer[" << m << "] too small";
+      return false;
     }
 
-    // Bytes 3-8: extract all, then skip first char (upper nibble of byte 3)
-    std::vector<uint8_t> data_slice(alias_buffer[i].begin() + 3, alias_buffer[i].begin() + 9);
-    ss << uint8_vector_to_hex_string(data_slice).substr(1);
+    // Bytes 3-8, less the upper nibble of byte 3
+    payload.nibble[payload.length++] = alias_buffer.data[m][3] & 0xf;
+    for (size_t i = 4; i < 9; i++) {
+      payload.nibble[payload.length++] = alias_buffer.data[m][i] >> 4;
+      payload.nibble[payload.length++] = alias_buffer.data[m][i] & 0xf;
+    }
   }
-
-  return ss.str();
+  return true;
 }
 
 // Phase 2 TDMA: Assemble payload from 17-byte MAC PDU messages
-std::string UnitTagsOTA::assemble_payload_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages) {
-  std::stringstream ss;
-
-  if (alias_buffer[0].size() < 17) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: header too small (" << alias_buffer[0].size() << " bytes)";
-    return "";
+bool UnitTagsOTA::assemble_payload_p2(const OTAAliasBlocks& alias_buffer, int messages, Payload& payload) {
+  if (alias_buffer.size[0] < 17) {
+    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: header too small (" << alias_buffer.size[0] << " bytes)";
+    return false;
   }
 
-  // Header block - extract bytes 3-16 (14 bytes)
-  std::vector<uint8_t> header_slice(alias_buffer[0].begin() + 3, alias_buffer[0].begin() + 17);
-  ss << uint8_vector_to_hex_string(header_slice);
+  payload.length = 0;
+  // Header block - bytes 3-16 (14 bytes)
+  for (size_t i = 3; i < 17; i++) {
+    payload.nibble[payload.length++] = alias_buffer.data[0][i] >> 4;
+    payload.nibble[payload.length++] = alias_buffer.data[0][i] & 0xf;
+  }
 
-  // Data blocks - extract bytes 4-16 (13 bytes each)
-  for (int i = 1; i <= messages; i++) {
-    if (alias_buffer[i].size() < 17) {
-      BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: alias_buffer[" << i << "] too small (" << alias_buffer[i].size() << " bytes)";
-      return "";
+  // Data blocks - bytes 4-16 (13 bytes each)
+  for (int m = 1; m <= messages; m++) {
+    if (alias_buffer.size[m] < 17) {
+      BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: alias_buffer[" << m << "] too small (" << alias_buffer.size[m] << " bytes)";
+      return false;
+    }
+    // Bytes 4-16, less the sequence ID in the upper nibble of byte 4
+    payload.nibble[payload.length++] = alias_buffer.data[m][4] & 0xf;
+    for (size_t i = 5; i < 17; i++) {
+      payload.nibble[payload.length++] = alias_buffer.data[m][i] >> 4;
+      payload.nibble[payload.length++] = alias_buffer.data[m][i] & 0xf;
     }
-    // Bytes 4-16: extract all, then skip first char (sequence ID upper nibble)
-    std::vector<uint8_t> data_slice(alias_buffer[i].begin() + 4, alias_buffer[i].begin() + 17);
-    ss << uint8_vector_to_hex_string(data_slice).substr(1);
   }
-
-  return ss.str();
+  return true;
 }
 
 // Phase 2 TDMA alias decode entry point
-OTAAlias UnitTagsOTA::decode_motorola_alias_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages) {
+OTAAlias UnitTagsOTA::decode_motorola_alias_p2(const OTAAliasBlocks& alias_buffer, int messages) {
   // Validate input
-  if (messages <= 0 || messages >= (int)alias_buffer.size()) {
+  if (messages <= 0 || messages >= (int)OTAAliasBlocks::MAX_BLOCKS) {
     BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: invalid message count " << messages;
     return OTAAlias();
   }
 
   // Assemble the payload from all message fragments using P2 format
-  std::string payload_hex = assemble_payload_p2(alias_buffer, messages);
-  if (payload_hex.length() < 30) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: assembled payload too short (" << payload_hex.length() << " chars)";
+  Payload payload;
+  if (!assemble_payload_p2(alias_buffer, messages, payload)) {
+    return OTAAlias();
+  }
+  if (payload.length < 30) {
+    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: assembled payload too short (" << payload.length << " chars)";
     return OTAAlias();
   }
 
-  // Extract components
-  std::string tg = payload_hex.substr(0, 4);           // Talkgroup ID
-  std::string msg_count = payload_hex.substr(4, 2);    // # of Data blocks
-  std::string unknown_4 = payload_hex.substr(6, 4);    // [unknown] - format?
-  std::string sequence_id = payload_hex.substr(10, 1); // Sequence ID char
-  std::string unknown_1 = payload_hex.substr(11, 1);   // [unknown] - check digit?
-  std::string wacn = payload_hex.substr(12, 5);        // WACN
-  std::string sys = payload_hex.substr(17, 3);         // System ID
-  std::string radio = payload_hex.substr(20, 6);       // Radio ID
-  std::string length_code = payload_hex.substr(26, 2); // Alias length code (first 2 chars of alias)
-
-  static const std::map<std::string, int> length_lookup = {
-    {"94", 1}, {"32", 2}, {"95", 3}, {"9d", 4}, {"1b", 5}, {"77", 6}, {"b5", 7},
-    {"6e", 8}, {"24", 9}, {"61", 10}, {"2d", 11}, {"7d", 12}, {"83", 13}, {"29", 14}
-  };
+  // TG (4), # of data blocks (2), [unknown] (4), sequence ID (1), [unknown] (1), then the WACN
+  return decode_motorola_payload(payload, 12, "MOTOROLA P2", "MotoP25_TDMA");
+}
 
-  auto it = length_lookup.find(length_code);
-  int alias_len = (it != length_lookup.end()) ? it->second : 0;
+// From the WACN on, both phases are laid out the same: WACN (5), System ID
+// (3), Radio ID (6), the alias, whose first byte is its length code, and
+// the CRC-16/GSM of all of that (4)
+OTAAlias UnitTagsOTA::decode_motorola_payload(const Payload& payload, size_t wacn_at, const char *log_prefix, const char *source) {
+  static const uint8_t LENGTH_CODES[14] = {0x94, 0x32, 0x95, 0x9d, 0x1b, 0x77, 0xb5, 0x6e, 0x24, 0x61, 0x2d, 0x7d, 0x83, 0x29};
+
+  size_t alias_at = wacn_at + 14;
+  unsigned long length_code = nibble_value(payload, alias_at, 2);
+  int alias_len = 0;
+  for (int i = 0; i < 14; i++) {
+    if (LENGTH_CODES[i] == length_code) {
+      alias_len = i + 1;
+      break;
+    }
+  }
 
   if (alias_len == 0) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: unknown alias length code: " << length_code;
+    BOOST_LOG_TRIVIAL(debug) << log_prefix << ": unknown alias length code: " << nibble_hex(payload, alias_at, 2);
     return OTAAlias();
   }
 
-  size_t required_len = 26 + alias_len * 4 + 4;
-  if (payload_hex.length() < required_len) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: payload too short for alias length " << alias_len;
+  size_t required_len = alias_at + alias_len * 4 + 4;
+  if (payload.length < required_len) {
+    BOOST_LOG_TRIVIAL(debug) << log_prefix << ": payload too short for alias length " << alias_len;
     return OTAAlias();
   }
 
-  std::string alias_code = payload_hex.substr(26, alias_len * 4);
-  std::string checksum = payload_hex.substr(26 + alias_len * 4, 4);
-
-  unsigned long radio_decimal = std::stoul(radio, nullptr, 16);
-  unsigned long tg_decimal = std::stoul(tg, nullptr, 16);
+  size_t checksum_at = alias_at + alias_len * 4;
+  unsigned long radio_decimal = nibble_value(payload, wacn_at + 8, 6);
+  unsigned long tg_decimal = nibble_value(payload, 0, 4);
 
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: WACN: " << wacn << ", SYS: " << sys << ", Radio: " << radio_decimal << " (0x" << radio << ")" << ", TG: " << tg_decimal << " (0x" << tg << ")";
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: Alias Length: " << alias_len << ", Code: " << alias_code << ", Checksum: " << checksum;
+  BOOST_LOG_TRIVIAL(debug) << log_prefix << ": WACN: " << nibble_hex(payload, wacn_at, 5) << ", SYS: " << nibble_hex(payload, wacn_at + 5, 3) << ", Radio: " << radio_decimal << " (0x" << nibble_hex(payload, wacn_at + 8, 6) << ")" << ", TG: " << tg_decimal << " (0x" << nibble_hex(payload, 0, 4) << ")";
+  BOOST_LOG_TRIVIAL(debug) << log_prefix << ": Alias Length: " << alias_len << ", Code: " << nibble_hex(payload, alias_at, alias_len * 4) << ", Checksum: " << nibble_hex(payload, checksum_at, 4);
 
-  // Validate CRC
-  std::string crc_payload = wacn + sys + radio + alias_code;
-  if (!validate_crc(crc_payload, checksum)) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: CRC-16/GSM check failed for " << crc_payload;
-    return OTAAlias();
+  // WACN through the alias is a whole number of bytes: 7 and then the alias
+  std::array<uint8_t, 7 + 14 * 2> crc_bytes;
+  size_t crc_length = (checksum_at - wacn_at) / 2;
+  for (size_t i = 0; i < crc_length; i++) {
+    crc_bytes[i] = (payload.nibble[wacn_at + i * 2] << 4) | payload.nibble[wacn_at + i * 2 + 1];
   }
 
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: CRC-16/GSM check passed";
-
-  // Convert hex string to bytes
-  std::vector<uint8_t> payload_bytes = hex_string_to_uint8_vector(crc_payload);
-  if (payload_bytes.empty()) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: failed to parse hex payload";
-    return OTAAlias();
-  }
-
-  // Need at least 8 bytes (7 byte offset + 1 byte minimum encoded data)
-  if (payload_bytes.size() < 8) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: payload too short for decoding (" << payload_bytes.size() << " bytes)";
+  // Validate CRC
+  if (crc16_gsm(crc_bytes.data(), crc_length) != nibble_value(payload, checksum_at, 4)) {
+    BOOST_LOG_TRIVIAL(debug) << log_prefix << ": CRC-16/GSM check failed for " << nibble_hex(payload, wacn_at, checksum_at - wacn_at);
     return OTAAlias();
   }
 
-  // Extract encoded portion (skip first 7 bytes)
-  std::vector<int8_t> encoded(payload_bytes.begin() + 7, payload_bytes.end());
-
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: Encoded data size: " << encoded.size() << " bytes";
+  BOOST_LOG_TRIVIAL(debug) << log_prefix << ": CRC-16/GSM check passed";
 
-  std::string alias = decode_mot_alias(encoded);
+  // The encoded alias follows the 7 bytes of WACN, System ID and Radio ID
+  std::string alias = decode_mot_alias(crc_bytes.data() + 7, crc_length - 7);
 
   // Trim trailing whitespace from alias
   rtrim_whitespace(alias);
 
   if (!alias.empty()) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: Decoded alias: '" << alias << "' for radio " << radio_decimal << " (0x" << radio << ")" << ", TG: " << tg_decimal << " (0x" << tg << ")";
-    return OTAAlias(radio_decimal, alias, "MotoP25_TDMA", wacn, sys, tg_decimal);
+    BOOST_LOG_TRIVIAL(debug) << log_prefix << ": Decoded alias: '" << alias << "' for radio " << radio_decimal << " (0x" << nibble_hex(payload, wacn_at + 8, 6) << ")" << ", TG: " << tg_decimal << " (0x" << nibble_hex(payload, 0, 4) << ")";
+    return OTAAlias(radio_decimal, alias, source, nibble_hex(payload, wacn_at, 5), nibble_hex(payload, wacn_at + 5, 3), tg_decimal);
   }
 
-  BOOST_LOG_TRIVIAL(debug) << "MOTOROLA P2: Decrypt returned empty alias";
+  BOOST_LOG_TRIVIAL(debug) << log_prefix << ": Decrypt returned empty alias";
   return OTAAlias();
 }
 
 // Harris Phase 1 FDMA: decode concatenated alias (14 characters)
 // FDMA decoder concatenates Part A (7 chars) + Part B (7 chars) into alias_buffer[0]
 // Radio ID and talkgroup are inferred from current transmission (curr_src_id/curr_grp_id)
-OTAAlias UnitTagsOTA::decode_harris_alias(const std::array<std::vector<uint8_t>, 10>& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id) {
+OTAAlias UnitTagsOTA::decode_harris_alias(const OTAAliasBlocks& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id) {
   BOOST_LOG_TRIVIAL(debug) << "HARRIS P1: Starting decode";
   
   // Validate that we have the concatenated buffer (14 bytes = 7 from Part A + 7 from Part B)
-  if (alias_buffer[0].size() != 14) {
-    BOOST_LOG_TRIVIAL(debug) << "HARRIS P1: Invalid buffer size (" << alias_buffer[0].size() << " bytes, expected exactly 14)";
+  if (alias_buffer.size[0] != 14) {
+    BOOST_LOG_TRIVIAL(debug) << "HARRIS P1: Invalid buffer size (" << alias_buffer.size[0] << " bytes, expected exactly 14)";
     return OTAAlias();
   }
   
@@ -277,7 +226,7 @@ OTAAlias UnitTagsOTA::decode_harris_alias(const std::array<std::vector<uint8_t>,
   
   // Extract all 14 ASCII characters (Part A + Part B already concatenated by FDMA decoder)
   for (size_t i = 0; i < 14; i++) {
-    uint8_t c = alias_buffer[0][i];
+    uint8_t c = alias_buffer.data[0][i];
     if (c == 0x00) break;  // Null terminator
     if (c >= 0x20 && c <= 0x7E) {  // Printable ASCII
       alias += static_cast<char>(c);
@@ -299,22 +248,20 @@ OTAAlias UnitTagsOTA::decode_harris_alias(const std::array<std::vector<uint8_t>,
 
 // Harris Phase 2 TDMA: decode single variable-length message
 // Radio ID and talkgroup are inferred from current transmission (src_id/grp_id)
-OTAAlias UnitTagsOTA::decode_harris_alias_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id) {
+OTAAlias UnitTagsOTA::decode_harris_alias_p2(const OTAAliasBlocks& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id) {
   BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Starting decode";
   
-  if (alias_buffer[0].size() < 4) {
-    BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Message too small (" << alias_buffer[0].size() << " bytes)";
+  if (alias_buffer.size[0] < 4) {
+    BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Message too small (" << alias_buffer.size[0] << " bytes)";
     return OTAAlias();
   }
   
-  // Convert message to hex for logging
-  std::string msg_hex = uint8_vector_to_hex_string(alias_buffer[0]);
-  BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Raw message (" << alias_buffer[0].size() << " bytes): " << msg_hex;
+  BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Raw message (" << alias_buffer.size[0] << " bytes): " << bytes_hex(alias_buffer.data[0].data(), alias_buffer.size[0]);
   
   // Extract all ASCII characters starting at byte 3 (after opcode, MFID, length)
   std::string alias;
-  for (size_t i = 3; i < alias_buffer[0].size(); i++) {
-    uint8_t c = alias_buffer[0][i];
+  for (size_t i = 3; i < alias_buffer.size[0]; i++) {
+    uint8_t c = alias_buffer.data[0][i];
     if (c == 0x00) break;  // Null terminator
     if (c >= 0x20 && c <= 0x7E) {  // Printable ASCII
       alias += static_cast<char>(c);
@@ -324,10 +271,6 @@ OTAAlias UnitTagsOTA::decode_harris_alias_p2(const std::array<std::vector<uint8_
   rtrim_whitespace(alias);
   
   if (!alias.empty()) {
-    std::ostringstream hex_debug;
-    for (unsigned char c : alias) {
-      hex_debug << std::hex << std::setw(2) << std::setfill('0') << (int)c << " ";
-    }
     BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Decoded alias: '" << alias << "' (" << alias.length() << " chars)";
     BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: Inferred radio_id: " << radio_id << ", talkgroup: " << talkgroup_id;
     BOOST_LOG_TRIVIAL(debug) << "HARRIS P2: WACN: " << wacn << ", System: " << sys_id;
@@ -338,17 +281,11 @@ OTAAlias UnitTagsOTA::decode_harris_alias_p2(const std::array<std::vector<uint8_
   return OTAAlias();
 }
 
-// Validate CRC-16/GSM checksum
-bool UnitTagsOTA::validate_crc(const std::string& payload_hex, const std::string& checksum_hex) {
-  // Convert hex string to bytes
-  std::vector<uint8_t> payload_bytes = hex_string_to_uint8_vector(payload_hex);
-  if (payload_bytes.empty()) return false;
-
-  // Calculate CRC-16/GSM
+// CRC-16/GSM, a byte at a time
+uint16_t UnitTagsOTA::crc16_gsm(const uint8_t *bytes, size_t length) {
   uint16_t crc = 0x0000;
-  for (size_t j = 0; j < payload_bytes.size(); ++j) {
-    uint8_t byte = static_cast<uint8_t>(payload_bytes[j]);
-    crc ^= byte << 8;
+  for (size_t j = 0; j < length; ++j) {
+    crc ^= bytes[j] << 8;
 
     for (int i = 0; i < 8; i++) {
       if (crc & 0x8000) {
@@ -358,22 +295,11 @@ bool UnitTagsOTA::validate_crc(const std::string& payload_hex, const std::string
       }
     }
   }
-  uint16_t crc_calc = ~crc & 0xFFFF;
-
-  // Parse expected checksum
-  uint16_t expected_crc = 0;
-  try {
-    expected_crc = std::stoi(checksum_hex, nullptr, 16);
-  } catch (const std::exception& e) {
-    BOOST_LOG_TRIVIAL(debug) << "MOTOROLA: invalid checksum format: " << checksum_hex;
-    return false;
-  }
-
-  return (crc_calc == expected_crc);
+  return ~crc & 0xFFFF;
 }
 
 // De-obfuscate Motorola alias using custom algorithm
-std::string UnitTagsOTA::decode_mot_alias(const std::vector<int8_t>& encoded) {
+std::string UnitTagsOTA::decode_mot_alias(const uint8_t *encoded, size_t length) {
 
   static const uint8_t SUBSTITUTION_TABLE[256] = {
     0xd2, 0xf6, 0xd4, 0x2b, 0x63, 0x49, 0x94, 0x5e, 0xa7, 0x5c, 0x70, 0x69, 0xf7, 0x08, 0xb1, 0x7d,
@@ -406,12 +332,16 @@ std::string UnitTagsOTA::decode_mot_alias(const std::vector<int8_t>& encoded) {
     0x21, 0xcb, 0xed, 0xd7, 0x59, 0xc3, 0xe5, 0x0f, 0x11, 0x3b, 0x5d, 0xc7, 0x49, 0x33, 0x55, 0xff,
   };
 
-  std::vector<uint8_t> decoded(encoded.size(), 0);
+  // At most the 14 characters of a 28 byte alias
+  std::array<uint8_t, 14 * 2> decoded;
+  if (length > decoded.size()) {
+    return "";
+  }
 
-  uint16_t accumulator = static_cast<uint16_t>(decoded.size());
+  uint16_t accumulator = static_cast<uint16_t>(length);
 
-  for (size_t i = 0; i < decoded.size(); ++i) {
-    uint8_t encoded_byte = static_cast<uint8_t>(encoded[i]);
+  for (size_t i = 0; i < length; ++i) {
+    uint8_t encoded_byte = encoded[i];
     
     uint16_t lcg_value = accumulator * 293 + 0x72E9;
     uint8_t substituted = SUBSTITUTION_TABLE[encoded_byte];
@@ -426,9 +356,9 @@ std::string UnitTagsOTA::decode_mot_alias(const std::vector<int8_t>& encoded) {
   }
 
   std::string alias;
-  alias.reserve(decoded.size() / 2);
+  alias.reserve(length / 2);
   
-  for (size_t i = 0; i + 1 < decoded.size(); i += 2) {
+  for (size_t i = 0; i + 1 < length; i += 2) {
     uint16_t codepoint = (static_cast<uint16_t>(decoded[i]) << 8) | decoded[i + 1];
     
     if (codepoint > 31 && codepoint < 128) {
@@ -439,31 +369,31 @@ std::string UnitTagsOTA::decode_mot_alias(const std::vector<int8_t>& encoded) {
   return alias;
 }
 
-// Convert vector of uint8_t to hex string
-std::string UnitTagsOTA::uint8_vector_to_hex_string(const std::vector<uint8_t>& v)
-{
-    std::string result;
-    result.reserve(v.size() * 2);
-
-    static constexpr char hex[] = "0123456789abcdef";
-
-    for (uint8_t c : v)
-    {
-        result.push_back(hex[c / 16]);
-        result.push_back(hex[c % 16]);
-    }
+// The value of count nibbles from at, most significant first
+unsigned long UnitTagsOTA::nibble_value(const Payload& payload, size_t at, size_t count) {
+  unsigned long value = 0;
+  for (size_t i = at; i < at + count; i++) {
+    value = (value << 4) | payload.nibble[i];
+  }
+  return value;
+}
 
-    return result;
+// count nibbles from at, as lower case hex
+std::string UnitTagsOTA::nibble_hex(const Payload& payload, size_t at, size_t count) {
+  std::string result;
+  result.reserve(count);
+  for (size_t i = at; i < at + count; i++) {
+    result.push_back(HEX_DIGITS[payload.nibble[i]]);
+  }
+  return result;
 }
 
-// Convert hex string to vector of int8_t
-std::vector<uint8_t> UnitTagsOTA::hex_string_to_uint8_vector(const std::string& hex_str) {
-    std::vector<uint8_t> result;
-    result.reserve(hex_str.length() / 2);
-    for (size_t i = 0; i + 1 < hex_str.length(); i += 2) {
-        int hi = (hex_str[i] <= '9') ? hex_str[i] - '0' : (hex_str[i] & 0xF) + 9;
-        int lo = (hex_str[i+1] <= '9') ? hex_str[i+1] - '0' : (hex_str[i+1] & 0xF) + 9;
-        result.push_back(static_cast<uint8_t>((hi << 4) | lo));
-    }
-    return result;
-}
\ No newline at end of file
+std::string UnitTagsOTA::bytes_hex(const uint8_t *bytes, size_t length) {
+  std::string result;
+  result.reserve(length * 2);
+  for (size_t i = 0; i < length; i++) {
+    result.push_back(HEX_DIGITS[bytes[i] >> 4]);
+    result.push_back(HEX_DIGITS[bytes[i] & 0xf]);
+  }
+  return result;
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 // Result structure for OTA alias decode containing radio ID, alias text, and source
@@ -22,24 +23,47 @@ struct OTAAlias {
     : success(true), radio_id(id), alias(text), source(src), wacn(w), sys(s), talkgroup_id(tg) {}
 };
 
+// The fragments of one alias, as they came in on the control channel or a
+// call. Fixed size, so putting one together doesn't allocate.
+struct OTAAliasBlocks {
+  static const size_t MAX_BLOCKS = 10;
+  static const size_t MAX_BLOCK_BYTES = 64;
+
+  std::array<std::array<uint8_t, MAX_BLOCK_BYTES>, MAX_BLOCKS> data;
+  std::array<size_t, MAX_BLOCKS> size;
+
+  OTAAliasBlocks() { size.fill(0); }
+  // false if the hex is malformed or longer than a block
+  bool set_hex(size_t block, const std::string &hex);
+};
+
 class UnitTagsOTA {
 public:
   // Motorola OTA (Over-The-Air) alias decoding
-  static OTAAlias decode_motorola_alias(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages);
-  static OTAAlias decode_motorola_alias_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages);
+  static OTAAlias decode_motorola_alias(const OTAAliasBlocks& alias_buffer, int messages);
+  static OTAAlias decode_motorola_alias_p2(const OTAAliasBlocks& alias_buffer, int messages);
 
   // Harris OTA (Over-The-Air) alias decoding
-  static OTAAlias decode_harris_alias(const std::array<std::vector<uint8_t>, 10>& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id);
-  static OTAAlias decode_harris_alias_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id);
+  static OTAAlias decode_harris_alias(const OTAAliasBlocks& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id);
+  static OTAAlias decode_harris_alias_p2(const OTAAliasBlocks& alias_buffer, long radio_id, long talkgroup_id, const std::string& wacn, const std::string& sys_id);
 
 private:
+  // A Motorola payload is laid out in nibbles, so it is put together a
+  // nibble to an entry: at most a 28 nibble header and 9 blocks of 25
+  struct Payload {
+    std::array<uint8_t, 256> nibble;
+    size_t length;
+  };
+
   // Helper functions for Motorola alias decoding
-  static std::string assemble_payload(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages);
-  static std::string assemble_payload_p2(const std::array<std::vector<uint8_t>, 10>& alias_buffer, int messages);
-  static bool validate_crc(const std::string& payload_hex, const std::string& checksum_hex);
-  static std::string decode_mot_alias(const std::vector<int8_t>& encoded_data);
-  static std::string uint8_vector_to_hex_string(const std::vector<uint8_t>& v);
-  static std::vector<uint8_t> hex_string_to_uint8_vector(const std::string& hex_str);
+  static bool assemble_payload(const OTAAliasBlocks& alias_buffer, int messages, Payload& payload);
+  static bool assemble_payload_p2(const OTAAliasBlocks& alias_buffer, int messages, Payload& payload);
+  static OTAAlias decode_motorola_payload(const Payload& payload, size_t wacn_at, const char *log_prefix, const char *source);
+  static uint16_t crc16_gsm(const uint8_t *bytes, size_t length);
+  static std::string decode_mot_alias(const uint8_t *encoded, size_t length);
+  static unsigned long nibble_value(const Payload& payload, size_t at, size_t count);
+  static std::string nibble_hex(const Payload& payload, size_t at, size_t count);
+  static std::string bytes_hex(const uint8_t *bytes, size_t length);
 };
 
 #endif // UNIT_TAGS_OTA_H
@@ -0,0 +1,215 @@
+#include "upload_engine.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <cstring>
+
+Upload_Engine::Upload_Engine()
+    : multi(NULL),
+      share(NULL),
+      running(false),
+      transfers(0),
+      failures(0),
+      connects(0) {
+  share = curl_share_init();
+  // Through the typedefs, so a callback with the wrong signature doesn't
+  // get past the varargs of curl_share_setopt()
+  curl_lock_function lock = lock_share;
+  curl_unlock_function unlock = unlock_share;
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock);
+  curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+Upload_Engine::~Upload_Engine() {
+  stop();
+  curl_share_cleanup(share);
+}
+
+void Upload_Engine::lock_share(CURL *, curl_lock_data data, curl_lock_access, void *userptr) {
+  ((Upload_Engine *)userptr)->share_mutexes[data].lock();
+}
+
+void Upload_Engine::unlock_share(CURL *, curl_lock_data data, void *userptr) {
+  ((Upload_Engine *)userptr)->share_mutexes[data].unlock();
+}
+
+void Upload_Engine::start(long connections_per_host) {
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  if (running) {
+    return;
+  }
+  multi = curl_multi_init();
+  if (!multi) {
+    BOOST_LOG_TRIVIAL(error) << "Upload Engine: curl_multi_init failed, uploads will each make their own connection";
+    return;
+  }
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, connections_per_host);
+  // Enough idle connections in the cache for a few hosts
+  curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, connections_per_host * 4);
+  running = true;
+  worker = std::thread(&Upload_Engine::run, this);
+  BOOST_LOG_TRIVIAL(info) << "Upload Engine started - Connections per Host: " << connections_per_host;
+}
+
+void Upload_Engine::stop() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!running) {
+      return;
+    }
+    running = false;
+  }
+  curl_multi_wakeup(multi);
+  // The worker finishes the transfers it has before it returns
+  worker.join();
+  curl_multi_cleanup(multi);
+  multi = NULL;
+}
+
+void Upload_Engine::prepare(CURL *easy) {
+  curl_easy_setopt(easy, CURLOPT_SHARE, share);
+  curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+  curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+  // Wait for a connection that can be multiplexed rather than open another
+  curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+}
+
+Upload_Engine::Result Upload_Engine::perform(CURL *easy) {
+  prepare(easy);
+
+  Transfer transfer;
+  transfer.easy = easy;
+  std::future<Result> done = transfer.done.get_future();
+
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  if (!running) {
+    lock.unlock();
+    Result result;
+    result.code = curl_easy_perform(easy);
+    result.response_code = 0;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &result.response_code);
+    return result;
+  }
+  incoming.push_back(&transfer);
+  lock.unlock();
+  curl_multi_wakeup(multi);
+
+  return done.get();
+}
+
+void Upload_Engine::run() {
+  int active = 0;
+
+  while (true) {
+    bool stopping;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      while (!incoming.empty()) {
+        Transfer *transfer = incoming.front();
+        incoming.pop_front();
+        curl_easy_setopt(transfer->easy, CURLOPT_PRIVATE, transfer);
+        if (curl_multi_add_handle(multi, transfer->easy) != CURLM_OK) {
+          Result result;
+          result.code = CURLE_FAILED_INIT;
+          result.response_code = 0;
+          transfer->done.set_value(result);
+          continue;
+        }
+        active++;
+      }
+      stopping = !running;
+    }
+    if (stopping && (active == 0)) {
+      return;
+    }
+
+    int still_running = 0;
+    curl_multi_perform(multi, &still_running);
+
+    CURLMsg *msg;
+    int msgs_left = 0;
+    while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      CURL *easy = msg->easy_handle;
+      Transfer *transfer = NULL;
+      curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&transfer);
+
+      Result result;
+      result.code = msg->data.result;
+      result.response_code = 0;
+      curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &result.response_code);
+      long num_connects = 0;
+      curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &num_connects);
+
+      transfers++;
+      connects += num_connects;
+      if (result.code != CURLE_OK) {
+        failures++;
+      }
+
+      curl_multi_remove_handle(multi, easy);
+      active--;
+      // The plugin's thread carries on from here, it owns the easy handle again
+      transfer->done.set_value(result);
+    }
+
+    curl_multi_poll(multi, NULL, 0, 1000, NULL);
+  }
+}
+
+size_t Upload_Engine::read_audio(char *buffer, size_t size, size_t nitems, void *arg) {
+  Audio_Reader *reader = (Audio_Reader *)arg;
+  size_t count = std::min(size * nitems, reader->audio->size() - reader->offset);
+  memcpy(buffer, reader->audio->data() + reader->offset, count);
+  reader->offset += count;
+  return count;
+}
+
+// For a retry after a redirect or a connection that was closed under it
+int Upload_Engine::seek_audio(void *arg, curl_off_t offset, int origin) {
+  Audio_Reader *reader = (Audio_Reader *)arg;
+  curl_off_t base = (origin == SEEK_CUR) ? (curl_off_t)reader->offset : ((origin == SEEK_END) ? (curl_off_t)reader->audio->size() : 0);
+  if ((base + offset < 0) || (base + offset > (curl_off_t)reader->audio->size())) {
+    return CURL_SEEKFUNC_FAIL;
+  }
+  reader->offset = base + offset;
+  return CURL_SEEKFUNC_OK;
+}
+
+void Upload_Engine::free_audio(void *arg) {
+  delete (Audio_Reader *)arg;
+}
+
+void Upload_Engine::set_upload_audio(CURL *easy, Audio_Reader *reader) {
+  reader->offset = 0;
+  curl_easy_setopt(easy, CURLOPT_READFUNCTION, read_audio);
+  curl_easy_setopt(easy, CURLOPT_READDATA, reader);
+  curl_easy_setopt(easy, CURLOPT_SEEKFUNCTION, seek_audio);
+  curl_easy_setopt(easy, CURLOPT_SEEKDATA, reader);
+  curl_easy_setopt(easy, CURLOPT_INFILESIZE_LARGE, (curl_off_t)reader->audio->size());
+}
+
+// The part keeps the audio until the mime is freed
+void Upload_Engine::set_mime_audio(curl_mimepart *part, std::shared_ptr<const std::string> audio) {
+  Audio_Reader *reader = new Audio_Reader();
+  reader->audio = audio;
+  reader->offset = 0;
+  curl_mime_data_cb(part, (curl_off_t)audio->size(), read_audio, seek_audio, free_audio, reader);
+}
+
+void Upload_Engine::print_stats() {
+  long total = transfers.load();
+  if (total == 0) {
+    return;
+  }
+  long opened = connects.load();
+  BOOST_LOG_TRIVIAL(info) << "Upload Engine - Uploads: " << total << " Failed: " << failures.load() << " Connections Opened: " << opened << " Reused: " << ((total > opened) ? total - opened : 0);
+}
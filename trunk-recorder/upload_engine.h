@@ -0,0 +1,92 @@
+#ifndef UPLOAD_ENGINE_H
+#define UPLOAD_ENGINE_H
+
+#include <atomic>
+#include <curl/curl.h>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Upload_Engine
+ *   Runs the uploads of all the uploader plugins on one curl multi handle,
+ *   on a thread of its own, so they share its connections instead of each
+ *   upload opening and closing one.
+ *
+ * A plugin sets up an easy handle the way it would for curl_easy_perform()
+ * and hands it to perform(), which returns when the transfer is done. The
+ * connections to each host are kept open between uploads, up to
+ * connections_per_host of them, and HTTP/2 servers get all the uploads
+ * multiplexed on one. DNS answers and TLS sessions are shared too, so a
+ * connection that does have to be opened again skips most of the handshake.
+ *
+ * It isn't a static class like the other workers: trunk_recorder_library is
+ * linked into every plugin, and each would have its own statics. The one
+ * instance belongs to main() and the plugins get it from the Config.
+ *
+ * The audio of a call can be sent from the Call_Data_t's converted_audio,
+ * which the Call_Concluder reads once, instead of each uploader reading the
+ * file through curl again. set_upload_audio() is for a PUT and
+ * set_mime_audio() for a multipart part.
+ *
+ * Before start() or after stop() perform() runs the transfer itself.
+ */
+class Upload_Engine {
+public:
+  struct Result {
+    CURLcode code;
+    long response_code;
+  };
+
+  Upload_Engine();
+  ~Upload_Engine();
+
+  void start(long connections_per_host);
+  void stop();
+
+  // Where a transfer is in the audio, it has to last until the transfer is done
+  struct Audio_Reader {
+    std::shared_ptr<const std::string> audio;
+    size_t offset;
+  };
+
+  Result perform(CURL *easy);
+  void print_stats();
+
+  static void set_upload_audio(CURL *easy, Audio_Reader *reader);
+  static void set_mime_audio(curl_mimepart *part, std::shared_ptr<const std::string> audio);
+
+private:
+  struct Transfer {
+    CURL *easy;
+    std::promise<Result> done;
+  };
+
+  static void lock_share(CURL *, curl_lock_data data, curl_lock_access, void *userptr);
+  static void unlock_share(CURL *, curl_lock_data data, void *userptr);
+
+  static size_t read_audio(char *buffer, size_t size, size_t nitems, void *arg);
+  static int seek_audio(void *arg, curl_off_t offset, int origin);
+  static void free_audio(void *arg);
+
+  void prepare(CURL *easy);
+  void run();
+
+  CURLM *multi;
+  CURLSH *share;
+  std::mutex share_mutexes[CURL_LOCK_DATA_LAST];
+
+  std::mutex queue_mutex;
+  std::deque<Transfer *> incoming;
+  bool running;
+  std::thread worker;
+
+  std::atomic<long> transfers;
+  std::atomic<long> failures;
+  std::atomic<long> connects; // connections opened, the rest of the transfers reused one
+};
+
+#endif // UPLOAD_ENGINE_H
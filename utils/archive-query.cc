@@ -0,0 +1,169 @@
+// archive-query - list and extract calls archived with archiveSegments
+//
+// Looks through every HH.idx under a directory, usually the captureDir or
+// one system's part of it, and lists the calls that match, oldest first:
+//
+//   start time, talkgroup, call number, freq, length, audio format and size
+//
+// With -x, each matching call's audio and JSON are also copied out of its
+// HH.seg into the output directory, named like the files Trunk Recorder
+// makes for a call: TG-START_FREQ-call_NUM.m4a and .json. Index lines that
+// are cut short or point past the end of their segment, which a crash can
+// leave, are skipped.
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 utils/archive-query.cc -o archive-query
+//
+// usage:
+//   archive-query dir [-t talkgroup] [-s start] [-e end] [-x outdir]
+//
+//   start and end are unix times in seconds; a call matches if it started
+//   in [start, end)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Entry {
+  long long start_ms;
+  long long stop_ms;
+  long talkgroup;
+  long call_num;
+  double freq;
+  long long audio_offset;
+  long long audio_length;
+  std::string audio_format;
+  long long json_offset;
+  long long json_length;
+  std::string segment;
+};
+
+static bool parse_entry(const std::string &line, Entry &entry) {
+  std::istringstream in(line);
+  if (!(in >> entry.start_ms >> entry.stop_ms >> entry.talkgroup >> entry.call_num >> entry.freq >> entry.audio_offset >> entry.audio_length >> entry.audio_format >> entry.json_offset >> entry.json_length)) {
+    return false;
+  }
+  return (entry.audio_offset >= 0) && (entry.audio_length >= 0) && (entry.json_offset >= 0) && (entry.json_length >= 0);
+}
+
+static bool copy_out(std::ifstream &segment, long long offset, long long length, const std::string &filename) {
+  std::vector<char> data(length);
+  segment.clear();
+  segment.seekg(offset);
+  if (!segment.read(data.data(), length)) {
+    return false;
+  }
+  std::ofstream out(filename, std::ios::binary);
+  return out.write(data.data(), length) && out.flush();
+}
+
+static void usage() {
+  fprintf(stderr, "usage: archive-query dir [-t talkgroup] [-s start] [-e end] [-x outdir]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+  }
+  std::string dir = argv[1];
+  bool by_talkgroup = false;
+  long talkgroup = 0;
+  long long start_ms = 0;
+  long long end_ms = 0;
+  std::string outdir;
+
+  for (int i = 2; i < argc; i++) {
+    if (i + 1 >= argc) {
+      usage();
+    }
+    if (!strcmp(argv[i], "-t")) {
+      by_talkgroup = true;
+      talkgroup = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "-s")) {
+      start_ms = atoll(argv[++i]) * 1000;
+    } else if (!strcmp(argv[i], "-e")) {
+      end_ms = atoll(argv[++i]) * 1000;
+    } else if (!strcmp(argv[i], "-x")) {
+      outdir = argv[++i];
+    } else {
+      usage();
+    }
+  }
+
+  std::vector<Entry> entries;
+  long skipped = 0;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(dir, ec), end; !ec && (it != end); it.increment(ec)) {
+    if (!it->is_regular_file() || (it->path().extension() != ".idx")) {
+      continue;
+    }
+    std::string segment = fs::path(it->path()).replace_extension(".seg").string();
+    std::uintmax_t segment_size = fs::file_size(segment, ec);
+    if (ec) {
+      ec.clear();
+      continue;
+    }
+
+    std::ifstream index(it->path());
+    std::string line;
+    while (std::getline(index, line)) {
+      Entry entry;
+      if (!parse_entry(line, entry) || ((std::uintmax_t)(entry.json_offset + entry.json_length) > segment_size) || ((std::uintmax_t)(entry.audio_offset + entry.audio_length) > segment_size)) {
+        skipped++;
+        continue;
+      }
+      if ((by_talkgroup && (entry.talkgroup != talkgroup)) || (start_ms && (entry.start_ms < start_ms)) || (end_ms && (entry.start_ms >= end_ms))) {
+        continue;
+      }
+      entry.segment = segment;
+      entries.push_back(entry);
+    }
+  }
+  if (ec) {
+    fprintf(stderr, "%s: %s\n", dir.c_str(), ec.message().c_str());
+    return 1;
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.start_ms < b.start_ms; });
+
+  long extracted = 0;
+  for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+    time_t start = it->start_ms / 1000;
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    printf("%s.%03lld\tTG: %ld\tCall: %ld\tFreq: %.0f\tLength: %.1f s\t%s %lld bytes\n", when, it->start_ms % 1000, it->talkgroup, it->call_num, it->freq,
+           (it->stop_ms - it->start_ms) / 1000.0, it->audio_format.c_str(), it->audio_length);
+
+    if (!outdir.empty()) {
+      char name[128];
+      snprintf(name, sizeof(name), "%ld-%lld.%03lld_%.0f-call_%ld", it->talkgroup, it->start_ms / 1000, it->start_ms % 1000, it->freq, it->call_num);
+      std::string base = (fs::path(outdir) / name).string();
+      std::ifstream segment(it->segment, std::ios::binary);
+      if (copy_out(segment, it->audio_offset, it->audio_length, base + "." + it->audio_format) && copy_out(segment, it->json_offset, it->json_length, base + ".json")) {
+        extracted++;
+      } else {
+        fprintf(stderr, "unable to extract %s from %s\n", name, it->segment.c_str());
+      }
+    }
+  }
+
+  fprintf(stderr, "%zu calls", entries.size());
+  if (!outdir.empty()) {
+    fprintf(stderr, ", %ld extracted to %s", extracted, outdir.c_str());
+  }
+  if (skipped) {
+    fprintf(stderr, ", %ld unreadable index lines skipped", skipped);
+  }
+  fprintf(stderr, "\n");
+  return 0;
+}
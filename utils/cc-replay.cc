@@ -0,0 +1,362 @@
+// cc-replay - plays a control channel capture back through the parsers
+// and the call handling
+//
+// Reads a file written with the controlChannelCapture option, makes a
+// System for each one in it and runs every message through the System's
+// parser and handle_message(), the same as monitor_messages() does, but
+// with no radio and no DSP. Grants are handed recorders that don't record
+// anything from one Source that covers every frequency, so the calls go
+// through start_recorder() and come out the other end. Calls end on the
+// capture's clock, once their talkgroup hasn't been granted or updated on
+// their channel for callTimeout seconds. Reports:
+//
+//   - messages and grants per second
+//   - p50/p90/p99/max for parsing a message and for handling what it
+//     decoded to
+//   - grant to recorder start and recorder start to retune for the calls
+//     that were recorded, from Call_Latency
+//   - how many calls were recorded and why the rest weren't
+//
+// Changes to the parsers or the call handling should not make these
+// numbers worse for the same capture.
+//
+// A control channel saved with controlIqRingSeconds comes with a
+// .replay.json that turns its IQ into a capture for this:
+//   trunk-recorder --config=<base>.replay.json && cc-replay <base>.capture
+//
+// build from a configured build directory with:
+//   make cc-replay
+//
+// usage:
+//   cc-replay [-s speed] [-r recorders] [-t talkgroups.csv] [-u] [-v] capture
+//
+//   -s  how fast to play it, 1 for as fast as it was captured, 0 for as
+//       fast as it will go (0)
+//   -r  digital and analog recorders on the Source, each (8)
+//   -t  a talkgroups file for every system, otherwise unknown talkgroups
+//       are recorded
+//   -u  treat UPDATEs as GRANTs, like newCallFromUpdate
+//   -v  log everything at info and above instead of only the report
+
+#include "../trunk-recorder/call_latency.h"
+#include "../trunk-recorder/message_capture.h"
+#include "../trunk-recorder/monitor_systems.h"
+#include "../trunk-recorder/latency_histogram.h"
+#include "../trunk-recorder/recorders/recorder.h"
+#include "../trunk-recorder/source.h"
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// A trunking recorder that takes a call and does nothing with it
+class Replay_Recorder : public Recorder {
+public:
+  Replay_Recorder(Source *source, Recorder_Type type) : Recorder(type), source(source), state(INACTIVE), freq(0), talkgroup(0) {
+    rec_num = rec_counter++;
+    conventional = false;
+    recording_count = 0;
+    recording_duration = 0;
+    d_enable_audio_streaming = false;
+  }
+
+  bool start(Call *call) {
+    source->take_recorder(this);
+    freq = call->get_freq();
+    talkgroup = call->get_talkgroup();
+    started = std::chrono::steady_clock::now();
+    call->mark_latency(LATENCY_RETUNE);
+    state = ACTIVE;
+    recording_count++;
+    return true;
+  }
+
+  void stop() {
+    if (state == INACTIVE) {
+      return;
+    }
+    state = INACTIVE;
+    source->release_recorder(this);
+  }
+
+  Source *get_source() { return source; }
+  double get_freq() { return freq; }
+  long get_talkgroup() { return talkgroup; }
+  State get_state() { return state; }
+  bool is_enabled() { return true; }
+  bool is_active() { return state == ACTIVE; }
+  bool is_analog() { return get_type() == ANALOG; }
+  bool is_idle() { return state != ACTIVE; }
+  bool is_squelched() { return false; }
+  double since_last_write() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(); }
+
+private:
+  Source *source;
+  State state;
+  double freq;
+  long talkgroup;
+  std::chrono::steady_clock::time_point started;
+};
+
+static void usage() {
+  fprintf(stderr, "usage: cc-replay [-s speed] [-r recorders] [-t talkgroups.csv] [-u] [-v] capture\n");
+  exit(1);
+}
+
+static void print_summary(const char *name, const Latency_Summary &summary) {
+  printf("%-18s %8ld %10.3f %10.3f %10.3f %10.3f\n", name, summary.count, summary.p50_ms, summary.p90_ms, summary.p99_ms, summary.max_ms);
+}
+
+static const char *monitoring_state_name(MonitoringState state) {
+  switch (state) {
+  case UNKNOWN_TG:
+    return "unknown talkgroup";
+  case IGNORED_TG:
+    return "ignored talkgroup";
+  case NO_SOURCE:
+    return "no source";
+  case NO_RECORDER:
+    return "no recorder";
+  case ENCRYPTED:
+    return "encrypted";
+  case DUPLICATE:
+    return "duplicate";
+  case SUPERSEDED:
+    return "superseded";
+  case BACKLOG:
+    return "backlog";
+  case REMOTE:
+    return "voice node";
+  case PREEMPTED:
+    return "preempted";
+  case ADMISSION:
+    return "over cpu budget";
+  default:
+    return "monitored";
+  }
+}
+
+int main(int argc, char **argv) {
+  double speed = 0;
+  int recorders = 8;
+  std::string talkgroups_file;
+  bool new_call_from_update = false;
+  bool verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:t:uv")) != -1) {
+    switch (opt) {
+    case 's':
+      speed = atof(optarg);
+      break;
+    case 'r':
+      recorders = atoi(optarg);
+      break;
+    case 't':
+      talkgroups_file = optarg;
+      break;
+    case 'u':
+      new_call_from_update = true;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+  }
+
+  // Calls that weren't recorded log at error when they are concluded
+  boost::log::core::get()->set_filter(boost::log::trivial::severity >= (verbose ? boost::log::trivial::info : boost::log::trivial::fatal));
+
+  FILE *fp = fopen(argv[optind], "rb");
+  std::vector<Message_Capture::System_Info> infos;
+  if (!fp || !Message_Capture::read_header(fp, infos)) {
+    fprintf(stderr, "%s is not a control channel capture\n", argv[optind]);
+    return 1;
+  }
+
+  std::string scratch = "/tmp/cc-replay-" + std::to_string(getpid());
+  std::string iq_file = scratch + ".iq";
+  {
+    // The Source's file source is never run, it only has to open
+    FILE *iq = fopen(iq_file.c_str(), "wb");
+    std::vector<char> zeros(4096, 0);
+    fwrite(zeros.data(), 1, zeros.size(), iq);
+    fclose(iq);
+  }
+
+  Config config = Config();
+  config.capture_dir = scratch;
+  config.temp_dir = scratch;
+  config.default_mode = "digital";
+  config.call_timeout = 3.0;
+  config.new_call_from_update = new_call_from_update;
+  config.record_uu_v_calls = true;
+
+  // 0 - 6 GHz, so every grant has a Source
+  std::vector<Source *> sources;
+  Source *source = new Source(iq_file, false, 3e9, 6e9, 1.0, Replay_Lockstep::sptr(), &config);
+  for (int i = 0; i < recorders; i++) {
+    source->add_external_recorder(new Replay_Recorder(source, P25));
+    source->add_external_recorder(new Replay_Recorder(source, ANALOG));
+  }
+  sources.push_back(source);
+
+  std::map<int, System *> systems;
+  for (std::vector<Message_Capture::System_Info>::iterator it = infos.begin(); it != infos.end(); ++it) {
+    System *system = System::make(it->sys_num);
+    system->set_short_name(it->short_name);
+    system->set_system_type(it->type);
+    system->set_record_unknown(talkgroups_file == "");
+    if (talkgroups_file != "") {
+      system->set_talkgroups_file(talkgroups_file);
+    }
+    if (it->custom_freq_table_file != "") {
+      system->set_custom_freq_table_file(it->custom_freq_table_file);
+    }
+    system->set_bandplan(it->bandplan);
+    system->set_bandplan_base(it->bandplan_base);
+    system->set_bandplan_high(it->bandplan_high);
+    system->set_bandplan_spacing(it->bandplan_spacing);
+    system->set_bandplan_offset(it->bandplan_offset);
+    systems[it->sys_num] = system;
+  }
+
+  gr::top_block_sptr tb;
+  std::vector<Call *> calls;
+  std::map<Call *, std::int64_t> last_seen; // capture time a call's talkgroup was last on its channel
+  std::vector<TrunkMessage> handled;
+  Latency_Histogram parse_times;
+  Latency_Histogram handle_times;
+  std::map<std::string, long> outcomes;
+  long messages = 0;
+  long grants = 0;
+  long skipped = 0;
+  std::int64_t first_us = -1;
+  std::int64_t now_us = 0;
+  std::int64_t next_expiry_us = 0;
+
+  Message_Capture::Record record;
+  auto started = std::chrono::steady_clock::now();
+
+  // Out here so the calls still going at the end can be ended the same way
+  auto end_calls = [&](std::int64_t older_than_us) {
+    for (size_t i = 0; i < calls.size();) {
+      Call *call = calls[i];
+      std::map<Call *, std::int64_t>::iterator seen = last_seen.find(call);
+      if ((seen != last_seen.end()) && (seen->second > older_than_us)) {
+        i++;
+        continue;
+      }
+      outcomes[(call->get_state() == RECORDING) ? "recorded" : monitoring_state_name(call->get_monitoring_state())]++;
+      if (seen != last_seen.end()) {
+        last_seen.erase(seen);
+      }
+      end_call(call, calls);
+    }
+  };
+
+  while (Message_Capture::read_record(fp, record)) {
+    std::map<int, System *>::iterator sys_it = systems.find(record.sys_num);
+    if (sys_it == systems.end() || !sys_it->second->get_parser()) {
+      skipped++;
+      continue;
+    }
+    System *system = sys_it->second;
+
+    if (first_us < 0) {
+      first_us = record.time_us;
+    }
+    now_us = record.time_us;
+    if (speed > 0) {
+      std::this_thread::sleep_until(started + std::chrono::microseconds((std::int64_t)((now_us - first_us) / speed)));
+    }
+
+    gr::message::sptr msg = gr::message::make_from_string(record.payload, record.type, record.arg1, record.arg2);
+
+    auto parse_start = std::chrono::steady_clock::now();
+    const std::vector<TrunkMessage> &trunk_messages = system->get_parser()->parse_message(msg, system);
+    auto parse_end = std::chrono::steady_clock::now();
+
+    // Retuning needs a running flowgraph
+    handled.clear();
+    for (std::vector<TrunkMessage>::const_iterator it = trunk_messages.begin(); it != trunk_messages.end(); ++it) {
+      if ((it->message_type != TDULC) && (it->message_type != INVALID_CC_MESSAGE)) {
+        handled.push_back(*it);
+      }
+      grants += (it->message_type == GRANT);
+    }
+
+    size_t calls_before = calls.size();
+    auto handle_start = std::chrono::steady_clock::now();
+    system->set_message_count(system->get_message_count() + 1);
+    handle_message(handled, system, config, sources, calls, tb);
+    auto handle_end = std::chrono::steady_clock::now();
+
+    parse_times.record(std::chrono::duration_cast<std::chrono::microseconds>(parse_end - parse_start).count());
+    handle_times.record(std::chrono::duration_cast<std::chrono::microseconds>(handle_end - handle_start).count());
+    messages++;
+
+    for (size_t i = calls_before; i < calls.size(); i++) {
+      last_seen[calls[i]] = now_us;
+    }
+    for (std::vector<TrunkMessage>::const_iterator it = handled.begin(); it != handled.end(); ++it) {
+      if ((it->message_type != GRANT) && (it->message_type != UPDATE)) {
+        continue;
+      }
+      for (std::vector<Call *>::iterator call_it = calls.begin(); call_it != calls.end(); ++call_it) {
+        Call *call = *call_it;
+        if ((call->get_sys_num() == it->sys_num) && (call->get_talkgroup() == it->talkgroup) && (call->get_freq() == it->freq)) {
+          last_seen[call] = now_us;
+        }
+      }
+    }
+
+    if (now_us >= next_expiry_us) {
+      end_calls(now_us - (std::int64_t)(config.call_timeout * 1e6));
+      next_expiry_us = now_us + 1000000;
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  end_calls(now_us + 1);
+  fclose(fp);
+  remove(iq_file.c_str());
+
+  double captured = (first_us < 0) ? 0 : (now_us - first_us) / 1e6;
+  printf("%ld messages, %ld grants over %.0f s of capture in %.3f s", messages, grants, captured, elapsed);
+  if (skipped) {
+    printf(", %ld skipped", skipped);
+  }
+  printf("\n\n%14s %14s\n", "messages/sec", "grants/sec");
+  printf("%14.0f %14.0f\n", messages / elapsed, grants / elapsed);
+
+  printf("\n%-18s %8s %10s %10s %10s %10s\n", "ms", "count", "p50", "p90", "p99", "max");
+  print_summary("parse", Call_Latency::summarize(parse_times));
+  print_summary("handle", Call_Latency::summarize(handle_times));
+  std::vector<Call_Latency_Stats> stats = Call_Latency::get_stats();
+  for (std::vector<Call_Latency_Stats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+    if (it->type != "system") {
+      continue;
+    }
+    print_summary(("[" + it->name + "] start").c_str(), it->grant_to_start);
+    print_summary(("[" + it->name + "] retune").c_str(), it->start_to_retune);
+  }
+
+  printf("\n%-18s %8s\n", "calls", "count");
+  for (std::map<std::string, long>::iterator it = outcomes.begin(); it != outcomes.end(); ++it) {
+    printf("%-18s %8ld\n", it->first.c_str(), it->second);
+  }
+  return 0;
+}
@@ -0,0 +1,316 @@
+// channelizer-bench - times a Source's channelizers for its P25 recorders
+//
+// Runs the same wideband signal through each of the channelizers a Source
+// can have, "xlat", "pfb", "fft" and "tile", into as many P25 recorder front ends
+// (the xlat_channelizer, with its squelch, AGC and FLL) as you ask for,
+// all of them tuned to a call, and reports for each:
+//
+//   - how long it took, and how many times faster than real time that is
+//   - Msamples/sec of the wideband input
+//   - the samples each recorder put out, which should be the same for all
+//     of them at 24 kHz, less the filters' start up
+//
+// This is the recorders' side of a Source with all of them busy, the worst
+// case. With "fft" the channel of a parked recorder isn't worked out at
+// all, and with no calls the FFT isn't either; with "tile" the same goes
+// for a sub-band with no recorder on it.
+//
+// The signal is noise with a carrier on each recorder's channel, 3 kHz off
+// the channel raster so the recorders have some tuning to do. The calls
+// are spread over 80% of the Source, or with -b packed into a band that
+// wide around its center, the way a site's voice channels often are,
+// which is where "tile" has recorders sharing its sub-bands.
+//
+// "legacy" is the older channelizer block, the two-stage decimator, with
+// the same front ends tuned straight off the Source the way "xlat" is.
+// When both of them are run the one that took less time is picked for
+// the rate and the type of recorder given with -m.
+//
+// build from a configured build directory with:
+//   make channelizer-bench
+//
+// usage:
+//   channelizer-bench [-r rate] [-n recorders] [-s seconds] [-c spacing] [-t threads] [-w width] [-b band] [-m type] [channelizer ...]
+//
+//   -r  the Source's sample rate (20000000)
+//   -n  P25 recorders, each on a call (16)
+//   -s  seconds of signal (5)
+//   -c  pfbChannelSpacing (12500)
+//   -t  FFT threads for the "fft" and "tile" channelizers (1)
+//   -w  tileWidth (1000000)
+//   -b  how wide a band the calls are in (80% of the rate)
+//   -m  the recorders' symbols, phase1, phase2 or smartnet (phase1)
+
+#include "../trunk-recorder/gr_blocks/channelizer.h"
+#include "../trunk-recorder/gr_blocks/fft_channelizer.h"
+#include "../trunk-recorder/gr_blocks/filter_taps.h"
+#include "../trunk-recorder/gr_blocks/subband_tiler.h"
+#include "../trunk-recorder/gr_blocks/xlat_channelizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <gnuradio/blocks/head.h>
+#include <gnuradio/blocks/vector_sink.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/filter/pfb_channelizer_ccf.h>
+#include <gnuradio/top_block.h>
+
+#if GNURADIO_VERSION < 0x030800
+#include <gnuradio/blocks/vector_sink_c.h>
+#include <gnuradio/blocks/vector_source_c.h>
+#endif
+
+// The vector source repeats this much signal
+static const size_t SIGNAL_SAMPLES = 1 << 20;
+
+struct Bench {
+  double rate;
+  int recorders;
+  double seconds;
+  double spacing;
+  int threads;
+  double tile_width;
+  double band;
+  std::string type;
+  int samples_per_symbol;
+  double symbol_rate;
+  std::vector<double> offsets; // where each recorder's call is, from the center
+};
+
+static std::vector<gr_complex> make_signal(const Bench &bench) {
+  std::mt19937 rng(131);
+  std::normal_distribution<float> noise(0, 0.05);
+  std::vector<gr_complex> signal(SIGNAL_SAMPLES);
+  for (size_t i = 0; i < signal.size(); i++) {
+    signal[i] = gr_complex(noise(rng), noise(rng));
+  }
+  for (size_t r = 0; r < bench.offsets.size(); r++) {
+    gr_complex phase(1, 0);
+    gr_complex step = std::polar(1.0f, (float)(2 * M_PI * bench.offsets[r] / bench.rate));
+    for (size_t i = 0; i < signal.size(); i++) {
+      signal[i] += phase * 0.1f;
+      phase *= step;
+      if ((i & 1023) == 0) {
+        phase /= std::abs(phase);
+      }
+    }
+  }
+  return signal;
+}
+
+// Spread over a band around the center of the Source, on the raster but
+// 3 kHz off it
+static std::vector<double> make_offsets(double band, int recorders, double spacing) {
+  std::vector<double> offsets;
+  for (int r = 0; r < recorders; r++) {
+    double spread = (recorders > 1) ? (band * r / (recorders - 1) - 0.5 * band) : 0;
+    offsets.push_back(round(spread / spacing) * spacing + 3000);
+  }
+  return offsets;
+}
+
+// Returns how long it took
+static double run(const Bench &bench, const std::string &channelizer, const std::vector<gr_complex> &signal) {
+  gr::top_block_sptr tb = gr::make_top_block(channelizer);
+  gr::blocks::vector_source_c::sptr source = gr::blocks::vector_source_c::make(signal, true);
+  gr::blocks::head::sptr head = gr::blocks::head::make(sizeof(gr_complex), (uint64_t)(bench.seconds * bench.rate));
+  tb->connect(source, 0, head, 0);
+
+  double recorder_rate = ((channelizer == "xlat") || (channelizer == "legacy")) ? bench.rate : 2 * bench.spacing;
+  gr::filter::pfb_channelizer_ccf::sptr pfb;
+  fft_channelizer_ccc_sptr fft;
+  subband_tiler_ccc_sptr tiler;
+  std::vector<int> channel_map;
+  if (channelizer == "pfb") {
+    int channels = round(bench.rate / bench.spacing);
+    Filter_Taps::Real taps = Filter_Taps::low_pass_2(1.0, bench.rate, bench.spacing, bench.spacing / 5, 60, Filter_Taps::BLACKMAN_HARRIS);
+    pfb = gr::filter::pfb_channelizer_ccf::make(channels, *taps, 2.0);
+    tb->connect(head, 0, pfb, 0);
+  } else if (channelizer == "fft") {
+    fft = make_fft_channelizer_ccc(bench.rate, 2 * bench.spacing, bench.threads);
+    tb->connect(head, 0, fft, 0);
+  } else if (channelizer == "tile") {
+    // As Source::attach_subband_tiler() makes it
+    tiler = make_subband_tiler_ccc(bench.rate, std::max(2, (int)floor(bench.rate / bench.tile_width)), 40000, bench.threads);
+    recorder_rate = tiler->get_tile_rate();
+    tb->connect(head, 0, tiler, 0);
+  }
+
+  std::vector<gr::blocks::vector_sink_c::sptr> sinks;
+  for (int r = 0; r < bench.recorders; r++) {
+    xlat_channelizer::sptr prefilter;
+    ::channelizer::sptr legacy;
+    gr::basic_block_sptr front_end;
+    if (channelizer == "legacy") {
+      legacy = ::channelizer::make(recorder_rate, bench.samples_per_symbol, bench.symbol_rate, 0, false);
+      front_end = legacy;
+    } else {
+      prefilter = xlat_channelizer::make(recorder_rate, bench.samples_per_symbol, bench.symbol_rate, xlat_channelizer::channel_bandwidth, 0, false);
+      front_end = prefilter;
+    }
+    // Source::tune_channel() for each of them
+    double offset_amount = -bench.offsets[r];
+    if (pfb) {
+      long channels = round(bench.rate / bench.spacing);
+      long nearest = lround(bench.offsets[r] / bench.spacing);
+      channel_map.push_back(((nearest % channels) + channels) % channels);
+      pfb->set_channel_map(channel_map);
+      tb->connect(pfb, r, front_end, 0);
+      offset_amount += nearest * bench.spacing;
+    } else if (fft) {
+      int channel = fft->add_channel();
+      offset_amount = -fft->set_channel(channel, bench.offsets[r]);
+      fft->set_channel_enabled(channel, true);
+      tb->connect(fft, channel, front_end, 0);
+    } else if (tiler) {
+      int output = tiler->add_output();
+      offset_amount = -tiler->set_output(output, bench.offsets[r]);
+      tiler->set_output_enabled(output, true);
+      tb->connect(tiler, output, front_end, 0);
+    } else {
+      tb->connect(head, 0, front_end, 0);
+    }
+    if (legacy) {
+      legacy->tune_offset(offset_amount);
+    } else {
+      prefilter->tune_offset(offset_amount);
+      prefilter->set_enabled(true);
+    }
+    gr::blocks::vector_sink_c::sptr sink = gr::blocks::vector_sink_c::make();
+    tb->connect(front_end, 0, sink, 0);
+    sinks.push_back(sink);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  tb->run();
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  size_t least = sinks.empty() ? 0 : sinks[0]->data().size();
+  size_t most = least;
+  for (size_t r = 0; r < sinks.size(); r++) {
+    least = std::min(least, sinks[r]->data().size());
+    most = std::max(most, sinks[r]->data().size());
+  }
+  printf("%-6s %8.3f s %7.2fx real time %8.2f Msamples/sec   out per recorder %zu - %zu\n",
+         channelizer.c_str(), secs, bench.seconds / secs, bench.seconds * bench.rate / secs / 1e6, least, most);
+  if (fft) {
+    printf("       FFT %d, bins %.1f Hz apart, %zu taps\n", fft->get_fft_size(), fft->get_bin_spacing(), fft->get_taps());
+  }
+  if (tiler) {
+    std::vector<double> centers;
+    for (size_t r = 0; r < bench.offsets.size(); r++) {
+      double center = bench.offsets[r] - tiler->set_output(r, bench.offsets[r]);
+      if (std::find(centers.begin(), centers.end(), center) == centers.end()) {
+        centers.push_back(center);
+      }
+    }
+    printf("       %zu tiles in use at %.3f Msps, %zu taps\n", centers.size(), tiler->get_tile_rate() / 1e6, tiler->get_taps());
+  }
+  return secs;
+}
+
+int main(int argc, char **argv) {
+  Bench bench;
+  bench.rate = 20000000;
+  bench.recorders = 16;
+  bench.seconds = 5;
+  bench.spacing = 12500;
+  bench.threads = 1;
+  bench.tile_width = 1000000;
+  bench.band = 0;
+  bench.type = "phase1";
+  int opt;
+  while ((opt = getopt(argc, argv, "r:n:s:c:t:w:b:m:")) != -1) {
+    switch (opt) {
+    case 'r':
+      bench.rate = atof(optarg);
+      break;
+    case 'n':
+      bench.recorders = atoi(optarg);
+      break;
+    case 's':
+      bench.seconds = atof(optarg);
+      break;
+    case 'c':
+      bench.spacing = atof(optarg);
+      break;
+    case 't':
+      bench.threads = atoi(optarg);
+      break;
+    case 'w':
+      bench.tile_width = atof(optarg);
+      break;
+    case 'b':
+      bench.band = atof(optarg);
+      break;
+    case 'm':
+      bench.type = optarg;
+      break;
+    default:
+      bench.seconds = 0;
+    }
+  }
+  if (bench.type == "phase1") {
+    bench.samples_per_symbol = xlat_channelizer::phase1_samples_per_symbol;
+    bench.symbol_rate = xlat_channelizer::phase1_symbol_rate;
+  } else if (bench.type == "phase2") {
+    bench.samples_per_symbol = xlat_channelizer::phase2_samples_per_symbol;
+    bench.symbol_rate = xlat_channelizer::phase2_symbol_rate;
+  } else if (bench.type == "smartnet") {
+    bench.samples_per_symbol = xlat_channelizer::smartnet_samples_per_symbol;
+    bench.symbol_rate = xlat_channelizer::smartnet_symbol_rate;
+  } else {
+    bench.seconds = 0;
+  }
+  long channels = lround(bench.rate / bench.spacing);
+  if ((bench.seconds <= 0) || (bench.recorders < 1) || (bench.threads < 1) || (fabs(channels * bench.spacing - bench.rate) > 1) || (channels & 1)) {
+    fprintf(stderr, "usage: %s [-r rate] [-n recorders] [-s seconds] [-c spacing] [-t threads] [-w width] [-b band] [-m type] [channelizer ...]\n", argv[0]);
+    fprintf(stderr, "the rate has to be an even multiple of the spacing\n");
+    return 1;
+  }
+
+  std::vector<std::string> channelizers;
+  for (int i = optind; i < argc; i++) {
+    channelizers.push_back(argv[i]);
+  }
+  if (channelizers.empty()) {
+    channelizers = {"xlat", "pfb", "fft", "tile"};
+  }
+  if ((bench.band <= 0) || (bench.band > bench.rate)) {
+    bench.band = 0.8 * bench.rate;
+  }
+
+  bench.offsets = make_offsets(bench.band, bench.recorders, bench.spacing);
+  std::vector<gr_complex> signal = make_signal(bench);
+  printf("%.3f Msps, %d %s recorders, %.1f seconds\n", bench.rate / 1e6, bench.recorders, bench.type.c_str(), bench.seconds);
+  double xlat_secs = -1;
+  double legacy_secs = -1;
+  for (size_t i = 0; i < channelizers.size(); i++) {
+    if ((channelizers[i] != "xlat") && (channelizers[i] != "pfb") && (channelizers[i] != "fft") && (channelizers[i] != "tile") && (channelizers[i] != "legacy")) {
+      fprintf(stderr, "unknown channelizer %s\n", channelizers[i].c_str());
+      return 1;
+    }
+    double secs = run(bench, channelizers[i], signal);
+    if (channelizers[i] == "xlat") {
+      xlat_secs = secs;
+    } else if (channelizers[i] == "legacy") {
+      legacy_secs = secs;
+    }
+  }
+  if ((xlat_secs > 0) && (legacy_secs > 0)) {
+    bool xlat = xlat_secs <= legacy_secs;
+    printf("cheaper for %s at %.3f Msps: %s, %.0f%% less time than %s\n", bench.type.c_str(), bench.rate / 1e6,
+           xlat ? "xlat" : "legacy", 100 * (1 - std::min(xlat_secs, legacy_secs) / std::max(xlat_secs, legacy_secs)), xlat ? "legacy" : "xlat");
+  }
+  return 0;
+}
@@ -0,0 +1,253 @@
+// concluder-bench - throughput and per-step latency of the Call_Concluder
+//
+// Makes N calls' worth of transmission WAVs in a scratch directory, with
+// the transmission, source and error lists a trunked call would have,
+// then queues them all on the Call_Concluder at once and runs
+// manage_call_data_workers() until every one is done. Reports:
+//
+//   - calls/sec and seconds of audio concluded per second
+//   - p50/p90/p99/max for each step of concluding a call, as timed by the
+//     workers: waiting in the queue, joining the transmissions, writing the
+//     JSON, encoding, the plugins, removing the files and the whole call
+//
+// Making the WAVs isn't timed. No plugins or upload script are loaded, so
+// the numbers are for Trunk Recorder's own work plus sox and fdkaac.
+// Changes to the concluder should not make these numbers worse.
+//
+// build from a configured build directory with:
+//   make concluder-bench
+//
+// usage:
+//   concluder-bench [-n calls] [-t transmissions] [-l seconds] [-w workers]
+//                   [-c] [-x] [-a] [-k] [-d dir]
+//
+//   -n  calls to conclude (200)
+//   -t  transmissions per call (6)
+//   -l  seconds per transmission (4)
+//   -w  concluder workers, 0 for the default of half the cores (0)
+//   -c  compress the calls to m4a, needs fdkaac (and sox with -x)
+//   -x  make every other transmission 16 kHz, so calls are joined by sox
+//   -a  archive the calls with archiveSegments
+//   -k  keep the calls' files instead of removing them
+//   -d  where to make the scratch directory (/tmp)
+
+#include "../trunk-recorder/call_concluder/archive_segments.h"
+#include "../trunk-recorder/call_concluder/call_concluder.h"
+#include "../trunk-recorder/gr_blocks/wavfile_gr3.8.h"
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Something like speech: a few formants on a wandering pitch, an envelope
+// that comes and goes, and some noise. Returns the loudest sample.
+static int write_transmission(const std::string &filename, unsigned int rate, double seconds, std::mt19937 &rng) {
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp || !gr::blocks::wavheader_write(fp, rate, 1, 2)) {
+    fprintf(stderr, "unable to write %s\n", filename.c_str());
+    exit(1);
+  }
+  std::normal_distribution<double> noise(0, 300);
+  std::uniform_real_distribution<double> level(0.3, 1.0);
+  long samples = (long)(seconds * rate);
+  std::vector<int16_t> audio(samples);
+  double pitch = 110 + rng() % 80;
+  double phase = 0;
+  double gain = level(rng);
+  int peak = 0;
+  for (long i = 0; i < samples; i++) {
+    double t = (double)i / rate;
+    if (i % (rate / 4) == 0) {
+      gain = level(rng);
+    }
+    phase += 2 * M_PI * (pitch + 20 * sin(2 * M_PI * 0.7 * t)) / rate;
+    double voice = gain * (6000 * sin(phase) + 3000 * sin(5.1 * phase) + 1500 * sin(11.3 * phase)) * (0.5 + 0.5 * sin(2 * M_PI * 3 * t));
+    double sample = std::max(-32768.0, std::min(32767.0, voice + noise(rng)));
+    audio[i] = (int16_t)sample;
+    peak = std::max(peak, std::abs((int)audio[i]));
+  }
+  fwrite(audio.data(), sizeof(int16_t), samples, fp);
+  gr::blocks::wavheader_complete(fp, samples * sizeof(int16_t));
+  fclose(fp);
+  return peak;
+}
+
+static Call_Data_t make_call(const std::string &dir, long call_num, int transmissions, double seconds, bool compress, bool mixed, bool keep, std::mt19937 &rng) {
+  Call_Data_t call_info = Call_Data_t();
+  std::int64_t start_ms = (std::int64_t)time(NULL) * 1000 + call_num * 100;
+  call_info.talkgroup = 1000 + call_num % 50;
+  call_info.talkgroup_display = std::to_string(call_info.talkgroup);
+  call_info.talkgroup_alpha_tag = "Bench " + call_info.talkgroup_display;
+  call_info.talkgroup_priority = 1;
+  call_info.call_num = call_num;
+  call_info.freq = 851012500 + (call_num % 20) * 12500;
+  call_info.source_num = 0;
+  call_info.recorder_num = call_num % 8;
+  call_info.signal = -60;
+  call_info.noise = -110;
+  call_info.priority = 1;
+  call_info.audio_type = "digital";
+  call_info.short_name = "bench";
+  call_info.sys_num = 0;
+  call_info.compress_wav = compress;
+  call_info.audio_archive = keep;
+  call_info.call_log = keep;
+
+  char base[128];
+  snprintf(base, sizeof(base), "%ld-%lld_%.0f-call_%ld", call_info.talkgroup, (long long)(start_ms / 1000), call_info.freq, call_num);
+  call_info.filename = dir + "/" + base + ".wav";
+  call_info.status_filename = dir + "/" + base + ".json";
+  call_info.converted = dir + "/" + base + ".m4a";
+
+  std::int64_t time_ms = start_ms;
+  double position = 0;
+  for (int i = 0; i < transmissions; i++) {
+    Transmission t = Transmission();
+    unsigned int rate = (mixed && (i % 2)) ? 16000 : 8000;
+    char name[160];
+    snprintf(name, sizeof(name), "%s/%s-%d.wav", dir.c_str(), base, i);
+    t.filename = name;
+    t.source = 1000000 + rng() % 500;
+    t.talkgroup = call_info.talkgroup;
+    t.dcs_code = -1;
+    t.start_time_ms = time_ms;
+    t.stop_time_ms = time_ms + (std::int64_t)(seconds * 1000);
+    t.start_time = t.start_time_ms / 1000;
+    t.stop_time = t.stop_time_ms / 1000;
+    t.sample_count = (long)(seconds * rate);
+    t.error_count = rng() % 4;
+    t.spike_count = rng() % 2;
+    t.freq = call_info.freq;
+    t.length = seconds;
+    t.peak = write_transmission(t.filename, rate, seconds, rng);
+
+    Call_Source source = {t.source, t.start_time, position, false, "", ""};
+    Call_Error error = {t.start_time, position, seconds, (double)t.error_count, (double)t.spike_count};
+    call_info.transmission_source_list.push_back(source);
+    call_info.transmission_error_list.push_back(error);
+    call_info.error_count += t.error_count;
+    call_info.spike_count += t.spike_count;
+    call_info.transmission_list.push_back(t);
+
+    position += seconds;
+    time_ms = t.stop_time_ms + 500;
+  }
+
+  call_info.start_time_ms = start_ms;
+  call_info.stop_time_ms = time_ms - 500;
+  call_info.start_time = call_info.start_time_ms / 1000;
+  call_info.stop_time = call_info.stop_time_ms / 1000;
+  call_info.length = position;
+  call_info.call_length_ms = (std::int64_t)(position * 1000);
+  call_info.status = INITIAL;
+  call_info.process_call_time = time(NULL);
+  return call_info;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: concluder-bench [-n calls] [-t transmissions] [-l seconds] [-w workers] [-c] [-x] [-a] [-k] [-d dir]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  long calls = 200;
+  int transmissions = 6;
+  double seconds = 4;
+  int workers = 0;
+  bool compress = false;
+  bool mixed = false;
+  bool archive = false;
+  bool keep = false;
+  std::string parent = "/tmp";
+
+  for (int i = 1; i < argc; i++) {
+    bool has_value = (i + 1 < argc);
+    if (!strcmp(argv[i], "-n") && has_value) {
+      calls = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "-t") && has_value) {
+      transmissions = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-l") && has_value) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-w") && has_value) {
+      workers = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-d") && has_value) {
+      parent = argv[++i];
+    } else if (!strcmp(argv[i], "-c")) {
+      compress = true;
+    } else if (!strcmp(argv[i], "-x")) {
+      mixed = true;
+    } else if (!strcmp(argv[i], "-a")) {
+      archive = true;
+    } else if (!strcmp(argv[i], "-k")) {
+      keep = true;
+    } else {
+      usage();
+    }
+  }
+  if ((calls < 1) || (transmissions < 1) || (seconds <= 0)) {
+    usage();
+  }
+
+  boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::warning);
+
+  std::string dir_template = parent + "/concluder-bench-XXXXXX";
+  std::vector<char> dir_name(dir_template.begin(), dir_template.end());
+  dir_name.push_back('\0');
+  if (!mkdtemp(dir_name.data())) {
+    fprintf(stderr, "unable to make a directory in %s\n", parent.c_str());
+    return 1;
+  }
+  std::string dir = dir_name.data();
+
+  printf("making %ld calls of %d x %.1f s transmissions in %s\n", calls, transmissions, seconds, dir.c_str());
+  std::mt19937 rng(1);
+  std::vector<Call_Data_t> call_data;
+  call_data.reserve(calls);
+  for (long i = 0; i < calls; i++) {
+    call_data.push_back(make_call(dir, i + 1, transmissions, seconds, compress, mixed, keep || archive, rng));
+  }
+
+  Call_Concluder::set_worker_count(workers);
+  Archive_Segments::set_enabled(archive, 5);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for (std::vector<Call_Data_t>::iterator it = call_data.begin(); it != call_data.end(); ++it) {
+    Call_Concluder::queue_call_data(std::move(*it));
+  }
+  while (!Call_Concluder::call_data_workers.empty()) {
+    Call_Concluder::manage_call_data_workers();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  Archive_Segments::close_all();
+
+  int worker_count = (workers > 0) ? workers : std::max(2, (int)std::thread::hardware_concurrency() / 2);
+  printf("\n%ld calls in %.2f s with %d workers: %.1f calls/sec, %.0f s of audio/sec\n", calls, elapsed, worker_count, calls / elapsed, calls * transmissions * seconds / elapsed);
+  if (!Call_Concluder::retry_calls.empty()) {
+    printf("%zu calls failed and were left for a retry\n", Call_Concluder::retry_calls.size());
+  }
+
+  printf("\n%-14s %8s %10s %10s %10s %10s\n", "stage", "calls", "p50 ms", "p90 ms", "p99 ms", "max ms");
+  std::vector<Concluder_Stage_Stats> stages = Call_Concluder::get_stage_stats();
+  for (std::vector<Concluder_Stage_Stats>::iterator it = stages.begin(); it != stages.end(); ++it) {
+    printf("%-14s %8ld %10.2f %10.2f %10.2f %10.2f\n", it->stage.c_str(), it->latency.count, it->latency.p50_ms, it->latency.p90_ms, it->latency.p99_ms, it->latency.max_ms);
+  }
+
+  if (keep || archive) {
+    printf("\ncalls left in %s\n", dir.c_str());
+  } else {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  }
+  return 0;
+}
@@ -0,0 +1,341 @@
+// decoder-bench - throughput and detection numbers for the signaling decoders
+//
+// Feeds synthetic sub-audio, and optionally a recording, through the DCS,
+// MDC1200, FleetSync and STAR decoders in trunk-recorder/gr_blocks/decoders
+// and reports:
+//
+//   - samples/sec and ns/sample for each decoder at 8, 16 and 96 kHz
+//   - for DCS, a golden-vector run over every standard code in both
+//     polarities: how many decode correctly, how many as one of the codes
+//     that share the code's bitstream (dcs_code_aliases), how long the
+//     first decode takes, and how many reports name any other code
+//   - false positives from each decoder on a minute of voice-band audio
+//     with no signaling in it
+//   - messages/sec and ns/message for TPS message decoding, over the mix
+//     of TSBK, MBT and JSON messages the OP25 frame assembler hands it
+//
+// Tuning changes to the decoders should leave the golden results alone and
+// not make the throughput numbers worse.
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I trunk-recorder/gr_blocks/decoders utils/decoder-bench.cc \
+//     trunk-recorder/gr_blocks/decoders/{dcs,mdc,fsync,star,tps}_decode.cc -lvolk -o decoder-bench
+//
+// usage:
+//   decoder-bench                      synthetic benchmark and golden vectors
+//   decoder-bench file rate            also decode a raw float32 recording
+//                                      (demodulated audio at rate Hz) and
+//                                      list what each decoder reported
+
+#include "dcs_decode.h"
+#include "fsync_decode.h"
+#include "mdc_decode.h"
+#include "star_decode.h"
+#include "tps_decode.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+static const int RATES[] = {8000, 16000, 96000};
+
+// Standard DCS codes in decimal, as in dcs_decode.cc
+static const int DCS_CODES[] = {
+    19, 21, 22, 25, 26, 30, 35, 39, 41, 43, 44, 53, 57, 58, 59, 60,
+    76, 77, 78, 82, 85, 89, 90, 92, 99, 101, 106, 109, 110, 114, 117, 122, 124,
+    133, 138, 140, 147, 149, 150, 163, 164, 165, 166, 169, 170, 173, 177, 179, 181, 182, 185, 188,
+    198, 201, 205, 213, 217, 218, 227, 230, 233, 238, 244, 245, 249,
+    265, 266, 267, 275, 281, 282, 293, 294, 298, 300, 301, 306, 308, 309, 310,
+    323, 326, 334, 339, 342, 346, 358, 373, 390, 394, 404, 407, 409, 410, 428, 434, 436,
+    451, 458, 467, 473, 474, 476, 483, 492};
+static const int NUM_DCS_CODES = sizeof(DCS_CODES) / sizeof(DCS_CODES[0]);
+
+struct Report {
+  double time;  // seconds into the input
+  int code;     // DCS: code + 1000 if inverted; others: unit ID
+};
+
+// Each decoder behind one interface: feed() takes a block of samples and
+// appends whatever the decoder reported to *reports.
+struct Decoder {
+  const char *name;
+  std::function<void *(int rate)> create;
+  std::function<void(void *dec, float *samples, int n)> feed;
+  std::function<void(void *dec)> destroy;
+};
+
+static std::vector<Report> *reports;
+static double report_time;
+static int report_rate;
+
+// DCS reports are timed at the sample the decoder confirmed on, not at the
+// end of the block, so the latency can be held against the squelch pre-roll
+static void dcs_cb(int code, int inverted, void *dec) {
+  double time = (double)dcs_decoder_get_position((dcs_decoder_t *)dec) / report_rate;
+  reports->push_back({time, code + (inverted ? 1000 : 0)});
+}
+static void mdc_cb(int, unsigned char, unsigned char, unsigned short unitID, unsigned char, unsigned char, unsigned char, unsigned char, void *) {
+  reports->push_back({report_time, unitID});
+}
+static void fsync_cb(int, int, int, int from_unit, int, int, int, unsigned char *, int, unsigned char *, int, void *, int, int) {
+  reports->push_back({report_time, from_unit});
+}
+static void star_cb(int unitID, int, int, int, void *) {
+  reports->push_back({report_time, unitID});
+}
+
+static std::vector<Decoder> decoders() {
+  std::vector<Decoder> d;
+  d.push_back({"dcs",
+               [](int rate) -> void * { dcs_decoder_t *dec = dcs_decoder_new(rate); dcs_decoder_set_callback(dec, dcs_cb, dec); return dec; },
+               [](void *dec, float *s, int n) { dcs_decoder_process_samples((dcs_decoder_t *)dec, s, n); },
+               [](void *dec) { dcs_decoder_delete((dcs_decoder_t *)dec); }});
+  d.push_back({"mdc1200",
+               [](int rate) -> void * { mdc_decoder_t *dec = mdc_decoder_new(rate); mdc_decoder_set_callback(dec, mdc_cb, NULL); return dec; },
+               [](void *dec, float *s, int n) { mdc_decoder_process_samples((mdc_decoder_t *)dec, s, n); },
+               [](void *dec) { free(dec); }});
+  d.push_back({"fleetsync",
+               [](int rate) -> void * { fsync_decoder_t *dec = fsync_decoder_new(rate); fsync_decoder_set_callback(dec, fsync_cb, NULL); return dec; },
+               [](void *dec, float *s, int n) { fsync_decoder_process_samples((fsync_decoder_t *)dec, s, n); },
+               [](void *dec) { free(dec); }});
+  d.push_back({"star",
+               [](int rate) -> void * { star_decoder_t *dec = star_decoder_new(rate); star_decoder_set_callback(dec, star_format_1_16383, star_cb, NULL); return dec; },
+               [](void *dec, float *s, int n) { star_decoder_process_samples((star_decoder_t *)dec, s, n); },
+               [](void *dec) { free(dec); }});
+  return d;
+}
+
+// Run samples through a fresh decoder in blocks the size the flowgraph
+// typically hands over; returns the wall time spent in the decoder.
+static double run(const Decoder &decoder, int rate, std::vector<float> &samples, std::vector<Report> &out) {
+  const int block = 4096;
+  void *dec = decoder.create(rate);
+  reports = &out;
+  report_rate = rate;
+  double elapsed = 0;
+  for (size_t i = 0; i < samples.size(); i += block) {
+    int n = (int)std::min<size_t>(block, samples.size() - i);
+    report_time = (double)(i + n) / rate;
+    auto start = std::chrono::steady_clock::now();
+    decoder.feed(dec, &samples[i], n);
+    elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  decoder.destroy(dec);
+  return elapsed;
+}
+
+// Voice-band stand-in: a few drifting tones plus noise, no sub-audio
+static std::vector<float> voice(int rate, double seconds, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  std::vector<float> s((size_t)(rate * seconds));
+  for (size_t i = 0; i < s.size(); i++) {
+    double t = (double)i / rate;
+    s[i] = 0.3f * (float)sin(2 * M_PI * (500 + 200 * sin(2 * M_PI * 0.7 * t)) * t) +
+           0.2f * (float)sin(2 * M_PI * 1300 * t) + noise(gen);
+  }
+  return s;
+}
+
+static unsigned golay_parity(unsigned data) {
+  unsigned reg = data << 11;
+  for (int i = 22; i >= 11; i--) {
+    if ((reg >> i) & 1U) {
+      reg ^= 0xC75U << (i - 11);
+    }
+  }
+  return reg & 0x7FFU;
+}
+
+// Continuous DCS on top of voice: LSB of the codeword first, NRZ, at
+// roughly the deviation a radio uses
+static void add_dcs(std::vector<float> &s, int rate, size_t start, int code, bool inverted) {
+  unsigned word = ((unsigned)code << 11) | golay_parity(code);
+  double samples_per_bit = rate / 134.4;
+  for (size_t i = start; i < s.size(); i++) {
+    long bit = (long)((i - start) / samples_per_bit);
+    int value = (word >> (bit % 23)) & 1;
+    if (inverted) {
+      value = !value;
+    }
+    s[i] += value ? 0.15f : -0.15f;
+  }
+}
+
+static void benchmark() {
+  std::vector<Decoder> decs = decoders();
+  printf("Throughput (10 s of audio per run)\n");
+  printf("%-10s %8s %14s %10s\n", "decoder", "rate", "samples/sec", "ns/sample");
+  for (const Decoder &decoder : decs) {
+    for (int rate : RATES) {
+      std::vector<float> s = voice(rate, 10, 1);
+      add_dcs(s, rate, 0, 19, false);
+      std::vector<Report> out;
+      double elapsed = run(decoder, rate, s, out);
+      printf("%-10s %8d %14.0f %10.2f\n", decoder.name, rate, s.size() / elapsed, elapsed * 1e9 / s.size());
+    }
+  }
+}
+
+static void dcs_golden() {
+  const Decoder decoder = decoders()[0];
+  const double lead_in = 1.0;
+  printf("\nDCS golden vectors (%d codes x 2 polarities, %.0f s voice then 3 s coded)\n", NUM_DCS_CODES, lead_in);
+  printf("%8s %8s %8s %8s %12s %12s %12s\n", "rate", "correct", "alias", "missed", "latency avg", "latency max", "wrong code");
+  for (int rate : RATES) {
+    int correct = 0, alias = 0, missed = 0;
+    long wrong = 0;
+    double latency_sum = 0, latency_max = 0;
+    for (int c = 0; c < NUM_DCS_CODES; c++) {
+      for (int inverted = 0; inverted < 2; inverted++) {
+        std::vector<float> s = voice(rate, lead_in + 3, 2 + c);
+        add_dcs(s, rate, (size_t)(lead_in * rate), DCS_CODES[c], inverted);
+        std::vector<Report> out;
+        run(decoder, rate, s, out);
+
+        const int expected = DCS_CODES[c] + (inverted ? 1000 : 0);
+        int alias_codes[DCS_MAX_ALIASES], alias_inverted[DCS_MAX_ALIASES];
+        int naliases = dcs_code_aliases(DCS_CODES[c], inverted, alias_codes, alias_inverted, DCS_MAX_ALIASES);
+        double first = -1;
+        bool first_alias = false;
+        for (const Report &r : out) {
+          bool is_alias = false;
+          for (int a = 0; a < naliases; a++) {
+            is_alias |= (r.code == alias_codes[a] + (alias_inverted[a] ? 1000 : 0));
+          }
+          if (r.code != expected && !is_alias) {
+            wrong++;
+          } else if (first < 0) {
+            first = r.time - lead_in;
+            first_alias = is_alias;
+          }
+        }
+        if (first < 0) {
+          missed++;
+        } else {
+          (first_alias ? alias : correct)++;
+          latency_sum += first;
+          latency_max = std::max(latency_max, first);
+        }
+      }
+    }
+    printf("%8d %8d %8d %8d %10.0fms %10.0fms %12ld\n", rate, correct, alias, missed,
+           (correct + alias) ? 1000 * latency_sum / (correct + alias) : 0.0, 1000 * latency_max, wrong);
+  }
+}
+
+static void false_positives() {
+  std::vector<Decoder> decs = decoders();
+  printf("\nFalse positives (60 s of voice, no signaling)\n");
+  printf("%-10s %8s %10s\n", "decoder", "rate", "reports");
+  for (const Decoder &decoder : decs) {
+    for (int rate : RATES) {
+      std::vector<float> s = voice(rate, 60, 3);
+      std::vector<Report> out;
+      run(decoder, rate, s, out);
+      printf("%-10s %8d %10zu\n", decoder.name, rate, out.size());
+    }
+  }
+}
+
+// TPS decoding runs on the main loop once per message, not per sample, so
+// it's timed over a batch of messages like a busy channel would produce
+static void tps_benchmark() {
+  struct Message {
+    long type;
+    std::string data;
+  };
+  std::mt19937 gen(4);
+  std::vector<Message> messages;
+  for (int i = 0; i < 4096; i++) {
+    std::string data;
+    long type;
+    switch (i % 4) {
+    case 0: // TSBK: NAC, 10 bytes, CRC stripped
+    case 1:
+      type = TPS_MSG_TSBK;
+      data.resize(12);
+      break;
+    case 2: // MBT: NAC, header, then data blocks
+      type = TPS_MSG_MBT;
+      data.resize(10 + 12 * (1 + gen() % 3));
+      break;
+    default:
+      type = TPS_MSG_JSON_DATA;
+      data = "{\"srcaddr\" : " + std::to_string(gen() % 16777216) + ", \"grpaddr\": " + std::to_string(gen() % 65536) + "}";
+      break;
+    }
+    if (type != TPS_MSG_JSON_DATA) {
+      for (char &c : data) {
+        c = (char)gen();
+      }
+      data[0] = 0x29; // NAC 0x293
+      data[1] = (char)0x93;
+    }
+    messages.push_back({type, data});
+  }
+
+  const int passes = 250;
+  long reported = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    for (const Message &m : messages) {
+      long unit_id;
+      int emergency;
+      reported += tps_decode_message(m.type, (const unsigned char *)m.data.data(), m.data.size(), &unit_id, &emergency) > 0;
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double count = (double)passes * messages.size();
+
+  printf("\nTPS message decoding (%zu messages, TSBK/MBT/JSON mix)\n", messages.size());
+  printf("%14s %12s %10s\n", "messages/sec", "ns/message", "reported");
+  printf("%14.0f %12.2f %10ld\n", count / elapsed, elapsed * 1e9 / count, reported / passes);
+}
+
+static int recording(const char *filename, int rate) {
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL) {
+    printf("Error opening %s\n", filename);
+    return 1;
+  }
+  std::vector<float> s;
+  float buf[4096];
+  size_t n;
+  while ((n = fread(buf, sizeof(float), 4096, f)) > 0) {
+    s.insert(s.end(), buf, buf + n);
+  }
+  fclose(f);
+
+  printf("\nRecording %s (%.1f s at %d Hz)\n", filename, (double)s.size() / rate, rate);
+  for (const Decoder &decoder : decoders()) {
+    std::vector<Report> out;
+    std::vector<float> samples = s;
+    double elapsed = run(decoder, rate, samples, out);
+    printf("%-10s %10.2f ns/sample %6zu reports\n", decoder.name, elapsed * 1e9 / s.size(), out.size());
+    for (const Report &r : out) {
+      if (decoder.name[0] == 'd') {
+        printf("    %8.3f s  D%03o%c\n", r.time, r.code % 1000, r.code >= 1000 ? 'I' : 'N');
+      } else {
+        printf("    %8.3f s  %d\n", r.time, r.code);
+      }
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  benchmark();
+  dcs_golden();
+  false_positives();
+  tps_benchmark();
+  if (argc >= 3) {
+    return recording(argv[1], atoi(argv[2]));
+  }
+  return 0;
+}
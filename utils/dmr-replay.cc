@@ -0,0 +1,175 @@
+// dmr-replay - plays a DMR dibit capture back through the DMR slot decoding
+//
+// Reads a file of dibits, one per byte with values 0 to 3, the way the OP25
+// fsk4_slicer_fb hands them to the frame assembler (a gr file_sink of char
+// on the slicer's output writes one), and frames them the way rx_sync does:
+// a burst is the 144 dibits around each DMR sync, and every 144 dibits
+// after it until no sync has been seen for 1728 dibits. Each burst goes to
+// dmr_cai::load_frame(), which hands the slots to dmr_slot, and the
+// messages they send up the queue are taken off it after every burst, like
+// the control channel reader would. Reports:
+//
+//   - bursts/sec and ns/burst through the CACH and slot decoding
+//   - heap allocations per burst, counted with a replacement operator new:
+//     once the message pool has seen each kind of message, this should be 0
+//   - how many of each message came up the queue, and a digest of their
+//     types and payloads, which should not change for the same capture when
+//     the decoding is only made faster
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib -I lib/op25_repeater/include utils/dmr-replay.cc \
+//     lib/op25_repeater/lib/{dmr_cai,dmr_slot,bptc19696,trellis,hamming,golay2087}.cc \
+//     -lgnuradio-runtime -lgnuradio-pmt -lboost_thread -o dmr-replay
+//
+// usage:
+//   dmr-replay [-l loops] capture      play the capture loops times (3), the
+//                                      first pass is not timed
+
+#include "dmr_cai.h"
+#include "dmr_const.h"
+#include "op25_msg_types.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <unistd.h>
+
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const char *msg_names[] = {"CACH SLC", "CACH CSBK", "PI", "VOICE LC", "TERM LC", "CSBK", "MBC", "EMB LC", "EMB RC", "EMB SB"};
+static const int MSG_TYPES = sizeof(msg_names) / sizeof(msg_names[0]);
+
+struct replay_stats {
+  size_t bursts;
+  size_t messages[MSG_TYPES];
+  uint64_t digest;
+};
+
+// rx_sync's DMR framing, for one pass over the capture
+static void replay(const std::vector<uint8_t> &dibits, dmr_cai &dmr, gr::msg_queue::sptr queue, replay_stats &stats) {
+  static const int SYNC_OFFSET = 66;
+  static const int SYNC_LEN = 48;
+  static const int FRAGMENT_LEN = 144;
+  static const size_t EXPIRATION = 1728;
+
+  uint64_t sync_reg = 0;
+  bool locked = false;
+  int rx_count = 0;
+  size_t expires = 0;
+  bool unmute;
+
+  for (size_t i = 0; i < dibits.size(); i++) {
+    sync_reg = ((sync_reg << 2) | (dibits[i] & 3)) & 0xffffffffffffULL;
+    bool sync = false;
+    for (unsigned int m = 0; m < DMR_SYNC_MAGICS_COUNT; m++) {
+      if (__builtin_popcountll(sync_reg ^ DMR_SYNC_MAGICS[m]) <= (locked ? 2 : 0)) {
+        sync = true;
+        break;
+      }
+    }
+    if (!locked && !sync)
+      continue;
+    rx_count++;
+    if (sync) {
+      locked = true;
+      rx_count = SYNC_OFFSET + (SYNC_LEN >> 1);
+      expires = i + EXPIRATION;
+    }
+    if (i >= expires) {
+      locked = false;
+      continue;
+    }
+    if ((rx_count < FRAGMENT_LEN) || (i + 1 < (size_t)FRAGMENT_LEN))
+      continue;
+    rx_count = 0;
+
+    if (dmr.load_frame(&dibits[i + 1 - FRAGMENT_LEN], unmute))
+      expires = i + EXPIRATION;
+    stats.bursts++;
+
+    while (gr::message::sptr msg = queue->delete_head_nowait()) {
+      int type = msg->type() & 0xffff;
+      if ((type >= 0) && (type < MSG_TYPES))
+        stats.messages[type]++;
+      stats.digest = (stats.digest ^ (uint64_t)msg->type()) * 0x100000001b3ULL;
+      for (size_t b = 0; b < msg->length(); b++)
+        stats.digest = (stats.digest ^ msg->msg()[b]) * 0x100000001b3ULL;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int loops = 3;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:")) != -1) {
+    switch (opt) {
+    case 'l':
+      loops = atoi(optarg);
+      break;
+    default:
+      loops = 0;
+    }
+  }
+  if ((loops < 2) || (optind != argc - 1)) {
+    fprintf(stderr, "usage: %s [-l loops] capture\n", argv[0]);
+    return 1;
+  }
+
+  FILE *fp = fopen(argv[optind], "rb");
+  if (!fp) {
+    fprintf(stderr, "%s: can't open %s\n", argv[0], argv[optind]);
+    return 1;
+  }
+  std::vector<uint8_t> dibits;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    dibits.insert(dibits.end(), buf, buf + n);
+  fclose(fp);
+
+  log_ts logger;
+  gr::msg_queue::sptr queue = gr::msg_queue::make(100);
+  dmr_cai dmr(logger, 0, 0, queue);
+
+  // The first pass fills the message pool and gets the capture into cache
+  replay_stats first;
+  memset(&first, 0, sizeof(first));
+  first.digest = 0xcbf29ce484222325ULL;
+  replay(dibits, dmr, queue, first);
+
+  replay_stats timed;
+  memset(&timed, 0, sizeof(timed));
+  timed.digest = 0xcbf29ce484222325ULL;
+  size_t start_allocations = allocations;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int l = 1; l < loops; l++)
+    replay(dibits, dmr, queue, timed);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t timed_allocations = allocations - start_allocations;
+
+  printf("%zu dibits, %zu bursts a pass\n", dibits.size(), first.bursts);
+  if (timed.bursts) {
+    printf("  %.0f bursts/sec  %.1f ns/burst\n", timed.bursts / secs, secs * 1e9 / timed.bursts);
+    printf("  %.3f allocations/burst (%zu over %zu bursts)\n", (double)timed_allocations / timed.bursts, timed_allocations, timed.bursts);
+  }
+  printf("  messages a pass, digest %016llx\n", (unsigned long long)first.digest);
+  for (int t = 0; t < MSG_TYPES; t++) {
+    if (first.messages[t])
+      printf("    %-10s %zu\n", msg_names[t], first.messages[t]);
+  }
+  return 0;
+}
@@ -0,0 +1,315 @@
+// fec-bench - checks and times the table driven op25 FEC syndromes
+//
+// Runs the Golay(23,12) syndrome lookup in lib/op25_repeater/lib/op25_golay.h
+// (used by the IMBE, HDU, TDU and Phase 2 voice decodes and the DMR
+// Golay(20,8)), and bchDec() from lib/op25_repeater/lib/bch.cc (the NID of
+// every P25 Phase 1 frame), against the bit at a time versions they
+// replace, and reports:
+//
+//   - golden results: the Golay syndrome of every 23 bit word, and the
+//     BCH(63,16) decode of codewords with 0 to 12 bit errors and of random
+//     words, the return value and the corrected bits. Anything but 0
+//     mismatches is a bug.
+//   - codewords/sec and ns/codeword for both versions of each
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib utils/fec-bench.cc lib/op25_repeater/lib/bch.cc -o fec-bench
+//
+// usage:
+//   fec-bench [codewords]              default 200000 codewords per test
+
+#include "bch.h"
+#include "op25_golay.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// golay_23_syndrome() and gly23127GetSyn() as they were
+static uint32_t ref_golay_23_syndrome(uint32_t pattern) {
+  uint32_t aux = 0x400000;
+  while (pattern & 0xFFFFF800) {
+    while ((aux & pattern) == 0) {
+      aux >>= 1;
+    }
+    pattern ^= (aux >> 11) * 0xC75;
+  }
+  return pattern;
+}
+
+// bchDec() as it was
+static const int ref_GFexp[64] = {
+	1, 2, 4, 8, 16, 32, 3, 6, 12, 24, 48, 35, 5, 10, 20, 40,
+	19, 38, 15, 30, 60, 59, 53, 41, 17, 34, 7, 14, 28, 56, 51, 37,
+	9, 18, 36, 11, 22, 44, 27, 54, 47, 29, 58, 55, 45, 25, 50, 39,
+	13, 26, 52, 43, 21, 42, 23, 46, 31, 62, 63, 61, 57, 49, 33, 0
+};
+
+static const int ref_GFlog[64] = {
+	-1, 0, 1, 6, 2, 12, 7, 26, 3, 32, 13, 35, 8, 48, 27, 18,
+	4, 24, 33, 16, 14, 52, 36, 54, 9, 45, 49, 38, 28, 41, 19, 56,
+	5, 62, 25, 11, 34, 31, 17, 47, 15, 23, 53, 51, 37, 44, 55, 40,
+	10, 61, 46, 30, 50, 22, 39, 43, 29, 60, 42, 21, 20, 59, 57, 58
+};
+
+static int ref_bchDec(bit_vector& Codeword)
+{
+
+   int elp[24][ 22], S[23];
+   int D[23], L[24], uLu[24];
+   int locn[11], reg[12];
+   int i,j,U,q,count;
+   int SynError, CantDecode;
+
+   SynError = 0; CantDecode = 0;
+
+   for(i = 1; i <= 22; i++) {
+      S[i] = 0;
+      // FOR j = 0 TO 62
+      for(j = 0; j <= 62; j++) {
+         if( Codeword[j]) { S[i] = S[i] ^ ref_GFexp[(i * j) % 63]; }
+      }
+      if( S[i]) { SynError = 1; }
+      S[i] = ref_GFlog[S[i]];
+      // printf("S[%d] %d\n", i, S[i]);
+   }
+
+   if( SynError) { //if there are errors, try to correct them
+      L[0] = 0; uLu[0] = -1; D[0] = 0;    elp[0][ 0] = 0;
+      L[1] = 0; uLu[1] = 0;  D[1] = S[1]; elp[1][ 0] = 1;
+      //FOR i = 1 TO 21
+      for(i = 1; i <= 21; i++) {
+         elp[0][ i] = -1; elp[1][ i] = 0;
+      }
+      U = 0;
+
+      do {
+         U = U + 1;
+         if( D[U] == -1) {
+            L[U + 1] = L[U];
+            // FOR i = 0 TO L[U]
+            for(i = 0; i <= L[U]; i++) {
+               elp[U + 1][ i] = elp[U][ i]; elp[U][ i] = ref_GFlog[elp[U][ i]];
+            }
+         } else {
+            //search for words with greatest uLu(q) for which d(q)!=0
+            q = U - 1;
+            while((D[q] == -1) &&(q > 0)) { q = q - 1; }
+            //have found first non-zero d(q)
+            if( q > 0) {
+               j = q;
+               do { j = j - 1; if((D[j] != -1) &&(uLu[q] < uLu[j])) { q = j; }
+               } while( j > 0) ;
+            }
+
+            //store degree of new elp polynomial
+            if( L[U] > L[q] + U - q) {
+               L[U + 1] = L[U] ;
+            } else {
+               L[U + 1] = L[q] + U - q;
+            }
+
+            ///* form new elp(x) */
+            // FOR i = 0 TO 21
+            for(i = 0; i <= 21; i++) {
+               elp[U + 1][ i] = 0;
+            }
+            // FOR i = 0 TO L(q)
+            for(i = 0; i <= L[q]; i++) {
+               if( elp[q][ i] != -1) {
+                  elp[U + 1][ i + U - q] = ref_GFexp[(D[U] + 63 - D[q] + elp[q][ i]) % 63];
+               }
+            }
+            // FOR i = 0 TO L(U)
+            for(i = 0; i <= L[U]; i++) {
+               elp[U + 1][ i] = elp[U + 1][ i] ^ elp[U][ i];
+               elp[U][ i] = ref_GFlog[elp[U][ i]];
+            }
+         }
+         uLu[U + 1] = U - L[U + 1];
+
+         //form(u+1)th discrepancy
+         if( U < 22) {
+            //no discrepancy computed on last iteration
+            if( S[U + 1] != -1) { D[U + 1] = ref_GFexp[S[U + 1]]; } else { D[U + 1] = 0; }
+            // FOR i = 1 TO L(U + 1)
+            for(i = 1; i <= L[U + 1]; i++) {
+               if((S[U + 1 - i] != -1) &&(elp[U + 1][ i] != 0)) {
+                  D[U + 1] = D[U + 1] ^ ref_GFexp[(S[U + 1 - i] + ref_GFlog[elp[U + 1][ i]]) % 63];
+               }
+            }
+            //put d(u+1) into index form */
+            D[U + 1] = ref_GFlog[D[U + 1]];
+         }
+      } while((U < 22) &&(L[U + 1] <= 11));
+
+      U = U + 1;
+      if( L[U] <= 11) { // /* Can correct errors */
+         //put elp into index form
+         // FOR i = 0 TO L[U]
+         for(i = 0; i <= L[U]; i++) {
+            elp[U][ i] = ref_GFlog[elp[U][ i]];
+         }
+
+         //Chien search: find roots of the error location polynomial
+         // FOR i = 1 TO L(U)
+         for(i = 1; i <= L[U]; i++) {
+            reg[i] = elp[U][ i];
+         }
+         count = 0;
+         // FOR i = 1 TO 63
+         for(i = 1; i <= 63; i++) {
+            q = 1;
+            //FOR j = 1 TO L(U)
+            for(j = 1; j <= L[U]; j++) {
+               if( reg[j] != -1) {
+                  reg[j] =(reg[j] + j) % 63; q = q ^ ref_GFexp[reg[j]];
+               }
+            }
+            if( q == 0) { //store error location number indices
+               locn[count] = 63 - i; count = count + 1;
+            }
+         }
+         if( count == L[U]) {
+            //no. roots = degree of elp hence <= t errors
+            //FOR i = 0 TO L[U] - 1
+            for(i = 0; i <= L[U]-1; i++) {
+               Codeword[locn[i]] = Codeword[locn[i]] ^ 1;
+            }
+            CantDecode = count;
+         } else { //elp has degree >t hence cannot solve
+            CantDecode = -1;
+         }
+      } else {
+         CantDecode = -2;
+      }
+   }
+   return CantDecode;
+}
+
+
+// The generator polynomial of the code, bit i the coefficient of x^i
+static const uint64_t bch_generator = 0xcd930bdd3b2bULL;
+
+// A codeword of the 16 bits of message with the given number of bit errors,
+// or a random word if errors is < 0
+static bit_vector make_word(std::mt19937_64 &rng, int errors) {
+  uint64_t word = 0;
+  if (errors < 0) {
+    word = rng() & 0x7fffffffffffffffULL;
+  } else {
+    uint64_t message = rng() & 0xffff;
+    for (int k = 0; k < 16; k++) {
+      if ((message >> k) & 1)
+        word ^= bch_generator << k;
+    }
+    uint64_t flipped = 0;
+    for (int e = 0; e < errors;) {
+      uint64_t bit = 1ULL << (rng() % 63);
+      if (flipped & bit)
+        continue;
+      flipped |= bit;
+      word ^= bit;
+      e++;
+    }
+  }
+  bit_vector cw(64);
+  for (int j = 0; j < 64; j++)
+    cw[j] = (word >> j) & 1;
+  return cw;
+}
+
+template <typename F>
+static double time_ns(size_t count, F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (double)count;
+}
+
+static void report(const char *name, double ref_ns, double new_ns) {
+  printf("  %-32s %8.1f ns/codeword %10.0f codewords/sec   was %8.1f ns/codeword   %5.2fx\n",
+         name, new_ns, 1e9 / new_ns, ref_ns, ref_ns / new_ns);
+}
+
+int main(int argc, char *argv[]) {
+  size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+  if (count == 0) {
+    fprintf(stderr, "usage: %s [codewords]\n", argv[0]);
+    return 1;
+  }
+  std::mt19937_64 rng(103);
+  size_t total_mismatches = 0;
+
+  printf("golden results:\n");
+  size_t mismatches = 0;
+  for (uint32_t pattern = 0; pattern < (1 << 23); pattern++) {
+    if (golay_23_syndrome(pattern) != ref_golay_23_syndrome(pattern))
+      mismatches++;
+  }
+  printf("  Golay(23,12) syndromes, all %d words  %6zu mismatches\n", 1 << 23, mismatches);
+  total_mismatches += mismatches;
+
+  for (int errors = -1; errors <= 12; errors++) {
+    size_t decoded = 0;
+    mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+      bit_vector cw = make_word(rng, errors);
+      bit_vector ref_cw = cw;
+      int ec = bchDec(cw);
+      int ref_ec = ref_bchDec(ref_cw);
+      if ((ec != ref_ec) || (cw != ref_cw))
+        mismatches++;
+      if (ec >= 0)
+        decoded++;
+    }
+    if (errors < 0)
+      printf("  BCH(63,16) random words        ");
+    else
+      printf("  BCH(63,16) %2d bit errors       ", errors);
+    printf("%8zu decoded %6zu mismatches\n", decoded, mismatches);
+    total_mismatches += mismatches;
+  }
+
+  printf("throughput:\n");
+  volatile uint32_t sink = 0;
+  std::vector<uint32_t> patterns(count);
+  for (size_t i = 0; i < count; i++)
+    patterns[i] = rng() & 0x7fffff;
+  double ref_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += ref_golay_23_syndrome(patterns[i]);
+  });
+  double new_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += golay_23_syndrome(patterns[i]);
+  });
+  report("Golay(23,12) syndrome", ref_ns, new_ns);
+
+  for (int errors : {0, 2, 4}) {
+    std::vector<bit_vector> words(count);
+    for (size_t i = 0; i < count; i++)
+      words[i] = make_word(rng, errors);
+    std::vector<bit_vector> work = words;
+    ref_ns = time_ns(count, [&]() {
+      for (size_t i = 0; i < count; i++)
+        sink += ref_bchDec(work[i]);
+    });
+    work = words;
+    new_ns = time_ns(count, [&]() {
+      for (size_t i = 0; i < count; i++)
+        sink += bchDec(work[i]);
+    });
+    char name[64];
+    snprintf(name, sizeof(name), "BCH(63,16) NID, %d bit errors", errors);
+    report(name, ref_ns, new_ns);
+  }
+
+  if (total_mismatches) {
+    printf("FAILED: %zu mismatches\n", total_mismatches);
+    return 1;
+  }
+  return 0;
+}
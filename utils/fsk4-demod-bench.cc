@@ -0,0 +1,214 @@
+// fsk4-demod-bench - checks and times the symbol timing loop of fsk4_demod_ff
+//
+// Runs the tracking loops in lib/op25_repeater/lib/fsk4_timing.h against the
+// sample at a time tracking_loop_mmse() fsk4_demod_ff_impl.cc used before,
+// over the same run of noisy, frequency offset 4 level (or 2 level) FSK at
+// each of the channel rates the recorders and control channels use, and
+// reports for each:
+//
+//   - golden results: how many symbols the two give different values for,
+//     and whether they gave the same number of them. Anything but 0 is a
+//     bug, they are meant to be bit for bit the same.
+//   - Msamples/sec and ns/sample for both
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib utils/fsk4-demod-bench.cc -o fsk4-demod-bench
+//
+// usage:
+//   fsk4-demod-bench [seconds]         default 60 seconds of signal per rate
+
+#include "fsk4_timing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace gr::op25_repeater;
+
+// tracking_loop_mmse() as it was, with the members it used
+struct reference_loop {
+  float d_history[NTAPS];
+  size_t d_history_last;
+  double d_symbol_clock;
+  double d_symbol_spread;
+  float d_symbol_time;
+  double fine_frequency_correction;
+  double coarse_frequency_correction;
+  bool d_bfsk;
+
+  reference_loop(float symbol_time, bool bfsk)
+      : d_history_last(0), d_symbol_clock(0.0), d_symbol_spread(2.0), d_symbol_time(symbol_time),
+        fine_frequency_correction(0.0), coarse_frequency_correction(0.0), d_bfsk(bfsk) {
+    std::fill(&d_history[0], &d_history[NTAPS], 0.0);
+  }
+
+  bool tracking_loop_mmse(float input, float *output) {
+    d_symbol_clock += d_symbol_time;
+
+    d_history[d_history_last++] = input;
+    d_history_last %= NTAPS;
+
+    if (d_symbol_clock > 1.0) {
+      d_symbol_clock -= 1.0;
+
+      int imu = (int)floor(0.5 + (NSTEPS * ((d_symbol_clock / d_symbol_time))));
+      int imu_p1 = imu + 1;
+      if (imu >= NSTEPS) {
+        imu = NSTEPS - 1;
+        imu_p1 = NSTEPS;
+      }
+
+      size_t j = d_history_last;
+      double interp = 0.0;
+      double interp_p1 = 0.0;
+      for (int i = 0; i < NTAPS; i++) {
+        interp += TAPS[imu][i] * d_history[j];
+        interp_p1 += TAPS[imu_p1][i] * d_history[j];
+        j = (j + 1) % NTAPS;
+      }
+
+      interp -= fine_frequency_correction;
+      interp_p1 -= fine_frequency_correction;
+
+      *output = 2.0 * interp / d_symbol_spread;
+
+      double symbol_error;
+      const double K_SYMBOL_SPREAD = 0.0100;
+
+      if (d_bfsk) {
+        if (interp < 0.0) {
+          symbol_error = interp + (0.5 * d_symbol_spread);
+          d_symbol_spread -= (symbol_error * K_SYMBOL_SPREAD);
+        } else {
+          symbol_error = interp - (0.5 * d_symbol_spread);
+          d_symbol_spread += (symbol_error * K_SYMBOL_SPREAD);
+        }
+      } else {
+        if (interp < -d_symbol_spread) {
+          symbol_error = interp + (1.5 * d_symbol_spread);
+          d_symbol_spread -= (symbol_error * 0.5 * K_SYMBOL_SPREAD);
+        } else if (interp < 0.0) {
+          symbol_error = interp + (0.5 * d_symbol_spread);
+          d_symbol_spread -= (symbol_error * K_SYMBOL_SPREAD);
+        } else if (interp < d_symbol_spread) {
+          symbol_error = interp - (0.5 * d_symbol_spread);
+          d_symbol_spread += (symbol_error * K_SYMBOL_SPREAD);
+        } else {
+          symbol_error = interp - (1.5 * d_symbol_spread);
+          d_symbol_spread += (symbol_error * 0.5 * K_SYMBOL_SPREAD);
+        }
+      }
+
+      const double K_SYMBOL_TIMING = 0.025;
+      if (interp_p1 < interp) {
+        d_symbol_clock += symbol_error * K_SYMBOL_TIMING;
+      } else {
+        d_symbol_clock -= symbol_error * K_SYMBOL_TIMING;
+      }
+
+      const double SYMBOL_SPREAD_MAX = 2.4;
+      const double SYMBOL_SPREAD_MIN = 1.6;
+      d_symbol_spread = std::max(d_symbol_spread, SYMBOL_SPREAD_MIN);
+      d_symbol_spread = std::min(d_symbol_spread, SYMBOL_SPREAD_MAX);
+
+      static const double K_COARSE_FREQUENCY = 0.00125;
+      coarse_frequency_correction += ((fine_frequency_correction - coarse_frequency_correction) * K_COARSE_FREQUENCY);
+
+      static const double K_FINE_FREQUENCY = 0.125;
+      fine_frequency_correction += (symbol_error * K_FINE_FREQUENCY);
+
+      return true;
+    }
+    return false;
+  }
+};
+
+struct Rate {
+  const char *name;
+  double sample_rate;
+  double symbol_rate;
+  bool bfsk;
+};
+
+// The symbols at the channel rate, raised cosine shaped, with a slow drift
+// in the symbol clock, a frequency offset and noise
+static std::vector<float> make_signal(const Rate &rate, double seconds) {
+  std::mt19937 rng(101);
+  std::normal_distribution<float> noise(0.0f, 0.15f);
+  size_t count = (size_t)(rate.sample_rate * seconds);
+  std::vector<float> signal(count);
+  double sps = rate.sample_rate / rate.symbol_rate * 1.0003;
+  double prev = 0, next = 0, phase = 1.0;
+  for (size_t i = 0; i < count; i++) {
+    phase += 1.0 / sps;
+    if (phase >= 1.0) {
+      phase -= 1.0;
+      prev = next;
+      int level = rate.bfsk ? ((rng() & 1) ? 1 : -1) : ((int)(rng() & 3) * 2 - 3);
+      next = level;
+    }
+    double shape = 0.5 - 0.5 * cos(M_PI * phase);
+    double offset = 0.2 * sin(2 * M_PI * i / (rate.sample_rate * 7.0));
+    signal[i] = (float)(prev + (next - prev) * shape + offset) + noise(rng);
+  }
+  return signal;
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 60;
+  if (seconds <= 0) {
+    fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+    return 1;
+  }
+
+  static const Rate rates[] = {
+      {"P25 C4FM, 4 sps", 19200, 4800, false},
+      {"P25 C4FM / DMR, 5 sps", 24000, 4800, false},
+      {"P25 C4FM, 10 sps", 48000, 4800, false},
+      {"SmartNet FSK2, 5 sps", 18000, 3600, true},
+  };
+  // Blocks of the size the scheduler tends to hand the block
+  const int block = 4096;
+  bool failed = false;
+
+  for (const Rate &rate : rates) {
+    std::vector<float> signal = make_signal(rate, seconds);
+    std::vector<float> reference_out(signal.size() / 2 + block);
+    std::vector<float> fast_out(signal.size() / 2 + block);
+
+    reference_loop reference(rate.symbol_rate / rate.sample_rate, rate.bfsk);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t reference_count = 0;
+    for (size_t i = 0; i < signal.size(); i++) {
+      if (reference.tracking_loop_mmse(signal[i], &reference_out[reference_count])) {
+        reference_count++;
+      }
+    }
+    double reference_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fsk4_timing fast(rate.symbol_rate / rate.sample_rate, rate.bfsk);
+    start = std::chrono::steady_clock::now();
+    size_t fast_count = 0;
+    for (size_t i = 0; i < signal.size(); i += block) {
+      int n = std::min((size_t)block, signal.size() - i);
+      fast_count += fast.work(&signal[i], n, &fast_out[fast_count]);
+    }
+    double fast_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long differ = 0;
+    for (size_t i = 0; i < std::min(reference_count, fast_count); i++) {
+      differ += (memcmp(&reference_out[i], &fast_out[i], sizeof(float)) != 0);
+    }
+    failed |= (differ != 0) || (reference_count != fast_count);
+
+    printf("%s, %.0f samples/sec\n", rate.name, rate.sample_rate);
+    printf("  golden      %ld of %zu symbols differ%s\n", differ, reference_count, (reference_count != fast_count) ? ", and the symbol counts differ" : "");
+    printf("  reference   %8.1f Msamples/sec  %6.2f ns/sample\n", signal.size() / reference_secs / 1e6, reference_secs * 1e9 / signal.size());
+    printf("  fast        %8.1f Msamples/sec  %6.2f ns/sample  (%.1fx)\n", signal.size() / fast_secs / 1e6, fast_secs * 1e9 / signal.size(), reference_secs / fast_secs);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+// imbe-vocoder-bench - checks and times the fixed point IMBE vocoder
+//
+// Runs the array kernels in lib/op25_repeater/lib/imbe_vocoder/aux_sub.cc
+// against the basic operator loops they replace, and the whole vocoder over
+// a fixed run of audio and random frames, and reports:
+//
+//   - golden results: how many of a set of random and saturating vectors
+//     the kernels give a different answer for than the L_add() / mult_r()
+//     loops. Anything but 0 is a bug.
+//   - ns/call for v_mult_r() and the mult_r() loop
+//   - frames/sec and us/frame to encode and decode, and a checksum of all
+//     the frames and audio. The basic operators are ETSI bit exact, so a
+//     change to them or to the kernels must leave the checksum alone; it
+//     was 0xce031cae before the operators were made inline and still is.
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib/imbe_vocoder
+//     utils/imbe-vocoder-bench.cc lib/op25_repeater/lib/imbe_vocoder/[a-z]*.cc
+//     -o imbe-vocoder-bench
+//
+// usage:
+//   imbe-vocoder-bench [frames]        default 3000 frames
+
+#include "imbe_vocoder.h"
+#include "aux_sub.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static Word32 loop_mult_sum(Word16 *vec1, Word16 *vec2, Word16 scale, Word16 n) {
+  Word32 L_sum = 0;
+  for (Word16 i = 0; i < n; i++) {
+    L_sum = L_add(L_sum, L_shr(L_mult(vec1[i], vec2[i]), scale));
+  }
+  return L_sum;
+}
+
+static void loop_mult_r(Word16 *vec1, Word16 *vec2, const Word16 *vec3, Word16 n) {
+  for (Word16 i = 0; i < n; i++) {
+    vec1[i] = mult_r(vec2[i], vec3[i]);
+  }
+}
+
+// Vectors of a random size, with random levels, and every so often pinned
+// to full scale so the sums saturate
+static void make_vector(std::mt19937 &rng, std::vector<Word16> &vec, int size) {
+  int level = 1 + (rng() % 15);
+  int kind = rng() % 8;
+  vec.resize(size);
+  for (int i = 0; i < size; i++) {
+    if (kind == 0) {
+      vec[i] = -32768;
+    } else if (kind == 1) {
+      vec[i] = (rng() & 1) ? 32767 : -32768;
+    } else {
+      vec[i] = (Word16)((int)(rng() & 0xffff) >> (16 - level)) - (1 << (level - 1));
+    }
+  }
+}
+
+static double ns_per_call(std::chrono::steady_clock::time_point start, long calls) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+static void golden_kernels() {
+  std::mt19937 rng(98);
+  std::vector<Word16> a, b, out1, out2;
+  long sums = 0, sum_failed = 0, products = 0, product_failed = 0;
+
+  for (int t = 0; t < 20000; t++) {
+    int size = 1 + rng() % 301;
+    Word16 scale = rng() % 8;
+    make_vector(rng, a, size);
+    make_vector(rng, b, size);
+    sums++;
+    sum_failed += (L_v_mult_sum(&a[0], &b[0], scale, size) != loop_mult_sum(&a[0], &b[0], scale, size));
+    sums++;
+    sum_failed += (L_v_magsq(&a[0], size) != loop_mult_sum(&a[0], &a[0], 0, size));
+
+    out1.resize(size);
+    out2.resize(size);
+    v_mult_r(&out1[0], &a[0], &b[0], size);
+    loop_mult_r(&out2[0], &a[0], &b[0], size);
+    products++;
+    product_failed += (out1 != out2);
+  }
+  printf("golden kernels\n");
+  printf("  L_v_mult_sum  %ld of %ld sums differ\n", sum_failed, sums);
+  printf("  v_mult_r      %ld of %ld vectors differ\n", product_failed, products);
+
+  // The size pitch_est() uses it at
+  const int calls = 200000;
+  make_vector(rng, a, 301);
+  make_vector(rng, b, 301);
+  out1.resize(301);
+  volatile Word32 sink = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    v_mult_r(&out1[0], &a[0], &b[0], 301);
+    sink = sink + out1[i % 301];
+  }
+  double kernel_product = ns_per_call(start, calls);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < calls; i++) {
+    loop_mult_r(&out1[0], &a[0], &b[0], 301);
+    sink = sink + out1[i % 301];
+  }
+  double loop_product = ns_per_call(start, calls);
+
+  printf("  v_mult_r      %8.1f ns/call  loop %8.1f ns/call  (301 samples)\n", kernel_product, loop_product);
+}
+
+static uint32_t fnv(uint32_t hash, const int16_t *data, int count) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (int i = 0; i < count * 2; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void vocoder(int frames) {
+  std::mt19937 rng(5);
+  std::vector<int16_t> audio(frames * 160);
+  std::vector<int16_t> codewords(frames * 8);
+  std::vector<int16_t> random_codewords(frames * 8);
+  std::vector<int16_t> decoded(frames * 160);
+  std::vector<int16_t> random_decoded(frames * 160);
+
+  // A sweeping tone and its third harmonic in noise
+  double phase = 0;
+  for (int f = 0; f < frames; f++) {
+    for (int i = 0; i < 160; i++) {
+      phase += 0.05 + 0.04 * sin(f * 0.01);
+      audio[f * 160 + i] = (int16_t)(8000 * sin(phase) + 3000 * sin(phase * 3.1) + (int)(rng() % 2000) - 1000);
+    }
+    for (int j = 0; j < 8; j++) {
+      random_codewords[f * 8 + j] = rng() & ((j < 4) ? 0xfff : ((j < 7) ? 0x7ff : 0x7f));
+    }
+  }
+
+  imbe_vocoder encoder;
+  imbe_vocoder decoder;
+  imbe_vocoder random_decoder;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; f++) {
+    encoder.imbe_encode(&codewords[f * 8], &audio[f * 160]);
+  }
+  double encode_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; f++) {
+    decoder.imbe_decode(&codewords[f * 8], &decoded[f * 160]);
+  }
+  for (int f = 0; f < frames; f++) {
+    random_decoder.imbe_decode(&random_codewords[f * 8], &random_decoded[f * 160]);
+  }
+  double decode_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 2;
+
+  uint32_t hash = 2166136261u;
+  for (int f = 0; f < frames; f++) {
+    hash = fnv(hash, &codewords[f * 8], 8);
+    hash = fnv(hash, &decoded[f * 160], 160);
+    hash = fnv(hash, &random_decoded[f * 160], 160);
+  }
+
+  printf("vocoder, %d frames\n", frames);
+  printf("  encode  %8.0f frames/sec  %8.2f us/frame\n", frames / encode_secs, encode_secs * 1e6 / frames);
+  printf("  decode  %8.0f frames/sec  %8.2f us/frame\n", frames / decode_secs, decode_secs * 1e6 / frames);
+  printf("  checksum 0x%08x\n", hash);
+}
+
+int main(int argc, char **argv) {
+  int frames = (argc > 1) ? atoi(argv[1]) : 3000;
+  if (frames < 1) {
+    fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+    return 1;
+  }
+  golden_kernels();
+  vocoder(frames);
+  return 0;
+}
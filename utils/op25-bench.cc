@@ -0,0 +1,766 @@
+// op25-bench - times the op25_repeater kernels one at a time
+//
+// Runs each of the demodulator, framing, FEC and vocoder kernels the
+// recorders spend their time in over the same synthetic input every time,
+// or a recording of your own, and reports for each:
+//
+//   - items/sec and ns/item, where an item is a sample, symbol, codeword
+//     or frame, whichever the kernel takes
+//   - a digest of everything it put out. A change that is only meant to
+//     make a kernel faster must leave its digest alone. The OP25_KERNELs
+//     (lib/op25_repeater/lib/op25_simd.h) give the same answer in every
+//     copy the loader can pick, so the digests are also the same from
+//     one CPU to the next and in a build with -DOP25_NO_DISPATCH.
+//
+// It starts by saying which vector extensions the CPU has, and so which
+// copy of the OP25_KERNELs is being run.
+//
+// The synthetic input is P25 Phase 1 voice: LDU1s and LDU2s of random IMBE
+// frames, as dibits for the frame assembler, made into C4FM for the FSK4
+// demodulator and into CQPSK for the Gardner and Costas loops, both at 5
+// samples a symbol with some noise and a frequency offset. The FEC decoders
+// get codewords with as many bit errors as they can correct, apart from
+// the DMR trellis, which has no encoder in the tree and gets random bursts.
+// The Phase 2 kernels get AMBE frames of their own, as 4V bursts for the
+// framer.
+//
+// The kernels are called directly, apart from the GNU Radio blocks, which
+// are run in a flowgraph of their own from a vector source to a vector
+// sink, so their numbers include the scheduler.
+//
+// build from a configured build directory with:
+//   make op25-bench
+//
+// or, for the kernels without the GNU Radio blocks, compile from the root
+// of the repository with:
+//   gcc -O3 -c lib/op25_repeater/lib/ambe.c lib/op25_repeater/lib/mbelib.c
+//   g++ -O3 -std=c++17 -DOP25_BENCH_NO_BLOCKS -DGNURADIO_VERSION=0x031000 -I lib/op25_repeater/lib \
+//     utils/op25-bench.cc lib/op25_repeater/lib/{software_imbe_decoder,imbe_decoder,p25p2_vf,p25p2_framer,rs,bch}.cc \
+//     lib/op25_repeater/lib/{golay2087,hamming,bptc19696,trellis}.cc lib/op25_repeater/lib/imbe_vocoder/[a-z]*.cc \
+//     ambe.o mbelib.o -o op25-bench
+//
+// usage:
+//   op25-bench [-s seconds] [-n codewords] [-f file] [-c file] [-d file] [kernel ...]
+//
+//   -s  seconds of synthetic signal and voice (60)
+//   -n  codewords for each FEC decoder (200000)
+//   -f  float32 FSK4 baseband at 24 kHz, the input of fsk4_demod_ff, to use
+//       for the FSK4 kernels instead of the synthetic C4FM
+//   -c  complex float32 baseband at 24 kHz, the input of the CQPSK
+//       demodulator, to use instead of the synthetic CQPSK
+//   -d  dibits, one per byte, to use for the frame assembler instead of
+//       the synthetic LDUs
+//
+// Naming kernels runs only the ones whose names start with one of them.
+
+#include "bch.h"
+#include "bptc19696.h"
+#include "fsk4_timing.h"
+#include "golay2087.h"
+#include "hamming.h"
+#include "imbe_vocoder/imbe_vocoder.h"
+#include "mbelib.h"
+#include "ambe.h" // after mbelib.h, it has the types
+#include "op25_golay.h"
+#include "op25_hamming.h"
+#include "op25_imbe_frame.h"
+#include "op25_simd.h"
+#include "p25_frame.h"
+#include "p25p1_blocks.h"
+#include "p25p2_framer.h"
+#include "p25p2_vf.h"
+#include "rs.h"
+#include "software_imbe_decoder.h"
+#include "trellis.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifndef OP25_BENCH_NO_BLOCKS
+#include "../trunk-recorder/gr_blocks/cqpsk_demod.h"
+
+#include <gnuradio/msg_queue.h>
+#include <gnuradio/top_block.h>
+#include <gnuradio/blocks/vector_sink.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <op25_repeater/costas_loop_cc.h>
+#include <op25_repeater/fsk4_demod_ff.h>
+#include <op25_repeater/fsk4_slicer_fb.h>
+#include <op25_repeater/gardner_cc.h>
+#include <op25_repeater/p25_frame_assembler.h>
+
+#if GNURADIO_VERSION < 0x030800
+#include <gnuradio/blocks/vector_sink_b.h>
+#include <gnuradio/blocks/vector_sink_c.h>
+#include <gnuradio/blocks/vector_sink_f.h>
+#include <gnuradio/blocks/vector_sink_s.h>
+#include <gnuradio/blocks/vector_source_b.h>
+#include <gnuradio/blocks/vector_source_c.h>
+#include <gnuradio/blocks/vector_source_f.h>
+#endif
+#endif
+
+using namespace gr::op25_repeater;
+
+static const double SAMPLE_RATE = 24000;
+static const double SYMBOL_RATE = 4800;
+static const int SPS = 5;
+
+static std::vector<std::string> only;
+
+static bool selected(const char *name) {
+  if (only.empty())
+    return true;
+  for (const std::string &prefix : only) {
+    if (strncmp(name, prefix.c_str(), prefix.size()) == 0)
+      return true;
+  }
+  return false;
+}
+
+struct digest {
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  void add(const void *p, size_t len) {
+    const uint8_t *b = (const uint8_t *)p;
+    for (size_t i = 0; i < len; i++)
+      h = (h ^ b[i]) * 0x100000001b3ULL;
+  }
+
+  template <typename T>
+  void add(const std::vector<T> &v) {
+    add(v.data(), v.size() * sizeof(T));
+  }
+};
+
+static void report(const char *name, const char *unit, size_t items, double secs, const digest &d) {
+  printf("  %-22s %12.0f %-10s %9.1f ns/%-9s digest %016llx\n", name, items / secs, (std::string(unit) + "s/sec").c_str(),
+         secs * 1e9 / items, unit, (unsigned long long)d.h);
+}
+
+template <typename F>
+static double time_secs(F f) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+static bool read_file(const char *path, std::vector<T> &out) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "can't open %s\n", path);
+    return false;
+  }
+  out.clear();
+  T buf[4096];
+  size_t n;
+  while ((n = fread(buf, sizeof(T), 4096, fp)) > 0)
+    out.insert(out.end(), buf, buf + n);
+  fclose(fp);
+  return true;
+}
+
+// The synthetic input
+
+struct imbe_frame {
+  uint32_t u[8];
+};
+
+// Random frames that decode as voice, rather than being repeated or muted
+static std::vector<imbe_frame> make_imbe_frames(std::mt19937 &rng, size_t count) {
+  static const uint32_t masks[8] = {0xfff, 0xfff, 0xfff, 0xfff, 0x7ff, 0x7ff, 0x7ff, 0x7f};
+  std::vector<imbe_frame> frames(count);
+  for (imbe_frame &frame : frames) {
+    do {
+      for (int j = 0; j < 8; j++)
+        frame.u[j] = rng() & masks[j];
+    } while ((((frame.u[0] >> 4) & 0xfc) | ((frame.u[7] >> 1) & 0x3)) > 207);
+  }
+  return frames;
+}
+
+// LDU1s and LDU2s of the frames, as dibits. The headers are the ones
+// p25p1_voice_encode sends, NAC 0x293; the link control and low speed data
+// are left as zeros, which are codewords.
+static std::vector<uint8_t> make_ldu_dibits(const std::vector<imbe_frame> &frames) {
+  static const uint64_t hws[2] = {0x293555ef2c653437ULL, 0x293aba93bec26a2bULL};
+  std::vector<uint8_t> dibits;
+  bit_vector frame_body(P25_VOICE_FRAME_SIZE);
+  for (size_t f = 0; f + nof_voice_codewords <= frames.size(); f += nof_voice_codewords) {
+    std::fill(frame_body.begin(), frame_body.end(), false);
+    for (uint32_t k = 0; k < nof_voice_codewords; k++) {
+      const uint32_t *u = frames[f + k].u;
+      voice_codeword cw(voice_codeword_sz);
+      imbe_header_encode(cw, u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7]);
+      imbe_interleave(frame_body, cw, k);
+    }
+    p25_setup_frame_header(frame_body, hws[(f / nof_voice_codewords) & 1]);
+    for (size_t i = 0; i < P25_VOICE_FRAME_SIZE; i += 2)
+      dibits.push_back((frame_body[i] << 1) | frame_body[i + 1]);
+  }
+  return dibits;
+}
+
+// C4FM as fsk4_demod_ff sees it once the frontend and the AGC are done with
+// it: the symbols at -3 / -1 / +1 / +3 with raised cosine steps between
+// them, an offset that wanders and some noise
+static std::vector<float> make_c4fm(std::mt19937 &rng, const std::vector<uint8_t> &dibits) {
+  static const float levels[4] = {1, 3, -1, -3};
+  std::normal_distribution<float> noise(0, 0.1);
+  std::vector<float> signal(dibits.size() * SPS);
+  float prev = 0;
+  for (size_t s = 0; s < dibits.size(); s++) {
+    float next = levels[dibits[s] & 3];
+    for (int k = 0; k < SPS; k++) {
+      size_t i = s * SPS + k;
+      double shape = 0.5 - 0.5 * cos(M_PI * (k + 1) / SPS);
+      double offset = 0.2 * sin(2 * M_PI * i / (SAMPLE_RATE * 7.0));
+      signal[i] = (float)(prev + (next - prev) * shape + offset) + noise(rng);
+    }
+    prev = next;
+  }
+  return signal;
+}
+
+// CQPSK: each dibit turns the carrier by an odd multiple of 45 degrees,
+// with raised cosine steps between the points, 50 Hz off and some noise
+static std::vector<std::complex<float>> make_cqpsk(std::mt19937 &rng, const std::vector<uint8_t> &dibits) {
+  static const double turns[4] = {M_PI / 4, 3 * M_PI / 4, -M_PI / 4, -3 * M_PI / 4};
+  std::normal_distribution<float> noise(0, 0.05);
+  std::vector<std::complex<float>> signal(dibits.size() * SPS);
+  double phase = 0;
+  std::complex<double> prev = 1;
+  for (size_t s = 0; s < dibits.size(); s++) {
+    phase = remainder(phase + turns[dibits[s] & 3], 2 * M_PI);
+    std::complex<double> next = std::polar(1.0, phase);
+    for (int k = 0; k < SPS; k++) {
+      size_t i = s * SPS + k;
+      double shape = 0.5 - 0.5 * cos(M_PI * (k + 1) / SPS);
+      std::complex<double> sample = (prev + (next - prev) * shape) * std::polar(1.0, 2 * M_PI * 50 * i / SAMPLE_RATE);
+      signal[i] = std::complex<float>(sample.real() + noise(rng), sample.imag() + noise(rng));
+    }
+    prev = next;
+  }
+  return signal;
+}
+
+static uint32_t flip_bits(std::mt19937 &rng, uint32_t word, int bits, int errors) {
+  for (int e = 0; e < errors; e++)
+    word ^= 1u << (rng() % bits);
+  return word;
+}
+
+// The kernels
+
+static void bench_fsk4_timing(const std::vector<float> &signal) {
+  fsk4_timing timing(SYMBOL_RATE / SAMPLE_RATE, false);
+  std::vector<float> symbols(signal.size() / 2 + 4096);
+  size_t count = 0;
+  double secs = time_secs([&] {
+    for (size_t i = 0; i < signal.size(); i += 4096) {
+      int n = std::min((size_t)4096, signal.size() - i);
+      count += timing.work(&signal[i], n, &symbols[count]);
+    }
+  });
+  symbols.resize(count);
+  digest d;
+  d.add(symbols);
+  report("fsk4 timing", "sample", signal.size(), secs, d);
+}
+
+static void bench_imbe(const std::vector<imbe_frame> &frames) {
+  std::mt19937 rng(1);
+  std::vector<voice_codeword> codewords(frames.size(), voice_codeword(voice_codeword_sz));
+  for (size_t i = 0; i < frames.size(); i++) {
+    const uint32_t *u = frames[i].u;
+    imbe_header_encode(codewords[i], u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7]);
+    for (int e = rng() % 3; e > 0; e--) {
+      size_t bit = rng() % voice_codeword_sz;
+      codewords[i][bit] = !codewords[i][bit];
+    }
+  }
+  std::vector<int16_t> audio(frames.size() * IMBE_SAMPLES_PER_FRAME);
+
+  if (selected("imbe soft")) {
+    software_imbe_decoder decoder;
+    double secs = time_secs([&] {
+      for (size_t i = 0; i < frames.size(); i++)
+        decoder.decode(&audio[i * IMBE_SAMPLES_PER_FRAME], codewords[i]);
+    });
+    digest d;
+    d.add(audio);
+    report("imbe soft", "frame", frames.size(), secs, d);
+  }
+
+  if (selected("imbe fixed")) {
+    imbe_vocoder vocoder;
+    double secs = time_secs([&] {
+      for (size_t i = 0; i < frames.size(); i++) {
+        uint32_t E0, ET;
+        uint32_t u[8];
+        imbe_header_decode(codewords[i], u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7], E0, ET);
+        int16_t frame_vector[8];
+        for (int j = 0; j < 8; j++)
+          frame_vector[j] = u[j];
+        vocoder.imbe_decode(frame_vector, &audio[i * IMBE_SAMPLES_PER_FRAME]);
+      }
+    });
+    digest d;
+    d.add(audio);
+    report("imbe fixed", "frame", frames.size(), secs, d);
+  }
+}
+
+// P25 Phase 2 voice the way p25p2_tdma::handle_voice_frame() decodes it:
+// the Golay codes of the frame, then the AMBE parameters, then the speech
+// from the software IMBE decoder
+static void bench_ambe(size_t count) {
+  std::mt19937 rng(2);
+  static const int widths[9] = {7, 5, 5, 9, 7, 5, 4, 4, 3};
+  p25p2_vf vf;
+  std::vector<std::vector<uint8_t>> frames(count, std::vector<uint8_t>(36));
+  for (size_t i = 0; i < count; i++) {
+    int b[9];
+    for (int j = 0; j < 9; j++)
+      b[j] = rng() & ((1 << widths[j]) - 1);
+    b[0] %= 120; // a voice frame, not a tone, erasure or silence
+    vf.encode_vcw(&frames[i][0], b);
+    for (int e = rng() % 3; e > 0; e--)
+      frames[i][rng() % 36] ^= 1 << (rng() & 1);
+  }
+
+  std::vector<int16_t> audio(count * IMBE_SAMPLES_PER_FRAME);
+  software_imbe_decoder decoder;
+  mbe_parms cur_mp, prev_mp, enh_mp;
+  mbe_errs errs_mp;
+  mbe_initMbeParms(&cur_mp, &prev_mp, &enh_mp);
+  mbe_initErrParms(&errs_mp);
+  size_t voice = 0;
+  double secs = time_secs([&] {
+    for (size_t i = 0; i < count; i++) {
+      int b[9];
+      vf.process_vcw(&errs_mp, &frames[i][0], b);
+      if (mbe_dequantizeAmbe2250Parms(&cur_mp, &prev_mp, &errs_mp, b) == 0) {
+        int K = 12;
+        if (cur_mp.L <= 36)
+          K = int(float(cur_mp.L + 2.0) / 3.0);
+        decoder.decode_tap(&audio[i * IMBE_SAMPLES_PER_FRAME], cur_mp.L, K, cur_mp.w0, &cur_mp.Vl[1], &cur_mp.Ml[1]);
+        voice++;
+      }
+      mbe_moveMbeParms(&cur_mp, &prev_mp);
+    }
+  });
+  digest d;
+  d.add(audio);
+  d.add(&voice, sizeof(voice));
+  report("ambe", "frame", count, secs, d);
+}
+
+// P25 Phase 2 bursts the way p25_frame_assembler hands them to p25p2_tdma:
+// the framer, the descrambling, then the AMBE parameters of the four voice
+// frames of a 4V burst, without the vocoder. The bursts are a frame sync
+// and random voice frames, scrambled past the sync with a random mask.
+static void bench_p2_bursts(size_t count) {
+  static const int voice_frames[4] = {11, 48, 96, 133}; // after the first 10 dibits
+  static const int widths[9] = {7, 5, 5, 9, 7, 5, 4, 4, 3};
+  std::mt19937 rng(3);
+  p25p2_vf vf;
+  std::vector<uint8_t> mask(P25P2_BURST_DIBITS - 10);
+  for (uint8_t &m : mask)
+    m = rng() & 3;
+  std::vector<uint8_t> dibits;
+  for (size_t n = 0; n < count; n++) {
+    uint8_t burst[P25P2_BURST_DIBITS];
+    for (int i = 0; i < 20; i++)
+      burst[i] = (P25P2_FRAME_SYNC_MAGIC >> (38 - 2 * i)) & 3;
+    for (size_t i = 20; i < P25P2_BURST_DIBITS; i++)
+      burst[i] = rng() & 3;
+    for (int f = 0; f < 4; f++) {
+      int b[9];
+      for (int j = 0; j < 9; j++)
+        b[j] = rng() & ((1 << widths[j]) - 1);
+      b[0] %= 120;
+      vf.encode_vcw(&burst[10 + voice_frames[f]], b);
+    }
+    for (size_t i = 20; i < P25P2_BURST_DIBITS; i++)
+      burst[i] ^= mask[i - 10];
+    dibits.insert(dibits.end(), burst, burst + P25P2_BURST_DIBITS);
+  }
+
+  p25p2_framer framer;
+  mbe_errs errs_mp;
+  mbe_initErrParms(&errs_mp);
+  std::vector<int> params;
+  params.reserve(count * 4 * 9);
+  size_t bursts = 0;
+  double secs = time_secs([&] {
+    for (size_t i = 0; i < dibits.size();) {
+      bool complete;
+      i += framer.rx_syms(&dibits[i], dibits.size() - i, complete);
+      if (!complete)
+        continue;
+      uint8_t xored[P25P2_BURST_DIBITS - 10];
+      p25p2_descramble(xored, &framer.d_burst[10], &mask[0], sizeof(xored));
+      for (int f = 0; f < 4; f++) {
+        int b[9];
+        vf.process_vcw(&errs_mp, &xored[voice_frames[f]], b);
+        params.insert(params.end(), b, b + 9);
+      }
+      bursts++;
+    }
+  });
+  digest d;
+  d.add(params);
+  d.add(&bursts, sizeof(bursts));
+  report("p25p2 bursts", "burst", count, secs, d);
+}
+
+// A BPTC(196,96) coded DMR burst of the 96 bits of data, one bit per byte,
+// in the 264 bits of a slot with the sync and slot type left out
+static void bptc_encode(const uint8_t *data, uint8_t *slot) {
+  static const int starts[9] = {4, 16, 31, 46, 61, 76, 91, 106, 121};
+  static const int ends[9] = {11, 26, 41, 56, 71, 86, 101, 116, 131};
+  bool d[196] = {false};
+  int pos = 0;
+  for (int r = 0; r < 9; r++) {
+    for (int a = starts[r]; a <= ends[r]; a++)
+      d[a] = data[pos++];
+  }
+  for (int r = 0; r < 9; r++)
+    CHamming::encode15113_2(d + r * 15 + 1);
+  for (int c = 0; c < 15; c++) {
+    bool col[13];
+    for (int a = 0; a < 13; a++)
+      col[a] = d[c + 1 + a * 15];
+    CHamming::encode1393(col);
+    for (int a = 0; a < 13; a++)
+      d[c + 1 + a * 15] = col[a];
+  }
+  bool raw[196];
+  for (int a = 0; a < 196; a++)
+    raw[(a * 181) % 196] = d[a];
+  for (int i = 0; i < 98; i++)
+    slot[i] = raw[i];
+  for (int i = 98; i < 196; i++)
+    slot[i + 68] = raw[i];
+}
+
+// The P25 1/2 rate trellis encoder and interleave, as in p25-block-bench
+static void p25_trellis_encode(const uint8_t data[12], bit_vector &bv) {
+  static const uint8_t next_words[4][4] = {
+      {0x2, 0xC, 0x1, 0xF},
+      {0xE, 0x0, 0xD, 0x3},
+      {0x9, 0x7, 0xA, 0x4},
+      {0x5, 0xB, 0x6, 0x8}};
+  static const uint8_t interleave[196] = {
+      0, 1, 2, 3, 52, 53, 54, 55, 100, 101, 102, 103, 148, 149, 150, 151,
+      4, 5, 6, 7, 56, 57, 58, 59, 104, 105, 106, 107, 152, 153, 154, 155,
+      8, 9, 10, 11, 60, 61, 62, 63, 108, 109, 110, 111, 156, 157, 158, 159,
+      12, 13, 14, 15, 64, 65, 66, 67, 112, 113, 114, 115, 160, 161, 162, 163,
+      16, 17, 18, 19, 68, 69, 70, 71, 116, 117, 118, 119, 164, 165, 166, 167,
+      20, 21, 22, 23, 72, 73, 74, 75, 120, 121, 122, 123, 168, 169, 170, 171,
+      24, 25, 26, 27, 76, 77, 78, 79, 124, 125, 126, 127, 172, 173, 174, 175,
+      28, 29, 30, 31, 80, 81, 82, 83, 128, 129, 130, 131, 176, 177, 178, 179,
+      32, 33, 34, 35, 84, 85, 86, 87, 132, 133, 134, 135, 180, 181, 182, 183,
+      36, 37, 38, 39, 88, 89, 90, 91, 136, 137, 138, 139, 184, 185, 186, 187,
+      40, 41, 42, 43, 92, 93, 94, 95, 140, 141, 142, 143, 188, 189, 190, 191,
+      44, 45, 46, 47, 96, 97, 98, 99, 144, 145, 146, 147, 192, 193, 194, 195,
+      48, 49, 50, 51};
+  bv.assign(196, false);
+  int state = 0;
+  for (int d = 0; d < 49; d++) {
+    int dibit = (d < 48) ? (data[d >> 2] >> (6 - ((d % 4) * 2))) & 3 : 0;
+    uint8_t codeword = next_words[state][dibit];
+    for (int j = 0; j < 4; j++)
+      bv[interleave[d * 4 + j]] = (codeword >> (3 - j)) & 1;
+    state = dibit;
+  }
+}
+
+template <typename Word, typename F>
+static void bench_fec(const char *name, const std::vector<Word> &words, F decode) {
+  if (!selected(name))
+    return;
+  std::vector<uint32_t> out(words.size());
+  double secs = time_secs([&] {
+    for (size_t i = 0; i < words.size(); i++)
+      out[i] = decode(words[i]);
+  });
+  digest d;
+  d.add(out);
+  report(name, "codeword", words.size(), secs, d);
+}
+
+static void bench_fecs(size_t count) {
+  std::mt19937 rng(3);
+  std::vector<uint32_t> words(count);
+
+  for (uint32_t &w : words)
+    w = flip_bits(rng, golay_23_encode(rng() & 0xfff), 23, rng() % 4);
+  bench_fec("golay 23,12", words, [](uint32_t w) {
+    uint32_t cw = w;
+    size_t errs = golay_23_decode(cw);
+    return (cw << 4) | (uint32_t)errs;
+  });
+
+  for (uint32_t &w : words)
+    w = flip_bits(rng, golay_24_encode(rng() & 0xfff), 24, rng() % 4);
+  bench_fec("golay 24,12", words, [](uint32_t w) {
+    size_t errs;
+    return (gly24128Dec(w, &errs) << 4) | (uint32_t)errs;
+  });
+
+  for (uint32_t &w : words)
+    w = flip_bits(rng, hamming_15_encode(rng() & 0x7ff), 15, rng() % 2);
+  bench_fec("hamming 15,11", words, [](uint32_t w) {
+    uint16_t cw = w;
+    size_t errs = hamming_15_decode(cw);
+    return ((uint32_t)cw << 4) | (uint32_t)errs;
+  });
+
+  // The NID, BCH(63,16) with up to 11 errors, as in fec-bench
+  static const uint64_t bch_generator = 0xcd930bdd3b2bULL;
+  std::vector<bit_vector> nids(count, bit_vector(64));
+  for (bit_vector &nid : nids) {
+    uint64_t message = rng() & 0xffff, word = 0;
+    for (int k = 0; k < 16; k++) {
+      if ((message >> k) & 1)
+        word ^= bch_generator << k;
+    }
+    for (int e = rng() % 12; e > 0; e--)
+      word ^= 1ULL << (rng() % 63);
+    for (int j = 0; j < 64; j++)
+      nid[j] = (word >> j) & 1;
+  }
+  bench_fec("bch 63,16", nids, [](const bit_vector &nid) {
+    bit_vector cw = nid;
+    int errs = bchDec(cw);
+    uint32_t message = 0;
+    for (int j = 0; j < 16; j++)
+      message = (message << 1) | cw[j];
+    return (message << 8) | (errs & 0xff);
+  });
+
+  std::vector<bit_vector> blocks(count);
+  for (bit_vector &block : blocks) {
+    uint8_t data[12];
+    for (int j = 0; j < 12; j++)
+      data[j] = rng();
+    p25_trellis_encode(data, block);
+    for (int e = rng() % 3; e > 0; e--) {
+      int bit = rng() % 196;
+      block[bit] = !block[bit];
+    }
+  }
+  bench_fec("p25 trellis 1/2", blocks, [](const bit_vector &block) {
+    uint8_t buf[12];
+    int rc = p25p1_block_deinterleave(block, 0, buf);
+    digest d;
+    d.add(buf, sizeof(buf));
+    return (uint32_t)d.h ^ rc;
+  });
+
+  std::vector<std::vector<uint8_t>> slot_types(count, std::vector<uint8_t>(20));
+  for (std::vector<uint8_t> &slot_type : slot_types) {
+    bit_vector bits(20);
+    for (int j = 0; j < 8; j++)
+      bits[j] = rng() & 1;
+    CGolay2087::encode(bits);
+    for (int j = 0; j < 20; j++)
+      slot_type[j] = bits[j];
+    for (int e = rng() % 4; e > 0; e--)
+      slot_type[rng() % 20] ^= 1;
+  }
+  bench_fec("dmr golay 20,8", slot_types, [](const std::vector<uint8_t> &slot_type) {
+    uint8_t bits[20];
+    memcpy(bits, slot_type.data(), sizeof(bits));
+    return CGolay2087::decode(bits);
+  });
+
+  std::vector<std::vector<uint8_t>> embs(count, std::vector<uint8_t>(16));
+  for (std::vector<uint8_t> &emb : embs) {
+    bit_vector bits(16);
+    for (int j = 0; j < 7; j++)
+      bits[j] = rng() & 1;
+    CQR1676::encode(bits);
+    for (int j = 0; j < 16; j++)
+      emb[j] = bits[j];
+    for (int e = rng() % 3; e > 0; e--)
+      emb[rng() % 16] ^= 1;
+  }
+  bench_fec("dmr qr 16,7", embs, [](const std::vector<uint8_t> &emb) {
+    uint8_t bits[16];
+    memcpy(bits, emb.data(), sizeof(bits));
+    return (uint32_t)CQR1676::decode(bits);
+  });
+
+  std::vector<std::vector<uint8_t>> bursts(count, std::vector<uint8_t>(264));
+  for (std::vector<uint8_t> &burst : bursts) {
+    uint8_t data[96];
+    for (int j = 0; j < 96; j++)
+      data[j] = rng() & 1;
+    bptc_encode(data, &burst[0]);
+    for (int e = rng() % 4; e > 0; e--) {
+      int bit = rng() % 196;
+      burst[(bit < 98) ? bit : bit + 68] ^= 1;
+    }
+  }
+  CBPTC19696 bptc;
+  bench_fec("dmr bptc 196,96", bursts, [&](const std::vector<uint8_t> &burst) {
+    uint8_t out[12];
+    bool rc = bptc.decode(&burst[0], out);
+    digest d;
+    d.add(out, sizeof(out));
+    return (uint32_t)d.h ^ rc;
+  });
+
+  for (std::vector<uint8_t> &burst : bursts) {
+    for (uint8_t &bit : burst)
+      bit = rng() & 1;
+  }
+  CDMRTrellis trellis;
+  bench_fec("dmr trellis 3/4", bursts, [&](const std::vector<uint8_t> &burst) {
+    uint8_t payload[18] = {0};
+    bool rc = trellis.decode(&burst[0], payload);
+    digest d;
+    d.add(payload, sizeof(payload));
+    return (uint32_t)d.h ^ rc;
+  });
+}
+
+#ifndef OP25_BENCH_NO_BLOCKS
+// The block in a flowgraph of its own, from a vector source of in to a
+// vector sink that ends up in out
+template <typename Source, typename Sink, typename In, typename Out>
+static void bench_block(const char *name, const char *unit, gr::basic_block_sptr block, const std::vector<In> &in, std::vector<Out> &out) {
+  gr::top_block_sptr tb = gr::make_top_block(name);
+  typename Source::sptr source = Source::make(in, false);
+  typename Sink::sptr sink = Sink::make();
+  tb->connect(source, 0, block, 0);
+  tb->connect(block, 0, sink, 0);
+  double secs = time_secs([&] { tb->run(); });
+  out = sink->data();
+  digest d;
+  d.add(out);
+  report(name, unit, in.size(), secs, d);
+}
+
+static void bench_blocks(const std::vector<float> &c4fm, const std::vector<std::complex<float>> &cqpsk, const std::vector<uint8_t> &dibits) {
+  static const float slices[] = {-2.0, 0.0, 2.0, 4.0};
+  const double pi = M_PI;
+  // p25_recorder_qpsk_demod's loop gains
+  const double gain_mu = 0.025;
+  const double gain_omega = 0.1 * gain_mu * gain_mu;
+  const double costas_alpha = 0.008;
+
+  std::vector<float> symbols;
+  if (selected("fsk4_demod_ff") || selected("fsk4_slicer_fb")) {
+    gr::msg_queue::sptr tune_queue = gr::msg_queue::make(20);
+    bench_block<gr::blocks::vector_source_f, gr::blocks::vector_sink_f>("fsk4_demod_ff", "sample", fsk4_demod_ff::make(tune_queue, SAMPLE_RATE, SYMBOL_RATE), c4fm, symbols);
+  }
+  if (selected("fsk4_slicer_fb")) {
+    std::vector<uint8_t> sliced;
+    bench_block<gr::blocks::vector_source_f, gr::blocks::vector_sink_b>("fsk4_slicer_fb", "symbol", fsk4_slicer_fb::make(0, 0, std::vector<float>(slices, slices + 4)), symbols, sliced);
+  }
+
+  std::vector<gr_complex> timed;
+  if (selected("gardner_cc") || selected("costas_loop_cc")) {
+    bench_block<gr::blocks::vector_source_c, gr::blocks::vector_sink_c>("gardner_cc", "sample", gardner_cc::make(SPS, gain_mu, gain_omega), cqpsk, timed);
+  }
+  if (selected("costas_loop_cc")) {
+    std::vector<gr_complex> locked;
+    bench_block<gr::blocks::vector_source_c, gr::blocks::vector_sink_c>("costas_loop_cc", "symbol", costas_loop_cc::make(costas_alpha, 4, (2 * pi) / 4), timed, locked);
+  }
+  if (selected("cqpsk_demod")) {
+    std::vector<float> out;
+    bench_block<gr::blocks::vector_source_c, gr::blocks::vector_sink_f>("cqpsk_demod", "sample", make_cqpsk_demod(SPS, gain_mu, gain_omega, costas_alpha, (2 * pi) / 4), cqpsk, out);
+  }
+
+  if (selected("p25_frame_assembler")) {
+    // as p25_recorder_decode makes it, with the fixed point vocoder
+    gr::msg_queue::sptr rx_queue = gr::msg_queue::make(100);
+    std::vector<int16_t> audio;
+    bench_block<gr::blocks::vector_source_b, gr::blocks::vector_sink_s>("p25_frame_assembler", "dibit", p25_frame_assembler::make(0, false, "127.0.0.1", 0, 0, true, true, true, rx_queue, true, false, true), dibits, audio);
+  }
+}
+#endif
+
+int main(int argc, char **argv) {
+  double seconds = 60;
+  size_t codewords = 200000;
+  const char *fsk4_file = NULL;
+  const char *cqpsk_file = NULL;
+  const char *dibit_file = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:f:c:d:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'n':
+      codewords = strtoul(optarg, NULL, 10);
+      break;
+    case 'f':
+      fsk4_file = optarg;
+      break;
+    case 'c':
+      cqpsk_file = optarg;
+      break;
+    case 'd':
+      dibit_file = optarg;
+      break;
+    default:
+      seconds = 0;
+    }
+  }
+  if ((seconds <= 0) || (codewords == 0)) {
+    fprintf(stderr, "usage: %s [-s seconds] [-n codewords] [-f file] [-c file] [-d file] [kernel ...]\n", argv[0]);
+    return 1;
+  }
+  for (int i = optind; i < argc; i++)
+    only.push_back(argv[i]);
+
+  std::mt19937 rng(106);
+  std::vector<imbe_frame> frames = make_imbe_frames(rng, (size_t)(seconds * 50));
+  std::vector<uint8_t> dibits = make_ldu_dibits(frames);
+  std::vector<float> c4fm = make_c4fm(rng, dibits);
+  std::vector<std::complex<float>> cqpsk = make_cqpsk(rng, dibits);
+  if ((fsk4_file && !read_file(fsk4_file, c4fm)) ||
+      (cqpsk_file && !read_file(cqpsk_file, cqpsk)) ||
+      (dibit_file && !read_file(dibit_file, dibits)))
+    return 1;
+
+#if OP25_KERNEL_DISPATCH
+  __builtin_cpu_init();
+  bool avx2 = __builtin_cpu_supports("avx2");
+  bool avx512f = __builtin_cpu_supports("avx512f");
+  printf("cpu: avx2 %s, avx512f %s, running the %s OP25_KERNELs\n", avx2 ? "yes" : "no", avx512f ? "yes" : "no",
+         avx512f ? "avx512f" : (avx2 ? "avx2" : "default"));
+#else
+  printf("cpu: OP25_KERNELs are built once, for the target\n");
+#endif
+
+  printf("%.0f seconds of signal, %zu voice frames, %zu codewords a decoder\n", seconds, frames.size(), codewords);
+  if (selected("fsk4 timing"))
+    bench_fsk4_timing(c4fm);
+  if (selected("imbe"))
+    bench_imbe(frames);
+  if (selected("ambe"))
+    bench_ambe(frames.size());
+  if (selected("p25p2 bursts"))
+    bench_p2_bursts((size_t)(seconds * 50)); // 4V bursts, two slots
+  bench_fecs(codewords);
+#ifndef OP25_BENCH_NO_BLOCKS
+  bench_blocks(c4fm, cqpsk, dibits);
+#endif
+  return 0;
+}
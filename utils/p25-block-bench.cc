@@ -0,0 +1,294 @@
+// p25-block-bench - checks and times the P25 Phase 1 TSBK / PDU block decoding
+//
+// Runs the table driven CRC-CCITT, CRC-32 and 1/2 rate trellis decode from
+// lib/op25_repeater/lib/p25p1_blocks.h against the bit at a time versions
+// p25p1_fdma.cc used before, and reports:
+//
+//   - golden results: how many of a set of blocks the two give different
+//     answers for, over clean encoded blocks, blocks with 1 to 8 bit
+//     errors, and random bits. Anything but 0 is a bug.
+//   - blocks/sec and ns/block for both versions of each
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib utils/p25-block-bench.cc -o p25-block-bench
+//
+// usage:
+//   p25-block-bench [blocks]           default 200000 blocks per test
+
+#include "p25p1_blocks.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace gr::op25_repeater;
+
+typedef std::vector<bool> bit_vector;
+
+static const uint16_t deinterleave_tb[] = {
+    0, 1, 2, 3, 52, 53, 54, 55, 100, 101, 102, 103, 148, 149, 150, 151,
+    4, 5, 6, 7, 56, 57, 58, 59, 104, 105, 106, 107, 152, 153, 154, 155,
+    8, 9, 10, 11, 60, 61, 62, 63, 108, 109, 110, 111, 156, 157, 158, 159,
+    12, 13, 14, 15, 64, 65, 66, 67, 112, 113, 114, 115, 160, 161, 162, 163,
+    16, 17, 18, 19, 68, 69, 70, 71, 116, 117, 118, 119, 164, 165, 166, 167,
+    20, 21, 22, 23, 72, 73, 74, 75, 120, 121, 122, 123, 168, 169, 170, 171,
+    24, 25, 26, 27, 76, 77, 78, 79, 124, 125, 126, 127, 172, 173, 174, 175,
+    28, 29, 30, 31, 80, 81, 82, 83, 128, 129, 130, 131, 176, 177, 178, 179,
+    32, 33, 34, 35, 84, 85, 86, 87, 132, 133, 134, 135, 180, 181, 182, 183,
+    36, 37, 38, 39, 88, 89, 90, 91, 136, 137, 138, 139, 184, 185, 186, 187,
+    40, 41, 42, 43, 92, 93, 94, 95, 140, 141, 142, 143, 188, 189, 190, 191,
+    44, 45, 46, 47, 96, 97, 98, 99, 144, 145, 146, 147, 192, 193, 194, 195,
+    48, 49, 50, 51};
+
+static const uint8_t next_words[4][4] = {
+    {0x2, 0xC, 0x1, 0xF},
+    {0xE, 0x0, 0xD, 0x3},
+    {0x9, 0x7, 0xA, 0x4},
+    {0x5, 0xB, 0x6, 0x8}};
+
+// The versions p25p1_fdma.cc had, as references
+
+static uint16_t ref_crc16(const uint8_t buf[], int len) {
+  uint32_t poly = (1 << 12) + (1 << 5) + (1 << 0);
+  uint32_t crc = 0;
+  for (int i = 0; i < len; i++) {
+    uint8_t bits = buf[i];
+    for (int j = 0; j < 8; j++) {
+      uint8_t bit = (bits >> (7 - j)) & 1;
+      crc = ((crc << 1) | bit) & 0x1ffff;
+      if (crc & 0x10000)
+        crc = (crc & 0xffff) ^ poly;
+    }
+  }
+  crc = crc ^ 0xffff;
+  return crc & 0xffff;
+}
+
+static uint32_t ref_crc32(const uint8_t buf[], int len) {
+  uint32_t g = 0x04c11db7;
+  uint64_t crc = 0;
+  for (int i = 0; i < len; i++) {
+    crc <<= 1;
+    int b = (buf[i / 8] >> (7 - (i % 8))) & 1;
+    if (((crc >> 32) ^ b) & 1)
+      crc ^= g;
+  }
+  crc = (crc & 0xffffffff) ^ 0xffffffff;
+  return crc;
+}
+
+static int find_min(uint8_t list[], int len) {
+  int min = list[0];
+  int index = 0;
+  int unique = 1;
+  for (int i = 1; i < len; i++) {
+    if (list[i] < min) {
+      min = list[i];
+      index = i;
+      unique = 1;
+    } else if (list[i] == min) {
+      unique = 0;
+    }
+  }
+  if (!unique)
+    return -1;
+  return index;
+}
+
+static int count_bits(unsigned int n) {
+  int i = 0;
+  for (i = 0; n != 0; i++)
+    n &= n - 1;
+  return i;
+}
+
+static int ref_block_deinterleave(const bit_vector &bv, unsigned int start, uint8_t *buf) {
+  uint8_t hd[4];
+  int state = 0;
+  memset(buf, 0, 12);
+  for (int b = 0; b < 98 * 2; b += 4) {
+    uint8_t codeword = (bv[start + deinterleave_tb[b + 0]] << 3) +
+                       (bv[start + deinterleave_tb[b + 1]] << 2) +
+                       (bv[start + deinterleave_tb[b + 2]] << 1) +
+                       bv[start + deinterleave_tb[b + 3]];
+    for (int j = 0; j < 4; j++)
+      hd[j] = count_bits(codeword ^ next_words[state][j]);
+    state = find_min(hd, 4);
+    if (state == -1)
+      return -1;
+    int d = b >> 2;
+    if (d < 48)
+      buf[d >> 2] |= state << (6 - ((d % 4) * 2));
+  }
+  return 0;
+}
+
+// 12 bytes of data, to 196 interleaved trellis coded bits
+static void encode_block(const uint8_t data[12], bit_vector &bv) {
+  bv.assign(196, false);
+  int state = 0;
+  for (int d = 0; d < 49; d++) {
+    int dibit = (d < 48) ? (data[d >> 2] >> (6 - ((d % 4) * 2))) & 3 : 0;
+    uint8_t codeword = next_words[state][dibit];
+    for (int j = 0; j < 4; j++)
+      bv[deinterleave_tb[d * 4 + j]] = (codeword >> (3 - j)) & 1;
+    state = dibit;
+  }
+}
+
+// a valid TSBK: the block less its last 2 bytes, then the crc-ccitt of
+// them inverted, which checks as 0
+static void add_crc16(uint8_t block[12]) {
+  block[10] = 0;
+  block[11] = 0;
+  uint16_t crc = ref_crc16(block, 12);
+  block[10] = crc >> 8;
+  block[11] = crc & 0xff;
+}
+
+struct Blocks {
+  std::vector<bit_vector> bits;
+  std::vector<std::vector<uint8_t> > bytes;
+};
+
+static Blocks make_blocks(std::mt19937 &rng, size_t count, int errors, bool random_bits) {
+  Blocks blocks;
+  blocks.bits.resize(count);
+  blocks.bytes.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    std::vector<uint8_t> &data = blocks.bytes[i];
+    data.resize(12);
+    for (int j = 0; j < 12; j++)
+      data[j] = rng() & 0xff;
+    if ((i % 2) == 0)
+      add_crc16(&data[0]);
+    if (random_bits) {
+      blocks.bits[i].resize(196);
+      for (int j = 0; j < 196; j++)
+        blocks.bits[i][j] = rng() & 1;
+    } else {
+      encode_block(&data[0], blocks.bits[i]);
+      for (int e = 0; e < errors; e++) {
+        int bit = rng() % 196;
+        blocks.bits[i][bit] = !blocks.bits[i][bit];
+      }
+    }
+  }
+  return blocks;
+}
+
+static size_t check(const Blocks &blocks, size_t &decoded, size_t &crc_good) {
+  size_t mismatches = 0;
+  decoded = 0;
+  crc_good = 0;
+  for (size_t i = 0; i < blocks.bits.size(); i++) {
+    uint8_t a[12], b[12];
+    int ra = p25p1_block_deinterleave(blocks.bits[i], 0, a);
+    int rb = ref_block_deinterleave(blocks.bits[i], 0, b);
+    if ((ra != rb) || ((ra == 0) && memcmp(a, b, 12))) {
+      mismatches++;
+      continue;
+    }
+    if (ra == 0) {
+      decoded++;
+      if (p25p1_crc16(a, 12) != ref_crc16(a, 12))
+        mismatches++;
+      else if (p25p1_crc16(a, 12) == 0)
+        crc_good++;
+    }
+    const uint8_t *data = &blocks.bytes[i][0];
+    for (int len = 0; len <= 96; len += 1 + (int)(i % 13)) {
+      if (p25p1_crc32(data, len) != ref_crc32(data, len)) {
+        mismatches++;
+        break;
+      }
+    }
+    if (p25p1_crc16(data, 12) != ref_crc16(data, 12))
+      mismatches++;
+  }
+  return mismatches;
+}
+
+template <typename F>
+static double time_ns(size_t count, F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (double)count;
+}
+
+static void report(const char *name, double ref_ns, double new_ns) {
+  printf("  %-28s %8.1f ns/block %10.0f blocks/sec   was %8.1f ns/block   %5.2fx\n",
+         name, new_ns, 1e9 / new_ns, ref_ns, ref_ns / new_ns);
+}
+
+int main(int argc, char *argv[]) {
+  size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+  if (count == 0) {
+    fprintf(stderr, "usage: %s [blocks]\n", argv[0]);
+    return 1;
+  }
+  std::mt19937 rng(65);
+  size_t total_mismatches = 0;
+
+  printf("golden results, %zu blocks each:\n", count);
+  for (int errors = -1; errors <= 8; errors++) {
+    Blocks blocks = make_blocks(rng, count, errors, errors < 0);
+    size_t decoded, crc_good;
+    size_t mismatches = check(blocks, decoded, crc_good);
+    total_mismatches += mismatches;
+    if (errors < 0)
+      printf("  random bits     ");
+    else
+      printf("  %d bit errors    ", errors);
+    printf("%8zu decoded %8zu crc good %6zu mismatches\n", decoded, crc_good, mismatches);
+  }
+
+  printf("throughput:\n");
+  Blocks blocks = make_blocks(rng, count, 2, false);
+  volatile int sink = 0;
+  uint8_t buf[12];
+
+  double ref_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += ref_block_deinterleave(blocks.bits[i], 0, buf) + buf[0];
+  });
+  double new_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += p25p1_block_deinterleave(blocks.bits[i], 0, buf) + buf[0];
+  });
+  report("trellis 1/2 (196 bits)", ref_ns, new_ns);
+
+  ref_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += ref_crc16(&blocks.bytes[i][0], 12);
+  });
+  new_ns = time_ns(count, [&]() {
+    for (size_t i = 0; i < count; i++)
+      sink += p25p1_crc16(&blocks.bytes[i][0], 12);
+  });
+  report("crc16 (12 bytes)", ref_ns, new_ns);
+
+  // an MBT's data is 3 blocks less the 4 byte crc
+  std::vector<uint8_t> mbt(count / 4 * 36 + 36);
+  for (size_t i = 0; i < mbt.size(); i++)
+    mbt[i] = rng() & 0xff;
+  size_t mbts = count / 4;
+  ref_ns = time_ns(mbts, [&]() {
+    for (size_t i = 0; i < mbts; i++)
+      sink += ref_crc32(&mbt[i * 36], 32 * 8);
+  });
+  new_ns = time_ns(mbts, [&]() {
+    for (size_t i = 0; i < mbts; i++)
+      sink += p25p1_crc32(&mbt[i * 36], 32 * 8);
+  });
+  report("crc32 (32 byte MBT data)", ref_ns, new_ns);
+
+  if (total_mismatches) {
+    printf("FAILED: %zu mismatches\n", total_mismatches);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,287 @@
+// p25-parser-bench - correctness and throughput of P25 TSBK and MBT decoding
+//
+// Checks that P25_Bits pulls the same value out of a message as the
+// boost::dynamic_bitset code it replaced, for every field position a TSBK
+// or MBT can have, over random messages of every length OP25 hands the
+// parser and a few it shouldn't. Then reports messages/sec and ns/message:
+//
+//   - for just building the bits of a group voice grant TSBK and pulling
+//     its fields out, with P25_Bits and with the old dynamic_bitset code
+//   - for P25Parser::parse_message() over a control channel's mix of
+//     TSBKs and MBTs: grants, grant updates, affiliations, registrations,
+//     identifier updates and status broadcasts
+//
+// A busy site sends around 40 TSBKs a second, so the numbers are for how
+// many sites one thread can keep up with.
+//
+// build from a configured build directory with:
+//   make p25-parser-bench
+
+#include "../trunk-recorder/systems/p25_bits.h"
+#include "../trunk-recorder/systems/p25_parser.h"
+
+#include <boost/dynamic_bitset.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The message as the parser used to build it: a byte at a time into a
+// dynamic_bitset sized to it, then shifted up for the missing CRC
+static boost::dynamic_bitset<> reference_bits(const std::string &s, int crc_bits) {
+  boost::dynamic_bitset<> b(s.length() * 8 + crc_bits);
+  for (unsigned int i = 0; i < s.length(); ++i) {
+    unsigned char c = (unsigned char)s[i];
+    b <<= 8;
+    for (int j = 0; j < 8; j++) {
+      b[j] = c & 0x1;
+      c >>= 1;
+    }
+  }
+  b <<= crc_bits;
+  return b;
+}
+
+static unsigned long reference_field(const boost::dynamic_bitset<> &b, int shift, unsigned long long mask) {
+  boost::dynamic_bitset<> bitmask(b.size(), mask);
+  return ((b >> shift) & bitmask).to_ulong();
+}
+
+static unsigned long reference_field_left(const boost::dynamic_bitset<> &b, int shift, unsigned long long mask) {
+  boost::dynamic_bitset<> bitmask(b.size(), mask);
+  return ((b << shift) & bitmask).to_ulong();
+}
+
+template <int Words>
+static P25_Bits<Words> make_bits(const std::string &s, int crc_bits) {
+  P25_Bits<Words> bits;
+  for (unsigned int i = 0; i < s.length(); ++i) {
+    bits.push_byte((unsigned char)s[i]);
+  }
+  bits.shift_up(crc_bits);
+  return bits;
+}
+
+static constexpr int mask_width(unsigned long long mask) {
+  return mask ? 1 + mask_width(mask >> 1) : 0;
+}
+
+// Every Shift whose field fits in the message. Past that the two can
+// differ, but only for messages longer than any field looks at.
+template <int Words, unsigned long long Mask, int... Shifts>
+static long check_fields(const P25_Bits<Words> &bits, const boost::dynamic_bitset<> &reference, std::integer_sequence<int, Shifts...>) {
+  long wrong = 0;
+  ((wrong += (Shifts + mask_width(Mask) <= P25_Bits<Words>::bits) && (bits.template field<Shifts, Mask>() != reference_field(reference, Shifts, Mask))), ...);
+  return wrong;
+}
+
+template <int Words>
+static long check_message(const std::string &s, int crc_bits) {
+  P25_Bits<Words> bits = make_bits<Words>(s, crc_bits);
+  boost::dynamic_bitset<> reference = reference_bits(s, crc_bits);
+  std::make_integer_sequence<int, P25_Bits<Words>::bits> shifts;
+  long wrong = 0;
+  wrong += check_fields<Words, 0x1>(bits, reference, shifts);
+  wrong += check_fields<Words, 0x7>(bits, reference, shifts);
+  wrong += check_fields<Words, 0x3f>(bits, reference, shifts);
+  wrong += check_fields<Words, 0xfff>(bits, reference, shifts);
+  wrong += check_fields<Words, 0xfffff>(bits, reference, shifts);
+  wrong += check_fields<Words, 0xffffff>(bits, reference, shifts);
+  wrong += check_fields<Words, 0xffffffff>(bits, reference, shifts);
+  wrong += (bits.template field_left<4, 0xffff0>() != reference_field_left(reference, 4, 0xffff0));
+  return wrong;
+}
+
+static void golden() {
+  std::mt19937 gen(1);
+  long checked = 0;
+  long tsbk_wrong = 0;
+  long header_wrong = 0;
+  long data_wrong = 0;
+  for (int i = 0; i < 2000; i++) {
+    std::string s(i % 17, '\0'); // TSBKs are 10 bytes
+    for (char &c : s) {
+      c = (char)gen();
+    }
+    tsbk_wrong += check_message<2>(s, 16);
+    header_wrong += check_message<2>(s.substr(0, 10), 16);
+    std::string data(i % 25, '\0'); // MBT data is 8, 20 or 32 bytes
+    for (char &c : data) {
+      c = (char)gen();
+    }
+    data_wrong += check_message<3>(data, 32);
+    checked++;
+  }
+  printf("P25_Bits against dynamic_bitset (%ld messages of each kind, every field position)\n", checked);
+  printf("%-12s %10s\n", "bits", "wrong");
+  printf("%-12s %10ld\n", "tsbk", tsbk_wrong);
+  printf("%-12s %10ld\n", "mbt header", header_wrong);
+  printf("%-12s %10ld\n", "mbt data", data_wrong);
+}
+
+// The fields of a group voice channel grant, the most common TSBK
+template <typename Bits>
+static unsigned long grant_fields(const Bits &tsbk) {
+  unsigned long sum = tsbk.template field<88, 0x3f>();
+  sum += tsbk.template field<80, 0xff>();
+  sum += tsbk.template field<72, 0x80>();
+  sum += tsbk.template field<72, 0x40>();
+  sum += tsbk.template field<72, 0x07>();
+  sum += tsbk.template field<56, 0xffff>();
+  sum += tsbk.template field<40, 0xffff>();
+  sum += tsbk.template field<16, 0xffffff>();
+  return sum;
+}
+
+static unsigned long reference_grant_fields(const boost::dynamic_bitset<> &tsbk) {
+  unsigned long sum = reference_field(tsbk, 88, 0x3f);
+  sum += reference_field(tsbk, 80, 0xff);
+  sum += reference_field(tsbk, 72, 0x80);
+  sum += reference_field(tsbk, 72, 0x40);
+  sum += reference_field(tsbk, 72, 0x07);
+  sum += reference_field(tsbk, 56, 0xffff);
+  sum += reference_field(tsbk, 40, 0xffff);
+  sum += reference_field(tsbk, 16, 0xffffff);
+  return sum;
+}
+
+static void field_benchmark() {
+  std::mt19937 gen(2);
+  std::vector<std::string> messages(4096, std::string(10, '\0'));
+  for (std::string &s : messages) {
+    for (char &c : s) {
+      c = (char)gen();
+    }
+    s[0] = 0x00;
+  }
+
+  const int passes = 100;
+  unsigned long sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    for (const std::string &s : messages) {
+      sum += grant_fields(make_bits<2>(s, 16));
+    }
+  }
+  double bits_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  unsigned long reference_sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    for (const std::string &s : messages) {
+      reference_sum += reference_grant_fields(reference_bits(s, 16));
+    }
+  }
+  double reference_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double count = (double)passes * messages.size();
+
+  printf("\nGrant TSBK bits and fields (%zu messages)%s\n", messages.size(), (sum == reference_sum) ? "" : " - THE RESULTS DIFFER");
+  printf("%-16s %14s %12s\n", "", "messages/sec", "ns/message");
+  printf("%-16s %14.0f %12.2f\n", "P25_Bits", count / bits_elapsed, bits_elapsed * 1e9 / count);
+  printf("%-16s %14.0f %12.2f\n", "dynamic_bitset", count / reference_elapsed, reference_elapsed * 1e9 / count);
+}
+
+// A control channel's worth of messages. Identifier updates come first so
+// the grants after them resolve to a frequency.
+static void parse_benchmark() {
+  struct Kind {
+    long type;
+    unsigned char opcode;
+    int weight;
+  };
+  static const Kind kinds[] = {
+      {7, 0x00, 20}, // group voice grant
+      {7, 0x02, 25}, // group voice grant update
+      {7, 0x03, 5},  // grant update, explicit
+      {7, 0x04, 2},  // unit to unit grant
+      {7, 0x20, 3},  // acknowledge
+      {7, 0x28, 8},  // group affiliation response
+      {7, 0x2c, 5},  // unit registration response
+      {7, 0x2f, 2},  // unit deregistration ack
+      {7, 0x33, 1},  // identifier update, TDMA
+      {7, 0x39, 3},  // secondary control channel
+      {7, 0x3a, 4},  // RFSS status
+      {7, 0x3b, 4},  // network status
+      {7, 0x3c, 6},  // adjacent status
+      {7, 0x3d, 1},  // identifier update
+      {7, 0x15, 2},  // an opcode the parser doesn't handle
+      {12, 0x00, 3}, // MBT group voice grant
+      {12, 0x28, 1}, // MBT group affiliation response
+      {12, 0x3a, 2}, // MBT RFSS status
+      {12, 0x3b, 2}, // MBT network status
+  };
+  std::vector<int> pick;
+  for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+    pick.insert(pick.end(), kinds[i].weight, i);
+  }
+
+  std::mt19937 gen(3);
+  std::vector<gr::message::sptr> messages;
+  for (int iden = 0; iden < 4; iden++) {
+    // 851.00625 MHz base, 6.25 kHz spacing, 12.5 kHz wide, no transmit offset
+    std::string s = std::string("\x02\x93", 2) + std::string("\x3d\x00", 2);
+    unsigned long long payload = ((unsigned long long)iden << 60) | (100ULL << 51) | (0ULL << 42) | (50ULL << 32) | 170201250ULL;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      s += (char)(payload >> shift);
+    }
+    messages.push_back(gr::message::make_from_string(s, 7, 0, 0));
+  }
+  for (int i = 0; i < 4096; i++) {
+    const Kind &kind = kinds[pick[gen() % pick.size()]];
+    std::string s = std::string("\x02\x93", 2); // NAC 0x293
+    if (kind.type == 7) {
+      s += (char)kind.opcode;
+      s += (char)((gen() % 8) ? 0x00 : 0x90);
+      for (int j = 0; j < 8; j++) {
+        s += (char)gen();
+      }
+      // Channels on the identifiers above
+      s[5] = (char)(s[5] & 0x3f);
+    } else {
+      std::string header(10, '\0');
+      for (char &c : header) {
+        c = (char)gen();
+      }
+      header[7] = (char)kind.opcode;
+      std::string data(20, '\0');
+      for (char &c : data) {
+        c = (char)gen();
+      }
+      s += header + data;
+    }
+    messages.push_back(gr::message::make_from_string(s, kind.type, 0, 0));
+  }
+
+  System *system = System::make(0);
+  P25Parser parser;
+  const int passes = 50;
+  long decoded = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; p++) {
+    for (const gr::message::sptr &msg : messages) {
+      const std::vector<TrunkMessage> &trunk_messages = parser.parse_message(msg, system);
+      for (const TrunkMessage &message : trunk_messages) {
+        decoded += (message.message_type != UNKNOWN);
+      }
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double count = (double)passes * messages.size();
+
+  printf("\nP25Parser::parse_message (%zu messages, TSBK/MBT mix)\n", messages.size());
+  printf("%14s %12s %10s\n", "messages/sec", "ns/message", "decoded");
+  printf("%14.0f %12.2f %10ld\n", count / elapsed, elapsed * 1e9 / count, decoded / passes);
+}
+
+int main() {
+  boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
+  golden();
+  field_benchmark();
+  parse_benchmark();
+  return 0;
+}
@@ -0,0 +1,46 @@
+#!/bin/sh
+# replay-bench - runs a reference capture through trunk-recorder end to end
+#
+# The config should have one iqfile or sigmf source with "replaySpeed": 0
+# and no "repeat", so the capture is played back as fast as it can be
+# decoded and trunk-recorder stops at the end of it. It is run with
+# --profile, and from its log this reports:
+#
+#   - the wall time, how many seconds of capture that was and the speed up
+#   - the CPU trunk-recorder used, and the share of a core each Recorder and
+#     Source used over the whole run
+#   - the calls concluded, which should not change for the same capture
+#     when only the speed does
+#
+# The call timing follows the samples read, not the clock, so the calls
+# come out the same as a live run would have made them.
+#
+# usage:
+#   replay-bench.sh path/to/trunk-recorder config.json
+# or, from a build directory:
+#   cmake -DREPLAY_BENCH_CONFIG=/path/to/config.json .. && make replay-bench
+
+if [ $# -ne 2 ] || [ -z "$2" ]; then
+  echo "usage: $0 trunk-recorder config.json" >&2
+  exit 1
+fi
+tr="$1"
+config="$2"
+if ! grep -q '"replaySpeed"' "$config"; then
+  echo "$config has no replaySpeed, the capture would be played in real time" >&2
+  exit 1
+fi
+
+log=$(mktemp /tmp/replay-bench.XXXXXX)
+trap 'rm -f "$log"' EXIT
+
+start=$(date +%s.%N)
+"$tr" --config="$config" --profile > "$log" 2>&1
+status=$?
+end=$(date +%s.%N)
+
+echo "trunk-recorder exited with $status, $(awk "BEGIN { printf \"%.1f\", $end - $start }") sec wall time including startup"
+grep -e 'Replay - ' -e 'Call Concluder - Workers' "$log" | tail -n 2 | sed 's/^\[[^]]*\] ([a-z]*)   //'
+# The Whole Run report, down to the blocks
+sed -n '/Profile - Whole Run/,/Blocks by CPU/p' "$log" | grep -v 'Blocks by CPU' | sed 's/^\[[^]]*\] ([a-z]*)   //'
+exit $status
@@ -0,0 +1,158 @@
+// rms-agc-bench - checks and times the RMS AGC of rmsagc_ff and rms_agc
+//
+// Runs lib/op25_repeater/lib/rms_agc_kernel.h against the sample at a time
+// loops it took the place of, over the same noisy signal with a fade and a
+// burst in it, for the float AGC at the alpha p25_recorder_fsk4_demod gives
+// rmsagc_ff and the complex one at the alpha the channelizers give rms_agc,
+// and reports for each:
+//
+//   - accuracy: the largest and the mean error of the kernel's output,
+//     relative to the loop's. The reciprocal square root is approximated,
+//     so it is not 0, but it should be a few parts in 10^7.
+//   - Msamples/sec and ns/sample for both
+//
+// The reference for rms_agc is the rms_cf, multiply_const, add_const and
+// divide_cc it was a flowgraph of, as a loop.
+//
+// compile from the root of the repository with:
+//   g++ -O3 -std=c++17 -I lib/op25_repeater/lib utils/rms-agc-bench.cc -o rms-agc-bench
+//
+// usage:
+//   rms-agc-bench [seconds]         default 60 seconds of signal at 24 kHz
+
+#include "rms_agc_kernel.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace gr::op25_repeater;
+
+static const double SAMPLE_RATE = 24000;
+
+// rmsagc_ff_impl::work() as it was
+static void reference_ff(double alpha, double gain, const std::vector<float> &in, std::vector<float> &out) {
+  double beta = 1 - alpha;
+  double avg = 1.0;
+  for (size_t i = 0; i < in.size(); i++) {
+    double mag_sqrd = in[i] * in[i];
+    avg = beta * avg + alpha * mag_sqrd;
+    if (avg > 0)
+      out[i] = gain * in[i] / sqrt(avg);
+    else
+      out[i] = gain * in[i];
+  }
+}
+
+// rms_cf into multiply_const_ff(1 / reference), add_const_ff(1e-18) and
+// divide_cc
+static void reference_cc(double alpha, double reference, const std::vector<std::complex<float>> &in,
+                         std::vector<std::complex<float>> &out) {
+  double avg = 0;
+  for (size_t i = 0; i < in.size(); i++) {
+    float mag_sqrd = in[i].real() * in[i].real() + in[i].imag() * in[i].imag();
+    avg = alpha * mag_sqrd + (1 - alpha) * avg;
+    float rms = (float)sqrt(avg);
+    float divisor = rms * (float)(1.0 / reference) + 1e-18f;
+    out[i] = in[i] / std::complex<float>(divisor, 0);
+  }
+}
+
+// How loud the signal is over time, so the AGC has something to follow
+static float envelope(size_t i) {
+  double t = i / SAMPLE_RATE;
+  double level = 0.3 + 0.25 * sin(2 * M_PI * 0.7 * t);
+  if (fmod(t, 5.0) > 4.5)
+    level *= 4; // a burst
+  if (fmod(t, 7.0) > 6.0)
+    level *= 0.001; // a fade
+  return (float)level;
+}
+
+template <typename T>
+static void errors(const std::vector<T> &expected, const std::vector<T> &got, double &max_err, double &mean_err) {
+  max_err = 0;
+  double sum = 0;
+  size_t counted = 0;
+  for (size_t i = 0; i < expected.size(); i++) {
+    double mag = std::abs(expected[i]);
+    if (mag < 1e-6)
+      continue;
+    double err = std::abs(got[i] - expected[i]) / mag;
+    max_err = std::max(max_err, err);
+    sum += err;
+    counted++;
+  }
+  mean_err = counted ? sum / counted : 0;
+}
+
+template <typename F>
+static double time_secs(F f) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *name, size_t samples, double ref_secs, double kernel_secs, double max_err, double mean_err) {
+  printf("%-10s max error %.2e, mean error %.2e\n", name, max_err, mean_err);
+  printf("  loop     %8.1f Msamples/sec %6.2f ns/sample\n", samples / ref_secs / 1e6, ref_secs * 1e9 / samples);
+  printf("  kernel   %8.1f Msamples/sec %6.2f ns/sample, %.1fx\n", samples / kernel_secs / 1e6,
+         kernel_secs * 1e9 / samples, ref_secs / kernel_secs);
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 60;
+  if (seconds <= 0) {
+    fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+    return 1;
+  }
+  size_t samples = (size_t)(seconds * SAMPLE_RATE);
+  // GNU Radio hands a block a few thousand samples at a time
+  const int CHUNK = 4096;
+
+  std::mt19937 rng(121);
+  std::normal_distribution<float> noise(0, 1);
+
+  {
+    // p25_recorder_fsk4_demod's baseband_amp
+    const double alpha = 0.01, gain = 1.0;
+    std::vector<float> in(samples), expected(samples), got(samples);
+    for (size_t i = 0; i < samples; i++)
+      in[i] = envelope(i) * (sin(2 * M_PI * 1200 * i / SAMPLE_RATE) + 0.1f * noise(rng));
+
+    double ref_secs = time_secs([&] { reference_ff(alpha, gain, in, expected); });
+    rms_agc_kernel agc(alpha, gain, 1.0);
+    double kernel_secs = time_secs([&] {
+      for (size_t done = 0; done < samples; done += CHUNK)
+        agc.agc(&in[done], &got[done], (int)std::min((size_t)CHUNK, samples - done));
+    });
+    double max_err, mean_err;
+    errors(expected, got, max_err, mean_err);
+    report("rmsagc_ff", samples, ref_secs, kernel_secs, max_err, mean_err);
+  }
+
+  {
+    // the channelizers' rms_agc
+    const double alpha = 0.45, reference = 0.85;
+    std::vector<std::complex<float>> in(samples), expected(samples), got(samples);
+    for (size_t i = 0; i < samples; i++) {
+      double phase = 2 * M_PI * 1800 * i / SAMPLE_RATE;
+      in[i] = envelope(i) * std::complex<float>(cos(phase) + 0.1f * noise(rng), sin(phase) + 0.1f * noise(rng));
+    }
+
+    double ref_secs = time_secs([&] { reference_cc(alpha, reference, in, expected); });
+    rms_agc_kernel agc(alpha, reference, 0.0);
+    double kernel_secs = time_secs([&] {
+      for (size_t done = 0; done < samples; done += CHUNK)
+        agc.agc(&in[done], &got[done], (int)std::min((size_t)CHUNK, samples - done));
+    });
+    double max_err, mean_err;
+    errors(expected, got, max_err, mean_err);
+    report("rms_agc", samples, ref_secs, kernel_secs, max_err, mean_err);
+  }
+  return 0;
+}
@@ -0,0 +1,223 @@
+// smartnet-demod-bench - checks and times the SmartNet control channel demod
+//
+// Plays a capture of a 3600 baud SmartNet control channel through
+// fsk2_slice_kernel, the fused demod of trunk-recorder/gr_blocks/
+// smartnet_fsk2_slicer, and through the blocks it replaced run one after
+// the other over the whole capture, the way they each got their buffer:
+// quadrature_demod_cf, rmsagc_ff, the moving average symbol filter,
+// fsk4_demod_ff and binary_slicer_fb. The bits from both go to an
+// rx_smartnet of their own, like the frame assembler's, and it reports:
+//
+//   - golden results: how many bits differ between the two, and the OSWs
+//     each got through the CRC with a digest of them. The digests should
+//     be the same.
+//   - Msamples/sec and ns/sample for both, and how many control channels
+//     that is in real time on one core
+//
+// The capture is complex float at 18000 samples/sec, 5 a symbol, which is
+// what the control channel's xlat_channelizer hands the demod: a gr
+// file_sink of gr_complex on its output writes one. -g makes up one from
+// random bits instead, which has no OSWs in it but does time the demod.
+//
+// compile from the root of the repository with:
+//   g++ -O2 -std=c++17 -I lib/op25_repeater/lib -I lib/op25_repeater/include -I trunk-recorder/gr_blocks \
+//     utils/smartnet-demod-bench.cc lib/op25_repeater/lib/{rx_smartnet,op25_timer}.cc \
+//     -lgnuradio-runtime -lgnuradio-pmt -lboost_thread -o smartnet-demod-bench
+//
+// usage:
+//   smartnet-demod-bench [-l loops] capture     play the capture loops times (5)
+//   smartnet-demod-bench [-l loops] -g seconds  a made up signal
+
+#include "fsk2_slice_kernel.h"
+#include "op25_msg_types.h"
+#include "rx_smartnet.h"
+
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+using namespace gr::op25_repeater;
+
+static const int SAMPLES_PER_SYMBOL = 5;
+static const double SYMBOL_RATE = 3600;
+static const double CHANNEL_RATE = SYMBOL_RATE * SAMPLES_PER_SYMBOL;
+static const double DEVIATION = 1200;
+
+// The five blocks smartnet_fsk2_demod used to be made of, a stage at a time
+static void reference_chain(const std::vector<gr_complex> &in, std::vector<uint8_t> &bits) {
+  size_t n = in.size();
+
+  // quadrature_demod_cf
+  std::vector<float> fm(n);
+  const float gain = CHANNEL_RATE / (2 * M_PI * DEVIATION);
+  gr_complex last(0, 0);
+  for (size_t i = 0; i < n; i++) {
+    gr_complex product = in[i] * std::conj(last);
+    last = in[i];
+    fm[i] = gain * gr::fast_atan2f(product.imag(), product.real());
+  }
+
+  // rmsagc_ff(0.01, 1.0)
+  std::vector<float> agc(n + SAMPLES_PER_SYMBOL - 1, 0.0f);
+  double avg = 1.0;
+  for (size_t i = 0; i < n; i++) {
+    double mag_sqrd = fm[i] * fm[i];
+    avg = 0.99 * avg + 0.01 * mag_sqrd;
+    agc[SAMPLES_PER_SYMBOL - 1 + i] = (avg > 0) ? 1.0 * fm[i] / sqrt(avg) : 1.0 * fm[i];
+  }
+
+  // fir_filter_fff with samples_per_symbol taps of 1 / samples_per_symbol
+  std::vector<float> filtered(n);
+  const float tap = 1.0 / SAMPLES_PER_SYMBOL;
+  for (size_t i = 0; i < n; i++) {
+    float sum = 0;
+    for (int k = 0; k < SAMPLES_PER_SYMBOL; k++) {
+      sum += tap * agc[i + k];
+    }
+    filtered[i] = sum;
+  }
+
+  // fsk4_demod_ff
+  fsk4_timing timing(SYMBOL_RATE / CHANNEL_RATE, false);
+  std::vector<float> symbols(n);
+  symbols.resize(timing.work(filtered.data(), n, symbols.data()));
+
+  // binary_slicer_fb
+  bits.resize(symbols.size());
+  for (size_t i = 0; i < symbols.size(); i++) {
+    bits[i] = (symbols[i] >= 0) ? 1 : 0;
+  }
+}
+
+struct osw_stats {
+  size_t osws;
+  uint64_t digest;
+};
+
+static osw_stats frame(const std::vector<uint8_t> &bits) {
+  log_ts logger;
+  gr::msg_queue::sptr queue = gr::msg_queue::make(0);
+  rx_smartnet framer("smartnet", logger, 0, 1, queue);
+  osw_stats stats = {0, 0xcbf29ce484222325ULL};
+
+  for (size_t i = 0; i < bits.size(); i++) {
+    framer.rx_sym(bits[i]);
+    while (gr::message::sptr msg = queue->delete_head_nowait()) {
+      if (msg->type() != get_msg_type(PROTOCOL_SMARTNET, M_SMARTNET_OSW)) {
+        continue;
+      }
+      stats.osws++;
+      for (size_t b = 0; b < msg->length(); b++)
+        stats.digest = (stats.digest ^ msg->msg()[b]) * 0x100000001b3ULL;
+    }
+  }
+  return stats;
+}
+
+// Random bits at +/- the deviation, with some noise and a frequency offset
+static std::vector<gr_complex> make_signal(double seconds) {
+  std::mt19937 rng(3600);
+  std::normal_distribution<float> noise(0.0, 0.1);
+  size_t symbols = seconds * SYMBOL_RATE;
+  std::vector<gr_complex> out;
+  out.reserve(symbols * SAMPLES_PER_SYMBOL);
+  double phase = 0;
+  for (size_t s = 0; s < symbols; s++) {
+    double freq = ((rng() & 1) ? DEVIATION : -DEVIATION) + 150.0;
+    for (int k = 0; k < SAMPLES_PER_SYMBOL; k++) {
+      phase += 2 * M_PI * freq / CHANNEL_RATE;
+      out.push_back(gr_complex(cos(phase) + noise(rng), sin(phase) + noise(rng)));
+    }
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  int loops = 5;
+  double generate = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:g:")) != -1) {
+    switch (opt) {
+    case 'l':
+      loops = atoi(optarg);
+      break;
+    case 'g':
+      generate = atof(optarg);
+      break;
+    default:
+      loops = 0;
+    }
+  }
+  if ((loops < 1) || ((generate > 0) == (optind == argc - 1))) {
+    fprintf(stderr, "usage: %s [-l loops] capture | -g seconds\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<gr_complex> samples;
+  if (generate > 0) {
+    samples = make_signal(generate);
+  } else {
+    FILE *fp = fopen(argv[optind], "rb");
+    if (!fp) {
+      fprintf(stderr, "%s: can't open %s\n", argv[0], argv[optind]);
+      return 1;
+    }
+    gr_complex buf[8192];
+    size_t n;
+    while ((n = fread(buf, sizeof(gr_complex), 8192, fp)) > 0)
+      samples.insert(samples.end(), buf, buf + n);
+    fclose(fp);
+  }
+  if (samples.empty()) {
+    fprintf(stderr, "%s: no samples\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<uint8_t> reference_bits;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int l = 0; l < loops; l++)
+    reference_chain(samples, reference_bits);
+  double reference_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Fed to the kernel in uneven pieces, like a flowgraph would
+  std::vector<uint8_t> fused_bits(samples.size());
+  size_t nbits = 0;
+  start = std::chrono::steady_clock::now();
+  for (int l = 0; l < loops; l++) {
+    fsk2_slice_kernel kernel(SAMPLES_PER_SYMBOL, SYMBOL_RATE, DEVIATION);
+    nbits = 0;
+    for (size_t i = 0, piece = 0; i < samples.size(); piece++) {
+      size_t count = std::min(samples.size() - i, (size_t)(700 + (piece * 977) % 3400));
+      nbits += kernel.work(&samples[i], count, &fused_bits[nbits]);
+      i += count;
+    }
+  }
+  double fused_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fused_bits.resize(nbits);
+
+  size_t different = 0;
+  for (size_t i = 0; i < std::min(reference_bits.size(), fused_bits.size()); i++) {
+    if (reference_bits[i] != fused_bits[i])
+      different++;
+  }
+  osw_stats reference_osws = frame(reference_bits);
+  osw_stats fused_osws = frame(fused_bits);
+
+  double total = (double)samples.size() * loops;
+  printf("%zu samples, %.1f sec of control channel\n", samples.size(), samples.size() / CHANNEL_RATE);
+  printf("  golden: %zu of %zu bits different, %zu / %zu bits\n", different, reference_bits.size(), reference_bits.size(), fused_bits.size());
+  printf("  OSWs: blocks %zu digest %016llx, fused %zu digest %016llx%s\n",
+         reference_osws.osws, (unsigned long long)reference_osws.digest,
+         fused_osws.osws, (unsigned long long)fused_osws.digest,
+         (reference_osws.digest == fused_osws.digest) ? "" : "  DIFFERENT");
+  printf("  blocks: %7.2f Msamples/sec  %6.1f ns/sample  %6.0f channels/core\n",
+         total / reference_secs / 1e6, reference_secs * 1e9 / total, total / reference_secs / CHANNEL_RATE);
+  printf("  fused:  %7.2f Msamples/sec  %6.1f ns/sample  %6.0f channels/core\n",
+         total / fused_secs / 1e6, fused_secs * 1e9 / total, total / fused_secs / CHANNEL_RATE);
+  return 0;
+}